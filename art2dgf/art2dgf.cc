@@ -23,27 +23,42 @@
 #include <opm/common/ErrorMacros.hpp>
 #include <opm/common/Exceptions.hpp>
 
-#include <dune/common/version.hh>
-#include <dune/common/fvector.hh>
-#include <dune/common/fmatrix.hh>
-
 #include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
 #include <fstream>
-#include <iomanip>
-#include <vector>
-#include <sstream>
+#include <iostream>
+#include <numeric>
 #include <string>
-#include <memory>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 namespace Ewoms {
 /*!
  * \brief Reads in mesh files in the ART format.
  *
  * This file format is used to specify grids with fractures.
+ *
+ * The ART file is mapped into memory and the conversion is done in two passes: The
+ * first one locates the vertex, edge and element sections of the file and counts the
+ * records in each part of them, the second one parses the parts in parallel. Only the
+ * vertex positions and the edges are kept in memory, the elements are written to the
+ * DGF file as soon as they have been parsed. The output is assembled in large buffers.
  */
-
- struct Art2DGF
- {
+struct Art2DGF
+{
     /*!
      * \brief Create the Grid
      */
@@ -51,217 +66,454 @@ namespace Ewoms {
                          std::ostream& dgfFile,
                          const unsigned precision = 16 )
     {
-        typedef double Scalar;
-        typedef Dune::FieldVector< Scalar, 2 > GlobalPosition;
-        enum ParseMode { Vertex, Edge, Element, Finished };
-        std::vector< std::pair<GlobalPosition, unsigned> > vertexPos;
-        std::vector<std::pair<unsigned, unsigned> > edges;
-        std::vector<std::pair<unsigned, unsigned> > fractureEdges;
-        std::vector<std::vector<unsigned> > elements;
-        std::ifstream inStream(artFileName);
-        if (!inStream.is_open()) {
+        MappedFile artFile(artFileName);
+
+        // first pass: find the sections of the file. they are separated by lines
+        // which only consist of a '$' character
+        std::vector<const char*> sectionBegin(1, artFile.begin());
+        std::vector<const char*> sectionEnd;
+        forEachLine_(artFile.begin(), artFile.end(),
+                     [&](const char* lineBegin, const char* lineEnd)
+                     {
+                         if (lineEnd - lineBegin == 1 && *lineBegin == '$'
+                             && sectionEnd.size() < 3)
+                         {
+                             sectionEnd.push_back(lineBegin);
+                             sectionBegin.push_back(lineEnd);
+                         }
+                     });
+        if (sectionEnd.size() < 2)
             OPM_THROW(std::runtime_error,
-                      "File '" << artFileName
-                      << "' does not exist or is not readable");
+                      "File '" << artFileName << "' is not a valid ART file");
+        if (sectionEnd.size() < 3)
+            sectionEnd.push_back(artFile.end());
+
+        // parse the vertices. only the first two coordinates are used, the last one
+        // is the Z coordinate which we ignore (so far)
+        std::vector<double> vertexPos;
+        std::vector<char> isFractureVertex;
+        size_t numVertices =
+            parseRecords_(sectionBegin[0], sectionEnd[0],
+                          [&](size_t n)
+                          {
+                              vertexPos.resize(2*n);
+                              isFractureVertex.resize(n, 0);
+                          },
+                          [&](size_t vertexIdx, const char* lineBegin, const char* lineEnd)
+                          {
+                              parseVertex_(lineBegin, lineEnd, &vertexPos[2*vertexIdx]);
+                          });
+
+        // parse the edges. the vertices of the edges which have negative data
+        // attached are fracture vertices
+        std::vector<unsigned> edgeVertices;
+        size_t numEdges =
+            parseRecords_(sectionBegin[1], sectionEnd[1],
+                          [&](size_t n)
+                          { edgeVertices.resize(2*n); },
+                          [&](size_t edgeIdx, const char* lineBegin, const char* lineEnd)
+                          {
+                              unsigned* vertIndices = &edgeVertices[2*edgeIdx];
+                              int dataVal = parseIndices_(lineBegin, lineEnd, vertIndices,
+                                                          /*numIndices=*/2, numVertices);
+                              if (dataVal < 0) {
+                                  for (unsigned i = 0; i < 2; ++i) {
+#ifdef _OPENMP
+#pragma omp atomic write
+#endif
+                                      isFractureVertex[vertIndices[i]] = 1;
+                                  }
+                              }
+                          });
+
+        dgfFile << "DGF\n\n";
+
+        dgfFile << "GridParameter\n"
+                << "overlap 1\n"
+                << "closure green\n"
+                << "#\n\n";
+
+        dgfFile << "Vertex\n";
+        const bool hasFractures =
+            std::find(isFractureVertex.begin(), isFractureVertex.end(), 1)
+            != isFractureVertex.end();
+        if( hasFractures )
+        {
+            dgfFile << "parameters 1\n";
         }
-        std::string curLine;
-        ParseMode curParseMode = Vertex;
-        while (inStream) {
-            std::getline(inStream, curLine);
+        const size_t numVertexChunks = (numVertices + verticesPerChunk_ - 1)/verticesPerChunk_;
+        writeChunks_(dgfFile, numVertexChunks,
+                     [&](std::string& buffer, size_t chunkIdx)
+                     {
+                         size_t endIdx = std::min(numVertices, (chunkIdx + 1)*verticesPerChunk_);
+                         for (size_t i = chunkIdx*verticesPerChunk_; i < endIdx; ++i) {
+                             appendScalar_(buffer, vertexPos[2*i], precision);
+                             buffer += ' ';
+                             appendScalar_(buffer, vertexPos[2*i + 1], precision);
+                             if( hasFractures )
+                             {
+                                 buffer += ' ';
+                                 buffer += isFractureVertex[i] ? '1' : '0';
+                             }
+                             buffer += '\n';
+                         }
+                     });
+
+        dgfFile << "#\n\n";
+
+        // parse the elements and write them to the DGF file without storing them
+        dgfFile << "Simplex\n";
+        const auto elementChunks = splitLines_(sectionBegin[2], sectionEnd[2]);
+        writeChunks_(dgfFile, elementChunks.size() - 1,
+                     [&](std::string& buffer, size_t chunkIdx)
+                     {
+                         forEachLine_(elementChunks[chunkIdx], elementChunks[chunkIdx + 1],
+                                      [&](const char* lineBegin, const char* lineEnd)
+                                      {
+                                          unsigned vertIndices[3];
+                                          elementVertices_(vertIndices, lineBegin, lineEnd,
+                                                           edgeVertices, numEdges, vertexPos);
+                                          for (unsigned i = 0; i < 3; ++i) {
+                                              appendUnsigned_(buffer, vertIndices[i]);
+                                              buffer += ' ';
+                                          }
+                                          buffer += '\n';
+                                      });
+                     });
+
+        dgfFile << "#\n\n";
+        dgfFile << "BoundaryDomain\n";
+        dgfFile << "default 1\n";
+        dgfFile << "#\n\n";
+        dgfFile << "#\n";
+
+        dgfFile.flush();
+        if (!dgfFile)
+            OPM_THROW(std::runtime_error, "Could not write the DGF file");
+    }
 
-            // remove comments
-            auto commentPos = curLine.find("%");
-            if (commentPos != curLine.npos) {
-                curLine = curLine.substr(0, commentPos);
-            }
+private:
+    // the number of vertices which are formatted by a thread at once
+    static const size_t verticesPerChunk_ = 1 << 16;
 
-            // remove leading whitespace
-            unsigned numLeadingSpaces = 0;
-            while (curLine.size() > numLeadingSpaces
-                   && std::isspace(curLine[numLeadingSpaces]))
-                ++numLeadingSpaces;
-            curLine = curLine.substr(numLeadingSpaces,
-                                     curLine.size() - numLeadingSpaces);
-
-            // remove trailing whitespace
-            unsigned numTrailingSpaces = 0;
-            while (curLine.size() > numTrailingSpaces
-                   && std::isspace(curLine[curLine.size() - numTrailingSpaces]))
-                ++numTrailingSpaces;
-            curLine = curLine.substr(0, curLine.size() - numTrailingSpaces);
-
-            // a section of the file is finished, go to the next one
-            if (curLine == "$") {
-                if (curParseMode == Vertex)
-                    curParseMode = Edge;
-                else if (curParseMode == Edge)
-                    curParseMode = Element;
-                else if (curParseMode == Element)
-                    curParseMode = Finished;
-                continue;
-            }
+    // the approximate number of bytes of the ART file which are parsed by a thread at once
+    static const size_t bytesPerChunk_ = 1 << 22;
 
-            // skip empty lines
-            if (curLine.empty())
-                continue;
-
-            if (curParseMode == Vertex) {
-                GlobalPosition coord;
-                std::istringstream iss(curLine);
-                // parse only the first two numbers as the vertex
-                // coordinate. the last number is the Z coordinate
-                // which we ignore (so far)
-                iss >> coord[0] >> coord[1];
-                vertexPos.push_back( std::make_pair( coord, 0 ) );
+    // maps a file into memory for reading
+    class MappedFile
+    {
+    public:
+        explicit MappedFile(const std::string& fileName)
+        {
+            data_ = 0;
+            size_ = 0;
+
+            int fd = ::open(fileName.c_str(), O_RDONLY);
+            struct stat statBuf;
+            if (fd < 0 || ::fstat(fd, &statBuf) != 0) {
+                if (fd >= 0)
+                    ::close(fd);
+                OPM_THROW(std::runtime_error,
+                          "File '" << fileName
+                          << "' does not exist or is not readable");
             }
-            else if (curParseMode == Edge) {
-                // read an edge and update the fracture mapper
-
-                // read the data attached to the edge
-                std::istringstream iss(curLine);
-                int dataVal;
-                std::string tmp;
-                iss >> dataVal;
-                iss >> tmp;
-                assert(tmp == ":");
-
-                // read the vertex indices of an edge
-                std::vector<unsigned int> vertIndices;
-                while (iss) {
-                    unsigned int tmp2;
-                    iss >> tmp2;
-                    if (!iss)
-                        break;
-                    vertIndices.push_back(tmp2);
-                    assert(tmp2 < vertexPos.size());
-                }
-
-                // an edge always has two indices!
-                assert(vertIndices.size() == 2);
-
-                std::pair<unsigned, unsigned> edge(vertIndices[0], vertIndices[1]);
-                edges.push_back(edge);
-
-                // add the edge to the fracture mapper if it is a fracture
-                if (dataVal < 0) {
-                    fractureEdges.push_back(edge);
-                    vertexPos[ edge.first  ].second = 1;
-                    vertexPos[ edge.second ].second = 1;
-                }
+
+            size_ = static_cast<size_t>(statBuf.st_size);
+            void* data = 0;
+            if (size_ > 0)
+                data = ::mmap(0, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+            if (data == MAP_FAILED) {
+                size_ = 0;
+                OPM_THROW(std::runtime_error,
+                          "File '" << fileName << "' could not be mapped into memory");
             }
-            else if (curParseMode == Element) {
-                // skip the data attached to an element
-                std::istringstream iss(curLine);
-                int dataVal;
-                std::string tmp;
-                iss >> dataVal;
-                iss >> tmp;
-                assert(tmp == ":");
-
-                // read the edge indices of an element
-                std::vector<unsigned> edgeIndices;
-                while (iss) {
-                    unsigned tmp2;
-                    iss >> tmp2;
-                    if (!iss)
-                        break;
-                    edgeIndices.push_back(tmp2);
-                    assert(tmp2 < edges.size());
-                }
-
-                // so far, we only support triangles
-                assert(edgeIndices.size() == 3);
-
-                // extract the vertex indices of the element
-                std::vector<unsigned> vertIndices;
-                for (unsigned i = 0; i < 3; ++i) {
-                    bool haveFirstVertex = false;
-                    for (unsigned j = 0; j < vertIndices.size(); ++j) {
-                        assert(edgeIndices[i] < edges.size());
-                        if (vertIndices[j] == edges[edgeIndices[i]].first) {
-                            haveFirstVertex = true;
-                            break;
-                        }
-                    }
-                    if (!haveFirstVertex)
-                        vertIndices.push_back(edges[edgeIndices[i]].first);
-
-                    bool haveSecondVertex = false;
-                    for (unsigned j = 0; j < vertIndices.size(); ++j) {
-                        assert(edgeIndices[i] < edges.size());
-                        if (vertIndices[j] == edges[edgeIndices[i]].second) {
-                            haveSecondVertex = true;
-                            break;
-                        }
-                    }
-                    if (!haveSecondVertex)
-                        vertIndices.push_back(edges[edgeIndices[i]].second);
-                }
-
-                // check whether the element's vertices are given in
-                // mathematically positive direction. if not, swap the
-                // first two.
-                Dune::FieldMatrix<Scalar, 2, 2> mat;
-                mat[0] = vertexPos[vertIndices[1]].first;
-                mat[0] -= vertexPos[vertIndices[0]].first;
-                mat[1] = vertexPos[vertIndices[2]].first;
-                mat[1] -= vertexPos[vertIndices[0]].first;
-                assert(std::abs(mat.determinant()) > 1e-50);
-                if (mat.determinant() < 0)
-                    std::swap(vertIndices[2], vertIndices[1]);
-
-                elements.push_back( vertIndices );
+            data_ = static_cast<const char*>(data);
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        ~MappedFile()
+        {
+            if (data_)
+                ::munmap(const_cast<char*>(data_), size_);
+        }
+
+        const char* begin() const
+        { return data_; }
+
+        const char* end() const
+        { return data_ + size_; }
+
+    private:
+        const char* data_;
+        size_t size_;
+    };
+
+    // calls visit(lineBegin, lineEnd) for all lines in [begin, end) which are not empty
+    // after comments and leading and trailing whitespace have been removed
+    template <class Visitor>
+    static void forEachLine_(const char* begin, const char* end, Visitor visit)
+    {
+        while (begin < end) {
+            const char* eol =
+                static_cast<const char*>(std::memchr(begin, '\n', static_cast<size_t>(end - begin)));
+            if (!eol)
+                eol = end;
+
+            // remove comments
+            const char* lineEnd =
+                static_cast<const char*>(std::memchr(begin, '%', static_cast<size_t>(eol - begin)));
+            if (!lineEnd)
+                lineEnd = eol;
+
+            // remove leading and trailing whitespace
+            const char* lineBegin = begin;
+            while (lineBegin < lineEnd && std::isspace(static_cast<unsigned char>(*lineBegin)))
+                ++lineBegin;
+            while (lineEnd > lineBegin && std::isspace(static_cast<unsigned char>(lineEnd[-1])))
+                --lineEnd;
+
+            if (lineBegin < lineEnd)
+                visit(lineBegin, lineEnd);
+
+            begin = (eol < end) ? eol + 1 : end;
+        }
+    }
+
+    // split [begin, end) into parts of approximately bytesPerChunk_ bytes at line
+    // boundaries. the result contains the boundaries of the parts.
+    static std::vector<const char*> splitLines_(const char* begin, const char* end)
+    {
+        std::vector<const char*> bounds(1, begin);
+        while (static_cast<size_t>(end - bounds.back()) > bytesPerChunk_) {
+            const char* pos = bounds.back() + bytesPerChunk_;
+            pos = static_cast<const char*>(std::memchr(pos, '\n', static_cast<size_t>(end - pos)));
+            if (!pos)
+                break;
+            bounds.push_back(pos + 1);
+        }
+        bounds.push_back(end);
+        return bounds;
+    }
+
+    // calls fn(i) for all 0 <= i < n in parallel. the first exception which is thrown
+    // is re-thrown after all calls have finished.
+    template <class Fn>
+    static void parallelFor_(size_t n, Fn fn)
+    {
+        std::exception_ptr exception;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+        for (int i = 0; i < static_cast<int>(n); ++i) {
+            try {
+                fn(static_cast<size_t>(i));
             }
-            else if (curParseMode == Finished) {
-                assert(curLine.size() == 0);
+            catch (...) {
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+                if (!exception)
+                    exception = std::current_exception();
             }
         }
 
-        dgfFile << "DGF" << std::endl << std::endl;
+        if (exception)
+            std::rethrow_exception(exception);
+    }
 
-        dgfFile << "GridParameter" << std::endl
-                << "overlap 1" << std::endl
-                << "closure green" << std::endl
-                << "#" << std::endl << std::endl;
+    // parse all records of a section of the ART file in parallel. since the index of
+    // each record is needed, the records of each part of the section are counted first.
+    template <class Resizer, class Parser>
+    static size_t parseRecords_(const char* begin, const char* end, Resizer resize, Parser parse)
+    {
+        const auto chunks = splitLines_(begin, end);
+        const size_t numChunks = chunks.size() - 1;
+
+        std::vector<size_t> offsets(numChunks + 1, 0);
+        parallelFor_(numChunks,
+                     [&](size_t chunkIdx)
+                     {
+                         size_t n = 0;
+                         forEachLine_(chunks[chunkIdx], chunks[chunkIdx + 1],
+                                      [&](const char*, const char*) { ++n; });
+                         offsets[chunkIdx + 1] = n;
+                     });
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+        resize(offsets.back());
+        parallelFor_(numChunks,
+                     [&](size_t chunkIdx)
+                     {
+                         size_t recordIdx = offsets[chunkIdx];
+                         forEachLine_(chunks[chunkIdx], chunks[chunkIdx + 1],
+                                      [&](const char* lineBegin, const char* lineEnd)
+                                      { parse(recordIdx++, lineBegin, lineEnd); });
+                     });
+
+        return offsets.back();
+    }
 
-        dgfFile << "Vertex" << std::endl;
-        const bool hasFractures = fractureEdges.size() > 0;
-        if( hasFractures )
-        {
-            dgfFile << "parameters 1" << std::endl;
+    // format the output in numChunks parts, up to one per thread at a time, and write
+    // them to the stream in their original order
+    template <class Formatter>
+    static void writeChunks_(std::ostream& os, size_t numChunks, Formatter format)
+    {
+        size_t numThreads = 1;
+#ifdef _OPENMP
+        numThreads = static_cast<size_t>(omp_get_max_threads());
+#endif
+        std::vector<std::string> buffers(numThreads);
+        for (size_t firstChunkIdx = 0; firstChunkIdx < numChunks; firstChunkIdx += numThreads) {
+            size_t n = std::min(numThreads, numChunks - firstChunkIdx);
+            parallelFor_(n,
+                         [&](size_t i)
+                         {
+                             buffers[i].clear();
+                             format(buffers[i], firstChunkIdx + i);
+                         });
+
+            for (size_t i = 0; i < n; ++i)
+                os.write(buffers[i].data(), static_cast<std::streamsize>(buffers[i].size()));
         }
-        dgfFile << std::scientific;
-        dgfFile.precision( precision );
-        const size_t vxSize = vertexPos.size();
-        for( size_t i=0; i<vxSize; ++i)
-        {
-            dgfFile << vertexPos[ i ].first;
-            if( hasFractures )
-            {
-                dgfFile << " " << vertexPos[ i ].second;
-            }
-            dgfFile << std::endl;
+    }
+
+    static void throwParseError_(const char* lineBegin, const char* lineEnd)
+    {
+        OPM_THROW(std::runtime_error,
+                  "Malformed line in ART file: '" << std::string(lineBegin, lineEnd) << "'");
+    }
+
+    // parse the first two coordinates of a vertex. the line is always followed by the
+    // end of its section, so strtod() cannot read beyond the end of the file.
+    static void parseVertex_(const char* lineBegin, const char* lineEnd, double* pos)
+    {
+        const char* cur = lineBegin;
+        for (unsigned i = 0; i < 2; ++i) {
+            char* numEnd;
+            pos[i] = std::strtod(cur, &numEnd);
+            if (numEnd == cur || numEnd > lineEnd)
+                throwParseError_(lineBegin, lineEnd);
+            cur = numEnd;
         }
+    }
 
-        dgfFile << "#" << std::endl << std::endl;
+    static const char* skipSpace_(const char* cur, const char* lineEnd)
+    {
+        while (cur < lineEnd && std::isspace(static_cast<unsigned char>(*cur)))
+            ++cur;
+        return cur;
+    }
 
-        dgfFile << "Simplex" << std::endl;
-        const size_t elSize = elements.size();
-        for( size_t i=0; i<elSize; ++i )
-        {
-            const size_t elVx = elements[ i ].size();
-            for( size_t j=0; j<elVx; ++j )
-                dgfFile << elements[ i ][ j ] << " ";
-            dgfFile << std::endl;
+    static unsigned parseUnsigned_(const char*& cur,
+                                   const char* lineBegin,
+                                   const char* lineEnd)
+    {
+        cur = skipSpace_(cur, lineEnd);
+        if (cur == lineEnd || !std::isdigit(static_cast<unsigned char>(*cur)))
+            throwParseError_(lineBegin, lineEnd);
+
+        unsigned result = 0;
+        for (; cur < lineEnd && std::isdigit(static_cast<unsigned char>(*cur)); ++cur)
+            result = 10*result + static_cast<unsigned>(*cur - '0');
+        return result;
+    }
+
+    // parse a line of the form 'DATA : IDX_1 ... IDX_N' where all indices must be
+    // smaller than maxIdx. DATA is returned.
+    static int parseIndices_(const char* lineBegin,
+                             const char* lineEnd,
+                             unsigned* indices,
+                             unsigned numIndices,
+                             size_t maxIdx)
+    {
+        const char* cur = lineBegin;
+        bool negative = (*cur == '-');
+        if (negative || *cur == '+')
+            ++cur;
+        int dataVal = static_cast<int>(parseUnsigned_(cur, lineBegin, lineEnd));
+        if (negative)
+            dataVal = -dataVal;
+
+        cur = skipSpace_(cur, lineEnd);
+        if (cur == lineEnd || *cur != ':')
+            throwParseError_(lineBegin, lineEnd);
+        ++cur;
+
+        for (unsigned i = 0; i < numIndices; ++i) {
+            indices[i] = parseUnsigned_(cur, lineBegin, lineEnd);
+            if (indices[i] >= maxIdx)
+                throwParseError_(lineBegin, lineEnd);
         }
 
-        dgfFile << "#" << std::endl << std::endl;
-        dgfFile << "BoundaryDomain" << std::endl;
-        dgfFile << "default 1" << std::endl;
-        dgfFile << "#" << std::endl << std::endl;
-        dgfFile << "#" << std::endl;
+        if (skipSpace_(cur, lineEnd) != lineEnd)
+            throwParseError_(lineBegin, lineEnd);
+        return dataVal;
+    }
+
+    // determine the vertices of a triangle from its edges. the vertices are returned in
+    // mathematically positive direction.
+    static void elementVertices_(unsigned* vertIndices,
+                                 const char* lineBegin,
+                                 const char* lineEnd,
+                                 const std::vector<unsigned>& edgeVertices,
+                                 size_t numEdges,
+                                 const std::vector<double>& vertexPos)
+    {
+        // so far, we only support triangles
+        unsigned edgeIndices[3];
+        parseIndices_(lineBegin, lineEnd, edgeIndices, /*numIndices=*/3, numEdges);
+
+        unsigned numVertices = 0;
+        for (unsigned i = 0; i < 3; ++i) {
+            for (unsigned j = 0; j < 2; ++j) {
+                unsigned vertIdx = edgeVertices[2*edgeIndices[i] + j];
+                if (std::find(vertIndices, vertIndices + numVertices, vertIdx)
+                    != vertIndices + numVertices)
+                    continue;
+                if (numVertices == 3)
+                    throwParseError_(lineBegin, lineEnd);
+                vertIndices[numVertices++] = vertIdx;
+            }
+        }
+        if (numVertices != 3)
+            throwParseError_(lineBegin, lineEnd);
+
+        // check whether the element's vertices are given in mathematically positive
+        // direction. if not, swap the last two.
+        const double* x0 = &vertexPos[2*vertIndices[0]];
+        const double* x1 = &vertexPos[2*vertIndices[1]];
+        const double* x2 = &vertexPos[2*vertIndices[2]];
+        double det = (x1[0] - x0[0])*(x2[1] - x0[1]) - (x1[1] - x0[1])*(x2[0] - x0[0]);
+        if (!(std::abs(det) > 1e-50))
+            OPM_THROW(std::runtime_error,
+                      "Degenerate element in ART file: '"
+                      << std::string(lineBegin, lineEnd) << "'");
+        if (det < 0)
+            std::swap(vertIndices[2], vertIndices[1]);
+    }
+
+    static void appendUnsigned_(std::string& buffer, unsigned value)
+    {
+        char tmp[16];
+        unsigned n = 0;
+        do {
+            tmp[n++] = static_cast<char>('0' + value%10);
+            value /= 10;
+        } while (value > 0);
+        while (n > 0)
+            buffer += tmp[--n];
+    }
+
+    static void appendScalar_(std::string& buffer, double value, unsigned precision)
+    {
+        char tmp[64];
+        int n = std::snprintf(tmp, sizeof(tmp), "%.*e", static_cast<int>(precision), value);
+        buffer.append(tmp, static_cast<size_t>(std::min(n, static_cast<int>(sizeof(tmp)) - 1)));
     }
- };
+};
 
 } // namespace Ewoms
 
@@ -0,0 +1,224 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \brief Measures the throughput of the kernels of the finite volume discretizations.
+ *
+ * For the problem specified by the type tag, the stencil update, the update of the
+ * intensive quantities, the complete update of the element context and the local
+ * linearization are executed for all elements of the grid using different numbers of
+ * threads. For each kernel and each thread count, the number of elements processed per
+ * second is printed. Only the time spend in the kernel itself is measured, i.e., the
+ * preparations required by a kernel (e.g., updating the element context before the
+ * local linearization) are excluded.
+ */
+#ifndef EWOMS_KERNEL_BENCHMARK_HH
+#define EWOMS_KERNEL_BENCHMARK_HH
+
+#include "../tests/problems/reservoirproblem.hh"
+
+#include <ewoms/common/start.hh>
+#include <ewoms/io/cubegridmanager.hh>
+
+#include <opm/common/Unused.hpp>
+
+#include <dune/common/version.hh>
+#include <dune/common/parallel/mpihelper.hh>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+namespace Ewoms {
+namespace Properties {
+NEW_TYPE_TAG(KernelBenchmarkBaseProblem, INHERITS_FROM(ReservoirBaseProblem));
+
+//! The number of times each kernel is executed for all elements
+NEW_PROP_TAG(KernelBenchmarkRepetitions);
+
+// use a structured grid which is considerably larger than the one of the regression
+// test so that the timings are not dominated by noise
+SET_TYPE_PROP(KernelBenchmarkBaseProblem, GridManager, Ewoms::CubeGridManager<TypeTag>);
+SET_SCALAR_PROP(KernelBenchmarkBaseProblem, DomainSizeX, 6000.0);
+SET_SCALAR_PROP(KernelBenchmarkBaseProblem, DomainSizeY, 60.0);
+SET_SCALAR_PROP(KernelBenchmarkBaseProblem, DomainSizeZ, 1.0);
+SET_INT_PROP(KernelBenchmarkBaseProblem, CellsX, 1000);
+SET_INT_PROP(KernelBenchmarkBaseProblem, CellsY, 100);
+SET_INT_PROP(KernelBenchmarkBaseProblem, CellsZ, 1);
+
+SET_INT_PROP(KernelBenchmarkBaseProblem, KernelBenchmarkRepetitions, 3);
+} // namespace Properties
+
+/*!
+ * \brief Run a kernel for all elements of the grid using a given number of threads.
+ *
+ * The prepare function is called before the kernel for each element but its run time
+ * is not measured.
+ *
+ * \return The number of elements processed per second
+ */
+template <class TypeTag, class PrepareFn, class KernelFn>
+double measureKernel(const typename GET_PROP_TYPE(TypeTag, Simulator)& simulator,
+                     int numThreads,
+                     unsigned numRepetitions,
+                     const PrepareFn& prepare,
+                     const KernelFn& kernel)
+{
+    typedef typename GET_PROP_TYPE(TypeTag, ThreadManager) ThreadManager;
+    typedef typename GET_PROP_TYPE(TypeTag, ElementContext) ElementContext;
+    typedef typename GET_PROP_TYPE(TypeTag, GridView) GridView;
+    typedef typename GridView::template Codim<0>::Entity Element;
+    typedef std::chrono::high_resolution_clock Clock;
+
+    const auto& grid = simulator.gridView().grid();
+    const auto& elemSeeds = simulator.model().elementSeeds();
+    int numElems = static_cast<int>(elemSeeds.size());
+
+    // the time spend in the kernel by each thread. the throughput is determined by the
+    // slowest thread.
+    std::vector<double> threadTime(static_cast<unsigned>(numThreads), 0.0);
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(numThreads)
+#endif
+    {
+        unsigned threadId = ThreadManager::threadId();
+        ElementContext elemCtx(simulator);
+        double time = 0.0;
+
+        for (unsigned repIdx = 0; repIdx < numRepetitions; ++repIdx) {
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+            for (int elemIdx = 0; elemIdx < numElems; ++elemIdx) {
+#if DUNE_VERSION_NEWER(DUNE_GRID, 2, 4)
+                const Element& elem = grid.entity(elemSeeds[elemIdx]);
+#else
+                const auto& elemPtr = grid.entity(elemSeeds[elemIdx]);
+                const Element& elem = *elemPtr;
+#endif
+                prepare(elemCtx, elem, threadId);
+
+                auto startTime = Clock::now();
+                kernel(elemCtx, elem, threadId);
+                time += std::chrono::duration<double>(Clock::now() - startTime).count();
+            }
+        }
+
+        threadTime[threadId] = time;
+    }
+
+    double maxTime = *std::max_element(threadTime.begin(), threadTime.end());
+    return numElems*numRepetitions/std::max(maxTime, 1e-30);
+}
+
+/*!
+ * \brief Set up the simulator for the problem specified by the type tag and measure the
+ *        throughput of the discretization kernels.
+ */
+template <class TypeTag>
+int runKernelBenchmarks(int argc, char **argv)
+{
+    typedef typename GET_PROP_TYPE(TypeTag, Scalar) Scalar;
+    typedef typename GET_PROP_TYPE(TypeTag, Simulator) Simulator;
+    typedef typename GET_PROP_TYPE(TypeTag, ThreadManager) ThreadManager;
+    typedef typename GET_PROP_TYPE(TypeTag, ElementContext) ElementContext;
+    typedef typename GET_PROP_TYPE(TypeTag, GridView) GridView;
+    typedef typename GridView::template Codim<0>::Entity Element;
+
+    Dune::MPIHelper::instance(argc, argv);
+
+    EWOMS_REGISTER_PARAM(TypeTag, unsigned, KernelBenchmarkRepetitions,
+                         "The number of times each kernel is executed for all elements");
+    int paramStatus = setupParameters_<TypeTag>(argc, argv);
+    if (paramStatus == 1)
+        return 1;
+    if (paramStatus == 2)
+        return 0;
+
+    ThreadManager::init();
+
+    Simulator simulator(/*verbose=*/false);
+    simulator.model().applyInitialSolution();
+    simulator.setTimeStepSize(EWOMS_GET_PARAM(TypeTag, Scalar, InitialTimeStepSize));
+
+    unsigned numRepetitions = EWOMS_GET_PARAM(TypeTag, unsigned, KernelBenchmarkRepetitions);
+    auto noPrepare =
+        [](ElementContext& elemCtx OPM_UNUSED, const Element& elem OPM_UNUSED, unsigned threadId OPM_UNUSED)
+        {};
+    auto updateStencil =
+        [](ElementContext& elemCtx, const Element& elem, unsigned threadId OPM_UNUSED)
+        { elemCtx.updateStencil(elem); };
+    auto updateIntensiveQuantities =
+        [](ElementContext& elemCtx, const Element& elem OPM_UNUSED, unsigned threadId OPM_UNUSED)
+        { elemCtx.updatePrimaryIntensiveQuantities(/*timeIdx=*/0); };
+    auto updateAll =
+        [](ElementContext& elemCtx, const Element& elem, unsigned threadId OPM_UNUSED)
+        { elemCtx.updateAll(elem); };
+    auto localLinearize =
+        [&simulator](ElementContext& elemCtx, const Element& elem OPM_UNUSED, unsigned threadId)
+        { simulator.model().localLinearizer(threadId).linearize(elemCtx); };
+
+    std::cout << "Number of elements: " << simulator.model().elementSeeds().size() << "\n"
+              << "Throughput [elements/s]:\n"
+              << std::setw(8) << "Threads"
+              << std::setw(18) << "updateStencil"
+              << std::setw(18) << "intensiveQuants"
+              << std::setw(18) << "updateAll"
+              << std::setw(18) << "localLinearize" << "\n";
+
+    // double the number of threads until the maximum number is reached
+    int maxThreads = static_cast<int>(ThreadManager::maxThreads());
+    for (int numThreads = 1; ; numThreads = std::min(2*numThreads, maxThreads)) {
+        std::cout << std::setw(8) << numThreads
+                  << std::setw(18)
+                  << measureKernel<TypeTag>(simulator, numThreads, numRepetitions,
+                                            noPrepare, updateStencil)
+                  << std::setw(18)
+                  << measureKernel<TypeTag>(simulator, numThreads, numRepetitions,
+                                            updateStencil, updateIntensiveQuantities)
+                  << std::setw(18)
+                  << measureKernel<TypeTag>(simulator, numThreads, numRepetitions,
+                                            noPrepare, updateAll)
+                  << std::setw(18)
+                  << measureKernel<TypeTag>(simulator, numThreads, numRepetitions,
+                                            updateAll, localLinearize)
+                  << "\n" << std::flush;
+
+        if (numThreads == maxThreads)
+            break;
+    }
+
+    return 0;
+}
+
+} // namespace Ewoms
+
+#endif
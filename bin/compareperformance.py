@@ -0,0 +1,70 @@
+#! /usr/bin/python
+#
+# Compares the performance record of a test run (cf. the PerformanceRecordFile
+# parameter) with a stored baseline record and reports all quantities which got worse
+# by more than a given tolerance.
+#
+# Usage:
+#
+# compareperformance.py BASELINE_RECORD CURRENT_RECORD [REL_TOLERANCE [ABS_TIME_TOLERANCE]]
+#
+from __future__ import print_function
+import sys
+
+# the quantities which only identify the run and are thus not compared
+identityKeys = [ "problem", "num_processes" ]
+
+def readRecord(fileName):
+    record = {}
+    for curLine in open(fileName):
+        fields = curLine.split()
+        if len(fields) != 2:
+            continue
+        record[fields[0]] = fields[1]
+    return record
+
+def compareRecords(baseline, current, relTol, absTimeTol):
+    for key in identityKeys:
+        if baseline.get(key) != current.get(key):
+            print('The records do not describe the same kind of run: "%s" is "%s" for the baseline and "%s" for the current run'%(key, baseline.get(key), current.get(key)))
+            return False
+
+    success = True
+    for key in sorted(baseline.keys()):
+        if key in identityKeys:
+            continue
+        if key not in current:
+            print('Quantity "%s" is missing in the record of the current run'%key)
+            success = False
+            continue
+
+        baseValue = float(baseline[key])
+        curValue = float(current[key])
+
+        # short timings are dominated by noise, so they get some absolute slack
+        limit = baseValue*(1 + relTol)
+        if key.endswith("_seconds"):
+            limit = max(limit, baseValue + absTimeTol)
+
+        if curValue > limit:
+            print('Regression of "%s": %g (baseline: %g, %+.1f%%)'%(key, curValue, baseValue, 100*(curValue/baseValue - 1) if baseValue > 0 else float("inf")))
+            success = False
+        elif curValue < baseValue/(1 + relTol):
+            print('Improvement of "%s": %g (baseline: %g)'%(key, curValue, baseValue))
+    return success
+
+if len(sys.argv) < 3 or len(sys.argv) > 5:
+    print(sys.argv[0], "BASELINE_RECORD CURRENT_RECORD [REL_TOLERANCE [ABS_TIME_TOLERANCE]]")
+    sys.exit(2)
+
+relTol = 0.2
+if len(sys.argv) > 3:
+    relTol = float(sys.argv[3])
+absTimeTol = 0.1
+if len(sys.argv) > 4:
+    absTimeTol = float(sys.argv[4])
+
+if compareRecords(readRecord(sys.argv[1]), readRecord(sys.argv[2]), relTol, absTimeTol):
+    sys.exit(0)
+else:
+    sys.exit(1)
@@ -0,0 +1,181 @@
+#! /usr/bin/python
+#
+# Converts the binary convergence logs of the Newton method to VTK
+# files.
+#
+# The logs are written by the Newton method if the parameters
+# NewtonWriteConvergence=true and NewtonConvergenceFormat=binary are
+# specified (cf. FvBaseBinaryConvergenceWriter). For each recorded
+# Newton iteration, a '.vtu' file which contains the degrees of
+# freedom as a point cloud with the residual and the update of each
+# equation as point data is written. A '.pvd' file which references
+# them in the order of the iterations is written as well.
+#
+# Example:
+#
+# convergence2vtk.py --output=conv convergence-0.bin
+#
+from __future__ import print_function
+
+import argparse
+import os
+import struct
+import sys
+import zlib
+
+noCompression = 0
+zlibCompression = 1
+lz4Compression = 2
+
+class LogReader:
+    def __init__(self, fileName):
+        self.f = open(fileName, "rb")
+
+        magic = self.f.read(8)
+        if magic != b"EWCONV1\0":
+            raise RuntimeError("'%s' is not a binary convergence log"%fileName)
+
+        self.numDof, self.numEq, self.compression = self.unpack_("III")
+        if self.compression == lz4Compression:
+            # the python LZ4 bindings are optional
+            import lz4.block
+            self.lz4 = lz4.block
+
+        self.pvNames = [self.readString_() for i in range(self.numEq)]
+        self.eqNames = [self.readString_() for i in range(self.numEq)]
+        self.positions = self.readBlock_()
+
+    def iterations(self):
+        # yields the time step index, the iteration index, the time, the
+        # time step size, the residual and the update of each record
+        while True:
+            head = self.f.read(struct.calcsize("=iidd"))
+            if len(head) == 0:
+                return
+            if len(head) < struct.calcsize("=iidd"):
+                print("Warning: ignoring truncated record at the end of the log",
+                      file=sys.stderr)
+                return
+
+            timeStepIdx, iterIdx, time, timeStepSize = struct.unpack("=iidd", head)
+            try:
+                residual = self.readBlock_()
+                update = self.readBlock_()
+            except EOFError:
+                print("Warning: ignoring truncated record at the end of the log",
+                      file=sys.stderr)
+                return
+
+            yield timeStepIdx, iterIdx, time, timeStepSize, residual, update
+
+    def unpack_(self, fmt):
+        fmt = "=" + fmt
+        size = struct.calcsize(fmt)
+        data = self.f.read(size)
+        if len(data) < size:
+            raise EOFError()
+        return struct.unpack(fmt, data)
+
+    def readString_(self):
+        n, = self.unpack_("I")
+        return self.f.read(n).decode("ascii")
+
+    def readBlock_(self):
+        rawSize, storedSize = self.unpack_("QQ")
+        data = self.f.read(storedSize)
+        if len(data) < storedSize:
+            raise EOFError()
+
+        if self.compression == zlibCompression:
+            data = zlib.decompress(data)
+        elif self.compression == lz4Compression:
+            data = self.lz4.decompress(data, uncompressed_size=rawSize)
+
+        return struct.unpack("=%df"%(rawSize//4), data)
+
+def writeArray(f, name, numComponents, values):
+    f.write('    <DataArray type="Float32" Name="%s" NumberOfComponents="%d" format="ascii">\n'
+            %(name, numComponents))
+    for i in range(0, len(values), 8):
+        f.write("     " + " ".join("%g"%v for v in values[i:i + 8]) + "\n")
+    f.write('    </DataArray>\n')
+
+def writeVtu(fileName, log, residual, update):
+    n = log.numDof
+    with open(fileName, "w") as f:
+        f.write('<?xml version="1.0"?>\n')
+        f.write('<VTKFile type="UnstructuredGrid" version="0.1" byte_order="LittleEndian">\n')
+        f.write(' <UnstructuredGrid>\n')
+        f.write('  <Piece NumberOfPoints="%d" NumberOfCells="%d">\n'%(n, n))
+
+        f.write('   <PointData>\n')
+        for eqIdx in range(log.numEq):
+            writeArray(f, "defect_" + log.eqNames[eqIdx], 1, residual[eqIdx::log.numEq])
+        for eqIdx in range(log.numEq):
+            # the convergence log stores the negative update, like the
+            # Newton method
+            writeArray(f, "delta_" + log.pvNames[eqIdx], 1,
+                       [-v for v in update[eqIdx::log.numEq]])
+        f.write('   </PointData>\n')
+
+        f.write('   <Points>\n')
+        writeArray(f, "Coordinates", 3, log.positions)
+        f.write('   </Points>\n')
+
+        # each DOF is a vertex cell
+        f.write('   <Cells>\n')
+        f.write('    <DataArray type="Int32" Name="connectivity" format="ascii">\n')
+        f.write("     " + " ".join(str(i) for i in range(n)) + "\n")
+        f.write('    </DataArray>\n')
+        f.write('    <DataArray type="Int32" Name="offsets" format="ascii">\n')
+        f.write("     " + " ".join(str(i + 1) for i in range(n)) + "\n")
+        f.write('    </DataArray>\n')
+        f.write('    <DataArray type="UInt8" Name="types" format="ascii">\n')
+        f.write("     " + " ".join("1" for i in range(n)) + "\n")
+        f.write('    </DataArray>\n')
+        f.write('   </Cells>\n')
+
+        f.write('  </Piece>\n')
+        f.write(' </UnstructuredGrid>\n')
+        f.write('</VTKFile>\n')
+
+def main():
+    parser = argparse.ArgumentParser(description="Convert the binary convergence log of "
+                                     "the Newton method to VTK files")
+    parser.add_argument("log", help="the convergence log, e.g. 'convergence-0.bin'")
+    parser.add_argument("--output", default=None,
+                        help="the prefix of the VTK files (default: the name of the log)")
+    parser.add_argument("--time-step", type=int, default=None,
+                        help="only convert the iterations of the given time step")
+    args = parser.parse_args()
+
+    prefix = args.output
+    if prefix is None:
+        prefix = os.path.splitext(args.log)[0]
+
+    log = LogReader(args.log)
+    entries = []
+    for timeStepIdx, iterIdx, time, timeStepSize, residual, update in log.iterations():
+        if args.time_step is not None and timeStepIdx != args.time_step:
+            continue
+
+        vtuName = "%s-%05d-%03d.vtu"%(prefix, timeStepIdx, iterIdx)
+        writeVtu(vtuName, log, residual, update)
+
+        # like the VTK convergence writer, the iterations of a time step
+        # are given fractional time indices
+        entries.append((timeStepIdx + iterIdx/100.0, os.path.basename(vtuName)))
+        print("Wrote '%s' (time step %d, iteration %d, t=%g)"
+              %(vtuName, timeStepIdx, iterIdx, time))
+
+    with open(prefix + ".pvd", "w") as f:
+        f.write('<?xml version="1.0"?>\n')
+        f.write('<VTKFile type="Collection" version="0.1" byte_order="LittleEndian">\n')
+        f.write(' <Collection>\n')
+        for t, name in entries:
+            f.write('  <DataSet timestep="%g" file="%s"/>\n'%(t, name))
+        f.write(' </Collection>\n')
+        f.write('</VTKFile>\n')
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,336 @@
+#! /usr/bin/python
+#
+# Measures the strong or weak scaling of ebos using synthetic black-oil
+# decks.
+#
+# A corner-point deck of the requested size and number of wells is
+# generated for each run, ebos is run for a fixed number of report
+# steps using the specified combinations of MPI processes and threads
+# per process, and the timing receipts and the profiles printed by the
+# simulator are collected into a single report.
+#
+# Example:
+#
+# ebosscaling.py --ebos=./bin/ebos --mode=strong --cells=200,200,20 \
+#                --wells=16 --steps=5 --configs=1x1,2x1,4x1,4x2
+#
+from __future__ import print_function
+
+import argparse
+import json
+import math
+import os
+import re
+import subprocess
+import sys
+
+# the lines of the timing receipt of the simulator and the keys under
+# which they are reported
+timingKeys = [
+    ("Setup time", "setupTime"),
+    ("Simulation time", "simulationTime"),
+    ("Linearization time", "linearizeTime"),
+    ("Linear solve time", "solveTime"),
+    ("Newton update time", "updateTime"),
+    ("Pre/postprocess time", "prePostProcessTime"),
+    ("Output write time", "writeTime"),
+]
+
+def writeValues(f, values, perLine=8):
+    # write a list of values using the repeat counts of ECL decks for
+    # runs of identical values
+    items = []
+    i = 0
+    while i < len(values):
+        j = i
+        while j < len(values) and values[j] == values[i]:
+            j += 1
+        if j - i > 1:
+            items.append("%d*%s"%(j - i, values[i]))
+        else:
+            items.append(str(values[i]))
+        i = j
+
+    for i in range(0, len(items), perLine):
+        f.write("  " + " ".join(items[i:i + perLine]) + "\n")
+    f.write("/\n\n")
+
+def topDepth(x, y):
+    # a slightly dipping and undulating top surface so that the grid is
+    # not a plain cartesian one
+    return 2000.0 + 0.02*x + 5.0*math.sin(y/500.0)
+
+def wellLocations(nx, ny, numWells):
+    # distribute the wells on a regular lattice over the areal extent
+    # of the grid
+    numWellsX = max(1, int(math.ceil(math.sqrt(numWells*float(nx)/ny))))
+    numWellsY = max(1, int(math.ceil(float(numWells)/numWellsX)))
+    result = []
+    for j in range(numWellsY):
+        for i in range(numWellsX):
+            if len(result) >= numWells:
+                break
+            result.append((1 + int((i + 0.5)*nx/numWellsX),
+                           1 + int((j + 0.5)*ny/numWellsY)))
+    return result
+
+def generateDeck(fileName, nx, ny, nz, numWells, numSteps, stepSize):
+    dx = 50.0
+    dy = 50.0
+    dz = 5.0
+
+    with open(fileName, "w") as f:
+        f.write("-- synthetic black-oil deck generated by ebosscaling.py\n\n")
+        f.write("RUNSPEC\n\n")
+        f.write("DIMENS\n  %d %d %d /\n\n"%(nx, ny, nz))
+        f.write("OIL\nWATER\nGAS\n\nMETRIC\n\n")
+        f.write("TABDIMS\n  1 1 20 20 1 20 /\n\n")
+        f.write("WELLDIMS\n  %d %d 1 %d /\n\n"%(numWells, nz, numWells))
+        f.write("START\n  1 'JAN' 2015 /\n\n")
+
+        f.write("GRID\n\n")
+        coord = []
+        for j in range(ny + 1):
+            for i in range(nx + 1):
+                x = i*dx
+                y = j*dy
+                top = topDepth(x, y)
+                coord += [x, y, "%.3f"%top, x, y, "%.3f"%(top + nz*dz)]
+        f.write("COORD\n")
+        writeValues(f, coord, perLine=6)
+
+        zcorn = []
+        for k in range(nz):
+            for topOrBottom in range(2):
+                for j in range(ny):
+                    for cornerY in range(2):
+                        for i in range(nx):
+                            for cornerX in range(2):
+                                x = (i + cornerX)*dx
+                                y = (j + cornerY)*dy
+                                zcorn.append("%.3f"%(topDepth(x, y) + (k + topOrBottom)*dz))
+        f.write("ZCORN\n")
+        writeValues(f, zcorn)
+
+        numCells = nx*ny*nz
+        f.write("PORO\n  %d*0.25 /\n\n"%numCells)
+        # make the permeability vary between the layers
+        perm = []
+        for k in range(nz):
+            perm += ["%.1f"%(100.0 + 400.0*(k%3))]*(nx*ny)
+        for keyword in ["PERMX", "PERMY"]:
+            f.write(keyword + "\n")
+            writeValues(f, perm)
+        f.write("PERMZ\n  %d*20.0 /\n\n"%numCells)
+
+        f.write("PROPS\n\n")
+        f.write("PVTW\n  200.0 1.02 4.5e-5 0.5 0.0 /\n\n")
+        f.write("PVDO\n"
+                "  50.0  1.10 1.20\n"
+                " 150.0  1.08 1.22\n"
+                " 250.0  1.06 1.24\n"
+                " 350.0  1.04 1.26\n"
+                " 450.0  1.02 1.28 /\n\n")
+        f.write("PVDG\n"
+                "  50.0  0.0250 0.0130\n"
+                " 150.0  0.0085 0.0160\n"
+                " 250.0  0.0052 0.0190\n"
+                " 350.0  0.0038 0.0220\n"
+                " 450.0  0.0031 0.0250 /\n\n")
+        f.write("ROCK\n  200.0 4.0e-5 /\n\n")
+        f.write("DENSITY\n  850.0 1020.0 0.9 /\n\n")
+        f.write("SWOF\n"
+                "  0.20 0.000 1.000 0.0\n"
+                "  0.40 0.050 0.450 0.0\n"
+                "  0.60 0.200 0.150 0.0\n"
+                "  0.80 0.500 0.000 0.0\n"
+                "  1.00 1.000 0.000 0.0 /\n\n")
+        f.write("SGOF\n"
+                "  0.00 0.000 1.000 0.0\n"
+                "  0.20 0.050 0.400 0.0\n"
+                "  0.40 0.200 0.100 0.0\n"
+                "  0.60 0.500 0.000 0.0\n"
+                "  0.80 1.000 0.000 0.0 /\n\n")
+
+        f.write("SOLUTION\n\n")
+        # the water-oil contact is below the bottom and the gas-oil
+        # contact above the top of the reservoir
+        f.write("EQUIL\n  2000.0 200.0 %.1f 0.0 1000.0 0.0 /\n\n"%(3000.0 + nz*dz))
+
+        f.write("SCHEDULE\n\n")
+        wells = wellLocations(nx, ny, numWells)
+        f.write("WELSPECS\n")
+        for wellIdx, (i, j) in enumerate(wells):
+            group = "G1"
+            phase = "OIL" if wellIdx%2 == 0 else "WATER"
+            f.write("  'W%d' '%s' %d %d 1* '%s' /\n"%(wellIdx + 1, group, i, j, phase))
+        f.write("/\n\n")
+
+        f.write("COMPDAT\n")
+        for wellIdx, (i, j) in enumerate(wells):
+            f.write("  'W%d' %d %d 1 %d 'OPEN' 1* 1* 0.2 /\n"%(wellIdx + 1, i, j, nz))
+        f.write("/\n\n")
+
+        f.write("WCONPROD\n")
+        for wellIdx in range(0, len(wells), 2):
+            f.write("  'W%d' 'OPEN' 'BHP' 5* 100.0 /\n"%(wellIdx + 1))
+        f.write("/\n\n")
+
+        if len(wells) > 1:
+            f.write("WCONINJE\n")
+            for wellIdx in range(1, len(wells), 2):
+                f.write("  'W%d' 'WATER' 'OPEN' 'BHP' 2* 300.0 /\n"%(wellIdx + 1))
+            f.write("/\n\n")
+
+        f.write("TSTEP\n  %d*%.1f /\n\n"%(numSteps, stepSize))
+        f.write("END\n")
+
+def parseOutput(output):
+    result = {}
+
+    for line in output.splitlines():
+        for (label, key) in timingKeys:
+            m = re.match(r"\s*" + re.escape(label) + r": ([0-9.eE+-]+) seconds", line)
+            if m:
+                result[key] = float(m.group(1))
+
+    # the profile of the first process. the summary table ends at the
+    # first line which does not contain exactly three numbers after
+    # the name of the region.
+    profile = []
+    inProfile = False
+    for line in output.splitlines():
+        if line.startswith("Profile of process 0:"):
+            inProfile = True
+            continue
+        if not inProfile or line.startswith("Region"):
+            continue
+        m = re.match(r"^(\s*)(\S+)\s+([0-9.eE+-]+)\s+([0-9.eE+-]+)\s+([0-9]+)\s*$", line)
+        if not m:
+            break
+        profile.append({"region": m.group(2),
+                        "depth": len(m.group(1))//2,
+                        "totalTime": float(m.group(3)),
+                        "maxThreadTime": float(m.group(4)),
+                        "calls": int(m.group(5))})
+    if profile:
+        result["profile"] = profile
+
+    return result
+
+def main():
+    parser = argparse.ArgumentParser(description="Measure the scaling of ebos using synthetic decks")
+    parser.add_argument("--ebos", default="ebos",
+                        help="The ebos executable")
+    parser.add_argument("--mode", choices=["strong", "weak"], default="strong",
+                        help="For weak scaling, the number of cells in x direction is "
+                        "multiplied by the total number of threads of a run")
+    parser.add_argument("--cells", default="100,100,10",
+                        help="The number of cells in x, y and z direction")
+    parser.add_argument("--wells", type=int, default=4,
+                        help="The number of wells (half producers, half water injectors)")
+    parser.add_argument("--steps", type=int, default=3,
+                        help="The number of report steps which are simulated")
+    parser.add_argument("--step-size", type=float, default=30.0,
+                        help="The size of the report steps [days]")
+    parser.add_argument("--configs", default="1x1,2x1,4x1",
+                        help="A comma-separated list of PROCESSESxTHREADS configurations")
+    parser.add_argument("--mpirun", default="mpirun -np %(np)d",
+                        help="The command which is used to start the parallel runs")
+    parser.add_argument("--work-dir", default="ebos-scaling",
+                        help="The directory for the decks and the output of the runs")
+    parser.add_argument("--report", default="ebos-scaling.json",
+                        help="The file to which the report is written")
+    parser.add_argument("ebos_args", nargs="*",
+                        help="Additional arguments passed to ebos")
+    args = parser.parse_args()
+
+    (nx, ny, nz) = [int(n) for n in args.cells.split(",")]
+    configs = []
+    for config in args.configs.split(","):
+        (numProcesses, numThreads) = [int(n) for n in config.split("x")]
+        configs.append((numProcesses, numThreads))
+
+    if not os.path.isdir(args.work_dir):
+        os.makedirs(args.work_dir)
+
+    runs = []
+    for (numProcesses, numThreads) in configs:
+        runNx = nx
+        if args.mode == "weak":
+            runNx = nx*numProcesses*numThreads
+
+        name = "SYNTH_%dx%dx%d_W%d"%(runNx, ny, nz, args.wells)
+        deckFile = os.path.join(args.work_dir, name + ".DATA")
+        if not os.path.exists(deckFile):
+            print("Generating deck '%s'"%deckFile)
+            generateDeck(deckFile, runNx, ny, nz, args.wells, args.steps, args.step_size)
+
+        command = []
+        if numProcesses > 1:
+            command += (args.mpirun%{"np": numProcesses}).split()
+        command += [args.ebos,
+                    "--ecl-deck-file-name=" + deckFile,
+                    "--threads-per-process=%d"%numThreads,
+                    "--enable-profiling=true",
+                    "--enable-ecl-output=false",
+                    "--enable-vtk-output=false"]
+        command += args.ebos_args
+
+        print("Running '%s'"%" ".join(command))
+        sys.stdout.flush()
+        process = subprocess.Popen(command, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                                   universal_newlines=True)
+        output = process.communicate()[0]
+
+        logName = os.path.join(args.work_dir, "%s_np%d_nt%d.log"%(name, numProcesses, numThreads))
+        with open(logName, "w") as f:
+            f.write(output)
+
+        run = {"processes": numProcesses,
+               "threads": numThreads,
+               "cells": runNx*ny*nz,
+               "wells": args.wells,
+               "exitCode": process.returncode,
+               "log": logName}
+        run.update(parseOutput(output))
+        runs.append(run)
+
+    # compute the speedup and the parallel efficiency relative to the first
+    # configuration
+    reference = runs[0]
+    for run in runs:
+        if "simulationTime" not in run or "simulationTime" not in reference:
+            continue
+        speedup = reference["simulationTime"]/run["simulationTime"]
+        relWorkers = float(run["processes"]*run["threads"])/(reference["processes"]*reference["threads"])
+        if args.mode == "weak":
+            run["efficiency"] = speedup
+        else:
+            run["speedup"] = speedup
+            run["efficiency"] = speedup/relWorkers
+
+    with open(args.report, "w") as f:
+        json.dump({"mode": args.mode, "steps": args.steps, "runs": runs}, f, indent=2)
+
+    print("")
+    print("%8s %8s %10s %12s %12s %12s %12s"%("Procs", "Threads", "Cells", "Simulation",
+                                               "Linearize", "Solve", "Efficiency"))
+    for run in runs:
+        if run["exitCode"] != 0:
+            print("%8d %8d %10d   run failed, see '%s'"%(run["processes"], run["threads"],
+                                                         run["cells"], run["log"]))
+            continue
+        print("%8d %8d %10d %12.3f %12.3f %12.3f %12.3f"%(run["processes"], run["threads"],
+                                                           run["cells"],
+                                                           run.get("simulationTime", float("nan")),
+                                                           run.get("linearizeTime", float("nan")),
+                                                           run.get("solveTime", float("nan")),
+                                                           run.get("efficiency", float("nan"))))
+    print("")
+    print("The full report has been written to '%s'"%args.report)
+
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -6,6 +6,12 @@
 #
 # runTest.sh REFERENCE_RESULT_FILE TEST_RESULT_FILE TEST_BINARY TEST_ARGS
 #
+# If the EWOMS_PERFORMANCE_RECORD_DIR environment variable is set, the timings and
+# iteration counts of simulation tests are written to "$TEST_NAME.perf" in this
+# directory. If EWOMS_PERFORMANCE_BASELINE_DIR contains a record with the same name, the
+# test fails if the run is slower than it by more than EWOMS_PERFORMANCE_TOLERANCE
+# (relative, default: 0.2).
+#
 MY_DIR="$(dirname "$0")"
 
 usage() {
@@ -34,6 +40,26 @@ validateResults() {
     exit 1
 }
 
+# compares the performance record of the test with its baseline if both of them exist
+checkPerformance() {
+    if test -z "$PERF_RECORD" || ! test -r "$PERF_RECORD"; then
+        return 0
+    fi
+    local BASELINE="${EWOMS_PERFORMANCE_BASELINE_DIR}/$TEST_NAME.perf"
+    if test -z "$EWOMS_PERFORMANCE_BASELINE_DIR" || ! test -r "$BASELINE"; then
+        echo "No performance baseline for '$TEST_NAME', record written to '$PERF_RECORD'"
+        return 0
+    fi
+
+    echo "######################"
+    echo "# Comparing performance with \"$BASELINE\""
+    echo "######################"
+    if ! python "${MY_DIR}/compareperformance.py" "$BASELINE" "$PERF_RECORD" "${EWOMS_PERFORMANCE_TOLERANCE:-0.2}"; then
+        echo "The performance of '$TEST_NAME' regressed compared to its baseline"
+        exit 1
+    fi
+}
+
 # this function clips the help message printed by an ewoms simulation
 # to what is actually printed, throwing away all garbage which is
 # printed before or after the "meat"
@@ -93,9 +119,19 @@ echo "# Running test '$TEST_NAME'"
 echo "######################"
 
 
+PERF_RECORD=""
+if test -n "$EWOMS_PERFORMANCE_RECORD_DIR"; then
+    mkdir -p "$EWOMS_PERFORMANCE_RECORD_DIR"
+    PERF_RECORD="$EWOMS_PERFORMANCE_RECORD_DIR/$TEST_NAME.perf"
+    rm -f "$PERF_RECORD"
+fi
+
 RND="$(dd if=/dev/urandom bs=20 count=1 2> /dev/null | md5sum | cut -d" " -f1)"
 case "$TEST_TYPE" in
     "--simulation")
+        if test -n "$PERF_RECORD"; then
+            TEST_ARGS="$TEST_ARGS --performance-record-file=$PERF_RECORD"
+        fi
         echo "executing \"$TEST_BINARY $TEST_ARGS\""
         "$TEST_BINARY" $TEST_ARGS | tee "test-$RND.log"
         RET="${PIPESTATUS[0]}"
@@ -126,11 +162,15 @@ case "$TEST_TYPE" in
         echo "Test result file: '$TEST_RESULT'"
 
         validateResults "$TEST_RESULT" "$SIM_NAME"
+        checkPerformance
         exit 0
         ;;
 
     "--parallel-simulation="*)
         NUM_PROCS="${TEST_TYPE/--parallel-simulation=/}"
+        if test -n "$PERF_RECORD"; then
+            TEST_ARGS="$TEST_ARGS --performance-record-file=$PERF_RECORD"
+        fi
 
         echo "executing \"mpirun -np \"$NUM_PROCS\" $TEST_BINARY $TEST_ARGS\""
         mpirun -np "$NUM_PROCS" "$TEST_BINARY" $TEST_ARGS | tee "test-$RND.log"
@@ -160,6 +200,7 @@ case "$TEST_TYPE" in
 
             validateResults "$TEST_RESULT" "$REF_FILE"
         done
+        checkPerformance
         exit 0
         ;;
 
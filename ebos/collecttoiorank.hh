@@ -23,6 +23,8 @@
 #ifndef EWOMS_PARALLELSERIALOUTPUT_HH
 #define EWOMS_PARALLELSERIALOUTPUT_HH
 
+#include "eclcartesianindexbitmap.hh"
+
 //#if HAVE_OPM_GRID
 #include <dune/grid/common/p2pcommunicator.hh>
 #include <dune/grid/utility/persistentcontainer.hh>
@@ -89,28 +91,22 @@ namespace Ewoms
             const std::vector<int>& distributedGlobalIndex_;
             IndexMapType& localIndexMap_;
             IndexMapStorageType& indexMaps_;
-            std::map< const int, const int > globalPosition_;
+            // maps the Cartesian index of a cell to the element index of the global grid
+            const EclCartesianIndexBitmap* globalPosition_;
 #ifndef NDEBUG
             std::set< int > checkPosition_;
 #endif
 
         public:
-            DistributeIndexMapping( const std::vector<int>& globalIndex,
+            DistributeIndexMapping( const EclCartesianIndexBitmap* globalPosition,
                                     const std::vector<int>& distributedGlobalIndex,
                                     IndexMapType& localIndexMap,
                                     IndexMapStorageType& indexMaps )
             : distributedGlobalIndex_( distributedGlobalIndex ),
               localIndexMap_( localIndexMap ),
               indexMaps_( indexMaps ),
-              globalPosition_()
+              globalPosition_( globalPosition )
             {
-                const size_t size = globalIndex.size();
-                // create mapping globalIndex --> localIndex
-                for ( size_t index = 0; index < size; ++index )
-                {
-                    globalPosition_.insert( std::make_pair( globalIndex[ index ], index ) );
-                }
-
                 // on I/O rank we need to create a mapping from local to global
                 if( ! indexMaps_.empty() )
                 {
@@ -121,7 +117,8 @@ namespace Ewoms
                     for( size_t i=0; i<localSize; ++i )
                     {
                         const int id = distributedGlobalIndex_[ localIndexMap_[ i ] ];
-                        indexMap[ i ] = globalPosition_[ id ] ;
+                        assert( globalPosition_ && globalPosition_->contains( id ) );
+                        indexMap[ i ] = globalPosition_->compressedIndex( id );
 #ifndef NDEBUG
                         assert( checkPosition_.find( id ) == checkPosition_.end() );
                         checkPosition_.insert( id );
@@ -152,7 +149,7 @@ namespace Ewoms
             {
                 // get index map for current link
                 IndexMapType& indexMap = indexMaps_[ link ];
-                assert( ! globalPosition_.empty() );
+                assert( globalPosition_ );
 
                 // unpack all interior global cell id's
                 int numCells = 0;
@@ -162,8 +159,8 @@ namespace Ewoms
                 {
                     int globalId = -1;
                     buffer.read( globalId );
-                    assert( globalPosition_.find( globalId ) != globalPosition_.end() );
-                    indexMap[ index ] = globalPosition_[ globalId ];
+                    assert( globalPosition_->contains( globalId ) );
+                    indexMap[ index ] = globalPosition_->compressedIndex( globalId );
 #ifndef NDEBUG
                     assert( checkPosition_.find( globalId ) == checkPosition_.end() );
                     checkPosition_.insert( globalId );
@@ -279,7 +276,9 @@ namespace Ewoms
                 }
 
                 // distribute global id's to io rank for later association of dof's
-                DistributeIndexMapping distIndexMapping( globalCartesianIndex_, distributedCartesianIndex, localIndexMap_, indexMaps_ );
+                const EclCartesianIndexBitmap* globalPosition =
+                    isIORank() ? &gridManager.equilCartesianToCompressed() : nullptr;
+                DistributeIndexMapping distIndexMapping( globalPosition, distributedCartesianIndex, localIndexMap_, indexMaps_ );
                 toIORankComm_.exchange( distIndexMapping );
             }
         }
@@ -398,6 +397,151 @@ namespace Ewoms
             }
         };
 
+        // gathers a single field on the I/O rank
+        template <class Buffer, class GlobalValue>
+        class PackUnPackOutputField : public P2PCommunicatorType::DataHandleInterface
+        {
+            typedef typename Buffer::value_type LocalValue;
+
+            const Buffer& localBuffer_;
+            GlobalValue* globalData_;
+
+            const IndexMapType& localIndexMap_;
+            const IndexMapStorageType& indexMaps_;
+
+        public:
+            PackUnPackOutputField( const Buffer& localBuffer,
+                                   GlobalValue* globalData,
+                                   const IndexMapType& localIndexMap,
+                                   const IndexMapStorageType& indexMaps,
+                                   const bool isIORank )
+            : localBuffer_( localBuffer ),
+              globalData_( globalData ),
+              localIndexMap_( localIndexMap ),
+              indexMaps_( indexMaps )
+            {
+                if( isIORank )
+                {
+                    assert( globalData_ );
+
+                    // the last index map is the local one
+                    const IndexMapType& indexMap = indexMaps_.back();
+                    const size_t size = localIndexMap_.size();
+                    assert( size == indexMap.size() );
+                    for( size_t i=0; i<size; ++i )
+                    {
+                        globalData_[ indexMap[ i ] ] =
+                            static_cast< GlobalValue >( localBuffer_[ localIndexMap_[ i ] ] );
+                    }
+                }
+            }
+
+            // pack the local part of the field
+            void pack( const int link, MessageBufferType& buffer )
+            {
+                // we should only get one link
+                if( link != 0 ) {
+                    OPM_THROW(std::logic_error,"link in method pack is not 0 as expected");
+                }
+
+                const size_t size = localIndexMap_.size();
+                assert( size <= localBuffer_.size() );
+                buffer.write( size );
+                for( size_t i=0; i<size; ++i )
+                {
+                    buffer.write( localBuffer_[ localIndexMap_[ i ] ] );
+                }
+            }
+
+            // unpack the part of the field which is associated with link
+            void unpack( const int link, MessageBufferType& buffer )
+            {
+                const IndexMapType& indexMap = indexMaps_[ link ];
+                size_t size = 0;
+                buffer.read( size );
+                assert( size == indexMap.size() );
+                for( size_t i=0; i<size; ++i )
+                {
+                    LocalValue value;
+                    buffer.read( value );
+                    globalData_[ indexMap[ i ] ] = static_cast< GlobalValue >( value );
+                }
+            }
+        };
+
+        /*!
+         * \brief Gather a single field on the I/O rank.
+         *
+         * In contrast to collect(), the local buffer is not modified and only one
+         * field is held in global size on the I/O rank at a time. The returned
+         * reference points to the data which ought to be written: On the I/O rank
+         * of parallel runs or if the data must be reordered, this is globalBuffer,
+         * else it is localBuffer. On all other ranks, the result is meaningless.
+         */
+        template <class Buffer>
+        const Buffer& collectField( const Buffer& localBuffer, Buffer& globalBuffer ) const
+        {
+            // nothing to do if the local data is already in the right order
+            if( ! needsReordering && ! isParallel_ )
+            {
+                return localBuffer;
+            }
+
+            if( isIORank() )
+                globalBuffer.resize( numCells() );
+
+            collectFieldTo( localBuffer, isIORank() ? globalBuffer.data() : nullptr );
+
+            return isIORank() ? globalBuffer : localBuffer;
+        }
+
+        /*!
+         * \brief Returns the number of entries of a field on the I/O rank.
+         *
+         * \param localSize The number of entries of the field on the local process
+         */
+        size_t globalFieldSize( const size_t localSize ) const
+        {
+            if( ! needsReordering && ! isParallel_ )
+                return localSize;
+            return numCells();
+        }
+
+        /*!
+         * \brief Gather a single field on the I/O rank and store it in an externally
+         *        provided array.
+         *
+         * This allows to gather a field directly into the storage from which it is
+         * written without an intermediate buffer of global size. On the I/O rank,
+         * globalData must point to an array of at least globalFieldSize() entries. The
+         * values are converted to the type of the array. On all other ranks, the
+         * argument is ignored.
+         */
+        template <class Buffer, class GlobalValue>
+        void collectFieldTo( const Buffer& localBuffer, GlobalValue* globalData ) const
+        {
+            if( ! needsReordering && ! isParallel_ )
+            {
+                const size_t size = localBuffer.size();
+                for( size_t i=0; i<size; ++i )
+                    globalData[ i ] = static_cast< GlobalValue >( localBuffer[ i ] );
+                return;
+            }
+
+            // this also copies the entries of the I/O rank
+            PackUnPackOutputField< Buffer, GlobalValue >
+                packUnpack( localBuffer,
+                            globalData,
+                            localIndexMap_,
+                            indexMaps_,
+                            isIORank() );
+
+            if ( isParallel_ )
+            {
+                toIORankComm_.exchange( packUnpack );
+            }
+        }
+
         // gather solution to rank 0 for EclipseWriter
         template <class BufferList>
         void collect( BufferList& bufferList ) const
@@ -124,6 +124,8 @@ public:
         delete equilCartesianIndexMapper_;
         equilCartesianIndexMapper_ = 0;
 
+        this->equilCartesianToCompressed_.clear();
+
         delete equilGrid_;
         equilGrid_ = 0;
     }
@@ -143,6 +145,8 @@ public:
         grid().communicate(*dataHandle,
                            Dune::InteriorBorder_All_Interface,
                            Dune::ForwardCommunication );
+
+        this->cartesianToCompressed_.clear();
     }
 
     /*!
@@ -0,0 +1,202 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \copydoc Ewoms::EclAsyncWriter
+ */
+#ifndef EWOMS_ECL_ASYNC_WRITER_HH
+#define EWOMS_ECL_ASYNC_WRITER_HH
+
+#include <list>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <exception>
+#include <functional>
+#include <condition_variable>
+
+namespace Ewoms {
+/*!
+ * \ingroup EclBlackOilSimulator
+ *
+ * \brief Serializes ECL output files on a background thread.
+ *
+ * The writers hand over jobs which own a snapshot of everything that they need to
+ * write a file, i.e., the jobs must not access the simulator. The jobs are executed
+ * one after another in the order in which they were submitted, so that the calls to
+ * the ERT library are never done concurrently.
+ *
+ * If no background thread is running (cf. enable()), submitted jobs are executed
+ * immediately.
+ */
+class EclAsyncWriter
+{
+public:
+    typedef std::function<void()> Job;
+
+    EclAsyncWriter(const EclAsyncWriter&) = delete;
+
+    EclAsyncWriter()
+    {
+        maxPendingJobs_ = 0;
+        workerShouldStop_ = false;
+    }
+
+    ~EclAsyncWriter()
+    { stopWorker_(); }
+
+    /*!
+     * \brief Start or stop the background thread.
+     *
+     * If maxPendingJobs jobs are already waiting to be executed, submit() blocks until
+     * the oldest of them is finished. A value of zero switches back to writing
+     * synchronously.
+     */
+    void enable(unsigned maxPendingJobs)
+    {
+        waitForPendingWrites();
+
+        if (maxPendingJobs == 0)
+            stopWorker_();
+        else if (!workerThread_.joinable()) {
+            workerShouldStop_ = false;
+            workerThread_ = std::thread([this]() { this->workerLoop_(); });
+        }
+
+        maxPendingJobs_ = maxPendingJobs;
+    }
+
+    /*!
+     * \brief Returns true if the jobs are executed by a background thread.
+     */
+    bool isEnabled() const
+    { return maxPendingJobs_ > 0; }
+
+    /*!
+     * \brief Execute a job which writes an ECL file.
+     *
+     * If an exception was thrown by a previous job which has been executed in the
+     * background, this exception is re-thrown by this method.
+     */
+    void submit(Job job)
+    {
+        if (!isEnabled()) {
+            job();
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock(queueMutex_);
+        queueCondition_.wait(lock,
+                             [this]()
+                             { return pendingJobs_.size() < maxPendingJobs_; });
+        rethrowWorkerException_();
+
+        pendingJobs_.push_back(std::move(job));
+        queueCondition_.notify_all();
+    }
+
+    /*!
+     * \brief Block until all jobs which have been submitted are finished.
+     *
+     * This is the flush barrier which must be passed before the simulation ends or a
+     * restart file is written. If one of the jobs failed, the exception is re-thrown by
+     * this method.
+     */
+    void waitForPendingWrites()
+    {
+        std::unique_lock<std::mutex> lock(queueMutex_);
+        queueCondition_.wait(lock, [this]() { return pendingJobs_.empty(); });
+        rethrowWorkerException_();
+    }
+
+private:
+    // the main function of the background thread
+    void workerLoop_()
+    {
+        while (true) {
+            Job* job;
+            {
+                std::unique_lock<std::mutex> lock(queueMutex_);
+                queueCondition_.wait(lock,
+                                     [this]()
+                                     { return workerShouldStop_ || !pendingJobs_.empty(); });
+                if (pendingJobs_.empty())
+                    return; // workerShouldStop_ is set and there is nothing left to do
+
+                // the job stays in the queue until it is finished, so that it is taken
+                // into account for the maximum number of pending jobs
+                job = &pendingJobs_.front();
+            }
+
+            std::exception_ptr exception;
+            try {
+                (*job)();
+            }
+            catch (...) {
+                exception = std::current_exception();
+            }
+
+            std::unique_lock<std::mutex> lock(queueMutex_);
+            if (exception)
+                workerException_ = exception;
+            pendingJobs_.pop_front();
+            queueCondition_.notify_all();
+        }
+    }
+
+    void stopWorker_()
+    {
+        if (!workerThread_.joinable())
+            return;
+
+        {
+            std::unique_lock<std::mutex> lock(queueMutex_);
+            workerShouldStop_ = true;
+            queueCondition_.notify_all();
+        }
+        workerThread_.join();
+    }
+
+    // this requires the queue mutex to be locked
+    void rethrowWorkerException_()
+    {
+        if (!workerException_)
+            return;
+
+        std::exception_ptr e = workerException_;
+        workerException_ = std::exception_ptr();
+        std::rethrow_exception(e);
+    }
+
+    std::list<Job> pendingJobs_;
+    std::mutex queueMutex_;
+    std::condition_variable queueCondition_;
+    std::exception_ptr workerException_;
+    std::thread workerThread_;
+    unsigned maxPendingJobs_;
+    bool workerShouldStop_;
+};
+} // namespace Ewoms
+
+#endif
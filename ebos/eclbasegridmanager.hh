@@ -27,6 +27,8 @@
 #ifndef EWOMS_ECL_BASE_GRID_MANAGER_HH
 #define EWOMS_ECL_BASE_GRID_MANAGER_HH
 
+#include "eclcartesianindexbitmap.hh"
+
 #include <ewoms/io/basegridmanager.hh>
 #include <ewoms/common/propertysystem.hh>
 #include <ewoms/common/parametersystem.hh>
@@ -43,6 +45,7 @@
 #include <mpi.h>
 #endif // HAVE_MPI
 
+#include <string>
 #include <vector>
 #include <unordered_set>
 #include <array>
@@ -51,6 +54,8 @@ namespace Ewoms {
 template <class TypeTag>
 class EclBaseGridManager;
 
+class EclInteriorFaces;
+
 namespace Properties {
 NEW_TYPE_TAG(EclBaseGridManager);
 
@@ -59,8 +64,10 @@ NEW_PROP_TAG(Grid);
 NEW_PROP_TAG(EquilGrid);
 NEW_PROP_TAG(Scalar);
 NEW_PROP_TAG(EclDeckFileName);
+NEW_PROP_TAG(EclMaxConcurrentDeckReaders);
 
 SET_STRING_PROP(EclBaseGridManager, EclDeckFileName, "ECLDECK.DATA");
+SET_INT_PROP(EclBaseGridManager, EclMaxConcurrentDeckReaders, 0);
 } // namespace Properties
 
 /*!
@@ -91,6 +98,8 @@ public:
     {
         EWOMS_REGISTER_PARAM(TypeTag, std::string, EclDeckFileName,
                              "The name of the file which contains the ECL deck to be simulated");
+        EWOMS_REGISTER_PARAM(TypeTag, int, EclMaxConcurrentDeckReaders,
+                             "The maximum number of processes which read the ECL deck at the same time. (0 means no limit.)");
     }
 
     /*!
@@ -107,7 +116,11 @@ public:
         MPI_Comm_rank(MPI_COMM_WORLD, &myRank);
 #endif
 
-        std::string fileName = EWOMS_GET_PARAM(TypeTag, std::string, EclDeckFileName);
+        std::string fileName = threadDeckFileName_();
+        if (fileName.empty())
+            fileName = EWOMS_GET_PARAM(TypeTag, std::string, EclDeckFileName);
+
+        deckFileName_ = fileName;
 
         // compute the base name of the input file name
         const char directorySeparator = '/';
@@ -144,14 +157,46 @@ public:
         tmp.push_back(ParseModePair(Opm::ParseContext::SUMMARY_UNKNOWN_GROUP, Opm::InputError::WARN));
         Opm::ParseContext parseContext(tmp);
 
-        deck_ = parser.parseFile(fileName , parseContext);
-        eclState_.reset(new Opm::EclipseState(deck_, parseContext));
+        // for large numbers of processes, reading the deck on all of them at the same
+        // time leads to a storm of requests to the file system. if requested, the
+        // processes thus read the deck in batches of limited size.
+        int maxReaders = EWOMS_GET_PARAM(TypeTag, int, EclMaxConcurrentDeckReaders);
+        int numBatches = 1;
+#if HAVE_MPI
+        int mpiSize = 1;
+        MPI_Comm_size(MPI_COMM_WORLD, &mpiSize);
+        if (maxReaders > 0)
+            numBatches = (mpiSize + maxReaders - 1)/maxReaders;
+#endif
+
+        for (int batchIdx = 0; batchIdx < numBatches; ++batchIdx) {
+            if (numBatches == 1 || myRank/maxReaders == batchIdx) {
+                deck_ = parser.parseFile(fileName , parseContext);
+                eclState_.reset(new Opm::EclipseState(deck_, parseContext));
+            }
+
+#if HAVE_MPI
+            if (numBatches > 1)
+                MPI_Barrier(MPI_COMM_WORLD);
+#endif
+        }
 
         asImp_().createGrids_();
 
         asImp_().finalizeInit_();
     }
 
+    /*!
+     * \brief Specify the deck file which is read by the grid managers that are
+     *        subsequently created by the calling thread.
+     *
+     * This allows several simulators which share the same set of parameters to simulate
+     * different decks, e.g., the members of an ensemble. If the file name is empty,
+     * the one given by the EclDeckFileName parameter is used.
+     */
+    static void setThreadDeckFileName(const std::string& fileName)
+    { threadDeckFileName_() = fileName; }
+
     /*!
      * \brief Return a pointer to the parsed ECL deck
      */
@@ -170,6 +215,12 @@ public:
     Opm::EclipseState& eclState()
     { return *eclState_; }
 
+    /*!
+     * \brief Returns the name of the file from which the ECL deck has been read.
+     */
+    const std::string& deckFileName() const
+    { return deckFileName_; }
+
     /*!
      * \brief Returns the name of the case.
      *
@@ -242,6 +293,51 @@ public:
     void equilCartesianCoordinate(unsigned cellIdx, std::array<int,3>& ijk) const
     { return asImp_().equilCartesianIndexMapper().cartesianCoordinate(cellIdx, ijk); }
 
+    /*!
+     * \brief Returns the object which maps the logically Cartesian index of a cell to
+     *        the index of the corresponding element of the simulation grid.
+     *
+     * Only the elements which are seen by the local process are considered. The map is
+     * computed at the first call and re-computed if the grid has changed.
+     */
+    const EclCartesianIndexBitmap& cartesianToCompressed() const
+    {
+        int seqNum = this->gridSequenceNumber();
+        unsigned numElements = asImp_().gridView().size(/*codim=*/0);
+        if (cartesianToCompressed_.sequenceNumber() != seqNum
+            || cartesianToCompressed_.numElements() != numElements)
+        {
+            const auto& mapper = asImp_().cartesianIndexMapper();
+            cartesianToCompressed_.update(mapper.cartesianSize(),
+                                          numElements,
+                                          [&mapper](unsigned elemIdx)
+                                          { return mapper.cartesianIndex(elemIdx); },
+                                          seqNum);
+        }
+
+        return cartesianToCompressed_;
+    }
+
+    /*!
+     * \brief Returns the object which maps the logically Cartesian index of a cell to
+     *        the index of the corresponding element of the EQUIL grid.
+     *
+     * This must not be called after the EQUIL grid has been released.
+     */
+    const EclCartesianIndexBitmap& equilCartesianToCompressed() const
+    {
+        if (equilCartesianToCompressed_.sequenceNumber() < 0) {
+            const auto& mapper = asImp_().equilCartesianIndexMapper();
+            unsigned numElements = asImp_().equilGrid().leafGridView().size(/*codim=*/0);
+            equilCartesianToCompressed_.update(mapper.cartesianSize(),
+                                               numElements,
+                                               [&mapper](unsigned elemIdx)
+                                               { return mapper.cartesianIndex(elemIdx); });
+        }
+
+        return equilCartesianToCompressed_;
+    }
+
     /*!
      * \brief Return the names of the wells which do not penetrate any cells on the local
      *        process.
@@ -252,16 +348,36 @@ public:
     std::unordered_set<std::string> defunctWellNames() const
     { return std::unordered_set<std::string>(); }
 
+    /*!
+     * \brief Returns the interior faces of the simulation grid if they are known without
+     *        iterating over the intersections of the grid.
+     *
+     * By default, they are not known and a null pointer is returned.
+     */
+    const EclInteriorFaces* interiorFaces() const
+    { return 0; }
+
 private:
+    static std::string& threadDeckFileName_()
+    {
+        static thread_local std::string fileName;
+        return fileName;
+    }
+
     Implementation& asImp_()
     { return *static_cast<Implementation*>(this); }
 
     const Implementation& asImp_() const
     { return *static_cast<const Implementation*>(this); }
 
+    std::string deckFileName_;
     std::string caseName_;
     Opm::Deck deck_;
     std::unique_ptr<Opm::EclipseState> eclState_;
+
+protected:
+    mutable EclCartesianIndexBitmap cartesianToCompressed_;
+    mutable EclCartesianIndexBitmap equilCartesianToCompressed_;
 };
 
 } // namespace Ewoms
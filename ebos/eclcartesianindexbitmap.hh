@@ -0,0 +1,180 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \copydoc Ewoms::EclCartesianIndexBitmap
+ */
+#ifndef EWOMS_ECL_CARTESIAN_INDEX_BITMAP_HH
+#define EWOMS_ECL_CARTESIAN_INDEX_BITMAP_HH
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+namespace Ewoms {
+
+/*!
+ * \ingroup EclBlackOilSimulator
+ *
+ * \brief Maps the indices of the logically Cartesian cells to the indices of the
+ *        elements of a compressed grid in constant time.
+ *
+ * The set of Cartesian cells which are represented by an element is stored as a bitmap
+ * with one bit per Cartesian cell. For each 64 bit word of the bitmap, the number of
+ * set bits in the preceeding words is stored, so that the rank of a Cartesian cell in
+ * the set can be determined using a single population count. The rank is then
+ * translated to the element index using a dense array. Compared to a hash map or a
+ * tree, this uses only a little more than one bit per inactive Cartesian cell and 32
+ * bits per element.
+ */
+class EclCartesianIndexBitmap
+{
+    typedef uint64_t Word;
+    static const unsigned bitsPerWord = 64;
+
+public:
+    EclCartesianIndexBitmap()
+    {
+        cartesianSize_ = 0;
+        sequenceNumber_ = -1;
+    }
+
+    /*!
+     * \brief Compute the map for a grid.
+     *
+     * \param cartesianSize The number of cells of the logically Cartesian grid
+     * \param numElements The number of elements of the compressed grid
+     * \param cartesianIndex A functor which returns the Cartesian index of an element
+     * \param sequenceNumber An arbitrary number which identifies the state of the grid
+     */
+    template <class CartesianIndexFn>
+    void update(unsigned cartesianSize,
+                unsigned numElements,
+                const CartesianIndexFn& cartesianIndex,
+                int sequenceNumber = 0)
+    {
+        unsigned numWords = (cartesianSize + bitsPerWord - 1)/bitsPerWord;
+        bits_.assign(numWords, 0);
+        for (unsigned elemIdx = 0; elemIdx < numElements; ++elemIdx) {
+            unsigned cartIdx = static_cast<unsigned>(cartesianIndex(elemIdx));
+            assert(cartIdx < cartesianSize);
+            bits_[cartIdx/bitsPerWord] |= Word(1) << (cartIdx%bitsPerWord);
+        }
+
+        wordRank_.resize(numWords);
+        unsigned numSet = 0;
+        for (unsigned wordIdx = 0; wordIdx < numWords; ++wordIdx) {
+            wordRank_[wordIdx] = numSet;
+            numSet += popCount_(bits_[wordIdx]);
+        }
+        assert(numSet == numElements);
+
+        // the order of the elements does not need to be the one of the Cartesian cells
+        elementIndex_.resize(numSet);
+        for (unsigned elemIdx = 0; elemIdx < numElements; ++elemIdx)
+            elementIndex_[rank_(static_cast<unsigned>(cartesianIndex(elemIdx)))] = elemIdx;
+
+        cartesianSize_ = cartesianSize;
+        sequenceNumber_ = sequenceNumber;
+    }
+
+    /*!
+     * \brief Discard the map.
+     */
+    void clear()
+    {
+        bits_.clear();
+        wordRank_.clear();
+        elementIndex_.clear();
+        cartesianSize_ = 0;
+        sequenceNumber_ = -1;
+    }
+
+    /*!
+     * \brief Returns the sequence number which has been passed to update().
+     *
+     * If the map has not been computed, -1 is returned.
+     */
+    int sequenceNumber() const
+    { return sequenceNumber_; }
+
+    /*!
+     * \brief Returns the number of elements of the compressed grid.
+     */
+    unsigned numElements() const
+    { return static_cast<unsigned>(elementIndex_.size()); }
+
+    /*!
+     * \brief Returns true iff a Cartesian cell is represented by an element.
+     */
+    bool contains(unsigned cartIdx) const
+    {
+        return
+            cartIdx < cartesianSize_
+            && (bits_[cartIdx/bitsPerWord] >> (cartIdx%bitsPerWord)) & 1;
+    }
+
+    /*!
+     * \brief Returns the index of the element which represents a Cartesian cell.
+     *
+     * If the cell is not represented by any element, -1 is returned.
+     */
+    int compressedIndex(unsigned cartIdx) const
+    {
+        if (!contains(cartIdx))
+            return -1;
+        return static_cast<int>(elementIndex_[rank_(cartIdx)]);
+    }
+
+private:
+    // the number of set bits before a given one
+    unsigned rank_(unsigned cartIdx) const
+    {
+        unsigned wordIdx = cartIdx/bitsPerWord;
+        Word mask = (Word(1) << (cartIdx%bitsPerWord)) - 1;
+        return wordRank_[wordIdx] + popCount_(bits_[wordIdx] & mask);
+    }
+
+    static unsigned popCount_(Word w)
+    {
+#if defined(__GNUC__)
+        return static_cast<unsigned>(__builtin_popcountll(w));
+#else
+        unsigned n = 0;
+        for (; w; w &= w - 1)
+            ++n;
+        return n;
+#endif
+    }
+
+    std::vector<Word> bits_;
+    std::vector<unsigned> wordRank_;
+    std::vector<unsigned> elementIndex_;
+    unsigned cartesianSize_;
+    int sequenceNumber_;
+};
+
+} // namespace Ewoms
+
+#endif
@@ -0,0 +1,503 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \copydoc Ewoms::EclConformingGridBuilder
+ */
+#ifndef EWOMS_ECL_CONFORMING_GRID_BUILDER_HH
+#define EWOMS_ECL_CONFORMING_GRID_BUILDER_HH
+
+#include <opm/parser/eclipse/EclipseState/Grid/EclipseGrid.hpp>
+
+#include <opm/core/grid.h>
+#include <opm/core/grid/cornerpoint_grid.h>
+
+#include <opm/common/ErrorMacros.hpp>
+#include <opm/common/Exceptions.hpp>
+
+#include <array>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+namespace Ewoms {
+
+/*!
+ * \ingroup EclBlackOilSimulator
+ *
+ * \brief The interior faces of a grid which was created by EclConformingGridBuilder.
+ *
+ * The faces are ordered by the index of their inside element, which is always smaller
+ * than the one of their outside element. The geometric quantities are taken from the
+ * grid, so this object must not be used after the grid has been destroyed.
+ */
+class EclInteriorFaces
+{
+public:
+    EclInteriorFaces()
+    { grid_ = 0; }
+
+    /*!
+     * \brief Returns the number of interior faces.
+     */
+    unsigned size() const
+    { return static_cast<unsigned>(gridFaceIdx_.size()); }
+
+    unsigned insideElemIdx(unsigned faceIdx) const
+    { return static_cast<unsigned>(grid_->face_cells[2*gridFaceIdx_[faceIdx]]); }
+
+    unsigned outsideElemIdx(unsigned faceIdx) const
+    { return static_cast<unsigned>(grid_->face_cells[2*gridFaceIdx_[faceIdx] + 1]); }
+
+    /*!
+     * \brief Returns the index of the face in the reference element of the inside
+     *        element, i.e., 1, 3 or 5.
+     */
+    unsigned insideFaceIdx(unsigned faceIdx) const
+    { return insideFaceIdx_[faceIdx]; }
+
+    unsigned outsideFaceIdx(unsigned faceIdx) const
+    { return insideFaceIdx_[faceIdx] - 1u; }
+
+    const double* center(unsigned faceIdx) const
+    { return grid_->face_centroids + 3*gridFaceIdx_[faceIdx]; }
+
+    /*!
+     * \brief Returns the normal of the face which is scaled by its area.
+     */
+    const double* areaNormal(unsigned faceIdx) const
+    { return grid_->face_normals + 3*gridFaceIdx_[faceIdx]; }
+
+private:
+    friend class EclConformingGridBuilder;
+
+    const UnstructuredGrid* grid_;
+    std::vector<int> gridFaceIdx_;
+    std::vector<unsigned char> insideFaceIdx_;
+};
+
+/*!
+ * \ingroup EclBlackOilSimulator
+ *
+ * \brief Creates an unstructured grid directly from a conforming corner-point grid.
+ *
+ * The generic corner-point processing intersects the pillars of all neighboring columns
+ * of cells to find the faces of faulted grids. If all active cells share their corners
+ * with their neighbors, which is the case for most grid blocks that do not contain
+ * faults, the faces are given by the logically Cartesian structure of the grid. In this
+ * case, the nodes and faces are generated directly and in parallel, the inactive cells
+ * are skipped as early as possible and the interior faces are recorded so that the
+ * transmissibilities can be computed without iterating over the intersections of the
+ * grid.
+ *
+ * Grids with faults, collapsed cells, pinch-outs or cells which are removed because
+ * their pore volume is too small are left to the generic code.
+ */
+class EclConformingGridBuilder
+{
+public:
+    /*!
+     * \brief Create the grid if the corner-point grid is conforming.
+     *
+     * If it is not, a null pointer is returned. Otherwise, the grid is allocated using
+     * allocate_grid() and needs to be released using destroy_grid().
+     */
+    static UnstructuredGrid* create(const Opm::EclipseGrid& eclGrid,
+                                    const std::vector<double>& porv,
+                                    EclInteriorFaces& interiorFaces)
+    {
+        if (eclGrid.isPinchActive())
+            return 0;
+
+        const std::array<int, 3> dims = {{ static_cast<int>(eclGrid.getNX()),
+                                           static_cast<int>(eclGrid.getNY()),
+                                           static_cast<int>(eclGrid.getNZ()) }};
+        const int numCartCells = dims[0]*dims[1]*dims[2];
+        const double minPv = eclGrid.getMinpvValue();
+
+        // determine the compressed index of each Cartesian cell
+        std::vector<int> compressedIdx(static_cast<size_t>(numCartCells), -1);
+        bool isConforming = true;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) reduction(&&:isConforming)
+#endif
+        for (int cartIdx = 0; cartIdx < numCartCells; ++cartIdx) {
+            if (!eclGrid.cellActive(static_cast<size_t>(cartIdx)))
+                continue;
+
+            compressedIdx[static_cast<size_t>(cartIdx)] = 0;
+            if (!porv.empty() && porv[static_cast<size_t>(cartIdx)] < minPv)
+                isConforming = false;
+        }
+        if (!isConforming)
+            return 0;
+
+        int numCells = 0;
+        for (int cartIdx = 0; cartIdx < numCartCells; ++cartIdx)
+            if (compressedIdx[static_cast<size_t>(cartIdx)] >= 0)
+                compressedIdx[static_cast<size_t>(cartIdx)] = numCells++;
+
+        // number the lattice points which are the corners of active cells
+        const std::array<int, 3> nodeDims = {{ dims[0] + 1, dims[1] + 1, dims[2] + 1 }};
+        const int numLatticeNodes = nodeDims[0]*nodeDims[1]*nodeDims[2];
+        std::vector<int> nodeIdx(static_cast<size_t>(numLatticeNodes), -1);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+        for (int latticeIdx = 0; latticeIdx < numLatticeNodes; ++latticeIdx) {
+            int cornerIdx;
+            if (firstActiveCell_(latticeIdx, dims, compressedIdx, cornerIdx) >= 0)
+                nodeIdx[static_cast<size_t>(latticeIdx)] = 0;
+        }
+
+        int numNodes = 0;
+        for (int latticeIdx = 0; latticeIdx < numLatticeNodes; ++latticeIdx)
+            if (nodeIdx[static_cast<size_t>(latticeIdx)] >= 0)
+                nodeIdx[static_cast<size_t>(latticeIdx)] = numNodes++;
+
+        // each cell owns the faces in positive direction and the boundary faces in
+        // negative direction, so the faces can be numbered by cell
+        std::vector<int> faceBegin(static_cast<size_t>(numCells) + 1, 0);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+        for (int cartIdx = 0; cartIdx < numCartCells; ++cartIdx) {
+            int cellIdx = compressedIdx[static_cast<size_t>(cartIdx)];
+            if (cellIdx >= 0)
+                faceBegin[static_cast<size_t>(cellIdx) + 1] =
+                    ownedFaceOffset_(cartIdx, /*faceTag=*/6, dims, compressedIdx);
+        }
+        for (int cellIdx = 0; cellIdx < numCells; ++cellIdx)
+            faceBegin[static_cast<size_t>(cellIdx) + 1] += faceBegin[static_cast<size_t>(cellIdx)];
+        const int numFaces = faceBegin[static_cast<size_t>(numCells)];
+
+        UnstructuredGrid* grid = allocate_grid(/*ndims=*/3,
+                                               static_cast<size_t>(numCells),
+                                               static_cast<size_t>(numFaces),
+                                               /*nfacenodes=*/4*static_cast<size_t>(numFaces),
+                                               /*ncellfaces=*/6*static_cast<size_t>(numCells),
+                                               static_cast<size_t>(numNodes));
+        if (!grid)
+            OPM_THROW(std::runtime_error, "Could not allocate the grid");
+        if (!grid->cell_facetag)
+            grid->cell_facetag = static_cast<int*>(std::malloc(6*static_cast<size_t>(numCells)*sizeof(int)));
+        grid->global_cell = static_cast<int*>(std::malloc(static_cast<size_t>(numCells)*sizeof(int)));
+        if (!grid->cell_facetag || !grid->global_cell) {
+            destroy_grid(grid);
+            OPM_THROW(std::runtime_error, "Could not allocate the grid");
+        }
+        for (unsigned dimIdx = 0; dimIdx < 3; ++dimIdx)
+            grid->cartdims[dimIdx] = dims[dimIdx];
+
+        // the position of each node is taken from the first active cell which contains
+        // it. if the positions of the corners of any active cell differ from the
+        // positions of its nodes, the grid is not conforming.
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+        for (int latticeIdx = 0; latticeIdx < numLatticeNodes; ++latticeIdx) {
+            int node = nodeIdx[static_cast<size_t>(latticeIdx)];
+            if (node < 0)
+                continue;
+
+            int cornerIdx;
+            int cartIdx = firstActiveCell_(latticeIdx, dims, compressedIdx, cornerIdx);
+            const auto& pos = cornerPos_(eclGrid, cartIdx, cornerIdx, dims);
+            for (unsigned dimIdx = 0; dimIdx < 3; ++dimIdx)
+                grid->node_coordinates[3*node + static_cast<int>(dimIdx)] = pos[dimIdx];
+        }
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) reduction(&&:isConforming)
+#endif
+        for (int cartIdx = 0; cartIdx < numCartCells; ++cartIdx) {
+            if (compressedIdx[static_cast<size_t>(cartIdx)] < 0)
+                continue;
+
+            std::array<int, 8> cellNodes;
+            cellNodes_(cellNodes, cartIdx, dims, nodeIdx);
+            std::array<std::array<double, 3>, 8> corners;
+            for (int cornerIdx = 0; cornerIdx < 8; ++cornerIdx) {
+                corners[cornerIdx] = cornerPos_(eclGrid, cartIdx, cornerIdx, dims);
+                const double* nodePos = grid->node_coordinates + 3*cellNodes[cornerIdx];
+                for (unsigned dimIdx = 0; dimIdx < 3; ++dimIdx)
+                    if (corners[cornerIdx][dimIdx] != nodePos[dimIdx])
+                        isConforming = false;
+            }
+
+            // collapsed pillars are merged by the generic code
+            for (int cornerIdx = 0; cornerIdx < 4; ++cornerIdx)
+                if (corners[cornerIdx] == corners[cornerIdx + 4])
+                    isConforming = false;
+        }
+        if (!isConforming) {
+            destroy_grid(grid);
+            return 0;
+        }
+
+        // create the topology of the faces and cells
+        grid->face_nodepos[0] = 0;
+        grid->cell_facepos[0] = 0;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+        for (int cartIdx = 0; cartIdx < numCartCells; ++cartIdx) {
+            int cellIdx = compressedIdx[static_cast<size_t>(cartIdx)];
+            if (cellIdx < 0)
+                continue;
+
+            grid->global_cell[cellIdx] = cartIdx;
+            grid->cell_facepos[cellIdx + 1] = 6*(cellIdx + 1);
+
+            std::array<int, 8> cellNodes;
+            cellNodes_(cellNodes, cartIdx, dims, nodeIdx);
+            std::array<double, 3> cellCenter = {{ 0.0, 0.0, 0.0 }};
+            for (int cornerIdx = 0; cornerIdx < 8; ++cornerIdx)
+                for (unsigned dimIdx = 0; dimIdx < 3; ++dimIdx)
+                    cellCenter[dimIdx] += grid->node_coordinates[3*cellNodes[cornerIdx] + static_cast<int>(dimIdx)]/8;
+
+            for (int faceTag = 0; faceTag < 6; ++faceTag) {
+                bool isPlusFace = (faceTag % 2) == 1;
+                int neighborIdx = neighborIdx_(cartIdx, faceTag, dims, compressedIdx);
+
+                int faceIdx;
+                if (isPlusFace || neighborIdx < 0) {
+                    faceIdx =
+                        faceBegin[static_cast<size_t>(cellIdx)]
+                        + ownedFaceOffset_(cartIdx, faceTag, dims, compressedIdx);
+                    grid->face_cells[2*faceIdx] = isPlusFace ? cellIdx : -1;
+                    grid->face_cells[2*faceIdx + 1] = isPlusFace ? neighborIdx : cellIdx;
+                    grid->face_nodepos[faceIdx + 1] = 4*(faceIdx + 1);
+                    setFaceNodes_(grid, faceIdx, faceTag, cellNodes, cellCenter);
+                }
+                else
+                    // the face is owned by the neighbor in negative direction
+                    faceIdx =
+                        faceBegin[static_cast<size_t>(neighborIdx)]
+                        + ownedFaceOffset_(neighborCartIdx_(cartIdx, faceTag, dims),
+                                           faceTag + 1,
+                                           dims,
+                                           compressedIdx);
+
+                grid->cell_faces[6*cellIdx + faceTag] = faceIdx;
+                grid->cell_facetag[6*cellIdx + faceTag] = faceTag;
+            }
+        }
+
+        compute_geometry(grid);
+
+        // record the interior faces. since the faces are numbered by the cells which
+        // own them, they are ordered by their inside element
+        std::vector<int> interiorFaceBegin(static_cast<size_t>(numCells) + 1, 0);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+        for (int cellIdx = 0; cellIdx < numCells; ++cellIdx) {
+            int n = 0;
+            for (int faceTag = 1; faceTag < 6; faceTag += 2)
+                if (grid->face_cells[2*grid->cell_faces[6*cellIdx + faceTag] + 1] >= 0)
+                    ++n;
+            interiorFaceBegin[static_cast<size_t>(cellIdx) + 1] = n;
+        }
+        for (int cellIdx = 0; cellIdx < numCells; ++cellIdx)
+            interiorFaceBegin[static_cast<size_t>(cellIdx) + 1] +=
+                interiorFaceBegin[static_cast<size_t>(cellIdx)];
+
+        interiorFaces.grid_ = grid;
+        interiorFaces.gridFaceIdx_.resize(static_cast<size_t>(interiorFaceBegin.back()));
+        interiorFaces.insideFaceIdx_.resize(static_cast<size_t>(interiorFaceBegin.back()));
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+        for (int cellIdx = 0; cellIdx < numCells; ++cellIdx) {
+            size_t i = static_cast<size_t>(interiorFaceBegin[static_cast<size_t>(cellIdx)]);
+            for (int faceTag = 1; faceTag < 6; faceTag += 2) {
+                int faceIdx = grid->cell_faces[6*cellIdx + faceTag];
+                if (grid->face_cells[2*faceIdx + 1] < 0)
+                    continue;
+                interiorFaces.gridFaceIdx_[i] = faceIdx;
+                interiorFaces.insideFaceIdx_[i] = static_cast<unsigned char>(faceTag);
+                ++i;
+            }
+        }
+
+        return grid;
+    }
+
+private:
+    // the Cartesian index of the neighbor of a cell, or -1 at the boundary of the
+    // logically Cartesian grid. faces 0 and 1 are in X direction, 2 and 3 in Y
+    // direction and 4 and 5 in Z direction.
+    static int neighborCartIdx_(int cartIdx, int faceTag, const std::array<int, 3>& dims)
+    {
+        std::array<int, 3> ijk = {{ cartIdx % dims[0],
+                                    (cartIdx/dims[0]) % dims[1],
+                                    cartIdx/(dims[0]*dims[1]) }};
+        int dimIdx = faceTag/2;
+        ijk[dimIdx] += (faceTag % 2 == 1) ? 1 : -1;
+        if (ijk[dimIdx] < 0 || ijk[dimIdx] >= dims[dimIdx])
+            return -1;
+        return ijk[0] + dims[0]*(ijk[1] + dims[1]*ijk[2]);
+    }
+
+    // the compressed index of the neighbor of a cell, or -1 if there is no active
+    // neighbor
+    static int neighborIdx_(int cartIdx,
+                            int faceTag,
+                            const std::array<int, 3>& dims,
+                            const std::vector<int>& compressedIdx)
+    {
+        int neighborCartIdx = neighborCartIdx_(cartIdx, faceTag, dims);
+        if (neighborCartIdx < 0)
+            return -1;
+        return compressedIdx[static_cast<size_t>(neighborCartIdx)];
+    }
+
+    // the number of faces which are owned by a cell and precede a given face of it. if
+    // faceTag is 6, this is the number of faces which are owned by the cell.
+    static int ownedFaceOffset_(int cartIdx,
+                                int faceTag,
+                                const std::array<int, 3>& dims,
+                                const std::vector<int>& compressedIdx)
+    {
+        int n = 0;
+        for (int i = 0; i < faceTag; ++i)
+            if (i % 2 == 1 || neighborIdx_(cartIdx, i, dims, compressedIdx) < 0)
+                ++n;
+        return n;
+    }
+
+    // returns the Cartesian index of the first active cell which contains a lattice
+    // point, or -1 if there is none. the index of the point in that cell is returned
+    // via cornerIdx.
+    static int firstActiveCell_(int latticeIdx,
+                                const std::array<int, 3>& dims,
+                                const std::vector<int>& compressedIdx,
+                                int& cornerIdx)
+    {
+        const int nx = dims[0] + 1;
+        const int ny = dims[1] + 1;
+        const std::array<int, 3> ijk = {{ latticeIdx % nx,
+                                          (latticeIdx/nx) % ny,
+                                          latticeIdx/(nx*ny) }};
+
+        // the corners of a cell are numbered like this: bit 0 denotes the X
+        // direction, bit 1 the Y direction and bit 2 the Z direction
+        for (cornerIdx = 7; cornerIdx >= 0; --cornerIdx) {
+            std::array<int, 3> cellIjk;
+            bool isValid = true;
+            for (unsigned dimIdx = 0; dimIdx < 3; ++dimIdx) {
+                cellIjk[dimIdx] = ijk[dimIdx] - ((cornerIdx >> dimIdx) & 1);
+                if (cellIjk[dimIdx] < 0 || cellIjk[dimIdx] >= dims[dimIdx])
+                    isValid = false;
+            }
+            if (!isValid)
+                continue;
+
+            int cartIdx = cellIjk[0] + dims[0]*(cellIjk[1] + dims[1]*cellIjk[2]);
+            if (compressedIdx[static_cast<size_t>(cartIdx)] >= 0)
+                return cartIdx;
+        }
+
+        return -1;
+    }
+
+    static void cellNodes_(std::array<int, 8>& cellNodes,
+                           int cartIdx,
+                           const std::array<int, 3>& dims,
+                           const std::vector<int>& nodeIdx)
+    {
+        const int nx = dims[0] + 1;
+        const int ny = dims[1] + 1;
+        const int i = cartIdx % dims[0];
+        const int j = (cartIdx/dims[0]) % dims[1];
+        const int k = cartIdx/(dims[0]*dims[1]);
+        for (int cornerIdx = 0; cornerIdx < 8; ++cornerIdx) {
+            int latticeIdx =
+                (i + (cornerIdx & 1))
+                + nx*((j + ((cornerIdx >> 1) & 1))
+                      + ny*(k + ((cornerIdx >> 2) & 1)));
+            cellNodes[cornerIdx] = nodeIdx[static_cast<size_t>(latticeIdx)];
+        }
+    }
+
+    static std::array<double, 3> cornerPos_(const Opm::EclipseGrid& eclGrid,
+                                            int cartIdx,
+                                            int cornerIdx,
+                                            const std::array<int, 3>& dims)
+    {
+        return eclGrid.getCornerPos(static_cast<size_t>(cartIdx % dims[0]),
+                                    static_cast<size_t>((cartIdx/dims[0]) % dims[1]),
+                                    static_cast<size_t>(cartIdx/(dims[0]*dims[1])),
+                                    static_cast<size_t>(cornerIdx));
+    }
+
+    // set the nodes of a face of a cell. the normal of the face, which is determined by
+    // the order of its nodes, must point in positive direction of the axis.
+    static void setFaceNodes_(UnstructuredGrid* grid,
+                              int faceIdx,
+                              int faceTag,
+                              const std::array<int, 8>& cellNodes,
+                              const std::array<double, 3>& cellCenter)
+    {
+        // the corners of the reference element which form a face, given in an order in
+        // which the normal points in positive direction of the axis if the grid is
+        // right-handed
+        static const int faceCorners[3][4] = {
+            { 0, 2, 6, 4 },
+            { 0, 4, 5, 1 },
+            { 0, 1, 3, 2 }
+        };
+
+        int dimIdx = faceTag/2;
+        int offset = (faceTag % 2 == 1) ? (1 << dimIdx) : 0;
+        int* faceNodes = grid->face_nodes + 4*faceIdx;
+        for (int i = 0; i < 4; ++i)
+            faceNodes[i] = cellNodes[faceCorners[dimIdx][i] + offset];
+
+        // if the grid is left-handed, the order of the nodes needs to be reversed.
+        const double* x[4];
+        for (int i = 0; i < 4; ++i)
+            x[i] = grid->node_coordinates + 3*faceNodes[i];
+        double diag1[3];
+        double diag2[3];
+        double dist[3];
+        for (int i = 0; i < 3; ++i) {
+            diag1[i] = x[2][i] - x[0][i];
+            diag2[i] = x[3][i] - x[1][i];
+            dist[i] = (x[0][i] + x[1][i] + x[2][i] + x[3][i])/4 - cellCenter[i];
+        }
+        double normalDist =
+            (diag1[1]*diag2[2] - diag1[2]*diag2[1])*dist[0]
+            + (diag1[2]*diag2[0] - diag1[0]*diag2[2])*dist[1]
+            + (diag1[0]*diag2[1] - diag1[1]*diag2[0])*dist[2];
+        bool pointsOutward = normalDist > 0;
+        if (pointsOutward != (faceTag % 2 == 1))
+            std::swap(faceNodes[1], faceNodes[3]);
+    }
+};
+
+} // namespace Ewoms
+
+#endif
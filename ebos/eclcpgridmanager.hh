@@ -28,12 +28,19 @@
 #define EWOMS_ECL_CP_GRID_MANAGER_HH
 
 #include "eclbasegridmanager.hh"
+#include "eclensemblegeometry.hh"
 #include "ecltransmissibility.hh"
 
 #include <dune/grid/CpGrid.hpp>
 
 #include <dune/common/version.hh>
 
+#include <opm/common/ErrorMacros.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
 namespace Ewoms {
 template <class TypeTag>
 class EclCpGridManager;
@@ -128,6 +135,8 @@ public:
 
         delete equilCartesianIndexMapper_;
         equilCartesianIndexMapper_ = 0;
+
+        this->equilCartesianToCompressed_.clear();
     }
 
     /*!
@@ -145,44 +154,21 @@ public:
 
         if (mpiSize > 1) {
             // the CpGrid's loadBalance() method likes to have the transmissibilities as
-            // its edge weights. since this is (kind of) a layering violation and
-            // transmissibilities are relatively expensive to compute, we only do it if
-            // more than a single process is involved in the simulation.
+            // its edge weights. since computing the full transmissibilities of the
+            // undistributed grid is a serial and memory intensive pass over the whole
+            // model, we only use an estimate of them which is based on the
+            // permeabilities and the geometry of the cells.
             cartesianIndexMapper_ = new CartesianIndexMapper(*grid_);
-            globalTrans_ = new EclTransmissibility<TypeTag>(*this);
-            globalTrans_->update();
-
-            // convert to transmissibility for faces
-            // TODO: grid_->numFaces() is not generic. use grid_->size(1) instead? (might
-            // not work)
-            const auto& gridView = grid_->leafGridView();
-            unsigned numFaces = grid_->numFaces();
-            std::vector<double> faceTrans(numFaces, 0.0);
-            ElementMapper elemMapper(this->gridView());
-            auto elemIt = gridView.template begin</*codim=*/0>();
-            const auto& elemEndIt = gridView.template end</*codim=*/0>();
-            for (; elemIt != elemEndIt; ++ elemIt) {
-                const auto& elem = *elemIt;
-                auto isIt = gridView.ibegin(elem);
-                const auto& isEndIt = gridView.iend(elem);
-                for (; isIt != isEndIt; ++ isIt) {
-                    const auto& is = *isIt;
-                    if (!is.neighbor())
-                        continue;
-
-#if DUNE_VERSION_NEWER(DUNE_COMMON, 2,4)
-                    unsigned I = elemMapper.index(is.inside());
-                    unsigned J = elemMapper.index(is.outside());
-#else
-                    unsigned I = elemMapper.map(is.inside());
-                    unsigned J = elemMapper.map(is.outside());
-#endif
-
-                    // FIXME (?): this is not portable!
-                    unsigned faceIdx = is.id();
-
-                    faceTrans[faceIdx] = globalTrans_->transmissibility(I, J);
-                }
+            std::vector<double> faceTrans;
+            computeFaceWeights_(faceTrans);
+
+            // the transmissibilities of the global grid are only computed if they are
+            // explicitly requested. the simulation itself uses the transmissibilities
+            // of the distributed grid which are computed by each process for its own
+            // part of the grid.
+            if (GET_PROP_VALUE(TypeTag, ExportGlobalTransmissibility)) {
+                globalTrans_ = new EclTransmissibility<TypeTag>(*this);
+                globalTrans_->update();
             }
 
             //distribute the grid and switch to the distributed view.
@@ -191,15 +177,11 @@ public:
 
             delete cartesianIndexMapper_;
             cartesianIndexMapper_ = nullptr;
-
-            if (!GET_PROP_VALUE(TypeTag, ExportGlobalTransmissibility)) {
-                delete globalTrans_;
-                globalTrans_ = nullptr;
-            }
         }
 #endif
 
         cartesianIndexMapper_ = new CartesianIndexMapper(*grid_);
+        this->cartesianToCompressed_.clear();
     }
 
     /*!
@@ -233,12 +215,22 @@ protected:
         const auto& gridProps = this->eclState().get3DProperties();
         const std::vector<double>& porv = gridProps.getDoubleGridProperty("PORV").getData();
 
-        grid_ = new Dune::CpGrid();
-        grid_->processEclipseFormat(this->eclState().getInputGrid(),
-                                    /*isPeriodic=*/false,
-                                    /*flipNormals=*/false,
-                                    /*clipZ=*/false,
-                                    porv);
+        auto createGrid = [&]() {
+            Dune::CpGrid *grid = new Dune::CpGrid();
+            grid->processEclipseFormat(this->eclState().getInputGrid(),
+                                       /*isPeriodic=*/false,
+                                       /*flipNormals=*/false,
+                                       /*clipZ=*/false,
+                                       porv);
+            return grid;
+        };
+
+        // the members of an ensemble use shallow copies of the same grid
+        auto& ensembleGeometry = EclEnsembleGeometry<TypeTag>::instance();
+        if (ensembleGeometry.enabled())
+            grid_ = new Dune::CpGrid(ensembleGeometry.grid(createGrid));
+        else
+            grid_ = createGrid();
 
         // we use separate grid objects: one for the calculation of the initial condition
         // via EQUIL and one for the actual simulation. The reason is that the EQUIL code
@@ -252,6 +244,83 @@ protected:
         globalTrans_ = nullptr;
     }
 
+    // estimate the transmissibilities of the faces of the undistributed grid for the
+    // purpose of partitioning it. this only considers the permeabilities in the
+    // direction of the faces, the face areas and the distances of the cell centers,
+    // i.e., net-to-gross ratios and transmissibility multipliers are ignored.
+    void computeFaceWeights_(std::vector<double>& faceWeights) const
+    {
+        const auto& props = this->eclState().get3DProperties();
+        if (!props.hasDeckDoubleGridProperty("PERMX"))
+            OPM_THROW(std::logic_error,
+                      "Can't read the intrinsic permeability from the ecl state. "
+                      "(The PERM{X,Y,Z} keywords are missing)");
+
+        const std::vector<double>& permxData = props.getDoubleGridProperty("PERMX").getData();
+        const std::vector<double>* permData[3] = { &permxData, &permxData, &permxData };
+        if (props.hasDeckDoubleGridProperty("PERMY"))
+            permData[1] = &props.getDoubleGridProperty("PERMY").getData();
+        if (props.hasDeckDoubleGridProperty("PERMZ"))
+            permData[2] = &props.getDoubleGridProperty("PERMZ").getData();
+
+        // TODO: grid_->numFaces() is not generic. use grid_->size(1) instead? (might
+        // not work)
+        const auto& gridView = grid_->leafGridView();
+        faceWeights.assign(grid_->numFaces(), 0.0);
+        ElementMapper elemMapper(gridView);
+        auto elemIt = gridView.template begin</*codim=*/0>();
+        const auto& elemEndIt = gridView.template end</*codim=*/0>();
+        for (; elemIt != elemEndIt; ++ elemIt) {
+            const auto& elem = *elemIt;
+            const auto& insideCenter = elem.geometry().center();
+#if DUNE_VERSION_NEWER(DUNE_COMMON, 2,4)
+            unsigned I = elemMapper.index(elem);
+#else
+            unsigned I = elemMapper.map(elem);
+#endif
+
+            auto isIt = gridView.ibegin(elem);
+            const auto& isEndIt = gridView.iend(elem);
+            for (; isIt != isEndIt; ++ isIt) {
+                const auto& is = *isIt;
+                if (!is.neighbor())
+                    continue;
+
+#if DUNE_VERSION_NEWER(DUNE_COMMON, 2,4)
+                unsigned J = elemMapper.index(is.outside());
+#else
+                unsigned J = elemMapper.map(is.outside());
+#endif
+                // each face only needs to be considered once
+                if (I > J)
+                    continue;
+
+                // FIXME (?): this is not portable!
+                unsigned faceIdx = is.id();
+
+                // the faces of the logically Cartesian cells are numbered such that
+                // two subsequent faces are perpendicular to the same axis
+                unsigned axisIdx = std::min<unsigned>(is.indexInInside()/2, 2);
+                const std::vector<double>& perm = *permData[axisIdx];
+                Scalar permI = perm[cartesianIndexMapper_->cartesianIndex(I)];
+                Scalar permJ = perm[cartesianIndexMapper_->cartesianIndex(J)];
+                if (permI <= 0.0 || permJ <= 0.0)
+                    continue;
+
+                auto distVec = is.outside().geometry().center();
+                distVec -= insideCenter;
+                Scalar dist = distVec.two_norm();
+                if (dist <= 0.0)
+                    continue;
+
+                // the harmonic mean of the permeabilities times the face area divided by
+                // the distance of the cell centers
+                Scalar harmonicPerm = 2.0/(1.0/permI + 1.0/permJ);
+                faceWeights[faceIdx] = harmonicPerm*is.geometry().volume()/dist;
+            }
+        }
+    }
+
     Grid* grid_;
     EquilGrid* equilGrid_;
     CartesianIndexMapper* cartesianIndexMapper_;
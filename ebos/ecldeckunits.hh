@@ -123,9 +123,22 @@ public:
      */
     template <class DeckScalar>
     void deckToSi(std::vector<DeckScalar>& values, Dimension dimens) const
+    { deckToSi(values.data(), values.data(), values.size(), dimens); }
+
+    /*!
+     * \brief Convert a buffer of scalar quantities from deck to SI units.
+     *
+     * The source and the destination may be the same buffer, otherwise they must not
+     * overlap. The conversion factors are loaded once and the loop only consists of a
+     * multiplication and an addition per value, so that it can be vectorized by the
+     * compiler.
+     */
+    template <class SrcScalar, class DstScalar>
+    void deckToSi(const SrcScalar* src, DstScalar* dst, size_t n, Dimension dimens) const
     {
-        for (unsigned i = 0; i < values.size(); ++i)
-            values[i] = values[i]*deckToSiFactor_[dimens] + deckToSiOffset_[dimens];
+        const Scalar factor = deckToSiFactor_[dimens];
+        const Scalar offset = deckToSiOffset_[dimens];
+        convert_(src, dst, n, factor, offset);
     }
 
     /*!
@@ -139,12 +152,42 @@ public:
      */
     template <class DeckScalar>
     void siToDeck(std::vector<DeckScalar>& values, Dimension dimens) const
+    { siToDeck(values.data(), values.data(), values.size(), dimens); }
+
+    /*!
+     * \brief Convert a buffer of scalar quantities from SI to deck units.
+     *
+     * This allows to convert the values while they are copied to the storage from which
+     * they are written, e.g., the one of an ERT keyword. The source and the destination
+     * may be the same buffer, otherwise they must not overlap.
+     */
+    template <class SrcScalar, class DstScalar>
+    void siToDeck(const SrcScalar* src, DstScalar* dst, size_t n, Dimension dimens) const
     {
-        for (unsigned i = 0; i < values.size(); ++i)
-            values[i] = (values[i] - deckToSiOffset_[dimens])/deckToSiFactor_[dimens];
+        // (x - offset)/factor is evaluated as x*(1/factor) - offset/factor
+        const Scalar factor = 1.0/deckToSiFactor_[dimens];
+        const Scalar offset = -deckToSiOffset_[dimens]*factor;
+        convert_(src, dst, n, factor, offset);
     }
 
 private:
+    // computes dst[i] = src[i]*factor + offset. if src and dst are the same buffer and
+    // the conversion is the identity, nothing needs to be done.
+    template <class SrcScalar, class DstScalar>
+    static void convert_(const SrcScalar* src,
+                         DstScalar* dst,
+                         size_t n,
+                         Scalar factor,
+                         Scalar offset)
+    {
+        if (factor == 1.0 && offset == 0.0
+            && static_cast<const void*>(src) == static_cast<const void*>(dst))
+            return;
+
+        for (size_t i = 0; i < n; ++i)
+            dst[i] = static_cast<DstScalar>(src[i]*factor + offset);
+    }
+
     std::vector<Scalar> deckToSiFactor_;
     std::vector<Scalar> deckToSiOffset_;
 };
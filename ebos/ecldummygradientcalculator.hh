@@ -85,6 +85,17 @@ public:
                   "Generic gradients are not supported by the ECL black-oil simulator");
     }
 
+    template <class QuantityCallback>
+    void calculateGradients(DimVector* quantityGrads OPM_UNUSED,
+                            const ElementContext& elemCtx OPM_UNUSED,
+                            unsigned fapIdx OPM_UNUSED,
+                            const QuantityCallback& quantityCallback OPM_UNUSED,
+                            unsigned numQuantities OPM_UNUSED) const
+    {
+        OPM_THROW(std::logic_error,
+                  "Generic gradients are not supported by the ECL black-oil simulator");
+    }
+
     template <class QuantityCallback>
     Scalar calculateBoundaryValue(const ElementContext& elemCtx OPM_UNUSED,
                                   unsigned fapIdx OPM_UNUSED,
@@ -0,0 +1,226 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \brief Provides a main function which simulates all members of an ensemble of ECL
+ *        decks within a single process.
+ */
+#ifndef EWOMS_ECL_ENSEMBLE_HH
+#define EWOMS_ECL_ENSEMBLE_HH
+
+#include "eclproblem.hh"
+#include "eclensemblegeometry.hh"
+
+#include <ewoms/common/start.hh>
+#include <ewoms/common/timer.hh>
+
+#include <opm/common/ResetLocale.hpp>
+
+#include <dune/common/parallel/mpihelper.hh>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Ewoms {
+namespace Properties {
+NEW_PROP_TAG(EclEnsembleMembers);
+NEW_PROP_TAG(EclEnsembleConcurrency);
+
+SET_STRING_PROP(EclBaseProblem, EclEnsembleMembers, "");
+SET_INT_PROP(EclBaseProblem, EclEnsembleConcurrency, -1);
+} // namespace Properties
+
+/*!
+ * \ingroup EclBlackOilSimulator
+ *
+ * \brief Simulate all members of an ensemble of ECL decks within a single process.
+ *
+ * The deck files of the members are listed in the file specified by the
+ * EclEnsembleMembers parameter (one file per line, empty lines and lines starting with
+ * '#' are ignored). All other parameters are the same for all members. The members must
+ * use the same grid and the same set of active cells, e.g., because they only differ in
+ * their property multipliers: The grid and the geometric part of the transmissibilities
+ * are computed only once (see EclEnsembleGeometry).
+ *
+ * The members are processed in batches of EclEnsembleConcurrency members (-1 means
+ * one member per OpenMP thread). The members of a batch are set up one after the other
+ * because the fluid systems and the auxiliary modules are initialized from the deck via
+ * static objects. Then they are run concurrently, each of them using a single thread.
+ * This is only supported for sequential runs.
+ *
+ * \param argc The number of command line arguments
+ * \param argv The array of the command line arguments
+ */
+template <class TypeTag>
+static inline int startEnsemble(int argc, char **argv)
+{
+    typedef typename GET_PROP_TYPE(TypeTag, Simulator) Simulator;
+    typedef typename GET_PROP_TYPE(TypeTag, GridManager) GridManager;
+    typedef typename GET_PROP_TYPE(TypeTag, ThreadManager) ThreadManager;
+
+    Opm::resetLocale();
+
+    // initialize MPI, finalize is done automatically on exit
+    const auto& mpiHelper = Dune::MPIHelper::instance(argc, argv);
+    if (mpiHelper.size() > 1) {
+        if (mpiHelper.rank() == 0)
+            std::cout << "Ensembles can only be simulated by a single process. Abort!\n"
+                      << std::flush;
+        return 1;
+    }
+
+    try
+    {
+        EWOMS_REGISTER_PARAM(TypeTag, std::string, EclEnsembleMembers,
+                             "A file which contains the names of the deck files of all "
+                             "members of the ensemble (one file per line)");
+        EWOMS_REGISTER_PARAM(TypeTag, int, EclEnsembleConcurrency,
+                             "The maximum number of members which are simulated "
+                             "concurrently ('-1' means one member per thread)");
+
+        int paramStatus = setupParameters_<TypeTag>(argc, argv);
+        if (paramStatus == 1)
+            return 1;
+        if (paramStatus == 2)
+            return 0;
+
+        ThreadManager::init();
+
+        const std::string& membersFileName =
+            EWOMS_GET_PARAM(TypeTag, std::string, EclEnsembleMembers);
+        std::ifstream membersFile(membersFileName);
+        if (!membersFile.is_open()) {
+            Parameters::printUsage<TypeTag>(argv[0],
+                                            "The file which lists the members of the "
+                                            "ensemble ('--ecl-ensemble-members') is not "
+                                            "readable!");
+            return 1;
+        }
+
+        std::vector<std::string> deckFileNames;
+        std::string line;
+        while (std::getline(membersFile, line)) {
+            line.erase(0, line.find_first_not_of(" \t"));
+            line.erase(line.find_last_not_of(" \t\r") + 1);
+            if (line.empty() || line[0] == '#')
+                continue;
+            deckFileNames.push_back(line);
+        }
+        unsigned numMembers = static_cast<unsigned>(deckFileNames.size());
+
+        int concurrency = EWOMS_GET_PARAM(TypeTag, int, EclEnsembleConcurrency);
+        if (concurrency <= 0)
+            concurrency = static_cast<int>(ThreadManager::maxThreads());
+        unsigned batchSize = static_cast<unsigned>(concurrency);
+
+        std::cout << "Simulating " << numMembers << " members of the ensemble, "
+                  << batchSize << " at a time\n" << std::flush;
+
+        EclEnsembleGeometry<TypeTag>::instance().setEnabled(true);
+
+        Ewoms::Timer timer;
+        timer.start();
+        unsigned numFailed = 0;
+        for (unsigned batchBegin = 0; batchBegin < numMembers; batchBegin += batchSize) {
+            unsigned batchEnd = std::min(batchBegin + batchSize, numMembers);
+            unsigned numBatchMembers = batchEnd - batchBegin;
+
+            std::vector<std::unique_ptr<Simulator> > simulators(numBatchMembers);
+            std::vector<std::string> errors(numBatchMembers);
+
+            // set up the members one after the other
+            for (unsigned i = 0; i < numBatchMembers; ++i) {
+                GridManager::setThreadDeckFileName(deckFileNames[batchBegin + i]);
+                try {
+                    simulators[i].reset(new Simulator(/*verbose=*/false));
+                }
+                catch (std::exception& e) {
+                    errors[i] = e.what();
+                }
+            }
+            GridManager::setThreadDeckFileName("");
+
+            // run them concurrently
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1) num_threads(concurrency)
+#endif
+            for (int i = 0; i < static_cast<int>(numBatchMembers); ++i) {
+                auto& simulator = simulators[static_cast<unsigned>(i)];
+                if (!simulator)
+                    continue;
+
+                try {
+                    simulator->run();
+                }
+                catch (std::exception& e) {
+                    errors[static_cast<unsigned>(i)] = e.what();
+                }
+
+                // release the memory of the member as soon as possible
+                simulator.reset();
+            }
+
+            for (unsigned i = 0; i < numBatchMembers; ++i) {
+                const std::string& deckFileName = deckFileNames[batchBegin + i];
+                if (errors[i].empty())
+                    std::cout << "Member '" << deckFileName << "' finished\n";
+                else {
+                    std::cout << "Member '" << deckFileName << "' failed: " << errors[i] << "\n";
+                    ++ numFailed;
+                }
+            }
+            std::cout << std::flush;
+        }
+        timer.stop();
+
+        EclEnsembleGeometry<TypeTag>::instance().setEnabled(false);
+
+        std::cout << "Simulated " << numMembers - numFailed << " of " << numMembers
+                  << " members of the ensemble in " << timer.realTimeElapsed() << " seconds\n"
+                  << std::flush;
+        return (numFailed > 0) ? 1 : 0;
+    }
+    catch (std::exception& e)
+    {
+        std::cout << e.what() << ". Abort!\n" << std::flush;
+        return 1;
+    }
+    catch (...)
+    {
+        std::cout << "Unknown exception thrown!\n" << std::flush;
+        return 3;
+    }
+}
+
+} // namespace Ewoms
+
+#endif
@@ -0,0 +1,135 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \copydoc Ewoms::EclEnsembleGeometry
+ */
+#ifndef EWOMS_ECL_ENSEMBLE_GEOMETRY_HH
+#define EWOMS_ECL_ENSEMBLE_GEOMETRY_HH
+
+#include "ecltransmissibility.hh"
+
+#include <ewoms/parallel/locks.hh>
+#include <ewoms/common/propertysystem.hh>
+
+#include <memory>
+
+namespace Ewoms {
+namespace Properties {
+NEW_PROP_TAG(Grid);
+}
+
+/*!
+ * \ingroup EclBlackOilSimulator
+ *
+ * \brief Stores the parts of the setup of an ECL simulation which are the same for all
+ *        members of an ensemble.
+ *
+ * The members of an ensemble are assumed to use the same grid and the same set of
+ * active cells, i.e., they may only differ in their properties and multipliers. The
+ * first member which is set up creates the grid and computes the geometric part of the
+ * transmissibilities, all subsequent members reuse these objects. If the ensemble mode
+ * is not enabled, which is the default, every simulator creates its own objects.
+ */
+template <class TypeTag>
+class EclEnsembleGeometry
+{
+    typedef typename GET_PROP_TYPE(TypeTag, Grid) Grid;
+    typedef typename EclTransmissibility<TypeTag>::Geometry TransmissibilityGeometry;
+
+public:
+    /*!
+     * \brief Returns the object which is used by the whole process.
+     */
+    static EclEnsembleGeometry& instance()
+    {
+        static EclEnsembleGeometry ensembleGeometry;
+        return ensembleGeometry;
+    }
+
+    /*!
+     * \brief Specify whether the simulators of the process share their grid and their
+     *        transmissibility geometry.
+     */
+    void setEnabled(bool yesno)
+    {
+        ScopedLock lock(mutex_);
+        enabled_ = yesno;
+        if (!enabled_) {
+            grid_.reset();
+            transGeometry_.reset();
+        }
+    }
+
+    /*!
+     * \brief Returns true iff the simulators of the process share their grid and their
+     *        transmissibility geometry.
+     */
+    bool enabled() const
+    { return enabled_; }
+
+    /*!
+     * \brief Returns the grid of the ensemble.
+     *
+     * If the grid does not exist yet, it is created by calling the specified function
+     * object, which is expected to return a pointer to a newly allocated grid.
+     */
+    template <class GridFactory>
+    const Grid& grid(GridFactory createGrid)
+    {
+        ScopedLock lock(mutex_);
+        if (!grid_)
+            grid_.reset(createGrid());
+        return *grid_;
+    }
+
+    /*!
+     * \brief Make an EclTransmissibility object use the geometry of the ensemble.
+     *
+     * If the geometry does not exist yet, it is computed by the specified object.
+     */
+    void shareTransmissibilityGeometry(EclTransmissibility<TypeTag>& trans)
+    {
+        ScopedLock lock(mutex_);
+        if (!transGeometry_) {
+            trans.updateGeometry();
+            transGeometry_ = trans.geometry();
+        }
+        else
+            trans.setGeometry(transGeometry_);
+    }
+
+private:
+    EclEnsembleGeometry()
+    { enabled_ = false; }
+
+    OmpMutex mutex_;
+    bool enabled_;
+    std::unique_ptr<Grid> grid_;
+    std::shared_ptr<const TransmissibilityGeometry> transGeometry_;
+};
+
+} // namespace Ewoms
+
+#endif
@@ -156,9 +156,14 @@ public:
             localToEquilIndex[ elemIdx ] = equilCartesianToCompressed[ cartesianIndex ];
         }
 
-        // copy the result into the array of initial fluid states
+        // copy the result into the array of initial fluid states. the cells are
+        // independent of each other, so this is done in parallel.
         initialFluidStates_.resize(numCartesianElems);
-        for (unsigned int elemIdx = 0; elemIdx < numElems; ++elemIdx) {
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+        for (int i = 0; i < static_cast<int>(numElems); ++i) {
+            unsigned elemIdx = static_cast<unsigned>(i);
             unsigned cartesianElemIdx = gridManager.cartesianIndex(elemIdx);
             auto& fluidState = initialFluidStates_[cartesianElemIdx];
 
@@ -33,6 +33,7 @@
 
 #include <ewoms/disc/common/fvbaseproperties.hh>
 #include <ewoms/models/blackoil/blackoilproperties.hh>
+#include <ewoms/common/fusedadoperations.hh>
 #include <ewoms/common/signum.hh>
 
 #include <opm/common/Valgrind.hpp>
@@ -271,16 +272,20 @@ protected:
             }
 
             // do the gravity correction: compute the hydrostatic pressure for the
-            // external at the depth of the internal one
+            // external at the depth of the internal one, i.e., the pressure difference
+            // is pEx + (rhoIn + rhoEx)/2*distZ*g - pIn. this is evaluated at once
+            // because the quantities of the exterior DOF are scalars.
             const Evaluation& rhoIn = intQuantsIn.fluidState().density(phaseIdx);
             Scalar rhoEx = Toolbox::value(intQuantsEx.fluidState().density(phaseIdx));
-            Evaluation rhoAvg = (rhoIn + rhoEx)/2;
 
             const Evaluation& pressureInterior = intQuantsIn.fluidState().pressure(phaseIdx);
-            Evaluation pressureExterior = Toolbox::value(intQuantsEx.fluidState().pressure(phaseIdx));
-            pressureExterior += rhoAvg*(distZ*g);
+            Scalar pressureExterior = Toolbox::value(intQuantsEx.fluidState().pressure(phaseIdx));
 
-            pressureDifference_[phaseIdx] = pressureExterior - pressureInterior;
+            Scalar halfDistZg = distZ*g/2;
+            fusedLinearCombination(pressureDifference_[phaseIdx],
+                                   pressureExterior + rhoEx*halfDistZg,
+                                   halfDistZg, rhoIn,
+                                   -1.0, pressureInterior);
 
             // decide the upstream index for the phase. for this we make sure that the
             // degree of freedom which is regarded upstream if both pressures are equal
@@ -344,11 +349,15 @@ protected:
             unsigned upstreamIdx = upstreamIndex_(phaseIdx);
             const auto& up = elemCtx.intensiveQuantities(upstreamIdx, timeIdx);
             if (upstreamIdx == interiorDofIdx_)
-                volumeFlux_[phaseIdx] =
-                    pressureDifference_[phaseIdx]*up.mobility(phaseIdx)*(-trans/faceArea);
+                fusedScaledProduct(volumeFlux_[phaseIdx],
+                                   -trans/faceArea,
+                                   pressureDifference_[phaseIdx],
+                                   up.mobility(phaseIdx));
             else
-                volumeFlux_[phaseIdx] =
-                    pressureDifference_[phaseIdx]*(Toolbox::value(up.mobility(phaseIdx))*(-trans/faceArea));
+                fusedAffine(volumeFlux_[phaseIdx],
+                            0.0,
+                            Toolbox::value(up.mobility(phaseIdx))*(-trans/faceArea),
+                            pressureDifference_[phaseIdx]);
         }
     }
 
@@ -0,0 +1,287 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \copydoc Ewoms::EclParameterSensitivities
+ */
+#ifndef EWOMS_ECL_PARAMETER_SENSITIVITIES_HH
+#define EWOMS_ECL_PARAMETER_SENSITIVITIES_HH
+
+#include "ecltransmissibility.hh"
+
+#include <ewoms/common/propertysystem.hh>
+
+#include <opm/material/common/MathToolbox.hpp>
+#include <opm/common/ErrorMacros.hpp>
+#include <opm/common/Exceptions.hpp>
+
+#include <dune/common/fvector.hh>
+
+#include <cassert>
+#include <memory>
+#include <vector>
+
+namespace Ewoms {
+namespace Properties {
+NEW_PROP_TAG(Simulator);
+NEW_PROP_TAG(Scalar);
+NEW_PROP_TAG(Evaluation);
+NEW_PROP_TAG(ElementContext);
+NEW_PROP_TAG(GlobalEqVector);
+NEW_PROP_TAG(RateVector);
+NEW_PROP_TAG(NumEq);
+NEW_PROP_TAG(ThreadManager);
+}
+
+/*!
+ * \ingroup EclBlackOilSimulator
+ *
+ * \brief Assembles the derivatives of the residual w.r.t. multipliers of the porosity
+ *        of each element and of the transmissibility of each interior face.
+ *
+ * The parameters are scaling factors of the current porosities and transmissibilities,
+ * i.e., the derivatives are evaluated at a value of 1 for all multipliers, so they
+ * correspond to \f$\theta \partial R/\partial\theta\f$ for the unscaled quantities.
+ * Since the storage term of the black-oil model is proportional to the porosity and the
+ * flux over a face is proportional to its transmissibility, the derivative of the
+ * residual w.r.t. a porosity multiplier is the storage term of the element and the one
+ * for a transmissibility multiplier is the flux over the face. Thus, no additional
+ * derivatives need to be carried by the automatic differentiation code, and the
+ * sensitivities can be extracted from the element contexts used by the linearizer (cf.
+ * FvBaseProblem::linearizeElement()).
+ *
+ * The result is a sparse matrix \f$\partial R/\partial\theta\f$: The porosity multiplier
+ * of an element only affects the residual of the element itself, and the
+ * transmissibility multiplier of a face only affects the residuals of the elements
+ * adjacent to it. Like the Jacobian matrix, the residuals are specific to the volume of
+ * the elements. The contribution of a time step to the gradient of an objective
+ * function then is \f$-\lambda^T \partial R/\partial\theta\f$, where \f$\lambda\f$ are
+ * the adjoint variables of the step (cf. addGradients()).
+ */
+template <class TypeTag>
+class EclParameterSensitivities
+{
+    typedef typename GET_PROP_TYPE(TypeTag, Simulator) Simulator;
+    typedef typename GET_PROP_TYPE(TypeTag, Scalar) Scalar;
+    typedef typename GET_PROP_TYPE(TypeTag, Evaluation) Evaluation;
+    typedef typename GET_PROP_TYPE(TypeTag, ElementContext) ElementContext;
+    typedef typename GET_PROP_TYPE(TypeTag, GlobalEqVector) GlobalEqVector;
+    typedef typename GET_PROP_TYPE(TypeTag, RateVector) RateVector;
+    typedef typename GET_PROP_TYPE(TypeTag, ThreadManager) ThreadManager;
+    typedef typename EclTransmissibility<TypeTag>::Geometry TransmissibilityGeometry;
+
+    typedef Opm::MathToolbox<Evaluation> Toolbox;
+
+    enum { numEq = GET_PROP_VALUE(TypeTag, NumEq) };
+
+    typedef Dune::FieldVector<Scalar, numEq> EqVector;
+
+public:
+    EclParameterSensitivities(const Simulator& simulator)
+        : simulator_(simulator)
+    {
+        enabled_ = false;
+    }
+
+    /*!
+     * \brief Allocate the data structures for the sensitivities.
+     *
+     * Until this method has been called, the sensitivities are not assembled.
+     *
+     * \param transGeometry The interior faces of the grid as used for the
+     *                      transmissibilities
+     */
+    void finishInit(std::shared_ptr<const TransmissibilityGeometry> transGeometry)
+    {
+        transGeometry_ = transGeometry;
+
+        // this code assumes that the DOFs are the elements, i.e., an ECFV spatial
+        // discretization with TPFA.
+        size_t numElements = simulator_.model().numGridDof();
+        assert(transGeometry_->rowBegin.size() == numElements + 1);
+
+        porositySensitivity_.resize(numElements);
+        transmissibilitySensitivity_.resize(2*transGeometry_->faces.size());
+        for (auto& sens : porositySensitivity_)
+            sens = 0.0;
+        for (auto& sens : transmissibilitySensitivity_)
+            sens = 0.0;
+
+        enabled_ = true;
+    }
+
+    /*!
+     * \brief Returns true iff the sensitivities are assembled by the linearizer.
+     */
+    bool enabled() const
+    { return enabled_; }
+
+    /*!
+     * \brief Update the sensitivities of the residual of an element.
+     *
+     * This only uses values which have already been calculated for the linearization
+     * of the element. Since only the entries of the element's own residual are written,
+     * this method may be called concurrently for different elements.
+     */
+    void update(const ElementContext& elemCtx)
+    {
+        // the parameter sensitivities are only required for the linearization w.r.t.
+        // the most recent solution
+        unsigned timeIdx = elemCtx.linearizationType().time;
+        if (!enabled_ || timeIdx != 0)
+            return;
+
+        const auto& model = elemCtx.model();
+        const auto& localResidual = model.localResidual(ThreadManager::threadId());
+        const auto& stencil = elemCtx.stencil(timeIdx);
+        unsigned focusDofIdx = 0;
+        unsigned globalElemIdx = elemCtx.globalSpaceIndex(focusDofIdx, timeIdx);
+        Scalar dofVolume = elemCtx.dofTotalVolume(focusDofIdx, timeIdx);
+
+        // the porosity enters the residual via the storage terms of the current
+        // solution and of the one at the beginning of the time step
+        EqVector storage;
+        EqVector prevStorage;
+        localResidual.computeStorage(storage, elemCtx, focusDofIdx, /*timeIdx=*/0);
+        if (elemCtx.enableStorageCache())
+            prevStorage = model.cachedStorage(globalElemIdx, /*timeIdx=*/1);
+        else
+            localResidual.computeStorage(prevStorage, elemCtx, focusDofIdx, /*timeIdx=*/1);
+
+        Scalar scvVolume =
+            stencil.subControlVolume(focusDofIdx).volume()
+            * elemCtx.intensiveQuantities(focusDofIdx, timeIdx).extrusionFactor();
+        Scalar storageFactor = scvVolume/(simulator_.timeStepSize()*dofVolume);
+        EqVector& porositySens = porositySensitivity_[globalElemIdx];
+        for (unsigned eqIdx = 0; eqIdx < numEq; ++eqIdx)
+            porositySens[eqIdx] = (storage[eqIdx] - prevStorage[eqIdx])*storageFactor;
+
+        // the transmissibility of a face enters the residual via the flux over it
+        RateVector flux;
+        size_t numInteriorFaces = elemCtx.numInteriorFaces(timeIdx);
+        for (unsigned scvfIdx = 0; scvfIdx < numInteriorFaces; ++scvfIdx) {
+            const auto& face = stencil.interiorFace(scvfIdx);
+            unsigned globalNeighborIdx = elemCtx.globalSpaceIndex(face.exteriorIndex(), timeIdx);
+            unsigned faceIdx = transGeometry_->faceIndex(globalElemIdx, globalNeighborIdx);
+            if (faceIdx >= transGeometry_->faces.size())
+                // e.g. a non-neighboring connection
+                continue;
+
+            localResidual.computeFlux(flux, elemCtx, scvfIdx, timeIdx);
+            Scalar alpha =
+                face.area()
+                * elemCtx.extensiveQuantities(scvfIdx, timeIdx).extrusionFactor()
+                / dofVolume;
+
+            EqVector& transSens =
+                transmissibilitySensitivity_[sensitivityIndex_(faceIdx, globalElemIdx)];
+            for (unsigned eqIdx = 0; eqIdx < numEq; ++eqIdx)
+                transSens[eqIdx] = Toolbox::value(flux[eqIdx])*alpha;
+        }
+    }
+
+    /*!
+     * \brief Returns the derivative of the residual of an element w.r.t. the multiplier
+     *        of its porosity.
+     *
+     * The residuals of all other elements do not depend on this parameter.
+     */
+    const EqVector& porositySensitivity(unsigned elemIdx) const
+    { return porositySensitivity_[elemIdx]; }
+
+    /*!
+     * \brief Returns the derivative of the residual of an element w.r.t. the multiplier
+     *        of the transmissibility of an interior face.
+     *
+     * The element must be adjacent to the face, the residuals of all other elements do
+     * not depend on this parameter. The faces are numbered as given by
+     * EclTransmissibility::geometry().
+     */
+    const EqVector& transmissibilitySensitivity(unsigned faceIdx, unsigned elemIdx) const
+    { return transmissibilitySensitivity_[sensitivityIndex_(faceIdx, elemIdx)]; }
+
+    /*!
+     * \brief Add the contribution of the most recent linearization to the gradients of
+     *        an objective function w.r.t. the porosity and transmissibility multipliers.
+     *
+     * i.e., this subtracts \f$\lambda^T \partial R/\partial\theta\f$ from the gradients.
+     * The vectors of the gradients are resized if necessary.
+     *
+     * \param lambda The adjoint variables of the time step
+     * \param porosityGradient The gradient w.r.t. the porosity multipliers of all
+     *                         elements
+     * \param transGradient The gradient w.r.t. the transmissibility multipliers of all
+     *                      interior faces
+     */
+    void addGradients(const GlobalEqVector& lambda,
+                      std::vector<Scalar>& porosityGradient,
+                      std::vector<Scalar>& transGradient) const
+    {
+        size_t numElements = porositySensitivity_.size();
+        size_t numFaces = transGeometry_->faces.size();
+        porosityGradient.resize(numElements, 0.0);
+        transGradient.resize(numFaces, 0.0);
+
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+        for (int i = 0; i < static_cast<int>(numElements); ++i) {
+            unsigned elemIdx = static_cast<unsigned>(i);
+            porosityGradient[elemIdx] -= lambda[elemIdx]*porositySensitivity_[elemIdx];
+        }
+
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+        for (int i = 0; i < static_cast<int>(numFaces); ++i) {
+            unsigned faceIdx = static_cast<unsigned>(i);
+            const auto& face = transGeometry_->faces[faceIdx];
+            transGradient[faceIdx] -=
+                lambda[face.insideElemIdx]*transmissibilitySensitivity_[2*faceIdx]
+                + lambda[face.outsideElemIdx]*transmissibilitySensitivity_[2*faceIdx + 1];
+        }
+    }
+
+private:
+    // the sensitivities of the two elements adjacent to a face are stored next to each
+    // other, the one of the inside element comes first
+    unsigned sensitivityIndex_(unsigned faceIdx, unsigned elemIdx) const
+    {
+        const auto& face = transGeometry_->faces[faceIdx];
+        assert(elemIdx == face.insideElemIdx || elemIdx == face.outsideElemIdx);
+        return 2*faceIdx + ((elemIdx == face.insideElemIdx) ? 0 : 1);
+    }
+
+    const Simulator& simulator_;
+
+    bool enabled_;
+    std::shared_ptr<const TransmissibilityGeometry> transGeometry_;
+
+    std::vector<EqVector> porositySensitivity_;
+    std::vector<EqVector> transmissibilitySensitivity_;
+};
+
+} // namespace Ewoms
+
+#endif
@@ -31,7 +31,9 @@
 #include <ewoms/models/blackoil/blackoilproperties.hh>
 #include <ewoms/aux/baseauxiliarymodule.hh>
 #include <ewoms/common/propertysystem.hh>
+#include <ewoms/common/parametersystem.hh>
 #include <ewoms/common/alignedallocator.hh>
+#include <ewoms/common/profiler.hh>
 
 #include <opm/material/fluidstates/CompositionalFluidState.hpp>
 #include <opm/material/densead/Evaluation.hpp>
@@ -45,8 +47,13 @@
 #include <dune/geometry/referenceelements.hh>
 
 #include <map>
+#include <utility>
+#include <vector>
 
 namespace Ewoms {
+namespace Properties {
+NEW_PROP_TAG(EliminateWellEquations);
+}
 
 template <class TypeTag>
 class EcfvDiscretization;
@@ -125,6 +132,10 @@ class EclPeacemanWell : public BaseAuxiliaryModule<TypeTag>
     typedef Opm::CompositionalFluidState<Scalar, FluidSystem, /*storeEnthalpy=*/false> FluidState;
     typedef Dune::FieldMatrix<Scalar, dimWorld, dimWorld> DimMatrix;
 
+    // the derivatives w.r.t. the bottom hole pressure
+    typedef Opm::DenseAd::Evaluation<Scalar, 1> BhpEval;
+    typedef Dune::FieldVector<Scalar, numModelEq> EqVector;
+
     // all quantities that need to be stored per degree of freedom that intersects the
     // well.
     struct DofVariables {
@@ -207,6 +218,9 @@ class EclPeacemanWell : public BaseAuxiliaryModule<TypeTag>
         ElementStorage element;
         unsigned pvtRegionIdx;
         unsigned localDofIdx;
+
+        // the global index of the DOF
+        unsigned gridDofIdx;
     };
 
     // some safety checks/caveats
@@ -268,7 +282,9 @@ public:
             actualResvRates_[phaseIdx] = 0.0;
 
             volumetricWeight_[phaseIdx] = 0.0;
+            groupVolumetricWeight_[phaseIdx] = 0.0;
         }
+        groupRateLimit_ = 1e100;
 
         refDepth_ = 0.0;
 
@@ -286,19 +302,33 @@ public:
         injectionFluidState_.setTemperature(273.15 + 25);
 
         injectedPhaseIdx_ = oilPhaseIdx;
+
+        eliminateEquations_ = EWOMS_GET_PARAM(TypeTag, bool, EliminateWellEquations);
+        eliminatedLinearizationValid_ = false;
+        perforationsEvaluated_ = false;
+        perfWellDerivativesEvaluated_ = false;
+        eliminatedInverseDiagonal_ = 0.0;
+        eliminatedResidual_ = 0.0;
     }
 
     /*!
      * \copydoc Ewoms::BaseAuxiliaryModule::numDofs()
+     *
+     * If the well equation is eliminated from the global system of equations, the well
+     * does not exhibit any degrees of freedom.
      */
     virtual unsigned numDofs() const
-    { return 1; }
+    { return eliminateEquations_ ? 0 : 1; }
 
     /*!
      * \copydoc Ewoms::BaseAuxiliaryModule::addNeighbors()
      */
     virtual void addNeighbors(std::vector<NeighborSet>& neighbors) const
     {
+        if (eliminateEquations_)
+            // the couplings of the perforated DOFs are not part of the matrix
+            return;
+
         int wellGlobalDof = AuxModule::localToGlobalDof(/*localDofIdx=*/0);
 
         // the well's bottom hole pressure always affects itself...
@@ -306,11 +336,10 @@ public:
 
         // add the grid DOFs which are influenced by the well, and add the well dof to
         // the ones neighboring the grid ones
-        auto wellDofIt = dofVariables_.begin();
-        const auto& wellDofEndIt = dofVariables_.end();
-        for (; wellDofIt != wellDofEndIt; ++ wellDofIt) {
-            neighbors[wellGlobalDof].insert(wellDofIt->first);
-            neighbors[wellDofIt->first].insert(wellGlobalDof);
+        for (unsigned perfIdx = 0; perfIdx < dofVariables_.size(); ++ perfIdx) {
+            unsigned gridDofIdx = dofVariables_[perfIdx].gridDofIdx;
+            neighbors[wellGlobalDof].insert(gridDofIdx);
+            neighbors[gridDofIdx].insert(wellGlobalDof);
         }
     }
 
@@ -319,18 +348,40 @@ public:
      */
     virtual void applyInitial()
     {
+        if (eliminateEquations_)
+            return;
+
         auto& sol = const_cast<SolutionVector&>(simulator_.model().solution(/*timeIdx=*/0));
 
         int wellGlobalDof = AuxModule::localToGlobalDof(/*localDofIdx=*/0);
         sol[wellGlobalDof] = 0.0;
     }
 
+    /*!
+     * \copydoc Ewoms::BaseAuxiliaryModule::prepareLinearization()
+     *
+     * This evaluates the well equation and the derivatives of all perforations, i.e.,
+     * everything except adding them to the global system of equations.
+     */
+    virtual void prepareLinearization(bool residualOnly)
+    {
+        EWOMS_PROFILE_REGION("EclPeacemanWell::prepareLinearization");
+
+        bool computeWellDerivatives = !(residualOnly && eliminateEquations_);
+        evaluatePerforations_(computeWellDerivatives);
+    }
+
     /*!
      * \copydoc Ewoms::BaseAuxiliaryModule::linearize()
      */
     virtual void linearize(JacobianMatrix& matrix, GlobalEqVector& residual)
     {
-        const SolutionVector& curSol = simulator_.model().solution(/*timeIdx=*/0);
+        EWOMS_PROFILE_REGION("EclPeacemanWell::linearize");
+
+        if (eliminateEquations_) {
+            linearizeEliminated_(&matrix, residual);
+            return;
+        }
 
         unsigned wellGlobalDofIdx = AuxModule::localToGlobalDof(/*localDofIdx=*/0);
         residual[wellGlobalDofIdx] = 0.0;
@@ -344,133 +395,80 @@ public:
             // if the well is shut, make the auxiliary DOFs a trivial equation in the
             // matrix: the main diagonal is already set to the identity matrix, the
             // off-diagonal matrix entries must be set to 0.
-            auto wellDofIt = dofVariables_.begin();
-            const auto& wellDofEndIt = dofVariables_.end();
-            for (; wellDofIt != wellDofEndIt; ++ wellDofIt) {
-                matrix[wellGlobalDofIdx][wellDofIt->first] = 0.0;
-                matrix[wellDofIt->first][wellGlobalDofIdx] = 0.0;
+            for (unsigned perfIdx = 0; perfIdx < dofVariables_.size(); ++ perfIdx) {
+                unsigned gridDofIdx = dofVariables_[perfIdx].gridDofIdx;
+                matrix[wellGlobalDofIdx][gridDofIdx] = 0.0;
+                matrix[gridDofIdx][wellGlobalDofIdx] = 0.0;
                 residual[wellGlobalDofIdx] = 0.0;
             }
             return;
         }
 
-        Scalar wellResid = wellResidual_(actualBottomHolePressure_);
-        residual[wellGlobalDofIdx][0] = wellResid;
+        // the well equation and its derivative w.r.t. the bottom hole pressure
+        if (!perforationsEvaluated_ || !perfWellDerivativesEvaluated_)
+            evaluatePerforations_(/*computeWellDerivatives=*/true);
+        perforationsEvaluated_ = false;
+
+        const BhpEval& wellResid = evaluatedWellResidual_;
+        residual[wellGlobalDofIdx][0] = wellResid.value();
+        diagBlock[0][0] = wellResid.derivative(0);
 
         // account for the effect of the grid DOFs which are influenced by the well on
         // the well equation and the effect of the well on the grid DOFs
-        auto wellDofIt = dofVariables_.begin();
-        const auto& wellDofEndIt = dofVariables_.end();
-
-        ElementContext elemCtx(simulator_);
-        for (; wellDofIt != wellDofEndIt; ++ wellDofIt) {
-            unsigned gridDofIdx = wellDofIt->first;
-            const auto& dofVars = *dofVariables_[gridDofIdx];
-            DofVariables tmpDofVars(dofVars);
-            auto priVars(curSol[gridDofIdx]);
+        for (unsigned perfIdx = 0; perfIdx < dofVariables_.size(); ++ perfIdx) {
+            unsigned gridDofIdx = dofVariables_[perfIdx].gridDofIdx;
+            const EqVector& wellDerivatives = perfWellDerivatives_[perfIdx];
+            const EqVector& sourceDerivatives = perfSourceDerivatives_[perfIdx];
 
-            /////////////
             // influence of grid on well
             auto& curBlock = matrix[wellGlobalDofIdx][gridDofIdx];
-
-#if DUNE_VERSION_NEWER(DUNE_GRID, 2, 4)
-            elemCtx.updateStencil( dofVars.element );
-#else
-            elemCtx.updateStencil( *dofVars.element );
-#endif
             curBlock = 0.0;
-            for (unsigned priVarIdx = 0; priVarIdx < numModelEq; ++priVarIdx) {
-                // calculate the derivative of the well equation w.r.t. the current
-                // primary variable using forward differences
-                Scalar eps =
-                    1e3
-                    *std::numeric_limits<Scalar>::epsilon()
-                    *std::max<Scalar>(1.0, priVars[priVarIdx]);
-                priVars[priVarIdx] += eps;
-
-                elemCtx.updateIntensiveQuantities(priVars, dofVars.localDofIdx, /*timeIdx=*/0);
-                tmpDofVars.update(elemCtx.intensiveQuantities(dofVars.localDofIdx, /*timeIdx=*/0));
-
-                Scalar dWellEq_dPV =
-                    (wellResidual_(actualBottomHolePressure_, &tmpDofVars, gridDofIdx) - wellResid)
-                    / eps;
-                curBlock[0][priVarIdx] = dWellEq_dPV;
-
-                // go back to the original primary variables
-                priVars[priVarIdx] -= eps;
-            }
-            //
-            /////////////
-
-            /////////////
-            // influence of well on grid:
-            RateVector q(0.0);
-            RateVector modelRate;
-            std::array<Scalar, numPhases> resvRates;
+            for (unsigned priVarIdx = 0; priVarIdx < numModelEq; ++priVarIdx)
+                curBlock[0][priVarIdx] = wellDerivatives[priVarIdx];
 
-            elemCtx.updateIntensiveQuantities(priVars, dofVars.localDofIdx, /*timeIdx=*/0);
-
-            const auto& fluidState = elemCtx.intensiveQuantities(dofVars.localDofIdx, /*timeIdx=*/0).fluidState();
-
-            // first, we need the source term of the grid for the slightly disturbed well.
-            Scalar eps =
-                1e3
-                *std::numeric_limits<Scalar>::epsilon()
-                *std::max<Scalar>(1e5, actualBottomHolePressure_);
-            computeVolumetricDofRates_(resvRates, actualBottomHolePressure_ + eps, *dofVariables_[gridDofIdx]);
-            for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++phaseIdx) {
-                if (!FluidSystem::phaseIsActive(phaseIdx))
-                    continue;
-
-                modelRate.setVolumetricRate(fluidState, phaseIdx, resvRates[phaseIdx]);
-                for (unsigned compIdx = 0; compIdx < numComponents; ++compIdx)
-                    q[compIdx] += modelRate[compIdx];
-            }
-
-            // then, we subtract the source rates for a undisturbed well.
-            computeVolumetricDofRates_(resvRates, actualBottomHolePressure_, *dofVariables_[gridDofIdx]);
-            for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++phaseIdx) {
-                if (!FluidSystem::phaseIsActive(phaseIdx))
-                    continue;
-
-                modelRate.setVolumetricRate(fluidState, phaseIdx, resvRates[phaseIdx]);
-                for (unsigned compIdx = 0; compIdx < numComponents; ++compIdx)
-                    q[compIdx] -= modelRate[compIdx];
-            }
-
-            // and finally, we divide by the epsilon to get the derivative
-            for (unsigned eqIdx = 0; eqIdx < numModelEq; ++eqIdx)
-                q[eqIdx] /= eps;
-
-            // now we put this derivative into the right place in the Jacobian
-            // matrix. This is a bit hacky because it assumes that the model uses a mass
-            // rate for each component as its first conservation equation, but we require
-            // the black-oil model for now anyway, so this should not be too much of a
-            // problem...
-            Opm::Valgrind::CheckDefined(q);
+            // influence of well on grid
             auto& matrixEntry = matrix[gridDofIdx][wellGlobalDofIdx];
             matrixEntry = 0.0;
             for (unsigned eqIdx = 0; eqIdx < numModelEq; ++ eqIdx)
-                matrixEntry[eqIdx][0] = - Toolbox::value(q[eqIdx])/dofVars.totalVolume;
-            //
-            /////////////
+                matrixEntry[eqIdx][0] = sourceDerivatives[eqIdx];
         }
+    }
 
-        // effect of changing the well's bottom hole pressure on the well equation
-        Scalar eps =
-            1e3
-            *std::numeric_limits<Scalar>::epsilon()
-            *std::max<Scalar>(1e7, targetBottomHolePressure_);
-        Scalar wellResidStar = wellResidual_(actualBottomHolePressure_ + eps);
-        diagBlock[0][0] = (wellResidStar - wellResid)/eps;
+    /*!
+     * \copydoc Ewoms::BaseAuxiliaryModule::linearizeResidual()
+     */
+    virtual void linearizeResidual(JacobianMatrix& matrix, GlobalEqVector& residual)
+    {
+        if (eliminateEquations_)
+            linearizeEliminated_(/*matrix=*/nullptr, residual);
+        else
+            linearize(matrix, residual);
     }
 
+    /*!
+     * \copydoc Ewoms::BaseAuxiliaryModule::updateEliminatedUnknowns()
+     */
+    virtual void updateEliminatedUnknowns(const GlobalEqVector& solutionUpdate)
+    {
+        if (!eliminateEquations_ || !eliminatedLinearizationValid_)
+            return;
+
+        // the update of the bottom hole pressure is d^-1 (r_w - b^T dx). It is used as
+        // the initial guess for the bottom hole pressure of the next iteration.
+        Scalar delta = eliminatedResidual_;
+        for (unsigned perfIdx = 0; perfIdx < dofVariables_.size(); ++ perfIdx) {
+            unsigned gridDofIdx = dofVariables_[perfIdx].gridDofIdx;
+            delta -= eliminatedWellDerivatives_[perfIdx]*solutionUpdate[gridDofIdx];
+        }
+        actualBottomHolePressure_ -= eliminatedInverseDiagonal_*delta;
+    }
 
     // reset the well to the initial state, i.e. remove all degrees of freedom...
     void clear()
     {
-        dofVarsStore_.clear();
         dofVariables_.clear();
+        eliminatedLinearizationValid_ = false;
+        perforationsEvaluated_ = false;
     }
 
     /*!
@@ -604,9 +602,8 @@ public:
 
         const auto& dofPos = context.pos(dofIdx, /*timeIdx=*/0);
 
-        dofVarsStore_.push_back(DofVariables());
-        dofVariables_[globalDofIdx] = &dofVarsStore_.back();
-        DofVariables& dofVars = *dofVariables_[globalDofIdx];
+        dofVariables_.push_back(DofVariables());
+        DofVariables& dofVars = dofVariables_.back();
         wellTotalVolume_ += context.model().dofTotalVolume(globalDofIdx);
 
 #if DUNE_VERSION_NEWER(DUNE_GRID, 2, 4)
@@ -616,6 +613,7 @@ public:
 #endif
 
         dofVars.localDofIdx = dofIdx;
+        dofVars.gridDofIdx = globalDofIdx;
         dofVars.pvtRegionIdx = context.problem().pvtRegionIndex(context, dofIdx, /*timeIdx=*/0);
         assert(dofVars.pvtRegionIdx == 0);
 
@@ -688,7 +686,7 @@ public:
             std::sqrt(K[0][0]*K[1][1])*dofVars.effectiveSize[2];
 
         // from that, compute the default connection transmissibility factor
-        computeConnectionTransmissibilityFactor_(globalDofIdx);
+        computeConnectionTransmissibilityFactor_(dofVars);
 
         // we assume that the z-coordinate represents depth (and not
         // height) here...
@@ -733,7 +731,7 @@ public:
     void setConnectionTransmissibilityFactor(const Context& context, unsigned dofIdx, Scalar value)
     {
         unsigned globalDofIdx = context.globalSpaceIndex(dofIdx, /*timeIdx=*/0);
-        dofVariables_[globalDofIdx]->connectionTransmissibilityFactor = value;
+        perforation_(globalDofIdx).connectionTransmissibilityFactor = value;
     }
 
     /*!
@@ -751,9 +749,10 @@ public:
     void setEffectivePermeability(const Context& context, unsigned dofIdx, Scalar value)
     {
         unsigned globalDofIdx = context.globalSpaceIndex(dofIdx, /*timeIdx=*/0);
-        dofVariables_[globalDofIdx].effectivePermeability = value;
+        DofVariables& dofVars = perforation_(globalDofIdx);
+        dofVars.effectivePermeability = value;
 
-        computeConnectionTransmissibilityFactor_(globalDofIdx);
+        computeConnectionTransmissibilityFactor_(dofVars);
     }
 
     /*!
@@ -800,12 +799,45 @@ public:
     WellStatus wellStatus() const
     { return wellStatus_; }
 
+    /*!
+     * \brief Return the number of degrees of freedom of the grid which are perforated
+     *        by the well.
+     */
+    unsigned numPerforatedDofs() const
+    { return dofVariables_.size(); }
+
+    /*!
+     * \brief Return the global index of the degree of freedom of the grid which
+     *        corresponds to a perforation of the well.
+     *
+     * The perforations are numbered in the order in which the degrees of freedom were
+     * added to the well.
+     */
+    unsigned perforatedDofIndex(unsigned perfIdx) const
+    { return dofVariables_[perfIdx].gridDofIdx; }
+
+    /*!
+     * \brief Return the index of the perforation of the well which corresponds to a
+     *        degree of freedom of the grid.
+     *
+     * If the degree of freedom is not perforated by the well, -1 is returned. Note that
+     * this requires a linear search over the perforations of the well: The
+     * EclWellManager stores the perforation of each degree of freedom.
+     */
+    int perforationIndex(unsigned globalDofIdx) const
+    {
+        for (unsigned perfIdx = 0; perfIdx < dofVariables_.size(); ++ perfIdx)
+            if (dofVariables_[perfIdx].gridDofIdx == globalDofIdx)
+                return static_cast<int>(perfIdx);
+        return -1;
+    }
+
     /*!
      * \brief Return true iff a degree of freedom is directly affected
      *        by the well
      */
     bool applies(unsigned globalDofIdx) const
-    { return dofVariables_.count(globalDofIdx) > 0; }
+    { return perforationIndex(globalDofIdx) >= 0; }
 
     /*!
      * \brief Set the maximum/minimum bottom hole pressure [Pa] of the well.
@@ -876,6 +908,64 @@ public:
     Scalar maximumReservoirRate() const
     { return maximumReservoirRate_; }
 
+    /*!
+     * \brief Set the share of the well in the target rate of its group [m^3/s].
+     *
+     * In contrast to the maximum surface rate, the group share uses its own relative
+     * weights of the volumetric phase rates, i.e., those of the target of the group.
+     * Like the other limits, the share is to be read as the maximum absolute value of
+     * the rate. A value of 1e100 or more disables the group limit.
+     */
+    void setGroupRateLimit(Scalar value, const std::array<Scalar, numPhases>& phaseWeights)
+    {
+        groupRateLimit_ = value;
+        groupVolumetricWeight_ = phaseWeights;
+    }
+
+    /*!
+     * \brief Return the share of the well in the target rate of its group [m^3/s].
+     */
+    Scalar groupRateLimit() const
+    { return groupRateLimit_; }
+
+    /*!
+     * \brief Return the absolute value of the weighted surface rate [m^3/s] which the
+     *        well would exhibit at its bottom hole pressure limit.
+     *
+     * The limits of the individual well are taken into account by assuming that the
+     * surface rates of all phases are reduced by the same factor. The group limit is
+     * not considered.
+     *
+     * \param phaseWeights The relative weights of the volumetric surface rates of the
+     *                     phases
+     */
+    Scalar weightedSurfaceRatePotential(const std::array<Scalar, numPhases>& phaseWeights) const
+    {
+        if (wellStatus() != Open || dofVariables_.empty())
+            return 0.0;
+
+        std::array<Scalar, numPhases> resvRates;
+        std::array<Scalar, numPhases> surfaceRates;
+        computeOverallRates_(targetBottomHolePressure_, resvRates, surfaceRates);
+
+        Scalar potential = 0.0;
+        for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++phaseIdx) {
+            if (FluidSystem::phaseIsActive(phaseIdx))
+                potential += phaseWeights[phaseIdx]*surfaceRates[phaseIdx];
+        }
+        potential = std::abs(potential);
+
+        Scalar wellSurfaceRate = std::abs(computeWeightedRate_(surfaceRates));
+        if (wellSurfaceRate > maximumSurfaceRate_)
+            potential *= maximumSurfaceRate_/wellSurfaceRate;
+
+        Scalar wellResvRate = std::abs(computeWeightedRate_(resvRates));
+        if (wellResvRate > maximumReservoirRate_)
+            potential *= maximumReservoirRate_/wellResvRate;
+
+        return potential;
+    }
+
     /*!
      * \brief Return the reservoir rate [m^3/s] actually seen by the well in the current time
      *        step.
@@ -915,16 +1005,17 @@ public:
     void setSkinFactor(const Context& context, unsigned dofIdx, Scalar value)
     {
         unsigned globalDofIdx = context.globalSpaceIndex(dofIdx, /*timeIdx=*/0);
-        dofVariables_[globalDofIdx].skinFactor = value;
+        DofVariables& dofVars = perforation_(globalDofIdx);
+        dofVars.skinFactor = value;
 
-        computeConnectionTransmissibilityFactor_(globalDofIdx);
+        computeConnectionTransmissibilityFactor_(dofVars);
     }
 
     /*!
      * \brief Return the well's skin factor at a DOF [-].
      */
     Scalar skinFactor(unsigned gridDofIdx) const
-    { return dofVariables_.at(gridDofIdx).skinFactor_; }
+    { return perforation_(gridDofIdx).skinFactor; }
 
     /*!
      * \brief Set the borehole radius of the well
@@ -937,16 +1028,17 @@ public:
     void setRadius(const Context& context, unsigned dofIdx, Scalar value)
     {
         unsigned globalDofIdx = context.globalSpaceIndex(dofIdx, /*timeIdx=*/0);
-        dofVariables_[globalDofIdx]->boreholeRadius = value;
+        DofVariables& dofVars = perforation_(globalDofIdx);
+        dofVars.boreholeRadius = value;
 
-        computeConnectionTransmissibilityFactor_(globalDofIdx);
+        computeConnectionTransmissibilityFactor_(dofVars);
     }
 
     /*!
      * \brief Return the well's radius at a cell [m].
      */
     Scalar radius(unsigned gridDofIdx) const
-    { return dofVariables_.at(gridDofIdx)->radius_; }
+    { return perforation_(gridDofIdx).boreholeRadius; }
 
     /*!
      * \brief Informs the well that a time step has just begun.
@@ -1006,18 +1098,32 @@ public:
             return;
 
         for (unsigned dofIdx = 0; dofIdx < context.numPrimaryDof(timeIdx); ++dofIdx) {
-            unsigned globalDofIdx = context.globalSpaceIndex(dofIdx, timeIdx);
-            if (!applies(globalDofIdx))
+            int perfIdx = perforationIndex(context.globalSpaceIndex(dofIdx, timeIdx));
+            if (perfIdx < 0)
                 continue;
 
-            DofVariables& dofVars = *dofVariables_.at(globalDofIdx);
-            const auto& intQuants = context.intensiveQuantities(dofIdx, timeIdx);
+            beginIterationAccumulatePerforation(static_cast<unsigned>(perfIdx),
+                                                context.intensiveQuantities(dofIdx, timeIdx));
+        }
+    }
+
+    /*!
+     * \brief Do the DOF specific part at the beginning of each iteration for a single
+     *        perforation of the well.
+     *
+     * This is the same as beginIterationAccumulate() but it avoids to search for the
+     * perforations of the DOFs of the context.
+     */
+    void beginIterationAccumulatePerforation(unsigned perfIdx, const IntensiveQuantities& intQuants)
+    {
+        if (wellStatus() == Shut)
+            return;
 
-            if (iterationIdx_ == 0)
-                dofVars.updateBeginTimestep(intQuants);
+        DofVariables& dofVars = dofVariables_[perfIdx];
+        if (iterationIdx_ == 0)
+            dofVars.updateBeginTimestep(intQuants);
 
-            dofVars.update(intQuants);
-        }
+        dofVars.update(intQuants);
     }
 
     /*!
@@ -1031,14 +1137,18 @@ public:
         if (wellStatus() == Shut)
             return;
 
-        auto& sol = const_cast<SolutionVector&>(simulator_.model().solution(/*timeIdx=*/0));
-        int wellGlobalDof = AuxModule::localToGlobalDof(/*localDofIdx=*/0);
-
-        // retrieve the bottom hole pressure from the global system of equations
-        actualBottomHolePressure_ = Toolbox::value(dofVariables_.begin()->second->pressure[0]);
+        // retrieve the bottom hole pressure from the global system of equations. if the
+        // well equation is eliminated, the value which has been recovered after the last
+        // linear solve is used as the initial guess instead.
+        if (!eliminateEquations_ || !eliminatedLinearizationValid_)
+            actualBottomHolePressure_ = Toolbox::value(dofVariables_[0].pressure[0]);
         actualBottomHolePressure_ = computeRateEquivalentBhp_();
 
-        sol[wellGlobalDof][0] = actualBottomHolePressure_;
+        if (!eliminateEquations_) {
+            auto& sol = const_cast<SolutionVector&>(simulator_.model().solution(/*timeIdx=*/0));
+            int wellGlobalDof = AuxModule::localToGlobalDof(/*localDofIdx=*/0);
+            sol[wellGlobalDof][0] = actualBottomHolePressure_;
+        }
 
         computeOverallRates_(actualBottomHolePressure_,
                              actualResvRates_,
@@ -1109,12 +1219,34 @@ public:
     {
         q = 0.0;
 
-        unsigned globalDofIdx = context.globalSpaceIndex(dofIdx, timeIdx);
-        if (wellStatus() == Shut || !applies(globalDofIdx))
+        if (wellStatus() == Shut)
+            return;
+
+        int perfIdx = perforationIndex(context.globalSpaceIndex(dofIdx, timeIdx));
+        if (perfIdx < 0)
+            return;
+
+        computeTotalRatesForPerforation(q, static_cast<unsigned>(perfIdx), context, dofIdx, timeIdx);
+    }
+
+    /*!
+     * \brief Computes the source term for a degree of freedom given the index of the
+     *        perforation of the well which corresponds to it.
+     */
+    template <class Context>
+    void computeTotalRatesForPerforation(RateVector& q,
+                                         unsigned perfIdx,
+                                         const Context& context,
+                                         unsigned dofIdx,
+                                         unsigned timeIdx) const
+    {
+        q = 0.0;
+
+        if (wellStatus() == Shut)
             return;
 
         // create a DofVariables object for the current evaluation point
-        DofVariables tmp(*dofVariables_.at(globalDofIdx));
+        DofVariables tmp(dofVariables_[perfIdx]);
 
         tmp.update(context.intensiveQuantities(dofIdx, timeIdx));
 
@@ -1136,13 +1268,271 @@ public:
         Opm::Valgrind::CheckDefined(q);
     }
 
+    /*!
+     * \brief Add the derivatives of a function of the bottom hole pressure and of the
+     *        surface rates of the well w.r.t. the primary variables to a sparse vector.
+     *
+     * The partial derivatives of the function are given by an automatic
+     * differentiation object: Its derivative 0 is the one w.r.t. the bottom hole
+     * pressure and the derivative 1 + phaseIdx the one w.r.t. the surface rate of a
+     * phase. The chain rule is then applied using the quantities of the perforated
+     * degrees of freedom which have been gathered for the last Newton-Raphson
+     * iteration, so the grid does not need to be visited again. The results are
+     * appended as (global DOF index, derivatives) pairs, i.e., in the layout of the
+     * residual assembled by the linearizer.
+     *
+     * If the well equation is eliminated from the global system, the bottom hole
+     * pressure is not a primary variable and its dependence on the grid DOFs would
+     * need to be considered via the Schur complement. This is not implemented, so an
+     * exception is thrown in this case.
+     */
+    template <class ObjectiveEval>
+    void addObjectiveGradient(std::vector<std::pair<unsigned, EqVector> >& gradient,
+                              const ObjectiveEval& objective) const
+    {
+        if (wellStatus() == Shut)
+            return;
+
+        if (eliminateEquations_)
+            OPM_THROW(Opm::NotImplemented,
+                      "The gradient of objective functions is not available for well '"
+                      << name() << "' because its equation is eliminated from the "
+                      "global system");
+
+        BhpEval bhpEval(actualBottomHolePressure_);
+        bhpEval.setDerivative(0, 1.0);
+
+        Scalar bhpDerivative = objective.derivative(0);
+        for (unsigned perfIdx = 0; perfIdx < dofVariables_.size(); ++ perfIdx) {
+            const auto& dofVars = dofVariables_[perfIdx];
+
+            // derivatives of the surface rates of the perforation w.r.t. the primary
+            // variables of the perforated DOF
+            std::array<Evaluation, numPhases> resvRates;
+            std::array<Evaluation, numPhases> surfaceRates;
+            for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++phaseIdx)
+                surfaceRates[phaseIdx] = 0.0;
+            computeVolumetricDofRates_<Evaluation, Scalar>(resvRates, actualBottomHolePressure_, dofVars);
+            computeSurfaceRates_<Evaluation, Evaluation>(surfaceRates, resvRates, dofVars);
+
+            Evaluation perfObjective = 0.0;
+            for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++phaseIdx) {
+                if (!FluidSystem::phaseIsActive(phaseIdx))
+                    continue;
+
+                perfObjective += surfaceRates[phaseIdx]*objective.derivative(1 + phaseIdx);
+            }
+
+            EqVector dofGradient;
+            for (unsigned pvIdx = 0; pvIdx < numModelEq; ++pvIdx)
+                dofGradient[pvIdx] = perfObjective.derivative(pvIdx);
+            gradient.push_back(std::make_pair(dofVars.gridDofIdx, dofGradient));
+
+            // derivatives of the surface rates of the perforation w.r.t. the bottom hole
+            // pressure
+            std::array<BhpEval, numPhases> bhpResvRates;
+            std::array<BhpEval, numPhases> bhpSurfaceRates;
+            for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++phaseIdx)
+                bhpSurfaceRates[phaseIdx] = 0.0;
+            computeVolumetricDofRates_(bhpResvRates, bhpEval, dofVars);
+            computeSurfaceRates_(bhpSurfaceRates, bhpResvRates, dofVars);
+            for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++phaseIdx) {
+                if (!FluidSystem::phaseIsActive(phaseIdx))
+                    continue;
+
+                bhpDerivative +=
+                    bhpSurfaceRates[phaseIdx].derivative(0)*objective.derivative(1 + phaseIdx);
+            }
+        }
+
+        EqVector wellGradient(0.0);
+        wellGradient[0] = bhpDerivative;
+        unsigned wellGlobalDofIdx =
+            static_cast<unsigned>(AuxModule::localToGlobalDof(/*localDofIdx=*/0));
+        gradient.push_back(std::make_pair(wellGlobalDofIdx, wellGradient));
+    }
+
 protected:
+    // computes the derivatives of the well equation w.r.t. the primary variables of a
+    // perforated DOF and the derivatives of the residual of the DOF w.r.t. the bottom
+    // hole pressure
+    void linearizePerforation_(EqVector& wellDerivatives,
+                               EqVector& sourceDerivatives,
+                               ElementContext& elemCtx,
+                               unsigned perfIdx,
+                               const BhpEval& bhpEval,
+                               bool computeWellDerivatives) const
+    {
+        const SolutionVector& curSol = simulator_.model().solution(/*timeIdx=*/0);
+        const auto& dofVars = dofVariables_[perfIdx];
+        const auto& priVars = curSol[dofVars.gridDofIdx];
+
+        // the intensive quantities of the DOF are evaluated using automatic
+        // differentiation, i.e., their derivatives are w.r.t. the DOF's primary
+        // variables
+#if DUNE_VERSION_NEWER(DUNE_GRID, 2, 4)
+        elemCtx.updateStencil( dofVars.element );
+#else
+        elemCtx.updateStencil( *dofVars.element );
+#endif
+        elemCtx.updateIntensiveQuantities(priVars, dofVars.localDofIdx, /*timeIdx=*/0);
+        const auto& intQuants = elemCtx.intensiveQuantities(dofVars.localDofIdx, /*timeIdx=*/0);
+
+        if (computeWellDerivatives) {
+            DofVariables tmpDofVars(dofVars);
+            tmpDofVars.update(intQuants);
+
+            const Evaluation& wellEq =
+                wellResidual_<Scalar, Evaluation>(actualBottomHolePressure_, &tmpDofVars, perfIdx);
+            for (unsigned priVarIdx = 0; priVarIdx < numModelEq; ++priVarIdx)
+                wellDerivatives[priVarIdx] = wellEq.derivative(priVarIdx);
+        }
+
+        // the source term is linear in the reservoir rates, so its derivative w.r.t. the
+        // bottom hole pressure is the source term of the derivatives of the reservoir
+        // rates
+        RateVector q(0.0);
+        RateVector modelRate;
+        std::array<BhpEval, numPhases> resvRates;
+
+        const auto& fluidState = intQuants.fluidState();
+        computeVolumetricDofRates_(resvRates, bhpEval, dofVars);
+        for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++phaseIdx) {
+            if (!FluidSystem::phaseIsActive(phaseIdx))
+                continue;
+
+            modelRate.setVolumetricRate(fluidState, phaseIdx, resvRates[phaseIdx].derivative(0));
+            for (unsigned compIdx = 0; compIdx < numComponents; ++compIdx)
+                q[compIdx] += modelRate[compIdx];
+        }
+
+        // This is a bit hacky because it assumes that the model uses a mass rate for
+        // each component as its first conservation equation, but we require the
+        // black-oil model for now anyway, so this should not be too much of a
+        // problem...
+        Opm::Valgrind::CheckDefined(q);
+        for (unsigned eqIdx = 0; eqIdx < numModelEq; ++ eqIdx)
+            sourceDerivatives[eqIdx] = - Toolbox::value(q[eqIdx])/dofVars.totalVolume;
+    }
+
+    // evaluate the well equation and the derivatives of the well equation and of the
+    // source terms of all perforations. this does not modify any object which is shared
+    // with other wells.
+    void evaluatePerforations_(bool computeWellDerivatives)
+    {
+        perforationsEvaluated_ = false;
+        if (wellStatus() == Shut)
+            return;
+
+        BhpEval bhpEval(actualBottomHolePressure_);
+        bhpEval.setDerivative(0, 1.0);
+        evaluatedWellResidual_ = wellResidual_<BhpEval>(bhpEval);
+
+        size_t numPerfs = dofVariables_.size();
+        perfWellDerivatives_.resize(numPerfs);
+        perfSourceDerivatives_.resize(numPerfs);
+
+        ElementContext elemCtx(simulator_);
+        for (unsigned perfIdx = 0; perfIdx < numPerfs; ++ perfIdx)
+            linearizePerforation_(perfWellDerivatives_[perfIdx],
+                                  perfSourceDerivatives_[perfIdx],
+                                  elemCtx,
+                                  perfIdx,
+                                  bhpEval,
+                                  computeWellDerivatives);
+
+        perforationsEvaluated_ = true;
+        perfWellDerivativesEvaluated_ = computeWellDerivatives;
+    }
+
+    // add the Schur complement of the well equation to the linear system of the grid. if
+    // no matrix is given, only the residual is updated.
+    void linearizeEliminated_(JacobianMatrix* matrix, GlobalEqVector& residual)
+    {
+        if (matrix)
+            eliminatedLinearizationValid_ = false;
+
+        if (wellStatus() == Shut)
+            // the well does not affect the reservoir
+            return;
+
+        bool computeWellDerivatives = (matrix != nullptr);
+        if (!perforationsEvaluated_
+            || (computeWellDerivatives && !perfWellDerivativesEvaluated_))
+            evaluatePerforations_(computeWellDerivatives);
+        perforationsEvaluated_ = false;
+
+        const BhpEval& wellResid = evaluatedWellResidual_;
+        if (wellResid.derivative(0) == 0.0)
+            // the well equation does not depend on the bottom hole pressure, so it
+            // cannot be eliminated. since the bottom hole pressure is determined anew at
+            // the beginning of each iteration, the well is simply ignored here.
+            return;
+
+        Scalar inverseDiagonal = 1.0/wellResid.derivative(0);
+        Scalar wellResidual = wellResid.value();
+
+        auto& schurCorrection =
+            const_cast<Simulator&>(simulator_).model().linearizer().schurCorrection();
+        if (matrix) {
+            schurCorrection.addUnknown(inverseDiagonal);
+            eliminatedWellDerivatives_.resize(dofVariables_.size());
+        }
+
+        for (unsigned perfIdx = 0; perfIdx < dofVariables_.size(); ++ perfIdx) {
+            unsigned gridDofIdx = dofVariables_[perfIdx].gridDofIdx;
+            const EqVector& wellDerivatives = perfWellDerivatives_[perfIdx];
+            const EqVector& sourceDerivatives = perfSourceDerivatives_[perfIdx];
+
+            // r - c d^-1 r_w
+            for (unsigned eqIdx = 0; eqIdx < numModelEq; ++ eqIdx)
+                residual[gridDofIdx][eqIdx] -=
+                    sourceDerivatives[eqIdx]*inverseDiagonal*wellResidual;
+
+            if (!matrix)
+                continue;
+
+            // the diagonal part of the complement is added to the matrix, the remaining
+            // couplings are applied by the linear solver
+            auto& diagBlock = (*matrix)[gridDofIdx][gridDofIdx];
+            for (unsigned eqIdx = 0; eqIdx < numModelEq; ++ eqIdx)
+                for (unsigned pvIdx = 0; pvIdx < numModelEq; ++ pvIdx)
+                    diagBlock[eqIdx][pvIdx] -=
+                        sourceDerivatives[eqIdx]*inverseDiagonal*wellDerivatives[pvIdx];
+
+            schurCorrection.addCoupling(gridDofIdx, sourceDerivatives, wellDerivatives);
+            eliminatedWellDerivatives_[perfIdx] = wellDerivatives;
+        }
+
+        if (matrix) {
+            eliminatedInverseDiagonal_ = inverseDiagonal;
+            eliminatedResidual_ = wellResidual;
+            eliminatedLinearizationValid_ = true;
+        }
+    }
+
+    // returns the quantities of the perforation of a DOF of the grid. this is only
+    // used to specify the well, so the linear search does not matter much.
+    DofVariables& perforation_(unsigned globalDofIdx)
+    { return dofVariables_[checkedPerforationIndex_(globalDofIdx)]; }
+
+    const DofVariables& perforation_(unsigned globalDofIdx) const
+    { return dofVariables_[checkedPerforationIndex_(globalDofIdx)]; }
+
+    unsigned checkedPerforationIndex_(unsigned globalDofIdx) const
+    {
+        int perfIdx = perforationIndex(globalDofIdx);
+        if (perfIdx < 0)
+            OPM_THROW(std::logic_error,
+                      "Degree of freedom " << globalDofIdx << " is not perforated by well "
+                      << name());
+        return static_cast<unsigned>(perfIdx);
+    }
+
     // compute the connection transmissibility factor based on the effective permeability
     // of a connection, the radius of the borehole and the skin factor.
-    void computeConnectionTransmissibilityFactor_(unsigned globalDofIdx)
+    void computeConnectionTransmissibilityFactor_(DofVariables& dofVars)
     {
-        auto& dofVars = *dofVariables_[globalDofIdx];
-
         const auto& D = dofVars.effectiveSize;
         const auto& K = dofVars.permeability;
         Scalar Kh = dofVars.effectivePermeability;
@@ -1167,15 +1557,18 @@ protected:
         dofVars.connectionTransmissibilityFactor = exposureFactor*Kh/(std::log(r0 / rWell) + S);
     }
 
-    template <class ResultEval, class BhpEval>
+    // unless it is explicitly specified, the quantities of the DOF are considered
+    // only if the bottom hole pressure is constant
+    template <class ResultEval,
+              class BhpEval,
+              class DofEval = typename std::conditional<std::is_same<BhpEval, Scalar>::value,
+                                                        ResultEval,
+                                                        Scalar>::type>
     void computeVolumetricDofRates_(std::array<ResultEval, numPhases>& volRates,
                                     const BhpEval& bottomHolePressure,
                                     const DofVariables& dofVars) const
     {
         typedef Opm::MathToolbox<Evaluation> DofVarsToolbox;
-        typedef typename std::conditional<std::is_same<BhpEval, Scalar>::value,
-                                          ResultEval,
-                                          Scalar>::type DofEval;
         for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++phaseIdx)
             volRates[phaseIdx] = 0.0;
 
@@ -1270,13 +1663,16 @@ protected:
      * \brief Convert volumetric reservoir rates into volumetric volume rates.
      *
      * This requires the density and composition of the phases and
-     * thus the applicable fluid state.
+     * thus the applicable fluid state. The derivatives of these quantities are only
+     * considered if DofEval is not Scalar.
      */
-    template <class Eval>
+    template <class Eval, class DofEval = Scalar>
     void computeSurfaceRates_(std::array<Eval, numPhases>& surfaceRates,
                               const std::array<Eval, numPhases>& reservoirRate,
                               const DofVariables& dofVars) const
     {
+        typedef Opm::MathToolbox<Evaluation> DofVarsToolbox;
+
         // the array for the surface rates and the one for the reservoir rates must not
         // be the same!
         assert(&surfaceRates != &reservoirRate);
@@ -1294,14 +1690,14 @@ protected:
             surfaceRates[oilPhaseIdx] =
                 // oil in gas phase
                 reservoirRate[gasPhaseIdx]
-                * Toolbox::value(dofVars.density[gasPhaseIdx])
-                * Toolbox::value(dofVars.gasMassFraction[oilCompIdx])
+                * DofVarsToolbox::template decay<DofEval>(dofVars.density[gasPhaseIdx])
+                * DofVarsToolbox::template decay<DofEval>(dofVars.gasMassFraction[oilCompIdx])
                 / rhoOilSurface
                 +
                 // oil in oil phase
                 reservoirRate[oilPhaseIdx]
-                * Toolbox::value(dofVars.density[oilPhaseIdx])
-                * Toolbox::value(dofVars.oilMassFraction[oilCompIdx])
+                * DofVarsToolbox::template decay<DofEval>(dofVars.density[oilPhaseIdx])
+                * DofVarsToolbox::template decay<DofEval>(dofVars.oilMassFraction[oilCompIdx])
                 / rhoOilSurface;
 
         // gas
@@ -1309,21 +1705,21 @@ protected:
             surfaceRates[gasPhaseIdx] =
                 // gas in gas phase
                 reservoirRate[gasPhaseIdx]
-                * Toolbox::value(dofVars.density[gasPhaseIdx])
-                * Toolbox::value(dofVars.gasMassFraction[gasCompIdx])
+                * DofVarsToolbox::template decay<DofEval>(dofVars.density[gasPhaseIdx])
+                * DofVarsToolbox::template decay<DofEval>(dofVars.gasMassFraction[gasCompIdx])
                 / rhoGasSurface
                 +
                 // gas in oil phase
                 reservoirRate[oilPhaseIdx]
-                * Toolbox::value(dofVars.density[oilPhaseIdx])
-                * Toolbox::value(dofVars.oilMassFraction[gasCompIdx])
+                * DofVarsToolbox::template decay<DofEval>(dofVars.density[oilPhaseIdx])
+                * DofVarsToolbox::template decay<DofEval>(dofVars.oilMassFraction[gasCompIdx])
                 / rhoGasSurface;
 
         // water
         if (FluidSystem::phaseIsActive(waterPhaseIdx))
             surfaceRates[waterPhaseIdx] =
                 reservoirRate[waterPhaseIdx]
-                * Toolbox::value(dofVars.density[waterPhaseIdx])
+                * DofVarsToolbox::template decay<DofEval>(dofVars.density[waterPhaseIdx])
                 / rhoWaterSurface;
     }
 
@@ -1345,15 +1741,11 @@ protected:
             overallSurfaceRates[phaseIdx] = 0.0;
         }
 
-        auto dofVarsIt = dofVariables_.begin();
-        const auto& dofVarsEndIt = dofVariables_.end();
-        for (; dofVarsIt != dofVarsEndIt; ++ dofVarsIt) {
+        for (unsigned perfIdx = 0; perfIdx < dofVariables_.size(); ++ perfIdx) {
             std::array<Scalar, numPhases> volumetricReservoirRates;
-            const DofVariables *tmp;
-            if (dofVarsIt->first == globalEvalDofIdx)
+            const DofVariables *tmp = &dofVariables_[perfIdx];
+            if (static_cast<int>(tmp->gridDofIdx) == globalEvalDofIdx)
                 tmp = evalDofVars;
-            else
-                tmp = dofVarsIt->second;
 
             computeVolumetricDofRates_<Scalar, Scalar>(volumetricReservoirRates, bottomHolePressure, *tmp);
 
@@ -1385,7 +1777,8 @@ protected:
                                               int globalEvalDofIdx) const
 
     {
-        static std::array<Scalar, numPhases> resvRatesDummy;
+        // the scratch objects must not be static: the wells are handled concurrently
+        std::array<Scalar, numPhases> resvRatesDummy;
         computeOverallRates_(bottomHolePressure,
                              overallSurfaceRates,
                              resvRatesDummy,
@@ -1401,7 +1794,7 @@ protected:
     {
         // create a dummy DofVariables object and call the method above using an index
         // that is guaranteed to never be part of a well...
-        static DofVariables dummyDofVars;
+        DofVariables dummyDofVars;
         return computeOverallWeightedSurfaceRate_(bottomHolePressure,
                                                   overallSurfaceRates,
                                                   dummyDofVars,
@@ -1468,30 +1861,39 @@ protected:
                   << "' within 20 iterations.");
     }
 
-    template <class BhpEval>
-    BhpEval wellResidual_(const BhpEval& bhp,
-                          const DofVariables *replacementDofVars = 0,
-                          int replacedGridIdx = -1) const
+    // if the result is not a Scalar, its derivatives are either the ones w.r.t. the
+    // bottom hole pressure or, if the bottom hole pressure is a Scalar, the ones of the
+    // quantities of the replaced DOF. (the derivatives of the remaining DOFs are always
+    // ignored because they refer to the primary variables of different DOFs.)
+    template <class BhpEval, class ResultEval = BhpEval>
+    ResultEval wellResidual_(const BhpEval& bhp,
+                             const DofVariables *replacementDofVars = 0,
+                             int replacedPerfIdx = -1) const
     {
-        typedef Opm::MathToolbox<BhpEval> BhpEvalToolbox;
+        typedef Opm::MathToolbox<ResultEval> ResultEvalToolbox;
+        typedef typename std::conditional<std::is_same<BhpEval, Scalar>::value,
+                                          ResultEval,
+                                          Scalar>::type ReplacedDofEval;
 
         // compute the volumetric reservoir and surface rates for the complete well
-        BhpEval resvRate = 0.0;
+        ResultEval resvRate = 0.0;
 
-        std::array<BhpEval, numPhases> totalSurfaceRates;
+        std::array<ResultEval, numPhases> totalSurfaceRates;
         std::fill(totalSurfaceRates.begin(), totalSurfaceRates.end(), 0.0);
 
-        auto dofVarsIt = dofVariables_.begin();
-        const auto& dofVarsEndIt = dofVariables_.end();
-        for (; dofVarsIt != dofVarsEndIt; ++ dofVarsIt) {
-            std::array<BhpEval, numPhases> resvRates;
-            const DofVariables *dofVars = dofVarsIt->second;
-            if (replacedGridIdx == dofVarsIt->first)
-                dofVars = replacementDofVars;
-            computeVolumetricDofRates_(resvRates, bhp, *dofVars);
-
-            std::array<BhpEval, numPhases> surfaceRates;
-            computeSurfaceRates_(surfaceRates, resvRates, *dofVars);
+        for (unsigned perfIdx = 0; perfIdx < dofVariables_.size(); ++ perfIdx) {
+            std::array<ResultEval, numPhases> resvRates;
+            std::array<ResultEval, numPhases> surfaceRates;
+            if (replacedPerfIdx == static_cast<int>(perfIdx)) {
+                const DofVariables& dofVars = *replacementDofVars;
+                computeVolumetricDofRates_<ResultEval, BhpEval, ReplacedDofEval>(resvRates, bhp, dofVars);
+                computeSurfaceRates_<ResultEval, ReplacedDofEval>(surfaceRates, resvRates, dofVars);
+            }
+            else {
+                const DofVariables& dofVars = dofVariables_[perfIdx];
+                computeVolumetricDofRates_<ResultEval, BhpEval, Scalar>(resvRates, bhp, dofVars);
+                computeSurfaceRates_<ResultEval, Scalar>(surfaceRates, resvRates, dofVars);
+            }
 
             for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++phaseIdx) {
                 if (!FluidSystem::phaseIsActive(phaseIdx))
@@ -1503,7 +1905,7 @@ protected:
             resvRate += computeWeightedRate_(resvRates);
         }
 
-        BhpEval surfaceRate = computeWeightedRate_(totalSurfaceRates);
+        ResultEval surfaceRate = computeWeightedRate_(totalSurfaceRates);
 
         // compute the residual of well equation. we currently use max(rateMax - rate,
         // bhp - targetBhp) for producers and max(rateMax - rate, bhp - targetBhp) for
@@ -1515,10 +1917,11 @@ protected:
         Opm::Valgrind::CheckDefined(surfaceRate);
         Opm::Valgrind::CheckDefined(resvRate);
 
-        BhpEval result = 1e30;
+        ResultEval result = 1e30;
+        ResultEval bottomHolePressure = bhp;
 
-        BhpEval maxSurfaceRate = maximumSurfaceRate_;
-        BhpEval maxResvRate = maximumReservoirRate_;
+        ResultEval maxSurfaceRate = maximumSurfaceRate_;
+        ResultEval maxResvRate = maximumReservoirRate_;
         if (wellStatus() == Closed) {
             // make the weight of the fluids on the surface equal and require that no
             // fluids are produced on the surface...
@@ -1535,20 +1938,34 @@ protected:
             maxResvRate = 1e30;
         }
 
+        // the share of the well in the target of its group
+        bool hasGroupLimit = wellStatus() != Closed && groupRateLimit_ < 1e100;
+        ResultEval groupRate = 0.0;
+        if (hasGroupLimit) {
+            for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++phaseIdx) {
+                if (FluidSystem::phaseIsActive(phaseIdx))
+                    groupRate += totalSurfaceRates[phaseIdx]*groupVolumetricWeight_[phaseIdx];
+            }
+        }
+
         if (wellType_ == Injector) {
             // for injectors the computed rates are positive and the target BHP is the
             // maximum allowed pressure ...
-            result = BhpEvalToolbox::min(maxSurfaceRate - surfaceRate, result);
-            result = BhpEvalToolbox::min(maxResvRate - resvRate, result);
-            result = BhpEvalToolbox::min(1e-7*(targetBottomHolePressure_ - bhp), result);
+            result = ResultEvalToolbox::min(maxSurfaceRate - surfaceRate, result);
+            result = ResultEvalToolbox::min(maxResvRate - resvRate, result);
+            if (hasGroupLimit)
+                result = ResultEvalToolbox::min(groupRateLimit_ - groupRate, result);
+            result = ResultEvalToolbox::min(1e-7*(targetBottomHolePressure_ - bottomHolePressure), result);
         }
         else {
             assert(wellType_ == Producer);
             // ... for producers the rates are negative and the bottom hole pressure is
             // is the minimum
-            result = BhpEvalToolbox::min(maxSurfaceRate + surfaceRate, result);
-            result = BhpEvalToolbox::min(maxResvRate + resvRate, result);
-            result = BhpEvalToolbox::min(1e-7*(bhp - targetBottomHolePressure_), result);
+            result = ResultEvalToolbox::min(maxSurfaceRate + surfaceRate, result);
+            result = ResultEvalToolbox::min(maxResvRate + resvRate, result);
+            if (hasGroupLimit)
+                result = ResultEvalToolbox::min(groupRateLimit_ + groupRate, result);
+            result = ResultEvalToolbox::min(1e-7*(bottomHolePressure - targetBottomHolePressure_), result);
         }
 
         const Scalar scalingFactor = 1e-3;
@@ -1559,8 +1976,8 @@ protected:
 
     std::string name_;
 
-    std::vector<DofVariables, Ewoms::aligned_allocator<DofVariables, alignof(DofVariables)> > dofVarsStore_;
-    std::map<int, DofVariables*> dofVariables_;
+    // the quantities of the perforations of the well
+    std::vector<DofVariables, Ewoms::aligned_allocator<DofVariables, alignof(DofVariables)> > dofVariables_;
 
     // the number of times beginIteration*() was called for the current time step
     unsigned iterationIdx_;
@@ -1619,6 +2036,11 @@ protected:
     // The relative weight of the volumetric rate of each fluid
     Scalar volumetricWeight_[numPhases];
 
+    // The share of the well in the target of its group and the relative weights of the
+    // volumetric surface rates for the group target
+    Scalar groupRateLimit_;
+    std::array<Scalar, numPhases> groupVolumetricWeight_;
+
     // the reference depth for the bottom hole pressure. if not specified otherwise, this
     // is the position of the _highest_ DOF in the well.
     Scalar refDepth_;
@@ -1631,6 +2053,24 @@ protected:
     mutable FluidState injectionFluidState_;
 
     unsigned injectedPhaseIdx_;
+
+    // specifies whether the well equation is eliminated from the global system of
+    // equations (cf. the EliminateWellEquations parameter)
+    bool eliminateEquations_;
+
+    // the last full linearization of the eliminated well equation, which is required
+    // to update the bottom hole pressure after the linear solve
+    bool eliminatedLinearizationValid_;
+    Scalar eliminatedInverseDiagonal_;
+    Scalar eliminatedResidual_;
+    std::vector<EqVector> eliminatedWellDerivatives_;
+
+    // the quantities evaluated by prepareLinearization() for the next linearization
+    bool perforationsEvaluated_;
+    bool perfWellDerivativesEvaluated_;
+    BhpEval evaluatedWellResidual_;
+    std::vector<EqVector> perfWellDerivatives_;
+    std::vector<EqVector> perfSourceDerivatives_;
 };
 } // namespace Ewoms
 
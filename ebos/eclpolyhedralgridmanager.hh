@@ -28,6 +28,7 @@
 #define EWOMS_ECL_POLYHEDRAL_GRID_MANAGER_HH
 
 #include "eclbasegridmanager.hh"
+#include "eclconforminggridbuilder.hh"
 
 #include <dune/grid/polyhedralgrid.hh>
 
@@ -49,7 +50,8 @@ SET_TYPE_PROP(EclPolyhedralGridManager, EquilGrid, typename GET_PROP_TYPE(TypeTa
  *
  * \brief Helper class for grid instantiation of ECL file-format using problems.
  *
- * This class uses Dune::PolyhedralGrid as the simulation grid.
+ * This class uses Dune::PolyhedralGrid as the simulation grid. If the corner-point grid
+ * of the deck is conforming, the grid is created directly by EclConformingGridBuilder.
  */
 template <class TypeTag>
 class EclPolyhedralGridManager : public EclBaseGridManager<TypeTag>
@@ -80,6 +82,7 @@ public:
     ~EclPolyhedralGridManager()
     {
         delete cartesianIndexMapper_;
+        delete interiorFaces_;
         delete grid_;
     }
 
@@ -141,18 +144,39 @@ public:
     const CartesianIndexMapper& equilCartesianIndexMapper() const
     { return *cartesianIndexMapper_; }
 
+    /*!
+     * \brief Returns the interior faces of the grid if it was created by
+     *        EclConformingGridBuilder.
+     *
+     * Otherwise, a null pointer is returned.
+     */
+    const EclInteriorFaces* interiorFaces() const
+    { return interiorFaces_; }
+
 protected:
     void createGrids_()
     {
         const auto& gridProps = this->eclState().get3DProperties();
         const std::vector<double>& porv = gridProps.getDoubleGridProperty("PORV").getData();
 
-        grid_ = new Grid(this->deck(), porv);
+        // the generic code is only used if the faces of the grid cannot be derived from
+        // its logically Cartesian structure
+        interiorFaces_ = new EclInteriorFaces;
+        UnstructuredGrid* ug =
+            EclConformingGridBuilder::create(this->eclState().getInputGrid(), porv, *interiorFaces_);
+        if (ug)
+            grid_ = new Grid(typename Grid::UnstructuredGridPtr(ug));
+        else {
+            delete interiorFaces_;
+            interiorFaces_ = 0;
+            grid_ = new Grid(this->deck(), porv);
+        }
         cartesianIndexMapper_ = new CartesianIndexMapper(*grid_);
     }
 
     GridPointer grid_;
     CartesianIndexMapperPointer cartesianIndexMapper_;
+    EclInteriorFaces* interiorFaces_;
 };
 
 } // namespace Ewoms
@@ -55,14 +55,19 @@
 #include "eclequilinitializer.hh"
 #include "eclwriter.hh"
 #include "eclsummarywriter.hh"
+#include "eclasyncwriter.hh"
 #include "ecloutputblackoilmodule.hh"
+#include "eclensemblegeometry.hh"
 #include "ecltransmissibility.hh"
 #include "eclthresholdpressure.hh"
+#include "eclparametersensitivities.hh"
 #include "ecldummygradientcalculator.hh"
 #include "eclfluxmodule.hh"
 #include "ecldeckunits.hh"
+#include "ertwrappers.hh"
 
 #include <ewoms/common/pffgridvector.hh>
+#include <ewoms/parallel/threadedentityiterator.hh>
 #include <ewoms/models/blackoil/blackoilmodel.hh>
 #include <ewoms/disc/ecfv/ecfvdiscretization.hh>
 
@@ -91,6 +96,11 @@
 
 #include <vector>
 #include <string>
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <sstream>
 
 namespace Ewoms {
 template <class TypeTag>
@@ -111,9 +121,27 @@ NEW_PROP_TAG(EnableWriteAllSolutions);
 // The number of time steps skipped between writing two consequtive restart files
 NEW_PROP_TAG(RestartWritingInterval);
 
+// Write the ECL restart and summary files on a background thread
+NEW_PROP_TAG(EnableAsyncEclOutput);
+
+// The maximum number of ECL output jobs which may wait for the background thread
+NEW_PROP_TAG(MaxPendingEclWrites);
+
 // Disable well treatment (for users which do this externally)
 NEW_PROP_TAG(DisableWells);
 
+// Eliminate the well equations from the global system of equations instead of adding a
+// degree of freedom for each well
+NEW_PROP_TAG(EliminateWellEquations);
+
+// Store the transmissibilities in a binary file next to the deck and reuse them in
+// subsequent runs of the same deck
+NEW_PROP_TAG(EnableTransmissibilityCache);
+
+// The ECL restart file from which the initial condition is read, and its report step
+NEW_PROP_TAG(EclRestartFileName);
+NEW_PROP_TAG(EclRestartReportStep);
+
 // Enable the additional checks even if compiled in debug mode (i.e., with the NDEBUG
 // macro undefined). Next to a slightly better performance, this also eliminates some
 // print statements in debug mode.
@@ -122,6 +150,10 @@ NEW_PROP_TAG(EnableDebuggingChecks);
 // If this property is set to false, the SWATINIT keyword will not be handled by ebos.
 NEW_PROP_TAG(EnableSwatinit);
 
+// Assemble the derivatives of the residual w.r.t. porosity and transmissibility
+// multipliers alongside the Jacobian matrix
+NEW_PROP_TAG(EnableParameterSensitivities);
+
 // Set the problem property
 SET_TYPE_PROP(EclBaseProblem, Problem, Ewoms::EclProblem<TypeTag>);
 
@@ -216,15 +248,33 @@ SET_STRING_PROP(EclBaseProblem, GridFile, "data/ecl.DATA");
 // between writing restart files
 SET_INT_PROP(EclBaseProblem, RestartWritingInterval, 0xffffff); // disable
 
+// By default, the ECL files are written synchronously. If asynchronous output is
+// enabled, at most two output jobs may be pending at any time.
+SET_BOOL_PROP(EclBaseProblem, EnableAsyncEclOutput, false);
+SET_INT_PROP(EclBaseProblem, MaxPendingEclWrites, 2);
+
 // By default, ebos should handle the wells internally, so we don't disable the well
 // treatment
 SET_BOOL_PROP(EclBaseProblem, DisableWells, false);
 
+// By default, the wells exhibit a degree of freedom in the global system of equations
+SET_BOOL_PROP(EclBaseProblem, EliminateWellEquations, false);
+
+// By default, the transmissibilities are computed from the deck for each run
+SET_BOOL_PROP(EclBaseProblem, EnableTransmissibilityCache, false);
+
+// by default, the initial condition is specified by the deck
+SET_STRING_PROP(EclBaseProblem, EclRestartFileName, "");
+SET_INT_PROP(EclBaseProblem, EclRestartReportStep, 0);
+
 // By default, we enable the debugging checks if we're compiled in debug mode
 SET_BOOL_PROP(EclBaseProblem, EnableDebuggingChecks, true);
 
 // ebos handles the SWATINIT keyword by default
 SET_BOOL_PROP(EclBaseProblem, EnableSwatinit, true);
+
+// the parameter sensitivities are only required for history matching
+SET_BOOL_PROP(EclBaseProblem, EnableParameterSensitivities, false);
 } // namespace Properties
 
 /*!
@@ -267,6 +317,7 @@ class EclProblem : public GET_PROP_TYPE(TypeTag, BaseProblem)
     typedef typename GET_PROP_TYPE(TypeTag, SolutionVector) SolutionVector;
     typedef typename GridView::template Codim<0>::Entity Element;
     typedef typename GET_PROP_TYPE(TypeTag, ElementContext) ElementContext;
+    typedef typename GET_PROP_TYPE(TypeTag, IntensiveQuantities) IntensiveQuantities;
     typedef typename GET_PROP(TypeTag, MaterialLaw)::EclMaterialLawManager EclMaterialLawManager;
     typedef typename GET_PROP_TYPE(TypeTag, DofMapper) DofMapper;
     typedef typename GET_PROP_TYPE(TypeTag, MaterialLaw) MaterialLaw;
@@ -308,6 +359,30 @@ public:
                              "Eclipse simulator");
         EWOMS_REGISTER_PARAM(TypeTag, unsigned, RestartWritingInterval,
                              "The frequencies of which time steps are serialized to disk");
+        EWOMS_REGISTER_PARAM(TypeTag, bool, EnableAsyncEclOutput,
+                             "Write the ECL restart and summary files on a background thread");
+        EWOMS_REGISTER_PARAM(TypeTag, int, MaxPendingEclWrites,
+                             "The maximum number of ECL output jobs which may wait to be "
+                             "written asynchronously");
+        EWOMS_REGISTER_PARAM(TypeTag, bool, EliminateWellEquations,
+                             "Eliminate the well equations from the linear system of "
+                             "equations via a Schur complement which is applied by the "
+                             "linear operator. This keeps the sparsity pattern of the "
+                             "matrix independent of the wells, but requires an iterative "
+                             "linear solver");
+        EWOMS_REGISTER_PARAM(TypeTag, bool, EnableTransmissibilityCache,
+                             "Store the transmissibilities in a binary file next to the "
+                             "deck and reuse them if the same deck is simulated again");
+        EWOMS_REGISTER_PARAM(TypeTag, std::string, EclRestartFileName,
+                             "The name of an ECL restart file (UNRST or Xnnnn) from which "
+                             "the initial condition is read. (empty means the deck is used)");
+        EWOMS_REGISTER_PARAM(TypeTag, int, EclRestartReportStep,
+                             "The report step of the ECL restart file at which the "
+                             "simulation is started");
+        EWOMS_REGISTER_PARAM(TypeTag, bool, EnableParameterSensitivities,
+                             "Assemble the derivatives of the residual w.r.t. multipliers "
+                             "of the porosities and of the transmissibilities whenever "
+                             "the Jacobian matrix is assembled");
     }
 
     /*!
@@ -317,6 +392,7 @@ public:
         : ParentType(simulator)
         , transmissibilities_(simulator.gridManager())
         , thresholdPressures_(simulator)
+        , parameterSensitivities_(simulator)
         , wellManager_(simulator)
         , deckUnits_(simulator)
         , eclWriter_( EWOMS_GET_PARAM(TypeTag, bool, EnableEclOutput)
@@ -325,13 +401,24 @@ public:
         , pffDofData_(simulator.gridView(), this->elementMapper())
     {
         // add the output module for the Ecl binary output
-        simulator.model().addOutputModule(new Ewoms::EclOutputBlackOilModule<TypeTag>(simulator));
+        if (eclWriter_)
+            simulator.model().addOutputModule(new Ewoms::EclOutputBlackOilModule<TypeTag>(simulator));
 
         // Tell the solvent module to initialize its internal data structures
         const auto& gridManager = simulator.gridManager();
         SolventModule::initFromDeck(gridManager.deck(), gridManager.eclState());
         PolymerModule::initFromDeck(gridManager.deck(), gridManager.eclState());
 
+        // the writers only take snapshots of the output data and let the asynchronous
+        // writer pass them to ERT. If it is not enabled, this happens immediately.
+        if (EWOMS_GET_PARAM(TypeTag, bool, EnableAsyncEclOutput)) {
+            int maxPendingWrites = EWOMS_GET_PARAM(TypeTag, int, MaxPendingEclWrites);
+            asyncWriter_.enable(static_cast<unsigned>(std::max(maxPendingWrites, 0)));
+        }
+        if (eclWriter_)
+            eclWriter_->setAsyncWriter(&asyncWriter_);
+        summaryWriter_.setAsyncWriter(&asyncWriter_);
+        summaryWriter_.setObjective(&wellObjective_);
     }
 
     /*!
@@ -355,7 +442,20 @@ public:
         updateElementDepths_();
         readRockParameters_();
         readMaterialParameters_();
-        transmissibilities_.finishInit();
+
+        // the members of an ensemble only compute the geometric part of the
+        // transmissibilities once
+        auto& ensembleGeometry = EclEnsembleGeometry<TypeTag>::instance();
+        if (EWOMS_GET_PARAM(TypeTag, bool, EnableTransmissibilityCache)
+            && !ensembleGeometry.enabled())
+            initTransmissibilitiesFromCache_();
+        else {
+            if (ensembleGeometry.enabled())
+                ensembleGeometry.shareTransmissibilityGeometry(transmissibilities_);
+            transmissibilities_.finishInit();
+        }
+        if (EWOMS_GET_PARAM(TypeTag, bool, EnableParameterSensitivities))
+            parameterSensitivities_.finishInit(transmissibilities_.geometry());
         readInitialCondition_();
 
         // Set the start time of the simulation
@@ -365,8 +465,15 @@ public:
         // We want the episode index to be the same as the report step index to make
         // things simpler, so we have to set the episode index to -1 because it is
         // incremented inside beginEpisode(). The size of the initial time step and
-        // length of the initial episode is set to zero for the same reason.
-        simulator.setEpisodeIndex(-1);
+        // length of the initial episode is set to zero for the same reason. If the
+        // initial condition is read from an ECL restart file, the simulation continues
+        // at its report step.
+        int restartStepIdx = 0;
+        if (!EWOMS_GET_PARAM(TypeTag, std::string, EclRestartFileName).empty())
+            restartStepIdx = EWOMS_GET_PARAM(TypeTag, int, EclRestartReportStep);
+        if (restartStepIdx > 0)
+            simulator.setTime(timeMap.getTimePassedUntil(static_cast<size_t>(restartStepIdx)));
+        simulator.setEpisodeIndex(restartStepIdx - 1);
         simulator.setEpisodeLength(0.0);
         simulator.setTimeStepSize(0.0);
 
@@ -385,6 +492,33 @@ public:
     void prefetch(const Element& elem) const
     { pffDofData_.prefetch(elem); }
 
+    /*!
+     * \copydoc FvBaseProblem::linearizeElement
+     */
+    void linearizeElement(const ElementContext& elemCtx)
+    { parameterSensitivities_.update(elemCtx); }
+
+    /*!
+     * \brief Returns the derivatives of the residual w.r.t. the porosity and
+     *        transmissibility multipliers of the most recent linearization.
+     *
+     * These are only available if the EnableParameterSensitivities parameter is set.
+     */
+    const EclParameterSensitivities<TypeTag>& parameterSensitivities() const
+    { return parameterSensitivities_; }
+
+    /*!
+     * \brief Returns the objective function which depends on the quantities of the
+     *        wells.
+     *
+     * It is evaluated alongside the summary output as soon as a term has been added to
+     * it.
+     */
+    EclWellObjective<TypeTag>& wellObjective()
+    { return wellObjective_; }
+    const EclWellObjective<TypeTag>& wellObjective() const
+    { return wellObjective_; }
+
     /*!
      * \brief This method restores the complete state of the well
      *        from disk.
@@ -411,7 +545,23 @@ public:
      */
     template <class Restarter>
     void serialize(Restarter& res)
-    { wellManager_.serialize(res); }
+    {
+        // make sure that the ECL files are consistent with the restart file
+        asyncWriter_.waitForPendingWrites();
+
+        wellManager_.serialize(res);
+    }
+
+    /*!
+     * \copydoc FvBaseProblem::finalize
+     */
+    void finalize()
+    {
+        // the simulation is only finished when all ECL files have been written
+        asyncWriter_.waitForPendingWrites();
+
+        ParentType::finalize();
+    }
 
     /*!
      * \brief Called by the simulator before an episode begins.
@@ -561,14 +711,6 @@ public:
         }
 
 
-        const auto& A_changed = this->simulator().model().linearizer().matrix();
-        const auto& A = this->simulator().model().linearizer().matrixA();
-
-        //std::cout << " ----------------------------------------------------" << std::endl<< std::endl<< std::endl;
-        //Dune::printmatrix(std::cout, A_changed, "A inserted well ", "row");
-        //std::cout << " ----------------------------------------------------" << std::endl<< std::endl<< std::endl;
-        //Dune::printmatrix(std::cout, A, "A", "row");
-
 
         //
         //updateState(dx,reservoir_state);
@@ -578,10 +720,17 @@ public:
 
 
 
-        // Get the sensitivity w.r.t. the initial state
-        auto tmpSol = this->simulator().model().solution(/*timeIdx=*/0);
-        this->simulator().model().solution(/*timeIdx=*/0) = initialSol_;
-        this->simulator().model().linearizer().linearize();
+        // Get the sensitivity w.r.t. the initial state. if the local linearizer
+        // computes it alongside the Jacobian of the Newton method, matrixA() is already
+        // up to date and we do not need to linearize the whole model a second time.
+        if (!GET_PROP_VALUE(TypeTag, EnableAdjointLinearization)) {
+            auto tmpSol = this->simulator().model().solution(/*timeIdx=*/0);
+            this->simulator().model().solution(/*timeIdx=*/0) = initialSol_;
+            auto& linearizer = this->simulator().model().linearizer();
+            linearizer.setLinearizationType(LinearizationType(/*timeIdx=*/1));
+            linearizer.linearize();
+            linearizer.setLinearizationType(LinearizationType());
+        }
 
 
 
@@ -979,6 +1128,47 @@ public:
              values[Indices::polymerConcentrationIdx] = polymerConcentration_[globalDofIdx];
     }
 
+    /*!
+     * \copydoc FvBaseProblem::initialSolution()
+     *
+     * The initial condition of ECL problems is available for all elements, so the
+     * solution is set in a single loop over the elements.
+     */
+    bool initialSolution(SolutionVector& solution) const
+    {
+        int numDof = static_cast<int>(this->model().numGridDof());
+        if (initialFluidStates_.size() != static_cast<size_t>(numDof))
+            // the fluid states are released by initialSolutionApplied()
+            OPM_THROW(std::logic_error,
+                      "The initial condition of ECL problems can only be applied once");
+
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+        for (int i = 0; i < numDof; ++i) {
+            unsigned globalDofIdx = static_cast<unsigned>(i);
+            auto& values = solution[globalDofIdx];
+
+            values.setPvtRegionIndex(pvtRegionIndex(globalDofIdx));
+
+            if (useMassConservativeInitialCondition_)
+                values.assignMassConservative(initialFluidStates_[globalDofIdx],
+                                              materialLawParams(globalDofIdx));
+            else
+                values.assignNaive(initialFluidStates_[globalDofIdx]);
+
+            if (enableSolvent)
+                values[Indices::solventSaturationIdx] = solventSaturation_[globalDofIdx];
+
+            if (enablePolymer)
+                values[Indices::polymerConcentrationIdx] = polymerConcentration_[globalDofIdx];
+
+            values.checkDefined();
+        }
+
+        return true;
+    }
+
     /*!
      * \copydoc FvBaseProblem::initialSolutionApplied()
      */
@@ -1112,6 +1302,36 @@ private:
         return zz/Scalar(corners);
     }
 
+    // read the transmissibilities from the cache file of the deck if it has been
+    // written for the same input. otherwise compute them and write the cache file.
+    void initTransmissibilitiesFromCache_()
+    {
+        const auto& gridManager = this->simulator().gridManager();
+        const auto& comm = gridManager.gridView().comm();
+
+        // the key is a hash of the contents of the deck file. note that this does not
+        // cover the files which are included by the deck.
+        std::ifstream deckFile(gridManager.deckFileName().c_str(), std::ios::binary);
+        std::ostringstream deckContents;
+        deckContents << deckFile.rdbuf();
+        uint64_t key = std::hash<std::string>()(deckContents.str());
+
+        // the faces depend on the partitioning of the grid, so each process uses its own
+        // file
+        std::ostringstream cacheFileName;
+        cacheFileName << gridManager.deckFileName() << ".trans";
+        if (comm.size() > 1)
+            cacheFileName << "." << comm.rank() << "-" << comm.size();
+
+        if (!transmissibilities_.readCache(cacheFileName.str(), key)) {
+            transmissibilities_.finishInit();
+            transmissibilities_.writeCache(cacheFileName.str(), key);
+        }
+        else if (comm.rank() == 0)
+            std::cout << "Read the transmissibilities from '" << cacheFileName.str() << "'"
+                      << std::endl;
+    }
+
     void updateElementDepths_()
     {
         const auto& gridManager = this->simulator().gridManager();
@@ -1278,6 +1498,34 @@ private:
             assert(dofVolume > 0.0);
             porosity_[dofIdx] = poreVolume/dofVolume;
         }
+
+        updateStaticDofProperties_();
+    }
+
+    // publish the porosities and rock parameters of all elements as flat arrays so
+    // that the intensive quantities do not need to look at the rock tables
+    void updateStaticDofProperties_()
+    {
+        auto& staticProps = this->staticDofProperties();
+        size_t numDof = this->model().numGridDof();
+
+        staticProps.porosity = porosity_;
+        staticProps.rockCompressibility.resize(numDof);
+        staticProps.rockReferencePressure.resize(numDof);
+        for (unsigned dofIdx = 0; dofIdx < numDof; ++dofIdx) {
+            if (rockParams_.empty()) {
+                staticProps.rockCompressibility[dofIdx] = 0.0;
+                staticProps.rockReferencePressure[dofIdx] = 1e5;
+                continue;
+            }
+
+            unsigned tableIdx = 0;
+            if (!rockTableIdx_.empty())
+                tableIdx = rockTableIdx_[dofIdx];
+
+            staticProps.rockCompressibility[dofIdx] = rockParams_[tableIdx].compressibility;
+            staticProps.rockReferencePressure[dofIdx] = rockParams_[tableIdx].referencePressure;
+        }
     }
 
     void initFluidSystem_()
@@ -1293,7 +1541,9 @@ private:
         const auto& gridManager = this->simulator().gridManager();
         const auto& deck = gridManager.deck();
 
-        if (!deck.hasKeyword("EQUIL"))
+        if (!EWOMS_GET_PARAM(TypeTag, std::string, EclRestartFileName).empty())
+            readEclRestartInitialCondition_();
+        else if (!deck.hasKeyword("EQUIL"))
             readExplicitInitialCondition_();
         else
             readEquilInitialCondition_();
@@ -1366,10 +1616,6 @@ private:
                       "The ECL input file requires the RV keyword to be present if"
                       " vaporized oil is enabled");
 
-        size_t numDof = this->model().numGridDof();
-
-        initialFluidStates_.resize(numDof);
-
         const auto& cartSize = this->simulator().gridManager().cartesianDimensions();
         size_t numCartesianCells = cartSize[0] * cartSize[1] * cartSize[2];
 
@@ -1393,6 +1639,97 @@ private:
         std::vector<double> rvData;
         if (FluidSystem::enableVaporizedOil())
             rvData = eclProps.getDoubleGridProperty("RV").getData();
+
+        initFluidStatesFromCartesianData_(waterSaturationData,
+                                          gasSaturationData,
+                                          pressureData,
+                                          rsData,
+                                          rvData);
+    }
+
+    // read the initial condition from a report step of an ECL restart file. only the
+    // values of the local cells are extracted from the file.
+    void readEclRestartInitialCondition_()
+    {
+#if !HAVE_ERT
+        OPM_THROW(std::runtime_error,
+                  "The ERT libraries must be available to read ECL restart files!");
+#else
+        const auto& gridManager = this->simulator().gridManager();
+        const auto& eclGrid = gridManager.eclState().getInputGrid();
+
+        std::string fileName = EWOMS_GET_PARAM(TypeTag, std::string, EclRestartFileName);
+        int reportStepIdx = EWOMS_GET_PARAM(TypeTag, int, EclRestartReportStep);
+        ErtRestartReader restartReader(fileName, reportStepIdx);
+
+        // the values are converted to the same representation as the explicit initial
+        // condition of the deck
+        useMassConservativeInitialCondition_ = (FluidSystem::numActivePhases() == 3);
+
+        const auto& cartSize = gridManager.cartesianDimensions();
+        size_t numCartesianCells = cartSize[0] * cartSize[1] * cartSize[2];
+        size_t numDof = this->model().numGridDof();
+
+        // the position of the local cells in the arrays of the restart file
+        std::vector<int> activeIndex(numDof);
+        for (size_t dofIdx = 0; dofIdx < numDof; ++dofIdx) {
+            size_t cartesianDofIdx = gridManager.cartesianIndex(dofIdx);
+            activeIndex[dofIdx] = eclGrid.activeIndex(cartesianDofIdx);
+        }
+
+        // the restart file uses the unit system of the deck
+        typedef EclDeckUnits<TypeTag> DeckUnits;
+        auto readCartesian = [&](std::vector<double>& cartData,
+                                 const char* name,
+                                 typename DeckUnits::Dimension dimension) {
+            std::vector<double> localData;
+            restartReader.readCellData(localData, name, activeIndex);
+            deckUnits_.deckToSi(localData, dimension);
+            cartData.assign(numCartesianCells, 0.0);
+            for (size_t dofIdx = 0; dofIdx < numDof; ++dofIdx)
+                cartData[gridManager.cartesianIndex(dofIdx)] = localData[dofIdx];
+        };
+
+        std::vector<double> waterSaturationData(numCartesianCells, 0.0);
+        std::vector<double> gasSaturationData(numCartesianCells, 0.0);
+        std::vector<double> pressureData;
+        std::vector<double> rsData;
+        std::vector<double> rvData;
+        if (FluidSystem::phaseIsActive(waterPhaseIdx))
+            readCartesian(waterSaturationData, "SWAT", DeckUnits::saturation);
+        if (FluidSystem::phaseIsActive(gasPhaseIdx))
+            readCartesian(gasSaturationData, "SGAS", DeckUnits::saturation);
+        readCartesian(pressureData, "PRESSURE", DeckUnits::pressure);
+        if (FluidSystem::enableDissolvedGas())
+            readCartesian(rsData, "RS", DeckUnits::gasDissolutionFactor);
+        if (FluidSystem::enableVaporizedOil())
+            readCartesian(rvData, "RV", DeckUnits::oilVaporizationFactor);
+
+        initFluidStatesFromCartesianData_(waterSaturationData,
+                                          gasSaturationData,
+                                          pressureData,
+                                          rsData,
+                                          rvData);
+#endif
+    }
+
+    // compute the initial fluid states from saturations, the oil pressure and the gas
+    // dissolution factors which are given for each cell of the logically Cartesian grid
+    void initFluidStatesFromCartesianData_(const std::vector<double>& waterSaturationData,
+                                           const std::vector<double>& gasSaturationData,
+                                           const std::vector<double>& pressureData,
+                                           const std::vector<double>& rsData,
+                                           const std::vector<double>& rvData)
+    {
+        const auto& gridManager = this->simulator().gridManager();
+        const auto& eclState = gridManager.eclState();
+
+        size_t numDof = this->model().numGridDof();
+        initialFluidStates_.resize(numDof);
+
+        const auto& cartSize = gridManager.cartesianDimensions();
+        size_t numCartesianCells = cartSize[0] * cartSize[1] * cartSize[2];
+
         // initial reservoir temperature
         const std::vector<double>& tempiData =
             eclState.get3DProperties().getDoubleGridProperty("TEMPI").getData();
@@ -1556,40 +1893,58 @@ private:
 
         // we need to update the hysteresis data for _all_ elements (i.e., not just the
         // interior ones) to avoid desynchronization of the processes in the parallel case!
-        ElementContext elemCtx(this->simulator());
-        const auto& gridManager = this->simulator().gridManager();
-        auto elemIt = gridManager.gridView().template begin</*codim=*/0>();
-        const auto& elemEndIt = gridManager.gridView().template end</*codim=*/0>();
-        for (; elemIt != elemEndIt; ++elemIt) {
-            const Element& elem = *elemIt;
-
-            elemCtx.updatePrimaryStencil(elem);
-            elemCtx.updatePrimaryIntensiveQuantities(/*timeIdx=*/0);
+        // the material law manager only modifies the data of the given cell, so the
+        // elements can be processed concurrently.
+        auto updateFn =
+            [this](const IntensiveQuantities& intQuants, unsigned compressedDofIdx) -> void
+            { this->materialLawManager_->updateHysteresis(intQuants.fluidState(), compressedDofIdx); };
+        forEachIntensiveQuantities_(updateFn);
 
-            unsigned compressedDofIdx = elemCtx.globalSpaceIndex(/*spaceIdx=*/0, /*timeIdx=*/0);
-            const auto& intQuants = elemCtx.intensiveQuantities(/*spaceIdx=*/0, /*timeIdx=*/0);
-            materialLawManager_->updateHysteresis(intQuants.fluidState(), compressedDofIdx);
-        }
         return true;
     }
 
     void updateMaxPolymerAdsorption_()
     {
         // we need to update the max polymer adsoption data for all elements
-        ElementContext elemCtx(this->simulator());
-        const auto& gridManager = this->simulator().gridManager();
-        auto elemIt = gridManager.gridView().template begin</*codim=*/0>();
-        const auto& elemEndIt = gridManager.gridView().template end</*codim=*/0>();
-        for (; elemIt != elemEndIt; ++elemIt) {
-            const Element& elem = *elemIt;
-
-            elemCtx.updatePrimaryStencil(elem);
-            elemCtx.updatePrimaryIntensiveQuantities(/*timeIdx=*/0);
+        auto updateFn =
+            [this](const IntensiveQuantities& intQuants, unsigned compressedDofIdx) -> void
+            {
+                Scalar& maxAdsorption = this->maxPolymerAdsorption_[compressedDofIdx];
+                maxAdsorption = std::max(maxAdsorption, Opm::scalarValue(intQuants.polymerAdsorption()));
+            };
+        forEachIntensiveQuantities_(updateFn);
+    }
 
-            unsigned compressedDofIdx = elemCtx.globalSpaceIndex(/*spaceIdx=*/0, /*timeIdx=*/0);
-            const auto& intQuants = elemCtx.intensiveQuantities(/*spaceIdx=*/0, /*timeIdx=*/0);
+    // call a functor with the intensive quantities of the current solution for each
+    // element of the grid. the intensive quantities are taken from the cache of the
+    // model if it is up to date, else they are computed. the functor is called
+    // concurrently for different elements.
+    template <class Functor>
+    void forEachIntensiveQuantities_(Functor& fn)
+    {
+        const auto& model = this->model();
+        ThreadedEntityIterator<GridView, /*codim=*/0> threadedElemIt(this->gridView());
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+        {
+            ElementContext elemCtx(this->simulator());
+            auto elemIt = threadedElemIt.beginParallel();
+            for (; !threadedElemIt.isFinished(elemIt); elemIt = threadedElemIt.increment()) {
+                const Element& elem = *elemIt;
+
+                elemCtx.updatePrimaryStencil(elem);
+                unsigned compressedDofIdx = elemCtx.globalSpaceIndex(/*spaceIdx=*/0, /*timeIdx=*/0);
+
+                const IntensiveQuantities* intQuants =
+                    model.cachedIntensiveQuantities(compressedDofIdx, /*timeIdx=*/0);
+                if (!intQuants) {
+                    elemCtx.updatePrimaryIntensiveQuantities(/*timeIdx=*/0);
+                    intQuants = &elemCtx.intensiveQuantities(/*spaceIdx=*/0, /*timeIdx=*/0);
+                }
 
-            maxPolymerAdsorption_[compressedDofIdx] = std::max(maxPolymerAdsorption_[compressedDofIdx] , Opm::scalarValue(intQuants.polymerAdsorption()));
+                fn(*intQuants, compressedDofIdx);
+            }
         }
     }
 
@@ -1712,6 +2067,7 @@ private:
     std::shared_ptr<EclMaterialLawManager> materialLawManager_;
 
     EclThresholdPressure<TypeTag> thresholdPressures_;
+    EclParameterSensitivities<TypeTag> parameterSensitivities_;
 
     std::vector<int> pvtnum_;
     std::vector<unsigned short> satnum_;
@@ -1736,6 +2092,11 @@ private:
 
     std::unique_ptr< EclWriterType > eclWriter_;
     EclSummaryWriter summaryWriter_;
+    EclWellObjective<TypeTag> wellObjective_;
+
+    // this must be destroyed before the ECL writers because it may still execute
+    // output jobs which use them
+    EclAsyncWriter asyncWriter_;
 
     PffGridVector<GridView, Stencil, PffDofData_, DofMapper> pffDofData_;
 };
@@ -31,6 +31,7 @@
 #include "ertwrappers.hh"
 #include "eclwellmanager.hh"
 #include "ecldeckunits.hh"
+#include "eclasyncwriter.hh"
 
 #include <ewoms/common/propertysystem.hh>
 
@@ -47,6 +48,8 @@
 #include <boost/algorithm/string.hpp>
 
 #include <string>
+#include <vector>
+#include <utility>
 
 namespace Ewoms {
 namespace Properties {
@@ -72,6 +75,7 @@ class EclSummaryWriter
 
     typedef Ewoms::EclWellManager<TypeTag> WellManager;
     typedef Ewoms::ErtSummary<TypeTag> ErtSummary;
+    typedef typename WellManager::RateTable RateTable;
 
 
     struct ErtWellInfo {
@@ -95,6 +99,7 @@ class EclSummaryWriter
     static const unsigned waterPhaseIdx = FluidSystem::waterPhaseIdx;
     static const unsigned gasPhaseIdx = FluidSystem::gasPhaseIdx;
     static const unsigned oilPhaseIdx = FluidSystem::oilPhaseIdx;
+    static const unsigned numPhases = FluidSystem::numPhases;
 
 public:
     EclSummaryWriter(const Simulator& simulator)
@@ -103,6 +108,9 @@ public:
         , ertSummary_(simulator)
 #endif
     {
+        asyncWriter_ = nullptr;
+        objective_ = nullptr;
+
         const auto& deck = simulator.gridManager().deck();
 
         // populate the set of quantities to write
@@ -129,150 +137,185 @@ public:
             reportIdx += 1;
         }
 
-        ErtSummaryTimeStep<TypeTag> ertSumTimeStep(ertSummary_, t, reportIdx);
+        // the values are computed here, but they are passed to ERT by a job which may be
+        // executed while the simulation proceeds
+        SummaryValues values;
 
         typedef EclDeckUnits<TypeTag> DeckUnits;
         const DeckUnits& deckUnits = simulator_.problem().deckUnits();
 
-        // add the well quantities
-        for (unsigned wellIdx = 0; wellIdx < wellsManager.numWells(); ++wellIdx) {
-            const auto& well = wellsManager.well(wellIdx);
-            const auto& summaryInfo = ertWellInfo_.at(well->name());
-
-            if (writeWbhp_()) {
-                Scalar bhpPascal = well->bottomHolePressure();
-                ecl_sum_tstep_iset(ertSumTimeStep.ertHandle(),
-                                   smspec_node_get_params_index(summaryInfo.wbhpErtHandle),
-                                   deckUnits.siToDeck(bhpPascal, DeckUnits::pressure));
-            }
+        // the quantities of all wells are retrieved in a single pass. the values for
+        // the individual summary keywords are then computed keyword by keyword, so
+        // that the set of requested keywords is only queried once per keyword.
+        if (objective_ && !objective_->empty()) {
+            unsigned stepIdx = isInitial ? 0 : static_cast<unsigned>(simulator_.timeStepIndex() + 1);
+            objective_->beginStep(stepIdx, t);
+            wellsManager.computeRateTable(rateTable_, objective_);
+        }
+        else
+            wellsManager.computeRateTable(rateTable_);
+
+        const unsigned numWells = rateTable_.numWells();
+        wellInfo_.resize(numWells);
+        for (unsigned wellIdx = 0; wellIdx < numWells; ++wellIdx)
+            wellInfo_[wellIdx] = &ertWellInfo_.at(wellsManager.well(wellIdx)->name());
+        values.reserve(numWells*summaryKeywords_.size());
+
+        if (writeWbhp_()) {
+            for (unsigned wellIdx = 0; wellIdx < numWells; ++wellIdx)
+                addValue_(values,
+                          wellInfo_[wellIdx]->wbhpErtHandle,
+                          deckUnits.siToDeck(rateTable_.bottomHolePressure(wellIdx),
+                                             DeckUnits::pressure));
+        }
 
-            if (writeWthp_()) {
-                Scalar thpPascal = well->tubingHeadPressure();
-                ecl_sum_tstep_iset(ertSumTimeStep.ertHandle(),
-                                   smspec_node_get_params_index(summaryInfo.wthpErtHandle),
-                                   deckUnits.siToDeck(thpPascal, DeckUnits::pressure));
-            }
+        if (writeWthp_()) {
+            for (unsigned wellIdx = 0; wellIdx < numWells; ++wellIdx)
+                addValue_(values,
+                          wellInfo_[wellIdx]->wthpErtHandle,
+                          deckUnits.siToDeck(rateTable_.tubingHeadPressure(wellIdx),
+                                             DeckUnits::pressure));
+        }
 
-            if (writeWgor_()) {
-                // since I'm usure what the gas-to-oil ratio exactly expresses, I just
-                // assume "volume of gas at standard conditions divided by volume of oil
-                // at standard conditions". Mass-based measures would be drastically
-                // different. (As will be if imperial units are used where the volume of
-                // gas is MCF and the volume of oil is bbl)
-                Scalar gasRate = std::abs(well->surfaceRate(gasPhaseIdx));
-                Scalar oilRate = std::abs(well->surfaceRate(oilPhaseIdx));
+        if (writeWgor_()) {
+            // since I'm usure what the gas-to-oil ratio exactly expresses, I just
+            // assume "volume of gas at standard conditions divided by volume of oil
+            // at standard conditions". Mass-based measures would be drastically
+            // different. (As will be if imperial units are used where the volume of
+            // gas is MCF and the volume of oil is bbl)
+            for (unsigned wellIdx = 0; wellIdx < numWells; ++wellIdx) {
+                Scalar gasRate =
+                    std::abs(rateTable_.phaseValue(RateTable::surfaceRateIdx, wellIdx, gasPhaseIdx));
+                Scalar oilRate =
+                    std::abs(rateTable_.phaseValue(RateTable::surfaceRateIdx, wellIdx, oilPhaseIdx));
 
                 Scalar gasToOilRatio = 0;
                 if (std::abs(oilRate) > 1e-3)
                     gasToOilRatio = gasRate/oilRate;
 
-                ecl_sum_tstep_iset(ertSumTimeStep.ertHandle(),
-                                   smspec_node_get_params_index(summaryInfo.wgorErtHandle),
-                                   deckUnits.siToDeck(gasToOilRatio, DeckUnits::gasOilRatio));
-            }
-
-            //////////
-            // injection surface rates
-            if (writeWwir_()) {
-                Scalar ratePerSecond = std::max<Scalar>(0.0, well->surfaceRate(waterPhaseIdx));
-                ecl_sum_tstep_iset(ertSumTimeStep.ertHandle(),
-                                   smspec_node_get_params_index(summaryInfo.wwirErtHandle),
-                                   deckUnits.siToDeck(ratePerSecond, DeckUnits::liquidRate));
-            }
-
-            if (writeWgir_()) {
-                Scalar ratePerSecond = std::max<Scalar>(0.0, well->surfaceRate(gasPhaseIdx));
-                ecl_sum_tstep_iset(ertSumTimeStep.ertHandle(),
-                                   smspec_node_get_params_index(summaryInfo.wgirErtHandle),
-                                   deckUnits.siToDeck(ratePerSecond, DeckUnits::gasRate));
-            }
-
-            if (writeWoir_()) {
-                Scalar ratePerSecond = std::max<Scalar>(0.0, well->surfaceRate(oilPhaseIdx));
-                ecl_sum_tstep_iset(ertSumTimeStep.ertHandle(),
-                                   smspec_node_get_params_index(summaryInfo.woirErtHandle),
-                                   deckUnits.siToDeck(ratePerSecond, DeckUnits::liquidRate));
-            }
-            //////////
-
-            //////////
-            // total injected surface volume
-            if (writeWwit_()) {
-                Scalar totalVolume = wellsManager.totalInjectedVolume(well->name(), waterPhaseIdx);
-                ecl_sum_tstep_iset(ertSumTimeStep.ertHandle(),
-                                   smspec_node_get_params_index(summaryInfo.wwitErtHandle),
-                                   deckUnits.siToDeck(totalVolume, DeckUnits::liquidSurfaceVolume));
-            }
-
-            if (writeWgit_()) {
-                Scalar totalVolume = wellsManager.totalInjectedVolume(well->name(), gasPhaseIdx);
-                ecl_sum_tstep_iset(ertSumTimeStep.ertHandle(),
-                                   smspec_node_get_params_index(summaryInfo.wgitErtHandle),
-                                   deckUnits.siToDeck(totalVolume, DeckUnits::gasSurfaceVolume));
+                addValue_(values,
+                          wellInfo_[wellIdx]->wgorErtHandle,
+                          deckUnits.siToDeck(gasToOilRatio, DeckUnits::gasOilRatio));
             }
+        }
 
-            if (writeWoit_()) {
-                Scalar totalVolume = wellsManager.totalInjectedVolume(well->name(), oilPhaseIdx);
-                ecl_sum_tstep_iset(ertSumTimeStep.ertHandle(),
-                                   smspec_node_get_params_index(summaryInfo.woitErtHandle),
-                                   deckUnits.siToDeck(totalVolume, DeckUnits::liquidSurfaceVolume));
-            }
-            //////////
-
-            //////////
-            // production surface rates
-            if (writeWwpr_()) {
-                Scalar ratePerSecond = std::max<Scalar>(0.0, -well->surfaceRate(waterPhaseIdx));
-                ecl_sum_tstep_iset(ertSumTimeStep.ertHandle(),
-                                   smspec_node_get_params_index(summaryInfo.wwprErtHandle),
-                                   deckUnits.siToDeck(ratePerSecond, DeckUnits::liquidRate));
-            }
+        //////////
+        // injection surface rates
+        if (writeWwir_())
+            addPhaseValues_(values, &ErtWellInfo::wwirErtHandle, RateTable::surfaceRateIdx,
+                            waterPhaseIdx, /*sign=*/1.0, deckUnits, DeckUnits::liquidRate);
+        if (writeWgir_())
+            addPhaseValues_(values, &ErtWellInfo::wgirErtHandle, RateTable::surfaceRateIdx,
+                            gasPhaseIdx, /*sign=*/1.0, deckUnits, DeckUnits::gasRate);
+        if (writeWoir_())
+            addPhaseValues_(values, &ErtWellInfo::woirErtHandle, RateTable::surfaceRateIdx,
+                            oilPhaseIdx, /*sign=*/1.0, deckUnits, DeckUnits::liquidRate);
+        //////////
+
+        //////////
+        // total injected surface volume
+        if (writeWwit_())
+            addPhaseValues_(values, &ErtWellInfo::wwitErtHandle, RateTable::injectedVolumeIdx,
+                            waterPhaseIdx, /*sign=*/1.0, deckUnits, DeckUnits::liquidSurfaceVolume);
+        if (writeWgit_())
+            addPhaseValues_(values, &ErtWellInfo::wgitErtHandle, RateTable::injectedVolumeIdx,
+                            gasPhaseIdx, /*sign=*/1.0, deckUnits, DeckUnits::gasSurfaceVolume);
+        if (writeWoit_())
+            addPhaseValues_(values, &ErtWellInfo::woitErtHandle, RateTable::injectedVolumeIdx,
+                            oilPhaseIdx, /*sign=*/1.0, deckUnits, DeckUnits::liquidSurfaceVolume);
+        //////////
+
+        //////////
+        // production surface rates
+        if (writeWwpr_())
+            addPhaseValues_(values, &ErtWellInfo::wwprErtHandle, RateTable::surfaceRateIdx,
+                            waterPhaseIdx, /*sign=*/-1.0, deckUnits, DeckUnits::liquidRate);
+        if (writeWgpr_())
+            addPhaseValues_(values, &ErtWellInfo::wgprErtHandle, RateTable::surfaceRateIdx,
+                            gasPhaseIdx, /*sign=*/-1.0, deckUnits, DeckUnits::gasRate);
+        if (writeWopr_())
+            addPhaseValues_(values, &ErtWellInfo::woprErtHandle, RateTable::surfaceRateIdx,
+                            oilPhaseIdx, /*sign=*/-1.0, deckUnits, DeckUnits::liquidRate);
+        //////////
+
+        //////////
+        // total producted surface volume
+        if (writeWwpt_())
+            addPhaseValues_(values, &ErtWellInfo::wwptErtHandle, RateTable::producedVolumeIdx,
+                            waterPhaseIdx, /*sign=*/1.0, deckUnits, DeckUnits::liquidSurfaceVolume);
+        if (writeWgpt_())
+            addPhaseValues_(values, &ErtWellInfo::wgptErtHandle, RateTable::producedVolumeIdx,
+                            gasPhaseIdx, /*sign=*/1.0, deckUnits, DeckUnits::gasSurfaceVolume);
+        if (writeWopt_())
+            addPhaseValues_(values, &ErtWellInfo::woptErtHandle, RateTable::producedVolumeIdx,
+                            oilPhaseIdx, /*sign=*/1.0, deckUnits, DeckUnits::liquidSurfaceVolume);
+        //////////
+
+        ErtSummary* ertSummary = &ertSummary_;
+        auto job = [=]()
+        {
+            ErtSummaryTimeStep<TypeTag> ertSumTimeStep(*ertSummary, t, reportIdx);
+            auto valueIt = values.begin();
+            const auto& valueEndIt = values.end();
+            for (; valueIt != valueEndIt; ++ valueIt)
+                ecl_sum_tstep_iset(ertSumTimeStep.ertHandle(), valueIt->first, valueIt->second);
+
+            // write the _complete_ summary file!
+            ecl_sum_fwrite(ertSummary->ertHandle());
+        };
 
-            if (writeWgpr_()) {
-                Scalar ratePerSecond = std::max<Scalar>(0.0, -well->surfaceRate(gasPhaseIdx));
-                ecl_sum_tstep_iset(ertSumTimeStep.ertHandle(),
-                                   smspec_node_get_params_index(summaryInfo.wgprErtHandle),
-                                   deckUnits.siToDeck(ratePerSecond, DeckUnits::gasRate));
-            }
+        if (asyncWriter_)
+            asyncWriter_->submit(job);
+        else
+            job();
+    }
 
-            if (writeWopr_()) {
-                Scalar ratePerSecond = std::max<Scalar>(0.0, -well->surfaceRate(oilPhaseIdx));
-                ecl_sum_tstep_iset(ertSumTimeStep.ertHandle(),
-                                   smspec_node_get_params_index(summaryInfo.woprErtHandle),
-                                   deckUnits.siToDeck(ratePerSecond, DeckUnits::liquidRate));
-            }
-            //////////
-
-            //////////
-            // total producted surface volume
-            if (writeWwpt_()) {
-                Scalar totalVolume = wellsManager.totalProducedVolume(well->name(), waterPhaseIdx);
-                ecl_sum_tstep_iset(ertSumTimeStep.ertHandle(),
-                                   smspec_node_get_params_index(summaryInfo.wwptErtHandle),
-                                   deckUnits.siToDeck(totalVolume, DeckUnits::liquidSurfaceVolume));
-            }
+    /*!
+     * \brief Write the summary file using a background thread.
+     *
+     * The asynchronous writer must live at least as long as the EclSummaryWriter.
+     * Passing a null pointer switches back to writing synchronously.
+     */
+    void setAsyncWriter(EclAsyncWriter* asyncWriter)
+    { asyncWriter_ = asyncWriter; }
 
-            if (writeWgpt_()) {
-                Scalar totalVolume = wellsManager.totalProducedVolume(well->name(), gasPhaseIdx);
-                ecl_sum_tstep_iset(ertSumTimeStep.ertHandle(),
-                                   smspec_node_get_params_index(summaryInfo.wgptErtHandle),
-                                   deckUnits.siToDeck(totalVolume, DeckUnits::gasSurfaceVolume));
-            }
+    /*!
+     * \brief Evaluate an objective function of the well quantities whenever the summary
+     *        data is computed.
+     *
+     * The objective function must live at least as long as the EclSummaryWriter.
+     * Passing a null pointer disables its evaluation.
+     */
+    void setObjective(EclWellObjective<TypeTag>* objective)
+    { objective_ = objective; }
 
-            if (writeWopt_()) {
-                Scalar totalVolume = wellsManager.totalProducedVolume(well->name(), oilPhaseIdx);
-                ecl_sum_tstep_iset(ertSumTimeStep.ertHandle(),
-                                   smspec_node_get_params_index(summaryInfo.woptErtHandle),
-                                   deckUnits.siToDeck(totalVolume, DeckUnits::liquidSurfaceVolume));
-            }
-            //////////
+private:
+    typedef std::vector<std::pair<int, float> > SummaryValues;
+
+    void addValue_(SummaryValues& values, smspec_node_type* ertHandle, Scalar value) const
+    { values.push_back(std::make_pair(smspec_node_get_params_index(ertHandle), value)); }
+
+    // add a phase quantity of all wells. the value is clamped to be non-negative after
+    // it has been multiplied by the sign, i.e., a sign of -1 selects the production
+    // part of the surface rates.
+    void addPhaseValues_(SummaryValues& values,
+                         smspec_node_type* ErtWellInfo::*ertHandle,
+                         typename RateTable::PhaseQuantity quantityIdx,
+                         unsigned phaseIdx,
+                         Scalar sign,
+                         const EclDeckUnits<TypeTag>& deckUnits,
+                         typename EclDeckUnits<TypeTag>::Dimension dimension) const
+    {
+        const unsigned numWells = rateTable_.numWells();
+        const Scalar* phaseValues = rateTable_.phaseValues(quantityIdx);
+        for (unsigned wellIdx = 0; wellIdx < numWells; ++wellIdx) {
+            Scalar value = std::max<Scalar>(0.0, sign*phaseValues[wellIdx*numPhases + phaseIdx]);
+            addValue_(values,
+                      wellInfo_[wellIdx]->*ertHandle,
+                      deckUnits.siToDeck(value, dimension));
         }
-
-        // write the _complete_ summary file!
-        ecl_sum_fwrite(ertSummary_.ertHandle());
     }
 
-private:
     static bool enableEclSummaryOutput_()
     { return EWOMS_GET_PARAM(TypeTag, bool, EnableEclSummaryOutput); }
 
@@ -538,6 +581,13 @@ private:
     std::set<std::string> summaryKeywords_;
     std::map<std::string, ErtWellInfo> ertWellInfo_;
 
+    // these are only members to avoid re-allocating them for each summary entry
+    RateTable rateTable_;
+    std::vector<const ErtWellInfo*> wellInfo_;
+
+    EclAsyncWriter* asyncWriter_;
+    EclWellObjective<TypeTag>* objective_;
+
 #if HAVE_ERT
     ErtSummary ertSummary_;
 #endif
@@ -29,6 +29,8 @@
 #define EWOMS_ECL_THRESHOLD_PRESSURE_HH
 
 #include <ewoms/common/propertysystem.hh>
+#include <ewoms/parallel/locks.hh>
+#include <ewoms/parallel/threadedentityiterator.hh>
 
 #include <opm/material/densead/Evaluation.hpp>
 #include <opm/material/densead/Math.hpp>
@@ -45,6 +47,7 @@
 #include <dune/grid/common/gridenums.hh>
 #include <dune/common/version.hh>
 
+#include <algorithm>
 #include <array>
 #include <vector>
 #include <unordered_map>
@@ -56,6 +59,7 @@ NEW_PROP_TAG(Scalar);
 NEW_PROP_TAG(Evaluation);
 NEW_PROP_TAG(ElementContext);
 NEW_PROP_TAG(FluidSystem);
+NEW_PROP_TAG(GridView);
 }
 
 /*!
@@ -76,6 +80,8 @@ class EclThresholdPressure
     typedef typename GET_PROP_TYPE(TypeTag, Evaluation) Evaluation;
     typedef typename GET_PROP_TYPE(TypeTag, ElementContext) ElementContext;
     typedef typename GET_PROP_TYPE(TypeTag, FluidSystem) FluidSystem;
+    typedef typename GET_PROP_TYPE(TypeTag, GridView) GridView;
+    typedef typename GridView::template Codim<0>::Entity Element;
 
     enum { numPhases = FluidSystem::numPhases };
 
@@ -164,70 +170,126 @@ private:
     {
         const auto& gridManager = simulator_.gridManager();
         const auto& gridView = gridManager.gridView();
+        const auto& elementMapper = simulator_.model().elementMapper();
 
-        typedef Opm::MathToolbox<Evaluation> Toolbox;
         // loop over the whole grid and compute the maximum gravity adjusted pressure
-        // difference between two EQUIL regions.
-        auto elemIt = gridView.template begin</*codim=*/ 0>();
-        const auto& elemEndIt = gridView.template end</*codim=*/ 0>();
-        ElementContext elemCtx(simulator_);
-        for (; elemIt != elemEndIt; ++elemIt) {
+        // difference between two EQUIL regions. only the elements which exhibit a face
+        // at the boundary of an EQUIL region need to be updated, and these can be
+        // identified using the grid alone.
+        ThreadedEntityIterator<GridView, /*codim=*/0> threadedElemIt(gridView);
+        OmpMutex mergeMutex;
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+        {
+            // Attention: the variables below are thread specific and thus cannot be
+            // moved in front of the #pragma!
+            ElementContext elemCtx(simulator_);
+            std::vector<Scalar> thpresDefault(thpresDefault_.size(), 0.0);
+
+            auto elemIt = threadedElemIt.beginParallel();
+            for (; !threadedElemIt.isFinished(elemIt); elemIt = threadedElemIt.increment()) {
+                const auto& elem = *elemIt;
+                if (elem.partitionType() != Dune::InteriorEntity)
+                    continue;
 
-            const auto& elem = *elemIt;
-            if (elem.partitionType() != Dune::InteriorEntity)
+                if (!isAtEquilRegionBoundary_(elementMapper, elem))
+                    continue;
+
+                elemCtx.updateAll(elem);
+                updateDefaultThresholdPressures_(thpresDefault, elemCtx);
+            }
+
+            ScopedLock lock(mergeMutex);
+            for (unsigned i = 0; i < thpresDefault.size(); ++i)
+                thpresDefault_[i] = std::max(thpresDefault_[i], thpresDefault[i]);
+        }
+
+        // make sure that the threshold pressures is consistent for parallel
+        // runs. (i.e. take the maximum of all processes)
+        for (unsigned i = 0; i < thpresDefault_.size(); ++i)
+            thpresDefault_[i] = gridView.comm().max(thpresDefault_[i]);
+    }
+
+    // returns true if any neighbor of an element is part of a different EQUIL region
+    template <class ElementMapper>
+    bool isAtEquilRegionBoundary_(const ElementMapper& elementMapper, const Element& elem) const
+    {
+        const auto& gridView = simulator_.gridView();
+#if DUNE_VERSION_NEWER(DUNE_COMMON, 2,4)
+        unsigned elemIdx = elementMapper.index(elem);
+#else
+        unsigned elemIdx = elementMapper.map(elem);
+#endif
+        auto isIt = gridView.ibegin(elem);
+        const auto& isEndIt = gridView.iend(elem);
+        for (; isIt != isEndIt; ++ isIt) {
+            const auto& intersection = *isIt;
+            if (!intersection.neighbor())
                 continue;
 
-            elemCtx.updateAll(elem);
-            const auto& stencil = elemCtx.stencil(/*timeIdx=*/0);
+#if DUNE_VERSION_NEWER(DUNE_COMMON, 2,4)
+            unsigned outsideElemIdx = elementMapper.index(intersection.outside());
+#else
+            unsigned outsideElemIdx = elementMapper.map(*intersection.outside());
+#endif
+            if (elemEquilRegion_[elemIdx] != elemEquilRegion_[outsideElemIdx])
+                return true;
+        }
 
-            for (unsigned scvfIdx = 0; scvfIdx < stencil.numInteriorFaces(); ++ scvfIdx) {
-                const auto& face = stencil.interiorFace(scvfIdx);
+        return false;
+    }
 
-                unsigned i = face.interiorIndex();
-                unsigned j = face.exteriorIndex();
+    // update the default threshold pressures using the faces of the element for which
+    // the element context was updated
+    void updateDefaultThresholdPressures_(std::vector<Scalar>& thpresDefault,
+                                          const ElementContext& elemCtx) const
+    {
+        typedef Opm::MathToolbox<Evaluation> Toolbox;
 
-                unsigned insideElemIdx = elemCtx.globalSpaceIndex(i, /*timeIdx=*/0);
-                unsigned outsideElemIdx = elemCtx.globalSpaceIndex(j, /*timeIdx=*/0);
+        const auto& stencil = elemCtx.stencil(/*timeIdx=*/0);
+        for (unsigned scvfIdx = 0; scvfIdx < stencil.numInteriorFaces(); ++ scvfIdx) {
+            const auto& face = stencil.interiorFace(scvfIdx);
 
-                unsigned equilRegionInside = elemEquilRegion_[insideElemIdx];
-                unsigned equilRegionOutside = elemEquilRegion_[outsideElemIdx];
+            unsigned i = face.interiorIndex();
+            unsigned j = face.exteriorIndex();
 
-                if (equilRegionInside == equilRegionOutside)
-                    // the current face is not at the boundary between EQUIL regions!
-                    continue;
+            unsigned insideElemIdx = elemCtx.globalSpaceIndex(i, /*timeIdx=*/0);
+            unsigned outsideElemIdx = elemCtx.globalSpaceIndex(j, /*timeIdx=*/0);
 
-                // don't include connections with negligible flow
-                const Scalar& trans = simulator_.problem().transmissibility(elemCtx, i, j);
-                const Scalar& faceArea = face.area();
-                if ( std::abs(faceArea * trans) < 1e-18)
-                    continue;
+            unsigned equilRegionInside = elemEquilRegion_[insideElemIdx];
+            unsigned equilRegionOutside = elemEquilRegion_[outsideElemIdx];
 
-                // determine the maximum difference of the pressure of any phase over the
-                // intersection
-                Scalar pth = 0.0;
-                const auto& extQuants = elemCtx.extensiveQuantities(scvfIdx, /*timeIdx=*/0);
-                for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++phaseIdx) {
-                    unsigned upIdx = extQuants.upstreamIndex(phaseIdx);
-                    const auto& up = elemCtx.intensiveQuantities(upIdx, /*timeIdx=*/0);
-
-                    if (up.mobility(phaseIdx) > 0.0) {
-                        Scalar phaseVal = Toolbox::value(extQuants.pressureDifference(phaseIdx));
-                        pth = std::max(pth, std::abs(phaseVal));
-                    }
-                }
+            if (equilRegionInside == equilRegionOutside)
+                // the current face is not at the boundary between EQUIL regions!
+                continue;
 
-                int offset1 = equilRegionInside*numEquilRegions_ + equilRegionOutside;
-                int offset2 = equilRegionOutside*numEquilRegions_ + equilRegionInside;
+            // don't include connections with negligible flow
+            const Scalar& trans = simulator_.problem().transmissibility(elemCtx, i, j);
+            const Scalar& faceArea = face.area();
+            if ( std::abs(faceArea * trans) < 1e-18)
+                continue;
 
-                thpresDefault_[offset1] = std::max(thpresDefault_[offset1], pth);
-                thpresDefault_[offset2] = std::max(thpresDefault_[offset2], pth);
+            // determine the maximum difference of the pressure of any phase over the
+            // intersection
+            Scalar pth = 0.0;
+            const auto& extQuants = elemCtx.extensiveQuantities(scvfIdx, /*timeIdx=*/0);
+            for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++phaseIdx) {
+                unsigned upIdx = extQuants.upstreamIndex(phaseIdx);
+                const auto& up = elemCtx.intensiveQuantities(upIdx, /*timeIdx=*/0);
+
+                if (up.mobility(phaseIdx) > 0.0) {
+                    Scalar phaseVal = Toolbox::value(extQuants.pressureDifference(phaseIdx));
+                    pth = std::max(pth, std::abs(phaseVal));
+                }
             }
-        }
 
-        // make sure that the threshold pressures is consistent for parallel
-        // runs. (i.e. take the maximum of all processes)
-        for (unsigned i = 0; i < thpres_.size(); ++i)
-            thpres_[i] = gridView.comm().max(thpres_[i]);
+            int offset1 = equilRegionInside*numEquilRegions_ + equilRegionOutside;
+            int offset2 = equilRegionOutside*numEquilRegions_ + equilRegionInside;
+
+            thpresDefault[offset1] = std::max(thpresDefault[offset1], pth);
+            thpresDefault[offset2] = std::max(thpresDefault[offset2], pth);
+        }
     }
 
     // internalize the threshold pressures which where explicitly specified via the
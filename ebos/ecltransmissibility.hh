@@ -29,7 +29,11 @@
 #define EWOMS_ECL_TRANSMISSIBILITY_HH
 
 
+#include "eclconforminggridbuilder.hh"
+
+#include <ewoms/common/profiler.hh>
 #include <ewoms/common/propertysystem.hh>
+#include <ewoms/parallel/threadedentityiterator.hh>
 
 #include <opm/parser/eclipse/EclipseState/EclipseState.hpp>
 #include <opm/parser/eclipse/EclipseState/Grid/GridProperties.hpp>
@@ -45,8 +49,12 @@
 #include <dune/grid/CpGrid.hpp>
 
 #include <array>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <type_traits>
 #include <vector>
-#include <unordered_map>
 
 namespace Ewoms {
 namespace Properties {
@@ -79,6 +87,58 @@ class EclTransmissibility
     typedef Dune::FieldVector<Scalar, dimWorld> DimVector;
 
 public:
+    /*!
+     * \brief The quantities of an interior face which only depend on the grid.
+     *
+     * The half-transmissibility of an element is given by the permeability of the
+     * element times the scalar product of the face's area normal and the distance
+     * vector from the cell center to the face center, divided by the squared length of
+     * the distance vector.
+     */
+    struct FaceGeometry
+    {
+        unsigned insideElemIdx;
+        unsigned outsideElemIdx;
+        unsigned char insideFaceIdx;
+        unsigned char outsideFaceIdx;
+        Scalar insideNormalDistance;
+        Scalar insideDistanceSquared;
+        Scalar outsideNormalDistance;
+        Scalar outsideDistanceSquared;
+    };
+
+    /*!
+     * \brief The interior faces of the grid and the quantities which only depend on the
+     *        geometry of these faces.
+     *
+     * The faces which are adjacent to an element are stored in compressed row storage
+     * format: For element \f$i\f$, the indices of its neighbors and of the corresponding
+     * faces can be found at the positions \f$[b_i, b_{i+1})\f$ of the neighborIdx and
+     * faceIdx arrays, where \f$b\f$ denotes the rowBegin array. Since this only depends
+     * on the grid, it can be shared by all objects which use the same grid.
+     */
+    struct Geometry
+    {
+        /*!
+         * \brief Returns the index of the face between two elements.
+         *
+         * If the elements are not neighbors, the number of faces is returned.
+         */
+        unsigned faceIndex(unsigned elemIdx1, unsigned elemIdx2) const
+        {
+            unsigned rowEnd = rowBegin[elemIdx1 + 1];
+            for (unsigned i = rowBegin[elemIdx1]; i < rowEnd; ++i)
+                if (neighborIdx[i] == elemIdx2)
+                    return faceIdx[i];
+            return static_cast<unsigned>(faces.size());
+        }
+
+        std::vector<FaceGeometry> faces;
+        std::vector<unsigned> rowBegin;
+        std::vector<unsigned> neighborIdx;
+        std::vector<unsigned> faceIdx;
+    };
+
     EclTransmissibility(const GridManager& gridManager)
         : gridManager_(gridManager)
     {}
@@ -101,180 +161,495 @@ public:
     { update(); }
 
 
+    /*!
+     * \brief Compute the transmissibilities of all faces.
+     *
+     * The geometric part of the half-transmissibilities only depends on the grid, so it
+     * is only computed if it is not yet available. The permeabilities, the net-to-gross
+     * ratios and the multipliers are taken from the current state of the ECL deck.
+     */
     void update()
     {
-        const auto& gridView = gridManager_.gridView();
-        const auto& cartMapper = gridManager_.cartesianIndexMapper();
+        EWOMS_PROFILE_REGION("EclTransmissibility::update");
+
+        if (!geometry_)
+            updateGeometry();
+
         const auto& eclState = gridManager_.eclState();
-        const auto& eclGrid = eclState.getInputGrid();
         auto& transMult = eclState.getTransMult();
-        ElementMapper elemMapper(gridView);
 
         // get the ntg values, the ntg values are modified for the cells merged with minpv
         std::vector<double> ntg;
         minPvFillNtg_(ntg);
 
-        unsigned numElements = elemMapper.size();
-
         extractPermeability_();
 
-        // calculate the axis specific centroids of all elements
+        const auto& faces = geometry_->faces;
+        trans_.resize(faces.size());
+
+        // compute the transmissibilities for all intersections. exceptions must not
+        // leave a parallel region, so invalid faces are only reported after the loop.
+        int numFaces = static_cast<int>(faces.size());
+        bool invalidFaceFound = false;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) reduction(||:invalidFaceFound)
+#endif
+        for (int faceIdx = 0; faceIdx < numFaces; ++faceIdx) {
+            const FaceGeometry& face = faces[static_cast<unsigned>(faceIdx)];
+            unsigned insideElemIdx = face.insideElemIdx;
+            unsigned outsideElemIdx = face.outsideElemIdx;
+            unsigned insideFaceIdx = face.insideFaceIdx;
+            unsigned outsideFaceIdx = face.outsideFaceIdx;
+
+            unsigned insideCartElemIdx = gridManager_.cartesianIndex(insideElemIdx);
+            unsigned outsideCartElemIdx = gridManager_.cartesianIndex(outsideElemIdx);
+
+            Scalar halfTrans1;
+            Scalar halfTrans2;
+
+            computeHalfTrans_(halfTrans1,
+                              insideFaceIdx,
+                              face.insideNormalDistance,
+                              face.insideDistanceSquared,
+                              permeability_[insideElemIdx]);
+            computeHalfTrans_(halfTrans2,
+                              outsideFaceIdx,
+                              face.outsideNormalDistance,
+                              face.outsideDistanceSquared,
+                              permeability_[outsideElemIdx]);
+
+            applyNtg_(halfTrans1, insideFaceIdx, insideCartElemIdx, ntg);
+            applyNtg_(halfTrans2, outsideFaceIdx, outsideCartElemIdx, ntg);
+
+            // convert half transmissibilities to full face
+            // transmissibilities using the harmonic mean
+            Scalar trans;
+            if (std::abs(halfTrans1) < 1e-30 || std::abs(halfTrans2) < 1e-30)
+                // avoid division by zero
+                trans = 0.0;
+            else
+                trans = 1.0 / (1.0/halfTrans1 + 1.0/halfTrans2);
+
+            // apply the full face transmissibility multipliers
+            // for the inside ...
+            applyMultipliers_(trans, insideFaceIdx, insideCartElemIdx, transMult);
+            // ... and outside elements
+            applyMultipliers_(trans, outsideFaceIdx, outsideCartElemIdx, transMult);
+
+            // apply the region multipliers (cf. the MULTREGT keyword)
+            Opm::FaceDir::DirEnum faceDir = Opm::FaceDir::XPlus;
+            switch (insideFaceIdx) {
+            case 0:
+            case 1:
+                faceDir = Opm::FaceDir::XPlus;
+                break;
+
+            case 2:
+            case 3:
+                faceDir = Opm::FaceDir::YPlus;
+                break;
+
+            case 4:
+            case 5:
+                faceDir = Opm::FaceDir::ZPlus;
+                break;
+
+            default:
+                invalidFaceFound = true;
+            }
+
+            trans *= transMult.getRegionMultiplier(insideCartElemIdx,
+                                                   outsideCartElemIdx,
+                                                   faceDir);
+
+            trans_[static_cast<unsigned>(faceIdx)] = trans;
+        }
+
+        if (invalidFaceFound)
+            OPM_THROW(std::logic_error, "Could not determine a face direction");
+    }
+
+    /*!
+     * \brief Compute the parts of the half-transmissibilities which only depend on the
+     *        geometry of the grid.
+     *
+     * The faces are numbered by the index of their inside element, i.e., the numbering
+     * does not depend on the number of threads. If the grid manager already knows the
+     * interior faces of the grid, the intersections of the grid are not visited.
+     */
+    void updateGeometry()
+    {
+        if (const EclInteriorFaces* interiorFaces = gridManager_.interiorFaces()) {
+            updateGeometry_(*interiorFaces);
+            return;
+        }
+
+        const auto& gridView = gridManager_.gridView();
+        const auto& cartMapper = gridManager_.cartesianIndexMapper();
+        const auto& eclGrid = gridManager_.eclState().getInputGrid();
+        ElementMapper elemMapper(gridView);
+
+        unsigned numElements = elemMapper.size();
+
+        // calculate the axis specific centroids of all elements and count the faces for
+        // which each element is the inside element
         std::array<std::vector<DimVector>, dimWorld> axisCentroids;
 
         for (unsigned dimIdx = 0; dimIdx < dimWorld; ++dimIdx)
             axisCentroids[dimIdx].resize(numElements);
 
-        auto elemIt = gridView.template begin</*codim=*/ 0>();
-        const auto& elemEndIt = gridView.template end</*codim=*/ 0>();
-        for (; elemIt != elemEndIt; ++elemIt) {
-            const auto& elem = *elemIt;
+        std::vector<unsigned> elemFaceBegin(numElements + 1, 0);
+
+        ThreadedEntityIterator<GridView, /*codim=*/0> threadedElemIt(gridView);
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+        {
+            auto elemIt = threadedElemIt.beginParallel();
+            for (; !threadedElemIt.isFinished(elemIt); elemIt = threadedElemIt.increment()) {
+                const auto& elem = *elemIt;
 #if DUNE_VERSION_NEWER(DUNE_COMMON, 2,4)
-            unsigned elemIdx = elemMapper.index(elem);
+                unsigned elemIdx = elemMapper.index(elem);
 #else
-            unsigned elemIdx = elemMapper.map(elem);
+                unsigned elemIdx = elemMapper.map(elem);
 #endif
 
-            // compute the axis specific "centroids" used for the transmissibilities. for
-            // consistency with the flow simulator, we use the element centers as
-            // computed by opm-parser's Opm::EclipseGrid class for all axes.
-            unsigned cartesianCellIdx = cartMapper.cartesianIndex(elemIdx);
-            const auto& centroid = eclGrid.getCellCenter(cartesianCellIdx);
-            for (unsigned axisIdx = 0; axisIdx < dimWorld; ++axisIdx)
-                for (unsigned dimIdx = 0; dimIdx < dimWorld; ++dimIdx)
-                    axisCentroids[axisIdx][elemIdx][dimIdx] = centroid[dimIdx];
+                // compute the axis specific "centroids" used for the transmissibilities. for
+                // consistency with the flow simulator, we use the element centers as
+                // computed by opm-parser's Opm::EclipseGrid class for all axes.
+                unsigned cartesianCellIdx = cartMapper.cartesianIndex(elemIdx);
+                const auto& centroid = eclGrid.getCellCenter(cartesianCellIdx);
+                for (unsigned axisIdx = 0; axisIdx < dimWorld; ++axisIdx)
+                    for (unsigned dimIdx = 0; dimIdx < dimWorld; ++dimIdx)
+                        axisCentroids[axisIdx][elemIdx][dimIdx] = centroid[dimIdx];
+
+                unsigned numElemFaces = 0;
+                auto isIt = gridView.ibegin(elem);
+                const auto& isEndIt = gridView.iend(elem);
+                for (; isIt != isEndIt; ++ isIt) {
+                    const auto& intersection = *isIt;
+                    if (intersection.neighbor()
+                        && elemIdx <= outsideElemIndex_(elemMapper, intersection))
+                        ++ numElemFaces;
+                }
+                elemFaceBegin[elemIdx + 1] = numElemFaces;
+            }
         }
 
-        // reserving some space in the hashmap upfront saves quite a bit of time because
-        // resizes are costly for hashmaps and there would be quite a few of them if we
-        // would not have a rough idea of how large the final map will be (the rough idea
-        // is a conforming Cartesian grid).
-        trans_.clear();
-        trans_.reserve(numElements*3*1.05);
-
-        // compute the transmissibilities for all intersections
-        elemIt = gridView.template begin</*codim=*/ 0>();
-        for (; elemIt != elemEndIt; ++elemIt) {
-            const auto& elem = *elemIt;
-            auto isIt = gridView.ibegin(elem);
-            const auto& isEndIt = gridView.iend(elem);
-            for (; isIt != isEndIt; ++ isIt) {
-                // store intersection, this might be costly
-                const auto& intersection = *isIt;
-
-                // ignore boundary intersections for now (TODO?)
-
-                // continue if no neighbor is present
-                if ( ! intersection.neighbor() )
-                    continue;
-
-                const auto& inside = intersection.inside();
-                const auto& outside = intersection.outside();
+        for (unsigned elemIdx = 0; elemIdx < numElements; ++elemIdx)
+            elemFaceBegin[elemIdx + 1] += elemFaceBegin[elemIdx];
+
+        std::shared_ptr<Geometry> geometry(new Geometry);
+        auto& faces = geometry->faces;
+        faces.resize(elemFaceBegin[numElements]);
+
+        // compute the geometric factors for all intersections
+        ThreadedEntityIterator<GridView, /*codim=*/0> threadedElemIt2(gridView);
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+        {
+            auto elemIt = threadedElemIt2.beginParallel();
+            for (; !threadedElemIt2.isFinished(elemIt); elemIt = threadedElemIt2.increment()) {
+                const auto& elem = *elemIt;
 #if DUNE_VERSION_NEWER(DUNE_COMMON, 2,4)
-                unsigned insideElemIdx = elemMapper.index(inside);
-                unsigned outsideElemIdx = elemMapper.index(outside);
+                unsigned insideElemIdx = elemMapper.index(elem);
 #else
-                unsigned insideElemIdx = elemMapper.map(*inside);
-                unsigned outsideElemIdx = elemMapper.map(*outside);
+                unsigned insideElemIdx = elemMapper.map(elem);
 #endif
-
-                // we only need to calculate a face's transmissibility
-                // once...
-                if (insideElemIdx > outsideElemIdx)
-                    continue;
-
-                unsigned insideCartElemIdx = cartMapper.cartesianIndex(insideElemIdx);
-                unsigned outsideCartElemIdx = cartMapper.cartesianIndex(outsideElemIdx);
-
-                // local indices of the faces of the inside and
-                // outside elements which contain the intersection
-                unsigned insideFaceIdx  = intersection.indexInInside();
-                unsigned outsideFaceIdx = intersection.indexInOutside();
-
-                DimVector faceCenterInside;
-                DimVector faceCenterOutside;
-                DimVector faceAreaNormal;
-
-                typename std::is_same< Grid, Dune::CpGrid> :: type isCpGrid;
-                computeFaceProperties( intersection, insideElemIdx, insideFaceIdx, outsideElemIdx, outsideFaceIdx,
-                                       faceCenterInside, faceCenterOutside, faceAreaNormal,
-                                       isCpGrid );
-
-                Scalar halfTrans1;
-                Scalar halfTrans2;
-
-                computeHalfTrans_(halfTrans1,
-                                  faceAreaNormal,
-                                  insideFaceIdx,
-                                  distanceVector_(faceCenterInside,
-                                                  intersection.indexInInside(),
-                                                  insideElemIdx,
-                                                  axisCentroids),
-                                  permeability_[insideElemIdx]);
-                computeHalfTrans_(halfTrans2,
-                                  faceAreaNormal,
-                                  outsideFaceIdx,
-                                  distanceVector_(faceCenterOutside,
-                                                  intersection.indexInOutside(),
-                                                  outsideElemIdx,
-                                                  axisCentroids),
-                                  permeability_[outsideElemIdx]);
-
-                applyNtg_(halfTrans1, insideFaceIdx, insideCartElemIdx, ntg);
-                applyNtg_(halfTrans2, outsideFaceIdx, outsideCartElemIdx, ntg);
-
-                // convert half transmissibilities to full face
-                // transmissibilities using the harmonic mean
-                Scalar trans;
-                if (std::abs(halfTrans1) < 1e-30 || std::abs(halfTrans2) < 1e-30)
-                    // avoid division by zero
-                    trans = 0.0;
-                else
-                    trans = 1.0 / (1.0/halfTrans1 + 1.0/halfTrans2);
-
-                // apply the full face transmissibility multipliers
-                // for the inside ...
-                applyMultipliers_(trans, insideFaceIdx, insideCartElemIdx, transMult);
-                // ... and outside elements
-                applyMultipliers_(trans, outsideFaceIdx, outsideCartElemIdx, transMult);
-
-                // apply the region multipliers (cf. the MULTREGT keyword)
-                Opm::FaceDir::DirEnum faceDir;
-                switch (insideFaceIdx) {
-                case 0:
-                case 1:
-                    faceDir = Opm::FaceDir::XPlus;
-                    break;
-
-                case 2:
-                case 3:
-                    faceDir = Opm::FaceDir::YPlus;
-                    break;
-
-                case 4:
-                case 5:
-                    faceDir = Opm::FaceDir::ZPlus;
-                    break;
-
-                default:
-                    OPM_THROW(std::logic_error, "Could not determine a face direction");
+                unsigned nextFaceIdx = elemFaceBegin[insideElemIdx];
+
+                auto isIt = gridView.ibegin(elem);
+                const auto& isEndIt = gridView.iend(elem);
+                for (; isIt != isEndIt; ++ isIt) {
+                    // store intersection, this might be costly
+                    const auto& intersection = *isIt;
+
+                    // ignore boundary intersections for now (TODO?)
+
+                    // continue if no neighbor is present
+                    if ( ! intersection.neighbor() )
+                        continue;
+
+                    unsigned outsideElemIdx = outsideElemIndex_(elemMapper, intersection);
+
+                    // we only need to calculate a face's transmissibility
+                    // once...
+                    if (insideElemIdx > outsideElemIdx)
+                        continue;
+
+                    // local indices of the faces of the inside and
+                    // outside elements which contain the intersection
+                    unsigned insideFaceIdx  = intersection.indexInInside();
+                    unsigned outsideFaceIdx = intersection.indexInOutside();
+
+                    DimVector faceCenterInside;
+                    DimVector faceCenterOutside;
+                    DimVector faceAreaNormal;
+
+                    typename std::is_same< Grid, Dune::CpGrid> :: type isCpGrid;
+                    computeFaceProperties( intersection, insideElemIdx, insideFaceIdx, outsideElemIdx, outsideFaceIdx,
+                                           faceCenterInside, faceCenterOutside, faceAreaNormal,
+                                           isCpGrid );
+
+                    FaceGeometry& face = faces[nextFaceIdx++];
+                    face.insideElemIdx = insideElemIdx;
+                    face.outsideElemIdx = outsideElemIdx;
+                    face.insideFaceIdx = static_cast<unsigned char>(insideFaceIdx);
+                    face.outsideFaceIdx = static_cast<unsigned char>(outsideFaceIdx);
+                    computeHalfTransGeometry_(face.insideNormalDistance,
+                                              face.insideDistanceSquared,
+                                              faceAreaNormal,
+                                              distanceVector_(faceCenterInside,
+                                                              insideFaceIdx,
+                                                              insideElemIdx,
+                                                              axisCentroids));
+                    computeHalfTransGeometry_(face.outsideNormalDistance,
+                                              face.outsideDistanceSquared,
+                                              faceAreaNormal,
+                                              distanceVector_(faceCenterOutside,
+                                                              outsideFaceIdx,
+                                                              outsideElemIdx,
+                                                              axisCentroids));
                 }
-
-                trans *= transMult.getRegionMultiplier(insideCartElemIdx,
-                                                       outsideCartElemIdx,
-                                                       faceDir);
-
-                trans_[isId_(insideElemIdx, outsideElemIdx)] = trans;
             }
         }
+
+        createAdjacency_(*geometry, numElements);
+        geometry_ = geometry;
     }
 
+    /*!
+     * \brief Returns the geometric part of the half-transmissibilities.
+     *
+     * This is a null pointer until update() or updateGeometry() have been called. The
+     * object may be shared with other EclTransmissibility objects which use the same
+     * grid, e.g., the ones of the members of an ensemble.
+     */
+    std::shared_ptr<const Geometry> geometry() const
+    { return geometry_; }
+
+    /*!
+     * \brief Use the geometric part of the half-transmissibilities of another
+     *        EclTransmissibility object.
+     *
+     * Both objects must use the same grid.
+     */
+    void setGeometry(std::shared_ptr<const Geometry> geometry)
+    { geometry_ = geometry; }
+
     const DimMatrix& permeability(unsigned elemIdx) const
     { return permeability_[elemIdx]; }
 
+    /*!
+     * \brief Returns the transmissibility of the face between two elements.
+     */
     Scalar transmissibility(unsigned elemIdx1, unsigned elemIdx2) const
-    { return trans_.at(isId_(elemIdx1, elemIdx2)); }
+    {
+        unsigned faceIdx = geometry_->faceIndex(elemIdx1, elemIdx2);
+        if (faceIdx >= trans_.size())
+            OPM_THROW(std::logic_error,
+                      "Elements " << elemIdx1 << " and " << elemIdx2 << " are not neighbors");
+        return trans_[faceIdx];
+    }
+
+    /*!
+     * \brief Returns the number of interior faces of the grid.
+     */
+    unsigned numFaces() const
+    { return static_cast<unsigned>(trans_.size()); }
+
+    /*!
+     * \brief Returns the transmissibility of an interior face.
+     *
+     * The faces are numbered as given by the geometry() object.
+     */
+    Scalar faceTransmissibility(unsigned faceIdx) const
+    { return trans_[faceIdx]; }
+
+    /*!
+     * \brief Write the geometric part of the half-transmissibilities and the
+     *        transmissibilities of all faces to a binary file.
+     *
+     * \param fileName The name of the file to be written
+     * \param key A hash which identifies the input from which the transmissibilities
+     *            were computed. It needs to match when the file is read again.
+     */
+    void writeCache(const std::string& fileName, uint64_t key) const
+    {
+        std::ofstream os(fileName.c_str(), std::ios::binary);
+        if (!os.good())
+            OPM_THROW(std::runtime_error,
+                      "Could not open the transmissibility cache file '" << fileName << "'");
+
+        uint64_t header[3] = { cacheMagic_(), key, gridManager_.gridView().size(/*codim=*/0) };
+        os.write(reinterpret_cast<const char*>(header), sizeof(header));
+        writeVector_(os, geometry_->faces);
+        writeVector_(os, geometry_->rowBegin);
+        writeVector_(os, geometry_->neighborIdx);
+        writeVector_(os, geometry_->faceIdx);
+        writeVector_(os, trans_);
+    }
+
+    /*!
+     * \brief Read the transmissibilities from a file which has been written using
+     *        writeCache().
+     *
+     * The permeabilities are taken from the ECL state. If the file does not exist, or
+     * if it was written for a different key or a different grid, false is returned and
+     * the object is left unmodified.
+     */
+    bool readCache(const std::string& fileName, uint64_t key)
+    {
+        std::ifstream is(fileName.c_str(), std::ios::binary);
+        if (!is.good())
+            return false;
+
+        uint64_t header[3];
+        is.read(reinterpret_cast<char*>(header), sizeof(header));
+        if (!is.good()
+            || header[0] != cacheMagic_()
+            || header[1] != key
+            || header[2] != static_cast<uint64_t>(gridManager_.gridView().size(/*codim=*/0)))
+            return false;
+
+        std::shared_ptr<Geometry> geometry(new Geometry);
+        std::vector<Scalar> trans;
+        if (!readVector_(is, geometry->faces)
+            || !readVector_(is, geometry->rowBegin)
+            || !readVector_(is, geometry->neighborIdx)
+            || !readVector_(is, geometry->faceIdx)
+            || !readVector_(is, trans)
+            || trans.size() != geometry->faces.size()
+            || geometry->rowBegin.size() != header[2] + 1)
+            return false;
+
+        extractPermeability_();
+        geometry_ = geometry;
+        trans_ = std::move(trans);
+        return true;
+    }
 
 private:
+    // compute the geometric part of the half-transmissibilities from the interior faces
+    // which are provided by the grid manager
+    void updateGeometry_(const EclInteriorFaces& interiorFaces)
+    {
+        const auto& eclGrid = gridManager_.eclState().getInputGrid();
+        unsigned numElements = gridManager_.gridView().size(/*codim=*/0);
+
+        // for consistency with the flow simulator, the element centers as computed by
+        // opm-parser's Opm::EclipseGrid class are used as the centroids for all axes.
+        std::vector<DimVector> centroids(numElements);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+        for (int elemIdx = 0; elemIdx < static_cast<int>(numElements); ++elemIdx) {
+            unsigned cartesianCellIdx = gridManager_.cartesianIndex(static_cast<unsigned>(elemIdx));
+            const auto& centroid = eclGrid.getCellCenter(cartesianCellIdx);
+            for (unsigned dimIdx = 0; dimIdx < dimWorld; ++dimIdx)
+                centroids[static_cast<unsigned>(elemIdx)][dimIdx] = centroid[dimIdx];
+        }
+
+        std::shared_ptr<Geometry> geometry(new Geometry);
+        auto& faces = geometry->faces;
+        faces.resize(interiorFaces.size());
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+        for (int i = 0; i < static_cast<int>(faces.size()); ++i) {
+            unsigned faceIdx = static_cast<unsigned>(i);
+            FaceGeometry& face = faces[faceIdx];
+            face.insideElemIdx = interiorFaces.insideElemIdx(faceIdx);
+            face.outsideElemIdx = interiorFaces.outsideElemIdx(faceIdx);
+            face.insideFaceIdx = static_cast<unsigned char>(interiorFaces.insideFaceIdx(faceIdx));
+            face.outsideFaceIdx = static_cast<unsigned char>(interiorFaces.outsideFaceIdx(faceIdx));
+
+            DimVector faceCenter;
+            DimVector faceAreaNormal;
+            for (unsigned dimIdx = 0; dimIdx < dimWorld; ++dimIdx) {
+                faceCenter[dimIdx] = interiorFaces.center(faceIdx)[dimIdx];
+                faceAreaNormal[dimIdx] = interiorFaces.areaNormal(faceIdx)[dimIdx];
+            }
+
+            DimVector distance = faceCenter;
+            distance -= centroids[face.insideElemIdx];
+            computeHalfTransGeometry_(face.insideNormalDistance,
+                                      face.insideDistanceSquared,
+                                      faceAreaNormal,
+                                      distance);
+
+            distance = faceCenter;
+            distance -= centroids[face.outsideElemIdx];
+            computeHalfTransGeometry_(face.outsideNormalDistance,
+                                      face.outsideDistanceSquared,
+                                      faceAreaNormal,
+                                      distance);
+        }
+
+        createAdjacency_(*geometry, numElements);
+        geometry_ = geometry;
+    }
+
+    // create the adjacency of the elements and the faces
+    static void createAdjacency_(Geometry& geometry, unsigned numElements)
+    {
+        const auto& faces = geometry.faces;
+        auto& rowBegin = geometry.rowBegin;
+        rowBegin.assign(numElements + 1, 0);
+        for (unsigned faceIdx = 0; faceIdx < faces.size(); ++faceIdx) {
+            ++ rowBegin[faces[faceIdx].insideElemIdx + 1];
+            ++ rowBegin[faces[faceIdx].outsideElemIdx + 1];
+        }
+        for (unsigned elemIdx = 0; elemIdx < numElements; ++elemIdx)
+            rowBegin[elemIdx + 1] += rowBegin[elemIdx];
+
+        std::vector<unsigned> nextPos(rowBegin.begin(), rowBegin.end() - 1);
+        geometry.neighborIdx.resize(2*faces.size());
+        geometry.faceIdx.resize(2*faces.size());
+        for (unsigned faceIdx = 0; faceIdx < faces.size(); ++faceIdx) {
+            unsigned insideElemIdx = faces[faceIdx].insideElemIdx;
+            unsigned outsideElemIdx = faces[faceIdx].outsideElemIdx;
+
+            unsigned pos = nextPos[insideElemIdx]++;
+            geometry.neighborIdx[pos] = outsideElemIdx;
+            geometry.faceIdx[pos] = faceIdx;
+
+            pos = nextPos[outsideElemIdx]++;
+            geometry.neighborIdx[pos] = insideElemIdx;
+            geometry.faceIdx[pos] = faceIdx;
+        }
+    }
+
+    // identifies the format of the files written by writeCache()
+    static uint64_t cacheMagic_()
+    { return 0x4557544331000000ULL + sizeof(Scalar); }
+
+    template <class T>
+    static void writeVector_(std::ostream& os, const std::vector<T>& v)
+    {
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "Only vectors of trivially copyable objects can be written");
+        uint64_t n = v.size();
+        os.write(reinterpret_cast<const char*>(&n), sizeof(n));
+        if (n > 0)
+            os.write(reinterpret_cast<const char*>(v.data()), static_cast<std::streamsize>(n*sizeof(T)));
+    }
+
+    template <class T>
+    static bool readVector_(std::istream& is, std::vector<T>& v)
+    {
+        uint64_t n;
+        is.read(reinterpret_cast<char*>(&n), sizeof(n));
+        if (!is.good())
+            return false;
+
+        v.resize(n);
+        if (n > 0)
+            is.read(reinterpret_cast<char*>(v.data()), static_cast<std::streamsize>(n*sizeof(T)));
+        return !is.fail();
+    }
+
     template <class Intersection>
     void computeFaceProperties( const Intersection& intersection,
                                 const int insideElemIdx,
@@ -312,6 +687,17 @@ private:
         faceAreaNormal = gridManager_.grid().faceAreaNormalEcl(faceIdx);
     }
 
+    template <class Intersection>
+    static unsigned outsideElemIndex_(const ElementMapper& elemMapper,
+                                      const Intersection& intersection)
+    {
+#if DUNE_VERSION_NEWER(DUNE_COMMON, 2,4)
+        return elemMapper.index(intersection.outside());
+#else
+        return elemMapper.map(*intersection.outside());
+#endif
+    }
+
     void extractPermeability_()
     {
         const auto& props = gridManager_.eclState().get3DProperties();
@@ -333,7 +719,11 @@ private:
             if (props.hasDeckDoubleGridProperty("PERMZ"))
                 permzData = props.getDoubleGridProperty("PERMZ").getData();
 
-            for (size_t dofIdx = 0; dofIdx < numElem; ++ dofIdx) {
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+            for (int i = 0; i < static_cast<int>(numElem); ++ i) {
+                unsigned dofIdx = static_cast<unsigned>(i);
                 unsigned cartesianElemIdx = gridManager_.cartesianIndex(dofIdx);
                 permeability_[dofIdx] = 0.0;
                 permeability_[dofIdx][0][0] = permxData[cartesianElemIdx];
@@ -349,32 +739,31 @@ private:
                       "(The PERM{X,Y,Z} keywords are missing)");
     }
 
-    std::uint64_t isId_(unsigned elemIdx1, unsigned elemIdx2) const
+    void computeHalfTransGeometry_(Scalar& normalDistance,
+                                   Scalar& distanceSquared,
+                                   const DimVector& areaNormal,
+                                   const DimVector& distance) const
     {
-        static const unsigned elemIdxShift = 32; // bits
-
-        unsigned elemAIdx = std::min(elemIdx1, elemIdx2);
-        std::uint64_t elemBIdx = std::max(elemIdx1, elemIdx2);
+        Scalar val = 0;
+        for (unsigned i = 0; i < areaNormal.size(); ++i)
+            val += areaNormal[i]*distance[i];
 
-        return (elemBIdx<<elemIdxShift) + elemAIdx;
+        normalDistance = std::abs(val);
+        distanceSquared = distance.two_norm2();
     }
 
     void computeHalfTrans_(Scalar& halfTrans,
-                           const DimVector& areaNormal,
                            unsigned faceIdx, // in the reference element that contains the intersection
-                           const DimVector& distance,
+                           Scalar normalDistance,
+                           Scalar distanceSquared,
                            const DimMatrix& perm) const
     {
         unsigned dimIdx = faceIdx/2;
         assert(dimIdx < dimWorld);
         halfTrans = perm[dimIdx][dimIdx];
 
-        Scalar val = 0;
-        for (unsigned i = 0; i < areaNormal.size(); ++i)
-            val += areaNormal[i]*distance[i];
-
-        halfTrans *= std::abs(val);
-        halfTrans /= distance.two_norm2();
+        halfTrans *= normalDistance;
+        halfTrans /= distanceSquared;
     }
 
     DimVector distanceVector_(const DimVector& center,
@@ -463,7 +852,10 @@ private:
 
         averageNtg = ntg;
 
-        for (size_t cartesianCellIdx = 0; cartesianCellIdx < ntg.size(); ++cartesianCellIdx)
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+        for (int cartesianCellIdx = 0; cartesianCellIdx < static_cast<int>(ntg.size()); ++cartesianCellIdx)
         {
             // use the original ntg values for the inactive cells
             if (!actnum[cartesianCellIdx])
@@ -494,8 +886,9 @@ private:
 
 
     const GridManager& gridManager_;
+    std::shared_ptr<const Geometry> geometry_;
     std::vector<DimMatrix> permeability_;
-    std::unordered_map<std::uint64_t, Scalar> trans_;
+    std::vector<Scalar> trans_;
 };
 
 } // namespace Ewoms
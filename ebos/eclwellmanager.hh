@@ -29,6 +29,7 @@
 #define EWOMS_ECL_WELL_MANAGER_HH
 
 #include "eclpeacemanwell.hh"
+#include "eclwellobjective.hh"
 
 #include <ewoms/disc/common/fvbaseproperties.hh>
 
@@ -36,6 +37,8 @@
 #include <opm/parser/eclipse/EclipseState/EclipseState.hpp>
 #include <opm/parser/eclipse/EclipseState/Schedule/Schedule.hpp>
 #include <opm/parser/eclipse/EclipseState/Schedule/Events.hpp>
+#include <opm/parser/eclipse/EclipseState/Schedule/Group.hpp>
+#include <opm/parser/eclipse/EclipseState/Schedule/ScheduleEnums.hpp>
 #include <opm/parser/eclipse/EclipseState/Schedule/CompletionSet.hpp>
 #include <opm/parser/eclipse/EclipseState/Schedule/Well.hpp>
 #include <opm/parser/eclipse/EclipseState/Schedule/TimeMap.hpp>
@@ -43,6 +46,7 @@
 #include <opm/common/Exceptions.hpp>
 
 #include <ewoms/common/propertysystem.hh>
+#include <ewoms/common/profiler.hh>
 #include <ewoms/parallel/threadedentityiterator.hh>
 
 #include <dune/grid/common/gridenums.hh>
@@ -50,12 +54,94 @@
 #include <map>
 #include <string>
 #include <vector>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <exception>
 
 namespace Ewoms {
 namespace Properties {
 NEW_PROP_TAG(Grid);
 }
 
+/*!
+ * \ingroup EclBlackOilSimulator
+ *
+ * \brief The pressures, rates and cumulative volumes of all wells.
+ *
+ * The quantities are stored as a structure of arrays: For each phase quantity, the
+ * values of all wells and phases are contiguous in memory, i.e., the entry for a
+ * given well and phase is located at <tt>wellIdx*numPhases + phaseIdx</tt> of the
+ * array returned by phaseValues().
+ */
+template <class Scalar, int numPhases>
+class EclWellRateTable
+{
+public:
+    enum PhaseQuantity {
+        surfaceRateIdx = 0, //!< Surface rate [m^3/s], positive for injection
+        injectedVolumeIdx = 1, //!< Total injected surface volume [m^3]
+        producedVolumeIdx = 2, //!< Total produced surface volume [m^3]
+        numPhaseQuantities = 3
+    };
+
+    EclWellRateTable()
+    { numWells_ = 0; }
+
+    /*!
+     * \brief Set the number of wells.
+     */
+    void resize(unsigned numWells)
+    {
+        numWells_ = numWells;
+        bottomHolePressure_.resize(numWells);
+        tubingHeadPressure_.resize(numWells);
+        phaseValues_.resize(numPhaseQuantities*numWells*numPhases);
+    }
+
+    /*!
+     * \brief Return the number of wells in the table.
+     */
+    unsigned numWells() const
+    { return numWells_; }
+
+    /*!
+     * \brief The bottom hole pressure [Pa] of a well.
+     */
+    Scalar& bottomHolePressure(unsigned wellIdx)
+    { return bottomHolePressure_[wellIdx]; }
+    Scalar bottomHolePressure(unsigned wellIdx) const
+    { return bottomHolePressure_[wellIdx]; }
+
+    /*!
+     * \brief The tubing head pressure [Pa] of a well.
+     */
+    Scalar& tubingHeadPressure(unsigned wellIdx)
+    { return tubingHeadPressure_[wellIdx]; }
+    Scalar tubingHeadPressure(unsigned wellIdx) const
+    { return tubingHeadPressure_[wellIdx]; }
+
+    /*!
+     * \brief A quantity of a fluid phase of a well.
+     */
+    Scalar& phaseValue(PhaseQuantity quantityIdx, unsigned wellIdx, unsigned phaseIdx)
+    { return phaseValues_[(quantityIdx*numWells_ + wellIdx)*numPhases + phaseIdx]; }
+    Scalar phaseValue(PhaseQuantity quantityIdx, unsigned wellIdx, unsigned phaseIdx) const
+    { return phaseValues_[(quantityIdx*numWells_ + wellIdx)*numPhases + phaseIdx]; }
+
+    /*!
+     * \brief The values of a phase quantity for all wells and phases.
+     */
+    const Scalar* phaseValues(PhaseQuantity quantityIdx) const
+    { return &phaseValues_[quantityIdx*numWells_*numPhases]; }
+
+private:
+    unsigned numWells_;
+    std::vector<Scalar> bottomHolePressure_;
+    std::vector<Scalar> tubingHeadPressure_;
+    std::vector<Scalar> phaseValues_;
+};
+
 /*!
  * \ingroup EclBlackOilSimulator
  *
@@ -84,11 +170,35 @@ class EclWellManager
     typedef std::map<int, std::pair<const Opm::Completion*, std::shared_ptr<Well> > > WellCompletionsMap;
 
     typedef Dune::FieldVector<Evaluation, numEq> EvalEqVector;
+    typedef typename WellCompletionsMap::value_type Completion_;
+
+    // the target of a group and the state of its distribution to the wells
+    struct GroupControl_
+    {
+        std::string name;
+        bool isInjector;
+
+        // the relative weights of the volumetric surface rates for the target
+        std::array<Scalar, numPhases> phaseWeights;
+        Scalar targetRate;
+
+        // the wells of the group which are controlled by it and the ones which are
+        // controlled individually
+        std::vector<unsigned> controlledWellIdx;
+        std::vector<unsigned> otherWellIdx;
+
+        // the guide rates of the controlled wells and the factor between the guide rates
+        // and the shares of the wells of the last iteration
+        std::vector<Scalar> guideRates;
+        Scalar scale;
+    };
 
 public:
+    typedef EclWellRateTable<Scalar, numPhases> RateTable;
+
     EclWellManager(Simulator& simulator)
         : simulator_(simulator)
-    { }
+    { elementSeedIdxSeqNum_ = -1; }
 
     /*!
      * \brief This sets up the basic properties of all wells.
@@ -115,6 +225,8 @@ public:
             wells_.push_back(well);
             wellNameToIndex_[well->name()] = wells_.size() - 1;
         }
+
+        updateWellTaskOrder_();
     }
 
     /*!
@@ -126,17 +238,25 @@ public:
         unsigned episodeIdx = simulator_.episodeIndex();
 
         const auto& deckSchedule = eclState.getSchedule();
-        WellCompletionsMap wellCompMap;
-        computeWellCompletionsMap_(episodeIdx, wellCompMap);
 
-        if (wasRestarted || wellTopologyChanged_(eclState, episodeIdx))
-            updateWellTopology_(episodeIdx, wellCompMap, gridDofIsPenetrated_);
+        // the perforations of the wells only need to be determined again if the
+        // completions have changed. (for most report steps, only the controls change.)
+        if (wasRestarted || wellTopologyChanged_(eclState, episodeIdx)) {
+            WellCompletionsMap wellCompMap;
+            computeWellCompletionsMap_(episodeIdx, wellCompMap);
+
+            updateWellTopology_(episodeIdx, wellCompMap);
 
-        // set those parameters of the wells which do not change the topology of the
-        // linearized system of equations
-        updateWellParameters_(episodeIdx, wellCompMap);
+            // set those parameters of the wells which do not change the topology of the
+            // linearized system of equations
+            updateWellParameters_(episodeIdx, wellCompMap);
+
+            // the perforations of the wells are re-created by the methods above
+            updatePerforationIndex_();
+        }
 
         const std::vector<const Opm::Well*>& deckWells = deckSchedule.getWells(episodeIdx);
+        std::vector<unsigned char> isGroupControlled(wells_.size(), 0);
         // set the injection data for the respective wells.
         for (size_t deckWellIdx = 0; deckWellIdx < deckWells.size(); ++deckWellIdx) {
             const Opm::Well* deckWell = deckWells[deckWellIdx];
@@ -206,8 +326,10 @@ public:
                     break;
 
                 case Opm::WellInjector::GRUP:
-                    OPM_THROW(std::runtime_error,
-                              "Not implemented: Well groups");
+                    // the rate of the well is determined by the target of its group
+                    well->setControlMode(Well::ControlMode::BottomHolePressure);
+                    isGroupControlled[wellIndex(deckWell->name())] = 1;
+                    break;
 
                 case Opm::WellInjector::CMODE_UNDEFINED:
                     std::cout << "Warning: Control mode of injection well " << well->name()
@@ -234,8 +356,14 @@ public:
                               "Not implemented: Multi-phase injection wells");
                 }
 
-                well->setMaximumSurfaceRate(injectProperties.surfaceInjectionRate);
-                well->setMaximumReservoirRate(injectProperties.reservoirInjectionRate);
+                if (isGroupControlled[wellIndex(deckWell->name())]) {
+                    well->setMaximumSurfaceRate(1e100);
+                    well->setMaximumReservoirRate(1e100);
+                }
+                else {
+                    well->setMaximumSurfaceRate(injectProperties.surfaceInjectionRate);
+                    well->setMaximumReservoirRate(injectProperties.reservoirInjectionRate);
+                }
                 well->setTargetBottomHolePressure(injectProperties.BHPLimit);
 
                 // TODO
@@ -293,8 +421,12 @@ public:
                     break;
 
                 case Opm::WellProducer::GRUP:
-                    OPM_THROW(std::runtime_error,
-                              "Not implemented: Well groups");
+                    // the rate of the well is determined by the target of its group
+                    well->setControlMode(Well::ControlMode::BottomHolePressure);
+                    well->setMaximumSurfaceRate(1e100);
+                    well->setMaximumReservoirRate(1e100);
+                    isGroupControlled[wellIndex(deckWell->name())] = 1;
+                    break;
 
                 case Opm::WellProducer::NONE:
                     // fall-through
@@ -312,6 +444,11 @@ public:
                 //well->setTargetTubingHeadPressure(producerProperties.THPLimit);
             }
         }
+
+        // the completions and the status of the wells may have changed
+        updateWellTaskOrder_();
+
+        updateGroupControls_(eclState, isGroupControlled);
     }
 
     /*!
@@ -332,7 +469,7 @@ public:
      * \brief Returns true iff a given degree of freedom is currently penetrated by any well.
      */
     bool gridDofIsPenetrated(unsigned globalDofIdx) const
-    { return gridDofIsPenetrated_[globalDofIdx]; }
+    { return dofWellIdx_[globalDofIdx] >= 0; }
 
     /*!
      * \brief Given a well name, return the corresponding index.
@@ -384,9 +521,8 @@ public:
      */
     void beginTimeStep()
     {
-        // iterate over all wells and notify them individually
-        for (size_t wellIdx = 0; wellIdx < wells_.size(); ++wellIdx)
-            wells_[wellIdx]->beginTimeStep();
+        // notify all wells individually
+        applyToWells_([](Well& well) { well.beginTimeStep(); });
     }
 
     /*!
@@ -398,11 +534,10 @@ public:
     void beginIteration()
     {
         // call the preprocessing routines
-        const size_t wellSize = wells_.size();
-        for (size_t wellIdx = 0; wellIdx < wellSize; ++wellIdx)
-            wells_[wellIdx]->beginIterationPreProcess();
+        applyToWells_([](Well& well) { well.beginIterationPreProcess(); });
 
-        // call the accumulation routines
+        // call the accumulation routines. only the intensive quantities of the
+        // penetrated degrees of freedom are needed.
         ThreadedEntityIterator<GridView, /*codim=*/0> threadedElemIt(simulator_.gridManager().gridView());
 #ifdef _OPENMP
 #pragma omp parallel
@@ -416,16 +551,35 @@ public:
                     continue;
 
                 elemCtx.updatePrimaryStencil(elem);
-                elemCtx.updatePrimaryIntensiveQuantities(/*timeIdx=*/0);
+                unsigned numPrimaryDof = elemCtx.numPrimaryDof(/*timeIdx=*/0);
+                bool isPenetrated = false;
+                for (unsigned dofIdx = 0; dofIdx < numPrimaryDof; ++dofIdx)
+                    isPenetrated = isPenetrated
+                        || gridDofIsPenetrated(elemCtx.globalSpaceIndex(dofIdx, /*timeIdx=*/0));
+                if (!isPenetrated)
+                    continue;
 
-                for (size_t wellIdx = 0; wellIdx < wellSize; ++wellIdx)
-                    wells_[wellIdx]->beginIterationAccumulate(elemCtx, /*timeIdx=*/0);
+                elemCtx.updatePrimaryIntensiveQuantities(/*timeIdx=*/0);
+                for (unsigned dofIdx = 0; dofIdx < numPrimaryDof; ++dofIdx) {
+                    unsigned globalDofIdx = elemCtx.globalSpaceIndex(dofIdx, /*timeIdx=*/0);
+                    int wellIdx = dofWellIdx_[globalDofIdx];
+                    if (wellIdx < 0)
+                        continue;
+
+                    wells_[static_cast<unsigned>(wellIdx)]->beginIterationAccumulatePerforation(
+                        dofPerforationIdx_[globalDofIdx],
+                        elemCtx.intensiveQuantities(dofIdx, /*timeIdx=*/0));
+                }
             }
         }
 
-        // call the postprocessing routines
-        for (size_t wellIdx = 0; wellIdx < wellSize; ++wellIdx)
-            wells_[wellIdx]->beginIterationPostProcess();
+        // distribute the group targets to the wells before their bottom hole
+        // pressures are determined
+        updateGroupRateLimits_();
+
+        // call the postprocessing routines. this is where the bottom hole pressures
+        // are determined, which is much more expensive for some wells than for others.
+        applyToWells_([](Well& well) { well.beginIterationPostProcess(); });
     }
 
     /*!
@@ -433,10 +587,8 @@ public:
      */
     void endIteration()
     {
-        // iterate over all wells and notify them individually
-        const size_t wellSize = wells_.size();
-        for (size_t wellIdx = 0; wellIdx < wellSize; ++wellIdx)
-            wells_[wellIdx]->endIteration();
+        // notify all wells individually
+        applyToWells_([](Well& well) { well.endIteration(); });
     }
 
     /*!
@@ -510,6 +662,44 @@ public:
         return wellTotalInjectedVolume_.at(wellName)[phaseIdx];
     }
 
+    /*!
+     * \brief Fill a table with the pressures, surface rates and cumulative volumes of
+     *        all wells.
+     *
+     * The table is filled in a single pass over the wells, so this is cheaper than
+     * querying the individual quantities of each well. If an objective function is
+     * given, the contributions of the wells to it are evaluated within the same pass.
+     * Its evaluation for the current time step must already have been started (cf.
+     * EclWellObjective::beginStep()).
+     */
+    void computeRateTable(RateTable& table, EclWellObjective<TypeTag>* objective = nullptr) const
+    {
+        const unsigned wellSize = numWells();
+        table.resize(wellSize);
+
+        for (unsigned wellIdx = 0; wellIdx < wellSize; ++wellIdx) {
+            const auto& well = wells_[wellIdx];
+            table.bottomHolePressure(wellIdx) = well->bottomHolePressure();
+            table.tubingHeadPressure(wellIdx) = well->tubingHeadPressure();
+
+            const auto& injIt = wellTotalInjectedVolume_.find(well->name());
+            const auto& prodIt = wellTotalProducedVolume_.find(well->name());
+            for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++phaseIdx) {
+                table.phaseValue(RateTable::surfaceRateIdx, wellIdx, phaseIdx) =
+                    well->surfaceRate(phaseIdx);
+
+                // wells which have not been seen yet did not inject or produce anything
+                table.phaseValue(RateTable::injectedVolumeIdx, wellIdx, phaseIdx) =
+                    (injIt == wellTotalInjectedVolume_.end()) ? 0.0 : injIt->second[phaseIdx];
+                table.phaseValue(RateTable::producedVolumeIdx, wellIdx, phaseIdx) =
+                    (prodIt == wellTotalProducedVolume_.end()) ? 0.0 : prodIt->second[phaseIdx];
+            }
+
+            if (objective)
+                objective->addWell(*well);
+        }
+    }
+
     /*!
      * \brief Computes the source term due to wells for a degree of
      *        freedom.
@@ -522,19 +712,20 @@ public:
     {
         q = 0.0;
 
-        if (!gridDofIsPenetrated(context.globalSpaceIndex(dofIdx, timeIdx)))
+        unsigned globalDofIdx = context.globalSpaceIndex(dofIdx, timeIdx);
+        int wellIdx = dofWellIdx_[globalDofIdx];
+        if (wellIdx < 0)
             return;
 
+        // each degree of freedom is perforated by at most a single well
         RateVector wellRate;
-
-        // iterate over all wells and add up their individual rates
-        const size_t wellSize = wells_.size();
-        for (size_t wellIdx = 0; wellIdx < wellSize; ++wellIdx) {
-            wellRate = 0.0;
-            wells_[wellIdx]->computeTotalRatesForDof(wellRate, context, dofIdx, timeIdx);
-            for (unsigned eqIdx = 0; eqIdx < numEq; ++eqIdx)
-                q[eqIdx] += wellRate[eqIdx];
-        }
+        wells_[static_cast<unsigned>(wellIdx)]->computeTotalRatesForPerforation(wellRate,
+                                                                                dofPerforationIdx_[globalDofIdx],
+                                                                                context,
+                                                                                dofIdx,
+                                                                                timeIdx);
+        for (unsigned eqIdx = 0; eqIdx < numEq; ++eqIdx)
+            q[eqIdx] = wellRate[eqIdx];
     }
 
     /*!
@@ -585,6 +776,369 @@ public:
     }
 
 protected:
+    // sort the wells by the amount of work which they are expected to cause, i.e., by
+    // the number of degrees of freedom which they perforate. shut wells do not do
+    // anything, so they come last.
+    void updateWellTaskOrder_()
+    {
+        std::vector<unsigned> weight(wells_.size());
+        wellTaskOrder_.resize(wells_.size());
+        for (unsigned wellIdx = 0; wellIdx < wells_.size(); ++wellIdx) {
+            wellTaskOrder_[wellIdx] = wellIdx;
+            if (wells_[wellIdx]->wellStatus() == Well::Shut)
+                weight[wellIdx] = 0;
+            else
+                weight[wellIdx] = wells_[wellIdx]->numPerforatedDofs();
+        }
+
+        std::stable_sort(wellTaskOrder_.begin(), wellTaskOrder_.end(),
+                         [&weight](unsigned a, unsigned b)
+                         { return weight[a] > weight[b]; });
+    }
+
+    // call a functor for each well. the wells are handed to the threads dynamically in
+    // the order of decreasing cost, so that the threads do not run idle if some wells
+    // are much more expensive than the others. exceptions thrown by the functor are
+    // re-thrown after all wells have been processed.
+    template <class Functor>
+    void applyToWells_(const Functor& functor)
+    {
+        const int numTasks = static_cast<int>(wellTaskOrder_.size());
+        std::exception_ptr exception;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+        for (int taskIdx = 0; taskIdx < numTasks; ++taskIdx) {
+            try {
+                functor(*wells_[wellTaskOrder_[taskIdx]]);
+            }
+            catch (...) {
+#ifdef _OPENMP
+#pragma omp critical (EclWellManagerException)
+#endif
+                exception = std::current_exception();
+            }
+        }
+
+        if (exception)
+            std::rethrow_exception(exception);
+    }
+
+    // determine the groups of the current episode which exhibit a target that is
+    // distributed to group controlled wells. only the wells which directly belong to a
+    // group are considered, i.e., the targets of higher level groups are ignored.
+    void updateGroupControls_(const Opm::EclipseState& eclState,
+                              const std::vector<unsigned char>& isGroupControlled)
+    {
+        unsigned episodeIdx = simulator_.episodeIndex();
+
+        // the shares of the last episode do not apply anymore
+        std::array<Scalar, numPhases> noWeights;
+        std::fill(noWeights.begin(), noWeights.end(), 0.0);
+        for (unsigned wellIdx = 0; wellIdx < wells_.size(); ++wellIdx)
+            wells_[wellIdx]->setGroupRateLimit(1e100, noWeights);
+
+        std::vector<GroupControl_> oldGroupControls;
+        oldGroupControls.swap(groupControls_);
+
+        const auto& deckSchedule = eclState.getSchedule();
+        const std::vector<const Opm::Well*>& deckWells = deckSchedule.getWells(episodeIdx);
+        const auto& deckGroups = deckSchedule.getGroups();
+        for (size_t deckGroupIdx = 0; deckGroupIdx < deckGroups.size(); ++deckGroupIdx) {
+            const Opm::Group& deckGroup = *deckGroups[deckGroupIdx];
+
+            GroupControl_ group;
+            group.name = deckGroup.name();
+            if (!groupTarget_(group, deckGroup, episodeIdx))
+                continue;
+
+            for (size_t deckWellIdx = 0; deckWellIdx < deckWells.size(); ++deckWellIdx) {
+                const Opm::Well* deckWell = deckWells[deckWellIdx];
+                if (!hasWell(deckWell->name()) || deckWell->getGroupName(episodeIdx) != group.name)
+                    continue;
+
+                unsigned wellIdx = wellIndex(deckWell->name());
+                const auto& well = wells_[wellIdx];
+                if (well->wellStatus() != Well::Open
+                    || (well->wellType() == Well::Injector) != group.isInjector)
+                    continue;
+
+                if (isGroupControlled[wellIdx])
+                    group.controlledWellIdx.push_back(wellIdx);
+                else
+                    group.otherWellIdx.push_back(wellIdx);
+            }
+
+            if (group.controlledWellIdx.empty())
+                continue;
+
+            // warm start from the previous episode
+            group.scale = 0.0;
+            for (unsigned i = 0; i < oldGroupControls.size(); ++i) {
+                if (oldGroupControls[i].name == group.name)
+                    group.scale = oldGroupControls[i].scale;
+            }
+
+            groupControls_.push_back(group);
+        }
+    }
+
+    // set the target of a group. returns false if the group does not exhibit a target
+    // which can be distributed to its wells.
+    bool groupTarget_(GroupControl_& group, const Opm::Group& deckGroup, unsigned episodeIdx) const
+    {
+        std::fill(group.phaseWeights.begin(), group.phaseWeights.end(), 0.0);
+        const unsigned oilPhaseIdx = FluidSystem::oilPhaseIdx;
+        const unsigned gasPhaseIdx = FluidSystem::gasPhaseIdx;
+        const unsigned waterPhaseIdx = FluidSystem::waterPhaseIdx;
+
+        if (deckGroup.isProductionGroup(episodeIdx)) {
+            group.isInjector = false;
+            switch (deckGroup.getProductionControlMode(episodeIdx)) {
+            case Opm::GroupProduction::ORAT:
+                group.phaseWeights[oilPhaseIdx] = 1.0;
+                group.targetRate = deckGroup.getOilTargetRate(episodeIdx);
+                return true;
+
+            case Opm::GroupProduction::WRAT:
+                group.phaseWeights[waterPhaseIdx] = 1.0;
+                group.targetRate = deckGroup.getWaterTargetRate(episodeIdx);
+                return true;
+
+            case Opm::GroupProduction::GRAT:
+                group.phaseWeights[gasPhaseIdx] = 1.0;
+                group.targetRate = deckGroup.getGasTargetRate(episodeIdx);
+                return true;
+
+            case Opm::GroupProduction::LRAT:
+                group.phaseWeights[oilPhaseIdx] = 1.0;
+                group.phaseWeights[waterPhaseIdx] = 1.0;
+                group.targetRate = deckGroup.getLiquidTargetRate(episodeIdx);
+                return true;
+
+            case Opm::GroupProduction::NONE:
+            case Opm::GroupProduction::FLD:
+                return false;
+
+            default:
+                std::cout << "Warning: Control mode of production group " << group.name
+                          << " is not supported. Ignoring its target.\n";
+                return false;
+            }
+        }
+
+        if (deckGroup.isInjectionGroup(episodeIdx)) {
+            group.isInjector = true;
+            switch (deckGroup.getInjectionControlMode(episodeIdx)) {
+            case Opm::GroupInjection::RATE:
+                switch (deckGroup.getInjectionPhase(episodeIdx)) {
+                case Opm::Phase::OIL:
+                    group.phaseWeights[oilPhaseIdx] = 1.0;
+                    break;
+                case Opm::Phase::GAS:
+                    group.phaseWeights[gasPhaseIdx] = 1.0;
+                    break;
+                case Opm::Phase::WATER:
+                    group.phaseWeights[waterPhaseIdx] = 1.0;
+                    break;
+                }
+                group.targetRate = deckGroup.getSurfaceMaxRate(episodeIdx);
+                return true;
+
+            case Opm::GroupInjection::NONE:
+            case Opm::GroupInjection::FLD:
+                return false;
+
+            default:
+                std::cout << "Warning: Control mode of injection group " << group.name
+                          << " is not supported. Ignoring its target.\n";
+                return false;
+            }
+        }
+
+        return false;
+    }
+
+    // distribute the targets of the groups to their group controlled wells. the share
+    // of a well is proportional to its guide rate, which is its potential at the
+    // beginning of the time step, but it is limited by its current potential. Solving
+    // for the proportionality factor is a small non-linear problem for each group. It is
+    // solved once per Newton-Raphson iteration, starting from the factor of the previous
+    // iteration.
+    void updateGroupRateLimits_()
+    {
+        if (groupControls_.empty())
+            return;
+
+        EWOMS_PROFILE_REGION("EclWellManager::updateGroupRateLimits");
+
+        bool isFirstIteration = simulator_.model().newtonMethod().numIterations() == 0;
+        const auto& comm = simulator_.gridView().comm();
+        for (unsigned groupIdx = 0; groupIdx < groupControls_.size(); ++groupIdx) {
+            GroupControl_& group = groupControls_[groupIdx];
+            unsigned numControlled = group.controlledWellIdx.size();
+
+            // the potentials of the group controlled wells and the rate of the
+            // individually controlled ones. the perforations of a well may be
+            // distributed over several processes.
+            std::vector<Scalar> values(numControlled + 1, 0.0);
+            for (unsigned i = 0; i < numControlled; ++i) {
+                const auto& well = wells_[group.controlledWellIdx[i]];
+                values[i] = well->weightedSurfaceRatePotential(group.phaseWeights);
+            }
+            for (unsigned i = 0; i < group.otherWellIdx.size(); ++i) {
+                const auto& well = wells_[group.otherWellIdx[i]];
+                Scalar rate = 0.0;
+                for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++phaseIdx)
+                    rate += group.phaseWeights[phaseIdx]*well->surfaceRate(phaseIdx);
+                values[numControlled] += std::abs(rate);
+            }
+            comm.sum(values.data(), static_cast<int>(values.size()));
+
+            std::vector<Scalar> potentials(values.begin(), values.begin() + numControlled);
+            if (isFirstIteration || group.guideRates.size() != numControlled)
+                group.guideRates = potentials;
+
+            Scalar remainingTarget = std::max(group.targetRate - values[numControlled], 0.0);
+            Scalar totalPotential = 0.0;
+            for (unsigned i = 0; i < numControlled; ++i)
+                totalPotential += potentials[i];
+
+            if (totalPotential <= remainingTarget) {
+                // the target cannot be reached, so all wells are constrained by their
+                // bottom hole pressure
+                for (unsigned i = 0; i < numControlled; ++i)
+                    wells_[group.controlledWellIdx[i]]->setGroupRateLimit(1e100, group.phaseWeights);
+                continue;
+            }
+
+            group.scale = solveGroupScale_(potentials, group.guideRates, remainingTarget, group.scale);
+            for (unsigned i = 0; i < numControlled; ++i) {
+                Scalar share = std::min(potentials[i], group.scale*group.guideRates[i]);
+                wells_[group.controlledWellIdx[i]]->setGroupRateLimit(share, group.phaseWeights);
+            }
+        }
+    }
+
+    // solve sum_i min(potential_i, scale*guideRate_i) = target for the scale factor
+    // using the Newton-Raphson method. the function is concave and piecewise linear, so
+    // once an iterate is left of the solution, the subsequent ones are increasing and
+    // the exact solution is found after a few iterations. it is assumed that the sum of
+    // the potentials is larger than the target.
+    static Scalar solveGroupScale_(const std::vector<Scalar>& potentials,
+                                   std::vector<Scalar>& guideRates,
+                                   Scalar target,
+                                   Scalar initialScale)
+    {
+        Scalar totalGuideRate = 0.0;
+        for (unsigned i = 0; i < guideRates.size(); ++i)
+            totalGuideRate += guideRates[i];
+        if (totalGuideRate <= 0.0) {
+            // none of the wells was able to produce at the beginning of the time step
+            guideRates = potentials;
+            for (unsigned i = 0; i < guideRates.size(); ++i)
+                totalGuideRate += guideRates[i];
+        }
+
+        // a starting point which is left of the solution
+        const Scalar lowerScale = target/totalGuideRate;
+
+        Scalar scale = std::max(initialScale, 0.0);
+        for (int iterIdx = 0; iterIdx < 50; ++iterIdx) {
+            Scalar f = -target;
+            Scalar df = 0.0;
+            for (unsigned i = 0; i < potentials.size(); ++i) {
+                Scalar rate = scale*guideRates[i];
+                if (rate < potentials[i]) {
+                    f += rate;
+                    df += guideRates[i];
+                }
+                else
+                    f += potentials[i];
+            }
+
+            if (std::abs(f) <= 1e-10*target)
+                break;
+
+            if (df <= 0.0) {
+                // all wells are limited by their potentials
+                scale = lowerScale;
+                continue;
+            }
+
+            scale = std::max(scale - f/df, 0.0);
+        }
+
+        return scale;
+    }
+
+    // determine the local interior elements which are perforated by the completions in
+    // the order of the grid. the elements are specified by their index in the list of
+    // element seeds of the model. since the well model is only implemented for
+    // element-centered finite volumes, the perforated DOF is the primary DOF of the
+    // element.
+    void perforatedElements_(std::vector<std::pair<unsigned, const Completion_*> >& result,
+                             const WellCompletionsMap& wellCompletions) const
+    {
+        updateElementSeedIndex_();
+
+        const auto& cartesianToCompressed = simulator_.gridManager().cartesianToCompressed();
+
+        result.clear();
+        auto complIt = wellCompletions.begin();
+        const auto& complEndIt = wellCompletions.end();
+        for (; complIt != complEndIt; ++complIt) {
+            int elemIdx = cartesianToCompressed.compressedIndex(static_cast<unsigned>(complIt->first));
+            if (elemIdx < 0 || elementSeedIdx_[static_cast<unsigned>(elemIdx)] < 0)
+                // the completion is not located in the interior of the local grid
+                continue;
+
+            unsigned seedIdx = static_cast<unsigned>(elementSeedIdx_[static_cast<unsigned>(elemIdx)]);
+            result.push_back(std::make_pair(seedIdx, &(*complIt)));
+        }
+
+        std::sort(result.begin(), result.end(),
+                  [](const std::pair<unsigned, const Completion_*>& a,
+                     const std::pair<unsigned, const Completion_*>& b)
+                  { return a.first < b.first; });
+    }
+
+    // map the indices of the elements to their position in the list of element seeds of
+    // the model. non-interior elements are mapped to -1. this walks the grid, so it is
+    // only redone if the grid has changed.
+    void updateElementSeedIndex_() const
+    {
+        const auto& gridManager = simulator_.gridManager();
+        int curSeqNum = gridManager.gridSequenceNumber();
+        const auto& elemSeeds = simulator_.model().elementSeeds();
+        if (elementSeedIdxSeqNum_ == curSeqNum && elementSeedIdx_.size() == elemSeeds.size())
+            return;
+
+        elementSeedIdxSeqNum_ = curSeqNum;
+        elementSeedIdx_.assign(elemSeeds.size(), -1);
+
+        const auto& grid = gridManager.grid();
+        const auto& elemMapper = simulator_.model().elementMapper();
+        for (unsigned seedIdx = 0; seedIdx < elemSeeds.size(); ++seedIdx) {
+#if DUNE_VERSION_NEWER(DUNE_GRID, 2, 4)
+            const Element& elem = grid.entity(elemSeeds[seedIdx]);
+#else
+            const auto& elemPtr = grid.entity(elemSeeds[seedIdx]);
+            const Element& elem = *elemPtr;
+#endif
+            if (elem.partitionType() != Dune::InteriorEntity)
+                continue; // non-local entities need to be skipped
+
+#if DUNE_VERSION_NEWER(DUNE_COMMON, 2,4)
+            unsigned elemIdx = elemMapper.index(elem);
+#else
+            unsigned elemIdx = elemMapper.map(elem);
+#endif
+            elementSeedIdx_[elemIdx] = static_cast<int>(seedIdx);
+        }
+    }
+
     bool wellTopologyChanged_(const Opm::EclipseState& eclState, unsigned reportStepIdx) const
     {
         if (reportStepIdx == 0) {
@@ -605,11 +1159,9 @@ protected:
     }
 
     void updateWellTopology_(unsigned reportStepIdx OPM_UNUSED,
-                             const WellCompletionsMap& wellCompletions,
-                             std::vector<bool>& gridDofIsPenetrated) const
+                             const WellCompletionsMap& wellCompletions) const
     {
         auto& model = simulator_.model();
-        const auto& gridManager = simulator_.gridManager();
 
         // first, remove all wells from the reservoir
         model.clearAuxiliaryModules();
@@ -622,38 +1174,21 @@ protected:
 
         //////
         // tell the active wells which DOFs they contain
-        const auto gridView = simulator_.gridManager().gridView();
-
-        gridDofIsPenetrated.resize(model.numGridDof());
-        std::fill(gridDofIsPenetrated.begin(), gridDofIsPenetrated.end(), false);
+        std::vector<std::pair<unsigned, const Completion_*> > perforatedElements;
+        perforatedElements_(perforatedElements, wellCompletions);
 
+        const auto& grid = simulator_.gridManager().grid();
+        const auto& elemSeeds = model.elementSeeds();
         ElementContext elemCtx(simulator_);
-        auto elemIt = gridView.template begin</*codim=*/0>();
-        const auto elemEndIt = gridView.template end</*codim=*/0>();
-        std::set<std::shared_ptr<Well> > wells;
-        for (; elemIt != elemEndIt; ++elemIt) {
-            const auto& elem = *elemIt;
-            if (elem.partitionType() != Dune::InteriorEntity)
-                continue; // non-local entities need to be skipped
-
+        for (unsigned i = 0; i < perforatedElements.size(); ++i) {
+#if DUNE_VERSION_NEWER(DUNE_GRID, 2, 4)
+            const Element& elem = grid.entity(elemSeeds[perforatedElements[i].first]);
+#else
+            const auto& elemPtr = grid.entity(elemSeeds[perforatedElements[i].first]);
+            const Element& elem = *elemPtr;
+#endif
             elemCtx.updateStencil(elem);
-            for (unsigned dofIdx = 0; dofIdx < elemCtx.numPrimaryDof(/*timeIdx=*/0); ++ dofIdx) {
-                unsigned globalDofIdx = elemCtx.globalSpaceIndex(dofIdx, /*timeIdx=*/0);
-                unsigned cartesianDofIdx = gridManager.cartesianIndex(globalDofIdx);
-
-                if (wellCompletions.count(cartesianDofIdx) == 0)
-                    // the current DOF is not contained in any well, so we must skip
-                    // it...
-                    continue;
-
-                gridDofIsPenetrated[globalDofIdx] = true;
-
-                auto eclWell = wellCompletions.at(cartesianDofIdx).second;
-                eclWell->addDof(elemCtx, dofIdx);
-
-                wells.insert(eclWell);
-            }
-            //////
+            perforatedElements[i].second->second->addDof(elemCtx, /*dofIdx=*/0);
         }
 
         // register all wells at the model as auxiliary equations
@@ -664,6 +1199,30 @@ protected:
         }
     }
 
+    // determine the well and the perforation of the well of each degree of freedom of
+    // the grid, so that the source terms do not need to search for them.
+    void updatePerforationIndex_()
+    {
+        unsigned numGridDof = simulator_.model().numGridDof();
+        dofWellIdx_.resize(numGridDof);
+        dofPerforationIdx_.resize(numGridDof);
+        std::fill(dofWellIdx_.begin(), dofWellIdx_.end(), -1);
+        std::fill(dofPerforationIdx_.begin(), dofPerforationIdx_.end(), 0);
+
+        for (unsigned wellIdx = 0; wellIdx < wells_.size(); ++wellIdx) {
+            const auto& well = wells_[wellIdx];
+            for (unsigned perfIdx = 0; perfIdx < well->numPerforatedDofs(); ++perfIdx) {
+                unsigned globalDofIdx = well->perforatedDofIndex(perfIdx);
+
+                // in this code we only support each cell to be part of at most a
+                // single well.
+                assert(dofWellIdx_[globalDofIdx] < 0);
+                dofWellIdx_[globalDofIdx] = static_cast<int>(wellIdx);
+                dofPerforationIdx_[globalDofIdx] = perfIdx;
+            }
+        }
+    }
+
     void computeWellCompletionsMap_(unsigned reportStepIdx OPM_UNUSED, WellCompletionsMap& cartesianIdxToCompletionMap)
     {
         const auto& eclState = simulator_.gridManager().eclState();
@@ -736,31 +1295,23 @@ protected:
 
         // associate the well completions with grid cells and register them in the
         // Peaceman well object
-        const auto& gridManager = simulator_.gridManager();
-        const GridView gridView = gridManager.gridView();
+        std::vector<std::pair<unsigned, const Completion_*> > perforatedElements;
+        perforatedElements_(perforatedElements, wellCompletions);
 
+        const auto& grid = simulator_.gridManager().grid();
+        const auto& elemSeeds = simulator_.model().elementSeeds();
         ElementContext elemCtx(simulator_);
-        auto elemIt = gridView.template begin</*codim=*/0>();
-        const auto elemEndIt = gridView.template end</*codim=*/0>();
-
-        for (; elemIt != elemEndIt; ++elemIt) {
-            const auto& elem = *elemIt;
-            if (elem.partitionType() != Dune::InteriorEntity)
-                continue; // non-local entities need to be skipped
-
+        for (unsigned i = 0; i < perforatedElements.size(); ++i) {
+#if DUNE_VERSION_NEWER(DUNE_GRID, 2, 4)
+            const Element& elem = grid.entity(elemSeeds[perforatedElements[i].first]);
+#else
+            const auto& elemPtr = grid.entity(elemSeeds[perforatedElements[i].first]);
+            const Element& elem = *elemPtr;
+#endif
             elemCtx.updateStencil(elem);
-            for (unsigned dofIdx = 0; dofIdx < elemCtx.numPrimaryDof(/*timeIdx=*/0); ++ dofIdx)
             {
-                assert( elemCtx.numPrimaryDof(/*timeIdx=*/0) == 1 );
-                unsigned globalDofIdx = elemCtx.globalSpaceIndex(dofIdx, /*timeIdx=*/0);
-                unsigned cartesianDofIdx = gridManager.cartesianIndex(globalDofIdx);
-
-                if (wellCompletions.count(cartesianDofIdx) == 0)
-                    // the current DOF is not contained in any well, so we must skip
-                    // it...
-                    continue;
-
-                const auto& compInfo = wellCompletions.at(cartesianDofIdx);
+                const unsigned dofIdx = 0;
+                const auto& compInfo = perforatedElements[i].second->second;
                 const Opm::Completion* completion = compInfo.first;
                 std::shared_ptr<Well> eclWell = compInfo.second;
                 eclWell->addDof(elemCtx, dofIdx);
@@ -796,7 +1347,21 @@ protected:
     Simulator& simulator_;
 
     std::vector<std::shared_ptr<Well> > wells_;
-    std::vector<bool> gridDofIsPenetrated_;
+    std::vector<unsigned> wellTaskOrder_;
+
+    // the position of each interior element in the list of element seeds of the model,
+    // and the grid for which it has been computed
+    mutable std::vector<int> elementSeedIdx_;
+    mutable int elementSeedIdxSeqNum_;
+
+    // the groups whose targets are distributed to their wells
+    std::vector<GroupControl_> groupControls_;
+
+    // the index of the well which perforates a degree of freedom of the grid (-1 if
+    // there is none) and the index of the corresponding perforation of the well
+    std::vector<int> dofWellIdx_;
+    std::vector<unsigned> dofPerforationIdx_;
+
     std::map<std::string, int> wellNameToIndex_;
     std::map<std::string, std::array<Scalar, numPhases> > wellTotalInjectedVolume_;
     std::map<std::string, std::array<Scalar, numPhases> > wellTotalProducedVolume_;
@@ -0,0 +1,363 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \copydoc Ewoms::EclWellObjective
+ */
+#ifndef EWOMS_ECL_WELL_OBJECTIVE_HH
+#define EWOMS_ECL_WELL_OBJECTIVE_HH
+
+#include "eclpeacemanwell.hh"
+
+#include <ewoms/common/propertysystem.hh>
+
+#include <opm/material/densead/Evaluation.hpp>
+#include <opm/material/densead/Math.hpp>
+
+#include <dune/common/fvector.hh>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Ewoms {
+namespace Properties {
+NEW_PROP_TAG(Scalar);
+NEW_PROP_TAG(FluidSystem);
+NEW_PROP_TAG(GlobalEqVector);
+NEW_PROP_TAG(NumEq);
+}
+
+/*!
+ * \ingroup EclBlackOilSimulator
+ *
+ * \brief The contribution of the wells to an objective function at the end of a time
+ *        step.
+ *
+ * The quantities of a well are passed as automatic differentiation objects: The
+ * bottom hole pressure is seeded with derivative 0 and the surface rate of a phase with
+ * derivative 1 + phaseIdx. The partial derivatives of the returned value thus are the
+ * ones of the objective function w.r.t. these quantities.
+ */
+template <class Scalar, int numPhases>
+class EclWellObjectiveTerm
+{
+public:
+    typedef Opm::DenseAd::Evaluation<Scalar, 1 + numPhases> Evaluation;
+
+    virtual ~EclWellObjectiveTerm()
+    {}
+
+    /*!
+     * \brief Evaluate the contribution of a well to the objective function.
+     *
+     * \param wellName The name of the well
+     * \param bottomHolePressure The bottom hole pressure of the well [Pa]
+     * \param surfaceRates The surface rates of the phases [m^3/s], positive for injection
+     * \param time The time at the end of the time step [s]
+     */
+    virtual Evaluation evaluate(const std::string& wellName,
+                                const Evaluation& bottomHolePressure,
+                                const std::array<Evaluation, numPhases>& surfaceRates,
+                                Scalar time) const = 0;
+};
+
+/*!
+ * \ingroup EclBlackOilSimulator
+ *
+ * \brief The weighted squared mismatch of the bottom hole pressures and surface rates
+ *        of the wells against observed data.
+ *
+ * The observations of a well apply to a point in time. Quantities which have not been
+ * observed may be specified as NaN, wells and times without observations do not
+ * contribute to the objective function.
+ */
+template <class Scalar, int numPhases>
+class EclWellMismatchTerm : public EclWellObjectiveTerm<Scalar, numPhases>
+{
+    typedef EclWellObjectiveTerm<Scalar, numPhases> ParentType;
+    typedef typename ParentType::Evaluation Evaluation;
+
+    struct Observation_
+    {
+        Scalar time;
+        Scalar bottomHolePressure;
+        std::array<Scalar, numPhases> surfaceRates;
+    };
+
+public:
+    EclWellMismatchTerm()
+    {
+        bottomHolePressureWeight_ = 0.0;
+        std::fill(surfaceRateWeights_.begin(), surfaceRateWeights_.end(), 0.0);
+        timeTolerance_ = 1.0;
+    }
+
+    /*!
+     * \brief Set the weights of the squared mismatch of the bottom hole pressure and of
+     *        the surface rates of each phase.
+     */
+    void setWeights(Scalar bottomHolePressureWeight,
+                    const std::array<Scalar, numPhases>& surfaceRateWeights)
+    {
+        bottomHolePressureWeight_ = bottomHolePressureWeight;
+        surfaceRateWeights_ = surfaceRateWeights;
+    }
+
+    /*!
+     * \brief Set the maximum difference between the end of a time step and the time of
+     *        an observation for the observation to apply [s].
+     */
+    void setTimeTolerance(Scalar value)
+    { timeTolerance_ = value; }
+
+    /*!
+     * \brief Add the observed quantities of a well at a given time.
+     *
+     * The surface rates use the sign convention of the well manager, i.e., they are
+     * positive for injection.
+     */
+    void addObservation(const std::string& wellName,
+                        Scalar time,
+                        Scalar bottomHolePressure,
+                        const std::array<Scalar, numPhases>& surfaceRates)
+    {
+        Observation_ obs;
+        obs.time = time;
+        obs.bottomHolePressure = bottomHolePressure;
+        obs.surfaceRates = surfaceRates;
+
+        observations_[wellName].push_back(obs);
+    }
+
+    /*!
+     * \copydoc EclWellObjectiveTerm::evaluate
+     */
+    virtual Evaluation evaluate(const std::string& wellName,
+                                const Evaluation& bottomHolePressure,
+                                const std::array<Evaluation, numPhases>& surfaceRates,
+                                Scalar time) const
+    {
+        Evaluation result = 0.0;
+
+        const Observation_* obs = findObservation_(wellName, time);
+        if (!obs)
+            return result;
+
+        if (!std::isnan(obs->bottomHolePressure)) {
+            Evaluation delta = bottomHolePressure - obs->bottomHolePressure;
+            result += bottomHolePressureWeight_*delta*delta;
+        }
+
+        for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++phaseIdx) {
+            if (std::isnan(obs->surfaceRates[phaseIdx]))
+                continue;
+
+            Evaluation delta = surfaceRates[phaseIdx] - obs->surfaceRates[phaseIdx];
+            result += surfaceRateWeights_[phaseIdx]*delta*delta;
+        }
+
+        return result;
+    }
+
+private:
+    // returns the observation of a well which is closest to a given time if it is
+    // within the tolerance
+    const Observation_* findObservation_(const std::string& wellName, Scalar time) const
+    {
+        auto wellIt = observations_.find(wellName);
+        if (wellIt == observations_.end())
+            return 0;
+
+        const Observation_* result = 0;
+        Scalar minDist = timeTolerance_;
+        for (const auto& obs : wellIt->second) {
+            Scalar dist = std::abs(obs.time - time);
+            if (dist <= minDist) {
+                minDist = dist;
+                result = &obs;
+            }
+        }
+        return result;
+    }
+
+    Scalar bottomHolePressureWeight_;
+    std::array<Scalar, numPhases> surfaceRateWeights_;
+    Scalar timeTolerance_;
+
+    std::map<std::string, std::vector<Observation_> > observations_;
+};
+
+/*!
+ * \ingroup EclBlackOilSimulator
+ *
+ * \brief Evaluates an objective function which depends on the quantities of the wells
+ *        and records its derivatives w.r.t. the solution of each time step.
+ *
+ * The objective function is the sum of all terms over all wells and time steps. It is
+ * evaluated while the pressures and rates of the wells are gathered for the summary
+ * output (cf. EclWellManager::computeRateTable()), so no additional pass over the
+ * wells is required. Since the wells only affect a small number of degrees of freedom,
+ * the derivatives of each time step are stored in a sparse format. They can be added to
+ * the right hand side of the adjoint equations by passing this object to
+ * FvBaseAdjointDriver::run().
+ */
+template <class TypeTag>
+class EclWellObjective
+{
+    typedef typename GET_PROP_TYPE(TypeTag, Scalar) Scalar;
+    typedef typename GET_PROP_TYPE(TypeTag, FluidSystem) FluidSystem;
+    typedef typename GET_PROP_TYPE(TypeTag, GlobalEqVector) GlobalEqVector;
+
+    typedef EclPeacemanWell<TypeTag> Well;
+
+    enum { numEq = GET_PROP_VALUE(TypeTag, NumEq) };
+    enum { numPhases = FluidSystem::numPhases };
+
+    typedef Dune::FieldVector<Scalar, numEq> EqVector;
+    typedef std::vector<std::pair<unsigned, EqVector> > SparseGradient;
+
+    struct StepRecord_
+    {
+        Scalar value;
+        SparseGradient gradient;
+    };
+
+public:
+    typedef EclWellObjectiveTerm<Scalar, numPhases> Term;
+    typedef typename Term::Evaluation Evaluation;
+
+    EclWellObjective()
+    {
+        curStepIdx_ = 0;
+        curTime_ = 0.0;
+    }
+
+    /*!
+     * \brief Add a term to the objective function.
+     */
+    void addTerm(std::shared_ptr<const Term> term)
+    { terms_.push_back(term); }
+
+    /*!
+     * \brief Returns true iff the objective function has no terms.
+     */
+    bool empty() const
+    { return terms_.empty(); }
+
+    /*!
+     * \brief Remove the values and derivatives of all time steps.
+     */
+    void clear()
+    { records_.clear(); }
+
+    /*!
+     * \brief Start the evaluation of the objective function after a time step.
+     *
+     * The step index 0 denotes the initial solution. If a time step is evaluated
+     * again, e.g., because it is recomputed by the adjoint driver, the previous results
+     * for the step are replaced.
+     */
+    void beginStep(unsigned stepIdx, Scalar time)
+    {
+        curStepIdx_ = stepIdx;
+        curTime_ = time;
+        auto& record = records_[stepIdx];
+        record.value = 0.0;
+        record.gradient.clear();
+    }
+
+    /*!
+     * \brief Evaluate the terms of the objective function for a well.
+     *
+     * This is supposed to be called for all wells between beginStep() and the next
+     * call to beginStep().
+     */
+    void addWell(const Well& well)
+    {
+        if (terms_.empty())
+            return;
+
+        Evaluation bhp(well.bottomHolePressure());
+        bhp.setDerivative(0, 1.0);
+
+        std::array<Evaluation, numPhases> surfaceRates;
+        for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++phaseIdx) {
+            surfaceRates[phaseIdx] = well.surfaceRate(phaseIdx);
+            surfaceRates[phaseIdx].setDerivative(1 + phaseIdx, 1.0);
+        }
+
+        Evaluation wellObjective = 0.0;
+        for (const auto& term : terms_)
+            wellObjective += term->evaluate(well.name(), bhp, surfaceRates, curTime_);
+
+        auto& record = records_[curStepIdx_];
+        record.value += wellObjective.value();
+        well.addObjectiveGradient(record.gradient, wellObjective);
+    }
+
+    /*!
+     * \brief Returns the value of the objective function, i.e., the sum of the values
+     *        of all time steps which have been evaluated.
+     */
+    Scalar value() const
+    {
+        Scalar result = 0.0;
+        for (const auto& record : records_)
+            result += record.second.value;
+        return result;
+    }
+
+    /*!
+     * \brief Add the derivatives of the objective function w.r.t. the solution after a
+     *        time step to a vector.
+     *
+     * This method has the signature required by FvBaseAdjointDriver::run().
+     */
+    void operator()(GlobalEqVector& gradient, unsigned stepIdx) const
+    {
+        auto it = records_.find(stepIdx);
+        if (it == records_.end())
+            return;
+
+        for (const auto& entry : it->second.gradient)
+            gradient[entry.first] += entry.second;
+    }
+
+private:
+    std::vector<std::shared_ptr<const Term> > terms_;
+    std::map<unsigned, StepRecord_> records_;
+
+    unsigned curStepIdx_;
+    Scalar curTime_;
+};
+
+} // namespace Ewoms
+
+#endif
@@ -32,6 +32,7 @@
 
 #include "ertwrappers.hh"
 #include "collecttoiorank.hh"
+#include "eclasyncwriter.hh"
 
 #include <ewoms/disc/ecfv/ecfvdiscretization.hh>
 #include <ewoms/io/baseoutputwriter.hh>
@@ -43,6 +44,7 @@
 #include <boost/algorithm/string.hpp>
 
 #include <list>
+#include <memory>
 #include <utility>
 #include <string>
 #include <limits>
@@ -139,6 +141,7 @@ public:
         , collectToIORank_( simulator_.gridManager() )
     {
         reportStepIdx_ = 0;
+        asyncWriter_ = nullptr;
     }
 
     ~EclWriter()
@@ -152,6 +155,17 @@ public:
     std::string caseName() const
     { return boost::to_upper_copy(simulator_.problem().name()); }
 
+    /*!
+     * \brief Write the restart files using a background thread.
+     *
+     * If the background thread of the asynchronous writer is running, endWrite() only
+     * gathers the attached fields and hands them over to it. The asynchronous writer
+     * must live at least as long as the EclWriter. Passing a null pointer switches back
+     * to writing synchronously.
+     */
+    void setAsyncWriter(EclAsyncWriter* asyncWriter)
+    { asyncWriter_ = asyncWriter; }
+
     /*!
      * \brief Updates the internal data structures after mesh
      *        refinement.
@@ -261,27 +275,41 @@ public:
                   "The ERT libraries must be available to write ECL output!");
 #else
 
-        // collect all data to I/O rank and store in attachedBuffers_
-        // this also reorders the data such that it fits the underlying eclGrid
-        collectToIORank_.collect( attachedBuffers_ );
+        if (asyncWriter_ && asyncWriter_->isEnabled()) {
+            endAsyncWrite_();
+            return;
+        }
 
         // write output on I/O rank
+        std::unique_ptr<ErtRestartFile> restartFile;
+        std::unique_ptr<ErtSolution> solution;
         if (collectToIORank_.isIORank()) {
-            ErtRestartFile restartFile(simulator_, reportStepIdx_);
-            restartFile.writeHeader(simulator_, reportStepIdx_);
-
-            ErtSolution solution(restartFile);
-            auto bufIt = attachedBuffers_.begin();
-            const auto& bufEndIt = attachedBuffers_.end();
-            for (; bufIt != bufEndIt; ++ bufIt) {
-                const std::string& name = bufIt->first;
-                const ScalarBuffer& buffer = *bufIt->second;
-
-                std::shared_ptr<const ErtKeyword<float>>
-                    bufKeyword(new ErtKeyword<float>(name, buffer));
-                solution.add(bufKeyword);
-            }
+            restartFile.reset(new ErtRestartFile(simulator_, reportStepIdx_));
+            restartFile->writeHeader(simulator_, reportStepIdx_);
+            solution.reset(new ErtSolution(*restartFile));
+        }
+
+        // the fields are gathered on the I/O rank and written one after another, so
+        // that the I/O rank only needs to hold a single field of the global grid at a
+        // time. the gathering also reorders the data such that it fits the underlying
+        // eclGrid. the values are directly gathered into the storage of the ERT
+        // keyword, which is released as soon as it has been written.
+        auto bufIt = attachedBuffers_.begin();
+        const auto& bufEndIt = attachedBuffers_.end();
+        for (; bufIt != bufEndIt; ++ bufIt) {
+            const std::string& name = bufIt->first;
+            const ScalarBuffer& buffer = *bufIt->second;
+
+            ErtKeyword<float> bufKeyword;
+            if (collectToIORank_.isIORank())
+                bufKeyword.allocate(name, collectToIORank_.globalFieldSize(buffer.size()));
+            collectToIORank_.collectFieldTo(buffer, bufKeyword.data());
+
+            if (collectToIORank_.isIORank())
+                solution->add(bufKeyword);
         }
+        solution.reset();
+        restartFile.reset();
 
         // detach all buffers
         attachedBuffers_.clear();
@@ -317,6 +345,60 @@ private:
     static bool enableEclOutput_()
     { return EWOMS_GET_PARAM(TypeTag, bool, EnableEclOutput); }
 
+#if HAVE_ERT
+    // gather all attached fields on the I/O rank and let the background thread write
+    // them. In contrast to the synchronous code path, the I/O rank thus has to hold all
+    // fields of the global grid until the restart file is written. the fields are
+    // directly gathered into the storage of the ERT keywords which are written.
+    void endAsyncWrite_()
+    {
+        typedef std::list<std::shared_ptr<const ErtKeyword<float> > > KeywordList;
+        std::shared_ptr<KeywordList> keywords(new KeywordList);
+
+        auto bufIt = attachedBuffers_.begin();
+        const auto& bufEndIt = attachedBuffers_.end();
+        for (; bufIt != bufEndIt; ++ bufIt) {
+            const std::string& name = bufIt->first;
+            const ScalarBuffer& buffer = *bufIt->second;
+
+            float* globalData = nullptr;
+            if (collectToIORank_.isIORank()) {
+                std::shared_ptr<ErtKeyword<float> > keyword(new ErtKeyword<float>);
+                keyword->allocate(name, collectToIORank_.globalFieldSize(buffer.size()));
+                globalData = keyword->data();
+                keywords->push_back(keyword);
+            }
+            collectToIORank_.collectFieldTo(buffer, globalData);
+        }
+        attachedBuffers_.clear();
+
+        if (collectToIORank_.isIORank()) {
+            // everything which is needed to write the report step is copied because the
+            // simulator changes while the file is written
+            const Opm::EclipseState* eclState = &simulator_.gridManager().eclState();
+            std::string caseName = simulator_.gridManager().caseName();
+            double startTime = simulator_.startTime();
+            double secondsElapsed = simulator_.time() + simulator_.timeStepSize();
+            unsigned reportStepIdx = reportStepIdx_;
+
+            asyncWriter_->submit([=]()
+            {
+                ErtRestartFile restartFile(caseName, reportStepIdx);
+                restartFile.writeHeader(*eclState, startTime, secondsElapsed, reportStepIdx);
+
+                ErtSolution solution(restartFile);
+                auto keywordIt = keywords->begin();
+                const auto& keywordEndIt = keywords->end();
+                for (; keywordIt != keywordEndIt; ++ keywordIt)
+                    solution.add(**keywordIt);
+            });
+        }
+
+        // next time we take the next report step
+        ++ reportStepIdx_;
+    }
+#endif
+
     // make sure the field is well defined if running under valgrind
     // and make sure that all values can be displayed by paraview
     void sanitizeBuffer_(std::vector<float>& b)
@@ -348,6 +430,8 @@ private:
     double curTime_;
     unsigned reportStepIdx_;
 
+    EclAsyncWriter* asyncWriter_;
+
     std::list<std::pair<std::string, ScalarBuffer*> > attachedBuffers_;
 };
 } // namespace Ewoms
@@ -46,6 +46,7 @@
 #include <ert/ecl/ecl_rst_file.h>
 #include <ert/ecl_well/well_const.h>
 
+#include <opm/parser/eclipse/EclipseState/EclipseState.hpp>
 #include <opm/parser/eclipse/EclipseState/Grid/EclipseGrid.hpp>
 
 #include <opm/common/Valgrind.hpp>
@@ -142,6 +143,37 @@ public:
 #endif
     }
 
+    /*!
+     * \brief Allocate the storage of a keyword without initializing it.
+     *
+     * The values can be set via data(). This avoids copying the values if they can be
+     * computed in place.
+     */
+    void allocate(const std::string& name, size_t size)
+    {
+#if HAVE_ERT
+        if(ertHandle_)
+            ecl_kw_free(ertHandle_);
+
+        name_ = name;
+        ertHandle_ = ecl_kw_alloc(name.c_str(), size, ertType_());
+#endif
+    }
+
+    /*!
+     * \brief Returns a pointer to the values of the keyword.
+     *
+     * This is a null pointer if the keyword has not been allocated.
+     */
+    T* data()
+    {
+#if HAVE_ERT
+        if (ertHandle_)
+            return static_cast<T*>(ecl_kw_get_ptr(ertHandle_));
+#endif
+        return nullptr;
+    }
+
     // special case for string keywords
     void set(const std::string name, const std::vector<const char*>& data)
     {
@@ -252,14 +284,13 @@ public:
             actnumData[cartElemIdx] = 1;
         }
 
-        // conversion to deck units
-        deckUnits.siToDeck(mapaxesData, DeckUnits::length);
-        deckUnits.siToDeck(coordData, DeckUnits::length);
-        deckUnits.siToDeck(zcornData, DeckUnits::length);
-
-        ErtKeyword<float> mapaxesKeyword("MAPAXES", mapaxesData);
-        ErtKeyword<float> coordKeyword("COORD", coordData);
-        ErtKeyword<float> zcornKeyword("ZCORN", zcornData);
+        // the values are converted to deck units while they are copied to the keywords
+        ErtKeyword<float> mapaxesKeyword;
+        ErtKeyword<float> coordKeyword;
+        ErtKeyword<float> zcornKeyword;
+        setLengthKeyword_(mapaxesKeyword, "MAPAXES", mapaxesData, deckUnits);
+        setLengthKeyword_(coordKeyword, "COORD", coordData, deckUnits);
+        setLengthKeyword_(zcornKeyword, "ZCORN", zcornData, deckUnits);
         ErtKeyword<int> actnumKeyword("ACTNUM", actnumData);
 
         ertHandle_ = ecl_grid_alloc_GRDECL_kw(nx, ny, nz,
@@ -295,6 +326,18 @@ public:
     { return ertHandle_; }
 
 private:
+#if HAVE_ERT
+    template <class DeckUnits>
+    static void setLengthKeyword_(ErtKeyword<float>& keyword,
+                                  const std::string& name,
+                                  const std::vector<double>& siData,
+                                  const DeckUnits& deckUnits)
+    {
+        keyword.allocate(name, siData.size());
+        deckUnits.siToDeck(siData.data(), keyword.data(), siData.size(), DeckUnits::length);
+    }
+#endif // HAVE_ERT
+
     ErtHandleType *ertHandle_;
 };
 
@@ -315,20 +358,13 @@ public:
 
     template <class Simulator>
     ErtRestartFile(const Simulator& simulator, unsigned reportStepIdx)
-    {
-        std::string caseName = simulator.gridManager().caseName();
-
-        restartFileName_ = ecl_util_alloc_filename("./",
-                                                   caseName.c_str(),
-                                                   /*type=*/ECL_UNIFIED_RESTART_FILE,
-                                                   /*writeFormatedOutput=*/false,
-                                                   reportStepIdx);
+    { open_(simulator.gridManager().caseName(), reportStepIdx); }
 
-        if (reportStepIdx == 0)
-            restartFileHandle_ = ecl_rst_file_open_write(restartFileName_);
-        else
-            restartFileHandle_ = ecl_rst_file_open_append(restartFileName_);
-    }
+    /*!
+     * \brief Open the restart file of a given case without accessing the simulator.
+     */
+    ErtRestartFile(const std::string& caseName, unsigned reportStepIdx)
+    { open_(caseName, reportStepIdx); }
 
     ~ErtRestartFile()
     {
@@ -346,15 +382,30 @@ public:
     template <class Simulator>
     void writeHeader(const Simulator& simulator, unsigned reportStepIdx)
     {
-        const auto& eclGrid = simulator.gridManager().eclState().getInputGrid();
-        const auto& eclState = simulator.gridManager().eclState();
+        writeHeader(simulator.gridManager().eclState(),
+                    simulator.startTime(),
+                    simulator.time() + simulator.timeStepSize(),
+                    reportStepIdx);
+    }
+
+    /*!
+     * \brief Write the header for the current report step.
+     *
+     * In contrast to the method above, this does not access the simulator, i.e., it
+     * can be called while the simulation proceeds.
+     */
+    void writeHeader(const Opm::EclipseState& eclState,
+                     double startTime,
+                     double secondsElapsed,
+                     unsigned reportStepIdx)
+    {
+        const auto& eclGrid = eclState.getInputGrid();
         const auto& eclSchedule = eclState.getSchedule();
 
-        double secondsElapsed = simulator.time() + simulator.timeStepSize();
         double daysElapsed = secondsElapsed/(24*60*60);
 
         ecl_rsthead_type rstHeader;
-        rstHeader.sim_time = simulator.startTime() + secondsElapsed;
+        rstHeader.sim_time = startTime + secondsElapsed;
         rstHeader.nactive = eclGrid.getNumActive();
         rstHeader.nx = eclGrid.getNX();
         rstHeader.ny = eclGrid.getNY();
@@ -395,6 +446,20 @@ public:
     { return restartFileHandle_; }
 
 private:
+    void open_(const std::string& caseName, unsigned reportStepIdx)
+    {
+        restartFileName_ = ecl_util_alloc_filename("./",
+                                                   caseName.c_str(),
+                                                   /*type=*/ECL_UNIFIED_RESTART_FILE,
+                                                   /*writeFormatedOutput=*/false,
+                                                   reportStepIdx);
+
+        if (reportStepIdx == 0)
+            restartFileHandle_ = ecl_rst_file_open_write(restartFileName_);
+        else
+            restartFileHandle_ = ecl_rst_file_open_append(restartFileName_);
+    }
+
     void appendIwelData_(std::vector<int>& iwelData,
                          const Opm::Well* eclWell,
                          size_t reportStepIdx) const
@@ -539,6 +604,16 @@ public:
         ecl_rst_file_add_kw(restartHandle_->ertHandle(), ertKeyword->ertHandle());
     }
 
+    /*!
+     * \brief Write a keyword to the solution section without keeping it alive.
+     *
+     * The keyword is written immediately, so it may be destroyed as soon as this
+     * method returns.
+     */
+    template <typename T>
+    void add(const ErtKeyword<T>& ertKeyword)
+    { ecl_rst_file_add_kw(restartHandle_->ertHandle(), ertKeyword.ertHandle()); }
+
     ecl_rst_file_type *ertHandle() const
     { return restartHandle_->ertHandle(); }
 
@@ -547,6 +622,91 @@ private:
     std::list<std::shared_ptr<const ErtBaseKeyword>> attachedKeywords_;
 };
 
+/**
+ * \ingroup EclBlackOilSimulator
+ *
+ * \brief The ErtRestartReader class wraps an ECL restart file which is opened for
+ *        reading the cell data of a single report step.
+ *
+ * Both, unified (UNRST) and non-unified (Xnnnn) restart files are supported. The
+ * report step is identified by the SEQNUM keyword which starts each block of the
+ * file.
+ */
+class ErtRestartReader
+{
+public:
+    ErtRestartReader(const ErtRestartReader&) = delete;
+
+    ErtRestartReader(const std::string& fileName, int reportStepIdx)
+    {
+        fileHandle_ = ecl_file_open(fileName.c_str(), /*flags=*/0);
+        if (!fileHandle_)
+            OPM_THROW(std::runtime_error,
+                      "Could not open the ECL restart file '" << fileName << "'");
+
+        // find the block of the requested report step
+        blockIdx_ = -1;
+        int numBlocks = ecl_file_get_num_named_kw(fileHandle_, "SEQNUM");
+        for (int blockIdx = 0; blockIdx < numBlocks; ++blockIdx) {
+            ecl_kw_type* seqnumKw = ecl_file_iget_named_kw(fileHandle_, "SEQNUM", blockIdx);
+            if (ecl_kw_iget_int(seqnumKw, 0) == reportStepIdx) {
+                blockIdx_ = blockIdx;
+                break;
+            }
+        }
+
+        if (blockIdx_ < 0) {
+            ecl_file_close(fileHandle_);
+            OPM_THROW(std::runtime_error,
+                      "The ECL restart file '" << fileName << "' does not contain "
+                      "report step " << reportStepIdx);
+        }
+    }
+
+    ~ErtRestartReader()
+    { ecl_file_close(fileHandle_); }
+
+    /*!
+     * \brief Returns true iff the report step contains a given keyword.
+     */
+    bool hasKeyword(const std::string& name) const
+    { return ecl_file_get_num_named_kw(fileHandle_, name.c_str()) > blockIdx_; }
+
+    /*!
+     * \brief Extract the values of a keyword for a subset of the active cells.
+     *
+     * The values are stored at the position of the corresponding active cell in the
+     * result, i.e., activeIndex[i] is the index of the value in the active cells of
+     * the restart file which is stored at position i. Only these values are
+     * converted.
+     */
+    template <class Scalar>
+    void readCellData(std::vector<Scalar>& result,
+                      const std::string& name,
+                      const std::vector<int>& activeIndex) const
+    {
+        if (!hasKeyword(name))
+            OPM_THROW(std::runtime_error,
+                      "The ECL restart file does not contain the keyword " << name);
+
+        ecl_kw_type* kw = ecl_file_iget_named_kw(fileHandle_, name.c_str(), blockIdx_);
+        int kwSize = ecl_kw_get_size(kw);
+
+        result.resize(activeIndex.size());
+        for (size_t i = 0; i < activeIndex.size(); ++i) {
+            if (activeIndex[i] < 0 || activeIndex[i] >= kwSize)
+                OPM_THROW(std::runtime_error,
+                          "The keyword " << name << " of the ECL restart file is too "
+                          "small for the grid");
+            result[i] = static_cast<Scalar>(ecl_kw_iget_as_double(kw, activeIndex[i]));
+        }
+    }
+
+private:
+    ecl_file_type* fileHandle_;
+    int blockIdx_;
+};
+
 /**
  * \ingroup EclBlackOilSimulator
  *
@@ -31,6 +31,8 @@
 
 #include <ewoms/disc/common/fvbaseproperties.hh>
 
+#include <opm/common/Unused.hpp>
+
 #include <set>
 #include <vector>
 
@@ -112,11 +114,52 @@ public:
      */
     virtual void applyInitial() = 0;
 
+    /*!
+     * \brief Evaluate the quantities which are required by the next call to
+     *        linearize() or linearizeResidual().
+     *
+     * The linearizer calls this method for all auxiliary modules before any of them is
+     * linearized. Since this is done by multiple threads concurrently, it must not
+     * modify any object which is shared with other modules, e.g. the global Jacobian
+     * matrix or the residual. Modules which do the expensive part of their
+     * linearization here only need to add the results to the global system in
+     * linearize(), which is called serially. By default, nothing is done.
+     *
+     * \param residualOnly Specifies whether linearizeResidual() will be called instead
+     *                     of linearize()
+     */
+    virtual void prepareLinearization(bool residualOnly OPM_UNUSED)
+    { }
+
     /*!
      * \brief Linearize the auxiliary equation.
      */
     virtual void linearize(JacobianMatrix& matrix, GlobalEqVector& residual) = 0;
 
+    /*!
+     * \brief Linearize the auxiliary equation if only the residual of the global system
+     *        of equations is required.
+     *
+     * Only the residual is reset before this method is called, i.e., modules which add
+     * their contributions to the existing entries of the Jacobian matrix must not modify
+     * it here. By default, the full linearization is done.
+     */
+    virtual void linearizeResidual(JacobianMatrix& matrix, GlobalEqVector& residual)
+    { linearize(matrix, residual); }
+
+    /*!
+     * \brief Update the unknowns which the module has eliminated from the global system
+     *        of equations after the system has been solved.
+     *
+     * This is only relevant for modules which do not add their unknowns to the global
+     * system, but which condense them into the equations of the grid DOFs. The
+     * solution of the global system is updated by subtracting the specified vector. It
+     * may be called multiple times for the same linearization, e.g. by a line search.
+     * By default, nothing is done.
+     */
+    virtual void updateEliminatedUnknowns(const GlobalEqVector& solutionUpdate OPM_UNUSED)
+    { }
+
 private:
     int dofOffset_;
 };
@@ -90,6 +90,15 @@ NEW_PROP_TAG(GridGlobalRefinements);
 //! parameters should to be loaded from
 NEW_PROP_TAG(ParameterFile);
 
+/*!
+ * \brief Specifies whether grid files should be cached in a binary format.
+ *
+ * If this is enabled, grid managers which read text files (e.g. DGF) store the
+ * grid next to the file once it is loaded and use this copy if it is not older
+ * than the file. This requires the grid to provide backup and restore facilities.
+ */
+NEW_PROP_TAG(EnableGridCache);
+
 /*!
  * \brief Print all properties on startup?
  *
@@ -115,9 +124,36 @@ NEW_PROP_TAG(InitialTimeStepSize);
 //! The default value for the simulation's restart time
 NEW_PROP_TAG(RestartTime);
 
+//! The format of the restart files which are written ('text', 'binary' or 'collective')
+NEW_PROP_TAG(RestartFormat);
+
+//! The maximum number of forked processes which write restart files in the background
+NEW_PROP_TAG(RestartWriterProcesses);
+
 //! The name of the file with a number of forced time step lengths
 NEW_PROP_TAG(PredeterminedTimeStepsFile);
 
+//! Specify whether the time spent in the profiled regions of the code is measured
+NEW_PROP_TAG(EnableProfiling);
+
+//! The name of the file to which the trace of the profiled regions is written
+NEW_PROP_TAG(ProfilingTraceFile);
+
+//! Specify whether the hardware performance counters are read in the profiled regions
+NEW_PROP_TAG(ProfilingHardwareCounters);
+
+//! Specify whether the memory used by the big data structures is reported
+NEW_PROP_TAG(EnableMemoryReport);
+
+//! The sink to which the metrics of each time step are sent while the simulation runs
+NEW_PROP_TAG(MetricsSink);
+
+//! The file to which the timings and iteration counts of the run are written at its end
+NEW_PROP_TAG(PerformanceRecordFile);
+
+//! Specify whether fast approximations of exp(), log() and pow() are used by the models
+NEW_PROP_TAG(EnableFastMath);
+
 ///////////////////////////////////
 // Values for the properties
 ///////////////////////////////////
@@ -146,6 +182,9 @@ SET_TYPE_PROP(NumericModel, GridManager, Ewoms::DgfGridManager<TypeTag>);
 //! Set a value for the GridFile property
 SET_STRING_PROP(NumericModel, GridFile, "");
 
+//! Always read the grid files by default
+SET_BOOL_PROP(NumericModel, EnableGridCache, false);
+
 #if HAVE_DUNE_FEM
 SET_PROP(NumericModel, GridPart)
 {
@@ -184,9 +223,36 @@ SET_SCALAR_PROP(NumericModel, InitialTimeStepSize, -1e35);
 //! The default value for the simulation's restart time
 SET_SCALAR_PROP(NumericModel, RestartTime, -1e35);
 
+//! By default, restart files are written in the text format
+SET_STRING_PROP(NumericModel, RestartFormat, "text");
+
+//! By default, restart files are written synchronously
+SET_INT_PROP(NumericModel, RestartWriterProcesses, 0);
+
 //! By default, do not force any time steps
 SET_STRING_PROP(NumericModel, PredeterminedTimeStepsFile, "");
 
+//! By default, the profiler is disabled
+SET_BOOL_PROP(NumericModel, EnableProfiling, false);
+
+//! By default, no trace of the profiled regions is written
+SET_STRING_PROP(NumericModel, ProfilingTraceFile, "");
+
+//! By default, the hardware performance counters are not read
+SET_BOOL_PROP(NumericModel, ProfilingHardwareCounters, false);
+
+//! By default, the memory usage is reported after the setup and at the end
+SET_BOOL_PROP(NumericModel, EnableMemoryReport, true);
+
+//! By default, the metrics are not reported while the simulation runs
+SET_STRING_PROP(NumericModel, MetricsSink, "");
+
+//! By default, no performance record is written
+SET_STRING_PROP(NumericModel, PerformanceRecordFile, "");
+
+//! By default, the exact versions of exp(), log() and pow() are used
+SET_BOOL_PROP(NumericModel, EnableFastMath, false);
+
 } // namespace Properties
 } // namespace Ewoms
 
@@ -0,0 +1,377 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \brief Fast approximations of exp(), log() and pow() for scalars and automatic
+ *        differentiation evaluations.
+ *
+ * \copydoc Ewoms::MathKernels
+ */
+#ifndef EWOMS_FAST_MATH_HH
+#define EWOMS_FAST_MATH_HH
+
+#include <opm/material/densead/Evaluation.hpp>
+#include <opm/material/densead/Math.hpp>
+#include <opm/material/common/MathToolbox.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+namespace Ewoms {
+namespace FastMath {
+
+/*!
+ * \brief The largest relative error of the approximations in the range where the
+ *        result is a normal floating point number.
+ *
+ * For pow(), the error of the logarithm is amplified by the magnitude of
+ * y*log(x), so the guaranteed bound is only reached if the result is within a
+ * few orders of magnitude of one.
+ */
+inline double maxRelativeError()
+{ return 1e-14; }
+
+//! \cond SKIP_THIS
+namespace Detail {
+inline double fromBits(uint64_t bits)
+{
+    double result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+inline uint64_t toBits(double x)
+{
+    uint64_t result;
+    std::memcpy(&result, &x, sizeof(result));
+    return result;
+}
+
+// returns x^n for integral exponents by repeated squaring
+inline double powi(double x, unsigned n)
+{
+    double result = 1.0;
+    while (n > 0) {
+        if (n & 1)
+            result *= x;
+        x *= x;
+        n >>= 1;
+    }
+    return result;
+}
+
+// the tables of the approximations. they are computed using the functions of the
+// standard library when they are used for the first time.
+struct Tables
+{
+    enum { tableBits = 7 };
+    enum { tableSize = 1 << tableBits };
+
+    static const Tables& instance()
+    {
+        static const Tables tables;
+        return tables;
+    }
+
+    // 2^(i/tableSize)
+    double exp2[tableSize];
+
+    // the centers c_i = 1 + (i + 1/2)/tableSize of the intervals of the mantissa,
+    // their reciprocals and their logarithms
+    double center[tableSize];
+    double invCenter[tableSize];
+    double logCenter[tableSize];
+
+private:
+    Tables()
+    {
+        for (unsigned i = 0; i < tableSize; ++i) {
+            exp2[i] = std::exp2(static_cast<double>(i)/tableSize);
+            center[i] = 1.0 + (i + 0.5)/tableSize;
+            invCenter[i] = 1.0/center[i];
+            logCenter[i] = std::log(center[i]);
+        }
+    }
+};
+} // namespace Detail
+//! \endcond
+
+/*!
+ * \brief Approximates the exponential function.
+ *
+ * The argument is reduced to x = (k + i/128)*ln(2) + r with |r| <= ln(2)/256. 2^(i/128)
+ * is taken from a table and e^r is approximated by a polynomial of degree 5.
+ */
+inline double exp(double x)
+{
+    if (!(std::abs(x) < 700.0))
+        return std::exp(x); // large arguments, overflows, underflows and NaNs
+
+    const Detail::Tables& tables = Detail::Tables::instance();
+    const double invLn2N = 1.4426950408889634*Detail::Tables::tableSize;
+    // ln(2)/tableSize split into a part which can be exactly multiplied by k and the
+    // rest
+    const double ln2hiN = 6.93147180369123816490e-01/Detail::Tables::tableSize;
+    const double ln2loN = 1.90821492927058770002e-10/Detail::Tables::tableSize;
+    // adding this rounds to an integer which is stored in the lower bits
+    const double shift = 6755399441055744.0; // 1.5*2^52
+
+    double kd = x*invLn2N + shift;
+    int64_t ki = static_cast<int64_t>(Detail::toBits(kd) - Detail::toBits(shift));
+    kd -= shift;
+    double r = (x - kd*ln2hiN) - kd*ln2loN;
+
+    // 2^(ki/tableSize): the integral part is added to the exponent of the table entry
+    unsigned idx = static_cast<unsigned>(ki) & (Detail::Tables::tableSize - 1);
+    int64_t e = (ki - static_cast<int64_t>(idx)) >> Detail::Tables::tableBits;
+    double scale =
+        Detail::fromBits(Detail::toBits(tables.exp2[idx]) + (static_cast<uint64_t>(e) << 52));
+
+    double r2 = r*r;
+    double p = (1.0 + r) + r2*((0.5 + r*(1.0/6)) + r2*(1.0/24 + r*(1.0/120)));
+    return scale*p;
+}
+
+/*!
+ * \brief Approximates the natural logarithm.
+ *
+ * The argument is decomposed into x = c*(1 + r)*2^e where log(c) is taken from a table
+ * and |r| <= 1/256, so that log(1 + r) is approximated by a polynomial of degree 6.
+ * Close to one, the series 2*atanh(s) with s = (x - 1)/(x + 1) is used to avoid the
+ * cancellation of the terms.
+ */
+inline double log(double x)
+{
+    uint64_t bits = Detail::toBits(x);
+    if (bits - 0x0010000000000000ULL >= 0x7fe0000000000000ULL)
+        return std::log(x); // zero, subnormal, negative, infinite or NaN
+
+    if (std::abs(x - 1.0) < 1.0/16) {
+        double s = (x - 1.0)/(x + 1.0);
+        double z = s*s;
+        double z2 = z*z;
+        double p = (1.0 + z*(1.0/3)) + z2*((1.0/5 + z*(1.0/7)) + z2*(1.0/9 + z*(1.0/11)));
+        return 2.0*s*p;
+    }
+
+    const Detail::Tables& tables = Detail::Tables::instance();
+    const double ln2hi = 6.93147180369123816490e-01;
+    const double ln2lo = 1.90821492927058770002e-10;
+
+    int e = static_cast<int>(bits >> 52) - 1023;
+    unsigned idx =
+        static_cast<unsigned>(bits >> (52 - Detail::Tables::tableBits))
+        & (Detail::Tables::tableSize - 1);
+    double m = Detail::fromBits((bits & 0x000fffffffffffffULL) | 0x3ff0000000000000ULL);
+
+    // m - c_i is exact
+    double r = (m - tables.center[idx])*tables.invCenter[idx];
+    double r2 = r*r;
+    double p =
+        r + r2*((-0.5 + r*(1.0/3)) + r2*((-0.25 + r*(1.0/5)) + r2*(-1.0/6)));
+
+    return (e*ln2hi + tables.logCenter[idx]) + (p + e*ln2lo);
+}
+
+/*!
+ * \brief Approximates x^y.
+ *
+ * Small integral exponents are evaluated by repeated multiplication, all others by
+ * exp(y*log(x)). The special cases follow std::pow().
+ */
+inline double pow(double x, double y)
+{
+    // integral exponents, also for negative bases
+    if (std::abs(y) <= 64.0 && static_cast<double>(static_cast<int>(y)) == y) {
+        double result = Detail::powi(x, static_cast<unsigned>(std::abs(y)));
+        return (y < 0) ? 1.0/result : result;
+    }
+
+    if (x > 0.0)
+        return exp(y*log(x));
+    else if (x == 0.0)
+        return (y > 0) ? 0.0 : std::numeric_limits<double>::infinity();
+    else if (x != x || y != y)
+        return x + y;
+
+    // negative bases with a non-integral exponent
+    return std::numeric_limits<double>::quiet_NaN();
+}
+
+/*!
+ * \brief Approximates the exponential function of an evaluation.
+ */
+template <class ValueT, int numVars>
+Opm::DenseAd::Evaluation<ValueT, numVars>
+exp(const Opm::DenseAd::Evaluation<ValueT, numVars>& x)
+{
+    Opm::DenseAd::Evaluation<ValueT, numVars> result(x);
+
+    // d/dx exp(x) = exp(x)
+    const ValueT& f = exp(x.value());
+    result.setValue(f);
+    for (int varIdx = 0; varIdx < numVars; ++varIdx)
+        result.setDerivative(varIdx, f*x.derivative(varIdx));
+    return result;
+}
+
+/*!
+ * \brief Approximates the natural logarithm of an evaluation.
+ */
+template <class ValueT, int numVars>
+Opm::DenseAd::Evaluation<ValueT, numVars>
+log(const Opm::DenseAd::Evaluation<ValueT, numVars>& x)
+{
+    Opm::DenseAd::Evaluation<ValueT, numVars> result(x);
+
+    // d/dx log(x) = 1/x
+    const ValueT& df = 1.0/x.value();
+    result.setValue(log(x.value()));
+    for (int varIdx = 0; varIdx < numVars; ++varIdx)
+        result.setDerivative(varIdx, df*x.derivative(varIdx));
+    return result;
+}
+
+/*!
+ * \brief Approximates x^y for an evaluation and a scalar exponent.
+ */
+template <class ValueT, int numVars, class ExponentT>
+typename std::enable_if<std::is_arithmetic<ExponentT>::value,
+                        Opm::DenseAd::Evaluation<ValueT, numVars> >::type
+pow(const Opm::DenseAd::Evaluation<ValueT, numVars>& x, ExponentT y)
+{
+    Opm::DenseAd::Evaluation<ValueT, numVars> result(x);
+
+    // d/dx x^y = y*x^(y - 1)
+    const ValueT& xv = x.value();
+    const ValueT& f = pow(xv, static_cast<ValueT>(y));
+    const ValueT& df =
+        (xv != 0.0) ? y*f/xv : y*pow(xv, static_cast<ValueT>(y - 1));
+    result.setValue(f);
+    for (int varIdx = 0; varIdx < numVars; ++varIdx)
+        result.setDerivative(varIdx, df*x.derivative(varIdx));
+    return result;
+}
+
+/*!
+ * \brief Approximates x^y for a scalar base and an evaluation as the exponent.
+ */
+template <class BaseT, class ValueT, int numVars>
+typename std::enable_if<std::is_arithmetic<BaseT>::value,
+                        Opm::DenseAd::Evaluation<ValueT, numVars> >::type
+pow(BaseT x, const Opm::DenseAd::Evaluation<ValueT, numVars>& y)
+{
+    Opm::DenseAd::Evaluation<ValueT, numVars> result(y);
+
+    // d/dy x^y = log(x)*x^y
+    const ValueT& f = pow(static_cast<ValueT>(x), y.value());
+    const ValueT& df = log(static_cast<ValueT>(x))*f;
+    result.setValue(f);
+    for (int varIdx = 0; varIdx < numVars; ++varIdx)
+        result.setDerivative(varIdx, df*y.derivative(varIdx));
+    return result;
+}
+
+/*!
+ * \brief Approximates x^y where both the base and the exponent are evaluations.
+ */
+template <class ValueT, int numVars>
+Opm::DenseAd::Evaluation<ValueT, numVars>
+pow(const Opm::DenseAd::Evaluation<ValueT, numVars>& x,
+    const Opm::DenseAd::Evaluation<ValueT, numVars>& y)
+{
+    Opm::DenseAd::Evaluation<ValueT, numVars> result(x);
+
+    const ValueT& xv = x.value();
+    const ValueT& yv = y.value();
+    const ValueT& f = pow(xv, yv);
+
+    // d/dx x^y = y*x^(y - 1), d/dy x^y = log(x)*x^y
+    const ValueT& dfdx = (xv != 0.0) ? yv*f/xv : yv*pow(xv, yv - 1);
+    const ValueT& dfdy = (xv > 0.0) ? log(xv)*f : 0.0;
+    result.setValue(f);
+    for (int varIdx = 0; varIdx < numVars; ++varIdx)
+        result.setDerivative(varIdx,
+                             dfdx*x.derivative(varIdx) + dfdy*y.derivative(varIdx));
+    return result;
+}
+
+} // namespace FastMath
+
+/*!
+ * \brief Selects between exact and fast implementations of exp(), log() and pow().
+ *
+ * The exact versions are the ones of opm-material which call the functions of the
+ * C++ standard library. The fast versions (cf. the Ewoms::FastMath namespace) are
+ * short table-based approximations which only fall back to the standard library for
+ * special cases. For evaluations, the derivative of pow() is derived from its value
+ * instead of calling pow() a second time. Their
+ * relative error is below FastMath::maxRelativeError(), which is well below the
+ * tolerances of the Newton method, but the results are not bit-identical to the
+ * exact ones.
+ *
+ * \tparam useFastMath Specifies whether the fast approximations are used
+ */
+template <bool useFastMath>
+struct MathKernels
+{
+    template <class Evaluation>
+    static Evaluation exp(const Evaluation& x)
+    { return Opm::exp(x); }
+
+    template <class Evaluation>
+    static Evaluation log(const Evaluation& x)
+    { return Opm::log(x); }
+
+    template <class Evaluation1, class Evaluation2>
+    static auto pow(const Evaluation1& x, const Evaluation2& y)
+        -> decltype(Opm::pow(x, y))
+    { return Opm::pow(x, y); }
+};
+
+//! \cond SKIP_THIS
+template <>
+struct MathKernels<true>
+{
+    template <class Evaluation>
+    static Evaluation exp(const Evaluation& x)
+    { return FastMath::exp(x); }
+
+    template <class Evaluation>
+    static Evaluation log(const Evaluation& x)
+    { return FastMath::log(x); }
+
+    template <class Evaluation1, class Evaluation2>
+    static auto pow(const Evaluation1& x, const Evaluation2& y)
+        -> decltype(Opm::pow(x, y))
+    { return FastMath::pow(x, y); }
+};
+//! \endcond
+
+} // namespace Ewoms
+
+#endif
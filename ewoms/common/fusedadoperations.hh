@@ -0,0 +1,162 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \brief Fused arithmetic operations for automatic differentiation evaluations.
+ *
+ * Each binary operator of an evaluation creates a temporary object and loops over all
+ * of its derivatives. The functions of this file evaluate short expressions which are
+ * frequently used to compute fluxes at once, i.e., the derivatives are traversed a
+ * single time and no temporaries are created. The results may alias the arguments.
+ *
+ * For plain floating point values, which are used if the linearization is done by
+ * finite differences, the functions simply evaluate the expression.
+ */
+#ifndef EWOMS_FUSED_AD_OPERATIONS_HH
+#define EWOMS_FUSED_AD_OPERATIONS_HH
+
+#include <opm/material/densead/Evaluation.hpp>
+
+#include <type_traits>
+
+namespace Ewoms {
+
+//! \cond SKIP_THIS
+namespace Detail {
+// prevents the type of the scalar arguments from being deduced, so that e.g. integer
+// literals can be passed
+template <class T>
+struct FusedScalar
+{ typedef T type; };
+} // namespace Detail
+//! \endcond
+
+/*!
+ * \brief Computes y += a*x.
+ */
+template <class Evaluation>
+typename std::enable_if<std::is_floating_point<Evaluation>::value>::type
+fusedAxpy(Evaluation& y,
+          typename Detail::FusedScalar<Evaluation>::type a,
+          const Evaluation& x)
+{ y += a*x; }
+
+/*!
+ * \brief Computes y += a*x.
+ */
+template <class ValueT, int numVars>
+void fusedAxpy(Opm::DenseAd::Evaluation<ValueT, numVars>& y,
+               typename Detail::FusedScalar<ValueT>::type a,
+               const Opm::DenseAd::Evaluation<ValueT, numVars>& x)
+{
+    y.setValue(y.value() + a*x.value());
+    for (int varIdx = 0; varIdx < numVars; ++varIdx)
+        y.setDerivative(varIdx, y.derivative(varIdx) + a*x.derivative(varIdx));
+}
+
+/*!
+ * \brief Computes result = c + a*x.
+ */
+template <class Evaluation>
+typename std::enable_if<std::is_floating_point<Evaluation>::value>::type
+fusedAffine(Evaluation& result,
+            typename Detail::FusedScalar<Evaluation>::type c,
+            typename Detail::FusedScalar<Evaluation>::type a,
+            const Evaluation& x)
+{ result = c + a*x; }
+
+/*!
+ * \brief Computes result = c + a*x.
+ */
+template <class ValueT, int numVars>
+void fusedAffine(Opm::DenseAd::Evaluation<ValueT, numVars>& result,
+                 typename Detail::FusedScalar<ValueT>::type c,
+                 typename Detail::FusedScalar<ValueT>::type a,
+                 const Opm::DenseAd::Evaluation<ValueT, numVars>& x)
+{
+    result.setValue(c + a*x.value());
+    for (int varIdx = 0; varIdx < numVars; ++varIdx)
+        result.setDerivative(varIdx, a*x.derivative(varIdx));
+}
+
+/*!
+ * \brief Computes result = c + a*x + b*y.
+ */
+template <class Evaluation>
+typename std::enable_if<std::is_floating_point<Evaluation>::value>::type
+fusedLinearCombination(Evaluation& result,
+                       typename Detail::FusedScalar<Evaluation>::type c,
+                       typename Detail::FusedScalar<Evaluation>::type a,
+                       const Evaluation& x,
+                       typename Detail::FusedScalar<Evaluation>::type b,
+                       const Evaluation& y)
+{ result = c + a*x + b*y; }
+
+/*!
+ * \brief Computes result = c + a*x + b*y.
+ */
+template <class ValueT, int numVars>
+void fusedLinearCombination(Opm::DenseAd::Evaluation<ValueT, numVars>& result,
+                            typename Detail::FusedScalar<ValueT>::type c,
+                            typename Detail::FusedScalar<ValueT>::type a,
+                            const Opm::DenseAd::Evaluation<ValueT, numVars>& x,
+                            typename Detail::FusedScalar<ValueT>::type b,
+                            const Opm::DenseAd::Evaluation<ValueT, numVars>& y)
+{
+    result.setValue(c + a*x.value() + b*y.value());
+    for (int varIdx = 0; varIdx < numVars; ++varIdx)
+        result.setDerivative(varIdx, a*x.derivative(varIdx) + b*y.derivative(varIdx));
+}
+
+/*!
+ * \brief Computes result = s*x*y.
+ */
+template <class Evaluation>
+typename std::enable_if<std::is_floating_point<Evaluation>::value>::type
+fusedScaledProduct(Evaluation& result,
+                   typename Detail::FusedScalar<Evaluation>::type s,
+                   const Evaluation& x,
+                   const Evaluation& y)
+{ result = s*x*y; }
+
+/*!
+ * \brief Computes result = s*x*y.
+ */
+template <class ValueT, int numVars>
+void fusedScaledProduct(Opm::DenseAd::Evaluation<ValueT, numVars>& result,
+                        typename Detail::FusedScalar<ValueT>::type s,
+                        const Opm::DenseAd::Evaluation<ValueT, numVars>& x,
+                        const Opm::DenseAd::Evaluation<ValueT, numVars>& y)
+{
+    // the values must be read before the result is written because it may alias x or y
+    const ValueT sx = s*x.value();
+    const ValueT sy = s*y.value();
+    result.setValue(sx*y.value());
+    for (int varIdx = 0; varIdx < numVars; ++varIdx)
+        result.setDerivative(varIdx, sy*x.derivative(varIdx) + sx*y.derivative(varIdx));
+}
+
+} // namespace Ewoms
+
+#endif
@@ -0,0 +1,221 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \copydoc Ewoms::HugePageAllocator
+ */
+#ifndef EWOMS_HUGE_PAGE_ALLOCATOR_HH
+#define EWOMS_HUGE_PAGE_ALLOCATOR_HH
+
+#include <ewoms/common/alignedallocator.hh>
+#include <ewoms/common/memoryaccounting.hh>
+#include <ewoms/parallel/locks.hh>
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <map>
+#include <new>
+#include <utility>
+
+namespace Ewoms {
+
+/*!
+ * \brief A process-wide pool of large memory blocks which are backed by huge pages if
+ *        the operating system supports it.
+ *
+ * Blocks of at least half the size of a huge page (2 MiB) are aligned to huge page
+ * boundaries, their size is rounded up to a multiple of the huge page size and the
+ * operating system is advised to back them by transparent huge pages. This reduces
+ * the number of TLB misses when the large vectors of the simulation are traversed.
+ * Freed large blocks are kept for reuse by subsequent allocations of the same size,
+ * e.g. when the caches are reallocated after the grid was adapted, up to a total of
+ * maxCachedBytes. Smaller blocks are directly allocated and freed.
+ */
+class HugePageArena
+{
+public:
+    static const size_t hugePageSize = 2*1024*1024;
+    static const size_t maxCachedBytes = 512*1024*1024;
+
+    /*!
+     * \brief Returns the object which is used by the whole process.
+     */
+    static HugePageArena& instance()
+    {
+        static HugePageArena arena;
+        return arena;
+    }
+
+    /*!
+     * \brief Allocate a block of memory.
+     *
+     * \return A pointer to the block or 0 if no memory is available
+     */
+    void* allocate(size_t numBytes, size_t alignment)
+    {
+        if (numBytes < hugePageSize/2)
+            return Ewoms::aligned_alloc(std::max(alignment, sizeof(void*)), numBytes);
+
+        size_t blockSize = roundUp_(numBytes);
+
+        ScopedLock lock(mutex_);
+        void* ptr = 0;
+        auto freeIt = freeBlocks_.find(blockSize);
+        if (freeIt != freeBlocks_.end()) {
+            ptr = freeIt->second;
+            freeBlocks_.erase(freeIt);
+            cachedMemory_.set(cachedMemory_.numBytes() - blockSize);
+        }
+        else {
+            ptr = Ewoms::aligned_alloc(hugePageSize, blockSize);
+            if (!ptr)
+                return 0;
+#ifdef MADV_HUGEPAGE
+            // this is only a hint, so failures are not fatal
+            madvise(ptr, blockSize, MADV_HUGEPAGE);
+#endif
+        }
+
+        return ptr;
+    }
+
+    /*!
+     * \brief Return a block of memory to the pool.
+     *
+     * \param ptr The pointer returned by allocate()
+     * \param numBytes The size which was passed to allocate()
+     */
+    void deallocate(void* ptr, size_t numBytes)
+    {
+        if (!ptr)
+            return;
+
+        if (numBytes < hugePageSize/2) {
+            aligned_free(ptr);
+            return;
+        }
+
+        size_t blockSize = roundUp_(numBytes);
+
+        ScopedLock lock(mutex_);
+        if (cachedMemory_.numBytes() + blockSize > maxCachedBytes) {
+            aligned_free(ptr);
+            return;
+        }
+
+        freeBlocks_.insert(std::make_pair(blockSize, ptr));
+        cachedMemory_.set(cachedMemory_.numBytes() + blockSize);
+    }
+
+    /*!
+     * \brief Give the memory of all unused blocks back to the operating system.
+     */
+    void releaseCached()
+    {
+        ScopedLock lock(mutex_);
+        auto it = freeBlocks_.begin();
+        const auto& endIt = freeBlocks_.end();
+        for (; it != endIt; ++it)
+            aligned_free(it->second);
+        freeBlocks_.clear();
+        cachedMemory_.set(0);
+    }
+
+private:
+    HugePageArena()
+        : cachedMemory_("Unused huge page blocks")
+    {
+        // make sure that the memory accounting outlives the arena
+        MemoryAccounting::instance();
+    }
+
+    ~HugePageArena()
+    { releaseCached(); }
+
+    static size_t roundUp_(size_t numBytes)
+    { return ((numBytes + hugePageSize - 1)/hugePageSize)*hugePageSize; }
+
+    OmpMutex mutex_;
+    std::multimap<size_t, void*> freeBlocks_;
+    MemoryRecord cachedMemory_;
+};
+
+/*!
+ * \brief An allocator which obtains its memory from the HugePageArena.
+ *
+ * It can be used as a replacement of std::allocator for the large vectors of the
+ * simulation. The blocks are aligned at least as required by the value type.
+ */
+template <class T>
+class HugePageAllocator
+{
+public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef std::size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+
+    template <class U>
+    struct rebind {
+        typedef HugePageAllocator<U> other;
+    };
+
+    HugePageAllocator() noexcept
+    {}
+
+    template <class U>
+    HugePageAllocator(const HugePageAllocator<U>&) noexcept
+    {}
+
+    pointer allocate(size_type n)
+    {
+        void* ptr = HugePageArena::instance().allocate(n*sizeof(T), alignof(T));
+        if (!ptr && n > 0)
+            throw std::bad_alloc();
+        return static_cast<pointer>(ptr);
+    }
+
+    void deallocate(pointer ptr, size_type n)
+    { HugePageArena::instance().deallocate(ptr, n*sizeof(T)); }
+
+    size_type max_size() const noexcept
+    { return ~static_cast<size_type>(0)/sizeof(T); }
+};
+
+template <class T, class U>
+bool operator==(const HugePageAllocator<T>&, const HugePageAllocator<U>&) noexcept
+{ return true; }
+
+template <class T, class U>
+bool operator!=(const HugePageAllocator<T>&, const HugePageAllocator<U>&) noexcept
+{ return false; }
+
+} // namespace Ewoms
+
+#endif
@@ -0,0 +1,248 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \copydoc Ewoms::MemoryAccounting
+ */
+#ifndef EWOMS_MEMORY_ACCOUNTING_HH
+#define EWOMS_MEMORY_ACCOUNTING_HH
+
+#include <ewoms/parallel/locks.hh>
+
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/bvector.hh>
+
+#include <cstddef>
+#include <iomanip>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace Ewoms {
+
+/*!
+ * \brief Keeps track of the memory used by the big data structures of the process.
+ *
+ * The objects which allocate large amounts of memory, e.g. the solution vectors, the
+ * caches of the model and the matrices of the linearizer and of the linear solver,
+ * report their memory usage by category using MemoryRecord objects. Besides the
+ * current usage, the usage at the point in time where the total was largest is kept.
+ * Memory which is not registered, e.g. the one of the grid, is not accounted for.
+ */
+class MemoryAccounting
+{
+    typedef std::map<std::string, double> CategoryMap;
+
+public:
+    /*!
+     * \brief Returns the object which is used by the whole process.
+     */
+    static MemoryAccounting& instance()
+    {
+        static MemoryAccounting accounting;
+        return accounting;
+    }
+
+    /*!
+     * \brief Change the memory used by a category by a given number of bytes.
+     *
+     * Since the object is shared by all simulators of the process, this may be called
+     * by several threads concurrently.
+     */
+    void add(const std::string& category, double numBytes)
+    {
+        ScopedLock lock(mutex_);
+        currentUsage_[category] += numBytes;
+        currentTotal_ += numBytes;
+        if (currentTotal_ > peakTotal_) {
+            peakTotal_ = currentTotal_;
+            peakUsage_ = currentUsage_;
+        }
+    }
+
+    /*!
+     * \brief Returns the number of bytes which are currently registered.
+     */
+    double currentTotal() const
+    {
+        ScopedLock lock(mutex_);
+        return currentTotal_;
+    }
+
+    /*!
+     * \brief Returns the largest number of bytes which were registered at any time.
+     */
+    double peakTotal() const
+    {
+        ScopedLock lock(mutex_);
+        return peakTotal_;
+    }
+
+    /*!
+     * \brief Print the memory used by each category of the process with rank 0 and
+     *        the minimum, average and maximum totals over all processes.
+     *
+     * This is a collective operation, i.e., it must be called by all processes of the
+     * communicator. Only the process with rank 0 prints the report.
+     *
+     * \param comm The collective communication of the simulation
+     * \param os The stream to which the report is written
+     * \param peak If true, the usage at the point in time of the largest total is
+     *             printed, else the current one
+     */
+    template <class CollectiveCommunication>
+    void printReport(const CollectiveCommunication& comm, std::ostream& os, bool peak) const
+    {
+        // do not hold the lock during the collective operations: other simulators of
+        // the process may be using different communicators
+        ScopedLock lock(mutex_);
+        const CategoryMap usage = peak ? peakUsage_ : currentUsage_;
+        double total = peak ? peakTotal_ : currentTotal_;
+        lock.unlock();
+
+        double minTotal = comm.min(total);
+        double maxTotal = comm.max(total);
+        double avgTotal = comm.sum(total)/comm.size();
+
+        if (comm.rank() != 0)
+            return;
+
+        os << (peak ? "Peak" : "Current") << " memory usage of the registered data "
+           << "structures [MiB]:\n"
+           << std::left << std::setw(40) << "Category"
+           << std::right << std::setw(14) << "Rank 0" << "\n";
+
+        auto it = usage.begin();
+        const auto& endIt = usage.end();
+        for (; it != endIt; ++it) {
+            if (it->second <= 0.0)
+                continue;
+
+            os << std::left << std::setw(40) << it->first
+               << std::right << std::setw(14) << toMiB_(it->second) << "\n";
+        }
+
+        os << std::left << std::setw(40) << "Total"
+           << std::right << std::setw(14) << toMiB_(total) << "\n";
+        if (comm.size() > 1)
+            os << "Total over all processes: min=" << toMiB_(minTotal)
+               << ", avg=" << toMiB_(avgTotal)
+               << ", max=" << toMiB_(maxTotal) << "\n";
+        os << std::flush;
+    }
+
+private:
+    MemoryAccounting()
+    {
+        currentTotal_ = 0.0;
+        peakTotal_ = 0.0;
+    }
+
+    static double toMiB_(double numBytes)
+    { return numBytes/(1024.0*1024.0); }
+
+    mutable OmpMutex mutex_;
+
+    CategoryMap currentUsage_;
+    CategoryMap peakUsage_;
+    double currentTotal_;
+    double peakTotal_;
+};
+
+/*!
+ * \brief Registers the memory used by a data structure with the MemoryAccounting.
+ *
+ * The owner of the data structure calls set() whenever the data structure is
+ * (re-)allocated. The memory is unregistered when the record is destroyed.
+ */
+class MemoryRecord
+{
+public:
+    explicit MemoryRecord(const std::string& category)
+        : category_(category)
+    { numBytes_ = 0; }
+
+    ~MemoryRecord()
+    { set(0); }
+
+    /*!
+     * \brief Set the number of bytes which are used by the data structure.
+     */
+    void set(size_t numBytes)
+    {
+        if (numBytes == numBytes_)
+            return;
+
+        MemoryAccounting::instance().add(category_,
+                                         static_cast<double>(numBytes)
+                                         - static_cast<double>(numBytes_));
+        numBytes_ = numBytes;
+    }
+
+    /*!
+     * \brief Returns the number of bytes which are currently registered by the record.
+     */
+    size_t numBytes() const
+    { return numBytes_; }
+
+private:
+    MemoryRecord(const MemoryRecord&) = delete;
+    MemoryRecord& operator=(const MemoryRecord&) = delete;
+
+    std::string category_;
+    size_t numBytes_;
+};
+
+/*!
+ * \brief Returns the number of bytes allocated by a std::vector.
+ */
+template <class T, class Allocator>
+size_t memoryUsage(const std::vector<T, Allocator>& v)
+{ return v.capacity()*sizeof(T); }
+
+/*!
+ * \brief Returns the number of bytes allocated by a block vector.
+ */
+template <class Block, class Allocator>
+size_t memoryUsage(const Dune::BlockVector<Block, Allocator>& v)
+{ return v.capacity()*sizeof(Block); }
+
+/*!
+ * \brief Returns the approximate number of bytes allocated by a BCRS matrix.
+ *
+ * Besides the blocks, the column index of each block and a row object for each row are
+ * stored.
+ */
+template <class Block, class Allocator>
+size_t memoryUsage(const Dune::BCRSMatrix<Block, Allocator>& M)
+{
+    typedef typename Dune::BCRSMatrix<Block, Allocator>::size_type SizeType;
+    typedef typename Dune::BCRSMatrix<Block, Allocator>::row_type Row;
+    return M.nonzeroes()*(sizeof(Block) + sizeof(SizeType)) + M.N()*sizeof(Row);
+}
+
+} // namespace Ewoms
+
+#endif
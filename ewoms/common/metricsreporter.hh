@@ -0,0 +1,439 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \copydoc Ewoms::MetricsReporter
+ */
+#ifndef EWOMS_METRICS_REPORTER_HH
+#define EWOMS_METRICS_REPORTER_HH
+
+#include <opm/common/ErrorMacros.hpp>
+#include <opm/common/Exceptions.hpp>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace Ewoms {
+
+/*!
+ * \brief A named value which describes the state of a running simulation.
+ *
+ * Counters only ever increase during a simulation (e.g. the accumulated time spent in
+ * the linear solver), whereas gauges may change arbitrarily (e.g. the size of the
+ * last time step).
+ */
+struct Metric
+{
+    enum Kind { Gauge, Counter };
+
+    Metric(const std::string& metricName, double metricValue, Kind metricKind = Gauge)
+        : name(metricName)
+    {
+        value = metricValue;
+        kind = metricKind;
+    }
+
+    std::string name;
+    double value;
+    Kind kind;
+};
+
+typedef std::vector<Metric> MetricsSample;
+
+/*!
+ * \brief The interface of the objects to which the MetricsReporter hands the metrics.
+ *
+ * All methods of a sink are called by the background thread of the reporter.
+ */
+class MetricsSink
+{
+public:
+    virtual ~MetricsSink()
+    {}
+
+    /*!
+     * \brief Called for each new sample of the metrics.
+     */
+    virtual void update(const MetricsSample& sample) = 0;
+
+    /*!
+     * \brief Called periodically if no new sample is available.
+     *
+     * Sinks which answer requests, e.g. an HTTP endpoint, handle them here. The method
+     * must not block for longer than a few milliseconds.
+     */
+    virtual void idle()
+    {}
+};
+
+/*!
+ * \brief Serves the latest metrics in the text exposition format of Prometheus.
+ *
+ * A minimal HTTP server listens on the given TCP port and answers every request with
+ * the latest sample, so the simulation can be scraped by Prometheus directly.
+ */
+class PrometheusHttpSink : public MetricsSink
+{
+public:
+    PrometheusHttpSink(unsigned port, const std::string& prefix)
+        : prefix_(prefix)
+    {
+        socket_ = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (socket_ < 0)
+            OPM_THROW(std::runtime_error, "Could not create the socket of the metrics endpoint");
+
+        int yes = 1;
+        setsockopt(socket_, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+        sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons(static_cast<uint16_t>(port));
+        if (::bind(socket_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0
+            || ::listen(socket_, /*backlog=*/8) < 0)
+        {
+            ::close(socket_);
+            OPM_THROW(std::runtime_error,
+                      "Could not listen on port " << port << " for metrics requests");
+        }
+
+        // idle() must not block
+        fcntl(socket_, F_SETFL, fcntl(socket_, F_GETFL, 0) | O_NONBLOCK);
+    }
+
+    ~PrometheusHttpSink()
+    { ::close(socket_); }
+
+    void update(const MetricsSample& sample) override
+    {
+        std::ostringstream oss;
+        oss.precision(12);
+        for (unsigned i = 0; i < sample.size(); ++i) {
+            const std::string& name = prefix_ + "_" + sample[i].name;
+            oss << "# TYPE " << name << " "
+                << ((sample[i].kind == Metric::Counter) ? "counter" : "gauge") << "\n"
+                << name << " " << sample[i].value << "\n";
+        }
+        body_ = oss.str();
+
+        idle();
+    }
+
+    void idle() override
+    {
+        while (true) {
+            int client = ::accept(socket_, 0, 0);
+            if (client < 0)
+                return; // no pending connections
+
+            // the request itself is ignored, but it is read so that the client does
+            // not see a connection reset
+            timeval timeout;
+            timeout.tv_sec = 1;
+            timeout.tv_usec = 0;
+            setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+            char request[1024];
+            if (::recv(client, request, sizeof(request), 0) < 0) {
+                ::close(client);
+                continue;
+            }
+
+            std::ostringstream oss;
+            oss << "HTTP/1.0 200 OK\r\n"
+                << "Content-Type: text/plain; version=0.0.4\r\n"
+                << "Content-Length: " << body_.size() << "\r\n"
+                << "Connection: close\r\n\r\n"
+                << body_;
+            const std::string& response = oss.str();
+            size_t numSent = 0;
+            while (numSent < response.size()) {
+                ssize_t n = ::send(client, response.data() + numSent,
+                                   response.size() - numSent, MSG_NOSIGNAL);
+                if (n <= 0)
+                    break;
+                numSent += static_cast<size_t>(n);
+            }
+            ::close(client);
+        }
+    }
+
+private:
+    std::string prefix_;
+    std::string body_;
+    int socket_;
+};
+
+/*!
+ * \brief Writes the latest metrics in the text exposition format of Prometheus to a
+ *        file.
+ *
+ * The file is replaced atomically, so it can be picked up by the textfile collector
+ * of the Prometheus node exporter or be inspected by scripts.
+ */
+class MetricsFileSink : public MetricsSink
+{
+public:
+    MetricsFileSink(const std::string& fileName, const std::string& prefix)
+        : fileName_(fileName)
+        , prefix_(prefix)
+    {}
+
+    void update(const MetricsSample& sample) override
+    {
+        const std::string& tmpFileName = fileName_ + ".tmp";
+        {
+            std::ofstream os(tmpFileName);
+            os.precision(12);
+            for (unsigned i = 0; i < sample.size(); ++i)
+                os << prefix_ << "_" << sample[i].name << " " << sample[i].value << "\n";
+            if (!os)
+                OPM_THROW(std::runtime_error, "Could not write the file '" << tmpFileName << "'");
+        }
+
+        if (std::rename(tmpFileName.c_str(), fileName_.c_str()) != 0)
+            OPM_THROW(std::runtime_error, "Could not rename '" << tmpFileName << "' to '"
+                      << fileName_ << "'");
+    }
+
+private:
+    std::string fileName_;
+    std::string prefix_;
+};
+
+/*!
+ * \brief Sends the metrics as gauges to a StatsD server via UDP.
+ */
+class StatsdSink : public MetricsSink
+{
+public:
+    StatsdSink(const std::string& host, unsigned port, const std::string& prefix)
+        : prefix_(prefix)
+    {
+        addrinfo hints;
+        std::memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_DGRAM;
+
+        addrinfo* result = 0;
+        const std::string& service = std::to_string(port);
+        if (getaddrinfo(host.c_str(), service.c_str(), &hints, &result) != 0 || !result)
+            OPM_THROW(std::runtime_error, "Could not resolve the StatsD host '" << host << "'");
+        std::memcpy(&addr_, result->ai_addr, sizeof(addr_));
+        freeaddrinfo(result);
+
+        socket_ = ::socket(AF_INET, SOCK_DGRAM, 0);
+        if (socket_ < 0)
+            OPM_THROW(std::runtime_error, "Could not create the socket of the StatsD sink");
+    }
+
+    ~StatsdSink()
+    { ::close(socket_); }
+
+    void update(const MetricsSample& sample) override
+    {
+        // send all metrics in a single datagram using the multi-metric format. UDP
+        // is lossy by design, so failures are ignored
+        std::ostringstream oss;
+        oss.precision(12);
+        for (unsigned i = 0; i < sample.size(); ++i)
+            oss << prefix_ << "." << sample[i].name << ":" << sample[i].value << "|g\n";
+        const std::string& packet = oss.str();
+        ::sendto(socket_, packet.data(), packet.size(), 0,
+                 reinterpret_cast<const sockaddr*>(&addr_), sizeof(addr_));
+    }
+
+private:
+    std::string prefix_;
+    sockaddr_in addr_;
+    int socket_;
+};
+
+/*!
+ * \brief Hands the metrics of a running simulation to a sink on a low-priority
+ *        background thread.
+ *
+ * The simulator calls post() once per time step. This only copies the sample, so the
+ * simulation is never slowed down by a slow sink: If samples are posted faster than
+ * the sink can process them, only the latest one is handed over. Errors of the sink
+ * are reported once and do not abort the simulation.
+ */
+class MetricsReporter
+{
+public:
+    MetricsReporter(const MetricsReporter&) = delete;
+
+    explicit MetricsReporter(std::unique_ptr<MetricsSink> sink)
+        : sink_(std::move(sink))
+    {
+        hasNewSample_ = false;
+        workerShouldStop_ = false;
+        errorPrinted_ = false;
+        workerThread_ = std::thread([this]() { this->workerLoop_(); });
+    }
+
+    ~MetricsReporter()
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            workerShouldStop_ = true;
+            condition_.notify_all();
+        }
+        workerThread_.join();
+    }
+
+    /*!
+     * \brief Create a sink from its specification.
+     *
+     * The supported specifications are "prometheus:PORT" for an HTTP endpoint,
+     * "file:FILE_NAME" for a file in the Prometheus text format and "statsd:HOST:PORT"
+     * for a StatsD server.
+     *
+     * \param spec The specification of the sink
+     * \param prefix The string which is prepended to the names of all metrics
+     */
+    static std::unique_ptr<MetricsSink> createSink(const std::string& spec,
+                                                   const std::string& prefix)
+    {
+        size_t colonPos = spec.find(':');
+        const std::string& kind = spec.substr(0, colonPos);
+        const std::string& arg = (colonPos == std::string::npos) ? "" : spec.substr(colonPos + 1);
+
+        if (kind == "prometheus" && !arg.empty())
+            return std::unique_ptr<MetricsSink>(new PrometheusHttpSink(parsePort_(arg), prefix));
+        else if (kind == "file" && !arg.empty())
+            return std::unique_ptr<MetricsSink>(new MetricsFileSink(arg, prefix));
+        else if (kind == "statsd") {
+            size_t portPos = arg.rfind(':');
+            if (portPos != std::string::npos && portPos > 0)
+                return std::unique_ptr<MetricsSink>(new StatsdSink(arg.substr(0, portPos),
+                                                                   parsePort_(arg.substr(portPos + 1)),
+                                                                   prefix));
+        }
+
+        OPM_THROW(std::runtime_error, "Invalid metrics sink '" << spec << "'. Use "
+                  "'prometheus:PORT', 'file:FILE_NAME' or 'statsd:HOST:PORT'");
+    }
+
+    /*!
+     * \brief Hand a new sample to the sink.
+     */
+    void post(const MetricsSample& sample)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        sample_ = sample;
+        hasNewSample_ = true;
+        condition_.notify_all();
+    }
+
+private:
+    // the interval at which MetricsSink::idle() is called
+    static std::chrono::milliseconds idleInterval_()
+    { return std::chrono::milliseconds(100); }
+
+    static unsigned parsePort_(const std::string& s)
+    {
+        char* end;
+        unsigned long port = std::strtoul(s.c_str(), &end, 10);
+        if (s.empty() || *end != '\0' || port == 0 || port > 65535)
+            OPM_THROW(std::runtime_error, "Invalid port '" << s << "' for the metrics sink");
+        return static_cast<unsigned>(port);
+    }
+
+    // the main function of the background thread
+    void workerLoop_()
+    {
+#ifdef __linux__
+        // on Linux, the nice value can be set for individual threads
+        setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 19);
+#endif
+
+        MetricsSample sample;
+        while (true) {
+            bool hasNewSample;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                condition_.wait_for(lock, idleInterval_(),
+                                    [this]()
+                                    { return workerShouldStop_ || hasNewSample_; });
+                if (workerShouldStop_)
+                    return;
+
+                hasNewSample = hasNewSample_;
+                if (hasNewSample)
+                    sample.swap(sample_);
+                hasNewSample_ = false;
+            }
+
+            try {
+                if (hasNewSample)
+                    sink_->update(sample);
+                else
+                    sink_->idle();
+            }
+            catch (const std::exception& e) {
+                if (!errorPrinted_)
+                    std::cerr << "Warning: Reporting the metrics failed: " << e.what() << "\n";
+                errorPrinted_ = true;
+            }
+        }
+    }
+
+    std::unique_ptr<MetricsSink> sink_;
+    MetricsSample sample_;
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    std::thread workerThread_;
+    bool hasNewSample_;
+    bool workerShouldStop_;
+    bool errorPrinted_;
+};
+
+} // namespace Ewoms
+
+#endif
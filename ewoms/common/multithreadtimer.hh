@@ -0,0 +1,171 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \copydoc Ewoms::MultiThreadTimer
+ */
+#ifndef EWOMS_MULTI_THREAD_TIMER_HH
+#define EWOMS_MULTI_THREAD_TIMER_HH
+
+#include <ewoms/common/timer.hh>
+#include <ewoms/common/alignedallocator.hh>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+namespace Ewoms {
+/*!
+ * \ingroup Common
+ *
+ * \brief Measures the wall clock time spent in a region of code which is executed by
+ *        the threads of an OpenMP parallel region.
+ *
+ * Each thread starts and stops the timer for itself and accumulates its times in a
+ * slot of its own, which occupies a separate cache line. Starting and stopping thus
+ * only reads the TickClock and does not require any synchronization. The times of the
+ * threads are only combined when they are queried, i.e., when the results are
+ * reported. This makes the timer cheap enough to instrument code which is executed for
+ * each element.
+ *
+ * Only the threads of OpenMP parallel regions may use the timer concurrently and the
+ * results must not be queried while it is being used.
+ */
+class MultiThreadTimer
+{
+    // the data of each thread occupies a cache line of its own, so that the threads
+    // do not write to the same cache line
+    struct alignas(64) ThreadData
+    {
+        uint64_t startTicks;
+        uint64_t ticksElapsed;
+        unsigned long numCalls;
+    };
+
+public:
+    MultiThreadTimer()
+    {
+#ifdef _OPENMP
+        threadData_.resize(static_cast<size_t>(omp_get_max_threads()));
+#else
+        threadData_.resize(1);
+#endif
+        reset();
+    }
+
+    /*!
+     * \brief Start measuring the time of the calling thread.
+     */
+    void start()
+    { localThreadData_().startTicks = TickClock::now(); }
+
+    /*!
+     * \brief Stop measuring the time of the calling thread.
+     */
+    void stop()
+    {
+        ThreadData& data = localThreadData_();
+        data.ticksElapsed += TickClock::now() - data.startTicks;
+        ++ data.numCalls;
+    }
+
+    /*!
+     * \brief Reset the times of all threads.
+     */
+    void reset()
+    {
+        for (size_t threadIdx = 0; threadIdx < threadData_.size(); ++threadIdx) {
+            threadData_[threadIdx].startTicks = 0;
+            threadData_[threadIdx].ticksElapsed = 0;
+            threadData_[threadIdx].numCalls = 0;
+        }
+    }
+
+    /*!
+     * \brief Return the sum of the wall clock times [s] measured by all threads.
+     */
+    double realTimeElapsed() const
+    {
+        uint64_t ticks = 0;
+        for (size_t threadIdx = 0; threadIdx < threadData_.size(); ++threadIdx)
+            ticks += threadData_[threadIdx].ticksElapsed;
+        return toSeconds_(ticks);
+    }
+
+    /*!
+     * \brief Return the largest wall clock time [s] measured by a single thread.
+     *
+     * Compared to realTimeElapsed(), this indicates how well the work is distributed
+     * among the threads.
+     */
+    double maxThreadTimeElapsed() const
+    {
+        uint64_t ticks = 0;
+        for (size_t threadIdx = 0; threadIdx < threadData_.size(); ++threadIdx)
+            ticks = std::max(ticks, threadData_[threadIdx].ticksElapsed);
+        return toSeconds_(ticks);
+    }
+
+    /*!
+     * \brief Return how often the timer was stopped by all threads.
+     */
+    unsigned long numCalls() const
+    {
+        unsigned long result = 0;
+        for (size_t threadIdx = 0; threadIdx < threadData_.size(); ++threadIdx)
+            result += threadData_[threadIdx].numCalls;
+        return result;
+    }
+
+private:
+    ThreadData& localThreadData_()
+    {
+#ifdef _OPENMP
+        size_t threadIdx = static_cast<size_t>(omp_get_thread_num());
+#else
+        size_t threadIdx = 0;
+#endif
+        assert(threadIdx < threadData_.size());
+        return threadData_[threadIdx];
+    }
+
+    static double toSeconds_(uint64_t ticks)
+    {
+        if (ticks == 0)
+            return 0.0;
+        return static_cast<double>(ticks)*TickClock::secondsPerTick();
+    }
+
+    // the standard allocator does not necessarily respect the alignment of the slots
+    std::vector<ThreadData, Ewoms::aligned_allocator<ThreadData, 64> > threadData_;
+};
+} // namespace Ewoms
+
+#endif
@@ -33,6 +33,7 @@
 #define EWOMS_PARAMETERS_HH
 
 #include <ewoms/common/propertysystem.hh>
+#include <ewoms/parallel/locks.hh>
 
 #include <opm/common/ErrorMacros.hpp>
 #include <opm/common/Exceptions.hpp>
@@ -681,6 +682,10 @@ private:
     {
         typedef std::unordered_map<std::string, Blubb> StaticData;
         static StaticData staticData;
+        static OmpMutex mutex;
+
+        // the parameters may be retrieved by multiple simulators concurrently
+        ScopedLock lock(mutex);
 
         typename StaticData::iterator it = staticData.find(paramName);
         Blubb *b;
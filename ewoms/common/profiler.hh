@@ -0,0 +1,624 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \copydoc Ewoms::Profiler
+ */
+#ifndef EWOMS_PROFILER_HH
+#define EWOMS_PROFILER_HH
+
+#include <ewoms/parallel/locks.hh>
+
+#if HAVE_PERF_EVENT
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace Ewoms {
+
+/*!
+ * \ingroup Common
+ *
+ * \brief Records the wall clock time spent in nested regions of the code.
+ *
+ * Regions are usually marked by the EWOMS_PROFILE_REGION() macro, which creates a
+ * ProfilerRegion object for the remainder of the current scope. The times are
+ * accumulated separately for each thread and for each path of nested regions,
+ * i.e., the same region is reported separately if it is entered from different parent
+ * regions. Optionally, each execution of a region is recorded as an event which can be
+ * written to a file in the trace event format of the Chrome web browser (open
+ * "chrome://tracing" and load the file).
+ *
+ * If the profiler is disabled, which is the default, entering and leaving a region
+ * only costs a check of a boolean flag.
+ *
+ * On Linux, the hardware performance counters of the CPU can additionally be read when
+ * a region is entered and left (cf. setEnabled()). For each region and thread, the
+ * number of instructions per cycle, the number of last level cache misses and the
+ * memory bandwidth caused by these misses are then reported. The counters are accessed
+ * using perf_event_open(), so this is only possible if the kernel permits the
+ * processes of the user to monitor themselves (cf. /proc/sys/kernel/perf_event_paranoid).
+ */
+class Profiler
+{
+    typedef std::chrono::high_resolution_clock Clock;
+
+    // the hardware events which are counted: CPU cycles, instructions and last
+    // level cache misses
+    enum { numCounters = 3 };
+    enum { cyclesIdx = 0, instructionsIdx = 1, cacheMissesIdx = 2 };
+
+    // the size of a cache line, used to estimate the memory bandwidth [bytes]
+    enum { cacheLineSize = 64 };
+
+    struct Node
+    {
+        const char *name;
+        unsigned parentIdx;
+        std::vector<unsigned> childIdx;
+        double totalTime;
+        unsigned long numCalls;
+        uint64_t counters[numCounters];
+    };
+
+    struct OpenRegion
+    {
+        unsigned nodeIdx;
+        Clock::time_point startTime;
+        uint64_t counters[numCounters];
+    };
+
+    // the performance counters of a thread. they are read by a single system call.
+    class HardwareCounters
+    {
+    public:
+        HardwareCounters()
+        {
+            for (unsigned i = 0; i < numCounters; ++i)
+                fd_[i] = -1;
+        }
+
+        ~HardwareCounters()
+        { close_(); }
+
+        // start counting the events of the calling thread. returns false if this is
+        // not possible.
+        bool open()
+        {
+#if HAVE_PERF_EVENT
+            static const uint64_t events[numCounters] = {
+                PERF_COUNT_HW_CPU_CYCLES,
+                PERF_COUNT_HW_INSTRUCTIONS,
+                PERF_COUNT_HW_CACHE_MISSES
+            };
+
+            for (unsigned i = 0; i < numCounters; ++i) {
+                perf_event_attr attr;
+                std::memset(&attr, 0, sizeof(attr));
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.size = sizeof(attr);
+                attr.config = events[i];
+                attr.disabled = (i == 0) ? 1 : 0;
+                attr.exclude_kernel = 1;
+                attr.exclude_hv = 1;
+                attr.read_format = PERF_FORMAT_GROUP;
+
+                // all counters form a group which is led by the first one
+                fd_[i] = static_cast<int>(syscall(__NR_perf_event_open, &attr,
+                                                  /*pid=*/0, /*cpu=*/-1,
+                                                  /*groupFd=*/(i == 0) ? -1 : fd_[0],
+                                                  /*flags=*/0));
+                if (fd_[i] < 0) {
+                    close_();
+                    return false;
+                }
+            }
+
+            ioctl(fd_[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(fd_[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+            return true;
+#else
+            return false;
+#endif
+        }
+
+        bool isOpen() const
+        { return fd_[0] >= 0; }
+
+        // read the current values of all counters. if the counters are not available,
+        // the values are zero
+        void read(uint64_t* values) const
+        {
+#if HAVE_PERF_EVENT
+            if (isOpen()) {
+                uint64_t buf[1 + numCounters];
+                if (::read(fd_[0], buf, sizeof(buf)) == static_cast<ssize_t>(sizeof(buf))) {
+                    std::copy(buf + 1, buf + 1 + numCounters, values);
+                    return;
+                }
+            }
+#endif
+            std::fill(values, values + numCounters, 0);
+        }
+
+    private:
+        HardwareCounters(const HardwareCounters&) = delete;
+        HardwareCounters& operator=(const HardwareCounters&) = delete;
+
+        void close_()
+        {
+            for (unsigned i = 0; i < numCounters; ++i) {
+#if HAVE_PERF_EVENT
+                if (fd_[i] >= 0)
+                    ::close(fd_[i]);
+#endif
+                fd_[i] = -1;
+            }
+        }
+
+        int fd_[numCounters];
+    };
+
+    struct TraceEvent
+    {
+        const char *name;
+        double startTime;
+        double duration;
+    };
+
+    struct ThreadData
+    {
+        ThreadData()
+        {
+            // node 0 is the root of the tree of regions
+            nodes.resize(1);
+            nodes[0].name = "";
+            nodes[0].parentIdx = 0;
+            nodes[0].totalTime = 0.0;
+            nodes[0].numCalls = 0;
+            std::fill(nodes[0].counters, nodes[0].counters + numCounters, 0);
+            openRegions.reserve(32);
+            numDroppedEvents = 0;
+            countersInitialized = false;
+        }
+
+        std::vector<Node> nodes;
+        std::vector<OpenRegion> openRegions;
+        std::vector<TraceEvent> events;
+        unsigned long numDroppedEvents;
+
+        bool countersInitialized;
+        HardwareCounters counters;
+    };
+
+public:
+    /*!
+     * \brief Returns the object which is used by the whole process.
+     */
+    static Profiler& instance()
+    {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    /*!
+     * \brief Turn the profiler on or off.
+     *
+     * Regions which are open while the profiler is turned on are not measured. Since
+     * the profiler is shared by all simulators of the process, this may be called by
+     * several threads concurrently.
+     *
+     * \param yesno Specifies whether the regions are measured
+     * \param recordTrace Specifies whether each execution of a region is recorded for
+     *                    the trace file
+     * \param readHardwareCounters Specifies whether the hardware performance counters
+     *                             are read when entering and leaving the regions
+     */
+    void setEnabled(bool yesno, bool recordTrace = false, bool readHardwareCounters = false)
+    {
+        ScopedLock lock(mutex_);
+        if (yesno && !enabled_)
+            referenceTime_ = Clock::now();
+        recordTrace_ = yesno && recordTrace;
+        readHardwareCounters_ = yesno && readHardwareCounters;
+        enabled_ = yesno;
+    }
+
+    /*!
+     * \brief Returns true iff the profiler measures the time spent in regions.
+     */
+    bool enabled() const
+    { return enabled_; }
+
+    /*!
+     * \brief Start measuring a region of code on the current thread.
+     *
+     * The name must be valid until the profiler is destroyed, i.e., it is usually a
+     * string literal.
+     */
+    void beginRegion(const char *name)
+    {
+        ThreadData& data = localThreadData_();
+        unsigned parentIdx = data.openRegions.empty() ? 0 : data.openRegions.back().nodeIdx;
+
+        // find the node of the region as a child of the currently open region
+        unsigned nodeIdx = 0;
+        const auto& children = data.nodes[parentIdx].childIdx;
+        for (unsigned i = 0; i < children.size(); ++i) {
+            const char *childName = data.nodes[children[i]].name;
+            if (childName == name || std::strcmp(childName, name) == 0) {
+                nodeIdx = children[i];
+                break;
+            }
+        }
+
+        if (nodeIdx == 0) {
+            nodeIdx = static_cast<unsigned>(data.nodes.size());
+            data.nodes.resize(nodeIdx + 1);
+            Node& node = data.nodes[nodeIdx];
+            node.name = name;
+            node.parentIdx = parentIdx;
+            node.totalTime = 0.0;
+            node.numCalls = 0;
+            std::fill(node.counters, node.counters + numCounters, 0);
+            data.nodes[parentIdx].childIdx.push_back(nodeIdx);
+        }
+
+        OpenRegion region;
+        region.nodeIdx = nodeIdx;
+        if (readHardwareCounters_) {
+            initCounters_(data);
+            data.counters.read(region.counters);
+        }
+        region.startTime = Clock::now();
+        data.openRegions.push_back(region);
+    }
+
+    /*!
+     * \brief Stop measuring the region of code which was started last on the current
+     *        thread.
+     */
+    void endRegion()
+    {
+        Clock::time_point endTime = Clock::now();
+
+        ThreadData& data = localThreadData_();
+        if (data.openRegions.empty())
+            return; // the profiler was enabled while the region was open
+
+        const OpenRegion& region = data.openRegions.back();
+        double duration = std::chrono::duration<double>(endTime - region.startTime).count();
+        Node& node = data.nodes[region.nodeIdx];
+        node.totalTime += duration;
+        ++ node.numCalls;
+
+        if (data.counters.isOpen()) {
+            uint64_t endCounters[numCounters];
+            data.counters.read(endCounters);
+            for (unsigned i = 0; i < numCounters; ++i)
+                node.counters[i] += endCounters[i] - region.counters[i];
+        }
+
+        if (recordTrace_) {
+            if (data.events.size() < maxEventsPerThread_) {
+                TraceEvent event;
+                event.name = node.name;
+                event.startTime =
+                    std::chrono::duration<double>(region.startTime - referenceTime_).count();
+                event.duration = duration;
+                data.events.push_back(event);
+            }
+            else
+                ++ data.numDroppedEvents;
+        }
+
+        data.openRegions.pop_back();
+    }
+
+    /*!
+     * \brief Print the accumulated times of all regions as a table.
+     *
+     * For each region, the sum of the times of all threads, the maximum time of a single
+     * thread and the number of executions of the region are printed.
+     */
+    void printSummary(std::ostream& os) const
+    {
+        ScopedLock lock(mutex_);
+
+        // accumulate the results of all threads by the path of the region
+        std::map<std::string, Summary_> summary;
+        for (unsigned threadIdx = 0; threadIdx < threadData_.size(); ++threadIdx) {
+            const ThreadData& data = *threadData_[threadIdx];
+            for (unsigned nodeIdx = 1; nodeIdx < data.nodes.size(); ++nodeIdx) {
+                const Node& node = data.nodes[nodeIdx];
+                Summary_& s = summary[path_(data, nodeIdx)];
+                s.depth = depth_(data, nodeIdx);
+                s.totalTime += node.totalTime;
+                s.maxThreadTime = std::max(s.maxThreadTime, node.totalTime);
+                s.numCalls += node.numCalls;
+            }
+        }
+
+        os << std::left << std::setw(60) << "Region"
+           << std::right << std::setw(16) << "Total [s]"
+           << std::setw(16) << "Max/thread [s]"
+           << std::setw(16) << "Calls" << "\n";
+        auto it = summary.begin();
+        const auto& endIt = summary.end();
+        for (; it != endIt; ++it) {
+            const std::string& path = it->first;
+            const Summary_& s = it->second;
+            std::string name = std::string(2*s.depth, ' ') + path.substr(path.rfind('/') + 1);
+            os << std::left << std::setw(60) << name
+               << std::right << std::setw(16) << s.totalTime
+               << std::setw(16) << s.maxThreadTime
+               << std::setw(16) << s.numCalls << "\n";
+        }
+
+        if (hasHardwareCounters_())
+            printHardwareCounters_(os);
+
+        os << std::flush;
+    }
+
+    /*!
+     * \brief Write the recorded executions of all regions in trace event format.
+     *
+     * \param fileName The name of the JSON file which is written
+     * \param processIdx The index of the process, e.g. the MPI rank
+     */
+    void writeTrace(const std::string& fileName, int processIdx = 0) const
+    {
+        ScopedLock lock(mutex_);
+
+        std::ofstream os(fileName);
+        os << "{\"traceEvents\":[\n";
+        bool first = true;
+        unsigned long numDroppedEvents = 0;
+        for (unsigned threadIdx = 0; threadIdx < threadData_.size(); ++threadIdx) {
+            const ThreadData& data = *threadData_[threadIdx];
+            numDroppedEvents += data.numDroppedEvents;
+            for (unsigned eventIdx = 0; eventIdx < data.events.size(); ++eventIdx) {
+                const TraceEvent& event = data.events[eventIdx];
+                if (!first)
+                    os << ",\n";
+                first = false;
+
+                // the time stamps are given in microseconds
+                os << "{\"name\":\"" << event.name << "\",\"ph\":\"X\""
+                   << ",\"ts\":" << std::fixed << std::setprecision(3) << event.startTime*1e6
+                   << ",\"dur\":" << event.duration*1e6
+                   << ",\"pid\":" << processIdx
+                   << ",\"tid\":" << threadIdx << "}";
+            }
+        }
+        os << "\n],\"otherData\":{\"droppedEvents\":\"" << numDroppedEvents << "\"}}\n";
+    }
+
+private:
+    struct Summary_
+    {
+        Summary_()
+            : depth(0)
+            , totalTime(0.0)
+            , maxThreadTime(0.0)
+            , numCalls(0)
+        {}
+
+        unsigned depth;
+        double totalTime;
+        double maxThreadTime;
+        unsigned long numCalls;
+    };
+
+    Profiler()
+    {
+        enabled_ = false;
+        recordTrace_ = false;
+        readHardwareCounters_ = false;
+        countersWarningPrinted_ = false;
+    }
+
+    // open the performance counters of a thread when it enters its first region
+    void initCounters_(ThreadData& data)
+    {
+        if (data.countersInitialized)
+            return;
+
+        data.countersInitialized = true;
+        if (data.counters.open())
+            return;
+
+        ScopedLock lock(mutex_);
+        if (!countersWarningPrinted_) {
+            std::cerr << "Warning: The hardware performance counters are not available. "
+                      << "(Is /proc/sys/kernel/perf_event_paranoid too restrictive?)\n";
+            countersWarningPrinted_ = true;
+        }
+    }
+
+    // this requires the mutex to be locked
+    bool hasHardwareCounters_() const
+    {
+        for (unsigned threadIdx = 0; threadIdx < threadData_.size(); ++threadIdx)
+            if (threadData_[threadIdx]->counters.isOpen())
+                return true;
+        return false;
+    }
+
+    // print the performance counters of each region and thread. this requires the
+    // mutex to be locked
+    void printHardwareCounters_(std::ostream& os) const
+    {
+        // collect the nodes of all threads by their path
+        typedef std::pair<unsigned, const Node*> ThreadNode;
+        std::map<std::string, std::vector<ThreadNode> > regions;
+        std::map<std::string, unsigned> regionDepth;
+        for (unsigned threadIdx = 0; threadIdx < threadData_.size(); ++threadIdx) {
+            const ThreadData& data = *threadData_[threadIdx];
+            if (!data.counters.isOpen())
+                continue;
+
+            for (unsigned nodeIdx = 1; nodeIdx < data.nodes.size(); ++nodeIdx) {
+                const std::string& path = path_(data, nodeIdx);
+                regions[path].push_back(ThreadNode(threadIdx, &data.nodes[nodeIdx]));
+                regionDepth[path] = depth_(data, nodeIdx);
+            }
+        }
+
+        // the bandwidth is estimated by the cache lines which were fetched from the
+        // memory because of last level cache misses
+        os << "\n"
+           << std::left << std::setw(60) << "Region"
+           << std::right << std::setw(8) << "Thread"
+           << std::setw(12) << "IPC"
+           << std::setw(16) << "LLC misses"
+           << std::setw(20) << "Bandwidth [GB/s]" << "\n";
+        auto it = regions.begin();
+        const auto& endIt = regions.end();
+        for (; it != endIt; ++it) {
+            const std::string& path = it->first;
+            std::string name =
+                std::string(2*regionDepth[path], ' ') + path.substr(path.rfind('/') + 1);
+
+            const std::vector<ThreadNode>& threadNodes = it->second;
+            for (unsigned i = 0; i < threadNodes.size(); ++i) {
+                const Node& node = *threadNodes[i].second;
+                double cycles = static_cast<double>(node.counters[cyclesIdx]);
+                double instructions = static_cast<double>(node.counters[instructionsIdx]);
+                double cacheMisses = static_cast<double>(node.counters[cacheMissesIdx]);
+
+                os << std::left << std::setw(60) << ((i == 0) ? name : std::string(""))
+                   << std::right << std::setw(8) << threadNodes[i].first
+                   << std::setw(12) << ((cycles > 0) ? instructions/cycles : 0.0)
+                   << std::setw(16) << node.counters[cacheMissesIdx]
+                   << std::setw(20)
+                   << ((node.totalTime > 0) ? cacheMisses*cacheLineSize/node.totalTime/1e9 : 0.0)
+                   << "\n";
+            }
+        }
+    }
+
+    // returns the data of the calling thread. the data is created when a thread enters
+    // its first region, which means that the threads of several simulators which run
+    // concurrently within the same process never share their data.
+    ThreadData& localThreadData_()
+    {
+        static thread_local ThreadData *data = nullptr;
+        if (!data) {
+            ScopedLock lock(mutex_);
+            threadData_.emplace_back(new ThreadData);
+            data = threadData_.back().get();
+        }
+        return *data;
+    }
+
+    static std::string path_(const ThreadData& data, unsigned nodeIdx)
+    {
+        std::string result = data.nodes[nodeIdx].name;
+        for (nodeIdx = data.nodes[nodeIdx].parentIdx; nodeIdx != 0; nodeIdx = data.nodes[nodeIdx].parentIdx)
+            result = std::string(data.nodes[nodeIdx].name) + "/" + result;
+        return result;
+    }
+
+    static unsigned depth_(const ThreadData& data, unsigned nodeIdx)
+    {
+        unsigned result = 0;
+        for (nodeIdx = data.nodes[nodeIdx].parentIdx; nodeIdx != 0; nodeIdx = data.nodes[nodeIdx].parentIdx)
+            ++ result;
+        return result;
+    }
+
+    // the maximum number of events which are recorded by each thread for the trace
+    static const unsigned long maxEventsPerThread_ = 1000000;
+
+    std::atomic<bool> enabled_;
+    std::atomic<bool> recordTrace_;
+    std::atomic<bool> readHardwareCounters_;
+    bool countersWarningPrinted_;
+    Clock::time_point referenceTime_;
+
+    // protects the list of the data of the threads, not the data itself
+    mutable OmpMutex mutex_;
+    std::vector<std::unique_ptr<ThreadData> > threadData_;
+};
+
+/*!
+ * \ingroup Common
+ *
+ * \brief Measures the time spent in the scope of the object if the profiler is enabled.
+ */
+class ProfilerRegion
+{
+public:
+    ProfilerRegion(const char *name)
+    {
+        Profiler& profiler = Profiler::instance();
+        active_ = profiler.enabled();
+        if (active_)
+            profiler.beginRegion(name);
+    }
+
+    ~ProfilerRegion()
+    {
+        if (active_)
+            Profiler::instance().endRegion();
+    }
+
+private:
+    ProfilerRegion(const ProfilerRegion&) = delete;
+
+    bool active_;
+};
+
+} // namespace Ewoms
+
+#define EWOMS_PROFILER_CONCAT_(a, b) a ## b
+#define EWOMS_PROFILER_NAME_(line) EWOMS_PROFILER_CONCAT_(ewomsProfilerRegion, line)
+
+/*!
+ * \brief Measure the time spent in the remainder of the current scope.
+ *
+ * The argument is the name of the region, usually a string literal.
+ */
+#define EWOMS_PROFILE_REGION(name) ::Ewoms::ProfilerRegion EWOMS_PROFILER_NAME_(__LINE__)(name)
+
+#endif
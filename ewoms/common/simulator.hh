@@ -29,15 +29,23 @@
 #define EWOMS_SIMULATOR_HH
 
 #include <ewoms/io/restart.hh>
+#include <ewoms/io/forkedrestartwriter.hh>
 #include <ewoms/common/parametersystem.hh>
 
 #include <ewoms/common/propertysystem.hh>
 #include <ewoms/common/timer.hh>
 #include <ewoms/common/timerguard.hh>
+#include <ewoms/common/profiler.hh>
+#include <ewoms/common/memoryaccounting.hh>
+#include <ewoms/common/metricsreporter.hh>
+#include <ewoms/parallel/collectivewaittimes.hh>
 
 #include <dune/common/version.hh>
 #include <dune/common/parallel/mpihelper.hh>
 
+#include <opm/common/ErrorMacros.hpp>
+#include <opm/common/Exceptions.hpp>
+
 #include <iostream>
 #include <fstream>
 #include <iomanip>
@@ -45,6 +53,8 @@
 #include <string>
 #include <memory>
 
+#include <sys/resource.h>
+
 namespace Ewoms {
 namespace Properties {
 NEW_PROP_TAG(Scalar);
@@ -54,8 +64,16 @@ NEW_PROP_TAG(Model);
 NEW_PROP_TAG(Problem);
 NEW_PROP_TAG(EndTime);
 NEW_PROP_TAG(RestartTime);
+NEW_PROP_TAG(RestartFormat);
+NEW_PROP_TAG(RestartWriterProcesses);
 NEW_PROP_TAG(InitialTimeStepSize);
 NEW_PROP_TAG(PredeterminedTimeStepsFile);
+NEW_PROP_TAG(EnableProfiling);
+NEW_PROP_TAG(ProfilingTraceFile);
+NEW_PROP_TAG(ProfilingHardwareCounters);
+NEW_PROP_TAG(EnableMemoryReport);
+NEW_PROP_TAG(MetricsSink);
+NEW_PROP_TAG(PerformanceRecordFile);
 }
 
 /*!
@@ -91,8 +109,26 @@ public:
         setupTimer_.start();
 
         verbose_ = verbose && Dune::MPIHelper::getCollectiveCommunication().rank() == 0;
+        // the report involves collective operations, so all processes need to agree
+        printMemoryReport_ = verbose && EWOMS_GET_PARAM(TypeTag, bool, EnableMemoryReport);
+
+        const std::string& traceFile = EWOMS_GET_PARAM(TypeTag, std::string, ProfilingTraceFile);
+        Profiler::instance().setEnabled(EWOMS_GET_PARAM(TypeTag, bool, EnableProfiling),
+                                        !traceFile.empty(),
+                                        EWOMS_GET_PARAM(TypeTag, bool, ProfilingHardwareCounters));
+
+        // the metrics are only reported by the first process
+        const std::string& metricsSink = EWOMS_GET_PARAM(TypeTag, std::string, MetricsSink);
+        if (!metricsSink.empty() && Dune::MPIHelper::getCollectiveCommunication().rank() == 0)
+            setMetricsSink(MetricsReporter::createSink(metricsSink, "ewoms"));
+
+        unsigned numRestartWriters = EWOMS_GET_PARAM(TypeTag, unsigned, RestartWriterProcesses);
+        if (numRestartWriters > 0)
+            restartWriter_.reset(new ForkedRestartWriter(numRestartWriters));
 
         timeStepIdx_ = 0;
+        totalNewtonIterations_ = 0;
+        totalLinearIterations_ = 0;
         startTime_ = 0.0;
         time_ = 0.0;
         endTime_ = EWOMS_GET_PARAM(TypeTag, Scalar, EndTime);
@@ -156,9 +192,39 @@ public:
                              "The size of the initial time step [s]");
         EWOMS_REGISTER_PARAM(TypeTag, Scalar, RestartTime,
                              "The simulation time at which a restart should be attempted [s]");
+        EWOMS_REGISTER_PARAM(TypeTag, std::string, RestartFormat,
+                             "The format of the restart files which are written "
+                             "('text', 'binary' or 'collective')");
+        EWOMS_REGISTER_PARAM(TypeTag, unsigned, RestartWriterProcesses,
+                             "The maximum number of forked processes which write the "
+                             "restart files in the background while the simulation "
+                             "continues (0: write them synchronously)");
         EWOMS_REGISTER_PARAM(TypeTag, std::string, PredeterminedTimeStepsFile,
                              "A file with a list of predetermined time step sizes (one "
                              "time step per line)");
+        EWOMS_REGISTER_PARAM(TypeTag, bool, EnableProfiling,
+                             "Measure the time spent in the profiled regions of the code "
+                             "and print a summary at the end of the simulation");
+        EWOMS_REGISTER_PARAM(TypeTag, std::string, ProfilingTraceFile,
+                             "The name of the file to which the executions of the "
+                             "profiled regions are written in the trace event format "
+                             "of the Chrome web browser (requires EnableProfiling)");
+        EWOMS_REGISTER_PARAM(TypeTag, bool, ProfilingHardwareCounters,
+                             "Read the hardware performance counters in the profiled "
+                             "regions and report the instructions per cycle, the cache "
+                             "misses and the memory bandwidth (requires EnableProfiling "
+                             "and perf_event_open())");
+        EWOMS_REGISTER_PARAM(TypeTag, bool, EnableMemoryReport,
+                             "Print the memory used by the solutions, caches and matrices "
+                             "after the setup and at the end of the simulation");
+        EWOMS_REGISTER_PARAM(TypeTag, std::string, MetricsSink,
+                             "The sink to which the metrics of each time step are sent "
+                             "while the simulation is running ('prometheus:PORT', "
+                             "'file:FILE_NAME' or 'statsd:HOST:PORT')");
+        EWOMS_REGISTER_PARAM(TypeTag, std::string, PerformanceRecordFile,
+                             "The file to which the timings, the iteration counts and the "
+                             "peak memory usage of the run are written at its end (cf. "
+                             "bin/compareperformance.py)");
 
         GridManager::registerParameters();
         Model::registerParameters();
@@ -324,6 +390,19 @@ public:
     const Ewoms::Timer& writeTimer() const
     { return writeTimer_; }
 
+    /*!
+     * \brief Specify the sink to which the metrics of each time step are handed.
+     *
+     * The sink is driven by a low-priority background thread. Passing a null pointer
+     * stops reporting the metrics.
+     */
+    void setMetricsSink(std::unique_ptr<MetricsSink> sink)
+    {
+        metricsReporter_.reset();
+        if (sink)
+            metricsReporter_.reset(new MetricsReporter(std::move(sink)));
+    }
+
     /*!
      * \brief Set the current time step size to a given value.
      *
@@ -465,6 +544,14 @@ public:
     Scalar episodeStartTime() const
     { return episodeStartTime_; }
 
+    /*!
+     * \brief Sets the absolute time when the current episode started \f$\mathrm{[s]}\f$.
+     *
+     * Use this method with care!
+     */
+    void setEpisodeStartTime(Scalar t)
+    { episodeStartTime_ = t; }
+
     /*!
      * \brief Sets the length in seconds of the current episode.
      *
@@ -547,7 +634,7 @@ public:
             // try to restart a previous simulation
             time_ = restartTime;
 
-            Ewoms::Restart res;
+            Ewoms::Restart res(restartFormat_());
             res.deserializeBegin(*this, time_);
             if (verbose_)
                 std::cout << "Deserialize from file '" << res.fileName() << "'\n" << std::flush;
@@ -576,18 +663,24 @@ public:
             model_->applyInitialSolution();
 
             // write initial condition
-            if (problem_->shouldWriteOutput())
+            if (problem_->shouldWriteOutput()) {
                 problem_->writeOutput();
+                model_->outputWritten();
+            }
 
             timeStepSize_ = oldTimeStepSize;
             timeStepIdx_ = oldTimeStepIdx;
         }
         setupTimer_.stop();
 
+        if (printMemoryReport_)
+            MemoryAccounting::instance().printReport(gridView().comm(), std::cout, /*peak=*/false);
+
         executionTimer_.start();
         bool episodeBegins = episodeIsOver() || (timeStepIdx_ == 0);
         // do the time steps
         while (!finished()) {
+            double timeStepStartWallTime = executionTimer_.realTimeElapsed();
             prePostProcessTimer_.start();
             if (episodeBegins) {
                 // notify the problem that a new episode has just been
@@ -642,6 +735,8 @@ public:
             linearizeTimer_ += model.linearizeTimer();
             solveTimer_ += model.solveTimer();
             updateTimer_ += model.updateTimer();
+            totalNewtonIterations_ += static_cast<unsigned long>(model.newtonMethod().numIterations());
+            totalLinearIterations_ += static_cast<unsigned long>(model.newtonMethod().numLinearIterations());
 
             // post-process the current solution
             prePostProcessTimer_.start();
@@ -650,8 +745,10 @@ public:
 
             // write the result to disk
             writeTimer_.start();
-            if (problem_->shouldWriteOutput())
+            if (problem_->shouldWriteOutput()) {
                 problem_->writeOutput();
+                model_->outputWritten();
+            }
             writeTimer_.stop();
 
             // do the next time integration
@@ -671,6 +768,9 @@ public:
             time_ += oldDt;
             ++timeStepIdx_;
 
+            if (metricsReporter_)
+                postMetrics_(oldDt, executionTimer_.realTimeElapsed() - timeStepStartWallTime);
+
             prePostProcessTimer_.start();
             // notify the problem if an episode is finished
             if (episodeIsOver()) {
@@ -701,7 +801,22 @@ public:
         }
         executionTimer_.stop();
 
+        // make sure that the restart files are complete when the simulation is finished
+        if (restartWriter_)
+            restartWriter_->waitAll();
+
         problem_->finalize();
+
+        CollectiveWaitTimes::instance().printReport(gridView().comm(), std::cout);
+        if (printMemoryReport_)
+            MemoryAccounting::instance().printReport(gridView().comm(), std::cout, /*peak=*/true);
+
+        if (Profiler::instance().enabled())
+            writeProfile_();
+
+        const std::string& recordFile = EWOMS_GET_PARAM(TypeTag, std::string, PerformanceRecordFile);
+        if (!recordFile.empty())
+            writePerformanceRecord_(recordFile);
     }
 
     /*!
@@ -793,11 +908,15 @@ public:
      * method, has the current time of the simulation clock in it's
      * name and uses the extension <tt>.ers</tt>. (Ewoms ReStart
      * file.)  See Ewoms::Restart for details.
+     *
+     * If the RestartWriterProcesses parameter is positive, the file is assembled in
+     * memory and written by a forked child process.
      */
     void serialize()
     {
         typedef Ewoms::Restart Restarter;
-        Restarter res;
+        Restarter res(restartFormat_());
+        res.setDeferredWrite(static_cast<bool>(restartWriter_));
         res.serializeBegin(*this);
         if (gridView().comm().rank() == 0)
             std::cout << "Serialize to file '" << res.fileName() << "'"
@@ -808,6 +927,9 @@ public:
         problem_->serialize(res);
         model_->serialize(res);
         res.serializeEnd();
+
+        if (restartWriter_)
+            restartWriter_->write(res);
     }
 
     /*!
@@ -853,9 +975,108 @@ public:
     }
 
 private:
+    static Ewoms::Restart::Format restartFormat_()
+    {
+        const std::string& formatName = EWOMS_GET_PARAM(TypeTag, std::string, RestartFormat);
+        return Ewoms::Restart::formatFromString(formatName);
+    }
+
+    // hand the metrics of the time step which was just finished to the reporter
+    void postMetrics_(Scalar dt, double wallTime)
+    {
+        const auto& newtonMethod = model_->newtonMethod();
+
+        MetricsSample sample;
+        sample.reserve(14);
+        sample.push_back(Metric("time_step_index", timeStepIdx_, Metric::Counter));
+        sample.push_back(Metric("simulated_time_seconds", time_));
+        sample.push_back(Metric("time_step_size_seconds", dt));
+        sample.push_back(Metric("time_step_wall_seconds", wallTime));
+        sample.push_back(Metric("newton_iterations", newtonMethod.numIterations()));
+        sample.push_back(Metric("linear_iterations", newtonMethod.numLinearIterations()));
+        sample.push_back(Metric("execution_seconds", executionTimer_.realTimeElapsed(),
+                                Metric::Counter));
+        sample.push_back(Metric("pre_post_process_seconds", prePostProcessTimer_.realTimeElapsed(),
+                                Metric::Counter));
+        sample.push_back(Metric("linearize_seconds", linearizeTimer_.realTimeElapsed(),
+                                Metric::Counter));
+        sample.push_back(Metric("solve_seconds", solveTimer_.realTimeElapsed(),
+                                Metric::Counter));
+        sample.push_back(Metric("update_seconds", updateTimer_.realTimeElapsed(),
+                                Metric::Counter));
+        sample.push_back(Metric("write_seconds", writeTimer_.realTimeElapsed(),
+                                Metric::Counter));
+        sample.push_back(Metric("memory_bytes", MemoryAccounting::instance().currentTotal()));
+        sample.push_back(Metric("peak_memory_bytes", MemoryAccounting::instance().peakTotal()));
+        metricsReporter_->post(sample);
+    }
+
+    // write the timings and iteration counts of the run as "KEY VALUE" lines. the peak
+    // resident set size is the maximum over all processes, everything else is taken
+    // from the first process which also writes the file.
+    void writePerformanceRecord_(const std::string& fileName) const
+    {
+        const auto& comm = gridView().comm();
+
+        struct rusage usage;
+        double peakRss = 0.0;
+        if (::getrusage(RUSAGE_SELF, &usage) == 0)
+            // ru_maxrss is specified in kilobytes
+            peakRss = 1024.0*static_cast<double>(usage.ru_maxrss);
+        peakRss = comm.max(peakRss);
+
+        if (comm.rank() != 0)
+            return;
+
+        std::ofstream os(fileName);
+        if (!os)
+            OPM_THROW(std::runtime_error,
+                      "Could not open performance record file '" << fileName << "'");
+
+        os << std::setprecision(9)
+           << "problem " << problem_->name() << "\n"
+           << "num_processes " << comm.size() << "\n"
+           << "time_steps " << timeStepIdx_ << "\n"
+           << "newton_iterations " << totalNewtonIterations_ << "\n"
+           << "linear_iterations " << totalLinearIterations_ << "\n"
+           << "setup_seconds " << setupTimer_.realTimeElapsed() << "\n"
+           << "execution_seconds " << executionTimer_.realTimeElapsed() << "\n"
+           << "linearize_seconds " << linearizeTimer_.realTimeElapsed() << "\n"
+           << "solve_seconds " << solveTimer_.realTimeElapsed() << "\n"
+           << "update_seconds " << updateTimer_.realTimeElapsed() << "\n"
+           << "pre_post_process_seconds " << prePostProcessTimer_.realTimeElapsed() << "\n"
+           << "write_seconds " << writeTimer_.realTimeElapsed() << "\n"
+           << "peak_rss_bytes " << peakRss << "\n";
+    }
+
+    // print the times spent in the profiled regions for each process and write the
+    // trace file if requested
+    void writeProfile_() const
+    {
+        const auto& comm = gridView().comm();
+        const Profiler& profiler = Profiler::instance();
+        for (int rank = 0; rank < comm.size(); ++rank) {
+            comm.barrier();
+            if (rank != comm.rank())
+                continue;
+
+            std::cout << "Profile of process " << rank << ":\n";
+            profiler.printSummary(std::cout);
+        }
+
+        std::string traceFile = EWOMS_GET_PARAM(TypeTag, std::string, ProfilingTraceFile);
+        if (traceFile.empty())
+            return;
+        if (comm.size() > 1)
+            traceFile += "." + std::to_string(comm.rank());
+        profiler.writeTrace(traceFile, comm.rank());
+    }
+
     std::unique_ptr<GridManager> gridManager_;
     std::unique_ptr<Model> model_;
     std::unique_ptr<Problem> problem_;
+    std::unique_ptr<MetricsReporter> metricsReporter_;
+    std::unique_ptr<ForkedRestartWriter> restartWriter_;
 
     int episodeIdx_;
     Scalar episodeStartTime_;
@@ -877,8 +1098,12 @@ private:
     Scalar timeStepSize_;
     int timeStepIdx_;
 
+    unsigned long totalNewtonIterations_;
+    unsigned long totalLinearIterations_;
+
     bool finished_;
     bool verbose_;
+    bool printMemoryReport_;
 };
 } // namespace Ewoms
 
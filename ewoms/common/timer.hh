@@ -28,13 +28,78 @@
 #ifndef EWOMS_TIMER_HH
 #define EWOMS_TIMER_HH
 
-#include <chrono>
-
 #if HAVE_MPI
 #include <mpi.h>
 #endif
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define EWOMS_HAVE_TSC_CLOCK 1
+#endif
+
+#include <stdint.h>
+
+#include <chrono>
+#include <ctime>
+
 namespace Ewoms {
+/*!
+ * \ingroup Common
+ *
+ * \brief A clock which is as cheap to read as possible.
+ *
+ * On x86 CPUs, the time stamp counter is used, i.e., reading the clock does not
+ * involve the operating system. Else, the steady clock of the standard library is read
+ * whose ticks are nanoseconds. The ticks are converted to seconds using
+ * secondsPerTick(), which calibrates the time stamp counter against the steady clock
+ * the first time it is called.
+ */
+class TickClock
+{
+public:
+    /*!
+     * \brief Returns the current value of the clock.
+     */
+    static uint64_t now()
+    {
+#if EWOMS_HAVE_TSC_CLOCK
+        return static_cast<uint64_t>(__rdtsc());
+#else
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    /*!
+     * \brief Returns the duration of a tick of the clock [s].
+     */
+    static double secondsPerTick()
+    {
+        static const double result = calibrate_();
+        return result;
+    }
+
+private:
+    static double calibrate_()
+    {
+#if EWOMS_HAVE_TSC_CLOCK
+        // count the ticks of the time stamp counter during a few milliseconds
+        typedef std::chrono::steady_clock Clock;
+        Clock::time_point t1 = Clock::now();
+        uint64_t ticks1 = now();
+        Clock::time_point t2;
+        do {
+            t2 = Clock::now();
+        } while (t2 - t1 < std::chrono::milliseconds(5));
+        uint64_t ticks2 = now();
+
+        return std::chrono::duration<double>(t2 - t1).count()/static_cast<double>(ticks2 - ticks1);
+#else
+        return 1e-9;
+#endif
+    }
+};
+
 /*!
  * \ingroup Common
  *
@@ -44,6 +109,14 @@ namespace Ewoms {
  * used by all threads of a single process and the CPU time used by
  * the overall simulation. (i.e., the time used by all threads of all
  * involved processes.)
+ *
+ * By default, both the wall clock and the CPU time are queried each time the timer is
+ * started or stopped. Since querying the CPU time usually requires a system call, this
+ * is too expensive for timers which are started and stopped very often, e.g. for each
+ * element. Such timers should use the low-overhead mode: In this mode, the wall clock
+ * time is measured using the TickClock and the CPU time is only sampled for one in
+ * cpuSamplingPeriod intervals. The CPU time of the remaining intervals is estimated
+ * from the ratio of CPU to wall clock time of the sampled ones.
  */
 class Timer
 {
@@ -53,8 +126,17 @@ class Timer
         std::clock_t cputimeData;
     };
 public:
-    Timer()
-    { halt(); }
+    //! The number of measured intervals per sample of the CPU time in low-overhead mode
+    static const unsigned cpuSamplingPeriod = 64;
+
+    /*!
+     * \param lowOverhead Specifies whether the timer uses the low-overhead mode
+     */
+    explicit Timer(bool lowOverhead = false)
+    {
+        lowOverhead_ = lowOverhead;
+        halt();
+    }
 
     /*!
      * \brief Start counting the time resources used by the simulation.
@@ -62,7 +144,14 @@ public:
     void start()
     {
         isStopped_ = false;
-        measure_(startTime_);
+        if (lowOverhead_) {
+            sampleCpuTime_ = (numIntervals_ % cpuSamplingPeriod == 0);
+            if (sampleCpuTime_)
+                measure_(startTime_);
+            startTicks_ = TickClock::now();
+        }
+        else
+            measure_(startTime_);
     }
 
     /*!
@@ -73,6 +162,15 @@ public:
     double stop()
     {
         if (!isStopped_) {
+            if (lowOverhead_) {
+                ticksElapsed_ += TickClock::now() - startTicks_;
+                if (sampleCpuTime_)
+                    addCpuSample_();
+                ++numIntervals_;
+                isStopped_ = true;
+                return realTimeElapsed();
+            }
+
             TimeData stopTime;
 
             measure_(stopTime);
@@ -90,7 +188,7 @@ public:
 
         isStopped_ = true;
 
-        return realTimeElapsed_;
+        return realTimeElapsed();
     }
 
     /*!
@@ -101,6 +199,7 @@ public:
         isStopped_ = true;
         cpuTimeElapsed_ = 0.0;
         realTimeElapsed_ = 0.0;
+        resetLowOverhead_();
     }
 
     /*!
@@ -110,8 +209,11 @@ public:
     {
         cpuTimeElapsed_ = 0.0;
         realTimeElapsed_ = 0.0;
+        resetLowOverhead_();
 
         measure_(startTime_);
+        sampleCpuTime_ = true;
+        startTicks_ = TickClock::now();
     }
 
     /*!
@@ -120,6 +222,9 @@ public:
      */
     double realTimeElapsed() const
     {
+        if (lowOverhead_)
+            return realTimeElapsed_ + lowOverheadRealTime_();
+
         if (isStopped_)
             return realTimeElapsed_;
 
@@ -146,9 +251,27 @@ public:
     /*!
      * \brief Return the CPU time [s] used by all threads of the local process for the
      *        periods the timer was active
+     *
+     * In low-overhead mode, this is an estimate.
      */
     double cpuTimeElapsed() const
     {
+        if (lowOverhead_) {
+            double sampledRealTime = sampledRealTime_;
+            double sampledCpuTime = sampledCpuTime_;
+            if (!isStopped_ && sampleCpuTime_) {
+                TimeData stopTime;
+                measure_(stopTime);
+                sampledRealTime += realTimeDifference_(startTime_, stopTime);
+                sampledCpuTime += cpuTimeDifference_(startTime_, stopTime);
+            }
+
+            // if none of the sampled intervals was long enough to be measured, all
+            // time is assumed to be used by a single thread
+            double cpuPerRealTime = (sampledRealTime > 0.0) ? sampledCpuTime/sampledRealTime : 1.0;
+            return cpuTimeElapsed_ + cpuPerRealTime*lowOverheadRealTime_();
+        }
+
         if (isStopped_)
             return cpuTimeElapsed_;
 
@@ -156,10 +279,7 @@ public:
 
         measure_(stopTime);
 
-        const auto& t1 = startTime_.cputimeData;
-        const auto& t2 = stopTime.cputimeData;
-
-        return cpuTimeElapsed_ + static_cast<double>(t2 - t1)/CLOCKS_PER_SEC;
+        return cpuTimeElapsed_ + cpuTimeDifference_(startTime_, stopTime);
     }
 
     /*!
@@ -207,10 +327,54 @@ private:
         timeData.cputimeData = std::clock();
     }
 
+    static double realTimeDifference_(const TimeData& t1, const TimeData& t2)
+    { return std::chrono::duration<double>(t2.realtimeData - t1.realtimeData).count(); }
+
+    static double cpuTimeDifference_(const TimeData& t1, const TimeData& t2)
+    { return static_cast<double>(t2.cputimeData - t1.cputimeData)/CLOCKS_PER_SEC; }
+
+    void addCpuSample_()
+    {
+        TimeData stopTime;
+        measure_(stopTime);
+        sampledRealTime_ += realTimeDifference_(startTime_, stopTime);
+        sampledCpuTime_ += cpuTimeDifference_(startTime_, stopTime);
+    }
+
+    void resetLowOverhead_()
+    {
+        ticksElapsed_ = 0;
+        numIntervals_ = 0;
+        sampledRealTime_ = 0.0;
+        sampledCpuTime_ = 0.0;
+        sampleCpuTime_ = false;
+    }
+
+    // the wall clock time measured by the tick clock. in low-overhead mode, the times
+    // added from other timers are stored in realTimeElapsed_ and cpuTimeElapsed_.
+    double lowOverheadRealTime_() const
+    {
+        uint64_t ticks = ticksElapsed_;
+        if (!isStopped_)
+            ticks += TickClock::now() - startTicks_;
+        if (ticks == 0)
+            return 0.0;
+        return static_cast<double>(ticks)*TickClock::secondsPerTick();
+    }
+
     bool isStopped_;
     double cpuTimeElapsed_;
     double realTimeElapsed_;
     TimeData startTime_;
+
+    // state of the low-overhead mode
+    bool lowOverhead_;
+    bool sampleCpuTime_;
+    uint64_t startTicks_;
+    uint64_t ticksElapsed_;
+    unsigned long numIntervals_;
+    double sampledRealTime_;
+    double sampledCpuTime_;
 };
 } // namespace Ewoms
 
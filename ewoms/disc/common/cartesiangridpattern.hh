@@ -0,0 +1,192 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \copydoc Ewoms::CartesianGridPattern
+ */
+#ifndef EWOMS_CARTESIAN_GRID_PATTERN_HH
+#define EWOMS_CARTESIAN_GRID_PATTERN_HH
+
+#include <opm/common/Unused.hpp>
+
+#include <dune/common/version.hh>
+#include <dune/grid/yaspgrid.hh>
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+namespace Ewoms {
+/*!
+ * \brief Specifies whether the degrees of freedom of a stencil are exactly the element
+ *        which it is centered at and the elements which share a face with it.
+ *
+ * Stencils which exhibit this property can specialize this class. This allows to
+ * determine the sparsity pattern of the Jacobian matrix without iterating over the
+ * grid if the grid is Cartesian, cf. CartesianGridPattern.
+ */
+template <class Stencil>
+struct StencilIsFaceNeighborhood
+{ static const bool value = false; };
+
+/*!
+ * \brief Determines the sparsity pattern of a Jacobian matrix for element-centered
+ *        face-neighbor stencils using the Cartesian structure of a grid.
+ *
+ * For an unstructured grid, nothing can be done here, i.e., the pattern must be
+ * determined by iterating over the stencils of all elements.
+ */
+template <class Grid>
+class CartesianGridPattern
+{
+public:
+    /*!
+     * \brief Computes the neighbors of all elements of the grid.
+     *
+     * The neighbors of the element with index i are stored in
+     * neighbors[rowOffset[i]] to neighbors[rowOffset[i] + rowSize[i] - 1] in
+     * ascending order. If the pattern cannot be determined for the grid, false is
+     * returned and the output arguments are not modified.
+     */
+    template <class GridView>
+    static bool create(const GridView& gridView OPM_UNUSED,
+                       std::vector<size_t>& rowOffset OPM_UNUSED,
+                       std::vector<unsigned>& rowSize OPM_UNUSED,
+                       std::vector<unsigned>& neighbors OPM_UNUSED)
+    { return false; }
+};
+
+/*!
+ * \brief Determines the sparsity pattern of a Jacobian matrix for element-centered
+ *        face-neighbor stencils on YaspGrid.
+ *
+ * The elements of a YaspGrid are indexed lexicographically with the x direction
+ * running fastest, so the indices of the neighbors of an element follow from its
+ * Cartesian index. This is only done for sequential, non-periodic grids which have
+ * been refined uniformly, because the index sets of distributed YaspGrids also cover
+ * the overlap of the processes.
+ */
+#if DUNE_VERSION_NEWER(DUNE_GRID, 2, 4)
+template <int dim, class Coordinates>
+class CartesianGridPattern<Dune::YaspGrid<dim, Coordinates> >
+#else
+template <int dim>
+class CartesianGridPattern<Dune::YaspGrid<dim> >
+#endif
+{
+    static const unsigned numDims = static_cast<unsigned>(dim);
+
+public:
+    /*!
+     * \copydoc CartesianGridPattern::create
+     */
+    template <class GridView>
+    static bool create(const GridView& gridView,
+                       std::vector<size_t>& rowOffset,
+                       std::vector<unsigned>& rowSize,
+                       std::vector<unsigned>& neighbors)
+    {
+        const auto& grid = gridView.grid();
+        if (gridView.comm().size() > 1)
+            return false;
+
+        // the neighbors across periodic boundaries do not follow from the Cartesian
+        // index of the element
+        for (int dimIdx = 0; dimIdx < dim; ++dimIdx)
+            if (grid.isPeriodic(dimIdx))
+                return false;
+
+        std::array<int, dim> cellRes;
+        const auto& levelSize = grid.levelSize(grid.maxLevel());
+        size_t numCells = 1;
+        for (unsigned dimIdx = 0; dimIdx < numDims; ++dimIdx) {
+            cellRes[dimIdx] = levelSize[dimIdx];
+            numCells *= static_cast<size_t>(cellRes[dimIdx]);
+        }
+
+        // if the leaf grid is not the finest level, the grid is not a box
+        if (numCells != static_cast<size_t>(gridView.size(/*codim=*/0)))
+            return false;
+
+        std::array<size_t, dim> stride;
+        stride[0] = 1;
+        for (unsigned dimIdx = 1; dimIdx < numDims; ++dimIdx)
+            stride[dimIdx] = stride[dimIdx - 1]*static_cast<size_t>(cellRes[dimIdx - 1]);
+
+        // the number of neighbors of each cell: the cell itself and one for each
+        // direction in which the cell is not on the boundary of the grid
+        int numRows = static_cast<int>(numCells);
+        rowSize.resize(numCells);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+        for (int cellIdx = 0; cellIdx < numRows; ++cellIdx) {
+            unsigned n = 1;
+            for (unsigned dimIdx = 0; dimIdx < numDims; ++dimIdx) {
+                int ijk = static_cast<int>((static_cast<size_t>(cellIdx)/stride[dimIdx])
+                                           % static_cast<size_t>(cellRes[dimIdx]));
+                if (ijk > 0)
+                    ++n;
+                if (ijk < cellRes[dimIdx] - 1)
+                    ++n;
+            }
+            rowSize[static_cast<size_t>(cellIdx)] = n;
+        }
+
+        rowOffset.resize(numCells + 1);
+        rowOffset[0] = 0;
+        for (size_t cellIdx = 0; cellIdx < numCells; ++cellIdx)
+            rowOffset[cellIdx + 1] = rowOffset[cellIdx] + rowSize[cellIdx];
+        neighbors.resize(rowOffset[numCells]);
+
+        // fill the neighbor indices in ascending order: first the neighbors with lower
+        // indices, starting at the largest stride, then the cell itself, then the
+        // neighbors with higher indices
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+        for (int cellIdx = 0; cellIdx < numRows; ++cellIdx) {
+            size_t myIdx = static_cast<size_t>(cellIdx);
+            unsigned* dest = &neighbors[rowOffset[myIdx]];
+            for (unsigned k = numDims; k > 0; --k) {
+                unsigned dimIdx = k - 1;
+                int ijk = static_cast<int>((myIdx/stride[dimIdx]) % static_cast<size_t>(cellRes[dimIdx]));
+                if (ijk > 0)
+                    *dest++ = static_cast<unsigned>(myIdx - stride[dimIdx]);
+            }
+            *dest++ = static_cast<unsigned>(myIdx);
+            for (unsigned dimIdx = 0; dimIdx < numDims; ++dimIdx) {
+                int ijk = static_cast<int>((myIdx/stride[dimIdx]) % static_cast<size_t>(cellRes[dimIdx]));
+                if (ijk < cellRes[dimIdx] - 1)
+                    *dest++ = static_cast<unsigned>(myIdx + stride[dimIdx]);
+            }
+        }
+
+        return true;
+    }
+};
+
+} // namespace Ewoms
+
+#endif
@@ -0,0 +1,544 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \copydoc Ewoms::FvBaseAdjointDriver
+ */
+#ifndef EWOMS_FV_BASE_ADJOINT_DRIVER_HH
+#define EWOMS_FV_BASE_ADJOINT_DRIVER_HH
+
+#include "fvbaseproperties.hh"
+#include "fvbasejacobianstore.hh"
+#include "linearizationtype.hh"
+
+#include <ewoms/common/parametersystem.hh>
+
+#include <opm/common/ErrorMacros.hpp>
+#include <opm/common/Exceptions.hpp>
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cassert>
+
+namespace Ewoms {
+/*!
+ * \ingroup FiniteVolumeDiscretizations
+ *
+ * \brief Runs a simulation forward and then solves the discrete adjoint equations
+ *        backward in time using binomial checkpointing.
+ *
+ * For a time step \f$n\f$, the residual \f$R_n(x_n, x_{n-1}) = 0\f$ relates the solution
+ * at the end of the step to the one at its beginning. Given the derivatives \f$g_n\f$ of
+ * an objective function w.r.t. the solution after each time step, the driver solves
+ *
+ * \f[
+ * J_n^T \lambda_n = g_n - B_{n+1}^T \lambda_{n+1}
+ * \f]
+ *
+ * for \f$n = N, \dots, 1\f$, where \f$J_n = \partial R_n/\partial x_n\f$ and \f$B_n =
+ * \partial R_n/\partial x_{n-1}\f$. Only the storage term of the solution at the
+ * beginning of a time step depends on \f$x_{n-1}\f$, i.e., \f$B_n\f$ is the derivative of
+ * \f$-S(x_{n-1})/\Delta t\f$ for the implicit Euler scheme. If the local linearizer
+ * assembles both Jacobians in a single sweep (cf. the EnableAdjointLinearization
+ * property), \f$B_n\f$ is taken from FvBaseLinearizer::matrixA(), else the residual is
+ * linearized a second time w.r.t. the solution at the beginning of the time step, which
+ * only assembles the derivatives of this storage term.
+ *
+ * Instead of storing the solution after each time step, only the initial solution plus
+ * a fixed number of snapshots (cf. the AdjointNumCheckpoints parameter) is kept in
+ * memory and the intermediate solutions are recomputed on demand. The snapshots are
+ * placed according to the binomial ("revolve") schedule by Griewank and Walther which
+ * minimizes the number of recomputed time steps. The sizes of the time steps taken by
+ * the forward sweep are recorded, so the recomputation reproduces it exactly.
+ *
+ * Alternatively, the Jacobian matrices of all time steps can be written to disk by the
+ * forward sweep (cf. the AdjointJacobianStoreDirectory parameter and
+ * Ewoms::FvBaseJacobianStore). In this case, no time step needs to be recomputed, but
+ * the solutions of all time steps are kept in memory because the objective function
+ * may depend on them.
+ *
+ * A snapshot consists of the primary variables and the state of the simulator's clock
+ * only. Problems which exhibit additional state that evolves over time (and that does
+ * not get re-established by their beginEpisode() and beginTimeStep() methods) are not
+ * supported yet.
+ */
+template <class TypeTag>
+class FvBaseAdjointDriver
+{
+    typedef typename GET_PROP_TYPE(TypeTag, Simulator) Simulator;
+    typedef typename GET_PROP_TYPE(TypeTag, Scalar) Scalar;
+    typedef typename GET_PROP_TYPE(TypeTag, SolutionVector) SolutionVector;
+    typedef typename GET_PROP_TYPE(TypeTag, GlobalEqVector) GlobalEqVector;
+    typedef FvBaseJacobianStore<TypeTag> JacobianStore;
+
+    enum { enableAdjointLinearization = GET_PROP_VALUE(TypeTag, EnableAdjointLinearization) };
+
+    struct Checkpoint_
+    {
+        SolutionVector solution;
+        int episodeIdx;
+        Scalar episodeStartTime;
+        Scalar episodeLength;
+        Scalar time;
+        int timeStepIdx;
+    };
+
+public:
+    FvBaseAdjointDriver(Simulator& simulator)
+        : simulator_(simulator)
+    {
+        numCheckpoints_ = EWOMS_GET_PARAM(TypeTag, unsigned, AdjointNumCheckpoints);
+        numRecomputedTimeSteps_ = 0;
+
+        const std::string& storeDir =
+            EWOMS_GET_PARAM(TypeTag, std::string, AdjointJacobianStoreDirectory);
+        if (!storeDir.empty()) {
+            std::ostringstream oss;
+            oss << storeDir << "/jacobian-rank" << simulator_.gridView().comm().rank();
+            jacobianStore_.init(oss.str(),
+                                EWOMS_GET_PARAM(TypeTag, bool, AdjointJacobianStoreSinglePrecision));
+        }
+    }
+
+    /*!
+     * \brief Register all run-time parameters for the adjoint driver.
+     *
+     * This needs to be called by the registerParameters() method of the problem.
+     */
+    static void registerParameters()
+    {
+        EWOMS_REGISTER_PARAM(TypeTag, unsigned, AdjointNumCheckpoints,
+                             "The number of solutions kept in memory by the backward sweep "
+                             "of the adjoint model");
+        EWOMS_REGISTER_PARAM(TypeTag, std::string, AdjointJacobianStoreDirectory,
+                             "The directory to which the Jacobian matrices of the forward "
+                             "sweep are written for the adjoint model. If empty, the time "
+                             "steps are recomputed instead");
+        EWOMS_REGISTER_PARAM(TypeTag, bool, AdjointJacobianStoreSinglePrecision,
+                             "Truncate the Jacobian matrices written for the adjoint model "
+                             "to single precision");
+    }
+
+    /*!
+     * \brief Run the simulation and solve the adjoint equations afterwards.
+     *
+     * The 'stateGradient' argument must be callable as
+     * \code
+     * stateGradient(GlobalEqVector& g, unsigned stepIdx);
+     * \endcode
+     * and is supposed to add the partial derivatives of the objective function w.r.t.
+     * the solution after the time step 'stepIdx' to 'g'. When it is called, the model
+     * exhibits this solution as its most recent one. The step index 0 denotes the
+     * initial solution.
+     *
+     * After this method has returned, the model is in the state of the initial
+     * solution.
+     */
+    template <class StateGradient>
+    void run(StateGradient& stateGradient)
+    {
+        if (simulator_.model().enableStorageCache()
+            || simulator_.model().storeIntensiveQuantities())
+        {
+            OPM_THROW(std::logic_error,
+                      "The adjoint driver requires the storage and the intensive quantity "
+                      "caches to be disabled");
+        }
+
+        forwardSweep_();
+
+        size_t numDof = simulator_.model().numTotalDof();
+        rhs_.resize(numDof);
+        lambda_.resize(numDof);
+        adjointRhsContrib_.resize(numDof);
+        adjointRhsContrib_ = 0.0;
+
+        numRecomputedTimeSteps_ = 0;
+        unsigned numSteps = numTimeSteps();
+        if (jacobianStore_.enabled())
+            storedBackwardSweep_(stateGradient);
+        else if (numSteps > 0)
+            backwardSweep_(stateGradient, /*firstStepIdx=*/0, numSteps, numCheckpoints_);
+
+        // the sensitivity of the objective function w.r.t. the initial solution
+        restoreCheckpoint_(checkpoints_.front());
+        initialStateGradient_.resize(numDof);
+        initialStateGradient_ = 0.0;
+        stateGradient(initialStateGradient_, /*stepIdx=*/0);
+        initialStateGradient_ -= adjointRhsContrib_;
+    }
+
+    /*!
+     * \brief Returns the number of time steps done by the forward sweep.
+     */
+    unsigned numTimeSteps() const
+    { return static_cast<unsigned>(timeStepSizes_.size()); }
+
+    /*!
+     * \brief Returns the number of time steps which needed to be recomputed during the
+     *        backward sweep.
+     */
+    unsigned numRecomputedTimeSteps() const
+    { return numRecomputedTimeSteps_; }
+
+    /*!
+     * \brief Returns the adjoint variables of the time step which was handled last.
+     *
+     * After run() has returned, these are the ones of the first time step.
+     */
+    const GlobalEqVector& adjointSolution() const
+    { return lambda_; }
+
+    /*!
+     * \brief Returns the total derivative of the objective function w.r.t. the initial
+     *        solution.
+     */
+    const GlobalEqVector& initialStateGradient() const
+    { return initialStateGradient_; }
+
+protected:
+    void forwardSweep_()
+    {
+        auto& problem = simulator_.problem();
+
+        simulator_.model().applyInitialSolution();
+        if (problem.shouldWriteOutput()) {
+            problem.writeOutput();
+            simulator_.model().outputWritten();
+        }
+
+        timeStepSizes_.clear();
+        episodeBegins_.clear();
+        checkpoints_.clear();
+        checkpoints_.push_back(makeCheckpoint_());
+        storedSolutions_.clear();
+        if (jacobianStore_.enabled())
+            storedSolutions_.push_back(simulator_.model().solution(/*timeIdx=*/0));
+
+        bool episodeBegins = simulator_.episodeIsOver() || (simulator_.timeStepIndex() == 0);
+        while (!simulator_.finished()) {
+            if (episodeBegins) {
+                problem.beginEpisode();
+                if (simulator_.finished()) {
+                    problem.endEpisode();
+                    break;
+                }
+            }
+
+            problem.beginTimeStep();
+            if (simulator_.finished()) {
+                problem.endTimeStep();
+                problem.endEpisode();
+                break;
+            }
+
+            problem.timeIntegration();
+            problem.endTimeStep();
+
+            if (problem.shouldWriteOutput()) {
+                problem.writeOutput();
+                simulator_.model().outputWritten();
+            }
+
+            // the time integration may have reduced the step size
+            timeStepSizes_.push_back(simulator_.timeStepSize());
+            episodeBegins_.push_back(episodeBegins);
+
+            if (jacobianStore_.enabled())
+                storeTimeStep_(numTimeSteps());
+
+            episodeBegins = advanceTimeLevel_();
+            if (!episodeBegins)
+                simulator_.setTimeStepSize(problem.nextTimeStepSize());
+        }
+    }
+
+    // write the Jacobians of the time step which was just completed to disk
+    void storeTimeStep_(unsigned stepIdx)
+    {
+        auto& model = simulator_.model();
+        auto& linearizer = model.linearizer();
+
+        storedSolutions_.push_back(model.solution(/*timeIdx=*/0));
+
+        // the Newton method's last linearization was done before the final update of
+        // the solution
+        linearizer.linearize();
+        jacobianStore_.store(stepIdx, JacobianStore::jacobianIdx, linearizer.matrix());
+
+        if (enableAdjointLinearization)
+            jacobianStore_.store(stepIdx, JacobianStore::previousJacobianIdx, linearizer.matrixA());
+        else {
+            linearizer.setLinearizationType(LinearizationType(/*timeIdx=*/1));
+            linearizer.linearize();
+            linearizer.setLinearizationType(LinearizationType());
+            jacobianStore_.store(stepIdx, JacobianStore::previousJacobianIdx, linearizer.matrix());
+        }
+    }
+
+    // handle the adjoint equations of all time steps using the Jacobians stored by the
+    // forward sweep
+    template <class StateGradient>
+    void storedBackwardSweep_(StateGradient& stateGradient)
+    {
+        auto& model = simulator_.model();
+        auto& linearizer = model.linearizer();
+
+        for (unsigned stepIdx = numTimeSteps(); stepIdx > 0; -- stepIdx) {
+            jacobianStore_.load(stepIdx);
+
+            model.solution(/*timeIdx=*/0) = storedSolutions_[stepIdx];
+            model.solution(/*timeIdx=*/1) = storedSolutions_[stepIdx - 1];
+
+            rhs_ = 0.0;
+            stateGradient(rhs_, stepIdx);
+            rhs_ -= adjointRhsContrib_;
+
+            jacobianStore_.copyTo(JacobianStore::jacobianIdx, linearizer.matrix());
+            solveAdjointSystem_(stepIdx);
+
+            jacobianStore_.copyTo(JacobianStore::previousJacobianIdx, linearizer.matrix());
+            linearizer.matrix().mtv(lambda_, adjointRhsContrib_);
+
+            // the solution of the time step is not required anymore
+            storedSolutions_.pop_back();
+        }
+        storedSolutions_.clear();
+    }
+
+    /*!
+     * \brief Handle the adjoint equations of the time steps (firstStepIdx, lastStepIdx].
+     *
+     * The checkpoint which was taken last must represent the solution after the time
+     * step 'firstStepIdx', and the contribution of the adjoint variables of the time step
+     * after 'lastStepIdx' must already be known.
+     */
+    template <class StateGradient>
+    void backwardSweep_(StateGradient& stateGradient,
+                        unsigned firstStepIdx,
+                        unsigned lastStepIdx,
+                        unsigned numFreeCheckpoints)
+    {
+        unsigned numSteps = lastStepIdx - firstStepIdx;
+        if (numSteps == 1) {
+            restoreCheckpoint_(checkpoints_.back());
+            adjointTimeStep_(stateGradient, lastStepIdx);
+            return;
+        }
+
+        if (numFreeCheckpoints == 0) {
+            // no snapshot left: recompute everything from the last checkpoint
+            for (unsigned stepIdx = lastStepIdx; stepIdx > firstStepIdx; -- stepIdx) {
+                restoreCheckpoint_(checkpoints_.back());
+                for (unsigned i = firstStepIdx + 1; i < stepIdx; ++i)
+                    recomputeTimeStep_(i);
+                adjointTimeStep_(stateGradient, stepIdx);
+            }
+            return;
+        }
+
+        // advance to the position of the next checkpoint and handle the rest of the
+        // interval using one checkpoint less. Then, release it and do the first part.
+        unsigned midStepIdx = firstStepIdx + binomialAdvance_(numSteps, numFreeCheckpoints);
+        restoreCheckpoint_(checkpoints_.back());
+        for (unsigned i = firstStepIdx + 1; i <= midStepIdx; ++i)
+            recomputeTimeStep_(i);
+        checkpoints_.push_back(makeCheckpoint_());
+        backwardSweep_(stateGradient, midStepIdx, lastStepIdx, numFreeCheckpoints - 1);
+        checkpoints_.pop_back();
+
+        backwardSweep_(stateGradient, firstStepIdx, midStepIdx, numFreeCheckpoints);
+    }
+
+    /*!
+     * \brief Recompute the time step 'stepIdx' and solve its adjoint equations.
+     *
+     * The model is supposed to exhibit the solution at the beginning of the time step.
+     */
+    template <class StateGradient>
+    void adjointTimeStep_(StateGradient& stateGradient, unsigned stepIdx)
+    {
+        auto& model = simulator_.model();
+        auto& linearizer = model.linearizer();
+
+        replayTimeStep_(stepIdx);
+
+        rhs_ = 0.0;
+        stateGradient(rhs_, stepIdx);
+        rhs_ -= adjointRhsContrib_;
+
+        linearizer.linearize();
+        solveAdjointSystem_(stepIdx);
+
+        // contribution of the adjoint variables of this time step to the right hand side
+        // of the previous one
+        if (enableAdjointLinearization)
+            linearizer.matrixA().mtv(lambda_, adjointRhsContrib_);
+        else {
+            linearizer.setLinearizationType(LinearizationType(/*timeIdx=*/1));
+            linearizer.linearize();
+            linearizer.setLinearizationType(LinearizationType());
+            linearizer.matrix().mtv(lambda_, adjointRhsContrib_);
+        }
+    }
+
+    // solve the transposed system of the linearizer's matrix for the adjoint variables
+    // of a time step. the right hand side must already be stored in 'rhs_'.
+    void solveAdjointSystem_(unsigned stepIdx)
+    {
+        auto& model = simulator_.model();
+        auto& linearizer = model.linearizer();
+
+        auto& linearSolver = model.newtonMethod().linearSolver();
+        linearSolver.prepareRhs(linearizer.matrix(), rhs_);
+        linearSolver.prepareMatrix(linearizer.matrix());
+        lambda_ = 0.0;
+        if (!linearSolver.solveTransposed(lambda_))
+            OPM_THROW(Opm::NumericalProblem,
+                      "The linear solver did not converge for the adjoint system of time step "
+                      << stepIdx);
+    }
+
+    void recomputeTimeStep_(unsigned stepIdx)
+    {
+        replayTimeStep_(stepIdx);
+        advanceTimeLevel_();
+    }
+
+    // redo a time step of the forward sweep without writing any output
+    void replayTimeStep_(unsigned stepIdx)
+    {
+        auto& problem = simulator_.problem();
+        Scalar dt = timeStepSizes_[stepIdx - 1];
+
+        if (episodeBegins_[stepIdx - 1])
+            problem.beginEpisode();
+        problem.beginTimeStep();
+
+        simulator_.setTimeStepSize(dt);
+        problem.timeIntegration();
+        problem.endTimeStep();
+        ++ numRecomputedTimeSteps_;
+
+        if (std::abs(simulator_.timeStepSize() - dt) > 1e-8*dt)
+            OPM_THROW(Opm::NumericalProblem,
+                      "Recomputing time step " << stepIdx << " of the adjoint sweep did "
+                      "not reproduce the step size of the forward simulation");
+    }
+
+    // returns true if an episode begins with the next time step
+    bool advanceTimeLevel_()
+    {
+        Scalar dt = simulator_.timeStepSize();
+        simulator_.problem().advanceTimeLevel();
+        simulator_.setTime(simulator_.time() + dt,
+                           static_cast<unsigned>(simulator_.timeStepIndex() + 1));
+
+        if (simulator_.episodeIsOver()) {
+            simulator_.problem().endEpisode();
+            return true;
+        }
+
+        return false;
+    }
+
+    Checkpoint_ makeCheckpoint_() const
+    {
+        Checkpoint_ checkpoint;
+        checkpoint.solution = simulator_.model().solution(/*timeIdx=*/0);
+        checkpoint.episodeIdx = simulator_.episodeIndex();
+        checkpoint.episodeStartTime = simulator_.episodeStartTime();
+        checkpoint.episodeLength = simulator_.episodeLength();
+        checkpoint.time = simulator_.time();
+        checkpoint.timeStepIdx = simulator_.timeStepIndex();
+
+        return checkpoint;
+    }
+
+    void restoreCheckpoint_(const Checkpoint_& checkpoint)
+    {
+        auto& model = simulator_.model();
+
+        simulator_.setEpisodeIndex(checkpoint.episodeIdx);
+        simulator_.setEpisodeStartTime(checkpoint.episodeStartTime);
+        simulator_.setEpisodeLength(checkpoint.episodeLength);
+        simulator_.setTime(checkpoint.time, static_cast<unsigned>(checkpoint.timeStepIdx));
+
+        model.solution(/*timeIdx=*/0) = checkpoint.solution;
+        model.solution(/*timeIdx=*/1) = checkpoint.solution;
+    }
+
+    // the number of time steps to advance before the next checkpoint is taken for an
+    // interval of 'numSteps' time steps if 'numFreeCheckpoints' snapshots are available.
+    static unsigned binomialAdvance_(unsigned numSteps, unsigned numFreeCheckpoints)
+    {
+        assert(numSteps > 1 && numFreeCheckpoints > 0);
+
+        // determine the minimum number of repetitions required for the interval
+        unsigned numRepetitions = 0;
+        while (binomialBeta_(numFreeCheckpoints, numRepetitions) < numSteps)
+            ++ numRepetitions;
+
+        // the rest of the interval must be handled with one checkpoint less
+        unsigned long numRightSteps = binomialBeta_(numFreeCheckpoints - 1, numRepetitions);
+        if (numRightSteps >= numSteps)
+            return 1;
+        return std::max<unsigned>(1, numSteps - static_cast<unsigned>(numRightSteps));
+    }
+
+    // the maximum number of time steps which can be reversed using 'numCheckpoints'
+    // snapshots if each step is recomputed at most 'numRepetitions' times, i.e.,
+    // (numCheckpoints + numRepetitions)!/(numCheckpoints! numRepetitions!)
+    static unsigned long binomialBeta_(unsigned numCheckpoints, unsigned numRepetitions)
+    {
+        unsigned long result = 1;
+        for (unsigned i = 1; i <= numRepetitions; ++i)
+            result = result*(numCheckpoints + i)/i;
+        return result;
+    }
+
+    Simulator& simulator_;
+
+    unsigned numCheckpoints_;
+    unsigned numRecomputedTimeSteps_;
+
+    std::vector<Scalar> timeStepSizes_;
+    std::vector<bool> episodeBegins_;
+    std::vector<Checkpoint_> checkpoints_;
+
+    JacobianStore jacobianStore_;
+    std::vector<SolutionVector> storedSolutions_;
+
+    GlobalEqVector rhs_;
+    GlobalEqVector lambda_;
+    GlobalEqVector adjointRhsContrib_;
+    GlobalEqVector initialStateGradient_;
+};
+
+} // namespace Ewoms
+
+#endif
@@ -0,0 +1,189 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \copydoc Ewoms::FvBaseAdjointLocalLinearizer
+ */
+#ifndef EWOMS_FV_BASE_ADJOINT_LOCAL_LINEARIZER_HH
+#define EWOMS_FV_BASE_ADJOINT_LOCAL_LINEARIZER_HH
+
+#include "fvbaseadlocallinearizer.hh"
+
+#include <ewoms/common/parametersystem.hh>
+
+#include <opm/common/ErrorMacros.hpp>
+#include <opm/common/Exceptions.hpp>
+
+namespace Ewoms {
+// forward declaration
+template<class TypeTag>
+class FvBaseAdjointLocalLinearizer;
+
+namespace Properties {
+// declare the property tags required for the adjoint local linearizer
+NEW_TYPE_TAG(AdjointLocalLinearizer);
+
+NEW_PROP_TAG(LocalLinearizer);
+NEW_PROP_TAG(Evaluation);
+NEW_PROP_TAG(EnableAdjointLinearization);
+NEW_PROP_TAG(EnableIntensiveQuantityCache);
+NEW_PROP_TAG(EnableStorageCache);
+NEW_PROP_TAG(Scalar);
+NEW_PROP_TAG(NumEq);
+
+// set the properties to be spliced in
+SET_TYPE_PROP(AdjointLocalLinearizer, LocalLinearizer,
+              Ewoms::FvBaseAdjointLocalLinearizer<TypeTag>);
+
+//! compute the derivatives w.r.t. the current solution and the one at the beginning of
+//! the time step in a single sweep
+SET_BOOL_PROP(AdjointLocalLinearizer, EnableAdjointLinearization, true);
+
+//! Set the function evaluation w.r.t. the primary variables of both time indices
+SET_PROP(AdjointLocalLinearizer, Evaluation)
+{
+private:
+    static const unsigned numEq = GET_PROP_VALUE(TypeTag, NumEq);
+
+    typedef typename GET_PROP_TYPE(TypeTag, Scalar) Scalar;
+
+public:
+    typedef Opm::DenseAd::Evaluation<Scalar, 2*numEq> type;
+};
+
+} // namespace Properties
+
+/*!
+ * \ingroup FiniteVolumeDiscretizations
+ *
+ * \brief Calculates the local residual and its Jacobians w.r.t. the current solution as
+ *        well as w.r.t. the solution at the beginning of the time step.
+ *
+ * This class uses automatic differentiation with an evaluation that features 2*numEq
+ * derivatives: The first numEq ones are seeded by the primary variables of time index 0,
+ * the remaining ones by the primary variables of time index 1. This means that the
+ * sensitivities which are required by adjoint methods come out of the same evaluation of
+ * the local residual as the Jacobian used by the Newton method.
+ *
+ * Since the intensive quantities of time index 1 need to be evaluated including their
+ * derivatives, neither the intensive quantity cache nor the storage cache can be used
+ * in conjunction with this linearizer.
+ */
+template<class TypeTag>
+class FvBaseAdjointLocalLinearizer : public FvBaseAdLocalLinearizer<TypeTag>
+{
+    typedef FvBaseAdLocalLinearizer<TypeTag> ParentType;
+
+    typedef typename GET_PROP_TYPE(TypeTag, Simulator) Simulator;
+    typedef typename GET_PROP_TYPE(TypeTag, ElementContext) ElementContext;
+    typedef typename GET_PROP_TYPE(TypeTag, Scalar) Scalar;
+    typedef typename GET_PROP_TYPE(TypeTag, GridView) GridView;
+    typedef typename GridView::template Codim<0>::Entity Element;
+
+    enum { numEq = GET_PROP_VALUE(TypeTag, NumEq) };
+
+    typedef Dune::FieldMatrix<Scalar, numEq, numEq> ScalarMatrixBlock;
+    typedef Dune::Matrix<ScalarMatrixBlock> ScalarLocalBlockMatrix;
+
+public:
+    FvBaseAdjointLocalLinearizer()
+        : ParentType()
+    { }
+
+    // copying local linearizer objects around is a very bad idea, so we explicitly
+    // prevent it...
+    FvBaseAdjointLocalLinearizer(const FvBaseAdjointLocalLinearizer&) = delete;
+
+    /*!
+     * \copydoc FvBaseAdLocalLinearizer::init
+     */
+    void init(Simulator& simulator)
+    {
+        if (EWOMS_GET_PARAM(TypeTag, bool, EnableIntensiveQuantityCache)
+            || EWOMS_GET_PARAM(TypeTag, bool, EnableStorageCache))
+            OPM_THROW(std::logic_error,
+                      "The adjoint linearizer requires the intensive quantities and the "
+                      "storage terms of the previous solution to be evaluated from scratch. "
+                      "Disable the intensive quantity and the storage caches.");
+
+        ParentType::init(simulator);
+    }
+
+    /*!
+     * \copydoc FvBaseAdLocalLinearizer::linearize(const Element&)
+     */
+    void linearize(const Element& element)
+    {
+        this->internalElemContext_->updateAll(element);
+
+        linearize(*this->internalElemContext_);
+    }
+
+    /*!
+     * \brief Compute an element's local Jacobian matrices and evaluate its residual.
+     *
+     * Besides the Jacobian w.r.t. the primary variables of the most recent solution
+     * (see jacobian()), this also computes the one w.r.t. the primary variables at the
+     * beginning of the time step (see adjointJacobian()).
+     *
+     * \param elemCtx The element execution context for which the local residual and its
+     *                local Jacobians should be calculated.
+     */
+    void linearize(ElementContext& elemCtx)
+    {
+        ParentType::linearize(elemCtx);
+
+        size_t numDof = elemCtx.numDof(/*timeIdx=*/0);
+        size_t numPrimaryDof = elemCtx.numPrimaryDof(/*timeIdx=*/0);
+        adjointJacobian_.setSize(numDof, numPrimaryDof);
+
+        const auto& resid = this->localResidual_.residual();
+        for (unsigned primaryDofIdx = 0; primaryDofIdx < numPrimaryDof; ++primaryDofIdx)
+            for (unsigned dofIdx = 0; dofIdx < numDof; dofIdx++)
+                // the derivatives w.r.t. the solution at the beginning of the time step
+                // are stored after the ones for the current solution
+                this->copyDerivatives_(adjointJacobian_[dofIdx][primaryDofIdx],
+                                       resid[dofIdx],
+                                       /*derivOffset=*/numEq);
+    }
+
+    /*!
+     * \brief Returns the local Jacobian matrix of the residual of a sub-control volume
+     *        w.r.t. the primary variables at the beginning of the time step.
+     *
+     * \param domainScvIdx The local index of the sub control volume to which the primary
+     *                     variables are associated with
+     * \param rangeScvIdx The local index of the sub control volume which contains the
+     *                    local residual
+     */
+    const ScalarMatrixBlock& adjointJacobian(unsigned domainScvIdx, unsigned rangeScvIdx) const
+    { return adjointJacobian_[domainScvIdx][rangeScvIdx]; }
+
+private:
+    ScalarLocalBlockMatrix adjointJacobian_;
+};
+
+} // namespace Ewoms
+
+#endif
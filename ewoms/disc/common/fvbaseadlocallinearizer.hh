@@ -61,11 +61,15 @@ NEW_PROP_TAG(ElementContext);
 NEW_PROP_TAG(Scalar);
 NEW_PROP_TAG(Evaluation);
 NEW_PROP_TAG(GridView);
+NEW_PROP_TAG(EnableAdjointLinearization);
 
 // set the properties to be spliced in
 SET_TYPE_PROP(AutoDiffLocalLinearizer, LocalLinearizer,
               Ewoms::FvBaseAdLocalLinearizer<TypeTag>);
 
+//! only compute the derivatives w.r.t. the most recent solution
+SET_BOOL_PROP(AutoDiffLocalLinearizer, EnableAdjointLinearization, false);
+
 //! Set the function evaluation w.r.t. the primary variables
 SET_PROP(AutoDiffLocalLinearizer, Evaluation)
 {
@@ -182,20 +186,12 @@ public:
         model_().updatePVWeights(elemCtx); // Does absolutely nothing
 
         resize_(elemCtx); // sets the size of the local jacobian and the residual
-        reset_(elemCtx); // sets both to 0.
+        reset_(elemCtx); // sets the residual to 0.
 
         // calculate the local residual
         localResidual_.eval(elemCtx);
 
-        unsigned timeIdx = 0;
-        std::string wrtInitial = "";
-        std::ifstream inputFile;
-        inputFile.open("/home/joakimra/yesno.txt");
-        getline(inputFile, wrtInitial);
-        inputFile.close();
-        if (wrtInitial=="true"){
-            timeIdx = 1 ;
-        }
+        unsigned timeIdx = elemCtx.linearizationType().time;
 
         // calculate the local jacobian matrix
         size_t numPrimaryDof = elemCtx.numPrimaryDof(timeIdx);
@@ -267,11 +263,13 @@ protected:
 
     /*!
      * \brief Reset the all relevant internal attributes to 0
+     *
+     * The local Jacobian is not reset because all of its blocks are overwritten by
+     * updateLocalLinearization_().
      */
     void reset_(const ElementContext& elemCtx OPM_UNUSED)
     {
         residual_ = 0.0;
-        jacobian_ = 0.0;
     }
 
     /*!
@@ -286,20 +284,35 @@ protected:
         for (unsigned eqIdx = 0; eqIdx < numEq; eqIdx++)
             residual_[primaryDofIdx][eqIdx] = resid[primaryDofIdx][eqIdx].value();
 
+        // A[dofIdx][primaryDofIdx][eqIdx][pvIdx] is the partial derivative of the
+        // residual function 'eqIdx' for the degree of freedom 'dofIdx' with regard to
+        // the primary variable 'pvIdx' of the degree of freedom 'primaryDofIdx'
         size_t numDof = elemCtx.numDof(/*timeIdx=*/0);
-        for (unsigned dofIdx = 0; dofIdx < numDof; dofIdx++) {
-            for (unsigned eqIdx = 0; eqIdx < numEq; eqIdx++) {
-                for (unsigned pvIdx = 0; pvIdx < numEq; pvIdx++) {
-                    // A[dofIdx][primaryDofIdx][eqIdx][pvIdx] is the partial derivative of
-                    // the residual function 'eqIdx' for the degree of freedom 'dofIdx' with
-                    // regard to the primary variable 'pvIdx' of the degree of freedom
-                    // 'primaryDofIdx'
-                    jacobian_[dofIdx][primaryDofIdx][eqIdx][pvIdx] =
-                        resid[dofIdx][eqIdx].derivative(pvIdx);
-                    Opm::Valgrind::CheckDefined(jacobian_[dofIdx][primaryDofIdx][eqIdx][pvIdx]);
-                }
-            }
+        for (unsigned dofIdx = 0; dofIdx < numDof; dofIdx++)
+            copyDerivatives_(jacobian_[dofIdx][primaryDofIdx], resid[dofIdx], /*derivOffset=*/0);
+    }
+
+    /*!
+     * \brief Copy the derivatives of the residual of a degree of freedom into a block of
+     *        a local Jacobian matrix.
+     *
+     * The derivatives which are copied are the ones with the indices [derivOffset,
+     * derivOffset + numEq). Since the size of the blocks is a compile-time constant,
+     * the loops of this method are fully unrolled by the compiler and the rows of the
+     * block are written contiguously.
+     */
+    template <class EvalVector>
+    static void copyDerivatives_(ScalarMatrixBlock& dest,
+                                 const EvalVector& resid,
+                                 unsigned derivOffset)
+    {
+        for (unsigned eqIdx = 0; eqIdx < numEq; eqIdx++) {
+            const auto& eval = resid[eqIdx];
+            auto& destRow = dest[eqIdx];
+            for (unsigned pvIdx = 0; pvIdx < numEq; pvIdx++)
+                destRow[pvIdx] = eval.derivative(derivOffset + pvIdx);
         }
+        Opm::Valgrind::CheckDefined(dest);
     }
 
     Simulator *simulatorPtr_;
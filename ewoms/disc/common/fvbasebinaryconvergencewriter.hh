@@ -0,0 +1,358 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \copydoc Ewoms::FvBaseBinaryConvergenceWriter
+ */
+#ifndef EWOMS_FV_BASE_BINARY_CONVERGENCE_WRITER_HH
+#define EWOMS_FV_BASE_BINARY_CONVERGENCE_WRITER_HH
+
+#include <ewoms/common/propertysystem.hh>
+#include <ewoms/common/parametersystem.hh>
+
+#include <opm/common/Unused.hpp>
+#include <opm/common/Exceptions.hpp>
+#include <opm/common/ErrorMacros.hpp>
+
+#if HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#if HAVE_LZ4
+#include <lz4.h>
+#endif
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace Ewoms {
+//! \cond SKIP_THIS
+namespace Properties {
+NEW_PROP_TAG(GridView);
+NEW_PROP_TAG(ElementContext);
+NEW_PROP_TAG(NewtonMethod);
+NEW_PROP_TAG(SolutionVector);
+NEW_PROP_TAG(GlobalEqVector);
+NEW_PROP_TAG(NumEq);
+
+//! The algorithm used to compress the binary convergence log ('none', 'zlib' or 'lz4')
+NEW_PROP_TAG(NewtonConvergenceCompression);
+} // namespace Properties
+//! \endcond
+
+/*!
+ * \ingroup FiniteVolumeDiscretizations
+ *
+ * \brief Appends the residual and the update of each Newton iteration to a compact
+ *        binary file.
+ *
+ * In contrast to FvBaseNewtonConvergenceWriter, no VTK file is written and no
+ * quantities need to be recomputed: The residual is the one of the most recent
+ * linearization and both vectors are stored in single precision, optionally
+ * compressed using zlib or LZ4. This makes the writer cheap enough to be left enabled
+ * for production runs. Each process appends to its own file named
+ * 'convergence-$RANK.bin' in the working directory; the file is flushed after each
+ * iteration, so the data of aborted runs is not lost. The 'convergence2vtk.py' script
+ * converts these files to VTK point clouds.
+ *
+ * All values are stored in the native byte order. The file starts with the 8 byte
+ * magic 'EWCONV1', followed by the number of grid DOFs, the number of equations and
+ * the compression algorithm (0: none, 1: zlib, 2: lz4) as 32 bit unsigned integers.
+ * Then the names of the primary variables and of the equations follow, each as a 32
+ * bit length and the characters. The header is completed by a block of the DOF
+ * positions (three coordinates per DOF). Each iteration appends the index of the time
+ * step and of the iteration as 32 bit signed integers, the time and the time step size
+ * as 64 bit floating point values and a block of the residual and of the update,
+ * ordered by DOF and then by equation. A block consists of its uncompressed and its
+ * stored size as 64 bit unsigned integers followed by the stored bytes.
+ */
+template <class TypeTag>
+class FvBaseBinaryConvergenceWriter
+{
+    typedef typename GET_PROP_TYPE(TypeTag, GridView) GridView;
+    typedef typename GET_PROP_TYPE(TypeTag, ElementContext) ElementContext;
+    typedef typename GET_PROP_TYPE(TypeTag, NewtonMethod) NewtonMethod;
+    typedef typename GET_PROP_TYPE(TypeTag, SolutionVector) SolutionVector;
+    typedef typename GET_PROP_TYPE(TypeTag, GlobalEqVector) GlobalEqVector;
+
+    typedef typename GridView::template Codim<0>::Iterator ElementIterator;
+
+    enum { numEq = GET_PROP_VALUE(TypeTag, NumEq) };
+    enum { dimWorld = GridView::dimensionworld };
+
+    enum Compression_ {
+        NoCompression_ = 0,
+        ZlibCompression_ = 1,
+        Lz4Compression_ = 2
+    };
+
+public:
+    FvBaseBinaryConvergenceWriter(NewtonMethod& nm)
+        : newtonMethod_(nm)
+    {
+        compression_ = NoCompression_;
+        headerWritten_ = false;
+    }
+
+    /*!
+     * \brief Register all run-time parameters of the binary convergence writer.
+     */
+    static void registerParameters()
+    {
+        EWOMS_REGISTER_PARAM(TypeTag, std::string, NewtonConvergenceCompression,
+                             "The algorithm used to compress the binary convergence "
+                             "log of the Newton method. Possible values are 'none', "
+                             "'zlib' and 'lz4'");
+    }
+
+    /*!
+     * \brief Called by the Newton method before the actual algorithm
+     *        is started for any given timestep.
+     */
+    void beginTimeStep()
+    {}
+
+    /*!
+     * \brief Called by the Newton method before an iteration of the
+     *        Newton algorithm is started.
+     */
+    void beginIteration()
+    {
+        if (!headerWritten_)
+            writeHeader_();
+    }
+
+    /*!
+     * \brief Append the residual and the Newton update to the file.
+     *
+     * Called after the linear solution is found for an iteration.
+     *
+     * \param uLastIter The solution vector of the previous iteration.
+     * \param deltaU The negative difference between the solution
+     *        vectors of the previous and the current iteration.
+     */
+    void writeFields(const SolutionVector& uLastIter OPM_UNUSED,
+                     const GlobalEqVector& deltaU)
+    {
+        const auto& simulator = newtonMethod_.problem().simulator();
+        const auto& model = newtonMethod_.model();
+        const GlobalEqVector& residual = model.linearizer().residual();
+        size_t numGridDof = model.numGridDof();
+
+        int32_t timeStepIdx = simulator.timeStepIndex();
+        int32_t iterationIdx = newtonMethod_.numIterations();
+        double time = simulator.time();
+        double timeStepSize = simulator.timeStepSize();
+        std::vector<char> buf;
+        append_(buf, timeStepIdx);
+        append_(buf, iterationIdx);
+        append_(buf, time);
+        append_(buf, timeStepSize);
+
+        values_.resize(numGridDof*numEq);
+        for (unsigned dofIdx = 0; dofIdx < numGridDof; ++dofIdx)
+            for (unsigned eqIdx = 0; eqIdx < numEq; ++eqIdx)
+                values_[dofIdx*numEq + eqIdx] = static_cast<float>(residual[dofIdx][eqIdx]);
+        appendBlock_(buf, values_);
+
+        for (unsigned dofIdx = 0; dofIdx < numGridDof; ++dofIdx)
+            for (unsigned eqIdx = 0; eqIdx < numEq; ++eqIdx)
+                values_[dofIdx*numEq + eqIdx] = static_cast<float>(deltaU[dofIdx][eqIdx]);
+        appendBlock_(buf, values_);
+
+        outStream_.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+    }
+
+    /*!
+     * \brief Called by the Newton method after an iteration of the
+     *        Newton algorithm has been completed.
+     */
+    void endIteration()
+    { outStream_.flush(); }
+
+    /*!
+     * \brief Called by the Newton method after Newton algorithm
+     *        has been completed for any given timestep.
+     *
+     * This method is called regardless of whether the Newton method
+     * converged or not.
+     */
+    void endTimeStep()
+    {}
+
+private:
+    void writeHeader_()
+    {
+        const std::string& compressionName =
+            EWOMS_GET_PARAM(TypeTag, std::string, NewtonConvergenceCompression);
+        if (compressionName == "none")
+            compression_ = NoCompression_;
+        else if (compressionName == "zlib")
+            compression_ = ZlibCompression_;
+        else if (compressionName == "lz4")
+            compression_ = Lz4Compression_;
+        else
+            OPM_THROW(std::invalid_argument,
+                      "Unknown compression algorithm '" << compressionName << "' for the "
+                      "convergence log (supported are 'none', 'zlib' and 'lz4')");
+#if !HAVE_ZLIB
+        if (compression_ == ZlibCompression_)
+            OPM_THROW(std::runtime_error,
+                      "A zlib compressed convergence log requires eWoms to be built with zlib");
+#endif
+#if !HAVE_LZ4
+        if (compression_ == Lz4Compression_)
+            OPM_THROW(std::runtime_error,
+                      "An LZ4 compressed convergence log requires eWoms to be built with LZ4");
+#endif
+
+        const auto& simulator = newtonMethod_.problem().simulator();
+        const auto& model = newtonMethod_.model();
+        const auto& gridView = simulator.gridView();
+
+        std::ostringstream fileName;
+        fileName << "convergence-" << gridView.comm().rank() << ".bin";
+        outStream_.open(fileName.str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!outStream_)
+            OPM_THROW(std::runtime_error,
+                      "Could not open the convergence log '" << fileName.str() << "'");
+
+        size_t numGridDof = model.numGridDof();
+        std::vector<char> buf;
+        const char magic[8] = { 'E', 'W', 'C', 'O', 'N', 'V', '1', '\0' };
+        buf.insert(buf.end(), magic, magic + sizeof(magic));
+        append_(buf, static_cast<uint32_t>(numGridDof));
+        append_(buf, static_cast<uint32_t>(numEq));
+        append_(buf, static_cast<uint32_t>(compression_));
+        for (unsigned pvIdx = 0; pvIdx < numEq; ++pvIdx)
+            appendString_(buf, model.primaryVarName(pvIdx));
+        for (unsigned eqIdx = 0; eqIdx < numEq; ++eqIdx)
+            appendString_(buf, model.eqName(eqIdx));
+
+        // the positions of the DOFs. for the vertex centered discretization, the DOFs
+        // are shared by multiple elements, so their positions are simply set several
+        // times.
+        values_.assign(3*numGridDof, 0.0f);
+        ElementContext elemCtx(simulator);
+        ElementIterator elemIt = gridView.template begin</*codim=*/0>();
+        const ElementIterator& elemEndIt = gridView.template end</*codim=*/0>();
+        for (; elemIt != elemEndIt; ++elemIt) {
+            elemCtx.updateStencil(*elemIt);
+            for (unsigned dofIdx = 0; dofIdx < elemCtx.numPrimaryDof(/*timeIdx=*/0); ++dofIdx) {
+                unsigned globalIdx = elemCtx.globalSpaceIndex(dofIdx, /*timeIdx=*/0);
+                const auto& pos = elemCtx.pos(dofIdx, /*timeIdx=*/0);
+                for (unsigned i = 0; i < dimWorld && i < 3; ++i)
+                    values_[3*globalIdx + i] = static_cast<float>(pos[i]);
+            }
+        }
+        appendBlock_(buf, values_);
+
+        outStream_.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+        headerWritten_ = true;
+    }
+
+    template <class T>
+    static void append_(std::vector<char>& buf, const T& value)
+    {
+        const char* bytes = reinterpret_cast<const char*>(&value);
+        buf.insert(buf.end(), bytes, bytes + sizeof(value));
+    }
+
+    static void appendString_(std::vector<char>& buf, const std::string& value)
+    {
+        append_(buf, static_cast<uint32_t>(value.size()));
+        buf.insert(buf.end(), value.begin(), value.end());
+    }
+
+    // append the uncompressed and the stored size of an array followed by the stored
+    // data
+    void appendBlock_(std::vector<char>& buf, const std::vector<float>& values) const
+    {
+        const char* data = reinterpret_cast<const char*>(values.data());
+        uint64_t numBytes = values.size()*sizeof(float);
+        append_(buf, numBytes);
+        size_t sizeOffset = buf.size();
+        append_(buf, numBytes);
+
+        if (compression_ == NoCompression_) {
+            buf.insert(buf.end(), data, data + numBytes);
+            return;
+        }
+
+        size_t offset = buf.size();
+        uint64_t storedSize = 0;
+#if HAVE_ZLIB
+        if (compression_ == ZlibCompression_) {
+            uLongf compressedSize = compressBound(static_cast<uLong>(numBytes));
+            buf.resize(offset + compressedSize);
+            int ret = compress2(reinterpret_cast<Bytef*>(&buf[offset]),
+                                &compressedSize,
+                                reinterpret_cast<const Bytef*>(data),
+                                static_cast<uLong>(numBytes),
+                                Z_BEST_SPEED);
+            if (ret != Z_OK)
+                OPM_THROW(std::runtime_error,
+                          "Compressing the convergence log using zlib failed (error code "
+                          << ret << ")");
+            storedSize = compressedSize;
+        }
+#endif
+#if HAVE_LZ4
+        if (compression_ == Lz4Compression_) {
+            int maxSize = LZ4_compressBound(static_cast<int>(numBytes));
+            buf.resize(offset + static_cast<size_t>(maxSize));
+            int compressedSize = LZ4_compress_default(data,
+                                                      &buf[offset],
+                                                      static_cast<int>(numBytes),
+                                                      maxSize);
+            if (compressedSize <= 0)
+                OPM_THROW(std::runtime_error,
+                          "Compressing the convergence log using LZ4 failed");
+            storedSize = static_cast<uint64_t>(compressedSize);
+        }
+#endif
+
+        buf.resize(offset + storedSize);
+        std::copy(reinterpret_cast<const char*>(&storedSize),
+                  reinterpret_cast<const char*>(&storedSize) + sizeof(storedSize),
+                  buf.begin() + static_cast<std::ptrdiff_t>(sizeOffset));
+    }
+
+    NewtonMethod& newtonMethod_;
+
+    Compression_ compression_;
+    bool headerWritten_;
+    std::ofstream outStream_;
+    std::vector<float> values_;
+};
+
+} // namespace Ewoms
+
+#endif
@@ -45,15 +45,19 @@
 #include "fvbaseprimaryvariables.hh"
 #include "fvbaseintensivequantities.hh"
 #include "fvbaseextensivequantities.hh"
+#include "restrictprolong.hh"
 
 #include <ewoms/parallel/gridcommhandles.hh>
 #include <ewoms/parallel/threadmanager.hh>
+#include <ewoms/parallel/threadlocalobjects.hh>
 #include <ewoms/linear/nullborderlistmanager.hh>
 #include <ewoms/common/simulator.hh>
 #include <ewoms/aux/baseauxiliarymodule.hh>
-#include <ewoms/common/alignedallocator.hh>
+#include <ewoms/common/hugepageallocator.hh>
+#include <ewoms/common/memoryaccounting.hh>
 #include <ewoms/common/timer.hh>
 #include <ewoms/common/timerguard.hh>
+#include <ewoms/common/profiler.hh>
 
 #include <opm/material/common/MathToolbox.hpp>
 #include <opm/common/Valgrind.hpp>
@@ -61,6 +65,7 @@
 #include <opm/common/ErrorMacros.hpp>
 #include <opm/common/Exceptions.hpp>
 
+#include <dune/common/version.hh>
 #include <dune/common/fvector.hh>
 #include <dune/common/fmatrix.hh>
 #include <dune/istl/bvector.hh>
@@ -70,8 +75,11 @@
 #include <dune/fem/space/common/restrictprolongtuple.hh>
 #include <dune/fem/function/blockvectorfunction.hh>
 #include <dune/fem/misc/capabilities.hh>
+#include <dune/grid/utility/persistentcontainer.hh>
 #endif
 
+#include <algorithm>
+#include <exception>
 #include <limits>
 #include <list>
 #include <sstream>
@@ -113,13 +121,16 @@ SET_TYPE_PROP(FvBaseDiscretization, DiscExtensiveQuantities, Ewoms::FvBaseExtens
 //! Calculates the gradient of any quantity given the index of a flux approximation point
 SET_TYPE_PROP(FvBaseDiscretization, GradientCalculator, Ewoms::FvBaseGradientCalculator<TypeTag>);
 
+//! Store the global Jacobian matrix with the same precision as the solution by default
+SET_TYPE_PROP(FvBaseDiscretization, JacobianScalar, typename GET_PROP_TYPE(TypeTag, Scalar));
+
 //! Set the type of a global jacobian matrix from the solution types
 SET_PROP(FvBaseDiscretization, JacobianMatrix)
 {
 private:
-    typedef typename GET_PROP_TYPE(TypeTag, Scalar) Scalar;
+    typedef typename GET_PROP_TYPE(TypeTag, JacobianScalar) JacobianScalar;
     enum { numEq = GET_PROP_VALUE(TypeTag, NumEq) };
-    typedef typename Dune::FieldMatrix<Scalar, numEq, numEq> MatrixBlock;
+    typedef typename Dune::FieldMatrix<JacobianScalar, numEq, numEq> MatrixBlock;
 public:
     typedef typename Dune::BCRSMatrix<MatrixBlock> type;
 };
@@ -196,7 +207,12 @@ SET_TYPE_PROP(FvBaseDiscretization, ConstraintsContext, Ewoms::FvBaseConstraints
  */
 SET_TYPE_PROP(FvBaseDiscretization, ThreadManager, Ewoms::ThreadManager<TypeTag>);
 SET_INT_PROP(FvBaseDiscretization, ThreadsPerProcess, 1);
+SET_STRING_PROP(FvBaseDiscretization, ThreadBinding, "none");
 SET_BOOL_PROP(FvBaseDiscretization, UseLinearizationLock, true);
+SET_BOOL_PROP(FvBaseDiscretization, UseLinearizationColoring, false);
+SET_SCALAR_PROP(FvBaseDiscretization, ActiveSetLinearizationTolerance, 0.0);
+SET_BOOL_PROP(FvBaseDiscretization, PrecomputeIntensiveQuantities, false);
+SET_BOOL_PROP(FvBaseDiscretization, OverlapAuxiliaryLinearization, false);
 
 /*!
  * \brief Linearizer for the global system of equations.
@@ -213,21 +229,51 @@ SET_SCALAR_PROP(FvBaseDiscretization, MaxTimeStepSize, 1e100);
 //! By default, accept any time step larger than zero
 SET_SCALAR_PROP(FvBaseDiscretization, MinTimeStepSize, 0.0);
 
+//! Select the time step size only based on the Newton iterations by default
+SET_SCALAR_PROP(FvBaseDiscretization, TimeStepControlTargetChange, 0.0);
+
 //! Disable grid adaptation by default
 SET_BOOL_PROP(FvBaseDiscretization, EnableGridAdaptation, false);
 
 //! Enable the VTK output by default
 SET_BOOL_PROP(FvBaseDiscretization, EnableVtkOutput, true);
 
+//! Keep the buffers of the output modules between writes by default
+SET_BOOL_PROP(FvBaseDiscretization, FreeOutputBuffers, false);
+
 //! Set the format of the VTK output to ASCII by default
 SET_INT_PROP(FvBaseDiscretization, VtkOutputFormat, Dune::VTK::ascii);
 
-// disable caching the storage term by default
-SET_BOOL_PROP(FvBaseDiscretization, EnableStorageCache, false);
+//! Do not compress the VTK output by default
+SET_STRING_PROP(FvBaseDiscretization, VtkCompression, "none");
+
+//! Write the VTK output synchronously by default
+SET_BOOL_PROP(FvBaseDiscretization, EnableAsyncVtkOutput, false);
+
+//! Use two output buffers if the VTK output is written asynchronously
+SET_INT_PROP(FvBaseDiscretization, MaxPendingVtkWrites, 2);
+
+//! Do not write HDF5 output by default
+SET_BOOL_PROP(FvBaseDiscretization, EnableHdfOutput, false);
+
+//! Use the fastest compression level of the HDF5 output by default
+SET_INT_PROP(FvBaseDiscretization, HdfCompressionLevel, 1);
+
+// cache the storage term of the previous time steps by default. this is not possible if
+// the derivatives of the storage term w.r.t. the previous solution are required, i.e., if
+// the adjoint linearization is enabled.
+SET_BOOL_PROP(FvBaseDiscretization, EnableStorageCache,
+              !GET_PROP_VALUE(TypeTag, EnableAdjointLinearization));
+
+// restart files only contain the solution by default
+SET_BOOL_PROP(FvBaseDiscretization, RestartWithCaches, false);
 
 // disable constraints by default
 SET_BOOL_PROP(FvBaseDiscretization, EnableConstraints, false);
 
+// use the solution of the last time step as the initial guess by default
+SET_INT_PROP(FvBaseDiscretization, SolutionPredictorOrder, 0);
+
 // by default, disable the intensive quantity cache. If the intensive quantities are
 // relatively cheap to calculate, the cache basically does not yield any performance
 // impact because of the intensive quantity cache will cause additional pressure on the
@@ -238,6 +284,15 @@ SET_BOOL_PROP(FvBaseDiscretization, EnableIntensiveQuantityCache, false);
 // enable the intensive quantity cache above to avoid getting an exception...
 SET_BOOL_PROP(FvBaseDiscretization, EnableThermodynamicHints, false);
 
+// keep eight snapshots of the solution in memory for the backward sweep of the adjoint
+// driver by default
+SET_INT_PROP(FvBaseDiscretization, AdjointNumCheckpoints, 8);
+
+// recompute the time steps of the forward sweep instead of storing the Jacobians on
+// disk. If they are stored, single precision is accurate enough for the adjoint solve.
+SET_STRING_PROP(FvBaseDiscretization, AdjointJacobianStoreDirectory, "");
+SET_BOOL_PROP(FvBaseDiscretization, AdjointJacobianStoreSinglePrecision, true);
+
 // if the deflection of the newton method is large, we do not need to solve the linear
 // approximation accurately. Assuming that the value for the current solution is quite
 // close to the final value, a reduction of 3 orders of magnitude in the defect should be
@@ -247,6 +302,12 @@ SET_SCALAR_PROP(FvBaseDiscretization, LinearSolverTolerance, 1e-3);
 //! Set the history size of the time discretization to 2 (for implicit euler)
 SET_INT_PROP(FvBaseDiscretization, TimeDiscHistorySize, 2);
 
+//! Use the implicit Euler time discretization by default
+SET_STRING_PROP(FvBaseDiscretization, TimeDiscretization, "implicit-euler");
+
+//! Do not control the time step size by the error estimate of BDF2 by default
+SET_SCALAR_PROP(FvBaseDiscretization, TimeDiscTolerance, 0.0);
+
 //! Most models don't need the gradients at the center of the SCVs, so
 //! we disable them by default.
 SET_BOOL_PROP(FvBaseDiscretization, RequireScvCenterGradients, false);
@@ -296,14 +357,15 @@ class FvBaseDiscretization
         historySize = GET_PROP_VALUE(TypeTag, TimeDiscHistorySize),
     };
 
-    typedef std::vector<IntensiveQuantities, Ewoms::aligned_allocator<IntensiveQuantities, alignof(IntensiveQuantities)> > IntensiveQuantitiesVector;
+    typedef std::vector<IntensiveQuantities, Ewoms::HugePageAllocator<IntensiveQuantities> > IntensiveQuantitiesVector;
+    typedef std::vector<EqVector, Ewoms::HugePageAllocator<EqVector> > StorageCacheVector;
 
     typedef typename GridView::template Codim<0>::Entity Element;
     typedef typename GridView::template Codim<0>::Iterator ElementIterator;
+    typedef typename Element::EntitySeed ElementSeed;
 
     typedef Opm::MathToolbox<Evaluation> Toolbox;
     typedef Dune::FieldVector<Evaluation, numEq> VectorBlock;
-    typedef Dune::FieldVector<Evaluation, numEq> EvalEqVector;
 
     typedef typename LocalResidual::LocalEvalBlockVector LocalEvalBlockVector;
 
@@ -334,7 +396,15 @@ class FvBaseDiscretization
 
     // discrete function restriction and prolongation operator for adaptation
     typedef Dune::Fem::RestrictProlongDefault< DiscreteFunction > DiscreteFunctionRestrictProlong;
-    typedef Dune::Fem::RestrictProlongTuple< DiscreteFunctionRestrictProlong,  ProblemRestrictProlongOperator > RestrictProlong;
+
+    // for each element, the index of its up-to-date cached intensive quantities before
+    // the adaptation. elements which are affected by the adaptation are marked by -1.
+    typedef Dune::PersistentContainer< Grid, int > IntensiveQuantitiesTransferContainer;
+    typedef Ewoms::InvalidatingRestrictProlong< Grid, IntensiveQuantitiesTransferContainer > IntensiveQuantitiesRestrictProlong;
+
+    typedef Dune::Fem::RestrictProlongTuple< DiscreteFunctionRestrictProlong,
+                                             ProblemRestrictProlongOperator,
+                                             IntensiveQuantitiesRestrictProlong > RestrictProlong;
     // adaptation classes
     typedef Dune::Fem::AdaptationManager<Grid, RestrictProlong  > AdaptationManager;
 #else
@@ -355,7 +425,6 @@ public:
         , elementMapper_(gridView_)
         , vertexMapper_(gridView_)
         , newtonMethod_(simulator)
-        , localLinearizer_(ThreadManager::maxThreads())
         , linearizer_(new Linearizer())
 #if HAVE_DUNE_FEM
         , space_( simulator.gridManager().gridPart() )
@@ -363,7 +432,12 @@ public:
         , space_( asImp_().numGridDof() )
 #endif
         , enableGridAdaptation_( EWOMS_GET_PARAM(TypeTag, bool, EnableGridAdaptation) )
+        , solutionMemory_("Solution vectors")
+        , intensiveQuantitiesMemory_("Intensive quantity cache")
+        , storageCacheMemory_("Storage cache")
     {
+        intensiveQuantityCacheOffset_ = 0;
+
 #if HAVE_DUNE_FEM
         if( enableGridAdaptation_ && ! Dune::Fem::Capabilities::isLocallyAdaptive< Grid >::v )
         {
@@ -382,7 +456,43 @@ public:
 
 
         enableStorageCache_ = EWOMS_GET_PARAM(TypeTag, bool, EnableStorageCache);
-        //enableStorageCache_ = false;
+        storageCacheIsUpToDate_ = false;
+        restartWithCaches_ = EWOMS_GET_PARAM(TypeTag, bool, RestartWithCaches);
+
+        predictorOrder_ = EWOMS_GET_PARAM(TypeTag, unsigned, SolutionPredictorOrder);
+        if (predictorOrder_ > 2)
+            OPM_THROW(std::runtime_error,
+                      "Only the solution predictors of order 0, 1 and 2 are available "
+                      "(is: " << predictorOrder_ << ")");
+
+        const std::string& timeDisc = EWOMS_GET_PARAM(TypeTag, std::string, TimeDiscretization);
+        if (timeDisc == "bdf2")
+            useBdf2_ = true;
+        else if (timeDisc == "implicit-euler")
+            useBdf2_ = false;
+        else
+            OPM_THROW(std::runtime_error,
+                      "Unknown time discretization '" << timeDisc << "' "
+                      "(supported are 'implicit-euler' and 'bdf2')");
+        if (useBdf2_ && historySize < 3)
+            OPM_THROW(std::runtime_error,
+                      "The BDF2 time discretization requires a TimeDiscHistorySize of at "
+                      "least 3 (is: " << historySize << ")");
+        if (useBdf2_ && GET_PROP_VALUE(TypeTag, EnableAdjointLinearization))
+            OPM_THROW(Opm::NotImplemented,
+                      "The adjoint linearization is only available for the implicit Euler "
+                      "time discretization");
+        numValidTimeLevels_ = 1;
+        prevTimeStepSizes_[0] = 0.0;
+        prevTimeStepSizes_[1] = 0.0;
+        timeDiscDivDiffValid_ = false;
+        timeDiscError_ = -1.0;
+
+        outputPartitionWithNeighbors_ = false;
+        outputPartitionIsValid_ = false;
+
+        // each thread constructs its own local linearizer
+        localLinearizer_.create(ThreadManager::maxThreads());
 
         size_t numDof = asImp_().numGridDof();
         for (unsigned timeIdx = 0; timeIdx < historySize; ++timeIdx) {
@@ -390,7 +500,7 @@ public:
 
             if (storeIntensiveQuantities()) {
                 intensiveQuantityCache_[timeIdx].resize(numDof);
-                intensiveQuantityCacheUpToDate_[timeIdx].resize(numDof, /*value=*/false);
+                intensiveQuantityCacheUpToDate_[timeIdx].resize(numDof, /*value=*/0);
             }
 
             if (enableStorageCache_)
@@ -398,7 +508,12 @@ public:
         }
 
         resizeAndResetIntensiveQuantitiesCache_();
-        asImp_().registerOutputModules_();
+
+        // the output modules of the model only produce VTK and HDF5 output, so they
+        // are not needed at all if both are disabled
+        if (EWOMS_GET_PARAM(TypeTag, bool, EnableVtkOutput)
+            || EWOMS_GET_PARAM(TypeTag, bool, EnableHdfOutput))
+            asImp_().registerOutputModules_();
     }
 
     ~FvBaseDiscretization()
@@ -430,9 +545,18 @@ public:
 
         EWOMS_REGISTER_PARAM(TypeTag, bool, EnableGridAdaptation, "Enable adaptive grid refinement/coarsening");
         EWOMS_REGISTER_PARAM(TypeTag, bool, EnableVtkOutput, "Global switch for turing on writing VTK files");
+        EWOMS_REGISTER_PARAM(TypeTag, bool, FreeOutputBuffers, "Release the memory of the output buffers after the results of a time step have been written");
+        EWOMS_REGISTER_PARAM(TypeTag, std::string, VtkCompression, "The algorithm used to compress the raw binary VTK output. Possible values are 'none', 'zlib' and 'lz4'");
+        EWOMS_REGISTER_PARAM(TypeTag, bool, EnableAsyncVtkOutput, "Encode and write the VTK files on a background thread");
+        EWOMS_REGISTER_PARAM(TypeTag, int, MaxPendingVtkWrites, "The maximum number of VTK files which may wait to be written asynchronously");
+        EWOMS_REGISTER_PARAM(TypeTag, bool, EnableHdfOutput, "Write the output into a single HDF5 file which is indexed by an XDMF file");
+        EWOMS_REGISTER_PARAM(TypeTag, int, HdfCompressionLevel, "The level of the deflate compression of the HDF5 output (0: none, 9: best)");
         EWOMS_REGISTER_PARAM(TypeTag, bool, EnableThermodynamicHints, "Enable thermodynamic hints");
         EWOMS_REGISTER_PARAM(TypeTag, bool, EnableIntensiveQuantityCache, "Turn on caching of intensive quantities");
         EWOMS_REGISTER_PARAM(TypeTag, bool, EnableStorageCache, "Store previous storage terms and avoid re-calculating them.");
+        EWOMS_REGISTER_PARAM(TypeTag, bool, RestartWithCaches, "Write the cached storage terms and the thermodynamic hints to binary restart files");
+        EWOMS_REGISTER_PARAM(TypeTag, unsigned, SolutionPredictorOrder, "The order of the extrapolation of the initial guess from the previous time steps (0: none, 1: linear, 2: quadratic)");
+        EWOMS_REGISTER_PARAM(TypeTag, std::string, TimeDiscretization, "The time discretization. Possible values are 'implicit-euler' and 'bdf2' (variable step second order backward differentiation formula, requires a TimeDiscHistorySize of at least 3)");
     }
 
     /*!
@@ -440,74 +564,29 @@ public:
      */
     void finishInit()
     {
-        // initialize the volume of the finite volumes to zero
-        size_t numDof = asImp_().numGridDof();
-        dofTotalVolume_.resize(numDof);
-        std::fill(dofTotalVolume_.begin(), dofTotalVolume_.end(), 0.0);
-
-        ElementContext elemCtx(simulator_);
-        gridTotalVolume_ = 0.0;
-
-        // iterate through the grid and evaluate the initial condition
-        ElementIterator elemIt = gridView_.template begin</*codim=*/0>();
-        const ElementIterator& elemEndIt = gridView_.template end</*codim=*/0>();
-        for (; elemIt != elemEndIt; ++elemIt) {
-            const Element& elem = *elemIt;
-            const bool isInteriorElement = elem.partitionType() == Dune::InteriorEntity;
-            // ignore everything which is not in the interior if the
-            // current process' piece of the grid
-            if (!isInteriorElement)
-                continue;
-
-            // deal with the current element
-            elemCtx.updateStencil(elem);
-            const auto& stencil = elemCtx.stencil(/*timeIdx=*/0);
-
-            // loop over all element vertices, i.e. sub control volumes
-            for (unsigned dofIdx = 0; dofIdx < elemCtx.numPrimaryDof(/*timeIdx=*/0); dofIdx++) {
-                // map the local degree of freedom index to the global one
-                unsigned globalIdx = elemCtx.globalSpaceIndex(dofIdx, /*timeIdx=*/0);
-
-                Scalar dofVolume = stencil.subControlVolume(dofIdx).volume();
-                dofTotalVolume_[globalIdx] += dofVolume;
-                if (isInteriorElement)
-                    gridTotalVolume_ += dofVolume;
-            }
-        }
-
-        // determine which DOFs should be considered to lie fully in the interior of the
-        // local process grid partition: those which do not have a non-zero volume
-        // before taking the peer processes into account...
-        isLocalDof_.resize(numDof);
-        for (unsigned dofIdx = 0; dofIdx < numDof; ++dofIdx)
-            isLocalDof_[dofIdx] = (dofTotalVolume_[dofIdx] != 0.0);
-
-        // add the volumes of the DOFs on the process boundaries
-        const auto sumHandle =
-            GridCommHandleFactory::template sumHandle<Scalar>(dofTotalVolume_,
-                                                              asImp_().dofMapper());
-        gridView_.communicate(*sumHandle,
-                              Dune::InteriorBorder_All_Interface,
-                              Dune::ForwardCommunication);
-
-        // sum up the volumes of the grid partitions
-        gridTotalVolume_ = gridView_.comm().sum(gridTotalVolume_);
+        updateGridGeometry_();
 
         linearizer_->init(simulator_);
-        for (unsigned threadId = 0; threadId < ThreadManager::maxThreads(); ++threadId)
-            localLinearizer_[threadId].init(simulator_);
 
+        // the local linearizers are allocated and initialized by the threads which use
+        // them. this places their memory on the NUMA node of the respective thread.
+        Simulator& simulator = simulator_;
+        localLinearizer_.applyLocally([&simulator](LocalLinearizer& localLinearizer)
+                                      { localLinearizer.init(simulator); });
+
+        // this also invalidates all cached intensive quantities
         resizeAndResetIntensiveQuantitiesCache_();
-        if (storeIntensiveQuantities()) {
-            // invalidate all cached intensive quantities
-            for (unsigned timeIdx = 0; timeIdx < historySize; ++ timeIdx) {
-                std::fill(intensiveQuantityCacheUpToDate_[timeIdx].begin(),
-                          intensiveQuantityCacheUpToDate_[timeIdx].end(),
-                          false);
-            }
-        }
     }
 
+    /*!
+     * \brief Prepare the stencil of a newly created element context.
+     *
+     * Discretizations can use this to e.g. let the stencils use precomputed
+     * geometry. By default, nothing is done.
+     */
+    void prepareStencil(Stencil& stencil OPM_UNUSED) const
+    { }
+
     /*!
      * \brief Returns whether the grid ought to be adapted to the solution during the simulation.
      */
@@ -524,34 +603,11 @@ public:
         SolutionVector& uCur = asImp_().solution(/*timeIdx=*/0);
         uCur = Scalar(0.0);
 
-        ElementContext elemCtx(simulator_);
-
-        // iterate through the grid and evaluate the initial condition
-        ElementIterator elemIt = gridView_.template begin</*codim=*/0>();
-        const ElementIterator& elemEndIt = gridView_.template end</*codim=*/0>();
-        for (; elemIt != elemEndIt; ++elemIt) {
-            const Element& elem = *elemIt;
-            // ignore everything which is not in the interior if the
-            // current process' piece of the grid
-            if (elem.partitionType() != Dune::InteriorEntity)
-                continue;
-
-            // deal with the current element
-            elemCtx.updateStencil(elem);
-
-            // loop over all element vertices, i.e. sub control volumes
-            for (unsigned dofIdx = 0; dofIdx < elemCtx.numPrimaryDof(/*timeIdx=*/0); dofIdx++)
-            {
-                // map the local degree of freedom index to the global one
-                unsigned globalIdx = elemCtx.globalSpaceIndex(dofIdx, /*timeIdx=*/0);
-
-                // let the problem do the dirty work of nailing down
-                // the initial solution.
-                simulator_.problem().initial(uCur[globalIdx], elemCtx, dofIdx, /*timeIdx=*/0);
-                asImp_().supplementInitialSolution_(uCur[globalIdx], elemCtx, dofIdx, /*timeIdx=*/0);
-                uCur[globalIdx].checkDefined();
-            }
-        }
+        // problems which know the initial condition of all degrees of freedom can fill
+        // the solution at once. else, it is evaluated for the degrees of freedom of each
+        // element.
+        if (!simulator_.problem().initialSolution(uCur))
+            applyInitialSolutionPerDof_(uCur);
 
         // synchronize the ghost DOFs (if necessary)
         asImp_().syncOverlap();
@@ -560,8 +616,13 @@ public:
         // initial solution.
         for (unsigned timeIdx = 1; timeIdx < historySize; ++timeIdx)
             solution(timeIdx) = solution(/*timeIdx=*/0);
+        resetTimeDiscHistory();
 
         simulator_.problem().initialSolutionApplied();
+
+        // the storage terms of the initial solution are calculated by the first
+        // linearization
+        invalidateStorageCache();
     }
 
     /*!
@@ -605,13 +666,16 @@ public:
         if (!enableThermodynamicHints_())
             return 0;
 
-        if (intensiveQuantityCacheUpToDate_[timeIdx][globalIdx])
-            return &intensiveQuantityCache_[timeIdx][globalIdx];
+        unsigned slotIdx = intensiveQuantityCacheSlot_(timeIdx);
+        if (intensiveQuantityCacheUpToDate_[slotIdx][globalIdx])
+            return &intensiveQuantityCache_[slotIdx][globalIdx];
 
         // use the intensive quantities for the first up-to-date time index as hint
-        for (unsigned timeIdx2 = 0; timeIdx2 < historySize; ++timeIdx2)
-            if (intensiveQuantityCacheUpToDate_[timeIdx2][globalIdx])
-                return &intensiveQuantityCache_[timeIdx2][globalIdx];
+        for (unsigned timeIdx2 = 0; timeIdx2 < historySize; ++timeIdx2) {
+            unsigned slot2Idx = intensiveQuantityCacheSlot_(timeIdx2);
+            if (intensiveQuantityCacheUpToDate_[slot2Idx][globalIdx])
+                return &intensiveQuantityCache_[slot2Idx][globalIdx];
+        }
 
         // no suitable up-to-date intensive quantities...
         return 0;
@@ -630,8 +694,9 @@ public:
      */
     const IntensiveQuantities *cachedIntensiveQuantities(unsigned globalIdx, unsigned timeIdx) const
     {
+        unsigned slotIdx = intensiveQuantityCacheSlot_(timeIdx);
         if (!enableIntensiveQuantitiesCache_() ||
-            !intensiveQuantityCacheUpToDate_[timeIdx][globalIdx])
+            !intensiveQuantityCacheUpToDate_[slotIdx][globalIdx])
             return 0;
 
         if (timeIdx > 0 && enableStorageCache_)
@@ -639,7 +704,7 @@ public:
             // recent time step are cached!
             return 0;
 
-        return &intensiveQuantityCache_[timeIdx][globalIdx];
+        return &intensiveQuantityCache_[slotIdx][globalIdx];
     }
 
     /*!
@@ -657,8 +722,9 @@ public:
         if (!storeIntensiveQuantities())
             return;
 
-        intensiveQuantityCache_[timeIdx][globalIdx] = intQuants;
-        intensiveQuantityCacheUpToDate_[timeIdx][globalIdx] = true;
+        unsigned slotIdx = intensiveQuantityCacheSlot_(timeIdx);
+        intensiveQuantityCache_[slotIdx][globalIdx] = intQuants;
+        intensiveQuantityCacheUpToDate_[slotIdx][globalIdx] = 1;
     }
 
     /*!
@@ -675,7 +741,8 @@ public:
         if (!storeIntensiveQuantities())
             return;
 
-        intensiveQuantityCacheUpToDate_[timeIdx][globalIdx] = newValue;
+        unsigned slotIdx = intensiveQuantityCacheSlot_(timeIdx);
+        intensiveQuantityCacheUpToDate_[slotIdx][globalIdx] = newValue ? 1 : 0;
     }
 
     /*!
@@ -686,15 +753,20 @@ public:
     void invalidateIntensiveQuantitiesCache(unsigned timeIdx) const
     {
         if (storeIntensiveQuantities()) {
-            std::fill(intensiveQuantityCacheUpToDate_[timeIdx].begin(),
-                      intensiveQuantityCacheUpToDate_[timeIdx].end(),
-                      /*value=*/false);
+            unsigned slotIdx = intensiveQuantityCacheSlot_(timeIdx);
+            std::fill(intensiveQuantityCacheUpToDate_[slotIdx].begin(),
+                      intensiveQuantityCacheUpToDate_[slotIdx].end(),
+                      /*value=*/0);
         }
     }
 
     /*!
      * \brief Move the intensive quantities for a given time index to the back.
      *
+     * The slots of the cache are used as a ring buffer, i.e., the cached objects are not
+     * copied but only the mapping of the time indices to the slots is rotated. The
+     * slots which become the most recent time indices are invalidated.
+     *
      * This method should only be called by the time discretization.
      *
      * \param numSlots The number of time step slots for which the
@@ -712,18 +784,24 @@ public:
             return;
         }
 
-        assert(numSlots > 0);
+        assert(0 < numSlots && numSlots < historySize);
 
-        for (unsigned timeIdx = 0; timeIdx < historySize - numSlots; ++ timeIdx) {
-            intensiveQuantityCache_[timeIdx + numSlots] = intensiveQuantityCache_[timeIdx];
-            intensiveQuantityCacheUpToDate_[timeIdx + numSlots] = intensiveQuantityCacheUpToDate_[timeIdx];
-        }
+        intensiveQuantityCacheOffset_ =
+            (intensiveQuantityCacheOffset_ + historySize - numSlots) % historySize;
 
-        // the cache for the most recent time indices do not need to be invalidated
-        // because the solution for them did not change (TODO: that assumes that there is
-        // no post-processing of the solution after a time step! fix it?)
+        // the slots of the most recent time indices now contain the data of the oldest
+        // ones. (their solution is the same as the one of the time index 'numSlots', so
+        // the thermodynamic hints can still be taken from there.)
+        for (unsigned timeIdx = 0; timeIdx < numSlots; ++ timeIdx)
+            invalidateIntensiveQuantitiesCache(timeIdx);
     }
 
+    /*!
+     * \brief Returns true iff the caches are written to binary restart files.
+     */
+    bool restartWithCaches() const
+    { return restartWithCaches_; }
+
     /*!
      * \brief Returns true iff the storage term is cached.
      *
@@ -766,6 +844,90 @@ public:
         storageCache_[timeIdx][globalIdx] = value;
     }
 
+    /*!
+     * \brief Mark the cached storage terms of the previous time step as outdated.
+     *
+     * This needs to be called if the solution of the previous time step is modified
+     * externally. The cache is then re-computed by the next linearization.
+     */
+    void invalidateStorageCache() const
+    { storageCacheIsUpToDate_ = false; }
+
+    /*!
+     * \brief Make sure that the cache for the storage terms of the previous time step is
+     *        consistent with the solution of that time step.
+     *
+     * Usually, the cache is filled when the time level is advanced. If this did not
+     * happen, e.g., for the first time step or after a restart, the storage terms are
+     * calculated from the solution of the previous time step.
+     */
+    void prepareStorageCache() const
+    {
+        if (!enableStorageCache_ || storageCacheIsUpToDate_)
+            return;
+
+        recordStorageCache_(/*timeIdx=*/1);
+        if (numValidTimeLevels_ > 1)
+            recordStorageCache_(/*timeIdx=*/2);
+    }
+
+    /*!
+     * \brief Returns the weight of the storage term of a time index in the time
+     *        discretization.
+     *
+     * The storage part of the residual is \f$\sum_k w_k S_k / \Delta t\f$ where
+     * \f$S_k\f$ is the storage term of the solution of time index \f$k\f$. For
+     * implicit Euler, the weights are 1 and -1. For the variable step BDF2 scheme with
+     * \f$\omega = \Delta t_n/\Delta t_{n-1}\f$ they are \f$(1 + 2\omega)/(1 +
+     * \omega)\f$, \f$-(1 + \omega)\f$ and \f$\omega^2/(1 + \omega)\f$. Until
+     * the solutions of two previous time steps are available, i.e., for the first time
+     * step and after the history has been reset, implicit Euler is used.
+     */
+    Scalar timeDiscWeight(unsigned timeIdx) const
+    {
+        if (!useBdf2_ || numValidTimeLevels_ < 2) {
+            if (timeIdx == 0)
+                return 1.0;
+            else if (timeIdx == 1)
+                return -1.0;
+            return 0.0;
+        }
+
+        Scalar omega = simulator_.timeStepSize()/prevTimeStepSizes_[0];
+        if (timeIdx == 0)
+            return (1 + 2*omega)/(1 + omega);
+        else if (timeIdx == 1)
+            return -(1 + omega);
+        else if (timeIdx == 2)
+            return omega*omega/(1 + omega);
+        return 0.0;
+    }
+
+    /*!
+     * \brief Forget the solutions of the time steps before the previous one.
+     *
+     * This needs to be called if the solution of the previous time step has been
+     * modified, e.g., after a restart. The next time step is then done using implicit
+     * Euler.
+     */
+    void resetTimeDiscHistory()
+    {
+        numValidTimeLevels_ = 1;
+        timeDiscDivDiffValid_ = false;
+        timeDiscError_ = -1.0;
+    }
+
+    /*!
+     * \brief Returns the estimated local truncation error of the last time step of the
+     *        BDF2 time discretization.
+     *
+     * The error is measured using the weights of the primary variables (cf.
+     * relativeDofError()). If no estimate is available, e.g., for implicit Euler or for
+     * the first time steps, a negative value is returned.
+     */
+    Scalar timeDiscError() const
+    { return timeDiscError_; }
+
     /*!
      * \brief Compute the global residual for an arbitrary solution
      *        vector.
@@ -787,14 +949,42 @@ public:
      * \brief Compute the global residual for the current solution
      *        vector.
      *
+     * If the residual of the current solution has already been evaluated by the last
+     * linearization, it is taken from the linearizer instead of being computed again.
+     *
      * \param dest Stores the result
      */
     Scalar globalResidual(GlobalEqVector& dest) const
     {
+        // the residual of the linearizer also contains the contributions of the
+        // auxiliary modules and the constraints, and the linear solver adds up the
+        // entries of the border degrees of freedom in place. it can thus only be used
+        // for sequential simulations which do not exhibit any of these.
+        const auto& linearizer = asImp_().linearizer();
+        if (linearizer.residualIsCurrent()
+            && gridView_.comm().size() == 1
+            && auxEqModules_.empty()
+            && !GET_PROP_VALUE(TypeTag, EnableConstraints))
+        {
+            dest = linearizer.residual();
+            return std::sqrt(dest.two_norm2());
+        }
+
         dest = 0;
 
+        // since the primary degrees of freedom of an element are exclusively owned by it
+        // for cell centered discretizations (cf. the UseLinearizationLock property),
+        // the residuals only need to be added under a lock for the other schemes. (the
+        // lock property is ignored if the linearization is colored, but the elements
+        // are not colored here.)
         OmpMutex mutex;
-        ThreadedEntityIterator<GridView, /*codim=*/0> threadedElemIt(gridView_);
+        const bool useLock =
+            GET_PROP_VALUE(TypeTag, UseLinearizationLock)
+            || GET_PROP_VALUE(TypeTag, UseLinearizationColoring);
+        const auto& grid = gridView_.grid();
+        int numElems = static_cast<int>(elementSeeds_.size());
+        auto& threadContexts = simulator_.model().linearizer();
+        threadContexts.createElementContexts();
 #ifdef _OPENMP
 #pragma omp parallel
 #endif
@@ -802,28 +992,36 @@ public:
             // Attention: the variables below are thread specific and thus cannot be
             // moved in front of the #pragma!
             unsigned threadId = ThreadManager::threadId();
-            ElementContext elemCtx(simulator_);
-            ElementIterator elemIt = threadedElemIt.beginParallel();
-            LocalEvalBlockVector residual, storageTerm;
+            ElementContext& elemCtx = threadContexts.elementContext(threadId);
+            LocalEvalBlockVector residual;
 
-            for (; !threadedElemIt.isFinished(elemIt); elemIt = threadedElemIt.increment()) {
-                const Element& elem = *elemIt;
+#ifdef _OPENMP
+#pragma omp for schedule(guided)
+#endif
+            for (int elemIdx = 0; elemIdx < numElems; ++elemIdx) {
+#if DUNE_VERSION_NEWER(DUNE_GRID, 2, 4)
+                const Element& elem = grid.entity(elementSeeds_[elemIdx]);
+#else
+                const auto& elemPtr = grid.entity(elementSeeds_[elemIdx]);
+                const Element& elem = *elemPtr;
+#endif
                 if (elem.partitionType() != Dune::InteriorEntity)
                     continue;
 
                 elemCtx.updateAll(elem);
                 residual.resize(elemCtx.numDof(/*timeIdx=*/0));
-                storageTerm.resize(elemCtx.numPrimaryDof(/*timeIdx=*/0));
                 asImp_().localResidual(threadId).eval(residual, elemCtx);
 
                 size_t numPrimaryDof = elemCtx.numPrimaryDof(/*timeIdx=*/0);
-                ScopedLock addLock(mutex);
+                if (useLock)
+                    mutex.lock();
                 for (unsigned dofIdx = 0; dofIdx < numPrimaryDof; ++dofIdx) {
                     unsigned globalI = elemCtx.globalSpaceIndex(dofIdx, /*timeIdx=*/0);
                     for (unsigned eqIdx = 0; eqIdx < numEq; ++ eqIdx)
                         dest[globalI][eqIdx] += Toolbox::value(residual[dofIdx][eqIdx]);
                 }
-                addLock.unlock();
+                if (useLock)
+                    mutex.unlock();
             }
         }
 
@@ -852,10 +1050,13 @@ public:
      */
     void globalStorage(EqVector& storage, unsigned timeIdx = 0) const
     {
-        storage = 0;
+        // each thread adds up the storage of its elements separately
+        std::vector<EqVector> threadStorage(ThreadManager::maxThreads(), EqVector(0.0));
 
-        OmpMutex mutex;
-        ThreadedEntityIterator<GridView, /*codim=*/0> threadedElemIt(gridView());
+        const auto& grid = gridView_.grid();
+        int numElems = static_cast<int>(elementSeeds_.size());
+        auto& threadContexts = simulator_.model().linearizer();
+        threadContexts.createElementContexts();
 #ifdef _OPENMP
 #pragma omp parallel
 #endif
@@ -863,16 +1064,25 @@ public:
             // Attention: the variables below are thread specific and thus cannot be
             // moved in front of the #pragma!
             unsigned threadId = ThreadManager::threadId();
-            ElementContext elemCtx(simulator_);
-            ElementIterator elemIt = threadedElemIt.beginParallel();
+            ElementContext& elemCtx = threadContexts.elementContext(threadId);
             LocalEvalBlockVector elemStorage;
+            EqVector& localStorage = threadStorage[threadId];
 
             // in this method, we need to disable the storage cache because we want to
             // evaluate the storage term for other time indices than the most recent one
+            bool storageCacheWasEnabled = elemCtx.enableStorageCache();
             elemCtx.setEnableStorageCache(false);
 
-            for (; !threadedElemIt.isFinished(elemIt); elemIt = threadedElemIt.increment()) {
-                const Element& elem = *elemIt;
+#ifdef _OPENMP
+#pragma omp for schedule(guided)
+#endif
+            for (int elemIdx = 0; elemIdx < numElems; ++elemIdx) {
+#if DUNE_VERSION_NEWER(DUNE_GRID, 2, 4)
+                const Element& elem = grid.entity(elementSeeds_[elemIdx]);
+#else
+                const auto& elemPtr = grid.entity(elementSeeds_[elemIdx]);
+                const Element& elem = *elemPtr;
+#endif
                 if (elem.partitionType() != Dune::InteriorEntity)
                     continue; // ignore ghost and overlap elements
 
@@ -884,14 +1094,17 @@ public:
 
                 localResidual(threadId).evalStorage(elemStorage, elemCtx, timeIdx);
 
-                ScopedLock addLock(mutex);
                 for (unsigned dofIdx = 0; dofIdx < numPrimaryDof; ++dofIdx)
                     for (unsigned eqIdx = 0; eqIdx < numEq; ++eqIdx)
-                        storage[eqIdx] += Toolbox::value(elemStorage[dofIdx][eqIdx]);
-                addLock.unlock();
+                        localStorage[eqIdx] += Toolbox::value(elemStorage[dofIdx][eqIdx]);
             }
+
+            elemCtx.setEnableStorageCache(storageCacheWasEnabled);
         }
 
+        storage = 0.0;
+        for (const auto& localStorage : threadStorage)
+            storage += localStorage;
         storage = gridView_.comm().sum(storage);
     }
 
@@ -899,16 +1112,15 @@ public:
      * \brief Ensure that the difference between the storage terms of the last and of the
      *        current time step is consistent with the source and boundary terms.
      *
-     * This method is purely intented for debugging purposes. If the program is compiled
-     * with optimizations enabled, it becomes a no-op.
+     * The storage terms of both time levels, the source terms and the boundary terms are
+     * evaluated by a single parallel pass over the elements which uses the element
+     * contexts of the linearizer. If the program is compiled with assertations enabled,
+     * it aborts if the rates are inconsistent.
+     *
+     * \return true iff the rates are consistent
      */
-    void checkConservativeness(Scalar OPM_OPTIM_UNUSED tolerance = -1, bool OPM_OPTIM_UNUSED verbose=false) const
+    bool checkConservativeness(Scalar tolerance = -1, bool verbose = false) const
     {
-#ifndef NDEBUG
-        Scalar totalBoundaryArea(0.0);
-        Scalar totalVolume(0.0);
-        EvalEqVector totalRate(0.0);
-
         // take the newton tolerance times the total volume of the grid if we're not
         // given an explicit tolerance...
         if (tolerance <= 0) {
@@ -919,100 +1131,173 @@ public:
         }
 
         // we assume the implicit Euler time discretization for now...
-        assert(historySize == 2);
+        assert(timeDiscWeight(/*timeIdx=*/2) == 0.0);
 
-        EqVector storageBeginTimeStep(0.0);
-        globalStorage(storageBeginTimeStep, /*timeIdx=*/1);
-
-        EqVector storageEndTimeStep(0.0);
-        globalStorage(storageEndTimeStep, /*timeIdx=*/0);
+        // the partial sums of each thread
+        struct ThreadSums
+        {
+            ThreadSums()
+                : storageBeginTimeStep(0.0)
+                , storageEndTimeStep(0.0)
+                , totalRate(0.0)
+                , totalBoundaryArea(0.0)
+                , totalVolume(0.0)
+            { }
+
+            EqVector storageBeginTimeStep;
+            EqVector storageEndTimeStep;
+            EqVector totalRate;
+            Scalar totalBoundaryArea;
+            Scalar totalVolume;
+        };
+        std::vector<ThreadSums> threadSums(ThreadManager::maxThreads());
+
+        const auto& grid = gridView_.grid();
+        int numElems = static_cast<int>(elementSeeds_.size());
+        auto& threadContexts = simulator_.model().linearizer();
+        threadContexts.createElementContexts();
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+        {
+            // Attention: the variables below are thread specific and thus cannot be
+            // moved in front of the #pragma!
+            unsigned threadId = ThreadManager::threadId();
+            ElementContext& elemCtx = threadContexts.elementContext(threadId);
+            LocalEvalBlockVector elemStorage;
+            ThreadSums& sums = threadSums[threadId];
 
-        // calculate the rate at the boundary and the source rate
-        ElementContext elemCtx(simulator_);
-        elemCtx.setEnableStorageCache(false);
-        auto eIt = simulator_.gridView().template begin</*codim=*/0>();
-        const auto& elemEndIt = simulator_.gridView().template end</*codim=*/0>();
-        for (; eIt != elemEndIt; ++eIt) {
-            if (eIt->partitionType() != Dune::InteriorEntity)
-                continue; // ignore ghost and overlap elements
-
-            elemCtx.updateAll(*eIt);
-
-            // handle the boundary terms
-            if (elemCtx.onBoundary()) {
-                BoundaryContext boundaryCtx(elemCtx);
-
-                for (unsigned faceIdx = 0; faceIdx < boundaryCtx.numBoundaryFaces(/*timeIdx=*/0); ++faceIdx) {
-                    BoundaryRateVector values;
-                    simulator_.problem().boundary(values,
-                                                         boundaryCtx,
-                                                         faceIdx,
-                                                         /*timeIdx=*/0);
-                    Opm::Valgrind::CheckDefined(values);
+            // the storage term of the beginning of the time step is required as well
+            bool storageCacheWasEnabled = elemCtx.enableStorageCache();
+            elemCtx.setEnableStorageCache(false);
 
-                    unsigned dofIdx = boundaryCtx.interiorScvIndex(faceIdx, /*timeIdx=*/0);
-                    const auto& insideIntQuants = elemCtx.intensiveQuantities(dofIdx, /*timeIdx=*/0);
+#ifdef _OPENMP
+#pragma omp for schedule(guided)
+#endif
+            for (int elemIdx = 0; elemIdx < numElems; ++elemIdx) {
+#if DUNE_VERSION_NEWER(DUNE_GRID, 2, 4)
+                const Element& elem = grid.entity(elementSeeds_[elemIdx]);
+#else
+                const auto& elemPtr = grid.entity(elementSeeds_[elemIdx]);
+                const Element& elem = *elemPtr;
+#endif
+                if (elem.partitionType() != Dune::InteriorEntity)
+                    continue; // ignore ghost and overlap elements
 
-                    Scalar bfArea =
-                        boundaryCtx.boundarySegmentArea(faceIdx, /*timeIdx=*/0)
-                        * insideIntQuants.extrusionFactor();
+                // the fluxes are only required to evaluate the boundary conditions
+                elemCtx.updateStencil(elem);
+                elemCtx.updatePrimaryIntensiveQuantities(/*timeIdx=*/1);
+                if (elemCtx.onBoundary()) {
+                    elemCtx.updateIntensiveQuantities(/*timeIdx=*/0);
+                    elemCtx.updateExtensiveQuantities(/*timeIdx=*/0);
+                }
+                else
+                    elemCtx.updatePrimaryIntensiveQuantities(/*timeIdx=*/0);
 
-                    for (unsigned i = 0; i < values.size(); ++i)
-                        values[i] *= bfArea;
+                size_t numPrimaryDof = elemCtx.numPrimaryDof(/*timeIdx=*/0);
+                elemStorage.resize(numPrimaryDof);
+                localResidual(threadId).evalStorage(elemStorage, elemCtx, /*timeIdx=*/1);
+                for (unsigned dofIdx = 0; dofIdx < numPrimaryDof; ++dofIdx)
+                    for (unsigned eqIdx = 0; eqIdx < numEq; ++eqIdx)
+                        sums.storageBeginTimeStep[eqIdx] +=
+                            Toolbox::value(elemStorage[dofIdx][eqIdx]);
 
-                    totalBoundaryArea += bfArea;
+                localResidual(threadId).evalStorage(elemStorage, elemCtx, /*timeIdx=*/0);
+                for (unsigned dofIdx = 0; dofIdx < numPrimaryDof; ++dofIdx)
                     for (unsigned eqIdx = 0; eqIdx < numEq; ++eqIdx)
-                        totalRate[eqIdx] += values[eqIdx];
+                        sums.storageEndTimeStep[eqIdx] +=
+                            Toolbox::value(elemStorage[dofIdx][eqIdx]);
+
+                // handle the boundary terms
+                if (elemCtx.onBoundary()) {
+                    BoundaryContext boundaryCtx(elemCtx);
+
+                    for (unsigned faceIdx = 0; faceIdx < boundaryCtx.numBoundaryFaces(/*timeIdx=*/0); ++faceIdx) {
+                        BoundaryRateVector values;
+                        simulator_.problem().boundary(values,
+                                                      boundaryCtx,
+                                                      faceIdx,
+                                                      /*timeIdx=*/0);
+                        Opm::Valgrind::CheckDefined(values);
+
+                        unsigned dofIdx = boundaryCtx.interiorScvIndex(faceIdx, /*timeIdx=*/0);
+                        const auto& insideIntQuants = elemCtx.intensiveQuantities(dofIdx, /*timeIdx=*/0);
+
+                        Scalar bfArea =
+                            boundaryCtx.boundarySegmentArea(faceIdx, /*timeIdx=*/0)
+                            * insideIntQuants.extrusionFactor();
+
+                        sums.totalBoundaryArea += bfArea;
+                        for (unsigned eqIdx = 0; eqIdx < numEq; ++eqIdx)
+                            sums.totalRate[eqIdx] += Toolbox::value(values[eqIdx])*bfArea;
+                    }
                 }
-            }
 
-            // deal with the source terms
-            for (unsigned dofIdx = 0; dofIdx < elemCtx.numPrimaryDof(/*timeIdx=*/0); ++ dofIdx) {
-                RateVector values;
-                simulator_.problem().source(values,
-                                            elemCtx,
-                                            dofIdx,
-                                            /*timeIdx=*/0);
-                Opm::Valgrind::CheckDefined(values);
-
-                const auto& intQuants = elemCtx.intensiveQuantities(dofIdx, /*timeIdx=*/0);
-                Scalar dofVolume =
-                    elemCtx.dofVolume(dofIdx, /*timeIdx=*/0)
-                    * intQuants.extrusionFactor();
-                for (unsigned eqIdx = 0; eqIdx < numEq; ++ eqIdx)
-                    totalRate[eqIdx] += -dofVolume*Toolbox::value(values[eqIdx]);
-                totalVolume += dofVolume;
+                // deal with the source terms
+                for (unsigned dofIdx = 0; dofIdx < numPrimaryDof; ++ dofIdx) {
+                    RateVector values;
+                    simulator_.problem().source(values,
+                                                elemCtx,
+                                                dofIdx,
+                                                /*timeIdx=*/0);
+                    Opm::Valgrind::CheckDefined(values);
+
+                    const auto& intQuants = elemCtx.intensiveQuantities(dofIdx, /*timeIdx=*/0);
+                    Scalar dofVolume =
+                        elemCtx.dofVolume(dofIdx, /*timeIdx=*/0)
+                        * intQuants.extrusionFactor();
+                    for (unsigned eqIdx = 0; eqIdx < numEq; ++ eqIdx)
+                        sums.totalRate[eqIdx] += -dofVolume*Toolbox::value(values[eqIdx]);
+                    sums.totalVolume += dofVolume;
+                }
             }
+
+            elemCtx.setEnableStorageCache(storageCacheWasEnabled);
+        }
+
+        // add up the partial sums of the threads in a fixed order and summarize
+        // everything over all processes
+        ThreadSums total;
+        for (const auto& sums : threadSums) {
+            total.storageBeginTimeStep += sums.storageBeginTimeStep;
+            total.storageEndTimeStep += sums.storageEndTimeStep;
+            total.totalRate += sums.totalRate;
+            total.totalBoundaryArea += sums.totalBoundaryArea;
+            total.totalVolume += sums.totalVolume;
         }
 
-        // summarize everything over all processes
         const auto& comm = simulator_.gridView().comm();
-        totalRate = comm.sum(totalRate);
-        totalBoundaryArea = comm.sum(totalBoundaryArea);
-        totalVolume = comm.sum(totalVolume);
-
-        if (comm.rank() == 0) {
-            EqVector storageRate = storageBeginTimeStep;
-            storageRate -= storageEndTimeStep;
-            storageRate /= simulator_.timeStepSize();
-            if (verbose) {
-                std::cout << "storage at beginning of time step: " << storageBeginTimeStep << "\n";
-                std::cout << "storage at end of time step: " << storageEndTimeStep << "\n";
-                std::cout << "rate based on storage terms: " << storageRate << "\n";
-                std::cout << "rate based on source and boundary terms: " << totalRate << "\n";
-                std::cout << "difference in rates: ";
-                for (unsigned eqIdx = 0; eqIdx < EqVector::dimension; ++eqIdx)
-                    std::cout << (storageRate[eqIdx] - Toolbox::value(totalRate[eqIdx])) << " ";
-                std::cout << "\n";
-            }
-            for (unsigned eqIdx = 0; eqIdx < EqVector::dimension; ++eqIdx) {
-                Scalar eps =
-                    (std::abs(storageRate[eqIdx]) + Toolbox::value(totalRate[eqIdx]))*tolerance;
-                eps = std::max(tolerance, eps);
-                assert(std::abs(storageRate[eqIdx] - Toolbox::value(totalRate[eqIdx])) <= eps);
-            }
+        total.storageBeginTimeStep = comm.sum(total.storageBeginTimeStep);
+        total.storageEndTimeStep = comm.sum(total.storageEndTimeStep);
+        total.totalRate = comm.sum(total.totalRate);
+        total.totalBoundaryArea = comm.sum(total.totalBoundaryArea);
+        total.totalVolume = comm.sum(total.totalVolume);
+
+        EqVector storageRate = total.storageBeginTimeStep;
+        storageRate -= total.storageEndTimeStep;
+        storageRate /= simulator_.timeStepSize();
+        if (verbose && comm.rank() == 0) {
+            std::cout << "storage at beginning of time step: " << total.storageBeginTimeStep << "\n";
+            std::cout << "storage at end of time step: " << total.storageEndTimeStep << "\n";
+            std::cout << "rate based on storage terms: " << storageRate << "\n";
+            std::cout << "rate based on source and boundary terms: " << total.totalRate << "\n";
+            std::cout << "difference in rates: ";
+            for (unsigned eqIdx = 0; eqIdx < EqVector::dimension; ++eqIdx)
+                std::cout << (storageRate[eqIdx] - total.totalRate[eqIdx]) << " ";
+            std::cout << "\n";
+        }
+
+        bool isConservative = true;
+        for (unsigned eqIdx = 0; eqIdx < EqVector::dimension; ++eqIdx) {
+            Scalar eps =
+                (std::abs(storageRate[eqIdx]) + total.totalRate[eqIdx])*tolerance;
+            eps = std::max(tolerance, eps);
+            if (std::abs(storageRate[eqIdx] - total.totalRate[eqIdx]) > eps)
+                isConservative = false;
         }
-#endif // NDEBUG
+        assert(isConservative);
+
+        return isConservative;
     }
 
     /*!
@@ -1031,6 +1316,18 @@ public:
     bool isLocalDof(unsigned globalIdx) const
     { return isLocalDof_[globalIdx]; }
 
+    /*!
+     * \brief Returns true iff an element intersects with the boundary of the domain.
+     *
+     * This is determined once per grid change, so in contrast to
+     * Element::hasBoundaryIntersections(), it does not require to iterate over the
+     * intersections of the element.
+     *
+     * \param elemIdx The index of the element as given by the element mapper
+     */
+    bool isBoundaryElement(unsigned elemIdx) const
+    { return isBoundaryElement_[elemIdx] != 0; }
+
     /*!
      * \brief Returns the volume \f$\mathrm{[m^3]}\f$ of the whole grid which represents
      *        the spatial domain.
@@ -1175,6 +1472,7 @@ public:
         updateTimer_.halt();
 
         prePostProcessTimer_.start();
+        asImp_().predictSolution_();
         asImp_().updateBegin();
         prePostProcessTimer_.stop();
 
@@ -1255,26 +1553,44 @@ public:
             // check if problem allows for adaptation and cells were marked
             if( simulator_.problem().markForGridAdaptation() )
             {
-                // adapt the grid and load balance if necessary
-                adaptationManager().adapt();
+                // remember which elements exhibit up-to-date intensive quantities. the
+                // ones of the elements which are not affected by the adaptation can
+                // be reused afterwards.
+                AdaptationManager& adaptManager = adaptationManager();
+                prepareIntensiveQuantitiesTransfer_();
 
-                // if the grid has potentially changed, we need to re-create the
-                // supporting data structures.
-                resetLinearizer();
-                finishInit();
-
-                // notify the problem that the grid has changed
-                simulator_.problem().gridChanged();
+                // adapt the grid and load balance if necessary
+                adaptManager.adapt();
 
                 // update the entity mappers
                 elementMapper_.update();
                 vertexMapper_.update();
 
-                // notify the modules for visualization output
-                auto outIt = outputModules_.begin();
-                auto outEndIt = outputModules_.end();
-                for (; outIt != outEndIt; ++outIt)
-                    (*outIt)->allocBuffers();
+                // if the grid has potentially changed, we need to update the supporting
+                // data structures. in contrast to finishInit(), the linearizer, the
+                // element contexts and the caches are kept, i.e., only the sparsity
+                // pattern is determined again and the existing memory is reused if
+                // possible.
+                updateGridGeometry_();
+                linearizer_->eraseMatrix();
+                finishIntensiveQuantitiesTransfer_();
+
+                // only the current solution is transferred to the new grid, so the
+                // solutions of the previous time steps cannot be used by BDF2 anymore
+                numValidTimeLevels_ = 0;
+                timeDiscDivDiffValid_ = false;
+
+                // the flags of the output region refer to the elements of the old
+                // grid. problems which want to restrict the output of the adapted grid
+                // need to specify the region again, e.g. in their gridChanged() method.
+                clearOutputRegion();
+
+                // notify the problem that the grid has changed
+                simulator_.problem().gridChanged();
+
+                // the buffers of the output modules do not fit the new grid anymore.
+                // they are allocated again when the output is written the next time.
+                freeOutputBuffers_();
             }
         }
 #endif
@@ -1291,9 +1607,7 @@ public:
         // previous time step so that we can start the next
         // update at a physically meaningful solution.
         solution(/*timeIdx=*/0) = solution(/*timeIdx=*/1);
-        std::fill(intensiveQuantityCacheUpToDate_[0].begin(),
-                  intensiveQuantityCacheUpToDate_[0].end(),
-                  false);
+        invalidateIntensiveQuantitiesCache(/*timeIdx=*/0);
     }
 
     /*!
@@ -1308,8 +1622,47 @@ public:
         // at this point we can adapt the grid
         asImp_().adaptGrid();
 
+        // keep the solutions of the time steps before the previous one around if they
+        // are required to extrapolate the initial guess of the next time step
+        if (predictorOrder_ > 0) {
+            if (!predictorSolutions_.empty()
+                && predictorSolutions_.front().size() != solution(/*timeIdx=*/1).size())
+            {
+                // the grid has changed, so the old solutions cannot be used anymore
+                predictorSolutions_.clear();
+                predictorTimes_.clear();
+            }
+
+            predictorSolutions_.insert(predictorSolutions_.begin(), solution(/*timeIdx=*/1));
+            predictorTimes_.insert(predictorTimes_.begin(), simulator_.time());
+            if (predictorSolutions_.size() > predictorOrder_) {
+                predictorSolutions_.resize(predictorOrder_);
+                predictorTimes_.resize(predictorOrder_);
+            }
+            updateMemoryUsage_();
+        }
+
+        // estimate the truncation error of BDF2 while the full history is available
+        if (useBdf2_)
+            updateTimeDiscError_();
+
         // make the current solution the previous one.
-        solution(/*timeIdx=*/1) = solution(/*timeIdx=*/0);
+        for (unsigned timeIdx = historySize - 1; timeIdx > 0; --timeIdx)
+            solution(timeIdx) = solution(timeIdx - 1);
+
+        // record the storage terms of the converged solution. this is done before the
+        // intensive quantities cache is shifted because the intensive quantities of the
+        // most recent time index are usually still cached.
+        if (enableStorageCache_) {
+            for (unsigned timeIdx = historySize - 1; timeIdx > 1; --timeIdx)
+                storageCache_[timeIdx].swap(storageCache_[timeIdx - 1]);
+            recordStorageCache_(/*timeIdx=*/0);
+        }
+
+        prevTimeStepSizes_[1] = prevTimeStepSizes_[0];
+        prevTimeStepSizes_[0] = simulator_.timeStepSize();
+        if (numValidTimeLevels_ + 1 < static_cast<unsigned>(historySize))
+            ++numValidTimeLevels_;
 
         // shift the intensive quantities cache by one position in the
         // history
@@ -1400,6 +1753,83 @@ public:
         }
     }
 
+    /*!
+     * \brief Write the solution of all degrees of freedom of the grid to a binary
+     *        restart file.
+     *
+     * In contrast to serializeEntity(), this writes contiguous blocks of values instead
+     * of formatting the data of each degree of freedom on its own. Models which need to
+     * store additional data must extend this method.
+     *
+     * If the RestartWithCaches parameter is set, the storage terms of the previous time
+     * step are written as well, so that they need not be recalculated after a restart.
+     *
+     * \param res The serializer object
+     */
+    template <class Restarter>
+    void serializeBlocks(Restarter& res)
+    {
+        const auto& sol = solution(/*timeIdx=*/0);
+        size_t numDof = asImp_().numGridDof();
+
+        res.serializeSectionBegin("Solution");
+        res.template serializeBlock<Scalar>(numDof*numEq,
+                                            [&sol](size_t i)
+                                            { return sol[i/numEq][i%numEq]; });
+        res.serializeSectionEnd();
+
+        if (restartWithCaches_ && enableStorageCache_) {
+            // restart files are written for the solution of the last time step, so the
+            // storage terms of time index 1 belong to the serialized solution
+            prepareStorageCache();
+
+            const auto& storage = storageCache_[/*timeIdx=*/1];
+            res.serializeSectionBegin("StorageCache");
+            res.template serializeBlock<Scalar>(numDof*numEq,
+                                                [&storage](size_t i)
+                                                { return storage[i/numEq][i%numEq]; });
+            res.serializeSectionEnd();
+        }
+    }
+
+    /*!
+     * \brief Read the solution of all degrees of freedom of the grid from a binary
+     *        restart file.
+     *
+     * This is the inverse of serializeBlocks().
+     *
+     * \param res The deserializer object
+     */
+    template <class Restarter>
+    void deserializeBlocks(Restarter& res)
+    {
+        auto& sol = solution(/*timeIdx=*/0);
+        size_t numDof = asImp_().numGridDof();
+
+        res.deserializeSectionBegin("Solution");
+        res.template deserializeBlock<Scalar>(numDof*numEq,
+                                              [&sol](size_t i, Scalar value)
+                                              { sol[i/numEq][i%numEq] = value; });
+        res.deserializeSectionEnd();
+
+        // the storage terms are optional. if they are present but the storage cache is
+        // disabled, they are simply ignored.
+        if (res.hasSection("StorageCache")) {
+            if (!enableStorageCache_) {
+                res.skipSection("StorageCache");
+                return;
+            }
+
+            auto& storage = storageCache_[/*timeIdx=*/1];
+            res.deserializeSectionBegin("StorageCache");
+            res.template deserializeBlock<Scalar>(numDof*numEq,
+                                                  [&storage](size_t i, Scalar value)
+                                                  { storage[i/numEq][i%numEq] = value; });
+            res.deserializeSectionEnd();
+            storageCacheIsUpToDate_ = true;
+        }
+    }
+
     /*!
      * \brief Returns the number of degrees of freedom (DOFs) for the computational grid
      */
@@ -1448,8 +1878,91 @@ public:
     { return elementMapper_; }
 
     /*!
-     * \brief Resets the Jacobian matrix linearizer, so that the
-     *        boundary types can be altered.
+     * \brief Returns the seeds of all elements of the grid view.
+     *
+     * The elements are stored in the order of the grid's element iterator and the list
+     * is updated whenever the grid changes. This allows to use plain OpenMP loops over
+     * integers instead of walking the grid.
+     */
+    const std::vector<ElementSeed>& elementSeeds() const
+    { return elementSeeds_; }
+
+    /*!
+     * \brief Restrict the output of the model to a subset of the grid's elements.
+     *
+     * The argument is indexed by the element mapper. Only elements for which it is
+     * true are passed to the output modules. If the output writer supports it
+     * (cf. Ewoms::VtkAppendedWriter), only these elements are written to disk. An
+     * empty vector selects the whole grid. If the grid is adapted, the output region is
+     * reset to the whole grid.
+     */
+    void setOutputRegion(const std::vector<bool>& isOutputElement)
+    {
+        if (!isOutputElement.empty()
+            && isOutputElement.size() != static_cast<size_t>(gridView_.size(/*codim=*/0)))
+            OPM_THROW(std::invalid_argument,
+                      "The output region must specify a flag for each element of the grid");
+
+        isOutputElement_ = isOutputElement;
+        outputPartitionIsValid_ = false;
+    }
+
+    /*!
+     * \brief Restrict the output of the model to the elements whose centroid is
+     *        located within an axis-aligned bounding box.
+     */
+    template <class GlobalPosition>
+    void setOutputRegion(const GlobalPosition& lowerLeft, const GlobalPosition& upperRight)
+    {
+        std::vector<bool> isOutputElement(static_cast<size_t>(gridView_.size(/*codim=*/0)), false);
+
+        const auto& grid = gridView_.grid();
+        for (size_t elemIdx = 0; elemIdx < elementSeeds_.size(); ++elemIdx) {
+#if DUNE_VERSION_NEWER(DUNE_GRID, 2, 4)
+            const Element& elem = grid.entity(elementSeeds_[elemIdx]);
+#else
+            const auto& elemPtr = grid.entity(elementSeeds_[elemIdx]);
+            const Element& elem = *elemPtr;
+#endif
+            const auto& center = elem.geometry().center();
+
+            bool isInside = true;
+            for (unsigned dimIdx = 0; dimIdx < center.size(); ++dimIdx)
+                isInside = isInside
+                    && lowerLeft[dimIdx] <= center[dimIdx]
+                    && center[dimIdx] <= upperRight[dimIdx];
+
+#if DUNE_VERSION_NEWER(DUNE_COMMON, 2, 4)
+            isOutputElement[static_cast<size_t>(elementMapper_.index(elem))] = isInside;
+#else
+            isOutputElement[static_cast<size_t>(elementMapper_.map(elem))] = isInside;
+#endif
+        }
+
+        setOutputRegion(isOutputElement);
+    }
+
+    /*!
+     * \brief Write the output for the whole grid.
+     */
+    void clearOutputRegion()
+    {
+        isOutputElement_.clear();
+        outputPartitionIsValid_ = false;
+    }
+
+    /*!
+     * \brief Returns the elements for which output is written.
+     *
+     * The vector is indexed by the element mapper. If it is empty, the output covers
+     * the whole grid.
+     */
+    const std::vector<bool>& outputRegion() const
+    { return isOutputElement_; }
+
+    /*!
+     * \brief Resets the Jacobian matrix linearizer, so that the
+     *        boundary types can be altered.
      */
     void resetLinearizer ()
     {
@@ -1516,7 +2029,7 @@ public:
                                  const SolutionVector& u,
                                  const GlobalEqVector& deltaU) const
     {
-        typedef std::vector<double> ScalarBuffer;
+        typedef typename VtkMultiWriter::ScalarBuffer ScalarBuffer;
 
         GlobalEqVector globalResid(u.size());
         asImp_().globalResidual(globalResid, u);
@@ -1587,6 +2100,11 @@ public:
      */
     void prepareOutputFields() const
     {
+        EWOMS_PROFILE_REGION("prepareOutputFields");
+
+        if (outputModules_.empty())
+            return;
+
         bool needFullContextUpdate = false;
         auto modIt = outputModules_.begin();
         const auto& modEndIt = outputModules_.end();
@@ -1595,34 +2113,93 @@ public:
             needFullContextUpdate = needFullContextUpdate || (*modIt)->needExtensiveQuantities();
         }
 
-        // iterate over grid
-        ThreadedEntityIterator<GridView, /*codim=*/0> threadedElemIt(gridView());
+        // assign the degrees of freedom and the elements to the threads
+        updateOutputPartition_(/*withNeighbors=*/needFullContextUpdate);
+
+        // iterate over grid. each partition only contains the elements which touch the
+        // degrees of freedom it owns, so the output modules can write their buffers
+        // without any synchronization. the OpenMP runtime may spawn fewer threads than
+        // requested, so the partitions are distributed over the threads of the team and
+        // each thread remembers the partition it currently handles.
+        const auto& grid = gridView_.grid();
+        int numPartitions = static_cast<int>(outputThreadElements_.size());
 #ifdef _OPENMP
-#pragma omp parallel
+#pragma omp parallel num_threads(numPartitions)
 #endif
         {
+            unsigned threadId = ThreadManager::threadId();
             ElementContext elemCtx(simulator_);
-            ElementIterator elemIt = threadedElemIt.beginParallel();
-            for (; !threadedElemIt.isFinished(elemIt); elemIt = threadedElemIt.increment()) {
-                const auto& elem = *elemIt;
-                if (elem.partitionType() != Dune::InteriorEntity)
-                    // ignore non-interior entities
-                    continue;
 
-                if (needFullContextUpdate)
-                    elemCtx.updateAll(elem);
-                else {
-                    elemCtx.updatePrimaryStencil(elem);
-                    elemCtx.updatePrimaryIntensiveQuantities(/*timeIdx=*/0);
-                }
+#ifdef _OPENMP
+#pragma omp for schedule(static, 1)
+#endif
+            for (int partitionIdx = 0; partitionIdx < numPartitions; ++partitionIdx) {
+                outputThreadPartition_[threadId] = static_cast<unsigned>(partitionIdx);
 
-                modIt = outputModules_.begin();
-                for (; modIt != modEndIt; ++modIt)
-                    (*modIt)->processElement(elemCtx);
+                const auto& elemIndices = outputThreadElements_[static_cast<size_t>(partitionIdx)];
+                for (size_t i = 0; i < elemIndices.size(); ++i) {
+#if DUNE_VERSION_NEWER(DUNE_GRID, 2, 4)
+                    const Element& elem = grid.entity(elementSeeds_[elemIndices[i]]);
+#else
+                    const auto& elemPtr = grid.entity(elementSeeds_[elemIndices[i]]);
+                    const Element& elem = *elemPtr;
+#endif
+                    if (needFullContextUpdate) {
+                        // the output only refers to the most recent solution, so neither
+                        // the intensive quantities of the previous time steps nor the
+                        // storage term are required
+                        elemCtx.updateStencil(elem);
+                        elemCtx.updateIntensiveQuantities(/*timeIdx=*/0);
+                        elemCtx.updateExtensiveQuantities(/*timeIdx=*/0);
+                    }
+                    else {
+                        elemCtx.updatePrimaryStencil(elem);
+                        elemCtx.updatePrimaryIntensiveQuantities(/*timeIdx=*/0);
+                    }
+
+                    auto threadModIt = outputModules_.begin();
+                    for (; threadModIt != modEndIt; ++threadModIt)
+                        (*threadModIt)->processElement(elemCtx);
+                }
             }
         }
     }
 
+    /*!
+     * \brief Returns true iff the calling thread owns a degree of freedom while the
+     *        output fields are prepared.
+     *
+     * The output modules must only write the entries of their buffers for which this
+     * method returns true. The degrees of freedom are split into a contiguous block
+     * for each partition and every element which touches a degree of freedom of a block
+     * is part of its partition. Each thread handles one partition at a time. This means
+     * that elements at the border of a block are processed by multiple threads, but each
+     * entry of a buffer is written by exactly one of them.
+     */
+    bool isOwnedOutputDof(unsigned globalDofIdx) const
+    {
+        if (outputDofBegin_.empty())
+            return true;
+
+        unsigned partitionIdx = outputThreadPartition_[ThreadManager::threadId()];
+        return
+            outputDofBegin_[partitionIdx] <= globalDofIdx
+            && globalDofIdx < outputDofBegin_[partitionIdx + 1];
+    }
+
+    /*!
+     * \brief Called after the results of the current time step have been written to
+     *        all output writers.
+     *
+     * If the FreeOutputBuffers parameter is set, the memory of the buffers of the output
+     * modules is released until the next call to prepareOutputFields().
+     */
+    void outputWritten()
+    {
+        if (EWOMS_GET_PARAM(TypeTag, bool, FreeOutputBuffers))
+            freeOutputBuffers_();
+    }
+
     /*!
      * \brief Append the quantities relevant for the current solution
      *        to an output writer.
@@ -1671,18 +2248,21 @@ public:
             solution(timeIdx).resize(numDof);
 
         auxMod->applyInitial();
+
+        linearizer_->auxiliaryModulesChanged();
     }
 
     /*!
      * \brief Causes the list of auxiliary equations to be cleared
      *
-     * Note that this method implies recreateMatrix()
+     * Note that this only causes the rows of the Jacobian matrix which are affected by
+     * the auxiliary equations to be determined again. The sparsity pattern of the grid
+     * is kept.
      */
     void clearAuxiliaryModules()
     {
         auxEqModules_.clear();
-        linearizer_->eraseMatrix();
-        newtonMethod_.eraseMatrix();
+        linearizer_->auxiliaryModulesChanged();
     }
 
     /*!
@@ -1716,9 +2296,12 @@ public:
         {
             // create adaptation objects here, because when doing so in constructor
             // problem is not yet intialized, aka seg fault
+            intQuantsTransfer_.reset(
+                new IntensiveQuantitiesTransferContainer( simulator_.gridManager().grid(), /*codim=*/0, /*value=*/-1 ) );
             restrictProlong_.reset(
                 new RestrictProlong( DiscreteFunctionRestrictProlong(*(solution_[/*timeIdx=*/ 0] )),
-                                     simulator_.problem().restrictProlongOperator() ) );
+                                     simulator_.problem().restrictProlongOperator(),
+                                     IntensiveQuantitiesRestrictProlong( *intQuantsTransfer_, /*invalidValue=*/-1 ) ) );
             adaptationManager_.reset( new AdaptationManager( simulator_.gridManager().grid(), *restrictProlong_ ) );
         }
         return *adaptationManager_;
@@ -1738,28 +2321,477 @@ public:
     { return updateTimer_; }
 
 protected:
+    // returns the slot of the intensive quantity cache which is used for a time index
+    unsigned intensiveQuantityCacheSlot_(unsigned timeIdx) const
+    { return (timeIdx + intensiveQuantityCacheOffset_) % historySize; }
+
+    // estimate the local truncation error of the BDF2 step which has just been
+    // completed. the third derivative of the solution w.r.t. time is approximated by the
+    // difference of the second divided differences of this and the previous time step.
+    void updateTimeDiscError_()
+    {
+        timeDiscError_ = -1.0;
+        if (numValidTimeLevels_ < 2) {
+            timeDiscDivDiffValid_ = false;
+            return;
+        }
+
+        Scalar h0 = simulator_.timeStepSize();
+        Scalar h1 = prevTimeStepSizes_[0];
+        Scalar h2 = prevTimeStepSizes_[1];
+        Scalar omega = h0/h1;
+        const auto& u0 = solution(/*timeIdx=*/0);
+        const auto& u1 = solution(/*timeIdx=*/1);
+        const auto& u2 = solution(/*timeIdx=*/2);
+
+        size_t numDof = asImp_().numGridDof();
+        bool estimateError = timeDiscDivDiffValid_ && timeDiscDivDiff_.size() == numDof;
+        timeDiscDivDiff_.resize(numDof);
+
+        // the leading term of the local truncation error of the variable step BDF2
+        // scheme is h0^2 (h0 + h1) (1 + omega)/(6 (1 + 2 omega)) times the third
+        // derivative of the solution. the latter is six times the third divided
+        // difference.
+        Scalar alpha =
+            h0*h0*(h0 + h1)*(1 + omega)/((1 + 2*omega)*(h0 + h1 + h2));
+
+        Scalar error = 0.0;
+        for (unsigned dofIdx = 0; dofIdx < numDof; ++dofIdx) {
+            PrimaryVariables shiftedPv(u0[dofIdx]);
+            for (unsigned pvIdx = 0; pvIdx < numEq; ++pvIdx) {
+                Scalar divDiff =
+                    ((u0[dofIdx][pvIdx] - u1[dofIdx][pvIdx])/h0
+                     - (u1[dofIdx][pvIdx] - u2[dofIdx][pvIdx])/h1)
+                    /(h0 + h1);
+                if (estimateError)
+                    shiftedPv[pvIdx] += alpha*(divDiff - timeDiscDivDiff_[dofIdx][pvIdx]);
+                timeDiscDivDiff_[dofIdx][pvIdx] = divDiff;
+            }
+
+            if (estimateError)
+                error = std::max(error, asImp_().relativeDofError(dofIdx, u0[dofIdx], shiftedPv));
+        }
+        timeDiscDivDiffValid_ = true;
+
+        error = gridView_.comm().max(error);
+        if (estimateError)
+            timeDiscError_ = error;
+    }
+
+    // calculate the storage terms of all DOFs for the solution of a given time index
+    // and store them as the ones of the same time index at the beginning of the next
+    // time step. (i.e., the storage terms of time index 0 are taken as the ones of the
+    // previous time step.)
+    void recordStorageCache_(unsigned timeIdx) const
+    {
+        assert(enableStorageCache_);
+        unsigned destTimeIdx = std::max<unsigned>(timeIdx, 1);
+
+        OmpMutex mutex;
+        const auto& grid = gridView_.grid();
+        int numElems = static_cast<int>(elementSeeds_.size());
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+        {
+            // Attention: the variables below are thread specific and thus cannot be
+            // moved in front of the #pragma!
+            unsigned threadId = ThreadManager::threadId();
+            ElementContext elemCtx(simulator_);
+            EqVector storage;
+
+            // the cache must not be used for the quantities it is about to be filled
+            // with, and the intensive quantities of the previous time step might be
+            // required.
+            elemCtx.setEnableStorageCache(false);
+
+#ifdef _OPENMP
+#pragma omp for schedule(guided)
+#endif
+            for (int elemIdx = 0; elemIdx < numElems; ++elemIdx) {
+#if DUNE_VERSION_NEWER(DUNE_GRID, 2, 4)
+                const Element& elem = grid.entity(elementSeeds_[elemIdx]);
+#else
+                const auto& elemPtr = grid.entity(elementSeeds_[elemIdx]);
+                const Element& elem = *elemPtr;
+#endif
+                elemCtx.updateStencil(elem);
+                elemCtx.updatePrimaryIntensiveQuantities(timeIdx);
+
+                size_t numPrimaryDof = elemCtx.numPrimaryDof(timeIdx);
+                for (unsigned dofIdx = 0; dofIdx < numPrimaryDof; ++dofIdx) {
+                    storage = 0.0;
+                    localResidual(threadId).computeStorage(storage, elemCtx, dofIdx, timeIdx);
+
+                    // for the vertex-centered discretization, DOFs are shared by
+                    // multiple elements
+                    unsigned globalIdx = elemCtx.globalSpaceIndex(dofIdx, timeIdx);
+                    ScopedLock lock(mutex);
+                    storageCache_[destTimeIdx][globalIdx] = storage;
+                }
+            }
+        }
+
+        storageCacheIsUpToDate_ = true;
+    }
+
+#if HAVE_DUNE_FEM
+    // the intensive quantities can only be transferred if the degrees of freedom are
+    // the elements of the grid
+    static bool canTransferIntensiveQuantities_()
+    {
+        return
+            enableIntensiveQuantitiesCache_()
+            && std::is_same<DofMapper, ElementMapper>::value;
+    }
+
+    // record the index of the up-to-date intensive quantities of the most recent time
+    // index for each element of the grid before the grid is adapted
+    void prepareIntensiveQuantitiesTransfer_()
+    {
+        if (!canTransferIntensiveQuantities_())
+            return;
+
+        intQuantsTransfer_->resize(/*value=*/-1);
+        const IntensiveQuantitiesTransferContainer& transfer = *intQuantsTransfer_;
+
+        unsigned slotIdx = intensiveQuantityCacheSlot_(/*timeIdx=*/0);
+        const auto& upToDate = intensiveQuantityCacheUpToDate_[slotIdx];
+        ElementIterator elemIt = gridView_.template begin</*codim=*/0>();
+        const ElementIterator& elemEndIt = gridView_.template end</*codim=*/0>();
+        for (; elemIt != elemEndIt; ++elemIt) {
+            const Element& elem = *elemIt;
+            int elemIdx = static_cast<int>(elementMapper_.index(elem));
+            transfer[elem] = upToDate[static_cast<size_t>(elemIdx)] ? elemIdx : -1;
+        }
+    }
+
+    // resize the intensive quantities cache after the grid has been adapted. the cached
+    // quantities of the elements which were not touched by the adaptation are kept, all
+    // others are invalidated.
+    void finishIntensiveQuantitiesTransfer_()
+    {
+        if (!canTransferIntensiveQuantities_()) {
+            resizeAndResetIntensiveQuantitiesCache_();
+            return;
+        }
+
+        unsigned slotIdx = intensiveQuantityCacheSlot_(/*timeIdx=*/0);
+        intQuantsTransferCache_.swap(intensiveQuantityCache_[slotIdx]);
+        resizeAndResetIntensiveQuantitiesCache_();
+
+        // the elements which did not exist before the adaptation (e.g., the ones which
+        // were received from other processes) do not exhibit valid cached quantities
+        intQuantsTransfer_->resize(/*value=*/-1);
+        const IntensiveQuantitiesTransferContainer& transfer = *intQuantsTransfer_;
+
+        auto& cache = intensiveQuantityCache_[slotIdx];
+        auto& upToDate = intensiveQuantityCacheUpToDate_[slotIdx];
+        const auto& grid = gridView_.grid();
+        int numElems = static_cast<int>(elementSeeds_.size());
+#ifdef _OPENMP
+#pragma omp parallel for schedule(guided)
+#endif
+        for (int elemIdx = 0; elemIdx < numElems; ++elemIdx) {
+#if DUNE_VERSION_NEWER(DUNE_GRID, 2, 4)
+            const Element& elem = grid.entity(elementSeeds_[elemIdx]);
+#else
+            const auto& elemPtr = grid.entity(elementSeeds_[elemIdx]);
+            const Element& elem = *elemPtr;
+#endif
+            int oldIdx = transfer[elem];
+            if (oldIdx < 0)
+                continue;
+
+            size_t newIdx = static_cast<size_t>(elementMapper_.index(elem));
+            cache[newIdx] = intQuantsTransferCache_[static_cast<size_t>(oldIdx)];
+            upToDate[newIdx] = 1;
+        }
+    }
+#endif // HAVE_DUNE_FEM
+
+    // determine the volumes of the degrees of freedom, the list of element seeds and
+    // which degrees of freedom are local to the process. these only depend on the grid.
+    void updateGridGeometry_()
+    {
+        // initialize the volume of the finite volumes to zero
+        size_t numDof = asImp_().numGridDof();
+        dofTotalVolume_.resize(numDof);
+        std::fill(dofTotalVolume_.begin(), dofTotalVolume_.end(), 0.0);
+
+        ElementContext elemCtx(simulator_);
+        gridTotalVolume_ = 0.0;
+
+        // the flat list of elements used by the threaded loops over the grid
+        elementSeeds_.clear();
+        elementSeeds_.reserve(static_cast<size_t>(gridView_.size(/*codim=*/0)));
+        outputPartitionIsValid_ = false;
+        isBoundaryElement_.assign(static_cast<size_t>(gridView_.size(/*codim=*/0)), 0);
+
+        // iterate through the grid and evaluate the initial condition
+        ElementIterator elemIt = gridView_.template begin</*codim=*/0>();
+        const ElementIterator& elemEndIt = gridView_.template end</*codim=*/0>();
+        for (; elemIt != elemEndIt; ++elemIt) {
+            const Element& elem = *elemIt;
+            elementSeeds_.push_back(elem.seed());
+
+            // this is the only place where the intersections of the elements are
+            // inspected to find the boundary of the domain
+#if DUNE_VERSION_NEWER(DUNE_COMMON, 2, 4)
+            size_t elemIdx = static_cast<size_t>(elementMapper_.index(elem));
+#else
+            size_t elemIdx = static_cast<size_t>(elementMapper_.map(elem));
+#endif
+            isBoundaryElement_[elemIdx] = elem.hasBoundaryIntersections() ? 1 : 0;
+
+            const bool isInteriorElement = elem.partitionType() == Dune::InteriorEntity;
+            // ignore everything which is not in the interior if the
+            // current process' piece of the grid
+            if (!isInteriorElement)
+                continue;
+
+            // deal with the current element
+            elemCtx.updateStencil(elem);
+            const auto& stencil = elemCtx.stencil(/*timeIdx=*/0);
+
+            // loop over all element vertices, i.e. sub control volumes
+            for (unsigned dofIdx = 0; dofIdx < elemCtx.numPrimaryDof(/*timeIdx=*/0); dofIdx++) {
+                // map the local degree of freedom index to the global one
+                unsigned globalIdx = elemCtx.globalSpaceIndex(dofIdx, /*timeIdx=*/0);
+
+                Scalar dofVolume = stencil.subControlVolume(dofIdx).volume();
+                dofTotalVolume_[globalIdx] += dofVolume;
+                if (isInteriorElement)
+                    gridTotalVolume_ += dofVolume;
+            }
+        }
+
+        // determine which DOFs should be considered to lie fully in the interior of the
+        // local process grid partition: those which do not have a non-zero volume
+        // before taking the peer processes into account...
+        isLocalDof_.resize(numDof);
+        for (unsigned dofIdx = 0; dofIdx < numDof; ++dofIdx)
+            isLocalDof_[dofIdx] = (dofTotalVolume_[dofIdx] != 0.0);
+
+        // add the volumes of the DOFs on the process boundaries
+        const auto sumHandle =
+            GridCommHandleFactory::template sumHandle<Scalar>(dofTotalVolume_,
+                                                              asImp_().dofMapper());
+        gridView_.communicate(*sumHandle,
+                              Dune::InteriorBorder_All_Interface,
+                              Dune::ForwardCommunication);
+
+        // sum up the volumes of the grid partitions
+        gridTotalVolume_ = gridView_.comm().sum(gridTotalVolume_);
+    }
+
+    // evaluate the initial condition for the primary degrees of freedom of all interior
+    // elements in parallel
+    void applyInitialSolutionPerDof_(SolutionVector& uCur)
+    {
+        OmpMutex mutex;
+        std::exception_ptr exception;
+        const auto& grid = gridView_.grid();
+        int numElems = static_cast<int>(elementSeeds_.size());
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+        {
+            ElementContext elemCtx(simulator_);
+            PrimaryVariables priVars;
+
+#ifdef _OPENMP
+#pragma omp for schedule(guided)
+#endif
+            for (int elemIdx = 0; elemIdx < numElems; ++elemIdx) {
+#if DUNE_VERSION_NEWER(DUNE_GRID, 2, 4)
+                const Element& elem = grid.entity(elementSeeds_[static_cast<size_t>(elemIdx)]);
+#else
+                const auto& elemPtr = grid.entity(elementSeeds_[static_cast<size_t>(elemIdx)]);
+                const Element& elem = *elemPtr;
+#endif
+                // ignore everything which is not in the interior if the
+                // current process' piece of the grid
+                if (elem.partitionType() != Dune::InteriorEntity)
+                    continue;
+
+                try {
+                    // deal with the current element
+                    elemCtx.updateStencil(elem);
+
+                    // loop over all element vertices, i.e. sub control volumes
+                    size_t numPrimaryDof = elemCtx.numPrimaryDof(/*timeIdx=*/0);
+                    for (unsigned dofIdx = 0; dofIdx < numPrimaryDof; dofIdx++) {
+                        // map the local degree of freedom index to the global one
+                        unsigned globalIdx = elemCtx.globalSpaceIndex(dofIdx, /*timeIdx=*/0);
+
+                        // let the problem do the dirty work of nailing down
+                        // the initial solution.
+                        priVars = uCur[globalIdx];
+                        simulator_.problem().initial(priVars, elemCtx, dofIdx, /*timeIdx=*/0);
+                        asImp_().supplementInitialSolution_(priVars, elemCtx, dofIdx, /*timeIdx=*/0);
+                        priVars.checkDefined();
+
+                        // degrees of freedom may be shared by multiple elements
+                        ScopedLock writeLock(mutex);
+                        uCur[globalIdx] = priVars;
+                        writeLock.unlock();
+                    }
+                }
+                catch (...) {
+                    // exceptions must not leave a parallel region, so the first one is
+                    // re-thrown afterwards
+                    ScopedLock exceptionLock(mutex);
+                    if (!exception)
+                        exception = std::current_exception();
+                }
+            }
+        }
+
+        if (exception)
+            std::rethrow_exception(exception);
+    }
+
+    // if the grid is adapted, the number of degrees of freedom usually changes only by a
+    // few percent. to avoid reallocating the caches each time the number grows a bit,
+    // some headroom is reserved in this case.
+    template <class Cache>
+    void reserveCacheCapacity_(Cache& cache, size_t numDof) const
+    {
+        if (enableGridAdaptation_ && cache.capacity() < numDof)
+            cache.reserve(numDof + numDof/10);
+    }
+
     void resizeAndResetIntensiveQuantitiesCache_()
     {
         // allocate the storage cache
         if (enableStorageCache()) {
             size_t numDof = asImp_().numGridDof();
             for (unsigned timeIdx = 0; timeIdx < historySize; ++timeIdx) {
+                reserveCacheCapacity_(storageCache_[timeIdx], numDof);
                 storageCache_[timeIdx].resize(numDof);
             }
+            storageCacheIsUpToDate_ = false;
         }
 
         // allocate the intensive quantities cache
         if (storeIntensiveQuantities()) {
             size_t numDof = asImp_().numGridDof();
             for(unsigned timeIdx=0; timeIdx<historySize; ++timeIdx) {
+                reserveCacheCapacity_(intensiveQuantityCache_[timeIdx], numDof);
                 intensiveQuantityCache_[timeIdx].resize(numDof);
                 intensiveQuantityCacheUpToDate_[timeIdx].resize(numDof);
                 std::fill(intensiveQuantityCacheUpToDate_[timeIdx].begin(),
                           intensiveQuantityCacheUpToDate_[timeIdx].end(),
-                          false );
+                          0);
             }
         }
+
+        updateMemoryUsage_();
+    }
+
+    // report the memory used by the solutions and the caches to the memory accounting
+    void updateMemoryUsage_()
+    {
+        size_t solutionBytes = 0;
+        for (unsigned timeIdx = 0; timeIdx < historySize; ++timeIdx)
+            solutionBytes += memoryUsage(solution(timeIdx));
+        for (const auto& predictorSolution : predictorSolutions_)
+            solutionBytes += memoryUsage(predictorSolution);
+        solutionMemory_.set(solutionBytes);
+
+        size_t intQuantsBytes = 0;
+        for (unsigned timeIdx = 0; timeIdx < historySize; ++timeIdx)
+            intQuantsBytes +=
+                memoryUsage(intensiveQuantityCache_[timeIdx])
+                + memoryUsage(intensiveQuantityCacheUpToDate_[timeIdx]);
+#if HAVE_DUNE_FEM
+        intQuantsBytes += memoryUsage(intQuantsTransferCache_);
+#endif
+        intensiveQuantitiesMemory_.set(intQuantsBytes);
+
+        size_t storageBytes = 0;
+        for (unsigned timeIdx = 0; timeIdx < historySize; ++timeIdx)
+            storageBytes += memoryUsage(storageCache_[timeIdx]);
+        storageCacheMemory_.set(storageBytes);
+    }
+    /*!
+     * \brief Extrapolate the initial guess for the solution at the end of the time step
+     *        from the solutions of the previous time steps.
+     *
+     * The primary variables of the solution at the beginning of the time step and
+     * the ones of the earlier time steps are extrapolated using a Lagrange polynomial
+     * of the order given by the SolutionPredictorOrder parameter. If fewer time steps
+     * are available, the order is reduced accordingly.
+     */
+    void predictSolution_()
+    {
+        if (predictorSolutions_.empty())
+            return;
+
+        const SolutionVector& uOld = solution(/*timeIdx=*/1);
+        SolutionVector& uCur = solution(/*timeIdx=*/0);
+        if (predictorSolutions_.front().size() != uOld.size())
+            return;
+
+        // compute the weights of the Lagrange polynomial which interpolates the
+        // solutions at the times 't[0]' (the beginning of the time step), 't[1]', ...
+        // and evaluate it at the end of the time step
+        unsigned numLevels = static_cast<unsigned>(predictorSolutions_.size()) + 1;
+        Scalar t[3];
+        Scalar weight[3];
+        t[0] = simulator_.time();
+        for (unsigned levelIdx = 1; levelIdx < numLevels; ++levelIdx)
+            t[levelIdx] = predictorTimes_[levelIdx - 1];
+        Scalar tNew = simulator_.time() + simulator_.timeStepSize();
+        for (unsigned levelIdx = 0; levelIdx < numLevels; ++levelIdx) {
+            weight[levelIdx] = 1.0;
+            for (unsigned otherIdx = 0; otherIdx < numLevels; ++otherIdx) {
+                if (otherIdx == levelIdx)
+                    continue;
+                if (t[levelIdx] == t[otherIdx])
+                    return; // degenerated time levels
+                weight[levelIdx] *= (tNew - t[otherIdx])/(t[levelIdx] - t[otherIdx]);
+            }
+        }
+
+        size_t numDof = asImp_().numGridDof();
+        for (unsigned dofIdx = 0; dofIdx < numDof; ++dofIdx) {
+            // the meaning of the primary variables must be the same for all solutions,
+            // else the initial guess is the solution at the beginning of the time step
+            bool canExtrapolate = true;
+            for (unsigned levelIdx = 1; levelIdx < numLevels && canExtrapolate; ++levelIdx)
+                canExtrapolate =
+                    asImp_().solutionIsExtrapolatable_(uOld[dofIdx],
+                                                       predictorSolutions_[levelIdx - 1][dofIdx]);
+            if (!canExtrapolate)
+                continue;
+
+            PrimaryVariables& priVars = uCur[dofIdx];
+            priVars = uOld[dofIdx];
+            for (unsigned pvIdx = 0; pvIdx < numEq; ++pvIdx) {
+                Scalar value = weight[0]*uOld[dofIdx][pvIdx];
+                for (unsigned levelIdx = 1; levelIdx < numLevels; ++levelIdx)
+                    value += weight[levelIdx]*predictorSolutions_[levelIdx - 1][dofIdx][pvIdx];
+                priVars[pvIdx] = value;
+            }
+        }
+
+        asImp_().syncOverlap();
+        invalidateIntensiveQuantitiesCache(/*timeIdx=*/0);
     }
+
+    /*!
+     * \brief Returns true iff the primary variables of a degree of freedom for two
+     *        different solutions can be extrapolated.
+     *
+     * Models which switch the meaning of their primary variables need to overload this
+     * method.
+     */
+    bool solutionIsExtrapolatable_(const PrimaryVariables& priVars OPM_UNUSED,
+                                   const PrimaryVariables& otherPriVars OPM_UNUSED) const
+    { return true; }
+
     template <class Context>
     void supplementInitialSolution_(PrimaryVariables& priVars OPM_UNUSED,
                                     const Context& context OPM_UNUSED,
@@ -1799,6 +2831,80 @@ protected:
     bool verbose_() const
     { return gridView_.comm().rank() == 0; }
 
+    // release the memory of the buffers of all output modules
+    void freeOutputBuffers_()
+    {
+        auto modIt = outputModules_.begin();
+        const auto& modEndIt = outputModules_.end();
+        for (; modIt != modEndIt; ++modIt)
+            (*modIt)->freeBuffers();
+    }
+
+    // split the degrees of freedom into a contiguous block for each thread and
+    // determine the elements which are handled by each thread. if withNeighbors is
+    // true, the extensive quantities are evaluated, so the modules may also write to
+    // the neighboring degrees of freedom of an element.
+    void updateOutputPartition_(bool withNeighbors) const
+    {
+        unsigned numThreads = ThreadManager::maxThreads();
+        size_t numDof = asImp_().numGridDof();
+        if (outputPartitionIsValid_
+            && outputPartitionWithNeighbors_ == withNeighbors
+            && outputThreadElements_.size() == numThreads
+            && outputDofBegin_.back() == numDof)
+            return;
+
+        outputDofBegin_.resize(numThreads + 1);
+        for (unsigned threadIdx = 0; threadIdx <= numThreads; ++threadIdx)
+            outputDofBegin_[threadIdx] = numDof*threadIdx/numThreads;
+
+        outputThreadElements_.assign(numThreads, std::vector<unsigned>());
+        outputThreadPartition_.assign(numThreads, 0);
+
+        const auto& grid = gridView_.grid();
+        Stencil stencil(gridView_, asImp_().dofMapper());
+        std::vector<unsigned> elemThreads;
+        for (unsigned elemIdx = 0; elemIdx < elementSeeds_.size(); ++elemIdx) {
+#if DUNE_VERSION_NEWER(DUNE_GRID, 2, 4)
+            const Element& elem = grid.entity(elementSeeds_[elemIdx]);
+#else
+            const auto& elemPtr = grid.entity(elementSeeds_[elemIdx]);
+            const Element& elem = *elemPtr;
+#endif
+            if (elem.partitionType() != Dune::InteriorEntity)
+                // ignore non-interior entities
+                continue;
+
+            // ignore the elements which are not part of the output region
+#if DUNE_VERSION_NEWER(DUNE_COMMON, 2, 4)
+            if (!isOutputElement_.empty() && !isOutputElement_[static_cast<size_t>(elementMapper_.index(elem))])
+#else
+            if (!isOutputElement_.empty() && !isOutputElement_[static_cast<size_t>(elementMapper_.map(elem))])
+#endif
+                continue;
+
+            stencil.update(elem);
+            unsigned numElemDof =
+                static_cast<unsigned>(withNeighbors ? stencil.numDof() : stencil.numPrimaryDof());
+
+            elemThreads.clear();
+            for (unsigned dofIdx = 0; dofIdx < numElemDof; ++dofIdx) {
+                size_t globalIdx = stencil.globalSpaceIndex(dofIdx);
+                unsigned threadIdx = static_cast<unsigned>(
+                    std::upper_bound(outputDofBegin_.begin(), outputDofBegin_.end(), globalIdx)
+                    - outputDofBegin_.begin() - 1);
+                if (std::find(elemThreads.begin(), elemThreads.end(), threadIdx) == elemThreads.end())
+                    elemThreads.push_back(threadIdx);
+            }
+
+            for (unsigned threadIdx : elemThreads)
+                outputThreadElements_[threadIdx].push_back(elemIdx);
+        }
+
+        outputPartitionWithNeighbors_ = withNeighbors;
+        outputPartitionIsValid_ = true;
+    }
+
     Implementation& asImp_()
     { return *static_cast<Implementation*>(this); }
     const Implementation& asImp_() const
@@ -1813,8 +2919,21 @@ protected:
 
     // the mappers for element and vertex entities to global indices
     ElementMapper elementMapper_;
+    std::vector<ElementSeed> elementSeeds_;
     VertexMapper vertexMapper_;
 
+    // the elements for which output is written. if empty, all are written
+    std::vector<bool> isOutputElement_;
+
+    // the first degree of freedom owned by each output partition and the indices of
+    // the elements which belong to each partition
+    mutable std::vector<size_t> outputDofBegin_;
+    mutable std::vector<std::vector<unsigned> > outputThreadElements_;
+    // the partition which is currently handled by each thread
+    mutable std::vector<unsigned> outputThreadPartition_;
+    mutable bool outputPartitionWithNeighbors_;
+    mutable bool outputPartitionIsValid_;
+
     // a vector with all auxiliary equations to be considered
     std::vector<std::shared_ptr<BaseAuxiliaryModule<TypeTag> > > auxEqModules_;
 
@@ -1826,7 +2945,7 @@ protected:
     Ewoms::Timer updateTimer_;
 
     // calculates the local jacobian matrix for a given element
-    std::vector<LocalLinearizer> localLinearizer_;
+    ThreadLocalObjects<LocalLinearizer> localLinearizer_;
     // Linearizes the problem at the current time step using the
     // local jacobian
     Linearizer *linearizer_;
@@ -1834,14 +2953,23 @@ protected:
     // cur is the current iterative solution, prev the converged
     // solution of the previous time step
     mutable IntensiveQuantitiesVector intensiveQuantityCache_[historySize];
-    mutable std::vector<bool> intensiveQuantityCacheUpToDate_[historySize];
+    // the validity flags of the cache use one byte per entry (instead of a bit for
+    // std::vector<bool>), so different threads can update them concurrently
+    mutable std::vector<unsigned char> intensiveQuantityCacheUpToDate_[historySize];
+    // the slot of the cache which is used for time index 0
+    unsigned intensiveQuantityCacheOffset_;
 
     DiscreteFunctionSpace space_;
     mutable std::array< std::unique_ptr< DiscreteFunction >, historySize > solution_;
 
 #if HAVE_DUNE_FEM
+    std::unique_ptr< IntensiveQuantitiesTransferContainer > intQuantsTransfer_;
     std::unique_ptr< RestrictProlong  > restrictProlong_;
     std::unique_ptr< AdaptationManager> adaptationManager_;
+
+    // the intensive quantities cache of the most recent time index before the grid
+    // was adapted. this is kept around to reuse its memory for the next adaptation.
+    IntensiveQuantitiesVector intQuantsTransferCache_;
 #endif
 
 
@@ -1850,10 +2978,33 @@ protected:
     Scalar gridTotalVolume_;
     std::vector<Scalar> dofTotalVolume_;
     std::vector<bool> isLocalDof_;
+    std::vector<unsigned char> isBoundaryElement_;
 
     bool enableGridAdaptation_;
-    mutable GlobalEqVector storageCache_[historySize];
+    mutable StorageCacheVector storageCache_[historySize];
     bool enableStorageCache_;
+    mutable bool storageCacheIsUpToDate_;
+    bool restartWithCaches_;
+
+    // the state of the time discretization: the number of previous solutions which can
+    // be used, the sizes of the last two time steps, the second divided differences of
+    // the solution w.r.t. time for the last time step and the error estimate of BDF2
+    bool useBdf2_;
+    unsigned numValidTimeLevels_;
+    Scalar prevTimeStepSizes_[2];
+    bool timeDiscDivDiffValid_;
+    std::vector<EqVector> timeDiscDivDiff_;
+    Scalar timeDiscError_;
+
+    // the solutions of the time steps before the previous one and the points in time
+    // at which they were valid. the most recent one comes first.
+    unsigned predictorOrder_;
+    std::vector<SolutionVector> predictorSolutions_;
+    std::vector<Scalar> predictorTimes_;
+
+    MemoryRecord solutionMemory_;
+    MemoryRecord intensiveQuantitiesMemory_;
+    MemoryRecord storageCacheMemory_;
 };
 } // namespace Ewoms
 
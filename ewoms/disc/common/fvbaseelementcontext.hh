@@ -29,6 +29,7 @@
 #define EWOMS_FV_BASE_ELEMENT_CONTEXT_HH
 
 #include "fvbaseproperties.hh"
+#include "linearizationtype.hh"
 
 #include <ewoms/common/alignedallocator.hh>
 
@@ -37,6 +38,7 @@
 #include <opm/common/Exceptions.hpp>
 
 #include <dune/common/fvector.hh>
+#include <dune/common/version.hh>
 
 #include <vector>
 #include <string>
@@ -66,6 +68,10 @@ class FvBaseElementContext
         IntensiveQuantities intensiveQuantities[timeDiscHistorySize];
         PrimaryVariables priVars[timeDiscHistorySize];
         const IntensiveQuantities *thermodynamicHint[timeDiscHistorySize];
+
+        // if this is not a null pointer, the intensive quantities of the DOF are taken
+        // from the intensive quantity cache of the model instead of the local copy.
+        const IntensiveQuantities *cachedIntensiveQuantities[timeDiscHistorySize];
     };
     typedef std::vector<DofStore_> DofVarsVector;
     typedef std::vector<ExtensiveQuantities> ExtensiveQuantitiesVector;
@@ -103,6 +109,8 @@ public:
         simulatorPtr_ = &simulator;
         enableStorageCache_ = EWOMS_GET_PARAM(TypeTag, bool, EnableStorageCache);
         stashedDofIdx_ = -1;
+
+        simulator.model().prepareStencil(stencil_);
     }
 
     static void *operator new(size_t size) {
@@ -233,6 +241,21 @@ public:
     void updatePrimaryIntensiveQuantities(unsigned timeIdx)
     { updateIntensiveQuantities_(timeIdx, numPrimaryDof(timeIdx)); }
 
+    /*!
+     * \brief Compute the intensive quantities of a single sub-control volume of the
+     *        current element from the global solution.
+     *
+     * In contrast to updateIntensiveQuantities(), this method considers the intensive
+     * quantities cache of the model and it does not update the gradients within the
+     * sub-control volumes.
+     *
+     * \param dofIdx The local index in the current element of the sub-control volume
+     *               which should be updated.
+     * \param timeIdx The index of the solution vector used by the time discretization.
+     */
+    void updateDofIntensiveQuantities(unsigned dofIdx, unsigned timeIdx)
+    { updateDofIntensiveQuantities_(model().solution(timeIdx), dofIdx, timeIdx); }
+
     /*!
      * \brief Compute the intensive quantities of a single sub-control volume of the
      *        current element for a single time index.
@@ -248,11 +271,13 @@ public:
         updateSingleIntQuants_(priVars, dofIdx, timeIdx);
 
         // update gradients inside a sub control volume
-        size_t nDof = numDof(timeIdx);
-        for (unsigned gradDofIdx = 0; gradDofIdx < nDof; gradDofIdx++) {
-            dofVars_[gradDofIdx].intensiveQuantities[timeIdx].updateScvGradients(/*context=*/*this,
-                                                                                 gradDofIdx,
-                                                                                 timeIdx);
+        if (requireScvCenterGradients) {
+            size_t nDof = numDof(timeIdx);
+            for (unsigned gradDofIdx = 0; gradDofIdx < nDof; gradDofIdx++) {
+                dofVars_[gradDofIdx].intensiveQuantities[timeIdx].updateScvGradients(/*context=*/*this,
+                                                                                     gradDofIdx,
+                                                                                     timeIdx);
+            }
         }
     }
 
@@ -400,9 +425,19 @@ public:
     /*!
      * \brief Returns whether the current element is on the domain's
      *        boundary.
+     *
+     * This is looked up from the flags precomputed by the model, cf.
+     * FvBaseDiscretization::isBoundaryElement().
      */
     bool onBoundary() const
-    { return element().hasBoundaryIntersections(); }
+    {
+#if DUNE_VERSION_NEWER(DUNE_COMMON, 2, 4)
+        unsigned elemIdx = static_cast<unsigned>(model().elementMapper().index(element()));
+#else
+        unsigned elemIdx = static_cast<unsigned>(model().elementMapper().map(element()));
+#endif
+        return model().isBoundaryElement(elemIdx);
+    }
 
     /*!
      * \brief Return a reference to the intensive quantities of a
@@ -425,7 +460,10 @@ public:
                       "for the most-recent substep (i.e. time index 0) are available!");
 #endif
 
-        return dofVars_[dofIdx].intensiveQuantities[timeIdx];
+        const DofStore_& dofStore = dofVars_[dofIdx];
+        if (dofStore.cachedIntensiveQuantities[timeIdx])
+            return *dofStore.cachedIntensiveQuantities[timeIdx];
+        return dofStore.intensiveQuantities[timeIdx];
     }
 
     /*!
@@ -443,11 +481,14 @@ public:
     }
     /*!
      * \copydoc intensiveQuantities()
+     *
+     * If the intensive quantities of the degree of freedom refer to the intensive
+     * quantity cache of the model, they are copied to the element context first.
      */
     IntensiveQuantities& intensiveQuantities(unsigned dofIdx, unsigned timeIdx)
     {
         assert(0 <= dofIdx && dofIdx < numDof(timeIdx));
-        return dofVars_[dofIdx].intensiveQuantities[timeIdx];
+        return localIntensiveQuantities_(dofIdx, timeIdx);
     }
 
     /*!
@@ -499,7 +540,8 @@ public:
     {
         assert(0 <= dofIdx && dofIdx < numDof(/*timeIdx=*/0));
 
-        intensiveQuantitiesStashed_ = dofVars_[dofIdx].intensiveQuantities[/*timeIdx=*/0];
+        const auto& constThis = *this;
+        intensiveQuantitiesStashed_ = constThis.intensiveQuantities(dofIdx, /*timeIdx=*/0);
         priVarsStashed_ = dofVars_[dofIdx].priVars[/*timeIdx=*/0];
         stashedDofIdx_ = static_cast<int>(dofIdx);
     }
@@ -513,6 +555,7 @@ public:
     {
         dofVars_[dofIdx].priVars[/*timeIdx=*/0] = priVarsStashed_;
         dofVars_[dofIdx].intensiveQuantities[/*timeIdx=*/0] = intensiveQuantitiesStashed_;
+        dofVars_[dofIdx].cachedIntensiveQuantities[/*timeIdx=*/0] = nullptr;
         stashedDofIdx_ = -1;
     }
 
@@ -549,6 +592,13 @@ public:
     void setEnableStorageCache(bool yesno)
     { enableStorageCache_ = yesno; }
 
+    /*!
+     * \brief Returns the solution of the time discretization w.r.t. which the residual is
+     *        currently linearized.
+     */
+    const LinearizationType& linearizationType() const
+    { return model().linearizer().getLinearizationType(); }
+
 protected:
     /*!
      * \brief Update the first 'n' intensive quantities objects from the primary variables.
@@ -561,31 +611,47 @@ protected:
         const SolutionVector& globalSol = model().solution(timeIdx);
 
         // update the non-gradient quantities
-        for (unsigned dofIdx = 0; dofIdx < numDof; dofIdx++) {
-            unsigned globalIdx = globalSpaceIndex(dofIdx, timeIdx);
-            const PrimaryVariables& dofSol = globalSol[globalIdx];
-            dofVars_[dofIdx].priVars[timeIdx] = dofSol;
-
-            dofVars_[dofIdx].thermodynamicHint[timeIdx] =
-                model().thermodynamicHint(globalIdx, timeIdx);
+        for (unsigned dofIdx = 0; dofIdx < numDof; dofIdx++)
+            updateDofIntensiveQuantities_(globalSol, dofIdx, timeIdx);
 
-            const auto *cachedIntQuants = model().cachedIntensiveQuantities(globalIdx, timeIdx);
-            if (cachedIntQuants) {
-                dofVars_[dofIdx].intensiveQuantities[timeIdx] = *cachedIntQuants;
-            }
-            else {
-                updateSingleIntQuants_(dofSol, dofIdx, timeIdx);
-                model().updateCachedIntensiveQuantities(dofVars_[dofIdx].intensiveQuantities[timeIdx],
-                                                        globalIdx,
-                                                        timeIdx);
+        // update gradients
+        if (requireScvCenterGradients) {
+            for (unsigned dofIdx = 0; dofIdx < numDof; dofIdx++) {
+                dofVars_[dofIdx].intensiveQuantities[timeIdx].updateScvGradients(/*context=*/*this,
+                                                                                 dofIdx,
+                                                                                 timeIdx);
             }
         }
+    }
 
-        // update gradients
-        for (unsigned dofIdx = 0; dofIdx < numDof; dofIdx++) {
-            dofVars_[dofIdx].intensiveQuantities[timeIdx].updateScvGradients(/*context=*/*this,
-                                                                             dofIdx,
-                                                                             timeIdx);
+    void updateDofIntensiveQuantities_(const SolutionVector& globalSol,
+                                       unsigned dofIdx,
+                                       unsigned timeIdx)
+    {
+        unsigned globalIdx = globalSpaceIndex(dofIdx, timeIdx);
+        const PrimaryVariables& dofSol = globalSol[globalIdx];
+        dofVars_[dofIdx].priVars[timeIdx] = dofSol;
+
+        dofVars_[dofIdx].thermodynamicHint[timeIdx] =
+            model().thermodynamicHint(globalIdx, timeIdx);
+
+        const auto *cachedIntQuants = model().cachedIntensiveQuantities(globalIdx, timeIdx);
+        if (cachedIntQuants && !requireScvCenterGradients) {
+            // the intensive quantities stored by the cache are not modified within
+            // the element context, so they can be referred to instead of copying
+            // them. this is faster because DOFs usually show up in the stencils of
+            // many elements.
+            dofVars_[dofIdx].cachedIntensiveQuantities[timeIdx] = cachedIntQuants;
+        }
+        else if (cachedIntQuants) {
+            dofVars_[dofIdx].cachedIntensiveQuantities[timeIdx] = nullptr;
+            dofVars_[dofIdx].intensiveQuantities[timeIdx] = *cachedIntQuants;
+        }
+        else {
+            updateSingleIntQuants_(dofSol, dofIdx, timeIdx);
+            model().updateCachedIntensiveQuantities(dofVars_[dofIdx].intensiveQuantities[timeIdx],
+                                                    globalIdx,
+                                                    timeIdx);
         }
     }
 
@@ -599,9 +665,20 @@ protected:
 #endif
 
         dofVars_[dofIdx].priVars[timeIdx] = priVars;
+        dofVars_[dofIdx].cachedIntensiveQuantities[timeIdx] = nullptr;
         dofVars_[dofIdx].intensiveQuantities[timeIdx].update(/*context=*/*this, dofIdx, timeIdx);
     }
 
+    IntensiveQuantities& localIntensiveQuantities_(unsigned dofIdx, unsigned timeIdx)
+    {
+        DofStore_& dofStore = dofVars_[dofIdx];
+        if (dofStore.cachedIntensiveQuantities[timeIdx]) {
+            dofStore.intensiveQuantities[timeIdx] = *dofStore.cachedIntensiveQuantities[timeIdx];
+            dofStore.cachedIntensiveQuantities[timeIdx] = nullptr;
+        }
+        return dofStore.intensiveQuantities[timeIdx];
+    }
+
     IntensiveQuantities intensiveQuantitiesStashed_;
     PrimaryVariables priVarsStashed_;
 
@@ -54,6 +54,7 @@ NEW_TYPE_TAG(FiniteDifferenceLocalLinearizer);
 NEW_PROP_TAG(LocalLinearizer);
 NEW_PROP_TAG(Evaluation);
 NEW_PROP_TAG(NumericDifferenceMethod);
+NEW_PROP_TAG(NumericDifferenceReuseVolumeTerms);
 NEW_PROP_TAG(BaseEpsilon);
 
 NEW_PROP_TAG(LocalResidual);
@@ -66,11 +67,15 @@ NEW_PROP_TAG(Scalar);
 NEW_PROP_TAG(Evaluation);
 NEW_PROP_TAG(GridView);
 NEW_PROP_TAG(NumEq);
+NEW_PROP_TAG(EnableAdjointLinearization);
 
 // set the properties to be spliced in
 SET_TYPE_PROP(FiniteDifferenceLocalLinearizer, LocalLinearizer,
               Ewoms::FvBaseFdLocalLinearizer<TypeTag>);
 
+//! finite differences only provide the derivatives w.r.t. most recent solution
+SET_BOOL_PROP(FiniteDifferenceLocalLinearizer, EnableAdjointLinearization, false);
+
 SET_TYPE_PROP(FiniteDifferenceLocalLinearizer, Evaluation,
               typename GET_PROP_TYPE(TypeTag, Scalar));
 
@@ -83,6 +88,15 @@ SET_TYPE_PROP(FiniteDifferenceLocalLinearizer, Evaluation,
  */
 SET_INT_PROP(FiniteDifferenceLocalLinearizer, NumericDifferenceMethod, +1);
 
+/*!
+ * \brief Specify whether the storage and source terms of the unperturbed degrees of
+ *        freedom are reused when the residual is evaluated for a perturbed solution.
+ *
+ * This is only correct if the storage and source terms of a degree of freedom
+ * exclusively depend on its own intensive quantities, so it is disabled by default.
+ */
+SET_BOOL_PROP(FiniteDifferenceLocalLinearizer, NumericDifferenceReuseVolumeTerms, false);
+
 //! The base epsilon value for finite difference calculations
 SET_SCALAR_PROP(FiniteDifferenceLocalLinearizer,
                 BaseEpsilon,
@@ -165,6 +179,7 @@ public:
 public:
     FvBaseFdLocalLinearizer()
         : internalElemContext_(0)
+        , reuseVolumeTerms_(false)
     { }
 
     ~FvBaseFdLocalLinearizer()
@@ -178,6 +193,9 @@ public:
         EWOMS_REGISTER_PARAM(TypeTag, int, NumericDifferenceMethod,
                              "The method used for numeric differentiation (-1: backward "
                              "differences, 0: central differences, 1: forward differences)");
+        EWOMS_REGISTER_PARAM(TypeTag, bool, NumericDifferenceReuseVolumeTerms,
+                             "Only re-evaluate the storage and source terms of the perturbed "
+                             "degree of freedom for numeric differentiation");
     }
 
     /*!
@@ -193,6 +211,7 @@ public:
         simulatorPtr_ = &simulator;
         delete internalElemContext_;
         internalElemContext_ = new ElementContext(simulator);
+        reuseVolumeTerms_ = EWOMS_GET_PARAM(TypeTag, bool, NumericDifferenceReuseVolumeTerms);
     }
 
     /*!
@@ -235,8 +254,12 @@ public:
         resize_(elemCtx);
         reset_(elemCtx);
 
-        // calculate the local residual
-        localResidual_.eval(residual_, elemCtx);
+        // calculate the local residual. if the volume terms are reused, they are
+        // recorded for the unperturbed solution.
+        if (reuseVolumeTerms_)
+            localResidual_.eval(residual_, volumeTerms_, elemCtx);
+        else
+            localResidual_.eval(residual_, elemCtx);
 
         // calculate the local jacobian matrix
         size_t numPrimaryDof = elemCtx.numPrimaryDof(/*timeIdx=*/0);
@@ -343,6 +366,10 @@ protected:
         jacobian_.setSize(numDof, numPrimaryDof);
 
         derivResidual_.resize(numDof);
+        if (reuseVolumeTerms_) {
+            volumeTerms_.resize(numDof);
+            perturbedResidual_.resize(numDof);
+        }
     }
 
     /*!
@@ -425,7 +452,7 @@ protected:
             // calculate the residual
             elemCtx.updateIntensiveQuantities(priVars, dofIdx, /*timeIdx=*/0);
             elemCtx.updateAllExtensiveQuantities();
-            localResidual_.eval(derivResidual_, elemCtx);
+            evalPerturbedResidual_(derivResidual_, elemCtx, dofIdx);
         }
         else {
             // we are using backward differences, i.e. we don't need
@@ -446,9 +473,14 @@ protected:
             // residual's internal storage.
             elemCtx.updateIntensiveQuantities(priVars, dofIdx, /*timeIdx=*/0);
             elemCtx.updateAllExtensiveQuantities();
-            localResidual_.eval(elemCtx);
-
-            derivResidual_ -= localResidual_.residual();
+            if (reuseVolumeTerms_) {
+                localResidual_.evalPerturbed(perturbedResidual_, volumeTerms_, elemCtx, dofIdx);
+                derivResidual_ -= perturbedResidual_;
+            }
+            else {
+                localResidual_.eval(elemCtx);
+                derivResidual_ -= localResidual_.residual();
+            }
         }
         else {
             // we are using forward differences, i.e. we don't need to
@@ -473,6 +505,20 @@ protected:
 #endif
     }
 
+    /*!
+     * \brief Evaluate the local residual after the primary variables of a degree of
+     *        freedom have been perturbed.
+     */
+    void evalPerturbedResidual_(LocalEvalBlockVector& residual,
+                                const ElementContext& elemCtx,
+                                unsigned dofIdx)
+    {
+        if (reuseVolumeTerms_)
+            localResidual_.evalPerturbed(residual, volumeTerms_, elemCtx, dofIdx);
+        else
+            localResidual_.eval(residual, elemCtx);
+    }
+
     /*!
      * \brief Updates the current local Jacobian matrix with the
      *        partial derivatives of all equations in regard to the
@@ -505,6 +551,12 @@ protected:
     LocalEvalBlockVector derivResidual_;
     ScalarLocalBlockMatrix jacobian_;
 
+    // the volume terms of the unperturbed solution and the buffer for the residual of
+    // the backward perturbation if the volume terms are reused
+    bool reuseVolumeTerms_;
+    LocalEvalBlockVector volumeTerms_;
+    LocalEvalBlockVector perturbedResidual_;
+
     LocalResidual localResidual_;
 };
 
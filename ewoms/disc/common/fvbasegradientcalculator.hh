@@ -194,6 +194,59 @@ public:
         }
     }
 
+    /*!
+     * \brief Calculates the gradients of several quantities at any flux approximation
+     *        point.
+     *
+     * This is equivalent to calling calculateGradient() for each quantity, but the
+     * geometric weights are only determined once.
+     *
+     * \param quantityGrads An array with \c numQuantities entries for the results
+     * \param elemCtx The current execution context
+     * \param fapIdx The local index of the flux approximation point
+     *               in the current element's stencil.
+     * \param quantityCallback A callable object returning the value of a quantity given
+     *               the index of a degree of freedom and the index of the quantity
+     * \param numQuantities The number of quantities for which the gradient is calculated
+     */
+    template <class QuantityCallback>
+    void calculateGradients(EvalDimVector* quantityGrads,
+                            const ElementContext& elemCtx,
+                            unsigned fapIdx,
+                            const QuantityCallback& quantityCallback,
+                            unsigned numQuantities) const
+    {
+        const auto& stencil = elemCtx.stencil(/*timeIdx=*/0);
+        const auto& face = stencil.interiorFace(fapIdx);
+
+        unsigned i = face.interiorIndex();
+        unsigned j = face.exteriorIndex();
+        const auto& exteriorPos = stencil.subControlVolume(j).globalPos();
+        const auto& interiorPos = stencil.subControlVolume(i).globalPos();
+
+        // the gradient of a quantity is the difference of its values times the distance
+        // vector divided by the squared distance, see calculateGradient()
+        Scalar weight[dimWorld];
+        Scalar distSquared = 0;
+        for (unsigned dimIdx = 0; dimIdx < dimWorld; ++dimIdx) {
+            weight[dimIdx] = exteriorPos[dimIdx] - interiorPos[dimIdx];
+            distSquared += weight[dimIdx]*weight[dimIdx];
+        }
+        for (unsigned dimIdx = 0; dimIdx < dimWorld; ++dimIdx)
+            weight[dimIdx] /= distSquared;
+
+        for (unsigned quantityIdx = 0; quantityIdx < numQuantities; ++quantityIdx) {
+            // see calculateGradient() for why the derivatives of the exterior DOF are
+            // thrown away
+            Evaluation deltay =
+                Toolbox::value(quantityCallback(j, quantityIdx))
+                - quantityCallback(i, quantityIdx);
+
+            for (unsigned dimIdx = 0; dimIdx < dimWorld; ++dimIdx)
+                quantityGrads[quantityIdx][dimIdx] = deltay*weight[dimIdx];
+        }
+    }
+
     /*!
      * \brief Calculates the value of an arbitrary quantity at any
      *        flux approximation point on the grid boundary.
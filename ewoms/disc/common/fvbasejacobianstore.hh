@@ -0,0 +1,426 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \copydoc Ewoms::FvBaseJacobianStore
+ */
+#ifndef EWOMS_FV_BASE_JACOBIAN_STORE_HH
+#define EWOMS_FV_BASE_JACOBIAN_STORE_HH
+
+#include "fvbaseproperties.hh"
+
+#include <opm/common/ErrorMacros.hpp>
+#include <opm/common/Exceptions.hpp>
+
+#if HAVE_LZ4
+#include <lz4.h>
+#endif
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Ewoms {
+/*!
+ * \ingroup FiniteVolumeDiscretizations
+ *
+ * \brief Spills the values of the Jacobian matrices of each time step to disk and
+ *        reads them back in reverse order.
+ *
+ * This is the alternative to recomputing the time steps of the forward simulation
+ * during the backward sweep of the adjoint model: The adjoint driver stores the
+ * Jacobian w.r.t. the solution at the end of each time step and the one w.r.t. the
+ * solution at its beginning. Since all matrices exhibit the sparsity pattern of the
+ * linearizer's matrix, the pattern is written only once and only the values of the
+ * non-zero blocks are stored for each time step. The values can be truncated to single
+ * precision and, if eWoms was built with LZ4, they are compressed.
+ *
+ * Compressing and writing the values is done by background threads, so the forward
+ * simulation only needs to wait if too many writes are pending. During the backward
+ * sweep, the matrices of the previous time step are read while the adjoint equations
+ * of the current one are solved.
+ */
+template <class TypeTag>
+class FvBaseJacobianStore
+{
+    typedef typename GET_PROP_TYPE(TypeTag, Scalar) Scalar;
+    typedef typename GET_PROP_TYPE(TypeTag, JacobianMatrix) Matrix;
+
+    enum { numEq = GET_PROP_VALUE(TypeTag, NumEq) };
+    enum { blockSize = numEq*numEq };
+
+    typedef std::vector<Scalar> Values;
+
+    // the uncompressed size of a compressed chunk of a file
+    static const size_t chunkSize = 64*1024*1024;
+
+public:
+    /*!
+     * \brief The matrices which are stored for each time step.
+     */
+    enum MatrixType {
+        //! The Jacobian w.r.t. the solution at the end of the time step
+        jacobianIdx = 0,
+        //! The Jacobian w.r.t. the solution at the beginning of the time step
+        previousJacobianIdx = 1,
+        numMatrices = 2
+    };
+
+    FvBaseJacobianStore()
+    {
+        singlePrecision_ = true;
+        maxPendingWrites_ = 2;
+        curStepIdx_ = 0;
+        prefetchStepIdx_ = 0;
+    }
+
+    FvBaseJacobianStore(const FvBaseJacobianStore&) = delete;
+
+    ~FvBaseJacobianStore()
+    { flush(); }
+
+    /*!
+     * \brief Enable the store.
+     *
+     * \param fileNamePrefix The prefix of the names of all files written by the store,
+     *                       usually a directory on a node-local disk plus the rank of
+     *                       the process
+     * \param singlePrecision Specifies whether the values are truncated to single
+     *                        precision
+     */
+    void init(const std::string& fileNamePrefix, bool singlePrecision)
+    {
+        fileNamePrefix_ = fileNamePrefix;
+        singlePrecision_ = singlePrecision;
+    }
+
+    /*!
+     * \brief Returns true iff the store has been enabled.
+     */
+    bool enabled() const
+    { return !fileNamePrefix_.empty(); }
+
+    /*!
+     * \brief Store the values of a matrix of a time step.
+     *
+     * The values are copied, so the matrix can be modified as soon as this method
+     * returns. The sparsity pattern is written when the first matrix is stored.
+     */
+    void store(unsigned stepIdx, MatrixType matrixIdx, const Matrix& matrix)
+    {
+        if (numNonZeroBlocks_() == 0)
+            writePattern_(matrix);
+        else if (static_cast<size_t>(matrix.nonzeroes()) != numNonZeroBlocks_())
+            OPM_THROW(std::logic_error,
+                      "All matrices of the Jacobian store must exhibit the same sparsity pattern");
+
+        Values values;
+        values.reserve(numNonZeroBlocks_()*blockSize);
+        auto rowIt = matrix.begin();
+        const auto& rowEndIt = matrix.end();
+        for (; rowIt != rowEndIt; ++rowIt) {
+            auto colIt = rowIt->begin();
+            const auto& colEndIt = rowIt->end();
+            for (; colIt != colEndIt; ++colIt)
+                for (unsigned i = 0; i < numEq; ++i)
+                    for (unsigned j = 0; j < numEq; ++j)
+                        values.push_back((*colIt)[i][j]);
+        }
+
+        // make sure that only a limited number of copies of the values is kept in
+        // memory
+        while (pendingWrites_.size() >= maxPendingWrites_) {
+            pendingWrites_.front().get();
+            pendingWrites_.pop_front();
+        }
+
+        pendingWrites_.push_back(std::async(std::launch::async,
+                                            &FvBaseJacobianStore::writeValues_,
+                                            fileName_(stepIdx, matrixIdx),
+                                            std::move(values),
+                                            singlePrecision_));
+    }
+
+    /*!
+     * \brief Block until all values have been written to disk.
+     *
+     * If writing a file failed, the exception is re-thrown by this method.
+     */
+    void flush()
+    {
+        while (!pendingWrites_.empty()) {
+            auto write = std::move(pendingWrites_.front());
+            pendingWrites_.pop_front();
+            write.get();
+        }
+    }
+
+    /*!
+     * \brief Make the matrices of a time step available to copyTo() and start reading
+     *        the ones of the previous time step in the background.
+     *
+     * This implies flush(). The files of the time step are removed after they have been
+     * read.
+     */
+    void load(unsigned stepIdx)
+    {
+        flush();
+
+        for (unsigned matrixIdx = 0; matrixIdx < numMatrices; ++matrixIdx) {
+            if (prefetchStepIdx_ == stepIdx && prefetched_[matrixIdx].valid())
+                curValues_[matrixIdx] = prefetched_[matrixIdx].get();
+            else
+                curValues_[matrixIdx] =
+                    readValues_(fileName_(stepIdx, static_cast<MatrixType>(matrixIdx)));
+        }
+        curStepIdx_ = stepIdx;
+
+        if (stepIdx > 0) {
+            prefetchStepIdx_ = stepIdx - 1;
+            for (unsigned matrixIdx = 0; matrixIdx < numMatrices; ++matrixIdx) {
+                prefetched_[matrixIdx] =
+                    std::async(std::launch::async,
+                               &FvBaseJacobianStore::readValues_,
+                               fileName_(prefetchStepIdx_, static_cast<MatrixType>(matrixIdx)));
+            }
+        }
+    }
+
+    /*!
+     * \brief Copy the values of a matrix of the time step which was loaded last into a
+     *        matrix.
+     *
+     * The matrix must exhibit the sparsity pattern of the stored matrices.
+     */
+    void copyTo(MatrixType matrixIdx, Matrix& matrix) const
+    {
+        const Values& values = curValues_[matrixIdx];
+        if (static_cast<size_t>(matrix.nonzeroes())*blockSize != values.size())
+            OPM_THROW(std::logic_error,
+                      "The matrix of time step " << curStepIdx_ << " does not exhibit "
+                      "the sparsity pattern of the stored matrices");
+
+        size_t valueIdx = 0;
+        auto rowIt = matrix.begin();
+        const auto& rowEndIt = matrix.end();
+        for (; rowIt != rowEndIt; ++rowIt) {
+            auto colIt = rowIt->begin();
+            const auto& colEndIt = rowIt->end();
+            for (; colIt != colEndIt; ++colIt)
+                for (unsigned i = 0; i < numEq; ++i)
+                    for (unsigned j = 0; j < numEq; ++j)
+                        (*colIt)[i][j] = values[valueIdx++];
+        }
+    }
+
+private:
+    size_t numNonZeroBlocks_() const
+    { return patternColIdx_.size(); }
+
+    std::string fileName_(unsigned stepIdx, MatrixType matrixIdx) const
+    {
+        std::ostringstream oss;
+        oss << fileNamePrefix_ << "-step" << stepIdx << "-" << matrixIdx << ".jac";
+        return oss.str();
+    }
+
+    // write the sparsity pattern as the number of entries of each row followed by the
+    // column indices of all entries. it is also kept in memory to check the matrices.
+    void writePattern_(const Matrix& matrix)
+    {
+        std::vector<uint32_t> rowSizes;
+        rowSizes.reserve(matrix.N());
+        patternColIdx_.clear();
+        patternColIdx_.reserve(static_cast<size_t>(matrix.nonzeroes()));
+
+        auto rowIt = matrix.begin();
+        const auto& rowEndIt = matrix.end();
+        for (; rowIt != rowEndIt; ++rowIt) {
+            rowSizes.push_back(static_cast<uint32_t>(rowIt->size()));
+            auto colIt = rowIt->begin();
+            const auto& colEndIt = rowIt->end();
+            for (; colIt != colEndIt; ++colIt)
+                patternColIdx_.push_back(static_cast<uint32_t>(colIt.index()));
+        }
+
+        std::ofstream os(fileNamePrefix_ + "-pattern.jac", std::ios::binary);
+        if (!os)
+            OPM_THROW(std::runtime_error,
+                      "Could not open file '" << fileNamePrefix_ << "-pattern.jac' for writing");
+        uint64_t numRows = rowSizes.size();
+        uint64_t numEntries = patternColIdx_.size();
+        uint64_t blockSize64 = numEq;
+        os.write(reinterpret_cast<const char*>(&numRows), sizeof(numRows));
+        os.write(reinterpret_cast<const char*>(&numEntries), sizeof(numEntries));
+        os.write(reinterpret_cast<const char*>(&blockSize64), sizeof(blockSize64));
+        os.write(reinterpret_cast<const char*>(rowSizes.data()),
+                 static_cast<std::streamsize>(rowSizes.size()*sizeof(uint32_t)));
+        os.write(reinterpret_cast<const char*>(patternColIdx_.data()),
+                 static_cast<std::streamsize>(patternColIdx_.size()*sizeof(uint32_t)));
+    }
+
+    // the file format is the number of values, the number of bytes per value and the
+    // number of chunks, followed by the chunks. each chunk consists of its uncompressed
+    // size, its size in the file and the data.
+    static void writeValues_(const std::string& fileName,
+                             const Values& values,
+                             bool singlePrecision)
+    {
+        std::vector<char> raw;
+        if (singlePrecision) {
+            std::vector<float> truncated(values.begin(), values.end());
+            raw.assign(reinterpret_cast<const char*>(truncated.data()),
+                       reinterpret_cast<const char*>(truncated.data() + truncated.size()));
+        }
+        else
+            raw.assign(reinterpret_cast<const char*>(values.data()),
+                       reinterpret_cast<const char*>(values.data() + values.size()));
+
+        std::ofstream os(fileName, std::ios::binary);
+        if (!os)
+            OPM_THROW(std::runtime_error, "Could not open file '" << fileName << "' for writing");
+
+        uint64_t numValues = values.size();
+        uint64_t valueSize = singlePrecision ? sizeof(float) : sizeof(Scalar);
+        uint64_t numChunks = (raw.size() + chunkSize - 1)/chunkSize;
+        os.write(reinterpret_cast<const char*>(&numValues), sizeof(numValues));
+        os.write(reinterpret_cast<const char*>(&valueSize), sizeof(valueSize));
+        os.write(reinterpret_cast<const char*>(&numChunks), sizeof(numChunks));
+
+        std::vector<char> compressed;
+        for (uint64_t chunkIdx = 0; chunkIdx < numChunks; ++chunkIdx) {
+            const char* chunk = raw.data() + chunkIdx*chunkSize;
+            uint64_t rawSize = std::min<uint64_t>(chunkSize, raw.size() - chunkIdx*chunkSize);
+            uint64_t storedSize = rawSize;
+#if HAVE_LZ4
+            compressed.resize(static_cast<size_t>(LZ4_compressBound(static_cast<int>(rawSize))));
+            int compressedSize = LZ4_compress_default(chunk,
+                                                      compressed.data(),
+                                                      static_cast<int>(rawSize),
+                                                      static_cast<int>(compressed.size()));
+            if (compressedSize <= 0)
+                OPM_THROW(std::runtime_error, "Compressing the values of a Jacobian using LZ4 failed");
+            storedSize = static_cast<uint64_t>(compressedSize);
+            chunk = compressed.data();
+#endif
+
+            os.write(reinterpret_cast<const char*>(&rawSize), sizeof(rawSize));
+            os.write(reinterpret_cast<const char*>(&storedSize), sizeof(storedSize));
+            os.write(chunk, static_cast<std::streamsize>(storedSize));
+        }
+
+        if (!os)
+            OPM_THROW(std::runtime_error, "Could not write file '" << fileName << "'");
+    }
+
+    static Values readValues_(const std::string& fileName)
+    {
+        std::ifstream is(fileName, std::ios::binary);
+        if (!is)
+            OPM_THROW(std::runtime_error, "Could not open file '" << fileName << "' for reading");
+
+        uint64_t numValues;
+        uint64_t valueSize;
+        uint64_t numChunks;
+        is.read(reinterpret_cast<char*>(&numValues), sizeof(numValues));
+        is.read(reinterpret_cast<char*>(&valueSize), sizeof(valueSize));
+        is.read(reinterpret_cast<char*>(&numChunks), sizeof(numChunks));
+        if (!is || (valueSize != sizeof(float) && valueSize != sizeof(Scalar)))
+            OPM_THROW(std::runtime_error, "File '" << fileName << "' is not a valid Jacobian file");
+
+        std::vector<char> raw(numValues*valueSize);
+        std::vector<char> stored;
+        size_t offset = 0;
+        for (uint64_t chunkIdx = 0; chunkIdx < numChunks; ++chunkIdx) {
+            uint64_t rawSize;
+            uint64_t storedSize;
+            is.read(reinterpret_cast<char*>(&rawSize), sizeof(rawSize));
+            is.read(reinterpret_cast<char*>(&storedSize), sizeof(storedSize));
+            if (!is || offset + rawSize > raw.size())
+                OPM_THROW(std::runtime_error, "File '" << fileName << "' is corrupt");
+
+            stored.resize(storedSize);
+            is.read(stored.data(), static_cast<std::streamsize>(storedSize));
+            if (storedSize == rawSize)
+                std::copy(stored.begin(), stored.end(), raw.begin() + static_cast<long>(offset));
+            else {
+#if HAVE_LZ4
+                int size = LZ4_decompress_safe(stored.data(),
+                                               raw.data() + offset,
+                                               static_cast<int>(storedSize),
+                                               static_cast<int>(rawSize));
+                if (size < 0 || static_cast<uint64_t>(size) != rawSize)
+                    OPM_THROW(std::runtime_error, "File '" << fileName << "' is corrupt");
+#else
+                OPM_THROW(std::runtime_error,
+                          "Reading file '" << fileName << "' requires eWoms to be built with LZ4");
+#endif
+            }
+            offset += rawSize;
+        }
+        if (!is || offset != raw.size())
+            OPM_THROW(std::runtime_error, "File '" << fileName << "' is corrupt");
+        is.close();
+
+        // the values of each time step are only required once
+        std::remove(fileName.c_str());
+
+        Values values(numValues);
+        if (valueSize == sizeof(float)) {
+            const float* data = reinterpret_cast<const float*>(raw.data());
+            std::copy(data, data + numValues, values.begin());
+        }
+        else {
+            const Scalar* data = reinterpret_cast<const Scalar*>(raw.data());
+            std::copy(data, data + numValues, values.begin());
+        }
+        return values;
+    }
+
+    std::string fileNamePrefix_;
+    bool singlePrecision_;
+    size_t maxPendingWrites_;
+
+    std::vector<uint32_t> patternColIdx_;
+    std::deque<std::future<void> > pendingWrites_;
+
+    unsigned curStepIdx_;
+    std::array<Values, numMatrices> curValues_;
+
+    unsigned prefetchStepIdx_;
+    std::array<std::future<Values>, numMatrices> prefetched_;
+};
+
+} // namespace Ewoms
+
+#endif
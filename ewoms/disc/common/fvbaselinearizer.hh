@@ -29,12 +29,22 @@
 #define EWOMS_FV_BASE_LINEARIZER_HH
 
 #include "fvbaseproperties.hh"
-
+#include "linearizationtype.hh"
+#include "cartesiangridpattern.hh"
+
+#include <ewoms/common/genericguard.hh>
+#include <ewoms/common/memoryaccounting.hh>
+#include <ewoms/common/parametersystem.hh>
+#include <ewoms/common/profiler.hh>
+#include <ewoms/parallel/collectivewaittimes.hh>
 #include <ewoms/parallel/gridcommhandles.hh>
 #include <ewoms/parallel/threadmanager.hh>
 #include <ewoms/parallel/threadedentityiterator.hh>
+#include <ewoms/parallel/threadlocalobjects.hh>
 #include <ewoms/aux/baseauxiliarymodule.hh>
+#include <ewoms/linear/schurcomplementcorrection.hh>
 
+#include <opm/common/Unused.hpp>
 #include <opm/common/ErrorMacros.hpp>
 #include <opm/common/Exceptions.hpp>
 
@@ -44,8 +54,18 @@
 
 #include <type_traits>
 #include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <utility>
 #include <vector>
 #include <set>
+#include <map>
+#include <stdexcept>
 
 namespace Ewoms {
 // forward declarations
@@ -90,6 +110,7 @@ class FvBaseLinearizer
 
     typedef typename GridView::template Codim<0>::Entity Element;
     typedef typename GridView::template Codim<0>::Iterator ElementIterator;
+    typedef typename Element::EntitySeed ElementSeed;
 
     typedef GlobalEqVector Vector;
     typedef JacobianMatrix Matrix;
@@ -97,37 +118,63 @@ class FvBaseLinearizer
     enum { numEq = GET_PROP_VALUE(TypeTag, NumEq) };
     enum { historySize = GET_PROP_VALUE(TypeTag, TimeDiscHistorySize) };
 
-    typedef Dune::FieldMatrix<Scalar, numEq, numEq> MatrixBlock;
+    // the blocks of the global Jacobian may use a different floating point type than the
+    // local linearizer (cf. the JacobianScalar property)
+    typedef typename Matrix::block_type MatrixBlock;
     typedef Dune::FieldVector<Scalar, numEq> VectorBlock;
 
     static const bool linearizeNonLocalElements = GET_PROP_VALUE(TypeTag, LinearizeNonLocalElements);
+    static const bool enableAdjointLinearization = GET_PROP_VALUE(TypeTag, EnableAdjointLinearization);
+    static const bool useLinearizationColoring = GET_PROP_VALUE(TypeTag, UseLinearizationColoring);
+    static const bool useLinearizationLock =
+        GET_PROP_VALUE(TypeTag, UseLinearizationLock) && !useLinearizationColoring;
 
     // copying the linearizer is not a good idea
     FvBaseLinearizer(const FvBaseLinearizer&);
 //! \endcond
 
 public:
+    typedef Linear::SchurComplementCorrection<Scalar, numEq> SchurCorrection;
+
     FvBaseLinearizer()
+        : linearizationMemory_("Jacobian matrices and residuals")
     {
         simulatorPtr_ = 0;
 
         matrix_ = 0;
+        matrixA_ = 0;
+        auxPatternIsDirty_ = false;
+
+        useActiveSet_ = false;
+        activeSetIsValid_ = false;
+        numRelinearizedElements_ = 0;
     }
 
     ~FvBaseLinearizer()
     {
         delete matrix_;
-        auto it = elementCtx_.begin();
-        const auto& endIt = elementCtx_.end();
-        for (; it != endIt; ++it)
-            delete *it;
+        delete matrixA_;
     }
 
     /*!
      * \brief Register all run-time parameters for the Jacobian linearizer.
      */
     static void registerParameters()
-    { }
+    {
+        EWOMS_REGISTER_PARAM(TypeTag, Scalar, ActiveSetLinearizationTolerance,
+                             "Only re-linearize the elements whose stencil contains a "
+                             "degree of freedom for which the weighted change of the "
+                             "primary variables since its last linearization exceeds "
+                             "this value. 0 means that all elements are linearized");
+        EWOMS_REGISTER_PARAM(TypeTag, bool, PrecomputeIntensiveQuantities,
+                             "Compute the intensive quantities of all degrees of freedom "
+                             "in a separate pass before linearizing the elements. This "
+                             "requires the intensive quantity cache to be enabled");
+        EWOMS_REGISTER_PARAM(TypeTag, bool, OverlapAuxiliaryLinearization,
+                             "Evaluate the equations of the auxiliary modules (e.g., "
+                             "wells) concurrently with the linearization of the "
+                             "elements");
+    }
 
     /*!
      * \brief Initialize the linearizer.
@@ -141,8 +188,7 @@ public:
     void init(Simulator& simulator)
     {
         simulatorPtr_ = &simulator;
-        delete matrix_; // <- note that this even works for nullpointers!
-        matrix_ = 0;
+        eraseMatrix();
     }
 
     /*!
@@ -150,14 +196,41 @@ public:
      *        iteration.
      *
      * This method is usally called if the sparsity pattern has changed for some
-     * reason. (e.g. by modifications of the grid or changes of the auxiliary equations.)
+     * reason. (e.g. by modifications of the grid.) If only the auxiliary equations
+     * have changed, auxiliaryModulesChanged() is the cheaper alternative.
      */
     void eraseMatrix()
     {
         delete matrix_; // <- note that this even works for nullpointers!
+        delete matrixA_;
         matrix_ = 0;
+        matrixA_ = 0;
+
+        gridRowOffset_.clear();
+        gridRowSize_.clear();
+        gridNeighbors_.clear();
+        auxRowIndices_.clear();
+        auxPatternIsDirty_ = false;
+
+        linearizationMemory_.set(0);
+
+        activeSetIsValid_ = false;
+        elementLinearizations_.clear();
+        dofOwnerElement_.clear();
     }
 
+    /*!
+     * \brief Notify the linearizer that the set of auxiliary modules has changed.
+     *
+     * In contrast to eraseMatrix(), the sparsity pattern of the grid is kept. Before
+     * the next linearization, only the rows which are affected by the auxiliary
+     * equations are determined again. If the resulting pattern is the same as the
+     * current one (e.g., because the same wells have been added again), the existing
+     * matrices are reused, else they are reallocated without walking the grid.
+     */
+    void auxiliaryModulesChanged()
+    { auxPatternIsDirty_ = true; }
+
     /*!
      * \brief Linearize the global non-linear system of equations
      *
@@ -168,47 +241,94 @@ public:
      * represented by the model object.
      */
     void linearize()
-    {
-        // we defer the initialization of the Jacobian matrix until here because the
-        // auxiliary modules usually assume the problem, model and grid to be fully
-        // initialized...
-        if (!matrix_)
-            initFirstIteration_();
+    { linearizeGlobal_(/*residualOnly=*/false); }
 
-        int succeeded;
-        try {
-            linearize_();
-            succeeded = 1;
-        }
-        catch (const std::exception& e)
-        {
-            std::cout << "rank " << simulator_().gridView().comm().rank()
-                      << " caught an exception while linearizing:" << e.what()
-                      << "\n"  << std::flush;
-            succeeded = 0;
-        }
-#if ! DUNE_VERSION_NEWER(DUNE_COMMON, 2, 5)
-        catch (const Dune::Exception& e)
-        {
-            std::cout << "rank " << simulator_().gridView().comm().rank()
-                      << " caught an exception while linearizing:" << e.what()
-                      << "\n"  << std::flush;
-            succeeded = 0;
+    /*!
+     * \brief Evaluate the residual of the global non-linear system of equations
+     *        without assembling its Jacobian matrix.
+     *
+     * This is intended for the cases where only the residual is required, e.g., for
+     * checking the trial steps of a line search. The residual is evaluated for the
+     * current solution of the model and afterwards stored in the object returned by
+     * residual(). The entries of the Jacobian matrix which are assembled for the
+     * elements are not modified, i.e., they are still the ones of the last call to
+     * linearize(). (Auxiliary modules may update their own rows, though.)
+     *
+     * Note that the local residuals are still evaluated using the Evaluation type of
+     * the model (i.e., the derivatives are computed by the local residual), but they
+     * are neither converted into local Jacobians nor scattered into the global matrix.
+     */
+    void linearizeResidual()
+    { linearizeGlobal_(/*residualOnly=*/true); }
+
+    /*!
+     * \brief Evaluate the residual of the global non-linear system of equations for the
+     *        current solution plus a small multiple of a given direction.
+     *
+     * This allows to approximate the product of the Jacobian matrix with the direction
+     * by a finite difference, i.e., \f$J d \approx (R(u + \epsilon d) - R(u))/\epsilon\f$.
+     * The step size \f$\epsilon\f$ is chosen relative to the norms of the solution and
+     * of the direction. The solution and the residual() are restored afterwards, but
+     * the cached intensive quantities of the current solution are invalidated. Since
+     * the step size is the same on all processes, this is a collective operation.
+     *
+     * \param dest Receives the residual for the perturbed solution
+     * \param direction The direction of the perturbation. It must be defined for all
+     *                  degrees of freedom, including the ones which are not owned by
+     *                  the local process.
+     * \return The step size \f$\epsilon\f$, or 0 if the direction is zero
+     */
+    Scalar linearizePerturbedResidual(GlobalEqVector& dest, const GlobalEqVector& direction)
+    {
+        auto& model = model_();
+        SolutionVector& solution = model.solution(/*timeIdx=*/0);
+        size_t numDof = model.numTotalDof();
+
+        Scalar solutionNorm2 = 0.0;
+        Scalar directionNorm2 = 0.0;
+        for (unsigned dofIdx = 0; dofIdx < numDof; ++dofIdx) {
+            for (unsigned eqIdx = 0; eqIdx < numEq; ++eqIdx) {
+                solutionNorm2 += solution[dofIdx][eqIdx]*solution[dofIdx][eqIdx];
+                directionNorm2 += direction[dofIdx][eqIdx]*direction[dofIdx][eqIdx];
+            }
         }
-#endif
-        catch (...)
-        {
-            std::cout << "rank " << simulator_().gridView().comm().rank()
-                      << " caught an exception while linearizing"
-                      << "\n"  << std::flush;
-            succeeded = 0;
+        const auto& comm = gridView_().comm();
+        solutionNorm2 = comm.sum(solutionNorm2);
+        directionNorm2 = comm.sum(directionNorm2);
+        if (directionNorm2 <= 0.0) {
+            dest = residual_;
+            return 0.0;
         }
-        succeeded = gridView_().comm().min(succeeded);
 
-        if (!succeeded) {
-            OPM_THROW(Opm::NumericalProblem,
-                       "A process did not succeed in linearizing the system");
-        }
+        Scalar eps =
+            std::sqrt(std::numeric_limits<Scalar>::epsilon())
+            *(1 + std::sqrt(solutionNorm2))/std::sqrt(directionNorm2);
+
+        // the unperturbed solution and residual are restored even if the evaluation
+        // of the residual throws
+        SolutionVector unperturbedSolution(solution);
+        GlobalEqVector unperturbedResidual(residual_);
+        ResidualStamp_ unperturbedStamp(residualStamp_);
+        auto restoreFn =
+            [this, &model, &solution, &unperturbedSolution, &unperturbedResidual,
+             &unperturbedStamp]() -> void
+            {
+                solution = unperturbedSolution;
+                this->residual_ = unperturbedResidual;
+                this->residualStamp_ = unperturbedStamp;
+                model.invalidateIntensiveQuantitiesCache(/*timeIdx=*/0);
+            };
+        GenericGuard<decltype(restoreFn)> restoreGuard(restoreFn);
+
+        for (unsigned dofIdx = 0; dofIdx < numDof; ++dofIdx)
+            for (unsigned eqIdx = 0; eqIdx < numEq; ++eqIdx)
+                solution[dofIdx][eqIdx] += eps*direction[dofIdx][eqIdx];
+        model.invalidateIntensiveQuantitiesCache(/*timeIdx=*/0);
+
+        linearizeGlobal_(/*residualOnly=*/true);
+        dest = residual_;
+
+        return eps;
     }
 
     /*!
@@ -220,10 +340,21 @@ public:
     Matrix& matrix()
     { return *matrix_; }
 
+    /*!
+     * \brief Return reference to the Jacobian matrix of the residual w.r.t. the solution
+     *        at the beginning of the time step.
+     *
+     * If the EnableAdjointLinearization property is set, this matrix is allocated
+     * together with matrix() and assembled by each call to linearize(). Otherwise, it is
+     * only created when this method is called for the first time after the sparsity
+     * pattern was determined. It exhibits the same sparsity pattern as matrix().
+     */
     Matrix& matrixA()
-    { return *matrixA_; }
-
-
+    {
+        if (!matrixA_)
+            createMatrixA_();
+        return *matrixA_;
+    }
 
     /*!
      * \brief Return constant reference to global residual vector.
@@ -234,19 +365,124 @@ public:
     GlobalEqVector& residual()
     { return residual_; }
 
+    /*!
+     * \brief Returns true iff residual() is the residual of the current solution of the
+     *        model as evaluated by the last linearization.
+     *
+     * This is not the case anymore if the solution, the time or the time step size have
+     * changed since then, if the residual was determined w.r.t. a solution other than
+     * the most recent one or if only a part of the elements was relinearized. Note that
+     * modifications of the residual by its users are not detected.
+     */
+    bool residualIsCurrent() const
+    { return residualStamp_.valid && residualStamp_ == currentResidualStamp_(); }
+
+    /*!
+     * \brief Create the per-thread element contexts if they do not exist yet.
+     *
+     * This must be called outside of parallel regions before elementContext() is used.
+     */
+    void createElementContexts()
+    {
+        if (elementCtx_.empty())
+            elementCtx_.create(ThreadManager::maxThreads(), simulator_());
+    }
+
+    /*!
+     * \brief Returns the element context which is used by a thread for the
+     *        linearization.
+     *
+     * Other code which loops over the elements in parallel may use these contexts
+     * instead of constructing its own ones as long as the system is not linearized at
+     * the same time (cf. createElementContexts()).
+     */
+    ElementContext& elementContext(unsigned threadId)
+    { return elementCtx_[threadId]; }
+
+    /*!
+     * \brief Returns the off-diagonal couplings of the unknowns which the auxiliary
+     *        modules have eliminated from the linear system of equations.
+     *
+     * The object is emptied at the beginning of each linearization of the Jacobian
+     * matrix and filled by the auxiliary modules. Its row indices are the global
+     * indices of the degrees of freedom. The couplings must be applied on top of
+     * matrix() by the linear solver.
+     */
+    const SchurCorrection& schurCorrection() const
+    { return schurCorrection_; }
+
+    SchurCorrection& schurCorrection()
+    { return schurCorrection_; }
+
     const GlobalEqVector& constresidualA()
-    { return residualA_; }
+    { return residualA(); }
 
     GlobalEqVector& residualA()
-    { return residualA_; }
+    {
+        if (residualA_.size() != residual_.size()) {
+            residualA_.resize(residual_.size());
+            residualA_ = 0;
+            updateMemoryUsage_();
+        }
+        return residualA_;
+    }
+
+    /*!
+     * \brief Specify the solution of the time discretization w.r.t. which the residual
+     *        is linearized.
+     *
+     * By default, the Jacobian is the derivative of the residual w.r.t. the most recent
+     * solution (time index 0). Changing this causes the subsequent calls to linearize()
+     * to produce the derivatives w.r.t. the given time index instead.
+     */
+    void setLinearizationType(const LinearizationType& linearizationType)
+    { linearizationType_ = linearizationType; }
+
+    /*!
+     * \brief Returns the solution of the time discretization w.r.t. which the residual
+     *        is linearized.
+     */
+    const LinearizationType& getLinearizationType() const
+    { return linearizationType_; }
+
+    /*!
+     * \brief Returns the constraint degrees of freedom and their constraints.
+     *
+     * The entries are sorted by the global index of the degree of freedom. (This
+     * object is only non-empty if the EnableConstraints property is true.)
+     */
+    const std::vector<std::pair<unsigned, Constraints> >& constraintDofs() const
+    { return constraintDofs_; }
+
+    /*!
+     * \brief Returns true iff a degree of freedom is constraint.
+     *
+     * This is a constant-time operation which is safe to be called concurrently.
+     */
+    bool isConstraintDof(unsigned dofIdx) const
+    { return dofIdx < constraintIdx_.size() && constraintIdx_[dofIdx] >= 0; }
 
     /*!
-     * \brief Returns the map of constraint degrees of freedom.
+     * \brief Returns the constraints of a constraint degree of freedom.
      *
-     * (This object is only non-empty if the EnableConstraints property is true.)
+     * This is a constant-time operation which is safe to be called concurrently. The
+     * degree of freedom must be constraint, cf. isConstraintDof().
      */
-    const std::map<unsigned, Constraints>& constraintsMap() const
-    { return constraintsMap_; }
+    const Constraints& constraints(unsigned dofIdx) const
+    {
+        assert(isConstraintDof(dofIdx));
+        return constraintDofs_[static_cast<unsigned>(constraintIdx_[dofIdx])].second;
+    }
+
+    /*!
+     * \brief Returns the number of elements which were linearized by the last call to
+     *        linearize() on the current process.
+     *
+     * Unless the ActiveSetLinearizationTolerance parameter is set, this is the number of
+     * elements which are linearized by the process.
+     */
+    size_t numRelinearizedElements() const
+    { return numRelinearizedElements_; }
 
 private:
     Simulator& simulator_()
@@ -283,94 +519,498 @@ private:
         residual_.resize(model_().numTotalDof());
         residual_ = 0;
 
-        residualA_.resize(model_().numTotalDof());
-        residualA_ = 0;
+        resizeResidualA_();
+
+        updateMemoryUsage_();
 
-        // create the per-thread context objects
-        elementCtx_.resize(ThreadManager::maxThreads());
-        for (unsigned threadId = 0; threadId != ThreadManager::maxThreads(); ++ threadId)
-            elementCtx_[threadId] = new ElementContext(simulator_());
+        // create the per-thread context objects. (these do not depend on the sparsity
+        // pattern, so they are only created once.) each context is allocated by the
+        // thread which uses it, so that it resides in the thread's local memory.
+        createElementContexts();
+    }
+
+    // the residual w.r.t. the solution at the beginning of the time step is only kept
+    // for the adjoint linearization. otherwise, it is allocated by residualA() if somebody
+    // asks for it.
+    void resizeResidualA_()
+    {
+        if (enableAdjointLinearization || residualA_.size() > 0) {
+            residualA_.resize(residual_.size());
+            residualA_ = 0;
+        }
+    }
+
+    // lazily create the Jacobian w.r.t. the solution at the beginning of the time step.
+    // it exhibits the same sparsity pattern as the one of the Newton method, so the
+    // pattern of the latter is copied.
+    void createMatrixA_()
+    {
+        if (!matrix_)
+            OPM_THROW(std::logic_error,
+                      "The sparsity pattern must be determined before matrixA() can be used");
+
+        matrixA_ = new Matrix(*matrix_);
+        *matrixA_ = 0;
+        updateMemoryUsage_();
+    }
+
+    // report the memory used by the matrices and residuals to the memory accounting
+    void updateMemoryUsage_()
+    {
+        size_t numBytes = memoryUsage(residual_) + memoryUsage(residualA_);
+        if (matrix_)
+            numBytes += memoryUsage(*matrix_);
+        if (matrixA_)
+            numBytes += memoryUsage(*matrixA_);
+        linearizationMemory_.set(numBytes);
+    }
+
+    // update the sparsity pattern after the auxiliary modules have changed
+    void updateAuxiliaryPattern_()
+    {
+        auxPatternIsDirty_ = false;
+
+        std::map<unsigned, NeighborSet> auxRows;
+        collectAuxiliaryNeighbors_(auxRows);
+
+        size_t numAllDof = model_().numTotalDof();
+        if (matrix_->N() == numAllDof && auxPatternMatches_(auxRows))
+            // nothing to do: the matrices can be reused as they are
+            return;
+
+        delete matrix_;
+        delete matrixA_;
+        allocateMatrix_(auxRows);
+
+        *matrix_ = 0;
+        residual_.resize(numAllDof);
+        residual_ = 0;
+
+        resizeResidualA_();
+
+        updateMemoryUsage_();
+
+        // the linear solver must not reuse anything which depends on the old pattern
+        model_().newtonMethod().eraseMatrix();
+    }
+
+    // returns true if the rows of the current matrix which are or were affected by the
+    // auxiliary equations exhibit the given pattern
+    bool auxPatternMatches_(const std::map<unsigned, NeighborSet>& auxRows) const
+    {
+        // the rows which are touched by the new auxiliary equations
+        auto auxIt = auxRows.begin();
+        const auto& auxEndIt = auxRows.end();
+        for (; auxIt != auxEndIt; ++auxIt) {
+            const auto& row = (*matrix_)[auxIt->first];
+            if (row.size() != auxIt->second.size())
+                return false;
+
+            auto colIt = row.begin();
+            auto nIt = auxIt->second.begin();
+            for (; colIt != row.end(); ++colIt, ++nIt)
+                if (colIt.index() != *nIt)
+                    return false;
+        }
+
+        // the rows which were touched by the old auxiliary equations but are not
+        // anymore must exhibit the pattern of the grid
+        size_t numGridDof = gridRowSize_.size();
+        for (unsigned i = 0; i < auxRowIndices_.size(); ++i) {
+            unsigned rowIdx = auxRowIndices_[i];
+            if (auxRows.count(rowIdx) > 0)
+                continue;
+
+            const auto& row = (*matrix_)[rowIdx];
+            if (rowIdx >= numGridDof) {
+                if (row.size() != 0)
+                    return false;
+                continue;
+            }
+
+            if (row.size() != gridRowSize_[rowIdx])
+                return false;
+
+            const unsigned* gridRow = gridNeighbors_.data() + gridRowOffset_[rowIdx];
+            auto colIt = row.begin();
+            for (unsigned j = 0; colIt != row.end(); ++colIt, ++j)
+                if (colIt.index() != gridRow[j])
+                    return false;
+        }
+
+        return true;
     }
 
     // Construct the BCRS matrix for the Jacobian of the residual function
     void createMatrix_()
     {
-        size_t numAllDof =  model_().numTotalDof();
+        EWOMS_PROFILE_REGION("createMatrix_");
 
-        // allocate raw matrix
-        matrix_ = new Matrix(numAllDof, numAllDof, Matrix::random);
-        matrixA_ = new Matrix(numAllDof, numAllDof, Matrix::random);
+        if (gridRowOffset_.empty()) {
+            createGridPattern_();
 
-        Stencil stencil(gridView_(), model_().dofMapper() );
+            if (useLinearizationColoring)
+                colorElements_();
+        }
 
-        // for the main model, find out the global indices of the neighboring degrees of
-        // freedom of each primary degree of freedom
-        typedef std::set<unsigned> NeighborSet;
-        std::vector<NeighborSet> neighbors(numAllDof);
-        ElementIterator elemIt = gridView_().template begin<0>();
-        const ElementIterator elemEndIt = gridView_().template end<0>();
-        for (; elemIt != elemEndIt; ++elemIt) {
-            const Element& elem = *elemIt;
-            stencil.update(elem);
+        std::map<unsigned, NeighborSet> auxRows;
+        collectAuxiliaryNeighbors_(auxRows);
 
-            for (unsigned primaryDofIdx = 0; primaryDofIdx < stencil.numPrimaryDof(); ++primaryDofIdx) {
-                unsigned myIdx = stencil.globalSpaceIndex(primaryDofIdx);
+        allocateMatrix_(auxRows);
+    }
+
+    // for the main model, find out the global indices of the neighboring degrees of
+    // freedom of each primary degree of freedom. this is done in two passes over the
+    // grid: the first one determines an upper bound of the number of neighbors of each
+    // degree of freedom and the second one fills the flat array of neighbor indices. the
+    // rows of the latter are then sorted and duplicates are removed.
+    //
+    // the result is kept until the grid changes, so that changes of the auxiliary
+    // equations do not require to walk the grid again.
+    void createGridPattern_()
+    {
+        // for element-centered face-neighbor stencils on Cartesian grids, the pattern
+        // follows from the indices of the elements
+        static const bool mayUseCartesianPattern =
+            std::is_same<DofMapper, ElementMapper>::value
+            && StencilIsFaceNeighborhood<Stencil>::value;
+        if (mayUseCartesianPattern
+            && CartesianGridPattern<typename GridView::Grid>::create(gridView_(),
+                                                                     gridRowOffset_,
+                                                                     gridRowSize_,
+                                                                     gridNeighbors_))
+            return;
+
+        size_t numGridDof = model_().numGridDof();
+
+        const auto& grid = gridView_().grid();
+        const auto& elemSeeds = model_().elementSeeds();
+        int numElems = static_cast<int>(elemSeeds.size());
+
+        gridRowOffset_.assign(numGridDof + 1, 0);
+        gridRowSize_.assign(numGridDof, 0);
+        gridNeighbors_.clear();
+        for (unsigned pass = 0; pass < 2; ++ pass) {
+            if (pass == 1) {
+                for (unsigned dofIdx = 0; dofIdx < numGridDof; ++ dofIdx)
+                    gridRowOffset_[dofIdx + 1] = gridRowOffset_[dofIdx] + gridRowSize_[dofIdx];
+                gridNeighbors_.resize(gridRowOffset_[numGridDof]);
+                std::fill(gridRowSize_.begin(), gridRowSize_.end(), 0);
+            }
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+            {
+                Stencil stencil(gridView_(), model_().dofMapper() );
 
-                for (unsigned dofIdx = 0; dofIdx < stencil.numDof(); ++dofIdx) {
-                    unsigned neighborIdx = stencil.globalSpaceIndex(dofIdx);
-                    neighbors[myIdx].insert(neighborIdx);
+#ifdef _OPENMP
+#pragma omp for
+#endif
+                for (int elemIdx = 0; elemIdx < numElems; ++elemIdx) {
+#if DUNE_VERSION_NEWER(DUNE_GRID, 2, 4)
+                    const Element& elem = grid.entity(elemSeeds[elemIdx]);
+#else
+                    const auto& elemPtr = grid.entity(elemSeeds[elemIdx]);
+                    const Element& elem = *elemPtr;
+#endif
+                    stencil.update(elem);
+
+                    unsigned numDof = stencil.numDof();
+                    for (unsigned primaryDofIdx = 0; primaryDofIdx < stencil.numPrimaryDof(); ++primaryDofIdx) {
+                        unsigned myIdx = stencil.globalSpaceIndex(primaryDofIdx);
+
+                        unsigned pos;
+#ifdef _OPENMP
+#pragma omp atomic capture
+#endif
+                        { pos = gridRowSize_[myIdx]; gridRowSize_[myIdx] += numDof; }
+
+                        if (pass == 0)
+                            continue;
+
+                        unsigned* dest = &gridNeighbors_[gridRowOffset_[myIdx] + pos];
+                        for (unsigned dofIdx = 0; dofIdx < numDof; ++dofIdx)
+                            dest[dofIdx] = stencil.globalSpaceIndex(dofIdx);
+                    }
                 }
             }
         }
 
-        // add the additional neighbors and degrees of freedom caused by the auxiliary
-        // equations
+        int numRows = static_cast<int>(numGridDof);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+        for (int dofIdx = 0; dofIdx < numRows; ++ dofIdx) {
+            auto rowBegin = gridNeighbors_.begin() + gridRowOffset_[dofIdx];
+            auto rowEnd = rowBegin + gridRowSize_[dofIdx];
+            std::sort(rowBegin, rowEnd);
+            gridRowSize_[dofIdx] = static_cast<unsigned>(std::unique(rowBegin, rowEnd) - rowBegin);
+        }
+    }
+
+    // determine the rows of the matrix which are affected by the auxiliary equations,
+    // including the neighbors of the grid. since the auxiliary modules usually only
+    // affect few degrees of freedom, these rows are stored separately.
+    void collectAuxiliaryNeighbors_(std::map<unsigned, NeighborSet>& auxRows) const
+    {
+        auxRows.clear();
+
         const auto& model = model_();
         size_t numAuxMod = model.numAuxiliaryModules();
+        if (numAuxMod == 0)
+            return;
+
+        std::vector<NeighborSet> auxNeighbors(model.numTotalDof());
         for (unsigned auxModIdx = 0; auxModIdx < numAuxMod; ++auxModIdx)
-            model.auxiliaryModule(auxModIdx)->addNeighbors(neighbors);
+            model.auxiliaryModule(auxModIdx)->addNeighbors(auxNeighbors);
+
+        for (unsigned dofIdx = 0; dofIdx < auxNeighbors.size(); ++ dofIdx) {
+            auto& auxRow = auxNeighbors[dofIdx];
+            if (auxRow.empty())
+                continue;
+
+            if (dofIdx < gridRowSize_.size()) {
+                auto rowBegin = gridNeighbors_.begin() + gridRowOffset_[dofIdx];
+                auxRow.insert(rowBegin, rowBegin + gridRowSize_[dofIdx]);
+            }
+            auxRows[dofIdx].swap(auxRow);
+        }
+    }
+
+    // allocate the matrices given the pattern of the grid and the rows affected by the
+    // auxiliary equations
+    void allocateMatrix_(const std::map<unsigned, NeighborSet>& auxRows)
+    {
+        size_t numAllDof =  model_().numTotalDof();
+        size_t numGridDof = gridRowSize_.size();
+
+        // allocate raw matrix
+        matrix_ = new Matrix(numAllDof, numAllDof, Matrix::random);
 
         // allocate space for the rows of the matrix
-        for (unsigned dofIdx = 0; dofIdx < numAllDof; ++ dofIdx){
-            matrix_->setrowsize(dofIdx, neighbors[dofIdx].size());
-            matrixA_->setrowsize(dofIdx, neighbors[dofIdx].size());
+        for (unsigned dofIdx = 0; dofIdx < numAllDof; ++ dofIdx) {
+            auto auxIt = auxRows.find(dofIdx);
+            if (auxIt != auxRows.end())
+                matrix_->setrowsize(dofIdx, auxIt->second.size());
+            else if (dofIdx < numGridDof)
+                matrix_->setrowsize(dofIdx, gridRowSize_[dofIdx]);
+            else
+                matrix_->setrowsize(dofIdx, 0);
         }
         matrix_->endrowsizes();
-        matrixA_->endrowsizes();
 
         // fill the rows with indices. each degree of freedom talks to
         // all of its neighbors. (it also talks to itself since
         // degrees of freedom are sometimes quite egocentric.)
         for (unsigned dofIdx = 0; dofIdx < numAllDof; ++ dofIdx) {
-            typename NeighborSet::iterator nIt = neighbors[dofIdx].begin();
-            typename NeighborSet::iterator nEndIt = neighbors[dofIdx].end();
-            for (; nIt != nEndIt; ++nIt){
-                matrix_->addindex(dofIdx, *nIt);
-                matrixA_->addindex(dofIdx, *nIt);
+            auto auxIt = auxRows.find(dofIdx);
+            if (auxIt != auxRows.end()) {
+                typename NeighborSet::const_iterator nIt = auxIt->second.begin();
+                typename NeighborSet::const_iterator nEndIt = auxIt->second.end();
+                for (; nIt != nEndIt; ++nIt)
+                    matrix_->addindex(dofIdx, *nIt);
+            }
+            else if (dofIdx < numGridDof) {
+                const unsigned* rowBegin = gridNeighbors_.data() + gridRowOffset_[dofIdx];
+                for (unsigned i = 0; i < gridRowSize_[dofIdx]; ++i)
+                    matrix_->addindex(dofIdx, rowBegin[i]);
             }
         }
         matrix_->endindices();
-        matrixA_->endindices();
 
+        // remember which rows have been modified by the auxiliary equations
+        auxRowIndices_.clear();
+        auto auxIt = auxRows.begin();
+        const auto& auxEndIt = auxRows.end();
+        for (; auxIt != auxEndIt; ++auxIt)
+            auxRowIndices_.push_back(auxIt->first);
+
+        // the Jacobian w.r.t. the solution at the beginning of the time step exhibits
+        // the same sparsity pattern, so we do not need to determine it again. it is
+        // only needed up front by the adjoint linearization; otherwise matrixA() creates
+        // it when it is asked for the first time.
+        matrixA_ = 0;
+        if (enableAdjointLinearization)
+            createMatrixA_();
+    }
+
+    // partition the elements into sets which do not share any primary degree of
+    // freedom. since an element only writes to the residual and the Jacobian columns of
+    // its primary degrees of freedom, the elements of a color can be linearized
+    // concurrently without a lock
+    void colorElements_()
+    {
+        elementColors_.clear();
+
+        Stencil stencil(gridView_(), model_().dofMapper() );
+
+        // the colors of the elements which have already been looked at for each degree
+        // of freedom
+        std::vector<std::vector<unsigned> > dofColors(model_().numGridDof());
+        std::vector<bool> colorIsUsed;
+
+        ElementIterator elemIt = gridView_().template begin<0>();
+        const ElementIterator elemEndIt = gridView_().template end<0>();
+        for (; elemIt != elemEndIt; ++elemIt) {
+            const Element& elem = *elemIt;
+            if (!linearizeNonLocalElements && elem.partitionType() != Dune::InteriorEntity)
+                continue;
+
+            stencil.update(elem);
+
+            // greedily pick the first color which is not used by any neighbor
+            colorIsUsed.assign(elementColors_.size(), false);
+            for (unsigned primaryDofIdx = 0; primaryDofIdx < stencil.numPrimaryDof(); ++primaryDofIdx) {
+                unsigned globI = stencil.globalSpaceIndex(primaryDofIdx);
+                for (unsigned colorIdx : dofColors[globI])
+                    colorIsUsed[colorIdx] = true;
+            }
+
+            unsigned colorIdx = 0;
+            while (colorIdx < colorIsUsed.size() && colorIsUsed[colorIdx])
+                ++ colorIdx;
+            if (colorIdx == elementColors_.size())
+                elementColors_.resize(colorIdx + 1);
+
+            elementColors_[colorIdx].push_back(elem.seed());
+            for (unsigned primaryDofIdx = 0; primaryDofIdx < stencil.numPrimaryDof(); ++primaryDofIdx) {
+                unsigned globI = stencil.globalSpaceIndex(primaryDofIdx);
+                dofColors[globI].push_back(colorIdx);
+            }
+        }
+    }
+
+    // linearize the system on all processes and make sure that all of them succeeded
+    void linearizeGlobal_(bool residualOnly)
+    {
+        // we defer the initialization of the Jacobian matrix until here because the
+        // auxiliary modules usually assume the problem, model and grid to be fully
+        // initialized...
+        if (!matrix_)
+            initFirstIteration_();
+        else if (auxPatternIsDirty_)
+            updateAuxiliaryPattern_();
+
+        residualStamp_.valid = false;
+
+        int succeeded;
+        try {
+            linearize_(residualOnly);
+            succeeded = 1;
+        }
+        catch (const std::exception& e)
+        {
+            std::cout << "rank " << simulator_().gridView().comm().rank()
+                      << " caught an exception while linearizing:" << e.what()
+                      << "\n"  << std::flush;
+            succeeded = 0;
+        }
+#if ! DUNE_VERSION_NEWER(DUNE_COMMON, 2, 5)
+        catch (const Dune::Exception& e)
+        {
+            std::cout << "rank " << simulator_().gridView().comm().rank()
+                      << " caught an exception while linearizing:" << e.what()
+                      << "\n"  << std::flush;
+            succeeded = 0;
+        }
+#endif
+        catch (...)
+        {
+            std::cout << "rank " << simulator_().gridView().comm().rank()
+                      << " caught an exception while linearizing"
+                      << "\n"  << std::flush;
+            succeeded = 0;
+        }
+
+        {
+            CollectiveWaitTimer waitTimer("linearize");
+            succeeded = gridView_().comm().min(succeeded);
+        }
+
+        if (!succeeded) {
+            OPM_THROW(Opm::NumericalProblem,
+                       "A process did not succeed in linearizing the system");
+        }
+
+        // the elements which are not relinearized only contribute an approximation of
+        // their residual if the active set is used
+        residualStamp_ = currentResidualStamp_();
+        residualStamp_.valid = !useActiveSet_ && linearizationType_.time == 0;
+    }
+
+    // identifies the state of the model for which the residual was evaluated
+    struct ResidualStamp_
+    {
+        ResidualStamp_()
+            : valid(false)
+            , time(0.0)
+            , timeStepSize(0.0)
+            , solutionHash(0)
+        { }
+
+        bool operator==(const ResidualStamp_& other) const
+        {
+            return
+                time == other.time
+                && timeStepSize == other.timeStepSize
+                && solutionHash == other.solutionHash;
+        }
+
+        bool valid;
+        Scalar time;
+        Scalar timeStepSize;
+        uint64_t solutionHash;
+    };
+
+    // hashing the current solution is much cheaper than evaluating the residual again
+    ResidualStamp_ currentResidualStamp_() const
+    {
+        ResidualStamp_ stamp;
+        stamp.valid = true;
+        stamp.time = simulator_().time();
+        stamp.timeStepSize = simulator_().timeStepSize();
+
+        // FNV-1a hash of the primary variables
+        const auto& solution = model_().solution(/*timeIdx=*/0);
+        uint64_t hash = 14695981039346656037ULL;
+        for (unsigned dofIdx = 0; dofIdx < solution.size(); ++dofIdx) {
+            for (unsigned pvIdx = 0; pvIdx < numEq; ++pvIdx) {
+                double value = solution[dofIdx][pvIdx];
+                uint64_t bits;
+                std::memcpy(&bits, &value, sizeof(bits));
+                hash = (hash ^ bits)*1099511628211ULL;
+            }
+        }
+        stamp.solutionHash = hash;
+
+        return stamp;
     }
 
     // reset the global linear system of equations.
-    void resetSystem_()
+    void resetSystem_(bool residualOnly)
     {
         residual_ = 0.0;
+        if (residualOnly)
+            return;
+
         (*matrix_) = 0;
+        if (enableAdjointLinearization)
+            (*matrixA_) = 0;
     }
 
     // query the problem for all constraint degrees of freedom. note that this method is
     // quite involved and is thus relatively slow.
-    void updateConstraintsMap_()
+    void updateConstraintDofs_()
     {
         if (!enableConstraints_())
             // constraints are not explictly enabled, so we don't need to consider them!
             return;
 
-        unsigned threadId = ThreadManager::threadId();
-        constraintsMap_.clear();
+        // each thread collects the constraints which it finds in a buffer of its own.
+        // these are merged afterwards.
+        std::vector<std::vector<std::pair<unsigned, Constraints> > >
+            threadConstraintDofs(ThreadManager::maxThreads());
 
         // loop over all elements...
         ThreadedEntityIterator<GridView, /*codim=*/0> threadedElemIt(gridView_());
@@ -378,16 +1018,18 @@ private:
 #pragma omp parallel
 #endif
         {
+            unsigned threadId = ThreadManager::threadId();
+            auto& localConstraintDofs = threadConstraintDofs[threadId];
             ElementIterator elemIt = threadedElemIt.beginParallel();
             for (; !threadedElemIt.isFinished(elemIt); elemIt = threadedElemIt.increment()) {
                 // create an element context (the solution-based quantities are not
                 // available here!)
                 const Element& elem = *elemIt;
-                ElementContext& elemCtx = *elementCtx_[threadId];
+                ElementContext& elemCtx = elementCtx_[threadId];
                 elemCtx.updateStencil(elem);
 
                 // check if the problem wants to constrain any degree of the current
-                // element's freedom. if yes, add the constraint to the map.
+                // element's freedom. if yes, add the constraint to the buffer.
                 for (unsigned primaryDofIdx = 0;
                      primaryDofIdx < elemCtx.numPrimaryDof(/*timeIdx=*/0);
                      ++ primaryDofIdx)
@@ -399,112 +1041,595 @@ private:
                                                   /*timeIdx=*/0);
                     if (constraints.isActive()) {
                         unsigned globI = elemCtx.globalSpaceIndex(primaryDofIdx, /*timeIdx=*/0);
-                        constraintsMap_[globI] = constraints;
-                        continue;
+                        localConstraintDofs.push_back(std::make_pair(globI, constraints));
                     }
                 }
             }
         }
+
+        constraintDofs_.clear();
+        for (const auto& localConstraintDofs : threadConstraintDofs)
+            constraintDofs_.insert(constraintDofs_.end(),
+                                   localConstraintDofs.begin(),
+                                   localConstraintDofs.end());
+
+        // degrees of freedom which are shared by multiple elements may have been found
+        // more than once
+        std::stable_sort(constraintDofs_.begin(), constraintDofs_.end(),
+                         [](const std::pair<unsigned, Constraints>& a,
+                            const std::pair<unsigned, Constraints>& b)
+                         { return a.first < b.first; });
+        auto uniqueEndIt =
+            std::unique(constraintDofs_.begin(), constraintDofs_.end(),
+                        [](const std::pair<unsigned, Constraints>& a,
+                           const std::pair<unsigned, Constraints>& b)
+                        { return a.first == b.first; });
+        constraintDofs_.erase(uniqueEndIt, constraintDofs_.end());
+
+        constraintIdx_.assign(model_().numTotalDof(), -1);
+        for (size_t i = 0; i < constraintDofs_.size(); ++i)
+            constraintIdx_[constraintDofs_[i].first] = static_cast<int>(i);
     }
 
-    // linearize the whole system
-    void linearize_()
+    // linearize the whole system. if only the residual is requested, the Jacobian
+    // matrix is left alone except for the contributions of the auxiliary modules.
+    void linearize_(bool residualOnly)
     {
-        resetSystem_();
+        EWOMS_PROFILE_REGION("linearize");
+
+        resetSystem_(residualOnly);
 
         // before the first iteration of each time step, we need to update the
         // constraints. (i.e., we assume that constraints can be time dependent, but they
-        // can't depend on the solution.)
-        if (model_().newtonMethod().numIterations() == 0)
-            updateConstraintsMap_();
+        // can't depend on the solution.) evaluating only the residual does not start a
+        // new time step, so the constraints of the last full linearization are used.
+        if (!residualOnly && model_().newtonMethod().numIterations() == 0)
+            updateConstraintDofs_();
 
         applyConstraintsToSolution_();
 
-        // relinearize the elements...
-        ThreadedEntityIterator<GridView, /*codim=*/0> threadedElemIt(gridView_());
+        // make sure that the cached storage terms of the last time step are available
+        model_().prepareStorageCache();
+
+        useActiveSet_ = !residualOnly && updateActiveSet_();
+        numRelinearizedElements_ = 0;
+
+        // if only a part of the elements is relinearized, computing the intensive
+        // quantities of all degrees of freedom in advance does not pay off
+        if (!useActiveSet_
+            && EWOMS_GET_PARAM(TypeTag, bool, EnableIntensiveQuantityCache)
+            && EWOMS_GET_PARAM(TypeTag, bool, PrecomputeIntensiveQuantities))
+            updateIntensiveQuantityCache_();
+
+        // relinearize the elements. the auxiliary modules do not depend on the
+        // linearization of the grid, so they can optionally be prepared at the same
+        // time. (the auxiliary equations do not exhibit storage terms, so they do not
+        // depend on the solution of a previous time level.)
+        bool linearizeAuxiliaryModules = linearizationType_.time == 0;
+        bool overlapAuxiliaryModules =
+            linearizeAuxiliaryModules
+            && !useLinearizationColoring
+            && model_().numAuxiliaryModules() > 0
+            && EWOMS_GET_PARAM(TypeTag, bool, OverlapAuxiliaryLinearization);
+        if (useLinearizationColoring)
+            linearizeColored_(residualOnly);
+        else if (overlapAuxiliaryModules)
+            linearizeOverlapped_(residualOnly);
+        else
+            linearizeThreaded_(residualOnly);
+
+        if (residualOnly)
+            applyConstraintsToResidual_();
+        else
+            applyConstraintsToLinearization_();
+
+        if (linearizeAuxiliaryModules)
+            linearizeAuxiliaryEquations_(residualOnly,
+                                         /*auxModulesPrepared=*/overlapAuxiliaryModules);
+    }
+
+    // for each degree of freedom, determine the first element which has it as one of its
+    // primary degrees of freedom
+    void determineDofOwners_()
+    {
+        const auto& grid = gridView_().grid();
+        const auto& elemSeeds = model_().elementSeeds();
+        int numElems = static_cast<int>(elemSeeds.size());
+
+        dofOwnerElement_.assign(model_().numGridDof(), -1);
+
+        Stencil stencil(gridView_(), model_().dofMapper() );
+        for (int elemIdx = 0; elemIdx < numElems; ++elemIdx) {
+#if DUNE_VERSION_NEWER(DUNE_GRID, 2, 4)
+            const Element& elem = grid.entity(elemSeeds[elemIdx]);
+#else
+            const auto& elemPtr = grid.entity(elemSeeds[elemIdx]);
+            const Element& elem = *elemPtr;
+#endif
+            stencil.update(elem);
+            for (unsigned primaryDofIdx = 0; primaryDofIdx < stencil.numPrimaryDof(); ++primaryDofIdx) {
+                unsigned globalIdx = stencil.globalSpaceIndex(primaryDofIdx);
+                if (dofOwnerElement_[globalIdx] < 0)
+                    dofOwnerElement_[globalIdx] = elemIdx;
+            }
+        }
+    }
+
+    // compute the intensive quantities of all degrees of freedom for the most recent
+    // solution and store them in the cache of the model. since each degree of freedom is
+    // handled by exactly one element, no work is duplicated and no cache entry is written
+    // by more than a single thread. the linearization of the elements then only needs to
+    // read the cache.
+    void updateIntensiveQuantityCache_()
+    {
+        EWOMS_PROFILE_REGION("updateIntensiveQuantityCache");
+
+        if (dofOwnerElement_.empty())
+            determineDofOwners_();
+
+        const auto& grid = gridView_().grid();
+        const auto& elemSeeds = model_().elementSeeds();
+        int numElems = static_cast<int>(elemSeeds.size());
+#ifdef _OPENMP
+#pragma omp parallel for schedule(guided)
+#endif
+        for (int elemIdx = 0; elemIdx < numElems; ++elemIdx) {
+#if DUNE_VERSION_NEWER(DUNE_GRID, 2, 4)
+            const Element& elem = grid.entity(elemSeeds[elemIdx]);
+#else
+            const auto& elemPtr = grid.entity(elemSeeds[elemIdx]);
+            const Element& elem = *elemPtr;
+#endif
+            unsigned threadId = ThreadManager::threadId();
+            ElementContext& elemCtx = elementCtx_[threadId];
+            elemCtx.updateStencil(elem);
+
+            unsigned numPrimaryDof = elemCtx.numPrimaryDof(/*timeIdx=*/0);
+            for (unsigned primaryDofIdx = 0; primaryDofIdx < numPrimaryDof; ++primaryDofIdx) {
+                unsigned globalIdx = elemCtx.globalSpaceIndex(primaryDofIdx, /*timeIdx=*/0);
+                if (dofOwnerElement_[globalIdx] == elemIdx)
+                    elemCtx.updateDofIntensiveQuantities(primaryDofIdx, /*timeIdx=*/0);
+            }
+        }
+    }
+
+    // linearize the elements using a plain OpenMP loop over the flat list of elements
+    void linearizeThreaded_(bool residualOnly)
+    {
+        int numElems = static_cast<int>(model_().elementSeeds().size());
+#ifdef _OPENMP
+#pragma omp parallel for schedule(guided)
+#endif
+        for (int elemIdx = 0; elemIdx < numElems; ++elemIdx)
+            linearizeFlatElement_(elemIdx, residualOnly);
+    }
+
+    // linearize the elements and prepare the linearization of the auxiliary modules
+    // within the same parallel region. the threads which are done with the auxiliary
+    // modules do not wait for the others but immediately continue with the elements.
+    // since exceptions must not leave a parallel region, the first one is re-thrown
+    // afterwards.
+    void linearizeOverlapped_(bool residualOnly)
+    {
+        EWOMS_PROFILE_REGION("linearizeOverlapped");
+
+        auto& model = model_();
+        int numElems = static_cast<int>(model.elementSeeds().size());
+        int numAuxMods = static_cast<int>(model.numAuxiliaryModules());
+        std::exception_ptr exception;
 #ifdef _OPENMP
 #pragma omp parallel
 #endif
         {
-            ElementIterator elemIt = threadedElemIt.beginParallel();
-            ElementIterator nextElemIt = elemIt;
-            for (; !threadedElemIt.isFinished(elemIt); elemIt = nextElemIt) {
-                // give the model and the problem a chance to prefetch the data required
-                // to linearize the next element, but only if we need to consider it
-                nextElemIt = threadedElemIt.increment();
-                if (!threadedElemIt.isFinished(nextElemIt)) {
-                    const auto& nextElem = *nextElemIt;
-                    if (linearizeNonLocalElements
-                        || nextElem.partitionType() == Dune::InteriorEntity)
-                    {
-                        model_().prefetch(nextElem);
-                        problem_().prefetch(nextElem);
-                    }
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic) nowait
+#endif
+            for (int i = 0; i < numAuxMods; ++i)
+                prepareAuxiliaryModule_(static_cast<unsigned>(i), residualOnly, exception);
+
+#ifdef _OPENMP
+#pragma omp for schedule(guided)
+#endif
+            for (int elemIdx = 0; elemIdx < numElems; ++elemIdx) {
+                try {
+                    linearizeFlatElement_(elemIdx, residualOnly);
+                }
+                catch (...) {
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+                    if (!exception)
+                        exception = std::current_exception();
                 }
+            }
+        }
+        if (exception)
+            std::rethrow_exception(exception);
+    }
 
-                const Element& elem = *elemIt;
-                if (!linearizeNonLocalElements && elem.partitionType() != Dune::InteriorEntity)
-                    continue;
+    // linearize an element of the flat list of elements of the model
+    void linearizeFlatElement_(int elemIdx, bool residualOnly)
+    {
+        const auto& grid = gridView_().grid();
+        const auto& elemSeeds = model_().elementSeeds();
+        int numElems = static_cast<int>(elemSeeds.size());
+#if DUNE_VERSION_NEWER(DUNE_GRID, 2, 4)
+        const Element& elem = grid.entity(elemSeeds[elemIdx]);
+#else
+        const auto& elemPtr = grid.entity(elemSeeds[elemIdx]);
+        const Element& elem = *elemPtr;
+#endif
+        if (!linearizeNonLocalElements && elem.partitionType() != Dune::InteriorEntity)
+            return;
+
+        // give the model and the problem a chance to prefetch the data required
+        // to linearize the next element
+        if (elemIdx + 1 < numElems) {
+#if DUNE_VERSION_NEWER(DUNE_GRID, 2, 4)
+            const Element& nextElem = grid.entity(elemSeeds[elemIdx + 1]);
+#else
+            const auto& nextElemPtr = grid.entity(elemSeeds[elemIdx + 1]);
+            const Element& nextElem = *nextElemPtr;
+#endif
+            if (linearizeNonLocalElements
+                || nextElem.partitionType() == Dune::InteriorEntity)
+            {
+                model_().prefetch(nextElem);
+                problem_().prefetch(nextElem);
+            }
+        }
+
+        linearizeElement_(elem, residualOnly);
+    }
 
-                linearizeElement_(elem);
+    // linearize the elements color by color. the elements of each color are handled by
+    // all threads in parallel.
+    void linearizeColored_(bool residualOnly)
+    {
+        const auto& grid = gridView_().grid();
+        for (unsigned colorIdx = 0; colorIdx < elementColors_.size(); ++colorIdx) {
+            const auto& elemSeeds = elementColors_[colorIdx];
+            int numElems = static_cast<int>(elemSeeds.size());
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+            for (int i = 0; i < numElems; ++i) {
+#if DUNE_VERSION_NEWER(DUNE_GRID, 2, 4)
+                const Element& elem = grid.entity(elemSeeds[i]);
+#else
+                const auto& elemPtr = grid.entity(elemSeeds[i]);
+                const Element& elem = *elemPtr;
+#endif
+                linearizeElement_(elem, residualOnly);
             }
         }
+    }
 
-        applyConstraintsToLinearization_();
+    // update the element context for the linearization of an element.
+    //
+    // if the residual is linearized w.r.t. the solution of a previous time level, the
+    // local residual only consists of the storage terms of that level (cf.
+    // FvBaseLocalResidual::eval()). these only require the intensive quantities of the
+    // element's primary degrees of freedom for the differentiated level, so neither the
+    // intensive quantities of the other levels nor any extensive quantities are
+    // computed.
+    void updateElementContext_(ElementContext& elemCtx, const Element& elem) const
+    {
+        unsigned linTimeIdx = linearizationType_.time;
+        if (linTimeIdx == 0) {
+            elemCtx.updateAll(elem);
+            return;
+        }
 
-        linearizeAuxiliaryEquations_();
+        elemCtx.updateStencil(elem);
+        elemCtx.updatePrimaryIntensiveQuantities(linTimeIdx);
     }
 
     // linearize an element in the interior of the process' grid partition
-    void linearizeElement_(const Element& elem)
+    void linearizeElement_(const Element& elem, bool residualOnly)
     {
         unsigned threadId = ThreadManager::threadId();
 
-        ElementContext *elementCtx = elementCtx_[threadId];
-        auto& localLinearizer = model_().localLinearizer(threadId);
+        ElementContext& elemCtx = elementCtx_[threadId];
+        ElementLinearization_* elemLinearization = nullptr;
+
+        // the model only caches the storage terms of the previous time steps, so the
+        // cache cannot be used if the residual is linearized w.r.t. one of them
+        elemCtx.setEnableStorageCache(model_().enableStorageCache()
+                                      && linearizationType_.time == 0);
+        if (useActiveSet_) {
+            // if none of the degrees of freedom of the element's stencil has changed
+            // significantly, the element keeps its last contribution
+            elemCtx.updateStencil(elem);
+            elemLinearization = &elementLinearizations_[elementIndex_(elem)];
+            if (!elemLinearization->residual.empty() && !stencilIsActive_(elemCtx)) {
+                addElementLinearization_(elemCtx, *elemLinearization);
+                return;
+            }
+
+            EWOMS_PROFILE_REGION("updateAll");
+            elemCtx.updateAllIntensiveQuantities();
+            elemCtx.updateAllExtensiveQuantities();
+        }
+        else {
+            EWOMS_PROFILE_REGION("updateAll");
+            updateElementContext_(elemCtx, elem);
+        }
+
+        if (residualOnly) {
+            evalElementResidual_(elemCtx);
+            return;
+        }
+
+        // give the problem the chance to extract additional quantities while the
+        // element context is up to date
+        problem_().linearizeElement(elemCtx);
 
         // the actual work of linearization is done by the local linearizer class
-        elementCtx->updateAll(elem);
-        localLinearizer.linearize(*elementCtx);
+        auto& localLinearizer = model_().localLinearizer(threadId);
+        {
+            EWOMS_PROFILE_REGION("localLinearize");
+            localLinearizer.linearize(elemCtx);
+        }
 
-        // update the right hand side and the Jacobian matrix
-        if (GET_PROP_VALUE(TypeTag, UseLinearizationLock))
-            globalMatrixMutex_.lock();
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+        ++numRelinearizedElements_;
 
-        unsigned timeIdx = 0;
-        std::string wrtInitial = "";
-        std::ifstream inputFile;
-        inputFile.open("/home/joakimra/yesno.txt");
-        getline(inputFile, wrtInitial);
-        inputFile.close();
-        if (wrtInitial=="true"){
-            timeIdx = 1 ;
+        if (elemLinearization) {
+            storeElementLinearization_(elemCtx, localLinearizer, *elemLinearization);
+            addElementLinearization_(elemCtx, *elemLinearization);
+            return;
         }
 
-        size_t numPrimaryDof = elementCtx->numPrimaryDof(timeIdx);
+        // update the right hand side and the Jacobian matrix
+        if (useLinearizationLock)
+            globalMatrixMutex_.lock();
+
+        unsigned timeIdx = linearizationType_.time;
+        size_t numPrimaryDof = elemCtx.numPrimaryDof(timeIdx);
         for (unsigned primaryDofIdx = 0; primaryDofIdx < numPrimaryDof; ++ primaryDofIdx) {
-            unsigned globI = elementCtx->globalSpaceIndex(/*spaceIdx=*/primaryDofIdx, timeIdx);
+            unsigned globI = elemCtx.globalSpaceIndex(/*spaceIdx=*/primaryDofIdx, timeIdx);
 
             // update the right hand side
             residual_[globI] += localLinearizer.residual(primaryDofIdx);
 
             // update the global Jacobian matrix
-            for (unsigned dofIdx = 0; dofIdx < elementCtx->numDof(timeIdx); ++ dofIdx) {
-                unsigned globJ = elementCtx->globalSpaceIndex(/*spaceIdx=*/dofIdx, timeIdx);
+            for (unsigned dofIdx = 0; dofIdx < elemCtx.numDof(timeIdx); ++ dofIdx) {
+                unsigned globJ = elemCtx.globalSpaceIndex(/*spaceIdx=*/dofIdx, timeIdx);
 
                 (*matrix_)[globJ][globI] += localLinearizer.jacobian(dofIdx, primaryDofIdx);
             }
         }
 
-        if (GET_PROP_VALUE(TypeTag, UseLinearizationLock))
+        addAdjointJacobian_(elemCtx,
+                            localLinearizer,
+                            std::integral_constant<bool, enableAdjointLinearization>());
+
+        if (useLinearizationLock)
             globalMatrixMutex_.unlock();
     }
 
-    void linearizeAuxiliaryEquations_()
+    // the contribution of an element to the global system of equations at its last
+    // linearization. the Jacobian blocks are stored in the order (dofIdx, primaryDofIdx).
+    struct ElementLinearization_
+    {
+        std::vector<VectorBlock> residual;
+        std::vector<MatrixBlock> jacobian;
+    };
+
+    // determine the degrees of freedom which changed significantly since the last
+    // linearization. returns false if the active set cannot be used for the current
+    // linearization.
+    bool updateActiveSet_()
+    {
+        Scalar tolerance = EWOMS_GET_PARAM(TypeTag, Scalar, ActiveSetLinearizationTolerance);
+        if (tolerance <= 0.0 || enableAdjointLinearization || linearizationType_.time != 0)
+            return false;
+
+        const auto& solution = model_().solution(/*timeIdx=*/0);
+        size_t numGridDof = model_().numGridDof();
+
+        // the storage term depends on the time step size and on the solution of the last
+        // time step, so all elements need to be linearized at the first iteration of
+        // each time step
+        if (!activeSetIsValid_
+            || model_().newtonMethod().numIterations() == 0
+            || referenceSolution_.size() != solution.size())
+        {
+            referenceSolution_ = solution;
+            dofIsActive_.assign(numGridDof, 1);
+            elementLinearizations_.clear();
+            elementLinearizations_.resize(elementMapper_().size());
+            activeSetIsValid_ = true;
+            return true;
+        }
+
+        // the reference solution of a degree of freedom is the one for which all
+        // elements which contain it in their stencil have been linearized
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+        for (int i = 0; i < static_cast<int>(numGridDof); ++i) {
+            unsigned dofIdx = static_cast<unsigned>(i);
+            Scalar change = 0.0;
+            for (unsigned pvIdx = 0; pvIdx < numEq; ++pvIdx) {
+                Scalar delta = solution[dofIdx][pvIdx] - referenceSolution_[dofIdx][pvIdx];
+                change = std::max(change, std::abs(delta)*model_().primaryVarWeight(dofIdx, pvIdx));
+            }
+
+            dofIsActive_[dofIdx] = (change > tolerance)?1:0;
+            if (dofIsActive_[dofIdx])
+                referenceSolution_[dofIdx] = solution[dofIdx];
+        }
+
+        return true;
+    }
+
+    // returns true if any degree of freedom of the element's stencil has changed
+    // significantly since the last linearization
+    bool stencilIsActive_(const ElementContext& elemCtx) const
+    {
+        size_t numDof = elemCtx.numDof(/*timeIdx=*/0);
+        for (unsigned dofIdx = 0; dofIdx < numDof; ++ dofIdx) {
+            unsigned globJ = elemCtx.globalSpaceIndex(/*spaceIdx=*/dofIdx, /*timeIdx=*/0);
+            if (globJ >= dofIsActive_.size() || dofIsActive_[globJ])
+                return true;
+        }
+        return false;
+    }
+
+    size_t elementIndex_(const Element& elem) const
+    {
+#if DUNE_VERSION_NEWER(DUNE_COMMON, 2, 4)
+        return static_cast<size_t>(elementMapper_().index(elem));
+#else
+        return static_cast<size_t>(elementMapper_().map(elem));
+#endif
+    }
+
+    // copy the local residual and the local Jacobian of an element
+    template <class LocalLinearizer>
+    void storeElementLinearization_(const ElementContext& elemCtx,
+                                    const LocalLinearizer& localLinearizer,
+                                    ElementLinearization_& elemLinearization) const
+    {
+        size_t numDof = elemCtx.numDof(/*timeIdx=*/0);
+        size_t numPrimaryDof = elemCtx.numPrimaryDof(/*timeIdx=*/0);
+        elemLinearization.residual.resize(numPrimaryDof);
+        elemLinearization.jacobian.resize(numDof*numPrimaryDof);
+        for (unsigned primaryDofIdx = 0; primaryDofIdx < numPrimaryDof; ++ primaryDofIdx) {
+            elemLinearization.residual[primaryDofIdx] = localLinearizer.residual(primaryDofIdx);
+            for (unsigned dofIdx = 0; dofIdx < numDof; ++ dofIdx) {
+                MatrixBlock& dest = elemLinearization.jacobian[dofIdx*numPrimaryDof + primaryDofIdx];
+                const auto& src = localLinearizer.jacobian(dofIdx, primaryDofIdx);
+                for (unsigned eqIdx = 0; eqIdx < numEq; ++ eqIdx)
+                    for (unsigned pvIdx = 0; pvIdx < numEq; ++ pvIdx)
+                        dest[eqIdx][pvIdx] = src[eqIdx][pvIdx];
+            }
+        }
+    }
+
+    // add the stored contribution of an element to the global system of equations
+    void addElementLinearization_(const ElementContext& elemCtx,
+                                  const ElementLinearization_& elemLinearization)
+    {
+        if (useLinearizationLock)
+            globalMatrixMutex_.lock();
+
+        size_t numDof = elemCtx.numDof(/*timeIdx=*/0);
+        size_t numPrimaryDof = elemCtx.numPrimaryDof(/*timeIdx=*/0);
+        for (unsigned primaryDofIdx = 0; primaryDofIdx < numPrimaryDof; ++ primaryDofIdx) {
+            unsigned globI = elemCtx.globalSpaceIndex(/*spaceIdx=*/primaryDofIdx, /*timeIdx=*/0);
+            residual_[globI] += elemLinearization.residual[primaryDofIdx];
+
+            for (unsigned dofIdx = 0; dofIdx < numDof; ++ dofIdx) {
+                unsigned globJ = elemCtx.globalSpaceIndex(/*spaceIdx=*/dofIdx, /*timeIdx=*/0);
+                (*matrix_)[globJ][globI] += elemLinearization.jacobian[dofIdx*numPrimaryDof + primaryDofIdx];
+            }
+        }
+
+        if (useLinearizationLock)
+            globalMatrixMutex_.unlock();
+    }
+
+    // evaluate the local residual of an element and add it to the global residual
+    // without extracting any derivatives
+    void evalElementResidual_(const ElementContext& elemCtx)
+    {
+        unsigned threadId = ThreadManager::threadId();
+        auto& localResidual = model_().localResidual(threadId);
+        localResidual.eval(elemCtx);
+
+        if (useLinearizationLock)
+            globalMatrixMutex_.lock();
+
+        unsigned timeIdx = linearizationType_.time;
+        size_t numPrimaryDof = elemCtx.numPrimaryDof(timeIdx);
+        for (unsigned primaryDofIdx = 0; primaryDofIdx < numPrimaryDof; ++ primaryDofIdx) {
+            unsigned globI = elemCtx.globalSpaceIndex(/*spaceIdx=*/primaryDofIdx, timeIdx);
+            const auto& resid = localResidual.residual(primaryDofIdx);
+            for (unsigned eqIdx = 0; eqIdx < numEq; ++ eqIdx)
+                residual_[globI][eqIdx] += Toolbox::value(resid[eqIdx]);
+        }
+
+        if (useLinearizationLock)
+            globalMatrixMutex_.unlock();
+    }
+
+    // add the local Jacobian w.r.t. the solution at the beginning of the time step to
+    // the global one. (this must be called while holding the lock of the global matrix.)
+    template <class LocalLinearizer>
+    void addAdjointJacobian_(const ElementContext& elemCtx OPM_UNUSED,
+                             const LocalLinearizer& localLinearizer OPM_UNUSED,
+                             std::false_type)
+    { }
+
+    template <class LocalLinearizer>
+    void addAdjointJacobian_(const ElementContext& elemCtx,
+                             const LocalLinearizer& localLinearizer,
+                             std::true_type)
+    {
+        size_t numPrimaryDof = elemCtx.numPrimaryDof(/*timeIdx=*/0);
+        for (unsigned primaryDofIdx = 0; primaryDofIdx < numPrimaryDof; ++ primaryDofIdx) {
+            unsigned globI = elemCtx.globalSpaceIndex(/*spaceIdx=*/primaryDofIdx, /*timeIdx=*/0);
+
+            for (unsigned dofIdx = 0; dofIdx < elemCtx.numDof(/*timeIdx=*/0); ++ dofIdx) {
+                unsigned globJ = elemCtx.globalSpaceIndex(/*spaceIdx=*/dofIdx, /*timeIdx=*/0);
+
+                (*matrixA_)[globJ][globI] += localLinearizer.adjointJacobian(dofIdx, primaryDofIdx);
+            }
+        }
+    }
+
+    void linearizeAuxiliaryEquations_(bool residualOnly, bool auxModulesPrepared)
     {
         auto& model = model_();
-        for (unsigned auxModIdx = 0; auxModIdx < model.numAuxiliaryModules(); ++auxModIdx)
-            model.auxiliaryModule(auxModIdx)->linearize(*matrix_, residual_);
+        if (!residualOnly)
+            schurCorrection_.clear();
+
+        // the expensive part of linearizing the auxiliary modules does not touch any
+        // shared objects, so it is done in parallel unless this has already happened
+        // while the elements were linearized
+        if (!auxModulesPrepared) {
+            int numAuxMods = static_cast<int>(model.numAuxiliaryModules());
+            std::exception_ptr exception;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+            for (int i = 0; i < numAuxMods; ++i)
+                prepareAuxiliaryModule_(static_cast<unsigned>(i), residualOnly, exception);
+            if (exception)
+                std::rethrow_exception(exception);
+        }
+
+        // adding their contributions to the global system is cheap, but the modules may
+        // write to the same rows of the Jacobian matrix
+        for (unsigned auxModIdx = 0; auxModIdx < model.numAuxiliaryModules(); ++auxModIdx) {
+            if (residualOnly)
+                model.auxiliaryModule(auxModIdx)->linearizeResidual(*matrix_, residual_);
+            else
+                model.auxiliaryModule(auxModIdx)->linearize(*matrix_, residual_);
+        }
+    }
+
+    // let an auxiliary module evaluate its equations. this is called by multiple threads
+    // concurrently, so the first exception is only recorded instead of thrown.
+    void prepareAuxiliaryModule_(unsigned auxModIdx,
+                                 bool residualOnly,
+                                 std::exception_ptr& exception)
+    {
+        try {
+            model_().auxiliaryModule(auxModIdx)->prepareLinearization(residualOnly);
+        }
+        catch (...) {
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+            if (!exception)
+                exception = std::current_exception();
+        }
     }
 
     // apply the constraints to the solution. (i.e., the solution of constraint degrees
@@ -518,8 +1643,8 @@ private:
         auto& sol = model_().solution(/*timeIdx=*/0);
         auto& oldSol = model_().solution(/*timeIdx=*/1);
 
-        auto it = constraintsMap_.begin();
-        const auto& endIt = constraintsMap_.end();
+        auto it = constraintDofs_.begin();
+        const auto& endIt = constraintDofs_.end();
         for (; it != endIt; ++it) {
             sol[it->first] = it->second;
             oldSol[it->first] = it->second;
@@ -537,8 +1662,8 @@ private:
         for (unsigned i = 0; i < numEq; ++i)
             idBlock[i][i] = 1.0;
 
-        auto it = constraintsMap_.begin();
-        const auto& endIt = constraintsMap_.end();
+        auto it = constraintDofs_.begin();
+        const auto& endIt = constraintDofs_.end();
         for (; it != endIt; ++it) {
             unsigned constraintDofIdx = it->first;
 
@@ -556,15 +1681,31 @@ private:
         }
     }
 
+    // make the residual of the constraint degrees of freedom zero without touching the
+    // Jacobian matrix
+    void applyConstraintsToResidual_()
+    {
+        if (!enableConstraints_())
+            return;
+
+        auto it = constraintDofs_.begin();
+        const auto& endIt = constraintDofs_.end();
+        for (; it != endIt; ++it)
+            residual_[it->first] = 0.0;
+    }
+
     static bool enableConstraints_()
     { return GET_PROP_VALUE(TypeTag, EnableConstraints); }
 
     Simulator *simulatorPtr_;
-    std::vector<ElementContext*> elementCtx_;
+    ThreadLocalObjects<ElementContext> elementCtx_;
 
     // The constraint equations (only non-empty if the
     // EnableConstraints property is true)
-    std::map<unsigned, Constraints> constraintsMap_;
+    std::vector<std::pair<unsigned, Constraints> > constraintDofs_;
+    // the index of each degree of freedom in constraintDofs_ or -1 if it is not
+    // constraint
+    std::vector<int> constraintIdx_;
 
     // the jacobian matrix
     Matrix *matrix_;
@@ -572,10 +1713,44 @@ private:
     // the right-hand side
     GlobalEqVector residual_;
     GlobalEqVector residualA_;
+    ResidualStamp_ residualStamp_;
+
+    // the couplings of the unknowns which have been eliminated by the auxiliary modules
+    SchurCorrection schurCorrection_;
 
+    // the sparsity pattern of the grid in compressed row format. this is kept until the
+    // grid changes so that the pattern can be cheaply updated if only the auxiliary
+    // equations change.
+    std::vector<size_t> gridRowOffset_;
+    std::vector<unsigned> gridRowSize_;
+    std::vector<unsigned> gridNeighbors_;
 
+    // the rows of the matrix which are affected by the auxiliary equations
+    std::vector<unsigned> auxRowIndices_;
+    bool auxPatternIsDirty_;
+
+    // the elements of each color if the linearization is colored
+    std::vector<std::vector<ElementSeed> > elementColors_;
+
+    LinearizationType linearizationType_;
 
     OmpMutex globalMatrixMutex_;
+
+    // the state of the active set linearization (see the
+    // ActiveSetLinearizationTolerance property)
+    bool useActiveSet_;
+    bool activeSetIsValid_;
+    SolutionVector referenceSolution_;
+    std::vector<unsigned char> dofIsActive_;
+    std::vector<ElementLinearization_> elementLinearizations_;
+    size_t numRelinearizedElements_;
+
+    // the index of the element which handles each degree of freedom if the intensive
+    // quantities are computed in advance (see the PrecomputeIntensiveQuantities
+    // property)
+    std::vector<int> dofOwnerElement_;
+
+    MemoryRecord linearizationMemory_;
 };
 
 } // namespace Ewoms
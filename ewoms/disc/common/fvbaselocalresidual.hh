@@ -32,6 +32,7 @@
 
 #include <ewoms/common/parametersystem.hh>
 #include <ewoms/common/alignedallocator.hh>
+#include <ewoms/common/profiler.hh>
 
 #include <opm/common/Valgrind.hpp>
 #include <opm/common/Unused.hpp>
@@ -73,6 +74,7 @@ private:
     typedef typename GET_PROP_TYPE(TypeTag, EqVector) EqVector;
     typedef typename GET_PROP_TYPE(TypeTag, PrimaryVariables) PrimaryVariables;
     enum { numEq = GET_PROP_VALUE(TypeTag, NumEq) };
+    enum { enableAdjointLinearization = GET_PROP_VALUE(TypeTag, EnableAdjointLinearization) };
 
     typedef typename GET_PROP_TYPE(TypeTag, ElementContext) ElementContext;
     typedef typename GET_PROP_TYPE(TypeTag, BoundaryContext) BoundaryContext;
@@ -143,15 +145,7 @@ public:
      */
     void eval(const ElementContext& elemCtx)
     {
-        unsigned timeIdx = 0;
-        std::string wrtInitial = "";
-        std::ifstream inputFile;
-        inputFile.open("/home/joakimra/yesno.txt");
-        getline(inputFile, wrtInitial);
-        inputFile.close();
-        if (wrtInitial=="true"){
-            timeIdx = 1 ;
-        }
+        unsigned timeIdx = elemCtx.linearizationType().time;
         size_t numDof = elemCtx.numDof(timeIdx);
         internalResidual_.resize(numDof);
         asImp_().eval(internalResidual_, elemCtx);
@@ -167,20 +161,22 @@ public:
     void eval(LocalEvalBlockVector& residual,
               const ElementContext& elemCtx) const
     {
-
-        unsigned timeIdx = 0;
-        std::string wrtInitial = "";
-        std::ifstream inputFile;
-        inputFile.open("/home/joakimra/yesno.txt");
-        getline(inputFile, wrtInitial);
-        inputFile.close();
-        if (wrtInitial=="true"){
-            timeIdx = 1 ;
-        }
+        unsigned timeIdx = elemCtx.linearizationType().time;
         assert(residual.size() == elemCtx.numDof(timeIdx));
 
         residual = 0.0;
 
+        // if the residual is linearized w.r.t. the solution of a previous time level,
+        // only the storage terms of that solution depend on it
+        if (timeIdx != 0) {
+            size_t numPrimaryDof = elemCtx.numPrimaryDof(timeIdx);
+            for (unsigned dofIdx = 0; dofIdx < numPrimaryDof; ++dofIdx)
+                asImp_().evalPreviousStorageTerm_(residual, elemCtx, dofIdx, timeIdx);
+
+            makeVolumeSpecific_(residual, elemCtx, timeIdx);
+            return;
+        }
+
         // evaluate the flux terms
         asImp_().evalFluxes(residual, elemCtx, timeIdx);
 
@@ -190,21 +186,90 @@ public:
         // evaluate the boundary conditions
         asImp_().evalBoundary_(residual, elemCtx, timeIdx);
 
-        // make the residual volume specific (i.e., make it incorrect mass per cubic
-        // meter instead of total mass)
-        size_t numDof = elemCtx.numDof(timeIdx);
-        for (unsigned dofIdx=0; dofIdx < numDof; ++dofIdx) {
-            if (elemCtx.dofTotalVolume(dofIdx, timeIdx) > 0) {
-                // interior DOF
-                Scalar dofVolume = elemCtx.dofTotalVolume(dofIdx, timeIdx);
+        makeVolumeSpecific_(residual, elemCtx, timeIdx);
+    }
 
-                assert(std::isfinite(dofVolume));
-                Opm::Valgrind::CheckDefined(dofVolume);
+    /*!
+     * \brief Compute the local residual and the volume terms of the primary degrees of
+     *        freedom.
+     *
+     * The volume terms are the storage and source terms of the degrees of freedom. In
+     * contrast to the residual, they are not divided by the volume of the degree of
+     * freedom. They can be passed to evalPerturbed().
+     *
+     * \copydetails Doxygen::residualParam
+     * \param volumeTerms Stores the volume terms of all degrees of freedom of the stencil
+     * \copydetails Doxygen::ecfvElemCtxParam
+     */
+    void eval(LocalEvalBlockVector& residual,
+              LocalEvalBlockVector& volumeTerms,
+              const ElementContext& elemCtx) const
+    {
+        unsigned timeIdx = elemCtx.linearizationType().time;
+        assert(residual.size() == elemCtx.numDof(timeIdx));
+        assert(volumeTerms.size() == elemCtx.numDof(timeIdx));
 
-                for (unsigned eqIdx = 0; eqIdx < numEq; ++ eqIdx)
-                    residual[dofIdx][eqIdx] /= dofVolume;
-            }
+        volumeTerms = 0.0;
+        if (timeIdx != 0) {
+            // only the storage terms depend on the solution of a previous time level
+            size_t numPrimaryDof = elemCtx.numPrimaryDof(timeIdx);
+            for (unsigned dofIdx = 0; dofIdx < numPrimaryDof; ++dofIdx)
+                asImp_().evalPreviousStorageTerm_(volumeTerms, elemCtx, dofIdx, timeIdx);
+
+            residual = volumeTerms;
+            makeVolumeSpecific_(residual, elemCtx, timeIdx);
+            return;
         }
+
+        asImp_().evalVolumeTerms_(volumeTerms, elemCtx);
+
+        residual = volumeTerms;
+        asImp_().evalFluxes(residual, elemCtx, timeIdx);
+        asImp_().evalBoundary_(residual, elemCtx, timeIdx);
+
+        makeVolumeSpecific_(residual, elemCtx, timeIdx);
+    }
+
+    /*!
+     * \brief Compute the local residual after the primary variables of a single degree
+     *        of freedom have been modified.
+     *
+     * This assumes that the storage and source terms of a degree of freedom only depend
+     * on its own intensive quantities. Thus only the volume terms of the modified
+     * degree of freedom are evaluated, while the ones of all other degrees of freedom
+     * are taken from the volume terms which were computed by eval() for the
+     * unmodified primary variables.
+     *
+     * \copydetails Doxygen::residualParam
+     * \param volumeTerms The volume terms of the unmodified primary variables
+     * \copydetails Doxygen::ecfvElemCtxParam
+     * \param modifiedDofIdx The index of the degree of freedom whose primary variables
+     *                       have been modified
+     */
+    void evalPerturbed(LocalEvalBlockVector& residual,
+                       const LocalEvalBlockVector& volumeTerms,
+                       const ElementContext& elemCtx,
+                       unsigned modifiedDofIdx) const
+    {
+        unsigned timeIdx = elemCtx.linearizationType().time;
+        assert(residual.size() == elemCtx.numDof(timeIdx));
+        assert(volumeTerms.size() == elemCtx.numDof(timeIdx));
+
+        residual = volumeTerms;
+        residual[modifiedDofIdx] = 0.0;
+        if (timeIdx != 0) {
+            // only the storage terms depend on the solution of a previous time level
+            asImp_().evalPreviousStorageTerm_(residual, elemCtx, modifiedDofIdx, timeIdx);
+            makeVolumeSpecific_(residual, elemCtx, timeIdx);
+            return;
+        }
+
+        asImp_().evalVolumeTerm_(residual, elemCtx, modifiedDofIdx);
+
+        asImp_().evalFluxes(residual, elemCtx, timeIdx);
+        asImp_().evalBoundary_(residual, elemCtx, timeIdx);
+
+        makeVolumeSpecific_(residual, elemCtx, timeIdx);
     }
 
     /*!
@@ -222,18 +287,8 @@ public:
                      const ElementContext& elemCtx,
                      unsigned timeIdx) const
     {
-
-        //unsigned timeIdx = 0;
-        std::string wrtInitial = "";
-        std::ifstream inputFile;
-        inputFile.open("/home/joakimra/yesno.txt");
-        getline(inputFile, wrtInitial);
-        inputFile.close();
-        if (wrtInitial=="true"){
-            //timeIdx = 1 ;
-        }
-
-        if ((wrtInitial=="false" && timeIdx == 0) || (wrtInitial=="true" && timeIdx==1)) {
+        unsigned linearizationTimeIdx = elemCtx.linearizationType().time;
+        if (timeIdx == linearizationTimeIdx) {
             // for the most current solution, the storage term depends on the current
             // primary variables
 
@@ -254,8 +309,10 @@ public:
         }
         else {
             // for all previous solutions, the storage term does _not_ depend on the
-            // current primary variables, so we use scalars to store it.
-            if (elemCtx.enableStorageCache()) {
+            // current primary variables, so we use scalars to store it. (the model only
+            // caches the storage terms of the previous time steps, i.e., those of time
+            // index 0 must always be calculated.)
+            if (elemCtx.enableStorageCache() && timeIdx != 0) {
                 size_t numPrimaryDof = elemCtx.numPrimaryDof(timeIdx);
                 for (unsigned dofIdx=0; dofIdx < numPrimaryDof; dofIdx++) {
                     unsigned globalDofIdx = elemCtx.globalSpaceIndex(dofIdx, timeIdx);
@@ -269,7 +326,7 @@ public:
                 // all primary sub control volumes
 
                 Dune::FieldVector<Scalar, numEq> tmp;
-                size_t numPrimaryDof = elemCtx.numPrimaryDof(/*timeIdx=*/ wrtInitial=="true" ? 1 : 0);
+                size_t numPrimaryDof = elemCtx.numPrimaryDof(linearizationTimeIdx);
                 for (unsigned dofIdx=0; dofIdx < numPrimaryDof; dofIdx++) {
                     tmp = 0.0;
                     asImp_().computeStorage(tmp,
@@ -298,6 +355,8 @@ public:
                     const ElementContext& elemCtx,
                     unsigned timeIdx) const
     {
+        EWOMS_PROFILE_REGION("evalFluxes");
+
         RateVector flux;
 
         const auto& stencil = elemCtx.stencil(timeIdx);
@@ -479,6 +538,33 @@ protected:
      */
     void evalVolumeTerms_(LocalEvalBlockVector& residual,
                           const ElementContext& elemCtx) const
+    {
+        unsigned timeIdx = elemCtx.linearizationType().time;
+
+        // evaluate the volumetric terms (storage + source terms)
+        size_t numPrimaryDof = elemCtx.numPrimaryDof(timeIdx);
+        for (unsigned dofIdx=0; dofIdx < numPrimaryDof; dofIdx++)
+            asImp_().evalVolumeTerm_(residual, elemCtx, dofIdx);
+
+#if !defined NDEBUG
+        // in debug mode, ensure that the residual is well-defined
+        size_t numDof = elemCtx.numDof(/*timeIdx=*/0);
+        for (unsigned i=0; i < numDof; i++) {
+            for (unsigned j = 0; j < numEq; ++ j) {
+                assert(std::isfinite(Toolbox::value(residual[i][j])));
+                Opm::Valgrind::CheckDefined(residual[i][j]);
+            }
+        }
+#endif
+    }
+
+    /*!
+     * \brief Add the change in the storage terms and the source term of a single
+     *        sub-control volume to its local residual.
+     */
+    void evalVolumeTerm_(LocalEvalBlockVector& residual,
+                         const ElementContext& elemCtx,
+                         unsigned dofIdx) const
     {
         EvalVector tmp;
         EqVector tmp2;
@@ -487,19 +573,8 @@ protected:
         tmp = 0.0;
         tmp2 = 0.0;
 
-        unsigned timeIdx = 0;
-        std::string wrtInitial = "";
-        std::ifstream inputFile;
-        inputFile.open("/home/joakimra/yesno.txt");
-        getline(inputFile, wrtInitial);
-        inputFile.close();
-        if (wrtInitial=="true"){
-            timeIdx = 1 ;
-        }
-
-        // evaluate the volumetric terms (storage + source terms)
-        size_t numPrimaryDof = elemCtx.numPrimaryDof(timeIdx);
-        for (unsigned dofIdx=0; dofIdx < numPrimaryDof; dofIdx++) {
+        unsigned timeIdx = elemCtx.linearizationType().time;
+        {
             Scalar extrusionFactor =
                 elemCtx.intensiveQuantities(dofIdx, timeIdx).extrusionFactor();
             Scalar scvVolume =
@@ -507,62 +582,57 @@ protected:
             Opm::Valgrind::CheckDefined(scvVolume);
 
             // mass balance within the element. this is the \f$\frac{m}{\partial t}\f$
-            // term if using implicit euler as time discretization.
-            //
-            // TODO (?): we might need a more explicit way for doing the time
-            // discretization...
+            // term discretized using implicit Euler or BDF2 (cf.
+            // FvBaseDiscretization::timeDiscWeight()).
             asImp_().computeStorage(tmp,
                                     elemCtx,
                                     dofIdx,
                                     timeIdx);
             Opm::Valgrind::CheckDefined(tmp);
 
-            if (elemCtx.enableStorageCache()) {
+            if (enableAdjointLinearization) {
+                // if the derivatives w.r.t. the solution at the beginning of the time
+                // step are required, the storage term of that solution must be
+                // evaluated including its derivatives. this implies that it cannot be
+                // cached...
+                EvalVector prevStorage = 0.0;
+                asImp_().computeStorage(prevStorage,
+                                        elemCtx,
+                                        dofIdx,
+                                        /*timeIdx=*/1);
+                Opm::Valgrind::CheckDefined(prevStorage);
+
+                tmp -= prevStorage;
+                tmp2 = 0.0;
+            }
+            else if (elemCtx.enableStorageCache() && timeIdx == 0) {
+                // if the storage term is cached, we take the cached data. it is recorded
+                // by the model for the converged solution of the last time step.
                 const auto& model = elemCtx.model();
                 unsigned globalDofIdx = elemCtx.globalSpaceIndex(dofIdx, timeIdx);
-                if (model.newtonMethod().numIterations() == 0 &&
-                    !elemCtx.haveStashedIntensiveQuantities())
-                {
-                    // if the storage term is cached and we're in the first iteration of
-                    // the time step, update the cache of the storage term (this assumes
-                    // that the initial guess for the solution at the end of the time
-                    // step is the same as the solution at the beginning of the time
-                    // step. This is usually true, but some fancy preprocessing scheme
-                    // might invalidate that assumption.)
-                    for (unsigned eqIdx = 0; eqIdx < numEq; ++ eqIdx)
-                        tmp2[eqIdx] = Toolbox::value(tmp[eqIdx]);
-                    Opm::Valgrind::CheckDefined(tmp2);
-
-                    model.updateCachedStorage(globalDofIdx, timeIdx==0 ? 1 : 0, tmp2);
-                }
-                else {
-                    // if the storage term is cached and we're not looking at the first
-                    // iteration of the time step, we take the cached data.
-                    tmp2 = model.cachedStorage(globalDofIdx, timeIdx==0 ? 1 : 0);
-                    Opm::Valgrind::CheckDefined(tmp2);
-                }
+                tmp2 = model.cachedStorage(globalDofIdx, /*timeIdx=*/1);
+                Opm::Valgrind::CheckDefined(tmp2);
             }
             else {
                 // if the mass storage at the beginning of the time step is not cached,
                 // we re-calculate it from scratch.
                 tmp2 = 0.0;
-
-
-                if (wrtInitial=="true"){
-
-                }
-                else{
                 asImp_().computeStorage(tmp2,
                                         elemCtx,
                                         dofIdx,
-                                        timeIdx==0 ? 1 : 0);
-                }
+                                        /*timeIdx=*/1);
                 Opm::Valgrind::CheckDefined(tmp2);
             }
 
+            // for the most recent solution, the storage terms of the previous time steps
+            // are combined as required by the time discretization
+            Scalar alpha = 1.0;
+            if (!enableAdjointLinearization && timeIdx == 0)
+                alpha = asImp_().combineOldStorage_(tmp2, elemCtx, dofIdx);
+
             for (unsigned eqIdx = 0; eqIdx < numEq; ++eqIdx) {
                 tmp[eqIdx] -= tmp2[eqIdx];
-                tmp[eqIdx] *= scvVolume / elemCtx.simulator().timeStepSize();
+                tmp[eqIdx] *= alpha * scvVolume / elemCtx.simulator().timeStepSize();
 
                 residual[dofIdx][eqIdx] += tmp[eqIdx];
             }
@@ -578,17 +648,83 @@ protected:
 
             Opm::Valgrind::CheckDefined(residual[dofIdx]);
         }
+    }
 
-#if !defined NDEBUG
-        // in debug mode, ensure that the residual is well-defined
-        size_t numDof = elemCtx.numDof(/*timeIdx=*/0);
-        for (unsigned i=0; i < numDof; i++) {
-            for (unsigned j = 0; j < numEq; ++ j) {
-                assert(std::isfinite(Toolbox::value(residual[i][j])));
-                Opm::Valgrind::CheckDefined(residual[i][j]);
+    // add the storage term of a degree of freedom for the solution of a previous time
+    // level to its local residual. the term is weighted as required by the time
+    // discretization, so its derivatives w.r.t. that solution are the ones of the
+    // complete residual.
+    void evalPreviousStorageTerm_(LocalEvalBlockVector& residual,
+                                  const ElementContext& elemCtx,
+                                  unsigned dofIdx,
+                                  unsigned timeIdx) const
+    {
+        assert(timeIdx > 0);
+
+        EvalVector storage = 0.0;
+        asImp_().computeStorage(storage, elemCtx, dofIdx, timeIdx);
+        Opm::Valgrind::CheckDefined(storage);
+
+        Scalar scvVolume =
+            elemCtx.stencil(timeIdx).subControlVolume(dofIdx).volume()
+            * elemCtx.intensiveQuantities(dofIdx, timeIdx).extrusionFactor();
+        Scalar weight =
+            elemCtx.model().timeDiscWeight(timeIdx)
+            * scvVolume / elemCtx.simulator().timeStepSize();
+        for (unsigned eqIdx = 0; eqIdx < numEq; ++eqIdx)
+            residual[dofIdx][eqIdx] += storage[eqIdx]*weight;
+    }
+
+    // convert the storage term of the previous time step to the one which is subtracted
+    // from the current storage term by the time discretization and return the weight
+    // of the difference. for implicit Euler, nothing needs to be done. for BDF2, the
+    // storage term of the time step before the previous one is considered as well.
+    Scalar combineOldStorage_(EqVector& oldStorage,
+                              const ElementContext& elemCtx,
+                              unsigned dofIdx) const
+    {
+        const auto& model = elemCtx.model();
+        Scalar w2 = model.timeDiscWeight(/*timeIdx=*/2);
+        if (w2 == 0.0)
+            return 1.0;
+
+        EqVector olderStorage;
+        if (elemCtx.enableStorageCache()) {
+            unsigned globalDofIdx = elemCtx.globalSpaceIndex(dofIdx, /*timeIdx=*/0);
+            olderStorage = model.cachedStorage(globalDofIdx, /*timeIdx=*/2);
+        }
+        else {
+            olderStorage = 0.0;
+            asImp_().computeStorage(olderStorage, elemCtx, dofIdx, /*timeIdx=*/2);
+        }
+        Opm::Valgrind::CheckDefined(olderStorage);
+
+        Scalar w0 = model.timeDiscWeight(/*timeIdx=*/0);
+        Scalar w1 = model.timeDiscWeight(/*timeIdx=*/1);
+        for (unsigned eqIdx = 0; eqIdx < numEq; ++eqIdx)
+            oldStorage[eqIdx] = -(w1*oldStorage[eqIdx] + w2*olderStorage[eqIdx])/w0;
+        return w0;
+    }
+
+    // make the residual volume specific (i.e., make it incorrect mass per cubic meter
+    // instead of total mass)
+    void makeVolumeSpecific_(LocalEvalBlockVector& residual,
+                             const ElementContext& elemCtx,
+                             unsigned timeIdx) const
+    {
+        size_t numDof = elemCtx.numDof(timeIdx);
+        for (unsigned dofIdx=0; dofIdx < numDof; ++dofIdx) {
+            if (elemCtx.dofTotalVolume(dofIdx, timeIdx) > 0) {
+                // interior DOF
+                Scalar dofVolume = elemCtx.dofTotalVolume(dofIdx, timeIdx);
+
+                assert(std::isfinite(dofVolume));
+                Opm::Valgrind::CheckDefined(dofVolume);
+
+                for (unsigned eqIdx = 0; eqIdx < numEq; ++ eqIdx)
+                    residual[dofIdx][eqIdx] /= dofVolume;
             }
         }
-#endif
     }
 
 
@@ -28,10 +28,19 @@
 #ifndef EWOMS_FV_BASE_NEWTON_CONVERGENCE_WRITER_HH
 #define EWOMS_FV_BASE_NEWTON_CONVERGENCE_WRITER_HH
 
+#include "fvbasebinaryconvergencewriter.hh"
+
 #include <ewoms/io/vtkmultiwriter.hh>
 #include <ewoms/common/propertysystem.hh>
+#include <ewoms/common/parametersystem.hh>
+
+#include <opm/common/Exceptions.hpp>
+#include <opm/common/ErrorMacros.hpp>
 
 #include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
 
 namespace Ewoms {
 //! \cond SKIP_THIS
@@ -42,6 +51,9 @@ NEW_PROP_TAG(NewtonMethod);
 NEW_PROP_TAG(SolutionVector);
 NEW_PROP_TAG(GlobalEqVector);
 NEW_PROP_TAG(VtkOutputFormat);
+
+//! The format of the convergence output of the Newton method ('vtk' or 'binary')
+NEW_PROP_TAG(NewtonConvergenceFormat);
 } // namespace Properties
 //! \endcond
 
@@ -50,6 +62,10 @@ NEW_PROP_TAG(VtkOutputFormat);
  *
  * \brief Writes the intermediate solutions during the Newton scheme
  *        for models using a finite volume discretization
+ *
+ * Depending on the NewtonConvergenceFormat parameter, either a VTK file is written for
+ * each iteration or the residual and the update are appended to a compact binary log
+ * (cf. FvBaseBinaryConvergenceWriter).
  */
 template <class TypeTag>
 class FvBaseNewtonConvergenceWriter
@@ -62,6 +78,7 @@ class FvBaseNewtonConvergenceWriter
 
     static const int vtkFormat = GET_PROP_VALUE(TypeTag, VtkOutputFormat);
     typedef Ewoms::VtkMultiWriter<GridView, vtkFormat> VtkMultiWriter;
+    typedef Ewoms::FvBaseBinaryConvergenceWriter<TypeTag> BinaryWriter;
 
 public:
     FvBaseNewtonConvergenceWriter(NewtonMethod& nm)
@@ -75,6 +92,18 @@ public:
     ~FvBaseNewtonConvergenceWriter()
     { delete vtkMultiWriter_; }
 
+    /*!
+     * \brief Register all run-time parameters of the convergence writer.
+     */
+    static void registerParameters()
+    {
+        BinaryWriter::registerParameters();
+
+        EWOMS_REGISTER_PARAM(TypeTag, std::string, NewtonConvergenceFormat,
+                             "The format of the convergence output of the Newton method. "
+                             "Possible values are 'vtk' and 'binary'");
+    }
+
     /*!
      * \brief Called by the Newton method before the actual algorithm
      *        is started for any given timestep.
@@ -83,6 +112,20 @@ public:
     {
         ++timeStepIdx_;
         iteration_ = 0;
+
+        if (!vtkMultiWriter_ && !binaryWriter_) {
+            const std::string& format =
+                EWOMS_GET_PARAM(TypeTag, std::string, NewtonConvergenceFormat);
+            if (format == "binary")
+                binaryWriter_.reset(new BinaryWriter(newtonMethod_));
+            else if (format != "vtk")
+                OPM_THROW(std::invalid_argument,
+                          "Unknown format '" << format << "' for the convergence output "
+                          "of the Newton method (supported are 'vtk' and 'binary')");
+        }
+
+        if (binaryWriter_)
+            binaryWriter_->beginTimeStep();
     }
 
     /*!
@@ -92,6 +135,11 @@ public:
     void beginIteration()
     {
         ++ iteration_;
+        if (binaryWriter_) {
+            binaryWriter_->beginIteration();
+            return;
+        }
+
         if (!vtkMultiWriter_)
             vtkMultiWriter_ =
                 new VtkMultiWriter(newtonMethod_.problem().gridView(), "convergence");
@@ -110,6 +158,11 @@ public:
     void writeFields(const SolutionVector& uLastIter,
                      const GlobalEqVector& deltaU)
     {
+        if (binaryWriter_) {
+            binaryWriter_->writeFields(uLastIter, deltaU);
+            return;
+        }
+
         try {
             newtonMethod_.problem().model().addConvergenceVtkFields(*vtkMultiWriter_,
                                                                     uLastIter,
@@ -127,7 +180,12 @@ public:
      *        Newton algorithm has been completed.
      */
     void endIteration()
-    { vtkMultiWriter_->endWrite(); }
+    {
+        if (binaryWriter_)
+            binaryWriter_->endIteration();
+        else
+            vtkMultiWriter_->endWrite();
+    }
 
     /*!
      * \brief Called by the Newton method after Newton algorithm
@@ -137,12 +195,17 @@ public:
      * converged or not.
      */
     void endTimeStep()
-    { iteration_ = 0; }
+    {
+        iteration_ = 0;
+        if (binaryWriter_)
+            binaryWriter_->endTimeStep();
+    }
 
 private:
     int timeStepIdx_;
     int iteration_;
     VtkMultiWriter *vtkMultiWriter_;
+    std::unique_ptr<BinaryWriter> binaryWriter_;
     NewtonMethod& newtonMethod_;
 };
 
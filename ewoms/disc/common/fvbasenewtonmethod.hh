@@ -29,9 +29,15 @@
 #define EWOMS_FV_BASE_NEWTON_METHOD_HH
 
 #include "fvbasenewtonconvergencewriter.hh"
+#include "fvbasesubdomainsolver.hh"
 
 #include <ewoms/nonlinear/newtonmethod.hh>
 #include <ewoms/common/propertysystem.hh>
+#include <ewoms/common/parametersystem.hh>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
 
 namespace Ewoms {
 
@@ -66,6 +72,29 @@ NEW_PROP_TAG(DiscNewtonMethod);
 //! The class implementing the Newton algorithm
 NEW_PROP_TAG(NewtonMethod);
 
+/*!
+ * \brief The maximum number of Newton iterations on the subdomain of the strongly
+ *        non-linear degrees of freedom which precede each global Newton iteration.
+ *
+ * A value of 0 disables the subdomain iterations (cf. FvBaseSubdomainSolver).
+ */
+NEW_PROP_TAG(NewtonSubdomainIterations);
+
+/*!
+ * \brief The fraction of the error of the global Newton iteration which the weighted
+ *        residual of a degree of freedom must exceed for it to become part of the
+ *        subdomain.
+ */
+NEW_PROP_TAG(NewtonSubdomainErrorFraction);
+
+/*!
+ * \brief The maximum fraction of a process' degrees of freedom which may be part of
+ *        the subdomain.
+ *
+ * Larger subdomains are left to the global Newton iteration.
+ */
+NEW_PROP_TAG(NewtonSubdomainMaxFraction);
+
 // set default values
 SET_TYPE_PROP(FvBaseNewtonMethod, DiscNewtonMethod,
               Ewoms::FvBaseNewtonMethod<TypeTag>);
@@ -73,6 +102,15 @@ SET_TYPE_PROP(FvBaseNewtonMethod, NewtonMethod,
               typename GET_PROP_TYPE(TypeTag, DiscNewtonMethod));
 SET_TYPE_PROP(FvBaseNewtonMethod, NewtonConvergenceWriter,
               Ewoms::FvBaseNewtonConvergenceWriter<TypeTag>);
+SET_INT_PROP(FvBaseNewtonMethod, NewtonSubdomainIterations, 0);
+SET_SCALAR_PROP(FvBaseNewtonMethod, NewtonSubdomainErrorFraction, 0.1);
+SET_SCALAR_PROP(FvBaseNewtonMethod, NewtonSubdomainMaxFraction, 0.1);
+SET_STRING_PROP(FvBaseNewtonMethod, NewtonConvergenceFormat, "vtk");
+#if HAVE_ZLIB
+SET_STRING_PROP(FvBaseNewtonMethod, NewtonConvergenceCompression, "zlib");
+#else
+SET_STRING_PROP(FvBaseNewtonMethod, NewtonConvergenceCompression, "none");
+#endif
 } // namespace Properties
 
 /*!
@@ -82,6 +120,13 @@ SET_TYPE_PROP(FvBaseNewtonMethod, NewtonConvergenceWriter,
  *
  * This class is sufficient for most models which use an Element or a
  * Vertex Centered Finite Volume discretization.
+ *
+ * Optionally, each global Newton iteration is preceded by a few Newton iterations on
+ * the subdomain of each process which contains the degrees of freedom where the
+ * residual is large (cf. the NewtonSubdomainIterations property). This non-linear
+ * preconditioning resolves the strongly non-linear regions, e.g. saturation fronts,
+ * locally, so that the global iterations do not need to solve the global linear system
+ * for them.
  */
 template <class TypeTag>
 class FvBaseNewtonMethod : public NewtonMethod<TypeTag>
@@ -99,12 +144,33 @@ class FvBaseNewtonMethod : public NewtonMethod<TypeTag>
     typedef typename GET_PROP_TYPE(TypeTag, PrimaryVariables) PrimaryVariables;
     typedef typename GET_PROP_TYPE(TypeTag, EqVector) EqVector;
 
+    typedef FvBaseSubdomainSolver<TypeTag> SubdomainSolver;
 
 public:
     FvBaseNewtonMethod(Simulator& simulator)
         : ParentType(simulator)
     { }
 
+    /*!
+     * \brief Register all run-time parameters for the Newton method.
+     */
+    static void registerParameters()
+    {
+        ParentType::registerParameters();
+
+        EWOMS_REGISTER_PARAM(TypeTag, int, NewtonSubdomainIterations,
+                             "The maximum number of Newton iterations on the subdomain of "
+                             "the strongly non-linear degrees of freedom before each "
+                             "global Newton iteration");
+        EWOMS_REGISTER_PARAM(TypeTag, Scalar, NewtonSubdomainErrorFraction,
+                             "The fraction of the global error which the residual of a "
+                             "degree of freedom must exceed for it to become part of the "
+                             "subdomain");
+        EWOMS_REGISTER_PARAM(TypeTag, Scalar, NewtonSubdomainMaxFraction,
+                             "The maximum fraction of the degrees of freedom of a process "
+                             "which may be part of the subdomain");
+    }
+
 protected:
     friend class Ewoms::NewtonMethod<TypeTag>;
 
@@ -147,6 +213,9 @@ protected:
      */
     void beginIteration_()
     {
+        if (EWOMS_GET_PARAM(TypeTag, int, NewtonSubdomainIterations) > 0)
+            solveSubdomain_();
+
         model_().syncOverlap();
 
         ParentType::beginIteration_();
@@ -164,12 +233,100 @@ protected:
     const Model& model_() const
     { return ParentType::model(); }
 
+    /*!
+     * \brief Do the Newton iterations on the subdomain of the strongly non-linear
+     *        degrees of freedom.
+     *
+     * The subdomain is determined using the residual of the most recent global
+     * linearization, which is evaluated first for the first iteration of a time step.
+     * The iterations stop as soon as the error of the subdomain is below the tolerance
+     * of the Newton method. If the error of an iteration grows, its update is reverted
+     * and the global Newton iteration takes over.
+     */
+    void solveSubdomain_()
+    {
+        auto& linearizer = model_().linearizer();
+        if (this->numIterations() == 0)
+            linearizer.linearizeResidual();
+
+        // this is a collective operation, so it must be done by all processes
+        Scalar globalError = asImp_().residualError_(linearizer.residual());
+        Scalar threshold =
+            std::max(this->tolerance(),
+                     EWOMS_GET_PARAM(TypeTag, Scalar, NewtonSubdomainErrorFraction)*globalError);
+        if (globalError <= this->tolerance())
+            return;
+
+        if (!subdomainSolver_)
+            subdomainSolver_.reset(new SubdomainSolver(this->simulator_));
+        size_t numSubdomainDof = subdomainSolver_->selectDofs(linearizer.residual(), threshold);
+        Scalar maxFraction = EWOMS_GET_PARAM(TypeTag, Scalar, NewtonSubdomainMaxFraction);
+        if (numSubdomainDof == 0 || numSubdomainDof > maxFraction*model_().numGridDof())
+            return;
+
+        const auto& dofs = subdomainSolver_->dofs();
+        SolutionVector& solution = model_().solution(/*timeIdx=*/0);
+        std::vector<PrimaryVariables> lastValues(dofs.size());
+        typename SubdomainSolver::Vector update;
+
+        int maxIterations = EWOMS_GET_PARAM(TypeTag, int, NewtonSubdomainIterations);
+        int iterIdx = 0;
+        Scalar lastError = 0.0;
+        for (; iterIdx < maxIterations; ++iterIdx) {
+            Scalar error = subdomainSolver_->linearize();
+            if (iterIdx > 0 && !(error < lastError)) {
+                // the iteration made things worse. revert its update.
+                for (size_t localIdx = 0; localIdx < dofs.size(); ++localIdx)
+                    solution[dofs[localIdx]] = lastValues[localIdx];
+                invalidateSubdomainCache_();
+                break;
+            }
+            if (error <= this->tolerance())
+                break;
+            lastError = error;
+
+            if (!subdomainSolver_->solve(update))
+                break;
+
+            const auto& residual = subdomainSolver_->residual();
+            for (size_t localIdx = 0; localIdx < dofs.size(); ++localIdx) {
+                unsigned dofIdx = dofs[localIdx];
+                lastValues[localIdx] = solution[dofIdx];
+                asImp_().updatePrimaryVariables_(dofIdx,
+                                                 solution[dofIdx],
+                                                 lastValues[localIdx],
+                                                 update[localIdx],
+                                                 residual[localIdx]);
+            }
+            invalidateSubdomainCache_();
+        }
+
+        this->endIterMsg() << ", subdomain DOFs=" << numSubdomainDof
+                           << ", subdomain iterations=" << iterIdx;
+    }
+
+    // make sure that the intensive quantities of the subdomain's degrees of freedom are
+    // recalculated
+    void invalidateSubdomainCache_()
+    {
+        if (!model_().storeIntensiveQuantities())
+            return;
+
+        const auto& dofs = subdomainSolver_->dofs();
+        for (size_t localIdx = 0; localIdx < dofs.size(); ++localIdx)
+            model_().setIntensiveQuantitiesCacheEntryValidity(dofs[localIdx],
+                                                              /*timeIdx=*/0,
+                                                              /*valid=*/false);
+    }
+
 private:
     Implementation& asImp_()
     { return *static_cast<Implementation*>(this); }
 
     const Implementation& asImp_() const
     { return *static_cast<const Implementation*>(this); }
+
+    std::unique_ptr<SubdomainSolver> subdomainSolver_;
 };
 } // namespace Ewoms
 
@@ -29,6 +29,7 @@
 #define EWOMS_FV_BASE_PRIMARY_VARIABLES_HH
 
 #include "fvbaseproperties.hh"
+#include "linearizationtype.hh"
 
 #include <opm/common/Valgrind.hpp>
 #include <opm/common/Unused.hpp>
@@ -53,6 +54,7 @@ class FvBasePrimaryVariables
     typedef typename GET_PROP_TYPE(TypeTag, Evaluation) Evaluation;
 
     enum { numEq = GET_PROP_VALUE(TypeTag, NumEq) };
+    enum { enableAdjointLinearization = GET_PROP_VALUE(TypeTag, EnableAdjointLinearization) };
 
     typedef Opm::MathToolbox<Evaluation> Toolbox;
     typedef Dune::FieldVector<Scalar, numEq> ParentType;
@@ -82,22 +84,29 @@ public:
     /*!
      * \brief Return a primary variable intensive evaluation.
      *
-     * i.e., the result represents the function f = x_i if the time index is zero, else
-     * it represents the a constant f = x_i. (the difference is that in the first case,
-     * the derivative w.r.t. x_i is 1, while it is 0 in the second case.
+     * i.e., the result represents the function f = x_i if the time index is the one
+     * w.r.t. which the residual is linearized (by default zero), else it represents the
+     * a constant f = x_i. (the difference is that in the first case, the derivative
+     * w.r.t. x_i is 1, while it is 0 in the second case.
+     *
+     * If the linearization w.r.t. the solution at the beginning of the time step is
+     * enabled (cf. the EnableAdjointLinearization property), the evaluations of the
+     * time indices 0 and 1 are seeded at different derivatives: the first 'numEq' ones
+     * are the derivatives w.r.t. the most recent solution and the next 'numEq' ones are
+     * w.r.t. the solution at the beginning of the time step.
      */
-    Evaluation makeEvaluation(unsigned varIdx, unsigned timeIdx) const
+    Evaluation makeEvaluation(unsigned varIdx,
+                              unsigned timeIdx,
+                              const LinearizationType& linearizationType = LinearizationType()) const
     {
-
-        std::string wrtInitial = "";
-        std::ifstream inputFile;
-        inputFile.open("/home/joakimra/yesno.txt");
-        getline(inputFile, wrtInitial);
-        inputFile.close();
-        if (wrtInitial=="true"){
-            timeIdx = timeIdx==0 ? 1 : 0 ;
+        if (enableAdjointLinearization) {
+            if (timeIdx < 2)
+                return Toolbox::createVariable((*this)[varIdx], timeIdx*numEq + varIdx);
+            else
+                return Toolbox::createConstant((*this)[varIdx]);
         }
-        if (timeIdx == 0)
+
+        if (timeIdx == linearizationType.time)
             return Toolbox::createVariable((*this)[varIdx], varIdx);
         else
             return Toolbox::createConstant((*this)[varIdx]);
@@ -31,6 +31,7 @@
 #include "fvbaseproperties.hh"
 
 #include <ewoms/io/vtkmultiwriter.hh>
+#include <ewoms/io/hdfoutputwriter.hh>
 #include <ewoms/io/restart.hh>
 #include <ewoms/disc/common/restrictprolong.hh>
 
@@ -43,9 +44,57 @@
 #include <iostream>
 #include <limits>
 #include <string>
+#include <vector>
+#include <algorithm>
+#include <cmath>
 
 namespace Ewoms {
 
+/*!
+ * \ingroup FiniteVolumeDiscretizations
+ *
+ * \brief The properties of the degrees of freedom which do not depend on the solution.
+ *
+ * Problems can optionally publish these properties as flat arrays which are indexed by
+ * the global index of the degree of freedom (cf. FvBaseProblem::staticDofProperties()).
+ * The intensive quantities can then avoid calling the context-based methods of the
+ * problem, which each need to determine the global index of the degree of freedom and
+ * often look up some region tables. An empty array means that the property is not
+ * published, i.e., the context-based method of the problem must be called.
+ */
+template <class Scalar>
+struct FvBaseStaticDofProperties
+{
+    //! The porosity of the degrees of freedom at the reference pressure
+    std::vector<Scalar> porosity;
+
+    //! The compressibility of the rock [1/Pa]
+    std::vector<Scalar> rockCompressibility;
+
+    //! The pressure at which the porosity is specified [Pa]
+    std::vector<Scalar> rockReferencePressure;
+
+    /*!
+     * \brief Returns true iff no property is published.
+     */
+    bool empty() const
+    {
+        return porosity.empty()
+            && rockCompressibility.empty()
+            && rockReferencePressure.empty();
+    }
+
+    /*!
+     * \brief Stop publishing any property.
+     */
+    void clear()
+    {
+        porosity.clear();
+        rockCompressibility.clear();
+        rockReferencePressure.clear();
+    }
+};
+
 /*!
  * \ingroup FiniteVolumeDiscretizations
  *
@@ -64,6 +113,9 @@ private:
 
     static const int vtkOutputFormat = GET_PROP_VALUE(TypeTag, VtkOutputFormat);
     typedef Ewoms::VtkMultiWriter<GridView, vtkOutputFormat> VtkMultiWriter;
+#if HAVE_HDF5
+    typedef Ewoms::HdfOutputWriter<GridView> HdfOutputWriter;
+#endif
 
     typedef typename GET_PROP_TYPE(TypeTag, Model) Model;
     typedef typename GET_PROP_TYPE(TypeTag, Scalar) Scalar;
@@ -77,6 +129,7 @@ private:
     typedef typename GET_PROP_TYPE(TypeTag, RateVector) RateVector;
     typedef typename GET_PROP_TYPE(TypeTag, BoundaryRateVector) BoundaryRateVector;
     typedef typename GET_PROP_TYPE(TypeTag, PrimaryVariables) PrimaryVariables;
+    typedef typename GET_PROP_TYPE(TypeTag, SolutionVector) SolutionVector;
     typedef typename GET_PROP_TYPE(TypeTag, Constraints) Constraints;
 
     enum {
@@ -115,7 +168,15 @@ public:
         , boundingBoxMax_(-std::numeric_limits<double>::max())
         , simulator_(simulator)
         , defaultVtkWriter_(0)
+#if HAVE_HDF5
+        , defaultHdfWriter_(0)
+#endif
     {
+        // the relative changes of the last three time steps used by the PID time step
+        // controller. a value of 1 means that the target change was hit exactly.
+        for (unsigned i = 0; i < 3; ++i)
+            timeStepChange_[i] = 1.0;
+
         // calculate the bounding box of the local partition of the grid view
         VertexIterator vIt = gridView_.template begin<dim>();
         const VertexIterator vEndIt = gridView_.template end<dim>();
@@ -132,12 +193,37 @@ public:
             boundingBoxMax_[i] = gridView_.comm().max(boundingBoxMax_[i]);
         }
 
-        if (enableVtkOutput_())
+        if (enableVtkOutput_()) {
             defaultVtkWriter_ = new VtkMultiWriter(gridView_, asImp_().name());
+
+            const std::string& compression = EWOMS_GET_PARAM(TypeTag, std::string, VtkCompression);
+            defaultVtkWriter_->setCompression(Ewoms::VtkAppendedWriter<GridView>::compressionFromString(compression));
+
+            if (EWOMS_GET_PARAM(TypeTag, bool, EnableAsyncVtkOutput)) {
+                int maxPendingWrites = EWOMS_GET_PARAM(TypeTag, int, MaxPendingVtkWrites);
+                maxPendingWrites = std::max(maxPendingWrites, 1);
+                defaultVtkWriter_->enableAsyncWrites(static_cast<unsigned>(maxPendingWrites));
+            }
+        }
+
+        if (enableHdfOutput_()) {
+#if HAVE_HDF5
+            defaultHdfWriter_ = new HdfOutputWriter(gridView_, asImp_().name());
+            defaultHdfWriter_->setCompressionLevel(EWOMS_GET_PARAM(TypeTag, int, HdfCompressionLevel));
+#else
+            OPM_THROW(std::runtime_error,
+                      "HDF5 output requires eWoms to be built with HDF5");
+#endif
+        }
     }
 
     ~FvBaseProblem()
-    { delete defaultVtkWriter_; }
+    {
+        delete defaultVtkWriter_;
+#if HAVE_HDF5
+        delete defaultHdfWriter_;
+#endif
+    }
 
     /*!
      * \brief Registers all available parameters for the problem and
@@ -153,6 +239,12 @@ public:
         EWOMS_REGISTER_PARAM(TypeTag, unsigned, MaxTimeStepDivisions,
                              "The maximum number of divisions by two of the timestep size "
                              "before the simulation bails out");
+        EWOMS_REGISTER_PARAM(TypeTag, Scalar, TimeStepControlTargetChange,
+                             "The relative change of the solution per time step at which "
+                             "the PID time step controller aims. 0 disables the controller");
+        EWOMS_REGISTER_PARAM(TypeTag, Scalar, TimeDiscTolerance,
+                             "The tolerance for the estimated local truncation error of the "
+                             "BDF2 time discretization. 0 disables the error control");
     }
 
     /*!
@@ -172,6 +264,39 @@ public:
         // do nothing by default
     }
 
+    /*!
+     * \brief Called by the linearizer before the local Jacobian of an element is
+     *        computed.
+     *
+     * At this point, the element context exhibits the intensive and extensive
+     * quantities which are used to linearize the element. This allows problems to
+     * extract additional quantities within the same sweep over the grid, e.g. the
+     * derivatives of the residual w.r.t. some model parameters. Note that this method
+     * may be called by multiple threads concurrently.
+     */
+    template <class ElementContext>
+    void linearizeElement(const ElementContext& elemCtx OPM_UNUSED)
+    {
+        // do nothing by default
+    }
+
+    /*!
+     * \brief Returns the properties of the degrees of freedom which are published as
+     *        flat arrays by the problem.
+     *
+     * By default, no property is published. Problems which do so are supposed to fill
+     * the arrays in their finishInit() method and to update them whenever the
+     * properties change, e.g. at the beginning of an episode.
+     */
+    const FvBaseStaticDofProperties<Scalar>& staticDofProperties() const
+    { return staticDofProperties_; }
+
+    /*!
+     * \copydoc staticDofProperties()
+     */
+    FvBaseStaticDofProperties<Scalar>& staticDofProperties()
+    { return staticDofProperties_; }
+
     /*!
      * \brief Handle changes of the grid
      */
@@ -182,6 +307,10 @@ public:
 
         if (enableVtkOutput_())
             defaultVtkWriter_->gridChanged();
+#if HAVE_HDF5
+        if (enableHdfOutput_())
+            defaultHdfWriter_->gridChanged();
+#endif
     }
 
     /*!
@@ -245,6 +374,8 @@ public:
      * \param spaceIdx The local index of the spatial entity which represents
      *                 the boundary segment.
      * \param timeIdx The index used for the time discretization
+     *
+     * Note that this method may be called by multiple threads concurrently.
      */
     template <class Context>
     void initial(PrimaryVariables& values OPM_UNUSED,
@@ -253,6 +384,23 @@ public:
                  unsigned timeIdx OPM_UNUSED) const
     { OPM_THROW(std::logic_error, "Problem does not provide a initial() method"); }
 
+    /*!
+     * \brief Evaluate the initial solution of all degrees of freedom at once.
+     *
+     * Problems which store their initial condition in arrays that are indexed by the
+     * global index of the degrees of freedom can overload this method to avoid
+     * evaluating initial() for the degrees of freedom of each element. If the
+     * solution is set by this method, the problem is responsible for specifying the
+     * complete primary variables of all degrees of freedom.
+     *
+     * \param solution The solution vector which receives the initial condition.
+     *
+     * \return true iff the solution has been set, else initial() is called for each
+     *         degree of freedom
+     */
+    bool initialSolution(SolutionVector& solution OPM_UNUSED) const
+    { return false; }
+
     /*!
      * \brief Return how much the domain is extruded at a given sub-control volume.
      *
@@ -404,8 +552,11 @@ public:
 
         for (unsigned i = 0; i < maxFails; ++i) {
             bool converged = model().update();
-            if (converged)
+            if (converged) {
+                if (EWOMS_GET_PARAM(TypeTag, Scalar, TimeStepControlTargetChange) > 0.0)
+                    recordTimeStepChange_();
                 return;
+            }
 
             Scalar dt = simulator().timeStepSize();
             Scalar nextDt = dt / 2;
@@ -436,6 +587,16 @@ public:
         Scalar dtNext = std::min(EWOMS_GET_PARAM(TypeTag, Scalar, MaxTimeStepSize),
                                  newtonMethod().suggestTimeStepSize(simulator().timeStepSize()));
 
+        // if the PID controller is enabled, the time step size must be acceptable for the
+        // Newton method as well as for the change of the solution
+        if (EWOMS_GET_PARAM(TypeTag, Scalar, TimeStepControlTargetChange) > 0.0)
+            dtNext = std::min(dtNext, pidTimeStepSize_(simulator().timeStepSize()));
+
+        // if the error of the time discretization is estimated, it must not exceed the
+        // tolerance
+        if (EWOMS_GET_PARAM(TypeTag, Scalar, TimeDiscTolerance) > 0.0)
+            dtNext = std::min(dtNext, errorControlledTimeStepSize_(simulator().timeStepSize()));
+
         if (dtNext < simulator().maxTimeStepSize()
             && simulator().maxTimeStepSize() < dtNext*2)
         {
@@ -596,6 +757,10 @@ public:
     {
         if (enableVtkOutput_())
             defaultVtkWriter_->serialize(res);
+#if HAVE_HDF5
+        if (enableHdfOutput_())
+            defaultHdfWriter_->serialize(res);
+#endif
     }
 
     /*!
@@ -613,6 +778,10 @@ public:
     {
         if (enableVtkOutput_())
             defaultVtkWriter_->deserialize(res);
+#if HAVE_HDF5
+        if (enableHdfOutput_())
+            defaultHdfWriter_->deserialize(res);
+#endif
     }
 
     /*!
@@ -630,8 +799,14 @@ public:
         // calculate the time _after_ the time was updated
         Scalar t = simulator().time() + simulator().timeStepSize();
 
-        if (enableVtkOutput_())
+        if (enableVtkOutput_()) {
+            defaultVtkWriter_->setOutputRegion(model().outputRegion());
             defaultVtkWriter_->beginWrite(t);
+        }
+#if HAVE_HDF5
+        if (enableHdfOutput_())
+            defaultHdfWriter_->beginWrite(t);
+#endif
 
         model().prepareOutputFields();
 
@@ -639,6 +814,12 @@ public:
             model().appendOutputFields(*defaultVtkWriter_);
             defaultVtkWriter_->endWrite();
         }
+#if HAVE_HDF5
+        if (enableHdfOutput_()) {
+            model().appendOutputFields(*defaultHdfWriter_);
+            defaultHdfWriter_->endWrite();
+        }
+#endif
     }
 
     /*!
@@ -652,6 +833,67 @@ private:
     bool enableVtkOutput_() const
     { return EWOMS_GET_PARAM(TypeTag, bool, EnableVtkOutput); }
 
+    bool enableHdfOutput_() const
+    { return EWOMS_GET_PARAM(TypeTag, bool, EnableHdfOutput); }
+
+    // store the relative change of the solution of the last time step w.r.t. the target
+    // change for the PID controller
+    void recordTimeStepChange_()
+    {
+        const auto& uCur = model().solution(/*timeIdx=*/0);
+        const auto& uOld = model().solution(/*timeIdx=*/1);
+
+        Scalar change = 0.0;
+        size_t numDof = model().numGridDof();
+        for (unsigned dofIdx = 0; dofIdx < numDof; ++dofIdx)
+            change = std::max(change, model().relativeDofError(dofIdx, uOld[dofIdx], uCur[dofIdx]));
+        change = gridView().comm().max(change);
+
+        timeStepChange_[2] = timeStepChange_[1];
+        timeStepChange_[1] = timeStepChange_[0];
+        timeStepChange_[0] =
+            std::max<Scalar>(change/EWOMS_GET_PARAM(TypeTag, Scalar, TimeStepControlTargetChange),
+                             1e-10);
+    }
+
+    // the time step size suggested by the PID controller. (the parameters of the
+    // controller are the ones proposed by Valli, Carey and Coutinho.)
+    Scalar pidTimeStepSize_(Scalar dt) const
+    {
+        static const Scalar kP = 0.075;
+        static const Scalar kI = 0.175;
+        static const Scalar kD = 0.01;
+
+        const Scalar* e = timeStepChange_;
+        Scalar factor =
+            std::pow(e[1]/e[0], kP)
+            * std::pow(1.0/e[0], kI)
+            * std::pow(e[1]*e[1]/(e[0]*e[2]), kD);
+
+        // do not change the time step size too abruptly
+        factor = std::max<Scalar>(0.2, std::min<Scalar>(factor, 5.0));
+        return dt*factor;
+    }
+
+    // the time step size for which the local truncation error of the time
+    // discretization is expected to be slightly smaller than the tolerance. since the
+    // error of BDF2 is proportional to the cube of the time step size, the step size is
+    // scaled by the cube root of the ratio of the tolerance and the error.
+    Scalar errorControlledTimeStepSize_(Scalar dt) const
+    {
+        Scalar error = model().timeDiscError();
+        if (error < 0.0)
+            // no error estimate available
+            return std::numeric_limits<Scalar>::max();
+
+        Scalar tolerance = EWOMS_GET_PARAM(TypeTag, Scalar, TimeDiscTolerance);
+        Scalar factor = 0.9*std::cbrt(tolerance/std::max<Scalar>(error, 1e-10*tolerance));
+
+        // do not change the time step size too abruptly
+        factor = std::max<Scalar>(0.2, std::min<Scalar>(factor, 5.0));
+        return dt*factor;
+    }
+
     //! Returns the implementation of the problem (i.e. static polymorphism)
     Implementation& asImp_()
     { return *static_cast<Implementation *>(this); }
@@ -670,6 +912,15 @@ private:
     // Attributes required for the actual simulation
     Simulator& simulator_;
     mutable VtkMultiWriter *defaultVtkWriter_;
+#if HAVE_HDF5
+    HdfOutputWriter *defaultHdfWriter_;
+#endif
+
+    FvBaseStaticDofProperties<Scalar> staticDofProperties_;
+
+    // the relative changes of the last three time steps divided by the target change.
+    // the most recent one comes first.
+    Scalar timeStepChange_[3];
 };
 
 } // namespace Ewoms
@@ -100,6 +100,35 @@ NEW_PROP_TAG(DiscLocalResidual);
 NEW_PROP_TAG(LocalResidual);
 //! The type of the local linearizer
 NEW_PROP_TAG(LocalLinearizer);
+/*!
+ * \brief Specify whether the local linearizer also computes the derivatives of the
+ *        residual w.r.t. the solution at the beginning of the time step.
+ *
+ * If this is enabled, the linearizer assembles the Jacobian w.r.t. time index 1 (see
+ * FvBaseLinearizer::matrixA()) alongside the one w.r.t. time index 0 with a single
+ * evaluation of the local residual.
+ */
+NEW_PROP_TAG(EnableAdjointLinearization);
+
+/*!
+ * \brief The number of solution snapshots which the adjoint driver keeps in memory in
+ *        addition to the initial solution.
+ *
+ * See Ewoms::FvBaseAdjointDriver for details.
+ */
+NEW_PROP_TAG(AdjointNumCheckpoints);
+
+/*!
+ * \brief The directory to which the adjoint driver writes the Jacobian matrices of the
+ *        forward sweep.
+ *
+ * If this is empty, the matrices are not stored but the time steps are recomputed
+ * during the backward sweep. See Ewoms::FvBaseJacobianStore for details.
+ */
+NEW_PROP_TAG(AdjointJacobianStoreDirectory);
+
+//! Specify if the stored Jacobian matrices are truncated to single precision
+NEW_PROP_TAG(AdjointJacobianStoreSinglePrecision);
 //! Specify if elements that do not belong to the local process' grid partition should be
 //! skipped
 NEW_PROP_TAG(LinearizeNonLocalElements);
@@ -108,6 +137,15 @@ NEW_PROP_TAG(LinearizeNonLocalElements);
 NEW_PROP_TAG(BaseLinearizer);
 //! Type of the global jacobian matrix
 NEW_PROP_TAG(JacobianMatrix);
+/*!
+ * \brief The floating point type of the entries of the global Jacobian matrix.
+ *
+ * The local Jacobians, the residual and the solution are always computed using the
+ * Scalar type. Since the global Jacobian is only used by the linear solver, it may be
+ * stored with less precision (e.g. 'float') to reduce the memory required by the
+ * matrix and the memory bandwidth of the linear solver.
+ */
+NEW_PROP_TAG(JacobianScalar);
 
 //! A vector of holding a quantity for each equation (usually at a given spatial location)
 NEW_PROP_TAG(EqVector);
@@ -162,12 +200,37 @@ NEW_PROP_TAG(GridCommHandleFactory);
 NEW_PROP_TAG(ThreadManager);
 NEW_PROP_TAG(ThreadsPerProcess);
 
+//! The policy used to bind the threads to CPU cores ('none', 'compact' or 'scatter')
+NEW_PROP_TAG(ThreadBinding);
+
 //! use locking to prevent race conditions when linearizing the global system of
 //! equations in multi-threaded mode. (setting this property to true is always save, but
 //! it may slightly deter performance in multi-threaded simlations and some
 //! discretizations do not need this.)
 NEW_PROP_TAG(UseLinearizationLock);
 
+//! linearize the elements color by color in multi-threaded mode. elements of the same
+//! color do not share any primary degrees of freedom, so their contributions can be added
+//! to the global system of equations without locking. (if this is enabled, the
+//! UseLinearizationLock property is ignored.)
+NEW_PROP_TAG(UseLinearizationColoring);
+
+//! only re-linearize the elements for which the weighted change of the primary variables
+//! of a degree of freedom of their stencil exceeds this value since the last
+//! linearization. the other elements keep their previous contributions to the global
+//! system of equations. (0 disables this, i.e., all elements are always linearized.)
+NEW_PROP_TAG(ActiveSetLinearizationTolerance);
+
+//! compute the intensive quantities of all degrees of freedom in a separate pass before
+//! the elements are linearized. (this only has an effect if the intensive quantity cache
+//! is enabled.)
+NEW_PROP_TAG(PrecomputeIntensiveQuantities);
+
+//! let the auxiliary modules (e.g., wells) evaluate their equations while the elements
+//! are linearized instead of afterwards. (this has no effect if the elements are
+//! linearized color by color.)
+NEW_PROP_TAG(OverlapAuxiliaryLinearization);
+
 // high-level simulation control
 
 //! Manages the simulation time
@@ -189,6 +252,15 @@ NEW_PROP_TAG(EnableGridAdaptation);
  */
 NEW_PROP_TAG(EnableVtkOutput);
 
+/*!
+ * \brief Specify whether the buffers of the output modules are released after the
+ *        results of a time step have been written.
+ *
+ * This reduces the memory footprint of the simulation between two writes at the cost
+ * of allocating the buffers again for each write.
+ */
+NEW_PROP_TAG(FreeOutputBuffers);
+
 /*!
  * \brief Specify the format the VTK output is written to disk
  *
@@ -197,9 +269,49 @@ NEW_PROP_TAG(EnableVtkOutput);
  *   - Dune::VTK::base64
  *   - Dune::VTK::appendedraw
  *   - Dune::VTK::appendedbase64
+ *
+ * The raw appended format is written by Ewoms::VtkAppendedWriter and can optionally
+ * be compressed (cf. the VtkCompression property).
  */
 NEW_PROP_TAG(VtkOutputFormat);
 
+/*!
+ * \brief The algorithm which is used to compress the raw binary VTK output.
+ *
+ * Possible values are 'none', 'zlib' and 'lz4'.
+ */
+NEW_PROP_TAG(VtkCompression);
+
+/*!
+ * \brief Specify whether the VTK output files are encoded and written by a
+ *        background thread while the simulation proceeds.
+ */
+NEW_PROP_TAG(EnableAsyncVtkOutput);
+
+/*!
+ * \brief The maximum number of VTK output files which may wait to be written if the
+ *        asynchronous VTK output is enabled.
+ *
+ * If this number is reached, the simulation waits until the oldest file is written.
+ */
+NEW_PROP_TAG(MaxPendingVtkWrites);
+
+/*!
+ * \brief Global switch to enable or disable writing the output into a single HDF5
+ *        file which is indexed by an XDMF file.
+ *
+ * The HDF5 output uses the same output modules as the VTK output, i.e., the
+ * WriteVtk$FOO options also select the fields of the HDF5 output.
+ */
+NEW_PROP_TAG(EnableHdfOutput);
+
+/*!
+ * \brief The level of the deflate compression of the HDF5 output.
+ *
+ * Possible values are between 0 (no compression) and 9 (best compression).
+ */
+NEW_PROP_TAG(HdfCompressionLevel);
+
 //! Specify whether the some degrees of fredom can be constraint
 NEW_PROP_TAG(EnableConstraints);
 
@@ -223,6 +335,15 @@ NEW_PROP_TAG(MinTimeStepSize);
  */
 NEW_PROP_TAG(MaxTimeStepDivisions);
 
+/*!
+ * \brief The relative change of the solution per time step at which the PID time step
+ *        controller aims.
+ *
+ * A value of 0 disables the controller, i.e., the time step size is only chosen based
+ * on the number of Newton iterations.
+ */
+NEW_PROP_TAG(TimeStepControlTargetChange);
+
 /*!
  * \brief Specify whether all intensive quantities for the grid should be
  *        cached in the discretization.
@@ -242,6 +363,24 @@ NEW_PROP_TAG(EnableIntensiveQuantityCache);
  */
 NEW_PROP_TAG(EnableStorageCache);
 
+/*!
+ * \brief Specify whether the cached storage terms of the previous time step are
+ *        written to binary restart files.
+ *
+ * If this is enabled, the storage terms do not need to be recalculated for the first
+ * time step after a restart.
+ */
+NEW_PROP_TAG(RestartWithCaches);
+
+/*!
+ * \brief The order of the polynomial used to extrapolate the initial guess of the
+ *        Newton method from the solutions of the previous time steps.
+ *
+ * 0 means that the solution of the last time step is used as the initial guess, 1
+ * means linear and 2 means quadratic extrapolation.
+ */
+NEW_PROP_TAG(SolutionPredictorOrder);
+
 /*!
  * \brief Specify whether to use the already calculated solutions as
  *        starting values of the intensive quantities.
@@ -282,11 +421,30 @@ NEW_PROP_TAG(BorderListCreator);
  */
 NEW_PROP_TAG(TimeDiscHistorySize);
 
+/*!
+ * \brief The time discretization ('implicit-euler' or 'bdf2')
+ *
+ * The second order backward differentiation formula requires a time discretization
+ * history size of at least 3.
+ */
+NEW_PROP_TAG(TimeDiscretization);
+
+/*!
+ * \brief The tolerance for the estimated local truncation error of the BDF2 time
+ *        discretization.
+ *
+ * The error is measured using the weights of the primary variables. A value of 0
+ * disables the control of the time step size based on the error estimate.
+ */
+NEW_PROP_TAG(TimeDiscTolerance);
+
 /*!
  * \brief Specify whether the gradients in the center of the SCVs need
  *        to be updated.
  *
- * Most models don't need this, but the (Navier-)Stokes ones do...
+ * Most models don't need this, but the (Navier-)Stokes ones do... If this is disabled,
+ * the element context refers to the intensive quantity cache of the model instead of
+ * copying the cached objects.
  */
 NEW_PROP_TAG(RequireScvCenterGradients);
 
@@ -0,0 +1,376 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \copydoc Ewoms::FvBaseSubdomainSolver
+ */
+#ifndef EWOMS_FV_BASE_SUBDOMAIN_SOLVER_HH
+#define EWOMS_FV_BASE_SUBDOMAIN_SOLVER_HH
+
+#include <ewoms/common/propertysystem.hh>
+#include <ewoms/parallel/locks.hh>
+#include <ewoms/parallel/threadmanager.hh>
+#include <ewoms/parallel/threadlocalobjects.hh>
+
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/bvector.hh>
+#include <dune/istl/operators.hh>
+#include <dune/istl/preconditioners.hh>
+#include <dune/istl/solvers.hh>
+#include <dune/common/fmatrix.hh>
+#include <dune/common/fvector.hh>
+#include <dune/common/version.hh>
+
+#include <algorithm>
+#include <cmath>
+#include <set>
+#include <vector>
+
+namespace Ewoms {
+namespace Properties {
+// forward declaration of the required property tags
+NEW_PROP_TAG(Scalar);
+NEW_PROP_TAG(Simulator);
+NEW_PROP_TAG(Model);
+NEW_PROP_TAG(ElementContext);
+NEW_PROP_TAG(GlobalEqVector);
+NEW_PROP_TAG(Stencil);
+NEW_PROP_TAG(GridView);
+NEW_PROP_TAG(NumEq);
+NEW_PROP_TAG(EnableConstraints);
+} // namespace Properties
+
+/*!
+ * \ingroup FiniteVolumeDiscretizations
+ *
+ * \brief Linearizes and solves the non-linear system of equations restricted to a
+ *        subset of the degrees of freedom of the local process.
+ *
+ * The subdomain consists of the degrees of freedom where the residual is large plus
+ * their direct neighbors. The primary variables of all other degrees of freedom are
+ * kept fixed, i.e., they act as a Dirichlet condition for the subdomain. The
+ * linearization only considers the elements which have one of the subdomain's degrees
+ * of freedom as a primary degree of freedom: For these, the residual and all Jacobian
+ * entries which couple two degrees of freedom of the subdomain are complete.
+ *
+ * Degrees of freedom which are a primary degree of freedom of an element that is not
+ * in the interior of the process' grid partition are never part of the subdomain.
+ * This makes sure that the subdomains of the processes do not overlap, so their
+ * solutions only need to be communicated to the ghost and overlap degrees of freedom
+ * of the neighboring processes afterwards.
+ */
+template <class TypeTag>
+class FvBaseSubdomainSolver
+{
+    typedef typename GET_PROP_TYPE(TypeTag, Scalar) Scalar;
+    typedef typename GET_PROP_TYPE(TypeTag, Simulator) Simulator;
+    typedef typename GET_PROP_TYPE(TypeTag, Model) Model;
+    typedef typename GET_PROP_TYPE(TypeTag, ElementContext) ElementContext;
+    typedef typename GET_PROP_TYPE(TypeTag, GlobalEqVector) GlobalEqVector;
+    typedef typename GET_PROP_TYPE(TypeTag, Stencil) Stencil;
+    typedef typename GET_PROP_TYPE(TypeTag, GridView) GridView;
+
+    typedef typename GridView::template Codim<0>::Entity Element;
+
+    enum { numEq = GET_PROP_VALUE(TypeTag, NumEq) };
+    enum { enableConstraints = GET_PROP_VALUE(TypeTag, EnableConstraints) };
+
+    typedef Dune::FieldMatrix<Scalar, numEq, numEq> MatrixBlock;
+    typedef Dune::FieldVector<Scalar, numEq> VectorBlock;
+
+public:
+    typedef Dune::BCRSMatrix<MatrixBlock> Matrix;
+    typedef Dune::BlockVector<VectorBlock> Vector;
+
+    FvBaseSubdomainSolver(Simulator& simulator)
+        : simulator_(simulator)
+    {}
+
+    /*!
+     * \brief Determine the degrees of freedom of the subdomain.
+     *
+     * \param residual The global residual which is used to locate the degrees of
+     *                 freedom where the residual is large
+     * \param threshold The weighted residual of a degree of freedom must be larger than
+     *                  this value for it to become part of the subdomain
+     * \return The number of degrees of freedom of the subdomain
+     */
+    size_t selectDofs(const GlobalEqVector& residual, Scalar threshold)
+    {
+        const auto& model = model_();
+        const auto& linearizer = model.linearizer();
+        const auto& grid = simulator_.gridView().grid();
+        const auto& elemSeeds = model.elementSeeds();
+        size_t numGridDof = model.numGridDof();
+
+        // find the degrees of freedom where the residual is large
+        std::vector<char> isBad(numGridDof, 0);
+        for (unsigned dofIdx = 0; dofIdx < numGridDof; ++dofIdx) {
+            if (model.dofTotalVolume(dofIdx) <= 0.0)
+                continue;
+
+            const auto& r = residual[dofIdx];
+            for (unsigned eqIdx = 0; eqIdx < numEq; ++eqIdx) {
+                if (std::abs(r[eqIdx]*model.eqWeight(dofIdx, eqIdx)) > threshold) {
+                    isBad[dofIdx] = 1;
+                    break;
+                }
+            }
+        }
+
+        // add the degrees of freedom whose elements are affected by these and determine
+        // the degrees of freedom which cannot be part of the subdomain
+        std::vector<char> isSelected(numGridDof, 0);
+        std::vector<char> isEligible(numGridDof, 1);
+        Stencil stencil(simulator_.gridView(), model.dofMapper());
+        for (size_t elemIdx = 0; elemIdx < elemSeeds.size(); ++elemIdx) {
+            const Element& elem = element_(grid, elemSeeds[elemIdx]);
+            stencil.update(elem);
+
+            bool isInterior = (elem.partitionType() == Dune::InteriorEntity);
+            bool touchesBadDof = false;
+            for (unsigned dofIdx = 0; dofIdx < stencil.numDof(); ++dofIdx) {
+                unsigned globalIdx = stencil.globalSpaceIndex(dofIdx);
+                if (globalIdx < numGridDof && isBad[globalIdx]) {
+                    touchesBadDof = true;
+                    break;
+                }
+            }
+
+            for (unsigned dofIdx = 0; dofIdx < stencil.numPrimaryDof(); ++dofIdx) {
+                unsigned globalIdx = stencil.globalSpaceIndex(dofIdx);
+                if (!isInterior)
+                    isEligible[globalIdx] = 0;
+                if (touchesBadDof)
+                    isSelected[globalIdx] = 1;
+            }
+        }
+
+        localIdx_.assign(numGridDof, -1);
+        dofs_.clear();
+        for (unsigned dofIdx = 0; dofIdx < numGridDof; ++dofIdx) {
+            if (!isSelected[dofIdx] || !isEligible[dofIdx])
+                continue;
+            if (model.dofTotalVolume(dofIdx) <= 0.0)
+                continue;
+            if (enableConstraints && linearizer.isConstraintDof(dofIdx))
+                continue;
+
+            localIdx_[dofIdx] = static_cast<int>(dofs_.size());
+            dofs_.push_back(dofIdx);
+        }
+
+        // determine the elements which need to be linearized and the sparsity pattern
+        // of the subdomain's Jacobian matrix
+        elements_.clear();
+        std::vector<std::set<unsigned> > pattern(dofs_.size());
+        for (size_t elemIdx = 0; elemIdx < elemSeeds.size() && !dofs_.empty(); ++elemIdx) {
+            const Element& elem = element_(grid, elemSeeds[elemIdx]);
+            if (elem.partitionType() != Dune::InteriorEntity)
+                continue;
+
+            stencil.update(elem);
+            bool isNeeded = false;
+            for (unsigned primaryDofIdx = 0; primaryDofIdx < stencil.numPrimaryDof(); ++primaryDofIdx) {
+                int localI = localIdx_[stencil.globalSpaceIndex(primaryDofIdx)];
+                if (localI < 0)
+                    continue;
+
+                isNeeded = true;
+                for (unsigned dofIdx = 0; dofIdx < stencil.numDof(); ++dofIdx) {
+                    unsigned globalJ = stencil.globalSpaceIndex(dofIdx);
+                    if (globalJ < numGridDof && localIdx_[globalJ] >= 0)
+                        pattern[static_cast<size_t>(localIdx_[globalJ])].insert(static_cast<unsigned>(localI));
+                }
+            }
+
+            if (isNeeded)
+                elements_.push_back(static_cast<unsigned>(elemIdx));
+        }
+
+        size_t numNonZeros = 0;
+        for (size_t rowIdx = 0; rowIdx < pattern.size(); ++rowIdx)
+            numNonZeros += pattern[rowIdx].size();
+
+        jacobian_ = Matrix();
+        jacobian_.setSize(dofs_.size(), dofs_.size(), numNonZeros);
+        jacobian_.setBuildMode(Matrix::row_wise);
+        auto createIt = jacobian_.createbegin();
+        for (size_t rowIdx = 0; createIt != jacobian_.createend(); ++createIt, ++rowIdx) {
+            auto colIt = pattern[rowIdx].begin();
+            const auto& colEndIt = pattern[rowIdx].end();
+            for (; colIt != colEndIt; ++colIt)
+                createIt.insert(*colIt);
+        }
+        residual_.resize(dofs_.size());
+
+        return dofs_.size();
+    }
+
+    /*!
+     * \brief Returns the global indices of the degrees of freedom of the subdomain.
+     */
+    const std::vector<unsigned>& dofs() const
+    { return dofs_; }
+
+    /*!
+     * \brief Returns the residual of the subdomain's degrees of freedom for the last
+     *        linearization.
+     */
+    const Vector& residual() const
+    { return residual_; }
+
+    /*!
+     * \brief Linearize the subdomain for the current solution.
+     *
+     * The intensive quantities of the subdomain's degrees of freedom must have been
+     * invalidated if their primary variables were changed.
+     *
+     * \return The maximum weighted residual of the subdomain's degrees of freedom
+     */
+    Scalar linearize()
+    {
+        auto& model = model_();
+        const auto& grid = simulator_.gridView().grid();
+        const auto& elemSeeds = model.elementSeeds();
+
+        if (elementCtx_.empty())
+            elementCtx_.create(ThreadManager::maxThreads(), simulator_);
+
+        jacobian_ = 0.0;
+        residual_ = 0.0;
+
+        int numElems = static_cast<int>(elements_.size());
+#ifdef _OPENMP
+#pragma omp parallel for schedule(guided)
+#endif
+        for (int i = 0; i < numElems; ++i) {
+            const Element& elem = element_(grid, elemSeeds[elements_[static_cast<size_t>(i)]]);
+
+            unsigned threadId = ThreadManager::threadId();
+            ElementContext& elemCtx = elementCtx_[threadId];
+            elemCtx.updateAll(elem);
+
+            auto& localLinearizer = model.localLinearizer(threadId);
+            localLinearizer.linearize(elemCtx);
+
+            ScopedLock lock(mutex_);
+            unsigned numPrimaryDof = elemCtx.numPrimaryDof(/*timeIdx=*/0);
+            for (unsigned primaryDofIdx = 0; primaryDofIdx < numPrimaryDof; ++primaryDofIdx) {
+                unsigned globalI = elemCtx.globalSpaceIndex(primaryDofIdx, /*timeIdx=*/0);
+                int localI = localIdx_[globalI];
+                if (localI < 0)
+                    continue;
+
+                residual_[static_cast<size_t>(localI)] += localLinearizer.residual(primaryDofIdx);
+                for (unsigned dofIdx = 0; dofIdx < elemCtx.numDof(/*timeIdx=*/0); ++dofIdx) {
+                    unsigned globalJ = elemCtx.globalSpaceIndex(dofIdx, /*timeIdx=*/0);
+                    if (globalJ >= localIdx_.size() || localIdx_[globalJ] < 0)
+                        continue;
+
+                    size_t localJ = static_cast<size_t>(localIdx_[globalJ]);
+                    jacobian_[localJ][static_cast<size_t>(localI)] +=
+                        localLinearizer.jacobian(dofIdx, primaryDofIdx);
+                }
+            }
+        }
+
+        Scalar error = 0.0;
+        for (size_t localIdx = 0; localIdx < dofs_.size(); ++localIdx) {
+            unsigned dofIdx = dofs_[localIdx];
+            for (unsigned eqIdx = 0; eqIdx < numEq; ++eqIdx)
+                error = std::max<Scalar>(error,
+                                         std::abs(residual_[localIdx][eqIdx]
+                                                  *model.eqWeight(dofIdx, eqIdx)));
+        }
+
+        return error;
+    }
+
+    /*!
+     * \brief Solve the linear system of the last linearization of the subdomain.
+     *
+     * The system is solved by the stabilized BiCG method preconditioned by ILU(0).
+     *
+     * \param update Receives the update of the primary variables of the subdomain's
+     *               degrees of freedom, i.e., they must be decreased by it
+     * \return true if the linear solver converged
+     */
+    bool solve(Vector& update)
+    {
+        typedef Dune::MatrixAdapter<Matrix, Vector, Vector> Operator;
+        typedef Dune::SeqILU0<Matrix, Vector, Vector> Preconditioner;
+
+        Operator op(jacobian_);
+        Preconditioner preCond(jacobian_, /*relaxationFactor=*/1.0);
+        Dune::BiCGSTABSolver<Vector> solver(op,
+                                            preCond,
+                                            /*reduction=*/1e-5,
+                                            /*maxIterations=*/500,
+                                            /*verbosity=*/0);
+
+        // the solver overwrites the right hand side
+        Vector rhs(residual_);
+        update.resize(dofs_.size());
+        update = 0.0;
+        Dune::InverseOperatorResult result;
+        solver.apply(update, rhs, result);
+
+        return result.converged && std::isfinite(update.two_norm());
+    }
+
+private:
+    Model& model_()
+    { return simulator_.model(); }
+
+    template <class Grid, class ElementSeed>
+    static Element element_(const Grid& grid, const ElementSeed& seed)
+    {
+#if DUNE_VERSION_NEWER(DUNE_GRID, 2, 4)
+        return grid.entity(seed);
+#else
+        return *grid.entity(seed);
+#endif
+    }
+
+    Simulator& simulator_;
+
+    // the global indices of the subdomain's degrees of freedom and the index of each
+    // global degree of freedom in the subdomain (-1 if it is not part of it)
+    std::vector<unsigned> dofs_;
+    std::vector<int> localIdx_;
+
+    // the indices of the elements which need to be linearized
+    std::vector<unsigned> elements_;
+
+    Matrix jacobian_;
+    Vector residual_;
+
+    ThreadLocalObjects<ElementContext> elementCtx_;
+    OmpMutex mutex_;
+};
+
+} // namespace Ewoms
+
+#endif
@@ -0,0 +1,66 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \copydoc Ewoms::LinearizationType
+ */
+#ifndef EWOMS_LINEARIZATION_TYPE_HH
+#define EWOMS_LINEARIZATION_TYPE_HH
+
+namespace Ewoms {
+
+/*!
+ * \ingroup FiniteVolumeDiscretizations
+ *
+ * \brief Specifies the solution of the time discretization with regard to which the
+ *        residual is differentiated.
+ *
+ * For the usual forward simulation, the Jacobian is the derivative of the residual with
+ * regard to the most recent solution (i.e., time index 0). For sensitivity analysis, it
+ * is also required to know the derivatives with regard to the solution at the beginning
+ * of the time step (time index 1).
+ */
+struct LinearizationType
+{
+    LinearizationType()
+        : time(0)
+    {}
+
+    explicit LinearizationType(unsigned timeIdx)
+        : time(timeIdx)
+    {}
+
+    bool operator==(const LinearizationType& other) const
+    { return time == other.time; }
+
+    bool operator!=(const LinearizationType& other) const
+    { return !(*this == other); }
+
+    //! The time index of the solution w.r.t. which the residual is differentiated
+    unsigned time;
+};
+
+} // namespace Ewoms
+
+#endif
@@ -129,6 +129,107 @@ namespace Ewoms
     };
 
 
+    template < class Grid, class Container >
+    class InvalidatingRestrictProlong;
+
+    template < class Grid, class Container >
+    struct InvalidatingRestrictProlongTraits
+    {
+      typedef typename Grid::ctype DomainFieldType;
+      typedef InvalidatingRestrictProlong< Grid, Container >  RestProlImp;
+    };
+
+    /** \brief Restriction and prolongation operator which marks the data of all
+     *         entities which are affected by the adaptation as invalid.
+     *
+     *  This is intended for data which cannot be transferred to the new entities in
+     *  a meaningful way, e.g., cached quantities which must be recomputed. The data
+     *  of those entities which are not touched by the adaptation is kept.
+     */
+    template< class Grid, class Container >
+    class InvalidatingRestrictProlong
+#if HAVE_DUNE_FEM
+    : public Dune::Fem::RestrictProlongInterfaceDefault< InvalidatingRestrictProlongTraits< Grid, Container > >
+#endif
+    {
+      typedef typename Container::Value Value;
+
+      Container& container_;
+      Value invalidValue_;
+    public:
+      typedef typename Grid::ctype DomainFieldType;
+
+      InvalidatingRestrictProlong( Container& container, const Value& invalidValue )
+        : container_( container ), invalidValue_( invalidValue )
+      {}
+
+      /** \brief explicit set volume ratio of son and father
+       *
+       *  \param[in]  weight  volume of son / volume of father
+       *
+       *  \note If this ratio is set, it is assume to be constant.
+       */
+      template <class Field>
+      void setFatherChildWeight(const Field& weight OPM_UNUSED) const
+      {}
+
+      //! invalidate the data of the father
+      template< class Entity >
+      void restrictLocal ( const Entity& father, const Entity& son OPM_UNUSED, bool initialize OPM_UNUSED ) const
+      {
+        // new entities must not refer to valid data
+        container_.resize( invalidValue_ );
+        assert( container_.codimension() == 0 );
+        container_[ father ] = invalidValue_;
+      }
+
+      //! invalidate the data of the father
+      template< class Entity, class LocalGeometry >
+      void restrictLocal(const Entity& father,
+                         const Entity& son,
+                         const LocalGeometry& geometryInFather OPM_UNUSED,
+                         bool initialize) const
+      { restrictLocal(father, son, initialize); }
+
+      //! invalidate the data of the children
+      template< class Entity >
+      void prolongLocal(const Entity& father OPM_UNUSED,
+                        const Entity& son,
+                        bool initialize OPM_UNUSED) const
+      {
+        container_.resize( invalidValue_ );
+        assert( container_.codimension() == 0 );
+        container_[ son ] = invalidValue_;
+      }
+
+      //! invalidate the data of the children
+      template< class Entity, class LocalGeometry >
+      void prolongLocal(const Entity& father,
+                        const Entity& son,
+                        const LocalGeometry& geometryInFather OPM_UNUSED,
+                        bool initialize) const
+      { prolongLocal(father, son, initialize); }
+
+      /** \brief add discrete function to communicator
+       *  \param[in]  comm  Communicator to add the discrete functions to
+       */
+      template< class Communicator >
+      void addToList(Communicator& comm OPM_UNUSED)
+      { }
+
+      /** \brief add discrete function to load balancer
+       *  \param[in]  lb LoadBalancer to add the discrete functions to
+       *
+       *  The data is not migrated, i.e., entities which are received from other
+       *  processes exhibit the default value of the container, which thus must be
+       *  invalid.
+       */
+      template< class LoadBalancer >
+      void addToLoadBalancer(LoadBalancer& lb OPM_UNUSED)
+      { }
+    };
+
+
     class EmptyRestrictProlong;
 
     struct EmptyRestrictProlongTraits
@@ -112,6 +112,9 @@ SET_BOOL_PROP(EcfvDiscretization, LinearizeNonLocalElements, true);
 //! conditions cannot occur since each matrix/vector entry is written exactly once
 SET_BOOL_PROP(EcfvDiscretization, UseLinearizationLock, false);
 
+//! compute the geometry of the stencils on the fly by default
+SET_BOOL_PROP(EcfvDiscretization, EnableStencilCache, false);
+
 } // namespace Properties
 } // namespace Ewoms
 
@@ -132,11 +135,65 @@ class EcfvDiscretization : public FvBaseDiscretization<TypeTag>
     typedef typename GET_PROP_TYPE(TypeTag, SolutionVector) SolutionVector;
     typedef typename GET_PROP_TYPE(TypeTag, GridView) GridView;
     typedef typename GET_PROP_TYPE(TypeTag, Simulator) Simulator;
+    typedef typename GET_PROP_TYPE(TypeTag, Stencil) Stencil;
+    typedef typename Stencil::GeometryCache StencilGeometryCache;
 
 public:
     EcfvDiscretization(Simulator& simulator)
         : ParentType(simulator)
-    { }
+    {
+        enableStencilCache_ = EWOMS_GET_PARAM(TypeTag, bool, EnableStencilCache);
+    }
+
+    /*!
+     * \brief Register all run-time parameters for the model.
+     */
+    static void registerParameters()
+    {
+        ParentType::registerParameters();
+
+        EWOMS_REGISTER_PARAM(TypeTag, bool, EnableStencilCache,
+                             "Compute the geometry of the stencils of all elements once and re-use it afterwards");
+    }
+
+    /*!
+     * \copydoc FvBaseDiscretization::finishInit
+     */
+    void finishInit()
+    {
+        // the cache needs to be recomputed before any element context is updated
+        // because the grid may have changed
+        if (enableStencilCache_)
+            stencilGeometryCache_.update(this->gridView_, this->elementMapper());
+
+        ParentType::finishInit();
+    }
+
+    /*!
+     * \copydoc FvBaseDiscretization::adaptGrid
+     */
+    void adaptGrid()
+    {
+        if (!enableStencilCache_ || !this->enableGridAdaptation()) {
+            ParentType::adaptGrid();
+            return;
+        }
+
+        // the cached geometry refers to the elements of the grid before the adaptation,
+        // so it must not be used while the grid is modified
+        stencilGeometryCache_.clear();
+        ParentType::adaptGrid();
+        stencilGeometryCache_.update(this->gridView_, this->elementMapper());
+    }
+
+    /*!
+     * \copydoc FvBaseDiscretization::prepareStencil
+     */
+    void prepareStencil(Stencil& stencil) const
+    {
+        if (enableStencilCache_)
+            stencil.setGeometryCache(&stencilGeometryCache_);
+    }
 
     /*!
      * \brief Returns a string of discretization's human-readable name
@@ -190,7 +247,12 @@ public:
      */
     template <class Restarter>
     void serialize(Restarter& res)
-    { res.template serializeEntities</*codim=*/0>(asImp_(), this->gridView_); }
+    {
+        if (res.isBinary())
+            asImp_().serializeBlocks(res);
+        else
+            res.template serializeEntities</*codim=*/0>(asImp_(), this->gridView_);
+    }
 
     /*!
      * \brief Deserializes the state of the model.
@@ -202,8 +264,14 @@ public:
     template <class Restarter>
     void deserialize(Restarter& res)
     {
-        res.template deserializeEntities</*codim=*/0>(asImp_(), this->gridView_);
+        // binary restart files may contain the storage terms of the previous time step
+        this->invalidateStorageCache();
+        if (res.isBinary())
+            asImp_().deserializeBlocks(res);
+        else
+            res.template deserializeEntities</*codim=*/0>(asImp_(), this->gridView_);
         this->solution(/*timeIdx=*/1) = this->solution(/*timeIdx=*/0);
+        this->resetTimeDiscHistory();
     }
 
 private:
@@ -211,6 +279,9 @@ private:
     { return *static_cast<Implementation*>(this); }
     const Implementation& asImp_() const
     { return *static_cast<const Implementation*>(this); }
+
+    StencilGeometryCache stencilGeometryCache_;
+    bool enableStencilCache_;
 };
 } // namespace Ewoms
 
@@ -37,6 +37,16 @@ namespace Ewoms {
 namespace Properties {
 //! The type tag for models based on the ECFV-scheme
 NEW_TYPE_TAG(EcfvDiscretization, INHERITS_FROM(FvBaseDiscretization));
+
+/*!
+ * \brief Specify whether the geometry of the stencils of all elements should be
+ *        computed once and then be re-used.
+ *
+ * This avoids evaluating the geometry of the faces and of the elements each time an
+ * element context is updated, but requires memory proportional to the number of faces
+ * of the grid.
+ */
+NEW_PROP_TAG(EnableStencilCache);
 }} // namespace Properties, Ewoms
 
 #endif
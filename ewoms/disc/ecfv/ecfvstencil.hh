@@ -29,6 +29,7 @@
 #define EWOMS_ECFV_STENCIL_HH
 
 #include <ewoms/common/quadraturegeometries.hh>
+#include <ewoms/disc/common/cartesiangridpattern.hh>
 
 #include <dune/grid/common/mcmgmapper.hh>
 #include <dune/grid/common/intersectioniterator.hh>
@@ -147,6 +148,17 @@ public:
         { return elementPtr_->geometry(); }
 #endif
 
+        /*!
+         * \brief The element which corresponds to the sub-control volume.
+         */
+#if DUNE_VERSION_NEWER(DUNE_COMMON, 2, 4)
+        const Element& element() const
+        { return element_; }
+#else
+        const Element& element() const
+        { return *elementPtr_; }
+#endif
+
     private:
         GlobalPosition centerPos_;
         Scalar volume_;
@@ -228,13 +240,201 @@ public:
         unsigned short exteriorIdx_;
     };
 
+    /*!
+     * \brief The geometry of the stencils of all elements of a grid view.
+     *
+     * Computing the geometry of the faces and of the elements is usually the most
+     * expensive part of updating a stencil. This object computes it once for all
+     * elements of the grid view and stores it in flat arrays which are indexed by the
+     * element index. Stencils which have been told to use a cache only look up their
+     * data. The cache needs to be recomputed whenever the grid changes.
+     */
+    class GeometryCache
+    {
+    public:
+        GeometryCache()
+        {}
+
+        /*!
+         * \brief Compute the stencil geometry of all elements of a grid view.
+         */
+        void update(const GridView& gridView, const ElementMapper& mapper)
+        {
+            unsigned numElements = static_cast<unsigned>(gridView.size(/*codim=*/0));
+
+            subControlVolumes_.resize(numElements);
+            interiorFaceBegin_.assign(numElements + 1, 0);
+            boundaryFaceBegin_.assign(numElements + 1, 0);
+
+            // first pass: compute the sub-control volumes and count the faces
+            auto elemIt = gridView.template begin</*codim=*/0>();
+            const auto& elemEndIt = gridView.template end</*codim=*/0>();
+            for (; elemIt != elemEndIt; ++elemIt) {
+                const Element& elem = *elemIt;
+                unsigned elemIdx = mapIndex_(mapper, elem);
+
+#if DUNE_VERSION_NEWER(DUNE_COMMON, 2, 4)
+                subControlVolumes_[elemIdx] = SubControlVolume(elem);
+#else
+                subControlVolumes_[elemIdx] = SubControlVolume(ElementPointer(elem));
+#endif
+
+                auto isIt = gridView.ibegin(elem);
+                const auto& isEndIt = gridView.iend(elem);
+                for (; isIt != isEndIt; ++isIt) {
+                    if (isIt->neighbor())
+                        ++ interiorFaceBegin_[elemIdx + 1];
+                    else
+                        ++ boundaryFaceBegin_[elemIdx + 1];
+                }
+            }
+
+            for (unsigned elemIdx = 0; elemIdx < numElements; ++elemIdx) {
+                interiorFaceBegin_[elemIdx + 1] += interiorFaceBegin_[elemIdx];
+                boundaryFaceBegin_[elemIdx + 1] += boundaryFaceBegin_[elemIdx];
+            }
+
+            // second pass: compute the faces
+            interiorFaces_.resize(interiorFaceBegin_[numElements]);
+            neighborIndices_.resize(interiorFaceBegin_[numElements]);
+            boundaryFaces_.resize(boundaryFaceBegin_[numElements]);
+            elemIt = gridView.template begin</*codim=*/0>();
+            for (; elemIt != elemEndIt; ++elemIt) {
+                const Element& elem = *elemIt;
+                unsigned elemIdx = mapIndex_(mapper, elem);
+
+                unsigned interiorFaceIdx = interiorFaceBegin_[elemIdx];
+                unsigned boundaryFaceIdx = boundaryFaceBegin_[elemIdx];
+                unsigned localNeighborIdx = 1;
+                auto isIt = gridView.ibegin(elem);
+                const auto& isEndIt = gridView.iend(elem);
+                for (; isIt != isEndIt; ++isIt) {
+                    const auto& intersection = *isIt;
+                    if (intersection.neighbor()) {
+#if DUNE_VERSION_NEWER(DUNE_COMMON, 2, 4)
+                        neighborIndices_[interiorFaceIdx] = mapIndex_(mapper, intersection.outside());
+#else
+                        neighborIndices_[interiorFaceIdx] = mapIndex_(mapper, *intersection.outside());
+#endif
+                        interiorFaces_[interiorFaceIdx] =
+                            SubControlVolumeFace(intersection, localNeighborIdx);
+                        ++ interiorFaceIdx;
+                        ++ localNeighborIdx;
+                    }
+                    else {
+                        boundaryFaces_[boundaryFaceIdx] =
+                            SubControlVolumeFace(intersection, - 10000);
+                        ++ boundaryFaceIdx;
+                    }
+                }
+            }
+        }
+
+        /*!
+         * \brief Release the memory used by the cache.
+         */
+        void clear()
+        {
+            subControlVolumes_.clear();
+            interiorFaceBegin_.clear();
+            boundaryFaceBegin_.clear();
+            interiorFaces_.clear();
+            neighborIndices_.clear();
+            boundaryFaces_.clear();
+        }
+
+        /*!
+         * \brief Returns the number of elements for which the geometry is cached.
+         */
+        unsigned numElements() const
+        { return static_cast<unsigned>(subControlVolumes_.size()); }
+
+        /*!
+         * \brief Returns the sub-control volume of an element.
+         */
+        const SubControlVolume& subControlVolume(unsigned elemIdx) const
+        { return subControlVolumes_[elemIdx]; }
+
+        /*!
+         * \brief Returns the number of interior faces of an element.
+         */
+        unsigned numInteriorFaces(unsigned elemIdx) const
+        { return interiorFaceBegin_[elemIdx + 1] - interiorFaceBegin_[elemIdx]; }
+
+        /*!
+         * \brief Returns an interior face of an element.
+         */
+        const SubControlVolumeFace& interiorFace(unsigned elemIdx, unsigned faceIdx) const
+        { return interiorFaces_[interiorFaceBegin_[elemIdx] + faceIdx]; }
+
+        /*!
+         * \brief Returns the index of the element on the exterior of an interior face.
+         */
+        unsigned neighborIndex(unsigned elemIdx, unsigned faceIdx) const
+        { return neighborIndices_[interiorFaceBegin_[elemIdx] + faceIdx]; }
+
+        /*!
+         * \brief Returns the number of boundary faces of an element.
+         */
+        unsigned numBoundaryFaces(unsigned elemIdx) const
+        { return boundaryFaceBegin_[elemIdx + 1] - boundaryFaceBegin_[elemIdx]; }
+
+        /*!
+         * \brief Returns a boundary face of an element.
+         */
+        const SubControlVolumeFace& boundaryFace(unsigned elemIdx, unsigned faceIdx) const
+        { return boundaryFaces_[boundaryFaceBegin_[elemIdx] + faceIdx]; }
+
+    private:
+        static unsigned mapIndex_(const ElementMapper& mapper, const Element& elem)
+        {
+#if DUNE_VERSION_NEWER(DUNE_COMMON, 2, 4)
+            return static_cast<unsigned>(mapper.index(elem));
+#else
+            return static_cast<unsigned>(mapper.map(elem));
+#endif
+        }
+
+        std::vector<SubControlVolume> subControlVolumes_;
+        std::vector<unsigned> interiorFaceBegin_;
+        std::vector<unsigned> boundaryFaceBegin_;
+        std::vector<SubControlVolumeFace> interiorFaces_;
+        std::vector<unsigned> neighborIndices_;
+        std::vector<SubControlVolumeFace> boundaryFaces_;
+    };
+
     EcfvStencil(const GridView& gridView, const Mapper& mapper)
         : gridView_(gridView)
         , elementMapper_(mapper)
-    { }
+    {
+        geometryCache_ = 0;
+        cachedElemIdx_ = -1;
+    }
+
+    /*!
+     * \brief Use precomputed geometry for the subsequent calls to update().
+     *
+     * If a null pointer is passed, the geometry is computed on the fly. The cache must
+     * outlive the stencil.
+     */
+    void setGeometryCache(const GeometryCache* cache)
+    {
+        geometryCache_ = cache;
+        cachedElemIdx_ = -1;
+    }
 
     void updateTopology(const Element& element)
     {
+        if (geometryCache_ && geometryCache_->numElements() > 0) {
+#if DUNE_VERSION_NEWER(DUNE_COMMON, 2, 4)
+            cachedElemIdx_ = static_cast<int>(elementMapper_.index(element));
+#else
+            cachedElemIdx_ = static_cast<int>(elementMapper_.map(element));
+#endif
+            return;
+        }
+        cachedElemIdx_ = -1;
+
         auto isIt = gridView_.ibegin(element);
         const auto& endIsIt = gridView_.iend(element);
 
@@ -274,6 +474,10 @@ public:
 
     void updatePrimaryTopology(const Element& element)
     {
+        // the primary topology is only the central element, which is cheap enough to
+        // not bother with the cache
+        cachedElemIdx_ = -1;
+
 #if DUNE_VERSION_NEWER(DUNE_COMMON, 2, 4)
         // add the "center" element of the stencil
         subControlVolumes_.clear();
@@ -318,7 +522,11 @@ public:
      *        current element interacts with.
      */
     size_t numDof() const
-    { return subControlVolumes_.size(); }
+    {
+        if (cachedElemIdx_ >= 0)
+            return 1 + geometryCache_->numInteriorFaces(static_cast<unsigned>(cachedElemIdx_));
+        return subControlVolumes_.size();
+    }
 
     /*!
      * \brief Returns the number of degrees of freedom which are contained
@@ -340,6 +548,13 @@ public:
     {
         assert(0 <= dofIdx && dofIdx < numDof());
 
+        if (cachedElemIdx_ >= 0) {
+            unsigned elemIdx = static_cast<unsigned>(cachedElemIdx_);
+            if (dofIdx == 0)
+                return elemIdx;
+            return geometryCache_->neighborIndex(elemIdx, dofIdx - 1);
+        }
+
 #if DUNE_VERSION_NEWER(DUNE_COMMON, 2, 4)
         return static_cast<unsigned>(elementMapper_.index(element(dofIdx)));
 #else
@@ -351,7 +566,7 @@ public:
      * \brief Return partition type of a given degree of freedom
      */
     Dune::PartitionType partitionType(unsigned dofIdx) const
-    { return elements_[dofIdx]->partitionType(); }
+    { return element(dofIdx).partitionType(); }
 
     /*!
      * \brief Return the element given the index of a degree of
@@ -364,6 +579,9 @@ public:
     {
         assert(0 <= dofIdx && dofIdx < numDof());
 
+        if (cachedElemIdx_ >= 0)
+            return subControlVolume(dofIdx).element();
+
 #if DUNE_VERSION_NEWER(DUNE_COMMON, 2, 4)
         return elements_[dofIdx];
 #else
@@ -385,33 +603,53 @@ public:
      *        given degree of freedom.
      */
     const SubControlVolume& subControlVolume(unsigned dofIdx) const
-    { return subControlVolumes_[dofIdx]; }
+    {
+        if (cachedElemIdx_ >= 0)
+            return geometryCache_->subControlVolume(globalSpaceIndex(dofIdx));
+        return subControlVolumes_[dofIdx];
+    }
 
     /*!
      * \brief Returns the number of interior faces of the stencil.
      */
     size_t numInteriorFaces() const
-    { return interiorFaces_.size(); }
+    {
+        if (cachedElemIdx_ >= 0)
+            return geometryCache_->numInteriorFaces(static_cast<unsigned>(cachedElemIdx_));
+        return interiorFaces_.size();
+    }
 
     /*!
      * \brief Returns the face object belonging to a given face index
      *        in the interior of the domain.
      */
     const SubControlVolumeFace& interiorFace(unsigned bfIdx) const
-    { return interiorFaces_[bfIdx]; }
+    {
+        if (cachedElemIdx_ >= 0)
+            return geometryCache_->interiorFace(static_cast<unsigned>(cachedElemIdx_), bfIdx);
+        return interiorFaces_[bfIdx];
+    }
 
     /*!
      * \brief Returns the number of boundary faces of the stencil.
      */
     size_t numBoundaryFaces() const
-    { return boundaryFaces_.size(); }
+    {
+        if (cachedElemIdx_ >= 0)
+            return geometryCache_->numBoundaryFaces(static_cast<unsigned>(cachedElemIdx_));
+        return boundaryFaces_.size();
+    }
 
     /*!
      * \brief Returns the boundary face object belonging to a given
      *        boundary face index.
      */
     const SubControlVolumeFace& boundaryFace(unsigned bfIdx) const
-    { return boundaryFaces_[bfIdx]; }
+    {
+        if (cachedElemIdx_ >= 0)
+            return geometryCache_->boundaryFace(static_cast<unsigned>(cachedElemIdx_), bfIdx);
+        return boundaryFaces_[bfIdx];
+    }
 
 protected:
     const GridView&       gridView_;
@@ -426,8 +664,18 @@ protected:
     std::vector<SubControlVolume>      subControlVolumes_;
     std::vector<SubControlVolumeFace>  interiorFaces_;
     std::vector<SubControlVolumeFace>  boundaryFaces_;
+
+    const GeometryCache* geometryCache_;
+    int cachedElemIdx_;
 };
 
+/*!
+ * \brief The ECFV stencil consists of an element and its face neighbors.
+ */
+template <class Scalar, class GridView>
+struct StencilIsFaceNeighborhood<EcfvStencil<Scalar, GridView> >
+{ static const bool value = true; };
+
 } // namespace Ewoms
 
 
@@ -36,6 +36,7 @@
 #include <dune/common/version.hh>
 
 #include <dune/geometry/type.hh>
+#include <dune/geometry/typeindex.hh>
 
 #if HAVE_DUNE_LOCALFUNCTIONS
 #include <dune/localfunctions/lagrange/pqkfactory.hh>
@@ -85,6 +86,20 @@ class P1FeGradientCalculator : public FvBaseGradientCalculator<TypeTag>
     typedef typename LocalFiniteElementCache::FiniteElementType LocalFiniteElement;
     typedef typename LocalFiniteElement::Traits::LocalBasisType::Traits LocalBasisTraits;
     typedef typename LocalBasisTraits::JacobianType ShapeJacobian;
+
+    // the values and the gradients in local coordinates of the shape functions at the
+    // sub-control-volume faces. since the positions of the faces in local coordinates
+    // only depend on the reference element, they are only evaluated once for each
+    // geometry type.
+    struct ReferenceData_
+    {
+        ReferenceData_()
+        { isInitialized = false; }
+
+        bool isInitialized;
+        std::vector<Dune::FieldVector<Scalar, 1>> value[maxFap];
+        DimVector localGradient[maxFap][maxDof];
+    };
 #endif // HAVE_DUNE_LOCALFUNCTIONS
 
 public:
@@ -109,36 +124,37 @@ public:
                       "It is only required to conditionally disable this method!");
 
         const auto& stencil = elemCtx.stencil(timeIdx);
+        const auto& elem = elemCtx.element();
 
-        const LocalFiniteElement& localFE = feCache_.get(elemCtx.element().type());
+        const LocalFiniteElement& localFE = feCache_.get(elem.type());
         localFiniteElement_ = &localFE;
 
-        // loop over all face centeres
-        for (unsigned faceIdx = 0; faceIdx < stencil.numInteriorFaces(); ++faceIdx) {
-            const auto& localFacePos = stencil.interiorFace(faceIdx).localPos();
-
-            // Evaluate the P1 shape functions and their gradients at all
-            // flux approximation points.
-            if (prepareValues)
-                localFE.localBasis().evaluateFunction(localFacePos, p1Value_[faceIdx]);
-
-            if (prepareGradients) {
-                // first, get the shape function's gradient in local coordinates
-                std::vector<ShapeJacobian> localGradient;
-                localFE.localBasis().evaluateJacobian(localFacePos, localGradient);
-
-                // convert to a gradient in global space by
-                // multiplying with the inverse transposed jacobian of
-                // the position
-                const auto& geom = elemCtx.element().geometry();
-                const auto& jacInvT =
-                    geom.jacobianInverseTransposed(localFacePos);
-
-                size_t numVertices = elemCtx.numDof(timeIdx);
-                for (unsigned vertIdx = 0; vertIdx < numVertices; vertIdx++) {
-                    jacInvT.mv(/*xVector=*/localGradient[vertIdx][0],
+        // the shape function values are directly taken from the reference data
+        referenceDataIdx_ = Dune::LocalGeometryTypeIndex::index(elem.type());
+        const ReferenceData_& refData = referenceData_(localFE, stencil);
+
+        if (!prepareGradients)
+            return;
+
+        // convert the gradients in local coordinates to gradients in global space by
+        // multiplying them with the inverse transposed jacobian of the position. for
+        // affine geometries, the jacobian is the same for all faces.
+        const auto& geom = elem.geometry();
+        size_t numVertices = elemCtx.numDof(timeIdx);
+        if (geom.affine()) {
+            const auto jacInvT = geom.jacobianInverseTransposed(stencil.interiorFace(0).localPos());
+            for (unsigned faceIdx = 0; faceIdx < stencil.numInteriorFaces(); ++faceIdx)
+                for (unsigned vertIdx = 0; vertIdx < numVertices; vertIdx++)
+                    jacInvT.mv(/*xVector=*/refData.localGradient[faceIdx][vertIdx],
+                               /*destVector=*/p1Gradient_[faceIdx][vertIdx]);
+        }
+        else {
+            for (unsigned faceIdx = 0; faceIdx < stencil.numInteriorFaces(); ++faceIdx) {
+                const auto jacInvT =
+                    geom.jacobianInverseTransposed(stencil.interiorFace(faceIdx).localPos());
+                for (unsigned vertIdx = 0; vertIdx < numVertices; vertIdx++)
+                    jacInvT.mv(/*xVector=*/refData.localGradient[faceIdx][vertIdx],
                                /*destVector=*/p1Gradient_[faceIdx][vertIdx]);
-                }
             }
         }
 #endif
@@ -192,7 +208,7 @@ public:
         QuantityType tmp;
         for (unsigned vertIdx = 0; vertIdx < elemCtx.numDof(/*timeIdx=*/0); ++vertIdx) {
             tmp = quantityCallback(vertIdx);
-            tmp *= p1Value_[fapIdx][vertIdx];
+            tmp *= referenceDataCache_[referenceDataIdx_].value[fapIdx][vertIdx];
             value += tmp;
         }
         return value;
@@ -267,6 +283,69 @@ public:
         return ParentType::calculateGradient(quantityGrad, elemCtx, fapIdx, quantityCallback);
     }
 
+    /*!
+     * \brief Calculates the gradients of several quantities at any flux approximation
+     *        point.
+     *
+     * The shape function gradients of each vertex are only loaded once for all
+     * quantities.
+     *
+     * \param quantityGrads An array with \c numQuantities entries for the results
+     * \param elemCtx The current execution context
+     * \param fapIdx The local index of the flux approximation point
+     *               in the current element's stencil.
+     * \param quantityCallback A callable object returning the value of a quantity given
+     *               the index of a degree of freedom and the index of the quantity
+     * \param numQuantities The number of quantities for which the gradient is calculated
+     */
+    template <class QuantityCallback, class EvalDimVector, class Dummy = unsigned>
+    void calculateGradients(EvalDimVector* EWOMS_NO_LOCALFUNCTIONS_UNUSED quantityGrads,
+                            const ElementContext& EWOMS_NO_LOCALFUNCTIONS_UNUSED elemCtx,
+                            typename std::enable_if<GET_PROP_VALUE(TypeTag, UseP1FiniteElementGradients),
+                                                    Dummy>::type EWOMS_NO_LOCALFUNCTIONS_UNUSED fapIdx,
+                            const QuantityCallback& EWOMS_NO_LOCALFUNCTIONS_UNUSED quantityCallback,
+                            unsigned EWOMS_NO_LOCALFUNCTIONS_UNUSED numQuantities) const
+    {
+#if !HAVE_DUNE_LOCALFUNCTIONS
+        // The dune-localfunctions module is required for P1 finite element gradients
+        OPM_THROW(std::logic_error, "The dune-localfunctions module is required in oder to use"
+                  " finite element gradients");
+#else
+        static_assert(std::is_same<Dummy, unsigned>::value,
+                      "The 'Dummy' template parameter must _not_ be specified explicitly."
+                      "It is only required to conditionally disable this method!");
+
+        for (unsigned quantityIdx = 0; quantityIdx < numQuantities; ++quantityIdx)
+            quantityGrads[quantityIdx] = 0.0;
+
+        for (unsigned vertIdx = 0; vertIdx < elemCtx.numDof(/*timeIdx=*/0); ++vertIdx) {
+            const DimVector& shapeGrad = p1Gradient_[fapIdx][vertIdx];
+            for (unsigned quantityIdx = 0; quantityIdx < numQuantities; ++quantityIdx) {
+                Scalar dofVal = quantityCallback(vertIdx, quantityIdx);
+
+                auto tmp = shapeGrad;
+                tmp *= dofVal;
+                quantityGrads[quantityIdx] += tmp;
+            }
+        }
+#endif
+    }
+
+    template <class QuantityCallback, class EvalDimVector, class Dummy=unsigned>
+    void calculateGradients(EvalDimVector* quantityGrads,
+                            const ElementContext& elemCtx,
+                            typename std::enable_if<!GET_PROP_VALUE(TypeTag, UseP1FiniteElementGradients),
+                                                    Dummy>::type fapIdx,
+                            const QuantityCallback& quantityCallback,
+                            unsigned numQuantities) const
+    {
+        static_assert(std::is_same<Dummy, unsigned>::value,
+                      "The 'Dummy' template parameter must _not_ be specified explicitly."
+                      "It is only required to conditionally disable this method!");
+
+        ParentType::calculateGradients(quantityGrads, elemCtx, fapIdx, quantityCallback, numQuantities);
+    }
+
     /*!
      * \brief Calculates the value of an arbitrary quantity at any
      *        flux approximation point on the grid boundary.
@@ -316,10 +395,38 @@ public:
 
 private:
 #if HAVE_DUNE_LOCALFUNCTIONS
+    // returns the reference data of the current geometry type, it is evaluated when it
+    // is requested for the first time.
+    template <class Stencil>
+    const ReferenceData_& referenceData_(const LocalFiniteElement& localFE,
+                                        const Stencil& stencil)
+    {
+        if (referenceDataCache_.empty())
+            referenceDataCache_.resize(Dune::LocalGeometryTypeIndex::size(dim));
+
+        ReferenceData_& refData = referenceDataCache_[referenceDataIdx_];
+        if (refData.isInitialized)
+            return refData;
+
+        std::vector<ShapeJacobian> localGradient;
+        for (unsigned faceIdx = 0; faceIdx < stencil.numInteriorFaces(); ++faceIdx) {
+            const auto& localFacePos = stencil.interiorFace(faceIdx).localPos();
+
+            localFE.localBasis().evaluateFunction(localFacePos, refData.value[faceIdx]);
+            localFE.localBasis().evaluateJacobian(localFacePos, localGradient);
+            for (unsigned vertIdx = 0; vertIdx < localGradient.size(); ++vertIdx)
+                refData.localGradient[faceIdx][vertIdx] = localGradient[vertIdx][0];
+        }
+
+        refData.isInitialized = true;
+        return refData;
+    }
+
     static LocalFiniteElementCache feCache_;
 
     const LocalFiniteElement* localFiniteElement_;
-    std::vector<Dune::FieldVector<Scalar, 1>> p1Value_[maxFap];
+    std::vector<ReferenceData_> referenceDataCache_;
+    size_t referenceDataIdx_;
     DimVector p1Gradient_[maxFap][maxDof];
 #endif // HAVE_DUNE_LOCALFUNCTIONS
 };
@@ -165,7 +165,12 @@ public:
      */
     template <class Restarter>
     void serialize(Restarter& res)
-    { res.template serializeEntities</*codim=*/dim>(asImp_(), this->gridView_); }
+    {
+        if (res.isBinary())
+            asImp_().serializeBlocks(res);
+        else
+            res.template serializeEntities</*codim=*/dim>(asImp_(), this->gridView_);
+    }
 
     /*!
      * \brief Deserializes the state of the model.
@@ -177,8 +182,14 @@ public:
     template <class Restarter>
     void deserialize(Restarter& res)
     {
-        res.template deserializeEntities</*codim=*/dim>(asImp_(), this->gridView_);
+        // binary restart files may contain the storage terms of the previous time step
+        this->invalidateStorageCache();
+        if (res.isBinary())
+            asImp_().deserializeBlocks(res);
+        else
+            res.template deserializeEntities</*codim=*/dim>(asImp_(), this->gridView_);
         this->solution(/*timeIdx=*/1) = this->solution(/*timeIdx=*/0);
+        this->resetTimeDiscHistory();
     }
 
 private:
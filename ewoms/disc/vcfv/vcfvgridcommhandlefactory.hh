@@ -85,6 +85,22 @@ public:
         typedef GridCommHandleSum<ValueType, ArrayType,  DofMapper, /*commCodim=*/dim> Handle;
         return  std::shared_ptr<Handle>(new Handle(array, dofMapper));
     }
+
+    /*!
+     * \brief Return a handle which communicates the values of several arrays for
+     *        all overlapping degrees of freedom in a single round.
+     *
+     * The arrays are added using the addContainer() method of the handle. The
+     * values received from the other processes are combined with the local ones
+     * using the Operation class, e.g., GridCommSumOperation.
+     */
+    template <class ValueType, class Operation, class ArrayType>
+    static std::shared_ptr<GridCommHandleMulti<ValueType, ArrayType,  DofMapper, /*commCodim=*/dim, Operation> >
+    multiHandle(const DofMapper& dofMapper)
+    {
+        typedef GridCommHandleMulti<ValueType, ArrayType,  DofMapper, /*commCodim=*/dim, Operation> Handle;
+        return  std::shared_ptr<Handle>(new Handle(dofMapper));
+    }
 };
 } // namespace Ewoms
 
@@ -827,16 +827,10 @@ public:
         , elementPtr_(gridView.template begin</*codim=*/0>())
 #endif
     {
-        static bool localGeometriesInitialized = false;
-        if (!localGeometriesInitialized) {
-            localGeometriesInitialized = true;
-
-            VcfvScvGeometries<Scalar, /*dim=*/1, Dune::GeometryType::cube>::init();
-            VcfvScvGeometries<Scalar, /*dim=*/2, Dune::GeometryType::cube>::init();
-            VcfvScvGeometries<Scalar, /*dim=*/2, Dune::GeometryType::simplex>::init();
-            VcfvScvGeometries<Scalar, /*dim=*/3, Dune::GeometryType::cube>::init();
-            VcfvScvGeometries<Scalar, /*dim=*/3, Dune::GeometryType::simplex>::init();
-        }
+        // the initialization of function-local static variables is thread-safe, so the
+        // local geometries are only initialized once even if multiple stencils are
+        // created concurrently
+        static bool localGeometriesInitialized OPM_UNUSED = initLocalGeometries_();
     }
 
     /*!
@@ -1150,6 +1144,16 @@ public:
     }
 
 private:
+    static bool initLocalGeometries_()
+    {
+        VcfvScvGeometries<Scalar, /*dim=*/1, Dune::GeometryType::cube>::init();
+        VcfvScvGeometries<Scalar, /*dim=*/2, Dune::GeometryType::cube>::init();
+        VcfvScvGeometries<Scalar, /*dim=*/2, Dune::GeometryType::simplex>::init();
+        VcfvScvGeometries<Scalar, /*dim=*/3, Dune::GeometryType::cube>::init();
+        VcfvScvGeometries<Scalar, /*dim=*/3, Dune::GeometryType::simplex>::init();
+        return true;
+    }
+
 #if __GNUC__ || __clang__
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wpragmas"
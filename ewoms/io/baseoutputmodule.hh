@@ -40,6 +40,7 @@
 #include <dune/common/fvector.hh>
 
 #include <vector>
+#include <set>
 #include <sstream>
 #include <string>
 #include <array>
@@ -124,10 +125,42 @@ public:
      */
     virtual void allocBuffers() = 0;
 
+    /*!
+     * \brief Release the memory of all buffers of the module.
+     *
+     * This covers all buffers which have been allocated using the resize*Buffer_()
+     * methods. They are allocated again by the next call to allocBuffers(), i.e., this
+     * may be called whenever the output fields are not needed until the next time the
+     * results are written.
+     */
+    virtual void freeBuffers()
+    {
+        for (ScalarBuffer* buffer : allocatedScalarBuffers_)
+            ScalarBuffer().swap(*buffer);
+        for (VectorBuffer* buffer : allocatedVectorBuffers_)
+            VectorBuffer().swap(*buffer);
+        for (TensorBuffer* buffer : allocatedTensorBuffers_)
+            TensorBuffer().swap(*buffer);
+
+        allocatedScalarBuffers_.clear();
+        allocatedVectorBuffers_.clear();
+        allocatedTensorBuffers_.clear();
+    }
+
     /*!
      * \brief Modify the internal buffers according to the intensive quanties relevant
      *        for an element
      *
+     * If the output is restricted to a region of the grid (cf.
+     * FvBaseDiscretization::setOutputRegion()), this method is only called for the
+     * elements of that region.
+     *
+     * This method is called concurrently by multiple threads. To avoid locks, each
+     * thread owns a block of the degrees of freedom and implementations must only
+     * modify the entries of their buffers for the degrees of freedom for which
+     * isOwnedDof_() returns true. Since an element may be handed to several
+     * threads, anything else must not be modified.
+     *
      * The module can dynamically cast the writer to the desired
      * concrete class. If the writer is incompatible with the module,
      * this method should become a no-op.
@@ -153,6 +186,13 @@ public:
     { return false; }
 
 protected:
+    /*!
+     * \brief Returns true iff the calling thread is responsible for writing the
+     *        buffer entries of a given degree of freedom in processElement().
+     */
+    bool isOwnedDof_(unsigned globalDofIdx) const
+    { return simulator_.model().isOwnedOutputDof(globalDofIdx); }
+
     enum BufferType {
         //! Buffer contains data associated with the degrees of freedom
         DofBuffer,
@@ -182,6 +222,33 @@ protected:
 
         buffer.resize(n);
         std::fill(buffer.begin(), buffer.end(), 0.0);
+        allocatedScalarBuffers_.insert(&buffer);
+    }
+
+    /*!
+     * \brief Allocate the space for a buffer storing a vectorial quantity
+     *
+     * The vectors have as many entries as the world has dimensions.
+     */
+    void resizeVectorBuffer_(VectorBuffer& buffer,
+                             BufferType bufferType = DofBuffer)
+    {
+        size_t n;
+        if (bufferType == VertexBuffer)
+            n = static_cast<size_t>(simulator_.gridView().size(dim));
+        else if (bufferType == ElementBuffer)
+            n = static_cast<size_t>(simulator_.gridView().size(0));
+        else if (bufferType == DofBuffer)
+            n = simulator_.model().numGridDof();
+        else
+            OPM_THROW(std::logic_error, "bufferType must be one of Dof, Vertex or Element");
+
+        buffer.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+            buffer[i].resize(dimWorld);
+            buffer[i] = 0.0;
+        }
+        allocatedVectorBuffers_.insert(&buffer);
     }
 
     /*!
@@ -203,6 +270,7 @@ protected:
         buffer.resize(n);
         Tensor nullMatrix(dimWorld, dimWorld, 0.0);
         std::fill(buffer.begin(), buffer.end(), nullMatrix);
+        allocatedTensorBuffers_.insert(&buffer);
     }
 
     /*!
@@ -225,6 +293,7 @@ protected:
         for (unsigned i = 0; i < numEq; ++i) {
             buffer[i].resize(n);
             std::fill(buffer[i].begin(), buffer[i].end(), 0.0);
+            allocatedScalarBuffers_.insert(&buffer[i]);
         }
     }
 
@@ -248,6 +317,7 @@ protected:
         for (unsigned i = 0; i < numPhases; ++i) {
             buffer[i].resize(n);
             std::fill(buffer[i].begin(), buffer[i].end(), 0.0);
+            allocatedScalarBuffers_.insert(&buffer[i]);
         }
     }
 
@@ -271,6 +341,7 @@ protected:
         for (unsigned i = 0; i < numComponents; ++i) {
             buffer[i].resize(n);
             std::fill(buffer[i].begin(), buffer[i].end(), 0.0);
+            allocatedScalarBuffers_.insert(&buffer[i]);
         }
     }
 
@@ -295,6 +366,7 @@ protected:
             for (unsigned j = 0; j < numComponents; ++j) {
                 buffer[i][j].resize(n);
                 std::fill(buffer[i][j].begin(), buffer[i][j].end(), 0.0);
+                allocatedScalarBuffers_.insert(&buffer[i][j]);
             }
         }
     }
@@ -507,6 +579,12 @@ protected:
     { baseWriter.attachTensorVertexData(buffer, name); }
 
     const Simulator& simulator_;
+
+private:
+    // the buffers which have been allocated since the last call to freeBuffers()
+    std::set<ScalarBuffer*> allocatedScalarBuffers_;
+    std::set<VectorBuffer*> allocatedVectorBuffers_;
+    std::set<TensorBuffer*> allocatedTensorBuffers_;
 };
 
 #if __GNUC__ || __clang__
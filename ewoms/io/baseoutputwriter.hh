@@ -43,9 +43,16 @@ namespace Ewoms {
 class BaseOutputWriter
 {
 public:
+    // all writers store the values of the fields with single precision, so the
+    // buffers use single precision as well unless double precision buffers are
+    // explicitly requested
+#if EWOMS_DOUBLE_PRECISION_OUTPUT_BUFFERS
     typedef double Scalar;
-    typedef Dune::DynamicVector<double> Vector;
-    typedef Dune::DynamicMatrix<double> Tensor;
+#else
+    typedef float Scalar;
+#endif
+    typedef Dune::DynamicVector<Scalar> Vector;
+    typedef Dune::DynamicMatrix<Scalar> Tensor;
     typedef std::vector<Scalar> ScalarBuffer;
     typedef std::vector<Vector> VectorBuffer;
     typedef std::vector<Tensor> TensorBuffer;
@@ -100,6 +107,15 @@ public:
      * buffers are deleted, but no output is written.
      */
     virtual void endWrite(bool onlyDiscard = false) = 0;
+
+    /*!
+     * \brief Returns true if the writer accepts the fields of the VTK output modules.
+     *
+     * These fields may have arbitrary names and may be vectors or tensors, so they are
+     * only passed to the writers of VTK-like formats, e.g., not to the ECL writer.
+     */
+    virtual bool isVtkLike() const
+    { return false; }
 };
 } // namespace Ewoms
 
@@ -29,20 +29,61 @@
 
 #include <dune/grid/io/file/dgfparser/dgfparser.hh>
 #include <dune/grid/common/mcmgmapper.hh>
+#include <dune/grid/common/backuprestore.hh>
+#include <dune/grid/common/capabilities.hh>
 #include <ewoms/models/discretefracture/fracturemapper.hh>
 
 #include <ewoms/io/basegridmanager.hh>
 #include <ewoms/common/propertysystem.hh>
 #include <ewoms/common/parametersystem.hh>
 
+#include <opm/common/Unused.hpp>
+
+#if HAVE_MPI
+#include <mpi.h>
+#endif
+
+#include <sys/stat.h>
 
 #include <type_traits>
+#include <sstream>
 #include <string>
 
 namespace Ewoms {
+namespace DgfGridManagerDetail {
+// writes and reads grids in the binary format of their backup and restore facilities,
+// if they have any
+template <class Grid, bool hasBackupRestore = Dune::Capabilities::hasBackupRestoreFacilities<Grid>::v>
+struct GridCache
+{
+    static bool isSupported()
+    { return false; }
+
+    static void write(const Grid& grid OPM_UNUSED, const std::string& fileName OPM_UNUSED)
+    {}
+
+    static Grid* read(const std::string& fileName OPM_UNUSED)
+    { return 0; }
+};
+
+template <class Grid>
+struct GridCache<Grid, /*hasBackupRestore=*/true>
+{
+    static bool isSupported()
+    { return true; }
+
+    static void write(const Grid& grid, const std::string& fileName)
+    { Dune::BackupRestoreFacility<Grid>::backup(grid, fileName); }
+
+    static Grid* read(const std::string& fileName)
+    { return Dune::BackupRestoreFacility<Grid>::restore(fileName); }
+};
+} // namespace DgfGridManagerDetail
+
 namespace Properties {
 NEW_PROP_TAG(Grid);
 NEW_PROP_TAG(GridFile);
+NEW_PROP_TAG(EnableGridCache);
 NEW_PROP_TAG(GridManager);
 NEW_PROP_TAG(GridGlobalRefinements);
 NEW_PROP_TAG(Scalar);
@@ -74,6 +115,9 @@ public:
         EWOMS_REGISTER_PARAM(TypeTag, unsigned, GridGlobalRefinements,
                              "The number of global refinements of the grid "
                              "executed after it was loaded");
+        EWOMS_REGISTER_PARAM(TypeTag, bool, EnableGridCache,
+                             "Store the grid in a binary file next to the DGF file and "
+                             "use it instead of the DGF file if it is up to date");
     }
 
     /*!
@@ -85,19 +129,55 @@ public:
         const std::string dgfFileName = EWOMS_GET_PARAM(TypeTag, std::string, GridFile);
         unsigned numRefinments = EWOMS_GET_PARAM(TypeTag, unsigned, GridGlobalRefinements);
 
-        {
-            // create DGF GridPtr from a dgf file
-            Dune::GridPtr< Grid > dgfPointer( dgfFileName );
+        useGridCache_ =
+            EWOMS_GET_PARAM(TypeTag, bool, EnableGridCache)
+            && GridCache::isSupported();
+        isDistributed_ = false;
+
+        // the caches contain the refined grid, so they depend on the number of
+        // refinements. if the cache of the distributed grid is available for each
+        // process, even the load balancing can be skipped.
+        std::ostringstream cacheName;
+        cacheName << dgfFileName << ".cache-ref" << numRefinments;
+        cacheFileName_ = cacheName.str();
+        distributedCacheFileName_ = distributedCacheName_(cacheFileName_);
+
+        if (useGridCache_ && readDistributedCache_(dgfFileName)) {
+            isDistributed_ = true;
+            this->finalizeInit_();
+            return;
+        }
 
-            // this is only implemented for 2d currently
-            addFractures_( dgfPointer );
+        if (useGridCache_ && globalCacheIsUpToDate_(dgfFileName))
+            gridPtr_.reset(GridCache::read(cacheFileName_));
+        else {
+            {
+                // create DGF GridPtr from a dgf file
+                Dune::GridPtr< Grid > dgfPointer( dgfFileName );
 
-            // store pointer to dune grid
-            gridPtr_.reset( dgfPointer.release() );
-        }
+                // this is only implemented for 2d currently
+                addFractures_( dgfPointer );
+
+                // store pointer to dune grid
+                gridPtr_.reset( dgfPointer.release() );
+            }
 
-        if (numRefinments > 0)
-            gridPtr_->globalRefine(static_cast<int>(numRefinments));
+            if (numRefinments > 0)
+                gridPtr_->globalRefine(static_cast<int>(numRefinments));
+
+            // the fractures are vertex parameters of the DGF file, which are not part
+            // of the cache. thus, grids with fractures are not cached.
+            if (useGridCache_ && fractureMapper_.numFractureEdges() > 0)
+                useGridCache_ = false;
+
+            // only the first process writes the cache. the others wait until it is
+            // complete, so that no process can see a partially written file.
+            if (useGridCache_) {
+                if (gridPtr_->comm().rank() == 0)
+                    GridCache::write(*gridPtr_, cacheFileName_);
+                gridPtr_->comm().barrier();
+            }
+        }
 
         this->finalizeInit_();
     }
@@ -122,7 +202,16 @@ public:
      * the DGF...
      */
     void loadBalance()
-    { gridPtr_->loadBalance(); }
+    {
+        // the grid has been read from the caches of the distributed grid
+        if (isDistributed_)
+            return;
+
+        gridPtr_->loadBalance();
+
+        if (useGridCache_ && gridPtr_->comm().size() > 1)
+            GridCache::write(*gridPtr_, distributedCacheFileName_);
+    }
 
     /*!
      * \brief Returns the fracture mapper
@@ -194,11 +283,106 @@ protected:
                     fractureMapper_.addFractureEdge(vertexIndices[0], vertexIndices[1]);
             }
         }
+
+        fractureMapper_.finalize();
     }
 
 private:
+    typedef DgfGridManagerDetail::GridCache<Grid> GridCache;
+
+    // returns the name of the cache of the local partition of the distributed grid
+    std::string distributedCacheName_(const std::string& cacheFileName) const
+    {
+        int rank = 0;
+        int size = 1;
+#if HAVE_MPI
+        int mpiIsInitialized = 0;
+        MPI_Initialized(&mpiIsInitialized);
+        if (mpiIsInitialized) {
+            MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+            MPI_Comm_size(MPI_COMM_WORLD, &size);
+        }
+#endif
+
+        std::ostringstream oss;
+        oss << cacheFileName << "-" << rank << "of" << size;
+        return oss.str();
+    }
+
+    // returns true if a cache file exists and it is not older than the file which it
+    // was created from
+    static bool cacheIsUpToDate_(const std::string& cacheFileName, const std::string& fileName)
+    {
+        struct stat cacheStat;
+        struct stat fileStat;
+        if (::stat(cacheFileName.c_str(), &cacheStat) != 0)
+            return false;
+        if (::stat(fileName.c_str(), &fileStat) != 0)
+            return false;
+        return cacheStat.st_mtime >= fileStat.st_mtime;
+    }
+
+    // returns true if the cache of the global grid is up to date. the first process
+    // decides this and broadcasts the result, so that all processes agree on it.
+    bool globalCacheIsUpToDate_(const std::string& dgfFileName) const
+    {
+        int rank = 0;
+#if HAVE_MPI
+        int mpiIsInitialized = 0;
+        MPI_Initialized(&mpiIsInitialized);
+        if (mpiIsInitialized)
+            MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+#endif
+
+        int isUpToDate = 0;
+        if (rank == 0)
+            isUpToDate = cacheIsUpToDate_(cacheFileName_, dgfFileName) ? 1 : 0;
+
+#if HAVE_MPI
+        if (mpiIsInitialized)
+            MPI_Bcast(&isUpToDate, 1, MPI_INT, /*root=*/0, MPI_COMM_WORLD);
+#endif
+
+        return isUpToDate != 0;
+    }
+
+    // read the local partition of the distributed grid if the caches of all processes
+    // are up to date. this is a collective operation.
+    bool readDistributedCache_(const std::string& dgfFileName)
+    {
+        int isUpToDate = cacheIsUpToDate_(distributedCacheFileName_, dgfFileName) ? 1 : 0;
+        int allUpToDate = isUpToDate;
+#if HAVE_MPI
+        int mpiIsInitialized = 0;
+        MPI_Initialized(&mpiIsInitialized);
+        if (!mpiIsInitialized)
+            return false;
+
+        int size;
+        MPI_Comm_size(MPI_COMM_WORLD, &size);
+        if (size < 2)
+            return false;
+
+        MPI_Allreduce(&isUpToDate, &allUpToDate, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+#else
+        // in sequential runs, there is no distributed grid
+        return false;
+#endif
+
+        if (!allUpToDate)
+            return false;
+
+        gridPtr_.reset(GridCache::read(distributedCacheFileName_));
+        return true;
+    }
+
     GridPointer    gridPtr_;
     FractureMapper fractureMapper_;
+
+    bool useGridCache_;
+    bool isDistributed_;
+    std::string cacheFileName_;
+    std::string distributedCacheFileName_;
 };
 
 } // namespace Ewoms
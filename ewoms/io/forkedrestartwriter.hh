@@ -0,0 +1,149 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \copydoc Ewoms::ForkedRestartWriter
+ */
+#ifndef EWOMS_FORKED_RESTART_WRITER_HH
+#define EWOMS_FORKED_RESTART_WRITER_HH
+
+#include "restart.hh"
+
+#include <opm/common/ErrorMacros.hpp>
+#include <opm/common/Exceptions.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cerrno>
+
+namespace Ewoms {
+
+/*!
+ * \brief Writes restart files from forked child processes.
+ *
+ * The restart file must have been assembled in memory (cf.
+ * Restart::setDeferredWrite()). Since everything which requires MPI is done before,
+ * the child process only needs to write the data from its copy-on-write snapshot of
+ * the memory of the simulator and exits, while the simulator continues at once.
+ *
+ * The number of child processes which may exist at the same time is limited. If this
+ * limit is reached, write() waits until one of them has finished. If a process cannot
+ * be forked, the file is written synchronously.
+ */
+class ForkedRestartWriter
+{
+public:
+    explicit ForkedRestartWriter(unsigned maxChildren)
+        : maxChildren_(std::max(maxChildren, 1u))
+    { }
+
+    ForkedRestartWriter(const ForkedRestartWriter&) = delete;
+    ForkedRestartWriter& operator=(const ForkedRestartWriter&) = delete;
+
+    ~ForkedRestartWriter()
+    { waitAll(); }
+
+    /*!
+     * \brief Let a child process write a restart file which was assembled in memory.
+     */
+    void write(const Restart& res)
+    {
+        reap_(/*block=*/false);
+        while (children_.size() >= maxChildren_)
+            reap_(/*block=*/true);
+
+        pid_t pid = ::fork();
+        if (pid == 0) {
+            // child process: only async-signal-safe functions may be called here
+            // because the parent may have been multi-threaded. in particular, the
+            // destructors of the simulator's objects must not run, so _exit() is used.
+            ::_exit(res.writeDeferred() ? 0 : 1);
+        }
+
+        if (pid < 0) {
+            std::cerr << "Warning: Could not fork a process to write the restart file '"
+                      << res.fileName() << "'. Writing it synchronously.\n";
+            if (!res.writeDeferred())
+                OPM_THROW(std::runtime_error,
+                          "Could not write to restart file '" << res.fileName() << "'");
+            return;
+        }
+
+        children_.push_back(std::make_pair(pid, res.fileName()));
+    }
+
+    /*!
+     * \brief Wait until all restart files have been written.
+     */
+    void waitAll()
+    {
+        while (!children_.empty())
+            reap_(/*block=*/true);
+    }
+
+    /*!
+     * \brief Returns the number of restart files which are currently written.
+     */
+    size_t numPending() const
+    { return children_.size(); }
+
+private:
+    // collect the exit status of the finished child processes. if block is true, wait
+    // until at least one of them has finished.
+    void reap_(bool block)
+    {
+        for (size_t i = 0; i < children_.size();) {
+            int status;
+            pid_t pid = ::waitpid(children_[i].first, &status, block ? 0 : WNOHANG);
+            if (pid == 0) {
+                // still running
+                ++i;
+                continue;
+            }
+            if (pid < 0 && errno == EINTR)
+                continue;
+
+            if (pid < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+                std::cerr << "Warning: Writing the restart file '" << children_[i].second
+                          << "' in the background failed\n";
+            children_.erase(children_.begin() + static_cast<long>(i));
+            if (block)
+                return;
+        }
+    }
+
+    unsigned maxChildren_;
+    std::vector<std::pair<pid_t, std::string> > children_;
+};
+
+} // namespace Ewoms
+
+#endif
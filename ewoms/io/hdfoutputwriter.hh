@@ -0,0 +1,761 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \copydoc Ewoms::HdfOutputWriter
+ */
+#ifndef EWOMS_HDF_OUTPUT_WRITER_HH
+#define EWOMS_HDF_OUTPUT_WRITER_HH
+
+#if HAVE_HDF5
+
+#include <ewoms/io/baseoutputwriter.hh>
+#include <ewoms/parallel/mpibuffer.hh>
+
+#include <opm/common/Exceptions.hpp>
+#include <opm/common/ErrorMacros.hpp>
+
+#include <dune/grid/common/mcmgmapper.hh>
+#include <dune/grid/io/file/vtk/common.hh>
+#include <dune/geometry/referenceelements.hh>
+#include <dune/common/version.hh>
+
+#if HAVE_MPI
+#include <mpi.h>
+#endif
+
+#include <hdf5.h>
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <list>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace Ewoms {
+
+/*!
+ * \brief Writes the output of a simulation into a single HDF5 file which is indexed by
+ *        an XDMF file.
+ *
+ * In contrast to the VTK writers, all processes write into the same file: Each process
+ * contributes the vertices and the elements of its interior partition as a contiguous
+ * slice of the global datasets, so no data needs to be gathered on a single process.
+ * If HDF5 has been built with MPI support, the file is opened by all processes and the
+ * datasets are written collectively using MPI-IO. The mesh is only written for the
+ * first time step and after the grid has changed (cf. gridChanged()); the fields of
+ * each time step are stored in a group of their own. Optionally, the datasets are
+ * chunked and compressed using the deflate filter of HDF5 (cf. setCompressionLevel()).
+ *
+ * The XDMF file is written by the first process and references the datasets of all
+ * time steps. It can be opened by ParaView and VisIt. Like for the VTK writers, the
+ * data is stored with single precision.
+ */
+template <class GridView>
+class HdfOutputWriter : public BaseOutputWriter
+{
+    enum { dim = GridView::dimension };
+    enum { dimWorld = GridView::dimensionworld };
+
+    typedef typename GridView::ctype CoordScalar;
+    typedef typename GridView::template Codim<0>::Entity Element;
+    typedef typename GridView::template Codim<0>::template Partition<Dune::Interior_Partition>::Iterator ElementIterator;
+    typedef Dune::ReferenceElements<CoordScalar, dim> ReferenceElements;
+
+    typedef Dune::MultipleCodimMultipleGeomTypeMapper<GridView, Dune::MCMGVertexLayout> VertexMapper;
+    typedef Dune::MultipleCodimMultipleGeomTypeMapper<GridView, Dune::MCMGElementLayout> ElementMapper;
+
+    // the maximum number of rows of the chunks of the compressed datasets
+    enum { maxChunkRows = 64*1024 };
+
+public:
+    typedef BaseOutputWriter::Scalar Scalar;
+    typedef BaseOutputWriter::Vector Vector;
+    typedef BaseOutputWriter::Tensor Tensor;
+    typedef BaseOutputWriter::ScalarBuffer ScalarBuffer;
+    typedef BaseOutputWriter::VectorBuffer VectorBuffer;
+    typedef BaseOutputWriter::TensorBuffer TensorBuffer;
+
+private:
+    // a field which is written for the current time step
+    struct Field_
+    {
+        std::string name;
+        bool isCellData;
+        unsigned numComponents;
+        std::vector<float> values;
+    };
+
+    // closes an HDF5 object when it goes out of scope
+    class Handle_
+    {
+    public:
+        Handle_(hid_t id, herr_t (*closeFn)(hid_t), const char* what)
+            : id_(id)
+            , closeFn_(closeFn)
+        {
+            if (id_ < 0)
+                OPM_THROW(std::runtime_error, "HDF5 output: " << what << " failed");
+        }
+
+        ~Handle_()
+        { closeFn_(id_); }
+
+        operator hid_t() const
+        { return id_; }
+
+    private:
+        Handle_(const Handle_&) = delete;
+        Handle_& operator=(const Handle_&) = delete;
+
+        hid_t id_;
+        herr_t (*closeFn_)(hid_t);
+    };
+
+public:
+    HdfOutputWriter(const GridView& gridView, const std::string& simName = "")
+        : gridView_(gridView)
+        , elementMapper_(gridView)
+        , vertexMapper_(gridView)
+    {
+        simName_ = (simName.empty()) ? "sim" : simName;
+
+        commRank_ = gridView.comm().rank();
+        commSize_ = gridView.comm().size();
+
+#if !HAVE_MPI || !defined(H5_HAVE_PARALLEL)
+        if (commSize_ > 1)
+            OPM_THROW(std::runtime_error,
+                      "Parallel HDF5 output requires HDF5 to be built with MPI support");
+#endif
+
+        curWriterNum_ = 0;
+        meshNum_ = 0;
+        meshValid_ = false;
+        fileCreated_ = false;
+        compressionLevel_ = 1;
+        curTime_ = 0.0;
+    }
+
+    ~HdfOutputWriter()
+    {}
+
+    /*!
+     * \brief Returns the number of the current time step.
+     */
+    int curWriterNum() const
+    { return curWriterNum_; }
+
+    /*!
+     * \brief Set the compression level of the deflate filter.
+     *
+     * Valid levels are between 0 (no compression) and 9 (best compression). If the
+     * deflate filter is not available or if the installed version of HDF5 does not
+     * support filters for parallel writes (i.e., the version is older than 1.10.2),
+     * the datasets are written uncompressed.
+     */
+    void setCompressionLevel(int level)
+    {
+        if (level < 0 || level > 9)
+            OPM_THROW(std::invalid_argument,
+                      "Invalid compression level " << level << " for HDF5 output");
+        compressionLevel_ = level;
+    }
+
+    /*!
+     * \brief Updates the internal data structures after mesh refinement.
+     *
+     * If the grid changes between two calls of beginWrite(), this method _must_ be
+     * called before the second beginWrite()!
+     */
+    void gridChanged()
+    {
+        elementMapper_.update();
+        vertexMapper_.update();
+        meshValid_ = false;
+    }
+
+    /*!
+     * \copydoc BaseOutputWriter::isVtkLike
+     */
+    bool isVtkLike() const
+    { return true; }
+
+    /*!
+     * \brief Called whenever a new time step must be written.
+     */
+    void beginWrite(double t)
+    {
+        if (!meshValid_)
+            collectMesh_();
+
+        curTime_ = t;
+        fields_.clear();
+        ++curWriterNum_;
+    }
+
+    /*!
+     * \brief Add a vertex centered scalar field to the output.
+     *
+     * The data is copied by this method, so the buffer can be modified as soon as the
+     * method returns.
+     */
+    void attachScalarVertexData(ScalarBuffer& buf, std::string name)
+    { addScalarField_(buf, name, pointVertexIdx_, /*isCellData=*/false); }
+
+    /*!
+     * \brief Add an element centered scalar field to the output.
+     */
+    void attachScalarElementData(ScalarBuffer& buf, std::string name)
+    { addScalarField_(buf, name, cellElementIdx_, /*isCellData=*/true); }
+
+    /*!
+     * \brief Add a vertex centered vector field to the output.
+     */
+    void attachVectorVertexData(VectorBuffer& buf, std::string name)
+    { addVectorField_(buf, name, pointVertexIdx_, /*isCellData=*/false); }
+
+    /*!
+     * \brief Add an element centered vector field to the output.
+     */
+    void attachVectorElementData(VectorBuffer& buf, std::string name)
+    { addVectorField_(buf, name, cellElementIdx_, /*isCellData=*/true); }
+
+    /*!
+     * \brief Add a vertex centered tensor field to the output.
+     *
+     * Like for the VTK output, each column of the tensors is written as a vector field.
+     */
+    void attachTensorVertexData(TensorBuffer& buf, std::string name)
+    { addTensorField_(buf, name, pointVertexIdx_, /*isCellData=*/false); }
+
+    /*!
+     * \brief Add an element centered tensor field to the output.
+     */
+    void attachTensorElementData(TensorBuffer& buf, std::string name)
+    { addTensorField_(buf, name, cellElementIdx_, /*isCellData=*/true); }
+
+    /*!
+     * \brief Finalizes the current time step.
+     *
+     * This is a collective operation, i.e., it must be called by all processes. Unless
+     * the onlyDiscard argument is true, the mesh (if required) and the attached fields
+     * are written to the HDF5 file and the XDMF file is updated.
+     */
+    void endWrite(bool onlyDiscard = false)
+    {
+        if (onlyDiscard) {
+            fields_.clear();
+            --curWriterNum_;
+            return;
+        }
+
+        Handle_ file(openFile_(), H5Fclose, "opening the file");
+        if (!meshValid_)
+            writeMesh_(file);
+
+        std::ostringstream xdmf;
+        xdmf.precision(16);
+        xdmf << "   <Grid Name=\"" << groupName_("step", curWriterNum_) << "\" GridType=\"Uniform\">\n"
+             << "    <Time Value=\"" << curTime_ << "\"/>\n"
+             << meshXdmf_;
+
+        std::string stepGroupName = "/" + groupName_("step", curWriterNum_);
+        Handle_ group(H5Gcreate2(file, stepGroupName.c_str(), H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT),
+                      H5Gclose,
+                      "creating a group");
+        auto fieldIt = fields_.begin();
+        const auto& fieldEndIt = fields_.end();
+        for (; fieldIt != fieldEndIt; ++fieldIt) {
+            const Field_& field = *fieldIt;
+            std::string datasetName = datasetName_(field.name);
+            hsize_t numRows = writeDataset_(group, datasetName, H5T_NATIVE_FLOAT,
+                                            field.values, field.numComponents);
+
+            xdmf << "    <Attribute Name=\"" << xmlEscape_(field.name) << "\""
+                 << " AttributeType=\"" << attributeType_(field.numComponents) << "\""
+                 << " Center=\"" << (field.isCellData ? "Cell" : "Node") << "\">\n"
+                 << "     <DataItem Dimensions=\"" << numRows << " " << field.numComponents << "\""
+                 << " NumberType=\"Float\" Precision=\"4\" Format=\"HDF\">"
+                 << xmlEscape_(hdfFileBaseName_() + ":" + stepGroupName + "/" + datasetName)
+                 << "</DataItem>\n"
+                 << "    </Attribute>\n";
+        }
+        xdmf << "   </Grid>\n";
+        fields_.clear();
+
+        if (commRank_ == 0) {
+            xdmfGrids_ += xdmf.str();
+            writeXdmfFile_();
+        }
+    }
+
+    /*!
+     * \brief Write the writer's state to a restart file.
+     */
+    template <class Restarter>
+    void serialize(Restarter& res)
+    {
+        res.serializeSectionBegin("HdfOutputWriter");
+        res.serializeStream() << curWriterNum_ << " " << meshNum_ << "\n";
+        if (commRank_ == 0) {
+            res.serializeStream() << xdmfGrids_.size() << "\n";
+            res.serializeStream().write(xdmfGrids_.data(),
+                                        static_cast<std::streamsize>(xdmfGrids_.size()));
+        }
+        res.serializeSectionEnd();
+    }
+
+    /*!
+     * \brief Read the writer's state from a restart file.
+     *
+     * The time steps which have been written before the restart are appended to.
+     */
+    template <class Restarter>
+    void deserialize(Restarter& res)
+    {
+        res.deserializeSectionBegin("HdfOutputWriter");
+        res.deserializeStream() >> curWriterNum_ >> meshNum_;
+        std::string dummy;
+        std::getline(res.deserializeStream(), dummy);
+        if (commRank_ == 0) {
+            size_t len;
+            res.deserializeStream() >> len;
+            std::getline(res.deserializeStream(), dummy);
+            xdmfGrids_.resize(len);
+            if (len > 0)
+                res.deserializeStream().read(&xdmfGrids_[0], static_cast<std::streamsize>(len));
+        }
+        res.deserializeSectionEnd();
+
+        // the grid may have been loaded differently, so the mesh is written again
+        fileCreated_ = true;
+        meshValid_ = false;
+    }
+
+private:
+    static std::string groupName_(const char* prefix, int num)
+    {
+        std::ostringstream oss;
+        oss << prefix << "-" << std::setw(5) << std::setfill('0') << num;
+        return oss.str();
+    }
+
+    std::string hdfFileName_() const
+    { return simName_ + ".h5"; }
+
+    std::string hdfFileBaseName_() const
+    {
+        // the XDMF file references the HDF5 file relative to its own location
+        const std::string& fileName = hdfFileName_();
+        size_t pos = fileName.rfind('/');
+        return (pos == std::string::npos) ? fileName : fileName.substr(pos + 1);
+    }
+
+    // the names of the datasets must not contain slashes
+    static std::string datasetName_(std::string name)
+    {
+        std::replace(name.begin(), name.end(), '/', '_');
+        return name;
+    }
+
+    static std::string xmlEscape_(const std::string& s)
+    {
+        std::string result;
+        for (size_t i = 0; i < s.size(); ++i) {
+            switch (s[i]) {
+            case '&': result += "&amp;"; break;
+            case '<': result += "&lt;"; break;
+            case '>': result += "&gt;"; break;
+            case '"': result += "&quot;"; break;
+            default: result += s[i];
+            }
+        }
+        return result;
+    }
+
+    static const char* attributeType_(unsigned numComponents)
+    {
+        if (numComponents == 1)
+            return "Scalar";
+        else if (numComponents == 3)
+            return "Vector";
+        return "Matrix";
+    }
+
+    // returns the XDMF cell type of a geometry type
+    static int xdmfCellType_(const Dune::GeometryType& geomType)
+    {
+        switch (Dune::VTK::geometryType(geomType)) {
+        case Dune::VTK::vertex: return 1; // polyvertex
+        case Dune::VTK::line: return 2; // polyline
+        case Dune::VTK::triangle: return 4;
+        case Dune::VTK::quadrilateral: return 5;
+        case Dune::VTK::tetrahedron: return 6;
+        case Dune::VTK::pyramid: return 7;
+        case Dune::VTK::prism: return 8; // wedge
+        case Dune::VTK::hexahedron: return 9;
+        default:
+            OPM_THROW(std::logic_error,
+                      "HDF5 output: Unsupported geometry type " << geomType);
+        }
+    }
+
+    // determine the topology and the coordinates of the interior partition. The
+    // vertices are numbered in the order in which they are first encountered by the
+    // element loop and the corners are ordered like for VTK, which is also used by
+    // XDMF.
+    void collectMesh_()
+    {
+        const auto& indexSet = gridView_.indexSet();
+        std::vector<int64_t> pointIndex(indexSet.size(dim), -1);
+
+        coordinates_.clear();
+        topology_.clear();
+        isVertexEntry_.clear();
+        pointVertexIdx_.clear();
+        cellElementIdx_.clear();
+
+        ElementIterator elemIt = gridView_.template begin<0, Dune::Interior_Partition>();
+        const ElementIterator& elemEndIt = gridView_.template end<0, Dune::Interior_Partition>();
+        for (; elemIt != elemEndIt; ++elemIt) {
+            const Element& elem = *elemIt;
+            const Dune::GeometryType& geomType = elem.type();
+            const auto& refElem = ReferenceElements::general(geomType);
+            const auto& geometry = elem.geometry();
+
+            int numCorners = refElem.size(dim);
+            int cellType = xdmfCellType_(geomType);
+            topology_.push_back(cellType);
+            isVertexEntry_.push_back(false);
+            // polyvertices and polylines are followed by their number of nodes
+            if (cellType <= 2) {
+                topology_.push_back(numCorners);
+                isVertexEntry_.push_back(false);
+            }
+
+            for (int vtkCornerIdx = 0; vtkCornerIdx < numCorners; ++vtkCornerIdx) {
+                int cornerIdx = Dune::VTK::renumber(geomType, vtkCornerIdx);
+                size_t vertexIdx = static_cast<size_t>(indexSet.subIndex(elem, cornerIdx, dim));
+                if (pointIndex[vertexIdx] < 0) {
+                    pointIndex[vertexIdx] = static_cast<int64_t>(pointVertexIdx_.size());
+
+                    const auto& pos = geometry.corner(cornerIdx);
+                    for (unsigned dimIdx = 0; dimIdx < 3; ++dimIdx)
+                        coordinates_.push_back((dimIdx < dimWorld) ? static_cast<float>(pos[dimIdx]) : 0.0f);
+
+#if DUNE_VERSION_NEWER(DUNE_COMMON, 2,4)
+                    pointVertexIdx_.push_back(static_cast<unsigned>(vertexMapper_.subIndex(elem, cornerIdx, /*codim=*/dim)));
+#else
+                    pointVertexIdx_.push_back(static_cast<unsigned>(vertexMapper_.map(elem, cornerIdx, /*codim=*/dim)));
+#endif
+                }
+
+                // the offset of the vertices of the process is added when the mesh is
+                // written
+                topology_.push_back(pointIndex[vertexIdx]);
+                isVertexEntry_.push_back(true);
+            }
+
+#if DUNE_VERSION_NEWER(DUNE_COMMON, 2,4)
+            cellElementIdx_.push_back(static_cast<unsigned>(elementMapper_.index(elem)));
+#else
+            cellElementIdx_.push_back(static_cast<unsigned>(elementMapper_.map(elem)));
+#endif
+        }
+    }
+
+    // write the mesh into a new group of the file and update the XDMF description
+    void writeMesh_(hid_t file)
+    {
+        ++meshNum_;
+        std::string meshGroupName = "/" + groupName_("mesh", meshNum_);
+        Handle_ group(H5Gcreate2(file, meshGroupName.c_str(), H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT),
+                      H5Gclose,
+                      "creating a group");
+
+        // convert the local vertex indices to global ones
+        hsize_t pointOffset;
+        hsize_t numPoints;
+        globalOffset_(pointVertexIdx_.size(), pointOffset, numPoints);
+        std::vector<int64_t> topology(topology_);
+        for (size_t i = 0; i < topology.size(); ++i)
+            if (isVertexEntry_[i])
+                topology[i] += static_cast<int64_t>(pointOffset);
+
+        hsize_t cellOffset;
+        hsize_t numCells;
+        globalOffset_(cellElementIdx_.size(), cellOffset, numCells);
+
+        writeDataset_(group, "coordinates", H5T_NATIVE_FLOAT, coordinates_, /*numComponents=*/3);
+        hsize_t topologySize = writeDataset_(group, "topology", H5T_NATIVE_INT64, topology, /*numComponents=*/1);
+
+        std::ostringstream xdmf;
+        std::string hdfPath = xmlEscape_(hdfFileBaseName_() + ":" + meshGroupName);
+        xdmf << "    <Topology TopologyType=\"Mixed\" NumberOfElements=\"" << numCells << "\">\n"
+             << "     <DataItem Dimensions=\"" << topologySize << "\""
+             << " NumberType=\"Int\" Precision=\"8\" Format=\"HDF\">"
+             << hdfPath << "/topology</DataItem>\n"
+             << "    </Topology>\n"
+             << "    <Geometry GeometryType=\"XYZ\">\n"
+             << "     <DataItem Dimensions=\"" << numPoints << " 3\""
+             << " NumberType=\"Float\" Precision=\"4\" Format=\"HDF\">"
+             << hdfPath << "/coordinates</DataItem>\n"
+             << "    </Geometry>\n";
+        meshXdmf_ = xdmf.str();
+        meshValid_ = true;
+    }
+
+    // compute the offset of the rows of the current process within a dataset and the
+    // total number of rows of the dataset
+    void globalOffset_(size_t numLocalRows, hsize_t& offset, hsize_t& numGlobalRows) const
+    {
+        unsigned long localRows = numLocalRows;
+        std::vector<unsigned long> allRows(static_cast<size_t>(commSize_));
+        gridView_.comm().allgather(&localRows, 1, allRows.data());
+
+        offset = 0;
+        numGlobalRows = 0;
+        for (int rank = 0; rank < commSize_; ++rank) {
+            if (rank == commRank_)
+                offset = numGlobalRows;
+            numGlobalRows += allRows[static_cast<size_t>(rank)];
+        }
+    }
+
+    bool useCompression_() const
+    {
+        if (compressionLevel_ == 0 || H5Zfilter_avail(H5Z_FILTER_DEFLATE) <= 0)
+            return false;
+
+#if !H5_VERSION_GE(1, 10, 2)
+        // older versions of HDF5 do not support filters for parallel writes
+        if (commSize_ > 1)
+            return false;
+#endif
+
+        return true;
+    }
+
+    // write the rows of all processes into a two-dimensional dataset and return the
+    // total number of rows
+    template <class T>
+    hsize_t writeDataset_(hid_t group,
+                          const std::string& name,
+                          hid_t memType,
+                          const std::vector<T>& values,
+                          unsigned numComponents)
+    {
+        hsize_t numLocalRows = values.size()/numComponents;
+        hsize_t rowOffset;
+        hsize_t numRows;
+        globalOffset_(static_cast<size_t>(numLocalRows), rowOffset, numRows);
+
+        hsize_t dims[2] = { numRows, numComponents };
+        Handle_ fileSpace(H5Screate_simple(2, dims, NULL), H5Sclose, "creating a dataspace");
+
+        Handle_ createProps(H5Pcreate(H5P_DATASET_CREATE), H5Pclose, "creating a property list");
+        if (numRows > 0 && useCompression_()) {
+            hsize_t chunkDims[2] = { std::min(numRows, static_cast<hsize_t>(maxChunkRows)), numComponents };
+            H5Pset_chunk(createProps, 2, chunkDims);
+            H5Pset_deflate(createProps, static_cast<unsigned>(compressionLevel_));
+        }
+
+        Handle_ dataset(H5Dcreate2(group, name.c_str(), memType, fileSpace,
+                                   H5P_DEFAULT, createProps, H5P_DEFAULT),
+                        H5Dclose,
+                        "creating a dataset");
+
+        // select the slice of the current process
+        hsize_t count[2] = { numLocalRows, numComponents };
+        Handle_ memSpace(H5Screate_simple(2, count, NULL), H5Sclose, "creating a dataspace");
+        if (numLocalRows > 0) {
+            hsize_t start[2] = { rowOffset, 0 };
+            H5Sselect_hyperslab(fileSpace, H5S_SELECT_SET, start, NULL, count, NULL);
+        }
+        else {
+            H5Sselect_none(fileSpace);
+            H5Sselect_none(memSpace);
+        }
+
+        Handle_ transferProps(H5Pcreate(H5P_DATASET_XFER), H5Pclose, "creating a property list");
+#if HAVE_MPI && defined(H5_HAVE_PARALLEL)
+        if (commSize_ > 1)
+            H5Pset_dxpl_mpio(transferProps, H5FD_MPIO_COLLECTIVE);
+#endif
+
+        // processes without any rows still have to pass a valid pointer
+        T dummy = T();
+        const T* data = values.empty() ? &dummy : values.data();
+        if (H5Dwrite(dataset, memType, memSpace, fileSpace, transferProps, data) < 0)
+            OPM_THROW(std::runtime_error,
+                      "HDF5 output: Writing dataset '" << name << "' failed");
+
+        return numRows;
+    }
+
+    hid_t openFile_()
+    {
+        Handle_ accessProps(H5Pcreate(H5P_FILE_ACCESS), H5Pclose, "creating a property list");
+#if HAVE_MPI && defined(H5_HAVE_PARALLEL)
+        if (commSize_ > 1)
+            // the offsets of the processes are determined using the grid's
+            // communicator, so the file must be opened by the same processes
+            H5Pset_fapl_mpio(accessProps, toMpiCommunicator(gridView_.comm()), MPI_INFO_NULL);
+#endif
+
+        hid_t file;
+        if (fileCreated_)
+            file = H5Fopen(hdfFileName_().c_str(), H5F_ACC_RDWR, accessProps);
+        else
+            file = H5Fcreate(hdfFileName_().c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, accessProps);
+        fileCreated_ = true;
+        return file;
+    }
+
+    // (re-)write the XDMF file. Since it is not large, it is written from scratch for
+    // each time step, so that it is always complete.
+    void writeXdmfFile_() const
+    {
+        std::ofstream xdmfFile((simName_ + ".xmf").c_str());
+        xdmfFile << "<?xml version=\"1.0\"?>\n"
+                 << "<Xdmf Version=\"2.0\">\n"
+                 << " <Domain>\n"
+                 << "  <Grid Name=\"" << xmlEscape_(simName_) << "\""
+                 << " GridType=\"Collection\" CollectionType=\"Temporal\">\n"
+                 << xdmfGrids_
+                 << "  </Grid>\n"
+                 << " </Domain>\n"
+                 << "</Xdmf>\n";
+        if (!xdmfFile)
+            OPM_THROW(std::runtime_error,
+                      "HDF5 output: Writing '" << simName_ << ".xmf' failed");
+    }
+
+    void addScalarField_(const ScalarBuffer& buf,
+                         const std::string& name,
+                         const std::vector<unsigned>& entityIdx,
+                         bool isCellData)
+    {
+        fields_.push_back(Field_());
+        Field_& field = fields_.back();
+        field.name = name;
+        field.isCellData = isCellData;
+        field.numComponents = 1;
+        field.values.resize(entityIdx.size());
+        for (size_t i = 0; i < entityIdx.size(); ++i)
+            field.values[i] = static_cast<float>(buf[entityIdx[i]]);
+    }
+
+    void addVectorField_(const VectorBuffer& buf,
+                         const std::string& name,
+                         const std::vector<unsigned>& entityIdx,
+                         bool isCellData)
+    {
+        // all processes must agree on the number of components, even if they do not
+        // write any data
+        unsigned n = buf.empty() ? 0u : static_cast<unsigned>(buf[0].size());
+        n = gridView_.comm().max(n);
+
+        fields_.push_back(Field_());
+        Field_& field = fields_.back();
+        field.name = name;
+        field.isCellData = isCellData;
+        // visualization tools only interpret arrays of three components as vectors,
+        // so two dimensional vectors are padded by a zero
+        field.numComponents = (n == 2) ? 3 : std::max(n, 1u);
+        field.values.resize(entityIdx.size()*field.numComponents, 0.0f);
+        for (size_t i = 0; i < entityIdx.size(); ++i) {
+            const Vector& v = buf[entityIdx[i]];
+            for (size_t compIdx = 0; compIdx < v.size(); ++compIdx)
+                field.values[i*field.numComponents + compIdx] = static_cast<float>(v[compIdx]);
+        }
+    }
+
+    void addTensorField_(const TensorBuffer& buf,
+                         const std::string& name,
+                         const std::vector<unsigned>& entityIdx,
+                         bool isCellData)
+    {
+        unsigned numRows = buf.empty() ? 0u : static_cast<unsigned>(buf[0].N());
+        unsigned numCols = buf.empty() ? 0u : static_cast<unsigned>(buf[0].M());
+        numRows = gridView_.comm().max(numRows);
+        numCols = gridView_.comm().max(numCols);
+
+        for (unsigned colIdx = 0; colIdx < numCols; ++colIdx) {
+            std::ostringstream oss;
+            oss << name << "[" << colIdx << "]";
+
+            fields_.push_back(Field_());
+            Field_& field = fields_.back();
+            field.name = oss.str();
+            field.isCellData = isCellData;
+            field.numComponents = (numRows == 2) ? 3 : std::max(numRows, 1u);
+            field.values.resize(entityIdx.size()*field.numComponents, 0.0f);
+            for (size_t i = 0; i < entityIdx.size(); ++i) {
+                const Tensor& t = buf[entityIdx[i]];
+                for (unsigned rowIdx = 0; rowIdx < numRows; ++rowIdx)
+                    field.values[i*field.numComponents + rowIdx] = static_cast<float>(t[rowIdx][colIdx]);
+            }
+        }
+    }
+
+    const GridView gridView_;
+    ElementMapper elementMapper_;
+    VertexMapper vertexMapper_;
+
+    std::string simName_;
+    int commRank_;
+    int commSize_;
+
+    int curWriterNum_;
+    double curTime_;
+    int compressionLevel_;
+    bool fileCreated_;
+
+    // the mesh of the interior partition of the process
+    bool meshValid_;
+    int meshNum_;
+    std::vector<float> coordinates_;
+    std::vector<int64_t> topology_;
+    std::vector<bool> isVertexEntry_;
+    std::vector<unsigned> pointVertexIdx_;
+    std::vector<unsigned> cellElementIdx_;
+
+    std::list<Field_> fields_;
+
+    // the XDMF description of the current mesh and of all time steps written so far
+    std::string meshXdmf_;
+    std::string xdmfGrids_;
+};
+} // namespace Ewoms
+
+#endif // HAVE_HDF5
+
+#endif
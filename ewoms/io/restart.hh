@@ -27,6 +27,8 @@
 #ifndef EWOMS_RESTART_HH
 #define EWOMS_RESTART_HH
 
+#include <ewoms/parallel/mpibuffer.hh>
+
 #include <opm/common/Exceptions.hpp>
 #include <opm/common/ErrorMacros.hpp>
 
@@ -34,14 +36,122 @@
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <streambuf>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <cctype>
+#include <cerrno>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#if HAVE_MPI
+#include <mpi.h>
+#endif
 
 namespace Ewoms {
 
 /*!
  * \brief Load or save a state of a problem to/from the harddisk.
+ *
+ * Three file formats are supported: The text format writes everything using the
+ * formatted output operators of the C++ standard library. The binary format organizes
+ * the file into length-prefixed sections. In addition to formatted data, these sections
+ * may contain contiguous blocks of raw values which can be written and read at the speed
+ * of the file system (cf. serializeBlock() and deserializeBlock()). Binary restart files
+ * are read back via mmap(2). Finally, the collective format is the binary format, but
+ * instead of one file per process, the data of all processes is written to a single
+ * file using MPI-IO.
+ *
+ * If deferred writing is enabled, the file is assembled in memory by serializeEnd() and
+ * written by writeDeferred(). The latter uses neither MPI nor the heap, so it can be
+ * called by a forked child process (cf. ForkedRestartWriter).
  */
 class Restart
 {
+public:
+    /*!
+     * \brief The format of the restart files.
+     */
+    enum Format {
+        //! One formatted text file per process
+        TextFormat,
+
+        //! One binary file per process
+        BinaryFormat,
+
+        //! A single binary file for all processes which is written collectively
+        CollectiveFormat
+    };
+
+    /*!
+     * \brief Convert the name of a restart file format to a Format object.
+     *
+     * Valid names are 'text', 'binary' and 'collective'.
+     */
+    static Format formatFromString(const std::string& formatName)
+    {
+        if (formatName == "text")
+            return TextFormat;
+        else if (formatName == "binary")
+            return BinaryFormat;
+        else if (formatName == "collective")
+            return CollectiveFormat;
+
+        OPM_THROW(std::invalid_argument,
+                  "Unknown restart file format '" << formatName << "'. "
+                  "(supported are 'text', 'binary' and 'collective')");
+    }
+
+private:
+    // the first eight bytes of every binary restart file
+    static const char* binaryMagic_()
+    { return "eWomsRB1"; }
+
+    // the first eight bytes of every collective restart file
+    static const char* collectiveMagic_()
+    { return "eWomsRC1"; }
+
+    // the maximum number of bytes which is passed to a single MPI-IO call
+    static const size_t collectiveChunkSize_ = 1 << 30;
+
+    // used to detect restart files which were produced on a machine with different
+    // endianess
+    static const std::uint32_t endianessMarker_ = 0x01020304;
+
+    // the sections of binary restart files are aligned to this number of bytes
+    static const size_t sectionAlignment_ = 8;
+
+    /*!
+     * \brief A stream buffer which reads from a piece of memory.
+     *
+     * This is used to read the formatted data of the sections of binary restart files
+     * directly from the memory mapped file.
+     */
+    class MemoryStreamBuf_ : public std::streambuf
+    {
+    public:
+        void setRange(const char* begin, const char* end)
+        {
+            char* b = const_cast<char*>(begin);
+            char* e = const_cast<char*>(end);
+            setg(b, b, e);
+        }
+
+        const char* current() const
+        { return gptr(); }
+
+        size_t remaining() const
+        { return static_cast<size_t>(egptr() - gptr()); }
+
+        void advance(size_t numBytes)
+        { setg(eback(), gptr() + numBytes, egptr()); }
+    };
+
     /*!
      * \brief Create a magic cookie for restart files, so that it is
      *        unlikely to load a restart file for an incorrectly.
@@ -75,15 +185,76 @@ class Restart
     template <class GridView, class Scalar>
     static const std::string restartFileName_(const GridView& gridView,
                                               const std::string& simName,
-                                              Scalar t)
+                                              Scalar t,
+                                              Format format)
     {
         int rank = gridView.comm().rank();
         std::ostringstream oss;
-        oss << simName << "_time=" << t << "_rank=" << rank << ".ers";
+        oss << simName << "_time=" << t;
+        if (format == CollectiveFormat)
+            // collective restart files contain the data of all processes
+            oss << ".erc";
+        else if (format == BinaryFormat)
+            oss << "_rank=" << rank << ".erb";
+        else
+            oss << "_rank=" << rank << ".ers";
         return oss.str();
     }
 
+    static bool fileExists_(const std::string& fileName)
+    {
+        struct stat buf;
+        return ::stat(fileName.c_str(), &buf) == 0;
+    }
+
 public:
+    /*!
+     * \brief Create a restart object using a given file format.
+     *
+     * Note that the format is only used for writing restart files: If no restart file
+     * of the given format exists when deserializing, the files of the other formats are
+     * tried.
+     */
+    explicit Restart(Format format = TextFormat)
+        : format_(format)
+        , mappedData_(0)
+        , mappedSize_(0)
+        , binaryData_(0)
+        , binarySize_(0)
+        , inBinaryStream_(&inBinaryBuf_)
+        , deferredWrite_(false)
+        , deferredDataOffset_(0)
+        , deferredTruncate_(true)
+        , comm_(defaultMpiCommunicator())
+    { }
+
+    ~Restart()
+    { unmapFile_(); }
+
+    /*!
+     * \brief Returns the format of the restart file which is currently (de-)serialized.
+     */
+    Format format() const
+    { return format_; }
+
+    /*!
+     * \brief Returns true if the restart file which is (de-)serialized uses the binary
+     *        format.
+     *
+     * If this is the case, serializeBlock() and deserializeBlock() are available.
+     */
+    bool isBinary() const
+    { return format_ == BinaryFormat || format_ == CollectiveFormat; }
+
+    /*!
+     * \brief Specify whether the restart file is assembled in memory and written by
+     *        writeDeferred() instead of serializeEnd().
+     *
+     * This must be called before serializeBegin().
+     */
+    void setDeferredWrite(bool yesno)
+    { deferredWrite_ = yesno; }
+
     /*!
      * \brief Returns the name of the file which is (de-)serialized.
      */
@@ -97,13 +268,34 @@ public:
     void serializeBegin(Simulator& simulator)
     {
         const std::string magicCookie = magicRestartCookie_(simulator.gridView());
+        comm_ = toMpiCommunicator(simulator.gridView().comm());
         fileName_ = restartFileName_(simulator.gridView(),
                                      simulator.problem().name(),
-                                     simulator.time());
+                                     simulator.time(),
+                                     format_);
+
+        // open output file and write magic cookie. the data of collective restart
+        // files is first assembled in memory and then written by all processes at once
+        // when the file is finished.
+        if (format_ == CollectiveFormat || deferredWrite_) {
+            outBuffer_.str("");
+            outBuffer_.clear();
+        }
+        else if (isBinary())
+            outFile_.open(fileName_.c_str(), std::ios::out | std::ios::binary);
+        else
+            outFile_.open(fileName_.c_str());
+
+        if (!out_().good())
+            OPM_THROW(std::runtime_error,
+                      "Restart file '" << fileName_ << "' could not be opened for writing");
+        out_().precision(20);
 
-        // open output file and write magic cookie
-        outStream_.open(fileName_.c_str());
-        outStream_.precision(20);
+        if (isBinary()) {
+            out_().write(binaryMagic_(), 8);
+            writeRaw_(static_cast<std::uint32_t>(endianessMarker_));
+            writePadding_();
+        }
 
         serializeSectionBegin(magicCookie);
         serializeSectionEnd();
@@ -113,19 +305,76 @@ public:
      * \brief The output stream to write the serialized data.
      */
     std::ostream& serializeStream()
-    { return outStream_; }
+    { return out_(); }
 
     /*!
      * \brief Start a new section in the serialized output.
      */
     void serializeSectionBegin(const std::string& cookie)
-    { outStream_ << cookie << "\n"; }
+    {
+        if (!isBinary()) {
+            out_() << cookie << "\n";
+            return;
+        }
+
+        // the size of the section's data is not yet known. we write a placeholder and
+        // fix it when the section is finished.
+        writeRaw_(static_cast<std::uint64_t>(cookie.size()));
+        out_().write(cookie.data(), static_cast<std::streamsize>(cookie.size()));
+        sectionSizePos_ = out_().tellp();
+        writeRaw_(static_cast<std::uint64_t>(0));
+        sectionDataPos_ = out_().tellp();
+    }
 
     /*!
      * \brief End of a section in the serialized output.
      */
     void serializeSectionEnd()
-    { outStream_ << "\n"; }
+    {
+        if (!isBinary()) {
+            out_() << "\n";
+            return;
+        }
+
+        std::streampos endPos = out_().tellp();
+        out_().seekp(sectionSizePos_);
+        writeRaw_(static_cast<std::uint64_t>(endPos - sectionDataPos_));
+        out_().seekp(endPos);
+        writePadding_();
+
+        if (!out_().good())
+            OPM_THROW(std::runtime_error,
+                      "Could not write to restart file '" << fileName_ << "'");
+    }
+
+    /*!
+     * \brief Write a contiguous block of values to a binary restart file.
+     *
+     * The values are retrieved by calling <tt>value = fn(size_t idx)</tt> for all
+     * indices between 0 and numValues-1. The object returned must be convertible to a
+     * trivially copyable type T. This avoids to copy all data into a temporary buffer,
+     * while still writing large chunks to the file.
+     */
+    template <class T, class Functor>
+    void serializeBlock(size_t numValues, Functor fn)
+    {
+        if (!isBinary())
+            OPM_THROW(std::logic_error,
+                      "Blocks of values can only be written to binary restart files");
+
+        writeRaw_(static_cast<std::uint64_t>(numValues));
+        writeRaw_(static_cast<std::uint32_t>(sizeof(T)));
+
+        static const size_t chunkSize = 64*1024;
+        std::vector<T> buf(std::min(numValues, chunkSize));
+        for (size_t chunkBegin = 0; chunkBegin < numValues; chunkBegin += chunkSize) {
+            size_t n = std::min(chunkSize, numValues - chunkBegin);
+            for (size_t i = 0; i < n; ++i)
+                buf[i] = fn(chunkBegin + i);
+            out_().write(reinterpret_cast<const char*>(buf.data()),
+                             static_cast<std::streamsize>(n*sizeof(T)));
+        }
+    }
 
     /*!
      * \brief Serialize all leaf entities of a codim in a gridView.
@@ -146,8 +395,8 @@ public:
         Iterator it = gridView.template begin<codim>();
         const Iterator& endIt = gridView.template end<codim>();
         for (; it != endIt; ++it) {
-            serializer.serializeEntity(outStream_, *it);
-            outStream_ << "\n";
+            serializer.serializeEntity(out_(), *it);
+            out_() << "\n";
         }
 
         serializeSectionEnd();
@@ -157,7 +406,37 @@ public:
      * \brief Finish the restart file.
      */
     void serializeEnd()
-    { outStream_.close(); }
+    {
+        if (deferredWrite_)
+            finishDeferred_();
+        else if (format_ == CollectiveFormat)
+            writeCollective_();
+        else
+            outFile_.close();
+    }
+
+    /*!
+     * \brief Write a restart file which was assembled in memory.
+     *
+     * This requires deferred writing to be enabled and serializeEnd() to be called
+     * before. Only async-signal-safe system calls are used so that the method can be
+     * called by a forked child process of a multi-threaded program. If the file could
+     * not be written, false is returned.
+     */
+    bool writeDeferred() const
+    {
+        int flags = O_WRONLY | O_CREAT;
+        if (deferredTruncate_)
+            flags |= O_TRUNC;
+        int fd = ::open(fileName_.c_str(), flags, 0644);
+        if (fd < 0)
+            return false;
+
+        bool success =
+            writeAt_(fd, deferredHeader_.data(), deferredHeader_.size(), /*offset=*/0)
+            && writeAt_(fd, deferredData_.data(), deferredData_.size(), deferredDataOffset_);
+        return ::close(fd) == 0 && success;
+    }
 
     /*!
      * \brief Start reading a restart file at a certain simulated
@@ -166,7 +445,33 @@ public:
     template <class Simulator, class Scalar>
     void deserializeBegin(Simulator& simulator, Scalar t)
     {
-        fileName_ = restartFileName_(simulator.gridView(), simulator.problem().name(), t);
+        const auto& gridView = simulator.gridView();
+        const std::string& simName = simulator.problem().name();
+        fileName_ = restartFileName_(gridView, simName, t, format_);
+        if (!fileExists_(fileName_)) {
+            // fall back to the restart files of the other formats
+            static const Format fallbackFormats[] =
+                { CollectiveFormat, BinaryFormat, TextFormat };
+            for (unsigned i = 0; i < 3; ++i) {
+                Format otherFormat = fallbackFormats[i];
+                const std::string& otherFileName =
+                    restartFileName_(gridView, simName, t, otherFormat);
+                if (otherFormat != format_ && fileExists_(otherFileName)) {
+                    format_ = otherFormat;
+                    fileName_ = otherFileName;
+                    break;
+                }
+            }
+        }
+
+        const std::string magicCookie = magicRestartCookie_(gridView);
+        if (isBinary()) {
+            mapFile_(gridView.comm().rank(), gridView.comm().size());
+
+            deserializeSectionBegin(magicCookie);
+            deserializeSectionEnd();
+            return;
+        }
 
         // open input file and read magic cookie
         inStream_.open(fileName_.c_str());
@@ -184,8 +489,6 @@ public:
         }
         inStream_.seekg(0, std::ios::beg);
 
-        const std::string magicCookie = magicRestartCookie_(simulator.gridView());
-
         deserializeSectionBegin(magicCookie);
         deserializeSectionEnd();
     }
@@ -195,13 +498,22 @@ public:
      *        deserialized.
      */
     std::istream& deserializeStream()
-    { return inStream_; }
+    {
+        if (isBinary())
+            return inBinaryStream_;
+        return inStream_;
+    }
 
     /*!
      * \brief Start reading a new section of the restart file.
      */
     void deserializeSectionBegin(const std::string& cookie)
     {
+        if (isBinary()) {
+            deserializeBinarySectionBegin_(cookie);
+            return;
+        }
+
         if (!inStream_.good())
             OPM_THROW(std::runtime_error,
                       "Encountered unexpected EOF in restart file.");
@@ -212,11 +524,63 @@ public:
                       "Could not start section '" << cookie << "'");
     }
 
+    /*!
+     * \brief Returns true if the next section of a binary restart file has a given
+     *        cookie.
+     *
+     * This allows to read optional sections. For text restart files, false is always
+     * returned.
+     */
+    bool hasSection(const std::string& cookie) const
+    {
+        if (!isBinary())
+            return false;
+
+        size_t pos = sectionPos_;
+        if (binarySize_ - pos < sizeof(std::uint64_t))
+            return false;
+
+        std::uint64_t cookieLen;
+        std::memcpy(&cookieLen, binaryData_ + pos, sizeof(cookieLen));
+        pos += sizeof(cookieLen);
+        if (binarySize_ - pos < cookieLen)
+            return false;
+
+        return std::string(binaryData_ + pos, cookieLen) == cookie;
+    }
+
+    /*!
+     * \brief Skip a section of a binary restart file without reading its data.
+     */
+    void skipSection(const std::string& cookie)
+    {
+        if (!isBinary())
+            OPM_THROW(std::logic_error,
+                      "Sections can only be skipped in binary restart files");
+
+        deserializeBinarySectionBegin_(cookie);
+        inBinaryBuf_.advance(inBinaryBuf_.remaining());
+    }
+
     /*!
      * \brief End of a section in the serialized output.
      */
     void deserializeSectionEnd()
     {
+        if (isBinary()) {
+            // only white space may be left at the end of the section
+            const char* c = inBinaryBuf_.current();
+            const char* endC = c + inBinaryBuf_.remaining();
+            for (; c != endC; ++c) {
+                if (!std::isspace(*c)) {
+                    OPM_THROW(std::logic_error,
+                              "Encountered unread values while deserializing");
+                }
+            }
+            inBinaryBuf_.advance(inBinaryBuf_.remaining());
+            return;
+        }
+
         std::string dummy;
         std::getline(inStream_, dummy);
         for (unsigned i = 0; i < dummy.length(); ++i) {
@@ -227,6 +591,41 @@ public:
         }
     }
 
+    /*!
+     * \brief Read a contiguous block of values from a binary restart file.
+     *
+     * This is the counterpart of serializeBlock(): For each of the numValues values,
+     * <tt>fn(size_t idx, const T& value)</tt> is called. An exception is thrown if the
+     * block stored in the file does not contain the expected number of values or if
+     * the size of the values is different.
+     */
+    template <class T, class Functor>
+    void deserializeBlock(size_t numValues, Functor fn)
+    {
+        if (!isBinary())
+            OPM_THROW(std::logic_error,
+                      "Blocks of values can only be read from binary restart files");
+
+        std::uint64_t storedNumValues = readRaw_<std::uint64_t>();
+        std::uint32_t storedValueSize = readRaw_<std::uint32_t>();
+        if (storedNumValues != numValues || storedValueSize != sizeof(T))
+            OPM_THROW(std::runtime_error,
+                      "Restart file '" << fileName_ << "': Expected a block of "
+                      << numValues << " values of " << sizeof(T) << " bytes, got "
+                      << storedNumValues << " values of " << storedValueSize << " bytes");
+
+        if (inBinaryBuf_.remaining() < numValues*sizeof(T))
+            OPM_THROW(std::runtime_error, "Restart file is corrupted");
+
+        const char* data = inBinaryBuf_.current();
+        for (size_t i = 0; i < numValues; ++i) {
+            T value;
+            std::memcpy(&value, data + i*sizeof(T), sizeof(T));
+            fn(i, value);
+        }
+        inBinaryBuf_.advance(numValues*sizeof(T));
+    }
+
     /*!
      * \brief Deserialize all leaf entities of a codim in a grid.
      *
@@ -246,12 +645,13 @@ public:
         typedef typename GridView::template Codim<codim>::Iterator Iterator;
         Iterator it = gridView.template begin<codim>();
         const Iterator& endIt = gridView.template end<codim>();
+        std::istream& inStream = deserializeStream();
         for (; it != endIt; ++it) {
-            if (!inStream_.good()) {
+            if (!inStream.good()) {
                 OPM_THROW(std::runtime_error, "Restart file is corrupted");
             }
 
-            std::getline(inStream_, curLine);
+            std::getline(inStream, curLine);
             std::istringstream curLineStream(curLine);
             deserializer.deserializeEntity(curLineStream, *it);
         }
@@ -263,12 +663,363 @@ public:
      * \brief Stop reading the restart file.
      */
     void deserializeEnd()
-    { inStream_.close(); }
+    {
+        if (isBinary())
+            unmapFile_();
+        else
+            inStream_.close();
+    }
 
 private:
+    std::ostream& out_()
+    {
+        if (format_ == CollectiveFormat || deferredWrite_)
+            return outBuffer_;
+        return outFile_;
+    }
+
+    template <class T>
+    void writeRaw_(const T& value)
+    { out_().write(reinterpret_cast<const char*>(&value), sizeof(T)); }
+
+    void writePadding_()
+    {
+        static const char zeros[sectionAlignment_] = { 0 };
+        size_t pos = static_cast<size_t>(out_().tellp());
+        size_t numPad = (sectionAlignment_ - pos%sectionAlignment_)%sectionAlignment_;
+        out_().write(zeros, static_cast<std::streamsize>(numPad));
+    }
+
+    template <class T>
+    T readRaw_()
+    {
+        if (inBinaryBuf_.remaining() < sizeof(T))
+            OPM_THROW(std::runtime_error, "Restart file is corrupted");
+
+        T value;
+        std::memcpy(&value, inBinaryBuf_.current(), sizeof(T));
+        inBinaryBuf_.advance(sizeof(T));
+        return value;
+    }
+
+    void deserializeBinarySectionBegin_(const std::string& cookie)
+    {
+        // the stream buffer covers the whole rest of the file while the header of the
+        // section is parsed
+        inBinaryBuf_.setRange(binaryData_ + sectionPos_, binaryData_ + binarySize_);
+        inBinaryStream_.clear();
+        if (inBinaryBuf_.remaining() == 0)
+            OPM_THROW(std::runtime_error,
+                      "Encountered unexpected EOF in restart file.");
+
+        std::uint64_t cookieLen = readRaw_<std::uint64_t>();
+        if (inBinaryBuf_.remaining() < cookieLen)
+            OPM_THROW(std::runtime_error, "Restart file is corrupted");
+        std::string storedCookie(inBinaryBuf_.current(), cookieLen);
+        inBinaryBuf_.advance(cookieLen);
+        if (storedCookie != cookie)
+            OPM_THROW(std::runtime_error,
+                      "Could not start section '" << cookie << "'");
+
+        std::uint64_t dataLen = readRaw_<std::uint64_t>();
+        if (inBinaryBuf_.remaining() < dataLen)
+            OPM_THROW(std::runtime_error, "Restart file is corrupted");
+
+        const char* dataBegin = inBinaryBuf_.current();
+        inBinaryBuf_.setRange(dataBegin, dataBegin + dataLen);
+
+        size_t dataEndPos = static_cast<size_t>(dataBegin - binaryData_) + dataLen;
+        sectionPos_ = dataEndPos + (sectionAlignment_ - dataEndPos%sectionAlignment_)%sectionAlignment_;
+        sectionPos_ = std::min(sectionPos_, binarySize_);
+    }
+
+    void mapFile_(int rank, int numRanks)
+    {
+        int fd = ::open(fileName_.c_str(), O_RDONLY);
+        if (fd < 0)
+            OPM_THROW(std::runtime_error, "Restart file '" << fileName_
+                                          << "' could not be opened properly");
+
+        struct stat statBuf;
+        if (::fstat(fd, &statBuf) != 0 || statBuf.st_size == 0) {
+            ::close(fd);
+            OPM_THROW(std::runtime_error,
+                      "Restart file '" << fileName_ << "' is empty");
+        }
+
+        mappedSize_ = static_cast<size_t>(statBuf.st_size);
+        void* data = ::mmap(0, mappedSize_, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED) {
+            mappedSize_ = 0;
+            OPM_THROW(std::runtime_error, "Restart file '" << fileName_
+                                          << "' could not be mapped into memory");
+        }
+        mappedData_ = static_cast<const char*>(data);
+
+        binaryData_ = mappedData_;
+        binarySize_ = mappedSize_;
+        if (format_ == CollectiveFormat) {
+            // find the part of the file which belongs to the current process
+            static const size_t headerSize = 8 + 2*sizeof(std::uint32_t);
+            checkFileHeader_(mappedData_, mappedSize_, collectiveMagic_(), headerSize);
+
+            std::uint32_t storedNumRanks;
+            std::memcpy(&storedNumRanks, mappedData_ + 12, sizeof(storedNumRanks));
+            if (storedNumRanks != static_cast<std::uint32_t>(numRanks))
+                OPM_THROW(std::runtime_error,
+                          "Restart file '" << fileName_ << "' was written by "
+                          << storedNumRanks << " processes, but " << numRanks
+                          << " processes are used");
+
+            size_t tablePos = headerSize + 2*sizeof(std::uint64_t)*static_cast<size_t>(rank);
+            if (mappedSize_ < tablePos + 2*sizeof(std::uint64_t))
+                OPM_THROW(std::runtime_error, "Restart file is corrupted");
+
+            std::uint64_t offset;
+            std::uint64_t size;
+            std::memcpy(&offset, mappedData_ + tablePos, sizeof(offset));
+            std::memcpy(&size, mappedData_ + tablePos + sizeof(offset), sizeof(size));
+            if (offset + size > mappedSize_)
+                OPM_THROW(std::runtime_error, "Restart file is corrupted");
+
+            binaryData_ = mappedData_ + offset;
+            binarySize_ = size;
+        }
+
+        size_t headerSize = 8 + sizeof(std::uint32_t);
+        checkFileHeader_(binaryData_, binarySize_, binaryMagic_(), headerSize);
+        sectionPos_ = headerSize + (sectionAlignment_ - headerSize%sectionAlignment_)%sectionAlignment_;
+    }
+
+    // make sure that a buffer starts with a given magic string and that it has been
+    // written on a machine with the same endianess
+    void checkFileHeader_(const char* data,
+                          size_t size,
+                          const char* magic,
+                          size_t minSize) const
+    {
+        if (size < minSize || std::memcmp(data, magic, 8) != 0)
+            OPM_THROW(std::runtime_error,
+                      "File '" << fileName_ << "' is not a binary eWoms restart file");
+
+        std::uint32_t marker;
+        std::memcpy(&marker, data + 8, sizeof(marker));
+        if (marker != endianessMarker_)
+            OPM_THROW(std::runtime_error,
+                      "Restart file '" << fileName_ << "' was written on a machine with "
+                      "different endianess");
+    }
+
+    // write the data of all processes to a single file. the file starts with a header
+    // and a table which contains the offset and the size of the data of each process.
+    // each of these parts has the same structure as a binary restart file.
+    void writeCollective_()
+    {
+        const std::string& localData = outBuffer_.str();
+        std::uint64_t localSize = localData.size();
+
+        std::uint64_t localOffset;
+        const std::string& headerData = collectiveHeader_(localSize, localOffset);
+
+#if HAVE_MPI
+        int rank = 0;
+        int numRanks = 1;
+        MPI_Comm_rank(comm_, &rank);
+        MPI_Comm_size(comm_, &numRanks);
+
+        if (numRanks > 1) {
+            MPI_File fh;
+            int err = MPI_File_open(comm_,
+                                    const_cast<char*>(fileName_.c_str()),
+                                    MPI_MODE_CREATE | MPI_MODE_WRONLY,
+                                    MPI_INFO_NULL,
+                                    &fh);
+            if (err != MPI_SUCCESS)
+                OPM_THROW(std::runtime_error,
+                          "Restart file '" << fileName_ << "' could not be opened for writing");
+            MPI_File_set_size(fh, 0);
+
+            if (rank == 0)
+                MPI_File_write_at(fh, 0,
+                                  const_cast<char*>(headerData.data()),
+                                  static_cast<int>(headerData.size()),
+                                  MPI_BYTE,
+                                  MPI_STATUS_IGNORE);
+
+            // collective writes allow the MPI library to aggregate the data of the
+            // processes. since MPI-IO uses integers for the size of the buffers, the
+            // data of a process might need to be written in multiple chunks. all
+            // processes need to take part in every collective call.
+            std::uint64_t numChunks = (localSize + collectiveChunkSize_ - 1)/collectiveChunkSize_;
+            std::uint64_t maxNumChunks = numChunks;
+            MPI_Allreduce(&numChunks, &maxNumChunks, 1, MPI_UINT64_T, MPI_MAX, comm_);
+            for (std::uint64_t chunkIdx = 0; chunkIdx < maxNumChunks; ++chunkIdx) {
+                std::uint64_t chunkBegin = std::min<std::uint64_t>(chunkIdx*collectiveChunkSize_, localSize);
+                std::uint64_t chunkEnd = std::min<std::uint64_t>(chunkBegin + collectiveChunkSize_, localSize);
+                MPI_File_write_at_all(fh,
+                                      static_cast<MPI_Offset>(localOffset + chunkBegin),
+                                      const_cast<char*>(localData.data() + chunkBegin),
+                                      static_cast<int>(chunkEnd - chunkBegin),
+                                      MPI_BYTE,
+                                      MPI_STATUS_IGNORE);
+            }
+
+            MPI_File_close(&fh);
+            outBuffer_.str("");
+            return;
+        }
+#endif
+
+        // with a single process, the file can be written directly
+        std::ofstream outFile(fileName_.c_str(), std::ios::out | std::ios::binary);
+        outFile.write(headerData.data(), static_cast<std::streamsize>(headerData.size()));
+        outFile.write(localData.data(), static_cast<std::streamsize>(localData.size()));
+        if (!outFile.good())
+            OPM_THROW(std::runtime_error,
+                      "Could not write to restart file '" << fileName_ << "'");
+        outBuffer_.str("");
+    }
+
+    // assemble the header of a collective restart file and determine the position of
+    // the data of the local process in the file. this must be called by all processes.
+    std::string collectiveHeader_(std::uint64_t localSize, std::uint64_t& localOffset) const
+    {
+        int rank = 0;
+        int numRanks = 1;
+#if HAVE_MPI
+        MPI_Comm_rank(comm_, &rank);
+        MPI_Comm_size(comm_, &numRanks);
+#endif
+
+        std::vector<std::uint64_t> sizes(static_cast<size_t>(numRanks), localSize);
+#if HAVE_MPI
+        MPI_Allgather(&localSize, 1, MPI_UINT64_T,
+                      sizes.data(), 1, MPI_UINT64_T,
+                      comm_);
+#endif
+
+        // assemble the header. the data of each process is aligned to the same
+        // boundaries as the sections of binary files.
+        std::ostringstream header(std::ios::out | std::ios::binary);
+        header.write(collectiveMagic_(), 8);
+        std::uint32_t marker = endianessMarker_;
+        std::uint32_t numRanks32 = static_cast<std::uint32_t>(numRanks);
+        header.write(reinterpret_cast<const char*>(&marker), sizeof(marker));
+        header.write(reinterpret_cast<const char*>(&numRanks32), sizeof(numRanks32));
+
+        std::vector<std::uint64_t> offsets(sizes.size());
+        std::uint64_t offset = 8 + 2*sizeof(std::uint32_t) + 2*sizeof(std::uint64_t)*sizes.size();
+        for (size_t i = 0; i < sizes.size(); ++i) {
+            offsets[i] = offset;
+            if (static_cast<int>(i) == rank)
+                localOffset = offset;
+            header.write(reinterpret_cast<const char*>(&offsets[i]), sizeof(offsets[i]));
+            header.write(reinterpret_cast<const char*>(&sizes[i]), sizeof(sizes[i]));
+            offset += sizes[i] + (sectionAlignment_ - sizes[i]%sectionAlignment_)%sectionAlignment_;
+        }
+        return header.str();
+    }
+
+    // finish a restart file which is written by writeDeferred(). the data of all
+    // formats is assembled in memory. the collective format additionally requires the
+    // offsets of the processes to be exchanged and the file to be truncated before any
+    // process may write to it, which can only be done by the process which uses MPI.
+    void finishDeferred_()
+    {
+        deferredData_ = outBuffer_.str();
+        outBuffer_.str("");
+        deferredHeader_.clear();
+        deferredDataOffset_ = 0;
+        deferredTruncate_ = true;
+        if (format_ != CollectiveFormat)
+            return;
+
+        std::uint64_t localOffset;
+        const std::string& headerData = collectiveHeader_(deferredData_.size(), localOffset);
+        deferredDataOffset_ = localOffset;
+
+        int rank = 0;
+        int numRanks = 1;
+#if HAVE_MPI
+        MPI_Comm_rank(comm_, &rank);
+        MPI_Comm_size(comm_, &numRanks);
+#endif
+        if (rank == 0)
+            deferredHeader_ = headerData;
+        if (numRanks == 1)
+            return;
+
+        // the processes write disjoint parts of the same file, so it must not be
+        // truncated by any of them
+        deferredTruncate_ = false;
+        if (rank == 0) {
+            int fd = ::open(fileName_.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0 || ::close(fd) != 0)
+                OPM_THROW(std::runtime_error,
+                          "Restart file '" << fileName_ << "' could not be opened for writing");
+        }
+#if HAVE_MPI
+        MPI_Barrier(comm_);
+#endif
+    }
+
+    // write a buffer to a given position of a file
+    static bool writeAt_(int fd, const char* data, size_t size, std::uint64_t offset)
+    {
+        while (size > 0) {
+            ssize_t n = ::pwrite(fd, data, size, static_cast<off_t>(offset));
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            data += n;
+            size -= static_cast<size_t>(n);
+            offset += static_cast<std::uint64_t>(n);
+        }
+        return true;
+    }
+
+    void unmapFile_()
+    {
+        if (mappedData_)
+            ::munmap(const_cast<char*>(mappedData_), mappedSize_);
+        mappedData_ = 0;
+        mappedSize_ = 0;
+    }
+
+    Format format_;
     std::string fileName_;
     std::ifstream inStream_;
-    std::ofstream outStream_;
+    std::ofstream outFile_;
+    std::stringstream outBuffer_;
+
+    // state for writing binary restart files
+    std::streampos sectionSizePos_;
+    std::streampos sectionDataPos_;
+
+    // state for reading binary restart files
+    const char* mappedData_;
+    size_t mappedSize_;
+
+    // the part of the mapped file which belongs to the current process
+    const char* binaryData_;
+    size_t binarySize_;
+    size_t sectionPos_;
+    MemoryStreamBuf_ inBinaryBuf_;
+    std::istream inBinaryStream_;
+
+    // state for restart files which are written by writeDeferred()
+    bool deferredWrite_;
+    std::string deferredHeader_;
+    std::string deferredData_;
+    std::uint64_t deferredDataOffset_;
+    bool deferredTruncate_;
+
+    // the communicator of the grid view which is serialized. it is used to write
+    // collective restart files.
+    MpiCommunicator comm_;
 };
 } // namespace Ewoms
 
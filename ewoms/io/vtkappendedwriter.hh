@@ -0,0 +1,742 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \copydoc Ewoms::VtkAppendedWriter
+ */
+#ifndef EWOMS_VTK_APPENDED_WRITER_HH
+#define EWOMS_VTK_APPENDED_WRITER_HH
+
+#include <ewoms/io/baseoutputwriter.hh>
+
+#include <opm/common/Exceptions.hpp>
+#include <opm/common/ErrorMacros.hpp>
+
+#include <dune/grid/io/file/vtk/common.hh>
+#include <dune/grid/io/file/vtk/function.hh>
+#include <dune/grid/io/file/vtk/vtkwriter.hh>
+#include <dune/geometry/referenceelements.hh>
+#include <dune/common/fvector.hh>
+#include <dune/common/version.hh>
+
+#if HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#if HAVE_LZ4
+#include <lz4.h>
+#endif
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+#include <list>
+#include <sstream>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <stdexcept>
+
+namespace Ewoms {
+
+/*!
+ * \brief Writes VTK unstructured grid files which store their data as raw binary
+ *        appended data.
+ *
+ * In contrast to the inline ASCII and base64 formats, the data of the appended format
+ * does not need to be encoded, so writing the files is limited by the speed of the
+ * disk. Optionally, each data array can be split into blocks which are individually
+ * compressed using zlib or LZ4 (cf. the vtkZLibDataCompressor and
+ * vtkLZ4DataCompressor classes of VTK). Like for the Dune VTK writer, the data is
+ * written in single precision and only the interior elements of the process are
+ * written. In parallel runs, each process writes its own piece file and the first
+ * process writes the '.pvtu' file which references them. Since no communication is
+ * required, this writer can be used from any thread. Finally, the output can be
+ * restricted to a subset of the elements (cf. setElementFilter()).
+ *
+ * Besides VTK functions, the data can be specified as the buffers of the output
+ * modules (cf. addVertexBuffer() and addCellBuffer()). These are copied to the data
+ * arrays using the indices of the written vertices and elements which have been
+ * determined while walking the grid, i.e., without evaluating a virtual function for
+ * each value.
+ */
+template <class GridView>
+class VtkAppendedWriter
+{
+    enum { dim = GridView::dimension };
+    enum { dimWorld = GridView::dimensionworld };
+
+    typedef typename GridView::ctype CoordScalar;
+    typedef typename GridView::template Codim<0>::Entity Element;
+    typedef typename GridView::template Codim<0>::template Partition<Dune::Interior_Partition>::Iterator ElementIterator;
+    typedef Dune::ReferenceElements<CoordScalar, dim> ReferenceElements;
+
+    typedef BaseOutputWriter::ScalarBuffer ScalarBuffer;
+    typedef BaseOutputWriter::VectorBuffer VectorBuffer;
+    typedef BaseOutputWriter::TensorBuffer TensorBuffer;
+
+public:
+#if DUNE_VERSION_NEWER(DUNE_GRID, 2, 5)
+    typedef std::shared_ptr< Dune::VTKFunction< GridView > > FunctionPtr;
+#else
+    typedef typename Dune::VTKWriter<GridView>::VTKFunctionPtr FunctionPtr;
+#endif
+
+    /*!
+     * \brief The algorithm used to compress the data arrays.
+     */
+    enum Compression {
+        NoCompression,
+        ZlibCompression,
+        Lz4Compression
+    };
+
+    VtkAppendedWriter(const GridView& gridView, Compression compression = NoCompression)
+        : gridView_(gridView)
+        , compression_(compression)
+    {
+        checkCompressionSupported(compression_);
+
+        commRank_ = gridView.comm().rank();
+        commSize_ = gridView.comm().size();
+
+        vertexBufferIdx_ = 0;
+        elementBufferIdx_ = 0;
+    }
+
+    /*!
+     * \brief Convert the name of a compression algorithm to a Compression object.
+     *
+     * Valid names are 'none', 'zlib' and 'lz4'.
+     */
+    static Compression compressionFromString(const std::string& name)
+    {
+        if (name == "none")
+            return NoCompression;
+        else if (name == "zlib")
+            return ZlibCompression;
+        else if (name == "lz4")
+            return Lz4Compression;
+
+        OPM_THROW(std::invalid_argument,
+                  "Unknown VTK compression algorithm '" << name << "'. "
+                  "(supported are 'none', 'zlib' and 'lz4')");
+    }
+
+    /*!
+     * \brief Throw an exception if the support for a compression algorithm has not
+     *        been available at compile time.
+     */
+    static void checkCompressionSupported(Compression compression)
+    {
+#if !HAVE_ZLIB
+        if (compression == ZlibCompression)
+            OPM_THROW(std::runtime_error,
+                      "zlib compressed VTK output requires eWoms to be built with zlib");
+#endif
+#if !HAVE_LZ4
+        if (compression == Lz4Compression)
+            OPM_THROW(std::runtime_error,
+                      "LZ4 compressed VTK output requires eWoms to be built with LZ4");
+#endif
+    }
+
+    /*!
+     * \brief Only write a subset of the elements.
+     *
+     * The flags are indexed by the element mapper. Only the vertices of the
+     * selected elements are written. An empty vector selects all elements.
+     */
+    template <class ElementMapper>
+    void setElementFilter(const std::vector<bool>& isWrittenElement,
+                          const ElementMapper& elementMapper)
+    {
+        isWrittenElement_.clear();
+        if (isWrittenElement.empty())
+            return;
+
+        // convert the flags to the numbering of the index set
+        const auto& indexSet = gridView_.indexSet();
+        isWrittenElement_.resize(indexSet.size(/*codim=*/0), false);
+        ElementIterator elemIt = gridView_.template begin<0, Dune::Interior_Partition>();
+        const ElementIterator& elemEndIt = gridView_.template end<0, Dune::Interior_Partition>();
+        for (; elemIt != elemEndIt; ++elemIt) {
+#if DUNE_VERSION_NEWER(DUNE_COMMON, 2, 4)
+            size_t mapperIdx = static_cast<size_t>(elementMapper.index(*elemIt));
+#else
+            size_t mapperIdx = static_cast<size_t>(elementMapper.map(*elemIt));
+#endif
+            isWrittenElement_[static_cast<size_t>(indexSet.index(*elemIt))] = isWrittenElement[mapperIdx];
+        }
+    }
+
+    /*!
+     * \brief Add a vertex centered quantity to the output.
+     */
+    void addVertexData(const FunctionPtr& fn)
+    { vertexFunctions_.push_back(fn); }
+
+    /*!
+     * \brief Add a element centered quantity to the output.
+     */
+    void addCellData(const FunctionPtr& fn)
+    { cellFunctions_.push_back(fn); }
+
+    /*!
+     * \brief Specify the indices of the buffers for the entities of the index set.
+     *
+     * The maps are indexed by the index set of the grid view and are used to look up
+     * the entries of the buffers which are added by addVertexBuffer() and
+     * addCellBuffer(). If no maps are specified, the buffers are indexed by the index
+     * set. The vectors must exist until write() has returned.
+     */
+    void setBufferIndexMaps(const std::vector<unsigned>& vertexBufferIdx,
+                            const std::vector<unsigned>& elementBufferIdx)
+    {
+        vertexBufferIdx_ = &vertexBufferIdx;
+        elementBufferIdx_ = &elementBufferIdx;
+    }
+
+    /*!
+     * \brief Add a buffer of vertex centered scalars to the output.
+     *
+     * The buffer must exist until write() has returned.
+     */
+    void addVertexBuffer(const ScalarBuffer& buf, const std::string& name)
+    { vertexBuffers_.push_back(bufferSource_(name, &buf, 0, 0, 0)); }
+
+    /*!
+     * \brief Add a buffer of vertex centered vectors to the output.
+     */
+    void addVertexBuffer(const VectorBuffer& buf, const std::string& name)
+    { vertexBuffers_.push_back(bufferSource_(name, 0, &buf, 0, 0)); }
+
+    /*!
+     * \brief Add a column of a buffer of vertex centered tensors to the output.
+     */
+    void addVertexBuffer(const TensorBuffer& buf, const std::string& name, unsigned colIdx)
+    { vertexBuffers_.push_back(bufferSource_(name, 0, 0, &buf, colIdx)); }
+
+    /*!
+     * \brief Add a buffer of element centered scalars to the output.
+     */
+    void addCellBuffer(const ScalarBuffer& buf, const std::string& name)
+    { cellBuffers_.push_back(bufferSource_(name, &buf, 0, 0, 0)); }
+
+    /*!
+     * \brief Add a buffer of element centered vectors to the output.
+     */
+    void addCellBuffer(const VectorBuffer& buf, const std::string& name)
+    { cellBuffers_.push_back(bufferSource_(name, 0, &buf, 0, 0)); }
+
+    /*!
+     * \brief Add a column of a buffer of element centered tensors to the output.
+     */
+    void addCellBuffer(const TensorBuffer& buf, const std::string& name, unsigned colIdx)
+    { cellBuffers_.push_back(bufferSource_(name, 0, 0, &buf, colIdx)); }
+
+    /*!
+     * \brief Write the file(s) for the attached functions.
+     *
+     * The returned string is the name of the file which ought to be referenced by the
+     * multi-file, i.e., the '.vtu' file for sequential runs and the '.pvtu' file for
+     * parallel ones.
+     */
+    std::string write(const std::string& name,
+                      Dune::VTK::OutputType type = Dune::VTK::appendedraw)
+    {
+        if (type != Dune::VTK::appendedraw)
+            OPM_THROW(std::logic_error,
+                      "The appended VTK writer only supports raw binary output");
+
+        Piece_ piece;
+        collectPiece_(piece);
+
+        std::string pieceName = name + ".vtu";
+        if (commSize_ > 1)
+            pieceName = parallelPieceName_(name, commRank_);
+
+        writePiece_(pieceName, piece);
+
+        if (commSize_ == 1)
+            return pieceName;
+
+        std::string headerName = parallelHeaderName_(name);
+        if (commRank_ == 0)
+            writeParallelHeader_(headerName, name, piece);
+        return headerName;
+    }
+
+private:
+    // a buffer of the output modules. exactly one of the pointers is non-zero
+    struct BufferSource_
+    {
+        std::string name;
+        const ScalarBuffer* scalarBuffer;
+        const VectorBuffer* vectorBuffer;
+        const TensorBuffer* tensorBuffer;
+        unsigned tensorColumnIdx;
+    };
+
+    static BufferSource_ bufferSource_(const std::string& name,
+                                       const ScalarBuffer* scalarBuffer,
+                                       const VectorBuffer* vectorBuffer,
+                                       const TensorBuffer* tensorBuffer,
+                                       unsigned tensorColumnIdx)
+    {
+        BufferSource_ src;
+        src.name = name;
+        src.scalarBuffer = scalarBuffer;
+        src.vectorBuffer = vectorBuffer;
+        src.tensorBuffer = tensorBuffer;
+        src.tensorColumnIdx = tensorColumnIdx;
+        return src;
+    }
+
+    // the data of a single array in single precision
+    struct DataArray_
+    {
+        std::string name;
+        unsigned numComponents;
+        std::vector<float> values;
+    };
+
+    // all data which is written by the current process
+    struct Piece_
+    {
+        std::vector<float> coordinates;
+        std::vector<int32_t> connectivity;
+        std::vector<int32_t> offsets;
+        std::vector<uint8_t> types;
+
+        std::vector<DataArray_> pointData;
+        std::vector<DataArray_> cellData;
+
+        size_t numPoints() const
+        { return coordinates.size()/3; }
+
+        size_t numCells() const
+        { return types.size(); }
+    };
+
+    // paraview only interprets arrays of three components as vectors, so two
+    // dimensional vectors are padded by a zero like it is done by the Dune VTK writer
+    static unsigned numWrittenComponents_(const FunctionPtr& fn)
+    {
+        unsigned n = static_cast<unsigned>(fn->ncomps());
+        return (n == 2) ? 3 : n;
+    }
+
+    static void initArrays_(std::vector<DataArray_>& arrays,
+                            const std::list<FunctionPtr>& functions)
+    {
+        arrays.resize(functions.size());
+        auto fnIt = functions.begin();
+        for (unsigned i = 0; i < arrays.size(); ++i, ++fnIt) {
+            arrays[i].name = (*fnIt)->name();
+            arrays[i].numComponents = numWrittenComponents_(*fnIt);
+        }
+    }
+
+    static void appendValues_(DataArray_& array,
+                              const FunctionPtr& fn,
+                              const Element& elem,
+                              const Dune::FieldVector<CoordScalar, dim>& local)
+    {
+        unsigned n = static_cast<unsigned>(fn->ncomps());
+        for (unsigned compIdx = 0; compIdx < n; ++compIdx)
+            array.values.push_back(static_cast<float>(fn->evaluate(static_cast<int>(compIdx), elem, local)));
+        for (unsigned compIdx = n; compIdx < array.numComponents; ++compIdx)
+            array.values.push_back(0.0f);
+    }
+
+    // copy the values of the written entities from the buffers to new data arrays
+    static void appendBufferArrays_(std::vector<DataArray_>& arrays,
+                                    const std::list<BufferSource_>& buffers,
+                                    const std::vector<unsigned>& bufferIdx)
+    {
+        size_t n = bufferIdx.size();
+        auto srcIt = buffers.begin();
+        const auto& srcEndIt = buffers.end();
+        for (; srcIt != srcEndIt; ++srcIt) {
+            const BufferSource_& src = *srcIt;
+            arrays.push_back(DataArray_());
+            DataArray_& array = arrays.back();
+            array.name = src.name;
+
+            if (src.scalarBuffer) {
+                const ScalarBuffer& buf = *src.scalarBuffer;
+                array.numComponents = 1;
+                array.values.resize(n);
+                for (size_t i = 0; i < n; ++i)
+                    array.values[i] = static_cast<float>(buf[bufferIdx[i]]);
+            }
+            else if (src.vectorBuffer) {
+                const VectorBuffer& buf = *src.vectorBuffer;
+                unsigned numComponents = buf.empty() ? 1u : static_cast<unsigned>(buf[0].size());
+                array.numComponents = (numComponents == 2) ? 3 : numComponents;
+                array.values.resize(n*array.numComponents, 0.0f);
+                for (size_t i = 0; i < n; ++i) {
+                    const auto& v = buf[bufferIdx[i]];
+                    float* dest = &array.values[i*array.numComponents];
+                    for (unsigned compIdx = 0; compIdx < numComponents; ++compIdx)
+                        dest[compIdx] = static_cast<float>(v[compIdx]);
+                }
+            }
+            else {
+                // like for Ewoms::VtkTensorFunction, the column of the tensor is
+                // written as a vector
+                const TensorBuffer& buf = *src.tensorBuffer;
+                unsigned colIdx = src.tensorColumnIdx;
+                unsigned numComponents = buf.empty() ? 1u : static_cast<unsigned>(buf[0].M());
+                array.numComponents = (numComponents == 2) ? 3 : numComponents;
+                array.values.resize(n*array.numComponents, 0.0f);
+                for (size_t i = 0; i < n; ++i) {
+                    const auto& t = buf[bufferIdx[i]];
+                    float* dest = &array.values[i*array.numComponents];
+                    for (unsigned compIdx = 0; compIdx < numComponents; ++compIdx)
+                        dest[compIdx] = static_cast<float>(t[compIdx][colIdx]);
+                }
+            }
+        }
+    }
+
+    // evaluate the geometry and all attached functions. The points are numbered in
+    // the order in which they are first encountered by the element loop.
+    void collectPiece_(Piece_& piece) const
+    {
+        initArrays_(piece.pointData, vertexFunctions_);
+        initArrays_(piece.cellData, cellFunctions_);
+
+        const auto& indexSet = gridView_.indexSet();
+        std::vector<int32_t> pointIndex(indexSet.size(dim), -1);
+
+        // the indices of the buffer entries of the written points and cells
+        std::vector<unsigned> pointBufferIdx;
+        std::vector<unsigned> cellBufferIdx;
+
+        ElementIterator elemIt = gridView_.template begin<0, Dune::Interior_Partition>();
+        const ElementIterator& elemEndIt = gridView_.template end<0, Dune::Interior_Partition>();
+        for (; elemIt != elemEndIt; ++elemIt) {
+            const Element& elem = *elemIt;
+            if (!isWrittenElement_.empty()
+                && !isWrittenElement_[static_cast<size_t>(indexSet.index(elem))])
+                continue;
+
+            const Dune::GeometryType& geomType = elem.type();
+            const auto& refElem = ReferenceElements::general(geomType);
+            const auto& geometry = elem.geometry();
+
+            unsigned numCorners = static_cast<unsigned>(refElem.size(dim));
+            for (unsigned vtkCornerIdx = 0; vtkCornerIdx < numCorners; ++vtkCornerIdx) {
+                int cornerIdx = Dune::VTK::renumber(geomType, static_cast<int>(vtkCornerIdx));
+                unsigned vertexIdx = static_cast<unsigned>(indexSet.subIndex(elem, cornerIdx, dim));
+                if (pointIndex[vertexIdx] < 0) {
+                    pointIndex[vertexIdx] = static_cast<int32_t>(piece.numPoints());
+
+                    const auto& pos = geometry.corner(cornerIdx);
+                    for (unsigned dimIdx = 0; dimIdx < 3; ++dimIdx)
+                        piece.coordinates.push_back((dimIdx < dimWorld) ? static_cast<float>(pos[dimIdx]) : 0.0f);
+
+                    if (!vertexBuffers_.empty())
+                        pointBufferIdx.push_back(vertexBufferIdx_ ? (*vertexBufferIdx_)[vertexIdx] : vertexIdx);
+
+                    const auto& local = refElem.position(cornerIdx, dim);
+                    auto fnIt = vertexFunctions_.begin();
+                    for (unsigned i = 0; i < piece.pointData.size(); ++i, ++fnIt)
+                        appendValues_(piece.pointData[i], *fnIt, elem, local);
+                }
+
+                piece.connectivity.push_back(pointIndex[vertexIdx]);
+            }
+
+            piece.offsets.push_back(static_cast<int32_t>(piece.connectivity.size()));
+            piece.types.push_back(static_cast<uint8_t>(Dune::VTK::geometryType(geomType)));
+
+            if (!cellBuffers_.empty()) {
+                unsigned elemIdx = static_cast<unsigned>(indexSet.index(elem));
+                cellBufferIdx.push_back(elementBufferIdx_ ? (*elementBufferIdx_)[elemIdx] : elemIdx);
+            }
+
+            const auto& center = refElem.position(0, 0);
+            auto fnIt = cellFunctions_.begin();
+            for (unsigned i = 0; i < piece.cellData.size(); ++i, ++fnIt)
+                appendValues_(piece.cellData[i], *fnIt, elem, center);
+        }
+
+        appendBufferArrays_(piece.pointData, vertexBuffers_, pointBufferIdx);
+        appendBufferArrays_(piece.cellData, cellBuffers_, cellBufferIdx);
+    }
+
+    static bool isLittleEndian_()
+    {
+        const uint16_t tmp = 1;
+        return *reinterpret_cast<const char*>(&tmp) == 1;
+    }
+
+    const char* byteOrder_() const
+    { return isLittleEndian_() ? "LittleEndian" : "BigEndian"; }
+
+    void writeFileHeader_(std::ostream& os, const char* type) const
+    {
+        os << "<?xml version=\"1.0\"?>\n"
+           << "<VTKFile type=\"" << type << "\" version=\"1.0\""
+           << " byte_order=\"" << byteOrder_() << "\" header_type=\"UInt64\"";
+        if (compression_ == ZlibCompression)
+            os << " compressor=\"vtkZLibDataCompressor\"";
+        else if (compression_ == Lz4Compression)
+            os << " compressor=\"vtkLZ4DataCompressor\"";
+        os << ">\n";
+    }
+
+    // append the encoded representation of a data array to the appended data and
+    // write the XML element which references it
+    template <class T>
+    void addArray_(std::ostream& xml,
+                   std::vector<char>& appendedData,
+                   const char* typeName,
+                   const std::string& name,
+                   unsigned numComponents,
+                   const std::vector<T>& values) const
+    {
+        xml << "    <DataArray type=\"" << typeName << "\" Name=\"" << name << "\""
+            << " NumberOfComponents=\"" << numComponents << "\""
+            << " format=\"appended\" offset=\"" << appendedData.size() << "\"/>\n";
+
+        encode_(appendedData,
+                reinterpret_cast<const char*>(values.data()),
+                values.size()*sizeof(T));
+    }
+
+    static void appendUInt64_(std::vector<char>& buf, uint64_t value)
+    {
+        const char* bytes = reinterpret_cast<const char*>(&value);
+        buf.insert(buf.end(), bytes, bytes + sizeof(value));
+    }
+
+    // encode a data array in the way expected by VTK's appended data section. For
+    // uncompressed data this is the number of bytes followed by the data, for
+    // compressed data it is the number of blocks, the uncompressed size of the
+    // blocks and of the last block, the compressed size of each block and finally
+    // the compressed blocks.
+    void encode_(std::vector<char>& buf, const char* data, size_t numBytes) const
+    {
+        if (compression_ == NoCompression) {
+            appendUInt64_(buf, numBytes);
+            buf.insert(buf.end(), data, data + numBytes);
+            return;
+        }
+
+        size_t numBlocks = (numBytes + compressionBlockSize_() - 1)/compressionBlockSize_();
+        size_t lastBlockSize = numBytes - (numBlocks > 0 ? (numBlocks - 1)*compressionBlockSize_() : 0);
+
+        appendUInt64_(buf, numBlocks);
+        appendUInt64_(buf, compressionBlockSize_());
+        appendUInt64_(buf, lastBlockSize);
+
+        // reserve the space for the table of the compressed block sizes
+        size_t tableOffset = buf.size();
+        buf.resize(buf.size() + numBlocks*sizeof(uint64_t));
+
+        for (size_t blockIdx = 0; blockIdx < numBlocks; ++blockIdx) {
+            size_t blockSize =
+                (blockIdx == numBlocks - 1) ? lastBlockSize : compressionBlockSize_();
+            uint64_t compressedSize =
+                compressBlock_(buf, data + blockIdx*compressionBlockSize_(), blockSize);
+            std::copy(reinterpret_cast<const char*>(&compressedSize),
+                      reinterpret_cast<const char*>(&compressedSize) + sizeof(compressedSize),
+                      buf.begin() + static_cast<std::ptrdiff_t>(tableOffset + blockIdx*sizeof(uint64_t)));
+        }
+    }
+
+    // append a compressed block to a buffer and return its size
+    size_t compressBlock_(std::vector<char>& buf, const char* data, size_t numBytes) const
+    {
+        size_t offset = buf.size();
+
+#if HAVE_ZLIB
+        if (compression_ == ZlibCompression) {
+            uLongf compressedSize = compressBound(static_cast<uLong>(numBytes));
+            buf.resize(offset + compressedSize);
+            int ret = compress2(reinterpret_cast<Bytef*>(&buf[offset]),
+                                &compressedSize,
+                                reinterpret_cast<const Bytef*>(data),
+                                static_cast<uLong>(numBytes),
+                                Z_DEFAULT_COMPRESSION);
+            if (ret != Z_OK)
+                OPM_THROW(std::runtime_error,
+                          "Compressing VTK data using zlib failed (error code " << ret << ")");
+            buf.resize(offset + compressedSize);
+            return compressedSize;
+        }
+#endif
+
+#if HAVE_LZ4
+        if (compression_ == Lz4Compression) {
+            int maxSize = LZ4_compressBound(static_cast<int>(numBytes));
+            buf.resize(offset + static_cast<size_t>(maxSize));
+            int compressedSize = LZ4_compress_default(data,
+                                                      &buf[offset],
+                                                      static_cast<int>(numBytes),
+                                                      maxSize);
+            if (compressedSize <= 0)
+                OPM_THROW(std::runtime_error, "Compressing VTK data using LZ4 failed");
+            buf.resize(offset + static_cast<size_t>(compressedSize));
+            return static_cast<size_t>(compressedSize);
+        }
+#endif
+
+        OPM_THROW(std::logic_error, "Unsupported VTK compression algorithm");
+    }
+
+    void writePiece_(const std::string& fileName, const Piece_& piece) const
+    {
+        std::ostringstream xml;
+        std::vector<char> appendedData;
+
+        writeFileHeader_(xml, "UnstructuredGrid");
+        xml << " <UnstructuredGrid>\n"
+            << "  <Piece NumberOfPoints=\"" << piece.numPoints() << "\""
+            << " NumberOfCells=\"" << piece.numCells() << "\">\n";
+
+        xml << "   <PointData>\n";
+        for (const auto& array : piece.pointData)
+            addArray_(xml, appendedData, "Float32", array.name, array.numComponents, array.values);
+        xml << "   </PointData>\n";
+
+        xml << "   <CellData>\n";
+        for (const auto& array : piece.cellData)
+            addArray_(xml, appendedData, "Float32", array.name, array.numComponents, array.values);
+        xml << "   </CellData>\n";
+
+        xml << "   <Points>\n";
+        addArray_(xml, appendedData, "Float32", "Coordinates", 3, piece.coordinates);
+        xml << "   </Points>\n";
+
+        xml << "   <Cells>\n";
+        addArray_(xml, appendedData, "Int32", "connectivity", 1, piece.connectivity);
+        addArray_(xml, appendedData, "Int32", "offsets", 1, piece.offsets);
+        addArray_(xml, appendedData, "UInt8", "types", 1, piece.types);
+        xml << "   </Cells>\n";
+
+        xml << "  </Piece>\n"
+            << " </UnstructuredGrid>\n"
+            << " <AppendedData encoding=\"raw\">\n"
+            << "_";
+
+        std::ofstream os(fileName.c_str(), std::ios::out | std::ios::binary);
+        if (!os)
+            OPM_THROW(std::runtime_error, "Could not open VTK file '" << fileName << "'");
+
+        const std::string& header = xml.str();
+        os.write(header.data(), static_cast<std::streamsize>(header.size()));
+        os.write(appendedData.data(), static_cast<std::streamsize>(appendedData.size()));
+        os << "\n </AppendedData>\n"
+           << "</VTKFile>\n";
+
+        if (!os)
+            OPM_THROW(std::runtime_error, "Could not write VTK file '" << fileName << "'");
+    }
+
+    void writeParallelDataArrays_(std::ostream& os, const std::vector<DataArray_>& arrays) const
+    {
+        for (const auto& array : arrays)
+            os << "   <PDataArray type=\"Float32\" Name=\"" << array.name << "\""
+               << " NumberOfComponents=\"" << array.numComponents << "\"/>\n";
+    }
+
+    void writeParallelHeader_(const std::string& fileName,
+                              const std::string& name,
+                              const Piece_& piece) const
+    {
+        std::ofstream os(fileName.c_str());
+        if (!os)
+            OPM_THROW(std::runtime_error, "Could not open VTK file '" << fileName << "'");
+
+        writeFileHeader_(os, "PUnstructuredGrid");
+        os << " <PUnstructuredGrid GhostLevel=\"0\">\n";
+
+        os << "  <PPointData>\n";
+        writeParallelDataArrays_(os, piece.pointData);
+        os << "  </PPointData>\n";
+
+        os << "  <PCellData>\n";
+        writeParallelDataArrays_(os, piece.cellData);
+        os << "  </PCellData>\n";
+
+        os << "  <PPoints>\n"
+           << "   <PDataArray type=\"Float32\" Name=\"Coordinates\" NumberOfComponents=\"3\"/>\n"
+           << "  </PPoints>\n";
+
+        for (int rank = 0; rank < commSize_; ++rank)
+            os << "  <Piece Source=\"" << parallelPieceName_(name, rank) << "\"/>\n";
+
+        os << " </PUnstructuredGrid>\n"
+           << "</VTKFile>\n";
+    }
+
+    // the file names of the parallel output follow the ones of the Dune VTK writer
+    std::string parallelPieceName_(const std::string& name, int rank) const
+    {
+        std::ostringstream oss;
+        oss << "s" << std::setw(4) << std::setfill('0') << commSize_ << "-"
+            << "p" << std::setw(4) << std::setfill('0') << rank << "-"
+            << name << ".vtu";
+        return oss.str();
+    }
+
+    std::string parallelHeaderName_(const std::string& name) const
+    {
+        std::ostringstream oss;
+        oss << "s" << std::setw(4) << std::setfill('0') << commSize_ << "-"
+            << name << ".pvtu";
+        return oss.str();
+    }
+
+    // the uncompressed size of a block. This is the default of VTK.
+    static size_t compressionBlockSize_()
+    { return 1 << 15; }
+
+    const GridView gridView_;
+    Compression compression_;
+
+    int commRank_;
+    int commSize_;
+
+    std::list<FunctionPtr> vertexFunctions_;
+    std::list<FunctionPtr> cellFunctions_;
+
+    std::list<BufferSource_> vertexBuffers_;
+    std::list<BufferSource_> cellBuffers_;
+    const std::vector<unsigned>* vertexBufferIdx_;
+    const std::vector<unsigned>* elementBufferIdx_;
+
+    // indexed by the index set. if empty, all elements are written
+    std::vector<bool> isWrittenElement_;
+};
+
+} // namespace Ewoms
+
+#endif
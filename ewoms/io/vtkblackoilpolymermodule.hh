@@ -77,14 +77,10 @@ class VtkBlackOilPolymerModule : public BaseOutputModule<TypeTag>
     typedef BaseOutputModule<TypeTag> ParentType;
 
     typedef typename GET_PROP_TYPE(TypeTag, Simulator) Simulator;
-    typedef typename GET_PROP_TYPE(TypeTag, GridView) GridView;
     typedef typename GET_PROP_TYPE(TypeTag, Scalar) Scalar;
     typedef typename GET_PROP_TYPE(TypeTag, Evaluation) Evaluation;
     typedef typename GET_PROP_TYPE(TypeTag, ElementContext) ElementContext;
 
-    static const int vtkFormat = GET_PROP_VALUE(TypeTag, VtkOutputFormat);
-    typedef Ewoms::VtkMultiWriter<GridView, vtkFormat> VtkMultiWriter;
-
     enum { enablePolymer = GET_PROP_VALUE(TypeTag, EnablePolymer) };
 
     typedef typename ParentType::ScalarBuffer ScalarBuffer;
@@ -164,6 +160,8 @@ public:
         for (unsigned dofIdx = 0; dofIdx < elemCtx.numPrimaryDof(/*timeIdx=*/0); ++dofIdx) {
             const auto& intQuants = elemCtx.intensiveQuantities(dofIdx, /*timeIdx=*/0);
             unsigned globalDofIdx = elemCtx.globalSpaceIndex(dofIdx, /*timeIdx=*/0);
+            if (!this->isOwnedDof_(globalDofIdx))
+                continue;
 
             if (polymerConcentrationOutput_())
                 polymerConcentration_[globalDofIdx] =
@@ -196,8 +194,7 @@ public:
      */
     void commitBuffers(BaseOutputWriter& baseWriter)
     {
-        VtkMultiWriter *vtkWriter = dynamic_cast<VtkMultiWriter*>(&baseWriter);
-        if (!vtkWriter)
+        if (!baseWriter.isVtkLike())
             return;
 
         if (!enablePolymer)
@@ -76,7 +76,6 @@ class VtkDiffusionModule : public BaseOutputModule<TypeTag>
 
     typedef typename GET_PROP_TYPE(TypeTag, Simulator) Simulator;
     typedef typename GET_PROP_TYPE(TypeTag, ElementContext) ElementContext;
-    typedef typename GET_PROP_TYPE(TypeTag, GridView) GridView;
     typedef typename GET_PROP_TYPE(TypeTag, Evaluation) Evaluation;
 
     typedef Opm::MathToolbox<Evaluation> Toolbox;
@@ -84,9 +83,6 @@ class VtkDiffusionModule : public BaseOutputModule<TypeTag>
     typedef typename ParentType::PhaseComponentBuffer PhaseComponentBuffer;
     typedef typename ParentType::PhaseBuffer PhaseBuffer;
 
-    static const int vtkFormat = GET_PROP_VALUE(TypeTag, VtkOutputFormat);
-    typedef Ewoms::VtkMultiWriter<GridView, vtkFormat> VtkMultiWriter;
-
     enum { numPhases = GET_PROP_VALUE(TypeTag, NumPhases) };
     enum { numComponents = GET_PROP_VALUE(TypeTag, NumComponents) };
 
@@ -137,6 +133,8 @@ public:
 
         for (unsigned i = 0; i < elemCtx.numPrimaryDof(/*timeIdx=*/0); ++i) {
             unsigned I = elemCtx.globalSpaceIndex(i, /*timeIdx=*/0);
+            if (!this->isOwnedDof_(I))
+                continue;
             const auto& intQuants = elemCtx.intensiveQuantities(i, /*timeIdx=*/0);
 
             for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++phaseIdx) {
@@ -159,10 +157,8 @@ public:
      */
     void commitBuffers(BaseOutputWriter& baseWriter)
     {
-        VtkMultiWriter *vtkWriter = dynamic_cast<VtkMultiWriter*>(&baseWriter);
-        if (!vtkWriter) {
+        if (!baseWriter.isVtkLike())
             return;
-        }
 
         if (tortuosityOutput_())
             this->commitPhaseBuffer_(baseWriter, "tortuosity", tortuosity_);
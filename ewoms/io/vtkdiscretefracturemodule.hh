@@ -95,9 +95,6 @@ class VtkDiscreteFractureModule : public BaseOutputModule<TypeTag>
 
     typedef typename GET_PROP_TYPE(TypeTag, DiscBaseOutputModule) DiscBaseOutputModule;
 
-    static const int vtkFormat = GET_PROP_VALUE(TypeTag, VtkOutputFormat);
-    typedef Ewoms::VtkMultiWriter<GridView, vtkFormat> VtkMultiWriter;
-
     enum { dim = GridView::dimension };
     enum { dimWorld = GridView::dimensionworld };
     enum { numPhases = GET_PROP_VALUE(TypeTag, NumPhases) };
@@ -156,14 +153,8 @@ public:
             this->resizeScalarBuffer_(fractureVolumeFraction_);
 
         if (velocityOutput_()) {
-            size_t nDof = this->simulator_.model().numGridDof();
-            for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++phaseIdx) {
-                fractureVelocity_[phaseIdx].resize(nDof);
-                for (unsigned dofIdx = 0; dofIdx < nDof; ++dofIdx) {
-                    fractureVelocity_[phaseIdx][dofIdx].resize(dimWorld);
-                    fractureVelocity_[phaseIdx][dofIdx] = 0.0;
-                }
-            }
+            for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++phaseIdx)
+                this->resizeVectorBuffer_(fractureVelocity_[phaseIdx]);
             this->resizePhaseBuffer_(fractureVelocityWeight_);
         }
     }
@@ -181,7 +172,7 @@ public:
 
         for (unsigned i = 0; i < elemCtx.numPrimaryDof(/*timeIdx=*/0); ++i) {
             unsigned I = elemCtx.globalSpaceIndex(i, /*timeIdx=*/0);
-            if (!fractureMapper.isFractureVertex(I))
+            if (!this->isOwnedDof_(I) || !fractureMapper.isFractureVertex(I))
                 continue;
 
             const auto& intQuants = elemCtx.intensiveQuantities(i, /*timeIdx=*/0);
@@ -228,7 +219,9 @@ public:
                 unsigned j = extQuants.exteriorIndex();
                 unsigned J = elemCtx.globalSpaceIndex(j, /*timeIdx=*/0);
 
-                if (!fractureMapper.isFractureEdge(I, J))
+                bool ownsI = this->isOwnedDof_(I);
+                bool ownsJ = this->isOwnedDof_(J);
+                if ((!ownsI && !ownsJ) || !fractureMapper.isFractureEdge(I, J))
                     continue;
 
                 for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++phaseIdx) {
@@ -241,13 +234,16 @@ public:
                     Dune::FieldVector<Scalar, dim> v(extQuants.fractureFilterVelocity(phaseIdx));
                     v *= weight;
 
-                    for (unsigned dimIdx = 0; dimIdx < dimWorld; ++dimIdx) {
-                        fractureVelocity_[phaseIdx][I][dimIdx] += v[dimIdx];
-                        fractureVelocity_[phaseIdx][J][dimIdx] += v[dimIdx];
+                    if (ownsI) {
+                        for (unsigned dimIdx = 0; dimIdx < dimWorld; ++dimIdx)
+                            fractureVelocity_[phaseIdx][I][dimIdx] += v[dimIdx];
+                        fractureVelocityWeight_[phaseIdx][I] += weight;
+                    }
+                    if (ownsJ) {
+                        for (unsigned dimIdx = 0; dimIdx < dimWorld; ++dimIdx)
+                            fractureVelocity_[phaseIdx][J][dimIdx] += v[dimIdx];
+                        fractureVelocityWeight_[phaseIdx][J] += weight;
                     }
-
-                    fractureVelocityWeight_[phaseIdx][I] += weight;
-                    fractureVelocityWeight_[phaseIdx][J] += weight;
                 }
             }
         }
@@ -258,10 +254,8 @@ public:
      */
     void commitBuffers(BaseOutputWriter& baseWriter)
     {
-        VtkMultiWriter *vtkWriter = dynamic_cast<VtkMultiWriter*>(&baseWriter);
-        if (!vtkWriter) {
+        if (!baseWriter.isVtkLike())
             return;
-        }
 
         if (saturationOutput_())
             this->commitPhaseBuffer_(baseWriter, "fractureSaturation_%s", fractureSaturation_);
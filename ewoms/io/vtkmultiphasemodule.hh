@@ -109,9 +109,6 @@ class VtkMultiPhaseModule : public BaseOutputModule<TypeTag>
     typedef typename GET_PROP_TYPE(TypeTag, FluidSystem) FluidSystem;
     typedef typename GET_PROP_TYPE(TypeTag, DiscBaseOutputModule) DiscBaseOutputModule;
 
-    static const int vtkFormat = GET_PROP_VALUE(TypeTag, VtkOutputFormat);
-    typedef Ewoms::VtkMultiWriter<GridView, vtkFormat> VtkMultiWriter;
-
     typedef Opm::MathToolbox<Evaluation> Toolbox;
 
     enum { dimWorld = GridView::dimensionworld };
@@ -181,26 +178,14 @@ public:
         if (intrinsicPermeabilityOutput_()) this->resizeTensorBuffer_(intrinsicPermeability_);
 
         if (velocityOutput_()) {
-            size_t nDof = this->simulator_.model().numGridDof();
-            for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++ phaseIdx) {
-                velocity_[phaseIdx].resize(nDof);
-                for (unsigned dofIdx = 0; dofIdx < nDof; ++ dofIdx) {
-                    velocity_[phaseIdx][dofIdx].resize(dimWorld);
-                    velocity_[phaseIdx][dofIdx] = 0.0;
-                }
-            }
+            for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++ phaseIdx)
+                this->resizeVectorBuffer_(velocity_[phaseIdx]);
             this->resizePhaseBuffer_(velocityWeight_);
         }
 
         if (potentialGradientOutput_()) {
-            size_t nDof = this->simulator_.model().numGridDof();
-            for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++ phaseIdx) {
-                potentialGradient_[phaseIdx].resize(nDof);
-                for (unsigned dofIdx = 0; dofIdx < nDof; ++ dofIdx) {
-                    potentialGradient_[phaseIdx][dofIdx].resize(dimWorld);
-                    potentialGradient_[phaseIdx][dofIdx] = 0.0;
-                }
-            }
+            for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++ phaseIdx)
+                this->resizeVectorBuffer_(potentialGradient_[phaseIdx]);
 
             this->resizePhaseBuffer_(potentialWeight_);
         }
@@ -220,6 +205,8 @@ public:
         const auto& problem = elemCtx.problem();
         for (unsigned i = 0; i < elemCtx.numPrimaryDof(/*timeIdx=*/0); ++i) {
             unsigned I = elemCtx.globalSpaceIndex(i, /*timeIdx=*/0);
+            if (!this->isOwnedDof_(I))
+                continue;
             const auto& intQuants = elemCtx.intensiveQuantities(i, /*timeIdx=*/0);
             const auto& fs = intQuants.fluidState();
 
@@ -258,6 +245,8 @@ public:
 
                 unsigned i = extQuants.interiorIndex();
                 unsigned I = elemCtx.globalSpaceIndex(i, /*timeIdx=*/0);
+                if (!this->isOwnedDof_(I))
+                    continue;
 
                 for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++phaseIdx) {
                     Scalar weight = extQuants.extrusionFactor();
@@ -284,6 +273,11 @@ public:
                 unsigned j = extQuants.exteriorIndex();
                 unsigned J = elemCtx.globalSpaceIndex(j, /*timeIdx=*/0);
 
+                bool ownsI = this->isOwnedDof_(I);
+                bool ownsJ = this->isOwnedDof_(J);
+                if (!ownsI && !ownsJ)
+                    continue;
+
                 for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++phaseIdx) {
                     Scalar weight = std::max<Scalar>(1e-16,
                                                      std::abs(Toolbox::value(extQuants.volumeFlux(phaseIdx))));
@@ -299,11 +293,14 @@ public:
                         weight /= v.two_norm();
                     v *= weight;
 
-                    velocity_[phaseIdx][I] += v;
-                    velocity_[phaseIdx][J] += v;
-
-                    velocityWeight_[phaseIdx][I] += weight;
-                    velocityWeight_[phaseIdx][J] += weight;
+                    if (ownsI) {
+                        velocity_[phaseIdx][I] += v;
+                        velocityWeight_[phaseIdx][I] += weight;
+                    }
+                    if (ownsJ) {
+                        velocity_[phaseIdx][J] += v;
+                        velocityWeight_[phaseIdx][J] += weight;
+                    }
                 } // end for all phases
             } // end for all faces
         }
@@ -314,8 +311,7 @@ public:
      */
     void commitBuffers(BaseOutputWriter& baseWriter)
     {
-        VtkMultiWriter *vtkWriter = dynamic_cast<VtkMultiWriter*>(&baseWriter);
-        if (!vtkWriter)
+        if (!baseWriter.isVtkLike())
             return;
 
         if (extrusionFactorOutput_())
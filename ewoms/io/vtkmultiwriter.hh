@@ -31,6 +31,7 @@
 #include "vtkscalarfunction.hh"
 #include "vtkvectorfunction.hh"
 #include "vtktensorfunction.hh"
+#include "vtkappendedwriter.hh"
 
 #include <ewoms/io/baseoutputwriter.hh>
 
@@ -46,10 +47,20 @@
 #endif
 
 #include <list>
+#include <vector>
+#include <deque>
 #include <string>
 #include <limits>
 #include <sstream>
 #include <fstream>
+#include <iostream>
+#include <memory>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <type_traits>
 
 namespace Ewoms {
 /*!
@@ -58,6 +69,16 @@ namespace Ewoms {
  * This class automatically keeps the meta file up to date and
  * simplifies writing datasets consisting of multiple files. (i.e.
  * multiple time steps or grid refinements within a time step.)
+ *
+ * Optionally, the files can be written asynchronously (cf. enableAsyncWrites()): In
+ * this case, the data of the attached buffers is copied and the VTK files are encoded
+ * and written by a background thread while the simulation proceeds.
+ *
+ * If the raw appended binary format is selected (i.e., Dune::VTK::appendedraw), the
+ * files are written by Ewoms::VtkAppendedWriter instead of the Dune VTK writer. This
+ * allows to compress the data (cf. setCompression()). In this case, the buffers are
+ * directly handed to the appended writer instead of being wrapped by VTK functions, so
+ * they are copied to the file without a virtual function call for each value.
  */
 template <class GridView, int vtkFormat>
 class VtkMultiWriter : public BaseOutputWriter
@@ -75,13 +96,37 @@ public:
     typedef BaseOutputWriter::VectorBuffer VectorBuffer;
     typedef BaseOutputWriter::TensorBuffer TensorBuffer;
 
-    typedef Dune::VTKWriter<GridView> VtkWriter;
+    // the raw appended format is written by our own writer because it supports
+    // compression
+    enum { useAppendedWriter = (vtkFormat == Dune::VTK::appendedraw) };
+
+    typedef typename std::conditional<useAppendedWriter,
+                                      Ewoms::VtkAppendedWriter<GridView>,
+                                      Dune::VTKWriter<GridView> >::type VtkWriter;
 #if DUNE_VERSION_NEWER(DUNE_GRID, 2, 5)
     typedef std::shared_ptr< Dune::VTKFunction< GridView > > FunctionPtr;
 #else
-    typedef typename VtkWriter::VTKFunctionPtr FunctionPtr;
+    typedef typename Dune::VTKWriter<GridView>::VTKFunctionPtr FunctionPtr;
 #endif
 
+    typedef typename Ewoms::VtkAppendedWriter<GridView>::Compression Compression;
+
+private:
+    // everything which is required to write a VTK file in the background
+    struct PendingWrite_
+    {
+        std::unique_ptr<VtkWriter> writer;
+        std::string outFileName;
+        double time;
+
+        // the snapshots of the data which is written
+        std::list<std::unique_ptr<ScalarBuffer> > scalarBuffers;
+        std::list<std::unique_ptr<VectorBuffer> > vectorBuffers;
+        std::list<std::unique_ptr<TensorBuffer> > tensorBuffers;
+    };
+
+public:
+
     VtkMultiWriter(const GridView& gridView,
                    const std::string& simName = "",
                    std::string multiFileName = "")
@@ -100,10 +145,18 @@ public:
 
         commRank_ = gridView.comm().rank();
         commSize_ = gridView.comm().size();
+
+        maxPendingWrites_ = 0;
+        workerShouldStop_ = false;
+
+        compression_ = Ewoms::VtkAppendedWriter<GridView>::NoCompression;
+
+        updateBufferIndexMaps_();
     }
 
     ~VtkMultiWriter()
     {
+        stopWorker_();
         finishMultiFile_();
 
         if (commRank_ == 0)
@@ -116,6 +169,85 @@ public:
     int curWriterNum() const
     { return curWriterNum_; }
 
+    /*!
+     * \brief Set the algorithm which is used to compress the data arrays.
+     *
+     * Compression is only supported by the raw appended binary format
+     * (Dune::VTK::appendedraw). For all other formats, the data is written
+     * uncompressed.
+     */
+    void setCompression(Compression compression)
+    {
+        Ewoms::VtkAppendedWriter<GridView>::checkCompressionSupported(compression);
+
+        if (!useAppendedWriter
+            && compression != Ewoms::VtkAppendedWriter<GridView>::NoCompression
+            && commRank_ == 0)
+            std::cout << "Compressed VTK output requires the raw appended binary format. "
+                      << "The VTK files are written uncompressed.\n" << std::flush;
+
+        compression_ = compression;
+    }
+
+    /*!
+     * \brief Only write a subset of the grid's elements.
+     *
+     * The flags are indexed by the element mapper and an empty vector selects the
+     * whole grid. Like compression, this is only supported by the raw appended binary
+     * format: the Dune VTK writer always writes the whole grid.
+     */
+    void setOutputRegion(const std::vector<bool>& isOutputElement)
+    { outputRegion_ = isOutputElement; }
+
+    /*!
+     * \brief Write the VTK files on a background thread.
+     *
+     * After this method has been called, endWrite() only hands a snapshot of the
+     * attached data to a background thread which then encodes and writes the files.
+     * If maxPendingWrites files are already waiting to be written, endWrite() blocks
+     * until the oldest of them is finished. Calling this method with
+     * maxPendingWrites equal to zero switches back to writing synchronously.
+     *
+     * In parallel runs, the Dune VTK writer communicates between the processes, so
+     * asynchronous writes are only possible if MPI supports calls from multiple
+     * threads (i.e., MPI_THREAD_MULTIPLE) or if the raw appended format is used.
+     * Otherwise, the files are still written synchronously.
+     */
+    void enableAsyncWrites(unsigned maxPendingWrites)
+    {
+        waitForPendingWrites();
+
+        if (maxPendingWrites > 0 && !asyncWritesSupported_()) {
+            if (commRank_ == 0)
+                std::cout << "Asynchronous VTK output requires MPI_THREAD_MULTIPLE. "
+                          << "The VTK files are written synchronously.\n" << std::flush;
+            maxPendingWrites = 0;
+        }
+
+        if (maxPendingWrites == 0)
+            stopWorker_();
+        else if (!workerThread_.joinable()) {
+            workerShouldStop_ = false;
+            workerThread_ = std::thread([this]() { this->workerLoop_(); });
+        }
+
+        maxPendingWrites_ = maxPendingWrites;
+    }
+
+    /*!
+     * \brief Block until all VTK files which are written in the background are
+     *        finished.
+     *
+     * If writing one of these files failed, the exception is re-thrown by this
+     * method.
+     */
+    void waitForPendingWrites()
+    {
+        std::unique_lock<std::mutex> lock(queueMutex_);
+        queueCondition_.wait(lock, [this]() { return pendingWrites_.empty(); });
+        rethrowWorkerException_();
+    }
+
     /*!
      * \brief Updates the internal data structures after mesh
      *        refinement.
@@ -125,23 +257,41 @@ public:
      */
     void gridChanged()
     {
+        // the files which are written in the background use the old mappers
+        waitForPendingWrites();
+
         elementMapper_.update();
         vertexMapper_.update();
+        updateBufferIndexMaps_();
     }
 
+    /*!
+     * \copydoc BaseOutputWriter::isVtkLike
+     */
+    bool isVtkLike() const
+    { return true; }
+
     /*!
      * \brief Called whenever a new time step must be written.
      */
     void beginWrite(double t)
     {
-        if (!multiFile_.is_open()) {
-            startMultiFile_(multiFileName_);
+        {
+            // the meta file may be concurrently written by the background thread
+            std::lock_guard<std::mutex> lock(queueMutex_);
+            if (!multiFile_.is_open())
+                startMultiFile_(multiFileName_);
         }
 
         curTime_ = t;
         curOutFileName_ = fileName_();
 
-        curWriter_ = new VtkWriter(gridView_, Dune::VTK::conforming);
+        curWriter_ = createWriter_(std::integral_constant<bool, useAppendedWriter>());
+        if (maxPendingWrites_ > 0) {
+            curPendingWrite_.reset(new PendingWrite_);
+            curPendingWrite_->outFileName = curOutFileName_;
+            curPendingWrite_->time = curTime_;
+        }
         ++curWriterNum_;
     }
 
@@ -195,12 +345,8 @@ public:
         sanitizeScalarBuffer_(buf);
 
         typedef Ewoms::VtkScalarFunction<GridView, VertexMapper> VtkFn;
-        FunctionPtr fnPtr(new VtkFn(name,
-                                    gridView_,
-                                    vertexMapper_,
-                                    buf,
-                                    /*codim=*/dim));
-        curWriter_->addVertexData(fnPtr);
+        attachBuffer_<VtkFn>(snapshot_(buf), name, vertexMapper_, /*codim=*/dim,
+                             std::integral_constant<bool, useAppendedWriter>());
     }
 
     /*!
@@ -223,12 +369,8 @@ public:
         sanitizeScalarBuffer_(buf);
 
         typedef Ewoms::VtkScalarFunction<GridView, ElementMapper> VtkFn;
-        FunctionPtr fnPtr(new VtkFn(name,
-                                    gridView_,
-                                    elementMapper_,
-                                    buf,
-                                    /*codim=*/0));
-        curWriter_->addCellData(fnPtr);
+        attachBuffer_<VtkFn>(snapshot_(buf), name, elementMapper_, /*codim=*/0,
+                             std::integral_constant<bool, useAppendedWriter>());
     }
 
     /*!
@@ -252,12 +394,8 @@ public:
         sanitizeVectorBuffer_(buf);
 
         typedef Ewoms::VtkVectorFunction<GridView, VertexMapper> VtkFn;
-        FunctionPtr fnPtr(new VtkFn(name,
-                                    gridView_,
-                                    vertexMapper_,
-                                    buf,
-                                    /*codim=*/dim));
-        curWriter_->addVertexData(fnPtr);
+        attachBuffer_<VtkFn>(snapshot_(buf), name, vertexMapper_, /*codim=*/dim,
+                             std::integral_constant<bool, useAppendedWriter>());
     }
 
     /*!
@@ -267,17 +405,13 @@ public:
     {
         typedef Ewoms::VtkTensorFunction<GridView, VertexMapper> VtkFn;
 
-        for (unsigned colIdx = 0; colIdx < buf[0].N(); ++colIdx) {
+        const TensorBuffer& data = snapshot_(buf);
+        for (unsigned colIdx = 0; colIdx < data[0].N(); ++colIdx) {
             std::ostringstream oss;
             oss << name <<  "[" << colIdx << "]";
 
-            FunctionPtr fnPtr(new VtkFn(oss.str(),
-                                        gridView_,
-                                        vertexMapper_,
-                                        buf,
-                                        /*codim=*/dim,
-                                        colIdx));
-            curWriter_->addVertexData(fnPtr);
+            attachTensorColumn_<VtkFn>(data, oss.str(), vertexMapper_, /*codim=*/dim, colIdx,
+                                       std::integral_constant<bool, useAppendedWriter>());
         }
     }
 
@@ -301,12 +435,8 @@ public:
         sanitizeVectorBuffer_(buf);
 
         typedef Ewoms::VtkVectorFunction<GridView, ElementMapper> VtkFn;
-        FunctionPtr fnPtr(new VtkFn(name,
-                                    gridView_,
-                                    elementMapper_,
-                                    buf,
-                                    /*codim=*/0));
-        curWriter_->addCellData(fnPtr);
+        attachBuffer_<VtkFn>(snapshot_(buf), name, elementMapper_, /*codim=*/0,
+                             std::integral_constant<bool, useAppendedWriter>());
     }
 
     /*!
@@ -316,17 +446,13 @@ public:
     {
         typedef Ewoms::VtkTensorFunction<GridView, ElementMapper> VtkFn;
 
-        for (unsigned colIdx = 0; colIdx < buf[0].N(); ++colIdx) {
+        const TensorBuffer& data = snapshot_(buf);
+        for (unsigned colIdx = 0; colIdx < data[0].N(); ++colIdx) {
             std::ostringstream oss;
             oss << name <<  "[" << colIdx << "]";
 
-            FunctionPtr fnPtr(new VtkFn(oss.str(),
-                                        gridView_,
-                                        elementMapper_,
-                                        buf,
-                                        /*codim=*/0,
-                                        colIdx));
-            curWriter_->addCellData(fnPtr);
+            attachTensorColumn_<VtkFn>(data, oss.str(), elementMapper_, /*codim=*/0, colIdx,
+                                       std::integral_constant<bool, useAppendedWriter>());
         }
     }
 
@@ -339,6 +465,11 @@ public:
      */
     void endWrite(bool onlyDiscard = false)
     {
+        if (curPendingWrite_) {
+            endAsyncWrite_(onlyDiscard);
+            return;
+        }
+
         if (!onlyDiscard) {
             std::string fileName;
             // write the actual data as vtu or vtp (plus the pieces file in the parallel case)
@@ -377,6 +508,9 @@ public:
     template <class Restarter>
     void serialize(Restarter& res)
     {
+        // the meta file must be complete before it can be stored
+        waitForPendingWrites();
+
         res.serializeSectionBegin("VTKMultiWriter");
         res.serializeStream() << curWriterNum_ << "\n";
 
@@ -411,6 +545,8 @@ public:
     template <class Restarter>
     void deserialize(Restarter& res)
     {
+        waitForPendingWrites();
+
         res.deserializeSectionBegin("VTKMultiWriter");
         res.deserializeStream() >> curWriterNum_;
 
@@ -445,6 +581,281 @@ public:
     }
 
 private:
+    VtkWriter* createWriter_(std::true_type)
+    {
+        VtkWriter* writer = new VtkWriter(gridView_, compression_);
+        writer->setElementFilter(outputRegion_, elementMapper_);
+        writer->setBufferIndexMaps(vertexBufferIdx_, elementBufferIdx_);
+        return writer;
+    }
+
+    VtkWriter* createWriter_(std::false_type)
+    { return new VtkWriter(gridView_, Dune::VTK::conforming); }
+
+    // the appended writer copies the buffers directly to the data arrays ...
+    template <class VtkFn, class Buffer, class Mapper>
+    void attachBuffer_(const Buffer& buf,
+                       const std::string& name,
+                       const Mapper& mapper OPM_UNUSED,
+                       unsigned codim,
+                       std::true_type)
+    {
+        if (codim == 0)
+            curWriter_->addCellBuffer(buf, name);
+        else
+            curWriter_->addVertexBuffer(buf, name);
+    }
+
+    // ... while the Dune VTK writer evaluates a VTK function for each value
+    template <class VtkFn, class Buffer, class Mapper>
+    void attachBuffer_(const Buffer& buf,
+                       const std::string& name,
+                       const Mapper& mapper,
+                       unsigned codim,
+                       std::false_type)
+    {
+        FunctionPtr fnPtr(new VtkFn(name, gridView_, mapper, buf, codim));
+        if (codim == 0)
+            curWriter_->addCellData(fnPtr);
+        else
+            curWriter_->addVertexData(fnPtr);
+    }
+
+    template <class VtkFn, class Mapper>
+    void attachTensorColumn_(const TensorBuffer& buf,
+                             const std::string& name,
+                             const Mapper& mapper OPM_UNUSED,
+                             unsigned codim,
+                             unsigned colIdx,
+                             std::true_type)
+    {
+        if (codim == 0)
+            curWriter_->addCellBuffer(buf, name, colIdx);
+        else
+            curWriter_->addVertexBuffer(buf, name, colIdx);
+    }
+
+    template <class VtkFn, class Mapper>
+    void attachTensorColumn_(const TensorBuffer& buf,
+                             const std::string& name,
+                             const Mapper& mapper,
+                             unsigned codim,
+                             unsigned colIdx,
+                             std::false_type)
+    {
+        FunctionPtr fnPtr(new VtkFn(name, gridView_, mapper, buf, codim, colIdx));
+        if (codim == 0)
+            curWriter_->addCellData(fnPtr);
+        else
+            curWriter_->addVertexData(fnPtr);
+    }
+
+    // determine the indices of the buffer entries of all vertices and elements of the
+    // index set. they are only required by the appended writer.
+    void updateBufferIndexMaps_()
+    {
+        vertexBufferIdx_.clear();
+        elementBufferIdx_.clear();
+        if (!useAppendedWriter)
+            return;
+
+        const auto& indexSet = gridView_.indexSet();
+        vertexBufferIdx_.resize(indexSet.size(dim));
+        elementBufferIdx_.resize(indexSet.size(/*codim=*/0));
+
+        auto elemIt = gridView_.template begin<0>();
+        const auto& elemEndIt = gridView_.template end<0>();
+        for (; elemIt != elemEndIt; ++elemIt) {
+            const auto& elem = *elemIt;
+#if DUNE_VERSION_NEWER(DUNE_COMMON, 2, 4)
+            elementBufferIdx_[static_cast<size_t>(indexSet.index(elem))] =
+                static_cast<unsigned>(elementMapper_.index(elem));
+            int numCorners = static_cast<int>(elem.subEntities(dim));
+#else
+            elementBufferIdx_[static_cast<size_t>(indexSet.index(elem))] =
+                static_cast<unsigned>(elementMapper_.map(elem));
+            int numCorners = elem.template count<dim>();
+#endif
+            for (int cornerIdx = 0; cornerIdx < numCorners; ++cornerIdx) {
+                size_t vertexIdx = static_cast<size_t>(indexSet.subIndex(elem, cornerIdx, dim));
+#if DUNE_VERSION_NEWER(DUNE_COMMON, 2, 4)
+                vertexBufferIdx_[vertexIdx] =
+                    static_cast<unsigned>(vertexMapper_.subIndex(elem, cornerIdx, dim));
+#else
+                vertexBufferIdx_[vertexIdx] =
+                    static_cast<unsigned>(vertexMapper_.map(elem, cornerIdx, dim));
+#endif
+            }
+        }
+    }
+
+    bool asyncWritesSupported_() const
+    {
+        // in contrast to the Dune writer, the appended writer does not communicate
+        if (useAppendedWriter)
+            return true;
+
+#if HAVE_MPI
+        if (commSize_ > 1) {
+            int provided;
+            MPI_Query_thread(&provided);
+            return provided == MPI_THREAD_MULTIPLE;
+        }
+#endif
+        return true;
+    }
+
+    // returns the buffer which is used for writing: In the synchronous case this is
+    // the buffer itself, else it is a copy which is owned by the pending write.
+    // managed buffers are not copied because nobody touches them after they have
+    // been attached.
+    template <class Buffer>
+    const Buffer& snapshot_(Buffer& buf)
+    {
+        if (!curPendingWrite_)
+            return buf;
+
+        std::unique_ptr<Buffer> managedBuf = releaseManagedBuffer_(buf);
+        if (!managedBuf)
+            managedBuf.reset(new Buffer(buf));
+
+        const Buffer& result = *managedBuf;
+        pendingBuffers_(*curPendingWrite_, managedBuf).push_back(std::move(managedBuf));
+        return result;
+    }
+
+    std::list<std::unique_ptr<ScalarBuffer> >&
+    pendingBuffers_(PendingWrite_& pw, const std::unique_ptr<ScalarBuffer>&)
+    { return pw.scalarBuffers; }
+    std::list<std::unique_ptr<VectorBuffer> >&
+    pendingBuffers_(PendingWrite_& pw, const std::unique_ptr<VectorBuffer>&)
+    { return pw.vectorBuffers; }
+    std::list<std::unique_ptr<TensorBuffer> >&
+    pendingBuffers_(PendingWrite_& pw, const std::unique_ptr<TensorBuffer>&)
+    { return pw.tensorBuffers; }
+
+    // if a buffer is managed by the writer, take its ownership
+    template <class Buffer>
+    std::unique_ptr<Buffer> releaseManagedBuffer_(Buffer& buf)
+    { return releaseFromList_(managedBuffers_(&buf), &buf); }
+
+    std::list<ScalarBuffer*>& managedBuffers_(ScalarBuffer*)
+    { return managedScalarBuffers_; }
+    std::list<VectorBuffer*>& managedBuffers_(VectorBuffer*)
+    { return managedVectorBuffers_; }
+    std::list<TensorBuffer*>& managedBuffers_(TensorBuffer*)
+    { return noManagedTensorBuffers_; }
+
+    template <class Buffer>
+    static std::unique_ptr<Buffer> releaseFromList_(std::list<Buffer*>& list, Buffer* buf)
+    {
+        auto it = std::find(list.begin(), list.end(), buf);
+        if (it == list.end())
+            return std::unique_ptr<Buffer>();
+
+        list.erase(it);
+        return std::unique_ptr<Buffer>(buf);
+    }
+
+    // hand the current pending write over to the background thread
+    void endAsyncWrite_(bool onlyDiscard)
+    {
+        std::unique_ptr<PendingWrite_> pw(std::move(curPendingWrite_));
+        pw->writer.reset(curWriter_);
+        curWriter_ = 0;
+
+        // the buffers which are managed by the writer but have not been attached
+        // are not needed anymore
+        while (!managedScalarBuffers_.empty()) {
+            delete managedScalarBuffers_.front();
+            managedScalarBuffers_.pop_front();
+        }
+        while (!managedVectorBuffers_.empty()) {
+            delete managedVectorBuffers_.front();
+            managedVectorBuffers_.pop_front();
+        }
+
+        if (onlyDiscard) {
+            --curWriterNum_;
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock(queueMutex_);
+        queueCondition_.wait(lock,
+                             [this]()
+                             { return pendingWrites_.size() < maxPendingWrites_; });
+        rethrowWorkerException_();
+
+        pendingWrites_.push_back(std::move(pw));
+        queueCondition_.notify_all();
+    }
+
+    // the main function of the background thread
+    void workerLoop_()
+    {
+        while (true) {
+            PendingWrite_* pw;
+            {
+                std::unique_lock<std::mutex> lock(queueMutex_);
+                queueCondition_.wait(lock,
+                                     [this]()
+                                     { return workerShouldStop_ || !pendingWrites_.empty(); });
+                if (pendingWrites_.empty())
+                    return; // workerShouldStop_ is set and there is nothing left to do
+
+                // the pending write stays in the queue until it is finished, so that it
+                // is taken into account for the maximum number of pending writes
+                pw = pendingWrites_.front().get();
+            }
+
+            std::string fileName;
+            std::exception_ptr exception;
+            try {
+                fileName = pw->writer->write(/*name=*/pw->outFileName.c_str(),
+                                             static_cast<Dune::VTK::OutputType>(vtkFormat));
+            }
+            catch (...) {
+                exception = std::current_exception();
+            }
+
+            std::unique_lock<std::mutex> lock(queueMutex_);
+            if (exception)
+                workerException_ = exception;
+            else if (commRank_ == 0) {
+                multiFile_.precision(16);
+                multiFile_ << "   <DataSet timestep=\"" << pw->time << "\" file=\""
+                           << fileName << "\"/>\n";
+                finishMultiFile_();
+            }
+            pendingWrites_.pop_front();
+            queueCondition_.notify_all();
+        }
+    }
+
+    void stopWorker_()
+    {
+        if (!workerThread_.joinable())
+            return;
+
+        {
+            std::unique_lock<std::mutex> lock(queueMutex_);
+            workerShouldStop_ = true;
+            queueCondition_.notify_all();
+        }
+        workerThread_.join();
+    }
+
+    // this requires the queue mutex to be locked
+    void rethrowWorkerException_()
+    {
+        if (!workerException_)
+            return;
+
+        std::exception_ptr e = workerException_;
+        workerException_ = std::exception_ptr();
+        std::rethrow_exception(e);
+    }
+
     std::string fileName_()
     {
         // use a new file name for each time step
@@ -489,18 +900,22 @@ private:
     // and make sure that all values can be displayed by paraview
     void sanitizeScalarBuffer_(ScalarBuffer& b OPM_UNUSED)
     {
-        // nothing to do: this is done by VtkScalarFunction
+        // nothing to do: this is done by VtkScalarFunction or the appended writer
     }
 
     void sanitizeVectorBuffer_(VectorBuffer& b OPM_UNUSED)
     {
-        // nothing to do: this is done by VtkVectorFunction
+        // nothing to do: this is done by VtkVectorFunction or the appended writer
     }
 
     const GridView gridView_;
     ElementMapper elementMapper_;
     VertexMapper vertexMapper_;
 
+    // the buffer indices of the entities of the index set for the appended writer
+    std::vector<unsigned> vertexBufferIdx_;
+    std::vector<unsigned> elementBufferIdx_;
+
     std::string simName_;
     std::ofstream multiFile_;
     std::string multiFileName_;
@@ -509,12 +924,25 @@ private:
     int commRank_; // rank of the current process in the communicator
 
     VtkWriter *curWriter_;
+    Compression compression_;
+    std::vector<bool> outputRegion_;
     double curTime_;
     std::string curOutFileName_;
     int curWriterNum_;
 
     std::list<ScalarBuffer *> managedScalarBuffers_;
     std::list<VectorBuffer *> managedVectorBuffers_;
+    std::list<TensorBuffer *> noManagedTensorBuffers_; // there are no managed tensors
+
+    // state of the asynchronous writes
+    unsigned maxPendingWrites_;
+    std::unique_ptr<PendingWrite_> curPendingWrite_;
+    std::deque<std::unique_ptr<PendingWrite_> > pendingWrites_;
+    std::exception_ptr workerException_;
+    std::thread workerThread_;
+    std::mutex queueMutex_;
+    std::condition_variable queueCondition_;
+    bool workerShouldStop_;
 };
 } // namespace Ewoms
 
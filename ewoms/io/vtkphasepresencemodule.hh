@@ -61,14 +61,9 @@ class VtkPhasePresenceModule : public BaseOutputModule<TypeTag>
     typedef typename GET_PROP_TYPE(TypeTag, Simulator) Simulator;
     typedef typename GET_PROP_TYPE(TypeTag, Scalar) Scalar;
     typedef typename GET_PROP_TYPE(TypeTag, ElementContext) ElementContext;
-    typedef typename GET_PROP_TYPE(TypeTag, GridView) GridView;
-
-    static const int vtkFormat = GET_PROP_VALUE(TypeTag, VtkOutputFormat);
-    typedef Ewoms::VtkMultiWriter<GridView, vtkFormat> VtkMultiWriter;
 
     typedef typename ParentType::ScalarBuffer ScalarBuffer;
 
-
 public:
     VtkPhasePresenceModule(const Simulator& simulator)
         : ParentType(simulator)
@@ -106,6 +101,8 @@ public:
             // calculate the phase presence
             int phasePresence = elemCtx.primaryVars(i, /*timeIdx=*/0).phasePresence();
             unsigned I = elemCtx.globalSpaceIndex(i, /*timeIdx=*/0);
+            if (!this->isOwnedDof_(I))
+                continue;
 
             if (phasePresenceOutput_())
                 phasePresence_[I] = phasePresence;
@@ -117,10 +114,8 @@ public:
      */
     void commitBuffers(BaseOutputWriter& baseWriter)
     {
-        VtkMultiWriter *vtkWriter = dynamic_cast<VtkMultiWriter*>(&baseWriter);
-        if (!vtkWriter) {
+        if (!baseWriter.isVtkLike())
             return;
-        }
 
         if (phasePresenceOutput_())
             this->commitScalarBuffer_(baseWriter, "phase presence", phasePresence_);
@@ -31,6 +31,7 @@
 #include "residreductioncriterion.hh"
 #include "linearsolverreport.hh"
 
+#include <ewoms/common/profiler.hh>
 #include <ewoms/common/timer.hh>
 #include <ewoms/common/timerguard.hh>
 
@@ -49,8 +50,15 @@ namespace Linear {
  *
  * See https://en.wikipedia.org/wiki/Biconjugate_gradient_stabilized_method, (article
  * date: December 19, 2016)
+ *
+ * Optionally, the pipelined variant of the method can be used (cf. setPipelined()). It
+ * needs a few more vectors, but it only exhibits two global reductions per
+ * iteration. These reductions are non-blocking and each of them is overlapped with an
+ * application of the preconditioner and the linear operator. The scalar product thus
+ * must provide the localDots(), beginSum() and endSum() methods of the
+ * OverlappingScalarProduct.
  */
-template <class LinearOperator, class Vector, class Preconditioner>
+template <class LinearOperator, class Vector, class Preconditioner, class ScalarProduct>
 class BiCGStabSolver
 {
     typedef Ewoms::Linear::ConvergenceCriterion<Vector> ConvergenceCriterion;
@@ -59,7 +67,7 @@ class BiCGStabSolver
 public:
     BiCGStabSolver(Preconditioner& preconditioner,
                    ConvergenceCriterion& convergenceCriterion,
-                   Dune::ScalarProduct<Vector>& scalarProduct)
+                   ScalarProduct& scalarProduct)
         : preconditioner_(preconditioner)
         , convergenceCriterion_(convergenceCriterion)
         , scalarProduct_(scalarProduct)
@@ -68,6 +76,7 @@ public:
         b_ = nullptr;
 
         maxIterations_ = 1000;
+        pipelined_ = false;
     }
 
     /*!
@@ -103,6 +112,24 @@ public:
     unsigned verbosity() const
     { return verbosity_; }
 
+    /*!
+     * \brief Specify whether the pipelined variant of the stabilized BiCG method
+     *        should be used.
+     *
+     * In exact arithmetic, this does not change the iterates, but the pipelined method
+     * needs less global communication and thus scales better on large numbers of
+     * processes.
+     */
+    void setPipelined(bool yesno)
+    { pipelined_ = yesno; }
+
+    /*!
+     * \brief Returns true if the pipelined variant of the stabilized BiCG method is
+     *        used.
+     */
+    bool pipelined() const
+    { return pipelined_; }
+
     /*!
      * \brief Set the matrix "A" of the linear system.
      */
@@ -120,6 +147,11 @@ public:
      */
     bool apply(Vector& x)
     {
+        EWOMS_PROFILE_REGION("BiCGStabSolver::apply");
+
+        if (pipelined_)
+            return applyPipelined_(x);
+
         // epsilon used for detecting breakdowns
         const Scalar breakdownEps = std::numeric_limits<Scalar>::min() * Scalar(1e10);
 
@@ -345,16 +377,247 @@ public:
     { return report_; }
 
 private:
+    // the preconditioned pipelined stabilized biconjugate gradient method. this is
+    // the stabilized BiCG method applied to the right-preconditioned system
+    // A*K^-1*u = b, with x = K^-1*u. the vectors marked by the 'Hat' suffix are the
+    // ones to which the preconditioner has been applied.
+    //
+    // See S. Cools, W. Vanroose: "The communication-hiding pipelined BiCGStab method
+    // for the parallel solution of large unsymmetric linear systems", Parallel
+    // Computing 65, pp. 1-20, 2017
+    bool applyPipelined_(Vector& x)
+    {
+        // epsilon used for detecting breakdowns
+        const Scalar breakdownEps = std::numeric_limits<Scalar>::min() * Scalar(1e10);
+
+        report_.reset();
+        Ewoms::TimerGuard reportTimerGuard(report_.timer());
+        report_.timer().start();
+
+        // set the initial solution to the zero vector and prepare the preconditioner
+        x = 0.0;
+        Vector r = *b_;
+        preconditioner_.pre(x, r);
+
+        convergenceCriterion_.setInitial(x, r);
+        if (convergenceCriterion_.converged()) {
+            report_.setConverged(true);
+            return report_.converged();
+        }
+
+        if (verbosity_ > 0) {
+            std::cout << "-------- PipelinedBiCGStabSolver --------" << std::endl;
+            convergenceCriterion_.printInitial();
+        }
+
+        // r0hat = r0 = b
+        const Vector& r0hat = *b_;
+
+        // rHat_0 = K^-1*r_0, w_0 = A*rHat_0, wHat_0 = K^-1*w_0, t_0 = A*wHat_0
+        Vector rHat(x);
+        preconditioner_.apply(rHat, r);
+        Vector w(x);
+        A_->apply(rHat, w);
+        Vector wHat(x);
+        preconditioner_.apply(wHat, w);
+        Vector t(x);
+        A_->apply(wHat, t);
+
+        // the scalar products which are summed up by the same global reduction. those
+        // which share a vector are computed by a single pass over the vectors.
+        Scalar dots[4];
+        const Vector* dotVectors[4];
+
+        // alpha_0 = (r0hat, r_0)/(r0hat, w_0)
+        dotVectors[0] = &r;
+        dotVectors[1] = &w;
+        scalarProduct_.localDots(r0hat, dotVectors, dots, 2);
+        scalarProduct_.beginSum(dots, 2);
+        scalarProduct_.endSum();
+        if (std::abs(dots[1]) <= breakdownEps)
+            OPM_THROW(Opm::NumericalProblem,
+                      "Breakdown of the pipelined BiCGStab solver (division by zero)");
+        Scalar rho = dots[0];
+        Scalar alpha = rho/dots[1];
+        Scalar beta = 0.0;
+        Scalar omega = 0.0;
+
+        // the remaining vectors. since beta is zero for the first iteration, the
+        // previous values of p, s and z do not matter.
+        Vector p(x);
+        Vector pHat(x);
+        Vector s(x);
+        Vector sHat(x);
+        Vector z(x);
+        Vector zHat(x);
+        Vector q(x);
+        Vector qHat(x);
+        Vector y(x);
+        Vector v(x);
+        Vector delta(x);
+        unsigned n = x.size();
+
+        for (; report_.iterations() < maxIterations_; report_.increment()) {
+            // this loop conflates the following operations:
+            //
+            // p_i = r_i + beta*(p_(i-1) - omega*s_(i-1))
+            // pHat_i = rHat_i + beta*(pHat_(i-1) - omega*sHat_(i-1))
+            // s_i = w_i + beta*(s_(i-1) - omega*z_(i-1))
+            // sHat_i = wHat_i + beta*(sHat_(i-1) - omega*zHat_(i-1))
+            // z_i = t_i + beta*(z_(i-1) - omega*v_(i-1))
+            // q_i = r_i - alpha*s_i
+            // qHat_i = rHat_i - alpha*sHat_i
+            // y_i = w_i - alpha*z_i
+            for (unsigned i = 0; i < n; ++i) {
+                p[i].axpy(-omega, s[i]);
+                p[i] *= beta;
+                p[i] += r[i];
+
+                pHat[i].axpy(-omega, sHat[i]);
+                pHat[i] *= beta;
+                pHat[i] += rHat[i];
+
+                s[i].axpy(-omega, z[i]);
+                s[i] *= beta;
+                s[i] += w[i];
+
+                sHat[i].axpy(-omega, zHat[i]);
+                sHat[i] *= beta;
+                sHat[i] += wHat[i];
+
+                z[i].axpy(-omega, v[i]);
+                z[i] *= beta;
+                z[i] += t[i];
+
+                q[i] = r[i];
+                q[i].axpy(-alpha, s[i]);
+
+                qHat[i] = rHat[i];
+                qHat[i].axpy(-alpha, sHat[i]);
+
+                y[i] = w[i];
+                y[i].axpy(-alpha, z[i]);
+            }
+
+            // start the reduction for omega_i = (q_i, y_i)/(y_i, y_i) and hide its
+            // latency behind zHat_i = K^-1*z_i and v_i = A*zHat_i
+            dotVectors[0] = &q;
+            dotVectors[1] = &y;
+            scalarProduct_.localDots(y, dotVectors, dots, 2);
+            scalarProduct_.beginSum(dots, 2);
+
+            zHat = 0.0;
+            preconditioner_.apply(zHat, z);
+            A_->apply(zHat, v);
+
+            scalarProduct_.endSum();
+            if (std::abs(dots[1]) <= breakdownEps)
+                OPM_THROW(Opm::NumericalProblem,
+                          "Breakdown of the pipelined BiCGStab solver (division by zero)");
+            omega = dots[0]/dots[1];
+            if (std::abs(omega) <= breakdownEps)
+                OPM_THROW(Opm::NumericalProblem,
+                          "Breakdown of the pipelined BiCGStab solver (stagnation detected)");
+
+            // this loop conflates the following operations:
+            //
+            // delta = alpha*pHat_i + omega*qHat_i
+            // x_(i+1) = x_i + delta
+            // r_(i+1) = q_i - omega*y_i
+            // rHat_(i+1) = qHat_i - omega*(wHat_i - alpha*zHat_i)
+            // w_(i+1) = y_i - omega*(t_i - alpha*v_i)
+            for (unsigned i = 0; i < n; ++i) {
+                delta[i] = pHat[i];
+                delta[i] *= alpha;
+                delta[i].axpy(omega, qHat[i]);
+                x[i] += delta[i];
+
+                r[i] = q[i];
+                r[i].axpy(-omega, y[i]);
+
+                rHat[i] = qHat[i];
+                rHat[i].axpy(-omega, wHat[i]);
+                rHat[i].axpy(alpha*omega, zHat[i]);
+
+                w[i] = y[i];
+                w[i].axpy(-omega, t[i]);
+                w[i].axpy(alpha*omega, v[i]);
+            }
+
+            // start the reduction for beta_i and alpha_(i+1). its latency is hidden behind
+            // the convergence check as well as wHat_(i+1) = K^-1*w_(i+1) and t_(i+1) =
+            // A*wHat_(i+1)
+            dotVectors[0] = &r;
+            dotVectors[1] = &w;
+            dotVectors[2] = &s;
+            dotVectors[3] = &z;
+            scalarProduct_.localDots(r0hat, dotVectors, dots, 4);
+            scalarProduct_.beginSum(dots, 4);
+
+            // do convergence check and print terminal output
+            convergenceCriterion_.update(/*curSol=*/x, /*delta=*/delta, r);
+            if (convergenceCriterion_.converged()) {
+                scalarProduct_.endSum();
+                if (verbosity_ > 0) {
+                    convergenceCriterion_.print(1.0 + report_.iterations());
+                    std::cout << "-------- /PipelinedBiCGStabSolver --------" << std::endl;
+                }
+
+                preconditioner_.post(x);
+                report_.setConverged(true);
+                return report_.converged();
+            }
+            else if (convergenceCriterion_.failed()) {
+                scalarProduct_.endSum();
+                if (verbosity_ > 0) {
+                    convergenceCriterion_.print(1.0 + report_.iterations());
+                    std::cout << "-------- /PipelinedBiCGStabSolver --------" << std::endl;
+                }
+
+                report_.setConverged(false);
+                return report_.converged();
+            }
+
+            if (verbosity_ > 1)
+                convergenceCriterion_.print(1.0 + report_.iterations());
+
+            wHat = 0.0;
+            preconditioner_.apply(wHat, w);
+            A_->apply(wHat, t);
+
+            scalarProduct_.endSum();
+
+            // beta_i = (alpha_i/omega_i)*(r0hat, r_(i+1))/(r0hat, r_i)
+            if (std::abs(rho) <= breakdownEps)
+                OPM_THROW(Opm::NumericalProblem,
+                          "Breakdown of the pipelined BiCGStab solver (division by zero)");
+            beta = (alpha/omega)*(dots[0]/rho);
+            rho = dots[0];
+
+            // alpha_(i+1) = (r0hat, r_(i+1))/(r0hat, s_(i+1)), where (r0hat, s_(i+1)) is
+            // expressed by the scalar products of the vectors of the current iteration
+            Scalar denom = dots[1] + beta*dots[2] - beta*omega*dots[3];
+            if (std::abs(denom) <= breakdownEps)
+                OPM_THROW(Opm::NumericalProblem,
+                          "Breakdown of the pipelined BiCGStab solver (division by zero)");
+            alpha = rho/denom;
+        }
+
+        report_.setConverged(false);
+        return report_.converged();
+    }
+
     const LinearOperator* A_;
     const Vector* b_;
 
     Preconditioner& preconditioner_;
     ConvergenceCriterion& convergenceCriterion_;
-    Dune::ScalarProduct<Vector>& scalarProduct_;
+    ScalarProduct& scalarProduct_;
     Ewoms::Linear::SolverReport report_;
 
     unsigned maxIterations_;
     unsigned verbosity_;
+    bool pipelined_;
 };
 
 } // namespace Linear
@@ -37,6 +37,8 @@
 #endif // HAVE_MPI
 
 #include <algorithm>
+#include <utility>
+#include <vector>
 
 namespace Ewoms {
 namespace Linear {
@@ -54,21 +56,41 @@ public:
     typedef std::vector<PeerBlackListedEntry> PeerBlackList;
     typedef std::map<ProcessRank, PeerBlackList> PeerBlackLists;
 
+private:
+    typedef std::pair<Index, Index> NativeToDomesticEntry;
+
+public:
+
     BlackList()
     { }
 
     BlackList(const BlackList&) = default;
 
     bool hasIndex(Index nativeIdx) const
-    { return nativeBlackListedIndices_.count(nativeIdx) > 0; }
+    {
+        return std::binary_search(nativeBlackListedIndices_.begin(),
+                                  nativeBlackListedIndices_.end(),
+                                  nativeIdx);
+    }
 
     void addIndex(Index nativeIdx)
-    { nativeBlackListedIndices_.insert(nativeIdx); }
+    {
+        // the indices are usually added in ascending order, i.e., they are appended
+        auto it = std::lower_bound(nativeBlackListedIndices_.begin(),
+                                   nativeBlackListedIndices_.end(),
+                                   nativeIdx);
+        if (it == nativeBlackListedIndices_.end() || *it != nativeIdx)
+            nativeBlackListedIndices_.insert(it, nativeIdx);
+    }
 
     Index nativeToDomestic(Index nativeIdx) const
     {
-        auto it = nativeToDomesticMap_.find(nativeIdx);
-        if (it == nativeToDomesticMap_.end())
+        auto it = std::lower_bound(nativeToDomesticMap_.begin(),
+                                   nativeToDomesticMap_.end(),
+                                   nativeIdx,
+                                   [](const NativeToDomesticEntry& entry, Index idx)
+                                   { return entry.first < idx; });
+        if (it == nativeToDomesticMap_.end() || it->first != nativeIdx)
             return -1;
         return it->second;
     }
@@ -92,6 +114,7 @@ public:
         for (; peerListIt != peerListEndIt; ++peerListIt) {
             receiveGlobalIndices_(peerListIt->first, domesticOverlap);
         }
+        sortNativeToDomesticMap_();
 
         peerListIt = peerBlackLists_.begin();
         for (; peerListIt != peerListEndIt; ++peerListIt) {
@@ -133,6 +156,9 @@ private:
         auto& numIdxBuff = numGlobalIdxSendBuff_[peerRank];
         auto& idxBuff = globalIdxSendBuff_[peerRank];
 
+        numIdxBuff.setCommunicator(domesticOverlap.communicator());
+        idxBuff.setCommunicator(domesticOverlap.communicator());
+
         numIdxBuff.resize(1);
         numIdxBuff[0] = static_cast<unsigned>(peerIndices.size());
         numIdxBuff.send(peerRank);
@@ -154,26 +180,48 @@ private:
     void receiveGlobalIndices_(ProcessRank peerRank,
                                const DomesticOverlap& domesticOverlap)
     {
-        MpiBuffer<unsigned> numGlobalIdxBuf(1);
+        MpiBuffer<unsigned> numGlobalIdxBuf(1, domesticOverlap.communicator());
         numGlobalIdxBuf.receive(peerRank);
         unsigned numIndices = numGlobalIdxBuf[0];
 
-        MpiBuffer<Index> globalIdxBuf(2*numIndices);
+        MpiBuffer<GlobalIndex> globalIdxBuf(2*numIndices, domesticOverlap.communicator());
         globalIdxBuf.receive(peerRank);
         for (unsigned i = 0; i < numIndices; ++i) {
-            Index globalIdx = globalIdxBuf[2*i + 0];
-            Index nativeIdx = globalIdxBuf[2*i + 1];
+            GlobalIndex globalIdx = globalIdxBuf[2*i + 0];
+            Index nativeIdx = static_cast<Index>(globalIdxBuf[2*i + 1]);
+
+            nativeToDomesticMap_.push_back(
+                NativeToDomesticEntry(nativeIdx, domesticOverlap.globalToDomestic(globalIdx)));
+        }
+    }
 
-            nativeToDomesticMap_[nativeIdx] = domesticOverlap.globalToDomestic(globalIdx);
+    // sort the native->domestic map by the native indices. if a native index has been
+    // received multiple times, the last entry wins.
+    void sortNativeToDomesticMap_()
+    {
+        std::stable_sort(nativeToDomesticMap_.begin(),
+                         nativeToDomesticMap_.end(),
+                         [](const NativeToDomesticEntry& a, const NativeToDomesticEntry& b)
+                         { return a.first < b.first; });
+
+        size_t n = 0;
+        for (size_t i = 0; i < nativeToDomesticMap_.size(); ++i) {
+            if (n > 0 && nativeToDomesticMap_[n - 1].first == nativeToDomesticMap_[i].first)
+                nativeToDomesticMap_[n - 1] = nativeToDomesticMap_[i];
+            else
+                nativeToDomesticMap_[n++] = nativeToDomesticMap_[i];
         }
+        nativeToDomesticMap_.resize(n);
     }
 #endif // HAVE_MPI
 
-    std::set<Index> nativeBlackListedIndices_;
-    std::map<Index, Index> nativeToDomesticMap_;
+    // the black listed native indices and the (native index, domestic index) pairs of
+    // the indices of the peers. both are flat arrays sorted by the native index.
+    std::vector<Index> nativeBlackListedIndices_;
+    std::vector<NativeToDomesticEntry> nativeToDomesticMap_;
 #if HAVE_MPI
     std::map<ProcessRank, MpiBuffer<unsigned>> numGlobalIdxSendBuff_;
-    std::map<ProcessRank, MpiBuffer<Index>> globalIdxSendBuff_;
+    std::map<ProcessRank, MpiBuffer<GlobalIndex>> globalIdxSendBuff_;
 #endif // HAVE_MPI
 
     PeerBlackLists peerBlackLists_;
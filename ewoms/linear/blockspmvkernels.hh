@@ -0,0 +1,248 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \brief Sparse matrix-vector products for block matrices which are specialized on
+ *        the size of the blocks.
+ *
+ * The generic code of dune-istl processes each block separately, which prevents the
+ * compiler from keeping the partial sums of a row in registers. The kernels of this
+ * file accumulate the contributions of all blocks of a row before they are written to
+ * the result vector. For 2x2 and 3x3 blocks of double precision, AVX2 versions are
+ * used if the code is compiled with support for AVX2 and FMA (e.g., using
+ * '-march=native' on a recent x86 CPU).
+ */
+#ifndef EWOMS_BLOCK_SPMV_KERNELS_HH
+#define EWOMS_BLOCK_SPMV_KERNELS_HH
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#define EWOMS_HAVE_AVX2_SPMV_KERNELS 1
+#endif
+
+namespace Ewoms {
+namespace Linear {
+
+/*!
+ * \ingroup Linear
+ *
+ * \brief Computes \f$y = y + \alpha \sum_j A_{ij} x_j\f$ for the blocks of a single row
+ *        of a block matrix.
+ *
+ * This is the generic version, which works for arbitrary square blocks.
+ */
+template <class Scalar, int n>
+struct BlockRowKernel
+{
+    template <class ColIterator, class DomainVector, class RangeBlock>
+    static void usmv(Scalar alpha,
+                     ColIterator colIt,
+                     const ColIterator& colEndIt,
+                     const DomainVector& x,
+                     RangeBlock& y)
+    {
+        Scalar sum[n];
+        for (int i = 0; i < n; ++i)
+            sum[i] = 0.0;
+
+        for (; colIt != colEndIt; ++colIt) {
+            const auto& block = *colIt;
+            const auto& xBlock = x[colIt.index()];
+            for (int i = 0; i < n; ++i)
+                for (int j = 0; j < n; ++j)
+                    sum[i] += block[i][j]*xBlock[j];
+        }
+
+        for (int i = 0; i < n; ++i)
+            y[i] += alpha*sum[i];
+    }
+};
+
+#if EWOMS_HAVE_AVX2_SPMV_KERNELS
+/*!
+ * \ingroup Linear
+ *
+ * \brief The AVX2 version of the row kernel for 2x2 blocks of double precision
+ *
+ * Each block consists of four consecutive values, i.e., it can be multiplied with the
+ * block of the vector using a single instruction.
+ */
+template <>
+struct BlockRowKernel<double, 2>
+{
+    template <class ColIterator, class DomainVector, class RangeBlock>
+    static void usmv(double alpha,
+                     ColIterator colIt,
+                     const ColIterator& colEndIt,
+                     const DomainVector& x,
+                     RangeBlock& y)
+    {
+        __m256d sum = _mm256_setzero_pd();
+        for (; colIt != colEndIt; ++colIt) {
+            const double* a = &(*colIt)[0][0];
+            const __m256d xBlock = _mm256_broadcast_pd(reinterpret_cast<const __m128d*>(&x[colIt.index()][0]));
+            sum = _mm256_fmadd_pd(_mm256_loadu_pd(a), xBlock, sum);
+        }
+
+        alignas(32) double tmp[4];
+        _mm256_store_pd(tmp, sum);
+        y[0] += alpha*(tmp[0] + tmp[1]);
+        y[1] += alpha*(tmp[2] + tmp[3]);
+    }
+};
+
+/*!
+ * \ingroup Linear
+ *
+ * \brief The AVX2 version of the row kernel for 3x3 blocks of double precision
+ *
+ * Each row of a block is multiplied with the vector block using a SIMD register of
+ * which only the first three lanes are used. Masked loads make sure that memory
+ * beyond the end of the blocks is not accessed.
+ */
+template <>
+struct BlockRowKernel<double, 3>
+{
+    template <class ColIterator, class DomainVector, class RangeBlock>
+    static void usmv(double alpha,
+                     ColIterator colIt,
+                     const ColIterator& colEndIt,
+                     const DomainVector& x,
+                     RangeBlock& y)
+    {
+        const __m256i mask = _mm256_set_epi64x(0, -1, -1, -1);
+
+        __m256d sum0 = _mm256_setzero_pd();
+        __m256d sum1 = _mm256_setzero_pd();
+        __m256d sum2 = _mm256_setzero_pd();
+        for (; colIt != colEndIt; ++colIt) {
+            const double* a = &(*colIt)[0][0];
+            const __m256d xBlock = _mm256_maskload_pd(&x[colIt.index()][0], mask);
+
+            // the fourth lane of the first two rows contains the first entry of the
+            // next row, but it is ignored by the horizontal sums below
+            sum0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + 0), xBlock, sum0);
+            sum1 = _mm256_fmadd_pd(_mm256_loadu_pd(a + 3), xBlock, sum1);
+            sum2 = _mm256_fmadd_pd(_mm256_maskload_pd(a + 6, mask), xBlock, sum2);
+        }
+
+        alignas(32) double tmp0[4];
+        alignas(32) double tmp1[4];
+        alignas(32) double tmp2[4];
+        _mm256_store_pd(tmp0, sum0);
+        _mm256_store_pd(tmp1, sum1);
+        _mm256_store_pd(tmp2, sum2);
+        y[0] += alpha*(tmp0[0] + tmp0[1] + tmp0[2]);
+        y[1] += alpha*(tmp1[0] + tmp1[1] + tmp1[2]);
+        y[2] += alpha*(tmp2[0] + tmp2[1] + tmp2[2]);
+    }
+};
+#endif // EWOMS_HAVE_AVX2_SPMV_KERNELS
+
+/*!
+ * \ingroup Linear
+ *
+ * \brief Computes \f$y = y + \alpha A x\f$ for a block matrix using the row kernels.
+ */
+template <class Matrix, class DomainVector, class RangeVector>
+void blockUsmv(typename Matrix::field_type alpha,
+               const Matrix& A,
+               const DomainVector& x,
+               RangeVector& y)
+{
+    typedef typename Matrix::block_type MatrixBlock;
+    typedef typename Matrix::field_type Scalar;
+    static_assert(MatrixBlock::rows == MatrixBlock::cols,
+                  "The block kernels require square blocks");
+    typedef BlockRowKernel<Scalar, MatrixBlock::rows> Kernel;
+
+    const auto& rowEndIt = A.end();
+    for (auto rowIt = A.begin(); rowIt != rowEndIt; ++rowIt)
+        Kernel::usmv(alpha, rowIt->begin(), rowIt->end(), x, y[rowIt.index()]);
+}
+
+/*!
+ * \ingroup Linear
+ *
+ * \brief Computes \f$y_i = y_i + \alpha \sum_j A_{ij} x_j\f$ for a subset of the rows
+ *        of a block matrix.
+ *
+ * The remaining rows of the result vector are not touched.
+ */
+template <class Matrix, class DomainVector, class RangeVector, class RowIndexList>
+void blockUsmvRows(typename Matrix::field_type alpha,
+                   const Matrix& A,
+                   const DomainVector& x,
+                   RangeVector& y,
+                   const RowIndexList& rowIndices)
+{
+    typedef typename Matrix::block_type MatrixBlock;
+    typedef typename Matrix::field_type Scalar;
+    static_assert(MatrixBlock::rows == MatrixBlock::cols,
+                  "The block kernels require square blocks");
+    typedef BlockRowKernel<Scalar, MatrixBlock::rows> Kernel;
+
+    const auto& rowIdxEndIt = rowIndices.end();
+    for (auto rowIdxIt = rowIndices.begin(); rowIdxIt != rowIdxEndIt; ++rowIdxIt) {
+        const auto& row = A[*rowIdxIt];
+        Kernel::usmv(alpha, row.begin(), row.end(), x, y[*rowIdxIt]);
+    }
+}
+
+/*!
+ * \ingroup Linear
+ *
+ * \brief Computes \f$y_i = \sum_j A_{ij} x_j\f$ for a subset of the rows of a block
+ *        matrix.
+ *
+ * The remaining rows of the result vector are not touched.
+ */
+template <class Matrix, class DomainVector, class RangeVector, class RowIndexList>
+void blockMvRows(const Matrix& A,
+                 const DomainVector& x,
+                 RangeVector& y,
+                 const RowIndexList& rowIndices)
+{
+    const auto& rowIdxEndIt = rowIndices.end();
+    for (auto rowIdxIt = rowIndices.begin(); rowIdxIt != rowIdxEndIt; ++rowIdxIt)
+        y[*rowIdxIt] = 0.0;
+    blockUsmvRows(1.0, A, x, y, rowIndices);
+}
+
+/*!
+ * \ingroup Linear
+ *
+ * \brief Computes \f$y = A x\f$ for a block matrix using the row kernels.
+ */
+template <class Matrix, class DomainVector, class RangeVector>
+void blockMv(const Matrix& A, const DomainVector& x, RangeVector& y)
+{
+    y = 0.0;
+    blockUsmv(1.0, A, x, y);
+}
+
+} // namespace Linear
+} // namespace Ewoms
+
+#endif
@@ -190,15 +190,39 @@ private:
         lastResidualError_ = residualError_;
         residualError_ = 0.0;
         stagnates_ = true;
-        for (size_t i = 0; i < curResid.size(); ++i) {
-            for (unsigned j = 0; j < BlockType::dimension; ++j) {
-                residualError_ =
-                    std::max<Scalar>(residualError_,
-                                     std::abs(curResid[i][j]));
-
-                if (stagnates_ && changeIndicator[i][j] != 0.0)
-                    // only stagnation means that we've failed!
-                    stagnates_ = false;
+
+        // each thread determines the maximum of a part of the vector
+        int n = static_cast<int>(curResid.size());
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+        {
+            Scalar threadResidualError = 0.0;
+            bool threadStagnates = true;
+
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+            for (int i = 0; i < n; ++i) {
+                const auto& residBlock = curResid[i];
+                const auto& changeBlock = changeIndicator[i];
+                for (unsigned j = 0; j < BlockType::dimension; ++j) {
+                    threadResidualError =
+                        std::max<Scalar>(threadResidualError,
+                                         std::abs(residBlock[j]));
+
+                    if (changeBlock[j] != 0.0)
+                        // only stagnation means that we've failed!
+                        threadStagnates = false;
+                }
+            }
+
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+            {
+                residualError_ = std::max(residualError_, threadResidualError);
+                stagnates_ = stagnates_ && threadStagnates;
             }
         }
 
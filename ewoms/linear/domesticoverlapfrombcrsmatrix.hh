@@ -61,13 +61,19 @@ public:
     /*!
      * \brief Constructs the foreign overlap given a BCRS matrix and
      *        an initial list of border indices.
+     *
+     * All communication required for the overlap is done using the
+     * specified MPI communicator. If useRcmOrdering is true, the local indices are
+     * numbered in reverse Cuthill-McKee order (cf. ForeignOverlapFromBCRSMatrix).
      */
     template <class BCRSMatrix>
     DomesticOverlapFromBCRSMatrix(const BCRSMatrix& A,
                                   const BorderList& borderList,
                                   const BlackList& blackList,
-                                  unsigned overlapSize)
-        : foreignOverlap_(A, borderList, blackList, overlapSize)
+                                  unsigned overlapSize,
+                                  MpiCommunicator comm = defaultMpiCommunicator(),
+                                  bool useRcmOrdering = false)
+        : foreignOverlap_(A, borderList, blackList, overlapSize, comm, useRcmOrdering)
         , blackList_(blackList)
         , globalIndices_(foreignOverlap_)
     {
@@ -76,9 +82,9 @@ public:
 
 #if HAVE_MPI
         int tmp;
-        MPI_Comm_rank(MPI_COMM_WORLD, &tmp);
+        MPI_Comm_rank(communicator(), &tmp);
         myRank_ = static_cast<ProcessRank>(tmp);
-        MPI_Comm_size(MPI_COMM_WORLD, &tmp);
+        MPI_Comm_size(communicator(), &tmp);
         worldSize_ = static_cast<unsigned>(tmp);
 #endif // HAVE_MPI
 
@@ -105,7 +111,7 @@ public:
         auto peerIt = peerSet_.begin();
         const auto& peerEndIt = peerSet_.end();
         for (; peerIt != peerEndIt; ++peerIt) {
-            auto& buffer = *(new MpiBuffer<unsigned>(1));
+            auto& buffer = *(new MpiBuffer<unsigned>(1, communicator()));
             sizeBufferMap[*peerIt] = &buffer;
             buffer[0] = foreignOverlap_.foreignOverlapWithPeer(*peerIt).size();
             buffer.send(*peerIt);
@@ -113,7 +119,7 @@ public:
 
         peerIt = peerSet_.begin();
         for (; peerIt != peerEndIt; ++peerIt) {
-            MpiBuffer<unsigned> rcvBuffer(1);
+            MpiBuffer<unsigned> rcvBuffer(1, communicator());
             rcvBuffer.receive(*peerIt);
 
             assert(rcvBuffer[0] == domesticOverlapWithPeer_.find(*peerIt)->second.size());
@@ -207,6 +213,12 @@ public:
     unsigned overlapSize() const
     { return foreignOverlap_.overlapSize(); }
 
+    /*!
+     * \brief Returns the MPI communicator used for the overlap
+     */
+    MpiCommunicator communicator() const
+    { return foreignOverlap_.communicator(); }
+
     /*!
      * \brief Returns the number native indices
      *
@@ -271,7 +283,7 @@ public:
     /*!
      * \brief Returns a domestic index given a global one
      */
-    Index globalToDomestic(Index globalIdx) const
+    Index globalToDomestic(GlobalIndex globalIdx) const
     {
         Index internalIdx = globalIndices_.globalToDomestic(globalIdx);
         if (internalIdx < 0)
@@ -282,7 +294,7 @@ public:
     /*!
      * \brief Returns a global index given a domestic one
      */
-    Index domesticToGlobal(Index domIdx) const
+    GlobalIndex domesticToGlobal(Index domIdx) const
     { return globalIndices_.domesticToGlobal(mapExternalToInternal_(domIdx)); }
 
     /*!
@@ -453,12 +465,12 @@ protected:
         // indices stemming from the overlap (i.e. without the border
         // indices)
         size_t numIndices = foreignOverlap.size();
-        numIndicesSendBuffer_[peerRank] = new MpiBuffer<size_t>(1);
+        numIndicesSendBuffer_[peerRank] = new MpiBuffer<size_t>(1, communicator());
         (*numIndicesSendBuffer_[peerRank])[0] = numIndices;
         numIndicesSendBuffer_[peerRank]->send(peerRank);
 
         // create MPI buffers
-        indicesSendBuffer_[peerRank] = new MpiBuffer<IndexDistanceNpeers>(numIndices);
+        indicesSendBuffer_[peerRank] = new MpiBuffer<GlobalIndexDistanceNpeers>(numIndices, communicator());
 
         // then send the additional indices themselfs
         auto overlapIt = foreignOverlap.begin();
@@ -468,8 +480,8 @@ protected:
             BorderDistance borderDistance = overlapIt->borderDistance;
             size_t numPeers = foreignOverlap_.foreignOverlapByLocalIndex(localIdx).size();
 
-            IndexDistanceNpeers tmp;
-            tmp.index = globalIndices_.domesticToGlobal(localIdx);
+            GlobalIndexDistanceNpeers tmp;
+            tmp.globalIdx = globalIndices_.domesticToGlobal(localIdx);
             tmp.borderDistance = borderDistance;
             tmp.numPeers = static_cast<unsigned>(numPeers);
 
@@ -494,15 +506,15 @@ protected:
 #if HAVE_MPI
         // receive the number of additional indices
         int numIndices = -1;
-        MpiBuffer<size_t> numIndicesRecvBuff(1);
+        MpiBuffer<size_t> numIndicesRecvBuff(1, communicator());
         numIndicesRecvBuff.receive(peerRank);
         numIndices = static_cast<int>(numIndicesRecvBuff[0]);
 
         // receive the additional indices themselfs
-        MpiBuffer<IndexDistanceNpeers> recvBuff(static_cast<size_t>(numIndices));
+        MpiBuffer<GlobalIndexDistanceNpeers> recvBuff(static_cast<size_t>(numIndices), communicator());
         recvBuff.receive(peerRank);
         for (unsigned i = 0; i < static_cast<unsigned>(numIndices); ++i) {
-            Index globalIdx = recvBuff[i].index;
+            GlobalIndex globalIdx = recvBuff[i].globalIdx;
             BorderDistance borderDistance = recvBuff[i].borderDistance;
 
             // if the index is not already known, add it to the
@@ -572,7 +584,7 @@ protected:
     std::vector<ProcessRank> masterRank_;
 
     std::map<ProcessRank, MpiBuffer<size_t> *> numIndicesSendBuffer_;
-    std::map<ProcessRank, MpiBuffer<IndexDistanceNpeers> *> indicesSendBuffer_;
+    std::map<ProcessRank, MpiBuffer<GlobalIndexDistanceNpeers> *> indicesSendBuffer_;
     GlobalIndices globalIndices_;
     PeerSet peerSet_;
 };
@@ -33,10 +33,10 @@
 #include <dune/istl/operators.hh>
 
 #include <algorithm>
-#include <set>
-#include <map>
+#include <vector>
+#include <utility>
 #include <iostream>
-#include <tuple>
+#include <cassert>
 
 #if HAVE_MPI
 #include <mpi.h>
@@ -56,8 +56,11 @@ class GlobalIndices
 {
     GlobalIndices(const GlobalIndices& ) = delete;
 
-    typedef std::map<Index, Index> GlobalToDomesticMap;
-    typedef std::map<Index, Index> DomesticToGlobalMap;
+    // the global->domestic mapping is a flat array of (global index, domestic index)
+    // pairs which is sorted by the global index. the domestic->global mapping is
+    // directly indexed by the domestic index.
+    typedef std::vector<std::pair<GlobalIndex, Index> > GlobalToDomesticMap;
+    typedef std::vector<GlobalIndex> DomesticToGlobalMap;
 
 public:
     GlobalIndices(const ForeignOverlap& foreignOverlap)
@@ -65,13 +68,14 @@ public:
     {
         myRank_ = 0;
         mpiSize_ = 1;
+        globalToDomesticIsSorted_ = true;
 
 #if HAVE_MPI
         {
             int tmp;
-            MPI_Comm_rank(MPI_COMM_WORLD, &tmp);
+            MPI_Comm_rank(foreignOverlap_.communicator(), &tmp);
             myRank_ = static_cast<ProcessRank>(tmp);
-            MPI_Comm_size(MPI_COMM_WORLD, &tmp);
+            MPI_Comm_size(foreignOverlap_.communicator(), &tmp);
             mpiSize_ = static_cast<size_t>(tmp);
         }
 #endif
@@ -85,24 +89,26 @@ public:
     /*!
      * \brief Converts a domestic index to a global one.
      */
-    Index domesticToGlobal(Index domesticIdx) const
+    GlobalIndex domesticToGlobal(Index domesticIdx) const
     {
-        assert(domesticToGlobal_.find(domesticIdx) != domesticToGlobal_.end());
+        assert(0 <= domesticIdx
+               && static_cast<size_t>(domesticIdx) < domesticToGlobal_.size()
+               && domesticToGlobal_[static_cast<size_t>(domesticIdx)] >= 0);
 
-        return domesticToGlobal_.find(domesticIdx)->second;
+        return domesticToGlobal_[static_cast<size_t>(domesticIdx)];
     }
 
     /*!
      * \brief Converts a global index to a domestic one.
      */
-    Index globalToDomestic(Index globalIdx) const
+    Index globalToDomestic(GlobalIndex globalIdx) const
     {
-        const auto& tmp = globalToDomestic_.find(globalIdx);
+        const auto& it = findGlobalIndex_(globalIdx);
 
-        if (tmp == globalToDomestic_.end())
+        if (it == globalToDomestic_.end() || it->first != globalIdx)
             return -1;
 
-        return tmp->second;
+        return it->second;
     }
 
     /*!
@@ -124,13 +130,22 @@ public:
     /*!
      * \brief Add an index to the domestic<->global mapping.
      */
-    void addIndex(Index domesticIdx, Index globalIdx)
+    void addIndex(Index domesticIdx, GlobalIndex globalIdx)
     {
-        domesticToGlobal_[domesticIdx] = globalIdx;
-        globalToDomestic_[globalIdx] = domesticIdx;
-        numDomestic_ = domesticToGlobal_.size();
-
-        assert(domesticToGlobal_.size() == globalToDomestic_.size());
+        assert(domesticIdx >= 0 && globalIdx >= 0);
+
+        size_t domIdx = static_cast<size_t>(domesticIdx);
+        if (domIdx >= domesticToGlobal_.size())
+            domesticToGlobal_.resize(domIdx + 1, /*value=*/-1);
+        if (domesticToGlobal_[domIdx] < 0)
+            ++ numDomestic_;
+        domesticToGlobal_[domIdx] = globalIdx;
+
+        // the indices are usually added in ascending order, so the array usually stays
+        // sorted. if it does not, it is sorted before the next look-up.
+        if (!globalToDomestic_.empty() && globalToDomestic_.back().first >= globalIdx)
+            globalToDomesticIsSorted_ = false;
+        globalToDomestic_.push_back(std::make_pair(globalIdx, domesticIdx));
     }
 
     /*!
@@ -147,7 +162,7 @@ public:
                  MPI_BYTE,                     // data type
                  static_cast<int>(peerRank),   // peer process
                  0,                            // tag
-                 MPI_COMM_WORLD);              // communicator
+                 foreignOverlap_.communicator()); // communicator
 #endif
     }
 
@@ -164,12 +179,12 @@ public:
                  MPI_BYTE,                     // data type
                  static_cast<int>(peerRank),   // peer process
                  0,                            // tag
-                 MPI_COMM_WORLD,               // communicator
+                 foreignOverlap_.communicator(), // communicator
                  MPI_STATUS_IGNORE);           // status
 
         Index domesticIdx = foreignOverlap_.nativeToLocal(recvBuf.peerIdx);
         if (domesticIdx >= 0) {
-            Index globalIdx = recvBuf.globalIdx;
+            GlobalIndex globalIdx = recvBuf.globalIdx;
             addIndex(domesticIdx, globalIdx);
         }
 #endif // HAVE_MPI
@@ -178,8 +193,11 @@ public:
     /*!
      * \brief Return true iff a given global index already exists
      */
-    bool hasGlobalIndex(Index globalIdx) const
-    { return globalToDomestic_.find(globalIdx) != globalToDomestic_.end(); }
+    bool hasGlobalIndex(GlobalIndex globalIdx) const
+    {
+        const auto& it = findGlobalIndex_(globalIdx);
+        return it != globalToDomestic_.end() && it->first == globalIdx;
+    }
 
     /*!
      * \brief Prints the global indices of all domestic indices
@@ -208,44 +226,39 @@ protected:
 #endif
 
 #if HAVE_MPI
-        if (myRank_ == 0) {
-            // the first rank starts at index zero
-            domesticOffset_ = 0;
-        }
-        else {
-            // all other ranks retrieve their offset from the next
-            // lower rank
-            MPI_Recv(&domesticOffset_, // buffer
-                     1,                // count
-                     MPI_INT,          // data type
-                     static_cast<int>(myRank_ - 1), // peer rank
-                     0,                // tag
-                     MPI_COMM_WORLD,   // communicator
-                     MPI_STATUS_IGNORE);
-        }
+        size_t numLocal = foreignOverlap_.numLocal();
+        domesticToGlobal_.reserve(numLocal);
+        globalToDomestic_.reserve(numLocal);
+
+        // count the indices for which the current process is the master
+        GlobalIndex numMaster = 0;
+        for (unsigned i = 0; i < numLocal; ++i)
+            if (foreignOverlap_.iAmMasterOf(static_cast<Index>(i)))
+                ++numMaster;
+
+        // the offset of each rank is the sum of the number of master indices of all
+        // lower ranks. MPI_Exscan leaves the result of the first rank undefined, which
+        // starts at index zero.
+        domesticOffset_ = 0;
+        GlobalIndex tmp = 0;
+        MPI_Exscan(&numMaster,       // send buffer
+                   &tmp,             // receive buffer
+                   1,                // count
+                   MPI_LONG_LONG,    // data type
+                   MPI_SUM,          // operation
+                   foreignOverlap_.communicator()); // communicator
+        if (myRank_ > 0)
+            domesticOffset_ = tmp;
 
         // create maps for all indices for which the current process
         // is the master
-        int numMaster = 0;
-        for (unsigned i = 0; i < foreignOverlap_.numLocal(); ++i) {
+        GlobalIndex masterIdx = 0;
+        for (unsigned i = 0; i < numLocal; ++i) {
             if (!foreignOverlap_.iAmMasterOf(static_cast<Index>(i)))
                 continue;
 
-            addIndex(static_cast<Index>(i),
-                     static_cast<Index>(domesticOffset_ + numMaster));
-            ++numMaster;
-        }
-
-        if (myRank_ < mpiSize_ - 1) {
-            // send the domestic offset plus the number of master
-            // indices to the process which is one rank higher
-            int tmp = domesticOffset_ + numMaster;
-            MPI_Send(&tmp,            // buff
-                     1,               // count
-                     MPI_INT,         // data type
-                     static_cast<int>(myRank_ + 1), // peer rank
-                     0,               // tag
-                     MPI_COMM_WORLD); // communicator
+            addIndex(static_cast<Index>(i), domesticOffset_ + masterIdx);
+            ++masterIdx;
         }
 
         typename PeerSet::const_iterator peerIt;
@@ -277,9 +290,48 @@ protected:
             if (*peerIt < myRank_)
                 sendBorderTo_(*peerIt);
         }
+
+        sortGlobalToDomestic_();
 #endif // HAVE_MPI
     }
 
+    typename GlobalToDomesticMap::const_iterator findGlobalIndex_(GlobalIndex globalIdx) const
+    {
+        sortGlobalToDomestic_();
+
+        typedef typename GlobalToDomesticMap::value_type Entry;
+        return std::lower_bound(globalToDomestic_.begin(),
+                                globalToDomestic_.end(),
+                                globalIdx,
+                                [](const Entry& entry, GlobalIndex idx)
+                                { return entry.first < idx; });
+    }
+
+    // sort the global->domestic mapping by the global indices. if a global index has
+    // been added multiple times, the last entry wins.
+    void sortGlobalToDomestic_() const
+    {
+        if (globalToDomesticIsSorted_)
+            return;
+
+        typedef typename GlobalToDomesticMap::value_type Entry;
+        std::stable_sort(globalToDomestic_.begin(),
+                         globalToDomestic_.end(),
+                         [](const Entry& a, const Entry& b)
+                         { return a.first < b.first; });
+
+        size_t n = 0;
+        for (size_t i = 0; i < globalToDomestic_.size(); ++i) {
+            if (n > 0 && globalToDomestic_[n - 1].first == globalToDomestic_[i].first)
+                globalToDomestic_[n - 1] = globalToDomestic_[i];
+            else
+                globalToDomestic_[n++] = globalToDomestic_[i];
+        }
+        globalToDomestic_.resize(n);
+
+        globalToDomesticIsSorted_ = true;
+    }
+
     void sendBorderTo_(ProcessRank peerRank)
     {
 #if HAVE_MPI
@@ -333,11 +385,12 @@ protected:
     ProcessRank myRank_;
     size_t mpiSize_;
 
-    int domesticOffset_;
+    GlobalIndex domesticOffset_;
     size_t numDomestic_;
     const ForeignOverlap& foreignOverlap_;
 
-    GlobalToDomesticMap globalToDomestic_;
+    mutable GlobalToDomesticMap globalToDomestic_;
+    mutable bool globalToDomesticIsSorted_;
     DomesticToGlobalMap domesticToGlobal_;
 };
 
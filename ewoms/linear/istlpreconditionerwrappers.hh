@@ -38,20 +38,42 @@
  * - \c SSOR: A symmetric successive overrelaxation (SSOR) preconditioner
  * - \c SOR: A successive overrelaxation (SOR) preconditioner
  * - \c ILUn: An ILU(n) preconditioner
- * - \c ILU0: A specialized (and optimized) ILU(0) preconditioner
+ * - \c ILU0: A specialized (and optimized) ILU(0) preconditioner. This is the only one
+ *            which can also be applied to transposed linear systems.
+ * - \c FloatILU0: The ILU(0) preconditioner, but its incomplete factors are stored in
+ *                 single precision
+ * - \c FloatILUn: The ILU(n) preconditioner, but its incomplete factors are stored in
+ *                 single precision
+ * - \c ThreadedILU0: A block-Jacobi preconditioner which uses ILU(0) for the blocks. Each
+ *                    OpenMP thread of the process is responsible for one block.
+ * - \c LevelScheduledILU0: The ILU(0) preconditioner, but the triangular systems are
+ *                          solved using all OpenMP threads of the process
  */
 #ifndef EWOMS_ISTL_PRECONDITIONER_WRAPPERS_HH
 #define EWOMS_ISTL_PRECONDITIONER_WRAPPERS_HH
 
+#include "seqtransposableilu0.hh"
+#include "threadedblockjacobiilu0.hh"
+#include "levelscheduledilu0.hh"
+#include "mixedprecisionpreconditioner.hh"
+
 #include <ewoms/common/propertysystem.hh>
 #include <ewoms/common/parametersystem.hh>
 
+#include <opm/common/ErrorMacros.hpp>
+#include <opm/common/Exceptions.hpp>
+
 #include <dune/istl/preconditioners.hh>
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/bvector.hh>
+#include <dune/common/fmatrix.hh>
+#include <dune/common/fvector.hh>
+
+#include <memory>
 
 namespace Ewoms {
 namespace Properties {
 NEW_PROP_TAG(Scalar);
-NEW_PROP_TAG(JacobianMatrix);
 NEW_PROP_TAG(OverlappingMatrix);
 NEW_PROP_TAG(OverlappingVector);
 NEW_PROP_TAG(PreconditionerOrder);
@@ -59,16 +81,48 @@ NEW_PROP_TAG(PreconditionerRelaxation);
 } // namespace Properties
 
 namespace Linear {
+/*!
+ * \brief Specify whether a sequential preconditioner is applied to the transposed
+ *        linear system.
+ *
+ * Preconditioners which do not support this throw an exception if they are to be
+ * transposed.
+ */
+template <class SeqPreCond>
+void setPreconditionerTransposed(SeqPreCond& seqPreCond OPM_UNUSED, bool yesno)
+{
+    if (yesno)
+        OPM_THROW(Opm::NotImplemented,
+                  "The chosen preconditioner cannot be applied to transposed linear systems");
+}
+
+template <class Matrix, class DomainVector, class RangeVector>
+void setPreconditionerTransposed(SeqTransposableIlu0<Matrix, DomainVector, RangeVector>& seqPreCond,
+                                 bool yesno)
+{ seqPreCond.setTransposed(yesno); }
+
+template <class Matrix, class DomainVector, class RangeVector>
+void setPreconditionerTransposed(ThreadedBlockJacobiIlu0<Matrix, DomainVector, RangeVector>& seqPreCond,
+                                 bool yesno)
+{ seqPreCond.setTransposed(yesno); }
+
+template <class LowPrecisionPreconditioner, class DomainVector, class RangeVector>
+void setPreconditionerTransposed(MixedPrecisionPreconditioner<LowPrecisionPreconditioner,
+                                                              DomainVector,
+                                                              RangeVector>& seqPreCond,
+                                 bool yesno)
+{ setPreconditionerTransposed(seqPreCond.lowPrecisionPreconditioner(), yesno); }
+
 #define EWOMS_WRAP_ISTL_PRECONDITIONER(PREC_NAME, ISTL_PREC_TYPE)               \
     template <class TypeTag>                                                    \
     class PreconditionerWrapper##PREC_NAME                                      \
     {                                                                           \
         typedef typename GET_PROP_TYPE(TypeTag, Scalar) Scalar;                 \
-        typedef typename GET_PROP_TYPE(TypeTag, JacobianMatrix) JacobianMatrix; \
+        typedef typename GET_PROP_TYPE(TypeTag, OverlappingMatrix) OverlappingMatrix; \
         typedef typename GET_PROP_TYPE(TypeTag, OverlappingVector) OverlappingVector; \
                                                                                 \
     public:                                                                     \
-        typedef ISTL_PREC_TYPE<JacobianMatrix, OverlappingVector,               \
+        typedef ISTL_PREC_TYPE<OverlappingMatrix, OverlappingVector,            \
                                OverlappingVector> SequentialPreconditioner;     \
         PreconditionerWrapper##PREC_NAME()                                      \
         {}                                                                      \
@@ -82,7 +136,7 @@ namespace Linear {
                                  "preconditioner");                             \
         }                                                                       \
                                                                                 \
-        void prepare(JacobianMatrix& matrix)                                    \
+        void prepare(OverlappingMatrix& matrix)                                 \
         {                                                                       \
             int order = EWOMS_GET_PARAM(TypeTag, int, PreconditionerOrder);     \
             Scalar relaxationFactor = EWOMS_GET_PARAM(TypeTag, Scalar, PreconditionerRelaxation);   \
@@ -90,6 +144,9 @@ namespace Linear {
                                                        relaxationFactor);       \
         }                                                                       \
                                                                                 \
+        void setTransposed(bool yesno)                                          \
+        { setPreconditionerTransposed(*seqPreCond_, yesno); }                   \
+                                                                                \
         SequentialPreconditioner& get()                                         \
         { return *seqPreCond_; }                                                \
                                                                                 \
@@ -131,6 +188,72 @@ namespace Linear {
                                                        relaxationFactor);       \
         }                                                                       \
                                                                                 \
+        void setTransposed(bool yesno)                                          \
+        { setPreconditionerTransposed(*seqPreCond_, yesno); }                   \
+                                                                                \
+        SequentialPreconditioner& get()                                         \
+        { return *seqPreCond_; }                                                \
+                                                                                \
+        void cleanup()                                                          \
+        { delete seqPreCond_; }                                                 \
+                                                                                \
+    private:                                                                    \
+        SequentialPreconditioner *seqPreCond_;                                  \
+    };
+
+// the same as the EWOMS_WRAP_ISTL_PRECONDITIONER macro, but the preconditioner is
+// constructed for a single precision copy of the matrix. the remaining arguments are
+// passed to the constructor of the preconditioner. since the preconditioners copy the
+// matrix, the single precision copy can be discarded after the preconditioner has been
+// created.
+#define EWOMS_WRAP_ISTL_FLOAT_PRECONDITIONER(PREC_NAME, ISTL_PREC_TYPE, ...)   \
+    template <class TypeTag>                                                    \
+    class PreconditionerWrapper##PREC_NAME                                      \
+    {                                                                           \
+        typedef typename GET_PROP_TYPE(TypeTag, Scalar) Scalar;                 \
+        typedef typename GET_PROP_TYPE(TypeTag, OverlappingMatrix) OverlappingMatrix; \
+        typedef typename GET_PROP_TYPE(TypeTag, OverlappingVector) OverlappingVector; \
+                                                                                \
+        typedef typename OverlappingMatrix::block_type MatrixBlock;             \
+        typedef Dune::FieldMatrix<float, MatrixBlock::rows, MatrixBlock::cols> FloatMatrixBlock; \
+        typedef Dune::FieldVector<float, MatrixBlock::rows> FloatVectorBlock;   \
+        typedef Dune::BCRSMatrix<FloatMatrixBlock> FloatMatrix;                 \
+        typedef Dune::BlockVector<FloatVectorBlock> FloatVector;                \
+        typedef ISTL_PREC_TYPE<FloatMatrix, FloatVector,                        \
+                               FloatVector> FloatPreconditioner;                \
+                                                                                \
+    public:                                                                     \
+        typedef MixedPrecisionPreconditioner<FloatPreconditioner,               \
+                                             OverlappingVector,                 \
+                                             OverlappingVector> SequentialPreconditioner; \
+        PreconditionerWrapper##PREC_NAME()                                      \
+        {}                                                                      \
+                                                                                \
+        static void registerParameters()                                        \
+        {                                                                       \
+            EWOMS_REGISTER_PARAM(TypeTag, int, PreconditionerOrder,             \
+                                 "The order of the preconditioner");            \
+            EWOMS_REGISTER_PARAM(TypeTag, Scalar, PreconditionerRelaxation,     \
+                                 "The relaxation factor of the "                \
+                                 "preconditioner");                             \
+        }                                                                       \
+                                                                                \
+        void prepare(OverlappingMatrix& matrix)                                 \
+        {                                                                       \
+            int order OPM_UNUSED = EWOMS_GET_PARAM(TypeTag, int, PreconditionerOrder); \
+            float relaxationFactor =                                            \
+                EWOMS_GET_PARAM(TypeTag, Scalar, PreconditionerRelaxation);     \
+                                                                                \
+            FloatMatrix floatMatrix;                                            \
+            copyMatrixToPrecision(floatMatrix, matrix);                         \
+            auto floatPreCond =                                                 \
+                std::make_shared<FloatPreconditioner>(floatMatrix, __VA_ARGS__); \
+            seqPreCond_ = new SequentialPreconditioner(floatPreCond);           \
+        }                                                                       \
+                                                                                \
+        void setTransposed(bool yesno)                                          \
+        { setPreconditionerTransposed(*seqPreCond_, yesno); }                   \
+                                                                                \
         SequentialPreconditioner& get()                                         \
         { return *seqPreCond_; }                                                \
                                                                                 \
@@ -146,10 +269,16 @@ EWOMS_WRAP_ISTL_PRECONDITIONER(Jacobi, Dune::SeqJac)
 EWOMS_WRAP_ISTL_PRECONDITIONER(GaussSeidel, Dune::SeqGS)
 EWOMS_WRAP_ISTL_PRECONDITIONER(SOR, Dune::SeqSOR)
 EWOMS_WRAP_ISTL_PRECONDITIONER(SSOR, Dune::SeqSSOR)
-EWOMS_WRAP_ISTL_SIMPLE_PRECONDITIONER(ILU0, Dune::SeqILU0)
+EWOMS_WRAP_ISTL_SIMPLE_PRECONDITIONER(ILU0, Ewoms::Linear::SeqTransposableIlu0)
 EWOMS_WRAP_ISTL_PRECONDITIONER(ILUn, Dune::SeqILUn)
+EWOMS_WRAP_ISTL_SIMPLE_PRECONDITIONER(ThreadedILU0, Ewoms::Linear::ThreadedBlockJacobiIlu0)
+EWOMS_WRAP_ISTL_SIMPLE_PRECONDITIONER(LevelScheduledILU0, Ewoms::Linear::LevelScheduledIlu0)
+EWOMS_WRAP_ISTL_FLOAT_PRECONDITIONER(FloatILU0, Ewoms::Linear::SeqTransposableIlu0, relaxationFactor)
+EWOMS_WRAP_ISTL_FLOAT_PRECONDITIONER(FloatILUn, Dune::SeqILUn, order, relaxationFactor)
 
 #undef EWOMS_WRAP_ISTL_PRECONDITIONER
+#undef EWOMS_WRAP_ISTL_SIMPLE_PRECONDITIONER
+#undef EWOMS_WRAP_ISTL_FLOAT_PRECONDITIONER
 }} // namespace Linear, Ewoms
 
 #endif
@@ -55,7 +55,6 @@ NEW_PROP_TAG(JacobianMatrix);
 NEW_PROP_TAG(OverlappingMatrix);
 NEW_PROP_TAG(OverlappingVector);
 NEW_PROP_TAG(GMResRestart);
-NEW_PROP_TAG(LinearSolverTolerance);
 NEW_PROP_TAG(LinearSolverMaxIterations);
 NEW_PROP_TAG(LinearSolverVerbosity);
 } // namespace Properties
@@ -87,10 +86,9 @@ namespace Linear {
         template <class LinearOperator, class ScalarProduct, class Preconditioner> \
         std::shared_ptr<RawSolver> get(LinearOperator& parOperator,                \
                                        ScalarProduct& parScalarProduct,            \
-                                       Preconditioner& parPreCond)                 \
+                                       Preconditioner& parPreCond,                 \
+                                       Scalar tolerance)                           \
         {                                                                          \
-            Scalar tolerance = EWOMS_GET_PARAM(TypeTag, Scalar,                    \
-                                               LinearSolverTolerance);             \
             int maxIter = EWOMS_GET_PARAM(TypeTag, int, LinearSolverMaxIterations);\
                                                                                    \
             int verbosity = 0;                                                     \
@@ -143,9 +141,9 @@ public:
     template <class LinearOperator, class ScalarProduct, class Preconditioner>
     std::shared_ptr<RawSolver> get(LinearOperator& parOperator,
                                    ScalarProduct& parScalarProduct,
-                                   Preconditioner& parPreCond)
+                                   Preconditioner& parPreCond,
+                                   Scalar tolerance)
     {
-        Scalar tolerance = EWOMS_GET_PARAM(TypeTag, Scalar, LinearSolverTolerance);
         int maxIter = EWOMS_GET_PARAM(TypeTag, int, LinearSolverMaxIterations);
 
         int verbosity = 0;
@@ -0,0 +1,260 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ * \copydoc Ewoms::Linear::LevelScheduledIlu0
+ */
+#ifndef EWOMS_LEVEL_SCHEDULED_ILU0_HH
+#define EWOMS_LEVEL_SCHEDULED_ILU0_HH
+
+#include "blockspmvkernels.hh"
+
+#include <opm/common/Unused.hpp>
+
+#include <dune/istl/preconditioner.hh>
+#include <dune/istl/solvercategory.hh>
+#include <dune/istl/ilu.hh>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <algorithm>
+#include <vector>
+
+namespace Ewoms {
+namespace Linear {
+
+/*!
+ * \ingroup Linear
+ *
+ * \brief An ILU(0) preconditioner which solves the triangular systems using all
+ *        OpenMP threads of the process.
+ *
+ * The incomplete factors are the same as the ones of Dune::SeqILU0. For the triangular
+ * solves, the rows are grouped into levels: The rows of a level only depend on rows of
+ * the previous levels, so all rows of a level can be processed concurrently. The levels
+ * only depend on the sparsity pattern of the matrix and are thus only computed when
+ * the preconditioner is created. How much parallelism is exposed depends on the
+ * enumeration of the DOFs: For a structured grid of \f$n_x \times n_y \times n_z\f$
+ * cells with a lexicographic ordering, there are about \f$n_x + n_y + n_z\f$ levels.
+ * If the levels contain too few rows to keep all threads busy, or if only a single
+ * thread is available, the triangular systems are solved sequentially in the natural
+ * order of the rows.
+ */
+template <class Matrix, class DomainVector, class RangeVector>
+class LevelScheduledIlu0 : public Dune::Preconditioner<DomainVector, RangeVector>
+{
+    typedef typename Matrix::block_type MatrixBlock;
+    typedef typename RangeVector::block_type RangeBlock;
+
+public:
+    //! export types
+    typedef Matrix matrix_type;
+    typedef DomainVector domain_type;
+    typedef RangeVector range_type;
+    typedef typename DomainVector::field_type field_type;
+
+    enum { category = Dune::SolverCategory::sequential };
+
+    LevelScheduledIlu0(const Matrix& A, field_type relaxationFactor)
+        : ilu_(A)
+        , relaxationFactor_(relaxationFactor)
+    {
+        Dune::bilu0_decomposition(ilu_);
+        computeLevels_();
+    }
+
+    /*!
+     * \brief Returns true iff the triangular systems are solved using multiple threads.
+     */
+    bool usesThreads() const
+    { return useThreads_; }
+
+    /*!
+     * \brief Returns the number of levels of the lower triangular system.
+     *
+     * If the triangular systems are solved sequentially, this is 1.
+     */
+    unsigned numLowerLevels() const
+    { return static_cast<unsigned>(lowerLevelBegin_.size() - 1); }
+
+    /*!
+     * \brief Returns the number of levels of the upper triangular system.
+     *
+     * If the triangular systems are solved sequentially, this is 1.
+     */
+    unsigned numUpperLevels() const
+    { return static_cast<unsigned>(upperLevelBegin_.size() - 1); }
+
+    virtual void pre(DomainVector& x OPM_UNUSED, RangeVector& b OPM_UNUSED)
+    {}
+
+    virtual void apply(DomainVector& v, const RangeVector& d)
+    {
+        typedef BlockRowKernel<field_type, MatrixBlock::rows> Kernel;
+
+        unsigned numLowerLevels = this->numLowerLevels();
+        unsigned numUpperLevels = this->numUpperLevels();
+
+#ifdef _OPENMP
+#pragma omp parallel if (useThreads_)
+#endif
+        {
+            // L y = d, where L exhibits unit diagonal blocks
+            for (unsigned levelIdx = 0; levelIdx < numLowerLevels; ++levelIdx) {
+                int levelBegin = static_cast<int>(lowerLevelBegin_[levelIdx]);
+                int levelEnd = static_cast<int>(lowerLevelBegin_[levelIdx + 1]);
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+                for (int i = levelBegin; i < levelEnd; ++i) {
+                    unsigned rowIdx = lowerLevelRows_[static_cast<unsigned>(i)];
+                    const auto& row = ilu_[rowIdx];
+                    v[rowIdx] = d[rowIdx];
+                    Kernel::usmv(-1.0, row.begin(), row.find(rowIdx), v, v[rowIdx]);
+                }
+            }
+
+            // U v = y, where the inverses of the diagonal blocks of U are stored
+            for (unsigned levelIdx = 0; levelIdx < numUpperLevels; ++levelIdx) {
+                int levelBegin = static_cast<int>(upperLevelBegin_[levelIdx]);
+                int levelEnd = static_cast<int>(upperLevelBegin_[levelIdx + 1]);
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+                for (int i = levelBegin; i < levelEnd; ++i) {
+                    unsigned rowIdx = upperLevelRows_[static_cast<unsigned>(i)];
+                    const auto& row = ilu_[rowIdx];
+                    auto diagIt = row.find(rowIdx);
+                    const auto& diagBlock = *diagIt;
+
+                    RangeBlock rhs(v[rowIdx]);
+                    Kernel::usmv(-1.0, ++diagIt, row.end(), v, rhs);
+                    diagBlock.mv(rhs, v[rowIdx]);
+                }
+            }
+
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+            for (int rowIdx = 0; rowIdx < static_cast<int>(v.size()); ++rowIdx)
+                v[static_cast<unsigned>(rowIdx)] *= relaxationFactor_;
+        }
+    }
+
+    virtual void post(DomainVector& x OPM_UNUSED)
+    {}
+
+private:
+    // group the rows into the levels of the lower and of the upper triangular systems
+    void computeLevels_()
+    {
+        unsigned numRows = static_cast<unsigned>(ilu_.N());
+        std::vector<unsigned> rowLevel(numRows);
+
+        // the level of a row of L is one more than the maximum level of the rows
+        // which it depends on
+        for (unsigned rowIdx = 0; rowIdx < numRows; ++rowIdx) {
+            unsigned level = 0;
+            const auto& row = ilu_[rowIdx];
+            for (auto colIt = row.begin(); colIt.index() < rowIdx; ++colIt)
+                level = std::max(level, rowLevel[colIt.index()] + 1);
+            rowLevel[rowIdx] = level;
+        }
+        sortRowsByLevel_(rowLevel, lowerLevelRows_, lowerLevelBegin_);
+
+        // the same for U, but the rows depend on the ones with larger indices
+        for (unsigned rowIdx = numRows; rowIdx > 0; --rowIdx) {
+            unsigned level = 0;
+            const auto& row = ilu_[rowIdx - 1];
+            auto colIt = row.find(rowIdx - 1);
+            const auto& colEndIt = row.end();
+            for (++colIt; colIt != colEndIt; ++colIt)
+                level = std::max(level, rowLevel[colIt.index()] + 1);
+            rowLevel[rowIdx - 1] = level;
+        }
+        sortRowsByLevel_(rowLevel, upperLevelRows_, upperLevelBegin_);
+
+        // use the threads only if each of them gets a reasonable amount of work for
+        // each level. otherwise, use a single level which contains all rows in the
+        // order in which they can be processed sequentially.
+        unsigned numThreads = 1;
+#ifdef _OPENMP
+        numThreads = static_cast<unsigned>(std::max(1, omp_get_max_threads()));
+#endif
+        unsigned maxLevels = std::max(numLowerLevels(), numUpperLevels());
+        useThreads_ =
+            numThreads > 1
+            && numRows >= minRowsPerThreadAndLevel_*numThreads*maxLevels;
+        if (!useThreads_) {
+            lowerLevelBegin_.assign({0, numRows});
+            upperLevelBegin_.assign({0, numRows});
+            for (unsigned rowIdx = 0; rowIdx < numRows; ++rowIdx) {
+                lowerLevelRows_[rowIdx] = rowIdx;
+                upperLevelRows_[rowIdx] = numRows - 1 - rowIdx;
+            }
+        }
+    }
+
+    // a counting sort of the row indices by their level. within a level, the rows stay
+    // in ascending order, i.e., each thread processes contiguous chunks of memory.
+    static void sortRowsByLevel_(const std::vector<unsigned>& rowLevel,
+                                 std::vector<unsigned>& levelRows,
+                                 std::vector<unsigned>& levelBegin)
+    {
+        unsigned numLevels = 0;
+        for (unsigned rowIdx = 0; rowIdx < rowLevel.size(); ++rowIdx)
+            numLevels = std::max(numLevels, rowLevel[rowIdx] + 1);
+
+        levelBegin.assign(numLevels + 1, 0);
+        for (unsigned rowIdx = 0; rowIdx < rowLevel.size(); ++rowIdx)
+            ++levelBegin[rowLevel[rowIdx] + 1];
+        for (unsigned levelIdx = 0; levelIdx < numLevels; ++levelIdx)
+            levelBegin[levelIdx + 1] += levelBegin[levelIdx];
+
+        std::vector<unsigned> nextPos(levelBegin.begin(), levelBegin.end() - 1);
+        levelRows.resize(rowLevel.size());
+        for (unsigned rowIdx = 0; rowIdx < rowLevel.size(); ++rowIdx)
+            levelRows[nextPos[rowLevel[rowIdx]]++] = rowIdx;
+    }
+
+    // the minimum average number of rows per thread for each level which is required
+    // to solve the triangular systems in parallel
+    static const unsigned minRowsPerThreadAndLevel_ = 32;
+
+    Matrix ilu_;
+    field_type relaxationFactor_;
+    bool useThreads_;
+
+    // the row indices of the levels and the offsets of the levels within these arrays
+    std::vector<unsigned> lowerLevelRows_;
+    std::vector<unsigned> lowerLevelBegin_;
+    std::vector<unsigned> upperLevelRows_;
+    std::vector<unsigned> upperLevelBegin_;
+};
+
+} // namespace Linear
+} // namespace Ewoms
+
+#endif
@@ -0,0 +1,446 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \copydoc Ewoms::Linear::LocalEliminationBackend
+ */
+#ifndef EWOMS_LOCAL_ELIMINATION_BACKEND_HH
+#define EWOMS_LOCAL_ELIMINATION_BACKEND_HH
+
+#include <ewoms/common/parametersystem.hh>
+#include <ewoms/common/timer.hh>
+
+#include <opm/common/Unused.hpp>
+#include <opm/common/ErrorMacros.hpp>
+#include <opm/common/Exceptions.hpp>
+
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/bvector.hh>
+#include <dune/istl/operators.hh>
+#include <dune/istl/preconditioners.hh>
+#include <dune/istl/solvers.hh>
+#include <dune/common/fmatrix.hh>
+#include <dune/common/fvector.hh>
+
+#include <cmath>
+#include <vector>
+
+namespace Ewoms {
+namespace Properties {
+// forward declaration of the required property tags
+NEW_PROP_TAG(Scalar);
+NEW_PROP_TAG(NumEq);
+NEW_PROP_TAG(Simulator);
+NEW_PROP_TAG(JacobianMatrix);
+NEW_PROP_TAG(GlobalEqVector);
+NEW_PROP_TAG(LinearSolverTolerance);
+NEW_PROP_TAG(LinearSolverMaxIterations);
+NEW_PROP_TAG(LinearSolverVerbosity);
+NEW_PROP_TAG(LinearSolverBackend);
+
+//! The index of the first equation which only depends on the unknowns of its own
+//! degree of freedom
+NEW_PROP_TAG(LocalEliminationFirstEqIdx);
+
+//! The number of consecutive equations which only depend on the unknowns of their own
+//! degree of freedom
+NEW_PROP_TAG(LocalEliminationNumEq);
+
+NEW_TYPE_TAG(LocalEliminationLinearSolver);
+} // namespace Properties
+} // namespace Ewoms
+
+namespace Ewoms {
+namespace Linear {
+/*!
+ * \ingroup Linear
+ *
+ * \brief A linear solver backend which eliminates the equations that do not couple
+ *        degrees of freedom before the linear system is solved.
+ *
+ * Some models exhibit equations which only depend on the unknowns of the degree of
+ * freedom they belong to, e.g., the complementarity conditions of the NCP model. For
+ * each degree of freedom, such equations can be solved for the same number of
+ * unknowns. The unknowns are selected by pivoting on the local equations, so that a
+ * different set of unknowns may be eliminated for each degree of freedom. Substituting
+ * the result into the remaining equations yields a linear system which has the same
+ * sparsity pattern as the original one but smaller blocks. After this reduced system
+ * has been solved, the eliminated unknowns are recovered locally.
+ *
+ * The reduced system is solved by the BiCGSTAB solver of dune-istl, preconditioned by
+ * ILU(0). This backend only works for sequential runs.
+ */
+template <class TypeTag>
+class LocalEliminationBackend
+{
+    typedef typename GET_PROP_TYPE(TypeTag, Scalar) Scalar;
+    typedef typename GET_PROP_TYPE(TypeTag, Simulator) Simulator;
+    typedef typename GET_PROP_TYPE(TypeTag, JacobianMatrix) Matrix;
+    typedef typename GET_PROP_TYPE(TypeTag, GlobalEqVector) Vector;
+
+    enum { numEq = GET_PROP_VALUE(TypeTag, NumEq) };
+    enum { firstLocalEqIdx = GET_PROP_VALUE(TypeTag, LocalEliminationFirstEqIdx) };
+    enum { numLocalEq = GET_PROP_VALUE(TypeTag, LocalEliminationNumEq) };
+    enum { numReducedEq = numEq - numLocalEq };
+
+    static_assert(0 < numLocalEq && numLocalEq < numEq,
+                  "At least one equation must be eliminated and one must remain");
+    static_assert(0 <= firstLocalEqIdx && firstLocalEqIdx + numLocalEq <= numEq,
+                  "The eliminated equations must be a subset of the equations");
+
+    typedef Dune::FieldMatrix<Scalar, numReducedEq, numReducedEq> ReducedMatrixBlock;
+    typedef Dune::FieldVector<Scalar, numReducedEq> ReducedVectorBlock;
+    typedef Dune::BCRSMatrix<ReducedMatrixBlock> ReducedMatrix;
+    typedef Dune::BlockVector<ReducedVectorBlock> ReducedVector;
+
+    typedef Dune::FieldMatrix<Scalar, numLocalEq, numLocalEq> LocalMatrix;
+    typedef Dune::FieldMatrix<Scalar, numLocalEq, numReducedEq> CouplingMatrix;
+    typedef Dune::FieldVector<Scalar, numLocalEq> LocalVector;
+
+    // the result of eliminating the local equations of a degree of freedom: if x_E are
+    // the eliminated unknowns, x_K the kept ones and r the right hand side of the local
+    // equations, x_E = inverse*r - coupling*x_K
+    struct LocalElimination
+    {
+        unsigned char eliminatedIdx[numLocalEq];
+        unsigned char keptIdx[numReducedEq];
+        LocalMatrix inverse;
+        CouplingMatrix coupling;
+    };
+
+public:
+    LocalEliminationBackend(Simulator& simulator)
+        : simulator_(simulator)
+    {
+        tolerance_ = EWOMS_GET_PARAM(TypeTag, Scalar, LinearSolverTolerance);
+        M_ = 0;
+        b_ = 0;
+        lastIterations_ = 0;
+        matrixIsValid_ = false;
+    }
+
+    static void registerParameters()
+    {
+        EWOMS_REGISTER_PARAM(TypeTag, Scalar, LinearSolverTolerance,
+                             "The maximum allowed error between of the linear solver");
+        EWOMS_REGISTER_PARAM(TypeTag, int, LinearSolverMaxIterations,
+                             "The maximum number of iterations of the linear solver");
+        EWOMS_REGISTER_PARAM(TypeTag, int, LinearSolverVerbosity,
+                             "The verbosity level of the linear solver");
+    }
+
+    /*!
+     * \brief Causes the solve() method to discared the structure of the linear system of
+     *        equations the next time it is called.
+     */
+    void eraseMatrix()
+    { reducedMatrix_ = ReducedMatrix(); }
+
+    /*!
+     * \brief Set the factor by which the linear solver reduces the residual.
+     */
+    void setTolerance(Scalar value)
+    { tolerance_ = value; }
+
+    void prepareMatrix(const Matrix& M)
+    {
+        // the couplings which are not part of the matrix cannot be reduced
+        if (!simulator_.model().linearizer().schurCorrection().empty())
+            OPM_THROW(Opm::NotImplemented,
+                      "The local elimination backend does not support unknowns which are "
+                      "eliminated by auxiliary modules");
+        if (simulator_.gridView().comm().size() > 1)
+            OPM_THROW(Opm::NotImplemented,
+                      "The local elimination backend only supports sequential runs");
+
+        M_ = &M;
+
+        prepreTimer_.start();
+        matrixIsValid_ = eliminateLocalEquations_(M);
+        if (matrixIsValid_)
+            reduceMatrix_(M);
+        prepreTimer_.stop();
+    }
+
+    void prepareRhs(const Matrix& M OPM_UNUSED, Vector& b)
+    { b_ = &b; }
+
+    bool solve(Vector& x)
+    {
+        lastIterations_ = 0;
+        if (!matrixIsValid_)
+            return false;
+
+        const Matrix& M = *M_;
+        const Vector& b = *b_;
+        size_t numRows = M.N();
+
+        // the eliminated unknowns for x_K = 0
+        std::vector<LocalVector> g(numRows);
+        for (size_t rowIdx = 0; rowIdx < numRows; ++rowIdx) {
+            LocalVector r;
+            for (unsigned i = 0; i < numLocalEq; ++i)
+                r[i] = b[rowIdx][firstLocalEqIdx + i];
+            elims_[rowIdx].inverse.mv(r, g[rowIdx]);
+        }
+
+        // the right hand side of the reduced system
+        ReducedVector reducedB(numRows);
+        auto rowIt = M.begin();
+        const auto& rowEndIt = M.end();
+        for (; rowIt != rowEndIt; ++rowIt) {
+            size_t rowIdx = rowIt.index();
+            auto& rb = reducedB[rowIdx];
+            for (unsigned p = 0; p < numReducedEq; ++p)
+                rb[p] = b[rowIdx][reducedEqIdx_(p)];
+
+            auto colIt = rowIt->begin();
+            const auto& colEndIt = rowIt->end();
+            for (; colIt != colEndIt; ++colIt) {
+                size_t colIdx = colIt.index();
+                const auto& block = *colIt;
+                const LocalElimination& elim = elims_[colIdx];
+                for (unsigned p = 0; p < numReducedEq; ++p)
+                    for (unsigned e = 0; e < numLocalEq; ++e)
+                        rb[p] -= block[reducedEqIdx_(p)][elim.eliminatedIdx[e]]*g[colIdx][e];
+            }
+        }
+
+        // solve the reduced system
+        int verbosity = EWOMS_GET_PARAM(TypeTag, int, LinearSolverVerbosity);
+        int maxIterations = EWOMS_GET_PARAM(TypeTag, int, LinearSolverMaxIterations);
+        Dune::MatrixAdapter<ReducedMatrix, ReducedVector, ReducedVector> op(reducedMatrix_);
+        Dune::SeqILU0<ReducedMatrix, ReducedVector, ReducedVector> precond(reducedMatrix_, 1.0);
+        Dune::BiCGSTABSolver<ReducedVector> solver(op, precond, tolerance_, maxIterations,
+                                                   verbosity);
+
+        ReducedVector y(numRows);
+        y = 0.0;
+        Dune::InverseOperatorResult result;
+        solver.apply(y, reducedB, result);
+        lastIterations_ = static_cast<unsigned>(result.iterations);
+
+        // recover the full solution
+        Scalar sum = 0.0;
+        for (size_t rowIdx = 0; rowIdx < numRows; ++rowIdx) {
+            const LocalElimination& elim = elims_[rowIdx];
+            for (unsigned q = 0; q < numReducedEq; ++q)
+                x[rowIdx][elim.keptIdx[q]] = y[rowIdx][q];
+
+            for (unsigned e = 0; e < numLocalEq; ++e) {
+                Scalar xe = g[rowIdx][e];
+                for (unsigned q = 0; q < numReducedEq; ++q)
+                    xe -= elim.coupling[e][q]*y[rowIdx][q];
+                x[rowIdx][elim.eliminatedIdx[e]] = xe;
+            }
+
+            for (unsigned eqIdx = 0; eqIdx < numEq; ++eqIdx)
+                sum += x[rowIdx][eqIdx];
+        }
+
+        // make sure that the result only contains finite values.
+        return result.converged && std::isfinite(sum);
+    }
+
+    /*!
+     * \brief Solve the transposed linear system of equations.
+     *
+     * This is not supported because the elimination of the local equations of the
+     * transposed system would require different couplings.
+     */
+    bool solveTransposed(Vector& x OPM_UNUSED)
+    {
+        OPM_THROW(Opm::NotImplemented,
+                  "The local elimination backend cannot solve transposed systems");
+    }
+
+    /*!
+     * \brief Returns the number of iterations which were required by the last linear
+     *        solve.
+     */
+    unsigned lastIterations() const
+    { return lastIterations_; }
+
+    /*!
+     * \brief Returns the timer which accumulates the time spent for setting up the
+     *        preconditioners.
+     *
+     * This includes the time to reduce the linear system.
+     */
+    const Ewoms::Timer& preconditionerSetupTimer() const
+    { return prepreTimer_; }
+
+private:
+    // the index of an equation of the full system which is a row of the reduced system
+    static unsigned reducedEqIdx_(unsigned p)
+    { return (p < firstLocalEqIdx) ? p : p + numLocalEq; }
+
+    // eliminate the local equations of all degrees of freedom. returns false if the
+    // local equations are singular for any of them
+    bool eliminateLocalEquations_(const Matrix& M)
+    {
+        size_t numRows = M.N();
+        elims_.resize(numRows);
+        for (size_t rowIdx = 0; rowIdx < numRows; ++rowIdx) {
+            const auto& diag = M[rowIdx][rowIdx];
+            LocalElimination& elim = elims_[rowIdx];
+
+            // choose the unknowns which are eliminated by Gaussian elimination with
+            // complete pivoting on a copy of the local equations
+            Scalar A[numLocalEq][numEq];
+            for (unsigned i = 0; i < numLocalEq; ++i)
+                for (unsigned j = 0; j < numEq; ++j)
+                    A[i][j] = diag[firstLocalEqIdx + i][j];
+
+            bool isEliminated[numEq];
+            for (unsigned j = 0; j < numEq; ++j)
+                isEliminated[j] = false;
+
+            for (unsigned k = 0; k < numLocalEq; ++k) {
+                unsigned pivotRow = k;
+                unsigned pivotCol = 0;
+                Scalar pivot = -1.0;
+                for (unsigned i = k; i < numLocalEq; ++i) {
+                    for (unsigned j = 0; j < numEq; ++j) {
+                        if (!isEliminated[j] && std::abs(A[i][j]) > pivot) {
+                            pivot = std::abs(A[i][j]);
+                            pivotRow = i;
+                            pivotCol = j;
+                        }
+                    }
+                }
+                if (!(pivot > 0.0))
+                    return false;
+
+                for (unsigned j = 0; j < numEq; ++j)
+                    std::swap(A[k][j], A[pivotRow][j]);
+                isEliminated[pivotCol] = true;
+                elim.eliminatedIdx[k] = static_cast<unsigned char>(pivotCol);
+
+                for (unsigned i = k + 1; i < numLocalEq; ++i) {
+                    Scalar factor = A[i][pivotCol]/A[k][pivotCol];
+                    for (unsigned j = 0; j < numEq; ++j)
+                        A[i][j] -= factor*A[k][j];
+                }
+            }
+
+            unsigned q = 0;
+            for (unsigned j = 0; j < numEq; ++j)
+                if (!isEliminated[j])
+                    elim.keptIdx[q++] = static_cast<unsigned char>(j);
+
+            // compute the inverse of the local equations w.r.t. the eliminated unknowns
+            // and their couplings to the kept ones
+            LocalMatrix NE;
+            CouplingMatrix NK;
+            for (unsigned i = 0; i < numLocalEq; ++i) {
+                const auto& row = diag[firstLocalEqIdx + i];
+                for (unsigned e = 0; e < numLocalEq; ++e)
+                    NE[i][e] = row[elim.eliminatedIdx[e]];
+                for (unsigned k = 0; k < numReducedEq; ++k)
+                    NK[i][k] = row[elim.keptIdx[k]];
+            }
+
+            try {
+                NE.invert();
+            }
+            catch (const Dune::FMatrixError&) {
+                return false;
+            }
+            elim.inverse = NE;
+            elim.coupling = NE.rightmultiplyany(NK);
+        }
+
+        return true;
+    }
+
+    // compute the matrix of the reduced linear system
+    void reduceMatrix_(const Matrix& M)
+    {
+        size_t numRows = M.N();
+        if (reducedMatrix_.N() != numRows || reducedMatrix_.nonzeroes() != M.nonzeroes()) {
+            // the sparsity pattern is the same as of the full matrix
+            reducedMatrix_ = ReducedMatrix();
+            reducedMatrix_.setSize(numRows, M.M(), M.nonzeroes());
+            reducedMatrix_.setBuildMode(ReducedMatrix::row_wise);
+            auto createIt = reducedMatrix_.createbegin();
+            auto rowIt = M.begin();
+            for (; createIt != reducedMatrix_.createend(); ++createIt, ++rowIt) {
+                auto colIt = rowIt->begin();
+                const auto& colEndIt = rowIt->end();
+                for (; colIt != colEndIt; ++colIt)
+                    createIt.insert(colIt.index());
+            }
+        }
+
+        auto rowIt = M.begin();
+        const auto& rowEndIt = M.end();
+        for (; rowIt != rowEndIt; ++rowIt) {
+            size_t rowIdx = rowIt.index();
+            auto colIt = rowIt->begin();
+            const auto& colEndIt = rowIt->end();
+            for (; colIt != colEndIt; ++colIt) {
+                size_t colIdx = colIt.index();
+                const auto& block = *colIt;
+                const LocalElimination& elim = elims_[colIdx];
+                auto& dest = reducedMatrix_[rowIdx][colIdx];
+                for (unsigned p = 0; p < numReducedEq; ++p) {
+                    const auto& srcRow = block[reducedEqIdx_(p)];
+                    for (unsigned q = 0; q < numReducedEq; ++q) {
+                        Scalar value = srcRow[elim.keptIdx[q]];
+                        for (unsigned e = 0; e < numLocalEq; ++e)
+                            value -= srcRow[elim.eliminatedIdx[e]]*elim.coupling[e][q];
+                        dest[p][q] = value;
+                    }
+                }
+            }
+        }
+    }
+
+    const Simulator& simulator_;
+    const Matrix* M_;
+    Vector* b_;
+
+    std::vector<LocalElimination> elims_;
+    ReducedMatrix reducedMatrix_;
+    bool matrixIsValid_;
+
+    Scalar tolerance_;
+    unsigned lastIterations_;
+    Ewoms::Timer prepreTimer_;
+};
+
+} // namespace Linear
+} // namespace Ewoms
+
+namespace Ewoms {
+namespace Properties {
+SET_INT_PROP(LocalEliminationLinearSolver, LinearSolverVerbosity, 0);
+SET_INT_PROP(LocalEliminationLinearSolver, LinearSolverMaxIterations, 1000);
+SET_TYPE_PROP(LocalEliminationLinearSolver, LinearSolverBackend,
+              Ewoms::Linear::LocalEliminationBackend<TypeTag>);
+} // namespace Properties
+} // namespace Ewoms
+
+#endif
@@ -0,0 +1,145 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \copydoc Ewoms::Linear::MatrixFreeOverlappingOperator
+ */
+#ifndef EWOMS_MATRIX_FREE_OVERLAPPING_OPERATOR_HH
+#define EWOMS_MATRIX_FREE_OVERLAPPING_OPERATOR_HH
+
+#include "overlappingoperator.hh"
+#include "overlaptypes.hh"
+
+namespace Ewoms {
+namespace Linear {
+
+/*!
+ * \brief An overlap aware linear operator which approximates the product of the
+ *        Jacobian matrix with a vector by a finite difference of the residual.
+ *
+ * Instead of multiplying with the overlapping matrix, the operator evaluates
+ * \f$(R(u + \epsilon x) - R(u))/\epsilon\f$, i.e., the linear system is solved for the
+ * exact derivatives of the current residual while the overlapping matrix can be an
+ * approximation which is only used to build the preconditioner (e.g. the Jacobian of an
+ * earlier Newton iteration). The matrix is still returned by getmat().
+ *
+ * The residuals are evaluated by the NativeSystem object for the native degrees of
+ * freedom. It must provide the following methods:
+ *
+ * - field_type perturbedResidual(NativeVector& dest, const NativeVector& direction):
+ *   Evaluate the residual of the native system for the current solution plus a
+ *   multiple of the given direction and return the multiple. This is a collective
+ *   operation
+ * - field_type rowScaling(unsigned nativeRowIdx, unsigned eqIdx): The factor by which
+ *   the row has been scaled when the native system was copied to the overlapping one
+ *
+ * The residual of the unperturbed solution is the (scaled) right hand side of the
+ * overlapping linear system, which thus needs to be passed to the constructor.
+ */
+template <class OverlappingMatrix, class DomainVector, class RangeVector, class NativeSystem>
+class MatrixFreeOverlappingOperator
+    : public OverlappingOperator<OverlappingMatrix, DomainVector, RangeVector>
+{
+    typedef OverlappingOperator<OverlappingMatrix, DomainVector, RangeVector> ParentType;
+    typedef typename OverlappingMatrix::Overlap Overlap;
+    typedef typename NativeSystem::NativeVector NativeVector;
+
+    static constexpr int numEq = DomainVector::block_type::dimension;
+
+public:
+    typedef typename ParentType::field_type field_type;
+
+    MatrixFreeOverlappingOperator(const OverlappingMatrix& A,
+                                  const RangeVector& baseResidual,
+                                  const NativeSystem& nativeSystem)
+        : ParentType(A)
+        , baseResidual_(baseResidual)
+        , nativeSystem_(nativeSystem)
+        , tmp_(baseResidual)
+    { }
+
+    //! apply operator to x:  \f$ y = A(x) \f$
+    virtual void apply(const DomainVector& x, RangeVector& y) const
+    {
+        const Overlap& overlap = this->overlap();
+
+        // the direction of the perturbation for all native indices. entries of the
+        // native system which are not local are represented by the domestic entries of
+        // their master process
+        size_t numNative = overlap.numNative();
+        nativeDirection_.resize(numNative);
+        for (unsigned nativeIdx = 0; nativeIdx < numNative; ++nativeIdx) {
+            Index domIdx = overlap.nativeToDomestic(static_cast<Index>(nativeIdx));
+            if (domIdx < 0)
+                domIdx = overlap.blackList().nativeToDomestic(static_cast<Index>(nativeIdx));
+
+            if (domIdx < 0)
+                nativeDirection_[nativeIdx] = 0.0;
+            else
+                for (unsigned eqIdx = 0; eqIdx < numEq; ++eqIdx)
+                    nativeDirection_[nativeIdx][eqIdx] = x[static_cast<unsigned>(domIdx)][eqIdx];
+        }
+
+        field_type eps = nativeSystem_.perturbedResidual(nativeResidual_, nativeDirection_);
+        if (eps == 0.0) {
+            y = 0.0;
+            return;
+        }
+
+        // convert the residual to the overlapping system in the same way as the right
+        // hand side, i.e., add up the border entries and scale the rows
+        y.assignAddBorder(nativeResidual_);
+        for (unsigned domIdx = 0; domIdx < overlap.numLocal(); ++domIdx) {
+            Index nativeIdx = overlap.domesticToNative(static_cast<Index>(domIdx));
+            for (unsigned eqIdx = 0; eqIdx < numEq; ++eqIdx)
+                y[domIdx][eqIdx] *= nativeSystem_.rowScaling(static_cast<unsigned>(nativeIdx),
+                                                             eqIdx);
+        }
+        y.sync();
+
+        y -= baseResidual_;
+        y /= eps;
+    }
+
+    //! apply operator to x, scale and add:  \f$ y = y + \alpha A(x) \f$
+    virtual void applyscaleadd(field_type alpha, const DomainVector& x,
+                               RangeVector& y) const
+    {
+        apply(x, tmp_);
+        y.axpy(alpha, tmp_);
+    }
+
+private:
+    const RangeVector baseResidual_;
+    NativeSystem nativeSystem_;
+
+    mutable NativeVector nativeDirection_;
+    mutable NativeVector nativeResidual_;
+    mutable RangeVector tmp_;
+};
+
+} // namespace Linear
+} // namespace Ewoms
+
+#endif
@@ -0,0 +1,176 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ * \copydoc Ewoms::Linear::MixedPrecisionPreconditioner
+ */
+#ifndef EWOMS_MIXED_PRECISION_PRECONDITIONER_HH
+#define EWOMS_MIXED_PRECISION_PRECONDITIONER_HH
+
+#include <dune/istl/preconditioner.hh>
+#include <dune/istl/bcrsmatrix.hh>
+
+#include <memory>
+
+namespace Ewoms {
+namespace Linear {
+
+/*!
+ * \ingroup Linear
+ *
+ * \brief Copy a block matrix into a matrix which uses a different field type.
+ *
+ * The destination matrix must not have been built yet, i.e., its sparsity pattern is
+ * created from the one of the source matrix.
+ */
+template <class DestMatrix, class SrcMatrix>
+void copyMatrixToPrecision(DestMatrix& dest, const SrcMatrix& src)
+{
+    typedef typename DestMatrix::field_type DestScalar;
+
+    dest.setSize(src.N(), src.M(), src.nonzeroes());
+    dest.setBuildMode(DestMatrix::row_wise);
+
+    auto srcRowIt = src.begin();
+    for (auto destRowIt = dest.createbegin(); destRowIt != dest.createend(); ++destRowIt, ++srcRowIt) {
+        const auto& colEndIt = srcRowIt->end();
+        for (auto colIt = srcRowIt->begin(); colIt != colEndIt; ++colIt)
+            destRowIt.insert(colIt.index());
+    }
+
+    copyMatrixValuesToPrecision(dest, src);
+}
+
+/*!
+ * \ingroup Linear
+ *
+ * \brief Copy the entries of a block matrix into a matrix which uses a different field
+ *        type and which exhibits the same sparsity pattern.
+ */
+template <class DestMatrix, class SrcMatrix>
+void copyMatrixValuesToPrecision(DestMatrix& dest, const SrcMatrix& src)
+{
+    typedef typename DestMatrix::field_type DestScalar;
+
+    auto destRowIt = dest.begin();
+    const auto& srcRowEndIt = src.end();
+    for (auto srcRowIt = src.begin(); srcRowIt != srcRowEndIt; ++srcRowIt, ++destRowIt) {
+        auto destColIt = destRowIt->begin();
+        const auto& srcColEndIt = srcRowIt->end();
+        for (auto srcColIt = srcRowIt->begin(); srcColIt != srcColEndIt; ++srcColIt, ++destColIt) {
+            const auto& srcBlock = *srcColIt;
+            auto& destBlock = *destColIt;
+            for (unsigned i = 0; i < srcBlock.rows; ++i)
+                for (unsigned j = 0; j < srcBlock.cols; ++j)
+                    destBlock[i][j] = static_cast<DestScalar>(srcBlock[i][j]);
+        }
+    }
+}
+
+/*!
+ * \ingroup Linear
+ *
+ * \brief Applies a preconditioner which operates on vectors of a lower precision to
+ *        the vectors of the linear solver.
+ *
+ * This allows to store the data of a preconditioner (e.g., the incomplete LU factors
+ * or an AMG hierarchy) in single precision while the iterations of the linear solver
+ * are still done using double precision. Since the application of preconditioners is
+ * usually bound by the memory bandwidth, this roughly halves the cost of each
+ * application. The defect and the correction are converted from and to the precision
+ * of the linear solver by each call.
+ */
+template <class LowPrecisionPreconditioner, class DomainVector, class RangeVector>
+class MixedPrecisionPreconditioner : public Dune::Preconditioner<DomainVector, RangeVector>
+{
+    typedef typename LowPrecisionPreconditioner::domain_type LowPrecisionDomainVector;
+    typedef typename LowPrecisionPreconditioner::range_type LowPrecisionRangeVector;
+
+public:
+    //! export types
+    typedef DomainVector domain_type;
+    typedef RangeVector range_type;
+    typedef typename DomainVector::field_type field_type;
+
+    enum { category = LowPrecisionPreconditioner::category };
+
+    MixedPrecisionPreconditioner(std::shared_ptr<LowPrecisionPreconditioner> lowPrecisionPreCond)
+        : lowPrecisionPreCond_(lowPrecisionPreCond)
+    { }
+
+    /*!
+     * \brief Returns the preconditioner which operates on the low-precision vectors.
+     */
+    LowPrecisionPreconditioner& lowPrecisionPreconditioner()
+    { return *lowPrecisionPreCond_; }
+
+    virtual void pre(DomainVector& x, RangeVector& b)
+    {
+        copyVector_(lowPrecisionX_, x);
+        copyVector_(lowPrecisionB_, b);
+        lowPrecisionPreCond_->pre(lowPrecisionX_, lowPrecisionB_);
+        copyVector_(x, lowPrecisionX_);
+        copyVector_(b, lowPrecisionB_);
+    }
+
+    virtual void apply(DomainVector& v, const RangeVector& d)
+    {
+        copyVector_(lowPrecisionB_, d);
+        if (lowPrecisionX_.size() != v.size())
+            lowPrecisionX_.resize(v.size());
+        lowPrecisionX_ = 0.0;
+        lowPrecisionPreCond_->apply(lowPrecisionX_, lowPrecisionB_);
+        copyVector_(v, lowPrecisionX_);
+    }
+
+    virtual void post(DomainVector& x)
+    {
+        copyVector_(lowPrecisionX_, x);
+        lowPrecisionPreCond_->post(lowPrecisionX_);
+        copyVector_(x, lowPrecisionX_);
+    }
+
+private:
+    template <class DestVector, class SrcVector>
+    static void copyVector_(DestVector& dest, const SrcVector& src)
+    {
+        typedef typename DestVector::field_type DestScalar;
+
+        if (dest.size() != src.size())
+            dest.resize(src.size());
+
+        size_t n = src.size();
+        for (size_t i = 0; i < n; ++i)
+            for (unsigned j = 0; j < src[i].size(); ++j)
+                dest[i][j] = static_cast<DestScalar>(src[i][j]);
+    }
+
+    std::shared_ptr<LowPrecisionPreconditioner> lowPrecisionPreCond_;
+    LowPrecisionDomainVector lowPrecisionX_;
+    LowPrecisionRangeVector lowPrecisionB_;
+};
+
+} // namespace Linear
+} // namespace Ewoms
+
+#endif
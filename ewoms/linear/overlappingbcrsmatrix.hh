@@ -33,6 +33,7 @@
 #include <ewoms/parallel/mpibuffer.hh>
 
 #include <opm/common/Valgrind.hpp>
+#include <opm/common/Unused.hpp>
 
 #include <dune/istl/scalarproducts.hh>
 #include <dune/istl/io.hh>
@@ -43,6 +44,7 @@
 #include <iostream>
 #include <vector>
 #include <memory>
+#include <unordered_set>
 
 namespace Ewoms {
 namespace Linear {
@@ -70,18 +72,43 @@ public:
     // no real copying done at the moment
     OverlappingBCRSMatrix(const OverlappingBCRSMatrix& other)
         : ParentType(other)
-    {}
+    {
+        nativeEntriesNumRows_ = 0;
+        nativeEntriesNumNonZeros_ = 0;
+    }
 
     template <class NativeBCRSMatrix>
     OverlappingBCRSMatrix(const NativeBCRSMatrix& nativeMatrix,
                           const BorderList& borderList,
                           const BlackList& blackList,
-                          unsigned overlapSize)
+                          unsigned overlapSize,
+                          MpiCommunicator comm = defaultMpiCommunicator())
+        : OverlappingBCRSMatrix(nativeMatrix,
+                                std::make_shared<Overlap>(nativeMatrix,
+                                                          borderList,
+                                                          blackList,
+                                                          overlapSize,
+                                                          comm))
+    {}
+
+    /*!
+     * \brief Create an overlapping matrix using an existing overlap.
+     *
+     * The overlap must have been created for a native matrix which exhibits the same
+     * sparsity pattern as the one which is passed here. This allows to avoid the
+     * communication which is required to determine the overlap if the sparsity pattern
+     * of the linear system does not change.
+     */
+    template <class NativeBCRSMatrix>
+    OverlappingBCRSMatrix(const NativeBCRSMatrix& nativeMatrix,
+                          std::shared_ptr<Overlap> overlap)
     {
-        overlap_ = std::make_shared<Overlap>(nativeMatrix, borderList, blackList, overlapSize);
+        overlap_ = overlap;
         myRank_ = 0;
+        nativeEntriesNumRows_ = 0;
+        nativeEntriesNumNonZeros_ = 0;
 #if HAVE_MPI
-        MPI_Comm_rank(MPI_COMM_WORLD, &myRank_);
+        MPI_Comm_rank(overlap_->communicator(), &myRank_);
 #endif // HAVE_MPI
 
         // build the overlapping matrix from the non-overlapping
@@ -213,43 +240,49 @@ public:
 
     template <class NativeBCRSMatrix>
     void assignFromNative(const NativeBCRSMatrix& nativeMatrix)
+    { assignFromNative(nativeMatrix, UnitRowScaling_()); }
+
+    /*!
+     * \brief Copy the domestic entries of a non-overlapping matrix and scale its rows.
+     *
+     * The entries of row i of the block in native row r are multiplied by
+     * rowScaling(r, i). This avoids a second pass over the matrix if the linear system
+     * needs to be scaled. The native matrix must exhibit the same sparsity pattern as
+     * the one used to construct the overlapping matrix.
+     */
+    template <class NativeBCRSMatrix, class RowScaling>
+    void assignFromNative(const NativeBCRSMatrix& nativeMatrix, const RowScaling& rowScaling)
     {
-        // first, set everything to 0,
-        BCRSMatrix::operator=(0.0);
+        updateNativeEntries_(nativeMatrix);
 
-        // then copy the domestic entries of the native matrix to the overlapping matrix
-        for (unsigned nativeRowIdx = 0; nativeRowIdx < nativeMatrix.N(); ++nativeRowIdx) {
-            Index domesticRowIdx = overlap_->nativeToDomestic(static_cast<Index>(nativeRowIdx));
-            if (domesticRowIdx < 0) {
-                continue; // row corresponds to a black-listed entry
-            }
+        // the entries which do not correspond to any native one, i.e., the overlap,
+        // are set to zero. all others are overwritten below.
+        for (block_type* entry : unassignedEntries_)
+            *entry = 0.0;
 
+        // the rows of the native matrix are written to disjoint domestic rows
+        int numNativeRows = static_cast<int>(nativeMatrix.N());
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+        for (int i = 0; i < numNativeRows; ++i) {
+            unsigned nativeRowIdx = static_cast<unsigned>(i);
+            size_t entryIdx = nativeRowOffsets_[nativeRowIdx];
             auto nativeColIt = nativeMatrix[nativeRowIdx].begin();
             const auto& nativeColEndIt = nativeMatrix[nativeRowIdx].end();
-            for (; nativeColIt != nativeColEndIt; ++nativeColIt) {
-                Index domesticColIdx = overlap_->nativeToDomestic(static_cast<Index>(nativeColIt.index()));
-
-                // make sure to include all off-diagonal entries, even those which belong
-                // to DOFs which are managed by a peer process. For this, we have to
-                // re-map the column index of the black-listed index to a native one.
-                if (domesticColIdx < 0)
-                    domesticColIdx = overlap_->blackList().nativeToDomestic(static_cast<Index>(nativeColIt.index()));
-
-                if (domesticColIdx < 0)
-                    // there is no domestic index which corresponds to a black-listed
-                    // one. this can happen if the grid overlap is larger than the
-                    // algebraic one...
+            for (; nativeColIt != nativeColEndIt; ++nativeColIt, ++entryIdx) {
+                block_type* dest = nativeEntries_[entryIdx];
+                if (!dest)
                     continue;
 
                 // we need to copy the block matrices manually since it seems that (at
                 // least some versions of) Dune have an endless recursion bug when
                 // assigning dense matrices of different field type
                 const auto& src = *nativeColIt;
-                auto& dest = (*this)[static_cast<unsigned>(domesticRowIdx)][static_cast<unsigned>(domesticColIdx)];
-                for (unsigned i = 0; i < src.rows; ++i) {
-                    for (unsigned j = 0; j < src.cols; ++j) {
-                        dest[i][j] = static_cast<field_type>(src[i][j]);
-                    }
+                for (unsigned rowIdx = 0; rowIdx < src.rows; ++rowIdx) {
+                    field_type alpha = static_cast<field_type>(rowScaling(nativeRowIdx, rowIdx));
+                    for (unsigned colIdx = 0; colIdx < src.cols; ++colIdx)
+                        (*dest)[rowIdx][colIdx] = alpha*static_cast<field_type>(src[rowIdx][colIdx]);
                 }
             }
         }
@@ -258,65 +291,155 @@ public:
     // communicates and adds up the contents of overlapping rows
     void syncAdd()
     {
-        // first, send all entries to the peers
+        startSync();
+        finishSyncAdd();
+    }
+
+    // communicates and copies the contents of overlapping rows from
+    // the master
+    void syncCopy()
+    {
+        startSync();
+        finishSyncCopy();
+    }
+
+    /*!
+     * \brief Start to exchange the entries of the overlapping rows with the peer
+     *        ranks.
+     *
+     * The entries which are required by the peers are copied into the send buffers
+     * immediately, so the matrix may be modified until the exchange is completed by
+     * finishSyncAdd() or finishSyncCopy().
+     */
+    void startSync()
+    {
         const PeerSet& peerSet = overlap_->peerSet();
         typename PeerSet::const_iterator peerIt = peerSet.begin();
         typename PeerSet::const_iterator peerEndIt = peerSet.end();
-        for (; peerIt != peerEndIt; ++peerIt) {
-            ProcessRank peerRank = *peerIt;
 
-            sendEntries_(peerRank);
-        }
-
-        // then, receive entries from the peers
-        peerIt = peerSet.begin();
+        // first, post the receive operations for the entries of the peers
         for (; peerIt != peerEndIt; ++peerIt) {
             ProcessRank peerRank = *peerIt;
 
-            receiveAddEntries_(peerRank);
+            startReceiveEntries_(peerRank);
         }
 
-        // finally, make sure that everything which we send was
-        // received by the peers
+        // then, send all entries to the peers
         peerIt = peerSet.begin();
         for (; peerIt != peerEndIt; ++peerIt) {
             ProcessRank peerRank = *peerIt;
-            entryValuesSendBuff_[peerRank]->wait();
+
+            sendEntries_(peerRank);
         }
     }
 
-    // communicates and copies the contents of overlapping rows from
-    // the master
-    void syncCopy()
+    /*!
+     * \brief Finish an exchange started by startSync() by adding up the contents of
+     *        the overlapping rows.
+     */
+    void finishSyncAdd()
     {
-        // first, send all entries to the peers
         const PeerSet& peerSet = overlap_->peerSet();
         typename PeerSet::const_iterator peerIt = peerSet.begin();
         typename PeerSet::const_iterator peerEndIt = peerSet.end();
         for (; peerIt != peerEndIt; ++peerIt) {
             ProcessRank peerRank = *peerIt;
 
-            sendEntries_(peerRank);
+            receiveAddEntries_(peerRank);
         }
 
-        // then, receive entries from the peers
-        peerIt = peerSet.begin();
+        waitSendFinished_();
+    }
+
+    /*!
+     * \brief Finish an exchange started by startSync() by copying the contents of the
+     *        overlapping rows from their master.
+     */
+    void finishSyncCopy()
+    {
+        const PeerSet& peerSet = overlap_->peerSet();
+        typename PeerSet::const_iterator peerIt = peerSet.begin();
+        typename PeerSet::const_iterator peerEndIt = peerSet.end();
         for (; peerIt != peerEndIt; ++peerIt) {
             ProcessRank peerRank = *peerIt;
 
             receiveCopyEntries_(peerRank);
         }
 
-        // finally, make sure that everything which we send was
-        // received by the peers
-        peerIt = peerSet.begin();
-        for (; peerIt != peerEndIt; ++peerIt) {
-            ProcessRank peerRank = *peerIt;
-            entryValuesSendBuff_[peerRank]->wait();
-        }
+        waitSendFinished_();
     }
 
 private:
+    struct UnitRowScaling_
+    {
+        field_type operator()(unsigned nativeRowIdx OPM_UNUSED, unsigned rowIdx OPM_UNUSED) const
+        { return 1.0; }
+    };
+
+    // determine the overlapping entry which corresponds to each entry of a native
+    // matrix. this is only done once for a given sparsity pattern, so the copying in
+    // assignFromNative() does not need to search for the entries.
+    template <class NativeBCRSMatrix>
+    void updateNativeEntries_(const NativeBCRSMatrix& nativeMatrix)
+    {
+        if (nativeEntriesNumRows_ == nativeMatrix.N()
+            && nativeEntriesNumNonZeros_ == nativeMatrix.nonzeroes())
+            return;
+
+        nativeRowOffsets_.resize(nativeMatrix.N() + 1);
+        nativeEntries_.clear();
+        nativeEntries_.reserve(nativeMatrix.nonzeroes());
+        std::unordered_set<const block_type*> assignedEntries;
+        for (unsigned nativeRowIdx = 0; nativeRowIdx < nativeMatrix.N(); ++nativeRowIdx) {
+            nativeRowOffsets_[nativeRowIdx] = nativeEntries_.size();
+            Index domesticRowIdx = overlap_->nativeToDomestic(static_cast<Index>(nativeRowIdx));
+
+            auto nativeColIt = nativeMatrix[nativeRowIdx].begin();
+            const auto& nativeColEndIt = nativeMatrix[nativeRowIdx].end();
+            for (; nativeColIt != nativeColEndIt; ++nativeColIt) {
+                if (domesticRowIdx < 0) {
+                    // row corresponds to a black-listed entry
+                    nativeEntries_.push_back(nullptr);
+                    continue;
+                }
+
+                Index domesticColIdx = overlap_->nativeToDomestic(static_cast<Index>(nativeColIt.index()));
+
+                // make sure to include all off-diagonal entries, even those which belong
+                // to DOFs which are managed by a peer process. For this, we have to
+                // re-map the column index of the black-listed index to a native one.
+                if (domesticColIdx < 0)
+                    domesticColIdx = overlap_->blackList().nativeToDomestic(static_cast<Index>(nativeColIt.index()));
+
+                if (domesticColIdx < 0) {
+                    // there is no domestic index which corresponds to a black-listed
+                    // one. this can happen if the grid overlap is larger than the
+                    // algebraic one...
+                    nativeEntries_.push_back(nullptr);
+                    continue;
+                }
+
+                block_type* dest =
+                    &(*this)[static_cast<unsigned>(domesticRowIdx)][static_cast<unsigned>(domesticColIdx)];
+                nativeEntries_.push_back(dest);
+                assignedEntries.insert(dest);
+            }
+        }
+        nativeRowOffsets_[nativeMatrix.N()] = nativeEntries_.size();
+
+        unassignedEntries_.clear();
+        for (auto rowIt = this->begin(); rowIt != this->end(); ++rowIt) {
+            for (auto colIt = rowIt->begin(); colIt != rowIt->end(); ++colIt) {
+                block_type* entry = &(*colIt);
+                if (assignedEntries.count(entry) == 0)
+                    unassignedEntries_.push_back(entry);
+            }
+        }
+
+        nativeEntriesNumRows_ = nativeMatrix.N();
+        nativeEntriesNumNonZeros_ = nativeMatrix.nonzeroes();
+    }
+
     template <class NativeBCRSMatrix>
     void build_(const NativeBCRSMatrix& nativeMatrix)
     {
@@ -447,25 +570,25 @@ private:
 #if HAVE_MPI
         // send size of foreign overlap to peer
         size_t numOverlapRows = overlap_->foreignOverlapSize(peerRank);
-        numRowsSendBuff_[peerRank] = new MpiBuffer<unsigned>(1);
+        numRowsSendBuff_[peerRank] = new MpiBuffer<unsigned>(1, overlap_->communicator());
         (*numRowsSendBuff_[peerRank])[0] = static_cast<unsigned>(numOverlapRows);
         numRowsSendBuff_[peerRank]->send(peerRank);
 
         // allocate the buffers which hold the global indices of each row and the number
         // of entries which need to be communicated by the respective row
-        rowIndicesSendBuff_[peerRank] = new MpiBuffer<Index>(numOverlapRows);
-        rowSizesSendBuff_[peerRank] = new MpiBuffer<unsigned>(numOverlapRows);
+        rowIndicesSendBuff_[peerRank] = new MpiBuffer<GlobalIndex>(numOverlapRows, overlap_->communicator());
+        rowSizesSendBuff_[peerRank] = new MpiBuffer<unsigned>(numOverlapRows, overlap_->communicator());
 
         // compute the sets of the indices of the entries which need to be send to the peer
-        typedef std::set<int> ColumnIndexSet;
-        typedef std::map<int, ColumnIndexSet> EntryTuples;
+        typedef std::set<GlobalIndex> ColumnIndexSet;
+        typedef std::map<GlobalIndex, ColumnIndexSet> EntryTuples;
 
         EntryTuples entryIndices;
         unsigned numEntries = 0; // <- total number of matrix entries to be send to the peer
         for (unsigned overlapOffset = 0; overlapOffset < numOverlapRows; ++overlapOffset) {
             Index domesticRowIdx = overlap_->foreignOverlapOffsetToDomesticIdx(peerRank, overlapOffset);
             Index nativeRowIdx = overlap_->domesticToNative(domesticRowIdx);
-            Index globalRowIdx = overlap_->domesticToGlobal(domesticRowIdx);
+            GlobalIndex globalRowIdx = overlap_->domesticToGlobal(domesticRowIdx);
 
             ColumnIndexSet& colIndices = entryIndices[globalRowIdx];
 
@@ -486,18 +609,18 @@ private:
                     // entry.
                     continue;
 
-                Index globalColIdx = overlap_->domesticToGlobal(domesticColIdx);
+                GlobalIndex globalColIdx = overlap_->domesticToGlobal(domesticColIdx);
                 colIndices.insert(globalColIdx);
                 ++numEntries;
             }
         };
 
         // fill the send buffers
-        entryColIndicesSendBuff_[peerRank] = new MpiBuffer<Index>(numEntries);
+        entryColIndicesSendBuff_[peerRank] = new MpiBuffer<GlobalIndex>(numEntries, overlap_->communicator());
         Index overlapEntryIdx = 0;
         for (unsigned overlapOffset = 0; overlapOffset < numOverlapRows; ++overlapOffset) {
             Index domesticRowIdx = overlap_->foreignOverlapOffsetToDomesticIdx(peerRank, overlapOffset);
-            Index globalRowIdx = overlap_->domesticToGlobal(domesticRowIdx);
+            GlobalIndex globalRowIdx = overlap_->domesticToGlobal(domesticRowIdx);
 
             (*rowIndicesSendBuff_[peerRank])[overlapOffset] = globalRowIdx;
 
@@ -505,7 +628,7 @@ private:
             auto* rssb = rowSizesSendBuff_[peerRank];
             (*rssb)[overlapOffset] = static_cast<unsigned>(colIndexSet.size());
             for (auto it = colIndexSet.begin(); it != colIndexSet.end(); ++it) {
-                int globalColIdx = *it;
+                GlobalIndex globalColIdx = *it;
 
                 (*entryColIndicesSendBuff_[peerRank])[static_cast<unsigned>(overlapEntryIdx)] = globalColIdx;
                 ++ overlapEntryIdx;
@@ -519,7 +642,8 @@ private:
 
         // create the send buffers for the values of the matrix
         // entries
-        entryValuesSendBuff_[peerRank] = new MpiBuffer<block_type>(numEntries);
+        entryValuesSendBuff_[peerRank] = new MpiBuffer<block_type>(numEntries, overlap_->communicator());
+        entryValuesSendBuff_[peerRank]->initPersistentSend(peerRank);
 #endif // HAVE_MPI
     }
 
@@ -530,14 +654,15 @@ private:
         // receive size of foreign overlap to peer
         unsigned numOverlapRows;
         auto& numRowsRecvBuff = numRowsRecvBuff_[peerRank];
+        numRowsRecvBuff.setCommunicator(overlap_->communicator());
         numRowsRecvBuff.resize(1);
         numRowsRecvBuff.receive(peerRank);
         numOverlapRows = numRowsRecvBuff[0];
 
         // create receive buffer for the row sizes and receive them
         // from the peer
-        rowSizesRecvBuff_[peerRank] = new MpiBuffer<unsigned>(numOverlapRows);
-        rowIndicesRecvBuff_[peerRank] = new MpiBuffer<Index>(numOverlapRows);
+        rowSizesRecvBuff_[peerRank] = new MpiBuffer<unsigned>(numOverlapRows, overlap_->communicator());
+        rowIndicesRecvBuff_[peerRank] = new MpiBuffer<GlobalIndex>(numOverlapRows, overlap_->communicator());
         rowSizesRecvBuff_[peerRank]->receive(peerRank);
         rowIndicesRecvBuff_[peerRank]->receive(peerRank);
 
@@ -548,8 +673,9 @@ private:
             totalIndices += (*rowSizesRecvBuff_[peerRank])[i];
 
         // create the buffer to store the column indices of the matrix entries
-        entryColIndicesRecvBuff_[peerRank] = new MpiBuffer<Index>(totalIndices);
-        entryValuesRecvBuff_[peerRank] = new MpiBuffer<block_type>(totalIndices);
+        entryColIndicesRecvBuff_[peerRank] = new MpiBuffer<GlobalIndex>(totalIndices, overlap_->communicator());
+        entryValuesRecvBuff_[peerRank] = new MpiBuffer<block_type>(totalIndices, overlap_->communicator());
+        entryValuesRecvBuff_[peerRank]->initPersistentReceive(peerRank);
 
         // communicate with the peer
         entryColIndicesRecvBuff_[peerRank]->receive(peerRank);
@@ -562,9 +688,9 @@ private:
         // add the entries to the global entry map
         unsigned k = 0;
         for (unsigned i = 0; i < numOverlapRows; ++i) {
-            Index domRowIdx = (*rowIndicesRecvBuff_[peerRank])[i];
+            Index domRowIdx = static_cast<Index>((*rowIndicesRecvBuff_[peerRank])[i]);
             for (unsigned j = 0; j < (*rowSizesRecvBuff_[peerRank])[i]; ++j) {
-                Index domColIdx = (*entryColIndicesRecvBuff_[peerRank])[k];
+                Index domColIdx = static_cast<Index>((*entryColIndicesRecvBuff_[peerRank])[k]);
                 entries_[static_cast<unsigned>(domRowIdx)].insert(domColIdx);
                 ++k;
             }
@@ -584,12 +710,12 @@ private:
         // fill the send buffer
         unsigned k = 0;
         for (unsigned i = 0; i < mpiRowIndicesSendBuff.size(); ++i) {
-            Index domRowIdx = mpiRowIndicesSendBuff[i];
+            Index domRowIdx = static_cast<Index>(mpiRowIndicesSendBuff[i]);
 
             for (Index j = 0; j < static_cast<Index>(mpiRowSizesSendBuff[i]); ++j)
             {
                 // move to the next column which is in the overlap
-                Index domColIdx = mpiColIndicesSendBuff[k];
+                Index domColIdx = static_cast<Index>(mpiColIndicesSendBuff[k]);
 
                 // add the values of this column to the send buffer
                 mpiSendBuff[k] = (*this)[static_cast<unsigned>(domRowIdx)][static_cast<unsigned>(domColIdx)];
@@ -597,7 +723,28 @@ private:
             }
         }
 
-        mpiSendBuff.send(peerRank);
+        mpiSendBuff.start();
+#endif // HAVE_MPI
+    }
+
+    void startReceiveEntries_(ProcessRank peerRank)
+    {
+#if HAVE_MPI
+        entryValuesRecvBuff_[peerRank]->start();
+#endif // HAVE_MPI
+    }
+
+    // make sure that everything which we send was received by the peers
+    void waitSendFinished_()
+    {
+#if HAVE_MPI
+        const PeerSet& peerSet = overlap_->peerSet();
+        typename PeerSet::const_iterator peerIt = peerSet.begin();
+        typename PeerSet::const_iterator peerEndIt = peerSet.end();
+        for (; peerIt != peerEndIt; ++peerIt) {
+            ProcessRank peerRank = *peerIt;
+            entryValuesSendBuff_[peerRank]->wait();
+        }
 #endif // HAVE_MPI
     }
 
@@ -610,14 +757,14 @@ private:
         auto &mpiRowSizesRecvBuff = *rowSizesRecvBuff_[peerRank];
         auto &mpiColIndicesRecvBuff = *entryColIndicesRecvBuff_[peerRank];
 
-        mpiRecvBuff.receive(peerRank);
+        mpiRecvBuff.wait();
 
         // retrieve the values from the receive buffer
         unsigned k = 0;
         for (unsigned i = 0; i < mpiRowIndicesRecvBuff.size(); ++i) {
-            Index domRowIdx = mpiRowIndicesRecvBuff[i];
+            Index domRowIdx = static_cast<Index>(mpiRowIndicesRecvBuff[i]);
             for (unsigned j = 0; j < mpiRowSizesRecvBuff[i]; ++j, ++k) {
-                Index domColIdx = mpiColIndicesRecvBuff[k];
+                Index domColIdx = static_cast<Index>(mpiColIndicesRecvBuff[k]);
 
                 if (domColIdx < 0)
                     // the matrix for the current process does not know about this DOF
@@ -634,18 +781,18 @@ private:
 #if HAVE_MPI
         MpiBuffer<block_type> &mpiRecvBuff = *entryValuesRecvBuff_[peerRank];
 
-        MpiBuffer<Index> &mpiRowIndicesRecvBuff = *rowIndicesRecvBuff_[peerRank];
+        MpiBuffer<GlobalIndex> &mpiRowIndicesRecvBuff = *rowIndicesRecvBuff_[peerRank];
         MpiBuffer<unsigned> &mpiRowSizesRecvBuff = *rowSizesRecvBuff_[peerRank];
-        MpiBuffer<Index> &mpiColIndicesRecvBuff = *entryColIndicesRecvBuff_[peerRank];
+        MpiBuffer<GlobalIndex> &mpiColIndicesRecvBuff = *entryColIndicesRecvBuff_[peerRank];
 
-        mpiRecvBuff.receive(peerRank);
+        mpiRecvBuff.wait();
 
         // retrieve the values from the receive buffer
         unsigned k = 0;
         for (unsigned i = 0; i < mpiRowIndicesRecvBuff.size(); ++i) {
-            Index domRowIdx = mpiRowIndicesRecvBuff[i];
+            Index domRowIdx = static_cast<Index>(mpiRowIndicesRecvBuff[i]);
             for (unsigned j = 0; j < mpiRowSizesRecvBuff[i]; ++j, ++k) {
-                Index domColIdx = mpiColIndicesRecvBuff[k];
+                Index domColIdx = static_cast<Index>(mpiColIndicesRecvBuff[k]);
 
                 if (domColIdx < 0)
                     // the matrix for the current process does not know about this DOF
@@ -657,7 +804,7 @@ private:
 #endif // HAVE_MPI
     }
 
-    void globalToDomesticBuff_(MpiBuffer<Index>& idxBuff)
+    void globalToDomesticBuff_(MpiBuffer<GlobalIndex>& idxBuff)
     {
         for (unsigned i = 0; i < idxBuff.size(); ++i)
             idxBuff[i] = overlap_->globalToDomestic(idxBuff[i]);
@@ -667,16 +814,25 @@ private:
     Entries entries_;
     std::shared_ptr<Overlap> overlap_;
 
+    // the overlapping entries which correspond to the entries of the native matrix in
+    // the order of the native rows (nullptr if an entry is not copied) and the ones
+    // which do not correspond to a native entry
+    size_t nativeEntriesNumRows_;
+    size_t nativeEntriesNumNonZeros_;
+    std::vector<size_t> nativeRowOffsets_;
+    std::vector<block_type*> nativeEntries_;
+    std::vector<block_type*> unassignedEntries_;
+
     std::map<ProcessRank, MpiBuffer<unsigned> *> numRowsSendBuff_;
     std::map<ProcessRank, MpiBuffer<unsigned> *> rowSizesSendBuff_;
-    std::map<ProcessRank, MpiBuffer<Index> *> rowIndicesSendBuff_;
-    std::map<ProcessRank, MpiBuffer<Index> *> entryColIndicesSendBuff_;
+    std::map<ProcessRank, MpiBuffer<GlobalIndex> *> rowIndicesSendBuff_;
+    std::map<ProcessRank, MpiBuffer<GlobalIndex> *> entryColIndicesSendBuff_;
     std::map<ProcessRank, MpiBuffer<block_type> *> entryValuesSendBuff_;
 
     std::map<ProcessRank, MpiBuffer<unsigned> > numRowsRecvBuff_;
     std::map<ProcessRank, MpiBuffer<unsigned> *> rowSizesRecvBuff_;
-    std::map<ProcessRank, MpiBuffer<Index> *> rowIndicesRecvBuff_;
-    std::map<ProcessRank, MpiBuffer<Index> *> entryColIndicesRecvBuff_;
+    std::map<ProcessRank, MpiBuffer<GlobalIndex> *> rowIndicesRecvBuff_;
+    std::map<ProcessRank, MpiBuffer<GlobalIndex> *> entryColIndicesRecvBuff_;
     std::map<ProcessRank, MpiBuffer<block_type> *> entryValuesRecvBuff_;
 };
 
@@ -30,6 +30,7 @@
 #include "overlaptypes.hh"
 
 #include <ewoms/parallel/mpibuffer.hh>
+#include <ewoms/parallel/mpisharedwindow.hh>
 #include <opm/common/Valgrind.hpp>
 
 #include <dune/istl/bvector.hh>
@@ -55,10 +56,19 @@ public:
     /*!
      * \brief Given a domestic overlap object, create an overlapping
      *        block vector coherent to it.
+     *
+     * If 'useSharedMemory' is true, the entries are exchanged with the peer processes
+     * which run on the same node via a shared memory window instead of sending
+     * messages. This is a collective decision, i.e., all processes must specify the
+     * same value. It has no effect if MPI-3 is not available.
      */
-    OverlappingBlockVector(const Overlap& overlap)
+    OverlappingBlockVector(const Overlap& overlap, bool useSharedMemory = false)
         : ParentType(overlap.numDomestic()), overlap_(&overlap)
-    { createBuffers_(); }
+    {
+        createBuffers_();
+        if (useSharedMemory)
+            createSharedWindow_();
+    }
 
     /*!
      * \brief Copy constructor.
@@ -70,6 +80,9 @@ public:
         , indicesRecvBuff_(obv.indicesRecvBuff_)
         , valuesSendBuff_(obv.valuesSendBuff_)
         , valuesRecvBuff_(obv.valuesRecvBuff_)
+        , sharedWindow_(obv.sharedWindow_)
+        , sharedSendOffset_(obv.sharedSendOffset_)
+        , sharedRecvOffset_(obv.sharedRecvOffset_)
         , overlap_(obv.overlap_)
     {}
 
@@ -97,6 +110,9 @@ public:
         indicesRecvBuff_ = obv.indicesRecvBuff_;
         valuesSendBuff_ = obv.valuesSendBuff_;
         valuesRecvBuff_ = obv.valuesRecvBuff_;
+        sharedWindow_ = obv.sharedWindow_;
+        sharedSendOffset_ = obv.sharedSendOffset_;
+        sharedRecvOffset_ = obv.sharedRecvOffset_;
         overlap_ = obv.overlap_;
         return *this;
     }
@@ -172,49 +188,90 @@ public:
      *        master process.
      */
     void sync()
+    {
+        startSync();
+        finishSync();
+    }
+
+    /*!
+     * \brief Syncronize all values of the block vector by adding up
+     *        the values of all peer ranks.
+     */
+    void syncAdd()
+    {
+        startSync();
+        finishSyncAdd();
+    }
+
+    /*!
+     * \brief Syncronize all values of the block vector from the
+     *        master rank, but add up the entries on the border.
+     */
+    void syncAddBorder()
+    {
+        startSync();
+        finishSyncAddBorder();
+    }
+
+    /*!
+     * \brief Start to exchange the entries of the vector which are shared with the
+     *        peer ranks.
+     *
+     * The values which are required by the peers are copied into the send buffers
+     * immediately and the data of the peers is received in the background. Until one
+     * of the finishSync*() methods has been called, the vector may thus be modified
+     * arbitrarily, e.g., to compute the rows which are not shared with any peer
+     * rank. Note that the communication buffers are shared by all copies of a vector,
+     * i.e., only a single exchange must be in flight for them at any time.
+     *
+     * If the vector uses a shared memory window, the entries for the peers on the
+     * same node are written to the window and this method waits until all processes
+     * of the node have done so.
+     */
+    void startSync()
     {
         typename PeerSet::const_iterator peerIt;
         typename PeerSet::const_iterator peerEndIt = overlap_->peerSet().end();
 
-        // send all entries to all peers
+        // post the receive operations for the entries of all peers
         peerIt = overlap_->peerSet().begin();
         for (; peerIt != peerEndIt; ++peerIt) {
             ProcessRank peerRank = *peerIt;
-            sendEntries_(peerRank);
+            if (!isSharedPeer_(peerRank))
+                valuesRecvBuff_[peerRank]->start();
         }
 
-        // recieve all entries to the peers
+        // send all entries to all peers
         peerIt = overlap_->peerSet().begin();
         for (; peerIt != peerEndIt; ++peerIt) {
             ProcessRank peerRank = *peerIt;
-            receiveFromMaster_(peerRank);
+            if (isSharedPeer_(peerRank))
+                writeSharedEntries_(peerRank);
+            else
+                sendEntries_(peerRank);
         }
 
-        // wait until we have send everything
-        waitSendFinished_();
+        // make the entries in the shared window visible to the peers on the node
+        if (sharedWindow_)
+            sharedWindow_->sync();
     }
 
     /*!
-     * \brief Syncronize all values of the block vector by adding up
-     *        the values of all peer ranks.
+     * \brief Finish an exchange started by startSync() by copying the entries from
+     *        their master process.
      */
-    void syncAdd()
+    void finishSync()
     {
-        typename PeerSet::const_iterator peerIt;
+        typename PeerSet::const_iterator peerIt = overlap_->peerSet().begin();
         typename PeerSet::const_iterator peerEndIt = overlap_->peerSet().end();
-
-        // send all entries to all peers
-        peerIt = overlap_->peerSet().begin();
-        for (; peerIt != peerEndIt; ++peerIt) {
-            ProcessRank peerRank = *peerIt;
-            sendEntries_(peerRank);
-        }
-
-        // recieve all entries to the peers
-        peerIt = overlap_->peerSet().begin();
         for (; peerIt != peerEndIt; ++peerIt) {
             ProcessRank peerRank = *peerIt;
-            receiveAdd_(peerRank);
+            if (isSharedPeer_(peerRank))
+                receiveFromMaster_(peerRank, sharedEntries_(peerRank));
+            else {
+                valuesRecvBuff_[peerRank]->wait();
+                receiveFromMaster_(peerRank, *valuesRecvBuff_[peerRank]);
+            }
         }
 
         // wait until we have send everything
@@ -222,31 +279,47 @@ public:
     }
 
     /*!
-     * \brief Syncronize all values of the block vector from the
-     *        master rank, but add up the entries on the border.
+     * \brief Finish an exchange started by startSync() by adding up the values of all
+     *        peer ranks.
      */
-    void syncAddBorder()
+    void finishSyncAdd()
     {
-        typename PeerSet::const_iterator peerIt;
+        typename PeerSet::const_iterator peerIt = overlap_->peerSet().begin();
         typename PeerSet::const_iterator peerEndIt = overlap_->peerSet().end();
-
-        // send all entries to all peers
-        peerIt = overlap_->peerSet().begin();
         for (; peerIt != peerEndIt; ++peerIt) {
             ProcessRank peerRank = *peerIt;
-            sendEntries_(peerRank);
+            if (isSharedPeer_(peerRank))
+                receiveAdd_(peerRank, sharedEntries_(peerRank));
+            else {
+                valuesRecvBuff_[peerRank]->wait();
+                receiveAdd_(peerRank, *valuesRecvBuff_[peerRank]);
+            }
         }
 
-        // recieve all entries to the peers
-        peerIt = overlap_->peerSet().begin();
+        // wait until we have send everything
+        waitSendFinished_();
+    }
+
+    /*!
+     * \brief Finish an exchange started by startSync() by copying the entries from
+     *        their master process, but adding up the entries on the border.
+     */
+    void finishSyncAddBorder()
+    {
+        typename PeerSet::const_iterator peerIt = overlap_->peerSet().begin();
+        typename PeerSet::const_iterator peerEndIt = overlap_->peerSet().end();
         for (; peerIt != peerEndIt; ++peerIt) {
             ProcessRank peerRank = *peerIt;
-            receiveAddBorder_(peerRank);
+            if (isSharedPeer_(peerRank))
+                receiveAddBorder_(peerRank, sharedEntries_(peerRank));
+            else {
+                valuesRecvBuff_[peerRank]->wait();
+                receiveAddBorder_(peerRank, *valuesRecvBuff_[peerRank]);
+            }
         }
 
         // wait until we have send everything
         waitSendFinished_();
-
     }
 
     void print() const
@@ -261,6 +334,8 @@ private:
     void createBuffers_()
     {
 #if HAVE_MPI
+        MpiCommunicator comm = overlap_->communicator();
+
         // create array for the front indices
         typename PeerSet::const_iterator peerIt;
         typename PeerSet::const_iterator peerEndIt = overlap_->peerSet().end();
@@ -271,12 +346,13 @@ private:
             ProcessRank peerRank = *peerIt;
 
             size_t numEntries = overlap_->foreignOverlapSize(peerRank);
-            numIndicesSendBuff_[peerRank] = std::make_shared<MpiBuffer<unsigned> >(1);
-            indicesSendBuff_[peerRank] = std::make_shared<MpiBuffer<Index> >(numEntries);
-            valuesSendBuff_[peerRank] = std::make_shared<MpiBuffer<FieldVector> >(numEntries);
+            numIndicesSendBuff_[peerRank] = std::make_shared<MpiBuffer<unsigned> >(1, comm);
+            indicesSendBuff_[peerRank] = std::make_shared<MpiBuffer<GlobalIndex> >(numEntries, comm);
+            valuesSendBuff_[peerRank] = std::make_shared<MpiBuffer<FieldVector> >(numEntries, comm);
+            valuesSendBuff_[peerRank]->initPersistentSend(peerRank);
 
             // fill the indices buffer with global indices
-            MpiBuffer<Index>& indicesSendBuff = *indicesSendBuff_[peerRank];
+            MpiBuffer<GlobalIndex>& indicesSendBuff = *indicesSendBuff_[peerRank];
             for (unsigned i = 0; i < numEntries; ++i) {
                 Index domRowIdx = overlap_->foreignOverlapOffsetToDomesticIdx(peerRank, i);
                 indicesSendBuff[i] = overlap_->domesticToGlobal(domRowIdx);
@@ -296,23 +372,24 @@ private:
             ProcessRank peerRank = *peerIt;
 
             // receive size of overlap to peer
-            MpiBuffer<unsigned> numRowsRecvBuff(1);
+            MpiBuffer<unsigned> numRowsRecvBuff(1, comm);
             numRowsRecvBuff.receive(peerRank);
             unsigned numRows = numRowsRecvBuff[0];
 
             // then, create the MPI buffers
-            indicesRecvBuff_[peerRank] = std::shared_ptr<MpiBuffer<Index> >(
-                new MpiBuffer<Index>(numRows));
+            indicesRecvBuff_[peerRank] = std::shared_ptr<MpiBuffer<GlobalIndex> >(
+                new MpiBuffer<GlobalIndex>(numRows, comm));
             valuesRecvBuff_[peerRank] = std::shared_ptr<MpiBuffer<FieldVector> >(
-                new MpiBuffer<FieldVector>(numRows));
-            MpiBuffer<Index>& indicesRecvBuff = *indicesRecvBuff_[peerRank];
+                new MpiBuffer<FieldVector>(numRows, comm));
+            valuesRecvBuff_[peerRank]->initPersistentReceive(peerRank);
+            MpiBuffer<GlobalIndex>& indicesRecvBuff = *indicesRecvBuff_[peerRank];
 
             // next, receive the actual indices
             indicesRecvBuff.receive(peerRank);
 
             // finally, translate the global indices to domestic ones
             for (unsigned i = 0; i != numRows; ++i) {
-                Index globalRowIdx = indicesRecvBuff[i];
+                GlobalIndex globalRowIdx = indicesRecvBuff[i];
                 Index domRowIdx = overlap_->globalToDomestic(globalRowIdx);
 
                 indicesRecvBuff[i] = domRowIdx;
@@ -328,7 +405,7 @@ private:
 
             // convert the global indices of the send buffer to
             // domestic ones
-            MpiBuffer<Index>& indicesSendBuff = *indicesSendBuff_[peerRank];
+            MpiBuffer<GlobalIndex>& indicesSendBuff = *indicesSendBuff_[peerRank];
             for (unsigned i = 0; i < indicesSendBuff.size(); ++i) {
                 indicesSendBuff[i] = overlap_->globalToDomestic(indicesSendBuff[i]);
             }
@@ -339,12 +416,12 @@ private:
     void sendEntries_(ProcessRank peerRank)
     {
         // copy the values into the send buffer
-        const MpiBuffer<Index>& indices = *indicesSendBuff_[peerRank];
+        const MpiBuffer<GlobalIndex>& indices = *indicesSendBuff_[peerRank];
         MpiBuffer<FieldVector>& values = *valuesSendBuff_[peerRank];
         for (unsigned i = 0; i < indices.size(); ++i)
             values[i] = (*this)[static_cast<unsigned>(indices[i])];
 
-        values.send(peerRank);
+        values.start();
     }
 
     void waitSendFinished_()
@@ -356,38 +433,113 @@ private:
         peerIt = overlap_->peerSet().begin();
         for (; peerIt != peerEndIt; ++peerIt) {
             ProcessRank peerRank = *peerIt;
-            valuesSendBuff_[peerRank]->wait();
+            if (!isSharedPeer_(peerRank))
+                valuesSendBuff_[peerRank]->wait();
+        }
+
+        // the entries of the shared window may only be overwritten after all peers on
+        // the node have read them
+        if (sharedWindow_)
+            sharedWindow_->sync();
+    }
+
+    // allocate a shared memory window which contains the entries sent to all peers
+    // and determine where the entries of the peers on the same node can be found in
+    // their windows
+    void createSharedWindow_()
+    {
+#if EWOMS_HAVE_MPI_SHARED_WINDOWS
+        MpiCommunicator comm = overlap_->communicator();
+
+        // the window must be allocated before we know which peers are on the same
+        // node, so it covers the entries for all peers. this wastes a bit of memory
+        // but keeps the offsets simple.
+        typename PeerSet::const_iterator peerIt;
+        typename PeerSet::const_iterator peerEndIt = overlap_->peerSet().end();
+        size_t windowSize = 0;
+        peerIt = overlap_->peerSet().begin();
+        for (; peerIt != peerEndIt; ++peerIt) {
+            ProcessRank peerRank = *peerIt;
+            sharedSendOffset_[peerRank] = windowSize;
+            windowSize += indicesSendBuff_[peerRank]->size();
         }
+        sharedWindow_ = std::make_shared<MpiSharedWindow<FieldVector> >(comm, windowSize);
+
+        // tell the peers on the same node where their entries are located
+        std::map<ProcessRank, std::shared_ptr<MpiBuffer<size_t> > > offsetSendBuff;
+        peerIt = overlap_->peerSet().begin();
+        for (; peerIt != peerEndIt; ++peerIt) {
+            ProcessRank peerRank = *peerIt;
+            if (!sharedWindow_->isOnNode(peerRank))
+                continue;
+
+            offsetSendBuff[peerRank] = std::make_shared<MpiBuffer<size_t> >(1, comm);
+            (*offsetSendBuff[peerRank])[0] = sharedSendOffset_[peerRank];
+            offsetSendBuff[peerRank]->send(peerRank);
+        }
+
+        peerIt = overlap_->peerSet().begin();
+        for (; peerIt != peerEndIt; ++peerIt) {
+            ProcessRank peerRank = *peerIt;
+            if (!sharedWindow_->isOnNode(peerRank))
+                continue;
+
+            MpiBuffer<size_t> offsetRecvBuff(1, comm);
+            offsetRecvBuff.receive(peerRank);
+            sharedRecvOffset_[peerRank] = offsetRecvBuff[0];
+        }
+
+        auto sendIt = offsetSendBuff.begin();
+        const auto& sendEndIt = offsetSendBuff.end();
+        for (; sendIt != sendEndIt; ++sendIt)
+            sendIt->second->wait();
+#endif // EWOMS_HAVE_MPI_SHARED_WINDOWS
+    }
+
+    // returns true iff the entries for a peer are exchanged via the shared window
+    bool isSharedPeer_(ProcessRank peerRank) const
+    { return sharedWindow_ && sharedWindow_->isOnNode(peerRank); }
+
+    void writeSharedEntries_(ProcessRank peerRank)
+    {
+        // copy the values directly into the window, the peer reads them from there
+        const MpiBuffer<GlobalIndex>& indices = *indicesSendBuff_[peerRank];
+        FieldVector* values = sharedWindow_->data() + sharedSendOffset_[peerRank];
+        for (unsigned i = 0; i < indices.size(); ++i)
+            values[i] = (*this)[static_cast<unsigned>(indices[i])];
     }
 
-    void receiveFromMaster_(ProcessRank peerRank)
+    // returns the entries which a peer on the same node has written for us
+    const FieldVector* sharedEntries_(ProcessRank peerRank) const
     {
-        const MpiBuffer<Index>& indices = *indicesRecvBuff_[peerRank];
-        MpiBuffer<FieldVector>& values = *valuesRecvBuff_[peerRank];
+        return sharedWindow_->peerData(peerRank) + sharedRecvOffset_.find(peerRank)->second;
+    }
 
-        // receive the values from the peer
-        values.receive(peerRank);
+    // the following methods expect that the values of the peer have already been
+    // received, cf. startSync(). the values are either an MPI buffer or a pointer into
+    // the shared window of the peer.
+    template <class Values>
+    void receiveFromMaster_(ProcessRank peerRank, const Values& values)
+    {
+        const MpiBuffer<GlobalIndex>& indices = *indicesRecvBuff_[peerRank];
 
         // copy them into the block vector
         for (unsigned j = 0; j < indices.size(); ++j) {
-            Index domRowIdx = indices[j];
+            Index domRowIdx = static_cast<Index>(indices[j]);
             if (overlap_->masterRank(domRowIdx) == peerRank) {
                 (*this)[static_cast<unsigned>(domRowIdx)] = values[j];
             }
         }
     }
 
-    void receiveAddBorder_(ProcessRank peerRank)
+    template <class Values>
+    void receiveAddBorder_(ProcessRank peerRank, const Values& values)
     {
-        const MpiBuffer<Index>& indices = *indicesRecvBuff_[peerRank];
-        MpiBuffer<FieldVector>& values = *valuesRecvBuff_[peerRank];
-
-        // receive the values from the peer
-        values.receive(peerRank);
+        const MpiBuffer<GlobalIndex>& indices = *indicesRecvBuff_[peerRank];
 
         // add up the values of rows on the shared boundary
         for (unsigned j = 0; j < indices.size(); ++j) {
-            Index domRowIdx = indices[j];
+            Index domRowIdx = static_cast<Index>(indices[j]);
             if (overlap_->isBorderWith(domRowIdx, peerRank))
                 (*this)[static_cast<unsigned>(domRowIdx)] += values[j];
             else
@@ -395,27 +547,30 @@ private:
         }
     }
 
-    void receiveAdd_(ProcessRank peerRank)
+    template <class Values>
+    void receiveAdd_(ProcessRank peerRank, const Values& values)
     {
-        const MpiBuffer<Index>& indices = *indicesRecvBuff_[peerRank];
-        MpiBuffer<FieldVector>& values = *valuesRecvBuff_[peerRank];
-
-        // receive the values from the peer
-        values.receive(peerRank);
+        const MpiBuffer<GlobalIndex>& indices = *indicesRecvBuff_[peerRank];
 
         // add up the values of rows on the shared boundary
         for (unsigned j = 0; j < indices.size(); ++j) {
-            Index domRowIdx = indices[j];
+            Index domRowIdx = static_cast<Index>(indices[j]);
             (*this)[static_cast<unsigned>(domRowIdx)] += values[j];
         }
     }
 
     std::map<ProcessRank, std::shared_ptr<MpiBuffer<unsigned> > > numIndicesSendBuff_;
-    std::map<ProcessRank, std::shared_ptr<MpiBuffer<Index> > > indicesSendBuff_;
-    std::map<ProcessRank, std::shared_ptr<MpiBuffer<Index> > > indicesRecvBuff_;
+    std::map<ProcessRank, std::shared_ptr<MpiBuffer<GlobalIndex> > > indicesSendBuff_;
+    std::map<ProcessRank, std::shared_ptr<MpiBuffer<GlobalIndex> > > indicesRecvBuff_;
     std::map<ProcessRank, std::shared_ptr<MpiBuffer<FieldVector> > > valuesSendBuff_;
     std::map<ProcessRank, std::shared_ptr<MpiBuffer<FieldVector> > > valuesRecvBuff_;
 
+    // the window used to exchange the entries with the peers on the same node and the
+    // offsets of the entries for and of each peer within the windows
+    std::shared_ptr<MpiSharedWindow<FieldVector> > sharedWindow_;
+    std::map<ProcessRank, size_t> sharedSendOffset_;
+    std::map<ProcessRank, size_t> sharedRecvOffset_;
+
     const Overlap *overlap_;
 };
 
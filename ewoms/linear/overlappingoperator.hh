@@ -27,13 +27,34 @@
 #ifndef EWOMS_OVERLAPPING_OPERATOR_HH
 #define EWOMS_OVERLAPPING_OPERATOR_HH
 
+#include "blockspmvkernels.hh"
+#include "schurcomplementcorrection.hh"
+
 #include <dune/istl/operators.hh>
 
+#include <algorithm>
+#include <vector>
+
 namespace Ewoms {
 namespace Linear {
 
 /*!
  * \brief An overlap aware linear operator usable by ISTL.
+ *
+ * If the operator is transposed, it applies \f$A^T\f$ instead of \f$A\f$ without
+ * creating a second matrix. Since the sparsity pattern of the overlapping matrix is
+ * symmetric and the rows of all domestic indices are complete, the results for the
+ * indices which a process is master of are the same as for the non-transposed case,
+ * and the remaining ones are fixed by synchronizing the result vector.
+ *
+ * The non-transposed products use the row kernels which are specialized on the size of
+ * the matrix blocks (cf. blockspmvkernels.hh). For these, the rows which are required
+ * by the peer processes are computed first, so that the result vector can be
+ * synchronized while the remaining rows are computed.
+ *
+ * Optionally, the off-diagonal part of the Schur complement of some eliminated unknowns
+ * is added to the products (cf. SchurComplementCorrection). The indices of its rows are
+ * domestic indices of the overlapping matrix.
  */
 template <class OverlappingMatrix, class DomainVector, class RangeVector>
 class OverlappingOperator
@@ -45,28 +66,79 @@ public:
     //! export types
     typedef DomainVector domain_type;
     typedef typename domain_type::field_type field_type;
+    typedef SchurComplementCorrection<field_type,
+                                      DomainVector::block_type::dimension> SchurCorrection;
 
     // redefine the category, that is the only difference
     enum { category = Dune::SolverCategory::overlapping };
 
-    OverlappingOperator(const OverlappingMatrix& A) : A_(A)
-    {}
+    OverlappingOperator(const OverlappingMatrix& A,
+                        bool transposed = false,
+                        const SchurCorrection* schurCorrection = nullptr)
+        : A_(A)
+        , transposed_(transposed)
+        , schurCorrection_(schurCorrection)
+    {
+        if (schurCorrection_ && schurCorrection_->empty())
+            schurCorrection_ = nullptr;
+
+        // the correction needs to be applied before the result is synchronized, so the
+        // rows are not partitioned in this case
+        if (!transposed_ && !schurCorrection_)
+            partitionRows_();
+    }
 
     //! apply operator to x:  \f$ y = A(x) \f$
     virtual void apply(const DomainVector& x, RangeVector& y) const
     {
-        A_.mv(x, y);
-        y.sync();
+        if (transposed_) {
+            A_.mtv(x, y);
+            if (schurCorrection_)
+                schurCorrection_->usmv(1.0, x, y, /*transposed=*/true);
+            y.sync();
+        }
+        else if (sendRows_.empty()) {
+            blockMv(A_, x, y);
+            if (schurCorrection_)
+                schurCorrection_->usmv(1.0, x, y);
+            y.sync();
+        }
+        else {
+            blockMvRows(A_, x, y, sendRows_);
+            y.startSync();
+            blockMvRows(A_, x, y, interiorRows_);
+            y.finishSync();
+        }
     }
 
     //! apply operator to x, scale and add:  \f$ y = y + \alpha A(x) \f$
     virtual void applyscaleadd(field_type alpha, const DomainVector& x,
                                RangeVector& y) const
     {
-        A_.usmv(alpha, x, y);
-        y.sync();
+        if (transposed_) {
+            A_.usmtv(alpha, x, y);
+            if (schurCorrection_)
+                schurCorrection_->usmv(alpha, x, y, /*transposed=*/true);
+            y.sync();
+        }
+        else if (sendRows_.empty()) {
+            blockUsmv(alpha, A_, x, y);
+            if (schurCorrection_)
+                schurCorrection_->usmv(alpha, x, y);
+            y.sync();
+        }
+        else {
+            blockUsmvRows(alpha, A_, x, y, sendRows_);
+            y.startSync();
+            blockUsmvRows(alpha, A_, x, y, interiorRows_);
+            y.finishSync();
+        }
     }
 
+    //! returns true iff the transposed matrix is applied
+    bool transposed() const
+    { return transposed_; }
+
     //! returns the matrix
     virtual const OverlappingMatrix& getmat() const
     { return A_; }
@@ -75,7 +147,41 @@ public:
     { return A_.overlap(); }
 
 private:
+    // split the rows of the matrix into the ones which are sent to at least one peer
+    // process by OverlappingBlockVector::sync() and the remaining ones
+    void partitionRows_()
+    {
+        const Overlap& overlap = A_.overlap();
+        std::vector<bool> isSendRow(A_.N(), false);
+
+        const auto& peerSet = overlap.peerSet();
+        const auto& peerEndIt = peerSet.end();
+        for (auto peerIt = peerSet.begin(); peerIt != peerEndIt; ++peerIt) {
+            auto peerRank = *peerIt;
+            size_t numEntries = overlap.foreignOverlapSize(peerRank);
+            for (unsigned i = 0; i < numEntries; ++i) {
+                auto domRowIdx = overlap.foreignOverlapOffsetToDomesticIdx(peerRank, i);
+                isSendRow[static_cast<unsigned>(domRowIdx)] = true;
+            }
+        }
+
+        // the sequential case does not require the partition
+        if (std::find(isSendRow.begin(), isSendRow.end(), true) == isSendRow.end())
+            return;
+
+        for (unsigned rowIdx = 0; rowIdx < isSendRow.size(); ++rowIdx) {
+            if (isSendRow[rowIdx])
+                sendRows_.push_back(rowIdx);
+            else
+                interiorRows_.push_back(rowIdx);
+        }
+    }
+
     const OverlappingMatrix& A_;
+    bool transposed_;
+    const SchurCorrection* schurCorrection_;
+    std::vector<unsigned> sendRows_;
+    std::vector<unsigned> interiorRows_;
 };
 
 } // namespace Linear
@@ -68,7 +68,7 @@ public:
                           1,               // number of objects in buffers
                           MPI_SHORT,       // data type
                           MPI_MIN,         // operation
-                          MPI_COMM_WORLD); // communicator
+                          overlap_->communicator()); // communicator
         }
         catch (...)
         {
@@ -78,7 +78,7 @@ public:
                           1,               // number of objects in buffers
                           MPI_SHORT,       // data type
                           MPI_MIN,         // operation
-                          MPI_COMM_WORLD); // communicator
+                          overlap_->communicator()); // communicator
         }
 
         if (success) {
@@ -114,7 +114,7 @@ public:
                               1,               // number of objects in buffers
                               MPI_SHORT,       // data type
                               MPI_MIN,         // operation
-                              MPI_COMM_WORLD); // communicator
+                              overlap_->communicator()); // communicator
             }
             catch (...)
             {
@@ -124,7 +124,7 @@ public:
                               1,               // number of objects in buffers
                               MPI_SHORT,       // data type
                               MPI_MIN,         // operation
-                              MPI_COMM_WORLD); // communicator
+                              overlap_->communicator()); // communicator
             }
 
             if (success) {
@@ -152,7 +152,7 @@ public:
                           1,               // number of objects in buffers
                           MPI_SHORT,       // data type
                           MPI_MIN,         // operation
-                          MPI_COMM_WORLD); // communicator
+                          overlap_->communicator()); // communicator
         }
         catch (...)
         {
@@ -162,7 +162,7 @@ public:
                           1,               // number of objects in buffers
                           MPI_SHORT,       // data type
                           MPI_MIN,         // operation
-                          MPI_COMM_WORLD); // communicator
+                          overlap_->communicator()); // communicator
         }
 
         if (success) {
@@ -29,13 +29,25 @@
 
 #include <dune/common/version.hh>
 #include <dune/common/parallel/mpihelper.hh>
+#include <dune/common/parallel/mpitraits.hh>
 #include <dune/istl/scalarproducts.hh>
 
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <vector>
+
 namespace Ewoms {
 namespace Linear {
 
 /*!
  * \brief An overlap aware ISTL scalar product.
+ *
+ * The local contributions are computed over the contiguous ranges of the indices for
+ * which the process is the master. These ranges are determined once when the object is
+ * constructed and they are split into chunks of limited size which are distributed to
+ * the threads. The partial sums of the chunks are always added up in the same order, so
+ * the result does not depend on the number of threads.
  */
 template <class OverlappingBlockVector, class Overlap>
 class OverlappingScalarProduct
@@ -53,30 +65,169 @@ public:
 
     enum { category = Dune::SolverCategory::overlapping };
 
+    //! The maximum number of scalar products which can be computed by localDots()
+    static const unsigned maxFusedDots = 4;
+
     OverlappingScalarProduct(const Overlap& overlap)
         : overlap_(overlap), comm_( Dune::MPIHelper::getCollectiveCommunication() )
-    {}
+    {
+#if HAVE_MPI
+        sumRequest_ = MPI_REQUEST_NULL;
+#endif
+        updateMasterChunks_();
+    }
 
     field_type dot(const OverlappingBlockVector& x,
                    const OverlappingBlockVector& y)
     {
-        field_type sum = 0;
-        size_t numLocal = overlap_.numLocal();
-        for (unsigned localIdx = 0; localIdx < numLocal; ++localIdx) {
-            if (overlap_.iAmMasterOf(static_cast<int>(localIdx)))
-                sum += x[localIdx] * y[localIdx];
-        }
-
         // return the global sum
-        return comm_.sum( sum );
+        return comm_.sum( localDot(x, y) );
     }
 
     real_type norm(const OverlappingBlockVector& x)
     { return std::sqrt(dot(x, x)); }
 
+    /*!
+     * \brief Returns the contribution of the local process to the scalar product of two
+     *        vectors.
+     *
+     * Together with beginSum() and endSum() this allows to fuse several scalar products
+     * into a single global reduction.
+     */
+    field_type localDot(const OverlappingBlockVector& x,
+                        const OverlappingBlockVector& y) const
+    {
+        const OverlappingBlockVector* yPtr = &y;
+        field_type sum;
+        localDots(x, &yPtr, &sum, /*numDots=*/1);
+        return sum;
+    }
+
+    /*!
+     * \brief Returns the contributions of the local process to several scalar products
+     *        which share their first vector.
+     *
+     * All scalar products are computed by a single pass over the vectors, i.e., the
+     * entries of x are only loaded once.
+     *
+     * \param x The first vector of all scalar products
+     * \param y The array of the second vectors of the scalar products
+     * \param result The array to which the local contributions (x, y[i]) are written
+     * \param numDots The number of scalar products, at most maxFusedDots
+     */
+    void localDots(const OverlappingBlockVector& x,
+                   const OverlappingBlockVector* const* y,
+                   field_type* result,
+                   unsigned numDots) const
+    {
+        assert(numDots <= maxFusedDots);
+
+        int numChunks = static_cast<int>(chunkBegin_.size());
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+        for (int chunkIdx = 0; chunkIdx < numChunks; ++chunkIdx) {
+            field_type sums[maxFusedDots];
+            for (unsigned dotIdx = 0; dotIdx < numDots; ++dotIdx)
+                sums[dotIdx] = 0.0;
+
+            unsigned endIdx = chunkEnd_[chunkIdx];
+            for (unsigned localIdx = chunkBegin_[chunkIdx]; localIdx < endIdx; ++localIdx) {
+                const auto& xBlock = x[localIdx];
+                for (unsigned dotIdx = 0; dotIdx < numDots; ++dotIdx) {
+                    const auto& yBlock = (*y[dotIdx])[localIdx];
+                    for (unsigned k = 0; k < blockSize; ++k)
+                        sums[dotIdx] += xBlock[k]*yBlock[k];
+                }
+            }
+
+            field_type* chunkSums = &chunkSums_[chunkIdx*maxFusedDots];
+            for (unsigned dotIdx = 0; dotIdx < numDots; ++dotIdx)
+                chunkSums[dotIdx] = sums[dotIdx];
+        }
+
+        for (unsigned dotIdx = 0; dotIdx < numDots; ++dotIdx)
+            result[dotIdx] = 0.0;
+        for (int chunkIdx = 0; chunkIdx < numChunks; ++chunkIdx)
+            for (unsigned dotIdx = 0; dotIdx < numDots; ++dotIdx)
+                result[dotIdx] += chunkSums_[chunkIdx*maxFusedDots + dotIdx];
+    }
+
+    /*!
+     * \brief Start to sum up an array of values over all processes.
+     *
+     * The reduction is non-blocking and the result is stored in-place, i.e., the
+     * values must not be accessed until endSum() has been called.
+     */
+    void beginSum(field_type* values, unsigned numValues)
+    {
+#if HAVE_MPI
+        if (comm_.size() > 1)
+            MPI_Iallreduce(MPI_IN_PLACE,
+                           values,
+                           static_cast<int>(numValues),
+                           Dune::MPITraits<field_type>::getType(),
+                           MPI_SUM,
+                           comm_,
+                           &sumRequest_);
+#endif
+    }
+
+    /*!
+     * \brief Wait until the reduction which was started by beginSum() is finished.
+     */
+    void endSum()
+    {
+#if HAVE_MPI
+        if (sumRequest_ != MPI_REQUEST_NULL)
+            MPI_Wait(&sumRequest_, MPI_STATUS_IGNORE);
+#endif
+    }
+
 private:
+    static const unsigned blockSize = OverlappingBlockVector::block_type::dimension;
+
+    // the maximum number of blocks of a chunk
+    static const unsigned chunkSize = 512;
+
+    // determine the ranges of the local indices for which this process is the master
+    // and split them into chunks
+    void updateMasterChunks_()
+    {
+        chunkBegin_.clear();
+        chunkEnd_.clear();
+
+        unsigned numLocal = static_cast<unsigned>(overlap_.numLocal());
+        unsigned localIdx = 0;
+        while (localIdx < numLocal) {
+            if (!overlap_.iAmMasterOf(static_cast<int>(localIdx))) {
+                ++localIdx;
+                continue;
+            }
+
+            unsigned rangeEnd = localIdx + 1;
+            while (rangeEnd < numLocal && overlap_.iAmMasterOf(static_cast<int>(rangeEnd)))
+                ++rangeEnd;
+
+            for (; localIdx < rangeEnd; localIdx += chunkSize) {
+                chunkBegin_.push_back(localIdx);
+                chunkEnd_.push_back(std::min(localIdx + chunkSize, rangeEnd));
+            }
+            localIdx = rangeEnd;
+        }
+
+        chunkSums_.resize(chunkBegin_.size()*maxFusedDots);
+    }
+
     const Overlap& overlap_;
     const CollectiveCommunication comm_;
+#if HAVE_MPI
+    MPI_Request sumRequest_;
+#endif
+
+    std::vector<unsigned> chunkBegin_;
+    std::vector<unsigned> chunkEnd_;
+    mutable std::vector<field_type> chunkSums_;
 };
 
 } // namespace Linear
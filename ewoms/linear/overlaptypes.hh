@@ -43,6 +43,14 @@ namespace Linear {
  */
 typedef int Index;
 
+/*!
+ * \brief The type of a global index of a degree of freedom.
+ *
+ * The number of degrees of freedom of all processes may exceed the range of the Index
+ * type, so global indices are 64 bit integers.
+ */
+typedef long long GlobalIndex;
+
 /*!
  * \brief The type of the rank of a process.
  */
@@ -69,7 +77,7 @@ struct IndexRank
 struct PeerIndexGlobalIndex
 {
     Index peerIdx;
-    Index globalIdx;
+    GlobalIndex globalIdx;
 };
 
 /*!
@@ -95,6 +103,18 @@ struct IndexDistanceNpeers
     unsigned numPeers;
 };
 
+/*!
+ * \brief This structure stores a global index, a process rank, and
+ *        the number of processes which "see" the degree of freedom
+ *        with the index.
+ */
+struct GlobalIndexDistanceNpeers
+{
+    GlobalIndex globalIdx;
+    BorderDistance borderDistance;
+    unsigned numPeers;
+};
+
 /*!
  * \brief A single index intersecting with the process boundary.
  */
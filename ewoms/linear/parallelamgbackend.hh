@@ -30,12 +30,17 @@
 #include "parallelbasebackend.hh"
 #include "bicgstabsolver.hh"
 #include "combinedcriterion.hh"
+#include "mixedprecisionpreconditioner.hh"
+
+#include <opm/common/ErrorMacros.hpp>
+#include <opm/common/Exceptions.hpp>
 
 #include <dune/istl/paamg/amg.hh>
 #include <dune/istl/paamg/pinfo.hh>
 #include <dune/istl/owneroverlapcopy.hh>
 
 #include <iostream>
+#include <type_traits>
 
 namespace Ewoms {
 namespace Linear {
@@ -47,24 +52,81 @@ namespace Properties {
 NEW_TYPE_TAG(ParallelAmgLinearSolver, INHERITS_FROM(ParallelBaseLinearSolver));
 
 NEW_PROP_TAG(AmgCoarsenTarget);
+NEW_PROP_TAG(AmgMaxHierarchyRefreshes);
 NEW_PROP_TAG(LinearSolverMaxError);
+NEW_PROP_TAG(LinearSolverScalar);
+
+//! The floating point type which is used to store the AMG hierarchy
+NEW_PROP_TAG(AmgScalar);
 
 //! The target number of DOFs per processor for the parallel algebraic
 //! multi-grid solver
 SET_INT_PROP(ParallelAmgLinearSolver, AmgCoarsenTarget, 5000);
 
+//! By default, the aggregates of the AMG hierarchy are determined for each setup
+SET_INT_PROP(ParallelAmgLinearSolver, AmgMaxHierarchyRefreshes, 0);
+
 SET_SCALAR_PROP(ParallelAmgLinearSolver, LinearSolverMaxError, 1e7);
 
+//! By default, the AMG hierarchy uses the same precision as the linear solver
+SET_TYPE_PROP(ParallelAmgLinearSolver, AmgScalar,
+              typename GET_PROP_TYPE(TypeTag, LinearSolverScalar));
+
 SET_TYPE_PROP(ParallelAmgLinearSolver, LinearSolverBackend,
               Ewoms::Linear::ParallelAmgBackend<TypeTag>);
 } // namespace Properties
 
 namespace Linear {
+#if HAVE_MPI
+/*!
+ * \ingroup Linear
+ *
+ * \brief Create DUNE's parallel index set for the AMG from the domestic overlap of
+ *        the linear solver.
+ */
+template <class Overlap, class ParallelIndexSet>
+void setupAmgIndexSet(const Overlap& overlap, ParallelIndexSet& istlIndices)
+{
+    typedef Dune::OwnerOverlapCopyAttributeSet GridAttributes;
+    typedef Dune::OwnerOverlapCopyAttributeSet::AttributeSet GridAttributeSet;
+
+    // create DUNE's ParallelIndexSet from a domestic overlap
+    istlIndices.beginResize();
+    for (Index curIdx = 0; static_cast<size_t>(curIdx) < overlap.numDomestic(); ++curIdx) {
+        GridAttributeSet gridFlag =
+            overlap.iAmMasterOf(curIdx)
+            ? GridAttributes::owner
+            : GridAttributes::copy;
+
+        // an index is used by other processes if it is in the
+        // domestic or in the foreign overlap.
+        bool isShared = overlap.isInOverlap(curIdx);
+
+        assert(curIdx == overlap.globalToDomestic(overlap.domesticToGlobal(curIdx)));
+        istlIndices.add(/*globalIdx=*/overlap.domesticToGlobal(curIdx),
+                        Dune::ParallelLocalIndex<GridAttributeSet>(static_cast<size_t>(curIdx),
+                                                                   gridFlag,
+                                                                   isShared));
+    }
+    istlIndices.endResize();
+}
+#endif
+
 /*!
  * \ingroup Linear
  *
  * \brief Provides a linear solver backend using the parallel
  *        algebraic multi-grid (AMG) linear solver from DUNE-ISTL.
+ *
+ * If the AmgScalar property is set to a type which is different from the one of the
+ * linear solver (e.g. 'float'), the AMG hierarchy and its smoothers are built for a
+ * copy of the matrix which uses this type while the iterations of the linear solver
+ * are still done in the precision of the linear solver.
+ *
+ * Determining the aggregates is the most expensive part of setting up the AMG. If the
+ * AmgMaxHierarchyRefreshes parameter is larger than zero, the aggregates of the last
+ * hierarchy are kept within a time step and only the coarse level matrices are
+ * recomputed for the new values, at most the specified number of times in a row.
  */
 template <class TypeTag>
 class ParallelAmgBackend : public ParallelBaseBackend<TypeTag>
@@ -73,6 +135,7 @@ class ParallelAmgBackend : public ParallelBaseBackend<TypeTag>
 
     typedef typename GET_PROP_TYPE(TypeTag, Scalar) Scalar;
     typedef typename GET_PROP_TYPE(TypeTag, LinearSolverScalar) LinearSolverScalar;
+    typedef typename GET_PROP_TYPE(TypeTag, AmgScalar) AmgScalar;
     typedef typename GET_PROP_TYPE(TypeTag, Simulator) Simulator;
     typedef typename GET_PROP_TYPE(TypeTag, GridView) GridView;
     typedef typename GET_PROP_TYPE(TypeTag, Overlap) Overlap;
@@ -83,8 +146,8 @@ class ParallelAmgBackend : public ParallelBaseBackend<TypeTag>
     typedef typename ParentType::ParallelScalarProduct ParallelScalarProduct;
 
     static constexpr int numEq = GET_PROP_VALUE(TypeTag, NumEq);
-    typedef Dune::FieldVector<LinearSolverScalar, numEq> VectorBlock;
-    typedef Dune::FieldMatrix<LinearSolverScalar, numEq, numEq> MatrixBlock;
+    typedef Dune::FieldVector<AmgScalar, numEq> VectorBlock;
+    typedef Dune::FieldMatrix<AmgScalar, numEq, numEq> MatrixBlock;
 
     typedef Dune::BCRSMatrix<MatrixBlock> Matrix;
     typedef Dune::BlockVector<VectorBlock> Vector;
@@ -121,14 +184,28 @@ class ParallelAmgBackend : public ParallelBaseBackend<TypeTag>
     typedef Dune::Amg::AMG<FineOperator, Vector, ParallelSmoother> AMG;
 #endif
 
+    // if the precision of the AMG differs from the one of the linear solver, the
+    // vectors need to be converted for each application of the preconditioner
+    static constexpr bool useMixedPrecision = !std::is_same<AmgScalar, LinearSolverScalar>::value;
+    typedef std::integral_constant<bool, useMixedPrecision> UseMixedPrecision;
+    typedef typename std::conditional<useMixedPrecision,
+                                      MixedPrecisionPreconditioner<AMG,
+                                                                   OverlappingVector,
+                                                                   OverlappingVector>,
+                                      AMG>::type AmgPreconditioner;
+
     typedef BiCGStabSolver<ParallelOperator,
                            OverlappingVector,
-                           AMG> RawLinearSolver;
+                           AmgPreconditioner,
+                           ParallelScalarProduct> RawLinearSolver;
 
 public:
-    ParallelAmgBackend(const Simulator& simulator)
+    ParallelAmgBackend(Simulator& simulator)
         : ParentType(simulator)
-    { }
+    {
+        numHierarchyRefreshes_ = 0;
+        amgTimeStepIdx_ = -1;
+    }
 
     static void registerParameters()
     {
@@ -137,34 +214,62 @@ public:
         EWOMS_REGISTER_PARAM(TypeTag, Scalar, LinearSolverMaxError,
                              "The maximum residual error which the linear solver tolerates"
                              " without giving up");
+        EWOMS_REGISTER_PARAM(TypeTag, std::string, LinearSolverAlgorithm,
+                             "The algorithm of the stabilized BiCG linear solver. Possible "
+                             "values: 'bicgstab', 'pipelined-bicgstab'");
         EWOMS_REGISTER_PARAM(TypeTag, int, AmgCoarsenTarget,
                              "The coarsening target for the agglomerations of "
                              "the AMG preconditioner");
+        EWOMS_REGISTER_PARAM(TypeTag, int, AmgMaxHierarchyRefreshes,
+                             "The number of times in a row the coarse level matrices of the "
+                             "AMG hierarchy are recomputed for new matrix values instead of "
+                             "determining the aggregates again. 0 means that the hierarchy "
+                             "is built from scratch for each setup");
     }
 
 protected:
     friend ParentType;
 
-    std::shared_ptr<AMG> preparePreconditioner_()
+    std::shared_ptr<AmgPreconditioner> preparePreconditioner_()
     {
+        // applying the AMG hierarchy to the transposed system would require transposed
+        // restriction, prolongation and smoothing operators on all levels.
+        if (this->transposed_)
+            OPM_THROW(Opm::NotImplemented,
+                      "The AMG linear solver backend cannot solve transposed linear systems");
+
+        if (canRefreshHierarchy_()) {
+            // the aggregates are kept, so the communication and the fine level
+            // operator, which references the matrix, stay valid as well
+            refreshFineMatrix_(UseMixedPrecision());
+            amg_->recalculateHierarchy();
+            ++ numHierarchyRefreshes_;
+
+            return wrapAmg_(UseMixedPrecision());
+        }
+
 #if HAVE_MPI
         // create and initialize DUNE's OwnerOverlapCopyCommunication
         // using the domestic overlap
-        istlComm_ = std::make_shared<OwnerOverlapCopyCommunication>(MPI_COMM_WORLD);
-        setupAmgIndexSet_(this->overlappingMatrix_->overlap(), istlComm_->indexSet());
+        istlComm_ = std::make_shared<OwnerOverlapCopyCommunication>(
+            this->overlappingMatrix_->overlap().communicator());
+        setupAmgIndexSet(this->overlappingMatrix_->overlap(), istlComm_->indexSet());
         istlComm_->remoteIndices().template rebuild<false>();
 #endif
 
         // create the parallel scalar product and the parallel operator
+        const Matrix& fineMatrix = fineMatrix_(UseMixedPrecision());
 #if HAVE_MPI
-        fineOperator_ = std::make_shared<FineOperator>(*this->overlappingMatrix_, *istlComm_);
+        fineOperator_ = std::make_shared<FineOperator>(fineMatrix, *istlComm_);
 #else
-        fineOperator_ = std::make_shared<FineOperator>(*this->overlappingMatrix_);
+        fineOperator_ = std::make_shared<FineOperator>(fineMatrix);
 #endif
 
         setupAmg_();
+        numHierarchyRefreshes_ = 0;
+        amgTimeStepIdx_ = this->simulator_.timeStepIndex();
 
-        return amg_;
+        return wrapAmg_(UseMixedPrecision());
     }
 
     void cleanupPreconditioner_()
@@ -172,12 +277,12 @@ protected:
 
     std::shared_ptr<RawLinearSolver> prepareSolver_(ParallelOperator& parOperator,
                                                     ParallelScalarProduct& parScalarProduct,
-                                                    AMG& parPreCond)
+                                                    AmgPreconditioner& parPreCond)
     {
         const auto& gridView = this->simulator_.gridView();
         typedef CombinedCriterion<OverlappingVector, decltype(gridView.comm())> CCC;
 
-        Scalar linearSolverTolerance = EWOMS_GET_PARAM(TypeTag, Scalar, LinearSolverTolerance);
+        Scalar linearSolverTolerance = this->tolerance();
         Scalar linearSolverAbsTolerance = this->simulator_.model().newtonMethod().tolerance() / 10.0;
 
         convCrit_.reset(new CCC(gridView.comm(),
@@ -195,44 +300,55 @@ protected:
         bicgstabSolver->setMaxIterations(EWOMS_GET_PARAM(TypeTag, int, LinearSolverMaxIterations));
         bicgstabSolver->setLinearOperator(&parOperator);
         bicgstabSolver->setRhs(this->overlappingb_);
+        bicgstabSolver->setPipelined(ParentType::usePipelinedBiCGStab_());
 
         return bicgstabSolver;
     }
 
     bool runSolver_(std::shared_ptr<RawLinearSolver> solver)
-    { return solver->apply(*this->overlappingx_); }
+    {
+        bool result;
+        try {
+            result = solver->apply(*this->overlappingx_);
+        }
+        catch (...) {
+            // do not refresh a hierarchy which could not cope with the system
+            amg_.reset();
+            throw;
+        }
+        this->lastIterations_ = solver->report().iterations();
+
+        if (!result)
+            amg_.reset();
+        return result;
+    }
 
     void cleanupSolver_()
     { /* nothing to do */ }
 
+    void cleanup_()
+    {
+        // the AMG hierarchy references the overlapping matrix which is about to be
+        // destroyed
+        amg_.reset();
+        fineOperator_.reset();
+        lowPrecisionMatrix_.reset();
 #if HAVE_MPI
-    template <class ParallelIndexSet>
-    void setupAmgIndexSet_(const Overlap& overlap, ParallelIndexSet& istlIndices)
+        istlComm_.reset();
+#endif
+
+        ParentType::cleanup_();
+    }
+
+    // returns true if the aggregates of the current AMG hierarchy can be used for the
+    // new values of the overlapping matrix
+    bool canRefreshHierarchy_() const
     {
-        typedef Dune::OwnerOverlapCopyAttributeSet GridAttributes;
-        typedef Dune::OwnerOverlapCopyAttributeSet::AttributeSet GridAttributeSet;
-
-        // create DUNE's ParallelIndexSet from a domestic overlap
-        istlIndices.beginResize();
-        for (Index curIdx = 0; static_cast<size_t>(curIdx) < overlap.numDomestic(); ++curIdx) {
-            GridAttributeSet gridFlag =
-                overlap.iAmMasterOf(curIdx)
-                ? GridAttributes::owner
-                : GridAttributes::copy;
-
-            // an index is used by other processes if it is in the
-            // domestic or in the foreign overlap.
-            bool isShared = overlap.isInOverlap(curIdx);
-
-            assert(curIdx == overlap.globalToDomestic(overlap.domesticToGlobal(curIdx)));
-            istlIndices.add(/*globalIdx=*/overlap.domesticToGlobal(curIdx),
-                            Dune::ParallelLocalIndex<GridAttributeSet>(static_cast<size_t>(curIdx),
-                                                                       gridFlag,
-                                                                       isShared));
-        }
-        istlIndices.endResize();
+        return
+            amg_
+            && numHierarchyRefreshes_ < EWOMS_GET_PARAM(TypeTag, int, AmgMaxHierarchyRefreshes)
+            && amgTimeStepIdx_ == this->simulator_.timeStepIndex();
     }
-#endif
 
     void setupAmg_()
     {
@@ -280,10 +396,38 @@ protected:
 #endif
     }
 
+    // the AMG directly uses the overlapping matrix if it has the same precision
+    const Matrix& fineMatrix_(std::false_type /*useMixedPrecision*/)
+    { return *this->overlappingMatrix_; }
+
+    const Matrix& fineMatrix_(std::true_type /*useMixedPrecision*/)
+    {
+        // the AMG hierarchy references the matrix, so the copy is kept until the
+        // preconditioner is set up the next time
+        lowPrecisionMatrix_.reset(new Matrix);
+        copyMatrixToPrecision(*lowPrecisionMatrix_, *this->overlappingMatrix_);
+        return *lowPrecisionMatrix_;
+    }
+
+    void refreshFineMatrix_(std::false_type /*useMixedPrecision*/)
+    { /* the AMG directly references the overlapping matrix */ }
+
+    void refreshFineMatrix_(std::true_type /*useMixedPrecision*/)
+    { copyMatrixValuesToPrecision(*lowPrecisionMatrix_, *this->overlappingMatrix_); }
+
+    std::shared_ptr<AMG> wrapAmg_(std::false_type /*useMixedPrecision*/)
+    { return amg_; }
+
+    std::shared_ptr<AmgPreconditioner> wrapAmg_(std::true_type /*useMixedPrecision*/)
+    { return std::make_shared<AmgPreconditioner>(amg_); }
+
     std::unique_ptr<ConvergenceCriterion<OverlappingVector> > convCrit_;
 
+    std::unique_ptr<Matrix> lowPrecisionMatrix_;
     std::shared_ptr<FineOperator> fineOperator_;
     std::shared_ptr<AMG> amg_;
+    int numHierarchyRefreshes_;
+    int amgTimeStepIdx_;
 
 #if HAVE_MPI
     std::shared_ptr<OwnerOverlapCopyCommunication> istlComm_;
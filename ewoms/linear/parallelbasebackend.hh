@@ -32,20 +32,38 @@
 #include <ewoms/linear/overlappingpreconditioner.hh>
 #include <ewoms/linear/overlappingscalarproduct.hh>
 #include <ewoms/linear/overlappingoperator.hh>
+#include <ewoms/linear/matrixfreeoverlappingoperator.hh>
 #include <ewoms/linear/parallelbasebackend.hh>
 #include <ewoms/linear/istlpreconditionerwrappers.hh>
 
 #include <ewoms/common/genericguard.hh>
+#include <ewoms/common/memoryaccounting.hh>
+#include <ewoms/common/timer.hh>
 #include <ewoms/common/propertysystem.hh>
 #include <ewoms/common/parametersystem.hh>
 
+#include <opm/common/Unused.hpp>
+#include <opm/common/ErrorMacros.hpp>
+#include <opm/common/Exceptions.hpp>
+
 #include <dune/grid/io/file/vtk/vtkwriter.hh>
 
 #include <dune/common/fvector.hh>
 
+#if HAVE_MPI
+#include <dune/common/parallel/mpicollectivecommunication.hh>
+
+#include <mpi.h>
+#endif
+
+#include <algorithm>
 #include <sstream>
+#include <string>
 #include <memory>
 #include <iostream>
+#include <utility>
+#include <vector>
+#include <cstdint>
 
 namespace Ewoms {
 namespace Properties {
@@ -56,6 +74,7 @@ NEW_PROP_TAG(Simulator);
 NEW_PROP_TAG(Scalar);
 NEW_PROP_TAG(NumEq);
 NEW_PROP_TAG(JacobianMatrix);
+NEW_PROP_TAG(JacobianScalar);
 NEW_PROP_TAG(GlobalEqVector);
 NEW_PROP_TAG(VertexMapper);
 NEW_PROP_TAG(GridView);
@@ -86,6 +105,45 @@ NEW_PROP_TAG(LinearSolverScalar);
  */
 NEW_PROP_TAG(LinearSolverOverlapSize);
 
+/*!
+ * \brief Specifies whether the entries of the overlapping vectors are exchanged with
+ *        the processes on the same node via shared memory.
+ *
+ * This requires MPI-3. The processes on other nodes are still addressed using
+ * messages.
+ */
+NEW_PROP_TAG(LinearSolverUseSharedMemory);
+
+/*!
+ * \brief Specifies whether the rows of the overlapping linear system are numbered in
+ *        reverse Cuthill-McKee order instead of the order of the degrees of freedom.
+ *
+ * This only affects the linear solver, the discretization still uses the order of
+ * the grid's mappers.
+ */
+NEW_PROP_TAG(LinearSolverUseRcmOrdering);
+
+/*!
+ * \brief Specifies whether the linear operator is applied without the Jacobian matrix.
+ *
+ * If enabled, the products of the Jacobian matrix with vectors are approximated by
+ * finite differences of the residual (cf. MatrixFreeOverlappingOperator), i.e., the
+ * matrix is only used to build the preconditioner. This makes it possible to use an
+ * approximate Jacobian, e.g., the one of an earlier Newton iteration.
+ */
+NEW_PROP_TAG(LinearSolverMatrixFree);
+
+/*!
+ * \brief The number of solutions of previous linear solves which are used to construct
+ *        the initial guess of the linear solver.
+ *
+ * The initial guess is the linear combination of these solutions which minimizes the
+ * residual of the current system. Since the updates of consecutive Newton iterations
+ * and time steps are often similar, this reduces the number of iterations of the linear
+ * solver. A value of 0 means that the linear solver always starts with a zero guess.
+ */
+NEW_PROP_TAG(LinearSolverRecycledSolutions);
+
 /*!
  * \brief Maximum accepted error of the solution of the linear solver.
  */
@@ -103,6 +161,34 @@ NEW_PROP_TAG(LinearSolverVerbosity);
 //! Maximum number of iterations eyecuted by the linear solver
 NEW_PROP_TAG(LinearSolverMaxIterations);
 
+/*!
+ * \brief The algorithm used by the backends which are based on the stabilized BiCG
+ *        solver.
+ *
+ * The possible values are "bicgstab" and "pipelined-bicgstab". The latter only exhibits
+ * two non-blocking global reductions per iteration, which makes it more suitable for
+ * large numbers of processes.
+ */
+NEW_PROP_TAG(LinearSolverAlgorithm);
+
+/*!
+ * \brief Specifies whether the preconditioner should be reused by subsequent solves.
+ *
+ * If this is enabled, the preconditioner is only rebuilt if the sparsity pattern of the
+ * matrix has changed, if the linear solver did not converge or if the number of
+ * iterations has grown too much (cf. the PreconditionerReuseIterationFactor property).
+ */
+NEW_PROP_TAG(LinearSolverReusePreconditioner);
+
+/*!
+ * \brief The maximum factor by which the number of linear iterations may grow before a
+ *        reused preconditioner is rebuilt.
+ *
+ * The number of iterations is compared to the one of the first solve which used the
+ * current preconditioner.
+ */
+NEW_PROP_TAG(PreconditionerReuseIterationFactor);
+
 //! The order of the sequential preconditioner
 NEW_PROP_TAG(PreconditionerOrder);
 
@@ -169,17 +255,34 @@ protected:
     enum { dimWorld = GridView::dimensionworld };
 
 public:
-    ParallelBaseBackend(const Simulator& simulator)
+    ParallelBaseBackend(Simulator& simulator)
         : simulator_(simulator)
         , gridSequenceNumber_( -1 )
+        , transposed_(false)
+        , overlappingMemory_("Overlapping linear system")
     {
         overlappingMatrix_ = nullptr;
         overlappingb_ = nullptr;
         overlappingx_ = nullptr;
+
+        patternHash_ = 0;
+        patternMayHaveChanged_ = true;
+
+        precWrapperIsPrepared_ = false;
+        lastIterations_ = 0;
+        preCondReferenceIterations_ = 0;
+
+        tolerance_ = EWOMS_GET_PARAM(TypeTag, Scalar, LinearSolverTolerance);
     }
 
     ~ParallelBaseBackend()
-    { cleanup_(); }
+    {
+        // the implementation has already been destroyed at this point, so we can only
+        // release the resources of the sequential preconditioner ourselfs
+        if (precWrapperIsPrepared_)
+            precWrapper_.cleanup();
+        cleanup_();
+    }
 
     /*!
      * \brief Register all run-time parameters for the linear solver.
@@ -190,10 +293,28 @@ public:
                              "The maximum allowed error between of the linear solver");
         EWOMS_REGISTER_PARAM(TypeTag, unsigned, LinearSolverOverlapSize,
                              "The size of the algebraic overlap for the linear solver");
+        EWOMS_REGISTER_PARAM(TypeTag, bool, LinearSolverUseSharedMemory,
+                             "Exchange the overlap with the processes on the same node "
+                             "using shared memory");
+        EWOMS_REGISTER_PARAM(TypeTag, bool, LinearSolverUseRcmOrdering,
+                             "Number the rows of the linear system in reverse "
+                             "Cuthill-McKee order");
+        EWOMS_REGISTER_PARAM(TypeTag, bool, LinearSolverMatrixFree,
+                             "Approximate the products of the Jacobian matrix with vectors "
+                             "by finite differences of the residual. The matrix is then "
+                             "only used by the preconditioner");
+        EWOMS_REGISTER_PARAM(TypeTag, unsigned, LinearSolverRecycledSolutions,
+                             "The number of solutions of previous linear solves which are "
+                             "used to construct the initial guess of the linear solver");
         EWOMS_REGISTER_PARAM(TypeTag, int, LinearSolverMaxIterations,
                              "The maximum number of iterations of the linear solver");
         EWOMS_REGISTER_PARAM(TypeTag, int, LinearSolverVerbosity,
                              "The verbosity level of the linear solver");
+        EWOMS_REGISTER_PARAM(TypeTag, bool, LinearSolverReusePreconditioner,
+                             "Reuse the preconditioner for subsequent linear solves");
+        EWOMS_REGISTER_PARAM(TypeTag, Scalar, PreconditionerReuseIterationFactor,
+                             "The factor by which the number of linear iterations may grow "
+                             "before a reused preconditioner is rebuilt");
 
         PreconditionerWrapper::registerParameters();
     }
@@ -201,9 +322,36 @@ public:
     /*!
      * \brief Causes the solve() method to discared the structure of the linear system of
      *        equations the next time it is called.
+     *
+     * The overlap of the parallel linear system is only determined again if the
+     * sparsity pattern of the matrix has actually changed. Since the pattern usually
+     * only changes between a few variants (e.g., if wells are opened and shut), the
+     * overlaps of the most recently used patterns are kept.
      */
     void eraseMatrix()
-    { cleanup_(); }
+    {
+        releasePreconditioner_();
+        patternMayHaveChanged_ = true;
+    }
+
+    /*!
+     * \brief Returns the factor by which the linear solver reduces the residual.
+     *
+     * Unless it is changed using setTolerance(), this is the value of the
+     * LinearSolverTolerance parameter.
+     */
+    Scalar tolerance() const
+    { return tolerance_; }
+
+    /*!
+     * \brief Set the factor by which the linear solver reduces the residual.
+     *
+     * This is used by the next call to solve() or solveTransposed(). It allows e.g.
+     * the non-linear solver to solve the linear systems of early iterations less
+     * accurately.
+     */
+    void setTolerance(Scalar value)
+    { tolerance_ = value; }
 
     void prepareMatrix(const Matrix& M)
     {
@@ -213,10 +361,12 @@ public:
 
         // copy the interior values of the non-overlapping linear system of
         // equations to the overlapping one. On ther border, we add up
-        // the values of all processes (using the assignAdd() methods)
-        overlappingMatrix_->assignFromNative(M);
+        // the values of all processes (using the assignAdd() methods). the rows are
+        // scaled by the equation weights while they are copied.
+        overlappingMatrix_->assignFromNative(M, EqWeights_(simulator_));
 
         asImp_().rescale_();
+        updateSchurCorrection_();
 
         // synchronize all entries from their master processes and add entries on the
         // process border
@@ -246,23 +396,158 @@ public:
      * \return true if the residual reduction could be achieved, else false.
      */
     bool solve(Vector& x)
+    { return solve_(x, /*transposed=*/false); }
+
+    /*!
+     * \brief Solve the transposed linear system of equations.
+     *
+     * i.e., \f$M^T x = b\f$ is solved for the matrix and the right hand side which were
+     * passed to prepareMatrix() and prepareRhs(). This is required for adjoint
+     * systems. No second matrix is created: the linear operator and preconditioner are
+     * applied in transposed mode instead, which requires the preconditioner to support
+     * this.
+     *
+     * \return true if the residual reduction could be achieved, else false.
+     */
+    bool solveTransposed(Vector& x)
+    {
+        // the rows of the overlapping matrix have been scaled by the equation weights,
+        // which means that its columns are scaled for the transposed system. we thus
+        // need to undo the scaling of the right hand side and apply it to the solution
+        // instead. the scaled right hand side is restored afterwards, so that the
+        // system can be solved again without calling prepareRhs() in between.
+        OverlappingVector scaledRhs(*overlappingb_);
+        auto restoreRhsFn =
+            [this, &scaledRhs]() -> void
+            { *this->overlappingb_ = scaledRhs; };
+        GenericGuard<decltype(restoreRhsFn)> rhsGuard(restoreRhsFn);
+
+        const auto& overlap = overlappingMatrix_->overlap();
+        for (unsigned domesticRowIdx = 0; domesticRowIdx < overlap.numLocal(); ++domesticRowIdx) {
+            Index nativeRowIdx = overlap.domesticToNative(static_cast<Index>(domesticRowIdx));
+            auto& rhsEntry = (*overlappingb_)[domesticRowIdx];
+            for (unsigned i = 0; i < rhsEntry.size(); ++i)
+                rhsEntry[i] /= simulator_.model().eqWeight(nativeRowIdx, i);
+        }
+        overlappingb_->sync();
+
+        bool result = solve_(x, /*transposed=*/true);
+
+        for (unsigned domesticRowIdx = 0; domesticRowIdx < overlap.numLocal(); ++domesticRowIdx) {
+            Index nativeRowIdx = overlap.domesticToNative(static_cast<Index>(domesticRowIdx));
+            auto& xEntry = x[nativeRowIdx];
+            for (unsigned i = 0; i < xEntry.size(); ++i)
+                xEntry[i] *= simulator_.model().eqWeight(nativeRowIdx, i);
+        }
+
+        return result;
+    }
+
+    /*!
+     * \brief Returns the number of iterations which were required by the last linear
+     *        solve.
+     */
+    unsigned lastIterations() const
+    { return lastIterations_; }
+
+    /*!
+     * \brief Returns the timer which accumulates the time spent for setting up the
+     *        preconditioners.
+     *
+     * The timer is never reset, i.e., users interested in the time of a single setup
+     * need to look at the difference of two measurements.
+     */
+    const Ewoms::Timer& preconditionerSetupTimer() const
+    { return preCondSetupTimer_; }
+
+protected:
+    Implementation& asImp_()
+    { return *static_cast<Implementation *>(this); }
+
+    const Implementation& asImp_() const
+    { return *static_cast<const Implementation *>(this); }
+
+    bool solve_(Vector& x, bool transposed)
     {
+        bool reusePreCond =
+            preCond_
+            && transposed == transposed_
+            && EWOMS_GET_PARAM(TypeTag, bool, LinearSolverReusePreconditioner);
+
+        bool result = solveWithPreconditioner_(x, transposed, reusePreCond);
+        if (!result && reusePreCond)
+            // the outdated preconditioner may be the reason why the linear solver
+            // failed. try again using a fresh one.
+            result = solveWithPreconditioner_(x, transposed, /*reusePreCond=*/false);
+
+        return result;
+    }
+
+    bool solveWithPreconditioner_(Vector& x, bool transposed, bool reusePreCond)
+    {
+        typedef decltype(asImp_().preparePreconditioner_()) PreconditionerPointer;
+        typedef typename PreconditionerPointer::element_type Preconditioner;
+
         (*overlappingx_) = 0.0;
 
-        auto parPreCond = asImp_().preparePreconditioner_();
+        if (!reusePreCond) {
+            releasePreconditioner_();
+            transposed_ = transposed;
+            preCondSetupTimer_.start();
+            preCond_ = asImp_().preparePreconditioner_();
+            preCondSetupTimer_.stop();
+        }
+        auto parPreCond = std::static_pointer_cast<Preconditioner>(preCond_);
 
+        // the preconditioner is only kept if it is to be reused by the next solve. this
+        // must also be the case if an exception is thrown.
+        bool keepPreCond = false;
         auto cleanupPrecondFn =
-            [this]() -> void
-            { this->asImp_().cleanupPreconditioner_(); };
+            [this, &keepPreCond]() -> void
+            {
+                if (!keepPreCond)
+                    this->releasePreconditioner_();
+            };
 
         GenericGuard<decltype(cleanupPrecondFn)> precondGuard(cleanupPrecondFn);
 
         // create the parallel scalar product and the parallel operator
         ParallelScalarProduct parScalarProduct(overlappingMatrix_->overlap());
-        ParallelOperator parOperator(*overlappingMatrix_);
+        std::unique_ptr<ParallelOperator> parOperator(createOperator_(transposed));
+
+        // if solutions of previous solves are available, the linear solver only needs
+        // to compute the correction of the initial guess which is constructed from
+        // them. to this end, the right hand side is temporarily replaced by the
+        // residual of the initial guess and the relative tolerance is adapted so that
+        // the accuracy of the final solution stays the same.
+        std::unique_ptr<OverlappingVector> x0;
+        std::unique_ptr<OverlappingVector> origRhs;
+        if (!transposed && !recycledSolutions_.empty()) {
+            x0.reset(new OverlappingVector(*overlappingx_));
+            origRhs.reset(new OverlappingVector(*overlappingb_));
+            if (!computeRecycledGuess_(*parOperator, parScalarProduct, *x0, *overlappingb_))
+                x0.reset();
+        }
+
+        const Scalar origTolerance = tolerance_;
+        auto restoreRhsFn =
+            [this, &origRhs, origTolerance]() -> void
+            {
+                *this->overlappingb_ = *origRhs;
+                this->tolerance_ = origTolerance;
+            };
+        GenericGuard<decltype(restoreRhsFn)> rhsGuard(restoreRhsFn);
+        rhsGuard.setEnabled(static_cast<bool>(x0));
+
+        if (x0) {
+            Scalar bNorm = parScalarProduct.norm(*origRhs);
+            Scalar r0Norm = parScalarProduct.norm(*overlappingb_);
+            if (r0Norm > 0.0)
+                tolerance_ = std::min<Scalar>(1.0, origTolerance*bNorm/r0Norm);
+        }
 
         // retrieve the linear solver
-        auto solver = asImp_().prepareSolver_(parOperator,
+        auto solver = asImp_().prepareSolver_(*parOperator,
                                               parScalarProduct,
                                               *parPreCond);
 
@@ -274,71 +559,362 @@ public:
         // run the linear solver and have some fun
         bool result = asImp_().runSolver_(solver);
 
+        if (x0)
+            (*overlappingx_) += *x0;
+
+        // remember the solution for the initial guesses of the subsequent solves
+        if (result && !transposed)
+            recycleSolution_(*overlappingx_);
+
         // copy the result back to the non-overlapping vector
         overlappingx_->assignTo(x);
 
+        // decide whether the preconditioner can be reused by the next solve. the
+        // number of iterations of the first solve after the preconditioner has been
+        // built is used as a reference for the ones of the subsequent solves.
+        if (!reusePreCond)
+            preCondReferenceIterations_ = lastIterations_;
+        Scalar maxIterationFactor =
+            EWOMS_GET_PARAM(TypeTag, Scalar, PreconditionerReuseIterationFactor);
+        keepPreCond =
+            result
+            && EWOMS_GET_PARAM(TypeTag, bool, LinearSolverReusePreconditioner)
+            && lastIterations_ <= maxIterationFactor*std::max(1U, preCondReferenceIterations_);
+
         // return the result of the solver
         return result;
     }
 
-protected:
-    Implementation& asImp_()
-    { return *static_cast<Implementation *>(this); }
+    /*!
+     * \brief Compute the linear combination of the recycled solutions which minimizes
+     *        the residual of the current linear system.
+     *
+     * The images of the recycled solutions under the linear operator are orthonormalized
+     * using the modified Gram-Schmidt method, so the initial guess is the solution of
+     * the least squares problem in the space spanned by the recycled solutions.
+     *
+     * \param parOperator The linear operator of the current system
+     * \param parScalarProduct The scalar product of the overlapping vectors
+     * \param x0 Receives the initial guess
+     * \param r The right hand side of the system. It is overwritten by the residual
+     *          of the initial guess.
+     * \return false if no recycled solutions are available
+     */
+    bool computeRecycledGuess_(const ParallelOperator& parOperator,
+                               ParallelScalarProduct& parScalarProduct,
+                               OverlappingVector& x0,
+                               OverlappingVector& r)
+    {
+        if (recycledSolutions_.empty())
+            return false;
+
+        x0 = 0.0;
+
+        // the orthonormalized basis of the recycled space and its image
+        std::vector<std::unique_ptr<OverlappingVector> > basis;
+        std::vector<std::unique_ptr<OverlappingVector> > image;
+        for (size_t solIdx = 0; solIdx < recycledSolutions_.size(); ++solIdx) {
+            std::unique_ptr<OverlappingVector> u(new OverlappingVector(*recycledSolutions_[solIdx]));
+            std::unique_ptr<OverlappingVector> c(new OverlappingVector(*u));
+            parOperator.apply(*u, *c);
+
+            Scalar origNorm = parScalarProduct.norm(*c);
+            for (size_t basisIdx = 0; basisIdx < basis.size(); ++basisIdx) {
+                Scalar h = parScalarProduct.dot(*image[basisIdx], *c);
+                c->axpy(-h, *image[basisIdx]);
+                u->axpy(-h, *basis[basisIdx]);
+            }
 
-    const Implementation& asImp_() const
-    { return *static_cast<const Implementation *>(this); }
+            // ignore solutions which are (almost) linearly dependent on the previous
+            // ones
+            Scalar norm = parScalarProduct.norm(*c);
+            if (!(norm > 1e-10*origNorm) || norm <= 0.0)
+                continue;
+
+            (*c) /= norm;
+            (*u) /= norm;
+
+            // project the residual onto the new direction
+            Scalar alpha = parScalarProduct.dot(*c, r);
+            x0.axpy(alpha, *u);
+            r.axpy(-alpha, *c);
+
+            basis.push_back(std::move(u));
+            image.push_back(std::move(c));
+        }
+
+        return !basis.empty();
+    }
+
+    /*!
+     * \brief Add the solution of a linear solve to the recycled ones.
+     *
+     * At most LinearSolverRecycledSolutions solutions are kept, the oldest one is
+     * dropped first.
+     */
+    void recycleSolution_(const OverlappingVector& x)
+    {
+        size_t maxSolutions = EWOMS_GET_PARAM(TypeTag, unsigned, LinearSolverRecycledSolutions);
+        if (maxSolutions == 0)
+            return;
+
+        if (recycledSolutions_.size() >= maxSolutions)
+            recycledSolutions_.erase(recycledSolutions_.begin(),
+                                     recycledSolutions_.begin()
+                                     + (recycledSolutions_.size() - maxSolutions + 1));
+        recycledSolutions_.emplace_back(new OverlappingVector(x));
+    }
 
     void prepare_(const Matrix& M)
     {
-        // if grid has changed the sequence number has changed too
+        // if grid has changed the sequence number has changed too. in this case, the
+        // cached overlaps cannot be used anymore
         int curSeqNum = simulator_.gridManager().gridSequenceNumber();
-        if( gridSequenceNumber_ == curSeqNum && overlappingMatrix_)
-            // the grid has not changed since the overlappingMatrix_has been created, so
-            // there's noting to do
+        if (gridSequenceNumber_ != curSeqNum) {
+            overlapCache_.clear();
+            patternMayHaveChanged_ = true;
+        }
+
+        if (overlappingMatrix_ && !patternMayHaveChanged_)
+            // the sparsity pattern has not changed since the overlappingMatrix_ has been
+            // created, so there's noting to do
             return;
 
+        patternMayHaveChanged_ = false;
+        uint64_t patternHash = globalPatternHash_(M, communicator_());
+        if (overlappingMatrix_ && gridSequenceNumber_ == curSeqNum && patternHash_ == patternHash)
+            // eraseMatrix() has been called, but the sparsity pattern is still the
+            // same, so the overlapping matrix can be kept
+            return;
+
+        // the preconditioner refers to the current overlapping matrix
+        releasePreconditioner_();
         asImp_().cleanup_();
         gridSequenceNumber_ = curSeqNum;
-
-        BorderListCreator borderListCreator(simulator_.gridView(),
-                                            simulator_.model().dofMapper());
-
-        // create the overlapping Jacobian matrix
-        unsigned overlapSize = EWOMS_GET_PARAM(TypeTag, unsigned, LinearSolverOverlapSize);
-        overlappingMatrix_ = new OverlappingMatrix(M,
-                                                   borderListCreator.borderList(),
-                                                   borderListCreator.blackList(),
-                                                   overlapSize);
+        patternHash_ = patternHash;
+
+        // create the overlapping Jacobian matrix. the overlap is only determined if
+        // the current sparsity pattern has not been seen recently
+        std::shared_ptr<Overlap> overlap = cachedOverlap_(patternHash);
+        if (!overlap) {
+            BorderListCreator borderListCreator(simulator_.gridView(),
+                                                simulator_.model().dofMapper());
+
+            unsigned overlapSize = EWOMS_GET_PARAM(TypeTag, unsigned, LinearSolverOverlapSize);
+            bool useRcmOrdering = EWOMS_GET_PARAM(TypeTag, bool, LinearSolverUseRcmOrdering);
+            overlap = std::make_shared<Overlap>(M,
+                                                borderListCreator.borderList(),
+                                                borderListCreator.blackList(),
+                                                overlapSize,
+                                                communicator_(),
+                                                useRcmOrdering);
+            cacheOverlap_(patternHash, overlap);
+        }
+        overlappingMatrix_ = new OverlappingMatrix(M, overlap);
 
         // create the overlapping vectors for the residual and the
         // solution
-        overlappingb_ = new OverlappingVector(overlappingMatrix_->overlap());
+        bool useSharedMemory = EWOMS_GET_PARAM(TypeTag, bool, LinearSolverUseSharedMemory);
+        overlappingb_ = new OverlappingVector(overlappingMatrix_->overlap(), useSharedMemory);
         overlappingx_ = new OverlappingVector(*overlappingb_);
+        overlappingMemory_.set(memoryUsage(*overlappingMatrix_)
+                               + memoryUsage(*overlappingb_)
+                               + memoryUsage(*overlappingx_));
 
         // writeOverlapToVTK_();
     }
 
+    // returns a hash of the sparsity patterns of the matrices of all processes. the
+    // result is the same on all ranks, i.e., it can be used for collective decisions.
+    static uint64_t globalPatternHash_(const Matrix& M, MpiCommunicator comm OPM_UNUSED)
+    {
+        uint64_t hash = hashCombine_(M.N(), M.M());
+        const auto& rowEndIt = M.end();
+        for (auto rowIt = M.begin(); rowIt != rowEndIt; ++rowIt) {
+            hash = hashCombine_(hash, rowIt->size());
+            const auto& colEndIt = rowIt->end();
+            for (auto colIt = rowIt->begin(); colIt != colEndIt; ++colIt)
+                hash = hashCombine_(hash, colIt.index());
+        }
+
+#if HAVE_MPI
+        // mix in the rank and sum up the hashes of all processes. the final mixing step
+        // makes sure that changes on different ranks do not cancel out.
+        int myRank;
+        MPI_Comm_rank(comm, &myRank);
+        unsigned long long globalHash = mixHash_(hashCombine_(hash, static_cast<uint64_t>(myRank)));
+        MPI_Allreduce(MPI_IN_PLACE, &globalHash, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, comm);
+        hash = static_cast<uint64_t>(globalHash);
+#endif // HAVE_MPI
+
+        return hash;
+    }
+
+    // returns the MPI communicator of the grid view. if the grid does not use MPI for
+    // its communication, the default communicator is used.
+    MpiCommunicator communicator_() const
+    { return toMpiCommunicator(simulator_.gridView().comm()); }
+
+    static uint64_t hashCombine_(uint64_t hash, uint64_t value)
+    { return hash ^ (mixHash_(value) + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2)); }
+
+    // the finalizer of the SplitMix64 random number generator
+    static uint64_t mixHash_(uint64_t x)
+    {
+        x = (x ^ (x >> 30))*0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27))*0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    std::shared_ptr<Overlap> cachedOverlap_(uint64_t patternHash)
+    {
+        for (unsigned i = 0; i < overlapCache_.size(); ++i) {
+            if (overlapCache_[i].first != patternHash)
+                continue;
+
+            // move the overlap to the front of the cache
+            auto entry = overlapCache_[i];
+            overlapCache_.erase(overlapCache_.begin() + i);
+            overlapCache_.insert(overlapCache_.begin(), entry);
+            return entry.second;
+        }
+
+        return nullptr;
+    }
+
+    void cacheOverlap_(uint64_t patternHash, std::shared_ptr<Overlap> overlap)
+    {
+        overlapCache_.insert(overlapCache_.begin(), std::make_pair(patternHash, overlap));
+        if (overlapCache_.size() > maxCachedOverlaps_)
+            overlapCache_.pop_back();
+    }
+
+    // the row scaling of the overlapping matrix, i.e., the equation weights of the model
+    // the residual of the native system for the matrix-free linear operator
+    struct NativeSystem_
+    {
+        typedef Vector NativeVector;
+
+        NativeSystem_(Simulator& simulator)
+            : simulator_(simulator)
+        {}
+
+        Scalar perturbedResidual(Vector& dest, const Vector& direction) const
+        { return simulator_.model().linearizer().linearizePerturbedResidual(dest, direction); }
+
+        Scalar rowScaling(unsigned nativeRowIdx, unsigned eqIdx) const
+        { return simulator_.model().eqWeight(nativeRowIdx, eqIdx); }
+
+    private:
+        Simulator& simulator_;
+    };
+
+    typedef MatrixFreeOverlappingOperator<OverlappingMatrix,
+                                          OverlappingVector,
+                                          OverlappingVector,
+                                          NativeSystem_> MatrixFreeOperator;
+
+    // create the linear operator of the overlapping system. the matrix-free operator
+    // uses the right hand side as the residual of the current solution, so this must be
+    // called before the linear solver is run.
+    ParallelOperator* createOperator_(bool transposed)
+    {
+        if (!EWOMS_GET_PARAM(TypeTag, bool, LinearSolverMatrixFree))
+            return new ParallelOperator(*overlappingMatrix_, transposed, &schurCorrection_);
+
+        if (transposed)
+            OPM_THROW(Opm::NotImplemented,
+                      "Transposed linear systems cannot be solved matrix-free");
+        if (!schurCorrection_.empty())
+            OPM_THROW(Opm::NotImplemented,
+                      "The matrix-free linear operator does not support auxiliary modules "
+                      "which eliminate unknowns");
+
+        return new MatrixFreeOperator(*overlappingMatrix_,
+                                      *overlappingb_,
+                                      NativeSystem_(simulator_));
+    }
+
+    struct EqWeights_
+    {
+        EqWeights_(const Simulator& simulator)
+            : simulator_(simulator)
+        {}
+
+        Scalar operator()(unsigned nativeRowIdx, unsigned eqIdx) const
+        { return simulator_.model().eqWeight(nativeRowIdx, eqIdx); }
+
+    private:
+        const Simulator& simulator_;
+    };
+
+    // scale the right hand side by the equation weights. the rows of the overlapping
+    // matrix have already been scaled while they were copied from the native matrix.
     void rescale_()
     {
         const auto& overlap = overlappingMatrix_->overlap();
         for (unsigned domesticRowIdx = 0; domesticRowIdx < overlap.numLocal(); ++domesticRowIdx) {
             Index nativeRowIdx = overlap.domesticToNative(static_cast<Index>(domesticRowIdx));
-            auto& row = (*overlappingMatrix_)[domesticRowIdx];
-
-            auto colIt = row.begin();
-            const auto& colEndIt = row.end();
-            for (; colIt != colEndIt; ++ colIt) {
-                auto& entry = *colIt;
-                for (unsigned i = 0; i < entry.rows; ++i)
-                    entry[i] *= simulator_.model().eqWeight(nativeRowIdx, i);
-            }
-
             auto& rhsEntry = (*overlappingb_)[domesticRowIdx];
             for (unsigned i = 0; i < rhsEntry.size(); ++i)
                 rhsEntry[i] *= simulator_.model().eqWeight(nativeRowIdx, i);
         }
     }
 
+    // convert the couplings of the unknowns which have been eliminated by the auxiliary
+    // modules to the domestic indices and the scaling of the overlapping system
+    void updateSchurCorrection_()
+    {
+        typedef typename ParallelOperator::SchurCorrection::BlockVector CorrectionBlock;
+
+        schurCorrection_.clear();
+        const auto& nativeCorrection = simulator_.model().linearizer().schurCorrection();
+        const auto& overlap = overlappingMatrix_->overlap();
+        for (unsigned unknownIdx = 0; unknownIdx < nativeCorrection.numUnknowns(); ++unknownIdx) {
+            schurCorrection_.addUnknown(nativeCorrection.inverseDiagonal(unknownIdx));
+
+            unsigned endIdx = nativeCorrection.couplingsEnd(unknownIdx);
+            for (unsigned i = nativeCorrection.couplingsBegin(unknownIdx); i < endIdx; ++i) {
+                const auto& coupling = nativeCorrection.coupling(i);
+                Index nativeRowIdx = static_cast<Index>(coupling.rowIdx);
+
+                CorrectionBlock c;
+                CorrectionBlock b;
+                for (unsigned eqIdx = 0; eqIdx < c.size(); ++eqIdx) {
+                    c[eqIdx] = coupling.c[eqIdx]*simulator_.model().eqWeight(nativeRowIdx, eqIdx);
+                    b[eqIdx] = coupling.b[eqIdx];
+                }
+
+                Index domesticRowIdx = overlap.nativeToDomestic(nativeRowIdx);
+                schurCorrection_.addCoupling(static_cast<unsigned>(domesticRowIdx), c, b);
+            }
+        }
+    }
+
+    // returns true if the pipelined stabilized BiCG solver has been selected by the
+    // LinearSolverAlgorithm parameter
+    static bool usePipelinedBiCGStab_()
+    {
+        const std::string& algorithm = EWOMS_GET_PARAM(TypeTag, std::string, LinearSolverAlgorithm);
+        if (algorithm == "pipelined-bicgstab")
+            return true;
+        else if (algorithm != "bicgstab")
+            OPM_THROW(std::runtime_error,
+                      "Unknown linear solver algorithm '" << algorithm << "'. "
+                      "Possible values are 'bicgstab' and 'pipelined-bicgstab'");
+        return false;
+    }
+
+    // throw away the preconditioner which has been kept for reuse
+    void releasePreconditioner_()
+    {
+        if (!preCond_)
+            return;
+
+        asImp_().cleanupPreconditioner_();
+        preCond_.reset();
+    }
+
     void cleanup_()
     {
         // create the overlapping Jacobian matrix and vectors
@@ -349,6 +925,10 @@ protected:
         overlappingMatrix_ = 0;
         overlappingb_ = 0;
         overlappingx_ = 0;
+        overlappingMemory_.set(0);
+
+        // the recycled solutions refer to the old overlap
+        recycledSolutions_.clear();
     }
 
     std::shared_ptr<ParallelPreconditioner> preparePreconditioner_()
@@ -357,6 +937,7 @@ protected:
         try {
             // update sequential preconditioner
             precWrapper_.prepare(*overlappingMatrix_);
+            precWrapperIsPrepared_ = true;
         }
         catch (const Dune::Exception& e) {
             std::cout << "Preconditioner threw exception \"" << e.what()
@@ -371,13 +952,17 @@ protected:
         if (!preconditionerIsReady)
             OPM_THROW(Opm::NumericalProblem, "Creating the preconditioner failed");
 
+        precWrapper_.setTransposed(transposed_);
+
         // create the parallel preconditioner
         return std::make_shared<ParallelPreconditioner>(precWrapper_.get(), overlappingMatrix_->overlap());
     }
 
     void cleanupPreconditioner_()
     {
-        precWrapper_.cleanup();
+        if (precWrapperIsPrepared_)
+            precWrapper_.cleanup();
+        precWrapperIsPrepared_ = false;
     }
 
     void writeOverlapToVTK_()
@@ -417,14 +1002,50 @@ protected:
         }
     }
 
-    const Simulator& simulator_;
+    // the maximum number of overlaps which are kept for sparsity patterns that are not
+    // in use anymore
+    static const unsigned maxCachedOverlaps_ = 4;
+
+    Simulator& simulator_;
     int gridSequenceNumber_;
+    bool transposed_;
+
+    // the hash of the sparsity pattern of the current overlapping matrix and the
+    // overlaps which have recently been used, most recent first
+    uint64_t patternHash_;
+    bool patternMayHaveChanged_;
+    std::vector<std::pair<uint64_t, std::shared_ptr<Overlap> > > overlapCache_;
 
     OverlappingMatrix *overlappingMatrix_;
     OverlappingVector *overlappingb_;
     OverlappingVector *overlappingx_;
 
+    // the solutions of the most recent linear solves, oldest first
+    std::vector<std::unique_ptr<OverlappingVector> > recycledSolutions_;
+
+    // the couplings of the eliminated unknowns in terms of the overlapping system
+    typename ParallelOperator::SchurCorrection schurCorrection_;
+
     PreconditionerWrapper precWrapper_;
+    bool precWrapperIsPrepared_;
+
+    // the preconditioner of the last solve if it is kept for reuse. its type depends
+    // on the implementation.
+    std::shared_ptr<void> preCond_;
+
+    // the number of iterations of the last solve, and the one of the first solve
+    // after the preconditioner has been built. the former is set by the runSolver_()
+    // method of the implementation.
+    unsigned lastIterations_;
+    unsigned preCondReferenceIterations_;
+
+    // accumulates the time spent by preparePreconditioner_()
+    Ewoms::Timer preCondSetupTimer_;
+
+    // the relative tolerance of the linear solver
+    Scalar tolerance_;
+
+    MemoryRecord overlappingMemory_;
 };
 }} // namespace Linear, Ewoms
 
@@ -439,11 +1060,11 @@ SET_SCALAR_PROP(ParallelBaseLinearSolver, PreconditionerRelaxation, 1.0);
 //! set the preconditioner order to 0 by default
 SET_INT_PROP(ParallelBaseLinearSolver, PreconditionerOrder, 0);
 
-//! by default use the same kind of floating point values for the linearization and for
+//! by default use the same kind of floating point values for the Jacobian matrix and for
 //! the linear solve
 SET_TYPE_PROP(ParallelBaseLinearSolver,
               LinearSolverScalar,
-              typename GET_PROP_TYPE(TypeTag, Scalar));
+              typename GET_PROP_TYPE(TypeTag, JacobianScalar));
 
 SET_PROP(ParallelBaseLinearSolver, OverlappingMatrix)
 {
@@ -489,8 +1110,29 @@ SET_TYPE_PROP(ParallelBaseLinearSolver,
 //! set the default overlap size to 2
 SET_INT_PROP(ParallelBaseLinearSolver, LinearSolverOverlapSize, 2);
 
+//! exchange the overlap using messages by default
+SET_BOOL_PROP(ParallelBaseLinearSolver, LinearSolverUseSharedMemory, false);
+
+//! keep the order of the degrees of freedom for the linear system by default
+SET_BOOL_PROP(ParallelBaseLinearSolver, LinearSolverUseRcmOrdering, false);
+
+//! apply the linear operator using the Jacobian matrix by default
+SET_BOOL_PROP(ParallelBaseLinearSolver, LinearSolverMatrixFree, false);
+
+//! start the linear solver with a zero initial guess by default
+SET_UINT_PROP(ParallelBaseLinearSolver, LinearSolverRecycledSolutions, 0);
+
 //! set the default number of maximum iterations for the linear solver
 SET_INT_PROP(ParallelBaseLinearSolver, LinearSolverMaxIterations, 1000);
+
+//! rebuild the preconditioner for each solve by default
+SET_BOOL_PROP(ParallelBaseLinearSolver, LinearSolverReusePreconditioner, false);
+
+//! rebuild a reused preconditioner if the number of iterations has doubled
+SET_SCALAR_PROP(ParallelBaseLinearSolver, PreconditionerReuseIterationFactor, 2.0);
+
+//! use the classic stabilized BiCG algorithm by default
+SET_STRING_PROP(ParallelBaseLinearSolver, LinearSolverAlgorithm, "bicgstab");
 } // namespace Properties
 } // namespace Ewoms
 
@@ -95,10 +95,11 @@ class ParallelBiCGStabSolverBackend : public ParallelBaseBackend<TypeTag>
 
     typedef BiCGStabSolver<ParallelOperator,
                            OverlappingVector,
-                           ParallelPreconditioner> RawLinearSolver;
+                           ParallelPreconditioner,
+                           ParallelScalarProduct> RawLinearSolver;
 
 public:
-    ParallelBiCGStabSolverBackend(const Simulator& simulator)
+    ParallelBiCGStabSolverBackend(Simulator& simulator)
         : ParentType(simulator)
     { }
 
@@ -109,6 +110,9 @@ public:
         EWOMS_REGISTER_PARAM(TypeTag, Scalar, LinearSolverMaxError,
                              "The maximum residual error which the linear solver tolerates"
                              " without giving up");
+        EWOMS_REGISTER_PARAM(TypeTag, std::string, LinearSolverAlgorithm,
+                             "The algorithm of the stabilized BiCG linear solver. Possible "
+                             "values: 'bicgstab', 'pipelined-bicgstab'");
     }
 
 protected:
@@ -121,7 +125,7 @@ protected:
         const auto& gridView = this->simulator_.gridView();
         typedef CombinedCriterion<OverlappingVector, decltype(gridView.comm())> CCC;
 
-        Scalar linearSolverTolerance = EWOMS_GET_PARAM(TypeTag, Scalar, LinearSolverTolerance);
+        Scalar linearSolverTolerance = this->tolerance();
         Scalar linearSolverAbsTolerance = this->simulator_.model().newtonMethod().tolerance() / 10.0;
 
         convCrit_.reset(new CCC(gridView.comm(),
@@ -139,12 +143,17 @@ protected:
         bicgstabSolver->setMaxIterations(EWOMS_GET_PARAM(TypeTag, int, LinearSolverMaxIterations));
         bicgstabSolver->setLinearOperator(&parOperator);
         bicgstabSolver->setRhs(this->overlappingb_);
+        bicgstabSolver->setPipelined(ParentType::usePipelinedBiCGStab_());
 
         return bicgstabSolver;
     }
 
     bool runSolver_(std::shared_ptr<RawLinearSolver> solver)
-    { return solver->apply(*this->overlappingx_); }
+    {
+        bool result = solver->apply(*this->overlappingx_);
+        this->lastIterations_ = solver->report().iterations();
+        return result;
+    }
 
     void cleanupSolver_()
     { /* nothing to do */ }
@@ -0,0 +1,509 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ * \copydoc Ewoms::Linear::ParallelCprBackend
+ */
+#ifndef EWOMS_PARALLEL_CPR_BACKEND_HH
+#define EWOMS_PARALLEL_CPR_BACKEND_HH
+
+#include "parallelbasebackend.hh"
+#include "parallelamgbackend.hh"
+#include "bicgstabsolver.hh"
+#include "combinedcriterion.hh"
+#include "blockspmvkernels.hh"
+
+#include <opm/common/ErrorMacros.hpp>
+#include <opm/common/Exceptions.hpp>
+
+#include <dune/common/fmatrix.hh>
+#include <dune/common/fvector.hh>
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/bvector.hh>
+#include <dune/istl/preconditioner.hh>
+#include <dune/istl/paamg/amg.hh>
+#include <dune/istl/paamg/pinfo.hh>
+#include <dune/istl/owneroverlapcopy.hh>
+
+#include <memory>
+#include <vector>
+
+namespace Ewoms {
+namespace Linear {
+template <class TypeTag>
+class ParallelCprBackend;
+}
+
+namespace Properties {
+NEW_TYPE_TAG(ParallelCprLinearSolver, INHERITS_FROM(ParallelAmgLinearSolver));
+
+NEW_PROP_TAG(Indices);
+
+//! The index of the primary variable which is used as pressure by the CPR
+//! preconditioner
+NEW_PROP_TAG(CprPressureIndex);
+
+SET_INT_PROP(ParallelCprLinearSolver, CprPressureIndex,
+             GET_PROP_TYPE(TypeTag, Indices)::pressureSwitchIdx);
+
+SET_TYPE_PROP(ParallelCprLinearSolver, LinearSolverBackend,
+              Ewoms::Linear::ParallelCprBackend<TypeTag>);
+} // namespace Properties
+
+namespace Linear {
+/*!
+ * \ingroup Linear
+ *
+ * \brief Compute the quasi-IMPES weights of a row of a block matrix.
+ *
+ * The weights w solve D^T w = e_p where D is the diagonal block of the row and e_p the
+ * unit vector of the pressure. The weighted sum of the equations of the row thus only
+ * depends on the pressure of the row's own degree of freedom. If the diagonal block is
+ * singular, the equations are simply added up.
+ */
+template <class MatrixBlock, class VectorBlock>
+void computeQuasiImpesWeights(const MatrixBlock& diagBlock,
+                              VectorBlock& weights,
+                              unsigned pressureIdx)
+{
+    static const int numEq = VectorBlock::dimension;
+
+    MatrixBlock diagBlockTransposed;
+    for (int i = 0; i < numEq; ++i)
+        for (int j = 0; j < numEq; ++j)
+            diagBlockTransposed[i][j] = diagBlock[j][i];
+
+    VectorBlock unitPressure(0.0);
+    unitPressure[pressureIdx] = 1.0;
+
+    try {
+        diagBlockTransposed.solve(weights, unitPressure);
+    }
+    catch (const Dune::FMatrixError&) {
+        weights = 1.0;
+    }
+}
+
+/*!
+ * \ingroup Linear
+ *
+ * \brief A two-stage constrained pressure residual (CPR) preconditioner.
+ *
+ * The first stage approximately solves the pressure part of the linear system using
+ * a single cycle of an algebraic multi-grid preconditioner. The second stage then
+ * applies a smoother for the full system to the residual which remains after the
+ * pressure correction.
+ *
+ * The scalar pressure system is extracted from the rows of the block matrix using
+ * quasi-IMPES weights, i.e. the combination of the equations of each row is chosen
+ * such that the derivatives of the combined equation with respect to the primary
+ * variables of the row's own degree of freedom vanish except for the pressure.
+ */
+template <class Matrix, class Vector, class PressureVector, class PressureSolver, class Smoother>
+class CprPreconditioner : public Dune::Preconditioner<Vector, Vector>
+{
+    typedef typename Vector::block_type VectorBlock;
+
+public:
+    typedef Vector domain_type;
+    typedef Vector range_type;
+    typedef std::vector<VectorBlock> WeightVector;
+
+    enum { category = Dune::SolverCategory::overlapping };
+
+    CprPreconditioner(const Matrix& matrix,
+                      const WeightVector& weights,
+                      PressureSolver& pressureSolver,
+                      Smoother& smoother,
+                      unsigned pressureIdx)
+        : matrix_(matrix)
+        , weights_(weights)
+        , pressureSolver_(pressureSolver)
+        , smoother_(smoother)
+        , pressureIdx_(pressureIdx)
+    { }
+
+    void pre(domain_type& x, range_type& b)
+    {
+        pressureRhs_.resize(b.size());
+        pressureSol_.resize(b.size());
+        pressureRhs_ = 0.0;
+        pressureSol_ = 0.0;
+        residual_.reset(new range_type(b));
+        correction_.reset(new domain_type(x));
+
+        pressureSolver_.pre(pressureSol_, pressureRhs_);
+        smoother_.pre(x, b);
+    }
+
+    void apply(domain_type& x, const range_type& d)
+    {
+        // first stage: correct the pressure
+        const size_t numRows = d.size();
+        for (size_t rowIdx = 0; rowIdx < numRows; ++ rowIdx)
+            pressureRhs_[rowIdx] = weights_[rowIdx]*d[rowIdx];
+
+        pressureSol_ = 0.0;
+        pressureSolver_.apply(pressureSol_, pressureRhs_);
+
+        x = 0.0;
+        for (size_t rowIdx = 0; rowIdx < numRows; ++ rowIdx)
+            x[rowIdx][pressureIdx_] = pressureSol_[rowIdx];
+
+        // second stage: smooth the residual of the full system which remains after
+        // the pressure correction
+        *residual_ = d;
+        blockUsmv(-1.0, matrix_, x, *residual_);
+
+        *correction_ = 0.0;
+        smoother_.apply(*correction_, *residual_);
+        x += *correction_;
+    }
+
+    void post(domain_type& x)
+    {
+        pressureSolver_.post(pressureSol_);
+        smoother_.post(x);
+
+        residual_.reset();
+        correction_.reset();
+    }
+
+private:
+    const Matrix& matrix_;
+    const WeightVector& weights_;
+    PressureSolver& pressureSolver_;
+    Smoother& smoother_;
+    unsigned pressureIdx_;
+
+    PressureVector pressureRhs_;
+    PressureVector pressureSol_;
+    std::unique_ptr<range_type> residual_;
+    std::unique_ptr<domain_type> correction_;
+};
+
+/*!
+ * \ingroup Linear
+ *
+ * \brief Provides a linear solver backend which uses the stabilized BiCG solver and
+ *        a constrained pressure residual (CPR) preconditioner.
+ *
+ * The pressure system is solved using the parallel algebraic multi-grid (AMG)
+ * preconditioner from DUNE-ISTL, the smoother of the full system is specified by the
+ * PreconditionerWrapper property (ILU(0) by default). The primary variable which
+ * is used as pressure is given by the CprPressureIndex property. Its default is the
+ * pressure index of the black-oil model. The pressure system and its AMG hierarchy
+ * use the precision given by the AmgScalar property.
+ */
+template <class TypeTag>
+class ParallelCprBackend : public ParallelBaseBackend<TypeTag>
+{
+    typedef ParallelBaseBackend<TypeTag> ParentType;
+
+    typedef typename GET_PROP_TYPE(TypeTag, Scalar) Scalar;
+    typedef typename GET_PROP_TYPE(TypeTag, LinearSolverScalar) LinearSolverScalar;
+    typedef typename GET_PROP_TYPE(TypeTag, AmgScalar) AmgScalar;
+    typedef typename GET_PROP_TYPE(TypeTag, Simulator) Simulator;
+    typedef typename GET_PROP_TYPE(TypeTag, GridView) GridView;
+
+    typedef typename ParentType::ParallelOperator ParallelOperator;
+    typedef typename ParentType::OverlappingMatrix OverlappingMatrix;
+    typedef typename ParentType::OverlappingVector OverlappingVector;
+    typedef typename ParentType::ParallelPreconditioner ParallelPreconditioner;
+    typedef typename ParentType::ParallelScalarProduct ParallelScalarProduct;
+
+    static constexpr int numEq = GET_PROP_VALUE(TypeTag, NumEq);
+    static constexpr int pressureIdx = GET_PROP_VALUE(TypeTag, CprPressureIndex);
+    typedef Dune::FieldVector<LinearSolverScalar, numEq> VectorBlock;
+    typedef Dune::FieldMatrix<LinearSolverScalar, numEq, numEq> MatrixBlock;
+
+    // the pressure system is stored using the precision of the AMG
+    typedef Dune::FieldMatrix<AmgScalar, 1, 1> PressureMatrixBlock;
+    typedef Dune::FieldVector<AmgScalar, 1> PressureVectorBlock;
+    typedef Dune::BCRSMatrix<PressureMatrixBlock> PressureMatrix;
+    typedef Dune::BlockVector<PressureVectorBlock> PressureVector;
+
+    // the smoother used by the AMG for the pressure system
+    typedef Dune::SeqSOR<PressureMatrix, PressureVector, PressureVector> SequentialSmoother;
+
+#if HAVE_MPI
+    typedef Dune::OwnerOverlapCopyCommunication<Ewoms::Linear::Index>
+    OwnerOverlapCopyCommunication;
+    typedef Dune::OverlappingSchwarzOperator<PressureMatrix,
+                                             PressureVector,
+                                             PressureVector,
+                                             OwnerOverlapCopyCommunication> PressureOperator;
+    typedef Dune::BlockPreconditioner<PressureVector,
+                                      PressureVector,
+                                      OwnerOverlapCopyCommunication,
+                                      SequentialSmoother> ParallelSmoother;
+    typedef Dune::Amg::AMG<PressureOperator,
+                           PressureVector,
+                           ParallelSmoother,
+                           OwnerOverlapCopyCommunication> PressureAmg;
+#else
+    typedef Dune::MatrixAdapter<PressureMatrix, PressureVector, PressureVector> PressureOperator;
+    typedef SequentialSmoother ParallelSmoother;
+    typedef Dune::Amg::AMG<PressureOperator, PressureVector, ParallelSmoother> PressureAmg;
+#endif
+
+    typedef CprPreconditioner<OverlappingMatrix,
+                              OverlappingVector,
+                              PressureVector,
+                              PressureAmg,
+                              ParallelPreconditioner> CprPrecond;
+
+    typedef typename CprPrecond::WeightVector WeightVector;
+
+    typedef BiCGStabSolver<ParallelOperator,
+                           OverlappingVector,
+                           CprPrecond,
+                           ParallelScalarProduct> RawLinearSolver;
+
+    static_assert(0 <= pressureIdx && pressureIdx < numEq,
+                  "The pressure index of the CPR preconditioner must be a valid "
+                  "primary variable index");
+
+public:
+    ParallelCprBackend(Simulator& simulator)
+        : ParentType(simulator)
+    { }
+
+    static void registerParameters()
+    {
+        ParentType::registerParameters();
+
+        EWOMS_REGISTER_PARAM(TypeTag, Scalar, LinearSolverMaxError,
+                             "The maximum residual error which the linear solver tolerates"
+                             " without giving up");
+        EWOMS_REGISTER_PARAM(TypeTag, std::string, LinearSolverAlgorithm,
+                             "The algorithm of the stabilized BiCG linear solver. Possible "
+                             "values: 'bicgstab', 'pipelined-bicgstab'");
+        EWOMS_REGISTER_PARAM(TypeTag, int, AmgCoarsenTarget,
+                             "The coarsening target for the agglomerations of "
+                             "the AMG preconditioner");
+    }
+
+protected:
+    friend ParentType;
+
+    std::shared_ptr<CprPrecond> preparePreconditioner_()
+    {
+        // the pressure system would need to be extracted from the columns of the
+        // matrix for the transposed system
+        if (this->transposed_)
+            OPM_THROW(Opm::NotImplemented,
+                      "The CPR linear solver backend cannot solve transposed linear systems");
+
+        // the smoother for the full system
+        smoother_ = ParentType::preparePreconditioner_();
+
+        updatePressureSystem_();
+
+#if HAVE_MPI
+        // the pressure system exhibits the same parallel structure as the full system
+        istlComm_ = std::make_shared<OwnerOverlapCopyCommunication>(
+            this->overlappingMatrix_->overlap().communicator());
+        setupAmgIndexSet(this->overlappingMatrix_->overlap(), istlComm_->indexSet());
+        istlComm_->remoteIndices().template rebuild<false>();
+
+        pressureOperator_ = std::make_shared<PressureOperator>(*pressureMatrix_, *istlComm_);
+#else
+        pressureOperator_ = std::make_shared<PressureOperator>(*pressureMatrix_);
+#endif
+
+        setupPressureAmg_();
+
+        cprPreconditioner_ = std::make_shared<CprPrecond>(*this->overlappingMatrix_,
+                                                          weights_,
+                                                          *pressureAmg_,
+                                                          *smoother_,
+                                                          static_cast<unsigned>(pressureIdx));
+        return cprPreconditioner_;
+    }
+
+    void cleanupPreconditioner_()
+    {
+        cprPreconditioner_.reset();
+        smoother_.reset();
+
+        ParentType::cleanupPreconditioner_();
+    }
+
+    std::shared_ptr<RawLinearSolver> prepareSolver_(ParallelOperator& parOperator,
+                                                    ParallelScalarProduct& parScalarProduct,
+                                                    CprPrecond& parPreCond)
+    {
+        const auto& gridView = this->simulator_.gridView();
+        typedef CombinedCriterion<OverlappingVector, decltype(gridView.comm())> CCC;
+
+        Scalar linearSolverTolerance = this->tolerance();
+        Scalar linearSolverAbsTolerance = this->simulator_.model().newtonMethod().tolerance() / 10.0;
+
+        convCrit_.reset(new CCC(gridView.comm(),
+                                /*residualReductionTolerance=*/linearSolverTolerance,
+                                /*absoluteResidualTolerance=*/linearSolverAbsTolerance,
+                                EWOMS_GET_PARAM(TypeTag, Scalar, LinearSolverMaxError)));
+
+        auto bicgstabSolver =
+            std::make_shared<RawLinearSolver>(parPreCond, *convCrit_, parScalarProduct);
+
+        int verbosity = 0;
+        if (parOperator.overlap().myRank() == 0)
+            verbosity = EWOMS_GET_PARAM(TypeTag, int, LinearSolverVerbosity);
+        bicgstabSolver->setVerbosity(verbosity);
+        bicgstabSolver->setMaxIterations(EWOMS_GET_PARAM(TypeTag, int, LinearSolverMaxIterations));
+        bicgstabSolver->setLinearOperator(&parOperator);
+        bicgstabSolver->setRhs(this->overlappingb_);
+        bicgstabSolver->setPipelined(ParentType::usePipelinedBiCGStab_());
+
+        return bicgstabSolver;
+    }
+
+    bool runSolver_(std::shared_ptr<RawLinearSolver> solver)
+    {
+        bool result = solver->apply(*this->overlappingx_);
+        this->lastIterations_ = solver->report().iterations();
+        return result;
+    }
+
+    void cleanupSolver_()
+    { /* nothing to do */ }
+
+    void cleanup_()
+    {
+        // the sparsity pattern of the pressure matrix is the one of the overlapping
+        // matrix which is about to be deleted
+        pressureAmg_.reset();
+        pressureOperator_.reset();
+        pressureMatrix_.reset();
+
+        ParentType::cleanup_();
+    }
+
+    // compute the quasi-IMPES weights and the entries of the pressure matrix
+    void updatePressureSystem_()
+    {
+        const OverlappingMatrix& M = *this->overlappingMatrix_;
+        const size_t numRows = M.N();
+
+        if (!pressureMatrix_) {
+            pressureMatrix_.reset(new PressureMatrix(numRows,
+                                                     numRows,
+                                                     M.nonzeroes(),
+                                                     PressureMatrix::row_wise));
+            auto rowIt = pressureMatrix_->createbegin();
+            const auto& rowEndIt = pressureMatrix_->createend();
+            for (; rowIt != rowEndIt; ++rowIt) {
+                const auto& row = M[rowIt.index()];
+                auto colIt = row.begin();
+                const auto& colEndIt = row.end();
+                for (; colIt != colEndIt; ++colIt)
+                    rowIt.insert(colIt.index());
+            }
+        }
+
+        weights_.resize(numRows);
+        for (size_t rowIdx = 0; rowIdx < numRows; ++rowIdx) {
+            const auto& row = M[rowIdx];
+            VectorBlock& weights = weights_[rowIdx];
+
+            const auto& diagIt = row.find(rowIdx);
+            if (diagIt == row.end())
+                weights = 1.0;
+            else
+                computeQuasiImpesWeights(*diagIt, weights, static_cast<unsigned>(pressureIdx));
+
+            auto pressureColIt = (*pressureMatrix_)[rowIdx].begin();
+            auto colIt = row.begin();
+            const auto& colEndIt = row.end();
+            for (; colIt != colEndIt; ++colIt, ++pressureColIt) {
+                const MatrixBlock& block = *colIt;
+                LinearSolverScalar value = 0.0;
+                for (int eqIdx = 0; eqIdx < numEq; ++eqIdx)
+                    value += weights[eqIdx]*block[eqIdx][pressureIdx];
+                *pressureColIt = value;
+            }
+        }
+    }
+
+    void setupPressureAmg_()
+    {
+        pressureAmg_.reset();
+
+        int verbosity = 0;
+        if (this->simulator_.gridManager().gridView().comm().rank() == 0)
+            verbosity = EWOMS_GET_PARAM(TypeTag, int, LinearSolverVerbosity);
+
+        typedef typename Dune::Amg::SmootherTraits<ParallelSmoother>::Arguments SmootherArgs;
+
+        SmootherArgs smootherArgs;
+        smootherArgs.iterations = 1;
+        smootherArgs.relaxationFactor = 1.0;
+
+        typedef Dune::Amg::
+            CoarsenCriterion<Dune::Amg::SymmetricCriterion<PressureMatrix, Dune::Amg::FirstDiagonal> >
+            CoarsenCriterion;
+        int coarsenTarget = EWOMS_GET_PARAM(TypeTag, int, AmgCoarsenTarget);
+        CoarsenCriterion coarsenCriterion(/*maxLevel=*/15, coarsenTarget);
+        coarsenCriterion.setDefaultValuesAnisotropic(GridView::dimension,
+                                                     /*aggregateSizePerDim=*/3);
+        if (verbosity > 0)
+            coarsenCriterion.setDebugLevel(1);
+        else
+            coarsenCriterion.setDebugLevel(0); // make the AMG shut up
+
+        coarsenCriterion.setMinCoarsenRate(1.05);
+        coarsenCriterion.setAccumulate(Dune::Amg::atOnceAccu);
+        coarsenCriterion.setSkipIsolated(false);
+
+#if HAVE_MPI
+        pressureAmg_ = std::make_shared<PressureAmg>(*pressureOperator_,
+                                                     coarsenCriterion,
+                                                     smootherArgs,
+                                                     *istlComm_);
+#else
+        pressureAmg_ = std::make_shared<PressureAmg>(*pressureOperator_,
+                                                     coarsenCriterion,
+                                                     smootherArgs);
+#endif
+    }
+
+    std::unique_ptr<ConvergenceCriterion<OverlappingVector> > convCrit_;
+
+    WeightVector weights_;
+    std::shared_ptr<PressureMatrix> pressureMatrix_;
+    std::shared_ptr<PressureOperator> pressureOperator_;
+    std::shared_ptr<PressureAmg> pressureAmg_;
+    std::shared_ptr<ParallelPreconditioner> smoother_;
+    std::shared_ptr<CprPrecond> cprPreconditioner_;
+
+#if HAVE_MPI
+    std::shared_ptr<OwnerOverlapCopyCommunication> istlComm_;
+#endif
+};
+
+} // namespace Linear
+} // namespace Ewoms
+
+#endif
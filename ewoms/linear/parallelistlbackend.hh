@@ -96,7 +96,7 @@ class ParallelIstlSolverBackend : public ParallelBaseBackend<TypeTag>
     typedef typename GET_PROP_TYPE(TypeTag, GlobalEqVector) Vector;
 
 public:
-    ParallelIstlSolverBackend(const Simulator& simulator)
+    ParallelIstlSolverBackend(Simulator& simulator)
         : ParentType(simulator)
     { }
 
@@ -119,7 +119,8 @@ protected:
     {
         return solverWrapper_.get(parOperator,
                                   parScalarProduct,
-                                  parPreCond);
+                                  parPreCond,
+                                  this->tolerance());
     }
 
     void cleanupSolver_()
@@ -131,6 +132,7 @@ protected:
     {
         Dune::InverseOperatorResult result;
         solver->apply(*this->overlappingx_, *this->overlappingb_, result);
+        this->lastIterations_ = static_cast<unsigned>(result.iterations);
         return result.converged;
     }
 
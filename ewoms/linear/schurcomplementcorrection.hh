@@ -0,0 +1,198 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \copydoc Ewoms::Linear::SchurComplementCorrection
+ */
+#ifndef EWOMS_SCHUR_COMPLEMENT_CORRECTION_HH
+#define EWOMS_SCHUR_COMPLEMENT_CORRECTION_HH
+
+#include <dune/common/fvector.hh>
+
+#include <cassert>
+#include <vector>
+
+namespace Ewoms {
+namespace Linear {
+
+/*!
+ * \ingroup Linear
+ *
+ * \brief The couplings of the rows of a block matrix which stem from scalar unknowns
+ *        that have been eliminated from the linear system of equations.
+ *
+ * If the equation \f$d\,w + \sum_j b_j^T x_j = r_w\f$ of an additional unknown \f$w\f$
+ * is eliminated from the system \f$A x + \sum_i c_i w = r\f$, the remaining system is
+ * \f$(A - \sum_{i,j} c_i d^{-1} b_j^T) x = r - \sum_i c_i d^{-1} r_w\f$. The terms of the
+ * complement which are located on the main diagonal (\f$i = j\f$) are expected to be
+ * added to the matrix itself, so that they are seen by the preconditioner. This object
+ * stores the remaining off-diagonal terms, which couple rows that may not be neighbors
+ * in the sparsity pattern of the matrix, and applies them to vectors. This allows to
+ * eliminate e.g. the equations of wells without changing the sparsity pattern.
+ *
+ * The couplings of an eliminated unknown must be added directly after the unknown.
+ */
+template <class Scalar, int numEq>
+class SchurComplementCorrection
+{
+public:
+    typedef Dune::FieldVector<Scalar, numEq> BlockVector;
+
+    struct Coupling
+    {
+        // the index of the affected row of the matrix
+        unsigned rowIdx;
+
+        // the derivatives of the equations of the row w.r.t. the eliminated unknown
+        BlockVector c;
+
+        // the derivatives of the equation of the eliminated unknown w.r.t. the unknowns
+        // of the row
+        BlockVector b;
+    };
+
+    /*!
+     * \brief Remove all eliminated unknowns.
+     */
+    void clear()
+    {
+        inverseDiagonal_.clear();
+        couplingOffset_.clear();
+        couplings_.clear();
+    }
+
+    /*!
+     * \brief Returns true iff no unknowns have been eliminated.
+     */
+    bool empty() const
+    { return inverseDiagonal_.empty(); }
+
+    /*!
+     * \brief Returns the number of eliminated unknowns.
+     */
+    unsigned numUnknowns() const
+    { return inverseDiagonal_.size(); }
+
+    /*!
+     * \brief Add an eliminated unknown and return its index.
+     *
+     * \param inverseDiagonal The inverse of the derivative of the equation of the unknown
+     *                        w.r.t. the unknown itself
+     */
+    unsigned addUnknown(Scalar inverseDiagonal)
+    {
+        inverseDiagonal_.push_back(inverseDiagonal);
+        couplingOffset_.push_back(couplings_.size());
+        return inverseDiagonal_.size() - 1;
+    }
+
+    /*!
+     * \brief Add the coupling of a row of the matrix to the eliminated unknown which has
+     *        been added last.
+     */
+    void addCoupling(unsigned rowIdx, const BlockVector& c, const BlockVector& b)
+    {
+        assert(!empty());
+
+        Coupling coupling;
+        coupling.rowIdx = rowIdx;
+        coupling.c = c;
+        coupling.b = b;
+        couplings_.push_back(coupling);
+    }
+
+    /*!
+     * \brief Returns the inverse of the diagonal entry of an eliminated unknown.
+     */
+    Scalar inverseDiagonal(unsigned unknownIdx) const
+    { return inverseDiagonal_[unknownIdx]; }
+
+    /*!
+     * \brief Returns the index of the first coupling of an eliminated unknown.
+     */
+    unsigned couplingsBegin(unsigned unknownIdx) const
+    { return couplingOffset_[unknownIdx]; }
+
+    /*!
+     * \brief Returns the index after the last coupling of an eliminated unknown.
+     */
+    unsigned couplingsEnd(unsigned unknownIdx) const
+    {
+        if (unknownIdx + 1 < couplingOffset_.size())
+            return couplingOffset_[unknownIdx + 1];
+        return couplings_.size();
+    }
+
+    /*!
+     * \brief Returns a coupling of an eliminated unknown.
+     */
+    const Coupling& coupling(unsigned couplingIdx) const
+    { return couplings_[couplingIdx]; }
+
+    /*!
+     * \brief Add the off-diagonal part of the Schur complement applied to a vector:
+     *        \f$ y = y - \alpha \sum_{i \neq j} c_i d^{-1} b_j^T x_j \f$.
+     *
+     * If the transposed complement is to be applied, the roles of \f$b\f$ and \f$c\f$
+     * are swapped.
+     */
+    template <class DomainVector, class RangeVector>
+    void usmv(Scalar alpha, const DomainVector& x, RangeVector& y, bool transposed = false) const
+    {
+        for (unsigned unknownIdx = 0; unknownIdx < numUnknowns(); ++unknownIdx) {
+            unsigned begin = couplingsBegin(unknownIdx);
+            unsigned end = couplingsEnd(unknownIdx);
+
+            // the change of the equation of the eliminated unknown
+            Scalar sum = 0.0;
+            for (unsigned couplingIdx = begin; couplingIdx < end; ++couplingIdx) {
+                const Coupling& coupling = couplings_[couplingIdx];
+                const BlockVector& b = transposed ? coupling.c : coupling.b;
+                sum += b*x[coupling.rowIdx];
+            }
+
+            Scalar factor = alpha*inverseDiagonal_[unknownIdx];
+            for (unsigned couplingIdx = begin; couplingIdx < end; ++couplingIdx) {
+                const Coupling& coupling = couplings_[couplingIdx];
+                const BlockVector& b = transposed ? coupling.c : coupling.b;
+                const BlockVector& c = transposed ? coupling.b : coupling.c;
+
+                Scalar offDiagonalSum = sum - b*x[coupling.rowIdx];
+                auto& yBlock = y[coupling.rowIdx];
+                for (unsigned eqIdx = 0; eqIdx < numEq; ++eqIdx)
+                    yBlock[eqIdx] -= factor*offDiagonalSum*c[eqIdx];
+            }
+        }
+    }
+
+private:
+    std::vector<Scalar> inverseDiagonal_;
+    std::vector<unsigned> couplingOffset_;
+    std::vector<Coupling> couplings_;
+};
+
+} // namespace Linear
+} // namespace Ewoms
+
+#endif
@@ -0,0 +1,164 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ * \copydoc Ewoms::Linear::SeqTransposableIlu0
+ */
+#ifndef EWOMS_SEQ_TRANSPOSABLE_ILU0_HH
+#define EWOMS_SEQ_TRANSPOSABLE_ILU0_HH
+
+#include "blockspmvkernels.hh"
+
+#include <opm/common/Unused.hpp>
+
+#include <dune/istl/preconditioner.hh>
+#include <dune/istl/solvercategory.hh>
+#include <dune/istl/ilu.hh>
+
+namespace Ewoms {
+namespace Linear {
+
+/*!
+ * \ingroup Linear
+ *
+ * \brief A sequential ILU(0) preconditioner which can also be applied to the transposed
+ *        linear system.
+ *
+ * If it is not transposed, this preconditioner behaves exactly like Dune::SeqILU0. If it
+ * is, the transposed incomplete factors are applied, i.e., \f$(LU)^T v = d\f$ is solved
+ * using the factorization of the original matrix.
+ */
+template <class Matrix, class DomainVector, class RangeVector>
+class SeqTransposableIlu0 : public Dune::Preconditioner<DomainVector, RangeVector>
+{
+public:
+    //! export types
+    typedef Matrix matrix_type;
+    typedef DomainVector domain_type;
+    typedef RangeVector range_type;
+    typedef typename DomainVector::field_type field_type;
+
+    enum { category = Dune::SolverCategory::sequential };
+
+    SeqTransposableIlu0(const Matrix& A, field_type relaxationFactor)
+        : ilu_(A)
+        , relaxationFactor_(relaxationFactor)
+        , transposed_(false)
+    { Dune::bilu0_decomposition(ilu_); }
+
+    /*!
+     * \brief Specify whether the preconditioner is applied to the transposed system.
+     */
+    void setTransposed(bool yesno)
+    { transposed_ = yesno; }
+
+    /*!
+     * \brief Returns true iff the preconditioner is applied to the transposed system.
+     */
+    bool transposed() const
+    { return transposed_; }
+
+    virtual void pre(DomainVector& x OPM_UNUSED, RangeVector& b OPM_UNUSED)
+    {}
+
+    virtual void apply(DomainVector& v, const RangeVector& d)
+    {
+        if (transposed_)
+            transposedBacksolve_(v, d);
+        else
+            backsolve_(v, d);
+        v *= relaxationFactor_;
+    }
+
+    virtual void post(DomainVector& x OPM_UNUSED)
+    {}
+
+private:
+    // solve L U v = d. this is the same as Dune::bilu_backsolve(), but the blocks of
+    // each row are processed by the specialized row kernels.
+    void backsolve_(DomainVector& v, const RangeVector& d) const
+    {
+        typedef typename Matrix::block_type MatrixBlock;
+        typedef BlockRowKernel<field_type, MatrixBlock::rows> Kernel;
+        typedef typename RangeVector::block_type RangeBlock;
+
+        // L y = d, where L exhibits unit diagonal blocks
+        auto rowIt = ilu_.begin();
+        const auto& rowEndIt = ilu_.end();
+        for (; rowIt != rowEndIt; ++rowIt) {
+            auto rowIdx = rowIt.index();
+            const auto& diagIt = rowIt->find(rowIdx);
+            v[rowIdx] = d[rowIdx];
+            Kernel::usmv(-1.0, rowIt->begin(), diagIt, v, v[rowIdx]);
+        }
+
+        // U v = y, where the inverses of the diagonal blocks of U are stored
+        for (auto rowRevIt = ilu_.beforeEnd(); rowRevIt != ilu_.beforeBegin(); --rowRevIt) {
+            auto rowIdx = rowRevIt.index();
+            auto diagIt = rowRevIt->find(rowIdx);
+            const auto& diagBlock = *diagIt;
+
+            RangeBlock rhs(v[rowIdx]);
+            Kernel::usmv(-1.0, ++diagIt, rowRevIt->end(), v, rhs);
+            diagBlock.mv(rhs, v[rowIdx]);
+        }
+    }
+
+    // solve U^T L^T v = d. the strict lower part of 'ilu_' holds L (which exhibits unit
+    // diagonal blocks), the remaining part holds U, with the inverses of its diagonal
+    // blocks being stored.
+    void transposedBacksolve_(DomainVector& v, const RangeVector& d) const
+    {
+        RangeVector r(d);
+
+        // U^T y = d, where U^T is a lower triangular matrix
+        auto rowIt = ilu_.begin();
+        const auto& rowEndIt = ilu_.end();
+        for (; rowIt != rowEndIt; ++rowIt) {
+            auto rowIdx = rowIt.index();
+            auto colIt = rowIt->find(rowIdx);
+            const auto& colEndIt = rowIt->end();
+            colIt->mtv(r[rowIdx], v[rowIdx]);
+            for (++colIt; colIt != colEndIt; ++colIt)
+                colIt->mmtv(v[rowIdx], r[colIt.index()]);
+        }
+
+        // L^T v = y, where L^T is an upper triangular matrix with unit diagonal blocks
+        for (auto rowRevIt = ilu_.beforeEnd(); rowRevIt != ilu_.beforeBegin(); --rowRevIt) {
+            auto rowIdx = rowRevIt.index();
+            const auto& vi = v[rowIdx];
+            auto colIt = rowRevIt->begin();
+            for (; colIt.index() < rowIdx; ++colIt)
+                colIt->mmtv(vi, v[colIt.index()]);
+        }
+    }
+
+    Matrix ilu_;
+    field_type relaxationFactor_;
+    bool transposed_;
+};
+
+} // namespace Linear
+} // namespace Ewoms
+
+#endif
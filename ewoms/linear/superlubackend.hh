@@ -30,35 +30,56 @@
 #if HAVE_SUPERLU
 
 #include <ewoms/common/parametersystem.hh>
+#include <ewoms/common/timer.hh>
 
 #include <opm/common/Unused.hpp>
+#include <opm/common/ErrorMacros.hpp>
+#include <opm/common/Exceptions.hpp>
 
 #include <dune/istl/superlu.hh>
-#include <dune/common/fmatrix.hh>
-#include <dune/common/version.hh>
+
+#include <cmath>
+#include <iostream>
+#include <vector>
 
 namespace Ewoms {
 namespace Properties {
 // forward declaration of the required property tags
 NEW_PROP_TAG(Scalar);
-NEW_PROP_TAG(NumEq);
 NEW_PROP_TAG(Simulator);
 NEW_PROP_TAG(JacobianMatrix);
 NEW_PROP_TAG(GlobalEqVector);
 NEW_PROP_TAG(LinearSolverVerbosity);
 NEW_PROP_TAG(LinearSolverBackend);
 NEW_TYPE_TAG(SuperLULinearSolver);
+
+/*!
+ * \brief Specifies whether the row permutation of the previous factorization of a
+ *        matrix with the same sparsity pattern is reused.
+ *
+ * The column permutation and the elimination tree only depend on the sparsity pattern,
+ * so they are always reused if it did not change. Reusing the row permutation, i.e.,
+ * the pivots, additionally requires the values of the matrix to be similar to the ones
+ * of the previous factorization. If the matrix turns out to be singular with the old
+ * pivots, it is factorized from scratch.
+ */
+NEW_PROP_TAG(SuperLUReuseRowPermutation);
 } // namespace Properties
 } // namespace Ewoms
 
 namespace Ewoms {
 namespace Linear {
-template <class Scalar, class TypeTag, class Matrix, class Vector>
-class SuperLUSolve_;
+template <class TypeTag>
+class SuperLUFactorization_;
 
 /*!
  * \ingroup Linear
  * \brief A linear solver backend for the SuperLU sparse matrix library.
+ *
+ * The factorization of the matrix is kept until the matrix changes, so solving the
+ * transposed system does not require an additional factorization. The results of the
+ * symbolic analysis are reused as long as the sparsity pattern of the matrix stays the
+ * same, which is usually the case for all Newton iterations of a simulation.
  */
 template <class TypeTag>
 class SuperLUBackend
@@ -69,27 +90,55 @@ class SuperLUBackend
     typedef typename GET_PROP_TYPE(TypeTag, GlobalEqVector) Vector;
 
 public:
-    SuperLUBackend(Simulator& simulator OPM_UNUSED)
-    {}
+    SuperLUBackend(Simulator& simulator)
+        : simulator_(simulator)
+    {
+        M_ = nullptr;
+        b_ = nullptr;
+        isFactorized_ = false;
+    }
 
     static void registerParameters()
     {
         EWOMS_REGISTER_PARAM(TypeTag, int, LinearSolverVerbosity,
                              "The verbosity level of the linear solver");
+        EWOMS_REGISTER_PARAM(TypeTag, bool, SuperLUReuseRowPermutation,
+                             "Reuse the pivots of the previous factorization if the "
+                             "sparsity pattern of the matrix did not change");
     }
 
     /*!
      * \brief Causes the solve() method to discared the structure of the linear system of
      *        equations the next time it is called.
      *
-     * Since the SuperLU backend does not create any internal matrices, this is a no-op.
+     * For the SuperLU backend, this means that the results of the symbolic analysis of
+     * the matrix are not reused.
      */
     void eraseMatrix()
+    {
+        factorization_.discardPattern();
+        isFactorized_ = false;
+    }
+
+    /*!
+     * \brief Set the factor by which the linear solver reduces the residual.
+     *
+     * SuperLU is a direct solver, so the tolerance is ignored.
+     */
+    void setTolerance(Scalar value OPM_UNUSED)
     { }
 
     void prepareMatrix(const Matrix& M)
     {
+        // SuperLU factorizes the matrix itself, i.e., it cannot deal with couplings
+        // which are not part of it
+        if (!simulator_.model().linearizer().schurCorrection().empty())
+            OPM_THROW(Opm::NotImplemented,
+                      "The SuperLU backend does not support unknowns which are eliminated "
+                      "by auxiliary modules");
+
         M_ = &M;
+        isFactorized_ = false;
     }
 
     void prepareRhs(const Matrix& M OPM_UNUSED, Vector& b)
@@ -98,77 +147,318 @@ public:
     }
 
     bool solve(Vector& x)
-    { return SuperLUSolve_<Scalar, TypeTag, Matrix, Vector>::solve_(*M_, x, *b_); }
+    { return solve_(x, /*transposed=*/false); }
+
+    /*!
+     * \brief Solve the transposed linear system of equations.
+     *
+     * This uses the same factorization as the solve() method.
+     */
+    bool solveTransposed(Vector& x)
+    { return solve_(x, /*transposed=*/true); }
+
+    /*!
+     * \brief Returns the number of iterations which were required by the last linear
+     *        solve.
+     *
+     * SuperLU is a direct solver, so this is always 1.
+     */
+    unsigned lastIterations() const
+    { return 1; }
+
+    /*!
+     * \brief Returns the timer which accumulates the time spent for setting up the
+     *        preconditioners.
+     *
+     * SuperLU does not use a preconditioner, so this timer never runs.
+     */
+    const Ewoms::Timer& preconditionerSetupTimer() const
+    { return preCondSetupTimer_; }
 
 private:
+    bool solve_(Vector& x, bool transposed)
+    {
+        int verbosity = EWOMS_GET_PARAM(TypeTag, int, LinearSolverVerbosity);
+        if (!isFactorized_) {
+            bool reuseRowPerm = EWOMS_GET_PARAM(TypeTag, bool, SuperLUReuseRowPermutation);
+            isFactorized_ = factorization_.factorize(*M_, reuseRowPerm, verbosity);
+            if (!isFactorized_)
+                return false;
+        }
+
+        if (!factorization_.solve(x, *b_, transposed))
+            return false;
+
+        // make sure that the result only contains finite values.
+        Scalar tmp = 0;
+        for (unsigned i = 0; i < x.size(); ++i) {
+            const auto& xi = x[i];
+            for (unsigned j = 0; j < Vector::block_type::dimension; ++j)
+                tmp += xi[j];
+        }
+        return std::isfinite(tmp);
+    }
+
+    const Simulator& simulator_;
     const Matrix* M_;
     Vector* b_;
+    SuperLUFactorization_<TypeTag> factorization_;
+    bool isFactorized_;
+    Ewoms::Timer preCondSetupTimer_;
 };
 
-template <class Scalar, class TypeTag, class Matrix, class Vector>
-class SuperLUSolve_
+/*!
+ * \brief The LU factorization of a matrix computed by SuperLU.
+ *
+ * The matrix is always factorized in double precision because this is the most which
+ * SuperLU can handle. Its rows are passed to SuperLU in compressed column format, i.e.,
+ * SuperLU factorizes the transposed matrix. This is taken into account when solving.
+ */
+template <class TypeTag>
+class SuperLUFactorization_
 {
+    typedef typename GET_PROP_TYPE(TypeTag, JacobianMatrix) Matrix;
+    typedef typename GET_PROP_TYPE(TypeTag, GlobalEqVector) Vector;
+
+    enum { blockSize = Matrix::block_type::rows };
+
 public:
-    static bool solve_(const Matrix& A, Vector& x, const Vector& b)
+    SuperLUFactorization_()
     {
-        Vector bTmp(b);
+        numRows_ = 0;
+        hasMatrix_ = false;
+        hasFactors_ = false;
+        hasPattern_ = false;
+        equed_ = 'N';
+    }
 
-        int verbosity = EWOMS_GET_PARAM(TypeTag, int, LinearSolverVerbosity);
-        Dune::InverseOperatorResult result;
-        Dune::SuperLU<Matrix> solver(A, verbosity > 0);
-        solver.apply(x, bTmp, result);
-
-        if (result.converged) {
-            // make sure that the result only contains finite values.
-            Scalar tmp = 0;
-            for (unsigned i = 0; i < x.size(); ++i) {
-                const auto& xi = x[i];
-                for (unsigned j = 0; j < Vector::block_type::dimension; ++j)
-                    tmp += xi[j];
+    ~SuperLUFactorization_()
+    {
+        releaseFactors_();
+        releaseMatrix_();
+    }
+
+    /*!
+     * \brief Do not reuse the results of the symbolic analysis for the next
+     *        factorization.
+     */
+    void discardPattern()
+    { hasPattern_ = false; }
+
+    /*!
+     * \brief Factorize a matrix.
+     *
+     * If the sparsity pattern of the matrix is the same as the one of the previous
+     * factorization, the column permutation and the elimination tree are reused.
+     *
+     * \return false if the matrix is singular
+     */
+    bool factorize(const Matrix& M, bool reuseRowPerm, int verbosity)
+    {
+        bool samePattern = copyMatrix_(M) && hasPattern_;
+
+        int info = factorize_(samePattern, reuseRowPerm);
+        if (info != 0 && info <= numRows_ && samePattern && reuseRowPerm) {
+            // the old pivots are not suitable for the new matrix
+            if (verbosity > 0)
+                std::cout << "SuperLU: Pivots of the previous factorization are not "
+                          << "suitable anymore, factorizing from scratch\n";
+            copyMatrix_(M);
+            info = factorize_(samePattern, /*reuseRowPerm=*/false);
+        }
+
+        if (verbosity > 0)
+            std::cout << "SuperLU: Factorized a " << numRows_ << "x" << numRows_
+                      << " matrix, " << (samePattern ? "reused" : "computed")
+                      << " the symbolic analysis\n";
+
+        // a failed factorization cannot serve as the starting point of the next one
+        hasPattern_ = (info == 0 || info > numRows_);
+        return hasPattern_;
+    }
+
+    /*!
+     * \brief Solve the factorized linear system or its transposed.
+     */
+    bool solve(Vector& x, const Vector& b, bool transposed)
+    {
+        rhs_.resize(numRows_);
+        sol_.resize(numRows_);
+        for (unsigned i = 0; i < b.size(); ++i)
+            for (int j = 0; j < blockSize; ++j)
+                rhs_[i*blockSize + j] = static_cast<double>(b[i][j]);
+
+        superlu_options_t options;
+        set_default_options(&options);
+        options.Fact = FACTORED;
+        // SuperLU has factorized the transposed matrix
+        options.Trans = transposed ? NOTRANS : TRANS;
+
+        int info = callSuperLU_(options, /*numRhs=*/1);
+
+        for (unsigned i = 0; i < x.size(); ++i)
+            for (int j = 0; j < blockSize; ++j)
+                x[i][j] = sol_[i*blockSize + j];
+
+        return info == 0 || info > numRows_;
+    }
+
+private:
+    // copy the matrix into the compressed row storage of the object. returns true if
+    // the sparsity pattern is the same as the one of the previously copied matrix.
+    bool copyMatrix_(const Matrix& M)
+    {
+        int n = static_cast<int>(M.N())*blockSize;
+        int nnz = static_cast<int>(M.nonzeroes())*blockSize*blockSize;
+        bool samePattern = (n == numRows_ && static_cast<int>(values_.size()) == nnz);
+
+        rowPtr_.resize(n + 1);
+        colIdx_.resize(nnz);
+        values_.resize(nnz);
+
+        int k = 0;
+        auto rowIt = M.begin();
+        const auto& rowEndIt = M.end();
+        for (; rowIt != rowEndIt; ++rowIt) {
+            for (int i = 0; i < blockSize; ++i) {
+                int row = static_cast<int>(rowIt.index())*blockSize + i;
+                samePattern = samePattern && rowPtr_[row] == k;
+                rowPtr_[row] = k;
+
+                auto colIt = rowIt->begin();
+                const auto& colEndIt = rowIt->end();
+                for (; colIt != colEndIt; ++colIt) {
+                    for (int j = 0; j < blockSize; ++j) {
+                        int col = static_cast<int>(colIt.index())*blockSize + j;
+                        samePattern = samePattern && colIdx_[k] == col;
+                        colIdx_[k] = col;
+                        values_[k] = static_cast<double>((*colIt)[i][j]);
+                        ++ k;
+                    }
+                }
             }
-            result.converged = std::isfinite(tmp);
         }
+        rowPtr_[n] = k;
+        numRows_ = n;
 
-        return result.converged;
+        return samePattern;
     }
-};
 
-// the following is required to make the SuperLU adapter of dune-istl happy with
-// quadruple precision math on Dune 2.4. this is because the most which SuperLU can
-// handle is double precision (i.e., the linear systems of equations are always solved
-// with at most double precision if chosing SuperLU as the linear solver...)
-#if DUNE_VERSION_NEWER(DUNE_COMMON, 2,4) && HAVE_QUAD
-template <class TypeTag, class Matrix, class Vector>
-class SuperLUSolve_<__float128, TypeTag, Matrix, Vector>
-{
-public:
-    static bool solve_(const Matrix& A,
-                       Vector& x,
-                       const Vector& b)
+    int factorize_(bool samePattern, bool reuseRowPerm)
+    {
+        // if the row permutation is reused, SuperLU overwrites the L and U factors of the
+        // previous factorization in place, so they must be kept. otherwise, it allocates
+        // new ones.
+        bool reuseFactors = samePattern && reuseRowPerm && hasFactors_;
+        if (!reuseFactors)
+            releaseFactors_();
+        releaseMatrix_();
+
+        if (!samePattern) {
+            permC_.resize(numRows_);
+            permR_.resize(numRows_);
+            etree_.resize(numRows_);
+            R_.resize(numRows_);
+            C_.resize(numRows_);
+        }
+
+        dCreateCompCol_Matrix(&A_, numRows_, numRows_, static_cast<int>(values_.size()),
+                              values_.data(), colIdx_.data(), rowPtr_.data(),
+                              SLU_NC, SLU_D, SLU_GE);
+
+        hasMatrix_ = true;
+
+        superlu_options_t options;
+        set_default_options(&options);
+        if (samePattern)
+            options.Fact = reuseFactors ? SamePattern_SameRowPerm : SamePattern;
+
+        // only compute the factorization
+        int info = callSuperLU_(options, /*numRhs=*/0);
+        hasFactors_ = true;
+        return info;
+    }
+
+    int callSuperLU_(superlu_options_t& options, int numRhs)
+    {
+        SuperMatrix B;
+        SuperMatrix X;
+        dCreateDense_Matrix(&B, numRows_, numRhs, rhs_.data(), numRows_,
+                            SLU_DN, SLU_D, SLU_GE);
+        dCreateDense_Matrix(&X, numRows_, numRhs, sol_.data(), numRows_,
+                            SLU_DN, SLU_D, SLU_GE);
+
+        SuperLUStat_t stat;
+        StatInit(&stat);
+
+        mem_usage_t memUsage;
+        double rpg;
+        double rcond;
+        double ferr;
+        double berr;
+        int info;
+#if SUPERLU_MIN_VERSION_5
+        GlobalLU_t gLU;
+        dgssvx(&options, &A_, permC_.data(), permR_.data(), etree_.data(), &equed_,
+               R_.data(), C_.data(), &L_, &U_, /*work=*/nullptr, /*lwork=*/0, &B, &X,
+               &rpg, &rcond, &ferr, &berr, &gLU, &memUsage, &stat, &info);
+#else
+        dgssvx(&options, &A_, permC_.data(), permR_.data(), etree_.data(), &equed_,
+               R_.data(), C_.data(), &L_, &U_, /*work=*/nullptr, /*lwork=*/0, &B, &X,
+               &rpg, &rcond, &ferr, &berr, &memUsage, &stat, &info);
+#endif
+
+        StatFree(&stat);
+        Destroy_SuperMatrix_Store(&B);
+        Destroy_SuperMatrix_Store(&X);
+
+        return info;
+    }
+
+    void releaseFactors_()
     {
-        static const int numEq = GET_PROP_VALUE(TypeTag, NumEq);
-        typedef Dune::FieldVector<double, numEq> DoubleEqVector;
-        typedef Dune::FieldMatrix<double, numEq, numEq> DoubleEqMatrix;
-        typedef Dune::BlockVector<DoubleEqVector> DoubleVector;
-        typedef Dune::BCRSMatrix<DoubleEqMatrix> DoubleMatrix;
-
-        // copy the inputs into the double precision data structures
-        DoubleVector bDouble(b);
-        DoubleVector xDouble(x);
-        DoubleMatrix ADouble(A);
-
-        bool res =
-            SuperLUSolve_<double, TypeTag, Matrix, Vector>::solve_(ADouble,
-                                                                   xDouble,
-                                                                   bDouble);
-
-        // copy the result back into the quadruple precision vector.
-        x = xDouble;
-
-        return res;
+        if (!hasFactors_)
+            return;
+
+        Destroy_SuperNode_Matrix(&L_);
+        Destroy_CompCol_Matrix(&U_);
+        hasFactors_ = false;
     }
+
+    void releaseMatrix_()
+    {
+        if (!hasMatrix_)
+            return;
+
+        // the arrays of the matrix are owned by the object
+        Destroy_SuperMatrix_Store(&A_);
+        hasMatrix_ = false;
+    }
+
+    // the matrix in compressed row storage
+    int numRows_;
+    std::vector<int> rowPtr_;
+    std::vector<int> colIdx_;
+    std::vector<double> values_;
+
+    // the results of the symbolic analysis and of the equilibration
+    std::vector<int> permC_;
+    std::vector<int> permR_;
+    std::vector<int> etree_;
+    std::vector<double> R_;
+    std::vector<double> C_;
+    char equed_;
+    bool hasPattern_;
+
+    SuperMatrix A_;
+    bool hasMatrix_;
+    SuperMatrix L_;
+    SuperMatrix U_;
+    bool hasFactors_;
+
+    std::vector<double> rhs_;
+    std::vector<double> sol_;
 };
-#endif
 
 } // namespace Linear
 } // namespace Ewoms
@@ -176,6 +466,7 @@ public:
 namespace Ewoms {
 namespace Properties {
 SET_INT_PROP(SuperLULinearSolver, LinearSolverVerbosity, 0);
+SET_BOOL_PROP(SuperLULinearSolver, SuperLUReuseRowPermutation, true);
 SET_TYPE_PROP(SuperLULinearSolver, LinearSolverBackend,
               Ewoms::Linear::SuperLUBackend<TypeTag>);
 } // namespace Properties
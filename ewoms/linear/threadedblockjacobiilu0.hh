@@ -0,0 +1,234 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ * \copydoc Ewoms::Linear::ThreadedBlockJacobiIlu0
+ */
+#ifndef EWOMS_THREADED_BLOCK_JACOBI_ILU0_HH
+#define EWOMS_THREADED_BLOCK_JACOBI_ILU0_HH
+
+#include "seqtransposableilu0.hh"
+
+#include <opm/common/Unused.hpp>
+
+#include <dune/istl/preconditioner.hh>
+#include <dune/istl/solvercategory.hh>
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/bvector.hh>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace Ewoms {
+namespace Linear {
+
+/*!
+ * \ingroup Linear
+ *
+ * \brief A block-Jacobi preconditioner which applies ILU(0) to each block using a
+ *        separate thread.
+ *
+ * The rows of the matrix are split into as many contiguous blocks as OpenMP threads
+ * are available (i.e., the number of threads specified by the ThreadsPerProcess
+ * parameter). The blocks are chosen such that they exhibit roughly the same number of
+ * non-zero entries. The couplings between the blocks are ignored, so each block can be
+ * factorized and its triangular systems can be solved independently of the other ones.
+ * If the DOFs of the grid are enumerated in a spatially local fashion, the blocks
+ * correspond to compact subdomains of the process' part of the grid, and the
+ * preconditioner is usually only slightly less effective than ILU(0) for the complete
+ * matrix.
+ *
+ * Like the sequential ILU(0) preconditioner, this preconditioner can be applied to the
+ * transposed linear system.
+ */
+template <class Matrix, class DomainVector, class RangeVector>
+class ThreadedBlockJacobiIlu0 : public Dune::Preconditioner<DomainVector, RangeVector>
+{
+    typedef typename Matrix::block_type MatrixBlock;
+    typedef Dune::BCRSMatrix<MatrixBlock> SubMatrix;
+    typedef Dune::BlockVector<typename DomainVector::block_type> SubDomainVector;
+    typedef Dune::BlockVector<typename RangeVector::block_type> SubRangeVector;
+    typedef SeqTransposableIlu0<SubMatrix, SubDomainVector, SubRangeVector> SubPreconditioner;
+
+public:
+    //! export types
+    typedef Matrix matrix_type;
+    typedef DomainVector domain_type;
+    typedef RangeVector range_type;
+    typedef typename DomainVector::field_type field_type;
+
+    enum { category = Dune::SolverCategory::sequential };
+
+    ThreadedBlockJacobiIlu0(const Matrix& A, field_type relaxationFactor)
+    {
+        unsigned numBlocks = 1;
+#ifdef _OPENMP
+        numBlocks = static_cast<unsigned>(std::max(1, omp_get_max_threads()));
+#endif
+        numBlocks = std::max(1U, std::min<unsigned>(numBlocks, static_cast<unsigned>(A.N())));
+
+        partition_(A, numBlocks);
+
+        blocks_.resize(numBlocks);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static, 1)
+#endif
+        for (int blockIdx = 0; blockIdx < static_cast<int>(numBlocks); ++blockIdx)
+            createBlock_(A, blocks_[static_cast<unsigned>(blockIdx)],
+                         blockBegin_[static_cast<unsigned>(blockIdx)],
+                         blockBegin_[static_cast<unsigned>(blockIdx) + 1],
+                         relaxationFactor);
+    }
+
+    /*!
+     * \brief Returns the number of blocks into which the matrix has been split.
+     */
+    unsigned numBlocks() const
+    { return static_cast<unsigned>(blocks_.size()); }
+
+    /*!
+     * \brief Specify whether the preconditioner is applied to the transposed system.
+     */
+    void setTransposed(bool yesno)
+    {
+        for (unsigned blockIdx = 0; blockIdx < blocks_.size(); ++blockIdx)
+            blocks_[blockIdx].preCond->setTransposed(yesno);
+    }
+
+    virtual void pre(DomainVector& x OPM_UNUSED, RangeVector& b OPM_UNUSED)
+    {}
+
+    virtual void apply(DomainVector& v, const RangeVector& d)
+    {
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static, 1)
+#endif
+        for (int blockIdx = 0; blockIdx < static_cast<int>(blocks_.size()); ++blockIdx) {
+            Block& block = blocks_[static_cast<unsigned>(blockIdx)];
+            unsigned rowBegin = blockBegin_[static_cast<unsigned>(blockIdx)];
+            unsigned rowEnd = blockBegin_[static_cast<unsigned>(blockIdx) + 1];
+
+            for (unsigned rowIdx = rowBegin; rowIdx < rowEnd; ++rowIdx)
+                block.d[rowIdx - rowBegin] = d[rowIdx];
+
+            block.preCond->apply(block.v, block.d);
+
+            for (unsigned rowIdx = rowBegin; rowIdx < rowEnd; ++rowIdx)
+                v[rowIdx] = block.v[rowIdx - rowBegin];
+        }
+    }
+
+    virtual void post(DomainVector& x OPM_UNUSED)
+    {}
+
+private:
+    struct Block
+    {
+        std::unique_ptr<SubPreconditioner> preCond;
+        SubDomainVector v;
+        SubRangeVector d;
+    };
+
+    // split the rows into contiguous ranges which exhibit roughly the same number of
+    // non-zero entries
+    void partition_(const Matrix& A, unsigned numBlocks)
+    {
+        unsigned numRows = static_cast<unsigned>(A.N());
+        size_t numNonZeros = A.nonzeroes();
+        blockBegin_.resize(numBlocks + 1);
+        blockBegin_[0] = 0;
+
+        unsigned blockIdx = 1;
+        size_t curNonZeros = 0;
+        const auto& rowEndIt = A.end();
+        for (auto rowIt = A.begin(); rowIt != rowEndIt; ++rowIt) {
+            if (blockIdx < numBlocks && curNonZeros*numBlocks >= blockIdx*numNonZeros)
+                blockBegin_[blockIdx++] = static_cast<unsigned>(rowIt.index());
+            curNonZeros += rowIt->size();
+        }
+        for (; blockIdx <= numBlocks; ++blockIdx)
+            blockBegin_[blockIdx] = numRows;
+
+        // make sure that each block contains at least one row. this is possible
+        // because there are at most as many blocks as rows.
+        for (blockIdx = 1; blockIdx < numBlocks; ++blockIdx)
+            blockBegin_[blockIdx] = std::max(blockBegin_[blockIdx], blockBegin_[blockIdx - 1] + 1);
+        for (blockIdx = numBlocks - 1; blockIdx > 0; --blockIdx)
+            blockBegin_[blockIdx] = std::min(blockBegin_[blockIdx], blockBegin_[blockIdx + 1] - 1);
+    }
+
+    // create the diagonal block of the matrix for the rows [rowBegin, rowEnd) and
+    // factorize it
+    static void createBlock_(const Matrix& A,
+                             Block& block,
+                             unsigned rowBegin,
+                             unsigned rowEnd,
+                             field_type relaxationFactor)
+    {
+        size_t numNonZeros = 0;
+        for (unsigned rowIdx = rowBegin; rowIdx < rowEnd; ++rowIdx) {
+            const auto& colEndIt = A[rowIdx].end();
+            for (auto colIt = A[rowIdx].begin(); colIt != colEndIt; ++colIt)
+                if (rowBegin <= colIt.index() && colIt.index() < rowEnd)
+                    ++numNonZeros;
+        }
+
+        unsigned numRows = rowEnd - rowBegin;
+        SubMatrix subMatrix(numRows, numRows, numNonZeros, SubMatrix::row_wise);
+        for (auto rowIt = subMatrix.createbegin(); rowIt != subMatrix.createend(); ++rowIt) {
+            const auto& row = A[rowBegin + rowIt.index()];
+            const auto& colEndIt = row.end();
+            for (auto colIt = row.begin(); colIt != colEndIt; ++colIt)
+                if (rowBegin <= colIt.index() && colIt.index() < rowEnd)
+                    rowIt.insert(colIt.index() - rowBegin);
+        }
+
+        for (unsigned rowIdx = rowBegin; rowIdx < rowEnd; ++rowIdx) {
+            const auto& row = A[rowIdx];
+            auto& subRow = subMatrix[rowIdx - rowBegin];
+            const auto& colEndIt = row.end();
+            for (auto colIt = row.begin(); colIt != colEndIt; ++colIt)
+                if (rowBegin <= colIt.index() && colIt.index() < rowEnd)
+                    subRow[colIt.index() - rowBegin] = *colIt;
+        }
+
+        // the ILU(0) preconditioner copies the matrix, so the sub-matrix is not required
+        // anymore after it has been created
+        block.preCond.reset(new SubPreconditioner(subMatrix, relaxationFactor));
+        block.v.resize(numRows);
+        block.d.resize(numRows);
+    }
+
+    std::vector<unsigned> blockBegin_;
+    std::vector<Block> blocks_;
+};
+
+} // namespace Linear
+} // namespace Ewoms
+
+#endif
@@ -254,15 +254,38 @@ private:
     {
         residualError_ = 0.0;
         fixPointError_ = 0.0;
-        for (size_t i = 0; i < curResid.size(); ++i) {
-            for (unsigned j = 0; j < BlockType::dimension; ++j) {
-                residualError_ =
-                    std::max<Scalar>(residualError_,
-                                     residualWeight(i, j)*std::abs(curResid[i][j]));
-                fixPointError_ =
-                    std::max<Scalar>(fixPointError_,
-                                     std::abs(curSol[i][j] - lastSolVec_[i][j])
-                                     /std::max<Scalar>(1.0, curSol[i][j]));
+
+        // each thread determines the maxima of a part of the vectors
+        int n = static_cast<int>(curResid.size());
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+        {
+            Scalar threadResidualError = 0.0;
+            Scalar threadFixPointError = 0.0;
+
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+            for (int i = 0; i < n; ++i) {
+                unsigned blockIdx = static_cast<unsigned>(i);
+                for (unsigned j = 0; j < BlockType::dimension; ++j) {
+                    threadResidualError =
+                        std::max<Scalar>(threadResidualError,
+                                         residualWeight(blockIdx, j)*std::abs(curResid[blockIdx][j]));
+                    threadFixPointError =
+                        std::max<Scalar>(threadFixPointError,
+                                         std::abs(curSol[blockIdx][j] - lastSolVec_[blockIdx][j])
+                                         /std::max<Scalar>(1.0, curSol[blockIdx][j]));
+                }
+            }
+
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+            {
+                residualError_ = std::max(residualError_, threadResidualError);
+                fixPointError_ = std::max(fixPointError_, threadFixPointError);
             }
         }
         lastSolVec_ = curSol;
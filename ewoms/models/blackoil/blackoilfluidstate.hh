@@ -29,12 +29,15 @@
 #define EWOMS_BLACK_OIL_FLUID_STATE_HH
 
 #include "blackoilproperties.hh"
+#include "blackoilphaseconfig.hh"
 
 #include <opm/common/Valgrind.hpp>
 #include <opm/common/Unused.hpp>
 #include <opm/common/ErrorMacros.hpp>
 #include <opm/common/Exceptions.hpp>
 
+#include <array>
+
 namespace Ewoms {
 /*!
  * \ingroup BlackOilModel
@@ -44,12 +47,20 @@ namespace Ewoms {
  * I.e., it uses exactly the same quantities which are used by the ECL blackoil
  * model. Further quantities are computed "on the fly" and are accessing them is thus
  * relatively slow.
+ *
+ * Only the quantities of the phases which may be active according to the phase
+ * configuration of the model (cf. BlackOilPhaseConfig) are stored, and the gas
+ * dissolution and oil vaporization factors are only stored if the respective
+ * mechanisms may be enabled. For the remaining phases, the quantities are zero and
+ * setting them does not have any effect. This reduces the size of the intensive
+ * quantities, which are copied quite frequently.
  */
 template <class TypeTag>
 class BlackOilFluidState
 {
     typedef typename GET_PROP_TYPE(TypeTag, FluidSystem) FluidSystem;
     typedef typename GET_PROP_TYPE(TypeTag, Evaluation) Evaluation;
+    typedef Ewoms::BlackOilPhaseConfig<TypeTag> PhaseConfig;
 
     enum { waterPhaseIdx = FluidSystem::waterPhaseIdx };
     enum { gasPhaseIdx = FluidSystem::gasPhaseIdx };
@@ -64,6 +75,23 @@ public:
     enum { numPhases = FluidSystem::numPhases };
     enum { numComponents = FluidSystem::numComponents };
 
+private:
+    enum { numStoredPhases =
+           int(PhaseConfig::phaseMayBeActive(waterPhaseIdx))
+           + int(PhaseConfig::phaseMayBeActive(oilPhaseIdx))
+           + int(PhaseConfig::phaseMayBeActive(gasPhaseIdx)) };
+    enum { storeAllPhases = (int(numStoredPhases) == int(numPhases)) };
+    enum { storeRs =
+           GET_PROP_VALUE(TypeTag, BlackOilEnableDissolvedGas)
+           && PhaseConfig::phaseMayBeActive(oilPhaseIdx)
+           && PhaseConfig::phaseMayBeActive(gasPhaseIdx) };
+    enum { storeRv =
+           GET_PROP_VALUE(TypeTag, BlackOilEnableVaporizedOil)
+           && PhaseConfig::phaseMayBeActive(oilPhaseIdx)
+           && PhaseConfig::phaseMayBeActive(gasPhaseIdx) };
+
+public:
+
     /*!
      * \brief Make sure that all attributes are defined.
      *
@@ -77,14 +105,16 @@ public:
 #ifndef NDEBUG
         Opm::Valgrind::CheckDefined(pvtRegionIdx_);
 
-        for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++ phaseIdx) {
-            Opm::Valgrind::CheckDefined(saturation_[phaseIdx]);
-            Opm::Valgrind::CheckDefined(pressure_[phaseIdx]);
-            Opm::Valgrind::CheckDefined(invB_[phaseIdx]);
+        for (unsigned i = 0; i < numStoredPhases; ++ i) {
+            Opm::Valgrind::CheckDefined(saturation_[i]);
+            Opm::Valgrind::CheckDefined(pressure_[i]);
+            Opm::Valgrind::CheckDefined(invB_[i]);
         }
 
-        Opm::Valgrind::CheckDefined(Rs_);
-        Opm::Valgrind::CheckDefined(Rv_);
+        if (storeRs)
+            Opm::Valgrind::CheckDefined(Rs_[0]);
+        if (storeRv)
+            Opm::Valgrind::CheckDefined(Rv_[0]);
 #endif // NDEBUG
     }
 
@@ -102,52 +132,70 @@ public:
     { pvtRegionIdx_ = static_cast<unsigned short>(newPvtRegionIdx); }
 
     void setPressure(unsigned phaseIdx, const Evaluation& p)
-    { pressure_[phaseIdx] = p; }
+    {
+        if (isStored_(phaseIdx))
+            pressure_[storageIdx_(phaseIdx)] = p;
+    }
 
     void setSaturation(unsigned phaseIdx, const Evaluation& S)
-    { saturation_[phaseIdx] = S; }
+    {
+        if (isStored_(phaseIdx))
+            saturation_[storageIdx_(phaseIdx)] = S;
+    }
 
     void setInvB(unsigned phaseIdx, const Evaluation& b)
-    { invB_[phaseIdx] = b; }
+    {
+        if (isStored_(phaseIdx))
+            invB_[storageIdx_(phaseIdx)] = b;
+    }
 
     void setDensity(unsigned phaseIdx, const Evaluation& rho)
-    { density_[phaseIdx] = rho; }
+    {
+        if (isStored_(phaseIdx))
+            density_[storageIdx_(phaseIdx)] = rho;
+    }
 
     void setRs(const Evaluation& newRs)
-    { Rs_ = newRs; }
+    {
+        if (storeRs)
+            Rs_[0] = newRs;
+    }
 
     void setRv(const Evaluation& newRv)
-    { Rv_ = newRv; }
+    {
+        if (storeRv)
+            Rv_[0] = newRv;
+    }
 
     const Evaluation& pressure(unsigned phaseIdx) const
-    { return pressure_[phaseIdx]; }
+    { return isStored_(phaseIdx) ? pressure_[storageIdx_(phaseIdx)] : zero_; }
 
     const Evaluation& saturation(unsigned phaseIdx) const
-    { return saturation_[phaseIdx]; }
+    { return isStored_(phaseIdx) ? saturation_[storageIdx_(phaseIdx)] : zero_; }
 
     const Evaluation& temperature(unsigned phaseIdx OPM_UNUSED) const
     { return temperature_; }
 
     const Evaluation& invB(unsigned phaseIdx) const
-    { return invB_[phaseIdx]; }
+    { return isStored_(phaseIdx) ? invB_[storageIdx_(phaseIdx)] : zero_; }
 
     const Evaluation& Rs() const
-    { return Rs_; }
+    { return storeRs ? Rs_[0] : zero_; }
 
     const Evaluation& Rv() const
-    { return Rv_; }
+    { return storeRv ? Rv_[0] : zero_; }
 
     unsigned short pvtRegionIndex() const
     { return pvtRegionIdx_; }
 
     bool phaseIsPresent(unsigned phaseIdx) const
-    { return saturation_[phaseIdx] > 0.0; }
+    { return saturation(phaseIdx) > 0.0; }
 
     //////
     // slow methods
     //////
     Evaluation density(unsigned phaseIdx) const
-    { return density_[phaseIdx]; }
+    { return isStored_(phaseIdx) ? density_[storageIdx_(phaseIdx)] : zero_; }
 
     Evaluation molarDensity(unsigned phaseIdx) const
     {
@@ -277,13 +325,36 @@ public:
     }
 
 private:
+    // returns true iff the quantities of a phase are stored. if all phases may be
+    // active, this is known at compile time.
+    static bool isStored_(unsigned phaseIdx)
+    { return storeAllPhases || PhaseConfig::phaseMayBeActive(phaseIdx); }
+
+    // returns the position of the quantities of a phase in the arrays of the stored
+    // phases, i.e., the number of stored phases which have a smaller index
+    static unsigned storageIdx_(unsigned phaseIdx)
+    {
+        if (storeAllPhases)
+            return phaseIdx;
+
+        unsigned result = 0;
+        if (PhaseConfig::phaseMayBeActive(waterPhaseIdx) && waterPhaseIdx < phaseIdx)
+            ++result;
+        if (PhaseConfig::phaseMayBeActive(oilPhaseIdx) && oilPhaseIdx < phaseIdx)
+            ++result;
+        if (PhaseConfig::phaseMayBeActive(gasPhaseIdx) && gasPhaseIdx < phaseIdx)
+            ++result;
+        return result;
+    }
+
     static const Evaluation temperature_;
-    std::array<Evaluation, numPhases> pressure_;
-    std::array<Evaluation, numPhases> saturation_;
-    std::array<Evaluation, numPhases> invB_;
-    std::array<Evaluation, numPhases> density_;
-    Evaluation Rs_;
-    Evaluation Rv_;
+    static const Evaluation zero_;
+    std::array<Evaluation, numStoredPhases> pressure_;
+    std::array<Evaluation, numStoredPhases> saturation_;
+    std::array<Evaluation, numStoredPhases> invB_;
+    std::array<Evaluation, numStoredPhases> density_;
+    std::array<Evaluation, storeRs ? 1 : 0> Rs_;
+    std::array<Evaluation, storeRv ? 1 : 0> Rv_;
     unsigned short pvtRegionIdx_;
 };
 
@@ -291,6 +362,9 @@ template <class TypeTag>
 const typename BlackOilFluidState<TypeTag>::Evaluation BlackOilFluidState<TypeTag>::temperature_ =
     BlackOilFluidState<TypeTag>::FluidSystem::surfaceTemperature;
 
+template <class TypeTag>
+const typename BlackOilFluidState<TypeTag>::Evaluation BlackOilFluidState<TypeTag>::zero_ = 0.0;
+
 } // namespace Ewoms
 
 #endif
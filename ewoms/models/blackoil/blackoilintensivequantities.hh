@@ -29,6 +29,7 @@
 #define EWOMS_BLACK_OIL_INTENSIVE_QUANTITIES_HH
 
 #include "blackoilproperties.hh"
+#include "blackoilphaseconfig.hh"
 #include "blackoilfluidstate.hh"
 #include "blackoilsolventmodules.hh"
 #include "blackoilpolymermodules.hh"
@@ -63,6 +64,7 @@ class BlackOilIntensiveQuantities
     typedef typename GET_PROP_TYPE(TypeTag, Scalar) Scalar;
     typedef typename GET_PROP_TYPE(TypeTag, Evaluation) Evaluation;
     typedef typename GET_PROP_TYPE(TypeTag, FluidSystem) FluidSystem;
+    typedef Ewoms::BlackOilPhaseConfig<TypeTag> PhaseConfig;
     typedef typename GET_PROP_TYPE(TypeTag, MaterialLaw) MaterialLaw;
     typedef typename GET_PROP_TYPE(TypeTag, ElementContext) ElementContext;
     typedef typename GET_PROP_TYPE(TypeTag, PrimaryVariables) PrimaryVariables;
@@ -123,21 +125,24 @@ public:
         fluidState_.setPvtRegionIndex(pvtRegionIdx);
 
         // extract the water and the gas saturations for convenience
-        Evaluation Sw = priVars.makeEvaluation(Indices::waterSaturationIdx, timeIdx);
+        Evaluation Sw = priVars.makeEvaluation(Indices::waterSaturationIdx, timeIdx,
+                                               elemCtx.linearizationType());
 
         Evaluation Sg = 0.0;
         if( compositionSwitchEnabled )
         {
             if (priVars.primaryVarsMeaning() == PrimaryVariables::Sw_po_Sg)
                 // -> threephase case
-                Sg = priVars.makeEvaluation(Indices::compositionSwitchIdx, timeIdx);
+                Sg = priVars.makeEvaluation(Indices::compositionSwitchIdx, timeIdx,
+                                            elemCtx.linearizationType());
             else if (priVars.primaryVarsMeaning() == PrimaryVariables::Sw_pg_Rv) {
                 // -> gas-water case
                 Sg = 1 - Sw;
 
                 // deal with solvent
                 if (enableSolvent)
-                    Sg -= priVars.makeEvaluation(Indices::solventSaturationIdx, timeIdx);
+                    Sg -= priVars.makeEvaluation(Indices::solventSaturationIdx, timeIdx,
+                                                 elemCtx.linearizationType());
             }
             else
             {
@@ -154,7 +159,8 @@ public:
 
         // deal with solvent
         if (enableSolvent)
-            So -= priVars.makeEvaluation(Indices::solventSaturationIdx, timeIdx);
+            So -= priVars.makeEvaluation(Indices::solventSaturationIdx, timeIdx,
+                                         elemCtx.linearizationType());
 
         fluidState_.setSaturation(waterPhaseIdx, Sw);
         fluidState_.setSaturation(gasPhaseIdx, Sg);
@@ -169,13 +175,15 @@ public:
 
         //oil is the reference phase for pressure
         if (priVars.primaryVarsMeaning() == PrimaryVariables::Sw_pg_Rv) {
-            const Evaluation& pg = priVars.makeEvaluation(Indices::pressureSwitchIdx, timeIdx);
+            const Evaluation& pg = priVars.makeEvaluation(Indices::pressureSwitchIdx, timeIdx,
+                                                          elemCtx.linearizationType());
             for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++phaseIdx)
                 fluidState_.setPressure(phaseIdx, pg + (pC[phaseIdx] - pC[gasPhaseIdx]));
         }
 
         else {
-            const Evaluation& po = priVars.makeEvaluation(Indices::pressureSwitchIdx, timeIdx);
+            const Evaluation& po = priVars.makeEvaluation(Indices::pressureSwitchIdx, timeIdx,
+                                                          elemCtx.linearizationType());
             for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++phaseIdx)
                 fluidState_.setPressure(phaseIdx, po + (pC[phaseIdx] - pC[oilPhaseIdx]));
         }
@@ -189,29 +197,24 @@ public:
         asImp_().solventPostSatFuncUpdate_(elemCtx, dofIdx, timeIdx);
 
         Scalar SoMax = elemCtx.model().maxOilSaturation(globalSpaceIdx);
+        const auto& pvtTables = elemCtx.model().pvtTables();
 
         // take the meaning of the switiching primary variable into account for the gas
         // and oil phase compositions
         if (priVars.primaryVarsMeaning() == PrimaryVariables::Sw_po_Sg) {
             // in the threephase case, gas and oil phases are potentially present, i.e.,
             // we use the compositions of the gas-saturated oil and oil-saturated gas.
-            if (FluidSystem::enableDissolvedGas()) {
+            if (PhaseConfig::enableDissolvedGas()) {
                 const Evaluation& RsSat =
-                    FluidSystem::saturatedDissolutionFactor(fluidState_,
-                                                            oilPhaseIdx,
-                                                            pvtRegionIdx,
-                                                            SoMax);
+                    saturatedDissolutionFactor_(pvtTables, oilPhaseIdx, pvtRegionIdx, SoMax);
                 fluidState_.setRs(RsSat);
             }
             else
                 fluidState_.setRs(0.0);
 
-            if (FluidSystem::enableVaporizedOil()) {
+            if (PhaseConfig::enableVaporizedOil()) {
                 const Evaluation& RvSat =
-                    FluidSystem::saturatedDissolutionFactor(fluidState_,
-                                                            gasPhaseIdx,
-                                                            pvtRegionIdx,
-                                                            SoMax);
+                    saturatedDissolutionFactor_(pvtTables, gasPhaseIdx, pvtRegionIdx, SoMax);
                 fluidState_.setRv(RvSat);
             }
             else
@@ -220,17 +223,15 @@ public:
         else if (priVars.primaryVarsMeaning() == PrimaryVariables::Sw_po_Rs) {
             // if the switching variable is the mole fraction of the gas component in the
             // oil phase, we can directly set the composition of the oil phase
-            const auto& Rs = priVars.makeEvaluation(Indices::compositionSwitchIdx, timeIdx);
+            const auto& Rs = priVars.makeEvaluation(Indices::compositionSwitchIdx, timeIdx,
+                                                    elemCtx.linearizationType());
             fluidState_.setRs(Rs);
 
-            if (FluidSystem::enableVaporizedOil()) {
+            if (PhaseConfig::enableVaporizedOil()) {
                 // the gas phase is not present, but we need to compute its "composition"
                 // for the gravity correction anyway
                 const auto& RvSat =
-                    FluidSystem::saturatedDissolutionFactor(fluidState_,
-                                                            gasPhaseIdx,
-                                                            pvtRegionIdx,
-                                                            SoMax);
+                    saturatedDissolutionFactor_(pvtTables, gasPhaseIdx, pvtRegionIdx, SoMax);
 
                 fluidState_.setRv(RvSat);
             }
@@ -240,17 +241,15 @@ public:
         else {
             assert(priVars.primaryVarsMeaning() == PrimaryVariables::Sw_pg_Rv);
 
-            const auto& Rv = priVars.makeEvaluation(Indices::compositionSwitchIdx, timeIdx);
+            const auto& Rv = priVars.makeEvaluation(Indices::compositionSwitchIdx, timeIdx,
+                                                    elemCtx.linearizationType());
             fluidState_.setRv(Rv);
 
-            if (FluidSystem::enableDissolvedGas()) {
+            if (PhaseConfig::enableDissolvedGas()) {
                 // the oil phase is not present, but we need to compute its "composition" for
                 // the gravity correction anyway
                 const auto& RsSat =
-                    FluidSystem::saturatedDissolutionFactor(fluidState_,
-                                                            oilPhaseIdx,
-                                                            pvtRegionIdx,
-                                                            SoMax);
+                    saturatedDissolutionFactor_(pvtTables, oilPhaseIdx, pvtRegionIdx, SoMax);
 
                 fluidState_.setRs(RsSat);
             }
@@ -258,37 +257,56 @@ public:
                 fluidState_.setRs(0.0);
         }
 
-        typedef typename GET_PROP_TYPE(TypeTag, FluidSystem) FluidSystem;
-        typename FluidSystem::template ParameterCache<Evaluation> paramCache;
-        paramCache.setRegionIndex(pvtRegionIdx);
-        paramCache.setMaxOilSat(SoMax);
-        paramCache.updateAll(fluidState_);
-
         // compute the phase densities and transform the phase permeabilities into mobilities
-        for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++phaseIdx) {
-            if (!FluidSystem::phaseIsActive(phaseIdx))
-                continue;
+        if (pvtTables.isInitialized()) {
+            for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++phaseIdx) {
+                if (!PhaseConfig::phaseIsActive(phaseIdx))
+                    continue;
+
+                Evaluation R = 0.0;
+                if (phaseIdx == oilPhaseIdx)
+                    R = fluidState_.Rs();
+                else if (phaseIdx == gasPhaseIdx)
+                    R = fluidState_.Rv();
+
+                const auto& p = fluidState_.pressure(phaseIdx);
+                fluidState_.setInvB(phaseIdx,
+                                    pvtTables.inverseFormationVolumeFactor(phaseIdx, pvtRegionIdx, p, R));
+                mobility_[phaseIdx] /= pvtTables.viscosity(phaseIdx, pvtRegionIdx, p, R);
+            }
+        }
+        else {
+            typedef typename GET_PROP_TYPE(TypeTag, FluidSystem) FluidSystem;
+            typename FluidSystem::template ParameterCache<Evaluation> paramCache;
+            paramCache.setRegionIndex(pvtRegionIdx);
+            paramCache.setMaxOilSat(SoMax);
+            paramCache.updateAll(fluidState_);
+
+            for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++phaseIdx) {
+                if (!PhaseConfig::phaseIsActive(phaseIdx))
+                    continue;
 
-            const auto& b = FluidSystem::inverseFormationVolumeFactor(fluidState_, phaseIdx, pvtRegionIdx);
-            fluidState_.setInvB(phaseIdx, b);
+                const auto& b = FluidSystem::inverseFormationVolumeFactor(fluidState_, phaseIdx, pvtRegionIdx);
+                fluidState_.setInvB(phaseIdx, b);
 
-            const auto& mu = FluidSystem::viscosity(fluidState_, paramCache, phaseIdx);
-            mobility_[phaseIdx] /= mu;
+                const auto& mu = FluidSystem::viscosity(fluidState_, paramCache, phaseIdx);
+                mobility_[phaseIdx] /= mu;
+            }
         }
         Opm::Valgrind::CheckDefined(mobility_);
 
         // calculate the phase densities
         Evaluation rho;
-        if (FluidSystem::phaseIsActive(waterPhaseIdx)) {
+        if (PhaseConfig::phaseIsActive(waterPhaseIdx)) {
             rho = fluidState_.invB(waterPhaseIdx);
             rho *= FluidSystem::referenceDensity(waterPhaseIdx, pvtRegionIdx);
             fluidState_.setDensity(waterPhaseIdx, rho);
         }
 
-        if (FluidSystem::phaseIsActive(gasPhaseIdx)) {
+        if (PhaseConfig::phaseIsActive(gasPhaseIdx)) {
             rho = fluidState_.invB(gasPhaseIdx);
             rho *= FluidSystem::referenceDensity(gasPhaseIdx, pvtRegionIdx);
-            if (FluidSystem::enableVaporizedOil()) {
+            if (PhaseConfig::enableVaporizedOil()) {
                 rho +=
                     fluidState_.invB(gasPhaseIdx) *
                     fluidState_.Rv() *
@@ -297,10 +315,10 @@ public:
             fluidState_.setDensity(gasPhaseIdx, rho);
         }
 
-        if (FluidSystem::phaseIsActive(oilPhaseIdx)) {
+        if (PhaseConfig::phaseIsActive(oilPhaseIdx)) {
             rho = fluidState_.invB(oilPhaseIdx);
             rho *= FluidSystem::referenceDensity(oilPhaseIdx, pvtRegionIdx);
-            if (FluidSystem::enableDissolvedGas()) {
+            if (PhaseConfig::enableDissolvedGas()) {
                 rho +=
                     fluidState_.invB(oilPhaseIdx) *
                     fluidState_.Rs() *
@@ -309,14 +327,27 @@ public:
             fluidState_.setDensity(oilPhaseIdx, rho);
         }
 
-        // retrieve the porosity from the problem
-        porosity_ = problem.porosity(elemCtx, dofIdx, timeIdx);
+        // retrieve the porosity from the problem. if the problem publishes the static
+        // properties of the degrees of freedom, they are read directly from its arrays.
+        const auto& staticProps = problem.staticDofProperties();
+        if (!staticProps.porosity.empty())
+            porosity_ = staticProps.porosity[globalSpaceIdx];
+        else
+            porosity_ = problem.porosity(elemCtx, dofIdx, timeIdx);
 
         // the porosity must be modified by the compressibility of the
         // rock...
-        Scalar rockCompressibility = problem.rockCompressibility(elemCtx, dofIdx, timeIdx);
+        Scalar rockCompressibility;
+        if (!staticProps.rockCompressibility.empty())
+            rockCompressibility = staticProps.rockCompressibility[globalSpaceIdx];
+        else
+            rockCompressibility = problem.rockCompressibility(elemCtx, dofIdx, timeIdx);
         if (rockCompressibility > 0.0) {
-            Scalar rockRefPressure = problem.rockReferencePressure(elemCtx, dofIdx, timeIdx);
+            Scalar rockRefPressure;
+            if (!staticProps.rockReferencePressure.empty())
+                rockRefPressure = staticProps.rockReferencePressure[globalSpaceIdx];
+            else
+                rockRefPressure = problem.rockReferencePressure(elemCtx, dofIdx, timeIdx);
             Evaluation x = rockCompressibility*(fluidState_.pressure(oilPhaseIdx) - rockRefPressure);
             porosity_ *= 1.0 + x + 0.5*x*x;
         }
@@ -332,7 +363,7 @@ public:
 #ifndef NDEBUG
         // some safety checks in debug mode
         for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++ phaseIdx) {
-            if (!FluidSystem::phaseIsActive(phaseIdx))
+            if (!PhaseConfig::phaseIsActive(phaseIdx))
                 continue;
 
             assert(std::isfinite(Toolbox::value(fluidState_.density(phaseIdx))));
@@ -398,6 +429,20 @@ private:
     Implementation& asImp_()
     { return *static_cast<Implementation*>(this); }
 
+    template <class PvtTables>
+    Evaluation saturatedDissolutionFactor_(const PvtTables& pvtTables,
+                                           unsigned phaseIdx,
+                                           unsigned pvtRegionIdx,
+                                           Scalar SoMax) const
+    {
+        if (pvtTables.isInitialized())
+            return pvtTables.saturatedDissolutionFactor(phaseIdx,
+                                                        pvtRegionIdx,
+                                                        fluidState_.pressure(phaseIdx));
+
+        return FluidSystem::saturatedDissolutionFactor(fluidState_, phaseIdx, pvtRegionIdx, SoMax);
+    }
+
     FluidState fluidState_;
     Evaluation porosity_;
     Evaluation mobility_[numPhases];
@@ -29,6 +29,7 @@
 #define EWOMS_BLACK_OIL_LOCAL_RESIDUAL_HH
 
 #include "blackoilproperties.hh"
+#include "blackoilphaseconfig.hh"
 #include "blackoilsolventmodules.hh"
 #include "blackoilpolymermodules.hh"
 
@@ -51,6 +52,7 @@ class BlackOilLocalResidual : public GET_PROP_TYPE(TypeTag, DiscLocalResidual)
     typedef typename GET_PROP_TYPE(TypeTag, EqVector) EqVector;
     typedef typename GET_PROP_TYPE(TypeTag, RateVector) RateVector;
     typedef typename GET_PROP_TYPE(TypeTag, FluidSystem) FluidSystem;
+    typedef Ewoms::BlackOilPhaseConfig<TypeTag> PhaseConfig;
 
     enum { conti0EqIdx = Indices::conti0EqIdx };
     enum { numEq = GET_PROP_VALUE(TypeTag, NumEq) };
@@ -91,7 +93,7 @@ public:
         storage = 0.0;
 
         for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++phaseIdx) {
-            if (!FluidSystem::phaseIsActive(phaseIdx))
+            if (!PhaseConfig::phaseIsActive(phaseIdx))
                 continue;
 
             unsigned compIdx = FluidSystem::solventComponentIndex(phaseIdx);
@@ -103,14 +105,14 @@ public:
             storage[conti0EqIdx + compIdx] += surfaceVolume;
 
             // account for dissolved gas
-            if (phaseIdx == oilPhaseIdx && FluidSystem::enableDissolvedGas()) {
+            if (phaseIdx == oilPhaseIdx && PhaseConfig::enableDissolvedGas()) {
                 storage[conti0EqIdx + gasCompIdx] +=
                     Toolbox::template decay<LhsEval>(intQuants.fluidState().Rs())
                     * surfaceVolume;
             }
 
             // account for vaporized oil
-            if (phaseIdx == gasPhaseIdx && FluidSystem::enableVaporizedOil()) {
+            if (phaseIdx == gasPhaseIdx && PhaseConfig::enableVaporizedOil()) {
                 storage[conti0EqIdx + oilCompIdx] +=
                     Toolbox::template decay<LhsEval>(intQuants.fluidState().Rv())
                     * surfaceVolume;
@@ -138,22 +140,25 @@ public:
         {
             assert(FluidSystem::numActivePhases() == 2);
             const auto& priVars = elemCtx.primaryVars(dofIdx, timeIdx);
-            if (!FluidSystem::phaseIsActive(oilPhaseIdx)) {
+            if (!PhaseConfig::phaseIsActive(oilPhaseIdx)) {
                 // the gas-water case
                 const auto& eval =
-                    priVars.makeEvaluation(Indices::compositionSwitchIdx, /*timeIdx=*/0);
+                    priVars.makeEvaluation(Indices::compositionSwitchIdx, /*timeIdx=*/0,
+                                           elemCtx.linearizationType());
                 storage[conti0EqIdx + oilCompIdx] = Toolbox::template decay<LhsEval>(eval);
             }
-            else if (!FluidSystem::phaseIsActive(gasPhaseIdx)) {
+            else if (!PhaseConfig::phaseIsActive(gasPhaseIdx)) {
                 // the oil-water case
                 const auto& eval =
-                    priVars.makeEvaluation(Indices::compositionSwitchIdx, /*timeIdx=*/0);
+                    priVars.makeEvaluation(Indices::compositionSwitchIdx, /*timeIdx=*/0,
+                                           elemCtx.linearizationType());
                 storage[conti0EqIdx + gasCompIdx] = Toolbox::template decay<LhsEval>(eval);
             }
-            else if (!FluidSystem::phaseIsActive(waterPhaseIdx)) {
+            else if (!PhaseConfig::phaseIsActive(waterPhaseIdx)) {
                 // the oil-gas case
                 const auto& eval =
-                    priVars.makeEvaluation(Indices::waterSaturationIdx, /*timeIdx=*/0);
+                    priVars.makeEvaluation(Indices::waterSaturationIdx, /*timeIdx=*/0,
+                                           elemCtx.linearizationType());
                 storage[conti0EqIdx + waterCompIdx] = Toolbox::template decay<LhsEval>(eval);
             }
         }
@@ -174,7 +179,7 @@ public:
         const ExtensiveQuantities& extQuants = elemCtx.extensiveQuantities(scvfIdx, timeIdx);
         unsigned interiorIdx = extQuants.interiorIndex();
         for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++ phaseIdx) {
-            if (!FluidSystem::phaseIsActive(phaseIdx))
+            if (!PhaseConfig::phaseIsActive(phaseIdx))
                 continue;
 
             unsigned upIdx = static_cast<unsigned>(extQuants.upstreamIndex(phaseIdx));
@@ -224,7 +229,7 @@ protected:
             FluidSystem::referenceDensity(phaseIdx, pvtRegionIdx);
 
         // dissolved gas (in the oil phase).
-        if (phaseIdx == oilPhaseIdx && FluidSystem::enableDissolvedGas()) {
+        if (phaseIdx == oilPhaseIdx && PhaseConfig::enableDissolvedGas()) {
             flux[conti0EqIdx + gasCompIdx] +=
                 FluidSystem::referenceDensity(gasPhaseIdx, pvtRegionIdx)
                 * Toolbox::template decay<UpEval>(fs.Rs())
@@ -232,7 +237,7 @@ protected:
         }
 
         // vaporized oil (in the gas phase).
-        if (phaseIdx == gasPhaseIdx && FluidSystem::enableVaporizedOil()) {
+        if (phaseIdx == gasPhaseIdx && PhaseConfig::enableVaporizedOil()) {
             flux[conti0EqIdx + oilCompIdx] +=
                 FluidSystem::referenceDensity(oilPhaseIdx, pvtRegionIdx)
                 * Toolbox::template decay<UpEval>(fs.Rv())
@@ -44,6 +44,8 @@
 #include "blackoilsolventmodules.hh"
 #include "blackoilpolymermodules.hh"
 #include "blackoildarcyfluxmodule.hh"
+#include "blackoilpvttables.hh"
+#include "blackoilphaseconfig.hh"
 
 #include <ewoms/models/common/multiphasebasemodel.hh>
 #include <ewoms/io/vtkcompositionmodule.hh>
@@ -56,6 +58,7 @@
 
 #include <sstream>
 #include <string>
+#include <type_traits>
 
 namespace Ewoms {
 template <class TypeTag>
@@ -106,9 +109,23 @@ SET_TYPE_PROP(BlackOilModel, ExtensiveQuantities, Ewoms::BlackOilExtensiveQuanti
 //! (i.e., the polymer and solvent extensions)
 SET_TYPE_PROP(BlackOilModel, FluxModule, Ewoms::BlackOilDarcyFluxModule<TypeTag>);
 
-//! The indices required by the model
-SET_TYPE_PROP(BlackOilModel, Indices,
-              Ewoms::BlackOilIndices<GET_PROP_VALUE(TypeTag, EnableSolvent)?1:0, GET_PROP_VALUE(TypeTag, EnablePolymer)?1:0, /*PVOffset=*/0>);
+//! The indices required by the model. If the gas phase is disabled at compile time, the
+//! composition switching variable and the gas conservation equation are not required.
+SET_PROP(BlackOilModel, Indices)
+{
+private:
+    static const unsigned numSolvents = GET_PROP_VALUE(TypeTag, EnableSolvent)?1:0;
+    static const unsigned numPolymers = GET_PROP_VALUE(TypeTag, EnablePolymer)?1:0;
+    static const bool oilWaterOnly =
+        !GET_PROP_VALUE(TypeTag, BlackOilEnableGasPhase)
+        && GET_PROP_VALUE(TypeTag, BlackOilEnableOilPhase)
+        && GET_PROP_VALUE(TypeTag, BlackOilEnableWaterPhase);
+
+public:
+    typedef typename std::conditional<oilWaterOnly,
+                                      Ewoms::BlackOilTwoPhaseIndices<numSolvents, numPolymers, /*PVOffset=*/0>,
+                                      Ewoms::BlackOilIndices<numSolvents, numPolymers, /*PVOffset=*/0> >::type type;
+};
 
 //! Set the fluid system to the black-oil fluid system by default
 SET_PROP(BlackOilModel, FluidSystem)
@@ -125,6 +142,30 @@ public:
 SET_BOOL_PROP(BlackOilModel, EnableSolvent, false);
 SET_BOOL_PROP(BlackOilModel, EnablePolymer, false);
 
+// by default, the PVT properties are evaluated using the tables of the fluid system
+SET_INT_PROP(BlackOilModel, BlackOilPvtTableSamples, 0);
+SET_SCALAR_PROP(BlackOilModel, BlackOilPvtTableMinPressure, 1e5);
+SET_SCALAR_PROP(BlackOilModel, BlackOilPvtTableMaxPressure, 1e8);
+
+// by default, the phase configuration is only determined by the fluid system at runtime
+SET_BOOL_PROP(BlackOilModel, BlackOilEnableWaterPhase, true);
+SET_BOOL_PROP(BlackOilModel, BlackOilEnableOilPhase, true);
+SET_BOOL_PROP(BlackOilModel, BlackOilEnableGasPhase, true);
+SET_BOOL_PROP(BlackOilModel, BlackOilEnableDissolvedGas, true);
+SET_BOOL_PROP(BlackOilModel, BlackOilEnableVaporizedOil, true);
+
+// by default, the Newton method solves the fully implicit system in each iteration
+SET_BOOL_PROP(BlackOilModel, EnableSequentialImplicit, false);
+SET_SCALAR_PROP(BlackOilModel, SequentialMinErrorReduction, 0.7);
+SET_SCALAR_PROP(BlackOilModel, SequentialPressureTolerance, 1e-3);
+SET_INT_PROP(BlackOilModel, SequentialPressureMaxIterations, 200);
+SET_INT_PROP(BlackOilModel, SequentialTransportSweeps, 2);
+SET_INT_PROP(BlackOilModel, SequentialComponentSweeps, 5);
+
+// the pressure is not the first primary variable of the black-oil model
+SET_INT_PROP(BlackOilModel, CoarsePredictorPressureIndex,
+             GET_PROP_TYPE(TypeTag, Indices)::pressureSwitchIdx);
+
 } // namespace Properties
 
 /*!
@@ -233,6 +274,13 @@ public:
         // register runtime parameters of the VTK output modules
         Ewoms::VtkBlackOilModule<TypeTag>::registerParameters();
         Ewoms::VtkCompositionModule<TypeTag>::registerParameters();
+
+        EWOMS_REGISTER_PARAM(TypeTag, int, BlackOilPvtTableSamples,
+                             "The number of sampling points of the uniformly resampled PVT tables. 0 means that the tables of the fluid system are used directly");
+        EWOMS_REGISTER_PARAM(TypeTag, Scalar, BlackOilPvtTableMinPressure,
+                             "The minimum pressure of the uniformly resampled PVT tables [Pa]");
+        EWOMS_REGISTER_PARAM(TypeTag, Scalar, BlackOilPvtTableMaxPressure,
+                             "The maximum pressure of the uniformly resampled PVT tables [Pa]");
     }
 
     /*!
@@ -444,6 +492,63 @@ public:
         priVars.setPvtRegionIndex(pvtRegionIdx);
     }
 
+    /*!
+     * \copydoc FvBaseDiscretization::serializeBlocks
+     */
+    template <class Restarter>
+    void serializeBlocks(Restarter& res)
+    {
+        // write the primary variables. this includes the ones of the solvent and polymer
+        // modules.
+        ParentType::serializeBlocks(res);
+
+        // write the pseudo primary variables
+        const auto& sol = this->solution(/*timeIdx=*/0);
+        size_t numDof = this->numGridDof();
+        res.serializeSectionBegin("BlackOil");
+        res.template serializeBlock<unsigned>(numDof,
+                                              [&sol](size_t dofIdx)
+                                              { return sol[dofIdx].primaryVarsMeaning(); });
+        res.template serializeBlock<unsigned short>(numDof,
+                                                    [&sol](size_t dofIdx)
+                                                    { return sol[dofIdx].pvtRegionIndex(); });
+
+        const auto& maxOilSat = maxOilSaturation_;
+        res.template serializeBlock<Scalar>(maxOilSat.size(),
+                                            [&maxOilSat](size_t dofIdx)
+                                            { return maxOilSat[dofIdx]; });
+        res.serializeSectionEnd();
+    }
+
+    /*!
+     * \copydoc FvBaseDiscretization::deserializeBlocks
+     */
+    template <class Restarter>
+    void deserializeBlocks(Restarter& res)
+    {
+        ParentType::deserializeBlocks(res);
+
+        typedef typename PrimaryVariables::PrimaryVarsMeaning PVM;
+        auto& sol = this->solution(/*timeIdx=*/0);
+        size_t numDof = this->numGridDof();
+        res.deserializeSectionBegin("BlackOil");
+        res.template deserializeBlock<unsigned>(numDof,
+                                                [&sol](size_t dofIdx, unsigned value)
+                                                {
+                                                    PVM meaning = static_cast<PVM>(value);
+                                                    sol[dofIdx].setPrimaryVarsMeaning(meaning);
+                                                });
+        res.template deserializeBlock<unsigned short>(numDof,
+                                                      [&sol](size_t dofIdx, unsigned short value)
+                                                      { sol[dofIdx].setPvtRegionIndex(value); });
+
+        auto& maxOilSat = maxOilSaturation_;
+        res.template deserializeBlock<Scalar>(maxOilSat.size(),
+                                              [&maxOilSat](size_t dofIdx, Scalar value)
+                                              { maxOilSat[dofIdx] = value; });
+        res.deserializeSectionEnd();
+    }
+
     /*!
      * \brief Deserializes the state of the model.
      *
@@ -476,6 +581,36 @@ public:
         this->solution(/*timeIdx=*/1) = this->solution(/*timeIdx=*/0);
     }
 
+    /*!
+     * \copydoc FvBaseDiscretization::updateBegin
+     */
+    void updateBegin()
+    {
+        ParentType::updateBegin();
+
+        // the fluid system is initialized by the problem, so neither its phase
+        // configuration can be checked nor can the resampled PVT tables be computed
+        // before the simulation runs
+        BlackOilPhaseConfig<TypeTag>::checkFluidSystem();
+
+        if (!pvtTables_.isInitialized()) {
+            int numSamples = EWOMS_GET_PARAM(TypeTag, int, BlackOilPvtTableSamples);
+            if (numSamples > 0)
+                pvtTables_.init(static_cast<unsigned>(numSamples),
+                                EWOMS_GET_PARAM(TypeTag, Scalar, BlackOilPvtTableMinPressure),
+                                EWOMS_GET_PARAM(TypeTag, Scalar, BlackOilPvtTableMaxPressure));
+        }
+    }
+
+    /*!
+     * \brief Returns the uniformly resampled PVT tables.
+     *
+     * If the tables have not been computed, the intensive quantities use the fluid
+     * system directly.
+     */
+    const BlackOilPvtTables<TypeTag>& pvtTables() const
+    { return pvtTables_; }
+
     /*!
      * \brief Returns an elements maximum oil phase saturation observed during the
      *        simulation.
@@ -542,6 +677,11 @@ protected:
                                     unsigned timeIdx)
     { updatePvtRegionIndex_(priVars, context, dofIdx, timeIdx); }
 
+    // the primary variables can only be extrapolated if they have the same meaning
+    bool solutionIsExtrapolatable_(const PrimaryVariables& priVars,
+                                   const PrimaryVariables& otherPriVars) const
+    { return priVars.primaryVarsMeaning() == otherPriVars.primaryVarsMeaning(); }
+
     void registerOutputModules_()
     {
         ParentType::registerOutputModules_();
@@ -571,6 +711,7 @@ private:
     }
 
     std::vector<Scalar> maxOilSaturation_;
+    BlackOilPvtTables<TypeTag> pvtTables_;
 };
 } // namespace Ewoms
 
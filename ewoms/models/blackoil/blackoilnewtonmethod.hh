@@ -29,10 +29,15 @@
 #define EWOMS_BLACK_OIL_NEWTON_METHOD_HH
 
 #include "blackoilproperties.hh"
+#include "blackoilsequentialsolver.hh"
 
 #include <ewoms/common/signum.hh>
 
 #include <opm/common/Unused.hpp>
+#include <opm/common/ErrorMacros.hpp>
+#include <opm/common/Exceptions.hpp>
+
+#include <vector>
 
 namespace Ewoms {
 
@@ -40,6 +45,13 @@ namespace Ewoms {
  * \ingroup BlackOilModel
  *
  * \brief A newton solver which is specific to the black oil model.
+ *
+ * If the EnableSequentialImplicit parameter is set, the iterations of a time step
+ * alternate between pressure and transport steps (cf. BlackOilSequentialSolver) for
+ * as long as each pair of them reduces the error sufficiently. If the splitting error
+ * prevents this, the remaining iterations of the time step solve the fully implicit
+ * system. The convergence criterion is the one of the fully implicit system in either
+ * case.
  */
 template <class TypeTag>
 class BlackOilNewtonMethod : public GET_PROP_TYPE(TypeTag, DiscNewtonMethod)
@@ -58,7 +70,19 @@ class BlackOilNewtonMethod : public GET_PROP_TYPE(TypeTag, DiscNewtonMethod)
 
 public:
     BlackOilNewtonMethod(Simulator& simulator) : ParentType(simulator)
-    { }
+    {
+        numPriVarsSwitched_ = 0;
+        numPriVarsOscillating_ = 0;
+
+        enableSequentialImplicit_ = EWOMS_GET_PARAM(TypeTag, bool, EnableSequentialImplicit);
+        if (enableSequentialImplicit_ && simulator.gridView().comm().size() > 1)
+            OPM_THROW(Opm::NotImplemented,
+                      "Sequential-implicit iterations are only supported for sequential runs");
+
+        fullyImplicit_ = !enableSequentialImplicit_;
+        pressureStep_ = true;
+        lastSequentialError_ = -1.0;
+    }
 
     /*!
      * \brief Register all run-time parameters for the immiscible model.
@@ -66,6 +90,24 @@ public:
     static void registerParameters()
     {
         ParentType::registerParameters();
+
+        EWOMS_REGISTER_PARAM(TypeTag, bool, EnableSequentialImplicit,
+                             "Alternate between pressure and transport steps instead of "
+                             "solving the fully implicit system in each Newton iteration");
+        EWOMS_REGISTER_PARAM(TypeTag, Scalar, SequentialMinErrorReduction,
+                             "The factor by which a pair of pressure and transport steps "
+                             "must reduce the error. Otherwise, the remaining iterations of "
+                             "the time step are fully implicit");
+        BlackOilSequentialSolver<TypeTag>::registerParameters();
+    }
+
+    /*!
+     * \copydoc NewtonMethod::eraseMatrix
+     */
+    void eraseMatrix()
+    {
+        sequentialSolver_.eraseMatrix();
+        ParentType::eraseMatrix();
     }
 
     /*!
@@ -75,16 +117,53 @@ public:
     unsigned numPriVarsSwitched() const
     { return numPriVarsSwitched_; }
 
+    /*!
+     * \brief Returns the number of degrees of freedom which have switched their
+     *        interpretation in the most recent iteration after they already did so at
+     *        least twice during the current time step.
+     */
+    unsigned numPriVarsOscillating() const
+    { return numPriVarsOscillating_; }
+
+    /*!
+     * \brief Returns how often the interpretation of the primary variables of a degree
+     *        of freedom has changed during the current time step.
+     *
+     * This can be used to stabilize degrees of freedom which oscillate between two
+     * interpretations.
+     */
+    unsigned numPriVarsSwitches(unsigned globalDofIdx) const
+    {
+        if (globalDofIdx >= dofSwitchCount_.size())
+            return 0;
+        return dofSwitchCount_[globalDofIdx];
+    }
+
 protected:
     friend NewtonMethod<TypeTag>;
     friend ParentType;
 
+    /*!
+     * \copydoc FvBaseNewtonMethod::begin_
+     */
+    void begin_(const SolutionVector& u)
+    {
+        ParentType::begin_(u);
+
+        dofSwitchCount_.assign(this->model().numGridDof(), 0);
+
+        fullyImplicit_ = !enableSequentialImplicit_;
+        pressureStep_ = true;
+        lastSequentialError_ = -1.0;
+    }
+
     /*!
      * \copydoc FvBaseNewtonMethod::beginIteration_
      */
     void beginIteration_()
     {
         numPriVarsSwitched_ = 0;
+        numPriVarsOscillating_ = 0;
         ParentType::beginIteration_();
     }
 
@@ -108,10 +187,59 @@ protected:
 
         this->simulator_.model().newtonMethod().endIterMsg()
             << ", num switched=" << numPriVarsSwitched_;
+        if (numPriVarsOscillating_ > 0)
+            this->simulator_.model().newtonMethod().endIterMsg()
+                << ", num oscillating=" << numPriVarsOscillating_;
 
         ParentType::endIteration_(uCurrentIter, uLastIter);
     }
 
+    /*!
+     * \copydoc NewtonMethod::solveLinear_
+     */
+    bool solveLinear_(GlobalEqVector& solutionUpdate)
+    {
+        if (!fullyImplicit_ && pressureStep_) {
+            // the splitting error is too large if the last pair of pressure and
+            // transport steps did not reduce the error sufficiently
+            Scalar minReduction = EWOMS_GET_PARAM(TypeTag, Scalar, SequentialMinErrorReduction);
+            if (lastSequentialError_ >= 0.0 && this->error_ > minReduction*lastSequentialError_) {
+                fullyImplicit_ = true;
+                this->endIterMsg() << ", switched to fully implicit";
+            }
+            lastSequentialError_ = this->error_;
+        }
+
+        if (fullyImplicit_)
+            return ParentType::solveLinear_(solutionUpdate);
+
+        auto& linearizer = this->model().linearizer();
+        if (pressureStep_) {
+            bool converged = sequentialSolver_.solvePressure(linearizer.matrix(),
+                                                             linearizer.residual(),
+                                                             solutionUpdate);
+            this->numLinearIterations_ += sequentialSolver_.lastIterations();
+            if (!converged) {
+                fullyImplicit_ = true;
+                this->endIterMsg() << ", pressure step failed, switched to fully implicit";
+
+                solutionUpdate = 0.0;
+                return ParentType::solveLinear_(solutionUpdate);
+            }
+            this->endIterMsg() << ", pressure step";
+        }
+        else {
+            sequentialSolver_.solveTransport(linearizer.matrix(),
+                                             linearizer.residual(),
+                                             this->model().numGridDof(),
+                                             solutionUpdate);
+            this->endIterMsg() << ", transport step";
+        }
+
+        pressureStep_ = !pressureStep_;
+        return true;
+    }
+
     void update_(SolutionVector& nextSolution,
                  const SolutionVector& currentSolution,
                  const GlobalEqVector& solutionUpdate,
@@ -139,6 +267,7 @@ protected:
                       "A process did not succeed in adapting the primary variables");
 
         numPriVarsSwitched_ = comm.sum(numPriVarsSwitched_);
+        numPriVarsOscillating_ = comm.sum(numPriVarsOscillating_);
     }
 
     /*!
@@ -180,12 +309,40 @@ protected:
         }
 
         // switch the new primary variables to something which is physically meaningful
-        if (nextValue.adaptPrimaryVariables(this->problem(), globalDofIdx))
+        // this method is called concurrently by multiple threads
+        if (nextValue.adaptPrimaryVariables(this->problem(), globalDofIdx)) {
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
             ++ numPriVarsSwitched_;
+
+            // each degree of freedom is only updated by a single thread
+            if (globalDofIdx < dofSwitchCount_.size()) {
+                unsigned char& count = dofSwitchCount_[globalDofIdx];
+                if (count >= 2) {
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+                    ++ numPriVarsOscillating_;
+                }
+                if (count < 255)
+                    ++ count;
+            }
+        }
     }
 
 private:
     int numPriVarsSwitched_;
+    int numPriVarsOscillating_;
+    std::vector<unsigned char> dofSwitchCount_;
+
+    BlackOilSequentialSolver<TypeTag> sequentialSolver_;
+    bool enableSequentialImplicit_;
+    // true if the current time step has fallen back to fully implicit iterations
+    bool fullyImplicit_;
+    bool pressureStep_;
+    // the error before the last pair of pressure and transport steps
+    Scalar lastSequentialError_;
 };
 } // namespace Ewoms
 
@@ -0,0 +1,122 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \copydoc Ewoms::BlackOilPhaseConfig
+ */
+#ifndef EWOMS_BLACK_OIL_PHASE_CONFIG_HH
+#define EWOMS_BLACK_OIL_PHASE_CONFIG_HH
+
+#include "blackoilproperties.hh"
+
+#include <opm/common/ErrorMacros.hpp>
+#include <opm/common/Exceptions.hpp>
+
+namespace Ewoms {
+/*!
+ * \ingroup BlackOilModel
+ *
+ * \brief Combines the phase configuration of the black-oil model which is specified at
+ *        compile time with the one of the fluid system.
+ *
+ * The fluid system decides about the active phases and about dissolved gas and
+ * vaporized oil at runtime. If the BlackOilEnable* properties rule out some of them,
+ * the corresponding branches are removed by the compiler.
+ */
+template <class TypeTag>
+class BlackOilPhaseConfig
+{
+    typedef typename GET_PROP_TYPE(TypeTag, FluidSystem) FluidSystem;
+
+    enum { waterPhaseIdx = FluidSystem::waterPhaseIdx };
+    enum { oilPhaseIdx = FluidSystem::oilPhaseIdx };
+    enum { gasPhaseIdx = FluidSystem::gasPhaseIdx };
+
+    enum { enableWater = GET_PROP_VALUE(TypeTag, BlackOilEnableWaterPhase) };
+    enum { enableOil = GET_PROP_VALUE(TypeTag, BlackOilEnableOilPhase) };
+    enum { enableGas = GET_PROP_VALUE(TypeTag, BlackOilEnableGasPhase) };
+    enum { enableRs = GET_PROP_VALUE(TypeTag, BlackOilEnableDissolvedGas) };
+    enum { enableRv = GET_PROP_VALUE(TypeTag, BlackOilEnableVaporizedOil) };
+
+public:
+    /*!
+     * \brief Returns true iff a fluid phase may be active at compile time.
+     */
+    static constexpr bool phaseMayBeActive(unsigned phaseIdx)
+    {
+        return
+            (phaseIdx == waterPhaseIdx) ? bool(enableWater) :
+            (phaseIdx == oilPhaseIdx) ? bool(enableOil) :
+            (phaseIdx == gasPhaseIdx) ? bool(enableGas) :
+            false;
+    }
+
+    /*!
+     * \brief Returns true iff a fluid phase is considered by the simulation.
+     */
+    static bool phaseIsActive(unsigned phaseIdx)
+    { return phaseMayBeActive(phaseIdx) && FluidSystem::phaseIsActive(phaseIdx); }
+
+    /*!
+     * \brief Returns true iff gas can dissolve in the oil phase.
+     */
+    static bool enableDissolvedGas()
+    { return enableRs && enableOil && enableGas && FluidSystem::enableDissolvedGas(); }
+
+    /*!
+     * \brief Returns true iff oil can vaporize into the gas phase.
+     */
+    static bool enableVaporizedOil()
+    { return enableRv && enableOil && enableGas && FluidSystem::enableVaporizedOil(); }
+
+    /*!
+     * \brief Throws an exception if the fluid system requires a phase or a mechanism
+     *        which has been disabled at compile time.
+     *
+     * This must be called after the fluid system has been initialized.
+     */
+    static void checkFluidSystem()
+    {
+        static const char* phaseNames[] = { "water", "oil", "gas" };
+        const unsigned phaseIndices[] = { waterPhaseIdx, oilPhaseIdx, gasPhaseIdx };
+        for (unsigned i = 0; i < 3; ++i) {
+            unsigned phaseIdx = phaseIndices[i];
+            if (FluidSystem::phaseIsActive(phaseIdx) && !phaseMayBeActive(phaseIdx))
+                OPM_THROW(std::runtime_error,
+                          "The " << phaseNames[i] << " phase is active, but it has "
+                          "been disabled at compile time");
+        }
+
+        if (FluidSystem::enableDissolvedGas() && !enableDissolvedGas())
+            OPM_THROW(std::runtime_error,
+                      "Dissolved gas is enabled, but it has been disabled at compile time");
+        if (FluidSystem::enableVaporizedOil() && !enableVaporizedOil())
+            OPM_THROW(std::runtime_error,
+                      "Vaporized oil is enabled, but it has been disabled at compile time");
+    }
+};
+
+} // namespace Ewoms
+
+#endif
@@ -29,6 +29,7 @@
 #define EWOMS_BLACK_OIL_POLYMER_MODULE_HH
 
 #include "blackoilproperties.hh"
+#include <ewoms/common/fastmath.hh>
 #include <ewoms/io/vtkblackoilpolymermodule.hh>
 #include <ewoms/models/common/quantitycallbacks.hh>
 
@@ -52,7 +53,11 @@
 
 #include <dune/common/fvector.hh>
 
+#include <algorithm>
+#include <cassert>
+#include <cmath>
 #include <string>
+#include <vector>
 
 namespace Ewoms {
 /*!
@@ -77,6 +82,7 @@ class BlackOilPolymerModule
     typedef typename GET_PROP_TYPE(TypeTag, Indices) Indices;
 
     typedef Opm::MathToolbox<Evaluation> Toolbox;
+    typedef Ewoms::MathKernels<GET_PROP_VALUE(TypeTag, EnableFastMath)> Math;
 
     typedef typename Opm::Tabulated1DFunction<Scalar> TabulatedFunction;
 
@@ -701,7 +707,7 @@ public:
         }
 
         const std::vector<Scalar>& shearEffectRefLogVelocity = plyshlogShearEffectRefLogVelocity_[pvtnumRegionIdx];
-        auto v0AbsLog = Opm::log(Opm::abs(v0));
+        auto v0AbsLog = Math::log(Opm::abs(v0));
         // return 1.0 if the velocity /sharte is smaller than the first velocity entry.
         if (v0AbsLog < shearEffectRefLogVelocity[0])
             return 1.0;
@@ -711,39 +717,22 @@ public:
         // where M(v) is computed from user input
         // and P = viscosityMultiplier
         const std::vector<Scalar>& shearEffectRefMultiplier = plyshlogShearEffectRefMultiplier_[pvtnumRegionIdx];
-        size_t numTableEntries = shearEffectRefLogVelocity.size();
-        assert(shearEffectRefMultiplier.size() == numTableEntries);
-
-        std::vector<Scalar> shearEffectMultiplier(numTableEntries, 1.0);
-        for (size_t i = 0; i < numTableEntries; ++i) {
-            shearEffectMultiplier[i] = (1.0 + (viscosityMultiplier - 1.0)*shearEffectRefMultiplier[i]) / viscosityMultiplier;
-            shearEffectMultiplier[i] = Opm::log(shearEffectMultiplier[i]);
-        }
-        // store the logarithmic velocity and logarithmic multipliers in a table for easy look up and
-        // linear interpolation in the logarithmic space.
-        TabulatedFunction logShearEffectMultiplier = TabulatedFunction(numTableEntries, shearEffectRefLogVelocity, shearEffectMultiplier, /*bool sortInputs =*/ false );
+        assert(shearEffectRefMultiplier.size() == shearEffectRefLogVelocity.size());
 
         // Find sheared velocity (v) that satisfies
         // F = log(v) + log (Z) - log(v0) = 0;
-
-        // Set up the function
-        // u = log(v)
-        auto F = [&logShearEffectMultiplier, &v0AbsLog](const Evaluation& u) {
-            return u + logShearEffectMultiplier.eval(u, true) - v0AbsLog;
-        };
-        // and its derivative
-        auto dF = [&logShearEffectMultiplier](const Evaluation& u) {
-            return 1 + logShearEffectMultiplier.evalDerivative(u, true);
-        };
-
-        // Solve F = 0 using Newton
-        // Use log(v0) as initial value for u
+        //
+        // using Newton's method with u = log(v). log(Z) is interpolated linearly in the
+        // logarithmic space. Use log(v0) as initial value for u
         auto u = v0AbsLog;
         bool converged = false;
         for (int i = 0; i < 20; ++i ) {
-            auto f = F(u);
-            auto df = dF(u);
-            u -= f/df;
+            Scalar slope;
+            const auto& logZ = logShearEffectMultiplier_(u, slope, viscosityMultiplier,
+                                                         shearEffectRefLogVelocity,
+                                                         shearEffectRefMultiplier);
+            auto f = u + logZ - v0AbsLog;
+            u -= f/(1.0 + slope);
             if (std::abs(Opm::scalarValue(f)) < 1e-12) {
                 converged = true;
                 break;
@@ -754,14 +743,50 @@ public:
         }
 
         // return the shear factor
-        return Opm::exp( logShearEffectMultiplier.eval(u, /*extrapolate=*/true) );
-
+        Scalar slope;
+        return Math::exp(logShearEffectMultiplier_(u, slope, viscosityMultiplier,
+                                                   shearEffectRefLogVelocity,
+                                                   shearEffectRefMultiplier));
     }
 
-
-
-
 private:
+    // evaluate the logarithm of the shear multiplier Z = (1 + (P - 1) * M(v)) / P for a
+    // given logarithmic velocity u. Z is linearly interpolated between the entries of
+    // the PLYSHLOG table in the logarithmic space and linearly extrapolated beyond them.
+    // In contrast to setting up a tabulated function, this does not allocate memory.
+    template <class Evaluation>
+    static Evaluation logShearEffectMultiplier_(const Evaluation& u,
+                                                Scalar& slope,
+                                                Scalar viscosityMultiplier,
+                                                const std::vector<Scalar>& refLogVelocity,
+                                                const std::vector<Scalar>& refMultiplier)
+    {
+        size_t numTableEntries = refLogVelocity.size();
+        assert(numTableEntries >= 2);
+
+        Scalar uValue = Opm::scalarValue(u);
+        size_t segIdx;
+        if (uValue <= refLogVelocity.front())
+            segIdx = 0;
+        else if (uValue >= refLogVelocity.back())
+            segIdx = numTableEntries - 2;
+        else
+            segIdx = static_cast<size_t>(std::upper_bound(refLogVelocity.begin(),
+                                                          refLogVelocity.end(),
+                                                          uValue)
+                                         - refLogVelocity.begin()) - 1;
+
+        Scalar x0 = refLogVelocity[segIdx];
+        Scalar x1 = refLogVelocity[segIdx + 1];
+        Scalar y0 =
+            std::log((1.0 + (viscosityMultiplier - 1.0)*refMultiplier[segIdx])/viscosityMultiplier);
+        Scalar y1 =
+            std::log((1.0 + (viscosityMultiplier - 1.0)*refMultiplier[segIdx + 1])/viscosityMultiplier);
+
+        slope = (y1 - y0)/(x1 - x0);
+        return y0 + slope*(u - x0);
+    }
+
     static std::vector<Scalar> plyrockDeadPoreVolume_;
     static std::vector<Scalar> plyrockResidualResistanceFactor_;
     static std::vector<Scalar> plyrockRockDensityFactor_;
@@ -858,6 +883,7 @@ class BlackOilPolymerIntensiveQuantities
     typedef typename GET_PROP_TYPE(TypeTag, ElementContext) ElementContext;
 
     typedef BlackOilPolymerModule<TypeTag> PolymerModule;
+    typedef Ewoms::MathKernels<GET_PROP_VALUE(TypeTag, EnableFastMath)> Math;
 
     enum { numPhases = GET_PROP_VALUE(TypeTag, NumPhases) };
     static constexpr int polymerConcentrationIdx = Indices::polymerConcentrationIdx;
@@ -876,7 +902,8 @@ public:
                                   unsigned timeIdx)
     {
         const PrimaryVariables& priVars = elemCtx.primaryVars(dofIdx, timeIdx);
-        polymerConcentration_ = priVars.makeEvaluation(polymerConcentrationIdx, timeIdx);
+        polymerConcentration_ = priVars.makeEvaluation(polymerConcentrationIdx, timeIdx,
+                                                       elemCtx.linearizationType());
         const Scalar cmax = PolymerModule::plymaxMaxConcentration(elemCtx, dofIdx, timeIdx);
 
         // permeability reduction due to polymer
@@ -901,8 +928,8 @@ public:
         // Do the Todd-Longstaff mixing
         const Scalar plymixparToddLongstaff = PolymerModule::plymixparToddLongstaff(elemCtx, dofIdx, timeIdx);
         Evaluation viscosityPolymer = viscosityMultiplier.eval(cmax, /*extrapolate=*/true) * muWater;
-        Evaluation viscosityPolymerEffective = pow(viscosityMixture, plymixparToddLongstaff) * pow(viscosityPolymer, 1.0 - plymixparToddLongstaff);
-        Evaluation viscosityWaterEffective = pow(viscosityMixture, plymixparToddLongstaff) * pow(muWater, 1.0 - plymixparToddLongstaff);
+        Evaluation viscosityPolymerEffective = Math::pow(viscosityMixture, plymixparToddLongstaff) * Math::pow(viscosityPolymer, 1.0 - plymixparToddLongstaff);
+        Evaluation viscosityWaterEffective = Math::pow(viscosityMixture, plymixparToddLongstaff) * Math::pow(muWater, 1.0 - plymixparToddLongstaff);
 
         Evaluation cbar = polymerConcentration_ / cmax;
         // waterViscosity / effectiveWaterViscosity
@@ -29,6 +29,7 @@
 #define EWOMS_BLACK_OIL_PRIMARY_VARIABLES_HH
 
 #include "blackoilproperties.hh"
+#include "blackoilphaseconfig.hh"
 #include "blackoilsolventmodules.hh"
 #include "blackoilpolymermodules.hh"
 
@@ -65,6 +66,7 @@ class BlackOilPrimaryVariables : public FvBasePrimaryVariables<TypeTag>
     typedef typename GET_PROP_TYPE(TypeTag, Indices) Indices;
     typedef typename GET_PROP_TYPE(TypeTag, Problem) Problem;
     typedef typename GET_PROP_TYPE(TypeTag, FluidSystem) FluidSystem;
+    typedef Ewoms::BlackOilPhaseConfig<TypeTag> PhaseConfig;
     typedef typename GET_PROP_TYPE(TypeTag, MaterialLaw) MaterialLaw;
     typedef typename GET_PROP_TYPE(TypeTag, MaterialLawParams) MaterialLawParams;
 
@@ -211,7 +213,7 @@ public:
 
         paramCache.updateAll(fsFlash);
         for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++phaseIdx) {
-            if (!FluidSystem::phaseIsActive(phaseIdx))
+            if (!PhaseConfig::phaseIsActive(phaseIdx))
                 continue;
 
             Scalar rho = FluidSystem::template density<FlashFluidState, Scalar>(fsFlash, paramCache, phaseIdx);
@@ -222,7 +224,7 @@ public:
         ComponentVector globalMolarities(0.0);
         for (unsigned compIdx = 0; compIdx < numComponents; ++compIdx) {
             for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++phaseIdx) {
-                if (!FluidSystem::phaseIsActive(phaseIdx))
+                if (!PhaseConfig::phaseIsActive(phaseIdx))
                     continue;
 
                 globalMolarities[compIdx] +=
@@ -276,7 +278,7 @@ public:
         else if (oilPresent) {
             // only oil: if dissolved gas is enabled, we need to consider the oil phase
             // composition, if it is disabled, the gas component must stick to its phase
-            if (FluidSystem::enableDissolvedGas())
+            if (PhaseConfig::enableDissolvedGas())
                 primaryVarsMeaning_ = Sw_po_Rs;
             else
                 primaryVarsMeaning_ = Sw_po_Sg;
@@ -285,7 +287,7 @@ public:
             assert(gasPresent);
             // only gas: if vaporized oil is enabled, we need to consider the gas phase
             // composition, if it is disabled, the oil component must stick to its phase
-            if (FluidSystem::enableVaporizedOil())
+            if (PhaseConfig::enableVaporizedOil())
                 primaryVarsMeaning_ = Sw_pg_Rv;
             else
                 primaryVarsMeaning_ = Sw_po_Sg;
@@ -345,7 +347,7 @@ public:
             Scalar So = 1.0 - Sw - Sg - solventSaturation();
 
             Scalar So2 = 1.0 - Sw;
-            if (Sg < 0.0 && So2 > 0.0 && FluidSystem::enableDissolvedGas()) {
+            if (Sg < 0.0 && So2 > 0.0 && PhaseConfig::enableDissolvedGas()) {
                 // the gas phase disappeared, i.e., switch the primary variables to { Sw,
                 // po, xoG }.
                 //
@@ -372,7 +374,7 @@ public:
             }
 
             Scalar Sg2 = 1.0 - Sw - solventSaturation();
-            if (So < 0.0 && Sg2 > 0.0 && FluidSystem::enableVaporizedOil()) {
+            if (So < 0.0 && Sg2 > 0.0 && PhaseConfig::enableVaporizedOil()) {
                 // the oil phase disappeared, i.e., switch the primary variables to { Sw,
                 // pg, xgO }.
                 Scalar po = (*this)[Indices::pressureSwitchIdx];
@@ -44,6 +44,37 @@ NEW_PROP_TAG(HeatConductionLawParams);
 NEW_PROP_TAG(EnableSolvent);
 //! Enable the ECL-blackoil extension for polymer.
 NEW_PROP_TAG(EnablePolymer);
+//! The number of sampling points of the uniformly resampled PVT tables (0 disables them)
+NEW_PROP_TAG(BlackOilPvtTableSamples);
+//! The minimum pressure of the uniformly resampled PVT tables [Pa]
+NEW_PROP_TAG(BlackOilPvtTableMinPressure);
+//! The maximum pressure of the uniformly resampled PVT tables [Pa]
+NEW_PROP_TAG(BlackOilPvtTableMaxPressure);
+//! Specifies whether the water phase may be active
+NEW_PROP_TAG(BlackOilEnableWaterPhase);
+//! Specifies whether the oil phase may be active
+NEW_PROP_TAG(BlackOilEnableOilPhase);
+//! Specifies whether the gas phase may be active
+NEW_PROP_TAG(BlackOilEnableGasPhase);
+//! Specifies whether gas may dissolve in the oil phase
+NEW_PROP_TAG(BlackOilEnableDissolvedGas);
+//! Specifies whether oil may vaporize into the gas phase
+NEW_PROP_TAG(BlackOilEnableVaporizedOil);
+//! Specifies whether the Newton method uses sequential-implicit iterations
+NEW_PROP_TAG(EnableSequentialImplicit);
+//! The factor by which the error must be reduced by each sequential-implicit iteration
+NEW_PROP_TAG(SequentialMinErrorReduction);
+//! The relative tolerance of the pressure steps of the sequential-implicit iterations
+NEW_PROP_TAG(SequentialPressureTolerance);
+//! The maximum number of linear iterations of a pressure step
+NEW_PROP_TAG(SequentialPressureMaxIterations);
+//! The number of passes over the components of the flux graph of a transport step
+NEW_PROP_TAG(SequentialTransportSweeps);
+//! The number of Gauss-Seidel sweeps over the cells of a strongly connected component
+NEW_PROP_TAG(SequentialComponentSweeps);
+
+//! The index of the primary variable which is corrected by the coarse pressure predictor
+NEW_PROP_TAG(CoarsePredictorPressureIndex);
 }} // namespace Properties, Ewoms
 
 #endif
@@ -0,0 +1,288 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \copydoc Ewoms::BlackOilPvtTables
+ */
+#ifndef EWOMS_BLACK_OIL_PVT_TABLES_HH
+#define EWOMS_BLACK_OIL_PVT_TABLES_HH
+
+#include "blackoilproperties.hh"
+
+#include <opm/material/common/MathToolbox.hpp>
+#include <opm/common/ErrorMacros.hpp>
+#include <opm/common/Exceptions.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+namespace Ewoms {
+/*!
+ * \ingroup BlackOilModel
+ *
+ * \brief The PVT properties of the black-oil fluid system resampled on uniform grids.
+ *
+ * The PVT objects of the black-oil fluid system use piecewise linear functions with
+ * non-uniformly spaced sampling points, so that each evaluation needs to search for
+ * the right segment. This class samples the inverse formation volume factors, the
+ * viscosities and the saturated dissolution factors on uniformly spaced pressures (and
+ * uniformly spaced dissolution factors for the oil and gas phases) once, which makes
+ * looking up the segment a simple division. The accuracy of the approximation is
+ * determined by the number of sampling points.
+ *
+ * Note that the VAPPARS mechanism is not taken into account by the resampled
+ * saturated dissolution factors.
+ */
+template <class TypeTag>
+class BlackOilPvtTables
+{
+    typedef typename GET_PROP_TYPE(TypeTag, Scalar) Scalar;
+    typedef typename GET_PROP_TYPE(TypeTag, FluidSystem) FluidSystem;
+
+    enum { waterPhaseIdx = FluidSystem::waterPhaseIdx };
+    enum { oilPhaseIdx = FluidSystem::oilPhaseIdx };
+    enum { gasPhaseIdx = FluidSystem::gasPhaseIdx };
+    enum { numPhases = FluidSystem::numPhases };
+
+    // a function of one or two variables sampled on a uniform grid
+    class UniformTable
+    {
+    public:
+        UniformTable()
+        {}
+
+        template <class Fn>
+        void init(Scalar xMin, Scalar xMax, unsigned numX,
+                  Scalar yMin, Scalar yMax, unsigned numY,
+                  const Fn& fn)
+        {
+            assert(numX >= 2 && numY >= 1);
+
+            xMin_ = xMin;
+            numX_ = numX;
+            dx_ = (xMax - xMin)/(numX - 1);
+
+            yMin_ = yMin;
+            numY_ = numY;
+            dy_ = (numY > 1) ? (yMax - yMin)/(numY - 1) : 1.0;
+
+            values_.resize(numX*numY);
+            for (unsigned yIdx = 0; yIdx < numY; ++yIdx)
+                for (unsigned xIdx = 0; xIdx < numX; ++xIdx)
+                    values_[yIdx*numX + xIdx] = fn(xMin_ + xIdx*dx_, yMin_ + yIdx*dy_);
+        }
+
+        template <class Evaluation>
+        Evaluation eval(const Evaluation& x, const Evaluation& y) const
+        {
+            typedef Opm::MathToolbox<Evaluation> Toolbox;
+
+            // values outside of the sampled range are linearly extrapolated using the
+            // first or the last segment
+            unsigned xIdx = segmentIndex_(Toolbox::value(x), xMin_, dx_, numX_);
+            const Evaluation& alpha = (x - (xMin_ + xIdx*dx_))/dx_;
+            if (numY_ == 1)
+                return values_[xIdx] + (values_[xIdx + 1] - values_[xIdx])*alpha;
+
+            unsigned yIdx = segmentIndex_(Toolbox::value(y), yMin_, dy_, numY_);
+            const Evaluation& beta = (y - (yMin_ + yIdx*dy_))/dy_;
+
+            const Scalar* low = &values_[yIdx*numX_ + xIdx];
+            const Scalar* high = low + numX_;
+            const Evaluation& fLow = low[0] + (low[1] - low[0])*alpha;
+            const Evaluation& fHigh = high[0] + (high[1] - high[0])*alpha;
+            return fLow + (fHigh - fLow)*beta;
+        }
+
+    private:
+        static unsigned segmentIndex_(Scalar x, Scalar xMin, Scalar dx, unsigned n)
+        {
+            Scalar pos = std::floor((x - xMin)/dx);
+            if (!(pos > 0.0))
+                return 0;
+            return std::min(static_cast<unsigned>(pos), n - 2);
+        }
+
+        Scalar xMin_;
+        Scalar dx_;
+        unsigned numX_;
+
+        Scalar yMin_;
+        Scalar dy_;
+        unsigned numY_;
+
+        std::vector<Scalar> values_;
+    };
+
+    struct RegionTables
+    {
+        UniformTable invB[numPhases];
+        UniformTable mu[numPhases];
+        UniformTable saturatedDissolutionFactor[numPhases];
+    };
+
+public:
+    BlackOilPvtTables()
+    { numPressureSamples_ = 0; }
+
+    /*!
+     * \brief Sample the PVT properties of the fluid system.
+     *
+     * This must be called after the fluid system has been initialized.
+     *
+     * \param numSamples The number of sampling points for each direction
+     * \param pMin The minimum pressure of the sampled range [Pa]
+     * \param pMax The maximum pressure of the sampled range [Pa]
+     */
+    void init(unsigned numSamples, Scalar pMin, Scalar pMax)
+    {
+        if (numSamples < 2)
+            OPM_THROW(std::runtime_error,
+                      "At least two sampling points are required for the PVT tables");
+        if (!(pMin < pMax))
+            OPM_THROW(std::runtime_error,
+                      "The pressure range of the PVT tables is empty");
+
+        const Scalar T = FluidSystem::surfaceTemperature;
+
+        regionTables_.resize(FluidSystem::numRegions());
+        for (unsigned regionIdx = 0; regionIdx < regionTables_.size(); ++regionIdx) {
+            RegionTables& tables = regionTables_[regionIdx];
+
+            if (FluidSystem::phaseIsActive(waterPhaseIdx)) {
+                const auto& pvt = FluidSystem::waterPvt();
+                tables.invB[waterPhaseIdx].init(pMin, pMax, numSamples, 0.0, 0.0, 1,
+                                                [&](Scalar p, Scalar)
+                                                { return pvt.inverseFormationVolumeFactor(regionIdx, T, p); });
+                tables.mu[waterPhaseIdx].init(pMin, pMax, numSamples, 0.0, 0.0, 1,
+                                              [&](Scalar p, Scalar)
+                                              { return pvt.viscosity(regionIdx, T, p); });
+            }
+
+            if (FluidSystem::phaseIsActive(oilPhaseIdx)) {
+                const auto& pvt = FluidSystem::oilPvt();
+                unsigned numRs = 1;
+                Scalar RsMax = 0.0;
+                if (FluidSystem::enableDissolvedGas()) {
+                    tables.saturatedDissolutionFactor[oilPhaseIdx].init(
+                        pMin, pMax, numSamples, 0.0, 0.0, 1,
+                        [&](Scalar p, Scalar)
+                        { return pvt.saturatedGasDissolutionFactor(regionIdx, T, p); });
+
+                    numRs = numSamples;
+                    RsMax = pvt.saturatedGasDissolutionFactor(regionIdx, T, pMax);
+                }
+
+                tables.invB[oilPhaseIdx].init(pMin, pMax, numSamples, 0.0, RsMax, numRs,
+                                              [&](Scalar p, Scalar Rs)
+                                              { return pvt.inverseFormationVolumeFactor(regionIdx, T, p, Rs); });
+                tables.mu[oilPhaseIdx].init(pMin, pMax, numSamples, 0.0, RsMax, numRs,
+                                            [&](Scalar p, Scalar Rs)
+                                            { return pvt.viscosity(regionIdx, T, p, Rs); });
+            }
+
+            if (FluidSystem::phaseIsActive(gasPhaseIdx)) {
+                const auto& pvt = FluidSystem::gasPvt();
+                unsigned numRv = 1;
+                Scalar RvMax = 0.0;
+                if (FluidSystem::enableVaporizedOil()) {
+                    tables.saturatedDissolutionFactor[gasPhaseIdx].init(
+                        pMin, pMax, numSamples, 0.0, 0.0, 1,
+                        [&](Scalar p, Scalar)
+                        { return pvt.saturatedOilVaporizationFactor(regionIdx, T, p); });
+
+                    numRv = numSamples;
+                    RvMax = pvt.saturatedOilVaporizationFactor(regionIdx, T, pMax);
+                }
+
+                tables.invB[gasPhaseIdx].init(pMin, pMax, numSamples, 0.0, RvMax, numRv,
+                                              [&](Scalar p, Scalar Rv)
+                                              { return pvt.inverseFormationVolumeFactor(regionIdx, T, p, Rv); });
+                tables.mu[gasPhaseIdx].init(pMin, pMax, numSamples, 0.0, RvMax, numRv,
+                                            [&](Scalar p, Scalar Rv)
+                                            { return pvt.viscosity(regionIdx, T, p, Rv); });
+            }
+        }
+
+        numPressureSamples_ = numSamples;
+    }
+
+    /*!
+     * \brief Returns true iff the PVT properties have been sampled.
+     */
+    bool isInitialized() const
+    { return numPressureSamples_ > 0; }
+
+    /*!
+     * \brief The inverse formation volume factor of a fluid phase.
+     *
+     * \param phaseIdx The index of the fluid phase
+     * \param regionIdx The index of the PVT region
+     * \param p The pressure of the phase [Pa]
+     * \param R The dissolution factor of the phase, i.e., Rs for oil and Rv for gas
+     */
+    template <class Evaluation>
+    Evaluation inverseFormationVolumeFactor(unsigned phaseIdx,
+                                            unsigned regionIdx,
+                                            const Evaluation& p,
+                                            const Evaluation& R) const
+    { return regionTables_[regionIdx].invB[phaseIdx].eval(p, R); }
+
+    /*!
+     * \brief The dynamic viscosity [Pa s] of a fluid phase.
+     *
+     * \copydetails inverseFormationVolumeFactor
+     */
+    template <class Evaluation>
+    Evaluation viscosity(unsigned phaseIdx,
+                         unsigned regionIdx,
+                         const Evaluation& p,
+                         const Evaluation& R) const
+    { return regionTables_[regionIdx].mu[phaseIdx].eval(p, R); }
+
+    /*!
+     * \brief The saturated dissolution factor of the oil or of the gas phase.
+     *
+     * For the oil phase, this is the saturated gas dissolution factor, for the gas phase
+     * the saturated oil vaporization factor.
+     */
+    template <class Evaluation>
+    Evaluation saturatedDissolutionFactor(unsigned phaseIdx,
+                                          unsigned regionIdx,
+                                          const Evaluation& p) const
+    {
+        assert(phaseIdx == oilPhaseIdx || phaseIdx == gasPhaseIdx);
+        return regionTables_[regionIdx].saturatedDissolutionFactor[phaseIdx].eval(p, p);
+    }
+
+private:
+    std::vector<RegionTables> regionTables_;
+    unsigned numPressureSamples_;
+};
+
+} // namespace Ewoms
+
+#endif
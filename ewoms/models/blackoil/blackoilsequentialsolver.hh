@@ -0,0 +1,590 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \copydoc Ewoms::BlackOilSequentialSolver
+ */
+#ifndef EWOMS_BLACK_OIL_SEQUENTIAL_SOLVER_HH
+#define EWOMS_BLACK_OIL_SEQUENTIAL_SOLVER_HH
+
+#include "blackoilproperties.hh"
+
+#include <ewoms/linear/parallelcprbackend.hh>
+#include <ewoms/common/parametersystem.hh>
+
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/bvector.hh>
+#include <dune/istl/operators.hh>
+#include <dune/istl/preconditioners.hh>
+#include <dune/istl/solvers.hh>
+#include <dune/istl/paamg/amg.hh>
+#include <dune/common/fmatrix.hh>
+#include <dune/common/fvector.hh>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace Ewoms {
+/*!
+ * \ingroup BlackOilModel
+ *
+ * \brief Computes the updates of the sequential-implicit iterations of the black-oil
+ *        model.
+ *
+ * Both steps operate on the Jacobian of the fully implicit system:
+ *
+ * - The pressure step extracts a scalar pressure system using quasi-IMPES weights, i.e.,
+ *   the equations of each degree of freedom are combined such that the derivatives of
+ *   the combination w.r.t. all primary variables of the degree of freedom except the
+ *   pressure vanish. (This is the same reduction as used by the CPR preconditioner.)
+ *   The pressure system is then solved using the stabilized BiCG method preconditioned
+ *   by algebraic multi-grid and only the pressure is updated.
+ *
+ * - The transport step keeps the pressure fixed and updates the remaining primary
+ *   variables. The equation which dominates the pressure equation of a cell is not
+ *   considered by the transport step. The cells are grouped into the strongly connected
+ *   components of the flux graph (Tarjan's algorithm) and the components are solved in
+ *   upwind order, i.e., a component is only processed after all components from which
+ *   it receives the fluids. Components which consist of a single cell are solved
+ *   directly, larger ones by block Gauss-Seidel sweeps over their cells. For flows
+ *   without counter-current effects, a single pass thus solves the transport system
+ *   exactly. The upwind direction of a connection is determined from the Jacobian:
+ *   The derivatives of the equations of a cell w.r.t. the saturations of its upstream
+ *   neighbor are larger than the ones of the reverse direction because the mobilities
+ *   are upwinded.
+ *
+ * The components are scheduled by levels: The level of a component is the length of
+ * the longest path to it from a component without inflow. Since the components of a
+ * level do not depend on each other, they are solved concurrently if OpenMP is
+ * enabled.
+ */
+template <class TypeTag>
+class BlackOilSequentialSolver
+{
+    typedef typename GET_PROP_TYPE(TypeTag, Scalar) Scalar;
+    typedef typename GET_PROP_TYPE(TypeTag, GridView) GridView;
+    typedef typename GET_PROP_TYPE(TypeTag, JacobianMatrix) Matrix;
+    typedef typename GET_PROP_TYPE(TypeTag, GlobalEqVector) Vector;
+    typedef typename GET_PROP_TYPE(TypeTag, Indices) Indices;
+
+    enum { numEq = GET_PROP_VALUE(TypeTag, NumEq) };
+    enum { numTransportEq = numEq - 1 };
+    enum { pressureIdx = Indices::pressureSwitchIdx };
+
+    typedef typename Matrix::block_type MatrixBlock;
+    typedef Dune::FieldVector<Scalar, numEq> VectorBlock;
+    typedef Dune::FieldMatrix<Scalar, numTransportEq, numTransportEq> TransportMatrixBlock;
+    typedef Dune::FieldVector<Scalar, numTransportEq> TransportVectorBlock;
+
+    typedef Dune::FieldMatrix<Scalar, 1, 1> PressureMatrixBlock;
+    typedef Dune::FieldVector<Scalar, 1> PressureVectorBlock;
+    typedef Dune::BCRSMatrix<PressureMatrixBlock> PressureMatrix;
+    typedef Dune::BlockVector<PressureVectorBlock> PressureVector;
+
+    typedef Dune::MatrixAdapter<PressureMatrix, PressureVector, PressureVector> PressureOperator;
+    typedef Dune::SeqSOR<PressureMatrix, PressureVector, PressureVector> PressureSmoother;
+    typedef Dune::Amg::AMG<PressureOperator, PressureVector, PressureSmoother> PressureAmg;
+
+public:
+    BlackOilSequentialSolver()
+    {
+        pressureTolerance_ = EWOMS_GET_PARAM(TypeTag, Scalar, SequentialPressureTolerance);
+        maxPressureIterations_ = EWOMS_GET_PARAM(TypeTag, int, SequentialPressureMaxIterations);
+        numTransportSweeps_ = std::max(1, EWOMS_GET_PARAM(TypeTag, int, SequentialTransportSweeps));
+        numComponentSweeps_ = std::max(1, EWOMS_GET_PARAM(TypeTag, int, SequentialComponentSweeps));
+        lastIterations_ = 0;
+    }
+
+    /*!
+     * \brief Register all run-time parameters of the sequential-implicit iterations.
+     */
+    static void registerParameters()
+    {
+        EWOMS_REGISTER_PARAM(TypeTag, Scalar, SequentialPressureTolerance,
+                             "The factor by which the residual of the pressure system is "
+                             "reduced by the pressure steps of the sequential-implicit "
+                             "iterations");
+        EWOMS_REGISTER_PARAM(TypeTag, int, SequentialPressureMaxIterations,
+                             "The maximum number of linear iterations of a pressure step of "
+                             "the sequential-implicit iterations");
+        EWOMS_REGISTER_PARAM(TypeTag, int, SequentialTransportSweeps,
+                             "The number of passes over the strongly connected components "
+                             "of the flux graph by a transport step of the "
+                             "sequential-implicit iterations");
+        EWOMS_REGISTER_PARAM(TypeTag, int, SequentialComponentSweeps,
+                             "The number of Gauss-Seidel sweeps over the cells of a strongly "
+                             "connected component of the flux graph which consists of more "
+                             "than one cell");
+    }
+
+    /*!
+     * \brief Causes the next pressure step to recreate the sparsity pattern of the
+     *        pressure system.
+     */
+    void eraseMatrix()
+    { pressureMatrix_ = PressureMatrix(); }
+
+    /*!
+     * \brief Returns the number of linear iterations of the last pressure step.
+     */
+    unsigned lastIterations() const
+    { return lastIterations_; }
+
+    /*!
+     * \brief Compute the update of the pressure for a linearization.
+     *
+     * \param M The Jacobian matrix of the fully implicit system
+     * \param b The residual of the fully implicit system
+     * \param x The update of the primary variables. Only the pressure is set, all other
+     *          primary variables are not changed.
+     * \return true if the pressure system could be solved
+     */
+    bool solvePressure(const Matrix& M, const Vector& b, Vector& x)
+    {
+        updatePressureSystem_(M, b);
+
+        typedef typename Dune::Amg::SmootherTraits<PressureSmoother>::Arguments SmootherArgs;
+        typedef Dune::Amg::
+            CoarsenCriterion<Dune::Amg::SymmetricCriterion<PressureMatrix, Dune::Amg::FirstDiagonal> >
+            CoarsenCriterion;
+
+        SmootherArgs smootherArgs;
+        smootherArgs.iterations = 1;
+        smootherArgs.relaxationFactor = 1.0;
+
+        CoarsenCriterion coarsenCriterion(/*maxLevel=*/15, /*coarsenTarget=*/1200);
+        coarsenCriterion.setDefaultValuesAnisotropic(GridView::dimension,
+                                                     /*aggregateSizePerDim=*/3);
+        coarsenCriterion.setDebugLevel(0); // make the AMG shut up
+        coarsenCriterion.setMinCoarsenRate(1.05);
+        coarsenCriterion.setAccumulate(Dune::Amg::atOnceAccu);
+        coarsenCriterion.setSkipIsolated(false);
+
+        // the hierarchy depends on the values of the matrix, so it is recreated for each
+        // linearization
+        PressureOperator pressureOperator(pressureMatrix_);
+        PressureAmg amg(pressureOperator, coarsenCriterion, smootherArgs);
+        Dune::BiCGSTABSolver<PressureVector> solver(pressureOperator,
+                                                    amg,
+                                                    pressureTolerance_,
+                                                    maxPressureIterations_,
+                                                    /*verbosity=*/0);
+
+        // the solver overwrites the right hand side
+        PressureVector pressureUpdate(pressureRhs_.size());
+        pressureUpdate = 0.0;
+        Dune::InverseOperatorResult result;
+        solver.apply(pressureUpdate, pressureRhs_, result);
+        lastIterations_ = static_cast<unsigned>(result.iterations);
+
+        for (size_t rowIdx = 0; rowIdx < x.size(); ++rowIdx) {
+            if (!std::isfinite(pressureUpdate[rowIdx][0]))
+                return false;
+            x[rowIdx][pressureIdx] = pressureUpdate[rowIdx][0];
+        }
+
+        return result.converged;
+    }
+
+    /*!
+     * \brief Compute the update of the saturations and compositions for a linearization
+     *        while the pressure is kept fixed.
+     *
+     * \param M The Jacobian matrix of the fully implicit system
+     * \param b The residual of the fully implicit system
+     * \param numGridDof The number of degrees of freedom which are associated with the
+     *                   grid. The rows of the auxiliary equations are not updated.
+     * \param x The update of the primary variables. The pressure is not changed.
+     */
+    void solveTransport(const Matrix& M, const Vector& b, size_t numGridDof, Vector& x)
+    {
+        updateTransportBlocks_(M, numGridDof);
+        updateFluxGraph_(M, numGridDof);
+        updateComponents_(numGridDof);
+
+        for (int sweepIdx = 0; sweepIdx < numTransportSweeps_; ++sweepIdx) {
+            // the couplings to the components which are processed concurrently or later
+            // use the updates of the previous pass
+            previousUpdate_ = x;
+
+            size_t numLevels = levelOffsets_.size() - 1;
+            for (size_t levelIdx = 0; levelIdx < numLevels; ++levelIdx) {
+                int levelBegin = static_cast<int>(levelOffsets_[levelIdx]);
+                int levelEnd = static_cast<int>(levelOffsets_[levelIdx + 1]);
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 16)
+#endif
+                for (int i = levelBegin; i < levelEnd; ++i)
+                    solveComponent_(M, b, numGridDof, levelComponents_[static_cast<size_t>(i)], x);
+            }
+        }
+    }
+
+private:
+    // compute the quasi-IMPES weights and the entries of the pressure system
+    void updatePressureSystem_(const Matrix& M, const Vector& b)
+    {
+        size_t numRows = M.N();
+        if (pressureMatrix_.N() != numRows || pressureMatrix_.nonzeroes() != M.nonzeroes()) {
+            pressureMatrix_ = PressureMatrix();
+            pressureMatrix_.setSize(numRows, M.M(), M.nonzeroes());
+            pressureMatrix_.setBuildMode(PressureMatrix::row_wise);
+            auto createIt = pressureMatrix_.createbegin();
+            auto rowIt = M.begin();
+            for (; createIt != pressureMatrix_.createend(); ++createIt, ++rowIt) {
+                auto colIt = rowIt->begin();
+                const auto& colEndIt = rowIt->end();
+                for (; colIt != colEndIt; ++colIt)
+                    createIt.insert(colIt.index());
+            }
+        }
+
+        weights_.resize(numRows);
+        pressureRhs_.resize(numRows);
+        for (size_t rowIdx = 0; rowIdx < numRows; ++rowIdx) {
+            const auto& row = M[rowIdx];
+            VectorBlock& weights = weights_[rowIdx];
+
+            const auto& diagIt = row.find(rowIdx);
+            if (diagIt == row.end())
+                weights = 1.0;
+            else
+                Linear::computeQuasiImpesWeights(*diagIt, weights, pressureIdx);
+
+            pressureRhs_[rowIdx][0] = weights*b[rowIdx];
+
+            auto pressureColIt = pressureMatrix_[rowIdx].begin();
+            auto colIt = row.begin();
+            const auto& colEndIt = row.end();
+            for (; colIt != colEndIt; ++colIt, ++pressureColIt) {
+                const MatrixBlock& block = *colIt;
+                Scalar value = 0.0;
+                for (unsigned eqIdx = 0; eqIdx < numEq; ++eqIdx)
+                    value += weights[eqIdx]*block[eqIdx][pressureIdx];
+                *pressureColIt = value;
+            }
+        }
+    }
+
+    // determine the equation which dominates the pressure equation of each cell and
+    // invert the diagonal blocks of the remaining equations w.r.t. the primary
+    // variables except the pressure. the quasi-IMPES weights of the pressure step are
+    // not reused because they belong to the linearization before the pressure update.
+    void updateTransportBlocks_(const Matrix& M, size_t numGridDof)
+    {
+        droppedEqIdx_.resize(numGridDof);
+        transportInvDiag_.resize(numGridDof);
+        for (size_t rowIdx = 0; rowIdx < numGridDof; ++rowIdx) {
+            const auto& row = M[rowIdx];
+            const auto& diagIt = row.find(rowIdx);
+            TransportMatrixBlock& invDiag = transportInvDiag_[rowIdx];
+            if (diagIt == row.end()) {
+                droppedEqIdx_[rowIdx] = 0;
+                invDiag = 0.0;
+                continue;
+            }
+
+            const MatrixBlock& diag = *diagIt;
+            VectorBlock weights;
+            Linear::computeQuasiImpesWeights(diag, weights, pressureIdx);
+
+            unsigned droppedEqIdx = 0;
+            for (unsigned eqIdx = 1; eqIdx < numEq; ++eqIdx)
+                if (std::abs(weights[eqIdx]) > std::abs(weights[droppedEqIdx]))
+                    droppedEqIdx = eqIdx;
+            droppedEqIdx_[rowIdx] = droppedEqIdx;
+
+            for (unsigned k = 0; k < numTransportEq; ++k)
+                for (unsigned l = 0; l < numTransportEq; ++l)
+                    invDiag[k][l] = diag[eqIdx_(k, droppedEqIdx)][pvIdx_(l)];
+
+            // cells with a singular transport block are not updated by the transport
+            // step
+            try {
+                invDiag.invert();
+            }
+            catch (const Dune::FMatrixError&) {
+                invDiag = 0.0;
+            }
+        }
+    }
+
+    // update the primary variables of the cells of a strongly connected component of
+    // the flux graph
+    void solveComponent_(const Matrix& M,
+                         const Vector& b,
+                         size_t numGridDof,
+                         unsigned compIdx,
+                         Vector& x) const
+    {
+        unsigned compBegin = componentOffsets_[compIdx];
+        unsigned compEnd = componentOffsets_[compIdx + 1];
+
+        // the transport equations of a single cell only depend on its upstream
+        // neighbors, which are final at this point
+        int numSweeps = (compEnd - compBegin > 1) ? numComponentSweeps_ : 1;
+        for (int sweepIdx = 0; sweepIdx < numSweeps; ++sweepIdx)
+            for (unsigned i = compBegin; i < compEnd; ++i)
+                solveCell_(M, b, numGridDof, componentCells_[i], x);
+    }
+
+    // update the primary variables of a cell except the pressure given the current
+    // updates of its neighbors
+    void solveCell_(const Matrix& M,
+                    const Vector& b,
+                    size_t numGridDof,
+                    unsigned rowIdx,
+                    Vector& x) const
+    {
+        unsigned droppedEqIdx = droppedEqIdx_[rowIdx];
+        unsigned compIdx = cellComponent_[rowIdx];
+        unsigned level = componentLevel_[compIdx];
+
+        // the residual of the transport equations minus the contributions of the
+        // updates of the neighboring cells
+        TransportVectorBlock rhs;
+        for (unsigned k = 0; k < numTransportEq; ++k)
+            rhs[k] = b[rowIdx][eqIdx_(k, droppedEqIdx)];
+
+        const auto& row = M[rowIdx];
+        auto colIt = row.begin();
+        const auto& colEndIt = row.end();
+        for (; colIt != colEndIt; ++colIt) {
+            size_t colIdx = colIt.index();
+            if (colIdx == rowIdx || colIdx >= numGridDof)
+                continue;
+
+            // the cells of the own component and of the components of lower levels
+            // are not modified concurrently
+            unsigned neighborCompIdx = cellComponent_[colIdx];
+            const VectorBlock& neighborUpdate =
+                (neighborCompIdx == compIdx || componentLevel_[neighborCompIdx] < level)
+                ? x[colIdx]
+                : previousUpdate_[colIdx];
+
+            const MatrixBlock& block = *colIt;
+            for (unsigned k = 0; k < numTransportEq; ++k) {
+                const auto& blockRow = block[eqIdx_(k, droppedEqIdx)];
+                for (unsigned l = 0; l < numTransportEq; ++l)
+                    rhs[k] -= blockRow[pvIdx_(l)]*neighborUpdate[pvIdx_(l)];
+            }
+        }
+
+        TransportVectorBlock update;
+        transportInvDiag_[rowIdx].mv(rhs, update);
+        for (unsigned l = 0; l < numTransportEq; ++l)
+            x[rowIdx][pvIdx_(l)] = update[l];
+    }
+
+    // determine the downstream neighbors of each cell
+    void updateFluxGraph_(const Matrix& M, size_t numGridDof)
+    {
+        // the downstream neighbors of each cell in compressed row storage
+        downstreamOffsets_.assign(numGridDof + 1, 0);
+        downstreamCells_.clear();
+        for (size_t rowIdx = 0; rowIdx < numGridDof; ++rowIdx) {
+            const auto& row = M[rowIdx];
+            auto colIt = row.begin();
+            const auto& colEndIt = row.end();
+            for (; colIt != colEndIt; ++colIt) {
+                size_t colIdx = colIt.index();
+                if (colIdx == rowIdx || colIdx >= numGridDof)
+                    continue;
+
+                // the equations of the downstream cell colIdx depend more strongly on
+                // the saturations of rowIdx than vice versa
+                const auto& reverseIt = M[colIdx].find(rowIdx);
+                if (reverseIt == M[colIdx].end())
+                    continue;
+                if (transportCoupling_(*reverseIt) > transportCoupling_(*colIt))
+                    downstreamCells_.push_back(static_cast<unsigned>(colIdx));
+            }
+            downstreamOffsets_[rowIdx + 1] = static_cast<unsigned>(downstreamCells_.size());
+        }
+    }
+
+    // compute the strongly connected components of the flux graph in upwind order
+    // using Tarjan's algorithm and group them into levels
+    void updateComponents_(size_t numGridDof)
+    {
+        static const unsigned unvisited = std::numeric_limits<unsigned>::max();
+
+        std::vector<unsigned> dfsIndex(numGridDof, unvisited);
+        std::vector<unsigned> lowLink(numGridDof, 0);
+        std::vector<bool> isOnStack(numGridDof, false);
+        std::vector<unsigned> cellStack;
+        // the cell and the position of the next downstream neighbor to be visited of
+        // each level of the depth first search. the recursion is unrolled because the
+        // paths of the flux graph may be as long as the number of cells
+        std::vector<std::pair<unsigned, unsigned> > callStack;
+
+        cellComponent_.resize(numGridDof);
+        componentOffsets_.assign(1, 0);
+        componentCells_.clear();
+        componentCells_.reserve(numGridDof);
+
+        unsigned nextDfsIndex = 0;
+        for (size_t startIdx = 0; startIdx < numGridDof; ++startIdx) {
+            if (dfsIndex[startIdx] != unvisited)
+                continue;
+
+            unsigned startCellIdx = static_cast<unsigned>(startIdx);
+            dfsIndex[startCellIdx] = lowLink[startCellIdx] = nextDfsIndex++;
+            cellStack.push_back(startCellIdx);
+            isOnStack[startCellIdx] = true;
+            callStack.push_back(std::make_pair(startCellIdx, downstreamOffsets_[startCellIdx]));
+
+            while (!callStack.empty()) {
+                unsigned cellIdx = callStack.back().first;
+                unsigned edgeIdx = callStack.back().second;
+
+                if (edgeIdx < downstreamOffsets_[cellIdx + 1]) {
+                    ++ callStack.back().second;
+
+                    unsigned downstreamIdx = downstreamCells_[edgeIdx];
+                    if (dfsIndex[downstreamIdx] == unvisited) {
+                        dfsIndex[downstreamIdx] = lowLink[downstreamIdx] = nextDfsIndex++;
+                        cellStack.push_back(downstreamIdx);
+                        isOnStack[downstreamIdx] = true;
+                        callStack.push_back(std::make_pair(downstreamIdx,
+                                                           downstreamOffsets_[downstreamIdx]));
+                    }
+                    else if (isOnStack[downstreamIdx])
+                        lowLink[cellIdx] = std::min(lowLink[cellIdx], dfsIndex[downstreamIdx]);
+                    continue;
+                }
+
+                // all downstream neighbors have been visited
+                callStack.pop_back();
+                if (!callStack.empty()) {
+                    unsigned parentIdx = callStack.back().first;
+                    lowLink[parentIdx] = std::min(lowLink[parentIdx], lowLink[cellIdx]);
+                }
+
+                if (lowLink[cellIdx] != dfsIndex[cellIdx])
+                    continue;
+
+                // the cell is the root of a component
+                unsigned compIdx = static_cast<unsigned>(componentOffsets_.size() - 1);
+                unsigned memberIdx;
+                do {
+                    memberIdx = cellStack.back();
+                    cellStack.pop_back();
+                    isOnStack[memberIdx] = false;
+                    cellComponent_[memberIdx] = compIdx;
+                    componentCells_.push_back(memberIdx);
+                } while (memberIdx != cellIdx);
+                componentOffsets_.push_back(static_cast<unsigned>(componentCells_.size()));
+            }
+        }
+
+        // Tarjan's algorithm finds the components in reverse topological order, i.e.,
+        // the components downstream of a component have smaller indices. thus, the
+        // levels can be determined by a single pass in reverse order.
+        size_t numComponents = componentOffsets_.size() - 1;
+        componentLevel_.assign(numComponents, 0);
+        unsigned numLevels = 0;
+        for (size_t i = numComponents; i > 0; --i) {
+            unsigned compIdx = static_cast<unsigned>(i - 1);
+            unsigned level = componentLevel_[compIdx];
+            numLevels = std::max(numLevels, level + 1);
+
+            for (unsigned j = componentOffsets_[compIdx]; j < componentOffsets_[compIdx + 1]; ++j) {
+                unsigned cellIdx = componentCells_[j];
+                for (unsigned k = downstreamOffsets_[cellIdx]; k < downstreamOffsets_[cellIdx + 1]; ++k) {
+                    unsigned downstreamCompIdx = cellComponent_[downstreamCells_[k]];
+                    if (downstreamCompIdx != compIdx)
+                        componentLevel_[downstreamCompIdx] =
+                            std::max(componentLevel_[downstreamCompIdx], level + 1);
+                }
+            }
+        }
+
+        // group the components by their levels
+        levelOffsets_.assign(numLevels + 1, 0);
+        for (size_t compIdx = 0; compIdx < numComponents; ++compIdx)
+            ++ levelOffsets_[componentLevel_[compIdx] + 1];
+        for (unsigned levelIdx = 0; levelIdx < numLevels; ++levelIdx)
+            levelOffsets_[levelIdx + 1] += levelOffsets_[levelIdx];
+
+        levelComponents_.resize(numComponents);
+        std::vector<unsigned> levelPos(levelOffsets_.begin(), levelOffsets_.end() - 1);
+        for (size_t compIdx = 0; compIdx < numComponents; ++compIdx)
+            levelComponents_[levelPos[componentLevel_[compIdx]]++] = static_cast<unsigned>(compIdx);
+    }
+
+    // the magnitude of the derivatives of the equations of a cell w.r.t. the primary
+    // variables of a neighbor except the pressure
+    static Scalar transportCoupling_(const MatrixBlock& block)
+    {
+        Scalar result = 0.0;
+        for (unsigned eqIdx = 0; eqIdx < numEq; ++eqIdx)
+            for (unsigned l = 0; l < numTransportEq; ++l)
+                result = std::max(result, std::abs(block[eqIdx][pvIdx_(l)]));
+        return result;
+    }
+
+    // the index of the primary variable of the l-th unknown of the transport step
+    static unsigned pvIdx_(unsigned l)
+    { return (l < pressureIdx) ? l : l + 1; }
+
+    // the index of the equation of the k-th equation of the transport step
+    static unsigned eqIdx_(unsigned k, unsigned droppedEqIdx)
+    { return (k < droppedEqIdx) ? k : k + 1; }
+
+    Scalar pressureTolerance_;
+    int maxPressureIterations_;
+    int numTransportSweeps_;
+    int numComponentSweeps_;
+    unsigned lastIterations_;
+
+    PressureMatrix pressureMatrix_;
+    PressureVector pressureRhs_;
+    std::vector<VectorBlock> weights_;
+
+    std::vector<unsigned> droppedEqIdx_;
+    std::vector<TransportMatrixBlock> transportInvDiag_;
+
+    // the flux graph
+    std::vector<unsigned> downstreamOffsets_;
+    std::vector<unsigned> downstreamCells_;
+
+    // the strongly connected components of the flux graph
+    std::vector<unsigned> cellComponent_;
+    std::vector<unsigned> componentOffsets_;
+    std::vector<unsigned> componentCells_;
+    std::vector<unsigned> componentLevel_;
+    std::vector<unsigned> levelOffsets_;
+    std::vector<unsigned> levelComponents_;
+
+    Vector previousUpdate_;
+};
+
+} // namespace Ewoms
+
+#endif
@@ -31,6 +31,7 @@
 #include "blackoilproperties.hh"
 #include <ewoms/io/vtkblackoilsolventmodule.hh>
 #include <ewoms/models/common/quantitycallbacks.hh>
+#include <ewoms/common/fastmath.hh>
 
 #include <opm/material/fluidsystems/blackoilpvt/SolventPvt.hpp>
 #include <opm/material/common/Tabulated1DFunction.hpp>
@@ -878,6 +879,7 @@ class BlackOilSolventIntensiveQuantities
     typedef typename GET_PROP_TYPE(TypeTag, ElementContext) ElementContext;
 
     typedef BlackOilSolventModule<TypeTag> SolventModule;
+    typedef Ewoms::MathKernels<GET_PROP_VALUE(TypeTag, EnableFastMath)> Math;
 
     enum { numPhases = GET_PROP_VALUE(TypeTag, NumPhases) };
     static constexpr int solventSaturationIdx = Indices::solventSaturationIdx;
@@ -900,7 +902,8 @@ public:
     {
         const PrimaryVariables& priVars = elemCtx.primaryVars(dofIdx, timeIdx);
         auto& fs = asImp_().fluidState_;
-        solventSaturation_ = priVars.makeEvaluation(solventSaturationIdx, timeIdx);
+        solventSaturation_ = priVars.makeEvaluation(solventSaturationIdx, timeIdx,
+                                                    elemCtx.linearizationType());
         hydrocarbonSaturation_ = fs.saturation(gasPhaseIdx);
 
         // apply a cut-off. Don't waste calculations if no solvent
@@ -938,9 +941,18 @@ public:
 
         // Pressure effects on capillary pressure miscibility
         if(SolventModule::isMiscible()) {
+            // evaluate the tables of the miscible model which only depend on the oil
+            // pressure or on the water saturation. These quantities are not modified
+            // until effectiveProperties() has been called, so the tables only need to
+            // be evaluated once per update.
+            const Evaluation& po = fs.pressure(oilPhaseIdx); // or gas pressure?
+            const Evaluation& sw = fs.saturation(waterPhaseIdx);
+            pmiscValue_ = SolventModule::pmisc(elemCtx, dofIdx, timeIdx).eval(po, /*extrapolate=*/true);
+            tlPMixValue_ = SolventModule::tlPMixTable(elemCtx, dofIdx, timeIdx).eval(po, /*extrapolate=*/true);
+            sorwmisValue_ = SolventModule::sorwmis(elemCtx, dofIdx, timeIdx).eval(sw, /*extrapolate=*/true);
+            sgcwmisValue_ = SolventModule::sgcwmis(elemCtx, dofIdx, timeIdx).eval(sw, /*extrapolate=*/true);
 
-            const Evaluation& p = fs.pressure(oilPhaseIdx); // or gas pressure?
-            const Evaluation pmisc = SolventModule::pmisc(elemCtx, dofIdx, timeIdx).eval(p, /*extrapolate=*/true);
+            const Evaluation& pmisc = pmiscValue_;
             const Evaluation& pgImisc = fs.pressure(gasPhaseIdx);
 
             // compute capillary pressure for miscible fluid
@@ -953,9 +965,11 @@ public:
 
             //oil is the reference phase for pressure
             if (priVars.primaryVarsMeaning() == PrimaryVariables::Sw_pg_Rv) {
-                pgMisc = priVars.makeEvaluation(Indices::pressureSwitchIdx, timeIdx);
+                pgMisc = priVars.makeEvaluation(Indices::pressureSwitchIdx, timeIdx,
+                                                elemCtx.linearizationType());
             } else {
-                const Evaluation& po = priVars.makeEvaluation(Indices::pressureSwitchIdx, timeIdx);
+                const Evaluation& po = priVars.makeEvaluation(Indices::pressureSwitchIdx, timeIdx,
+                                                              elemCtx.linearizationType());
                 pgMisc = po + (pC[gasPhaseIdx] - pC[oilPhaseIdx]);
             }
 
@@ -975,9 +989,7 @@ public:
         // account for miscibility of oil and solvent
         if(SolventModule::isMiscible()) {
             const auto& misc = SolventModule::misc(elemCtx, dofIdx, timeIdx);
-            const auto& pmisc = SolventModule::pmisc(elemCtx, dofIdx, timeIdx);
-            const Evaluation& p = fs.pressure(oilPhaseIdx); // or gas pressure?
-            const Evaluation miscibility = misc.eval(Fsolgas, /*extrapolate=*/true) * pmisc.eval(p, /*extrapolate=*/true);
+            const Evaluation miscibility = misc.eval(Fsolgas, /*extrapolate=*/true) * pmiscValue_;
 
             // TODO adjust endpoints of sn and ssg
             unsigned cellIdx = elemCtx.globalSpaceIndex(dofIdx, timeIdx);
@@ -987,12 +999,9 @@ public:
 
             const Scalar& sgcr = scaledDrainageInfo.Sgcr;
             const Scalar& sogcr = scaledDrainageInfo.Sogcr;
-            const Evaluation& sw = fs.saturation(waterPhaseIdx);
-            const auto& sorwmis = SolventModule::sorwmis(elemCtx, dofIdx, timeIdx);
-            const auto& sgcwmis = SolventModule::sgcwmis(elemCtx, dofIdx, timeIdx);
 
-            Evaluation sor = miscibility * sorwmis.eval(sw,  /*extrapolate=*/true) + ( 1.0 - miscibility) * sogcr;
-            Evaluation sgc = miscibility * sgcwmis.eval(sw,  /*extrapolate=*/true) + ( 1.0 - miscibility) * sgcr;
+            Evaluation sor = miscibility * sorwmisValue_ + ( 1.0 - miscibility) * sogcr;
+            Evaluation sgc = miscibility * sgcwmisValue_ + ( 1.0 - miscibility) * sgcr;
 
             const Evaluation oilGasSolventSat = gasSolventSat + fs.saturation(oilPhaseIdx);
             const Evaluation zero = 0.0;
@@ -1100,13 +1109,11 @@ private:
 
         auto& fs = asImp_().fluidState_;
 
-        // Compute effective saturations
-        const auto& sorwmis = SolventModule::sorwmis(elemCtx, scvIdx, timeIdx);
-        const auto& sgcwmis = SolventModule::sgcwmis(elemCtx, scvIdx, timeIdx);
-        const Evaluation& sw = fs.saturation(waterPhaseIdx);
-        const Evaluation oilEffSat = fs.saturation(oilPhaseIdx) - sorwmis.eval(sw,  /*extrapolate=*/true);
-        const Evaluation gasEffSat = fs.saturation(gasPhaseIdx) - sgcwmis.eval(sw,  /*extrapolate=*/true);
-        const Evaluation solventEffSat = solventSaturation() - sgcwmis.eval(sw,  /*extrapolate=*/true);
+        // Compute effective saturations. The values of the SORWMIS and SGCWMIS tables
+        // have been evaluated by solventPostSatFuncUpdate_()
+        const Evaluation oilEffSat = fs.saturation(oilPhaseIdx) - sorwmisValue_;
+        const Evaluation gasEffSat = fs.saturation(gasPhaseIdx) - sgcwmisValue_;
+        const Evaluation solventEffSat = solventSaturation() - sgcwmisValue_;
         const Evaluation oilGasSolventEffSat =  oilEffSat + gasEffSat + solventEffSat;
         const Evaluation oilSolventEffSat = oilEffSat + solventEffSat;
         const Evaluation solventGasEffSat = solventEffSat + gasEffSat;
@@ -1116,32 +1123,30 @@ private:
         const Evaluation& muOil = fs.viscosity(oilPhaseIdx);
         const Evaluation& muSolvent = solventViscosity_;
 
-        const Evaluation muOilPow = pow(muOil, 0.25);
-        const Evaluation muGasPow = pow(muGas, 0.25);
-        const Evaluation muSolventPow = pow(muSolvent, 0.25);
+        const Evaluation muOilPow = Math::pow(muOil, 0.25);
+        const Evaluation muGasPow = Math::pow(muGas, 0.25);
+        const Evaluation muSolventPow = Math::pow(muSolvent, 0.25);
 
         Evaluation muMixOilSolvent = muOil;
         if ( std::abs(oilSolventEffSat.value()) > cutOff)
-            muMixOilSolvent *= muSolvent / pow( ( (oilEffSat / oilSolventEffSat) * muSolventPow) + ( (solventEffSat / oilSolventEffSat) * muOilPow) , 4.0);
+            muMixOilSolvent *= muSolvent / Math::pow( ( (oilEffSat / oilSolventEffSat) * muSolventPow) + ( (solventEffSat / oilSolventEffSat) * muOilPow) , 4.0);
         Evaluation muMixSolventGas = muGas;
         if ( std::abs(solventGasEffSat.value()) > cutOff)
-            muMixSolventGas *= muSolvent / pow( ( (gasEffSat / solventGasEffSat) * muSolventPow) + ( (solventEffSat / solventGasEffSat) * muGasPow) , 4.0);
+            muMixSolventGas *= muSolvent / Math::pow( ( (gasEffSat / solventGasEffSat) * muSolventPow) + ( (solventEffSat / solventGasEffSat) * muGasPow) , 4.0);
 
         Evaluation muMixSolventGasOil = muOil;
         if (std::abs(oilGasSolventEffSat.value()) > cutOff)
-            muMixSolventGasOil *= muSolvent * muGas / pow( ( (oilEffSat / oilGasSolventEffSat) * muSolventPow *  muGasPow)
+            muMixSolventGasOil *= muSolvent * muGas / Math::pow( ( (oilEffSat / oilGasSolventEffSat) * muSolventPow *  muGasPow)
                   + ( (solventEffSat / oilGasSolventEffSat) * muOilPow *  muGasPow) + ( (gasEffSat / oilGasSolventEffSat) * muSolventPow * muOilPow), 4.0);
 
         // Mixing parameter for viscosity
         // The pressureMixingParameter represent the miscibility of the solvent while the mixingParameterViscosity the effect of the porous media.
         // The pressureMixingParameter is not implemented in ecl100.
-        const Evaluation& po = fs.pressure(oilPhaseIdx);
-        const auto& tlPMixTable = SolventModule::tlPMixTable(elemCtx, scvIdx, timeIdx);
-        const Evaluation tlMixParamMu = SolventModule::tlMixParamViscosity(elemCtx, scvIdx, timeIdx) * tlPMixTable.eval(po,  /*extrapolate=*/true);
+        const Evaluation tlMixParamMu = SolventModule::tlMixParamViscosity(elemCtx, scvIdx, timeIdx) * tlPMixValue_;
 
-        Evaluation muOilEff = pow(muOil,1.0 - tlMixParamMu) * pow(muMixOilSolvent, tlMixParamMu);
-        Evaluation muGasEff = pow(muGas,1.0 - tlMixParamMu) * pow(muMixSolventGas, tlMixParamMu);
-        Evaluation muSolventEff = pow(muSolvent,1.0 - tlMixParamMu) * pow(muMixSolventGasOil, tlMixParamMu);
+        Evaluation muOilEff = Math::pow(muOil,1.0 - tlMixParamMu) * Math::pow(muMixOilSolvent, tlMixParamMu);
+        Evaluation muGasEff = Math::pow(muGas,1.0 - tlMixParamMu) * Math::pow(muMixSolventGas, tlMixParamMu);
+        Evaluation muSolventEff = Math::pow(muSolvent,1.0 - tlMixParamMu) * Math::pow(muMixSolventGasOil, tlMixParamMu);
 
         // Compute effective densities
         const Evaluation& rhoGas = fs.density(gasPhaseIdx);
@@ -1151,13 +1156,13 @@ private:
         // Mixing parameter for density
         // The pressureMixingParameter represent the miscibility of the solvent while the mixingParameterDenisty the effect of the porous media.
         // The pressureMixingParameter is not implemented in ecl100.
-        const Evaluation tlMixParamRho = SolventModule::tlMixParamDensity(elemCtx, scvIdx, timeIdx) * tlPMixTable.eval(po,  /*extrapolate=*/true);
+        const Evaluation tlMixParamRho = SolventModule::tlMixParamDensity(elemCtx, scvIdx, timeIdx) * tlPMixValue_;
 
         // compute effective viscosities for density calculations. These have to
         // be recomputed as a different mixing parameter may be used.
-        const Evaluation muOilEffPow = pow(pow(muOil, 1.0 - tlMixParamRho) * pow(muMixOilSolvent, tlMixParamRho), 0.25);
-        const Evaluation muGasEffPow = pow(pow(muGas, 1.0 - tlMixParamRho) * pow(muMixSolventGas, tlMixParamRho), 0.25);
-        const Evaluation muSolventEffPow = pow(pow(muSolvent, 1.0 - tlMixParamRho) * pow(muMixSolventGasOil, tlMixParamRho), 0.25);
+        const Evaluation muOilEffPow = Math::pow(Math::pow(muOil, 1.0 - tlMixParamRho) * Math::pow(muMixOilSolvent, tlMixParamRho), 0.25);
+        const Evaluation muGasEffPow = Math::pow(Math::pow(muGas, 1.0 - tlMixParamRho) * Math::pow(muMixSolventGas, tlMixParamRho), 0.25);
+        const Evaluation muSolventEffPow = Math::pow(Math::pow(muSolvent, 1.0 - tlMixParamRho) * Math::pow(muMixSolventGasOil, tlMixParamRho), 0.25);
 
         const Evaluation oilGasEffSaturation = oilEffSat + gasEffSat;
         Evaluation sof = 0.0;
@@ -1204,8 +1209,7 @@ private:
         const Evaluation bSolventEff = rhoSolventEff / solventRefDensity();
 
         // account for pressure effects
-        const auto& pmiscTable = SolventModule::pmisc(elemCtx, scvIdx, timeIdx);
-        const Evaluation pmisc = pmiscTable.eval(po, /*extrapolate=*/true);
+        const Evaluation& pmisc = pmiscValue_;
 
         // copy the unmodified invB factors
         const Evaluation bo = fs.invB(oilPhaseIdx);
@@ -1244,6 +1248,13 @@ protected:
 
     Evaluation hydrocarbonSaturation_;
     Evaluation solventSaturation_;
+
+    // the values of the PMISC, TLPMIXPA, SORWMIS and SGCWMIS tables for the current
+    // oil pressure and water saturation. these are only valid for miscible solvents.
+    Evaluation pmiscValue_;
+    Evaluation tlPMixValue_;
+    Evaluation sorwmisValue_;
+    Evaluation sgcwmisValue_;
     Evaluation solventDensity_;
     Evaluation solventViscosity_;
     Evaluation solventMobility_;
@@ -32,6 +32,7 @@
 
 #include "multiphasebaseproperties.hh"
 #include <ewoms/models/common/quantitycallbacks.hh>
+#include <ewoms/common/fusedadoperations.hh>
 
 #include <opm/common/Valgrind.hpp>
 #include <opm/common/Unused.hpp>
@@ -200,18 +201,18 @@ protected:
         interiorDofIdx_ = static_cast<short>(i);
         exteriorDofIdx_ = static_cast<short>(j);
 
-        // calculate the "raw" pressure gradient
+        // calculate the "raw" pressure gradients of all phases in a single pass
+        gradCalc.calculateGradients(potentialGrad_,
+                                    elemCtx,
+                                    faceIdx,
+                                    pressureCallback,
+                                    numPhases);
         for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++phaseIdx) {
             if (!elemCtx.model().phaseIsConsidered(phaseIdx)) {
                 Opm::Valgrind::SetUndefined(potentialGrad_[phaseIdx]);
                 continue;
             }
 
-            pressureCallback.setPhaseIndex(phaseIdx);
-            gradCalc.calculateGradient(potentialGrad_[phaseIdx],
-                                       elemCtx,
-                                       faceIdx,
-                                       pressureCallback);
             Opm::Valgrind::CheckDefined(potentialGrad_[phaseIdx]);
         }
 
@@ -243,8 +244,8 @@ protected:
                     continue;
 
                 // calculate the hydrostatic pressure at the integration point of the face
-                auto rhoIn = intQuantsIn.fluidState().density(phaseIdx);
-                auto pStatIn = - rhoIn*(gIn*distVecIn);
+                const auto& rhoIn = intQuantsIn.fluidState().density(phaseIdx);
+                Scalar gDistIn = gIn*distVecIn;
 
                 // the quantities on the exterior side of the face do not influence the
                 // result for the TPFA scheme, so they can be treated as scalar values.
@@ -254,13 +255,18 @@ protected:
                 // compute the hydrostatic gradient between the two control volumes (this
                 // gradient exhibitis the same direction as the vector between the two
                 // control volume centers and the length (pStaticExterior -
-                // pStaticInterior)/distanceInteriorToExterior
-                EvalDimVector f(distVecTotal);
-                f *= (pStatEx - pStatIn)/absDistTotalSquared;
+                // pStaticInterior)/distanceInteriorToExterior. with pStaticInterior =
+                // -rhoIn*gDistIn, the factor of the vector between the centers is
+                // computed at once.
+                Evaluation f;
+                fusedAffine(f,
+                            pStatEx/absDistTotalSquared,
+                            gDistIn/absDistTotalSquared,
+                            rhoIn);
 
                 // calculate the final potential gradient
                 for (unsigned dimIdx = 0; dimIdx < dimWorld; ++dimIdx)
-                    potentialGrad_[phaseIdx][dimIdx] += f[dimIdx];
+                    fusedAxpy(potentialGrad_[phaseIdx][dimIdx], distVecTotal[dimIdx], f);
 
                 for (unsigned dimIdx = 0; dimIdx < potentialGrad_[phaseIdx].size(); ++dimIdx) {
                     if (!std::isfinite(Toolbox::value(potentialGrad_[phaseIdx][dimIdx]))) {
@@ -285,7 +291,7 @@ protected:
             // determine the upstream and downstream DOFs
             Evaluation tmp = 0.0;
             for (unsigned dimIdx = 0; dimIdx < faceNormal.size(); ++dimIdx)
-                tmp += potentialGrad_[phaseIdx][dimIdx]*faceNormal[dimIdx];
+                fusedAxpy(tmp, faceNormal[dimIdx], potentialGrad_[phaseIdx][dimIdx]);
 
             if (tmp > 0) {
                 upstreamDofIdx_[phaseIdx] = exteriorDofIdx_;
@@ -413,7 +419,7 @@ protected:
 
             Evaluation tmp = 0.0;
             for (unsigned dimIdx = 0; dimIdx < faceNormal.size(); ++dimIdx)
-                tmp += potentialGrad_[phaseIdx][dimIdx]*faceNormal[dimIdx];
+                fusedAxpy(tmp, faceNormal[dimIdx], potentialGrad_[phaseIdx][dimIdx]);
 
             if (tmp > 0) {
                 upstreamDofIdx_[phaseIdx] = exteriorDofIdx_;
@@ -457,7 +463,7 @@ protected:
             Opm::Valgrind::CheckDefined(filterVelocity_[phaseIdx]);
             volumeFlux_[phaseIdx] = 0.0;
             for (unsigned i = 0; i < normal.size(); ++i)
-                volumeFlux_[phaseIdx] += (filterVelocity_[phaseIdx][i] * normal[i]);
+                fusedAxpy(volumeFlux_[phaseIdx], normal[i], filterVelocity_[phaseIdx][i]);
         }
     }
 
@@ -486,7 +492,7 @@ protected:
             Opm::Valgrind::CheckDefined(filterVelocity_[phaseIdx]);
             volumeFlux_[phaseIdx] = 0.0;
             for (unsigned i = 0; i < normal.size(); ++i)
-                volumeFlux_[phaseIdx] += (filterVelocity_[phaseIdx][i] * normal[i]);
+                fusedAxpy(volumeFlux_[phaseIdx], normal[i], filterVelocity_[phaseIdx][i]);
         }
     }
 
@@ -41,6 +41,7 @@
 namespace Ewoms {
 namespace Properties {
 NEW_PROP_TAG(Indices);
+NEW_PROP_TAG(EnableLaggedTortuosity);
 }
 
 /*!
@@ -211,9 +212,11 @@ class DiffusionIntensiveQuantities<TypeTag, /*enableDiffusion=*/true>
     typedef typename GET_PROP_TYPE(TypeTag, Evaluation) Evaluation;
     typedef typename GET_PROP_TYPE(TypeTag, ElementContext) ElementContext;
     typedef typename GET_PROP_TYPE(TypeTag, FluidSystem) FluidSystem;
+    typedef typename GET_PROP_TYPE(TypeTag, IntensiveQuantities) IntensiveQuantities;
 
     enum { numPhases = FluidSystem::numPhases };
     enum { numComponents = FluidSystem::numComponents };
+    enum { enableLaggedTortuosity = GET_PROP_VALUE(TypeTag, EnableLaggedTortuosity) };
 
 public:
     /*!
@@ -252,20 +255,35 @@ protected:
         typedef Opm::MathToolbox<Evaluation> Toolbox;
 
         const auto& intQuants = elemCtx.intensiveQuantities(dofIdx, timeIdx);
+
+        // if the tortuosity is lagged, the values of the beginning of the time step are
+        // used for the current one. these are only available if the intensive
+        // quantities of the last time step are cached, else the tortuosity is
+        // calculated as usual.
+        const IntensiveQuantities* oldIntQuants = 0;
+        if (enableLaggedTortuosity && timeIdx == 0) {
+            unsigned globalDofIdx = elemCtx.globalSpaceIndex(dofIdx, timeIdx);
+            oldIntQuants = elemCtx.model().cachedIntensiveQuantities(globalDofIdx, /*timeIdx=*/1);
+        }
+
         for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++phaseIdx) {
             if (!elemCtx.model().phaseIsConsidered(phaseIdx))
                 continue;
 
-            // TODO: let the problem do this (this is a constitutive
-            // relation of which the model should be free of from the
-            // abstraction POV!)
-            const Evaluation& base =
-                Toolbox::max(0.0001,
-                             intQuants.porosity()
-                             * intQuants.fluidState().saturation(phaseIdx));
-            tortuosity_[phaseIdx] =
-                1.0 / (intQuants.porosity() * intQuants.porosity())
-                * Toolbox::pow(base, 7.0/3.0);
+            if (oldIntQuants)
+                tortuosity_[phaseIdx] = Toolbox::value(oldIntQuants->tortuosity(phaseIdx));
+            else {
+                // TODO: let the problem do this (this is a constitutive
+                // relation of which the model should be free of from the
+                // abstraction POV!)
+                const Evaluation& base =
+                    Toolbox::max(0.0001,
+                                 intQuants.porosity()
+                                 * intQuants.fluidState().saturation(phaseIdx));
+                tortuosity_[phaseIdx] =
+                    1.0 / (intQuants.porosity() * intQuants.porosity())
+                    * Toolbox::pow(base, 7.0/3.0);
+            }
 
             for (unsigned compIdx = 0; compIdx < numComponents; ++compIdx) {
                 diffusionCoefficient_[phaseIdx][compIdx] =
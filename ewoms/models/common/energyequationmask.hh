@@ -0,0 +1,233 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \copydoc Ewoms::EnergyEquationMask
+ */
+#ifndef EWOMS_ENERGY_EQUATION_MASK_HH
+#define EWOMS_ENERGY_EQUATION_MASK_HH
+
+#include <ewoms/aux/baseauxiliarymodule.hh>
+#include <ewoms/common/propertysystem.hh>
+#include <ewoms/common/parametersystem.hh>
+
+#include <opm/common/Unused.hpp>
+
+#include <cmath>
+#include <vector>
+
+namespace Ewoms {
+namespace Properties {
+NEW_PROP_TAG(Model);
+NEW_PROP_TAG(Indices);
+NEW_PROP_TAG(NumEq);
+NEW_PROP_TAG(EnergyEquationMaskTolerance);
+}
+
+/*!
+ * \ingroup Energy
+ *
+ * \brief Freezes the temperature of the degrees of freedom which are not affected by
+ *        heat transport.
+ *
+ * At the beginning of each time step, the temperature change of the last time step is
+ * determined for every degree of freedom. If neither a degree of freedom nor any of its
+ * neighbors in the sparsity pattern of the Jacobian matrix changed its temperature by
+ * more than the EnergyEquationMaskTolerance parameter, the energy equation of the degree
+ * of freedom is replaced by \f$ \Delta T = 0 \f$, i.e., the row of the Jacobian matrix
+ * only contains a one on the main diagonal and the residual is zero. Since the neighbors
+ * are considered, the heated zone can grow by one layer of degrees of freedom per time
+ * step.
+ *
+ * This is implemented as an auxiliary module which does not add any degrees of
+ * freedom, so it is applied after the grid has been linearized.
+ */
+template <class TypeTag>
+class EnergyEquationMask : public BaseAuxiliaryModule<TypeTag>
+{
+    typedef BaseAuxiliaryModule<TypeTag> ParentType;
+
+    typedef typename GET_PROP_TYPE(TypeTag, Scalar) Scalar;
+    typedef typename GET_PROP_TYPE(TypeTag, Model) Model;
+    typedef typename GET_PROP_TYPE(TypeTag, Indices) Indices;
+    typedef typename GET_PROP_TYPE(TypeTag, GlobalEqVector) GlobalEqVector;
+    typedef typename GET_PROP_TYPE(TypeTag, JacobianMatrix) JacobianMatrix;
+
+    typedef typename ParentType::NeighborSet NeighborSet;
+
+    enum { numEq = GET_PROP_VALUE(TypeTag, NumEq) };
+    enum { energyEqIdx = Indices::energyEqIdx };
+    enum { temperatureIdx = Indices::temperatureIdx };
+
+public:
+    EnergyEquationMask(const Model& model)
+        : model_(model)
+    {
+        tolerance_ = EWOMS_GET_PARAM(TypeTag, Scalar, EnergyEquationMaskTolerance);
+        numMaskedDofs_ = 0;
+    }
+
+    /*!
+     * \copydoc BaseAuxiliaryModule::numDofs()
+     */
+    virtual unsigned numDofs() const
+    { return 0; }
+
+    /*!
+     * \copydoc BaseAuxiliaryModule::addNeighbors()
+     */
+    virtual void addNeighbors(std::vector<NeighborSet>& neighbors OPM_UNUSED) const
+    { }
+
+    /*!
+     * \copydoc BaseAuxiliaryModule::applyInitial()
+     */
+    virtual void applyInitial()
+    { }
+
+    /*!
+     * \copydoc BaseAuxiliaryModule::linearize()
+     */
+    virtual void linearize(JacobianMatrix& matrix, GlobalEqVector& residual)
+    {
+        if (model_.newtonMethod().numIterations() == 0)
+            updateMask_(matrix);
+
+        if (numMaskedDofs_ == 0)
+            return;
+
+        unsigned numGridDof = static_cast<unsigned>(isMasked_.size());
+        for (unsigned dofIdx = 0; dofIdx < numGridDof; ++dofIdx) {
+            if (!isMasked_[dofIdx])
+                continue;
+
+            auto colIt = matrix[dofIdx].begin();
+            const auto& colEndIt = matrix[dofIdx].end();
+            for (; colIt != colEndIt; ++colIt)
+                (*colIt)[energyEqIdx] = 0.0;
+            matrix[dofIdx][dofIdx][energyEqIdx][temperatureIdx] = 1.0;
+
+            residual[dofIdx][energyEqIdx] = 0.0;
+        }
+    }
+
+    /*!
+     * \copydoc BaseAuxiliaryModule::linearizeResidual()
+     */
+    virtual void linearizeResidual(JacobianMatrix& matrix OPM_UNUSED, GlobalEqVector& residual)
+    {
+        if (numMaskedDofs_ == 0)
+            return;
+
+        unsigned numGridDof = static_cast<unsigned>(isMasked_.size());
+        for (unsigned dofIdx = 0; dofIdx < numGridDof; ++dofIdx)
+            if (isMasked_[dofIdx])
+                residual[dofIdx][energyEqIdx] = 0.0;
+    }
+
+    /*!
+     * \brief Returns true iff the energy equation of a degree of freedom is currently
+     *        replaced by a constant temperature.
+     */
+    bool isMasked(unsigned dofIdx) const
+    { return dofIdx < isMasked_.size() && isMasked_[dofIdx]; }
+
+    /*!
+     * \brief Returns the number of degrees of freedom for which the temperature is
+     *        currently frozen.
+     */
+    unsigned numMaskedDofs() const
+    { return numMaskedDofs_; }
+
+private:
+    // determine the degrees of freedom which are masked for the current time step. at
+    // this point, the solution at the beginning of the time step is the one at the end
+    // of the last one.
+    void updateMask_(const JacobianMatrix& matrix)
+    {
+        const auto& oldSol = model_.solution(/*timeIdx=*/1);
+        unsigned numGridDof = static_cast<unsigned>(model_.numGridDof());
+
+        // if the time step is repeated with a smaller step size, the solution at its
+        // beginning has not changed and the mask is kept
+        if (startTemperature_.size() == numGridDof) {
+            bool isRepeated = true;
+            for (unsigned dofIdx = 0; dofIdx < numGridDof && isRepeated; ++dofIdx)
+                isRepeated = (oldSol[dofIdx][temperatureIdx] == startTemperature_[dofIdx]);
+            if (isRepeated)
+                return;
+        }
+
+        lastStartTemperature_.swap(startTemperature_);
+        startTemperature_.resize(numGridDof);
+        for (unsigned dofIdx = 0; dofIdx < numGridDof; ++dofIdx)
+            startTemperature_[dofIdx] = oldSol[dofIdx][temperatureIdx];
+
+        isMasked_.assign(numGridDof, 0);
+        numMaskedDofs_ = 0;
+
+        // nothing is known about the temperature change before the first time step or
+        // after the grid was modified
+        if (lastStartTemperature_.size() != numGridDof)
+            return;
+
+        std::vector<unsigned char> isHeated(numGridDof, 0);
+        for (unsigned dofIdx = 0; dofIdx < numGridDof; ++dofIdx) {
+            Scalar deltaT = startTemperature_[dofIdx] - lastStartTemperature_[dofIdx];
+            isHeated[dofIdx] = std::abs(deltaT) > tolerance_;
+        }
+
+        for (unsigned dofIdx = 0; dofIdx < numGridDof; ++dofIdx) {
+            bool masked = true;
+            auto colIt = matrix[dofIdx].begin();
+            const auto& colEndIt = matrix[dofIdx].end();
+            for (; colIt != colEndIt; ++colIt) {
+                unsigned colIdx = static_cast<unsigned>(colIt.index());
+                // the columns of auxiliary degrees of freedom are not considered
+                if (colIdx < numGridDof && isHeated[colIdx]) {
+                    masked = false;
+                    break;
+                }
+            }
+
+            if (masked) {
+                isMasked_[dofIdx] = 1;
+                ++ numMaskedDofs_;
+            }
+        }
+    }
+
+    const Model& model_;
+    Scalar tolerance_;
+
+    // the temperatures at the beginning of the current and of the last time step
+    std::vector<Scalar> startTemperature_;
+    std::vector<Scalar> lastStartTemperature_;
+    std::vector<unsigned char> isMasked_;
+    unsigned numMaskedDofs_;
+};
+
+} // namespace Ewoms
+
+#endif
@@ -31,6 +31,7 @@
 
 #include <ewoms/disc/common/fvbaseproperties.hh>
 #include <ewoms/models/common/quantitycallbacks.hh>
+#include <ewoms/models/common/energyequationmask.hh>
 
 #include <opm/common/Valgrind.hpp>
 #include <opm/common/Unused.hpp>
@@ -39,6 +40,7 @@
 
 #include <dune/common/fvector.hh>
 
+#include <memory>
 #include <string>
 
 namespace Ewoms {
@@ -47,6 +49,8 @@ NEW_PROP_TAG(Indices);
 NEW_PROP_TAG(EnableEnergy);
 NEW_PROP_TAG(HeatConductionLaw);
 NEW_PROP_TAG(HeatConductionLawParams);
+NEW_PROP_TAG(EnableEnergyEquationMask);
+NEW_PROP_TAG(EnergyEquationMaskTolerance);
 }}
 
 namespace Ewoms {
@@ -84,6 +88,14 @@ public:
     static void registerParameters()
     {}
 
+    /*!
+     * \brief Add the auxiliary modules required by the energy module to the model.
+     *
+     * This must be called by the finishInit() method of the model.
+     */
+    static void finishInit(Model& model OPM_UNUSED)
+    {}
+
     /*!
      * \brief Returns the name of a primary variable or an empty
      *        string if the specified primary variable index does not belong to
@@ -255,7 +267,25 @@ public:
      * \brief Register all run-time parameters for the energy module.
      */
     static void registerParameters()
-    {}
+    {
+        EWOMS_REGISTER_PARAM(TypeTag, bool, EnableEnergyEquationMask,
+                             "Freeze the temperature of the degrees of freedom which are "
+                             "not affected by heat transport");
+        EWOMS_REGISTER_PARAM(TypeTag, Scalar, EnergyEquationMaskTolerance,
+                             "The temperature change per time step [K] below which the "
+                             "energy equation of a degree of freedom may be frozen");
+    }
+
+    /*!
+     * \brief Add the auxiliary modules required by the energy module to the model.
+     *
+     * This must be called by the finishInit() method of the model.
+     */
+    static void finishInit(Model& model)
+    {
+        if (EWOMS_GET_PARAM(TypeTag, bool, EnableEnergyEquationMask))
+            model.addAuxiliaryModule(std::make_shared<EnergyEquationMask<TypeTag> >(model));
+    }
 
     /*!
      * \brief Returns the name of a primary variable or an empty
@@ -631,13 +661,8 @@ protected:
                                     unsigned timeIdx)
     {
         const auto& priVars = context.primaryVars(spaceIdx, timeIdx);
-        Evaluation val;
-        if (timeIdx == 0)
-            val = Toolbox::createVariable(priVars[temperatureIdx], temperatureIdx);
-        else
-            val = Toolbox::createConstant(priVars[temperatureIdx]);
-
-        fluidState.setTemperature(val);
+        fluidState.setTemperature(priVars.makeEvaluation(temperatureIdx, timeIdx,
+                                                         context.linearizationType()));
     }
 
     /*!
@@ -385,9 +385,12 @@ protected:
 
     void calculateForchheimerFlux_(unsigned phaseIdx)
     {
-        // initial guess: filter velocity is zero
+        // initial guess: the Darcy velocity, i.e., the solution of the Forchheimer
+        // equation if the turbulence correction is zero. Compared to starting with a
+        // zero velocity, this saves most of the Newton iterations for slow flows.
         DimVector& velocity = this->filterVelocity_[phaseIdx];
         velocity = 0;
+        this->K_.usmv(-this->mobility_[phaseIdx], this->potentialGrad_[phaseIdx], velocity);
 
         // the change of velocity between two consecutive Newton iterations
         DimVector deltaV(1e5);
@@ -410,7 +413,7 @@ protected:
             gradForchheimerResid_(residual, gradResid, phaseIdx);
 
             // newton method
-            gradResid.solve(deltaV, residual);
+            solve_(deltaV, gradResid, residual);
             velocity -= deltaV;
         }
     }
@@ -451,20 +454,63 @@ protected:
                                DimMatrix& gradResid,
                                unsigned phaseIdx)
     {
-        DimVector& velocity = this->filterVelocity_[phaseIdx];
+        const DimVector& velocity = this->filterVelocity_[phaseIdx];
         forchheimerResid_(residual, phaseIdx);
 
-        Scalar eps = 1e-11;
-        DimVector tmp;
+        // the derivative of the residual is given analytically by
+        //
+        // I + c sqrt(K) (abs(v) I + v v^T/abs(v))
+        //
+        // with c = \rho_\alpha * mobility_\alpha * C_E / \eta_{r,\alpha}. sqrt(K) is
+        // diagonal.
+        Scalar c = density_[phaseIdx]*mobilityPassabilityRatio_[phaseIdx]*ergunCoefficient_;
+        Scalar absV = velocity.two_norm();
         for (unsigned i = 0; i < dimWorld; ++i) {
-            Scalar coordEps = std::max(eps, velocity[i] * (1 + eps));
-            velocity[i] += coordEps;
-            forchheimerResid_(tmp, phaseIdx);
-            tmp -= residual;
-            tmp /= coordEps;
-            gradResid[i] = tmp;
-            velocity[i] -= coordEps;
+            for (unsigned j = 0; j < dimWorld; ++j) {
+                Scalar dAbsVv = (absV > 0.0) ? velocity[i]*velocity[j]/absV : 0.0;
+                if (i == j)
+                    dAbsVv += absV;
+                gradResid[i][j] = c*sqrtK_[i][i]*dAbsVv;
+            }
+            gradResid[i][i] += 1.0;
+        }
+    }
+
+    // solve a dimWorld x dimWorld linear system of equations. for two and three
+    // dimensions, Cramer's rule is used.
+    static void solve_(DimVector& x, const DimMatrix& A, const DimVector& b)
+    {
+        if (dimWorld == 2) {
+            Scalar det = A[0][0]*A[1][1] - A[0][1]*A[1][0];
+            if (std::abs(det) > 1e-30) {
+                x[0] = (b[0]*A[1][1] - A[0][1]*b[1])/det;
+                x[1] = (A[0][0]*b[1] - b[0]*A[1][0])/det;
+                return;
+            }
         }
+        else if (dimWorld == 3) {
+            // the cofactors of the first row
+            Scalar c00 = A[1][1]*A[2][2] - A[1][2]*A[2][1];
+            Scalar c01 = A[1][2]*A[2][0] - A[1][0]*A[2][2];
+            Scalar c02 = A[1][0]*A[2][1] - A[1][1]*A[2][0];
+            Scalar det = A[0][0]*c00 + A[0][1]*c01 + A[0][2]*c02;
+            if (std::abs(det) > 1e-30) {
+                // x = adj(A) b / det(A)
+                x[0] = (c00*b[0]
+                        + (A[0][2]*A[2][1] - A[0][1]*A[2][2])*b[1]
+                        + (A[0][1]*A[1][2] - A[0][2]*A[1][1])*b[2])/det;
+                x[1] = (c01*b[0]
+                        + (A[0][0]*A[2][2] - A[0][2]*A[2][0])*b[1]
+                        + (A[0][2]*A[1][0] - A[0][0]*A[1][2])*b[2])/det;
+                x[2] = (c02*b[0]
+                        + (A[0][1]*A[2][0] - A[0][0]*A[2][1])*b[1]
+                        + (A[0][0]*A[1][1] - A[0][1]*A[1][0])*b[2])/det;
+                return;
+            }
+        }
+
+        // other dimensions and (almost) singular matrices
+        A.solve(x, b);
     }
 
     /*!
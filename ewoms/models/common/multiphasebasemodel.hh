@@ -109,6 +109,15 @@ SET_TYPE_PROP(MultiPhaseBaseModel,
 //! disable gravity by default
 SET_BOOL_PROP(MultiPhaseBaseModel, EnableGravity, false);
 
+//! do not freeze the energy equation of DOFs without heat transport by default
+SET_BOOL_PROP(MultiPhaseBaseModel, EnableEnergyEquationMask, false);
+
+//! temperature changes below 1 mK per time step are considered to be negligible
+SET_SCALAR_PROP(MultiPhaseBaseModel, EnergyEquationMaskTolerance, 1e-3);
+
+//! evaluate the tortuosity used for molecular diffusion fully implicitly by default
+SET_BOOL_PROP(MultiPhaseBaseModel, EnableLaggedTortuosity, false);
+
 } // namespace Properties
 
 /*!
@@ -59,6 +59,14 @@ NEW_PROP_TAG(FluxModule);
 
 //! Returns whether gravity is considered in the problem
 NEW_PROP_TAG(EnableGravity);
+
+//! Specifies whether the energy equation of DOFs without heat transport is frozen
+NEW_PROP_TAG(EnableEnergyEquationMask);
+//! The temperature change below which the energy equation of a DOF may be frozen [K]
+NEW_PROP_TAG(EnergyEquationMaskTolerance);
+
+//! Specifies whether the tortuosity of the last time step is used for diffusion
+NEW_PROP_TAG(EnableLaggedTortuosity);
 } // namespace Properties
 } // namespace Ewoms
 
@@ -114,6 +114,15 @@ public:
         return elemCtx_.intensiveQuantities(dofIdx, /*timeIdx=*/0).fluidState().pressure(phaseIdx_);
     }
 
+    /*!
+     * \brief Return the pressure of a given phase given the index of a degree of
+     *        freedom within an element context.
+     *
+     * This is used to calculate the gradients of all phase pressures at once.
+     */
+    ResultType operator()(unsigned dofIdx, unsigned phaseIdx) const
+    { return elemCtx_.intensiveQuantities(dofIdx, /*timeIdx=*/0).fluidState().pressure(phaseIdx); }
+
 private:
     const ElementContext& elemCtx_;
     unsigned short phaseIdx_;
@@ -0,0 +1,430 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \brief This file contains the necessary classes to calculate the volumetric fluxes
+ *        using a two-point flux approximation.
+ */
+#ifndef EWOMS_TPFA_FLUX_MODULE_HH
+#define EWOMS_TPFA_FLUX_MODULE_HH
+
+#include "darcyfluxmodule.hh"
+
+#include <ewoms/parallel/locks.hh>
+
+#include <opm/common/Valgrind.hpp>
+#include <opm/common/ErrorMacros.hpp>
+#include <opm/common/Exceptions.hpp>
+
+#include <dune/common/fvector.hh>
+#include <dune/common/fmatrix.hh>
+#include <dune/common/version.hh>
+
+#include <atomic>
+#include <vector>
+#include <cassert>
+#include <cmath>
+
+namespace Ewoms {
+template <class TypeTag>
+class TpfaExtensiveQuantities;
+
+template <class TypeTag>
+class TpfaBaseProblem;
+
+/*!
+ * \ingroup FluxModules
+ * \brief Specifies a flux module which uses a two-point flux approximation of the
+ *        Darcy relation.
+ *
+ * The volumetric flux over an interior face is given by the transmissibility of the
+ * face times the difference of the pressure potentials of the two adjacent degrees of
+ * freedom. This is exact if the grid is K-orthogonal, i.e., if the permeability times
+ * the vector between the centers of the two adjacent control volumes is parallel to the
+ * face normal. This is the case for the ECFV discretization on the grids of the
+ * StructuredGridManager and the CubeGridManager with diagonal permeabilities. Compared to
+ * the DarcyFluxModule, no gradient vectors need to be computed.
+ *
+ * The flux module can be selected using
+ * \code
+ * SET_TYPE_PROP(MyProblemTypeTag, FluxModule, Ewoms::TpfaFluxModule<TypeTag>);
+ * \endcode
+ */
+template <class TypeTag>
+struct TpfaFluxModule
+{
+    typedef DarcyIntensiveQuantities<TypeTag> FluxIntensiveQuantities;
+    typedef TpfaExtensiveQuantities<TypeTag> FluxExtensiveQuantities;
+    typedef TpfaBaseProblem<TypeTag> FluxBaseProblem;
+
+    /*!
+     * \brief Register all run-time parameters for the flux module.
+     */
+    static void registerParameters()
+    { }
+};
+
+/*!
+ * \ingroup FluxModules
+ * \brief Provides the transmissibilities required by the two-point flux approximation.
+ *
+ * By default, the transmissibility of an interior face is calculated from the
+ * intrinsic permeabilities of the adjacent degrees of freedom and the geometry of the
+ * stencil. Since the permeabilities are assumed to be constant, this is done once for
+ * all interior faces of the grid when the first transmissibility is requested, i.e.,
+ * after the problem has been fully initialized. If the permeabilities or the grid
+ * change, invalidateTransmissibilities() must be called. Problems may also overload
+ * the transmissibility() method, e.g., to return values which they compute themselves.
+ */
+template <class TypeTag>
+class TpfaBaseProblem
+{
+    typedef typename GET_PROP_TYPE(TypeTag, Problem) Implementation;
+    typedef typename GET_PROP_TYPE(TypeTag, Scalar) Scalar;
+    typedef typename GET_PROP_TYPE(TypeTag, GridView) GridView;
+    typedef typename GET_PROP_TYPE(TypeTag, ElementContext) ElementContext;
+
+    typedef typename GridView::template Codim<0>::Iterator ElementIterator;
+
+    enum { dimWorld = GridView::dimensionworld };
+
+    typedef Dune::FieldVector<Scalar, dimWorld> DimVector;
+    typedef Dune::FieldMatrix<Scalar, dimWorld, dimWorld> DimMatrix;
+
+public:
+    TpfaBaseProblem()
+        : transmissibilitiesValid_(false)
+    { }
+
+    /*!
+     * \brief Returns the transmissibility of an interior face of a stencil [m^3].
+     *
+     * The transmissibility is the harmonic mean of the half-transmissibilities of the
+     * two control volumes which are adjacent to the face.
+     *
+     * \param context Reference to the object which represents the current execution
+     *                context.
+     * \param faceIdx The local index of the interior face in the stencil
+     * \param timeIdx The index used by the time discretization.
+     */
+    template <class Context>
+    Scalar transmissibility(const Context& context,
+                            unsigned faceIdx,
+                            unsigned timeIdx OPM_UNUSED) const
+    {
+        if (!transmissibilitiesValid_.load(std::memory_order_acquire))
+            updateTransmissibilities_();
+
+#if DUNE_VERSION_NEWER(DUNE_COMMON, 2, 4)
+        unsigned elemIdx = static_cast<unsigned>(context.model().elementMapper().index(context.element()));
+#else
+        unsigned elemIdx = static_cast<unsigned>(context.model().elementMapper().map(context.element()));
+#endif
+        assert(faceOffsets_[elemIdx] + faceIdx < transmissibilities_.size());
+        return transmissibilities_[faceOffsets_[elemIdx] + faceIdx];
+    }
+
+    /*!
+     * \brief Discard the precomputed transmissibilities.
+     *
+     * They are calculated again when the next transmissibility is requested. This must
+     * be called if the grid or the intrinsic permeabilities have changed.
+     */
+    void invalidateTransmissibilities()
+    { transmissibilitiesValid_.store(false, std::memory_order_release); }
+
+private:
+    // calculate the transmissibilities of the interior faces of all elements. the
+    // transmissibilities of the faces of an element are stored contiguously, starting
+    // at the element's entry of faceOffsets_.
+    void updateTransmissibilities_() const
+    {
+        ScopedLock lock(transmissibilitiesMutex_);
+        if (transmissibilitiesValid_.load(std::memory_order_relaxed))
+            // another thread has been faster
+            return;
+
+        const auto& simulator = asImp_().simulator();
+        const auto& gridView = simulator.gridView();
+
+        faceOffsets_.resize(static_cast<size_t>(gridView.size(/*codim=*/0)));
+        transmissibilities_.clear();
+
+        // the faces of the ghost and overlap elements are required as well because
+        // these elements are linearized to calculate the fluxes over the process
+        // boundaries
+        ElementContext elemCtx(simulator);
+        ElementIterator elemIt = gridView.template begin</*codim=*/0>();
+        const ElementIterator& elemEndIt = gridView.template end</*codim=*/0>();
+        for (; elemIt != elemEndIt; ++elemIt) {
+            const auto& elem = *elemIt;
+            elemCtx.updateStencil(elem);
+
+#if DUNE_VERSION_NEWER(DUNE_COMMON, 2, 4)
+            unsigned elemIdx = static_cast<unsigned>(elemCtx.model().elementMapper().index(elem));
+#else
+            unsigned elemIdx = static_cast<unsigned>(elemCtx.model().elementMapper().map(elem));
+#endif
+            faceOffsets_[elemIdx] = static_cast<unsigned>(transmissibilities_.size());
+
+            size_t numFaces = elemCtx.stencil(/*timeIdx=*/0).numInteriorFaces();
+            for (unsigned faceIdx = 0; faceIdx < numFaces; ++faceIdx)
+                transmissibilities_.push_back(computeTransmissibility_(elemCtx, faceIdx));
+        }
+
+        transmissibilitiesValid_.store(true, std::memory_order_release);
+    }
+
+    Scalar computeTransmissibility_(const ElementContext& elemCtx, unsigned faceIdx) const
+    {
+        unsigned timeIdx = 0;
+        const auto& stencil = elemCtx.stencil(timeIdx);
+        const auto& face = stencil.interiorFace(faceIdx);
+        unsigned i = face.interiorIndex();
+        unsigned j = face.exteriorIndex();
+
+        Scalar halfTransIn =
+            halfTransmissibility_(asImp_().intrinsicPermeability(elemCtx, i, timeIdx),
+                                  elemCtx.pos(i, timeIdx),
+                                  face);
+        Scalar halfTransEx =
+            halfTransmissibility_(asImp_().intrinsicPermeability(elemCtx, j, timeIdx),
+                                  elemCtx.pos(j, timeIdx),
+                                  face);
+
+        // avoid division by zero
+        if (std::abs(halfTransIn) < 1e-30 || std::abs(halfTransEx) < 1e-30)
+            return 0.0;
+
+        return 1.0/(1.0/halfTransIn + 1.0/halfTransEx);
+    }
+
+    template <class Face>
+    static Scalar halfTransmissibility_(const DimMatrix& K,
+                                        const DimVector& dofPos,
+                                        const Face& face)
+    {
+        DimVector distVec(face.integrationPos());
+        distVec -= dofPos;
+
+        DimVector Kd;
+        K.mv(distVec, Kd);
+
+        return face.area()*std::abs(Kd*face.normal())/distVec.two_norm2();
+    }
+
+    const Implementation& asImp_() const
+    { return *static_cast<const Implementation *>(this); }
+
+    mutable std::vector<Scalar> transmissibilities_;
+    mutable std::vector<unsigned> faceOffsets_;
+    mutable std::atomic<bool> transmissibilitiesValid_;
+    mutable OmpMutex transmissibilitiesMutex_;
+};
+
+/*!
+ * \ingroup FluxModules
+ * \brief Provides the extensive quantities of the two-point flux approximation
+ *
+ * Only interior faces are treated by the two-point flux approximation, boundary fluxes
+ * are calculated like in the DarcyFluxModule. The potential gradients and filter
+ * velocities which are provided for the interior faces only exhibit the direction of
+ * the line between the centers of the adjacent control volumes and the direction of the
+ * face normal, respectively.
+ */
+template <class TypeTag>
+class TpfaExtensiveQuantities : public DarcyExtensiveQuantities<TypeTag>
+{
+    typedef DarcyExtensiveQuantities<TypeTag> ParentType;
+
+    typedef typename GET_PROP_TYPE(TypeTag, ElementContext) ElementContext;
+    typedef typename GET_PROP_TYPE(TypeTag, Scalar) Scalar;
+    typedef typename GET_PROP_TYPE(TypeTag, Evaluation) Evaluation;
+    typedef typename GET_PROP_TYPE(TypeTag, GridView) GridView;
+    typedef typename GET_PROP_TYPE(TypeTag, FluidSystem) FluidSystem;
+
+    enum { dimWorld = GridView::dimensionworld };
+    enum { numPhases = GET_PROP_VALUE(TypeTag, NumPhases) };
+
+    typedef typename Opm::MathToolbox<Evaluation> Toolbox;
+    typedef Dune::FieldVector<Scalar, dimWorld> DimVector;
+
+public:
+    /*!
+     * \brief Return the difference of the pressure potentials of a fluid phase between
+     *        the exterior and the interior degree of freedom of an interior face [Pa]
+     *
+     * \param phaseIdx The index of the fluid phase
+     */
+    const Evaluation& potentialDifference(unsigned phaseIdx) const
+    { return potentialDifference_[phaseIdx]; }
+
+protected:
+    /*!
+     * \brief Calculate the pressure potential differences and the upstream directions
+     *        of an interior face.
+     */
+    void calculateGradients_(const ElementContext& elemCtx,
+                             unsigned faceIdx,
+                             unsigned timeIdx)
+    {
+        const auto& problem = elemCtx.problem();
+        const auto& scvf = elemCtx.stencil(timeIdx).interiorFace(faceIdx);
+
+        unsigned i = scvf.interiorIndex();
+        unsigned j = scvf.exteriorIndex();
+        this->interiorDofIdx_ = static_cast<short>(i);
+        this->exteriorDofIdx_ = static_cast<short>(j);
+
+        transmissibility_ = problem.transmissibility(elemCtx, faceIdx, timeIdx);
+
+        const auto& intQuantsIn = elemCtx.intensiveQuantities(i, timeIdx);
+        const auto& intQuantsEx = elemCtx.intensiveQuantities(j, timeIdx);
+
+        const auto& posIn = elemCtx.pos(i, timeIdx);
+        const auto& posEx = elemCtx.pos(j, timeIdx);
+        const auto& posFace = scvf.integrationPos();
+
+        DimVector distVecTotal(posEx);
+        distVecTotal -= posIn;
+        Scalar absDistTotalSquared = distVecTotal.two_norm2();
+        bool exteriorIsDownstreamOfNormal = (distVecTotal*scvf.normal()) > 0;
+
+        // the hydrostatic pressures are calculated like in the DarcyFluxModule
+        bool enableGravity = EWOMS_GET_PARAM(TypeTag, bool, EnableGravity);
+        Scalar gTimesDistIn = 0.0;
+        Scalar gTimesDistEx = 0.0;
+        if (enableGravity) {
+            DimVector distVecIn(posIn);
+            DimVector distVecEx(posEx);
+            distVecIn -= posFace;
+            distVecEx -= posFace;
+
+            gTimesDistIn = problem.gravity(elemCtx, i, timeIdx)*distVecIn;
+            gTimesDistEx = problem.gravity(elemCtx, j, timeIdx)*distVecEx;
+        }
+
+        for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++phaseIdx) {
+            if (!elemCtx.model().phaseIsConsidered(phaseIdx)) {
+                Opm::Valgrind::SetUndefined(this->potentialGrad_[phaseIdx]);
+                Opm::Valgrind::SetUndefined(potentialDifference_[phaseIdx]);
+                continue;
+            }
+
+            // the quantities on the exterior side of the face do not influence the
+            // result for the TPFA scheme, so they can be treated as scalar values.
+            potentialDifference_[phaseIdx] =
+                Toolbox::value(intQuantsEx.fluidState().pressure(phaseIdx))
+                - intQuantsIn.fluidState().pressure(phaseIdx);
+
+            if (enableGravity) {
+                const Evaluation& rhoIn = intQuantsIn.fluidState().density(phaseIdx);
+                Scalar rhoEx = Toolbox::value(intQuantsEx.fluidState().density(phaseIdx));
+
+                potentialDifference_[phaseIdx] -= rhoEx*gTimesDistEx;
+                potentialDifference_[phaseIdx] += rhoIn*gTimesDistIn;
+            }
+
+            if (!std::isfinite(Toolbox::value(potentialDifference_[phaseIdx])))
+                OPM_THROW(Opm::NumericalProblem,
+                          "Non-finite potential difference for phase '"
+                          << FluidSystem::phaseName(phaseIdx) << "'");
+
+            // the potential gradient along the line between the centers of the control
+            // volumes
+            for (unsigned dimIdx = 0; dimIdx < dimWorld; ++dimIdx)
+                this->potentialGrad_[phaseIdx][dimIdx] =
+                    potentialDifference_[phaseIdx]*(distVecTotal[dimIdx]/absDistTotalSquared);
+
+            // determine the upstream and downstream DOFs
+            bool exteriorIsUpstream =
+                (potentialDifference_[phaseIdx] > 0.0) == exteriorIsDownstreamOfNormal;
+            if (exteriorIsUpstream) {
+                this->upstreamDofIdx_[phaseIdx] = this->exteriorDofIdx_;
+                this->downstreamDofIdx_[phaseIdx] = this->interiorDofIdx_;
+            }
+            else {
+                this->upstreamDofIdx_[phaseIdx] = this->interiorDofIdx_;
+                this->downstreamDofIdx_[phaseIdx] = this->exteriorDofIdx_;
+            }
+
+            // see the DarcyFluxModule for why only the derivatives of the interior
+            // degree of freedom are considered
+            if (exteriorIsUpstream)
+                this->mobility_[phaseIdx] = Toolbox::value(intQuantsEx.mobility(phaseIdx));
+            else
+                this->mobility_[phaseIdx] = intQuantsIn.mobility(phaseIdx);
+        }
+
+        // the permeability of the face is not required by the two-point flux
+        // approximation
+        Opm::Valgrind::SetUndefined(this->K_);
+    }
+
+    /*!
+     * \brief Calculate the volumetric fluxes of all phases over an interior face
+     *
+     * The pressure potential differences and upwind directions must already be
+     * determined before calling this method!
+     */
+    void calculateFluxes_(const ElementContext& elemCtx, unsigned scvfIdx, unsigned timeIdx)
+    {
+        const auto& scvf = elemCtx.stencil(timeIdx).interiorFace(scvfIdx);
+        const DimVector& normal = scvf.normal();
+        Opm::Valgrind::CheckDefined(normal);
+
+        // the volume flux is expressed per area of the face
+        Scalar transPerArea = transmissibility_/scvf.area();
+
+        DimVector distVecTotal(elemCtx.pos(scvf.exteriorIndex(), timeIdx));
+        distVecTotal -= elemCtx.pos(scvf.interiorIndex(), timeIdx);
+        Scalar orientation = (distVecTotal*normal > 0) ? 1.0 : -1.0;
+
+        for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++phaseIdx) {
+            this->filterVelocity_[phaseIdx] = 0.0;
+            this->volumeFlux_[phaseIdx] = 0.0;
+            if (!elemCtx.model().phaseIsConsidered(phaseIdx))
+                continue;
+
+            this->volumeFlux_[phaseIdx] =
+                this->mobility_[phaseIdx]*potentialDifference_[phaseIdx]*(-orientation*transPerArea);
+
+            for (unsigned dimIdx = 0; dimIdx < dimWorld; ++dimIdx)
+                this->filterVelocity_[phaseIdx][dimIdx] =
+                    this->volumeFlux_[phaseIdx]*normal[dimIdx];
+        }
+    }
+
+private:
+    // the difference of the pressure potentials between the exterior and the interior
+    // degree of freedom [Pa]
+    Evaluation potentialDifference_[numPhases];
+
+    // the transmissibility of the face [m^3]
+    Scalar transmissibility_;
+};
+
+} // namespace Ewoms
+
+#endif
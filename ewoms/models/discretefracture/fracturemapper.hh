@@ -31,12 +31,19 @@
 
 #include <algorithm>
 #include <set>
+#include <vector>
 
 namespace Ewoms {
 
 /*!
  * \ingroup DiscreteFractureModel
  * \brief Stores the topology of fractures.
+ *
+ * The fracture edges are collected using addFractureEdge(). Calling finalize()
+ * afterwards stores them as a compact adjacency list, which makes the queries of the
+ * discrete fracture model cheap: For vertices which are not touched by any fracture, a
+ * single bit needs to be checked, otherwise the fracture edges of the vertex are
+ * scanned.
  */
 template <class TypeTag>
 class FractureMapper
@@ -63,7 +70,7 @@ public:
      * \brief Constructor
      */
     FractureMapper()
-    {}
+    { isFinalized_ = false; }
 
     /*!
      * \brief Marks an edge as having a fracture.
@@ -76,15 +83,68 @@ public:
         fractureEdges_.insert(FractureEdge(vertexIdx1, vertexIdx2));
         fractureVertices_.insert(vertexIdx1);
         fractureVertices_.insert(vertexIdx2);
+        isFinalized_ = false;
     }
 
+    /*!
+     * \brief Convert the fracture edges to the compact representation.
+     *
+     * This must be called after all fracture edges have been added. Adding a further
+     * edge reverts to the slower representation until finalize() is called again.
+     */
+    void finalize()
+    {
+        unsigned numVertices = 0;
+        if (!fractureVertices_.empty())
+            numVertices = *fractureVertices_.rbegin() + 1;
+
+        isFractureVertex_.assign(numVertices, false);
+        for (unsigned vertexIdx : fractureVertices_)
+            isFractureVertex_[vertexIdx] = true;
+
+        // count the fracture edges of each vertex
+        neighborBegin_.assign(numVertices + 1, 0);
+        for (const auto& edge : fractureEdges_) {
+            ++ neighborBegin_[edge.i_ + 1];
+            ++ neighborBegin_[edge.j_ + 1];
+        }
+        for (unsigned vertexIdx = 0; vertexIdx < numVertices; ++vertexIdx)
+            neighborBegin_[vertexIdx + 1] += neighborBegin_[vertexIdx];
+
+        // the edges are sorted lexicographically, so the neighbors with lower indices
+        // are inserted before the ones with higher indices and both are ascending
+        std::vector<unsigned> pos(neighborBegin_.begin(), neighborBegin_.end() - 1);
+        neighbors_.resize(neighborBegin_.back());
+        neighborEdgeIdx_.resize(neighborBegin_.back());
+        unsigned edgeIdx = 0;
+        for (const auto& edge : fractureEdges_) {
+            neighbors_[pos[edge.i_]] = edge.j_;
+            neighborEdgeIdx_[pos[edge.i_]++] = edgeIdx;
+            neighbors_[pos[edge.j_]] = edge.i_;
+            neighborEdgeIdx_[pos[edge.j_]++] = edgeIdx;
+            ++ edgeIdx;
+        }
+
+        isFinalized_ = true;
+    }
+
+    /*!
+     * \brief Returns the number of fracture edges.
+     */
+    unsigned numFractureEdges() const
+    { return static_cast<unsigned>(fractureEdges_.size()); }
+
     /*!
      * \brief Returns true iff a fracture cuts through a given vertex.
      *
      * \param vertexIdx The index of the vertex.
      */
     bool isFractureVertex(unsigned vertexIdx) const
-    { return fractureVertices_.count(vertexIdx) > 0; }
+    {
+        if (isFinalized_)
+            return vertexIdx < isFractureVertex_.size() && isFractureVertex_[vertexIdx];
+        return fractureVertices_.count(vertexIdx) > 0;
+    }
 
     /*!
      * \brief Returns true iff a fracture is associated with a given edge.
@@ -94,13 +154,46 @@ public:
      */
     bool isFractureEdge(unsigned vertex1Idx, unsigned vertex2Idx) const
     {
+        if (isFinalized_)
+            return fractureEdgeIndex(vertex1Idx, vertex2Idx) >= 0;
+
         FractureEdge tmp(vertex1Idx, vertex2Idx);
         return fractureEdges_.count(tmp) > 0;
     }
 
+    /*!
+     * \brief Returns the index of the fracture edge between two vertices.
+     *
+     * The edges are numbered consecutively from 0 to numFractureEdges() - 1. If the
+     * edge does not feature a fracture or if finalize() has not been called, -1 is
+     * returned.
+     *
+     * \param vertex1Idx The index of the first vertex of the edge.
+     * \param vertex2Idx The index of the second vertex of the edge.
+     */
+    int fractureEdgeIndex(unsigned vertex1Idx, unsigned vertex2Idx) const
+    {
+        if (!isFinalized_ || !isFractureVertex(vertex1Idx) || !isFractureVertex(vertex2Idx))
+            return -1;
+
+        auto beginIt = neighbors_.begin() + neighborBegin_[vertex1Idx];
+        auto endIt = neighbors_.begin() + neighborBegin_[vertex1Idx + 1];
+        auto it = std::lower_bound(beginIt, endIt, vertex2Idx);
+        if (it == endIt || *it != vertex2Idx)
+            return -1;
+        return static_cast<int>(neighborEdgeIdx_[static_cast<size_t>(it - neighbors_.begin())]);
+    }
+
 private:
     std::set<FractureEdge> fractureEdges_;
     std::set<unsigned> fractureVertices_;
+
+    // the compact representation
+    bool isFinalized_;
+    std::vector<bool> isFractureVertex_;
+    std::vector<unsigned> neighborBegin_;
+    std::vector<unsigned> neighbors_;
+    std::vector<unsigned> neighborEdgeIdx_;
 };
 
 } // namespace Ewoms
@@ -114,8 +114,11 @@ public:
         // extract the total molar densities of the components
         ComponentVector cTotal;
         for (unsigned compIdx = 0; compIdx < numComponents; ++compIdx)
-            cTotal[compIdx] = priVars.makeEvaluation(cTot0Idx + compIdx, timeIdx);
+            cTotal[compIdx] = priVars.makeEvaluation(cTot0Idx + compIdx, timeIdx,
+                                                     elemCtx.linearizationType());
 
+        const auto& model = elemCtx.model();
+        unsigned globalDofIdx = elemCtx.globalSpaceIndex(dofIdx, timeIdx);
         const auto *hint = elemCtx.thermodynamicHint(dofIdx, timeIdx);
         if (hint) {
             // use the same fluid state as the one of the hint, but
@@ -125,7 +128,8 @@ public:
             fluidState_.assign(hint->fluidState());
             fluidState_.setTemperature(T);
         }
-        else
+        else if (!model.enableFlashWarmStart()
+                 || !model.flashWarmStart().assignInitialGuess(fluidState_, globalDofIdx, cTotal))
             FlashSolver::guessInitial(fluidState_, cTotal);
 
         // compute the phase compositions, densities and pressures
@@ -138,6 +142,18 @@ public:
                                                  cTotal,
                                                  flashTolerance);
 
+        // remember the result for the next time step. only the primary degrees of
+        // freedom are stored because the other ones are evaluated by several element
+        // contexts. if a primary degree of freedom is shared by multiple elements, the
+        // store needs to be locked.
+        if (model.enableFlashWarmStart()
+            && timeIdx == 0
+            && dofIdx < elemCtx.numPrimaryDof(timeIdx))
+        {
+            model.flashWarmStart().store(fluidState_, globalDofIdx,
+                                         GET_PROP_VALUE(TypeTag, UseLinearizationLock));
+        }
+
         // calculate relative permeabilities
         MaterialLaw::relativePermeabilities(relativePermeability_,
                                             materialParams, fluidState_);
@@ -38,6 +38,7 @@
 #include "flashintensivequantities.hh"
 #include "flashextensivequantities.hh"
 #include "flashindices.hh"
+#include "flashwarmstart.hh"
 
 #include <ewoms/models/common/multiphasebasemodel.hh>
 #include <ewoms/models/common/energymodule.hh>
@@ -76,6 +77,9 @@ SET_TYPE_PROP(FlashModel, FlashSolver,
 //! Let the flash solver choose its tolerance by default
 SET_SCALAR_PROP(FlashModel, FlashTolerance, -1.0);
 
+//! Do not keep the results of the flash calculations around by default
+SET_BOOL_PROP(FlashModel, EnableFlashWarmStart, false);
+
 //! the Model property
 SET_TYPE_PROP(FlashModel, Model, Ewoms::FlashModel<TypeTag>);
 
@@ -193,7 +197,9 @@ class FlashModel
 public:
     FlashModel(Simulator& simulator)
         : ParentType(simulator)
-    {}
+    {
+        enableFlashWarmStart_ = EWOMS_GET_PARAM(TypeTag, bool, EnableFlashWarmStart);
+    }
 
     /*!
      * \brief Register all run-time parameters for the immiscible model.
@@ -211,11 +217,95 @@ public:
         if (enableEnergy)
             Ewoms::VtkEnergyModule<TypeTag>::registerParameters();
 
+        EnergyModule::registerParameters();
+
         EWOMS_REGISTER_PARAM(TypeTag, Scalar, FlashTolerance,
                              "The maximum tolerance for the flash solver to "
                              "consider the solution converged");
+        EWOMS_REGISTER_PARAM(TypeTag, bool, EnableFlashWarmStart,
+                             "Use the results of the flash calculations of the last "
+                             "time step as the initial guesses of the flash solver");
+    }
+
+    /*!
+     * \copydoc FvBaseDiscretization::finishInit
+     */
+    void finishInit()
+    {
+        ParentType::finishInit();
+
+        if (enableFlashWarmStart_)
+            flashWarmStart_.resize(this->numGridDof());
+
+        EnergyModule::finishInit(*this);
+    }
+
+    /*!
+     * \copydoc FvBaseDiscretization::updateSuccessful
+     */
+    void updateSuccessful()
+    {
+        ParentType::updateSuccessful();
+
+        if (enableFlashWarmStart_)
+            flashWarmStart_.swap();
     }
 
+    /*!
+     * \copydoc FvBaseDiscretization::serializeBlocks
+     *
+     * If the caches are written to the restart file, the results of the flash
+     * calculations are written as well, so the flash solver is warm started after a
+     * restart.
+     */
+    template <class Restarter>
+    void serializeBlocks(Restarter& res)
+    {
+        ParentType::serializeBlocks(res);
+
+        if (this->restartWithCaches() && enableFlashWarmStart_) {
+            res.serializeSectionBegin("FlashWarmStart");
+            flashWarmStart_.serializeBlocks(res);
+            res.serializeSectionEnd();
+        }
+    }
+
+    /*!
+     * \copydoc FvBaseDiscretization::deserializeBlocks
+     */
+    template <class Restarter>
+    void deserializeBlocks(Restarter& res)
+    {
+        ParentType::deserializeBlocks(res);
+
+        if (res.hasSection("FlashWarmStart")) {
+            if (!enableFlashWarmStart_) {
+                res.skipSection("FlashWarmStart");
+                return;
+            }
+
+            res.deserializeSectionBegin("FlashWarmStart");
+            flashWarmStart_.deserializeBlocks(res);
+            res.deserializeSectionEnd();
+        }
+    }
+
+    /*!
+     * \brief Returns true iff the results of the flash calculations of the last time
+     *        step are used as the initial guesses of the flash solver.
+     */
+    bool enableFlashWarmStart() const
+    { return enableFlashWarmStart_; }
+
+    /*!
+     * \brief Returns the results of the flash calculations of the last time step.
+     *
+     * The object is modified by the intensive quantities, so it can be accessed by the
+     * const model.
+     */
+    FlashWarmStart<TypeTag>& flashWarmStart() const
+    { return flashWarmStart_; }
+
     /*!
      * \copydoc FvBaseDiscretization::name
      */
@@ -308,6 +398,10 @@ public:
         if (enableEnergy)
             this->addOutputModule(new Ewoms::VtkEnergyModule<TypeTag>(this->simulator_));
     }
+
+private:
+    mutable FlashWarmStart<TypeTag> flashWarmStart_;
+    bool enableFlashWarmStart_;
 };
 
 } // namespace Ewoms
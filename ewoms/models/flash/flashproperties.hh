@@ -43,6 +43,8 @@ NEW_PROP_TAG(FluidSystem);
 NEW_PROP_TAG(FlashSolver);
 //! The maximum accepted error of the flash solver
 NEW_PROP_TAG(FlashTolerance);
+//! Use the results of the last time step as the initial guess of the flash solver
+NEW_PROP_TAG(EnableFlashWarmStart);
 
 //! The heat conduction law which ought to be used
 NEW_PROP_TAG(HeatConductionLaw);
@@ -0,0 +1,254 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \copydoc Ewoms::FlashWarmStart
+ */
+#ifndef EWOMS_FLASH_WARM_START_HH
+#define EWOMS_FLASH_WARM_START_HH
+
+#include "flashproperties.hh"
+
+#include <ewoms/parallel/locks.hh>
+
+#include <opm/material/common/MathToolbox.hpp>
+
+#include <vector>
+
+namespace Ewoms {
+/*!
+ * \ingroup FlashModel
+ *
+ * \brief Stores the result of the flash calculation of each degree of freedom for the
+ *        last successful time step.
+ *
+ * The stored pressures, saturations and phase compositions (which implicitly contain
+ * the K-values) are used as the initial guess of the flash solver for the next time
+ * step. Compared to the intensive quantity cache, only a few scalar values are stored
+ * per degree of freedom.
+ *
+ * Two buffers are held: The results of the current time step are written to one of
+ * them, while the initial guesses are read from the other one. The buffers are swapped
+ * when a time step was successful, so reading and writing do not race.
+ */
+template <class TypeTag>
+class FlashWarmStart
+{
+    typedef typename GET_PROP_TYPE(TypeTag, Scalar) Scalar;
+
+    enum { numPhases = GET_PROP_VALUE(TypeTag, NumPhases) };
+    enum { numComponents = GET_PROP_VALUE(TypeTag, NumComponents) };
+
+    struct Entry
+    {
+        Scalar pressure[numPhases];
+        Scalar saturation[numPhases];
+        Scalar moleFraction[numPhases][numComponents];
+
+        // the index of the only present phase or -1 if multiple phases are present
+        int singlePhaseIdx;
+        bool isValid;
+    };
+
+    // the number of scalar values of an entry
+    enum { numEntryScalars = 2*numPhases + numPhases*numComponents };
+
+    template <class EntryT>
+    static auto entryScalar_(EntryT& entry, size_t i) -> decltype(entry.pressure[0])
+    {
+        if (i < numPhases)
+            return entry.pressure[i];
+        if (i < 2*numPhases)
+            return entry.saturation[i - numPhases];
+        i -= 2*numPhases;
+        return entry.moleFraction[i/numComponents][i%numComponents];
+    }
+
+public:
+    FlashWarmStart()
+    { readIdx_ = 0; }
+
+    /*!
+     * \brief Allocate the storage for a given number of degrees of freedom and
+     *        discard all stored results.
+     */
+    void resize(size_t numDof)
+    {
+        for (unsigned bufferIdx = 0; bufferIdx < 2; ++bufferIdx) {
+            buffer_[bufferIdx].resize(numDof);
+            for (size_t dofIdx = 0; dofIdx < numDof; ++dofIdx)
+                buffer_[bufferIdx][dofIdx].isValid = false;
+        }
+    }
+
+    /*!
+     * \brief Make the results of the current time step available as the initial
+     *        guesses of the next one.
+     *
+     * This must not be called concurrently with the other methods.
+     */
+    void swap()
+    { readIdx_ = 1 - readIdx_; }
+
+    /*!
+     * \brief Write the initial guesses for the next time step to a binary restart file.
+     */
+    template <class Restarter>
+    void serializeBlocks(Restarter& res) const
+    {
+        const auto& readBuffer = buffer_[readIdx_];
+        size_t numDof = readBuffer.size();
+
+        res.template serializeBlock<Scalar>(numDof*numEntryScalars,
+                                            [&readBuffer](size_t i)
+                                            { return entryScalar_(readBuffer[i/numEntryScalars],
+                                                                  i%numEntryScalars); });
+        res.template serializeBlock<int>(numDof,
+                                         [&readBuffer](size_t dofIdx)
+                                         { return readBuffer[dofIdx].singlePhaseIdx; });
+        res.template serializeBlock<unsigned char>(numDof,
+                                                   [&readBuffer](size_t dofIdx)
+                                                   { return readBuffer[dofIdx].isValid ? 1 : 0; });
+    }
+
+    /*!
+     * \brief Read the initial guesses for the next time step from a binary restart
+     *        file.
+     *
+     * This is the inverse of serializeBlocks(). The storage must have been resized to
+     * the number of degrees of freedom of the grid before.
+     */
+    template <class Restarter>
+    void deserializeBlocks(Restarter& res)
+    {
+        auto& readBuffer = buffer_[readIdx_];
+        size_t numDof = readBuffer.size();
+
+        res.template deserializeBlock<Scalar>(numDof*numEntryScalars,
+                                              [&readBuffer](size_t i, Scalar value)
+                                              { entryScalar_(readBuffer[i/numEntryScalars],
+                                                             i%numEntryScalars) = value; });
+        res.template deserializeBlock<int>(numDof,
+                                           [&readBuffer](size_t dofIdx, int value)
+                                           { readBuffer[dofIdx].singlePhaseIdx = value; });
+        res.template deserializeBlock<unsigned char>(numDof,
+                                                     [&readBuffer](size_t dofIdx, unsigned char value)
+                                                     { readBuffer[dofIdx].isValid = (value != 0); });
+    }
+
+    /*!
+     * \brief Set the initial guess of the flash solver for a degree of freedom.
+     *
+     * If no result is available for the degree of freedom, false is returned and the
+     * fluid state is not modified. If the degree of freedom only contained a single
+     * phase, the composition of that phase is set to the total composition, which is
+     * the solution of the flash if the phase stays the only one.
+     */
+    template <class FluidState, class ComponentVector>
+    bool assignInitialGuess(FluidState& fluidState,
+                            unsigned globalDofIdx,
+                            const ComponentVector& cTotal) const
+    {
+        typedef typename FluidState::Scalar Evaluation;
+
+        const auto& readBuffer = buffer_[readIdx_];
+        if (globalDofIdx >= readBuffer.size() || !readBuffer[globalDofIdx].isValid)
+            return false;
+
+        const Entry& entry = readBuffer[globalDofIdx];
+        for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++phaseIdx) {
+            fluidState.setPressure(phaseIdx, entry.pressure[phaseIdx]);
+            fluidState.setSaturation(phaseIdx, entry.saturation[phaseIdx]);
+            for (unsigned compIdx = 0; compIdx < numComponents; ++compIdx)
+                fluidState.setMoleFraction(phaseIdx, compIdx, entry.moleFraction[phaseIdx][compIdx]);
+        }
+
+        if (entry.singlePhaseIdx >= 0) {
+            unsigned phaseIdx = static_cast<unsigned>(entry.singlePhaseIdx);
+
+            Evaluation sumc = 0.0;
+            for (unsigned compIdx = 0; compIdx < numComponents; ++compIdx)
+                sumc += cTotal[compIdx];
+            if (Opm::MathToolbox<Evaluation>::value(sumc) > 0.0) {
+                for (unsigned compIdx = 0; compIdx < numComponents; ++compIdx)
+                    fluidState.setMoleFraction(phaseIdx, compIdx, cTotal[compIdx]/sumc);
+            }
+        }
+
+        return true;
+    }
+
+    /*!
+     * \brief Store the result of the flash calculation for a degree of freedom.
+     *
+     * If several threads may store the result for the same degree of freedom at the
+     * same time, \c useLock must be true.
+     */
+    template <class FluidState>
+    void store(const FluidState& fluidState, unsigned globalDofIdx, bool useLock)
+    {
+        typedef Opm::MathToolbox<typename FluidState::Scalar> Toolbox;
+
+        Entry entry;
+        entry.singlePhaseIdx = -1;
+        unsigned numPresentPhases = 0;
+        for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++phaseIdx) {
+            entry.pressure[phaseIdx] = Toolbox::value(fluidState.pressure(phaseIdx));
+            entry.saturation[phaseIdx] = Toolbox::value(fluidState.saturation(phaseIdx));
+            for (unsigned compIdx = 0; compIdx < numComponents; ++compIdx)
+                entry.moleFraction[phaseIdx][compIdx] =
+                    Toolbox::value(fluidState.moleFraction(phaseIdx, compIdx));
+
+            // phases with a negligible saturation are considered to be absent
+            if (entry.saturation[phaseIdx] > 1e-10) {
+                ++ numPresentPhases;
+                entry.singlePhaseIdx = static_cast<int>(phaseIdx);
+            }
+        }
+        if (numPresentPhases != 1)
+            entry.singlePhaseIdx = -1;
+        entry.isValid = true;
+
+        // the grid may have been adapted without the store being resized
+        auto& writeBuffer = buffer_[1 - readIdx_];
+        if (globalDofIdx >= writeBuffer.size())
+            return;
+
+        if (useLock) {
+            ScopedLock lock(mutex_);
+            writeBuffer[globalDofIdx] = entry;
+        }
+        else
+            writeBuffer[globalDofIdx] = entry;
+    }
+
+private:
+    std::vector<Entry> buffer_[2];
+    unsigned readIdx_;
+    OmpMutex mutex_;
+};
+
+} // namespace Ewoms
+
+#endif
@@ -0,0 +1,376 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \copydoc Ewoms::ImmiscibleImpesSolver
+ */
+#ifndef EWOMS_IMMISCIBLE_IMPES_SOLVER_HH
+#define EWOMS_IMMISCIBLE_IMPES_SOLVER_HH
+
+#include "immiscibleproperties.hh"
+
+#include <ewoms/linear/parallelcprbackend.hh>
+#include <ewoms/common/parametersystem.hh>
+
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/bvector.hh>
+#include <dune/istl/operators.hh>
+#include <dune/istl/preconditioners.hh>
+#include <dune/istl/solvers.hh>
+#include <dune/istl/paamg/amg.hh>
+#include <dune/common/fmatrix.hh>
+#include <dune/common/fvector.hh>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace Ewoms {
+/*!
+ * \ingroup ImmiscibleModel
+ *
+ * \brief Computes the update of a time step of the immiscible model using the IMPES
+ *        (implicit pressure, explicit saturations) method.
+ *
+ * The solver works on the Jacobian of the fully implicit system at the solution of the
+ * last time step. The derivatives of the accumulation terms of a degree of freedom are
+ * obtained as the sums of the columns of the Jacobian: The fluxes between two degrees
+ * of freedom occur with opposite signs in their equations, so they cancel out.
+ *
+ * - The pressure step combines the equations of each degree of freedom such that the
+ *   combination does not depend on the accumulation of the saturations. The
+ *   saturations of all fluxes are treated explicitly, so this yields a scalar system
+ *   for the pressure, which is solved by the stabilized BiCG method preconditioned by
+ *   algebraic multi-grid.
+ *
+ * - The saturation step then evaluates the fluxes for the new pressure and the
+ *   saturations of the last time step, and determines the saturations which balance
+ *   them with the accumulation. This only requires to solve a small system per degree
+ *   of freedom. The temperature of non-isothermal models is treated like the
+ *   saturations.
+ *
+ * Since the saturations are explicit, the time step size is limited by the CFL
+ * number, i.e., the ratio of the outflow of a degree of freedom to its accumulation.
+ */
+template <class TypeTag>
+class ImmiscibleImpesSolver
+{
+    typedef typename GET_PROP_TYPE(TypeTag, Scalar) Scalar;
+    typedef typename GET_PROP_TYPE(TypeTag, GridView) GridView;
+    typedef typename GET_PROP_TYPE(TypeTag, JacobianMatrix) Matrix;
+    typedef typename GET_PROP_TYPE(TypeTag, GlobalEqVector) Vector;
+    typedef typename GET_PROP_TYPE(TypeTag, Indices) Indices;
+
+    enum { numEq = GET_PROP_VALUE(TypeTag, NumEq) };
+    enum { pressureIdx = Indices::pressure0Idx };
+
+    typedef Dune::FieldMatrix<Scalar, numEq, numEq> MatrixBlock;
+    typedef Dune::FieldVector<Scalar, numEq> VectorBlock;
+
+    typedef Dune::FieldMatrix<Scalar, 1, 1> PressureMatrixBlock;
+    typedef Dune::FieldVector<Scalar, 1> PressureVectorBlock;
+    typedef Dune::BCRSMatrix<PressureMatrixBlock> PressureMatrix;
+    typedef Dune::BlockVector<PressureVectorBlock> PressureVector;
+
+    typedef Dune::MatrixAdapter<PressureMatrix, PressureVector, PressureVector> PressureOperator;
+    typedef Dune::SeqSOR<PressureMatrix, PressureVector, PressureVector> PressureSmoother;
+    typedef Dune::Amg::AMG<PressureOperator, PressureVector, PressureSmoother> PressureAmg;
+
+public:
+    ImmiscibleImpesSolver()
+    {
+        pressureTolerance_ = EWOMS_GET_PARAM(TypeTag, Scalar, ImpesPressureTolerance);
+        maxPressureIterations_ = EWOMS_GET_PARAM(TypeTag, int, ImpesPressureMaxIterations);
+        lastIterations_ = 0;
+        maxCfl_ = 0.0;
+    }
+
+    /*!
+     * \brief Register all run-time parameters of the IMPES method.
+     */
+    static void registerParameters()
+    {
+        EWOMS_REGISTER_PARAM(TypeTag, Scalar, ImpesPressureTolerance,
+                             "The factor by which the residual of the pressure system is "
+                             "reduced by the linear solver of the IMPES method");
+        EWOMS_REGISTER_PARAM(TypeTag, int, ImpesPressureMaxIterations,
+                             "The maximum number of linear iterations for the pressure "
+                             "system of the IMPES method");
+    }
+
+    /*!
+     * \brief Causes the next pressure step to recreate the sparsity pattern of the
+     *        pressure system.
+     */
+    void eraseMatrix()
+    { pressureMatrix_ = PressureMatrix(); }
+
+    /*!
+     * \brief Returns the number of linear iterations of the last pressure step.
+     */
+    unsigned lastIterations() const
+    { return lastIterations_; }
+
+    /*!
+     * \brief Returns the largest CFL number of all degrees of freedom for the last
+     *        linearization passed to computeCfl().
+     */
+    Scalar maxCfl() const
+    { return maxCfl_; }
+
+    /*!
+     * \brief Determine the derivatives of the accumulation terms and the largest CFL
+     *        number of a linearization.
+     *
+     * This must be called before solvePressure() and solveSaturations().
+     *
+     * \param M The Jacobian matrix of the fully implicit system
+     * \param numGridDof The number of degrees of freedom which are associated with the
+     *                   grid. The auxiliary equations are not considered.
+     * \return The largest CFL number of all degrees of freedom
+     */
+    Scalar computeCfl(const Matrix& M, size_t numGridDof)
+    {
+        accumulation_.resize(numGridDof);
+        for (size_t i = 0; i < numGridDof; ++i)
+            accumulation_[i] = 0.0;
+
+        for (size_t rowIdx = 0; rowIdx < numGridDof; ++rowIdx) {
+            const auto& row = M[rowIdx];
+            auto colIt = row.begin();
+            const auto& colEndIt = row.end();
+            for (; colIt != colEndIt; ++colIt) {
+                size_t colIdx = colIt.index();
+                if (colIdx < numGridDof)
+                    accumulation_[colIdx] += *colIt;
+            }
+        }
+
+        // the difference between the diagonal block and the accumulation is the
+        // derivative of the outflow w.r.t. the primary variables of the degree of
+        // freedom itself
+        maxCfl_ = 0.0;
+        for (size_t rowIdx = 0; rowIdx < numGridDof; ++rowIdx) {
+            const auto& diagIt = M[rowIdx].find(rowIdx);
+            if (diagIt == M[rowIdx].end())
+                continue;
+
+            const MatrixBlock& diag = *diagIt;
+            const MatrixBlock& acc = accumulation_[rowIdx];
+            for (unsigned eqIdx = 0; eqIdx < numEq; ++eqIdx) {
+                for (unsigned pvIdx = 0; pvIdx < numEq; ++pvIdx) {
+                    if (pvIdx == pressureIdx || acc[eqIdx][pvIdx] == 0.0)
+                        continue;
+
+                    Scalar cfl = std::abs((diag[eqIdx][pvIdx] - acc[eqIdx][pvIdx])/acc[eqIdx][pvIdx]);
+                    maxCfl_ = std::max(maxCfl_, cfl);
+                }
+            }
+        }
+
+        return maxCfl_;
+    }
+
+    /*!
+     * \brief Compute the update of the pressure for a linearization.
+     *
+     * \param M The Jacobian matrix of the fully implicit system
+     * \param b The residual of the fully implicit system
+     * \param x The update of the primary variables. Only the pressure is set, all other
+     *          primary variables are not changed.
+     * \return true if the pressure system could be solved
+     */
+    bool solvePressure(const Matrix& M, const Vector& b, Vector& x)
+    {
+        updatePressureSystem_(M, b);
+
+        typedef typename Dune::Amg::SmootherTraits<PressureSmoother>::Arguments SmootherArgs;
+        typedef Dune::Amg::
+            CoarsenCriterion<Dune::Amg::SymmetricCriterion<PressureMatrix, Dune::Amg::FirstDiagonal> >
+            CoarsenCriterion;
+
+        SmootherArgs smootherArgs;
+        smootherArgs.iterations = 1;
+        smootherArgs.relaxationFactor = 1.0;
+
+        CoarsenCriterion coarsenCriterion(/*maxLevel=*/15, /*coarsenTarget=*/1200);
+        coarsenCriterion.setDefaultValuesAnisotropic(GridView::dimension,
+                                                     /*aggregateSizePerDim=*/3);
+        coarsenCriterion.setDebugLevel(0); // make the AMG shut up
+        coarsenCriterion.setMinCoarsenRate(1.05);
+        coarsenCriterion.setAccumulate(Dune::Amg::atOnceAccu);
+        coarsenCriterion.setSkipIsolated(false);
+
+        PressureOperator pressureOperator(pressureMatrix_);
+        PressureAmg amg(pressureOperator, coarsenCriterion, smootherArgs);
+        Dune::BiCGSTABSolver<PressureVector> solver(pressureOperator,
+                                                    amg,
+                                                    pressureTolerance_,
+                                                    maxPressureIterations_,
+                                                    /*verbosity=*/0);
+
+        // the solver overwrites the right hand side
+        PressureVector pressureUpdate(pressureRhs_.size());
+        pressureUpdate = 0.0;
+        Dune::InverseOperatorResult result;
+        solver.apply(pressureUpdate, pressureRhs_, result);
+        lastIterations_ = static_cast<unsigned>(result.iterations);
+
+        for (size_t rowIdx = 0; rowIdx < x.size(); ++rowIdx) {
+            if (!std::isfinite(pressureUpdate[rowIdx][0]))
+                return false;
+            x[rowIdx][pressureIdx] = pressureUpdate[rowIdx][0];
+        }
+
+        return result.converged;
+    }
+
+    /*!
+     * \brief Compute the update of the saturations given the update of the pressure.
+     *
+     * \param M The Jacobian matrix of the fully implicit system
+     * \param b The residual of the fully implicit system
+     * \param numGridDof The number of degrees of freedom which are associated with the
+     *                   grid. The rows of the auxiliary equations are not updated.
+     * \param x The update of the primary variables. The pressure must have been set by
+     *          solvePressure() and is not changed.
+     */
+    void solveSaturations(const Matrix& M, const Vector& b, size_t numGridDof, Vector& x) const
+    {
+        int numRows = static_cast<int>(numGridDof);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+        for (int i = 0; i < numRows; ++i) {
+            size_t rowIdx = static_cast<size_t>(i);
+
+            // the residual for the new pressure and the old saturations
+            VectorBlock rhs(b[rowIdx]);
+            const auto& row = M[rowIdx];
+            auto colIt = row.begin();
+            const auto& colEndIt = row.end();
+            for (; colIt != colEndIt; ++colIt) {
+                const MatrixBlock& block = *colIt;
+                Scalar pressureUpdate = x[colIt.index()][pressureIdx];
+                for (unsigned eqIdx = 0; eqIdx < numEq; ++eqIdx)
+                    rhs[eqIdx] -= block[eqIdx][pressureIdx]*pressureUpdate;
+            }
+
+            // if the pressure system was solved exactly, the equations are linearly
+            // dependent w.r.t. the saturations. the one which dominates the pressure
+            // equation is thus replaced by the condition that the pressure is not
+            // modified.
+            const VectorBlock& weights = weights_[rowIdx];
+            unsigned droppedEqIdx = 0;
+            for (unsigned eqIdx = 1; eqIdx < numEq; ++eqIdx)
+                if (std::abs(weights[eqIdx]) > std::abs(weights[droppedEqIdx]))
+                    droppedEqIdx = eqIdx;
+
+            MatrixBlock A(accumulation_[rowIdx]);
+            for (unsigned pvIdx = 0; pvIdx < numEq; ++pvIdx)
+                A[droppedEqIdx][pvIdx] = (pvIdx == pressureIdx) ? 1.0 : 0.0;
+            rhs[droppedEqIdx] = 0.0;
+
+            // degrees of freedom without any accumulation keep their saturations
+            VectorBlock update;
+            try {
+                A.solve(update, rhs);
+            }
+            catch (const Dune::FMatrixError&) {
+                continue;
+            }
+
+            for (unsigned pvIdx = 0; pvIdx < numEq; ++pvIdx)
+                if (pvIdx != pressureIdx)
+                    x[rowIdx][pvIdx] = update[pvIdx];
+        }
+    }
+
+private:
+    // compute the IMPES weights and the entries of the pressure system
+    void updatePressureSystem_(const Matrix& M, const Vector& b)
+    {
+        size_t numRows = M.N();
+        if (pressureMatrix_.N() != numRows || pressureMatrix_.nonzeroes() != M.nonzeroes()) {
+            pressureMatrix_ = PressureMatrix();
+            pressureMatrix_.setSize(numRows, M.M(), M.nonzeroes());
+            pressureMatrix_.setBuildMode(PressureMatrix::row_wise);
+            auto createIt = pressureMatrix_.createbegin();
+            auto rowIt = M.begin();
+            for (; createIt != pressureMatrix_.createend(); ++createIt, ++rowIt) {
+                auto colIt = rowIt->begin();
+                const auto& colEndIt = rowIt->end();
+                for (; colIt != colEndIt; ++colIt)
+                    createIt.insert(colIt.index());
+            }
+        }
+
+        weights_.resize(numRows);
+        pressureRhs_.resize(numRows);
+        for (size_t rowIdx = 0; rowIdx < numRows; ++rowIdx) {
+            const auto& row = M[rowIdx];
+            VectorBlock& weights = weights_[rowIdx];
+
+            const auto& diagIt = row.find(rowIdx);
+            if (diagIt == row.end() || rowIdx >= accumulation_.size())
+                weights = 1.0;
+            else {
+                // the weights eliminate the saturations from the accumulation terms.
+                // the pressure column of the diagonal block only normalizes them, so it
+                // also works for incompressible fluids.
+                MatrixBlock block(accumulation_[rowIdx]);
+                for (unsigned eqIdx = 0; eqIdx < numEq; ++eqIdx)
+                    block[eqIdx][pressureIdx] = (*diagIt)[eqIdx][pressureIdx];
+                Linear::computeQuasiImpesWeights(block, weights, pressureIdx);
+            }
+
+            pressureRhs_[rowIdx][0] = weights*b[rowIdx];
+
+            auto pressureColIt = pressureMatrix_[rowIdx].begin();
+            auto colIt = row.begin();
+            const auto& colEndIt = row.end();
+            for (; colIt != colEndIt; ++colIt, ++pressureColIt) {
+                const MatrixBlock& block = *colIt;
+                Scalar value = 0.0;
+                for (unsigned eqIdx = 0; eqIdx < numEq; ++eqIdx)
+                    value += weights[eqIdx]*block[eqIdx][pressureIdx];
+                *pressureColIt = value;
+            }
+        }
+    }
+
+    Scalar pressureTolerance_;
+    int maxPressureIterations_;
+    unsigned lastIterations_;
+    Scalar maxCfl_;
+
+    std::vector<MatrixBlock> accumulation_;
+    std::vector<VectorBlock> weights_;
+    PressureMatrix pressureMatrix_;
+    PressureVector pressureRhs_;
+};
+
+} // namespace Ewoms
+
+#endif
@@ -108,7 +108,8 @@ public:
 
         Evaluation sumSat = 0.0;
         for (unsigned phaseIdx = 0; phaseIdx < numPhases - 1; ++phaseIdx) {
-            const Evaluation& Salpha = priVars.makeEvaluation(saturation0Idx + phaseIdx, timeIdx);
+            const Evaluation& Salpha = priVars.makeEvaluation(saturation0Idx + phaseIdx, timeIdx,
+                                                              elemCtx.linearizationType());
             fluidState_.setSaturation(phaseIdx, Salpha);
             sumSat += Salpha;
         }
@@ -122,7 +123,8 @@ public:
         MaterialLaw::relativePermeabilities(relativePermeability_, materialParams, fluidState_);
         Opm::Valgrind::CheckDefined(relativePermeability_);
 
-        const Evaluation& p0 = priVars.makeEvaluation(pressure0Idx, timeIdx);
+        const Evaluation& p0 = priVars.makeEvaluation(pressure0Idx, timeIdx,
+                                                      elemCtx.linearizationType());
         for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++phaseIdx)
             fluidState_.setPressure(phaseIdx, p0 + (pC[phaseIdx] - pC[0]));
 
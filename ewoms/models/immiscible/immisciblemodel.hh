@@ -37,6 +37,7 @@
 #include "immiscibleratevector.hh"
 #include "immiscibleboundaryratevector.hh"
 #include "immisciblelocalresidual.hh"
+#include "immisciblenewtonmethod.hh"
 
 #include <ewoms/models/common/multiphasebasemodel.hh>
 #include <ewoms/models/common/energymodule.hh>
@@ -92,6 +93,15 @@ SET_TYPE_PROP(ImmiscibleModel, Indices, Ewoms::ImmiscibleIndices<TypeTag, /*PVOf
 //! Disable the energy equation by default
 SET_BOOL_PROP(ImmiscibleModel, EnableEnergy, false);
 
+//! Use the Newton method which can optionally solve the time steps using IMPES
+SET_TYPE_PROP(ImmiscibleModel, NewtonMethod, Ewoms::ImmiscibleNewtonMethod<TypeTag>);
+
+// by default, the time steps are solved fully implicitly
+SET_BOOL_PROP(ImmiscibleModel, EnableImpes, false);
+SET_SCALAR_PROP(ImmiscibleModel, ImpesMaxCfl, 1.0);
+SET_SCALAR_PROP(ImmiscibleModel, ImpesPressureTolerance, 1e-6);
+SET_INT_PROP(ImmiscibleModel, ImpesPressureMaxIterations, 200);
+
 /////////////////////
 // set slightly different properties for the single-phase case
 /////////////////////
@@ -223,10 +233,22 @@ public:
     {
         ParentType::registerParameters();
 
+        EnergyModule::registerParameters();
+
         if (enableEnergy)
             Ewoms::VtkEnergyModule<TypeTag>::registerParameters();
     }
 
+    /*!
+     * \copydoc FvBaseDiscretization::finishInit()
+     */
+    void finishInit()
+    {
+        ParentType::finishInit();
+
+        EnergyModule::finishInit(asImp_());
+    }
+
     /*!
      * \copydoc FvBaseDiscretization::name
      */
@@ -0,0 +1,194 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \copydoc Ewoms::ImmiscibleNewtonMethod
+ */
+#ifndef EWOMS_IMMISCIBLE_NEWTON_METHOD_HH
+#define EWOMS_IMMISCIBLE_NEWTON_METHOD_HH
+
+#include "immiscibleproperties.hh"
+#include "immiscibleimpessolver.hh"
+
+#include <opm/common/ErrorMacros.hpp>
+#include <opm/common/Exceptions.hpp>
+
+#include <algorithm>
+
+namespace Ewoms {
+
+/*!
+ * \ingroup ImmiscibleModel
+ *
+ * \brief A newton solver which is specific to the immiscible multi-phase model.
+ *
+ * If the EnableImpes parameter is set, each time step is not solved fully implicitly
+ * but by a single step of the IMPES method (cf. ImmiscibleImpesSolver). The time step
+ * is rejected if its CFL number exceeds ImpesMaxCfl, and the size of the next time step
+ * is chosen such that its CFL number is close to this limit.
+ */
+template <class TypeTag>
+class ImmiscibleNewtonMethod : public GET_PROP_TYPE(TypeTag, DiscNewtonMethod)
+{
+    typedef typename GET_PROP_TYPE(TypeTag, DiscNewtonMethod) ParentType;
+    typedef typename GET_PROP_TYPE(TypeTag, Simulator) Simulator;
+    typedef typename GET_PROP_TYPE(TypeTag, SolutionVector) SolutionVector;
+    typedef typename GET_PROP_TYPE(TypeTag, GlobalEqVector) GlobalEqVector;
+    typedef typename GET_PROP_TYPE(TypeTag, Scalar) Scalar;
+
+public:
+    ImmiscibleNewtonMethod(Simulator& simulator) : ParentType(simulator)
+    {
+        enableImpes_ = EWOMS_GET_PARAM(TypeTag, bool, EnableImpes);
+        if (enableImpes_ && simulator.gridView().comm().size() > 1)
+            OPM_THROW(Opm::NotImplemented,
+                      "The IMPES method is only supported for sequential runs");
+        if (enableImpes_ && EWOMS_GET_PARAM(TypeTag, bool, EnableCoarsePressurePredictor))
+            OPM_THROW(std::logic_error,
+                      "The IMPES method cannot be combined with the coarse pressure predictor");
+
+        impesStepSucceeded_ = false;
+    }
+
+    /*!
+     * \brief Register all run-time parameters for the immiscible model.
+     */
+    static void registerParameters()
+    {
+        ParentType::registerParameters();
+
+        EWOMS_REGISTER_PARAM(TypeTag, bool, EnableImpes,
+                             "Solve each time step by the IMPES method instead of the "
+                             "fully implicit Newton method");
+        EWOMS_REGISTER_PARAM(TypeTag, Scalar, ImpesMaxCfl,
+                             "The largest CFL number which is acceptable for a time step "
+                             "of the IMPES method");
+        ImmiscibleImpesSolver<TypeTag>::registerParameters();
+    }
+
+    /*!
+     * \copydoc NewtonMethod::eraseMatrix
+     */
+    void eraseMatrix()
+    {
+        impesSolver_.eraseMatrix();
+        ParentType::eraseMatrix();
+    }
+
+    /*!
+     * \copydoc NewtonMethod::converged
+     *
+     * A step of the IMPES method is always accepted if it could be computed.
+     */
+    bool converged() const
+    {
+        if (enableImpes_)
+            return impesStepSucceeded_;
+        return ParentType::converged();
+    }
+
+    /*!
+     * \copydoc NewtonMethod::suggestTimeStepSize
+     *
+     * For the IMPES method, the time step size is scaled such that the CFL number of
+     * the next time step is slightly below its limit. It is at most doubled, though.
+     */
+    Scalar suggestTimeStepSize(Scalar oldTimeStep) const
+    {
+        if (!enableImpes_)
+            return ParentType::suggestTimeStepSize(oldTimeStep);
+
+        // the CFL number is proportional to the time step size
+        Scalar maxCfl = EWOMS_GET_PARAM(TypeTag, Scalar, ImpesMaxCfl);
+        Scalar cfl = impesSolver_.maxCfl();
+        Scalar factor = 2.0;
+        if (cfl > 0.0)
+            factor = std::min(factor, 0.9*maxCfl/cfl);
+        return oldTimeStep*factor;
+    }
+
+protected:
+    friend NewtonMethod<TypeTag>;
+    friend ParentType;
+
+    /*!
+     * \copydoc NewtonMethod::begin_
+     */
+    void begin_(const SolutionVector& u)
+    {
+        ParentType::begin_(u);
+        impesStepSucceeded_ = false;
+    }
+
+    /*!
+     * \copydoc NewtonMethod::proceed_
+     */
+    bool proceed_() const
+    {
+        if (enableImpes_)
+            // the IMPES method does a single step per time step
+            return this->numIterations() < 1;
+        return ParentType::proceed_();
+    }
+
+    /*!
+     * \copydoc NewtonMethod::solveLinear_
+     */
+    bool solveLinear_(GlobalEqVector& solutionUpdate)
+    {
+        if (!enableImpes_)
+            return ParentType::solveLinear_(solutionUpdate);
+
+        const auto& linearizer = this->model().linearizer();
+        const auto& M = linearizer.matrix();
+        const auto& b = linearizer.residual();
+        size_t numGridDof = this->model().numGridDof();
+
+        // the step cannot be stable if the CFL number is too large, so the pressure
+        // system does not need to be solved in this case
+        Scalar cfl = impesSolver_.computeCfl(M, numGridDof);
+        this->endIterMsg() << ", CFL number: " << cfl;
+        if (cfl > EWOMS_GET_PARAM(TypeTag, Scalar, ImpesMaxCfl)) {
+            this->endIterMsg() << " (exceeds its limit)";
+            return false;
+        }
+
+        bool pressureConverged = impesSolver_.solvePressure(M, b, solutionUpdate);
+        this->numLinearIterations_ += impesSolver_.lastIterations();
+        if (!pressureConverged)
+            return false;
+
+        impesSolver_.solveSaturations(M, b, numGridDof, solutionUpdate);
+        impesStepSucceeded_ = true;
+        return true;
+    }
+
+private:
+    ImmiscibleImpesSolver<TypeTag> impesSolver_;
+    bool enableImpes_;
+    bool impesStepSucceeded_;
+};
+} // namespace Ewoms
+
+#endif
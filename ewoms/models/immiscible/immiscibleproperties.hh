@@ -52,6 +52,15 @@ NEW_PROP_TAG(NonwettingPhase);
 //! The fluid used by the model
 NEW_PROP_TAG(Fluid);
 
+//! Solve each time step using the IMPES method instead of the fully implicit one
+NEW_PROP_TAG(EnableImpes);
+//! The largest acceptable CFL number of a time step of the IMPES method
+NEW_PROP_TAG(ImpesMaxCfl);
+//! The relative tolerance of the linear solver for the pressure system of the IMPES method
+NEW_PROP_TAG(ImpesPressureTolerance);
+//! The maximum number of linear iterations for the pressure system of the IMPES method
+NEW_PROP_TAG(ImpesPressureMaxIterations);
+
 } // namespace Properties
 } // namespace Ewoms
 
@@ -43,6 +43,7 @@
 #include <ewoms/models/common/multiphasebasemodel.hh>
 #include <ewoms/models/common/energymodule.hh>
 #include <ewoms/models/common/diffusionmodule.hh>
+#include <ewoms/linear/localeliminationbackend.hh>
 #include <ewoms/io/vtkcompositionmodule.hh>
 #include <ewoms/io/vtkenergymodule.hh>
 #include <ewoms/io/vtkdiffusionmodule.hh>
@@ -118,6 +119,13 @@ SET_SCALAR_PROP(NcpModel, NcpSaturationsBaseWeight, 1.0);
 //! The unmodified weight for the fugacity primary variables
 SET_SCALAR_PROP(NcpModel, NcpFugacitiesBaseWeight, 1.0e-6);
 
+//! The complementarity conditions only depend on the unknowns of their own degree of
+//! freedom, so they can be eliminated locally if the LocalEliminationLinearSolver is used
+SET_INT_PROP(NcpModel, LocalEliminationFirstEqIdx,
+             GET_PROP_TYPE(TypeTag, Indices)::ncp0EqIdx);
+SET_INT_PROP(NcpModel, LocalEliminationNumEq,
+             GET_PROP_VALUE(TypeTag, NumPhases));
+
 } // namespace Properties
 
 /*!
@@ -257,6 +265,8 @@ public:
 
         minActivityCoeff_.resize(this->numGridDof());
         std::fill(minActivityCoeff_.begin(), minActivityCoeff_.end(), 1.0);
+
+        EnergyModule::finishInit(*this);
     }
 
     /*!
@@ -30,6 +30,8 @@
 
 #include "ncpproperties.hh"
 
+#include <ewoms/parallel/collectivewaittimes.hh>
+
 #include <opm/common/Unused.hpp>
 #include <opm/common/ErrorMacros.hpp>
 #include <opm/common/Exceptions.hpp>
@@ -77,46 +79,56 @@ protected:
     friend ParentType;
     friend NewtonMethod<TypeTag>;
 
-    void preSolve_(const SolutionVector& currentSolution OPM_UNUSED,
-                   const GlobalEqVector& currentResidual)
+    // calculate the error as the maximum weighted tolerance of the solution's residual.
+    // in addition to the DOFs of the auxiliary equations and the constraint DOFs, the
+    // NCP equations are not considered. the bookkeeping of the Newton method (e.g., the
+    // number of diverging iterations) is done by the base class' preSolve_().
+    Scalar residualError_(const GlobalEqVector& residual) const
     {
-        const auto& constraintsMap = this->model().linearizer().constraintsMap();
-        this->lastError_ = this->error_;
-
-        // calculate the error as the maximum weighted tolerance of
-        // the solution's residual
-        this->error_ = 0;
-        for (unsigned dofIdx = 0; dofIdx < currentResidual.size(); ++dofIdx) {
-            // do not consider auxiliary DOFs for the error
-            if (dofIdx >= this->model().numGridDof() || this->model().dofTotalVolume(dofIdx) <= 0.0)
-                continue;
-
-            // also do not consider DOFs which are constraint
-            if (this->enableConstraints_()) {
-                if (constraintsMap.count(dofIdx) > 0)
+        const auto& linearizer = this->model().linearizer();
+
+        Scalar error = 0;
+        int numGridDof = static_cast<int>(std::min<size_t>(this->model().numGridDof(),
+                                                           residual.size()));
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+        {
+            Scalar threadError = 0.0;
+
+#ifdef _OPENMP
+#pragma omp for
+#endif
+            for (int i = 0; i < numGridDof; ++i) {
+                unsigned dofIdx = static_cast<unsigned>(i);
+
+                // do not consider DOFs which are not associated with any volume
+                if (this->model().dofTotalVolume(dofIdx) <= 0.0)
                     continue;
-            }
 
-            const auto& r = currentResidual[dofIdx];
-            for (unsigned eqIdx = 0; eqIdx < r.size(); ++eqIdx) {
-                if (ncp0EqIdx <= eqIdx && eqIdx < Indices::ncp0EqIdx + numPhases)
+                // also do not consider DOFs which are constraint
+                if (this->enableConstraints_() && linearizer.isConstraintDof(dofIdx))
                     continue;
-                this->error_ =
-                    std::max(std::abs(r[eqIdx]*this->model().eqWeight(dofIdx, eqIdx)),
-                             this->error_);
+
+                const auto& r = residual[dofIdx];
+                for (unsigned eqIdx = 0; eqIdx < r.size(); ++eqIdx) {
+                    if (ncp0EqIdx <= eqIdx && eqIdx < Indices::ncp0EqIdx + numPhases)
+                        continue;
+                    threadError =
+                        std::max(std::abs(r[eqIdx]*this->model().eqWeight(dofIdx, eqIdx)),
+                                 threadError);
+                }
             }
+
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+            error = std::max(error, threadError);
         }
 
         // take the other processes into account
-        this->error_ = this->comm_.max(this->error_);
-
-        // make sure that the error never grows beyond the maximum
-        // allowed one
-        if (this->error_ > EWOMS_GET_PARAM(TypeTag, Scalar, NewtonMaxError))
-            OPM_THROW(Opm::NumericalProblem,
-                      "Newton: Error " << this->error_
-                      << " is larger than maximum allowed error of "
-                      << EWOMS_GET_PARAM(TypeTag, Scalar, NewtonMaxError));
+        CollectiveWaitTimer waitTimer("residualError");
+        return this->comm_.max(error);
     }
 
     /*!
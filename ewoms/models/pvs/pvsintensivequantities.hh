@@ -121,7 +121,9 @@ public:
         /////////////
         Evaluation sumSat = 0.0;
         for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++phaseIdx) {
-            fluidState_.setSaturation(phaseIdx, priVars.explicitSaturationValue(phaseIdx, timeIdx));
+            fluidState_.setSaturation(phaseIdx,
+                                      priVars.explicitSaturationValue(phaseIdx, timeIdx,
+                                                                      elemCtx.linearizationType()));
             Opm::Valgrind::CheckDefined(fluidState_.saturation(phaseIdx));
             sumSat += fluidState_.saturation(phaseIdx);
         }
@@ -140,7 +142,8 @@ public:
         MaterialLaw::capillaryPressures(pC, materialParams, fluidState_);
 
         // set the absolute phase pressures in the fluid state
-        const Evaluation& p0 = priVars.makeEvaluation(pressure0Idx, timeIdx);
+        const Evaluation& p0 = priVars.makeEvaluation(pressure0Idx, timeIdx,
+                                                      elemCtx.linearizationType());
         for (unsigned phaseIdx = 0; phaseIdx < numPhases; ++phaseIdx)
             fluidState_.setPressure(phaseIdx, p0 + (pC[phaseIdx] - pC[0]));
 
@@ -162,7 +165,8 @@ public:
             // contain the complete composition of the phase
             Evaluation sumx = 0.0;
             for (unsigned compIdx = 1; compIdx < numComponents; ++compIdx) {
-                const Evaluation& x = priVars.makeEvaluation(switch0Idx + compIdx - 1, timeIdx);
+                const Evaluation& x = priVars.makeEvaluation(switch0Idx + compIdx - 1, timeIdx,
+                                                             elemCtx.linearizationType());
                 fluidState_.setMoleFraction(lowestPresentPhaseIdx, compIdx, x);
                 sumx += x;
             }
@@ -193,7 +197,8 @@ public:
 
                 if (!priVars.phaseIsPresent(switchPhaseIdx)) {
                     auxConstraints[auxIdx].set(lowestPresentPhaseIdx, compIdx,
-                                               priVars.makeEvaluation(switch0Idx + switchIdx, timeIdx));
+                                               priVars.makeEvaluation(switch0Idx + switchIdx, timeIdx,
+                                                                      elemCtx.linearizationType()));
                     ++auxIdx;
                 }
             }
@@ -201,7 +206,8 @@ public:
             for (; auxIdx < numAuxConstraints; ++auxIdx, ++switchIdx) {
                 unsigned compIdx = numPhases - numNonPresentPhases + auxIdx;
                 auxConstraints[auxIdx].set(lowestPresentPhaseIdx, compIdx,
-                                           priVars.makeEvaluation(switch0Idx + switchIdx, timeIdx));
+                                           priVars.makeEvaluation(switch0Idx + switchIdx, timeIdx,
+                                                                  elemCtx.linearizationType()));
             }
 
             // both phases are present, i.e. phase compositions are a result of the the
@@ -246,6 +246,8 @@ public:
     {
         verbosity_ = EWOMS_GET_PARAM(TypeTag, int, PvsVerbosity);
         numSwitched_ = 0;
+        numOscillating_ = 0;
+        switchDofOwnerSeqNum_ = -1;
     }
 
     /*!
@@ -265,11 +267,23 @@ public:
         if (enableEnergy)
             Ewoms::VtkEnergyModule<TypeTag>::registerParameters();
 
+        EnergyModule::registerParameters();
+
         EWOMS_REGISTER_PARAM(TypeTag, int, PvsVerbosity,
                              "The verbosity level of the primary variable "
                              "switching model");
     }
 
+    /*!
+     * \copydoc FvBaseDiscretization::finishInit()
+     */
+    void finishInit()
+    {
+        ParentType::finishInit();
+
+        EnergyModule::finishInit(*this);
+    }
+
     /*!
      * \copydoc FvBaseDiscretization::name
      */
@@ -337,6 +351,9 @@ public:
     {
         ParentType::updateBegin();
 
+        // the phase state switches are counted for each time step
+        dofSwitchCount_.assign(this->numGridDof(), 0);
+
         // find the a reference pressure. The first degree of freedom
         // might correspond to non-interior entities which would lead
         // to an undefined value, so we have to iterate...
@@ -461,6 +478,52 @@ public:
         this->solution(/*timeIdx=*/1)[dofIdx].setPhasePresence(tmp);
     }
 
+    /*!
+     * \copydoc FvBaseDiscretization::serializeBlocks
+     */
+    template <class Restarter>
+    void serializeBlocks(Restarter& res)
+    {
+        // write primary variables
+        ParentType::serializeBlocks(res);
+
+        // write phase presence
+        const auto& sol = this->solution(/*timeIdx=*/0);
+        res.serializeSectionBegin("PvsPhasePresence");
+        res.template serializeBlock<short>(this->numGridDof(),
+                                           [&sol](size_t dofIdx)
+                                           { return sol[dofIdx].phasePresence(); });
+        res.serializeSectionEnd();
+    }
+
+    /*!
+     * \copydoc FvBaseDiscretization::deserializeBlocks
+     */
+    template <class Restarter>
+    void deserializeBlocks(Restarter& res)
+    {
+        // read primary variables
+        ParentType::deserializeBlocks(res);
+
+        // read phase presence
+        auto& sol = this->solution(/*timeIdx=*/0);
+        res.deserializeSectionBegin("PvsPhasePresence");
+        res.template deserializeBlock<short>(this->numGridDof(),
+                                             [&sol](size_t dofIdx, short value)
+                                             { sol[dofIdx].setPhasePresence(value); });
+        res.deserializeSectionEnd();
+    }
+
+    /*!
+     * \internal
+     * \copydoc FvBaseDiscretization::solutionIsExtrapolatable_
+     *
+     * The primary variables can only be extrapolated if the same phases are present.
+     */
+    bool solutionIsExtrapolatable_(const PrimaryVariables& priVars,
+                                   const PrimaryVariables& otherPriVars) const
+    { return priVars.phasePresence() == otherPriVars.phasePresence(); }
+
     /*!
      * \internal
      * \brief Do the primary variable switching after a Newton iteration.
@@ -471,60 +534,101 @@ public:
     void switchPrimaryVars_()
     {
         numSwitched_ = 0;
+        numOscillating_ = 0;
+
+        updateSwitchDofOwners_();
 
-        int succeeded;
-        try {
-            std::vector<bool> visited(this->numGridDof(), false);
+        int succeeded = 1;
+        const auto& grid = this->gridView_.grid();
+        const auto& elementSeeds = this->elementSeeds();
+        int numElems = static_cast<int>(elementSeeds.size());
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+        {
+            // Attention: the variables below are thread specific and thus cannot be
+            // moved in front of the #pragma!
             ElementContext elemCtx(this->simulator_);
+            unsigned threadSwitched = 0;
+            unsigned threadOscillating = 0;
 
-            ElementIterator elemIt = this->gridView_.template begin<0>();
-            ElementIterator elemEndIt = this->gridView_.template end<0>();
-            for (; elemIt != elemEndIt; ++elemIt) {
-                const Element& elem = *elemIt;
-                if (elem.partitionType() != Dune::InteriorEntity)
-                    continue;
-                elemCtx.updateStencil(elem);
+#ifdef _OPENMP
+#pragma omp for schedule(guided)
+#endif
+            for (int elemIdx = 0; elemIdx < numElems; ++elemIdx) {
+                try {
+#if DUNE_VERSION_NEWER(DUNE_GRID, 2, 4)
+                    const Element& elem = grid.entity(elementSeeds[elemIdx]);
+#else
+                    const auto& elemPtr = grid.entity(elementSeeds[elemIdx]);
+                    const Element& elem = *elemPtr;
+#endif
+                    if (elem.partitionType() != Dune::InteriorEntity)
+                        continue;
+                    elemCtx.updateStencil(elem);
 
-                size_t numLocalDof = elemCtx.stencil(/*timeIdx=*/0).numPrimaryDof();
-                for (unsigned dofIdx = 0; dofIdx < numLocalDof; ++dofIdx) {
-                    unsigned globalIdx = elemCtx.globalSpaceIndex(dofIdx, /*timeIdx=*/0);
+                    size_t numLocalDof = elemCtx.stencil(/*timeIdx=*/0).numPrimaryDof();
+                    for (unsigned dofIdx = 0; dofIdx < numLocalDof; ++dofIdx) {
+                        unsigned globalIdx = elemCtx.globalSpaceIndex(dofIdx, /*timeIdx=*/0);
 
-                    if (visited[globalIdx])
-                        continue;
-                    visited[globalIdx] = true;
-
-                    // compute the intensive quantities of the current degree of freedom
-                    auto& priVars = this->solution(/*timeIdx=*/0)[globalIdx];
-                    elemCtx.updateIntensiveQuantities(priVars, dofIdx, /*timeIdx=*/0);
-                    const IntensiveQuantities& intQuants = elemCtx.intensiveQuantities(dofIdx, /*timeIdx=*/0);
-
-                    // evaluate primary variable switch
-                    short oldPhasePresence = priVars.phasePresence();
-
-                    // set the primary variables and the new phase state
-                    // from the current fluid state
-                    priVars.assignNaive(intQuants.fluidState());
-
-                    if (oldPhasePresence != priVars.phasePresence()) {
-                        if (verbosity_ > 1)
-                            printSwitchedPhases_(elemCtx,
-                                                 dofIdx,
-                                                 intQuants.fluidState(),
-                                                 oldPhasePresence,
-                                                 priVars);
-                        ++numSwitched_;
+                        // each degree of freedom is only handled by a single element
+                        if (switchDofOwner_[globalIdx] != elemIdx)
+                            continue;
+
+                        // compute the intensive quantities of the current degree of freedom
+                        auto& priVars = this->solution(/*timeIdx=*/0)[globalIdx];
+                        elemCtx.updateIntensiveQuantities(priVars, dofIdx, /*timeIdx=*/0);
+                        const IntensiveQuantities& intQuants = elemCtx.intensiveQuantities(dofIdx, /*timeIdx=*/0);
+
+                        // evaluate primary variable switch
+                        short oldPhasePresence = priVars.phasePresence();
+
+                        // set the primary variables and the new phase state
+                        // from the current fluid state
+                        priVars.assignNaive(intQuants.fluidState());
+
+                        if (oldPhasePresence != priVars.phasePresence()) {
+                            if (verbosity_ > 1) {
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+                                printSwitchedPhases_(elemCtx,
+                                                     dofIdx,
+                                                     intQuants.fluidState(),
+                                                     oldPhasePresence,
+                                                     priVars);
+                            }
+                            ++threadSwitched;
+
+                            unsigned char& count = dofSwitchCount_[globalIdx];
+                            if (count >= 2)
+                                ++threadOscillating;
+                            if (count < 255)
+                                ++count;
+                        }
                     }
                 }
+                catch (...)
+                {
+                    std::cout << "rank " << this->simulator_.gridView().comm().rank()
+                              << " caught an exception during primary variable switching"
+                              << "\n"  << std::flush;
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+                    succeeded = 0;
+                }
             }
 
-            succeeded = 1;
-        }
-        catch (...)
-        {
-            std::cout << "rank " << this->simulator_.gridView().comm().rank()
-                      << " caught an exception during primary variable switching"
-                      << "\n"  << std::flush;
-            succeeded = 0;
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+            numSwitched_ += threadSwitched;
+
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+            numOscillating_ += threadOscillating;
         }
         succeeded = this->simulator_.gridView().comm().min(succeeded);
 
@@ -537,10 +641,29 @@ public:
         // other partition we will also set the switch flag
         // for our partition.
         numSwitched_ = this->gridView_.comm().sum(numSwitched_);
+        numOscillating_ = this->gridView_.comm().sum(numOscillating_);
 
-        if (verbosity_ > 0)
+        if (verbosity_ > 0) {
             this->simulator_.model().newtonMethod().endIterMsg()
                 << ", num switched=" << numSwitched_;
+            if (numOscillating_ > 0)
+                this->simulator_.model().newtonMethod().endIterMsg()
+                    << ", num oscillating=" << numOscillating_;
+        }
+    }
+
+    /*!
+     * \brief Returns how often the phase presence of a degree of freedom has changed
+     *        during the current time step.
+     *
+     * This can be used to stabilize degrees of freedom which oscillate between two
+     * phase states.
+     */
+    unsigned numDofSwitches(unsigned globalDofIdx) const
+    {
+        if (globalDofIdx >= dofSwitchCount_.size())
+            return 0;
+        return dofSwitchCount_[globalDofIdx];
     }
 
     template <class FluidState>
@@ -581,6 +704,42 @@ public:
         std::cout << "\n"  << std::flush;
     }
 
+    // determine the element which is responsible for switching the primary variables
+    // of each degree of freedom, i.e., the first interior element for which the
+    // degree of freedom is primary. this only needs to be done if the grid changed.
+    void updateSwitchDofOwners_()
+    {
+        int seqNum = this->simulator_.gridManager().gridSequenceNumber();
+        if (switchDofOwnerSeqNum_ == seqNum && switchDofOwner_.size() == this->numGridDof())
+            return;
+
+        switchDofOwner_.assign(this->numGridDof(), -1);
+        ElementContext elemCtx(this->simulator_);
+        const auto& grid = this->gridView_.grid();
+        const auto& elementSeeds = this->elementSeeds();
+        for (unsigned elemIdx = 0; elemIdx < elementSeeds.size(); ++elemIdx) {
+#if DUNE_VERSION_NEWER(DUNE_GRID, 2, 4)
+            const Element& elem = grid.entity(elementSeeds[elemIdx]);
+#else
+            const auto& elemPtr = grid.entity(elementSeeds[elemIdx]);
+            const Element& elem = *elemPtr;
+#endif
+            if (elem.partitionType() != Dune::InteriorEntity)
+                continue;
+            elemCtx.updateStencil(elem);
+
+            size_t numLocalDof = elemCtx.stencil(/*timeIdx=*/0).numPrimaryDof();
+            for (unsigned dofIdx = 0; dofIdx < numLocalDof; ++dofIdx) {
+                unsigned globalIdx = elemCtx.globalSpaceIndex(dofIdx, /*timeIdx=*/0);
+                if (switchDofOwner_[globalIdx] < 0)
+                    switchDofOwner_[globalIdx] = static_cast<int>(elemIdx);
+            }
+        }
+
+        dofSwitchCount_.resize(this->numGridDof(), 0);
+        switchDofOwnerSeqNum_ = seqNum;
+    }
+
     void registerOutputModules_()
     {
         ParentType::registerOutputModules_();
@@ -600,6 +759,19 @@ public:
     // iteration
     unsigned numSwitched_;
 
+    // number of degrees of freedom which switched their phase state in the last Newton
+    // iteration after they already did so twice in the current time step
+    unsigned numOscillating_;
+
+    // the number of phase state switches of each degree of freedom during the current
+    // time step
+    std::vector<unsigned char> dofSwitchCount_;
+
+    // the index of the element which is responsible for the primary variable switch of
+    // each degree of freedom
+    std::vector<int> switchDofOwner_;
+    int switchDofOwnerSeqNum_;
+
     // verbosity of the model
     int verbosity_;
 };
@@ -254,16 +254,16 @@ public:
      *
      * \copydoc Doxygen::phaseIdxParam
      */
-    Evaluation explicitSaturationValue(unsigned phaseIdx, unsigned timeIdx) const
+    Evaluation explicitSaturationValue(unsigned phaseIdx,
+                                       unsigned timeIdx,
+                                       const LinearizationType& linearizationType = LinearizationType()) const
     {
         if (!phaseIsPresent(phaseIdx) || phaseIdx == lowestPresentPhaseIdx())
             // non-present phases have saturation 0
             return 0.0;
 
         unsigned varIdx = switch0Idx + phaseIdx - 1;
-        if (timeIdx != 0)
-            Toolbox::createConstant((*this)[varIdx]);
-        return Toolbox::createVariable((*this)[varIdx], varIdx);
+        return this->makeEvaluation(varIdx, timeIdx, linearizationType);
     }
 
     /*!
@@ -72,7 +72,11 @@ class RichardsIntensiveQuantities
 
 public:
     //! The type returned by the fluidState() method
-    typedef Opm::ImmiscibleFluidState<Evaluation, FluidSystem> FluidState;
+    //!
+    //! The Richards model is always isothermal, so the enthalpies of the fluid phases
+    //! are not stored.
+    typedef Opm::ImmiscibleFluidState<Evaluation, FluidSystem,
+                                      /*storeEnthalpy=*/false> FluidState;
 
     RichardsIntensiveQuantities()
     {}
@@ -114,7 +118,8 @@ public:
         // non-wetting pressure can be larger than the
         // reference pressure if the medium is fully
         // saturated by the wetting phase
-        const Evaluation& pW = priVars.makeEvaluation(pressureWIdx, timeIdx);
+        const Evaluation& pW = priVars.makeEvaluation(pressureWIdx, timeIdx,
+                                                      elemCtx.linearizationType());
         Evaluation pN =
             Toolbox::max(elemCtx.problem().referencePressure(elemCtx, dofIdx, /*timeIdx=*/0),
                          pW + (pC[gasPhaseIdx] - pC[liquidPhaseIdx]));
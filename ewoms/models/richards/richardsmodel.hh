@@ -48,8 +48,10 @@
 #include <opm/material/fluidsystems/TwoPhaseImmiscibleFluidSystem.hpp>
 #include <opm/common/Unused.hpp>
 
+#include <algorithm>
 #include <sstream>
 #include <string>
+#include <vector>
 
 namespace Ewoms {
 template <class TypeTag>
@@ -110,6 +112,12 @@ SET_TYPE_PROP(Richards, NewtonMethod, Ewoms::RichardsNewtonMethod<TypeTag>);
 //! The class with all index definitions for the model
 SET_TYPE_PROP(Richards, Indices, Ewoms::RichardsIndices);
 
+//! Treat all degrees of freedom implicitly by default
+SET_BOOL_PROP(Richards, EnableAdaptiveImplicit, false);
+
+//! The CFL number below which a degree of freedom is treated explicitly
+SET_SCALAR_PROP(Richards, AdaptiveImplicitCflThreshold, 0.1);
+
 /*!
  * \brief The wetting phase used.
  *
@@ -237,8 +245,13 @@ class RichardsModel
     typedef typename GET_PROP_TYPE(TypeTag, Simulator) Simulator;
 
     typedef typename GET_PROP_TYPE(TypeTag, Scalar) Scalar;
+    typedef typename GET_PROP_TYPE(TypeTag, Evaluation) Evaluation;
     typedef typename GET_PROP_TYPE(TypeTag, FluidSystem) FluidSystem;
     typedef typename GET_PROP_TYPE(TypeTag, Indices) Indices;
+    typedef typename GET_PROP_TYPE(TypeTag, ElementContext) ElementContext;
+    typedef typename GET_PROP_TYPE(TypeTag, GridView) GridView;
+    typedef typename GridView::template Codim<0>::Entity Element;
+    typedef Opm::MathToolbox<Evaluation> Toolbox;
 
      static const unsigned numPhases = FluidSystem::numPhases;
      static const unsigned numComponents = FluidSystem::numComponents;
@@ -268,6 +281,10 @@ public:
         // gaseous. Think about it!
         assert(FluidSystem::isLiquid(liquidPhaseIdx));
         assert(!FluidSystem::isLiquid(gasPhaseIdx));
+
+        enableAdaptiveImplicit_ = EWOMS_GET_PARAM(TypeTag, bool, EnableAdaptiveImplicit);
+        cflThreshold_ = EWOMS_GET_PARAM(TypeTag, Scalar, AdaptiveImplicitCflThreshold);
+        numExplicitDofs_ = 0;
     }
 
     /*!
@@ -276,6 +293,13 @@ public:
     static void registerParameters()
     {
         ParentType::registerParameters();
+
+        EWOMS_REGISTER_PARAM(TypeTag, bool, EnableAdaptiveImplicit,
+                             "Remove the couplings of degrees of freedom with a small CFL "
+                             "number from the Jacobian matrix");
+        EWOMS_REGISTER_PARAM(TypeTag, Scalar, AdaptiveImplicitCflThreshold,
+                             "The CFL number of the last time step below which a degree of "
+                             "freedom is treated explicitly");
     }
 
     /*!
@@ -355,18 +379,129 @@ public:
         }
     }
 
+    /*!
+     * \copydoc FvBaseDiscretization::updateSuccessful
+     */
+    void updateSuccessful()
+    {
+        ParentType::updateSuccessful();
+
+        if (enableAdaptiveImplicit_)
+            updateExplicitDofs_();
+    }
+
     /*!
      * \copydoc FvBaseDiscretization::phaseIsConsidered
      */
     bool phaseIsConsidered(unsigned phaseIdx) const
     { return phaseIdx == liquidPhaseIdx; }
 
+    /*!
+     * \brief Returns true iff the adaptive implicit treatment of the degrees of freedom
+     *        is enabled.
+     */
+    bool enableAdaptiveImplicit() const
+    { return enableAdaptiveImplicit_; }
+
+    /*!
+     * \brief Returns true iff a degree of freedom is treated explicitly.
+     *
+     * The couplings of explicit degrees of freedom with their neighbors are removed from
+     * the Jacobian matrix, i.e., only the residual of the Newton method stays fully
+     * implicit. A degree of freedom is treated explicitly if the CFL number based on
+     * the fluxes of the last successful time step is below the threshold specified by
+     * the AdaptiveImplicitCflThreshold parameter.
+     */
+    bool isExplicitDof(unsigned globalDofIdx) const
+    { return globalDofIdx < isExplicitDof_.size() && isExplicitDof_[globalDofIdx]; }
+
+    /*!
+     * \brief Returns the number of degrees of freedom which are treated explicitly.
+     */
+    unsigned numExplicitDofs() const
+    { return numExplicitDofs_; }
+
     void registerOutputModules_()
     {
         ParentType::registerOutputModules_();
     }
 
+private:
+    // determine the degrees of freedom which can be treated explicitly using the
+    // volumes of liquid which left them during the last time step
+    void updateExplicitDofs_()
+    {
+        size_t numDof = this->numGridDof();
+        std::vector<Scalar> outflow(numDof, 0.0);
+        std::vector<Scalar> poreVolume(numDof, 0.0);
+
+        ElementContext elemCtx(this->simulator_);
+        const auto& grid = this->gridView_.grid();
+        const auto& elementSeeds = this->elementSeeds();
+        for (unsigned elemIdx = 0; elemIdx < elementSeeds.size(); ++elemIdx) {
+#if DUNE_VERSION_NEWER(DUNE_GRID, 2, 4)
+            const Element& elem = grid.entity(elementSeeds[elemIdx]);
+#else
+            const auto& elemPtr = grid.entity(elementSeeds[elemIdx]);
+            const Element& elem = *elemPtr;
+#endif
+            if (elem.partitionType() != Dune::InteriorEntity)
+                continue;
+
+            elemCtx.updateAll(elem);
+            const auto& stencil = elemCtx.stencil(/*timeIdx=*/0);
+            size_t numPrimaryDof = elemCtx.numPrimaryDof(/*timeIdx=*/0);
+            for (unsigned dofIdx = 0; dofIdx < numPrimaryDof; ++dofIdx) {
+                unsigned globalIdx = elemCtx.globalSpaceIndex(dofIdx, /*timeIdx=*/0);
+                const auto& intQuants = elemCtx.intensiveQuantities(dofIdx, /*timeIdx=*/0);
+                poreVolume[globalIdx] +=
+                    elemCtx.dofTotalVolume(dofIdx, /*timeIdx=*/0)
+                    * Toolbox::value(intQuants.porosity());
+            }
+
+            // the fluxes are attributed to their upstream degree of freedom. since the
+            // exterior degrees of freedom of the ECFV discretization see the face from
+            // their own element as well, only primary degrees of freedom are considered
+            size_t numInteriorFaces = elemCtx.numInteriorFaces(/*timeIdx=*/0);
+            for (unsigned scvfIdx = 0; scvfIdx < numInteriorFaces; ++scvfIdx) {
+                const auto& face = stencil.interiorFace(scvfIdx);
+                const auto& extQuants = elemCtx.extensiveQuantities(scvfIdx, /*timeIdx=*/0);
+
+                Scalar flux =
+                    Toolbox::value(extQuants.volumeFlux(liquidPhaseIdx))
+                    * face.area()
+                    * extQuants.extrusionFactor();
+
+                unsigned upstreamIdx = (flux > 0) ? face.interiorIndex() : face.exteriorIndex();
+                if (upstreamIdx < numPrimaryDof)
+                    outflow[elemCtx.globalSpaceIndex(upstreamIdx, /*timeIdx=*/0)] +=
+                        std::abs(flux);
+            }
+        }
+
+        Scalar dt = this->simulator_.timeStepSize();
+        isExplicitDof_.assign(numDof, false);
+        numExplicitDofs_ = 0;
+        for (unsigned dofIdx = 0; dofIdx < numDof; ++dofIdx) {
+            // the degrees of freedom which are not fully owned by this process are
+            // always treated implicitly
+            if (!this->isLocalDof(dofIdx) || !(poreVolume[dofIdx] > 0.0))
+                continue;
+
+            Scalar cfl = dt*outflow[dofIdx]/poreVolume[dofIdx];
+            if (cfl < cflThreshold_) {
+                isExplicitDof_[dofIdx] = true;
+                ++ numExplicitDofs_;
+            }
+        }
+    }
+
     mutable Scalar referencePressure_;
+
+    bool enableAdaptiveImplicit_;
+    Scalar cflThreshold_;
+    std::vector<bool> isExplicitDof_;
+    unsigned numExplicitDofs_;
 };
 } // namespace Ewoms
 
@@ -72,6 +72,39 @@ protected:
     friend NewtonMethod<TypeTag>;
     friend ParentType;
 
+    /*!
+     * \copydoc NewtonMethod::linearize_
+     *
+     * If the adaptive implicit treatment is enabled, the couplings of the degrees of
+     * freedom which are treated explicitly are removed from the Jacobian matrix. Since
+     * the residual is still evaluated fully implicitly, this only affects the rate of
+     * convergence of the Newton method, not its result.
+     */
+    void linearize_()
+    {
+        ParentType::linearize_();
+
+        auto& model = this->model();
+        if (!model.enableAdaptiveImplicit() || model.numExplicitDofs() == 0)
+            return;
+
+        auto& M = model.linearizer().matrix();
+        auto rowIt = M.begin();
+        const auto& rowEndIt = M.end();
+        for (; rowIt != rowEndIt; ++rowIt) {
+            unsigned rowIdx = static_cast<unsigned>(rowIt.index());
+            bool rowIsExplicit = model.isExplicitDof(rowIdx);
+
+            auto colIt = rowIt->begin();
+            const auto& colEndIt = rowIt->end();
+            for (; colIt != colEndIt; ++colIt) {
+                unsigned colIdx = static_cast<unsigned>(colIt.index());
+                if (colIdx != rowIdx && (rowIsExplicit || model.isExplicitDof(colIdx)))
+                    *colIt = 0.0;
+            }
+        }
+    }
+
     /*!
      * \copydoc FvBaseNewtonMethod::updatePrimaryVariables_
      */
@@ -57,6 +57,13 @@ NEW_PROP_TAG(LiquidComponentIndex);
 //! Index of the component which constitutes the gas
 NEW_PROP_TAG(GasComponentIndex);
 
+//! Specifies whether the couplings of degrees of freedom with a small CFL number should
+//! be removed from the Jacobian matrix
+NEW_PROP_TAG(EnableAdaptiveImplicit);
+
+//! The CFL number below which a degree of freedom is treated explicitly
+NEW_PROP_TAG(AdaptiveImplicitCflThreshold);
+
 // \}
 }} // namespace Properties, Ewoms
 
@@ -0,0 +1,519 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \copydoc Ewoms::Linear::StokesBackend
+ */
+#ifndef EWOMS_STOKES_BACKEND_HH
+#define EWOMS_STOKES_BACKEND_HH
+
+#include <ewoms/common/parametersystem.hh>
+#include <ewoms/common/propertysystem.hh>
+#include <ewoms/common/timer.hh>
+
+#include <opm/common/Unused.hpp>
+#include <opm/common/ErrorMacros.hpp>
+#include <opm/common/Exceptions.hpp>
+
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/bvector.hh>
+#include <dune/istl/operators.hh>
+#include <dune/istl/preconditioner.hh>
+#include <dune/istl/preconditioners.hh>
+#include <dune/istl/solvercategory.hh>
+#include <dune/istl/solvers.hh>
+#include <dune/istl/paamg/amg.hh>
+#include <dune/common/fmatrix.hh>
+#include <dune/common/fvector.hh>
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+namespace Ewoms {
+namespace Properties {
+// forward declaration of the required property tags
+NEW_PROP_TAG(Scalar);
+NEW_PROP_TAG(NumEq);
+NEW_PROP_TAG(Simulator);
+NEW_PROP_TAG(GridView);
+NEW_PROP_TAG(Indices);
+NEW_PROP_TAG(JacobianMatrix);
+NEW_PROP_TAG(GlobalEqVector);
+NEW_PROP_TAG(LinearSolverTolerance);
+NEW_PROP_TAG(LinearSolverMaxIterations);
+NEW_PROP_TAG(LinearSolverVerbosity);
+NEW_PROP_TAG(LinearSolverBackend);
+NEW_PROP_TAG(AmgCoarsenTarget);
+
+NEW_TYPE_TAG(StokesLinearSolver);
+} // namespace Properties
+} // namespace Ewoms
+
+namespace Ewoms {
+namespace Linear {
+/*!
+ * \ingroup StokesModel
+ *
+ * \brief A block triangular preconditioner for the saddle point systems of the Stokes
+ *        model.
+ *
+ * The unknowns of each degree of freedom are split into the velocity components and the
+ * remaining ones, i.e., the pressure, the mole fractions and the temperature. Using
+ * this splitting, the linear system exhibits the structure
+ * \f[
+ * \begin{pmatrix} A & B \\ C & D \end{pmatrix}
+ * \begin{pmatrix} x_v \\ x_p \end{pmatrix}
+ * =
+ * \begin{pmatrix} d_v \\ d_p \end{pmatrix}
+ * \f]
+ * and the preconditioner approximately solves the upper block triangular system
+ * \f$\begin{pmatrix} A & B \\ 0 & S \end{pmatrix}\f$: First, \f$S x_p = d_p\f$ is
+ * solved, then one AMG cycle is applied to \f$A x_v = d_v - B x_p\f$.
+ *
+ * The Schur complement \f$S = D - C A^{-1} B\f$ is approximated by a block diagonal
+ * matrix which only considers the diagonal blocks of \f$A\f$ and the diagonal blocks
+ * of the product. For the Stokes equations, this is a lumped approximation of the
+ * pressure mass matrix scaled by the inverse viscosity, but it gets the scaling of
+ * the mass conservation equations right without any knowledge of the fluid.
+ */
+template <class Matrix, class Vector, class VelocityMatrix, class VelocityVector,
+          class SchurBlock, class Amg, int velocity0Idx, int momentum0EqIdx>
+class StokesBlockTriangularPreconditioner : public Dune::Preconditioner<Vector, Vector>
+{
+    typedef typename Vector::field_type Scalar;
+
+    enum { numEq = Vector::block_type::dimension };
+    enum { numVelocity = VelocityVector::block_type::dimension };
+    enum { numOther = numEq - numVelocity };
+
+public:
+    //! export types
+    typedef Matrix matrix_type;
+    typedef Vector domain_type;
+    typedef Vector range_type;
+    typedef Scalar field_type;
+
+    enum { category = Dune::SolverCategory::sequential };
+
+    StokesBlockTriangularPreconditioner(const Matrix& M,
+                                        const std::vector<SchurBlock>& invSchurDiag,
+                                        Amg& amg)
+        : M_(M)
+        , invSchurDiag_(invSchurDiag)
+        , amg_(amg)
+        , velX_(M.N())
+        , velD_(M.N())
+    {}
+
+    virtual void pre(Vector& x OPM_UNUSED, Vector& b OPM_UNUSED)
+    {
+        velX_ = 0.0;
+        velD_ = 0.0;
+        amg_.pre(velX_, velD_);
+    }
+
+    virtual void apply(Vector& v, const Vector& d)
+    {
+        size_t numRows = M_.N();
+
+        // x_p = S^-1 d_p
+        for (size_t rowIdx = 0; rowIdx < numRows; ++rowIdx) {
+            Dune::FieldVector<Scalar, numOther> dp;
+            for (unsigned i = 0; i < numOther; ++i)
+                dp[i] = d[rowIdx][otherIndex(i)];
+
+            Dune::FieldVector<Scalar, numOther> xp;
+            invSchurDiag_[rowIdx].mv(dp, xp);
+            for (unsigned i = 0; i < numOther; ++i)
+                v[rowIdx][otherIndex(i)] = xp[i];
+        }
+
+        // d_v - B x_p
+        auto rowIt = M_.begin();
+        const auto& rowEndIt = M_.end();
+        for (; rowIt != rowEndIt; ++rowIt) {
+            size_t rowIdx = rowIt.index();
+            auto& dv = velD_[rowIdx];
+            for (unsigned i = 0; i < numVelocity; ++i)
+                dv[i] = d[rowIdx][momentum0EqIdx + i];
+
+            auto colIt = rowIt->begin();
+            const auto& colEndIt = rowIt->end();
+            for (; colIt != colEndIt; ++colIt) {
+                const auto& block = *colIt;
+                const auto& xj = v[colIt.index()];
+                for (unsigned i = 0; i < numVelocity; ++i)
+                    for (unsigned k = 0; k < numOther; ++k) {
+                        unsigned pvIdx = otherIndex(k);
+                        dv[i] -= block[momentum0EqIdx + i][pvIdx]*xj[pvIdx];
+                    }
+            }
+        }
+
+        // x_v = A^-1 (d_v - B x_p)
+        velX_ = 0.0;
+        amg_.apply(velX_, velD_);
+        for (size_t rowIdx = 0; rowIdx < numRows; ++rowIdx)
+            for (unsigned i = 0; i < numVelocity; ++i)
+                v[rowIdx][velocity0Idx + i] = velX_[rowIdx][i];
+    }
+
+    virtual void post(Vector& x OPM_UNUSED)
+    { amg_.post(velX_); }
+
+    /*!
+     * \brief Returns the index of the k-th entry of a block which does not belong to
+     *        the velocity.
+     */
+    static unsigned otherIndex(unsigned k)
+    { return (k < velocity0Idx) ? k : k + numVelocity; }
+
+private:
+    const Matrix& M_;
+    const std::vector<SchurBlock>& invSchurDiag_;
+    Amg& amg_;
+
+    VelocityVector velX_;
+    VelocityVector velD_;
+};
+
+/*!
+ * \ingroup StokesModel
+ *
+ * \brief A linear solver backend for the saddle point systems of the Stokes model.
+ *
+ * The linear system is solved by BiCGSTAB, preconditioned by
+ * StokesBlockTriangularPreconditioner. This backend only works for sequential runs.
+ */
+template <class TypeTag>
+class StokesBackend
+{
+    typedef typename GET_PROP_TYPE(TypeTag, Scalar) Scalar;
+    typedef typename GET_PROP_TYPE(TypeTag, Simulator) Simulator;
+    typedef typename GET_PROP_TYPE(TypeTag, GridView) GridView;
+    typedef typename GET_PROP_TYPE(TypeTag, Indices) Indices;
+    typedef typename GET_PROP_TYPE(TypeTag, JacobianMatrix) Matrix;
+    typedef typename GET_PROP_TYPE(TypeTag, GlobalEqVector) Vector;
+
+    enum { numEq = GET_PROP_VALUE(TypeTag, NumEq) };
+    enum { dimWorld = GridView::dimensionworld };
+    enum { numOther = numEq - dimWorld };
+    enum { velocity0Idx = Indices::velocity0Idx };
+    enum { momentum0EqIdx = Indices::momentum0EqIdx };
+
+    static_assert(velocity0Idx == momentum0EqIdx,
+                  "The velocity unknowns must match the momentum equations");
+
+    typedef Dune::FieldMatrix<Scalar, dimWorld, dimWorld> VelocityMatrixBlock;
+    typedef Dune::FieldVector<Scalar, dimWorld> VelocityVectorBlock;
+    typedef Dune::BCRSMatrix<VelocityMatrixBlock> VelocityMatrix;
+    typedef Dune::BlockVector<VelocityVectorBlock> VelocityVector;
+    typedef Dune::FieldMatrix<Scalar, numOther, numOther> SchurBlock;
+
+    typedef Dune::MatrixAdapter<VelocityMatrix, VelocityVector, VelocityVector> VelocityOperator;
+    typedef Dune::SeqSSOR<VelocityMatrix, VelocityVector, VelocityVector> Smoother;
+    typedef Dune::Amg::AMG<VelocityOperator, VelocityVector, Smoother> Amg;
+
+    typedef StokesBlockTriangularPreconditioner<Matrix, Vector,
+                                                VelocityMatrix, VelocityVector,
+                                                SchurBlock, Amg,
+                                                velocity0Idx, momentum0EqIdx> Preconditioner;
+
+public:
+    StokesBackend(Simulator& simulator)
+        : simulator_(simulator)
+    {
+        tolerance_ = EWOMS_GET_PARAM(TypeTag, Scalar, LinearSolverTolerance);
+        M_ = 0;
+        b_ = 0;
+        lastIterations_ = 0;
+        matrixIsValid_ = false;
+    }
+
+    static void registerParameters()
+    {
+        EWOMS_REGISTER_PARAM(TypeTag, Scalar, LinearSolverTolerance,
+                             "The maximum allowed error between of the linear solver");
+        EWOMS_REGISTER_PARAM(TypeTag, int, LinearSolverMaxIterations,
+                             "The maximum number of iterations of the linear solver");
+        EWOMS_REGISTER_PARAM(TypeTag, int, LinearSolverVerbosity,
+                             "The verbosity level of the linear solver");
+        EWOMS_REGISTER_PARAM(TypeTag, int, AmgCoarsenTarget,
+                             "The coarsening target for the agglomerations of "
+                             "the AMG preconditioner of the velocity block");
+    }
+
+    /*!
+     * \brief Causes the solve() method to discared the structure of the linear system of
+     *        equations the next time it is called.
+     */
+    void eraseMatrix()
+    {
+        amg_.reset();
+        velocityOperator_.reset();
+        velocityMatrix_ = VelocityMatrix();
+    }
+
+    /*!
+     * \brief Set the factor by which the linear solver reduces the residual.
+     */
+    void setTolerance(Scalar value)
+    { tolerance_ = value; }
+
+    void prepareMatrix(const Matrix& M)
+    {
+        if (!simulator_.model().linearizer().schurCorrection().empty())
+            OPM_THROW(Opm::NotImplemented,
+                      "The Stokes backend does not support unknowns which are "
+                      "eliminated by auxiliary modules");
+        if (simulator_.gridView().comm().size() > 1)
+            OPM_THROW(Opm::NotImplemented,
+                      "The Stokes backend only supports sequential runs");
+
+        M_ = &M;
+
+        prepreTimer_.start();
+        extractVelocityMatrix_(M);
+        matrixIsValid_ = approximateSchurComplement_(M);
+        if (matrixIsValid_)
+            setupAmg_();
+        prepreTimer_.stop();
+    }
+
+    void prepareRhs(const Matrix& M OPM_UNUSED, Vector& b)
+    { b_ = &b; }
+
+    bool solve(Vector& x)
+    {
+        lastIterations_ = 0;
+        if (!matrixIsValid_)
+            return false;
+
+        int verbosity = EWOMS_GET_PARAM(TypeTag, int, LinearSolverVerbosity);
+        int maxIterations = EWOMS_GET_PARAM(TypeTag, int, LinearSolverMaxIterations);
+
+        Dune::MatrixAdapter<Matrix, Vector, Vector> op(*M_);
+        Preconditioner precond(*M_, invSchurDiag_, *amg_);
+        Dune::BiCGSTABSolver<Vector> solver(op, precond, tolerance_, maxIterations, verbosity);
+
+        // the solver overwrites the right hand side
+        Vector b(*b_);
+        x = 0.0;
+        Dune::InverseOperatorResult result;
+        solver.apply(x, b, result);
+        lastIterations_ = static_cast<unsigned>(result.iterations);
+
+        // make sure that the result only contains finite values.
+        Scalar sum = 0.0;
+        for (size_t rowIdx = 0; rowIdx < x.size(); ++rowIdx)
+            for (unsigned eqIdx = 0; eqIdx < numEq; ++eqIdx)
+                sum += x[rowIdx][eqIdx];
+
+        return result.converged && std::isfinite(sum);
+    }
+
+    /*!
+     * \brief Returns the number of iterations which were required by the last linear
+     *        solve.
+     */
+    unsigned lastIterations() const
+    { return lastIterations_; }
+
+    /*!
+     * \brief Returns the timer which accumulates the time spent for setting up the
+     *        preconditioners.
+     */
+    const Ewoms::Timer& preconditionerSetupTimer() const
+    { return prepreTimer_; }
+
+private:
+    // copy the couplings of the velocity unknowns to the momentum equations
+    void extractVelocityMatrix_(const Matrix& M)
+    {
+        size_t numRows = M.N();
+        if (velocityMatrix_.N() != numRows || velocityMatrix_.nonzeroes() != M.nonzeroes()) {
+            amg_.reset();
+            velocityOperator_.reset();
+
+            velocityMatrix_ = VelocityMatrix();
+            velocityMatrix_.setSize(numRows, M.M(), M.nonzeroes());
+            velocityMatrix_.setBuildMode(VelocityMatrix::row_wise);
+            auto createIt = velocityMatrix_.createbegin();
+            auto rowIt = M.begin();
+            for (; createIt != velocityMatrix_.createend(); ++createIt, ++rowIt) {
+                auto colIt = rowIt->begin();
+                const auto& colEndIt = rowIt->end();
+                for (; colIt != colEndIt; ++colIt)
+                    createIt.insert(colIt.index());
+            }
+        }
+
+        auto rowIt = M.begin();
+        const auto& rowEndIt = M.end();
+        for (; rowIt != rowEndIt; ++rowIt) {
+            size_t rowIdx = rowIt.index();
+            auto colIt = rowIt->begin();
+            const auto& colEndIt = rowIt->end();
+            for (; colIt != colEndIt; ++colIt) {
+                const auto& src = *colIt;
+                auto& dest = velocityMatrix_[rowIdx][colIt.index()];
+                for (unsigned i = 0; i < dimWorld; ++i)
+                    for (unsigned j = 0; j < dimWorld; ++j)
+                        dest[i][j] = src[momentum0EqIdx + i][velocity0Idx + j];
+            }
+        }
+    }
+
+    // compute the inverse of the diagonal blocks of D - C diag(A)^-1 B. returns false if
+    // any of them is singular
+    bool approximateSchurComplement_(const Matrix& M)
+    {
+        size_t numRows = M.N();
+
+        std::vector<VelocityMatrixBlock> invDiagA(numRows);
+        for (size_t rowIdx = 0; rowIdx < numRows; ++rowIdx) {
+            invDiagA[rowIdx] = velocityMatrix_[rowIdx][rowIdx];
+            try {
+                invDiagA[rowIdx].invert();
+            }
+            catch (const Dune::FMatrixError&) {
+                return false;
+            }
+        }
+
+        invSchurDiag_.resize(numRows);
+        auto rowIt = M.begin();
+        const auto& rowEndIt = M.end();
+        for (; rowIt != rowEndIt; ++rowIt) {
+            size_t i = rowIt.index();
+            SchurBlock& S = invSchurDiag_[i];
+
+            const auto& diag = M[i][i];
+            for (unsigned k = 0; k < numOther; ++k)
+                for (unsigned l = 0; l < numOther; ++l)
+                    S[k][l] = diag[otherIdx_(k)][otherIdx_(l)];
+
+            auto colIt = rowIt->begin();
+            const auto& colEndIt = rowIt->end();
+            for (; colIt != colEndIt; ++colIt) {
+                size_t j = colIt.index();
+
+                // the sparsity pattern of the Jacobian is symmetric for finite volume
+                // discretizations, but do not rely on it
+                const auto& rowJ = M[j];
+                auto blockJiIt = rowJ.find(i);
+                if (blockJiIt == rowJ.end())
+                    continue;
+
+                const auto& Cij = *colIt;
+                const auto& Bji = *blockJiIt;
+
+                // C_ij diag(A)^-1_jj
+                Dune::FieldMatrix<Scalar, numOther, dimWorld> CinvA(0.0);
+                for (unsigned k = 0; k < numOther; ++k)
+                    for (unsigned m = 0; m < dimWorld; ++m)
+                        for (unsigned n = 0; n < dimWorld; ++n)
+                            CinvA[k][n] +=
+                                Cij[otherIdx_(k)][velocity0Idx + m]*invDiagA[j][m][n];
+
+                for (unsigned k = 0; k < numOther; ++k)
+                    for (unsigned l = 0; l < numOther; ++l)
+                        for (unsigned n = 0; n < dimWorld; ++n)
+                            S[k][l] -= CinvA[k][n]*Bji[momentum0EqIdx + n][otherIdx_(l)];
+            }
+
+            try {
+                S.invert();
+            }
+            catch (const Dune::FMatrixError&) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    void setupAmg_()
+    {
+        typedef typename Dune::Amg::SmootherTraits<Smoother>::Arguments SmootherArgs;
+        typedef Dune::Amg::
+            CoarsenCriterion<Dune::Amg::SymmetricCriterion<VelocityMatrix, Dune::Amg::FrobeniusNorm> >
+            CoarsenCriterion;
+
+        SmootherArgs smootherArgs;
+        smootherArgs.iterations = 1;
+        smootherArgs.relaxationFactor = 1.0;
+
+        int coarsenTarget = EWOMS_GET_PARAM(TypeTag, int, AmgCoarsenTarget);
+        CoarsenCriterion coarsenCriterion(/*maxLevel=*/15, coarsenTarget);
+        coarsenCriterion.setDefaultValuesIsotropic(GridView::dimension,
+                                                   /*aggregateSizePerDim=*/3);
+        if (EWOMS_GET_PARAM(TypeTag, int, LinearSolverVerbosity) > 0)
+            coarsenCriterion.setDebugLevel(1);
+        else
+            coarsenCriterion.setDebugLevel(0); // make the AMG shut up
+        coarsenCriterion.setMinCoarsenRate(1.05);
+        coarsenCriterion.setAccumulate(Dune::Amg::atOnceAccu);
+        coarsenCriterion.setSkipIsolated(false);
+
+        // the hierarchy depends on the values of the matrix, so it is recreated for
+        // each linearization
+        amg_.reset();
+        velocityOperator_.reset(new VelocityOperator(velocityMatrix_));
+        amg_.reset(new Amg(*velocityOperator_, coarsenCriterion, smootherArgs));
+    }
+
+    static unsigned otherIdx_(unsigned k)
+    { return Preconditioner::otherIndex(k); }
+
+    const Simulator& simulator_;
+    const Matrix* M_;
+    Vector* b_;
+
+    VelocityMatrix velocityMatrix_;
+    std::vector<SchurBlock> invSchurDiag_;
+    std::unique_ptr<VelocityOperator> velocityOperator_;
+    std::unique_ptr<Amg> amg_;
+    bool matrixIsValid_;
+
+    Scalar tolerance_;
+    unsigned lastIterations_;
+    Ewoms::Timer prepreTimer_;
+};
+
+} // namespace Linear
+} // namespace Ewoms
+
+namespace Ewoms {
+namespace Properties {
+SET_INT_PROP(StokesLinearSolver, LinearSolverVerbosity, 0);
+SET_INT_PROP(StokesLinearSolver, LinearSolverMaxIterations, 1000);
+SET_INT_PROP(StokesLinearSolver, AmgCoarsenTarget, 2000);
+SET_TYPE_PROP(StokesLinearSolver, LinearSolverBackend,
+              Ewoms::Linear::StokesBackend<TypeTag>);
+} // namespace Properties
+} // namespace Ewoms
+
+#endif
@@ -41,6 +41,7 @@
 #include "stokesintensivequantities.hh"
 #include "stokesextensivequantities.hh"
 #include "stokesboundaryratevector.hh"
+#include "stokesbackend.hh"
 
 #include <ewoms/linear/superlubackend.hh>
 
@@ -104,11 +105,12 @@ SET_TYPE_PROP(StokesModel,
 //! Increase the raw tolerance of the newton method to 10^-7
 SET_SCALAR_PROP(StokesModel, NewtonRawTolerance, 1e-7);
 
+//! Use SuperLU if it is available and the block triangular preconditioner for the saddle
+//! point systems otherwise
 #if HAVE_SUPERLU
 SET_TAG_PROP(StokesModel, LinearSolverSplice, SuperLULinearSolver);
 #else
-#warning "No SuperLU installed. SuperLU is the recommended linear " \
-         "solver for the Stokes models."
+SET_TAG_PROP(StokesModel, LinearSolverSplice, StokesLinearSolver);
 #endif
 
 //! the Stokes model requires center gradients, and those are only available when using
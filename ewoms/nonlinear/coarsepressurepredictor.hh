@@ -0,0 +1,340 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \copydoc Ewoms::CoarsePressurePredictor
+ */
+#ifndef EWOMS_COARSE_PRESSURE_PREDICTOR_HH
+#define EWOMS_COARSE_PRESSURE_PREDICTOR_HH
+
+#include <ewoms/linear/parallelcprbackend.hh>
+#include <ewoms/common/parametersystem.hh>
+#include <ewoms/common/propertysystem.hh>
+
+#include <dune/common/fmatrix.hh>
+#include <dune/common/fvector.hh>
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/bvector.hh>
+#include <dune/istl/operators.hh>
+#include <dune/istl/preconditioners.hh>
+#include <dune/istl/solvers.hh>
+#include <dune/istl/paamg/aggregates.hh>
+#include <dune/istl/paamg/graph.hh>
+#include <dune/istl/paamg/amg.hh>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace Ewoms {
+namespace Properties {
+NEW_PROP_TAG(Scalar);
+NEW_PROP_TAG(GridView);
+NEW_PROP_TAG(NumEq);
+
+//! Specify whether the initial guess of each time step is improved by solving a coarse
+//! pressure system before the first full Newton iteration
+NEW_PROP_TAG(EnableCoarsePressurePredictor);
+
+//! The index of the primary variable which is corrected by the coarse pressure predictor
+NEW_PROP_TAG(CoarsePredictorPressureIndex);
+
+//! The relative tolerance of the linear solver for the coarse pressure system
+NEW_PROP_TAG(CoarsePredictorTolerance);
+} // namespace Properties
+
+/*!
+ * \ingroup Newton
+ *
+ * \brief Computes a correction of the pressure for the first Newton iteration of a time
+ *        step from an upscaled pressure system.
+ *
+ * After large changes of the boundary conditions, e.g. if wells are opened or closed,
+ * the initial guess of the pressure can be far off. The Newton method then needs many
+ * iterations, each of them solving the full linear system. This class determines the
+ * pressure change of the time step approximately and at much lower cost:
+ *
+ * - The pressure system is extracted from the Jacobian matrix using the quasi-IMPES
+ *   weights of the CPR preconditioner.
+ * - The degrees of freedom are grouped into aggregates using the same aggregation
+ *   algorithm and coarsening criterion as the algebraic multi-grid hierarchies of the
+ *   AMG and the CPR linear solver backends.
+ * - The Galerkin projection of the pressure system onto the piecewise constant
+ *   functions on the aggregates is solved, and the result is prolongated to the
+ *   degrees of freedom.
+ *
+ * The resulting update only affects the pressure and is applied as the update of the
+ * first Newton iteration. The remaining iterations are regular ones.
+ *
+ * The aggregates are determined for the processes independently. Since the overlap of
+ * the processes would end up with inconsistent values, the predictor is only applied
+ * to sequential runs.
+ */
+template <class TypeTag>
+class CoarsePressurePredictor
+{
+    typedef typename GET_PROP_TYPE(TypeTag, Scalar) Scalar;
+    typedef typename GET_PROP_TYPE(TypeTag, GridView) GridView;
+
+    static constexpr int numEq = GET_PROP_VALUE(TypeTag, NumEq);
+    static constexpr int pressureIdx = GET_PROP_VALUE(TypeTag, CoarsePredictorPressureIndex);
+
+    typedef Dune::FieldMatrix<Scalar, 1, 1> PressureMatrixBlock;
+    typedef Dune::FieldVector<Scalar, 1> PressureVectorBlock;
+    typedef Dune::BCRSMatrix<PressureMatrixBlock> PressureMatrix;
+    typedef Dune::BlockVector<PressureVectorBlock> PressureVector;
+
+    typedef Dune::Amg::MatrixGraph<const PressureMatrix> MatrixGraph;
+    typedef Dune::Amg::PropertiesGraph<MatrixGraph,
+                                       Dune::Amg::VertexProperties,
+                                       Dune::Amg::EdgeProperties,
+                                       Dune::IdentityMap,
+                                       Dune::IdentityMap> PropertiesGraph;
+    typedef typename PropertiesGraph::VertexDescriptor Vertex;
+    typedef Dune::Amg::AggregatesMap<Vertex> AggregatesMap;
+    typedef Dune::Amg::
+        CoarsenCriterion<Dune::Amg::SymmetricCriterion<PressureMatrix, Dune::Amg::FirstDiagonal> >
+        CoarsenCriterion;
+
+    static_assert(0 <= pressureIdx && pressureIdx < numEq,
+                  "The pressure index of the coarse pressure predictor must be a valid "
+                  "primary variable index");
+
+public:
+    CoarsePressurePredictor()
+    {
+        tolerance_ = EWOMS_GET_PARAM(TypeTag, Scalar, CoarsePredictorTolerance);
+        numAggregates_ = 0;
+    }
+
+    /*!
+     * \brief Register all run-time parameters of the coarse pressure predictor.
+     */
+    static void registerParameters()
+    {
+        EWOMS_REGISTER_PARAM(TypeTag, bool, EnableCoarsePressurePredictor,
+                             "Correct the pressure of the initial guess of each time step "
+                             "by solving an upscaled pressure system before the first "
+                             "full Newton iteration (sequential runs only)");
+        EWOMS_REGISTER_PARAM(TypeTag, Scalar, CoarsePredictorTolerance,
+                             "The relative tolerance of the linear solver for the "
+                             "upscaled pressure system of the coarse pressure predictor");
+    }
+
+    /*!
+     * \brief Compute the update of the first Newton iteration of a time step.
+     *
+     * The update uses the same sign convention as the one of the Newton method, i.e.,
+     * it approximately solves \f$J \Delta x = r\f$. If the coarse system could not be
+     * solved, false is returned and the update is undefined.
+     */
+    template <class Matrix, class Vector>
+    bool computeUpdate(Vector& update, const Matrix& jacobian, const Vector& residual)
+    {
+        updatePressureSystem_(jacobian, residual);
+        updateAggregates_();
+        updateCoarseSystem_();
+
+        // solve the coarse system. it is much smaller than the pressure system, so
+        // ILU(0) is a sufficient preconditioner.
+        typedef Dune::MatrixAdapter<PressureMatrix, PressureVector, PressureVector> Operator;
+        Operator coarseOperator(*coarseMatrix_);
+        Dune::SeqILU0<PressureMatrix, PressureVector, PressureVector> ilu(*coarseMatrix_, 1.0);
+        Dune::BiCGSTABSolver<PressureVector> solver(coarseOperator,
+                                                    ilu,
+                                                    tolerance_,
+                                                    /*maxIterations=*/200,
+                                                    /*verbose=*/0);
+
+        PressureVector coarseSolution(coarseRhs_.size());
+        coarseSolution = 0.0;
+        Dune::InverseOperatorResult result;
+        solver.apply(coarseSolution, coarseRhs_, result);
+        if (!result.converged)
+            return false;
+
+        // prolongate the pressure change
+        update = 0.0;
+        for (size_t dofIdx = 0; dofIdx < update.size(); ++dofIdx)
+            update[dofIdx][pressureIdx] = coarseSolution[aggregateIdx_[dofIdx]][0];
+
+        return true;
+    }
+
+    /*!
+     * \brief Returns the number of aggregates of the last coarse system.
+     */
+    size_t numAggregates() const
+    { return numAggregates_; }
+
+private:
+    // extract the pressure system from the Jacobian matrix using quasi-IMPES weights
+    template <class Matrix, class Vector>
+    void updatePressureSystem_(const Matrix& jacobian, const Vector& residual)
+    {
+        typedef Dune::FieldVector<typename Matrix::field_type, numEq> WeightBlock;
+
+        const size_t numRows = jacobian.N();
+
+        // the sparsity pattern of the pressure system is the one of the Jacobian matrix
+        if (!pressureMatrix_
+            || pressureMatrix_->N() != numRows
+            || pressureMatrix_->nonzeroes() != jacobian.nonzeroes())
+        {
+            pressureMatrix_.reset(new PressureMatrix(numRows,
+                                                     numRows,
+                                                     jacobian.nonzeroes(),
+                                                     PressureMatrix::row_wise));
+            auto rowIt = pressureMatrix_->createbegin();
+            const auto& rowEndIt = pressureMatrix_->createend();
+            for (; rowIt != rowEndIt; ++rowIt) {
+                const auto& row = jacobian[rowIt.index()];
+                auto colIt = row.begin();
+                const auto& colEndIt = row.end();
+                for (; colIt != colEndIt; ++colIt)
+                    rowIt.insert(colIt.index());
+            }
+        }
+
+        pressureRhs_.resize(numRows);
+        for (size_t rowIdx = 0; rowIdx < numRows; ++rowIdx) {
+            const auto& row = jacobian[rowIdx];
+
+            WeightBlock weights;
+            const auto& diagIt = row.find(rowIdx);
+            if (diagIt == row.end())
+                weights = 1.0;
+            else
+                Linear::computeQuasiImpesWeights(*diagIt, weights, static_cast<unsigned>(pressureIdx));
+
+            pressureRhs_[rowIdx] = weights*residual[rowIdx];
+
+            auto pressureColIt = (*pressureMatrix_)[rowIdx].begin();
+            auto colIt = row.begin();
+            const auto& colEndIt = row.end();
+            for (; colIt != colEndIt; ++colIt, ++pressureColIt) {
+                Scalar value = 0.0;
+                for (int eqIdx = 0; eqIdx < numEq; ++eqIdx)
+                    value += weights[eqIdx]*(*colIt)[eqIdx][pressureIdx];
+                *pressureColIt = value;
+            }
+        }
+    }
+
+    // group the degrees of freedom into aggregates like the first level of the AMG
+    void updateAggregates_()
+    {
+        CoarsenCriterion criterion;
+        criterion.setDefaultValuesAnisotropic(GridView::dimension,
+                                              /*aggregateSizePerDim=*/3);
+        criterion.setDebugLevel(0);
+        criterion.setSkipIsolated(false);
+
+        MatrixGraph matrixGraph(*pressureMatrix_);
+        PropertiesGraph propertiesGraph(matrixGraph);
+        AggregatesMap aggregatesMap(propertiesGraph.maxVertex() + 1);
+        aggregatesMap.buildAggregates(*pressureMatrix_, propertiesGraph, criterion,
+                                      /*finestLevel=*/true);
+
+        // the degrees of freedom which did not end up in any aggregate form aggregates
+        // of their own
+        const size_t numDof = pressureMatrix_->N();
+        aggregateIdx_.resize(numDof);
+        numAggregates_ = 0;
+        for (size_t dofIdx = 0; dofIdx < numDof; ++dofIdx) {
+            Vertex aggIdx = aggregatesMap[static_cast<Vertex>(dofIdx)];
+            if (aggIdx != AggregatesMap::UNAGGREGATED && aggIdx != AggregatesMap::ISOLATED)
+                numAggregates_ = std::max(numAggregates_, static_cast<size_t>(aggIdx) + 1);
+        }
+        for (size_t dofIdx = 0; dofIdx < numDof; ++dofIdx) {
+            Vertex aggIdx = aggregatesMap[static_cast<Vertex>(dofIdx)];
+            if (aggIdx == AggregatesMap::UNAGGREGATED || aggIdx == AggregatesMap::ISOLATED)
+                aggregateIdx_[dofIdx] = numAggregates_++;
+            else
+                aggregateIdx_[dofIdx] = static_cast<size_t>(aggIdx);
+        }
+    }
+
+    // compute the Galerkin projection of the pressure system onto the aggregates
+    void updateCoarseSystem_()
+    {
+        const size_t numDof = pressureMatrix_->N();
+
+        // determine the sparsity pattern
+        std::vector<std::vector<size_t> > neighbors(numAggregates_);
+        for (size_t rowIdx = 0; rowIdx < numDof; ++rowIdx) {
+            auto& aggNeighbors = neighbors[aggregateIdx_[rowIdx]];
+            const auto& row = (*pressureMatrix_)[rowIdx];
+            for (auto colIt = row.begin(); colIt != row.end(); ++colIt)
+                aggNeighbors.push_back(aggregateIdx_[colIt.index()]);
+        }
+
+        size_t numNonZeros = 0;
+        for (auto& aggNeighbors : neighbors) {
+            std::sort(aggNeighbors.begin(), aggNeighbors.end());
+            aggNeighbors.erase(std::unique(aggNeighbors.begin(), aggNeighbors.end()),
+                               aggNeighbors.end());
+            numNonZeros += aggNeighbors.size();
+        }
+
+        coarseMatrix_.reset(new PressureMatrix(numAggregates_,
+                                               numAggregates_,
+                                               numNonZeros,
+                                               PressureMatrix::row_wise));
+        auto rowIt = coarseMatrix_->createbegin();
+        const auto& rowEndIt = coarseMatrix_->createend();
+        for (; rowIt != rowEndIt; ++rowIt)
+            for (size_t colIdx : neighbors[rowIt.index()])
+                rowIt.insert(colIdx);
+
+        // add up the entries of the pressure system
+        *coarseMatrix_ = 0.0;
+        coarseRhs_.resize(numAggregates_);
+        coarseRhs_ = 0.0;
+        for (size_t rowIdx = 0; rowIdx < numDof; ++rowIdx) {
+            size_t aggRowIdx = aggregateIdx_[rowIdx];
+            coarseRhs_[aggRowIdx] += pressureRhs_[rowIdx];
+
+            auto& coarseRow = (*coarseMatrix_)[aggRowIdx];
+            const auto& row = (*pressureMatrix_)[rowIdx];
+            for (auto colIt = row.begin(); colIt != row.end(); ++colIt)
+                coarseRow[aggregateIdx_[colIt.index()]] += *colIt;
+        }
+    }
+
+    Scalar tolerance_;
+
+    std::unique_ptr<PressureMatrix> pressureMatrix_;
+    PressureVector pressureRhs_;
+
+    std::vector<size_t> aggregateIdx_;
+    size_t numAggregates_;
+
+    std::unique_ptr<PressureMatrix> coarseMatrix_;
+    PressureVector coarseRhs_;
+};
+
+} // namespace Ewoms
+
+#endif
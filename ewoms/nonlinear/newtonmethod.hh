@@ -28,11 +28,15 @@
 #define EWOMS_NEWTON_METHOD_HH
 
 #include "nullconvergencewriter.hh"
+#include "newtontelemetrywriter.hh"
+#include "coarsepressurepredictor.hh"
 
 #include <ewoms/common/propertysystem.hh>
 #include <ewoms/common/parametersystem.hh>
 #include <ewoms/common/timer.hh>
 #include <ewoms/common/timerguard.hh>
+#include <ewoms/common/profiler.hh>
+#include <ewoms/parallel/collectivewaittimes.hh>
 
 #include <dune/common/classname.hh>
 #include <opm/common/Unused.hpp>
@@ -43,8 +47,15 @@
 #include <dune/common/version.hh>
 #include <dune/common/parallel/mpihelper.hh>
 
+#include <algorithm>
+#include <exception>
+#include <cmath>
+#include <cstddef>
 #include <iostream>
+#include <memory>
 #include <sstream>
+#include <utility>
+#include <vector>
 
 #include <unistd.h>
 
@@ -117,6 +128,10 @@ NEW_PROP_TAG(NewtonWriteConvergence);
 //! gets written out to disk for every Newton iteration
 NEW_PROP_TAG(ConvergenceWriter);
 
+//! Specifies the type of the class which writes the performance data of each Newton
+//! iteration
+NEW_PROP_TAG(NewtonTelemetryWriter);
+
 /*!
  * \brief The value for the error below which convergence is declared
  *
@@ -142,9 +157,65 @@ NEW_PROP_TAG(NewtonTargetIterations);
 //! Number of maximum iterations for the Newton method.
 NEW_PROP_TAG(NewtonMaxIterations);
 
+/*!
+ * \brief The maximum number of times the update of a Newton iteration is halved by the
+ *        backtracking line search.
+ *
+ * A value of 0 disables the line search.
+ */
+NEW_PROP_TAG(NewtonMaxLineSearchIterations);
+
+/*!
+ * \brief Specify whether the tolerance of the linear solver is adapted to the progress
+ *        of the Newton method.
+ *
+ * If this is enabled, the forcing terms of Eisenstat and Walker are used as the relative
+ * tolerance of the linear solver.
+ */
+NEW_PROP_TAG(NewtonUseEisenstatWalker);
+
+//! The largest relative tolerance of the linear solver if the Eisenstat-Walker forcing
+//! terms are used
+NEW_PROP_TAG(NewtonMaxLinearSolverTolerance);
+
+//! The relative tolerance of the linear solver
+NEW_PROP_TAG(LinearSolverTolerance);
+
+/*!
+ * \brief The number of consecutive iterations with a growing error after which the
+ *        Newton method is considered to diverge and is aborted.
+ *
+ * A value of 0 means that the Newton method is never aborted early.
+ */
+NEW_PROP_TAG(NewtonMaxDivergingIterations);
+
+/*!
+ * \brief The number of consecutive iterations for which the Jacobian matrix of an
+ *        earlier iteration of the time step is reused.
+ *
+ * In these iterations, only the residual is evaluated. This is mainly intended to be
+ * combined with a matrix-free linear operator (cf. the LinearSolverMatrixFree
+ * property), where the Jacobian matrix is only used to build the preconditioner. A
+ * value of 0 means that the Jacobian is assembled for each iteration.
+ */
+NEW_PROP_TAG(NewtonMaxJacobianAge);
+
+/*!
+ * \brief The number of previous iterations which are used to accelerate the updates of
+ *        the Newton method using Anderson mixing.
+ *
+ * This is mainly useful if the iterations only converge linearly, e.g. because the
+ * Jacobian matrix is lagged or only approximate. A value of 0 disables the
+ * acceleration.
+ */
+NEW_PROP_TAG(NewtonAndersonDepth);
+
 // set default values for the properties
 SET_TYPE_PROP(NewtonMethod, NewtonMethod, Ewoms::NewtonMethod<TypeTag>);
 SET_TYPE_PROP(NewtonMethod, NewtonConvergenceWriter, Ewoms::NullConvergenceWriter<TypeTag>);
+SET_TYPE_PROP(NewtonMethod, NewtonTelemetryWriter, Ewoms::NewtonTelemetryWriter<TypeTag>);
+SET_STRING_PROP(NewtonMethod, NewtonTelemetryFile, "");
+SET_STRING_PROP(NewtonMethod, NewtonTelemetryFormat, "csv");
 SET_BOOL_PROP(NewtonMethod, NewtonWriteConvergence, false);
 SET_BOOL_PROP(NewtonMethod, NewtonVerbose, true);
 SET_SCALAR_PROP(NewtonMethod, NewtonRawTolerance, 1e-8);
@@ -153,6 +224,15 @@ SET_SCALAR_PROP(NewtonMethod, NewtonRawTolerance, 1e-8);
 SET_SCALAR_PROP(NewtonMethod, NewtonMaxError, 1e100);
 SET_INT_PROP(NewtonMethod, NewtonTargetIterations, 10);
 SET_INT_PROP(NewtonMethod, NewtonMaxIterations, 18);
+SET_INT_PROP(NewtonMethod, NewtonMaxLineSearchIterations, 0);
+SET_BOOL_PROP(NewtonMethod, NewtonUseEisenstatWalker, false);
+SET_SCALAR_PROP(NewtonMethod, NewtonMaxLinearSolverTolerance, 0.1);
+SET_INT_PROP(NewtonMethod, NewtonMaxDivergingIterations, 0);
+SET_INT_PROP(NewtonMethod, NewtonMaxJacobianAge, 0);
+SET_INT_PROP(NewtonMethod, NewtonAndersonDepth, 0);
+SET_BOOL_PROP(NewtonMethod, EnableCoarsePressurePredictor, false);
+SET_INT_PROP(NewtonMethod, CoarsePredictorPressureIndex, 0);
+SET_SCALAR_PROP(NewtonMethod, CoarsePredictorTolerance, 1e-2);
 } // namespace Properties
 } // namespace Ewoms
 
@@ -182,6 +262,7 @@ class NewtonMethod
     typedef typename GET_PROP_TYPE(TypeTag, JacobianMatrix) JacobianMatrix;
     typedef typename GET_PROP_TYPE(TypeTag, LinearSolverBackend) LinearSolverBackend;
     typedef typename GET_PROP_TYPE(TypeTag, NewtonConvergenceWriter) ConvergenceWriter;
+    typedef typename GET_PROP_TYPE(TypeTag, NewtonTelemetryWriter) TelemetryWriter;
 
     typedef typename Dune::MPIHelper::MPICommunicator Communicator;
     typedef Dune::CollectiveCommunication<Communicator> CollectiveCommunication;
@@ -193,12 +274,28 @@ public:
         , linearSolver_(simulator)
         , comm_(Dune::MPIHelper::getCommunicator())
         , convergenceWriter_(asImp_())
+        , telemetryWriter_(asImp_())
     {
         lastError_ = 1e100;
         error_ = 1e100;
         tolerance_ = EWOMS_GET_PARAM(TypeTag, Scalar, NewtonRawTolerance);
+        linearSolverTolerance_ = 0.0;
 
         numIterations_ = 0;
+        numDivergingIterations_ = 0;
+        numLinearIterations_ = 0;
+        jacobianAge_ = 0;
+        andersonNumStored_ = 0;
+
+        if (EWOMS_GET_PARAM(TypeTag, bool, EnableCoarsePressurePredictor)) {
+            if (comm_.size() > 1) {
+                if (comm_.rank() == 0)
+                    std::cout << "Warning: The coarse pressure predictor is only available "
+                              << "for sequential runs. Disabling it.\n" << std::flush;
+            }
+            else
+                coarsePredictor_.reset(new CoarsePressurePredictor<TypeTag>());
+        }
     }
 
     /*!
@@ -207,13 +304,16 @@ public:
     static void registerParameters()
     {
         LinearSolverBackend::registerParameters();
+        TelemetryWriter::registerParameters();
+        ConvergenceWriter::registerParameters();
+        CoarsePressurePredictor<TypeTag>::registerParameters();
 
         EWOMS_REGISTER_PARAM(TypeTag, bool, NewtonVerbose,
                              "Specify whether the Newton method should inform "
                              "the user about its progress or not");
         EWOMS_REGISTER_PARAM(TypeTag, bool, NewtonWriteConvergence,
                              "Write the convergence behaviour of the Newton "
-                             "method to a VTK file");
+                             "method to disk");
         EWOMS_REGISTER_PARAM(TypeTag, int, NewtonTargetIterations,
                              "The 'optimimum' number of Newton iterations per "
                              "time step");
@@ -227,6 +327,27 @@ public:
         EWOMS_REGISTER_PARAM(TypeTag, Scalar, NewtonMaxError,
                              "The maximum error tolerated by the Newton "
                              "method to which does not cause an abort");
+        EWOMS_REGISTER_PARAM(TypeTag, int, NewtonMaxLineSearchIterations,
+                             "The maximum number of times the update of a Newton "
+                             "iteration is halved if it does not reduce the error "
+                             "of the residual. 0 disables the line search");
+        EWOMS_REGISTER_PARAM(TypeTag, bool, NewtonUseEisenstatWalker,
+                             "Adapt the tolerance of the linear solver to the reduction "
+                             "of the error using the forcing terms of Eisenstat and Walker");
+        EWOMS_REGISTER_PARAM(TypeTag, Scalar, NewtonMaxLinearSolverTolerance,
+                             "The largest relative tolerance of the linear solver if the "
+                             "Eisenstat-Walker forcing terms are used");
+        EWOMS_REGISTER_PARAM(TypeTag, int, NewtonMaxDivergingIterations,
+                             "The number of consecutive iterations with a growing error "
+                             "after which the Newton method is aborted. 0 disables this");
+        EWOMS_REGISTER_PARAM(TypeTag, int, NewtonMaxJacobianAge,
+                             "The number of consecutive iterations for which the Jacobian "
+                             "matrix of an earlier iteration is reused. 0 assembles the "
+                             "Jacobian for each iteration");
+        EWOMS_REGISTER_PARAM(TypeTag, int, NewtonAndersonDepth,
+                             "The number of previous iterations which are used to "
+                             "accelerate the updates by Anderson mixing. 0 disables the "
+                             "acceleration");
     }
 
     /*!
@@ -267,6 +388,19 @@ public:
     int numIterations() const
     { return numIterations_; }
 
+    /*!
+     * \brief Returns the total number of iterations of the linear solver since the
+     *        Newton method was invoked.
+     */
+    unsigned numLinearIterations() const
+    { return numLinearIterations_; }
+
+    /*!
+     * \brief Returns the error of the residual of the current iteration.
+     */
+    Scalar error() const
+    { return error_; }
+
     /*!
      * \brief Set the index of current iteration.
      *
@@ -390,8 +524,21 @@ public:
 
                 solveTimer_.start();
                 solutionUpdate = 0;
-                linearSolver_.prepareMatrix(M);
-                bool converged = linearSolver_.solve(solutionUpdate);
+                asImp_().updateLinearSolverTolerance_();
+                bool converged;
+                {
+                    EWOMS_PROFILE_REGION("solve");
+                    // the first update of a time step may be determined from a coarse
+                    // pressure system. if this fails, the full system is solved.
+                    if (numIterations_ == 0
+                        && coarsePredictor_
+                        && coarsePredictor_->computeUpdate(solutionUpdate, M, b))
+                    {
+                        converged = true;
+                    }
+                    else
+                        converged = asImp_().solveLinear_(solutionUpdate);
+                }
                 solveTimer_.stop();
 
                 if (!converged) {
@@ -406,6 +553,9 @@ public:
                     return false;
                 }
 
+                if (andersonDepth_() > 0)
+                    asImp_().andersonAccelerate_(solutionUpdate);
+
                 // update the solution
                 if (asImp_().verbose_()) {
                     std::cout << "Update: x^(k+1) = x^k - deltax^k"
@@ -421,6 +571,10 @@ public:
                                     b,
                                     solutionUpdate);
                 asImp_().update_(nextSolution, currentSolution, solutionUpdate, b);
+                if (maxLineSearchIterations_() > 0)
+                    asImp_().lineSearch_(nextSolution, currentSolution, solutionUpdate, b);
+                if (andersonDepth_() > 0)
+                    andersonLastStep_ = solutionUpdate;
                 updateTimer_.stop();
 
                 if (asImp_().verbose_() && isatty(fileno(stdout)))
@@ -583,9 +737,13 @@ protected:
     void begin_(const SolutionVector& u  OPM_UNUSED)
     {
         numIterations_ = 0;
+        numDivergingIterations_ = 0;
+        numLinearIterations_ = 0;
+        andersonNumStored_ = 0;
 
         if (EWOMS_GET_PARAM(TypeTag, bool, NewtonWriteConvergence))
             convergenceWriter_.beginTimeStep();
+        telemetryWriter_.beginTimeStep();
     }
 
     /*!
@@ -595,41 +753,43 @@ protected:
     {
         problem().beginIteration();
         lastError_ = error_;
+        telemetryWriter_.beginIteration();
     }
 
     /*!
      * \brief Linearize the global non-linear system of equations.
+     *
+     * The Jacobian matrix is assembled for the first iteration of each time step. For
+     * the subsequent ones, it may be kept for a few iterations, in which case only the
+     * residual is evaluated (cf. the NewtonMaxJacobianAge property).
      */
     void linearize_()
-    { model().linearizer().linearize(); }
+    {
+        auto& linearizer = model().linearizer();
+        if (numIterations_ > 0
+            && jacobianAge_ < EWOMS_GET_PARAM(TypeTag, int, NewtonMaxJacobianAge))
+        {
+            linearizer.linearizeResidual();
+            ++ jacobianAge_;
+            return;
+        }
+
+        linearizer.linearize();
+        jacobianAge_ = 0;
+    }
 
     void preSolve_(const SolutionVector& currentSolution  OPM_UNUSED,
                    const GlobalEqVector& currentResidual)
     {
-        const auto& constraintsMap = model().linearizer().constraintsMap();
         lastError_ = error_;
+        error_ = asImp_().residualError_(currentResidual);
 
-        // calculate the error as the maximum weighted tolerance of
-        // the solution's residual
-        error_ = 0;
-        for (unsigned dofIdx = 0; dofIdx < currentResidual.size(); ++dofIdx) {
-            // do not consider auxiliary DOFs for the error
-            if (dofIdx >= model().numGridDof() || model().dofTotalVolume(dofIdx) <= 0.0)
-                continue;
-
-            // also do not consider DOFs which are constraint
-            if (enableConstraints_()) {
-                if (constraintsMap.count(dofIdx) > 0)
-                    continue;
-            }
-
-            const auto& r = currentResidual[dofIdx];
-            for (unsigned eqIdx = 0; eqIdx < r.size(); ++eqIdx)
-                error_ = Opm::max(std::abs(r[eqIdx] * model().eqWeight(dofIdx, eqIdx)), error_);
-        }
-
-        // take the other processes into account
-        error_ = comm_.max(error_);
+        // keep track of how many iterations in a row increased the error. (the error of
+        // the first iteration cannot be compared with anything.)
+        if (numIterations_ > 0 && error_ > lastError_)
+            ++ numDivergingIterations_;
+        else
+            numDivergingIterations_ = 0;
 
         // make sure that the error never grows beyond the maximum
         // allowed one
@@ -640,6 +800,116 @@ protected:
                       << EWOMS_GET_PARAM(TypeTag, Scalar, NewtonMaxError));
     }
 
+    /*!
+     * \brief Returns the error of a residual.
+     *
+     * The error is defined as the maximum of the weighted residual over all processes.
+     * The DOFs of the auxiliary equations and the constraint DOFs are not considered.
+     */
+    Scalar residualError_(const GlobalEqVector& residual) const
+    {
+        const auto& linearizer = model().linearizer();
+
+        Scalar error = 0;
+        int numGridDof = static_cast<int>(std::min<size_t>(model().numGridDof(), residual.size()));
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+        {
+            Scalar threadError = 0.0;
+
+#ifdef _OPENMP
+#pragma omp for
+#endif
+            for (int i = 0; i < numGridDof; ++i) {
+                unsigned dofIdx = static_cast<unsigned>(i);
+
+                // do not consider DOFs which are not associated with any volume
+                if (model().dofTotalVolume(dofIdx) <= 0.0)
+                    continue;
+
+                // also do not consider DOFs which are constraint
+                if (enableConstraints_() && linearizer.isConstraintDof(dofIdx))
+                    continue;
+
+                const auto& r = residual[dofIdx];
+                for (unsigned eqIdx = 0; eqIdx < r.size(); ++eqIdx)
+                    threadError = Opm::max(std::abs(r[eqIdx] * model().eqWeight(dofIdx, eqIdx)), threadError);
+            }
+
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+            error = Opm::max(error, threadError);
+        }
+
+        // take the other processes into account
+        CollectiveWaitTimer waitTimer("residualError");
+        return comm_.max(error);
+    }
+
+    /*!
+     * \brief Set the relative tolerance of the linear solver for the current iteration.
+     *
+     * This only does something if the NewtonUseEisenstatWalker parameter is enabled. In
+     * this case, the forcing terms of Eisenstat and Walker (SIAM J. Sci. Comput., 17(1),
+     * 1996, "choice 2" with gamma=0.9 and alpha=2) are used, i.e., the linear systems of
+     * the first iterations are only solved as accurately as the reduction of the Newton
+     * error by the previous iteration suggests. The tolerance is bounded by the
+     * LinearSolverTolerance parameter from below and by the
+     * NewtonMaxLinearSolverTolerance parameter from above. Also, a linear system is not
+     * solved more accurately than required to reach the tolerance of the Newton method.
+     */
+    void updateLinearSolverTolerance_()
+    {
+        if (!EWOMS_GET_PARAM(TypeTag, bool, NewtonUseEisenstatWalker))
+            return;
+
+        const Scalar gamma = 0.9;
+        const Scalar alpha = 2.0;
+        Scalar minTolerance = EWOMS_GET_PARAM(TypeTag, Scalar, LinearSolverTolerance);
+        Scalar maxTolerance = EWOMS_GET_PARAM(TypeTag, Scalar, NewtonMaxLinearSolverTolerance);
+
+        Scalar eta = maxTolerance;
+        if (numIterations_ > 0 && lastError_ > 0.0) {
+            eta = gamma*std::pow(error_/lastError_, alpha);
+
+            // do not decrease the tolerance too rapidly if the last one was large
+            Scalar safeguard = gamma*std::pow(linearSolverTolerance_, alpha);
+            if (safeguard > 0.1)
+                eta = std::max(eta, safeguard);
+        }
+        eta = std::max(eta, minTolerance);
+
+        // avoid over-solving the linear system of the last iterations
+        if (error_ > 0.0)
+            eta = std::max(eta, 0.5*tolerance()/error_);
+        eta = std::min(eta, maxTolerance);
+
+        linearSolverTolerance_ = eta;
+        linearSolver_.setTolerance(eta);
+    }
+
+    /*!
+     * \brief Compute the update of the solution for the current linearization.
+     *
+     * The default behavior is to solve the full linear system of equations using the
+     * linear solver backend. Implementations may override this to e.g. only solve a
+     * subset of the equations.
+     *
+     * \param solutionUpdate The vector which receives the update of the solution. It is
+     *                       zero when this method is called.
+     * \return true if the update could be computed, false if the Newton method should
+     *         give up on the time step.
+     */
+    bool solveLinear_(GlobalEqVector& solutionUpdate)
+    {
+        linearSolver_.prepareMatrix(model().linearizer().matrix());
+        bool converged = linearSolver_.solve(solutionUpdate);
+        numLinearIterations_ += linearSolver_.lastIterations();
+        return converged;
+    }
+
     /*!
      * \brief Update the error of the solution given the previous
      *        iteration.
@@ -678,8 +948,6 @@ protected:
                  const GlobalEqVector& solutionUpdate,
                  const GlobalEqVector& currentResidual)
     {
-        const auto& constraintsMap = model().linearizer().constraintsMap();
-
         // first, write out the current solution to make convergence
         // analysis possible
         asImp_().writeConvergence_(currentSolution, solutionUpdate);
@@ -688,11 +956,20 @@ protected:
         if (!std::isfinite(solutionUpdate.one_norm()))
             OPM_THROW(Opm::NumericalProblem, "Non-finite update!");
 
+        // the primary variables of the grid DOFs are updated in parallel. exceptions
+        // must not leave a parallel region, so the first one which occurs is re-thrown
+        // afterwards.
+        const auto& linearizer = model().linearizer();
         size_t numGridDof = model().numGridDof();
-        for (unsigned dofIdx = 0; dofIdx < numGridDof; ++dofIdx) {
-            if (enableConstraints_()) {
-                if (constraintsMap.count(dofIdx) > 0) {
-                    const auto& constraints = constraintsMap.at(dofIdx);
+        std::exception_ptr exception;
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+        for (int i = 0; i < static_cast<int>(numGridDof); ++i) {
+            unsigned dofIdx = static_cast<unsigned>(i);
+            try {
+                if (enableConstraints_() && linearizer.isConstraintDof(dofIdx)) {
+                    const auto& constraints = linearizer.constraints(dofIdx);
                     asImp_().updateConstraintDof_(dofIdx,
                                                   nextSolution[dofIdx],
                                                   constraints);
@@ -704,13 +981,16 @@ protected:
                                                      solutionUpdate[dofIdx],
                                                      currentResidual[dofIdx]);
             }
-            else
-                asImp_().updatePrimaryVariables_(dofIdx,
-                                                 nextSolution[dofIdx],
-                                                 currentSolution[dofIdx],
-                                                 solutionUpdate[dofIdx],
-                                                 currentResidual[dofIdx]);
+            catch (...) {
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+                if (!exception)
+                    exception = std::current_exception();
+            }
         }
+        if (exception)
+            std::rethrow_exception(exception);
 
         // update the DOFs of the auxiliary equations
         size_t numDof = model().numTotalDof();
@@ -718,6 +998,135 @@ protected:
             nextSolution[dofIdx] = currentSolution[dofIdx];
             nextSolution[dofIdx] -= solutionUpdate[dofIdx];
         }
+
+        // update the unknowns which the auxiliary modules have eliminated from the
+        // global system of equations
+        size_t numAuxMod = model().numAuxiliaryModules();
+        for (unsigned auxModIdx = 0; auxModIdx < numAuxMod; ++auxModIdx)
+            model().auxiliaryModule(auxModIdx)->updateEliminatedUnknowns(solutionUpdate);
+    }
+
+    /*!
+     * \brief Backtrack along the direction of the Newton update until the error of the
+     *        residual decreases.
+     *
+     * If the error of the residual at the updated solution is not smaller than the one at
+     * the current solution, the update is halved and the solution is updated again. This
+     * is repeated until the error decreases or until the update has been halved
+     * NewtonMaxLineSearchIterations times. The residuals of the trial solutions are
+     * evaluated without assembling the Jacobian matrix.
+     *
+     * \param nextSolution The solution vector after the current iteration
+     * \param currentSolution The solution vector after the last iteration
+     * \param solutionUpdate The delta vector as calculated by solving the linear system
+     *                       of equations. This is scaled by the line search.
+     * \param currentResidual The residual vector of the current Newton-Raphson iteraton
+     */
+    void lineSearch_(SolutionVector& nextSolution,
+                     const SolutionVector& currentSolution,
+                     GlobalEqVector& solutionUpdate,
+                     const GlobalEqVector& currentResidual)
+    {
+        // the residual of the linearizer is overwritten by the evaluation of the trial
+        // solutions, so the residual of the current solution needs to be copied
+        GlobalEqVector residual(currentResidual);
+        Scalar currentError = asImp_().residualError_(residual);
+
+        Linearizer& linearizer = model().linearizer();
+        int numHalvings = 0;
+        for (; numHalvings < maxLineSearchIterations_(); ++numHalvings) {
+            linearizer.linearizeResidual();
+            if (asImp_().residualError_(linearizer.residual()) < currentError)
+                break;
+
+            solutionUpdate *= 0.5;
+            asImp_().update_(nextSolution, currentSolution, solutionUpdate, residual);
+        }
+
+        if (numHalvings > 0)
+            endIterMsg() << ", line search halvings=" << numHalvings;
+    }
+
+    /*!
+     * \brief Replace the update of the current iteration by its Anderson-accelerated
+     *        counterpart.
+     *
+     * The iterations are considered to be the fixed point iteration
+     * \f$x^{k+1} = g(x^k) = x^k - \Delta x^k\f$. With the differences
+     * \f$\Delta D_i\f$ of the updates \f$\Delta x\f$ and \f$\Delta G_i\f$ of the values
+     * of \f$g\f$ of the NewtonAndersonDepth previous iterations, the coefficients
+     * \f$\gamma\f$ which minimize \f$\|\Delta x^k - \sum_i \gamma_i \Delta D_i\|\f$ are
+     * determined and the next solution is \f$g(x^k) - \sum_i \gamma_i \Delta G_i\f$. The
+     * norm is weighted by the weights of the primary variables. Since all scalar
+     * products are reduced in a single collective operation, the coefficients are the
+     * same on all processes.
+     *
+     * \param solutionUpdate The update computed by the linear solver. This receives the
+     *                       accelerated update.
+     */
+    void andersonAccelerate_(GlobalEqVector& solutionUpdate)
+    {
+        size_t depth = static_cast<size_t>(andersonDepth_());
+        if (numIterations_ == 0) {
+            andersonNumStored_ = 0;
+            andersonLastUpdate_ = solutionUpdate;
+            return;
+        }
+
+        // add the differences to the previous iteration to the history. the values of
+        // the fixed point function differ by the difference of the solutions, i.e., the
+        // negative update applied by the last iteration, minus the difference of the
+        // updates.
+        if (andersonDeltaUpdates_.size() != depth) {
+            andersonDeltaUpdates_.resize(depth);
+            andersonDeltaValues_.resize(depth);
+            andersonNumStored_ = 0;
+        }
+        size_t slotIdx = andersonNumStored_ % depth;
+        GlobalEqVector& deltaUpdate = andersonDeltaUpdates_[slotIdx];
+        GlobalEqVector& deltaValue = andersonDeltaValues_[slotIdx];
+        deltaUpdate = solutionUpdate;
+        deltaUpdate -= andersonLastUpdate_;
+        deltaValue = andersonLastStep_;
+        deltaValue *= -1.0;
+        deltaValue -= deltaUpdate;
+        ++ andersonNumStored_;
+        andersonLastUpdate_ = solutionUpdate;
+
+        // assemble the normal equations of the least squares problem
+        size_t n = std::min(andersonNumStored_, depth);
+        std::vector<Scalar> sums(n*n + n, 0.0);
+        for (size_t i = 0; i < n; ++i) {
+            for (size_t j = 0; j <= i; ++j)
+                sums[i*n + j] = weightedDot_(andersonDeltaUpdates_[i], andersonDeltaUpdates_[j]);
+            sums[n*n + i] = weightedDot_(andersonDeltaUpdates_[i], solutionUpdate);
+        }
+        comm_.sum(sums.data(), static_cast<int>(sums.size()));
+
+        std::vector<Scalar> A(n*n);
+        std::vector<Scalar> gamma(sums.begin() + static_cast<std::ptrdiff_t>(n*n), sums.end());
+        Scalar trace = 0.0;
+        for (size_t i = 0; i < n; ++i) {
+            for (size_t j = 0; j <= i; ++j)
+                A[i*n + j] = A[j*n + i] = sums[i*n + j];
+            trace += A[i*n + i];
+        }
+
+        // regularize the problem slightly to cope with (almost) linearly dependent
+        // differences
+        for (size_t i = 0; i < n; ++i)
+            A[i*n + i] += 1e-10*trace/n;
+
+        if (!(trace > 0.0) || !solveDense_(A, gamma, n)) {
+            // the history is useless, start from scratch
+            andersonNumStored_ = 0;
+            return;
+        }
+
+        for (size_t i = 0; i < n; ++i)
+            solutionUpdate.axpy(gamma[i], andersonDeltaValues_[i]);
+
+        endIterMsg() << ", Anderson depth=" << n;
     }
 
     /*!
@@ -768,6 +1177,7 @@ protected:
     {
         ++numIterations_;
         problem().endIteration();
+        telemetryWriter_.endIteration();
 
         if (asImp_().verbose_()) {
             std::cout << "Newton iteration " << numIterations_ << ""
@@ -797,6 +1207,17 @@ protected:
             // the maximum number of steps
             return error_ * 4.0 < lastError_;
         }
+        else if (maxDivergingIterations_() > 0
+                 && numDivergingIterations_ >= maxDivergingIterations_())
+        {
+            // the error has grown for too many iterations in a row. chances are that
+            // the Newton method will not converge for this time step, so we give up
+            // early instead of wasting more iterations.
+            if (asImp_().verbose_())
+                std::cout << "Newton: Error grew for " << numDivergingIterations_
+                          << " consecutive iterations. Aborting.\n" << std::flush;
+            return false;
+        }
 
         return true;
     }
@@ -809,6 +1230,10 @@ protected:
     {
         if (EWOMS_GET_PARAM(TypeTag, bool, NewtonWriteConvergence))
             convergenceWriter_.endTimeStep();
+
+        // other users of the linear solver expect its regular tolerance
+        if (EWOMS_GET_PARAM(TypeTag, bool, NewtonUseEisenstatWalker))
+            linearSolver_.setTolerance(EWOMS_GET_PARAM(TypeTag, Scalar, LinearSolverTolerance));
     }
 
     /*!
@@ -833,10 +1258,76 @@ protected:
     // maximum number of iterations we do before giving up
     int maxIterations_() const
     { return EWOMS_GET_PARAM(TypeTag, int, NewtonMaxIterations); }
+    // maximum number of times the update of an iteration is halved by the line search
+    int maxLineSearchIterations_() const
+    { return EWOMS_GET_PARAM(TypeTag, int, NewtonMaxLineSearchIterations); }
+    // number of iterations with a growing error after which the Newton method gives up
+    int maxDivergingIterations_() const
+    { return EWOMS_GET_PARAM(TypeTag, int, NewtonMaxDivergingIterations); }
+
+    // number of previous iterations used for the Anderson acceleration
+    int andersonDepth_() const
+    { return EWOMS_GET_PARAM(TypeTag, int, NewtonAndersonDepth); }
 
     static bool enableConstraints_()
     { return GET_PROP_VALUE(TypeTag, EnableConstraints); }
 
+    // the local contribution to the scalar product of two updates. the primary
+    // variables are weighted like for the convergence criterion.
+    Scalar weightedDot_(const GlobalEqVector& a, const GlobalEqVector& b) const
+    {
+        size_t numGridDof = model().numGridDof();
+        Scalar result = 0.0;
+        for (size_t dofIdx = 0; dofIdx < a.size(); ++dofIdx) {
+            for (unsigned pvIdx = 0; pvIdx < a[dofIdx].size(); ++pvIdx) {
+                Scalar w = 1.0;
+                if (dofIdx < numGridDof)
+                    w = model().primaryVarWeight(static_cast<unsigned>(dofIdx), pvIdx);
+                result += w*w*a[dofIdx][pvIdx]*b[dofIdx][pvIdx];
+            }
+        }
+        return result;
+    }
+
+    // solve a small dense linear system of equations using Gaussian elimination with
+    // partial pivoting. the solution is returned in the right hand side. returns false
+    // if the matrix is singular.
+    static bool solveDense_(std::vector<Scalar>& A, std::vector<Scalar>& b, size_t n)
+    {
+        for (size_t k = 0; k < n; ++k) {
+            size_t pivotIdx = k;
+            for (size_t i = k + 1; i < n; ++i)
+                if (std::abs(A[i*n + k]) > std::abs(A[pivotIdx*n + k]))
+                    pivotIdx = i;
+            if (!(std::abs(A[pivotIdx*n + k]) > 0.0))
+                return false;
+
+            if (pivotIdx != k) {
+                for (size_t j = 0; j < n; ++j)
+                    std::swap(A[k*n + j], A[pivotIdx*n + j]);
+                std::swap(b[k], b[pivotIdx]);
+            }
+
+            for (size_t i = k + 1; i < n; ++i) {
+                Scalar factor = A[i*n + k]/A[k*n + k];
+                for (size_t j = k; j < n; ++j)
+                    A[i*n + j] -= factor*A[k*n + j];
+                b[i] -= factor*b[k];
+            }
+        }
+
+        for (size_t k = n; k > 0; --k) {
+            size_t i = k - 1;
+            for (size_t j = i + 1; j < n; ++j)
+                b[i] -= A[i*n + j]*b[j];
+            b[i] /= A[i*n + i];
+            if (!std::isfinite(b[i]))
+                return false;
+        }
+
+        return true;
+    }
+
     Simulator& simulator_;
 
     Ewoms::Timer prePostProcessTimer_;
@@ -850,12 +1341,38 @@ protected:
     Scalar lastError_;
     Scalar tolerance_;
 
+    // the relative tolerance of the linear solver used by the last iteration if the
+    // Eisenstat-Walker forcing terms are used
+    Scalar linearSolverTolerance_;
+
     // actual number of iterations done so far
     int numIterations_;
 
+    // number of consecutive iterations for which the error grew
+    int numDivergingIterations_;
+
+    // number of iterations since the Jacobian matrix was assembled
+    int jacobianAge_;
+
+    // number of iterations of the linear solver done so far
+    unsigned numLinearIterations_;
+
+    // the history of the Anderson acceleration: the differences of the consecutive
+    // updates and of the consecutive values of the fixed point function, stored as a
+    // ring buffer, and the raw and the applied update of the last iteration
+    std::vector<GlobalEqVector> andersonDeltaUpdates_;
+    std::vector<GlobalEqVector> andersonDeltaValues_;
+    size_t andersonNumStored_;
+    GlobalEqVector andersonLastUpdate_;
+    GlobalEqVector andersonLastStep_;
+
     // the linear solver
     LinearSolverBackend linearSolver_;
 
+    // computes the update of the first iteration of a time step from a coarse pressure
+    // system if enabled
+    std::unique_ptr<CoarsePressurePredictor<TypeTag> > coarsePredictor_;
+
     // the collective communication used by the simulation (i.e. fake
     // or MPI)
     CollectiveCommunication comm_;
@@ -864,6 +1381,9 @@ protected:
     // method to disk
     ConvergenceWriter convergenceWriter_;
 
+    // the object which writes the performance data of each iteration
+    TelemetryWriter telemetryWriter_;
+
 private:
     Implementation& asImp_()
     { return *static_cast<Implementation *>(this); }
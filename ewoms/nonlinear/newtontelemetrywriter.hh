@@ -0,0 +1,229 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \copydoc Ewoms::NewtonTelemetryWriter
+ */
+#ifndef EWOMS_NEWTON_TELEMETRY_WRITER_HH
+#define EWOMS_NEWTON_TELEMETRY_WRITER_HH
+
+#include <ewoms/common/propertysystem.hh>
+#include <ewoms/common/parametersystem.hh>
+
+#include <opm/common/ErrorMacros.hpp>
+
+#include <dune/common/parallel/mpihelper.hh>
+
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+#include <string>
+
+namespace Ewoms {
+namespace Properties {
+NEW_PROP_TAG(Scalar);
+NEW_PROP_TAG(NewtonMethod);
+
+//! The name of the file to which the performance telemetry of the Newton method is
+//! written. If it is empty, no telemetry is written.
+NEW_PROP_TAG(NewtonTelemetryFile);
+
+//! The format of the telemetry file ('csv' or 'json')
+NEW_PROP_TAG(NewtonTelemetryFormat);
+}
+}
+
+namespace Ewoms {
+/*!
+ * \ingroup Newton
+ *
+ * \brief Writes machine readable performance data for each iteration of the Newton
+ *        method.
+ *
+ * For each Newton iteration, a record is written which contains the index, time and
+ * size of the time step, the index of the iteration, the wall clock times required for
+ * the linearization, the linear solve and the update of the solution, the time spent
+ * for setting up the preconditioner, the number of iterations of the linear solver, the
+ * error of the residual, the number of auxiliary modules of the model (i.e., the number
+ * of wells for the ECL models) and the number of processes. The records are either
+ * written as the rows of a CSV file or as JSON objects, one per line.
+ *
+ * Only the first process writes the file, i.e., the timings are the ones of this
+ * process. The file is flushed after each record, so the data of simulations which are
+ * aborted is not lost.
+ */
+template <class TypeTag>
+class NewtonTelemetryWriter
+{
+    typedef typename GET_PROP_TYPE(TypeTag, Scalar) Scalar;
+    typedef typename GET_PROP_TYPE(TypeTag, NewtonMethod) NewtonMethod;
+
+public:
+    NewtonTelemetryWriter(NewtonMethod& newtonMethod)
+        : newtonMethod_(newtonMethod)
+    {
+        writeJson_ = false;
+        startLinearizeTime_ = 0.0;
+        startSolveTime_ = 0.0;
+        startUpdateTime_ = 0.0;
+        startPreconditionerSetupTime_ = 0.0;
+        startLinearIterations_ = 0;
+
+        const std::string& fileName = EWOMS_GET_PARAM(TypeTag, std::string, NewtonTelemetryFile);
+        if (fileName.empty()
+            || Dune::MPIHelper::getCollectiveCommunication().rank() != 0)
+            return;
+
+        const std::string& format = EWOMS_GET_PARAM(TypeTag, std::string, NewtonTelemetryFormat);
+        if (format == "json")
+            writeJson_ = true;
+        else if (format != "csv")
+            OPM_THROW(std::runtime_error,
+                      "Unknown format '" << format << "' for the Newton telemetry. "
+                      "Valid formats are 'csv' and 'json'");
+
+        outStream_.open(fileName);
+        if (!writeJson_)
+            outStream_ << "timeStepIdx,time,timeStepSize,iteration,"
+                       << "linearizeTime,solveTime,updateTime,preconditionerSetupTime,"
+                       << "linearIterations,error,numWells,numProcesses\n";
+        outStream_ << std::setprecision(8);
+    }
+
+    /*!
+     * \brief Register all run-time parameters of the telemetry writer.
+     */
+    static void registerParameters()
+    {
+        EWOMS_REGISTER_PARAM(TypeTag, std::string, NewtonTelemetryFile,
+                             "The name of the file to which the performance data of each "
+                             "Newton iteration is written. Nothing is written if it is empty");
+        EWOMS_REGISTER_PARAM(TypeTag, std::string, NewtonTelemetryFormat,
+                             "The format of the Newton telemetry file ('csv' or 'json')");
+    }
+
+    /*!
+     * \brief Called by the Newton method before the actual algorithm
+     *        is started for any given timestep.
+     */
+    void beginTimeStep()
+    {}
+
+    /*!
+     * \brief Called by the Newton method before an iteration of the
+     *        Newton algorithm is started.
+     */
+    void beginIteration()
+    {
+        if (!outStream_.is_open())
+            return;
+
+        // the timers of the Newton method accumulate the times of all iterations of the
+        // time step, so we need to remember their values at the beginning of the
+        // iteration
+        startLinearizeTime_ = newtonMethod_.linearizeTimer().realTimeElapsed();
+        startSolveTime_ = newtonMethod_.solveTimer().realTimeElapsed();
+        startUpdateTime_ = newtonMethod_.updateTimer().realTimeElapsed();
+        startPreconditionerSetupTime_ =
+            newtonMethod_.linearSolver().preconditionerSetupTimer().realTimeElapsed();
+        startLinearIterations_ = newtonMethod_.numLinearIterations();
+    }
+
+    /*!
+     * \brief Called by the Newton method after an iteration of the
+     *        Newton algorithm has been completed.
+     */
+    void endIteration()
+    {
+        if (!outStream_.is_open())
+            return;
+
+        const auto& simulator = newtonMethod_.problem().simulator();
+        int timeStepIdx = simulator.timeStepIndex();
+        Scalar time = simulator.time();
+        Scalar timeStepSize = simulator.timeStepSize();
+        int iterationIdx = newtonMethod_.numIterations();
+        double linearizeTime =
+            newtonMethod_.linearizeTimer().realTimeElapsed() - startLinearizeTime_;
+        double solveTime =
+            newtonMethod_.solveTimer().realTimeElapsed() - startSolveTime_;
+        double updateTime =
+            newtonMethod_.updateTimer().realTimeElapsed() - startUpdateTime_;
+        double preconditionerSetupTime =
+            newtonMethod_.linearSolver().preconditionerSetupTimer().realTimeElapsed()
+            - startPreconditionerSetupTime_;
+        unsigned linearIterations =
+            newtonMethod_.numLinearIterations() - startLinearIterations_;
+        Scalar error = newtonMethod_.error();
+        size_t numWells = newtonMethod_.model().numAuxiliaryModules();
+        int numProcesses = simulator.gridView().comm().size();
+
+        if (writeJson_)
+            outStream_ << "{\"timeStepIdx\":" << timeStepIdx
+                       << ",\"time\":" << time
+                       << ",\"timeStepSize\":" << timeStepSize
+                       << ",\"iteration\":" << iterationIdx
+                       << ",\"linearizeTime\":" << linearizeTime
+                       << ",\"solveTime\":" << solveTime
+                       << ",\"updateTime\":" << updateTime
+                       << ",\"preconditionerSetupTime\":" << preconditionerSetupTime
+                       << ",\"linearIterations\":" << linearIterations
+                       << ",\"error\":" << error
+                       << ",\"numWells\":" << numWells
+                       << ",\"numProcesses\":" << numProcesses
+                       << "}\n";
+        else
+            outStream_ << timeStepIdx
+                       << "," << time
+                       << "," << timeStepSize
+                       << "," << iterationIdx
+                       << "," << linearizeTime
+                       << "," << solveTime
+                       << "," << updateTime
+                       << "," << preconditionerSetupTime
+                       << "," << linearIterations
+                       << "," << error
+                       << "," << numWells
+                       << "," << numProcesses
+                       << "\n";
+        outStream_ << std::flush;
+    }
+
+private:
+    NewtonMethod& newtonMethod_;
+
+    std::ofstream outStream_;
+    bool writeJson_;
+
+    // the values of the accumulating quantities at the beginning of the iteration
+    double startLinearizeTime_;
+    double startSolveTime_;
+    double startUpdateTime_;
+    double startPreconditionerSetupTime_;
+    unsigned startLinearIterations_;
+};
+
+} // namespace Ewoms
+
+#endif
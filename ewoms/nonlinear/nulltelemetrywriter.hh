@@ -0,0 +1,88 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \copydoc Ewoms::NullTelemetryWriter
+ */
+#ifndef EWOMS_NULL_TELEMETRY_WRITER_HH
+#define EWOMS_NULL_TELEMETRY_WRITER_HH
+
+#include <ewoms/common/propertysystem.hh>
+
+#include <opm/common/Unused.hpp>
+
+namespace Ewoms {
+namespace Properties {
+NEW_PROP_TAG(NewtonMethod);
+}
+}
+
+namespace Ewoms {
+/*!
+ * \ingroup Newton
+ *
+ * \brief A performance telemetry writer for the Newton method which does nothing
+ *
+ * This can be used to remove all overhead of the telemetry at compile time.
+ */
+template <class TypeTag>
+class NullTelemetryWriter
+{
+    typedef typename GET_PROP_TYPE(TypeTag, NewtonMethod) NewtonMethod;
+
+public:
+    NullTelemetryWriter(NewtonMethod& method  OPM_UNUSED)
+    {}
+
+    /*!
+     * \brief Register all run-time parameters of the telemetry writer.
+     */
+    static void registerParameters()
+    {}
+
+    /*!
+     * \brief Called by the Newton method before the actual algorithm
+     *        is started for any given timestep.
+     */
+    void beginTimeStep()
+    {}
+
+    /*!
+     * \brief Called by the Newton method before an iteration of the
+     *        Newton algorithm is started.
+     */
+    void beginIteration()
+    {}
+
+    /*!
+     * \brief Called by the Newton method after an iteration of the
+     *        Newton algorithm has been completed.
+     */
+    void endIteration()
+    {}
+};
+
+} // namespace Ewoms
+
+#endif
@@ -0,0 +1,169 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \copydoc Ewoms::CollectiveWaitTimes
+ */
+#ifndef EWOMS_COLLECTIVE_WAIT_TIMES_HH
+#define EWOMS_COLLECTIVE_WAIT_TIMES_HH
+
+#include <ewoms/parallel/locks.hh>
+
+#include <chrono>
+#include <iomanip>
+#include <map>
+#include <ostream>
+#include <string>
+
+namespace Ewoms {
+
+/*!
+ * \brief Accumulates the time which the process spends in collective
+ *        communication operations.
+ *
+ * Since the collective operations of the simulation only exchange a few numbers, the
+ * time spent in them is dominated by waiting for the slowest process to arrive. If the
+ * work is distributed unevenly, the processes with little work thus exhibit large wait
+ * times while the ones with much work hardly wait at all. The difference of the
+ * minimum and the maximum wait times over all processes is thus an estimate of how much
+ * time could be saved by balancing the load better.
+ *
+ * The times are accumulated by phase, e.g. "linearize", and the collective operations
+ * of a phase are usually timed using a CollectiveWaitTimer object.
+ */
+class CollectiveWaitTimes
+{
+public:
+    /*!
+     * \brief Returns the object which is used by the whole process.
+     */
+    static CollectiveWaitTimes& instance()
+    {
+        static CollectiveWaitTimes waitTimes;
+        return waitTimes;
+    }
+
+    /*!
+     * \brief Add the time spent in a collective operation to a phase.
+     *
+     * Since the object is shared by all simulators of the process, this may be called
+     * by several threads concurrently.
+     */
+    void add(const std::string& phase, double waitTime)
+    {
+        ScopedLock lock(mutex_);
+        auto& entry = phases_[phase];
+        entry.first += waitTime;
+        ++ entry.second;
+    }
+
+    /*!
+     * \brief Print the minimum, average and maximum wait times of each phase over all
+     *        processes.
+     *
+     * This is a collective operation, i.e., it must be called by all processes of the
+     * communicator. Only the process with rank 0 prints the report, and nothing is
+     * printed for sequential runs. Since all processes take part in the same collective
+     * operations, all of them know the same phases.
+     */
+    template <class CollectiveCommunication>
+    void printReport(const CollectiveCommunication& comm, std::ostream& os) const
+    {
+        if (comm.size() < 2)
+            return;
+
+        // do not hold the lock during the collective operations: other simulators of
+        // the process may be using different communicators
+        ScopedLock lock(mutex_);
+        const auto phases = phases_;
+        lock.unlock();
+
+        if (comm.rank() == 0)
+            os << "Time spent waiting in collective communication [s]:\n"
+               << std::left << std::setw(24) << "Phase"
+               << std::right << std::setw(14) << "Min"
+               << std::setw(14) << "Avg"
+               << std::setw(14) << "Max"
+               << std::setw(14) << "Calls" << "\n";
+
+        auto it = phases.begin();
+        const auto& endIt = phases.end();
+        for (; it != endIt; ++it) {
+            double waitTime = it->second.first;
+            double minWaitTime = comm.min(waitTime);
+            double maxWaitTime = comm.max(waitTime);
+            double avgWaitTime = comm.sum(waitTime)/comm.size();
+
+            if (comm.rank() == 0)
+                os << std::left << std::setw(24) << it->first
+                   << std::right << std::setw(14) << minWaitTime
+                   << std::setw(14) << avgWaitTime
+                   << std::setw(14) << maxWaitTime
+                   << std::setw(14) << it->second.second << "\n";
+        }
+
+        if (comm.rank() == 0)
+            os << std::flush;
+    }
+
+private:
+    CollectiveWaitTimes()
+    {}
+
+    mutable OmpMutex mutex_;
+
+    // the accumulated wait time and the number of collective operations of each phase
+    std::map<std::string, std::pair<double, unsigned long> > phases_;
+};
+
+/*!
+ * \brief Measures the time spent in the scope of the object and adds it to a phase of
+ *        the CollectiveWaitTimes.
+ */
+class CollectiveWaitTimer
+{
+    typedef std::chrono::high_resolution_clock Clock;
+
+public:
+    CollectiveWaitTimer(const char *phase)
+        : phase_(phase)
+        , startTime_(Clock::now())
+    {}
+
+    ~CollectiveWaitTimer()
+    {
+        double waitTime = std::chrono::duration<double>(Clock::now() - startTime_).count();
+        CollectiveWaitTimes::instance().add(phase_, waitTime);
+    }
+
+private:
+    CollectiveWaitTimer(const CollectiveWaitTimer&) = delete;
+
+    const char *phase_;
+    Clock::time_point startTime_;
+};
+
+} // namespace Ewoms
+
+#endif
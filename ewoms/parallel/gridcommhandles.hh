@@ -34,6 +34,9 @@
 #include <dune/grid/common/datahandleif.hh>
 #include <dune/common/version.hh>
 
+#include <algorithm>
+#include <vector>
+
 namespace Ewoms {
 
 /*!
@@ -297,6 +300,137 @@ private:
     Container& container_;
 };
 
+/*!
+ * \brief Reduction operation for GridCommHandleMulti which replaces the local value by
+ *        the one of the master process.
+ */
+struct GridCommAssignOperation
+{
+    template <class FieldType>
+    static void apply(FieldType& localValue, const FieldType& remoteValue)
+    { localValue = remoteValue; }
+};
+
+/*!
+ * \brief Reduction operation for GridCommHandleMulti which sums up all values.
+ */
+struct GridCommSumOperation
+{
+    template <class FieldType>
+    static void apply(FieldType& localValue, const FieldType& remoteValue)
+    { localValue += remoteValue; }
+};
+
+/*!
+ * \brief Reduction operation for GridCommHandleMulti which takes the maximum of all
+ *        values.
+ */
+struct GridCommMaxOperation
+{
+    template <class FieldType>
+    static void apply(FieldType& localValue, const FieldType& remoteValue)
+    { localValue = std::max(localValue, remoteValue); }
+};
+
+/*!
+ * \brief Reduction operation for GridCommHandleMulti which takes the minimum of all
+ *        values.
+ */
+struct GridCommMinOperation
+{
+    template <class FieldType>
+    static void apply(FieldType& localValue, const FieldType& remoteValue)
+    { localValue = std::min(localValue, remoteValue); }
+};
+
+/*!
+ * \brief Data handle for parallel communication which exchanges the values of
+ *        several containers in a single communication round.
+ *
+ * All containers must store values of the same type for each DOF. The values which
+ * are received from the peer processes are combined with the local ones using the
+ * static apply() method of the Operation class, cf. GridCommSumOperation and
+ * friends. Compared to communicating each container on its own, the latency of the
+ * communication only needs to be paid once.
+ */
+template <class FieldType, class Container, class EntityMapper, unsigned commCodim, class Operation>
+class GridCommHandleMulti
+    : public Dune::CommDataHandleIF<GridCommHandleMulti<FieldType, Container,
+                                                        EntityMapper, commCodim,
+                                                        Operation>,
+                                    FieldType>
+{
+public:
+    GridCommHandleMulti(const EntityMapper& mapper)
+        : mapper_(mapper)
+    {}
+
+    /*!
+     * \brief Add a container to the set of containers which are to be communicated.
+     *
+     * The container must stay alive until the communication is finished.
+     */
+    void addContainer(Container& container)
+    { containers_.push_back(&container); }
+
+    /*!
+     * \brief Returns the number of containers which are communicated.
+     */
+    size_t numContainers() const
+    { return containers_.size(); }
+
+    bool contains(unsigned dim OPM_UNUSED, unsigned codim) const
+    {
+        // return true if the codim is the same as the codim which we
+        // are asked to communicate with.
+        return codim == commCodim;
+    }
+
+    bool fixedsize(unsigned dim OPM_UNUSED, unsigned codim OPM_UNUSED) const
+    {
+        // for each DOF we communicate one value per container
+        return true;
+    }
+
+    template <class EntityType>
+    size_t size(const EntityType& e OPM_UNUSED) const
+    {
+        // communicate a field type per entity and container
+        return containers_.size();
+    }
+
+    template <class MessageBufferImp, class EntityType>
+    void gather(MessageBufferImp& buff, const EntityType& e) const
+    {
+#if DUNE_VERSION_NEWER(DUNE_COMMON, 2, 4)
+        unsigned dofIdx = static_cast<unsigned>(mapper_.index(e));
+#else
+        unsigned dofIdx = static_cast<unsigned>(mapper_.map(e));
+#endif
+        for (unsigned i = 0; i < containers_.size(); ++i)
+            buff.write((*containers_[i])[dofIdx]);
+    }
+
+    template <class MessageBufferImp, class EntityType>
+    void scatter(MessageBufferImp& buff, const EntityType& e, size_t n OPM_UNUSED)
+    {
+#if DUNE_VERSION_NEWER(DUNE_COMMON, 2, 4)
+        unsigned dofIdx = static_cast<unsigned>(mapper_.index(e));
+#else
+        unsigned dofIdx = static_cast<unsigned>(mapper_.map(e));
+#endif
+        for (unsigned i = 0; i < containers_.size(); ++i) {
+            FieldType tmp;
+            buff.read(tmp);
+            Operation::apply((*containers_[i])[dofIdx], tmp);
+        }
+    }
+
+private:
+    const EntityMapper& mapper_;
+    std::vector<Container*> containers_;
+};
+
 } // namespace Ewoms
 
 #endif
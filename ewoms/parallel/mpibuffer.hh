@@ -27,7 +27,11 @@
 #ifndef EWOMS_MPI_BUFFER_HH
 #define EWOMS_MPI_BUFFER_HH
 
+#include <opm/common/Unused.hpp>
+
 #if HAVE_MPI
+#include <dune/common/parallel/mpicollectivecommunication.hh>
+
 #include <mpi.h>
 #endif
 
@@ -38,8 +42,49 @@
 
 namespace Ewoms {
 
+#if HAVE_MPI
+//! The type of an MPI communicator
+typedef MPI_Comm MpiCommunicator;
+#else
+//! A placeholder for the type of an MPI communicator if MPI is not available
+typedef int MpiCommunicator;
+#endif
+
+/*!
+ * \brief Returns the communicator used if none is specified explicitly.
+ */
+inline MpiCommunicator defaultMpiCommunicator()
+{
+#if HAVE_MPI
+    return MPI_COMM_WORLD;
+#else
+    return 0;
+#endif
+}
+
+#if HAVE_MPI
+/*!
+ * \brief Returns the MPI communicator of a collective communication object of a grid.
+ */
+inline MpiCommunicator toMpiCommunicator(const Dune::CollectiveCommunication<MPI_Comm>& comm)
+{ return static_cast<MPI_Comm>(comm); }
+#endif // HAVE_MPI
+
+/*!
+ * \brief Returns the MPI communicator of a collective communication object of a grid.
+ *
+ * If the grid does not use MPI for its communication, the default communicator is
+ * returned.
+ */
+template <class GridComm>
+inline MpiCommunicator toMpiCommunicator(const GridComm& comm OPM_UNUSED)
+{ return defaultMpiCommunicator(); }
+
 /*!
  * \brief Simplifies handling of buffers to be used in conjunction with MPI
+ *
+ * All communication of the buffer uses the communicator which is passed to the
+ * constructor or to setCommunicator(). By default, MPI_COMM_WORLD is used.
  */
 template <class DataType>
 class MpiBuffer
@@ -49,15 +94,19 @@ public:
     {
         data_ = NULL;
         dataSize_ = 0;
+        hasPersistentRequest_ = false;
+        mpiComm_ = defaultMpiCommunicator();
 
         setMpiDataType_();
         updateMpiDataSize_();
     }
 
-    MpiBuffer(size_t size)
+    MpiBuffer(size_t size, MpiCommunicator comm = defaultMpiCommunicator())
     {
         data_ = new DataType[size];
         dataSize_ = size;
+        hasPersistentRequest_ = false;
+        mpiComm_ = comm;
 
         setMpiDataType_();
         updateMpiDataSize_();
@@ -66,19 +115,42 @@ public:
     MpiBuffer(const MpiBuffer&) = default;
 
     ~MpiBuffer()
-    { delete[] data_; }
+    {
+        freePersistentRequest_();
+        delete[] data_;
+    }
 
     /*!
      * \brief Set the size of the buffer
+     *
+     * This invalidates the persistent request of the buffer.
      */
     void resize(size_t newSize)
     {
+        freePersistentRequest_();
         delete[] data_;
         data_ = new DataType[newSize];
         dataSize_ = newSize;
         updateMpiDataSize_();
     }
 
+    /*!
+     * \brief Set the communicator which is used to exchange the buffer.
+     *
+     * This invalidates the persistent request of the buffer.
+     */
+    void setCommunicator(MpiCommunicator comm)
+    {
+        freePersistentRequest_();
+        mpiComm_ = comm;
+    }
+
+    /*!
+     * \brief Returns the communicator which is used to exchange the buffer.
+     */
+    MpiCommunicator communicator() const
+    { return mpiComm_; }
+
     /*!
      * \brief Send the buffer asyncronously to a peer process.
      */
@@ -90,13 +162,32 @@ public:
                   mpiDataType_,
                   static_cast<int>(peerRank),
                   0, // tag
-                  MPI_COMM_WORLD,
+                  mpiComm_,
                   &mpiRequest_);
 #endif
     }
 
     /*!
-     * \brief Wait until the buffer was send to the peer completely.
+     * \brief Receive the buffer asyncronously from a peer process.
+     *
+     * The contents of the buffer are only valid after wait() has been called.
+     */
+    void startReceive(unsigned peerRank)
+    {
+#if HAVE_MPI
+        MPI_Irecv(data_,
+                  static_cast<int>(mpiDataSize_),
+                  mpiDataType_,
+                  static_cast<int>(peerRank),
+                  0, // tag
+                  mpiComm_,
+                  &mpiRequest_);
+#endif
+    }
+
+    /*!
+     * \brief Wait until the buffer was send to the peer completely or until an
+     *        asyncronous receive operation has been completed.
      */
     void wait()
     {
@@ -105,6 +196,61 @@ public:
 #endif // HAVE_MPI
     }
 
+    /*!
+     * \brief Create a persistent request which sends the buffer to a peer process.
+     *
+     * The request is started by start(). This avoids setting up the communication
+     * each time if the buffer is exchanged with the same peer over and over again.
+     */
+    void initPersistentSend(unsigned peerRank)
+    {
+        freePersistentRequest_();
+#if HAVE_MPI
+        MPI_Send_init(data_,
+                      static_cast<int>(mpiDataSize_),
+                      mpiDataType_,
+                      static_cast<int>(peerRank),
+                      0, // tag
+                      mpiComm_,
+                      &mpiRequest_);
+        hasPersistentRequest_ = true;
+#endif
+    }
+
+    /*!
+     * \brief Create a persistent request which receives the buffer from a peer process.
+     *
+     * The request is started by start(). The contents of the buffer are only valid
+     * after wait() has been called.
+     */
+    void initPersistentReceive(unsigned peerRank)
+    {
+        freePersistentRequest_();
+#if HAVE_MPI
+        MPI_Recv_init(data_,
+                      static_cast<int>(mpiDataSize_),
+                      mpiDataType_,
+                      static_cast<int>(peerRank),
+                      0, // tag
+                      mpiComm_,
+                      &mpiRequest_);
+        hasPersistentRequest_ = true;
+#endif
+    }
+
+    /*!
+     * \brief Start the persistent request of the buffer.
+     *
+     * initPersistentSend() or initPersistentReceive() must have been called before.
+     */
+    void start()
+    {
+#if HAVE_MPI
+        assert(hasPersistentRequest_);
+        MPI_Start(&mpiRequest_);
+#endif
+    }
+
     /*!
      * \brief Receive the buffer syncronously from a peer rank
      */
@@ -116,7 +262,7 @@ public:
                  mpiDataType_,
                  static_cast<int>(peerRank),
                  0, // tag
-                 MPI_COMM_WORLD,
+                 mpiComm_,
                  &mpiStatus_);
         assert(!mpiStatus_.MPI_ERROR);
 #endif // HAVE_MPI
@@ -126,14 +272,14 @@ public:
     /*!
      * \brief Returns the current MPI_Request object.
      *
-     * This object is only well defined after the send() method.
+     * This object is only well defined after the send() and startReceive() methods.
      */
     MPI_Request& request()
     { return mpiRequest_; }
     /*!
      * \brief Returns the current MPI_Request object.
      *
-     * This object is only well defined after the send() method.
+     * This object is only well defined after the send() and startReceive() methods.
      */
     const MPI_Request& request() const
     { return mpiRequest_; }
@@ -224,8 +370,24 @@ private:
 #endif // HAVE_MPI
     }
 
+    void freePersistentRequest_()
+    {
+#if HAVE_MPI
+        if (hasPersistentRequest_) {
+            // the buffer may be destroyed after MPI has been shut down
+            int finalized;
+            MPI_Finalized(&finalized);
+            if (!finalized)
+                MPI_Request_free(&mpiRequest_);
+        }
+#endif // HAVE_MPI
+        hasPersistentRequest_ = false;
+    }
+
     DataType *data_;
     size_t dataSize_;
+    bool hasPersistentRequest_;
+    MpiCommunicator mpiComm_;
 #if HAVE_MPI
     size_t mpiDataSize_;
     MPI_Datatype mpiDataType_;
@@ -0,0 +1,215 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ * \copydoc Ewoms::MpiSharedWindow
+ */
+#ifndef EWOMS_MPI_SHARED_WINDOW_HH
+#define EWOMS_MPI_SHARED_WINDOW_HH
+
+#include <ewoms/parallel/mpibuffer.hh>
+
+#include <opm/common/ErrorMacros.hpp>
+#include <opm/common/Exceptions.hpp>
+#include <opm/common/Unused.hpp>
+
+#if HAVE_MPI
+#include <mpi.h>
+#endif
+
+#include <stddef.h>
+
+#include <algorithm>
+#include <map>
+#include <vector>
+#include <stdexcept>
+#include <cassert>
+
+#if HAVE_MPI && MPI_VERSION >= 3
+#define EWOMS_HAVE_MPI_SHARED_WINDOWS 1
+#else
+#define EWOMS_HAVE_MPI_SHARED_WINDOWS 0
+#endif
+
+namespace Ewoms {
+
+/*!
+ * \brief A memory segment which is directly accessible by all processes that run on
+ *        the same node.
+ *
+ * Each process allocates a segment of a given size. The segments of the other
+ * processes on the same node can then be read directly, i.e., without any copying by
+ * MPI. All processes of the communicator must take part in the construction, in
+ * calls to sync() and in the destruction of the window.
+ *
+ * If MPI-3 is not available, the window only provides the local segment and no
+ * process is considered to be on the same node as any other.
+ */
+template <class DataType>
+class MpiSharedWindow
+{
+public:
+    // the window owns MPI resources which must be freed exactly once
+    MpiSharedWindow(const MpiSharedWindow&) = delete;
+
+    /*!
+     * \brief Allocate the local segment of the window.
+     *
+     * This is a collective operation on the communicator.
+     */
+    MpiSharedWindow(MpiCommunicator comm OPM_UNUSED, size_t size)
+    {
+        localData_ = 0;
+        localSize_ = size;
+
+#if EWOMS_HAVE_MPI_SHARED_WINDOWS
+        MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, /*key=*/0, MPI_INFO_NULL, &nodeComm_);
+
+        // MPI does not like zero sized segments on all implementations, so we always
+        // allocate at least one object
+        MPI_Aint segmentSize = static_cast<MPI_Aint>(std::max<size_t>(size, 1)*sizeof(DataType));
+        int err = MPI_Win_allocate_shared(segmentSize,
+                                          static_cast<int>(sizeof(DataType)),
+                                          MPI_INFO_NULL,
+                                          nodeComm_,
+                                          &localData_,
+                                          &window_);
+        if (err != MPI_SUCCESS)
+            OPM_THROW(std::runtime_error,
+                      "Could not allocate a shared memory window of size " << size);
+
+        // the window is accessed passively during its whole lifetime. synchronization
+        // is done using sync()
+        MPI_Win_lock_all(MPI_MODE_NOCHECK, window_);
+
+        // determine the ranks within the communicator of the processes on the node
+        // and the base pointers of their segments
+        int nodeSize;
+        MPI_Comm_size(nodeComm_, &nodeSize);
+
+        std::vector<int> nodeRanks(static_cast<size_t>(nodeSize));
+        std::vector<int> commRanks(static_cast<size_t>(nodeSize));
+        for (int i = 0; i < nodeSize; ++i)
+            nodeRanks[static_cast<size_t>(i)] = i;
+
+        MPI_Group commGroup;
+        MPI_Group nodeGroup;
+        MPI_Comm_group(comm, &commGroup);
+        MPI_Comm_group(nodeComm_, &nodeGroup);
+        MPI_Group_translate_ranks(nodeGroup, nodeSize, nodeRanks.data(),
+                                  commGroup, commRanks.data());
+        MPI_Group_free(&nodeGroup);
+        MPI_Group_free(&commGroup);
+
+        for (int i = 0; i < nodeSize; ++i) {
+            MPI_Aint peerSize;
+            int peerDispUnit;
+            DataType* peerData;
+            MPI_Win_shared_query(window_, i, &peerSize, &peerDispUnit, &peerData);
+
+            unsigned commRank = static_cast<unsigned>(commRanks[static_cast<size_t>(i)]);
+            peerData_[commRank] = peerData;
+        }
+#else
+        localData_ = new DataType[size];
+#endif
+    }
+
+    /*!
+     * \brief Release the window.
+     *
+     * This is a collective operation on the communicator.
+     */
+    ~MpiSharedWindow()
+    {
+#if EWOMS_HAVE_MPI_SHARED_WINDOWS
+        // if MPI has already been finalized, the window cannot be freed anymore
+        int finalized;
+        MPI_Finalized(&finalized);
+        if (finalized)
+            return;
+
+        MPI_Win_unlock_all(window_);
+        MPI_Win_free(&window_);
+        MPI_Comm_free(&nodeComm_);
+#else
+        delete[] localData_;
+#endif
+    }
+
+    /*!
+     * \brief Returns true iff the segment of a process can be accessed directly.
+     *
+     * The rank refers to the communicator which was passed to the constructor.
+     */
+    bool isOnNode(unsigned peerRank) const
+    { return peerData_.count(peerRank) > 0; }
+
+    /*!
+     * \brief Returns the number of objects in the local segment.
+     */
+    size_t size() const
+    { return localSize_; }
+
+    /*!
+     * \brief Returns the local segment.
+     */
+    DataType* data()
+    { return localData_; }
+
+    /*!
+     * \brief Returns the segment of a process on the same node.
+     */
+    const DataType* peerData(unsigned peerRank) const
+    {
+        assert(isOnNode(peerRank));
+        return peerData_.find(peerRank)->second;
+    }
+
+    /*!
+     * \brief Make the modifications of the local segment visible to all processes
+     *        on the node and wait until all of them have done the same.
+     */
+    void sync()
+    {
+#if EWOMS_HAVE_MPI_SHARED_WINDOWS
+        MPI_Win_sync(window_);
+        MPI_Barrier(nodeComm_);
+        MPI_Win_sync(window_);
+#endif
+    }
+
+private:
+    DataType* localData_;
+    size_t localSize_;
+    std::map<unsigned, const DataType*> peerData_;
+
+#if EWOMS_HAVE_MPI_SHARED_WINDOWS
+    MPI_Comm nodeComm_;
+    MPI_Win window_;
+#endif
+};
+
+} // namespace Ewoms
+
+#endif
@@ -29,12 +29,21 @@
 
 #include <ewoms/parallel/locks.hh>
 
+#include <deque>
+#include <vector>
+
 namespace Ewoms {
 
 /*!
  * \brief Provides an STL-iterator like interface to iterate over the enties of a
  *        GridView in OpenMP threaded applications
  *
+ * The entities are partitioned into chunks of consecutive entities when the object is
+ * created, and each thread gets a contiguous range of these chunks assigned. Threads
+ * which have finished their own chunks steal the remaining ones of the other
+ * threads. This means that a lock only needs to be taken once per chunk instead of for
+ * each entity.
+ *
  * ATTENTION: This class must be instantiated in a sequential context!
  */
 template <class GridView, int codim>
@@ -42,26 +51,64 @@ class ThreadedEntityIterator
 {
     typedef typename GridView::template Codim<codim>::Entity Entity;
     typedef typename GridView::template Codim<codim>::Iterator EntityIterator;
+
+    struct ThreadData_
+    {
+        ThreadData_(const EntityIterator& endIt)
+            : it(endIt)
+            , remaining(0)
+        {}
+
+        // the chunks which are still to be processed by the thread
+        std::deque<unsigned> chunks;
+        OmpMutex mutex;
+
+        // the entity which was handed out last and the number of entities of the
+        // current chunk which are not yet handed out
+        EntityIterator it;
+        unsigned remaining;
+    };
+
 public:
-    ThreadedEntityIterator(const GridView& gridView)
+    ThreadedEntityIterator(const GridView& gridView, unsigned chunkSize = 256)
         : gridView_(gridView)
-        , sequentialIt_(gridView_.template begin<codim>())
         , sequentialEnd_(gridView.template end<codim>())
-    { }
+    {
+        // determine the first entity of each chunk
+        unsigned n = 0;
+        auto it = gridView_.template begin<codim>();
+        for (; it != sequentialEnd_; ++it, ++n) {
+            if (n % chunkSize == 0) {
+                chunkBegin_.push_back(it);
+                chunkSize_.push_back(0);
+            }
+            ++ chunkSize_.back();
+        }
+
+        // distribute the chunks evenly to the threads
+#ifdef _OPENMP
+        unsigned numThreads = static_cast<unsigned>(omp_get_max_threads());
+#else
+        unsigned numThreads = 1;
+#endif
+        unsigned numChunks = static_cast<unsigned>(chunkBegin_.size());
+        threadData_.reserve(numThreads);
+        for (unsigned threadId = 0; threadId < numThreads; ++threadId) {
+            threadData_.emplace_back(sequentialEnd_);
+            auto& data = threadData_.back();
+
+            unsigned firstChunk = threadId*numChunks/numThreads;
+            unsigned lastChunk = (threadId + 1)*numChunks/numThreads;
+            for (unsigned chunkIdx = firstChunk; chunkIdx < lastChunk; ++chunkIdx)
+                data.chunks.push_back(chunkIdx);
+        }
+    }
 
     ThreadedEntityIterator(const ThreadedEntityIterator& other) = default;
 
     // begin iterating over the grid in parallel
     EntityIterator beginParallel()
-    {
-        mutex_.lock();
-        auto tmp = sequentialIt_;
-        if (sequentialIt_ != sequentialEnd_)
-            ++sequentialIt_; // make the next thread look at the next element
-        mutex_.unlock();
-
-        return tmp;
-    }
+    { return increment(); }
 
     // returns true if the last element was reached
     bool isFinished(const EntityIterator& it) const
@@ -71,21 +118,77 @@ public:
     // thread
     EntityIterator increment()
     {
-        mutex_.lock();
-        auto tmp = sequentialIt_;
-        if (sequentialIt_ != sequentialEnd_)
-            ++sequentialIt_;
-        mutex_.unlock();
-
-        return tmp;
+        unsigned threadId = threadId_();
+        if (threadId >= threadData_.size())
+            // more threads than expected. since the positions of these cannot be
+            // tracked, they do not get any work.
+            return sequentialEnd_;
+
+        auto& data = threadData_[threadId];
+        if (data.remaining > 0) {
+            ++ data.it;
+            -- data.remaining;
+            return data.it;
+        }
+
+        return nextChunk_(threadId);
     }
 
 private:
+    static unsigned threadId_()
+    {
+#ifdef _OPENMP
+        return static_cast<unsigned>(omp_get_thread_num());
+#else
+        return 0;
+#endif
+    }
+
+    // start working on the next chunk of the thread. if it does not have any chunks
+    // left, take one from the back of another thread's queue.
+    EntityIterator nextChunk_(unsigned threadId)
+    {
+        unsigned numThreads = static_cast<unsigned>(threadData_.size());
+
+        int chunkIdx = popChunk_(threadData_[threadId], /*fromFront=*/true);
+        for (unsigned i = 1; chunkIdx < 0 && i <= numThreads; ++i)
+            chunkIdx = popChunk_(threadData_[(threadId + i) % numThreads], /*fromFront=*/false);
+
+        if (chunkIdx < 0)
+            return sequentialEnd_;
+
+        auto& data = threadData_[threadId];
+        data.it = chunkBegin_[static_cast<unsigned>(chunkIdx)];
+        data.remaining = chunkSize_[static_cast<unsigned>(chunkIdx)] - 1;
+        return data.it;
+    }
+
+    static int popChunk_(ThreadData_& data, bool fromFront)
+    {
+        int chunkIdx = -1;
+
+        data.mutex.lock();
+        if (!data.chunks.empty()) {
+            if (fromFront) {
+                chunkIdx = static_cast<int>(data.chunks.front());
+                data.chunks.pop_front();
+            }
+            else {
+                chunkIdx = static_cast<int>(data.chunks.back());
+                data.chunks.pop_back();
+            }
+        }
+        data.mutex.unlock();
+
+        return chunkIdx;
+    }
+
     GridView gridView_;
-    EntityIterator sequentialIt_;
     EntityIterator sequentialEnd_;
 
-    OmpMutex mutex_;
+    std::vector<EntityIterator> chunkBegin_;
+    std::vector<unsigned> chunkSize_;
+    std::vector<ThreadData_> threadData_;
 };
 } // namespace Ewoms
 
@@ -0,0 +1,203 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \copydoc Ewoms::ThreadLocalObjects
+ */
+#ifndef EWOMS_THREAD_LOCAL_OBJECTS_HH
+#define EWOMS_THREAD_LOCAL_OBJECTS_HH
+
+#include <ewoms/common/alignedallocator.hh>
+
+#include <vector>
+#include <new>
+#include <cstddef>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace Ewoms {
+
+/*!
+ * \brief Stores one object per OpenMP thread.
+ *
+ * In contrast to a plain std::vector, each object is constructed by the thread which
+ * uses it. On NUMA machines, this means that the memory of the object is "first
+ * touched" by the thread which owns it and is thus placed on the memory node of that
+ * thread. Also, each object is allocated in its own set of cache lines, so that the
+ * objects of different threads do not suffer from false sharing.
+ */
+template <class T>
+class ThreadLocalObjects
+{
+    static const size_t cacheLineSize = 64;
+    static const size_t alignment = (alignof(T) > cacheLineSize) ? alignof(T) : cacheLineSize;
+    static const size_t allocSize = ((sizeof(T) + alignment - 1)/alignment)*alignment;
+
+public:
+    ThreadLocalObjects()
+    { }
+
+    // copying the objects of other threads around defeats the purpose of this class
+    ThreadLocalObjects(const ThreadLocalObjects&) = delete;
+
+    ~ThreadLocalObjects()
+    { clear(); }
+
+    /*!
+     * \brief Create one object for each of the first 'numThreads' OpenMP threads.
+     *
+     * The objects are constructed from within a parallel region by calling the
+     * constructor of T with the specified arguments. If the OpenMP runtime provides
+     * less threads than requested or if a constructor throws, the affected objects are
+     * constructed by the master thread.
+     */
+    template <class... Args>
+    void create(unsigned numThreads, Args&... args)
+    {
+        clear();
+        objects_.resize(numThreads, nullptr);
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(numThreads)
+#endif
+        {
+            unsigned threadId = threadId_();
+            if (threadId < numThreads) {
+                // exceptions must not leave a parallel region. the constructor is just
+                // called again by the master thread in this case.
+                try { objects_[threadId] = allocate_(args...); }
+                catch (...) { }
+            }
+        }
+
+        for (unsigned threadId = 0; threadId < numThreads; ++threadId)
+            if (!objects_[threadId])
+                objects_[threadId] = allocate_(args...);
+    }
+
+    /*!
+     * \brief Call a functor for each object from within the thread which owns it.
+     *
+     * This is intended for initialization code which allocates additional memory, so
+     * that this memory is first-touched by the thread which uses it as well. Objects for
+     * which the functor threw are processed again by the master thread.
+     */
+    template <class Functor>
+    void applyLocally(Functor functor)
+    {
+        unsigned numThreads = size();
+        std::vector<char> isDone(numThreads, 0);
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(numThreads)
+#endif
+        {
+            unsigned threadId = threadId_();
+            if (threadId < numThreads) {
+                try {
+                    functor(*objects_[threadId]);
+                    isDone[threadId] = 1;
+                }
+                catch (...) { }
+            }
+        }
+
+        for (unsigned threadId = 0; threadId < numThreads; ++threadId)
+            if (!isDone[threadId])
+                functor(*objects_[threadId]);
+    }
+
+    /*!
+     * \brief Destroy all objects.
+     */
+    void clear()
+    {
+        for (unsigned threadId = 0; threadId < objects_.size(); ++threadId) {
+            if (!objects_[threadId])
+                continue;
+
+            objects_[threadId]->~T();
+            Ewoms::aligned_free(objects_[threadId]);
+        }
+        objects_.clear();
+    }
+
+    /*!
+     * \brief Returns the number of objects.
+     */
+    unsigned size() const
+    { return static_cast<unsigned>(objects_.size()); }
+
+    /*!
+     * \brief Returns true if no objects have been created.
+     */
+    bool empty() const
+    { return objects_.empty(); }
+
+    /*!
+     * \brief Returns the object of a given thread.
+     */
+    T& operator[](unsigned threadId)
+    { return *objects_[threadId]; }
+
+    /*!
+     * \copydoc operator[]
+     */
+    const T& operator[](unsigned threadId) const
+    { return *objects_[threadId]; }
+
+private:
+    static unsigned threadId_()
+    {
+#ifdef _OPENMP
+        return static_cast<unsigned>(omp_get_thread_num());
+#else
+        return 0;
+#endif
+    }
+
+    template <class... Args>
+    static T* allocate_(Args&... args)
+    {
+        void* storage = Ewoms::aligned_alloc(alignment, allocSize);
+        if (!storage)
+            throw std::bad_alloc();
+
+        try {
+            return new (storage) T(args...);
+        }
+        catch (...) {
+            Ewoms::aligned_free(storage);
+            throw;
+        }
+    }
+
+    std::vector<T*> objects_;
+};
+
+} // namespace Ewoms
+
+#endif
@@ -31,18 +31,38 @@
 #include <omp.h>
 #endif
 
+#if HAVE_MPI
+#include <mpi.h>
+#endif
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 #include <ewoms/parallel/locks.hh>
 #include <ewoms/common/parametersystem.hh>
 #include <ewoms/common/propertysystem.hh>
 
 #include <opm/common/ErrorMacros.hpp>
 #include <opm/common/Exceptions.hpp>
+#include <opm/common/Unused.hpp>
 
 #include <dune/common/version.hh>
 
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
 namespace Ewoms {
 namespace Properties {
 NEW_PROP_TAG(ThreadsPerProcess);
+NEW_PROP_TAG(ThreadBinding);
 }
 
 /*!
@@ -69,37 +89,52 @@ public:
         EWOMS_REGISTER_PARAM(TypeTag, int, ThreadsPerProcess,
                              "The maximum number of threads to be instantiated per process "
                              "('-1' means 'automatic')");
+        EWOMS_REGISTER_PARAM(TypeTag, std::string, ThreadBinding,
+                             "The policy used to bind the threads to CPU cores ('none', "
+                             "'compact' or 'scatter')");
     }
 
+    /*!
+     * \brief Set the number of OpenMP threads of the calling thread and bind the threads
+     *        to CPUs.
+     *
+     * Several simulators may share the same process and the same parameters, e.g., if
+     * the members of an ensemble are run concurrently from within an OpenMP parallel
+     * region. In this case, each of them calls this method from its own thread. Since
+     * OpenMP stores the number of threads for each thread, all simulators use the
+     * specified number of threads for their parallel regions (provided that nested
+     * parallelism is enabled), but the threads are only bound to CPUs if this method is
+     * called outside of a parallel region.
+     */
     static void init()
     {
-        numThreads_ = EWOMS_GET_PARAM(TypeTag, int, ThreadsPerProcess);
+        int numThreads = EWOMS_GET_PARAM(TypeTag, int, ThreadsPerProcess);
 
         // some safety checks. This is pretty ugly macro-magic, but so what?
 #if !defined(_OPENMP)
-        if (numThreads_ != 1 && numThreads_ != -1)
+        if (numThreads != 1 && numThreads != -1)
             OPM_THROW(std::invalid_argument,
                       "OpenMP is not available. The only valid values for "
-                      "threads-per-process is 1 and -1 but it is " << numThreads_ << "!");
-        numThreads_ = 1;
+                      "threads-per-process is 1 and -1 but it is " << numThreads << "!");
+        numThreads = 1;
 #elif !DUNE_VERSION_NEWER(DUNE_COMMON, 2,4) && !defined NDEBUG
-        if (numThreads_ != 1)
+        if (numThreads != 1)
             OPM_THROW(std::invalid_argument,
                       "You seem to be using Dune "
                       <<DUNE_COMMON_VERSION_MAJOR<<"."<<DUNE_COMMON_VERSION_MINOR
                       << " in debug mode and with the number of OpenMP threads larger than 1. "
                       "This Dune version does not support thread parallelism in debug mode!");
-        numThreads_ = 1;
+        numThreads = 1;
 
 #elif DUNE_VERSION_NEWER(DUNE_COMMON, 2,4) && !defined NDEBUG && defined DUNE_INTERFACECHECK
-        if (numThreads_ != 1)
+        if (numThreads != 1)
             OPM_THROW(std::invalid_argument,
                       "You explicitly enabled Barton-Nackman interface checking in Dune. "
                       "The Dune implementation of this is currently incompatible with "
                       "thread parallelism!");
-        numThreads_ = 1;
+        numThreads = 1;
 #else
-        if (numThreads_ == 0)
+        if (numThreads == 0)
             OPM_THROW(std::invalid_argument,
                       "Zero threads per process are not possible: It must be at least 1, "
                       "(or -1 for 'automatic')!");
@@ -108,15 +143,29 @@ public:
 #ifdef _OPENMP
         // actually limit the number of threads and get the number of threads which are
         // used in the end.
-        if (numThreads_ > 0)
-            omp_set_num_threads(numThreads_);
+        if (numThreads > 0)
+            omp_set_num_threads(numThreads);
+
+        numThreads = omp_get_max_threads();
+#endif
 
-        numThreads_ = omp_get_max_threads();
+        ScopedLock lock(mutex_());
+        if (numThreads > numThreads_)
+            numThreads_ = numThreads;
+        lock.unlock();
+
+#ifdef _OPENMP
+        if (omp_in_parallel())
+            return;
 #endif
+        bindThreads_();
     }
 
     /*!
      * \brief Return the maximum number of threads of the current process.
+     *
+     * If multiple simulators run concurrently, this is the largest number of threads
+     * used by any of them, i.e., it can be used to size the per-thread data.
      */
     static unsigned maxThreads()
     { return static_cast<unsigned>(numThreads_); }
@@ -134,11 +183,201 @@ public:
     }
 
 private:
-    static int numThreads_;
+    /*!
+     * \brief Bind each thread to a single CPU according to the ThreadBinding policy.
+     *
+     * The CPUs which can be used are the ones of the process' affinity mask. If several
+     * processes of the same node are allowed to use the same CPUs (i.e., the MPI launcher
+     * did not bind them), these CPUs are split into disjoint slices based on the
+     * node-local rank of the process. The 'compact' policy then fills the cores of one
+     * socket before moving on to the next socket, while the 'scatter' policy distributes
+     * consecutive threads over the sockets and only uses the hardware threads of a
+     * core once all cores of the socket are busy.
+     *
+     * This assumes that the OpenMP runtime reuses its threads for subsequent parallel
+     * regions, which is the case for all common implementations unless the OMP_PROC_BIND
+     * environment variable is set.
+     */
+    static void bindThreads_()
+    {
+        const std::string& policy = EWOMS_GET_PARAM(TypeTag, std::string, ThreadBinding);
+        if (policy == "none")
+            return;
+        if (policy != "compact" && policy != "scatter")
+            OPM_THROW(std::invalid_argument,
+                      "Unknown thread binding policy '" << policy << "'. Valid policies "
+                      "are 'none', 'compact' and 'scatter'");
+
+#ifdef __linux__
+        cpu_set_t processMask;
+        CPU_ZERO(&processMask);
+        if (sched_getaffinity(0, sizeof(processMask), &processMask) != 0) {
+            std::cerr << "Warning: Could not determine the CPUs available to the process. "
+                      << "The threads are not bound to CPUs.\n";
+            return;
+        }
+
+        std::vector<int> cpus;
+        for (int cpuIdx = 0; cpuIdx < CPU_SETSIZE; ++cpuIdx)
+            if (CPU_ISSET(cpuIdx, &processMask))
+                cpus.push_back(cpuIdx);
+
+        int rank = 0;
+        int localRank = 0;
+        int localSize = 1;
+        restrictToLocalSlice_(cpus, rank, localRank, localSize);
+        sortCpus_(cpus, /*scatter=*/policy == "scatter");
+
+        std::vector<int> threadCpu(static_cast<unsigned>(numThreads_));
+        for (unsigned threadIdx = 0; threadIdx < threadCpu.size(); ++threadIdx)
+            threadCpu[threadIdx] = cpus[threadIdx % cpus.size()];
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+        {
+            cpu_set_t threadMask;
+            CPU_ZERO(&threadMask);
+            CPU_SET(threadCpu[threadId()], &threadMask);
+            pthread_setaffinity_np(pthread_self(), sizeof(threadMask), &threadMask);
+        }
+
+        // report the resulting binding. each process prints a single line, so the
+        // output of different processes is not intermixed within a line.
+        std::ostringstream oss;
+        oss << "Process " << rank << " (local rank " << localRank << " of " << localSize
+            << "), '" << policy << "' thread binding:";
+        for (unsigned threadIdx = 0; threadIdx < threadCpu.size(); ++threadIdx)
+            oss << " " << threadIdx << "->" << threadCpu[threadIdx]
+                << "(socket " << cpuTopology_(threadCpu[threadIdx], "physical_package_id") << ")";
+        oss << "\n";
+        std::cout << oss.str() << std::flush;
+#else
+        std::cerr << "Warning: Binding threads to CPUs is only supported on Linux.\n";
+#endif
+    }
+
+    // if the launcher did not bind the processes of a node to disjoint sets of CPUs,
+    // restrict the CPUs of the current process to a slice determined by its node-local
+    // rank
+    static void restrictToLocalSlice_(std::vector<int>& cpus OPM_UNUSED,
+                                      int& rank OPM_UNUSED,
+                                      int& localRank OPM_UNUSED,
+                                      int& localSize OPM_UNUSED)
+    {
+#if HAVE_MPI
+        int mpiIsInitialized = 0;
+        MPI_Initialized(&mpiIsInitialized);
+        if (!mpiIsInitialized)
+            return;
+
+        MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+        MPI_Comm localComm;
+        MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, /*key=*/0,
+                            MPI_INFO_NULL, &localComm);
+        MPI_Comm_rank(localComm, &localRank);
+        MPI_Comm_size(localComm, &localSize);
+
+        // the processes share their CPUs if they all see the same first CPU and the
+        // same number of CPUs
+        int localInfo[2] = { cpus.front(), static_cast<int>(cpus.size()) };
+        int minInfo[2];
+        int maxInfo[2];
+        MPI_Allreduce(localInfo, minInfo, 2, MPI_INT, MPI_MIN, localComm);
+        MPI_Allreduce(localInfo, maxInfo, 2, MPI_INT, MPI_MAX, localComm);
+        MPI_Comm_free(&localComm);
+
+        bool sharedCpus = minInfo[0] == maxInfo[0] && minInfo[1] == maxInfo[1];
+        if (!sharedCpus || localSize < 2)
+            return;
+
+        // sort the CPUs compactly first, so that each slice exhibits as few sockets as
+        // possible
+        sortCpus_(cpus, /*scatter=*/false);
+        unsigned sliceSize = std::max<unsigned>(1, static_cast<unsigned>(cpus.size()/localSize));
+        unsigned sliceBegin = (static_cast<unsigned>(localRank)*sliceSize) % cpus.size();
+        unsigned sliceEnd = std::min<unsigned>(sliceBegin + sliceSize, static_cast<unsigned>(cpus.size()));
+        cpus = std::vector<int>(cpus.begin() + sliceBegin, cpus.begin() + sliceEnd);
+#endif
+    }
+
+    // order the CPUs in which they are assigned to the threads
+    static void sortCpus_(std::vector<int>& cpus, bool scatter)
+    {
+        // determine the socket, the core and the index of the hardware thread within
+        // its core for each CPU
+        typedef std::tuple<int, int, int, int> CpuInfo; // (socket, core, smt, cpu)
+        std::vector<CpuInfo> infos;
+        for (unsigned i = 0; i < cpus.size(); ++i) {
+            int socket = cpuTopology_(cpus[i], "physical_package_id");
+            int core = cpuTopology_(cpus[i], "core_id");
+            int smt = 0;
+            for (unsigned j = 0; j < infos.size(); ++j)
+                if (std::get<0>(infos[j]) == socket && std::get<1>(infos[j]) == core)
+                    ++ smt;
+            infos.push_back(CpuInfo(socket, core, smt, cpus[i]));
+        }
+
+        if (!scatter) {
+            std::sort(infos.begin(), infos.end());
+            for (unsigned i = 0; i < infos.size(); ++i)
+                cpus[i] = std::get<3>(infos[i]);
+            return;
+        }
+
+        // for the scatter policy, use all cores of a socket before their additional
+        // hardware threads and deal the CPUs out to the sockets in a round-robin fashion
+        std::vector<std::vector<CpuInfo> > socketCpus;
+        std::vector<int> socketIds;
+        for (unsigned i = 0; i < infos.size(); ++i) {
+            int socket = std::get<0>(infos[i]);
+            unsigned socketIdx = static_cast<unsigned>(
+                std::find(socketIds.begin(), socketIds.end(), socket) - socketIds.begin());
+            if (socketIdx == socketIds.size()) {
+                socketIds.push_back(socket);
+                socketCpus.resize(socketIds.size());
+            }
+            CpuInfo info = infos[i];
+            std::get<0>(info) = std::get<2>(infos[i]);
+            std::get<2>(info) = socket;
+            socketCpus[socketIdx].push_back(info); // (smt, core, socket, cpu)
+        }
+        for (unsigned socketIdx = 0; socketIdx < socketCpus.size(); ++socketIdx)
+            std::sort(socketCpus[socketIdx].begin(), socketCpus[socketIdx].end());
+
+        cpus.clear();
+        for (unsigned i = 0; cpus.size() < infos.size(); ++i)
+            for (unsigned socketIdx = 0; socketIdx < socketCpus.size(); ++socketIdx)
+                if (i < socketCpus[socketIdx].size())
+                    cpus.push_back(std::get<3>(socketCpus[socketIdx][i]));
+    }
+
+    // read a topology attribute of a CPU from sysfs. if it is not available, 0 is
+    // returned.
+    static int cpuTopology_(int cpuIdx, const char *attribute)
+    {
+        std::ostringstream fileName;
+        fileName << "/sys/devices/system/cpu/cpu" << cpuIdx << "/topology/" << attribute;
+        std::ifstream is(fileName.str());
+        int value = 0;
+        if (!(is >> value))
+            return 0;
+        return value;
+    }
+
+    // the mutex which serializes the updates of the number of threads
+    static OmpMutex& mutex_()
+    {
+        static OmpMutex mutex;
+        return mutex;
+    }
+
+    static std::atomic<int> numThreads_;
 };
 
 template <class TypeTag>
-int ThreadManager<TypeTag>::numThreads_ = 1;
+std::atomic<int> ThreadManager<TypeTag>::numThreads_(1);
 } // namespace Ewoms
 
 #endif
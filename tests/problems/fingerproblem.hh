@@ -40,6 +40,9 @@
 #include <opm/material/fluidstates/ImmiscibleFluidState.hpp>
 #include <opm/material/components/SimpleH2O.hpp>
 #include <opm/material/components/Air.hpp>
+#include <opm/material/common/MathToolbox.hpp>
+#include <opm/common/ErrorMacros.hpp>
+#include <opm/common/Exceptions.hpp>
 
 #include <ewoms/models/immiscible/immiscibleproperties.hh>
 #include <ewoms/disc/common/restrictprolong.hh>
@@ -55,6 +58,9 @@
 
 #include <vector>
 #include <string>
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
 
 namespace Ewoms {
 template <class TypeTag>
@@ -174,6 +180,8 @@ class FingerProblem : public GET_PROP_TYPE(TypeTag, BaseProblem)
     typedef typename GET_PROP_TYPE(TypeTag, Simulator) Simulator;
     typedef typename GET_PROP_TYPE(TypeTag, Constraints) Constraints;
     typedef typename GET_PROP_TYPE(TypeTag, Model) Model;
+    typedef typename GET_PROP_TYPE(TypeTag, Evaluation) Evaluation;
+    typedef Opm::MathToolbox<Evaluation> Toolbox;
 
     enum {
         // number of phases
@@ -343,6 +351,16 @@ public:
         }
     }
 
+    /*!
+     * \copydoc FvBaseProblem::gridChanged
+     */
+    void gridChanged()
+    {
+        ParentType::gridChanged();
+
+        checkIntensiveQuantitiesCache_();
+    }
+
     //! \}
 
     /*!
@@ -505,6 +523,52 @@ private:
         return false;
     }
 
+    // make sure that the intensive quantities which are still cached after the grid has
+    // been adapted are the ones of the current solution of their degree of freedom. the
+    // quantities which are not determined by the primary variables alone (e.g., the
+    // capillary pressure of the hysteresis law) are not considered.
+    void checkIntensiveQuantitiesCache_() const
+    {
+        const auto& model = this->model();
+        if (!model.storeIntensiveQuantities())
+            return;
+
+        ElementContext elemCtx(this->simulator());
+        auto elemIt = this->gridView().template begin<0>();
+        const auto& elemEndIt = this->gridView().template end<0>();
+        for (; elemIt != elemEndIt; ++elemIt) {
+            const auto& elem = *elemIt;
+            elemCtx.updateStencil(elem);
+            size_t numPrimaryDof = elemCtx.numPrimaryDof(/*timeIdx=*/0);
+            for (unsigned dofIdx = 0; dofIdx < numPrimaryDof; ++dofIdx) {
+                unsigned globalIdx = elemCtx.globalSpaceIndex(dofIdx, /*timeIdx=*/0);
+                const auto* cachedIntQuants = model.cachedIntensiveQuantities(globalIdx, /*timeIdx=*/0);
+                if (!cachedIntQuants)
+                    continue;
+
+                elemCtx.updateIntensiveQuantities(model.solution(/*timeIdx=*/0)[globalIdx],
+                                                  dofIdx,
+                                                  /*timeIdx=*/0);
+                const auto& fs = elemCtx.intensiveQuantities(dofIdx, /*timeIdx=*/0).fluidState();
+                const auto& cachedFs = cachedIntQuants->fluidState();
+
+                Scalar maxDelta =
+                    std::abs(Toolbox::value(fs.pressure(/*phaseIdx=*/0))
+                             - Toolbox::value(cachedFs.pressure(/*phaseIdx=*/0)))
+                    / std::max<Scalar>(1.0, std::abs(Toolbox::value(fs.pressure(/*phaseIdx=*/0))));
+                for (unsigned phaseIdx = 0; phaseIdx < FluidSystem::numPhases; ++phaseIdx)
+                    maxDelta = std::max<Scalar>(maxDelta,
+                                                std::abs(Toolbox::value(fs.saturation(phaseIdx))
+                                                         - Toolbox::value(cachedFs.saturation(phaseIdx))));
+
+                if (maxDelta > 1e-10)
+                    OPM_THROW(std::logic_error,
+                              "The cached intensive quantities of degree of freedom " << globalIdx
+                              << " do not correspond to its solution after the grid has been adapted");
+            }
+        }
+    }
+
     void setupInitialFluidState_()
     {
         auto& fs = initialFluidState_;
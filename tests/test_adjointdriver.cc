@@ -0,0 +1,305 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \brief This file tests the adjoint driver of the finite volume discretizations.
+ *
+ * The sensitivity of an objective function w.r.t. the initial solution of the lens
+ * problem is computed twice: Once by recomputing the time steps of the forward sweep
+ * from a few checkpoints and once using the Jacobian matrices which the forward sweep
+ * wrote to disk (cf. the AdjointJacobianStoreDirectory parameter). Both results must
+ * agree. Finally, the derivative w.r.t. the saturation of a single degree of freedom is
+ * compared to a finite difference approximation.
+ */
+#include "config.h"
+
+#include <ewoms/common/start.hh>
+#include <ewoms/models/immiscible/immisciblemodel.hh>
+#include <ewoms/disc/ecfv/ecfvdiscretization.hh>
+#include <ewoms/disc/common/fvbaseadjointdriver.hh>
+#include "problems/lensproblem.hh"
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+#include <cmath>
+
+namespace Ewoms {
+template <class TypeTag>
+class LensAdjointProblem;
+}
+
+// the perturbation which is added to a primary variable of the initial solution by the
+// LensAdjointProblem. this is used by the finite difference approximation.
+struct InitialPerturbation
+{
+    int dofIdx;
+    unsigned pvIdx;
+    double delta;
+};
+
+static InitialPerturbation initialPerturbation = { /*dofIdx=*/-1, /*pvIdx=*/0, /*delta=*/0.0 };
+
+namespace Ewoms {
+namespace Properties {
+NEW_TYPE_TAG(LensAdjointProblem, INHERITS_FROM(ImmiscibleTwoPhaseModel, LensBaseProblem));
+
+SET_TAG_PROP(LensAdjointProblem, SpatialDiscretizationSplice, EcfvDiscretization);
+SET_TAG_PROP(LensAdjointProblem, LocalLinearizerSplice, AutoDiffLocalLinearizer);
+SET_TYPE_PROP(LensAdjointProblem, Problem, Ewoms::LensAdjointProblem<TypeTag>);
+
+// the adjoint driver requires the storage and the intensive quantity caches to be
+// disabled
+SET_BOOL_PROP(LensAdjointProblem, EnableStorageCache, false);
+SET_BOOL_PROP(LensAdjointProblem, EnableIntensiveQuantityCache, false);
+
+// use a small grid and only a few time steps. the time steps exhibit a fixed size, so
+// the perturbed runs of the finite difference approximation use the same ones
+SET_INT_PROP(LensAdjointProblem, CellsX, 12);
+SET_INT_PROP(LensAdjointProblem, CellsY, 8);
+SET_SCALAR_PROP(LensAdjointProblem, EndTime, 2000);
+SET_SCALAR_PROP(LensAdjointProblem, InitialTimeStepSize, 250);
+SET_SCALAR_PROP(LensAdjointProblem, MaxTimeStepSize, 250);
+SET_BOOL_PROP(LensAdjointProblem, EnableVtkOutput, false);
+
+// keep only two checkpoints, so that the backward sweep must recompute time steps
+SET_INT_PROP(LensAdjointProblem, AdjointNumCheckpoints, 2);
+
+// the same problem, but the forward sweep writes the Jacobian matrices to disk
+NEW_TYPE_TAG(LensAdjointStoreProblem, INHERITS_FROM(LensAdjointProblem));
+
+SET_STRING_PROP(LensAdjointStoreProblem, AdjointJacobianStoreDirectory, ".");
+}} // namespace Properties, Ewoms
+
+namespace Ewoms {
+/*!
+ * \brief The lens problem plus the run-time parameters of the adjoint driver.
+ *
+ * A primary variable of the initial solution can be perturbed (cf. the
+ * initialPerturbation object).
+ */
+template <class TypeTag>
+class LensAdjointProblem : public LensProblem<TypeTag>
+{
+    typedef LensProblem<TypeTag> ParentType;
+    typedef typename GET_PROP_TYPE(TypeTag, Simulator) Simulator;
+    typedef typename GET_PROP_TYPE(TypeTag, PrimaryVariables) PrimaryVariables;
+
+public:
+    LensAdjointProblem(Simulator& simulator)
+        : ParentType(simulator)
+    { }
+
+    /*!
+     * \copydoc LensProblem::registerParameters
+     */
+    static void registerParameters()
+    {
+        ParentType::registerParameters();
+
+        FvBaseAdjointDriver<TypeTag>::registerParameters();
+    }
+
+    /*!
+     * \copydoc LensProblem::initial
+     */
+    template <class Context>
+    void initial(PrimaryVariables& values, const Context& context, unsigned spaceIdx, unsigned timeIdx) const
+    {
+        ParentType::initial(values, context, spaceIdx, timeIdx);
+
+        int globalIdx = static_cast<int>(context.globalSpaceIndex(spaceIdx, timeIdx));
+        if (globalIdx == initialPerturbation.dofIdx)
+            values[initialPerturbation.pvIdx] += initialPerturbation.delta;
+    }
+};
+} // namespace Ewoms
+
+// run the adjoint driver for a type tag whose parameters have already been set up and
+// return the derivatives of the objective function w.r.t. the initial solution. the
+// objective function is the sum of all primary variables after the last time step.
+template <class TypeTag>
+void computeInitialStateGradient(std::vector<double>& result,
+                                 double& objective,
+                                 unsigned& numRecomputedTimeSteps)
+{
+    typedef typename GET_PROP_TYPE(TypeTag, Simulator) Simulator;
+    typedef typename GET_PROP_TYPE(TypeTag, GlobalEqVector) GlobalEqVector;
+    typedef Ewoms::FvBaseAdjointDriver<TypeTag> AdjointDriver;
+
+    Simulator simulator;
+    AdjointDriver driver(simulator);
+
+    auto stateGradient = [&simulator, &driver, &objective](GlobalEqVector& g, unsigned stepIdx) {
+        if (stepIdx != driver.numTimeSteps())
+            return;
+
+        const auto& solution = simulator.model().solution(/*timeIdx=*/0);
+        objective = 0.0;
+        for (unsigned dofIdx = 0; dofIdx < g.size(); ++dofIdx) {
+            for (unsigned pvIdx = 0; pvIdx < g[dofIdx].size(); ++pvIdx) {
+                objective += solution[dofIdx][pvIdx];
+                g[dofIdx][pvIdx] += 1.0;
+            }
+        }
+    };
+    driver.run(stateGradient);
+
+    numRecomputedTimeSteps = driver.numRecomputedTimeSteps();
+    std::cout << "Adjoint sweep over " << driver.numTimeSteps() << " time steps, "
+              << numRecomputedTimeSteps << " time steps recomputed\n";
+
+    const auto& gradient = driver.initialStateGradient();
+    result.clear();
+    for (unsigned dofIdx = 0; dofIdx < gradient.size(); ++dofIdx)
+        for (unsigned pvIdx = 0; pvIdx < gradient[dofIdx].size(); ++pvIdx)
+            result.push_back(gradient[dofIdx][pvIdx]);
+}
+
+// set up the parameters of a type tag and run the adjoint driver
+template <class TypeTag>
+bool computeInitialStateGradient(std::vector<double>& result,
+                                 double& objective,
+                                 unsigned& numRecomputedTimeSteps,
+                                 int argc,
+                                 char **argv)
+{
+    typedef typename GET_PROP_TYPE(TypeTag, ThreadManager) ThreadManager;
+
+    if (Ewoms::setupParameters_<TypeTag>(argc, argv) != 0)
+        return false;
+
+    ThreadManager::init();
+
+    computeInitialStateGradient<TypeTag>(result, objective, numRecomputedTimeSteps);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    // initialize MPI, finalize is done automatically on exit
+#if HAVE_DUNE_FEM
+    Dune::Fem::MPIManager::initialize(argc, argv);
+#else
+    Dune::MPIHelper::instance(argc, argv);
+#endif
+
+    typedef TTAG(LensAdjointProblem) CheckpointTypeTag;
+    typedef GET_PROP_TYPE(CheckpointTypeTag, Indices) Indices;
+    static const unsigned numEq = GET_PROP_VALUE(CheckpointTypeTag, NumEq);
+
+    std::vector<double> checkpointGradient;
+    std::vector<double> storeGradient;
+    std::vector<double> perturbedGradient;
+    double objective;
+    double storeObjective;
+    double perturbedObjective;
+    unsigned numCheckpointRecomputed;
+    unsigned numStoreRecomputed;
+    unsigned numPerturbedRecomputed;
+    unsigned fdDofIdx = 0;
+    const double fdDelta = -1e-3;
+    try {
+        if (!computeInitialStateGradient<CheckpointTypeTag>(checkpointGradient,
+                                                            objective,
+                                                            numCheckpointRecomputed,
+                                                            argc, argv))
+            return 1;
+
+        if (!computeInitialStateGradient<TTAG(LensAdjointStoreProblem)>(storeGradient,
+                                                                        storeObjective,
+                                                                        numStoreRecomputed,
+                                                                        argc, argv))
+            return 1;
+
+        // perturb the saturation of the degree of freedom which influences the objective
+        // function most. the initial solution is fully water saturated, so the
+        // saturation of the wetting phase is decreased.
+        double maxSatGradient = 0.0;
+        for (unsigned dofIdx = 0; dofIdx*numEq < checkpointGradient.size(); ++dofIdx) {
+            double satGradient = std::abs(checkpointGradient[dofIdx*numEq + Indices::saturation0Idx]);
+            if (satGradient > maxSatGradient) {
+                maxSatGradient = satGradient;
+                fdDofIdx = dofIdx;
+            }
+        }
+
+        initialPerturbation.dofIdx = static_cast<int>(fdDofIdx);
+        initialPerturbation.pvIdx = Indices::saturation0Idx;
+        initialPerturbation.delta = fdDelta;
+        computeInitialStateGradient<CheckpointTypeTag>(perturbedGradient,
+                                                       perturbedObjective,
+                                                       numPerturbedRecomputed);
+    }
+    catch (std::exception& e) {
+        std::cout << e.what() << ". Abort!\n";
+        return 1;
+    }
+
+    if (numCheckpointRecomputed == 0) {
+        std::cout << "The checkpointed backward sweep did not recompute any time step\n";
+        return 1;
+    }
+
+    if (numStoreRecomputed != 0) {
+        std::cout << "The backward sweep recomputed time steps although the Jacobians "
+                  << "were stored\n";
+        return 1;
+    }
+
+    if (checkpointGradient.size() != storeGradient.size()) {
+        std::cout << "The sizes of the gradients do not match\n";
+        return 1;
+    }
+
+    double maxGradient = 0.0;
+    double maxDelta = 0.0;
+    for (size_t i = 0; i < checkpointGradient.size(); ++i) {
+        maxGradient = std::max(maxGradient, std::abs(checkpointGradient[i]));
+        maxDelta = std::max(maxDelta, std::abs(checkpointGradient[i] - storeGradient[i]));
+    }
+
+    std::cout << "Maximum derivative w.r.t. the initial solution: " << maxGradient
+              << ", maximum difference: " << maxDelta << "\n";
+
+    // the Jacobians are stored using single precision by default
+    if (maxGradient <= 0.0 || maxDelta > 1e-3*maxGradient) {
+        std::cout << "The gradients computed with and without the Jacobian store differ\n";
+        return 1;
+    }
+
+    double adjointDerivative = checkpointGradient[fdDofIdx*numEq + Indices::saturation0Idx];
+    double fdDerivative = (perturbedObjective - objective)/fdDelta;
+    std::cout << "Derivative w.r.t. the initial saturation of degree of freedom " << fdDofIdx
+              << ": " << adjointDerivative << " (adjoint), " << fdDerivative
+              << " (finite difference)\n";
+
+    // the finite difference is only accurate to first order
+    if (std::abs(adjointDerivative - fdDerivative) > 5e-2*std::abs(adjointDerivative)) {
+        std::cout << "The adjoint derivative does not match its finite difference approximation\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -25,6 +25,9 @@
  *
  * \brief This test ensures that the API of the black-oil fluid state conforms to the
  *        fluid state specification
+ *
+ * It also checks that the fluid state of a model for which the gas phase has been
+ * disabled at compile time does not store the quantities of this phase.
  */
 #include "config.h"
 
@@ -39,16 +42,76 @@
 #include <dune/common/parallel/mpihelper.hh>
 #include <opm/common/utility/platform_dependent/reenable_warnings.h>
 
+#include <iostream>
+
+namespace Ewoms {
+namespace Properties {
+NEW_TYPE_TAG(BlackOilOilWaterModel, INHERITS_FROM(BlackOilModel));
+
+SET_BOOL_PROP(BlackOilOilWaterModel, BlackOilEnableGasPhase, false);
+SET_BOOL_PROP(BlackOilOilWaterModel, BlackOilEnableDissolvedGas, false);
+SET_BOOL_PROP(BlackOilOilWaterModel, BlackOilEnableVaporizedOil, false);
+}}
+
+template <class TypeTag>
+bool checkStoredQuantities(bool gasIsStored)
+{
+    typedef typename GET_PROP_TYPE(TypeTag, FluidSystem) FluidSystem;
+    typedef Ewoms::BlackOilFluidState<TypeTag> FluidState;
+
+    FluidState fs;
+    for (unsigned phaseIdx = 0; phaseIdx < FluidSystem::numPhases; ++phaseIdx) {
+        fs.setPressure(phaseIdx, 1e5 + phaseIdx);
+        fs.setSaturation(phaseIdx, 0.25 + 0.25*phaseIdx);
+        fs.setInvB(phaseIdx, 1.0 + phaseIdx);
+        fs.setDensity(phaseIdx, 100.0*(1 + phaseIdx));
+    }
+    fs.setRs(50.0);
+    fs.setRv(1e-3);
+
+    for (unsigned phaseIdx = 0; phaseIdx < FluidSystem::numPhases; ++phaseIdx) {
+        bool isStored = gasIsStored || phaseIdx != FluidSystem::gasPhaseIdx;
+        if (fs.pressure(phaseIdx).value() != (isStored ? 1e5 + phaseIdx : 0.0)
+            || fs.saturation(phaseIdx).value() != (isStored ? 0.25 + 0.25*phaseIdx : 0.0)
+            || fs.invB(phaseIdx).value() != (isStored ? 1.0 + phaseIdx : 0.0)
+            || fs.density(phaseIdx).value() != (isStored ? 100.0*(1 + phaseIdx) : 0.0))
+            return false;
+    }
+
+    return
+        fs.Rs().value() == (gasIsStored ? 50.0 : 0.0)
+        && fs.Rv().value() == (gasIsStored ? 1e-3 : 0.0);
+}
+
 int main(int argc, char **argv)
 {
     typedef TTAG(BlackOilModel) TypeTag;
     typedef typename GET_PROP_TYPE(TypeTag, Evaluation) Evaluation;
     typedef Ewoms::BlackOilFluidState<TypeTag> FluidState;
 
+    typedef TTAG(BlackOilOilWaterModel) OilWaterTypeTag;
+    typedef typename GET_PROP_TYPE(OilWaterTypeTag, Evaluation) OilWaterEvaluation;
+    typedef Ewoms::BlackOilFluidState<OilWaterTypeTag> OilWaterFluidState;
+
     Dune::MPIHelper::instance(argc, argv);
 
     FluidState fs;
     checkFluidState<Evaluation>(fs);
 
+    OilWaterFluidState oilWaterFs;
+    checkFluidState<OilWaterEvaluation>(oilWaterFs);
+
+    if (!checkStoredQuantities<TypeTag>(/*gasIsStored=*/true)
+        || !checkStoredQuantities<OilWaterTypeTag>(/*gasIsStored=*/false))
+    {
+        std::cout << "The black-oil fluid state does not store the right quantities\n";
+        return 1;
+    }
+
+    if (sizeof(OilWaterFluidState) >= sizeof(FluidState)) {
+        std::cout << "The oil-water fluid state is not smaller than the three-phase one\n";
+        return 1;
+    }
+
     return 0;
 }
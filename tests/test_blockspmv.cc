@@ -0,0 +1,197 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \brief This file tests the sparse matrix-vector kernels which are specialized on
+ *        the size of the matrix blocks.
+ *
+ * The results of the matrix-vector product and of the ILU(0) preconditioner are
+ * compared with the generic code of dune-istl, and the run times of both variants are
+ * printed.
+ */
+#include "config.h"
+
+#include <ewoms/linear/blockspmvkernels.hh>
+#include <ewoms/linear/seqtransposableilu0.hh>
+#include <ewoms/common/timer.hh>
+
+#include <dune/common/fmatrix.hh>
+#include <dune/common/fvector.hh>
+#include <dune/common/parallel/mpihelper.hh>
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/bvector.hh>
+#include <dune/istl/ilu.hh>
+
+#include <algorithm>
+#include <iostream>
+#include <cmath>
+#include <limits>
+#include <cstdlib>
+
+// the number of rows of the test matrix and the number of times each operation is
+// repeated for measuring its run time
+static const unsigned numRows = 100000;
+static const unsigned numRepetitions = 20;
+
+template <class Vector>
+typename Vector::field_type maxDifference(const Vector& u, const Vector& v)
+{
+    typename Vector::field_type result = 0.0;
+    for (unsigned i = 0; i < u.size(); ++i)
+        for (unsigned j = 0; j < u[i].size(); ++j)
+            result = std::max(result, std::abs(u[i][j] - v[i][j]));
+    return result;
+}
+
+// create a diagonally dominant block matrix which exhibits the sparsity pattern of a
+// seven point stencil of a structured 3D grid
+template <class Matrix>
+void createMatrix(Matrix& A)
+{
+    typedef typename Matrix::block_type MatrixBlock;
+    const int nx = 50;
+    const int nxy = nx*nx;
+    const int offsets[7] = { -nxy, -nx, -1, 0, 1, nx, nxy };
+
+    unsigned numNonZeros = 0;
+    for (int i = 0; i < static_cast<int>(numRows); ++i)
+        for (int k = 0; k < 7; ++k)
+            if (0 <= i + offsets[k] && i + offsets[k] < static_cast<int>(numRows))
+                ++numNonZeros;
+
+    A.setSize(numRows, numRows, numNonZeros);
+    A.setBuildMode(Matrix::row_wise);
+    for (auto rowIt = A.createbegin(); rowIt != A.createend(); ++rowIt) {
+        int i = static_cast<int>(rowIt.index());
+        for (int k = 0; k < 7; ++k)
+            if (0 <= i + offsets[k] && i + offsets[k] < static_cast<int>(numRows))
+                rowIt.insert(static_cast<unsigned>(i + offsets[k]));
+    }
+
+    std::srand(42);
+    for (auto rowIt = A.begin(); rowIt != A.end(); ++rowIt) {
+        for (auto colIt = rowIt->begin(); colIt != rowIt->end(); ++colIt) {
+            MatrixBlock& block = *colIt;
+            for (unsigned i = 0; i < MatrixBlock::rows; ++i) {
+                for (unsigned j = 0; j < MatrixBlock::cols; ++j) {
+                    block[i][j] = static_cast<double>(std::rand())/RAND_MAX - 0.5;
+                    if (colIt.index() == rowIt.index() && i == j)
+                        block[i][j] += 10.0*MatrixBlock::rows;
+                }
+            }
+        }
+    }
+}
+
+template <class Scalar, int numEq>
+bool testBlockSize()
+{
+    typedef Dune::FieldMatrix<Scalar, numEq, numEq> MatrixBlock;
+    typedef Dune::FieldVector<Scalar, numEq> VectorBlock;
+    typedef Dune::BCRSMatrix<MatrixBlock> Matrix;
+    typedef Dune::BlockVector<VectorBlock> Vector;
+
+    const Scalar tolerance = 1e3*std::numeric_limits<Scalar>::epsilon();
+
+    Matrix A;
+    createMatrix(A);
+
+    Vector x(numRows);
+    for (unsigned i = 0; i < numRows; ++i)
+        for (unsigned j = 0; j < numEq; ++j)
+            x[i][j] = std::sin(static_cast<Scalar>(i*numEq + j));
+
+    Vector yGeneric(numRows);
+    Vector yKernel(numRows);
+
+    // matrix-vector product
+    Ewoms::Timer genericTimer;
+    genericTimer.start();
+    for (unsigned k = 0; k < numRepetitions; ++k)
+        A.mv(x, yGeneric);
+    genericTimer.stop();
+
+    Ewoms::Timer kernelTimer;
+    kernelTimer.start();
+    for (unsigned k = 0; k < numRepetitions; ++k)
+        Ewoms::Linear::blockMv(A, x, yKernel);
+    kernelTimer.stop();
+
+    Scalar mvError = maxDifference(yGeneric, yKernel);
+    std::cout << "numEq=" << numEq << ", sizeof(Scalar)=" << sizeof(Scalar)
+              << ": SpMV generic " << genericTimer.realTimeElapsed() << "s,"
+              << " specialized " << kernelTimer.realTimeElapsed() << "s,"
+              << " max. difference " << mvError << "\n";
+
+    // ILU(0) preconditioner
+    Matrix ilu(A);
+    Dune::bilu0_decomposition(ilu);
+    Ewoms::Linear::SeqTransposableIlu0<Matrix, Vector, Vector> preCond(A, /*relaxation=*/1.0);
+
+    genericTimer.halt();
+    genericTimer.start();
+    for (unsigned k = 0; k < numRepetitions; ++k)
+        Dune::bilu_backsolve(ilu, yGeneric, x);
+    genericTimer.stop();
+
+    kernelTimer.halt();
+    kernelTimer.start();
+    for (unsigned k = 0; k < numRepetitions; ++k)
+        preCond.apply(yKernel, x);
+    kernelTimer.stop();
+
+    Scalar iluError = maxDifference(yGeneric, yKernel);
+    std::cout << "numEq=" << numEq << ", sizeof(Scalar)=" << sizeof(Scalar)
+              << ": ILU(0) generic " << genericTimer.realTimeElapsed() << "s,"
+              << " specialized " << kernelTimer.realTimeElapsed() << "s,"
+              << " max. difference " << iluError << "\n";
+
+    return mvError <= tolerance && iluError <= tolerance;
+}
+
+int main(int argc, char **argv)
+{
+    // initialize MPI, finalize is done automatically on exit
+    Dune::MPIHelper::instance(argc, argv);
+
+#if EWOMS_HAVE_AVX2_SPMV_KERNELS
+    std::cout << "Using the AVX2 kernels\n";
+#else
+    std::cout << "Not using the AVX2 kernels\n";
+#endif
+
+    bool success = true;
+    success = testBlockSize<double, 1>() && success;
+    success = testBlockSize<double, 2>() && success;
+    success = testBlockSize<double, 3>() && success;
+    success = testBlockSize<double, 4>() && success;
+    success = testBlockSize<float, 3>() && success;
+
+    if (!success) {
+        std::cout << "The results of the specialized kernels differ from the generic ones\n";
+        return 1;
+    }
+
+    return 0;
+}
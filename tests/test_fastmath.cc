@@ -0,0 +1,210 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \brief This file tests the fast approximations of exp(), log() and pow().
+ *
+ * The values and the derivatives are compared with the exact versions of the standard
+ * library and of opm-material, and the run times of both variants are printed.
+ */
+#include "config.h"
+
+#include <ewoms/common/fastmath.hh>
+#include <ewoms/common/timer.hh>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+static const unsigned numSamples = 1000000;
+
+typedef Opm::DenseAd::Evaluation<double, 3> Evaluation;
+
+static double relativeError(double exact, double approx)
+{
+    if (exact == approx)
+        return 0.0;
+    return std::abs(exact - approx)/std::max(std::abs(exact), std::numeric_limits<double>::min());
+}
+
+// the derivatives may be sums of terms which cancel each other, so their errors are
+// measured relative to the magnitude of the value and the derivative
+static double maxError(const Evaluation& exact, const Evaluation& approx)
+{
+    double result = relativeError(exact.value(), approx.value());
+    for (int varIdx = 0; varIdx < 3; ++varIdx) {
+        double scale = std::max(std::abs(exact.value()), std::abs(exact.derivative(varIdx)));
+        double error = std::abs(exact.derivative(varIdx) - approx.derivative(varIdx));
+        result = std::max(result, error/scale);
+    }
+    return result;
+}
+
+static bool check(const std::string& name, double error, double tolerance)
+{
+    std::cout << name << ": max. relative error " << error << "\n";
+    if (error <= tolerance)
+        return true;
+
+    std::cout << "  the error exceeds the tolerance of " << tolerance << "\n";
+    return false;
+}
+
+static Evaluation makeEvaluation(double value)
+{
+    Evaluation result(value);
+    result.setDerivative(0, 1.0);
+    result.setDerivative(1, -0.5);
+    result.setDerivative(2, 2.0);
+    return result;
+}
+
+bool testScalars()
+{
+    const double tol = Ewoms::FastMath::maxRelativeError();
+    bool success = true;
+
+    double expError = 0.0;
+    double logError = 0.0;
+    double powError = 0.0;
+    for (unsigned i = 0; i < numSamples; ++i) {
+        // the arguments cover the whole range of normal results
+        double x = -700.0 + 1400.0*i/numSamples;
+        expError = std::max(expError, relativeError(std::exp(x), Ewoms::FastMath::exp(x)));
+
+        double y = std::exp(x);
+        logError = std::max(logError, relativeError(std::log(y), Ewoms::FastMath::log(y)));
+
+        // the typical range of viscosities and mixing exponents
+        double base = 1e-5 + 1e-1*i/numSamples;
+        double exponent = -4.0 + 8.0*((i*7919) % numSamples)/numSamples;
+        powError = std::max(powError,
+                            relativeError(std::pow(base, exponent),
+                                          Ewoms::FastMath::pow(base, exponent)));
+    }
+    success = check("exp", expError, tol) && success;
+    success = check("log", logError, tol) && success;
+    success = check("pow", powError, 100*tol) && success;
+
+    // special cases
+    const double inf = std::numeric_limits<double>::infinity();
+    success = success
+        && Ewoms::FastMath::exp(1000.0) == inf
+        && Ewoms::FastMath::exp(-1000.0) == 0.0
+        && Ewoms::FastMath::log(0.0) == -inf
+        && std::isnan(Ewoms::FastMath::log(-1.0))
+        && Ewoms::FastMath::pow(-2.0, 3.0) == -8.0
+        && std::isnan(Ewoms::FastMath::pow(-2.0, 0.5))
+        && Ewoms::FastMath::pow(0.0, 2.5) == 0.0;
+    if (!success)
+        std::cout << "The special cases are not handled correctly\n";
+
+    return success;
+}
+
+bool testEvaluations()
+{
+    const double tol = Ewoms::FastMath::maxRelativeError();
+    typedef Ewoms::MathKernels</*useFastMath=*/true> Fast;
+    typedef Ewoms::MathKernels</*useFastMath=*/false> Exact;
+
+    double expError = 0.0;
+    double logError = 0.0;
+    double powError = 0.0;
+    for (unsigned i = 0; i < numSamples/100; ++i) {
+        const Evaluation& x = makeEvaluation(-20.0 + 40.0*i/(numSamples/100));
+        expError = std::max(expError, maxError(Exact::exp(x), Fast::exp(x)));
+
+        const Evaluation& y = makeEvaluation(1e-3 + 10.0*i/(numSamples/100));
+        logError = std::max(logError, maxError(Exact::log(y), Fast::log(y)));
+
+        const Evaluation& exponent = makeEvaluation(0.25 + 0.5*i/(numSamples/100));
+        powError = std::max(powError, maxError(Exact::pow(y, 0.25), Fast::pow(y, 0.25)));
+        powError = std::max(powError, maxError(Exact::pow(y, 4.0), Fast::pow(y, 4.0)));
+        powError = std::max(powError, maxError(Exact::pow(y, exponent), Fast::pow(y, exponent)));
+    }
+
+    bool success = true;
+    success = check("exp(Evaluation)", expError, 10*tol) && success;
+    success = check("log(Evaluation)", logError, 10*tol) && success;
+    success = check("pow(Evaluation)", powError, 100*tol) && success;
+    return success;
+}
+
+template <class Fn>
+double measure(const std::vector<double>& args, Fn fn)
+{
+    Ewoms::Timer timer;
+    timer.start();
+    double sum = 0.0;
+    for (unsigned i = 0; i < args.size(); ++i)
+        sum += fn(args[i]);
+    timer.stop();
+
+    // make sure that the loop is not optimized away
+    if (sum == 42.0)
+        std::cout << "";
+    return timer.realTimeElapsed();
+}
+
+void printRunTimes()
+{
+    std::vector<double> args(numSamples);
+    for (unsigned i = 0; i < numSamples; ++i)
+        args[i] = 1e-3 + 10.0*i/numSamples;
+
+    std::cout << "Run times for " << numSamples << " evaluations [s]:\n"
+              << "exp: std " << measure(args, [](double x) { return std::exp(x); })
+              << ", fast " << measure(args, [](double x) { return Ewoms::FastMath::exp(x); }) << "\n"
+              << "log: std " << measure(args, [](double x) { return std::log(x); })
+              << ", fast " << measure(args, [](double x) { return Ewoms::FastMath::log(x); }) << "\n"
+              << "pow: std " << measure(args, [](double x) { return std::pow(x, 0.25); })
+              << ", fast " << measure(args, [](double x) { return Ewoms::FastMath::pow(x, 0.25); })
+              << "\n"
+              << "pow(Evaluation): exact "
+              << measure(args, [](double x)
+                         { return Ewoms::MathKernels<false>::pow(makeEvaluation(x), 0.25).derivative(0); })
+              << ", fast "
+              << measure(args, [](double x)
+                         { return Ewoms::MathKernels<true>::pow(makeEvaluation(x), 0.25).derivative(0); })
+              << "\n";
+}
+
+int main()
+{
+    bool success = true;
+    success = testScalars() && success;
+    success = testEvaluations() && success;
+    printRunTimes();
+
+    if (!success) {
+        std::cout << "The fast approximations are not accurate enough\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,170 @@
+// -*- mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*-
+// vi: set et ts=4 sw=4 sts=4:
+/*
+  This file is part of the Open Porous Media project (OPM).
+
+  OPM is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  OPM is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with OPM.  If not, see <http://www.gnu.org/licenses/>.
+
+  Consult the COPYING file in the top-level source directory of this
+  module for the precise wording of the license and the list of
+  copyright holders.
+*/
+/*!
+ * \file
+ *
+ * \brief This file tests the repeated factorization of matrices which exhibit the same
+ *        sparsity pattern by the SuperLU backend.
+ *
+ * The first factorization computes the symbolic analysis, the following ones reuse it
+ * and the row permutation of the previous one. The last matrix requires different
+ * pivots, so that the factorization must be redone from scratch.
+ */
+#include "config.h"
+
+#include <ewoms/common/propertysystem.hh>
+#include <ewoms/linear/superlubackend.hh>
+
+#include <dune/common/fmatrix.hh>
+#include <dune/common/fvector.hh>
+#include <dune/common/parallel/mpihelper.hh>
+#include <dune/istl/bcrsmatrix.hh>
+#include <dune/istl/bvector.hh>
+
+#include <algorithm>
+#include <iostream>
+#include <cmath>
+
+static const int blockSize = 2;
+static const unsigned numRows = 50;
+
+typedef Dune::FieldMatrix<double, blockSize, blockSize> MatrixBlock;
+typedef Dune::FieldVector<double, blockSize> VectorBlock;
+typedef Dune::BCRSMatrix<MatrixBlock> Matrix;
+typedef Dune::BlockVector<VectorBlock> Vector;
+
+namespace Ewoms {
+namespace Properties {
+NEW_TYPE_TAG(SuperLUTestTypeTag, INHERITS_FROM(SuperLULinearSolver));
+
+SET_TYPE_PROP(SuperLUTestTypeTag, JacobianMatrix, ::Matrix);
+SET_TYPE_PROP(SuperLUTestTypeTag, GlobalEqVector, ::Vector);
+} // namespace Properties
+} // namespace Ewoms
+
+typedef Ewoms::Linear::SuperLUFactorization_<TTAG(SuperLUTestTypeTag)> Factorization;
+
+// create a block tridiagonal matrix. if 'swapPivots' is true, the diagonal entries of
+// the diagonal blocks are zero, i.e., the rows must be pivoted differently.
+void createMatrix(Matrix& A, double scale, bool swapPivots)
+{
+    A.setSize(numRows, numRows, 3*numRows - 2);
+    A.setBuildMode(Matrix::row_wise);
+    for (auto rowIt = A.createbegin(); rowIt != A.createend(); ++rowIt) {
+        unsigned i = rowIt.index();
+        if (i > 0)
+            rowIt.insert(i - 1);
+        rowIt.insert(i);
+        if (i + 1 < numRows)
+            rowIt.insert(i + 1);
+    }
+
+    for (auto rowIt = A.begin(); rowIt != A.end(); ++rowIt) {
+        for (auto colIt = rowIt->begin(); colIt != rowIt->end(); ++colIt) {
+            MatrixBlock& block = *colIt;
+            for (int i = 0; i < blockSize; ++i) {
+                for (int j = 0; j < blockSize; ++j) {
+                    double off = 0.1*std::sin(static_cast<double>(rowIt.index()*7 + colIt.index()*3 + i*2 + j));
+                    block[i][j] = scale*off;
+                    if (colIt.index() == rowIt.index()) {
+                        bool dominant = swapPivots ? (i != j) : (i == j);
+                        block[i][j] = dominant ? scale*(4.0 + i) : 0.0;
+                    }
+                }
+            }
+        }
+    }
+}
+
+// solve the system and its transposed for a given matrix and compare the results with
+// the exact solution
+bool checkFactorization(Factorization& factorization, const Matrix& A, bool reuseRowPerm)
+{
+    if (!factorization.factorize(A, reuseRowPerm, /*verbosity=*/1)) {
+        std::cout << "Factorizing the matrix failed\n";
+        return false;
+    }
+
+    Vector xRef(numRows);
+    for (unsigned i = 0; i < numRows; ++i)
+        for (int j = 0; j < blockSize; ++j)
+            xRef[i][j] = std::cos(static_cast<double>(i*blockSize + j));
+
+    bool success = true;
+    for (int transposed = 0; transposed < 2; ++transposed) {
+        Vector b(numRows);
+        if (transposed)
+            A.mtv(xRef, b);
+        else
+            A.mv(xRef, b);
+
+        Vector x(numRows);
+        x = 0.0;
+        if (!factorization.solve(x, b, transposed != 0)) {
+            std::cout << "Solving the factorized system failed\n";
+            return false;
+        }
+
+        double maxError = 0.0;
+        for (unsigned i = 0; i < numRows; ++i)
+            for (int j = 0; j < blockSize; ++j)
+                maxError = std::max(maxError, std::abs(x[i][j] - xRef[i][j]));
+
+        std::cout << (transposed ? "transposed" : "regular") << " solve: max. error "
+                  << maxError << "\n";
+        success = success && maxError < 1e-10;
+    }
+
+    return success;
+}
+
+int main(int argc, char **argv)
+{
+    // initialize MPI, finalize is done automatically on exit
+    Dune::MPIHelper::instance(argc, argv);
+
+    bool success = true;
+    for (int reuseRowPerm = 0; reuseRowPerm < 2; ++reuseRowPerm) {
+        std::cout << "Reusing the row permutation: " << (reuseRowPerm ? "yes" : "no") << "\n";
+
+        Factorization factorization;
+        Matrix A;
+
+        // the values change, but the sparsity pattern stays the same
+        for (int k = 0; k < 3; ++k) {
+            createMatrix(A, /*scale=*/1.0 + 0.1*k, /*swapPivots=*/false);
+            success = checkFactorization(factorization, A, reuseRowPerm != 0) && success;
+        }
+
+        // the old pivots are not suitable for this matrix
+        createMatrix(A, /*scale=*/1.0, /*swapPivots=*/true);
+        success = checkFactorization(factorization, A, reuseRowPerm != 0) && success;
+    }
+
+    if (!success) {
+        std::cout << "The SuperLU backend did not solve the systems correctly\n";
+        return 1;
+    }
+
+    return 0;
+}